@@ -23,12 +23,20 @@
 	/**
 	 * @brief Initializes the generic ATA device driver
 	 * 
-	 * @details Initializes the generic ATA device driver by first probing the
-	 *          devices that are connected to the primary and secondary ATA
+	 * @details Initializes the generic ATA device driver by starting to probe
+	 *          the devices that are connected to the primary and secondary ATA
 	 *          buses, and then registering the ATA interrupt handlers.
 	 * 
 	 * @author Pedro H. Penna
 	 */
 	extern void ata_init(void);
+	
+	/**
+	 * @brief Completes probing ATA devices.
+	 * 
+	 * @details Waits, with bounded timeouts, for the devices whose probing was
+	 *          started by ata_init(), probing both buses at once.
+	 */
+	extern void ata_probe(void);
 
 #endif /* ATA_H_ */
@@ -0,0 +1,33 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BOOTLOG_H_
+#define BOOTLOG_H_
+
+	/**
+	 * @brief Initializes the boot timeline driver.
+	 */
+	extern void bootlog_init(void);
+	
+	/**
+	 * @brief Marks the start of a boot phase.
+	 */
+	extern void boot_mark(const char *name);
+
+#endif /* BOOTLOG_H_ */
@@ -0,0 +1,38 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KPROF_H_
+#define KPROF_H_
+
+	/**
+	 * @brief Is the profiler sampling?
+	 */
+	extern int kprof_on;
+
+	/**
+	 * @brief Initializes the kernel profiler driver.
+	 */
+	extern void kprof_init(void);
+	
+	/**
+	 * @brief Samples the interrupted context.
+	 */
+	extern void kprof_tick(void);
+
+#endif /* KPROF_H_ */
@@ -0,0 +1,64 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PCI_H_
+#define PCI_H_
+
+	#include <nanvix/const.h>
+	#include <stdint.h>
+
+	/* PCI configuration space registers. */
+	#define PCI_REG_ID      0x00 /* Vendor and device IDs. */
+	#define PCI_REG_COMMAND 0x04 /* Command and status.    */
+	#define PCI_REG_CLASS   0x08 /* Class code.            */
+	#define PCI_REG_HEADER  0x0c /* Header type.           */
+	#define PCI_REG_BAR0    0x10 /* Base address 0.        */
+	#define PCI_REG_BAR4    0x20 /* Base address 4.        */
+	#define PCI_REG_BAR5    0x24 /* Base address 5.        */
+	#define PCI_REG_IRQ     0x3c /* Interrupt line.        */
+
+	/* PCI command register. */
+	#define PCI_CMD_IO     (1 << 0) /* I/O space enable.    */
+	#define PCI_CMD_MEMORY (1 << 1) /* Memory space enable. */
+	#define PCI_CMD_MASTER (1 << 2) /* Bus master enable.   */
+
+	/* PCI device classes. */
+	#define PCI_CLASS_STORAGE 0x01 /* Mass storage controller. */
+
+	/* PCI mass storage subclasses. */
+	#define PCI_STORAGE_IDE  0x01 /* IDE controller.  */
+	#define PCI_STORAGE_SATA 0x06 /* SATA controller. */
+
+	/**
+	 * @brief PCI device address.
+	 */
+	struct pci_dev
+	{
+		unsigned bus;  /**< Bus number.      */
+		unsigned slot; /**< Slot number.     */
+		unsigned func; /**< Function number. */
+	};
+
+	/* Forward definitions. */
+	EXTERN uint32_t pci_read(const struct pci_dev *, unsigned);
+	EXTERN void pci_write(const struct pci_dev *, unsigned, uint32_t);
+	EXTERN int pci_find(struct pci_dev *, unsigned, unsigned);
+	EXTERN int pci_find_id(struct pci_dev *, unsigned, unsigned, unsigned);
+
+#endif /* PCI_H_ */
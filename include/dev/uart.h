@@ -0,0 +1,38 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UART_H_
+#define UART_H_
+
+	/**
+	 * @brief Initializes the serial line device driver.
+	 * 
+	 * @details Probes the 16550 UART on COM1, enables its FIFOs and
+	 *          registers the interrupt handler and the character device.
+	 */
+	extern void uart_init(void);
+	
+	/**
+	 * @brief Asserts if the serial line is present.
+	 * 
+	 * @returns Non-zero if the serial line was found, and zero otherwise.
+	 */
+	extern int uart_present(void);
+
+#endif /* UART_H_ */
@@ -0,0 +1,32 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef VIRTBLK_H_
+#define VIRTBLK_H_
+
+	/**
+	 * @brief Initializes the virtio-blk device driver
+	 * 
+	 * @details Initializes the virtio-blk device driver by first probing the
+	 *          virtio block devices on the PCI bus, setting up their request
+	 *          virtqueues, and then registering the interrupt handlers.
+	 */
+	extern void virtblk_init(void);
+
+#endif /* VIRTBLK_H_ */
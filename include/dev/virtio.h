@@ -0,0 +1,144 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef VIRTIO_H_
+#define VIRTIO_H_
+
+	#include <nanvix/config.h>
+	#include <nanvix/const.h>
+	#include <nanvix/mm.h>
+	#include <stdint.h>
+
+	/* virtio PCI vendor ID. */
+	#define VIRTIO_VENDOR 0x1af4 /* Red Hat, Inc. */
+
+	/* Legacy virtio registers (offsets in I/O space). */
+	#define VIRTIO_REG_HOST_FEATURES  0x00 /* Device features. */
+	#define VIRTIO_REG_GUEST_FEATURES 0x04 /* Driver features. */
+	#define VIRTIO_REG_QUEUE_PFN      0x08 /* Queue address.   */
+	#define VIRTIO_REG_QUEUE_SIZE     0x0c /* Queue size.      */
+	#define VIRTIO_REG_QUEUE_SEL      0x0e /* Queue select.    */
+	#define VIRTIO_REG_QUEUE_NOTIFY   0x10 /* Queue notify.    */
+	#define VIRTIO_REG_STATUS         0x12 /* Device status.   */
+	#define VIRTIO_REG_ISR            0x13 /* ISR status.      */
+	#define VIRTIO_REG_CONFIG         0x14 /* Device config.   */
+
+	/* Device status register. */
+	#define VIRTIO_STATUS_ACK       (1 << 0) /* Device found.     */
+	#define VIRTIO_STATUS_DRIVER    (1 << 1) /* Driver found.     */
+	#define VIRTIO_STATUS_DRIVER_OK (1 << 2) /* Driver is ready.  */
+	#define VIRTIO_STATUS_FAILED    (1 << 7) /* Driver gave up.   */
+
+	/* ISR status register. */
+	#define VIRTIO_ISR_QUEUE (1 << 0) /* Used ring updated. */
+
+	/* Device independent features. */
+	#define VIRTIO_RING_F_EVENT_IDX (1 << 29) /* Event indexes. */
+
+	/* Virtqueue descriptor flags. */
+	#define VRING_DESC_F_NEXT  (1 << 0) /* Chained.         */
+	#define VRING_DESC_F_WRITE (1 << 1) /* Device writable. */
+
+	/* Virtqueue ring flags. */
+	#define VRING_AVAIL_F_NO_INTERRUPT (1 << 0) /* Don't interrupt us.  */
+	#define VRING_USED_F_NO_NOTIFY     (1 << 0) /* Don't notify device. */
+
+	/* Maximum virtqueue size that we support. */
+	#define VIRTIO_QUEUE_MAX 256
+
+	/*
+	 * Returns the offset of the used ring in a legacy virtqueue of n entries.
+	 */
+	#define vring_used_off(n) \
+		ALIGN(16*(n) + 6 + 2*(n), PAGE_SIZE)
+
+	/*
+	 * Returns the size of a legacy virtqueue of n entries.
+	 */
+	#define vring_size(n) \
+		(vring_used_off(n) + ALIGN(6 + 8*(n), PAGE_SIZE))
+
+	/*
+	 * Asserts if moving a ring index from old to new crosses
+	 * the event index that the other side has published.
+	 */
+	#define vring_need_event(event, new, old) \
+		((uint16_t)((new) - (event) - 1) < (uint16_t)((new) - (old)))
+
+	/*
+	 * Converts a kernel virtual address into a physical address.
+	 */
+	#define virtio_phys(x) \
+		((uint32_t)(x) - KBASE_VIRT + KBASE_PHYS)
+
+	/*
+	 * Full memory barrier.
+	 */
+	#define virtio_mb() \
+		__asm__ __volatile__("lock; addl $0, 0(%%esp)" ::: "memory")
+
+	/*
+	 * Write memory barrier. Stores are not reordered on x86.
+	 */
+	#define virtio_wmb() \
+		__asm__ __volatile__("" ::: "memory")
+
+	/*
+	 * Virtqueue descriptor.
+	 */
+	struct vring_desc
+	{
+		uint64_t addr;  /* Physical address.    */
+		uint32_t len;   /* Length.              */
+		uint16_t flags; /* Flags (see above).   */
+		uint16_t next;  /* Next in the chain.   */
+	} __attribute__((packed));
+
+	/*
+	 * Available ring. With event indexes, the
+	 * used event follows the last ring entry.
+	 */
+	struct vring_avail
+	{
+		uint16_t flags;  /* Flags (see above).   */
+		uint16_t idx;    /* Next free entry.     */
+		uint16_t ring[]; /* Descriptor chains.   */
+	} __attribute__((packed));
+
+	/*
+	 * Used ring entry.
+	 */
+	struct vring_used_elem
+	{
+		uint32_t id;  /* Descriptor chain.  */
+		uint32_t len; /* Bytes written.     */
+	} __attribute__((packed));
+
+	/*
+	 * Used ring. With event indexes, the
+	 * avail event follows the last ring entry.
+	 */
+	struct vring_used
+	{
+		uint16_t flags;                /* Flags (see above). */
+		uint16_t idx;                  /* Next free entry.   */
+		struct vring_used_elem ring[]; /* Used chains.       */
+	} __attribute__((packed));
+
+#endif /* VIRTIO_H_ */
@@ -0,0 +1,33 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef VIRTNET_H_
+#define VIRTNET_H_
+
+	/**
+	 * @brief Initializes the virtio-net device driver
+	 * 
+	 * @details Initializes the virtio-net device driver by first probing the
+	 *          virtio network devices on the PCI bus, setting up their receive
+	 *          and transmit virtqueues, and then registering the interrupt
+	 *          handlers. Frame buffers are only allocated on first open.
+	 */
+	extern void virtnet_init(void);
+
+#endif /* VIRTNET_H_ */
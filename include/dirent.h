@@ -32,8 +32,28 @@
 		char d_name[NAME_MAX]; /* Name of entry.      */
 	};
 	
+	/*
+	 * Packed directory entry, as returned by getdents().
+	 */
+	struct dent
+	{
+		ino_t d_ino;             /* File serial number.  */
+		unsigned short d_reclen; /* Length of the entry. */
+		unsigned char d_type;    /* File type.           */
+		char d_name[1];          /* Name of entry.       */
+	};
+	
+	/* File types in packed directory entries. */
+	#define DT_UNKNOWN 0 /* Unknown.                */
+	#define DT_FIFO    1 /* FIFO special file.      */
+	#define DT_CHR     2 /* Character special file. */
+	#define DT_DIR     4 /* Directory.              */
+	#define DT_BLK     6 /* Block special file.     */
+	#define DT_REG     8 /* Regular file.           */
+	#define DT_SOCK   12 /* Socket.                 */
+	
 	/* Directory stream buffer size. */
-	#define _DIR_BUFSIZ ((1024/sizeof(struct dirent))*sizeof(struct dirent))
+	#define _DIR_BUFSIZ 1024
 
 	/* Directory stream flags. */
 	#define _DIR_VALID 001 /* Valid directory?  */
@@ -46,9 +66,10 @@
 	{
 		int fd;             /* Underlying file descriptor.       */
 		int flags;          /* Flags (see above).                */
-		int count;          /* Valid entries left in the buffer. */
-		struct dirent *ptr; /* Next valid entry in the buffer.   */
-		struct dirent *buf; /* Buffer of directory entries.      */
+		int count;          /* Bytes left in the buffer.         */
+		char *ptr;          /* Next packed entry in the buffer.  */
+		char *buf;          /* Buffer of packed entries.         */
+		struct dirent ent;  /* Last entry read.                  */
 	} DIR;
 	
 	/*
@@ -70,5 +91,16 @@
 	 * Rewinds a directory stream.
 	 */
 	extern void rewinddir(DIR *dirp);
+	
+	/*
+	 * Gets the file descriptor of a directory stream.
+	 */
+	#define dirfd(dirp) \
+		((dirp)->fd)
+	
+	/*
+	 * Reads packed directory entries.
+	 */
+	extern int getdents(int fd, void *buf, size_t n);
 
 #endif /* DIRENT_H_ */
@@ -125,4 +125,48 @@
 		uint32_t p_align;  /* Alignment value.                    */
 	};
 
+	/* Section types. */
+	#define SHT_NULL     0 /* Unused section.      */
+	#define SHT_PROGBITS 1 /* Program data.        */
+	#define SHT_SYMTAB   2 /* Symbol table.        */
+	#define SHT_STRTAB   3 /* String table.        */
+	
+	/* Symbol types. */
+	#define STT_NOTYPE 0 /* Unspecified type. */
+	#define STT_OBJECT 1 /* Data object.      */
+	#define STT_FUNC   2 /* Function.         */
+	
+	/* Gets the type of a symbol. */
+	#define ELF32_ST_TYPE(i) ((i) & 0xf)
+
+	/*
+	 * ELF 32 section header.
+	 */
+	struct elf32_shdr
+	{
+		uint32_t sh_name;      /* Section name (string table index). */
+		uint32_t sh_type;      /* Section type.                      */
+		uint32_t sh_flags;     /* Section flags.                     */
+		uint32_t sh_addr;      /* Address in memory image.           */
+		uint32_t sh_offset;    /* Offset in file.                    */
+		uint32_t sh_size;      /* Section size.                      */
+		uint32_t sh_link;      /* Link to another section.           */
+		uint32_t sh_info;      /* Additional information.            */
+		uint32_t sh_addralign; /* Alignment.                         */
+		uint32_t sh_entsize;   /* Size of entries, if any.           */
+	};
+	
+	/*
+	 * ELF 32 symbol table entry.
+	 */
+	struct elf32_sym
+	{
+		uint32_t st_name;  /* Symbol name (string table index). */
+		uint32_t st_value; /* Symbol value.                     */
+		uint32_t st_size;  /* Symbol size.                      */
+		uint8_t st_info;   /* Symbol type and binding.          */
+		uint8_t st_other;  /* Symbol visibility.                */
+		uint16_t st_shndx; /* Section index.                    */
+	};
+
 #endif /* ELF_H_ */
@@ -20,6 +20,8 @@
 #ifndef FCNTL_H_
 #define FCNTL_H_
 
+	#include <sys/types.h>
+
 	/* Access modes. */
 	#define O_ACCMODE 00003 /* Mask.           */
 	#define O_RDONLY     00 /* Read only.      */
@@ -35,6 +37,7 @@
 	/* File status flags. */
 	#define O_APPEND   02000 /* Append mode.       */
 	#define O_NONBLOCK 04000 /* Non-blocking mode. */
+	#define O_DIRECT  040000 /* Bypass caches.     */
 	
 	/* File descriptor flags. */
 	#define FD_CLOEXEC 01 /* Close on exec. */
@@ -45,6 +48,21 @@
 	#define F_SETFD  2 /* Set file descriptor flags.                   */
 	#define F_GETFL  3 /* Get file status flags and file access modes. */
 	#define F_SETFL  4 /* Set file status flags.                       */
+	#define F_GETPIPE_SZ 5 /* Get pipe capacity.                       */
+	#define F_SETPIPE_SZ 6 /* Set pipe capacity.                       */
+	
+	/* Values for the *at() functions. */
+	#define AT_FDCWD            -100 /* Use the working directory. */
+	#define AT_SYMLINK_NOFOLLOW    1 /* Do not follow links.       */
+	#define AT_REMOVEDIR           2 /* Remove a directory.        */
+	
+	/* Advice for posix_fadvise(). */
+	#define POSIX_FADV_NORMAL     0 /* No special treatment.      */
+	#define POSIX_FADV_RANDOM     1 /* Random access.             */
+	#define POSIX_FADV_SEQUENTIAL 2 /* Sequential access.         */
+	#define POSIX_FADV_WILLNEED   3 /* Data will be needed soon.  */
+	#define POSIX_FADV_DONTNEED   4 /* Data will not be needed.   */
+	#define POSIX_FADV_NOREUSE    5 /* Data will be used once.    */
 
 	/*
 	 * Returns file's access mode.
@@ -56,11 +74,21 @@
 	 */
 	extern int open(const char *path, int oflag, ...);
 	
+	/*
+	 * Opens a file relative to a directory.
+	 */
+	extern int openat(int fd, const char *path, int oflag, ...);
+	
 	/*
 	 * Manipulates file descriptor.
 	 */
 	extern int fcntl(int fd, int cmd, ...);
 	
+	/*
+	 * Gives advice about the use of file data.
+	 */
+	extern int posix_fadvise(int fd, off_t off, off_t len, int advice);
+	
 	/*
 	 * Creates a file. 
 	 */
@@ -34,8 +34,17 @@
  
 	/**
 	 * @brief Log 2 of block size.
+	 * 
+	 * @details Either 10, for 1 KiB blocks, or 12, for 4 KiB blocks. It may
+	 *          be overridden at build time.
 	 */
+#ifndef BLOCK_SIZE_LOG2
 	#define BLOCK_SIZE_LOG2 10
+#endif
+
+#if (BLOCK_SIZE_LOG2 != 10) && (BLOCK_SIZE_LOG2 != 12)
+	#error "unsupported block size"
+#endif
 	
 	/**
 	 * @brief Block size (in bytes).
@@ -71,9 +80,105 @@
 		uint16_t s_imap_nblocks;     /**< Number of inode map blocks. */
 		uint16_t s_bmap_nblocks;     /**< Number of block map blocks. */
 		uint16_t s_first_data_block; /**< Unused.                     */
-		uint16_t unused1;            /**< Unused.                     */
+		uint16_t s_log_block_size;   /**< Log 2 of block size - 10.   */
 		uint32_t s_max_size;         /**< Maximum file size.          */
 		uint16_t s_magic;            /**< Magic number.               */
+		uint16_t s_journal_start;    /**< First journal block.        */
+		uint16_t s_journal_nblocks;  /**< Journal blocks, or zero.    */
+	} __attribute__((packed));
+	
+	/**
+	 * @brief Number of allocation groups.
+	 * 
+	 * @details The inode map and the zone map are each split into this many
+	 *          equal ranges, and the n-th range of inodes is paired with the
+	 *          n-th range of data zones. Groups are not recorded on disk, so
+	 *          they only steer where new inodes and zones are placed.
+	 */
+	#define NR_GROUPS 8
+
+/*============================================================================*
+ *                            Journal Information                             *
+ *============================================================================*/
+
+	/**
+	 * @name Journal Magic Numbers
+	 */
+	/**@{*/
+	#define JOURNAL_MAGIC  0x4a524e4c /**< Journal header.    */
+	#define JOURNAL_DESC   0x4a444553 /**< Descriptor block.  */
+	#define JOURNAL_COMMIT 0x4a434d54 /**< Commit block.      */
+	/**@}*/
+	
+	/**
+	 * @name Journal Size Limits (in blocks)
+	 */
+	/**@{*/
+	#define JOURNAL_SIZE_MIN   32 /**< Smallest journal. */
+	#define JOURNAL_SIZE_MAX 1024 /**< Largest journal.  */
+	/**@}*/
+	
+	/**
+	 * @brief Journal header.
+	 * 
+	 * @details The journal is an optional area of s_journal_nblocks blocks
+	 *          that starts at block s_journal_start, right before the first
+	 *          data block. Its first block holds this header, and the others
+	 *          hold a circular log of transactions. A transaction is written
+	 *          as a descriptor block, the images of the metadata blocks it
+	 *          changes, and a commit block. It never wraps around the end of
+	 *          the area: when it does not fit there, it starts over at the
+	 *          block that follows the header.
+	 * 
+	 *          Upon mount, transactions are replayed in sequence, starting
+	 *          with transaction h_seq at journal block h_start, and moving on
+	 *          to the block that follows the header when the next one is not
+	 *          found right after the previous one. Replay stops at the first
+	 *          transaction which is not found, or whose commit block does not
+	 *          match it. Nothing is replayed if h_start is zero.
+	 */
+	struct d_jheader
+	{
+		uint32_t h_magic; /**< Magic number.                          */
+		uint32_t h_seq;   /**< Sequence number of the first record.   */
+		uint16_t h_start; /**< Journal block of the first record.     */
+	} __attribute__((packed));
+	
+	/**
+	 * @brief Journal descriptor block.
+	 */
+	struct d_jdesc
+	{
+		uint32_t d_magic;    /**< Magic number.                 */
+		uint32_t d_seq;      /**< Sequence number.              */
+		uint16_t d_count;    /**< Number of logged blocks.      */
+		uint16_t d_nrevoke;  /**< Number of revoked blocks.     */
+		uint16_t d_blocks[]; /**< Logged, then revoked, blocks. */
+	} __attribute__((packed));
+	
+	/**
+	 * @brief Maximum number of blocks logged and revoked by a transaction.
+	 * 
+	 * @details A block is revoked when it is reused as file data, so that
+	 *          its images in older transactions are not replayed over the
+	 *          data.
+	 */
+	#define JOURNAL_DESC_MAX \
+		((BLOCK_SIZE - sizeof(struct d_jdesc))/sizeof(uint16_t))
+	
+	/**
+	 * @brief Journal commit block.
+	 * 
+	 * @details The checksum covers the descriptor block and the logged
+	 *          blocks, taken as little endian 32-bit words w, and computed
+	 *          as c = ((c << 1) | (c >> 31)) ^ w, starting with c = 0. This
+	 *          lets the whole transaction be written at once.
+	 */
+	struct d_jcommit
+	{
+		uint32_t c_magic; /**< Magic number.    */
+		uint32_t c_seq;   /**< Sequence number. */
+		uint32_t c_sum;   /**< Checksum.        */
 	} __attribute__((packed));
 
 /*============================================================================*
@@ -162,5 +267,41 @@
 		uint16_t d_ino;              /**< File serial number. */
 		char d_name[MINIX_NAME_MAX]; /**< Name of entry.      */
 	} __attribute__((packed));
+	
+	/**
+	 * @brief Hashed directory magic number.
+	 */
+	#define DIRHASH_MAGIC 0x4844
+	
+	/**
+	 * @brief Index of the hashed directory header.
+	 */
+	#define DIRHASH_SLOT 2
+	
+	/**
+	 * @brief Hashed directory header.
+	 * 
+	 * @details A hashed directory is laid out as a plain directory, but its
+	 *          first h_nbuckets blocks are buckets: a file goes to the first
+	 *          free entry of bucket hash(name)%h_nbuckets, or of the buckets
+	 *          that follow it when that one is full, and to the entries past
+	 *          the last bucket when all of them are full. The hash is computed
+	 *          as h = h*31 + c, in 32-bit unsigned arithmetic, over the (at
+	 *          most #MINIX_NAME_MAX) characters of the name. A free entry that
+	 *          was never used, that is, one with an empty name, ends a probe.
+	 *          The "." and ".." entries are the exception: they always sit in
+	 *          the first two entries of the first bucket.
+	 * 
+	 *          The header sits in place of the third directory entry, and
+	 *          looks like a free entry to readers that are not aware of it.
+	 *          Its magic number doubles as a non-empty name.
+	 */
+	struct d_dirhash
+	{
+		uint16_t h_ino;        /**< Always #INODE_NULL. */
+		uint16_t h_magic;      /**< Magic number.       */
+		uint16_t h_nbuckets;   /**< Number of buckets.  */
+		uint8_t h_unused[10];  /**< Unused.             */
+	} __attribute__((packed));
 
 #endif /* MINIX_H_ */
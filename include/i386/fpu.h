@@ -20,6 +20,11 @@
 
 #ifndef FPU_H_
 #define FPU_H_
+
+	/* Control register bits. */
+	#define CR0_TS     (1 << 3) /* Task switched.                  */
+	#define CR4_OSFXSR (1 << 9) /* Operating system supports FXSR. */
+
 #ifndef _ASM_FILE_
 
 	#include <nanvix/const.h>
@@ -58,7 +63,15 @@
 		uint16_t st7[FPU_REGISTER_WIDTH]; /** ST(7) register.      */
 	} __attribute__((packed));
 
+	struct process;
+	
+	/* Forward definitions. */
 	EXTERN void fpu_init(void);
+	EXTERN void fpu_dup(struct process *);
+	EXTERN void fpu_release(struct process *);
+	
+	/* Process whose state is loaded in the FPU. */
+	EXTERN struct process *fpu_owner;
 
 #endif /* _ASM_FILE_ */
 #endif /* FPU_H_ */
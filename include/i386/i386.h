@@ -40,6 +40,14 @@
 	#define DWORD_BIT  32 /* 32 bits. */
 	#define QWORD_BIT  64 /* 64 bits. */
 	
+	/* Size of a cache line. */
+	#define CACHE_LINE_SIZE 64
+	
+	/* Model specific registers for fast system calls. */
+	#define MSR_SYSENTER_CS  0x174 /* Kernel code segment. */
+	#define MSR_SYSENTER_ESP 0x175 /* Kernel stack.        */
+	#define MSR_SYSENTER_EIP 0x176 /* Kernel entry point.  */
+	
 	/* Offsets to the jmp_buf structure*/
 	#define JMP_BUF_EBX     0
 	#define JMP_BUF_ESI     4
@@ -81,6 +89,16 @@
 	 */
 	EXTERN void tlb_flush(void);
 	
+	/*
+	 * Flushes the TLB entry of the page at addr.
+	 */
+	EXTERN void tlb_flush_page(addr_t addr);
+	
+	/*
+	 * Flushes the TLB entries of size bytes starting at addr.
+	 */
+	EXTERN void tlb_flush_range(addr_t addr, unsigned size);
+	
 	/*
 	 * Flushes the IDT pointed to by idtptr.
 	 */
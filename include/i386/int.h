@@ -91,6 +91,9 @@
 	/* System call hook. */
 	EXTERN void syscall();
 	
+	/* Fast system call hook. */
+	EXTERN void sysenter();
+	
 	/* Hardware interrupt hooks. */
 	EXTERN void hwint0();
 	EXTERN void hwint1();
@@ -31,6 +31,12 @@
 	#define PGTAB_SIZE (1 << PGTAB_SHIFT) /* Page table size.           */
 	#define PTE_SIZE   4                 /* Page table entry size.     */
 	#define PDE_SIZE   4                 /* Page directory entry size. */
+	
+	/* Page size extensions (4 MB pages) enabled. */
+	#define CR4_PSE (1 << 4)
+
+	/* Largest range flushed page by page from the TLB (in pages). */
+	#define TLB_RANGE_MAX 32
 
 #ifndef _ASM_FILE_
 
@@ -45,7 +51,8 @@
 		unsigned          :  2; /* Reserved.          */
 		unsigned accessed :  1; /* Accessed?          */
 		unsigned dirty    :  1; /* Dirty?             */
-		unsigned          :  2; /* Reserved.          */
+		unsigned huge     :  1; /* 4 MB page?         */
+		unsigned          :  1; /* Reserved.          */
 		unsigned          :  3; /* Unused.            */
 		unsigned frame    : 20; /* Frame number.      */
 	};
@@ -58,10 +65,12 @@
 		unsigned present  :  1; /* Present in memory? */
 		unsigned writable :  1; /* Writable page?     */
 		unsigned user     :  1; /* User page?         */
-		unsigned          :  2; /* Reserved.          */
+		unsigned wthrough :  1; /* Write through?     */
+		unsigned nocache  :  1; /* Cache disabled?    */
 		unsigned accessed :  1; /* Accessed?          */
 		unsigned dirty    :  1; /* Dirty?             */
-		unsigned          :  2; /* Reserved.          */
+		unsigned          :  1; /* Reserved.          */
+		unsigned global   :  1; /* Global page?       */
 		unsigned cow      :  1; /* Copy on write?     */
 		unsigned zero     :  1; /* Demand zero?       */
 		unsigned fill     :  1; /* Demand fill?       */
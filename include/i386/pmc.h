@@ -0,0 +1,49 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PMC_H_
+#define PMC_H_
+
+	/* Model specific registers. */
+	#define MSR_PERFEVTSEL0 0x186 /* First event select register. */
+	#define MSR_PMC0        0x0c1 /* First performance counter.   */
+	
+	/* Event select register bits. */
+	#define PERFEVTSEL_USR (1 << 16) /* Count in user mode.   */
+	#define PERFEVTSEL_OS  (1 << 17) /* Count in kernel mode. */
+	#define PERFEVTSEL_EN  (1 << 22) /* Enable counter.       */
+
+#ifndef _ASM_FILE_
+
+	#include <nanvix/const.h>
+	#include <stdint.h>
+
+	struct process;
+	
+	/* Forward definitions. */
+	EXTERN void pmc_init(void);
+	EXTERN void pmc_switch(struct process *, struct process *);
+	EXTERN void pmc_release(struct process *);
+	EXTERN int pmc_sample(struct process *);
+	EXTERN int pmc_alloc(unsigned, unsigned);
+	EXTERN int pmc_value(int, uint64_t *);
+	EXTERN int pmc_free(int);
+
+#endif /* _ASM_FILE_ */
+#endif /* PMC_H_ */
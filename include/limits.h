@@ -56,17 +56,42 @@
 	 */
 	#define NAME_MAX 14
 	
+	/**
+	 * @brief Maximum number of bytes written atomically to a pipe.
+	 */
+	#define PIPE_BUF 512
+	
+	/**
+	 * @brief Maximum number of buffers in a readv() or writev() call.
+	 */
+	#define IOV_MAX 16
+
+	/**
+	 * @brief Maximum number of message queues that one process can have open.
+	 */
+	#define MQ_OPEN_MAX 8
+
+	/**
+	 * @brief Number of message priorities.
+	 */
+	#define MQ_PRIO_MAX 32
+
 	/* Files that one process can have open simultaneously. */
 	#define OPEN_MAX 20
 	
 	/* Length of argument to the execve(). */
-	#define ARG_MAX 2048
+	#define ARG_MAX 32768
 	
 	/**
 	 * @brief Maximum number of bytes in a pathname.
 	 */
 	#define PATH_MAX 512
 	
+	/**
+	 * @brief Maximum value for an object of type ssize_t.
+	 */
+	#define SSIZE_MAX 2147483647
+	
 	/* Maximum value for unsigned long. */
 	#define ULONG_MAX 4294967295u
 	
@@ -0,0 +1,43 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MALLOC_H_
+#define MALLOC_H_
+#ifndef _ASM_FILE_
+
+	#include <sys/types.h>
+
+	/*
+	 * Allocator statistics.
+	 */
+	struct mallinfo
+	{
+		size_t arena;    /* Bytes obtained from the kernel. */
+		size_t ordblks;  /* Number of free large blocks.    */
+		size_t smblks;   /* Number of free small objects.   */
+		size_t uordblks; /* Bytes in use.                   */
+		size_t fordblks; /* Bytes in free large blocks.     */
+		size_t fsmblks;  /* Bytes in free small objects.    */
+	};
+
+	/* Forward definitions. */
+	extern struct mallinfo mallinfo(void);
+
+#endif /* _ASM_FILE_ */
+#endif /* MALLOC_H_ */
@@ -0,0 +1,55 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MQUEUE_H_
+#define MQUEUE_H_
+
+#ifndef _ASM_FILE_
+
+	#include <sys/types.h>
+	#include <fcntl.h>
+
+	/**
+	 * @brief Message queue descriptor.
+	 */
+	typedef int mqd_t;
+
+	/**
+	 * @brief Message queue attributes.
+	 */
+	struct mq_attr
+	{
+		long mq_flags;   /**< Message queue flags.        */
+		long mq_maxmsg;  /**< Maximum number of messages. */
+		long mq_msgsize; /**< Maximum message size.       */
+		long mq_curmsgs; /**< Messages currently queued.  */
+	};
+
+	/* Forward definitions. */
+	extern mqd_t mq_open(const char *, int, ...);
+	extern int mq_close(mqd_t);
+	extern int mq_unlink(const char *);
+	extern int mq_send(mqd_t, const char *, size_t, unsigned);
+	extern ssize_t mq_receive(mqd_t, char *, size_t, unsigned *);
+	extern int mq_getattr(mqd_t, struct mq_attr *);
+	extern int mq_setattr(mqd_t, const struct mq_attr *, struct mq_attr *);
+
+#endif /* _ASM_FILE_ */
+
+#endif /* MQUEUE_H_ */
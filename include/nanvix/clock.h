@@ -21,6 +21,7 @@
 #define TIMER_H_
 
 	#include <nanvix/const.h>
+	#include <stdint.h>
 	
 	/* Clock frequency (in hertz). */
 	#define CLOCK_FREQ 100
@@ -32,6 +33,54 @@
 	 * Initializes the timer interrupt.
 	 */
 	EXTERN void clock_init(unsigned freq);
+	
+	/*
+	 * Waits for an interrupt, stopping the clock if possible.
+	 */
+	EXTERN void clock_idle(void);
+	
+	/*
+	 * Halts the processor until the next interrupt.
+	 */
+	EXTERN void clock_halt(void);
+	
+	/*
+	 * Gets the time spent halted and the time since initialization.
+	 */
+	EXTERN void clock_idlestat(uint64_t *idle, uint64_t *total);
+	
+	/*
+	 * Gets the current time (in ticks).
+	 */
+	EXTERN unsigned clock_now(void);
+	
+	/*
+	 * Gets a fine-grained time stamp.
+	 */
+	EXTERN uint64_t clock_cycles(void);
+	
+	/*
+	 * Gets a fine-grained time stamp, even before initialization.
+	 */
+	EXTERN uint64_t clock_early(void);
+	
+	/*
+	 * Gets the number of time stamp counts per clock tick.
+	 */
+	EXTERN unsigned clock_rate(void);
+	
+	/* Forward definitions. */
+	struct timepage;
+	
+	/*
+	 * Gets the time page that is shared with user space.
+	 */
+	EXTERN struct timepage *clock_timepage(void);
+	
+	/*
+	 * Runs the clock interrupt several times per tick, for profiling.
+	 */
+	EXTERN void clock_profile(unsigned rate);
 
 	/* Ticks since system initialization. */
 	EXTERN unsigned ticks;
@@ -24,6 +24,7 @@
 	#define MACHINE_NAME "valhalla" /* Machine name.*/
 	#define CPU                i386 /* Cpu model.                 */
 	#define MEMORY_SIZE   0x1000000 /* Memory size (in bytes).    */
+	#define MEMORY_MAX    0x8000000 /* Maximum memory size.       */
 	#define HDD_SIZE      0x2000000 /* Hard disk size (in bytes). */
 	#define SWP_SIZE      0x1000000 /* Swap disk size (in bytes). */
 	#define KEYBOARD_US           1 /* US International keyboard. */
@@ -32,15 +33,82 @@
 	#define MULTIUSER              0 /* Multiuser support?              */
 	#define KERNEL_VERSION     "1.2" /* Kernel version.                 */
 	#define PROC_MAX              64 /* Maximum number of process.      */
+	#define CLOCK_TICKLESS         1 /* One-shot clock when idle?       */
+	#define CLOCK_TSC              1 /* TSC-calibrated timekeeping?     */
+	#define SCHED_MLFQ             1 /* Multilevel feedback scheduler?  */
+	#define SCHED_RT_PERIOD      100 /* Real-time bandwidth period.     */
+	#define SCHED_RT_RUNTIME      95 /* Real-time ticks per period.     */
 	#define PROC_SIZE_MAX  0x4000000 /* Maximum process size.           */
-	#define RAMDISK_SIZE    0x400000 /* RAM disks size.                 */
+	#define NR_RAMDISKS            2 /* Number of RAM disks.            */
+	#define RAMDISK_SIZE    0x100000 /* RAM disks size.                 */
 	#define INITRD_SIZE      0x80000 /* Init RAM disk size.             */
-	#define NR_INODES           1024 /* Number of in-core inodes.       */
+	#define INODES_PER_MB         96 /* In-core inodes per MB of memory.*/
+	#define NR_DENTRIES          256 /* Number of cached file names.    */
 	#define NR_SUPERBLOCKS         4 /* Number of in-core super blocks. */
 	#define ROOT_DEV          0x0101 /* Root device number.             */
+	#define ROOT_MNTOPT  MS_RELATIME /* Root file system mount options. */
 	#define SWAP_DEV          0x0101 /* Swap device number.             */
-	#define NR_FILES             256 /* Number of opened files.         */
+	#define SWAP_OFF        HDD_SIZE /* Swap area offset in SWAP_DEV.   */
+	#define NR_SWAPAREAS           4 /* Number of swap areas.           */
+	#define ZSWAP_PERCENT         10 /* Compressed swap cache (% RAM).  */
+	#define FAULT_AROUND           4 /* File fault-around (pages).      */
+	#define MLOCK_MAX       0x100000 /* Locked memory per user.        */
+	#define LOADCTL                1 /* Working set load control?       */
+	#define LOADCTL_SWAPINS       64 /* Swap ins per second of overload.*/
+	#define PGMERGE                1 /* Same-page merging?              */
+	#define PGMERGE_PAGES         64 /* Pages merge-scanned per second. */
+	#define FILES_PER_MB         128 /* Opened files per MB of memory.  */
 	#define NR_REGIONS           128 /* Number of memory regions.       */
-	#define NR_BUFFERS           256 /* Number of block buffers.        */
+	#define BUFFERS_SIZE     0x40000 /* Fixed buffer area (in bytes).   */
+	#define NR_EXECS              16 /* Cached executable layouts.      */
+	#define PIPE_PAGES             1 /* Default pipe capacity (pages).  */
+	#define PIPE_PAGES_MAX        16 /* Maximum pipe capacity (pages).  */
+	#define BDFLUSH_AGE           30 /* Dirty buffer max age (seconds). */
+	#define BDFLUSH_RATIO         40 /* Dirty buffer max ratio (%).     */
+	#define JOURNAL_AGE            5 /* Journal commit interval (s).    */
+	#define BUFFERS_2Q             1 /* Scan-resistant buffer cache?    */
+	#define BCACHE                 1 /* Second-level block cache?       */
+	#define BCACHE_DEV        0x0011 /* Second-level cache RAM disk.    */
+	#define BCACHE_SIZE      0x80000 /* Second-level cache size.        */
+	#define BOOT_PREFETCH          1 /* Replay boot block trace?        */
+	#define BOOT_TRACE_SIZE      256 /* Boot trace size (blocks).       */
+	#define BOOT_TRACE_TIME       30 /* Boot trace length (seconds).    */
+	#define ATA_MERGE_MAX         16 /* Max. blocks per ATA command.    */
+	#define AHCI_MERGE_MAX         8 /* Max. blocks per AHCI command.   */
+	#define VIRTBLK_MERGE_MAX      8 /* Max. blocks per virtio command. */
+	#define KTRACE_SIZE         2048 /* Trace ring size (records).      */
+	#define KPROF_SIZE          4096 /* Profiler ring size (samples).   */
+	#define BOOTLOG_SIZE          64 /* Boot timeline size (marks).     */
+	#define FBCONSOLE              1 /* Linear frame buffer console?    */
+	#define NR_KWORKERS            2 /* Number of kernel workers.       */
+	#define KWORKER_NICE          10 /* Kernel workers nice value.      */
+	#define NET_ADDR      0x0a00020f /* Default address (10.0.2.15).    */
+	#define NET_NETMASK   0xffffff00 /* Default netmask (/24).          */
+	#define NET_GATEWAY   0x0a000202 /* Default gateway (10.0.2.2).     */
+	
+	/*
+	 * By default, swap lives right after the file system on the root
+	 * disk. To put swap on its own disk on the secondary ATA channel,
+	 * so that swap and file system I/O proceed concurrently, attach a
+	 * disk of at least SWP_SIZE bytes as secondary master (see
+	 * tools/run/bochsrc.txt.tpl) and set:
+	 * 
+	 *   #define SWAP_DEV 0x0121
+	 *   #define SWAP_OFF 0
+	 * 
+	 * Under QEMU/KVM, attach the disk as a virtio-blk device instead
+	 * (see tools/run/run.sh --virtio), so that disk I/O does not trap
+	 * on every ATA port access, and set:
+	 * 
+	 *   #define ROOT_DEV 0x0301
+	 *   #define SWAP_DEV 0x0301
+	 * 
+	 * A second virtio-blk disk for swap is 0x0311.
+	 * 
+	 * Further swap areas of up to SWP_SIZE bytes each may be added at
+	 * run time with swapon(8). The default area has priority -1, so
+	 * areas added with a non-negative priority are preferred over it,
+	 * and areas with the same priority are used in round-robin.
+	 */
 	
 #endif /* CONFIG_H_ */
@@ -22,6 +22,7 @@
 
 	#include <nanvix/const.h>
 	#include <nanvix/fs.h>
+	#include <sys/iostat.h>
 	#include <sys/types.h>
 
 	/* Device types. */
@@ -60,15 +61,34 @@
 	 *   No errors are defined.
 	 */
 	EXTERN void dev_init(void);
+	
+	/*
+	 * DESCRIPTION:
+	 *   The dev_probe() function waits for devices that are probed in the
+	 *   background since dev_init() to be set up.
+	 * 
+	 * RETURN VALUE:
+	 *   The dev_probe() has no return value.
+	 * 
+	 * ERRORS:
+	 *   No errors are defined.
+	 */
+	EXTERN void dev_probe(void);
 
 	/*========================================================================*
 	 *                             character device                           *
 	 *========================================================================*/
 	
 	/* Character device major numbers. */
-	#define NULL_MAJOR 0x0 /* Null device.       */
-	#define TTY_MAJOR  0x1 /* tty device.        */
-	#define KLOG_MAJOR 0x2 /* kernel log device. */
+	#define NULL_MAJOR    0x0 /* Null device.       */
+	#define TTY_MAJOR     0x1 /* tty device.        */
+	#define KLOG_MAJOR    0x2 /* kernel log device. */
+	#define SERIAL_MAJOR  0x3 /* serial line.       */
+	#define PTM_MAJOR     0x4 /* pty master.        */
+	#define KTRACE_MAJOR  0x5 /* kernel trace.      */
+	#define KPROF_MAJOR   0x6 /* kernel profiler.   */
+	#define NET_MAJOR     0x7 /* network interface. */
+	#define BOOTLOG_MAJOR 0x8 /* boot timeline.     */
 	
 	/* NULL device. */
 	#define NULL_DEV DEVID(NULL_MAJOR, 0, CHRDEV)
@@ -83,6 +103,7 @@
 		ssize_t (*write)(unsigned, const char *, size_t); /* Write.   */
 		int (*ioctl)(unsigned, unsigned, unsigned);       /* Control. */
 		int (*close)(dev_t);                              /* Close.   */
+		int (*poll)(unsigned);                            /* Poll.    */
 	};
 	
 
@@ -114,6 +135,11 @@
 	 */
 	EXTERN int cdev_ioctl(dev_t dev, unsigned cmd, unsigned arg);
 	
+	/*
+	 * Asserts which operations on a character device would not block.
+	 */
+	EXTERN int cdev_poll(dev_t dev);
+	
 	/*========================================================================*
 	 *                               block device                             *
 	 *========================================================================*/
@@ -121,6 +147,8 @@
 	/* Block device major numbers. */
 	#define RAMDISK_MAJOR 0x0 /* ramdisk device */
 	#define ATA_MAJOR     0x1 /* ATA device     */
+	#define AHCI_MAJOR    0x2 /* AHCI device    */
+	#define VIRTBLK_MAJOR 0x3 /* virtio disk    */
 	
 	/*
 	 * Block device.
@@ -131,6 +159,9 @@
 		ssize_t (*write)(dev_t, const char *, size_t, off_t); /* Write.       */
 		int (*readblk)(unsigned, struct buffer *);            /* Read block.  */
 		int (*writeblk)(unsigned, struct buffer *);           /* Write block. */
+		int (*stat)(unsigned, struct iostat *);               /* Statistics.  */
+		int (*flush)(unsigned);                               /* Flush cache. */
+		void *(*direct)(unsigned, block_t);                   /* Map block.   */
 	};
 	
 	/*
@@ -192,4 +223,83 @@
 	 */
 	EXTERN void bdev_readblk(struct buffer *buf);
 	
+	/*
+	 * DESCRIPTION:
+	 *   The bdev_stat() function gets I/O statistics of the block device
+	 *   identified by dev, and stores them in the buffer pointed to by buf.
+	 * 
+	 * RETURN VALUE:
+	 *   Upon successful completion, the bdev_stat() function returns 0.
+	 *   Upon failure, a negative error code is returned.
+	 * 
+	 * ERRORS:
+	 *   - EINVAL: invalid block device.
+	 *   - ENOTSUP: operation not supported.
+	 */
+	EXTERN int bdev_stat(dev_t dev, struct iostat *buf);
+	
+	/* Kinds of block device requests. */
+	#define BDEV_READ  0 /* Read.          */
+	#define BDEV_WRITE 1 /* Write.         */
+	#define BDEV_FLUSH 2 /* Write barrier. */
+	
+	/*
+	 * Block device I/O accounting. Block device drivers keep
+	 * one of these per device, and update it with interrupts
+	 * disabled.
+	 */
+	struct bdev_acct
+	{
+		struct iostat io; /* Statistics.            */
+		unsigned since;   /* Busy since (in ticks). */
+	};
+	
+	/*
+	 * Accounts a request that enters the queue of a block device.
+	 */
+	EXTERN void bdev_acct_issue(struct bdev_acct *acct);
+	
+	/*
+	 * Accounts a request of n bytes that was issued at time issued and
+	 * has just completed. The kind of request is given by op.
+	 */
+	EXTERN void bdev_acct_done(struct bdev_acct *acct, int op, size_t n,
+		unsigned issued);
+	
+	/*
+	 * Accounts a command that serves n requests and is sent to the device.
+	 */
+	EXTERN void bdev_acct_start(struct bdev_acct *acct, int n);
+	
+	/*
+	 * Accounts a command that serves n requests and is done.
+	 */
+	EXTERN void bdev_acct_end(struct bdev_acct *acct, int n);
+	
+	/*
+	 * Takes a snapshot of the I/O statistics of a block device.
+	 */
+	EXTERN void bdev_acct_stat(const struct bdev_acct *acct, struct iostat *buf);
+	
+	/*
+	 * Maps a block of a block device in place.
+	 */
+	EXTERN void *bdev_direct(dev_t dev, block_t num);
+	
+	/*
+	 * DESCRIPTION:
+	 *   The bdev_flush() function issues a write barrier to the block device
+	 *   identified by dev: it waits for all previously scheduled writes to
+	 *   complete, and then flushes the write cache of the device, so that
+	 *   data reaches the media.
+	 * 
+	 * RETURN VALUE:
+	 *   Upon successful completion, the bdev_flush() function returns 0.
+	 *   Upon failure, a negative error code is returned.
+	 * 
+	 * ERRORS:
+	 *   - EINVAL: invalid block device.
+	 */
+	EXTERN int bdev_flush(dev_t dev);
+	
 #endif /* DEV_H_ */
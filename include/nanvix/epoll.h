@@ -0,0 +1,89 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file nanvix/epoll.h
+ * 
+ * @brief Event poll instances.
+ */
+
+#ifndef NANVIX_EPOLL_H_
+#define NANVIX_EPOLL_H_
+
+#ifndef _ASM_FILE_
+
+	#include <nanvix/const.h>
+	#include <nanvix/fs.h>
+	#include <nanvix/waitq.h>
+	#include <sys/epoll.h>
+
+	/**
+	 * @name Event poll limits
+	 */
+	/**@{*/
+	#define EPOLL_MAX          16 /**< Event poll instances.     */
+	#define EPOLL_MAXEVENTS    32 /**< Events taken per wait.    */
+	#define EPOLL_HASHTAB_SIZE 32 /**< Size of watch hash table. */
+	/**@}*/
+
+	/**
+	 * @brief Watched file descriptor.
+	 */
+	struct epitem
+	{
+		struct eventpoll *ep; /**< Event poll instance.           */
+		int fd;               /**< File descriptor.               */
+		struct file *file;    /**< Underlying file.               */
+		uint32_t events;      /**< Watched events.                */
+		epoll_data_t data;    /**< User data.                     */
+		int ready;            /**< In the ready list?             */
+		struct epitem *next;  /**< Next item in the instance.     */
+		struct epitem *rnext; /**< Next item in the ready list.   */
+		struct epitem *hnext; /**< Next item in the hash table.   */
+	};
+
+	/**
+	 * @brief Event poll instance.
+	 */
+	struct eventpoll
+	{
+		int count;            /**< Reference count (0 if free). */
+		struct epitem *items; /**< Watched file descriptors.    */
+		struct epitem *rhead; /**< First ready item.            */
+		struct epitem *rtail; /**< Last ready item.             */
+		struct waitq chain;   /**< Waiting processes.           */
+	};
+
+	/* Forward definitions. */
+	EXTERN struct eventpoll *epoll_alloc(void);
+	EXTERN struct eventpoll *epoll_get(int);
+	EXTERN int epoll_id(const struct eventpoll *);
+	EXTERN void epoll_put(struct eventpoll *);
+	EXTERN struct epitem *epoll_find(struct eventpoll *, int);
+	EXTERN int epoll_insert(struct eventpoll *, int, struct file *,
+		const struct epoll_event *);
+	EXTERN void epoll_modify(struct epitem *, const struct epoll_event *);
+	EXTERN void epoll_remove(struct epitem *);
+	EXTERN int epoll_harvest(struct eventpoll *, struct epoll_event *, int);
+	EXTERN void epoll_notify(const struct inode *);
+	EXTERN void epoll_forget(const struct file *);
+
+#endif /* _ASM_FILE_ */
+
+#endif /* NANVIX_EPOLL_H_ */
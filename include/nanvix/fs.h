@@ -39,9 +39,12 @@
 	#include <nanvix/config.h>
 	#include <nanvix/const.h>
 	#include <nanvix/pm.h>
+	#include <nanvix/waitq.h>
 	#include <sys/stat.h>
 	#include <sys/types.h>
 	#include <stdint.h>
+	#include <sys/cachestat.h>
+	#include <sys/lockstat.h>
 	#include <ustat.h>
 
 /*============================================================================*
@@ -65,16 +68,32 @@
 	
 	/* Forward definitions. */
 	EXTERN void bsync(void);
+	EXTERN void bdrop(void);
 	EXTERN void blklock(buffer_t);
 	EXTERN void blkunlock(buffer_t);
 	EXTERN void brelse(buffer_t);
+	EXTERN buffer_t bget(dev_t, block_t);
+	EXTERN buffer_t bcached(dev_t, block_t);
 	EXTERN buffer_t bread(dev_t, block_t);
+	EXTERN void breada(dev_t, block_t);
+	EXTERN void bread_vec(dev_t, const block_t *, unsigned, buffer_t *);
+	EXTERN void bforget(dev_t, block_t);
 	EXTERN void bwrite(buffer_t);
+	EXTERN void bdflush(void);
+	EXTERN void bdflush_wakeup(void);
+	EXTERN void bstat(struct cachestat *);
+	EXTERN void bcache_stat(struct cachestat *);
+	EXTERN void bcache_invalidate(dev_t, block_t);
+	EXTERN void blockstat(struct lockstat *);
 	EXTERN void buffer_dirty(buffer_t, int);
+	EXTERN void buffer_valid(buffer_t, int);
+	EXTERN void buffer_once(buffer_t);
 	EXTERN void *buffer_data(const_buffer_t);
 	EXTERN dev_t buffer_dev(const_buffer_t);
 	EXTERN block_t buffer_num(const_buffer_t);
 	EXTERN int buffer_is_sync(const_buffer_t);
+	EXTERN int buffer_is_valid(const_buffer_t);
+	EXTERN int buffer_is_async(const_buffer_t);
 	
 	/**@}*/
 	
@@ -96,49 +115,98 @@
 		INODE_DIRTY  = (1 << 1), /**< Dirty?       */
 		INODE_MOUNT  = (1 << 2), /**< Mount point? */
 		INODE_VALID  = (1 << 3), /**< Valid inode? */
-		INODE_PIPE   = (1 << 4)  /**< Pipe inode?  */
+		INODE_PIPE   = (1 << 4), /**< Pipe inode?  */
+		INODE_LAYOUT = (1 << 5), /**< New layout?  */
+		INODE_TEXT   = (1 << 6), /**< Cached text? */
+		INODE_ONCE   = (1 << 7), /**< Read once?   */
+		INODE_SOCKET = (1 << 8)  /**< Socket?      */
 	};
 	 
+	/**
+	 * @brief Pipe state.
+	 * 
+	 * @details Kept apart from the inode, as only pipe inodes need it.
+	 */
+	struct pipe
+	{
+		char *pages[PIPE_PAGES_MAX]; /**< Pipe pages. */
+		off_t head;                  /**< Pipe head.  */
+		off_t tail;                  /**< Pipe tail.  */
+	};
+	
 	/**
 	 * @brief In-core inode.
+	 * 
+	 * @details Fields checked while walking the hash table come first, so
+	 *          that they share a cache line.
 	 */
 	struct inode 
 	{
-		mode_t mode;              /**< Access permissions.                   */
-		nlink_t nlinks;           /**< Number of links to the file.          */
-		uid_t uid;                /**< User id of the file's owner           */
-		gid_t gid;                /**< Group number of owner user.           */
-		off_t size;               /**< File size (in bytes).                 */
-		time_t time;              /**< Time when the file was last accessed. */
-		block_t blocks[NR_ZONES]; /**< Zone numbers.                         */
-		dev_t dev;                /**< Underlying device.                    */
-		ino_t num;                /**< Inode number.                         */
-		struct superblock *sb;    /**< Superblock.                           */
-		unsigned count;           /**< Reference count.                      */
-		enum inode_flags flags;   /**< Flags.                                */
-		char *pipe;               /**< Pipe page.                            */
-		off_t head;               /**< Pipe head.                            */
-		off_t tail;               /**< Pipe tail.                            */
-		struct inode *free_next;  /**< Next inode in the free list.          */
-		struct inode *hash_next;  /**< Next inode in the hash table.         */
-		struct inode *hash_prev;  /**< Previous inode in the hash table.     */
-		struct process *chain;    /**< Sleeping chain.                       */
+		dev_t dev;                  /**< Underlying device.                    */
+		ino_t num;                  /**< Inode number.                         */
+		struct inode *hash_next;    /**< Next inode in the hash table.         */
+		unsigned count;             /**< Reference count.                      */
+		enum inode_flags flags;     /**< Flags.                                */
+		mode_t mode;                /**< Access permissions.                   */
+		struct superblock *sb;      /**< Superblock.                           */
+		struct inode *hash_prev;    /**< Previous inode in the hash table.     */
+		struct inode *free_next;    /**< Next inode in the free list.          */
+		struct inode *free_prev;    /**< Previous inode in the free list.      */
+		nlink_t nlinks;             /**< Number of links to the file.          */
+		uid_t uid;                  /**< User id of the file's owner           */
+		gid_t gid;                  /**< Group number of owner user.           */
+		off_t size;                 /**< File size (in bytes).                 */
+		time_t time;                /**< Time when the file was last accessed. */
+		block_t blocks[NR_ZONES];   /**< Zone numbers.                         */
+		unsigned readers;           /**< Shared lock holders.                  */
+		unsigned xwaiters;          /**< Exclusive lock waiters.               */
+		struct process *holder;     /**< Exclusive lock holder.                */
+		unsigned waits;             /**< Sleeps waiting for the lock.          */
+		struct waitq chain;         /**< Sleeping chain.                       */
+		struct pipe *pipe;          /**< Pipe state, for pipe inodes.          */
+		struct socket *sock;        /**< Socket bound to it, if any.           */
+		block_t goal;               /**< Next block to allocate.               */
+		block_t pa_start;           /**< First preallocated block.             */
+		unsigned pa_count;          /**< Number of preallocated blocks.        */
+		unsigned nbuckets;          /**< Number of directory hash buckets.     */
+		unsigned dfree;             /**< First free directory entry hint.      */
+		block_t map_logic;          /**< First cached indirect entry.          */
+		block_t map_phys;           /**< Block mapped by that entry.           */
+		unsigned map_len;           /**< Length of cached contiguous run.      */
+		block_t map_dind;           /**< Cached double indirect entry.         */
+		block_t map_ind;            /**< Indirect block held by that entry.    */
+		buffer_t dirty;             /**< Dirty buffers of the file.            */
+		unsigned npages;            /**< Pages in the page cache.              */
+		unsigned ndelay;            /**< Zones reserved to delayed writes.     */
+		unsigned delay_time;        /**< When writes were first delayed.       */
 	};
 	
 	/**@}*/
 	
 	/* Forward definitions. */
 	EXTERN void inode_touch(struct inode *i);
+	EXTERN void inode_access(struct inode *i);
 	EXTERN void inode_lock(struct inode *i);
 	EXTERN void inode_unlock(struct inode *i);
+	EXTERN void inode_lock_shared(struct inode *i);
+	EXTERN void inode_unlock_shared(struct inode *i);
 	EXTERN void inode_sync(void);
+	EXTERN void inode_flush(unsigned age);
+	EXTERN void inode_drop(void);
+	EXTERN int inode_fsync(struct inode *i, int datasync);
 	EXTERN void inode_truncate(struct inode *i);
-	EXTERN struct inode *inode_alloc(struct superblock *sb);
+	EXTERN struct inode *inode_alloc(struct inode *dir, mode_t mode);
 	EXTERN struct inode *inode_get(dev_t dev, ino_t num);
 	EXTERN void inode_put(struct inode *i);
 	EXTERN struct inode *inode_dname(const char *path, const char **name);
+	EXTERN struct inode *inode_dname_at(struct inode *dir, const char *path, const char **name);
 	EXTERN struct inode *inode_name(const char *pathname);
+	EXTERN struct inode *inode_name_at(struct inode *dir, const char *pathname);
 	EXTERN struct inode *inode_pipe(void);
+	EXTERN struct inode *inode_socket(void);
+	EXTERN void inode_stat(struct cachestat *buf);
+	EXTERN void inode_lockstat(struct lockstat *buf);
+	EXTERN mode_t inode_mode(dev_t dev, ino_t num);
 
 /*============================================================================*
  *                            Super Block Library                             *
@@ -154,6 +222,14 @@
 	 */
 	typedef struct superblock * superblock_t;
 	
+	/**
+	 * @name Mount Options
+	 */
+	/**@{*/
+	#define MS_NOATIME  (1 << 0) /**< Never update access times.       */
+	#define MS_RELATIME (1 << 1) /**< Update stale access times only.  */
+	/**@}*/
+	
 	/**@}*/
 	
 	/* Forward definitions. */
@@ -162,11 +238,19 @@
 	EXTERN void superblock_unlock(superblock_t);
 	EXTERN superblock_t superblock_get(dev_t);
 	EXTERN void superblock_put(superblock_t);
-	EXTERN superblock_t superblock_read(dev_t);
+	EXTERN superblock_t superblock_read(dev_t, int);
 	EXTERN void superblock_stat(superblock_t, struct ustat *);
 	EXTERN void superblock_sync(void);
+	EXTERN void superblock_lockstat(struct lockstat *);
 	EXTERN block_t block_map(struct inode *, off_t, int);
 	EXTERN void block_free(struct superblock *, block_t, int);
+	EXTERN void block_sync(void);
+	EXTERN void block_trim(struct inode *);
+	EXTERN int block_reserve(struct inode *);
+	EXTERN void block_unreserve(struct inode *);
+	EXTERN void block_release(struct inode *);
+	EXTERN void journal_sync(unsigned);
+	EXTERN void journal_clean(void);
 	
 	
 /*============================================================================*
@@ -178,12 +262,21 @@
 	 */
 	struct file
 	{
-		int oflag;           /* Open flags.                   */
-		int count;           /* Reference count.              */
-		off_t pos;           /* Read/write cursor's position. */
-		struct inode *inode; /* Underlying inode.             */
+		int oflag;              /* Open flags.                   */
+		int count;              /* Reference count.              */
+		off_t pos;              /* Read/write cursor's position. */
+		struct inode *inode;    /* Underlying inode.             */
+		off_t ra_pos;           /* Expected next read position.  */
+		unsigned ra_size;       /* Read-ahead window (blocks).   */
+		int advice;             /* Access pattern advice.        */
+		struct file *free_next; /* Next file in the free list.   */
 	};
 	
+	/*
+	 * Number of file table entries.
+	 */
+	#define NR_FILES ((MEMORY_SIZE >> 20)*FILES_PER_MB)
+	
 	/*
 	 * File table.
 	 */
@@ -209,6 +302,21 @@
 	 */
 	EXTERN void putname(char *name);
 	
+	/*
+	 * Gets the directory that an *at() path is looked up from.
+	 */
+	EXTERN struct inode *getdirfd(int dirfd, const char *path);
+	
+	/*
+	 * Gets the absolute path name of a path.
+	 */
+	EXTERN char *abspath(const char *path);
+	
+	/*
+	 * Fixes working directory paths after a directory is renamed.
+	 */
+	EXTERN void cwd_rename(const char *from, const char *to);
+	
 	/*
 	 * Gets an empty file descriptor table entry.
 	 */
@@ -219,11 +327,41 @@
 	 */
 	EXTERN struct file *getfile(void);
 	
+	/*
+	 * Puts back an unused file table entry.
+	 */
+	EXTERN void putfile(struct file *f);
+	
+	/*
+	 * Releases a reference to an open file.
+	 */
+	EXTERN void releasefile(struct file *f);
+	
 	/*
 	 * Closes a file.
 	 */
 	EXTERN void do_close(int fd);
 	
+	/*
+	 * Reads from an open file.
+	 */
+	EXTERN ssize_t do_read(struct file *f, void *buf, size_t n);
+	
+	/*
+	 * Writes to an open file.
+	 */
+	EXTERN ssize_t do_write(struct file *f, const void *buf, size_t n);
+	
+	/*
+	 * Reads from an open file at a given offset.
+	 */
+	EXTERN ssize_t do_pread(struct file *f, void *buf, size_t n, off_t off);
+	
+	/*
+	 * Writes to an open file at a given offset.
+	 */
+	EXTERN ssize_t do_pwrite(struct file *f, const void *buf, size_t n, off_t off);
+	
 	/*
 	 * Adds an entry to a directory.
 	 */
@@ -240,25 +378,100 @@
 	 */
 	EXTERN int dir_remove(struct inode *dinode, const char *filename);
 	
+	/*
+	 * Points an entry of a directory to another inode.
+	 */
+	EXTERN int dir_set(struct inode *dinode, const char *filename, ino_t old, ino_t num);
+	
+	/*
+	 * Renames an entry of a directory in place.
+	 */
+	EXTERN int dir_rename(struct inode *dinode, const char *filename, ino_t num, const char *newname);
+	
+	/*
+	 * Reads packed entries from a directory.
+	 */
+	EXTERN ssize_t dir_getdents(struct inode *dip, void *buf, size_t n, off_t *off);
+	
 	/*
 	 * Reads from a regular file.
 	 */
-	EXTERN ssize_t file_read(struct inode *i, void *buf, size_t n, off_t off);
+	EXTERN ssize_t file_read(struct inode *i, void *buf, size_t n, off_t off, unsigned ra);
+	
+	/*
+	 * Updates the read-ahead window of a file.
+	 */
+	EXTERN unsigned file_readahead(struct file *f, size_t n);
+	
+	/*
+	 * Reads ahead blocks first to last, relative to the block at offset off.
+	 */
+	EXTERN void file_prefetch(struct inode *i, off_t off, unsigned first, unsigned last);
+	
+	/*
+	 * Fills a page of a regular file, starting at offset off.
+	 */
+	EXTERN void file_fillpg(struct inode *i, void *pg, off_t off, unsigned ra);
+	
+	/*
+	 * Sends data from a regular file to another open file.
+	 */
+	EXTERN ssize_t file_send(struct inode *i, struct file *out, size_t n, off_t off, unsigned ra);
+	
+	/*
+	 * Seeks the next data or hole in a regular file.
+	 */
+	EXTERN off_t file_seek(struct inode *i, off_t off, int hole);
 	
 	/*
 	 * Writes to a regular file.
 	 */
 	EXTERN ssize_t file_write(struct inode *i, const void *buf, size_t n, off_t off);
 	
+	/*
+	 * Reads from or writes to a regular file, bypassing caches.
+	 */
+	EXTERN ssize_t file_direct(struct inode *i, void *buf, size_t n, off_t off, int write);
+	
+	/*
+	 * Applies advice about the use of a range of a regular file.
+	 */
+	EXTERN void file_advise(struct inode *i, off_t off, off_t len, int advice);
+	
+	/*
+	 * Allocates disk blocks to the delayed writes of a regular file.
+	 */
+	EXTERN void file_flush(struct inode *i);
+	
 	/*
 	 * Reads data from a pipe.
 	 */
-	EXTERN ssize_t pipe_read(struct inode *inode, char *buf, size_t n);
+	EXTERN ssize_t pipe_read(struct inode *inode, char *buf, size_t n, int nonblock);
 	
 	/*
 	 * Writes data to a pipe.
 	 */
-	EXTERN ssize_t pipe_write(struct inode *inode, const char *buf, size_t n);
+	EXTERN ssize_t pipe_write(struct inode *inode, const char *buf, size_t n, int nonblock);
+	
+	/*
+	 * Changes the capacity of a pipe.
+	 */
+	EXTERN int pipe_resize(struct inode *inode, size_t size);
+	
+	/*
+	 * Asserts which operations on a pipe would not block.
+	 */
+	EXTERN int pipe_poll(struct inode *inode);
+	
+	/*
+	 * Asserts which operations on an open file would not block.
+	 */
+	EXTERN int do_poll(struct file *f);
+	
+	/*
+	 * Wakes up processes that poll files.
+	 */
+	EXTERN void pollwakeup(const struct inode *ip);
 	
 	/*
 	 * Root device.
@@ -50,11 +50,24 @@
 	#define INT_LVL_5 5 /**< Level 5: all hardware interrupts enabled.  */
 	/**@}*/
 	
+	/**
+	 * @name Bottom Halves
+	 */
+	/**@{*/
+	#define BH_ATA 0 /**< ATA disk driver.          */
+	#define BH_TTY 1 /**< TTY driver.               */
+	#define BH_NET 2 /**< Network stack.            */
+	#define NR_BH  3 /**< Number of bottom halves.  */
+	/**@}*/
+	
 	/**
 	 * @name Processor Control Functions
 	 */
 	/**@{*/
 	EXTERN int set_hwint(int, void (*)(void));
+	EXTERN int share_hwint(int, void (*)(void));
+	EXTERN int set_bh(unsigned, void (*)(void));
+	EXTERN void mark_bh(unsigned);
 	EXTERN void enable_interrupts(void);
 	EXTERN void disable_interrupts(void);
 	EXTERN void halt(void);
@@ -76,6 +89,10 @@
 	EXTERN void outputw(word_t, word_t);
 	EXTERN byte_t inputb(word_t);
 	EXTERN word_t inputw(word_t);
+	EXTERN void outputl(word_t, dword_t);
+	EXTERN dword_t inputl(word_t);
+	EXTERN void outputsw(word_t, const void *, size_t);
+	EXTERN void inputsw(word_t, void *, size_t);
 	/**@}*/	
 
 	/**
@@ -83,6 +100,8 @@
 	 */
 	/**@{*/
 	EXTERN void physcpy(addr_t, addr_t, size_t);
+	EXTERN void kpgcpy(void *, const void *);
+	EXTERN void kpgzero(void *);
 	/**@}*/	
 
 #endif /* _ASM_FILE_ */
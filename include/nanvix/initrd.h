@@ -0,0 +1,43 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NANVIX_INITRD_H_
+#define NANVIX_INITRD_H_
+
+	#include <stdint.h>
+	
+	/**
+	 * @brief Magic number of a compressed initial RAM disk ("NLZ4").
+	 */
+	#define INITRD_MAGIC 0x345a4c4e
+	
+	/**
+	 * @brief Compressed initial RAM disk header.
+	 * 
+	 * @details The header is followed by a single LZ4 block, which holds
+	 *          the disk image.
+	 */
+	struct initrd_header
+	{
+		uint32_t magic; /**< Magic number.                 */
+		uint32_t size;  /**< Uncompressed size (in bytes). */
+		uint32_t csize; /**< Compressed size (in bytes).   */
+	};
+
+#endif /* NANVIX_INITRD_H_ */
@@ -31,6 +31,7 @@
 
 	#include <nanvix/const.h>
 	#include <nanvix/pm.h>
+	#include <nanvix/waitq.h>
 	#include <sys/types.h>
 	#include <stdarg.h>
 	#include <stdint.h>
@@ -75,11 +76,21 @@
 	#define bitmap_clear(bitmap, pos) \
 		(((uint32_t *)(bitmap))[IDX(pos)] &= ~(0x1 << OFF(pos)))
 	
+	/**
+	 * @brief Tests a bit in a bitmap.
+	 * 
+	 * @param bitmap Bitmap where the bit should be tested.
+	 * @param pos    Position of the bit that shall be tested.
+	 */
+	#define bitmap_test(bitmap, pos) \
+		(((uint32_t *)(bitmap))[IDX(pos)] & (0x1 << OFF(pos)))
+	
 	/**
 	 * @name Bitmap Functions
 	 */
 	/**@{*/
 	EXTERN bit_t bitmap_first_free(uint32_t *, size_t);
+	EXTERN bit_t bitmap_first_free_n(uint32_t *, size_t, size_t);
 	EXTERN unsigned bitmap_nclear(uint32_t *, size_t);
 	/**@}*/
 
@@ -102,7 +113,7 @@
 		unsigned head;                      /**< First character in the buf. */
 		unsigned tail;                      /**< Next free slot in the buf.  */
 		unsigned char buffer[KBUFFER_SIZE]; /**< Ring buffer.                */
-		struct process *chain;              /**< Sleeping chain.             */
+		struct waitq chain;                 /**< Sleeping chain.             */
 	};
 	
 	/**
@@ -152,12 +163,12 @@
 	 * 
 	 * @param b Kernel buffer to be initialized.
 	 */
-	#define KBUFFER_INIT(b) \
-	{                       \
-		(b).head = 0;       \
-		(b).tail = 0;       \
-		(b).chain = NULL;   \
-	}                       \
+	#define KBUFFER_INIT(b)     \
+	{                           \
+		(b).head = 0;           \
+		(b).tail = 0;           \
+		waitq_init(&(b).chain); \
+	}                           \
 		
 	/**
 	 * @brief Takes a character out from a kernel buffer.
@@ -196,6 +207,14 @@
 	EXTERN void *kmemset(void *, int, size_t);
 	/**@}*/
 	
+	/**
+	 * @name Compression Functions
+	 */
+	/**@{*/
+	EXTERN size_t klz_compress(const void *, size_t, void *, size_t);
+	EXTERN size_t klz_decompress(const void *, size_t, void *, size_t);
+	/**@}*/
+	
 	/**
 	 * @brief Aligns a value on a boundary.
 	 * 
@@ -234,7 +253,20 @@
 	PUBLIC int itoa(char *str, unsigned num, int base);
 	EXTERN void chkout(dev_t);
 	EXTERN void kprintf(const char *, ...);
+	EXTERN void kflush(void);
 	/**@}*/
+	
+	/**
+	 * @brief Size of the buffer of deferred kernel messages (in characters).
+	 * 
+	 * @note This should be 2^x.
+	 */
+	#define KMSG_SIZE 4096
+	
+	/**
+	 * @brief Characters waiting to be written to the kernel's output device.
+	 */
+	EXTERN unsigned kmsg_pending;
 
 	/*========================================================================*
 	 *                           logging and debugging                        *
@@ -255,6 +287,16 @@
 
 	/* default log level is no log level, 
 	   useful to avoid printing log level in early boot */
+	
+	/**
+	 * @brief Log level assumed for messages that carry no log level.
+	 */
+	#define KERN_DEFAULT_LEVEL '5'
+	
+	/**
+	 * @brief Messages whose log level is above this one are dropped.
+	 */
+	EXTERN char klog_level;
 
 	/**
 	 * @brief Kernel log size (in characters).
@@ -0,0 +1,57 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file nanvix/ktrace.h
+ * 
+ * @brief Kernel tracing.
+ */
+
+#ifndef NANVIX_KTRACE_H_
+#define NANVIX_KTRACE_H_
+
+	#include <nanvix/const.h>
+	#include <sys/ktrace.h>
+	#include <stdint.h>
+
+	/**
+	 * @brief Events that are being traced.
+	 */
+	EXTERN unsigned ktrace_mask;
+	
+	/* Forward definitions. */
+	EXTERN void ktrace_emit(unsigned, uint32_t, uint32_t);
+	
+	/**
+	 * @brief Records a trace event.
+	 * 
+	 * @details Costs a single test, predicted not taken, while event @p id
+	 *          is not being traced.
+	 * 
+	 * @param id Event ID.
+	 * @param a0 First argument.
+	 * @param a1 Second argument.
+	 */
+	#define ktrace(id, a0, a1)                                 \
+	{                                                          \
+		if (__builtin_expect(ktrace_mask & (1 << (id)), 0))    \
+			ktrace_emit((id), (uint32_t)(a0), (uint32_t)(a1)); \
+	}                                                          \
+
+#endif /* NANVIX_KTRACE_H_ */
@@ -23,7 +23,9 @@
 	#include <nanvix/const.h>
 	#include <nanvix/hal.h>
 	#include <nanvix/pm.h>
+	#include <sys/cachestat.h>
 	#include <sys/types.h>
+	#include <sys/vmstat.h>
 	
 	/* Kernel stack size. */
 	#define KSTACK_SIZE 4096
@@ -33,7 +35,9 @@
 	#define BUFFERS_VIRT 0xc0008000 /* Buffers.          */
 	#define KBASE_VIRT   0xc0000000 /* Kernel base.      */
 	#define KPOOL_VIRT   0xc0400000 /* Kernel page pool. */
-	#define INITRD_VIRT  0xc0800000 /* Initial RAM disk. */
+	#define KEXT_VIRT    0xc0800000 /* Pool extension.   */
+	#define INITRD_VIRT  0xc0c00000 /* Initial RAM disk. */
+	#define IOMEM_VIRT   0xc1000000 /* Memory-mapped IO. */
 	
 	/* Physical memory layout. */
 	#define KBASE_PHYS   0x00000000 /* Kernel base.      */
@@ -42,8 +46,9 @@
 	#define UBASE_PHYS   0x00800000 /* User base.        */
 	
 	/* User memory layout. */
-	#define USTACK_ADDR 0xc0000000 /* User stack. */
-	#define UHEAP_ADDR  0xa0000000 /* User heap.  */
+	#define USTACK_ADDR 0xc0000000 /* User stack.         */
+	#define UMMAP_ADDR  0xa4000000 /* User file mappings. */
+	#define UHEAP_ADDR  0xa0000000 /* User heap.          */
 
 	/* Kernel memory size: 4 MB. */
 	#define KMEM_SIZE 0x00400000
@@ -51,22 +56,93 @@
 	/* Kernel page pool size: 4 MB. */
 	#define KPOOL_SIZE 0x00400000
 	
-	/* User memory size. */
-	#define UMEM_SIZE (MEMORY_SIZE - KMEM_SIZE - KPOOL_SIZE)
+	/*
+	 * Kernel page pool extension size: 4 MB. The
+	 * extension maps the lowest user frames, which
+	 * are borrowed when the kernel page pool is full.
+	 */
+	#define KEXT_SIZE 0x00400000
+	
+	/* Memory-mapped IO window size: 4 MB. */
+	#define IOMEM_SIZE 0x00400000
+	
+	/* Maximum user memory size. */
+	#define UMEM_MAX (MEMORY_MAX - KMEM_SIZE - KPOOL_SIZE)
 
 #ifndef _ASM_FILE_
 	
+	/**
+	 * @brief Object cache.
+	 * 
+	 * @details Serves objects of a single type from slabs of kernel pages.
+	 *          Objects are built by the constructor once, when their slab is
+	 *          created, and shall be released in their constructed state.
+	 */
+	struct kcache
+	{
+		const char *name;     /**< Cache name.                 */
+		size_t size;          /**< Object size.                */
+		void (*ctor)(void *); /**< Object constructor.         */
+		unsigned offset;      /**< Offset of objects in slabs. */
+		unsigned nper;        /**< Objects per slab.           */
+		unsigned nslabs;      /**< Slabs in the cache.         */
+		unsigned nobjs;       /**< Objects in use.             */
+		struct kslab *slabs;  /**< Slabs with free objects.    */
+	};
+	
+	/**
+	 * @brief Initializes an object cache.
+	 * 
+	 * @param name Cache name.
+	 * @param size Object size.
+	 * @param ctor Object constructor (may be NULL).
+	 */
+	#define KCACHE(name, size, ctor) \
+		{ (name), (size), (ctor), 0, 0, 0, 0, NULL }
+	
 	/* Forward definitions. */
 	EXTERN int chkmem(const void *, size_t, mode_t);
 	EXTERN int fubyte(const void *);
 	EXTERN int fudword(const void *);
 	EXTERN int crtpgdir(struct process *);
+	EXTERN int sharepgdir(struct process *);
+	EXTERN int sharedpgdir(struct process *);
 	EXTERN int pfault(addr_t);
-	EXTERN int vfault(addr_t);
+	EXTERN int faultupg(addr_t, int);
+	EXTERN int writableupg(addr_t);
+	EXTERN int vfault(addr_t, int);
 	EXTERN void dstrypgdir(struct process *);
 	EXTERN void putkpg(void *);
 	EXTERN void mm_init(void);
+	EXTERN const char *mboot_cmdline(void);
 	EXTERN void *getkpg(int);
+	EXTERN void *mapiomem(addr_t, size_t);
+	EXTERN void *mapiomem_wc(addr_t, size_t);
+	EXTERN addr_t pinupg(addr_t, int);
+	EXTERN void unpinupg(addr_t);
+	EXTERN addr_t getupg(addr_t, int);
+	EXTERN void putupg(addr_t);
+	EXTERN int swap_add(dev_t, size_t, int);
+	EXTERN void pgstat(struct cachestat *);
+	EXTERN void pgvmstat(struct vmstat *);
+	EXTERN void *pcache_get(struct inode *, unsigned, unsigned);
+	EXTERN void pcache_put(void *);
+	EXTERN void pcache_write(struct inode *, off_t, const void *, size_t);
+	EXTERN int pcache_delay(struct inode *, off_t, const void *, size_t);
+	EXTERN void *pcache_undelay(struct inode *, unsigned, unsigned *);
+	EXTERN void pcache_purge(struct inode *);
+	EXTERN void pcache_forget(struct inode *, unsigned, unsigned);
+	EXTERN void pcache_drop(void);
+	EXTERN void pcache_stat(struct cachestat *);
+	EXTERN unsigned pgrss(struct process *);
+	EXTERN void pgrss_peak(struct process *);
+	EXTERN void *kcache_alloc(struct kcache *);
+	EXTERN void kcache_free(void *);
+	EXTERN void *kmalloc(size_t);
+	EXTERN void kfree(void *);
+	
+	/* Memory size (in bytes). */
+	EXTERN size_t mem_size;
 
 #endif /* _ASM_FILE_ */
 	
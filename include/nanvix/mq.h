@@ -0,0 +1,103 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file nanvix/mq.h
+ * 
+ * @brief Message queues.
+ */
+
+#ifndef NANVIX_MQ_H_
+#define NANVIX_MQ_H_
+
+#ifndef _ASM_FILE_
+
+	#include <nanvix/const.h>
+	#include <nanvix/hal.h>
+	#include <nanvix/pm.h>
+	#include <nanvix/waitq.h>
+	#include <sys/types.h>
+
+	/**
+	 * @name Message queue limits
+	 */
+	/**@{*/
+	#define MQ_MAX         16                         /**< Message queues.     */
+	#define MQ_NAME_MAX    NAME_MAX                   /**< Queue name length.  */
+	#define MQ_MAXMSG      32                         /**< Messages in queue.  */
+	#define MQ_MSGSIZE_MAX (16*PAGE_SIZE)             /**< Message size.       */
+	#define MQ_PAGES_MAX   (MQ_MSGSIZE_MAX/PAGE_SIZE) /**< Pages in a message. */
+	/**@}*/
+
+	/**
+	 * @name Default message queue attributes
+	 */
+	/**@{*/
+	#define MQ_DEF_MAXMSG  8    /**< Messages in a queue. */
+	#define MQ_DEF_MSGSIZE 1024 /**< Message size.        */
+	/**@}*/
+
+	/**
+	 * @brief Message.
+	 * 
+	 * @details The contents of a message are kept one page at a time. Whole
+	 *          pages of page aligned messages are lent by the sender, copy on
+	 *          write, and are handed over to the receiver without copying
+	 *          them. Other pages are copied to kernel memory.
+	 */
+	struct message
+	{
+		unsigned prio;                  /**< Priority.               */
+		size_t size;                    /**< Size (in bytes).        */
+		struct pte pages[MQ_PAGES_MAX]; /**< Lent pages.             */
+		void *data[MQ_PAGES_MAX];       /**< Copied pages (or NULL). */
+		struct message *next;           /**< Next message in queue.  */
+	};
+
+	/**
+	 * @brief Message queue.
+	 */
+	struct mqueue
+	{
+		int count;                  /**< Reference count (0 if free). */
+		int unlinked;               /**< Has the name been removed?   */
+		char name[MQ_NAME_MAX + 1]; /**< Name.                        */
+		long maxmsg;                /**< Maximum number of messages.  */
+		long msgsize;               /**< Maximum message size.        */
+		long curmsgs;               /**< Messages currently queued.   */
+		struct message *head;       /**< Queued messages.             */
+		struct waitq rchain;        /**< Processes waiting to read.   */
+		struct waitq wchain;        /**< Processes waiting to write.  */
+	};
+
+	/* Forward definitions. */
+	EXTERN struct mqueue *mq_lookup(const char *);
+	EXTERN struct mqueue *mq_alloc(const char *, long, long);
+	EXTERN void mq_put(struct mqueue *);
+	EXTERN void mq_remove(struct mqueue *);
+	EXTERN void do_mq_close(int);
+	EXTERN struct message *mq_msgin(const char *, size_t, unsigned);
+	EXTERN int mq_msgout(struct message *, char *);
+	EXTERN void mq_msgfree(struct message *);
+	EXTERN void mq_enqueue(struct mqueue *, struct message *);
+	EXTERN struct message *mq_dequeue(struct mqueue *);
+
+#endif /* _ASM_FILE_ */
+
+#endif /* NANVIX_MQ_H_ */
@@ -0,0 +1,313 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file nanvix/net.h
+ * 
+ * @brief Internet protocols.
+ */
+
+#ifndef NANVIX_NET_H_
+#define NANVIX_NET_H_
+
+#ifndef _ASM_FILE_
+
+	#include <nanvix/const.h>
+	#include <nanvix/fs.h>
+	#include <nanvix/socket.h>
+	#include <nanvix/waitq.h>
+	#include <netinet/in.h>
+	#include <sys/netif.h>
+	#include <sys/socket.h>
+	#include <sys/types.h>
+	#include <sys/uio.h>
+	#include <stdint.h>
+
+	/**
+	 * @name Network stack limits
+	 */
+	/**@{*/
+	#define NET_PACKETS   128  /**< Packets in the pool.                */
+	#define NET_BUDGET    16   /**< Frames taken from a device at once. */
+	#define NET_TICK      10   /**< Protocol timer period (in ticks).   */
+	#define ARP_ENTRIES   16   /**< Entries in the ARP table.           */
+	#define UDP_PCBS      16   /**< UDP sockets.                        */
+	#define UDP_QUEUE_MAX 16   /**< Datagrams queued at a UDP socket.   */
+	#define TCP_PCBS      16   /**< TCP connections.                    */
+	#define TCP_MSS       1460 /**< Largest segment sent or taken.      */
+	#define TCP_RCVBUF    8192 /**< Receive window.                     */
+	#define TCP_RCVQ      8    /**< Segments queued for reading.        */
+	#define TCP_SNDQ      8    /**< Segments queued for sending.        */
+	/**@}*/
+
+	/**
+	 * @name Protocol headers
+	 */
+	/**@{*/
+	#define ETH_P_IP  0x0800 /**< IPv4 frame.         */
+	#define ETH_P_ARP 0x0806 /**< ARP frame.          */
+	#define IP_HLEN   20     /**< IPv4 header length. */
+	#define UDP_HLEN  8      /**< UDP header length.  */
+	#define TCP_HLEN  20     /**< TCP header length.  */
+	/**@}*/
+	
+	/**
+	 * @name Packet layout
+	 */
+	/**@{*/
+	#define NET_L3OFF ETH_HLEN             /**< Network header offset.   */
+	#define NET_L4OFF (ETH_HLEN + IP_HLEN) /**< Transport header offset. */
+	/**@}*/
+	
+	/**
+	 * @brief Largest UDP payload. Datagrams are never fragmented.
+	 */
+	#define UDP_DATA_MAX (ETH_FRAME_MAX - NET_L4OFF - UDP_HLEN)
+
+	/**
+	 * @brief Ethernet header.
+	 */
+	struct eth_hdr
+	{
+		uint8_t dst[ETH_ALEN]; /**< Destination address. */
+		uint8_t src[ETH_ALEN]; /**< Source address.      */
+		uint16_t type;         /**< Protocol.            */
+	} __attribute__((packed));
+
+	/**
+	 * @brief ARP packet for IPv4 over Ethernet.
+	 */
+	struct arp_hdr
+	{
+		uint16_t htype;        /**< Hardware type.           */
+		uint16_t ptype;        /**< Protocol type.           */
+		uint8_t hlen;          /**< Hardware address length. */
+		uint8_t plen;          /**< Protocol address length. */
+		uint16_t op;           /**< Operation.               */
+		uint8_t sha[ETH_ALEN]; /**< Sender hardware address. */
+		uint32_t spa;          /**< Sender address.          */
+		uint8_t tha[ETH_ALEN]; /**< Target hardware address. */
+		uint32_t tpa;          /**< Target address.          */
+	} __attribute__((packed));
+
+	/**
+	 * @brief IPv4 header.
+	 */
+	struct ip_hdr
+	{
+		uint8_t vhl;   /**< Version and header length. */
+		uint8_t tos;   /**< Type of service.           */
+		uint16_t len;  /**< Total length.              */
+		uint16_t id;   /**< Identification.            */
+		uint16_t off;  /**< Flags and fragment offset. */
+		uint8_t ttl;   /**< Time to live.              */
+		uint8_t proto; /**< Protocol.                  */
+		uint16_t sum;  /**< Header checksum.           */
+		uint32_t src;  /**< Source address.            */
+		uint32_t dst;  /**< Destination address.       */
+	} __attribute__((packed));
+
+	/**
+	 * @brief ICMP echo header.
+	 */
+	struct icmp_hdr
+	{
+		uint8_t type;  /**< Message type.    */
+		uint8_t code;  /**< Message code.    */
+		uint16_t sum;  /**< Checksum.        */
+		uint16_t id;   /**< Identifier.      */
+		uint16_t seq;  /**< Sequence number. */
+	} __attribute__((packed));
+
+	/**
+	 * @brief UDP header.
+	 */
+	struct udp_hdr
+	{
+		uint16_t sport; /**< Source port.      */
+		uint16_t dport; /**< Destination port. */
+		uint16_t len;   /**< Length.           */
+		uint16_t sum;   /**< Checksum.         */
+	} __attribute__((packed));
+
+	/**
+	 * @brief TCP header.
+	 */
+	struct tcp_hdr
+	{
+		uint16_t sport; /**< Source port.       */
+		uint16_t dport; /**< Destination port.  */
+		uint32_t seq;   /**< Sequence number.   */
+		uint32_t ack;   /**< Acknowledgment.    */
+		uint8_t off;    /**< Header length.     */
+		uint8_t flags;  /**< Flags.             */
+		uint16_t win;   /**< Window.            */
+		uint16_t sum;   /**< Checksum.          */
+		uint16_t urp;   /**< Urgent pointer.    */
+	} __attribute__((packed));
+
+	/**
+	 * @brief Packet.
+	 * 
+	 * @details Packets come from a pool of their own, that is filled once
+	 *          at boot, so that frames may be taken from interrupt context.
+	 *          A packet holds a whole frame, built forward from the Ethernet
+	 *          header. A queued TCP segment may also refer to data that is
+	 *          sent in place, straight out of a block buffer.
+	 */
+	struct packet
+	{
+		struct packet *next;     /**< Next packet in queue.       */
+		unsigned len;            /**< Frame length in the buffer. */
+		unsigned off;            /**< Payload offset.             */
+		unsigned dlen;           /**< Payload length.             */
+		uint32_t seq;            /**< Sequence number (TCP).      */
+		unsigned tflags;         /**< Segment flags (TCP).        */
+		const char *zdata;       /**< Data sent in place.         */
+		unsigned zlen;           /**< Length of that data.        */
+		buffer_t zbuf;           /**< Block buffer to release.    */
+		in_addr_t saddr;         /**< Source address.             */
+		in_port_t sport;         /**< Source port.                */
+		char buf[ETH_FRAME_MAX]; /**< Frame.                      */
+	};
+
+	/**
+	 * @name Network interface flags
+	 */
+	/**@{*/
+	#define NETIF_UP  (1 << 0) /**< Run by the network stack? */
+	#define NETIF_RAW (1 << 1) /**< Frames go to raw readers? */
+	/**@}*/
+
+	/**
+	 * @brief Network interface.
+	 * 
+	 * @details Interfaces that are run by the network stack hand received
+	 *          frames to it in a bottom half. The operations below are called
+	 *          with interrupts disabled, except for up(), which may sleep.
+	 */
+	struct netif
+	{
+		const char *name;      /**< Interface name.      */
+		unsigned minor;        /**< Minor device number. */
+		unsigned flags;        /**< Flags (see above).   */
+		uint8_t mac[ETH_ALEN]; /**< Hardware address.    */
+		in_addr_t addr;        /**< Address.             */
+		in_addr_t netmask;     /**< Network mask.        */
+		in_addr_t gateway;     /**< Default gateway.     */
+		struct netif *next;    /**< Next interface.      */
+		
+		/**
+		 * @brief Gets the device ready for the network stack.
+		 */
+		int (*up)(struct netif *);
+		
+		/**
+		 * @brief Takes a received frame, or turns interrupts back on and
+		 *        returns NULL if there is none.
+		 */
+		struct packet *(*recv)(struct netif *);
+		
+		/**
+		 * @brief Sends a frame, followed by data that is sent in place.
+		 */
+		int (*xmit)(struct netif *, const char *, size_t, const char *, size_t);
+	};
+
+	/**
+	 * @brief Asserts if an interface is run by the network stack.
+	 */
+	#define netif_running(nif) \
+		(((nif) != NULL) &&    \
+		(((nif)->flags & (NETIF_UP | NETIF_RAW)) == NETIF_UP))
+
+	/**
+	 * @brief Asserts if a sequence number comes before another one.
+	 */
+	#define seq_lt(a, b) ((int32_t)((a) - (b)) < 0)
+
+	/**
+	 * @brief Asserts if a sequence number does not come after another one.
+	 */
+	#define seq_leq(a, b) ((int32_t)((a) - (b)) <= 0)
+
+	/* Forward definitions. */
+	EXTERN struct netif *net_if;
+	EXTERN struct waitq net_chain;
+	EXTERN void netif_register(struct netif *);
+	EXTERN void net_init(void);
+	EXTERN void net_rx(void);
+	EXTERN void net_tx(void);
+	EXTERN void net_arm(void);
+	EXTERN struct packet *net_alloc(void);
+	EXTERN void net_free(struct packet *);
+	EXTERN void net_dead(struct packet *);
+	EXTERN uint32_t net_cksum(uint32_t, const void *, size_t);
+	EXTERN uint16_t net_fold(uint32_t);
+	EXTERN uint32_t net_pseudo(in_addr_t, in_addr_t, unsigned, size_t);
+	EXTERN size_t net_gather(char *, const struct iovec *, int, size_t, size_t);
+	EXTERN size_t net_scatter(const struct iovec *, int, size_t, const char *,
+		size_t);
+	EXTERN int ip_output(struct packet *, in_addr_t, in_addr_t, unsigned);
+	EXTERN void udp_input(struct packet *, in_addr_t);
+	EXTERN int udp_attach(struct socket *);
+	EXTERN void udp_detach(struct socket *);
+	EXTERN int udp_bind(struct socket *, in_addr_t, in_port_t);
+	EXTERN int udp_connect(struct socket *, in_addr_t, in_port_t);
+	EXTERN ssize_t udp_send(struct socket *, const struct iovec *, int, size_t,
+		const struct sockaddr_in *, int);
+	EXTERN ssize_t udp_recv(struct socket *, const struct iovec *, int, size_t,
+		struct sockaddr_in *, int *);
+	EXTERN int udp_poll(struct socket *);
+	EXTERN void udp_name(struct socket *, int, struct sockaddr_in *);
+	EXTERN void tcp_input(struct packet *, in_addr_t);
+	EXTERN int tcp_timer(void);
+	EXTERN void tcp_kick(void);
+	EXTERN int tcp_attach(struct socket *);
+	EXTERN void tcp_detach(struct socket *);
+	EXTERN int tcp_bind(struct socket *, in_addr_t, in_port_t);
+	EXTERN int tcp_listen(struct socket *, unsigned);
+	EXTERN struct socket *tcp_accept(struct socket *, int);
+	EXTERN int tcp_connect(struct socket *, in_addr_t, in_port_t, int);
+	EXTERN ssize_t tcp_send(struct socket *, const struct iovec *, int, size_t,
+		int);
+	EXTERN ssize_t tcp_sendbuf(struct socket *, buffer_t, size_t, size_t, int);
+	EXTERN ssize_t tcp_recv(struct socket *, const struct iovec *, int, size_t,
+		int *);
+	EXTERN int tcp_poll(struct socket *);
+	EXTERN void tcp_name(struct socket *, int, struct sockaddr_in *);
+	EXTERN int inet_attach(struct socket *, int);
+	EXTERN void inet_release(struct socket *);
+	EXTERN int inet_bind(struct socket *, const struct sockaddr *, socklen_t);
+	EXTERN int inet_listen(struct socket *, int);
+	EXTERN struct socket *inet_accept(struct socket *, int);
+	EXTERN int inet_connect(struct socket *, const struct sockaddr *, socklen_t,
+		int);
+	EXTERN ssize_t inet_send(struct socket *, const struct iovec *, int,
+		const struct sockaddr *, socklen_t, int);
+	EXTERN ssize_t inet_recv(struct socket *, const struct iovec *, int,
+		struct sockaddr *, socklen_t *, int *);
+	EXTERN int inet_poll(struct socket *);
+	EXTERN void inet_name(struct socket *, int, struct sockaddr *, socklen_t *);
+	EXTERN int inet_zerocopy(const struct file *, const void *);
+	EXTERN ssize_t inet_sendbuf(struct file *, buffer_t, size_t, size_t);
+
+#endif /* _ASM_FILE_ */
+
+#endif /* NANVIX_NET_H_ */
@@ -32,9 +32,13 @@
 	#include <nanvix/fs.h>
 	#include <nanvix/hal.h>
 	#include <nanvix/region.h>
+	#include <nanvix/timer.h>
+	#include <nanvix/waitq.h>
  	#include <i386/fpu.h>
+	#include <sys/ioprio.h>
 	#include <sys/types.h>
 	#include <limits.h>
+	#include <sched.h>
 	#include <signal.h>
 	
 	/**
@@ -65,16 +69,29 @@
 	 * @name Process flags
 	 */
 	/**@{*/
-	#define PROC_NEW 0 /**< Is the process new?     */
-	#define PROC_SYS 1 /**< Handling a system call? */
+	#define PROC_NEW     0 /**< Is the process new?         */
+	#define PROC_SYS     1 /**< Handling a system call?     */
+	#define PROC_VFORK   2 /**< Father waiting on vfork?    */
+	#define PROC_FAST    3 /**< Entered through sysenter?   */
+	#define PROC_SIGSUSP 4 /**< Mask saved by sigsuspend()? */
+	#define PROC_SWAPIN  5 /**< Swapping pages in?          */
+	#define PROC_SUSPEND 6 /**< Suspended by load control?  */
+	#define PROC_MLOCK   7 /**< Lock new mappings?          */
+	#define PROC_REAP    8 /**< Teardown pending?           */
 	/**@}*/
 	
+	/**
+	 * @brief Signals that cannot be blocked.
+	 */
+	#define SIG_UNBLOCKABLE ((1 << SIGKILL) | (1 << SIGSTOP))
+	
 	/**
 	 * @name Process parameters
 	 */
 	/**@{*/
-	#define PROC_QUANTUM 50 /**< Quantum.                  */
-	#define NR_PREGIONS   4 /**< Number of memory regions. */
+	#define PROC_QUANTUM 50             /**< Quantum.                  */
+	#define NR_MMAPS     8              /**< Number of file mappings.  */
+	#define NR_PREGIONS  (6 + NR_MMAPS) /**< Number of memory regions. */
 	/**@}*/
 	
 	/**
@@ -90,6 +107,34 @@
 	#define PRIO_SIG          20 /**< Waiting for signal.          */
 	#define PRIO_USER         40 /**< User priority.               */
 	/**@}*/
+	
+	/**
+	 * @name Multilevel feedback queues
+	 */
+	/**@{*/
+	#define MLFQ_LEVELS 4    /**< Number of user feedback levels. */
+	#define MLFQ_BOOST  1000 /**< Priority boost period (ticks).  */
+	/**@}*/
+	
+	/**
+	 * @brief Number of real-time ready queues.
+	 */
+	#define NR_RTQUEUES (SCHED_RTPRIO_MAX - SCHED_RTPRIO_MIN + 1)
+	
+	/**
+	 * @brief Number of ready queues.
+	 * 
+	 * @details There is one ready queue for each process
+	 *          priority, from #PRIO_IO up to #PRIO_USER, and
+	 *          one for each real-time priority, right before
+	 *          #PRIO_USER. With #SCHED_MLFQ, #PRIO_USER is
+	 *          further split into #MLFQ_LEVELS feedback levels.
+	 */
+#if (SCHED_MLFQ)
+	#define NR_READYQ (7 + NR_RTQUEUES + MLFQ_LEVELS)
+#else
+	#define NR_READYQ (8 + NR_RTQUEUES)
+#endif
 
 	/**
 	 * @name Process states
@@ -113,11 +158,13 @@
 	#define PROC_INTLVL    8 /**< Interrupt level offset.        */
 	#define PROC_FLAGS    12 /**< Process flags.                 */
 	#define PROC_RECEIVED 16 /**< Received signals offset.       */
-	#define PROC_KSTACK   20 /**< Kernel stack pointer offset.   */
-	#define PROC_RESTORER 24 /**< Signal restorer.               */
-	#define PROC_HANDLERS 28 /**< Signal handlers offset.        */
-	#define PROC_IRQLVL 120  /**< IRQ Level offset.              */
-	#define PROC_FSS    124  /**< FPU Saved Status offset.       */
+	#define PROC_BLOCKED  20 /**< Blocked signals offset.        */
+	#define PROC_KSTACK   24 /**< Kernel stack pointer offset.   */
+	#define PROC_RESTORER 28 /**< Signal restorer.               */
+	#define PROC_HANDLERS 32 /**< Signal handlers offset.        */
+	#define PROC_IRQLVL   132 /**< IRQ Level offset.              */
+	#define PROC_NSYSCALL 136 /**< System calls made offset.     */
+	#define PROC_FSS      140 /**< FPU Saved Status offset.       */
 	/**@}*/
 
 #ifndef _ASM_FILE_
@@ -136,20 +183,56 @@
 		dword_t intlvl;                    /**< Interrupt level.        */
 		unsigned flags;                    /**< Process flags.          */
     	unsigned received;                 /**< Received signals.       */
+		unsigned blocked;                  /**< Blocked signals.        */
     	void *kstack;                      /**< Kernel stack pointer.   */
     	void (*restorer)(void);            /**< Signal restorer.        */
 		sighandler_t handlers[NR_SIGNALS]; /**< Signal handlers.        */
 		unsigned irqlvl;                   /**< Current IRQ level.      */
+		unsigned nsyscall;                 /**< System calls made.      */
     	struct fpu fss;                    /**< FPU Saved Status.       */
 		/**@}*/
 
+		/**
+		 * @name Scheduling information
+		 * 
+		 * @details Fields read on every scheduling decision and process
+		 *          table scan start a cache line of their own.
+		 */
+		/**@{*/
+		unsigned state
+			__attribute__((aligned(CACHE_LINE_SIZE))); /**< Current state. */
+		int counter;           /**< Remaining quantum.             */
+		int priority;          /**< Process priorities.            */
+		unsigned alarm;        /**< Alarm.                         */
+		int level;             /**< Feedback queue level.          */
+		int nice;              /**< Nice for scheduling.           */
+		int lent;              /**< Lent priority.                 */
+		int policy;            /**< Scheduling policy.             */
+		int rtprio;            /**< Real-time priority.            */
+		int ioprio;            /**< I/O scheduling class.          */
+		struct process *next;  /**< Next process in a list.        */
+		struct process *rnext; /**< Next process in a ready queue. */
+		struct waitq *waitq;   /**< Wait queue.                    */
+		int wexcl;             /**< Exclusive waiter?              */
+		int wreason;           /**< Wakeup reason.                 */
+		addr_t futex;          /**< Futex being waited on.         */
+		struct timer alarmtm;  /**< Alarm timer.                   */
+		/**@}*/
+
     	/**
     	 * @name Memory information
     	 */
 		/**@{*/
 		struct pde *pgdir;                 /**< Page directory.         */
 		struct pregion pregs[NR_PREGIONS]; /**< Process memory regions. */
+		struct pregion *pmap[NR_PREGIONS]; /**< Sorted by address.      */
+		unsigned npregs;                   /**< Attached regions.       */
 		size_t size;                       /**< Process size.           */
+		unsigned minflt;                   /**< Minor page faults.      */
+		unsigned majflt;                   /**< Major page faults.      */
+		unsigned wss;                      /**< Working set (in pages). */
+		unsigned wsflt;                    /**< Faults at last sample.  */
+		unsigned wsusp;                    /**< Suspension time.        */
 		/**@}*/
 
 		/**
@@ -158,11 +241,44 @@
 		/**@{*/
 		struct inode *pwd;             /**< Working directory.         */
 		struct inode *root;            /**< Root directory.            */
+		char cwd[PATH_MAX];            /**< Working directory path.    */
 		struct file *ofiles[OPEN_MAX]; /**< Opened files.              */
 		int close;                     /**< Close on exec()?           */
+		uint32_t ofmap;                /**< Used file descriptors.     */
 		mode_t umask;                  /**< User file's creation mask. */
 		dev_t tty;                     /**< Associated tty device.     */
 		/**@}*/
+
+		/**
+		 * @name Signal information
+		 */
+		/**@{*/
+		sigset_t sigmasks[NR_SIGNALS]; /**< Blocked while handling.  */
+		int sigflags[NR_SIGNALS];      /**< Signal action flags.     */
+		sigset_t sigsaved;             /**< Saved by sigsuspend().   */
+		/**@}*/
+
+		/**
+		 * @name Message queue information
+		 */
+		/**@{*/
+		struct mqueue *mqdes[MQ_OPEN_MAX]; /**< Opened message queues. */
+		uint32_t mqnonblock;               /**< Non-blocking queues.   */
+		/**@}*/
+
+		/**
+		 * @name Event poll information
+		 */
+		/**@{*/
+		uint32_t epmap; /**< Event poll instances. */
+		/**@}*/
+
+		/**
+		 * @name Asynchronous I/O information
+		 */
+		/**@{*/
+		uint32_t urmap; /**< I/O rings. */
+		/**@}*/
 		
 		/**
 		 * @name General information
@@ -180,6 +296,11 @@
     	pid_t pid;              /**< Process ID.              */
     	struct process *pgrp;   /**< Process group ID.        */
     	struct process *father; /**< Father process.          */
+    	struct process *children; /**< First child process.   */
+    	struct process *sibling;  /**< Next sibling process.  */
+    	struct process *members;  /**< Group members (leader). */
+    	struct process *gnext;    /**< Next group member.     */
+    	struct process *hnext;    /**< Next process in PID hash. */
 		char name[NAME_MAX];    /**< Process name.            */
 		/**@}*/
 
@@ -187,51 +308,102 @@
     	 * @name Timing information
     	 */
 		/**@{*/
-    	unsigned utime;  /**< User CPU time.                          */
-    	unsigned ktime;  /**< Kernel CPU time.                        */
-		unsigned cutime; /**< User CPU time of terminated children.   */
-		unsigned cktime; /**< Kernel CPU time of terminated children. */
+    	unsigned utime;          /**< User CPU time.                          */
+    	unsigned ktime;          /**< Kernel CPU time.                        */
+		unsigned cutime;         /**< User CPU time of terminated children.   */
+		unsigned cktime;         /**< Kernel CPU time of terminated children. */
+		unsigned itreal;         /**< Real timer interval (in ticks).         */
+		unsigned itvirt;         /**< Virtual timer value (in ticks).         */
+		unsigned itvirtint;      /**< Virtual timer interval (in ticks).      */
+		unsigned itprof;         /**< Profiling timer value (in ticks).       */
+		unsigned itprofint;      /**< Profiling timer interval (in ticks).    */
+		unsigned short *profbuf; /**< Profiling histogram.                    */
+		size_t profsize;         /**< Histogram size (in bytes).              */
+		addr_t profoff;          /**< Lowest profiled address.                */
+		unsigned profscale;      /**< Profiling scale, or zero.               */
 		/**@}*/
 
-    	/**
-    	 * @name Scheduling information
-    	 */
+		/**
+		 * @name Resource usage
+		 */
 		/**@{*/
-    	unsigned state;          /**< Current state.          */
-    	int counter;             /**< Remaining quantum.      */
-    	int priority;            /**< Process priorities.     */
-    	int nice;                /**< Nice for scheduling.    */
-    	unsigned alarm;          /**< Alarm.                  */
-		struct process *next;    /**< Next process in a list. */
-		struct process **chain;  /**< Sleeping chain.         */
+		unsigned nvcsw;     /**< Voluntary context switches.       */
+		unsigned nivcsw;    /**< Involuntary context switches.     */
+		unsigned inblock;   /**< Blocks read.                      */
+		unsigned oublock;   /**< Blocks written.                   */
+		unsigned maxrss;    /**< Peak resident pages.              */
+		unsigned cminflt;   /**< Minor page faults of children.    */
+		unsigned cmajflt;   /**< Major page faults of children.    */
+		unsigned cnvcsw;    /**< Voluntary switches of children.   */
+		unsigned cnivcsw;   /**< Involuntary switches of children. */
+		unsigned cinblock;  /**< Blocks read by children.          */
+		unsigned coublock;  /**< Blocks written by children.       */
+		unsigned cnsyscall; /**< System calls made by children.    */
+		unsigned cmaxrss;   /**< Peak resident pages of children.  */
 		/**@}*/
 	};
 	
 	/* Forward definitions. */
+	EXTERN void adopt(struct process *, struct process *);
 	EXTERN void bury(struct process *);
+	EXTERN struct process *getproc(pid_t);
+	EXTERN void setgrp(struct process *, struct process *);
+	EXTERN void pidhash_insert(struct process *);
+	EXTERN void pidhash_remove(struct process *);
 	EXTERN void die(int);
+	EXTERN pid_t do_fork(int);
+	EXTERN void dropexec(struct inode *);
 	EXTERN int issig(void);
+	EXTERN sigset_t sigenter(int);
 	EXTERN void pm_init(void);
 	EXTERN void sched(struct process *);
+	EXTERN void setalarm(struct process *, unsigned);
+	EXTERN void itimer_tick(int);
+	EXTERN int runnable(void);
+	EXTERN void sched_stat(unsigned *, unsigned *, unsigned *, unsigned *);
+	EXTERN void sched_tick(int);
+	EXTERN void sched_setpolicy(struct process *, int, int);
+	EXTERN int sched_lend(struct process *, int);
+	EXTERN void sched_suspend(struct process *);
+	EXTERN void sched_unsuspend(struct process *);
 
 #ifdef __NANVIX_KERNEL__
 
-	EXTERN void sleep(struct process **, int);
+	EXTERN int sleep(struct waitq *, int);
+	EXTERN int sleep_excl(struct waitq *, int);
+	EXTERN int tsleep(struct waitq *, int, unsigned);
 	
 #endif /* __NANVIX_KERNEL__ */
 
     EXTERN void sndsig(struct process *, int);
-	EXTERN void wakeup(struct process **);
+	EXTERN void wake(struct process *, int);
+	EXTERN void wakeup(struct waitq *);
+	EXTERN void wakeup_one(struct waitq *);
+	EXTERN void wakeup_reason(struct waitq *, int);
 	EXTERN void yield(void);
+	EXTERN void preempt(void);
+	EXTERN void resched(void);
+	EXTERN int need_resched;
+	
+	/* Lock accounting. */
+	struct lockstat;
+	EXTERN void lock_acquire(int);
+	EXTERN void lock_wait(int, struct process *, int);
+	EXTERN void lock_release(struct process *);
+	EXTERN void lock_stat(int, struct lockstat *);
+	EXTERN void lock_hot(struct lockstat *, unsigned, unsigned, unsigned);
 	
 	/**
 	 * @name Process memory regions
 	 */
 	/**@{*/
-	#define TEXT(p)  (&p->pregs[0]) /**< Text region.  */
-	#define DATA(p)  (&p->pregs[1]) /**< Data region.  */
-	#define STACK(p) (&p->pregs[2]) /**< Stack region. */
-	#define HEAP(p)  (&p->pregs[3]) /**< Heap region.  */
+	#define TEXT(p)    (&p->pregs[0])       /**< Text region.         */
+	#define DATA(p)    (&p->pregs[1])       /**< Data region.         */
+	#define STACK(p)   (&p->pregs[2])       /**< Stack region.        */
+	#define HEAP(p)    (&p->pregs[3])       /**< Heap region.         */
+	#define LTEXT(p)   (&p->pregs[4])       /**< Shared library text. */
+	#define LDATA(p)   (&p->pregs[5])       /**< Shared library data. */
+	#define MMAP(p, i) (&p->pregs[6 + (i)]) /**< File mapping region. */
 	/**@}*/
 	
 	/**
@@ -277,6 +449,7 @@
 	/* Forward definitions. */	
 	EXTERN void resume(struct process *);
 	EXTERN void stop(void);
+	EXTERN void vfrelease(void);
 	
 	/* Forward definitions. */
 	EXTERN int shutting_down;
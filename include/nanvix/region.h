@@ -24,7 +24,10 @@
 
 	#include <nanvix/const.h>
 	#include <nanvix/hal.h>
+	#include <nanvix/waitq.h>
+	#include <sys/lockstat.h>
 	#include <sys/types.h>
+	#include <sys/vmstat.h>
 
 	/* Memory region flags. */
 	#define REGION_FREE      0x01 /* Region is free.         */
@@ -33,6 +36,8 @@
 	#define REGION_STICKY    0x08 /* Stick region.           */
 	#define REGION_DOWNWARDS 0x10 /* Region grows downwards. */
 	#define REGION_UPWARDS   0x20 /* Region grows upwards.   */
+	#define REGION_MMAP      0x40 /* Region maps a file.     */
+	#define REGION_HUGE      0x80 /* May use 4 MB pages.     */
 	
 	/* Memory region dimensions. */
 	#define REGION_PGTABS (8)                        /* # Page tables.   */
@@ -48,8 +53,11 @@
 		int count;                        /* Reference count.            */
 		size_t size;                      /* Region size.                */
 		struct pte *pgtab[REGION_PGTABS]; /* Underlying page table.      */
-		struct process *chain;            /* Sleeping chain.             */
+		struct waitq chain;               /* Sleeping chain.             */
+		struct process *holder;           /* Lock holder.                */
+		unsigned waits;                   /* Sleeps waiting for lock.    */
 		struct pregion *preg;             /* Process region attached to. */
+		unsigned nlocks;                  /* Processes locking it.       */
 		
 		/* File information. */
 		struct
@@ -74,6 +82,7 @@
 	{
 		addr_t start;       /* Starting address.         */
 		struct region *reg; /* Underlying memory region. */
+		int locked;         /* Locked in memory?         */
 	};
 	
 	/**
@@ -105,16 +114,27 @@
 	
 	/* Forward definitions. */
 	EXTERN int attachreg(struct process*,struct pregion*,addr_t,struct region*);
+	EXTERN int discardreg(struct process *, struct pregion *, addr_t, size_t);
 	EXTERN int editreg(struct region *, uid_t, gid_t, mode_t);
 	EXTERN int growreg(struct process *, struct pregion *, ssize_t);
 	EXTERN int loadreg(struct inode *, struct region *, off_t, size_t);
+	EXTERN int mlockreg(struct process *, struct pregion *);
+	EXTERN int shrinktext(void);
 	EXTERN void detachreg(struct process *, struct pregion *);
+	EXTERN void droptext(struct inode *);
 	EXTERN void freereg(struct region *);
 	EXTERN void initreg(void);
 	EXTERN void lockreg(struct region *);
+	EXTERN void munlockreg(struct pregion *);
+	EXTERN void regstat(struct vmstat *);
+	EXTERN void reglockstat(struct lockstat *);
+	EXTERN void sharereg(struct process *, struct pregion *, struct pregion *);
 	EXTERN void unlockreg(struct region *);
+	EXTERN size_t lockedreg(struct process *);
 	EXTERN struct region *allocreg(mode_t, size_t, int);
 	EXTERN struct region *dupreg(struct region *);
+	EXTERN struct region *mmapreg(struct inode *, off_t, size_t, mode_t, int);
+	EXTERN struct region *textreg(struct inode *, off_t, size_t, size_t);
 	EXTERN struct pregion *findreg(struct process *, addr_t);
 
 #endif /* _ASM_FILE */
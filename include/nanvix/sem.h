@@ -0,0 +1,66 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file nanvix/sem.h
+ * 
+ * @brief Semaphores.
+ */
+
+#ifndef NANVIX_SEM_H_
+#define NANVIX_SEM_H_
+
+#ifndef _ASM_FILE_
+
+	#include <nanvix/const.h>
+	#include <nanvix/waitq.h>
+
+	/**
+	 * @name Semaphore table dimensions
+	 */
+	/**@{*/
+	#define SEM_MAX          64 /**< Number of semaphores.     */
+	#define SEM_HASHTAB_SIZE 32 /**< Size of key hash table.   */
+	/**@}*/
+
+	/**
+	 * @brief Semaphore.
+	 */
+	struct semaphore
+	{
+		int valid;              /**< Is the semaphore in use?     */
+		int value;              /**< Current value.               */
+		unsigned key;           /**< Key.                         */
+		unsigned seq;           /**< Incarnation number.          */
+		struct semaphore *next; /**< Next semaphore in hash/free. */
+		struct waitq chain;     /**< Processes waiting to down.   */
+		struct waitq zchain;    /**< Processes waiting for zero.  */
+	};
+
+	/* Forward definitions. */
+	EXTERN struct semaphore *sem_lookup(unsigned);
+	EXTERN struct semaphore *sem_alloc(unsigned);
+	EXTERN struct semaphore *sem_get(int);
+	EXTERN int sem_id(const struct semaphore *);
+	EXTERN void sem_free(struct semaphore *);
+	EXTERN void sem_init(void);
+
+#endif /* _ASM_FILE_ */
+
+#endif /* NANVIX_SEM_H_ */
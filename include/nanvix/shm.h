@@ -0,0 +1,58 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file nanvix/shm.h
+ * 
+ * @brief Shared memory segments.
+ */
+
+#ifndef NANVIX_SHM_H_
+#define NANVIX_SHM_H_
+
+#ifndef _ASM_FILE_
+
+	#include <nanvix/const.h>
+	#include <nanvix/pm.h>
+
+	/**
+	 * @brief Number of shared memory segments.
+	 */
+	#define SHM_MAX 32
+
+	/**
+	 * @brief Shared memory segment.
+	 */
+	struct shm
+	{
+		unsigned key;       /**< Key.                          */
+		size_t size;        /**< Size (in bytes).              */
+		struct region *reg; /**< Memory region (NULL if free). */
+	};
+
+	/* Forward definitions. */
+	EXTERN struct shm *shm_lookup(unsigned);
+	EXTERN struct shm *shm_alloc(unsigned, size_t);
+	EXTERN struct shm *shm_get(int);
+	EXTERN int shm_id(const struct shm *);
+	EXTERN void shm_free(struct shm *);
+
+#endif /* _ASM_FILE_ */
+
+#endif /* NANVIX_SHM_H_ */
@@ -0,0 +1,146 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file nanvix/socket.h
+ * 
+ * @brief Sockets.
+ */
+
+#ifndef NANVIX_SOCKET_H_
+#define NANVIX_SOCKET_H_
+
+#ifndef _ASM_FILE_
+
+	#include <nanvix/const.h>
+	#include <nanvix/fs.h>
+	#include <nanvix/waitq.h>
+	#include <sys/socket.h>
+	#include <sys/types.h>
+	#include <sys/uio.h>
+	#include <sys/un.h>
+
+	/**
+	 * @name Socket limits
+	 */
+	/**@{*/
+	#define SOCK_PAGES    4                      /**< Receive buffer pages.   */
+	#define SOCK_BUFSIZ   (SOCK_PAGES*PAGE_SIZE) /**< Receive buffer size.    */
+	#define SOCK_FDS_MAX  8                      /**< Files passed at once.   */
+	#define SOCK_PATH_MAX UNIX_PATH_MAX          /**< Length of a bound name. */
+	/**@}*/
+
+	/**
+	 * @name Socket flags
+	 */
+	/**@{*/
+	#define SOCKET_LISTEN    (1 << 0) /**< Listening for connections? */
+	#define SOCKET_CONNECTED (1 << 1) /**< Ever connected?            */
+	#define SOCKET_HUP       (1 << 2) /**< Peer gone?                 */
+	#define SOCKET_DEAD      (1 << 3) /**< Last file closed?          */
+	/**@}*/
+
+	/**
+	 * @brief Files in flight.
+	 * 
+	 * @details Files passed along with data are queued at the receiving
+	 *          socket, tagged with the position of that data in the stream
+	 *          of bytes that the socket has received. They are handed to the
+	 *          first receive call that gets past that position, or closed if
+	 *          that call cannot take them.
+	 */
+	struct rights
+	{
+		unsigned seq;                     /**< Position of the data. */
+		unsigned nfiles;                  /**< Number of files.      */
+		struct file *files[SOCK_FDS_MAX]; /**< Files.                */
+		struct rights *next;              /**< Next in queue.        */
+	};
+
+	/**
+	 * @brief Socket.
+	 * 
+	 * @details Each UNIX domain socket owns a receive buffer, which its peers
+	 *          write to. Byte counters run freely, so that the buffer holds
+	 *          head - tail bytes. Datagrams are stored as records, each one
+	 *          preceded by its length and by the name of its sender. Internet
+	 *          sockets keep their state in a protocol control block instead.
+	 */
+	struct socket
+	{
+		int domain;               /**< AF_UNIX or AF_INET.           */
+		int type;                 /**< SOCK_STREAM or SOCK_DGRAM.    */
+		int flags;                /**< Flags (see above).            */
+		struct inode *inode;      /**< Socket inode.                 */
+		struct inode *name;       /**< Bound name (or NULL).         */
+		struct inode *dest;       /**< Default datagram destination. */
+		struct socket *peer;      /**< Connected peer (or NULL).     */
+		struct socket *pending;   /**< Connections to be accepted.   */
+		struct socket *next;      /**< Next pending connection.      */
+		unsigned npending;        /**< Pending connections.          */
+		unsigned backlog;         /**< Maximum pending connections.  */
+		unsigned busy;            /**< Senders writing to it.        */
+		char *pages[SOCK_PAGES];  /**< Receive buffer.               */
+		unsigned head;            /**< Bytes received.               */
+		unsigned tail;            /**< Bytes consumed.               */
+		struct rights *rights;    /**< Files in flight.              */
+		struct waitq rchain;      /**< Waiting to receive/accept.    */
+		struct waitq wchain;      /**< Waiting for buffer room.      */
+		char path[SOCK_PATH_MAX]; /**< Bound name (or empty).        */
+		void *pcb;                /**< Protocol control block.       */
+	};
+
+	/**
+	 * @brief Bytes in the receive buffer of a socket.
+	 */
+	#define socket_used(so) \
+		((so)->head - (so)->tail)
+
+	/**
+	 * @brief Room left in the receive buffer of a socket.
+	 */
+	#define socket_room(so) \
+		(SOCK_BUFSIZ - socket_used(so))
+
+	/* Forward definitions. */
+	EXTERN struct socket *socket_alloc(int, int);
+	EXTERN void socket_put(struct socket *);
+	EXTERN void socket_release(struct socket *);
+	EXTERN struct socket *socket_get(int);
+	EXTERN int socket_install(struct socket *);
+	EXTERN int socket_path(const struct sockaddr *, socklen_t, char *);
+	EXTERN void socket_name(const char *, struct sockaddr *, socklen_t *);
+	EXTERN struct inode *socket_lookup(const char *);
+	EXTERN int socket_bind(struct socket *, const char *);
+	EXTERN int socket_connect(struct socket *, struct socket *);
+	EXTERN struct socket *socket_accept(struct socket *, int);
+	EXTERN int socket_pair(struct socket *, struct socket *);
+	EXTERN ssize_t socket_send(struct socket *, const struct iovec *, int,
+		struct socket *, struct rights **, int);
+	EXTERN ssize_t socket_recv(struct socket *, const struct iovec *, int,
+		char *, struct rights **, int *);
+	EXTERN ssize_t socket_read(struct inode *, char *, size_t, int);
+	EXTERN ssize_t socket_write(struct inode *, const char *, size_t, int);
+	EXTERN int socket_poll(struct inode *);
+	EXTERN struct rights *rights_alloc(void);
+	EXTERN void rights_free(struct rights *);
+
+#endif /* _ASM_FILE_ */
+
+#endif /* NANVIX_SOCKET_H_ */
@@ -0,0 +1,65 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file nanvix/spinlock.h
+ * 
+ * @brief Spinlocks.
+ */
+
+#ifndef NANVIX_SPINLOCK_H_
+#define NANVIX_SPINLOCK_H_
+
+#ifndef _ASM_FILE_
+
+	#include <nanvix/const.h>
+
+	/**
+	 * @brief Spinlock.
+	 * 
+	 * @details A spinlock also disables interrupts on the local processor
+	 *          while it is held, so it protects data shared with interrupt
+	 *          handlers. Critical sections must be short, must not nest and
+	 *          must not sleep.
+	 */
+	struct spinlock
+	{
+		volatile int locked; /**< Is the lock held? */
+	};
+	
+	/**
+	 * @brief Static initializer for spinlocks.
+	 */
+	#define SPINLOCK_INITIALIZER { 0 }
+	
+	/**
+	 * @brief Initializes a spinlock.
+	 * 
+	 * @param lock Spinlock.
+	 */
+	#define spin_init(lock) \
+		((lock)->locked = 0)
+	
+	/* Forward definitions. */
+	EXTERN void spin_lock(struct spinlock *lock);
+	EXTERN void spin_unlock(struct spinlock *lock);
+
+#endif /* _ASM_FILE_ */
+
+#endif /* NANVIX_SPINLOCK_H_ */
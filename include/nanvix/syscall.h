@@ -26,12 +26,32 @@
 	#include <sys/times.h>
 	#include <sys/types.h>
 	#include <sys/utsname.h>
+	#include <sys/cachestat.h>
+	#include <sys/epoll.h>
+	#include <sys/ioprio.h>
+	#include <sys/iostat.h>
+	#include <sys/io_uring.h>
+	#include <sys/lockstat.h>
+	#include <sys/multicall.h>
+	#include <sys/procstat.h>
+	#include <sys/resource.h>
+	#include <sys/shm.h>
+	#include <sys/socket.h>
+	#include <sys/sysstat.h>
+	#include <sys/time.h>
+	#include <sys/uio.h>
+	#include <sys/vmstat.h>
+	#include <mqueue.h>
+	#include <poll.h>
+	#include <sched.h>
 	#include <signal.h>
+	#include <stdint.h>
+	#include <time.h>
 	#include <ustat.h>
 	#include <utime.h>
 	
 	/* Number of system calls. */
-	#define NR_SYSCALLS 48
+	#define NR_SYSCALLS 126
 	
 	/* System call numbers. */
 	#define NR_alarm     0
@@ -85,6 +105,88 @@
  	#define NR_semget   48
  	#define NR_semctl   49
  	#define NR_semop    50
+	#define NR_cachestat 51
+	#define NR_iostat    52
+	#define NR_sendfile  53
+	#define NR_readv     54
+	#define NR_writev    55
+	#define NR_pread     56
+	#define NR_pwrite    57
+	#define NR_fsync     58
+	#define NR_fdatasync 59
+	#define NR_mmap      60
+	#define NR_munmap    61
+	#define NR_getdents  62
+	#define NR_swapon    63
+	#define NR_vfork     64
+	#define NR_vmstat    65
+	#define NR_nanosleep 66
+	#define NR_futex     67
+	#define NR_shmget    68
+	#define NR_shmat     69
+	#define NR_shmdt     70
+	#define NR_shmctl    71
+	#define NR_clone     72
+	#define NR_mq_open   73
+	#define NR_mq_close  74
+	#define NR_mq_unlink 75
+	#define NR_mq_send   76
+	#define NR_mq_receive 77
+	#define NR_mq_setattr 78
+	#define NR_poll      79
+	#define NR_epoll_create 80
+	#define NR_epoll_ctl    81
+	#define NR_epoll_wait   82
+	#define NR_epoll_close  83
+	#define NR_io_uring_setup 84
+	#define NR_io_uring_enter 85
+	#define NR_io_uring_close 86
+	#define NR_multicall      87
+	#define NR_sigaction      88
+	#define NR_sigprocmask    89
+	#define NR_sigsuspend     90
+	#define NR_sigpending     91
+	#define NR_pmc_open       92
+	#define NR_pmc_read       93
+	#define NR_pmc_close      94
+	#define NR_sysstat        95
+	#define NR_wait4          96
+	#define NR_getrusage      97
+	#define NR_procstat       98
+	#define NR_getcwd         99
+	#define NR_fstat         100
+	#define NR_openat        101
+	#define NR_fstatat       102
+	#define NR_unlinkat      103
+	#define NR_mkdirat       104
+	#define NR_rename        105
+	#define NR_lockstat      106
+	#define NR_sched_setscheduler 107
+	#define NR_ioprio_set    108
+	#define NR_madvise       109
+	#define NR_posix_fadvise 110
+	#define NR_mlock         111
+	#define NR_munlock       112
+	#define NR_mlockall      113
+	#define NR_munlockall    114
+	#define NR_socket        115
+	#define NR_socketpair    116
+	#define NR_bind          117
+	#define NR_listen        118
+	#define NR_accept        119
+	#define NR_connect       120
+	#define NR_sendmsg       121
+	#define NR_recvmsg       122
+	#define NR_getitimer     123
+	#define NR_setitimer     124
+	#define NR_profil        125
+	
+	/*
+	 * System call trap used by the C library. It goes through
+	 * sysenter when the processor supports it, and through
+	 * int $0x80 otherwise. Arguments go in ebx, ecx and edx.
+	 */
+	#define SYSCALL_TRAP "call *__syscall_entry"
 
 #ifndef _ASM_FILE_
 
@@ -106,6 +208,9 @@
 	EXTERN pid_t sys_setpgrp(void);
 	EXTERN int sys_setuid(pid_t uid);
 	EXTERN pid_t sys_wait(int *stat_loc);
+	EXTERN pid_t sys_wait4(pid_t pid, int *stat_loc, int options, struct rusage *r_usage);
+	EXTERN int sys_getrusage(int who, struct rusage *r_usage);
+
 	
 	/*
 	 * Duplicates a file descriptor.
@@ -252,7 +357,7 @@
 	/*
 	 * Gets process information
 	 */
-	EXTERN int sys_ps(void);
+	EXTERN int sys_ps(int flags);
 
 	/*
 	 * Clear the screen
@@ -263,6 +368,442 @@
 	 * Get system ticks since initialization
 	 */
 	EXTERN int sys_gticks(void);
+	
+	/*
+	 * Unimplemented system call.
+	 */
+	EXTERN int sys_nosys(void);
+	
+	/*
+	 * Gets kernel cache statistics.
+	 */
+	EXTERN int sys_cachestat(int cache, struct cachestat *buf);
+	
+	/*
+	 * Gets block device I/O statistics.
+	 */
+	EXTERN int sys_iostat(dev_t dev, struct iostat *buf);
+	
+	/*
+	 * Sends data from a file to another file.
+	 */
+	EXTERN ssize_t sys_sendfile(int out_fd, int in_fd, size_t n);
+	
+	/*
+	 * Reads from a file into multiple buffers.
+	 */
+	EXTERN ssize_t sys_readv(int fd, const struct iovec *iov, int iovcnt);
+	
+	/*
+	 * Writes to a file from multiple buffers.
+	 */
+	EXTERN ssize_t sys_writev(int fd, const struct iovec *iov, int iovcnt);
+	
+	/*
+	 * Reads from a file at a given offset.
+	 */
+	EXTERN ssize_t sys_pread(int fd, void *buf, size_t n, off_t off);
+	
+	/*
+	 * Writes to a file at a given offset.
+	 */
+	EXTERN ssize_t sys_pwrite(int fd, const void *buf, size_t n, off_t off);
+	
+	/*
+	 * Synchronizes changes to a file.
+	 */
+	EXTERN int sys_fsync(int fd);
+	
+	/*
+	 * Synchronizes the data of a file.
+	 */
+	EXTERN int sys_fdatasync(int fd);
+	
+	/*
+	 * Maps a file into memory.
+	 */
+	EXTERN void *sys_mmap(size_t len, int prot, int flags, int fd, off_t off);
+	
+	/*
+	 * Unmaps a file from memory.
+	 */
+	EXTERN int sys_munmap(void *addr, size_t len);
+	
+	/*
+	 * Reads directory entries.
+	 */
+	EXTERN ssize_t sys_getdents(int fd, void *buf, size_t n);
+	
+	/*
+	 * Adds a swap area.
+	 */
+	EXTERN int sys_swapon(const char *path, size_t size, int prio);
+	
+	/*
+	 * Creates a new process and suspends the caller.
+	 */
+	EXTERN pid_t sys_vfork(void);
+	
+	/*
+	 * Gets virtual memory statistics.
+	 */
+	EXTERN int sys_vmstat(struct vmstat *buf);
+	
+	/*
+	 * High resolution sleep.
+	 */
+	EXTERN int sys_nanosleep(const struct timespec *rqtp, struct timespec *rmtp);
+	
+	/*
+	 * Gets a semaphore.
+	 */
+	EXTERN int sys_semget(unsigned key);
+	
+	/*
+	 * Controls a semaphore.
+	 */
+	EXTERN int sys_semctl(int semid, int cmd, int val);
+	
+	/*
+	 * Operates on a semaphore.
+	 */
+	EXTERN int sys_semop(int semid, int op);
+	
+	/*
+	 * Waits on or wakes up processes waiting on a futex.
+	 */
+	EXTERN int sys_futex(int *addr, int op, int val);
+	
+	/*
+	 * Gets a shared memory segment.
+	 */
+	EXTERN int sys_shmget(unsigned key, size_t size);
+	
+	/*
+	 * Attaches a shared memory segment.
+	 */
+	EXTERN void *sys_shmat(int shmid);
+	
+	/*
+	 * Detaches a shared memory segment.
+	 */
+	EXTERN int sys_shmdt(const void *addr);
+	
+	/*
+	 * Controls a shared memory segment.
+	 */
+	EXTERN int sys_shmctl(int shmid, int cmd, struct shmid_ds *buf);
+	
+	/*
+	 * Creates a thread.
+	 */
+	EXTERN pid_t sys_clone(void (*fn)(void), void *stack);
+	
+	/*
+	 * Opens a message queue.
+	 */
+	EXTERN mqd_t sys_mq_open(const char *name, int oflag,
+		const struct mq_attr *attr);
+	
+	/*
+	 * Closes a message queue.
+	 */
+	EXTERN int sys_mq_close(mqd_t mqd);
+	
+	/*
+	 * Removes a message queue.
+	 */
+	EXTERN int sys_mq_unlink(const char *name);
+	
+	/*
+	 * Sends a message to a message queue.
+	 */
+	EXTERN int sys_mq_send(mqd_t mqd, const char *buf, size_t len,
+		unsigned prio);
+	
+	/*
+	 * Receives a message from a message queue.
+	 */
+	EXTERN ssize_t sys_mq_receive(mqd_t mqd, char *buf, size_t len,
+		unsigned *prio);
+	
+	/*
+	 * Gets and sets message queue attributes.
+	 */
+	EXTERN int sys_mq_setattr(mqd_t mqd, const struct mq_attr *attr,
+		struct mq_attr *oattr);
+	
+	/*
+	 * Waits for events on file descriptors.
+	 */
+	EXTERN int sys_poll(struct pollfd *fds, nfds_t nfds, int timeout);
+	
+	/*
+	 * Creates an event poll instance.
+	 */
+	EXTERN int sys_epoll_create(int size);
+	
+	/*
+	 * Changes the file descriptors watched by an event poll instance.
+	 */
+	EXTERN int sys_epoll_ctl(int epfd, int op, int fd, struct epoll_event *event);
+	
+	/*
+	 * Waits for events on an event poll instance.
+	 */
+	EXTERN int sys_epoll_wait(int epfd, struct epoll_event *events,
+		int maxevents, int timeout);
+	
+	/*
+	 * Closes an event poll instance.
+	 */
+	EXTERN int sys_epoll_close(int epfd);
+	
+	/*
+	 * Sets up an I/O ring.
+	 */
+	EXTERN int sys_io_uring_setup(unsigned entries, struct io_uring_params *params);
+	
+	/*
+	 * Submits requests and waits for completions on an I/O ring.
+	 */
+	EXTERN int sys_io_uring_enter(int id, unsigned to_submit, unsigned min_complete);
+	
+	/*
+	 * Closes an I/O ring.
+	 */
+	EXTERN int sys_io_uring_close(int id);
+	
+	/*
+	 * Executes a batch of system calls.
+	 */
+	EXTERN int sys_multicall(struct multicall *calls, unsigned n, int flags);
+	
+	/*
+	 * Examines and changes a signal action.
+	 */
+	EXTERN int sys_sigaction(int sig, const struct sigaction *act,
+		struct sigaction *oact, void (*restorer)(void));
+	
+	/*
+	 * Examines and changes blocked signals.
+	 */
+	EXTERN int sys_sigprocmask(int how, const sigset_t *set, sigset_t *oset);
+	
+	/*
+	 * Waits for a signal with a given signal mask.
+	 */
+	EXTERN int sys_sigsuspend(const sigset_t *mask);
+	
+	/*
+	 * Examines pending signals.
+	 */
+	EXTERN int sys_sigpending(sigset_t *set);
+	
+	/*
+	 * Opens a performance counter.
+	 */
+	EXTERN int sys_pmc_open(unsigned event, unsigned period);
+	
+	/*
+	 * Reads a performance counter.
+	 */
+	EXTERN int sys_pmc_read(int id, uint64_t *value);
+	
+	/*
+	 * Closes a performance counter.
+	 */
+	EXTERN int sys_pmc_close(int id);
+	
+	/*
+	 * Gets or controls system call statistics.
+	 */
+	EXTERN int sys_sysstat(int cmd, pid_t pid, struct sysstat *buf);
+	
+	/*
+	 * Gets a snapshot of the process table.
+	 */
+	EXTERN int sys_procstat
+	(int version, const struct procfilter *filter, struct procstat *buf, unsigned n);
+	
+	/*
+	 * Gets the pathname of the current working directory.
+	 */
+	EXTERN int sys_getcwd(char *buf, size_t size);
+	
+	/*
+	 * Gets status of an opened file.
+	 */
+	EXTERN int sys_fstat(int fd, struct stat *buf);
+	
+	/*
+	 * Opens a file relative to a directory.
+	 */
+	EXTERN int sys_openat(int dirfd, const char *path, int oflag, mode_t mode);
+	
+	/*
+	 * Gets file status relative to a directory.
+	 */
+	EXTERN int sys_fstatat(int dirfd, const char *path, struct stat *buf, int flag);
+	
+	/*
+	 * Removes a directory entry relative to a directory.
+	 */
+	EXTERN int sys_unlinkat(int dirfd, const char *path, int flag);
+	
+	/*
+	 * Creates a directory relative to a directory.
+	 */
+	EXTERN int sys_mkdirat(int dirfd, const char *path, mode_t mode);
+	
+	/*
+	 * Renames a file.
+	 */
+	EXTERN int sys_rename(const char *path1, const char *path2);
+	
+	/*
+	 * Gets kernel lock statistics.
+	 */
+	EXTERN int sys_lockstat(int class, struct lockstat *buf);
+	
+	/*
+	 * Sets the scheduling policy and parameters of a process.
+	 */
+	EXTERN int sys_sched_setscheduler(pid_t pid, int policy, const struct sched_param *param);
+	
+	/*
+	 * Sets the I/O scheduling class of a process.
+	 */
+	EXTERN int sys_ioprio_set(pid_t pid, int ioclass);
+	
+	/*
+	 * Gives advice about the use of memory.
+	 */
+	EXTERN int sys_madvise(void *addr, size_t len, int advice);
+	
+	/*
+	 * Gives advice about the use of file data.
+	 */
+	EXTERN int sys_posix_fadvise(int fd, off_t off, off_t len, int advice);
+	
+	/*
+	 * Locks a range of the address space in memory.
+	 */
+	EXTERN int sys_mlock(const void *addr, size_t len);
+	
+	/*
+	 * Unlocks a range of the address space.
+	 */
+	EXTERN int sys_munlock(const void *addr, size_t len);
+	
+	/*
+	 * Locks the address space in memory.
+	 */
+	EXTERN int sys_mlockall(int flags);
+	
+	/*
+	 * Unlocks the address space.
+	 */
+	EXTERN int sys_munlockall(void);
+	
+	/*
+	 * Creates a socket.
+	 */
+	EXTERN int sys_socket(int domain, int type, int protocol);
+	
+	/*
+	 * Creates a pair of connected sockets.
+	 */
+	EXTERN int sys_socketpair(int domain, int type, int protocol, int sv[2]);
+	
+	/*
+	 * Binds a name to a socket.
+	 */
+	EXTERN int sys_bind(int fd, const struct sockaddr *addr, socklen_t len);
+	
+	/*
+	 * Listens for socket connections.
+	 */
+	EXTERN int sys_listen(int fd, int backlog);
+	
+	/*
+	 * Accepts a new connection on a socket.
+	 */
+	EXTERN int sys_accept(int fd, struct sockaddr *addr, socklen_t *len);
+	
+	/*
+	 * Connects a socket.
+	 */
+	EXTERN int sys_connect(int fd, const struct sockaddr *addr, socklen_t len);
+	
+	/*
+	 * Sends a message through a socket.
+	 */
+	EXTERN ssize_t sys_sendmsg(int fd, const struct msghdr *msg, int flags);
+	
+	/*
+	 * Receives a message from a socket.
+	 */
+	EXTERN ssize_t sys_recvmsg(int fd, struct msghdr *msg, int flags);
+	
+	/*
+	 * Gets the value of an interval timer.
+	 */
+	EXTERN int sys_getitimer(int which, struct itimerval *value);
+	
+	/*
+	 * Sets the value of an interval timer.
+	 */
+	EXTERN int sys_setitimer(int which, const struct itimerval *value,
+		struct itimerval *ovalue);
+	
+	/*
+	 * Starts or stops execution time profiling.
+	 */
+	EXTERN int sys_profil(unsigned short *buf, size_t bufsiz, size_t offset,
+		unsigned scale);
+	
+	/*
+	 * Are system calls being accounted?
+	 */
+	EXTERN int sysstat_on;
+	
+	/*
+	 * Does a system call and accounts for it.
+	 */
+	EXTERN int syscall_timed
+	(unsigned nr, unsigned a, unsigned b, unsigned c, unsigned d, unsigned e);
+	
+	/* Forward definitions. */
+	struct process;
+	
+	/*
+	 * Clears the system call statistics of a process.
+	 */
+	EXTERN void sysstat_release(struct process *proc);
+	
+	/*
+	 * Target of do_rusage(): a process and its waited-for children.
+	 */
+	#define RUSAGE_BOTH -2
+	
+	/*
+	 * Gets the resource usage of a process.
+	 */
+	EXTERN void do_rusage(struct process *proc, int who, struct rusage *r_usage);
+	
+	/* Forward definitions. */
+	struct inode;
+	
+	/*
+	 * Fills in the status of a file.
+	 */
+	EXTERN void do_stat(struct inode *ip, struct stat *buf);
+	
+	/*
+	 * System calls table.
+	 */
+	EXTERN void (*syscalls_table[NR_SYSCALLS])(void);
 
 #endif /* _ASM_FILE_ */
 
@@ -0,0 +1,61 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NANVIX_TIMEPAGE_H_
+#define NANVIX_TIMEPAGE_H_
+
+	/**
+	 * @brief Address of the time page in every address space.
+	 */
+	#define TIMEPAGE_ADDR 0xc13ff000
+
+#ifndef _ASM_FILE_
+
+	#include <sys/types.h>
+	#include <stdint.h>
+
+	/**
+	 * @brief Time page.
+	 * 
+	 * @details The kernel shares this page read-only with every process,
+	 *          so that the time and the process ID can be read without a
+	 *          system call. The sequence counter is odd while the kernel
+	 *          updates the time fields, and readers retry if it was odd
+	 *          or changed while they read. The process ID always refers
+	 *          to the running process.
+	 */
+	struct timepage
+	{
+		unsigned seq;          /**< Sequence counter.                  */
+		unsigned ticks;        /**< Clock ticks since initialization.  */
+		unsigned startup_time; /**< Time at system startup.            */
+		unsigned freq;         /**< Clock ticks per second.            */
+		unsigned tsc_per_tick; /**< TSC counts per tick, or zero.      */
+		uint64_t tsc_last;     /**< TSC at the last clock tick.        */
+		pid_t pid;             /**< ID of the running process.         */
+	};
+	
+	/**
+	 * @brief Time page of the calling process.
+	 */
+	#define TIMEPAGE \
+		((const volatile struct timepage *)TIMEPAGE_ADDR)
+
+#endif /* _ASM_FILE_ */
+#endif /* NANVIX_TIMEPAGE_H_ */
@@ -0,0 +1,59 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file nanvix/timer.h
+ * 
+ * @brief Kernel timers.
+ */
+
+#ifndef NANVIX_TIMER_H_
+#define NANVIX_TIMER_H_
+
+#ifndef _ASM_FILE_
+
+	#include <nanvix/const.h>
+
+	/**
+	 * @brief Kernel timer.
+	 */
+	struct timer
+	{
+		struct timer *next;     /**< Next timer in the slot.        */
+		struct timer **pprev;   /**< Link to this timer (if armed). */
+		unsigned expires;       /**< Expiration time (in ticks).    */
+		void (*func)(void *);   /**< Function to call on expiry.    */
+		void *arg;              /**< Argument to that function.     */
+	};
+	
+	/**
+	 * @brief Asserts if a timer is armed.
+	 */
+	#define TIMER_PENDING(t) ((t)->pprev != NULL)
+	
+	/* Forward definitions. */
+	EXTERN void timer_init(struct timer *, void (*)(void *), void *);
+	EXTERN void timer_add(struct timer *, unsigned);
+	EXTERN void timer_cancel(struct timer *);
+	EXTERN void timer_run(void);
+	EXTERN unsigned timer_idle(unsigned);
+
+#endif /* _ASM_FILE_ */
+
+#endif /* NANVIX_TIMER_H_ */
@@ -0,0 +1,90 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file nanvix/uring.h
+ * 
+ * @brief Asynchronous I/O rings.
+ */
+
+#ifndef NANVIX_URING_H_
+#define NANVIX_URING_H_
+
+#ifndef _ASM_FILE_
+
+	#include <nanvix/const.h>
+	#include <nanvix/fs.h>
+	#include <nanvix/waitq.h>
+	#include <sys/io_uring.h>
+	#include <sys/types.h>
+
+	/**
+	 * @name Asynchronous I/O limits
+	 */
+	/**@{*/
+	#define URING_MAX      8 /**< I/O rings.                 */
+	#define AIO_PAGES_MAX 16 /**< Buffer pages of a request. */
+	/**@}*/
+
+	/**
+	 * @brief I/O ring.
+	 */
+	struct uring
+	{
+		int count;           /**< Reference count (0 if free).  */
+		addr_t phys;         /**< Physical address of the ring. */
+		unsigned sq_head;    /**< First pending submission.     */
+		unsigned sq_mask;    /**< Mask of submission indexes.   */
+		unsigned cq_entries; /**< Number of completion entries. */
+		unsigned cq_mask;    /**< Mask of completion indexes.   */
+		unsigned inflight;   /**< Requests not completed yet.   */
+		struct waitq chain;  /**< Waiting for completions.      */
+	};
+
+	/**
+	 * @brief Asynchronous I/O request.
+	 */
+	struct aioreq
+	{
+		struct uring *ur;              /**< Ring.                       */
+		struct file *file;             /**< Target file.                */
+		unsigned opcode;               /**< Operation.                  */
+		unsigned flags;                /**< Operation flags.            */
+		off_t off;                     /**< File offset.                */
+		size_t len;                    /**< Buffer length.              */
+		unsigned pgoff;                /**< Offset in the first page.   */
+		unsigned npages;               /**< Buffer pages.               */
+		addr_t pages[AIO_PAGES_MAX];   /**< Physical buffer pages.      */
+		uint64_t user_data;            /**< Completion tag.             */
+		struct aioreq *next;           /**< Next request in the queue.  */
+	};
+
+	/* Forward definitions. */
+	EXTERN struct uring *uring_alloc(void);
+	EXTERN struct uring *uring_get(int);
+	EXTERN int uring_id(const struct uring *);
+	EXTERN void uring_put(struct uring *);
+	EXTERN void uring_init(struct uring *, addr_t, unsigned);
+	EXTERN int uring_submit(struct uring *, unsigned);
+	EXTERN int uring_wait(struct uring *, unsigned);
+	EXTERN void aiod(void);
+
+#endif /* _ASM_FILE_ */
+
+#endif /* NANVIX_URING_H_ */
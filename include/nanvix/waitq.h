@@ -0,0 +1,78 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file nanvix/waitq.h
+ * 
+ * @brief Wait queues.
+ */
+
+#ifndef NANVIX_WAITQ_H_
+#define NANVIX_WAITQ_H_
+
+#ifndef _ASM_FILE_
+
+	#include <nanvix/const.h>
+
+	/**
+	 * @name Wakeup reasons
+	 */
+	/**@{*/
+	#define WAKE_NORMAL  0 /**< Awaken by wakeup().      */
+	#define WAKE_SIGNAL  1 /**< Awaken by a signal.      */
+	#define WAKE_TIMEOUT 2 /**< Sleep has timed out.     */
+	/**@}*/
+
+	/**
+	 * @brief Wait queue.
+	 * 
+	 * @details Processes wait in first-in first-out order. Exclusive waiters
+	 *          are awaken one at a time, whereas non-exclusive waiters are
+	 *          all awaken at once.
+	 */
+	struct waitq
+	{
+		struct process *head; /**< Oldest waiting process. */
+		struct process *tail; /**< Newest waiting process. */
+	};
+	
+	/**
+	 * @brief Static initializer for wait queues.
+	 */
+	#define WAITQ_INITIALIZER { NULL, NULL }
+	
+	/**
+	 * @brief Initializes a wait queue.
+	 * 
+	 * @param wq Wait queue.
+	 */
+	#define waitq_init(wq) \
+		((wq)->head = (wq)->tail = NULL)
+	
+	/**
+	 * @brief Asserts if a wait queue is empty.
+	 * 
+	 * @param wq Wait queue.
+	 */
+	#define waitq_empty(wq) \
+		((wq)->head == NULL)
+
+#endif /* _ASM_FILE_ */
+
+#endif /* NANVIX_WAITQ_H_ */
@@ -0,0 +1,61 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file nanvix/work.h
+ * 
+ * @brief Kernel worker threads.
+ */
+
+#ifndef NANVIX_WORK_H_
+#define NANVIX_WORK_H_
+
+#ifndef _ASM_FILE_
+
+	#include <nanvix/const.h>
+
+	/**
+	 * @brief Deferred work item.
+	 */
+	struct work
+	{
+		struct work *next;    /**< Next item in the work queue. */
+		void (*func)(void *); /**< Function to call.            */
+		void *arg;            /**< Argument to that function.   */
+		int queued;           /**< Waiting for a worker?        */
+	};
+	
+	/**
+	 * @brief Static initializer for deferred work items.
+	 */
+	#define WORK_INITIALIZER(func, arg) { NULL, (func), (arg), 0 }
+	
+	/**
+	 * @brief Asserts if a work item is waiting for a worker.
+	 */
+	#define WORK_PENDING(w) ((w)->queued)
+	
+	/* Forward definitions. */
+	EXTERN void work_init(struct work *, void (*)(void *), void *);
+	EXTERN int work_queue(struct work *);
+	EXTERN void kworker(void);
+
+#endif /* _ASM_FILE_ */
+
+#endif /* NANVIX_WORK_H_ */
@@ -0,0 +1,110 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NETINET_IN_H_
+#define NETINET_IN_H_
+
+	#include <sys/socket.h>
+
+	/**
+	 * @name Internet protocols
+	 */
+	/**@{*/
+	#define IPPROTO_IP   0  /**< Internet protocol.  */
+	#define IPPROTO_ICMP 1  /**< Control messages.   */
+	#define IPPROTO_TCP  6  /**< Byte streams.       */
+	#define IPPROTO_UDP  17 /**< Datagrams.          */
+	/**@}*/
+
+	/**
+	 * @name Special addresses (host byte order)
+	 */
+	/**@{*/
+	#define INADDR_ANY       ((in_addr_t)0x00000000) /**< Any address.       */
+	#define INADDR_BROADCAST ((in_addr_t)0xffffffff) /**< Limited broadcast. */
+	#define INADDR_LOOPBACK  ((in_addr_t)0x7f000001) /**< Loopback.          */
+	#define INADDR_NONE      ((in_addr_t)0xffffffff) /**< Bad address.       */
+	/**@}*/
+
+	/**
+	 * @brief Length of the text form of an address, with the null byte.
+	 */
+	#define INET_ADDRSTRLEN 16
+
+#ifndef _ASM_FILE_
+
+	#include <stdint.h>
+
+	/**
+	 * @brief Port number.
+	 */
+	typedef uint16_t in_port_t;
+
+	/**
+	 * @brief IPv4 address.
+	 */
+	typedef uint32_t in_addr_t;
+
+	/**
+	 * @brief IPv4 address, in network byte order.
+	 */
+	struct in_addr
+	{
+		in_addr_t s_addr; /**< Address. */
+	};
+
+	/**
+	 * @brief Internet socket address.
+	 */
+	struct sockaddr_in
+	{
+		sa_family_t sin_family;    /**< AF_INET.                  */
+		in_port_t sin_port;        /**< Port, network byte order. */
+		struct in_addr sin_addr;   /**< Address.                  */
+		unsigned char sin_zero[8]; /**< Padding up to sockaddr.   */
+	};
+
+	/**
+	 * @brief Converts a 16-bit value to network byte order.
+	 */
+	#define htons(x) \
+		((uint16_t)((((uint16_t)(x) & 0xff) << 8) | ((uint16_t)(x) >> 8)))
+
+	/**
+	 * @brief Converts a 32-bit value to network byte order.
+	 */
+	#define htonl(x)                                 \
+		((uint32_t)((((uint32_t)(x) & 0xff) << 24) |   \
+		(((uint32_t)(x) & 0xff00) << 8) |              \
+		(((uint32_t)(x) >> 8) & 0xff00) |              \
+		((uint32_t)(x) >> 24)))
+
+	/**
+	 * @brief Converts a 16-bit value to host byte order.
+	 */
+	#define ntohs(x) htons(x)
+
+	/**
+	 * @brief Converts a 32-bit value to host byte order.
+	 */
+	#define ntohl(x) htonl(x)
+
+#endif /* _ASM_FILE_ */
+
+#endif /* NETINET_IN_H_ */
@@ -0,0 +1,57 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef POLL_H_
+#define POLL_H_
+
+	/**
+	 * @name Poll events
+	 */
+	/**@{*/
+	#define POLLIN   0x01 /**< Data may be read without blocking.    */
+	#define POLLPRI  0x02 /**< Priority data may be read.            */
+	#define POLLOUT  0x04 /**< Data may be written without blocking. */
+	#define POLLERR  0x08 /**< An error has occurred.                */
+	#define POLLHUP  0x10 /**< Hung up.                              */
+	#define POLLNVAL 0x20 /**< Invalid file descriptor.              */
+	/**@}*/
+
+#ifndef _ASM_FILE_
+
+	/**
+	 * @brief Number of file descriptors.
+	 */
+	typedef unsigned nfds_t;
+
+	/**
+	 * @brief Polled file descriptor.
+	 */
+	struct pollfd
+	{
+		int fd;        /**< File descriptor.  */
+		short events;  /**< Requested events. */
+		short revents; /**< Returned events.  */
+	};
+
+	/* Forward definitions. */
+	extern int poll(struct pollfd [], nfds_t, int);
+
+#endif /* _ASM_FILE_ */
+
+#endif /* POLL_H_ */
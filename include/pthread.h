@@ -0,0 +1,76 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PTHREAD_H_
+#define PTHREAD_H_
+#ifndef _ASM_FILE_
+
+	#include <sys/types.h>
+	#include <sys/futex.h>
+
+	/*
+	 * Maximum number of threads.
+	 */
+	#define PTHREAD_MAX 16
+
+	/*
+	 * Thread stack size (in bytes).
+	 */
+	#define PTHREAD_STACK_SIZE (16*1024)
+
+	/*
+	 * Thread.
+	 */
+	struct pthread
+	{
+		pid_t tid;                  /* Thread ID.           */
+		void *(*start)(void *);     /* Start routine.       */
+		void *arg;                  /* Start argument.      */
+		void *retval;               /* Exit value.          */
+		char *stack;                /* Stack base.          */
+		int done;                   /* Has it terminated?   */
+	};
+
+	/*
+	 * Thread handle.
+	 */
+	typedef struct pthread *pthread_t;
+
+	/*
+	 * Thread mutex.
+	 */
+	typedef mutex_t pthread_mutex_t;
+
+	/* Static initializers. */
+	#define PTHREAD_MUTEX_INITIALIZER MUTEX_INITIALIZER
+
+	/* Forward definitions. */
+	extern int pthread_create(pthread_t *, const void *,
+		void *(*)(void *), void *);
+	extern int pthread_join(pthread_t, void **);
+	extern void pthread_exit(void *);
+	extern pthread_t pthread_self(void);
+	extern int pthread_mutex_init(pthread_mutex_t *, const void *);
+	extern int pthread_mutex_destroy(pthread_mutex_t *);
+	extern int pthread_mutex_lock(pthread_mutex_t *);
+	extern int pthread_mutex_trylock(pthread_mutex_t *);
+	extern int pthread_mutex_unlock(pthread_mutex_t *);
+
+#endif /* _ASM_FILE_ */
+#endif /* PTHREAD_H_ */
@@ -0,0 +1,70 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCHED_H_
+#define SCHED_H_
+
+	#include <sys/types.h>
+
+	/**
+	 * @name Scheduling policies
+	 */
+	/**@{*/
+	#define SCHED_OTHER 0 /**< Time sharing.                    */
+	#define SCHED_FIFO  1 /**< Real-time, first in, first out. */
+	#define SCHED_RR    2 /**< Real-time, round robin.          */
+	/**@}*/
+
+	/**
+	 * @name Real-time priorities
+	 * 
+	 * @details Real-time processes always run ahead of time sharing ones,
+	 *          and larger priorities run ahead of smaller ones.
+	 */
+	/**@{*/
+	#define SCHED_RTPRIO_MIN 1 /**< Lowest real-time priority.  */
+	#define SCHED_RTPRIO_MAX 8 /**< Highest real-time priority. */
+	/**@}*/
+
+	/*
+	 * Gets the priority range of a scheduling policy.
+	 */
+	#define sched_get_priority_min(policy) \
+		(((policy) == SCHED_OTHER) ? 0 : SCHED_RTPRIO_MIN)
+	#define sched_get_priority_max(policy) \
+		(((policy) == SCHED_OTHER) ? 0 : SCHED_RTPRIO_MAX)
+
+#ifndef _ASM_FILE_
+
+	/**
+	 * @brief Scheduling parameters.
+	 */
+	struct sched_param
+	{
+		int sched_priority; /**< Real-time priority, zero if time sharing. */
+	};
+
+	/*
+	 * Sets the scheduling policy and parameters of a process.
+	 */
+	extern int sched_setscheduler(pid_t pid, int policy, const struct sched_param *param);
+
+#endif /* _ASM_FILE_ */
+
+#endif /* SCHED_H_ */
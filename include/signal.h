@@ -19,7 +19,7 @@
 #ifndef SIGNAL_H_
 #define SIGNAL_H_
 
-	#define NR_SIGNALS 23
+	#define NR_SIGNALS 25
 
 	/* Signals. */
 	#define SIGNULL  0
@@ -45,6 +45,8 @@
 	#define SIGUSR1 20
 	#define SIGUSR2 21
 	#define SIGTRAP 22
+	#define SIGVTALRM 23
+	#define SIGPROF   24
 	
 	/* Handlers. */
 	#define _SIG_DFL 1
@@ -55,6 +57,15 @@
     /* Other constants. */
     #define _SIG_ERR 0
     #define SIG_ERR (sighandler_t)(_SIG_ERR)
+	
+	/* How sigprocmask() changes the signal mask. */
+	#define SIG_BLOCK   0 /* Add signals to the mask.      */
+	#define SIG_UNBLOCK 1 /* Remove signals from the mask. */
+	#define SIG_SETMASK 2 /* Replace the mask.             */
+	
+	/* Signal action flags. */
+	#define SA_RESETHAND 1 /* Reset handler upon delivery.    */
+	#define SA_NODEFER   2 /* Do not block the signal itself. */
 
 #ifndef _ASM_FILE_
 
@@ -62,10 +73,28 @@
 
 	/* Types. */
 	typedef void (*sighandler_t)(int);
+	typedef unsigned sigset_t;
+	
+	/* Signal action. */
+	struct sigaction
+	{
+		sighandler_t sa_handler; /* Signal handler.         */
+		sigset_t sa_mask;        /* Blocked while handling. */
+		int sa_flags;            /* Flags.                  */
+	};
 	
 	/* Function prototypes. */
 	extern sighandler_t signal(int sig, sighandler_t func);
 	extern int kill(pid_t pid, int sig);
+	extern int sigaction(int sig, const struct sigaction *act, struct sigaction *oact);
+	extern int sigprocmask(int how, const sigset_t *set, sigset_t *oset);
+	extern int sigsuspend(const sigset_t *mask);
+	extern int sigpending(sigset_t *set);
+	extern int sigemptyset(sigset_t *set);
+	extern int sigfillset(sigset_t *set);
+	extern int sigaddset(sigset_t *set, int sig);
+	extern int sigdelset(sigset_t *set, int sig);
+	extern int sigismember(const sigset_t *set, int sig);
 
 #endif /* _ASM_FILE_ */
 
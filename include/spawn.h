@@ -0,0 +1,94 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SPAWN_H_
+#define SPAWN_H_
+#ifndef _ASM_FILE_
+
+	#include <sys/types.h>
+
+	/*
+	 * Spawn flags.
+	 */
+	#define POSIX_SPAWN_RESETIDS  0x01 /* Reset effective IDs. */
+	#define POSIX_SPAWN_SETPGROUP 0x02 /* Set process group.   */
+
+	/*
+	 * File action types.
+	 */
+	#define SPAWN_OPEN  0 /* open().  */
+	#define SPAWN_CLOSE 1 /* close(). */
+	#define SPAWN_DUP2  2 /* dup2().  */
+
+	/*
+	 * Spawn file action.
+	 */
+	struct spawn_action
+	{
+		int type;    /* Action type.          */
+		int fd;      /* Target file.          */
+		int newfd;   /* New file for dup2().  */
+		int oflag;   /* Flags for open().     */
+		mode_t mode; /* Mode for open().      */
+		char *path;  /* Path name for open(). */
+	};
+
+	/*
+	 * Spawn file actions.
+	 */
+	typedef struct
+	{
+		int nactions;                 /* Number of actions. */
+		int maxactions;               /* Room for actions.  */
+		struct spawn_action *actions; /* Actions.           */
+	} posix_spawn_file_actions_t;
+
+	/*
+	 * Spawn attributes.
+	 */
+	typedef struct
+	{
+		short flags;  /* Spawn flags.    */
+		pid_t pgroup; /* Process group.  */
+	} posix_spawnattr_t;
+
+	/* Forward definitions. */
+	extern int posix_spawn(pid_t *, const char *,
+		const posix_spawn_file_actions_t *, const posix_spawnattr_t *,
+		char *const [], char *const []);
+	extern int posix_spawnp(pid_t *, const char *,
+		const posix_spawn_file_actions_t *, const posix_spawnattr_t *,
+		char *const [], char *const []);
+	extern int posix_spawn_file_actions_init(posix_spawn_file_actions_t *);
+	extern int posix_spawn_file_actions_destroy(posix_spawn_file_actions_t *);
+	extern int posix_spawn_file_actions_addopen(posix_spawn_file_actions_t *,
+		int, const char *, int, mode_t);
+	extern int posix_spawn_file_actions_addclose(posix_spawn_file_actions_t *,
+		int);
+	extern int posix_spawn_file_actions_adddup2(posix_spawn_file_actions_t *,
+		int, int);
+	extern int posix_spawnattr_init(posix_spawnattr_t *);
+	extern int posix_spawnattr_destroy(posix_spawnattr_t *);
+	extern int posix_spawnattr_getflags(const posix_spawnattr_t *, short *);
+	extern int posix_spawnattr_setflags(posix_spawnattr_t *, short);
+	extern int posix_spawnattr_getpgroup(const posix_spawnattr_t *, pid_t *);
+	extern int posix_spawnattr_setpgroup(posix_spawnattr_t *, pid_t);
+
+#endif /* _ASM_FILE_ */
+#endif /* SPAWN_H_ */
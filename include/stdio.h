@@ -25,7 +25,7 @@
 	#include <stdarg.h>
 
 	/* Standard buffer size. */
-	#define BUFSIZ 1024
+	#define BUFSIZ 4096
 
 	/* End of file. */
 	#define EOF -1
@@ -45,6 +45,7 @@
 	#define _IOERROR  00400 /* Error encountered?            */
 	#define _IOMYBUF  01000 /* Library buffer?               */
 	#define _IOSYNC   02000 /* Sync file position on append? */
+	#define _IOAUTO   04000 /* Buffering not picked yet?     */
 
 	/*
 	 * File stream.
@@ -123,6 +124,16 @@
 	 */
 	extern int fputs(const char *str, FILE *stream);
 	
+	/*
+	 * Reads an array from a file.
+	 */
+	extern size_t fread(void *ptr, size_t size, size_t nmemb, FILE *stream);
+	
+	/*
+	 * Writes an array to a file.
+	 */
+	extern size_t fwrite(const void *ptr, size_t size, size_t nmemb, FILE *stream);
+	
 	/* Forward definitions. */
 	extern FILE *fopen(const char *, const char *);
 	extern FILE *freopen(const char *filename, const char *mode, FILE *stream);
@@ -143,6 +154,11 @@
 	 */
 	extern int puts(const char *str);
 	
+	/*
+	 * Renames a file.
+	 */
+	extern int rename(const char *old, const char *new);
+	
 	/*
 	 * Writes a formated string to the standard output file.
 	 */
@@ -0,0 +1,49 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYS_BOOTLOG_H_
+#define SYS_BOOTLOG_H_
+
+	/**
+	 * @name bootlog ioctl() Commands
+	 */
+	/**@{*/
+	#define BOOTLOG_GETRATE 0x4d100000 /**< Get time stamps per tick. */
+	/**@}*/
+	
+	/**
+	 * @brief Maximum length of a boot phase name.
+	 */
+	#define BOOTLOG_NAME_MAX 24
+
+#ifndef _ASM_FILE_
+
+	#include <stdint.h>
+
+	/**
+	 * @brief Boot timeline mark.
+	 */
+	struct bootmark
+	{
+		uint64_t stamp;              /**< Time stamp.             */
+		char name[BOOTLOG_NAME_MAX]; /**< Phase that starts here. */
+	};
+
+#endif /* _ASM_FILE_ */
+#endif /* SYS_BOOTLOG_H_ */
@@ -0,0 +1,55 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CACHESTAT_H_
+#define CACHESTAT_H_
+#ifndef _ASM_FILE_
+
+	/**
+	 * @brief Kernel caches.
+	 */
+	/**@{*/
+	#define CACHE_BUFFER 0 /**< Block buffer cache. */
+	#define CACHE_INODE  1 /**< Inode cache.        */
+	#define CACHE_PAGE   2 /**< File page faults.   */
+	#define CACHE_DROP   3 /**< Drop caches.        */
+	#define CACHE_FILE   4 /**< File page cache.    */
+	#define CACHE_BLOCK2 5 /**< RAM disk cache.     */
+	/**@}*/
+
+	/**
+	 * @brief Kernel cache statistics.
+	 */
+	struct cachestat
+	{
+		unsigned size;       /**< Number of slots.                   */
+		unsigned used;       /**< Number of slots in use.            */
+		unsigned dirty;      /**< Number of dirty slots.             */
+		unsigned hits;       /**< Lookups found in the cache.        */
+		unsigned misses;     /**< Lookups not found in the cache.    */
+		unsigned evictions;  /**< Slots reused for another object.   */
+		unsigned writebacks; /**< Slots written back to disk.        */
+		unsigned waits;      /**< Sleeps waiting for a locked slot.  */
+	};
+	
+	/* Forward definitions. */
+	extern int cachestat(int, struct cachestat *);
+
+#endif /* _ASM_FILE_ */
+#endif /* CACHESTAT_H_ */
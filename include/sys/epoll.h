@@ -0,0 +1,78 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EPOLL_H_
+#define EPOLL_H_
+
+	#include <poll.h>
+
+	/**
+	 * @name Event poll events
+	 */
+	/**@{*/
+	#define EPOLLIN      POLLIN      /**< Data may be read.     */
+	#define EPOLLPRI     POLLPRI     /**< Priority data.        */
+	#define EPOLLOUT     POLLOUT     /**< Data may be written.  */
+	#define EPOLLERR     POLLERR     /**< Error condition.      */
+	#define EPOLLHUP     POLLHUP     /**< Hung up.              */
+	#define EPOLLONESHOT 0x40000000u /**< Report once.          */
+	#define EPOLLET      0x80000000u /**< Edge-triggered.       */
+	/**@}*/
+
+	/**
+	 * @name Event poll control operations
+	 */
+	/**@{*/
+	#define EPOLL_CTL_ADD 1 /**< Add a file descriptor.       */
+	#define EPOLL_CTL_DEL 2 /**< Remove a file descriptor.    */
+	#define EPOLL_CTL_MOD 3 /**< Change watched events.       */
+	/**@}*/
+
+#ifndef _ASM_FILE_
+
+	#include <stdint.h>
+
+	/**
+	 * @brief User data of an event.
+	 */
+	typedef union epoll_data
+	{
+		void *ptr;    /**< Pointer.         */
+		int fd;       /**< File descriptor. */
+		uint32_t u32; /**< Integer.         */
+	} epoll_data_t;
+
+	/**
+	 * @brief Event.
+	 */
+	struct epoll_event
+	{
+		uint32_t events;   /**< Events.    */
+		epoll_data_t data; /**< User data. */
+	};
+
+	/* Forward definitions. */
+	extern int epoll_create(int);
+	extern int epoll_ctl(int, int, int, struct epoll_event *);
+	extern int epoll_wait(int, struct epoll_event *, int, int);
+	extern int epoll_close(int);
+
+#endif /* _ASM_FILE_ */
+
+#endif /* EPOLL_H_ */
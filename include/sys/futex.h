@@ -0,0 +1,61 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FUTEX_H_
+#define FUTEX_H_
+
+	/* Futex operations. */
+	#define FUTEX_WAIT 0 /* Sleep if the futex holds a value. */
+	#define FUTEX_WAKE 1 /* Wake up sleeping processes.       */
+
+#ifndef _ASM_FILE_
+
+	/*
+	 * Mutex.
+	 */
+	typedef struct
+	{
+		volatile int state; /* 0 unlocked, 1 locked, 2 contended. */
+	} mutex_t;
+	
+	/*
+	 * Condition variable.
+	 */
+	typedef struct
+	{
+		volatile int seq; /* Signal counter. */
+	} cond_t;
+	
+	/* Static initializers. */
+	#define MUTEX_INITIALIZER { 0 }
+	#define COND_INITIALIZER  { 0 }
+
+	/* Forward definitions. */
+	extern int futex(int *, int, int);
+	extern void mutex_init(mutex_t *);
+	extern void mutex_lock(mutex_t *);
+	extern int mutex_trylock(mutex_t *);
+	extern void mutex_unlock(mutex_t *);
+	extern void cond_init(cond_t *);
+	extern void cond_wait(cond_t *, mutex_t *);
+	extern void cond_signal(cond_t *);
+	extern void cond_broadcast(cond_t *);
+
+#endif /* _ASM_FILE_ */
+#endif /* FUTEX_H_ */
@@ -0,0 +1,63 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYS_GMON_H_
+#define SYS_GMON_H_
+#ifndef _ASM_FILE_
+
+	#include <stdint.h>
+
+	/**
+	 * @brief Profile written out by _mcleanup().
+	 */
+	#define GMON_OUT "gmon.out"
+	
+	/**
+	 * @brief Profile file magic number.
+	 */
+	#define GMON_MAGIC 0x6e6f6d67
+	
+	/**
+	 * @brief Bytes of text per histogram byte.
+	 */
+	#define HISTFRACTION 2
+	
+	/**
+	 * @brief Profile file header.
+	 * 
+	 * @details The header is followed by the histogram, as an array of
+	 *          #ncnt unsigned shorts filled in by profil().
+	 */
+	struct gmonhdr
+	{
+		uint32_t magic;  /**< #GMON_MAGIC.                */
+		uint32_t lowpc;  /**< Lowest profiled address.    */
+		uint32_t highpc; /**< Highest profiled address.   */
+		uint32_t ncnt;   /**< Histogram buckets.          */
+		uint32_t scale;  /**< Scale passed to profil().   */
+		uint32_t rate;   /**< Samples per second.         */
+	};
+
+	/* Forward definitions. */
+	extern void monstartup(unsigned long, unsigned long);
+	extern void moncontrol(int);
+	extern void _mcleanup(void);
+
+#endif /* _ASM_FILE_ */
+#endif /* SYS_GMON_H_ */
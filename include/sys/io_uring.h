@@ -0,0 +1,126 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file sys/io_uring.h
+ * 
+ * @brief Asynchronous I/O rings.
+ */
+
+#ifndef IO_URING_H_
+#define IO_URING_H_
+
+	/**
+	 * @brief Maximum number of submission queue entries.
+	 */
+	#define IORING_ENTRIES_MAX 32
+
+	/**
+	 * @name Operations
+	 */
+	/**@{*/
+	#define IORING_OP_NOP   0 /**< No operation.         */
+	#define IORING_OP_READ  1 /**< Read from a file.     */
+	#define IORING_OP_WRITE 2 /**< Write to a file.      */
+	#define IORING_OP_FSYNC 3 /**< Synchronize a file.   */
+	/**@}*/
+
+	/**
+	 * @brief Synchronize file data only.
+	 */
+	#define IORING_FSYNC_DATASYNC 1
+
+#ifndef _ASM_FILE_
+
+	#include <sys/types.h>
+	#include <stdint.h>
+
+	/**
+	 * @brief Submission queue entry.
+	 */
+	struct io_uring_sqe
+	{
+		uint8_t opcode;     /**< Operation.              */
+		uint8_t flags;      /**< Unused, must be zero.   */
+		uint16_t ioprio;    /**< Unused, must be zero.   */
+		int32_t fd;         /**< File descriptor.        */
+		off_t off;          /**< File offset.            */
+		void *addr;         /**< Buffer.                 */
+		uint32_t len;       /**< Buffer length.          */
+		uint32_t op_flags;  /**< Operation flags.        */
+		uint64_t user_data; /**< Completion tag.         */
+	};
+
+	/**
+	 * @brief Completion queue entry.
+	 */
+	struct io_uring_cqe
+	{
+		uint64_t user_data; /**< Completion tag of the request.   */
+		int32_t res;        /**< Result, or negative error code.  */
+		uint32_t flags;     /**< Unused.                          */
+	};
+
+	/**
+	 * @brief Ring shared by the kernel and the process.
+	 * 
+	 * @details The process fills submission queue entries at sq_tail and
+	 *          takes completion queue entries at cq_head. The kernel advances
+	 *          sq_head and cq_tail. Counters run freely, and they are masked
+	 *          to index the queues.
+	 */
+	struct io_uring_ring
+	{
+		uint32_t sq_head;     /**< First pending submission.        */
+		uint32_t sq_tail;     /**< Next free submission.            */
+		uint32_t sq_mask;     /**< Mask of submission indexes.      */
+		uint32_t sq_entries;  /**< Number of submission entries.    */
+		uint32_t cq_head;     /**< First unread completion.         */
+		uint32_t cq_tail;     /**< Next free completion.            */
+		uint32_t cq_mask;     /**< Mask of completion indexes.      */
+		uint32_t cq_entries;  /**< Number of completion entries.    */
+		uint32_t cq_overflow; /**< Completions that were dropped.   */
+		uint32_t unused[7];   /**< Unused.                          */
+		
+		struct io_uring_sqe sqes[IORING_ENTRIES_MAX];   /**< Submission queue. */
+		struct io_uring_cqe cqes[2*IORING_ENTRIES_MAX]; /**< Completion queue. */
+	};
+
+	/**
+	 * @brief Ring setup parameters.
+	 */
+	struct io_uring_params
+	{
+		uint32_t sq_entries;        /**< Number of submission entries. */
+		uint32_t cq_entries;        /**< Number of completion entries. */
+		struct io_uring_ring *ring; /**< Where the ring is mapped.      */
+	};
+
+	/* Forward definitions. */
+	extern int io_uring_setup(unsigned, struct io_uring_params *);
+	extern int io_uring_enter(int, unsigned, unsigned);
+	extern int io_uring_close(int);
+	extern struct io_uring_sqe *io_uring_get_sqe(struct io_uring_ring *);
+	extern void io_uring_push_sqe(struct io_uring_ring *);
+	extern struct io_uring_cqe *io_uring_peek_cqe(struct io_uring_ring *);
+	extern void io_uring_cqe_seen(struct io_uring_ring *);
+
+#endif /* _ASM_FILE_ */
+
+#endif /* IO_URING_H_ */
@@ -0,0 +1,46 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IOPRIO_H_
+#define IOPRIO_H_
+
+	#include <sys/types.h>
+
+	/**
+	 * @brief I/O scheduling classes.
+	 * 
+	 * @details Disk requests are served in proportion to the weight of
+	 *          their class, and lower classes have larger weights.
+	 */
+	/**@{*/
+	#define IOPRIO_CLASS_RT   0 /**< Real-time.            */
+	#define IOPRIO_CLASS_BE   1 /**< Best-effort.          */
+	#define IOPRIO_CLASS_IDLE 2 /**< Idle.                 */
+	#define IOPRIO_CLASSES    3 /**< Number of classes.    */
+	/**@}*/
+
+#ifndef _ASM_FILE_
+
+	/*
+	 * Sets the I/O scheduling class of a process.
+	 */
+	extern int ioprio_set(pid_t pid, int ioclass);
+
+#endif /* _ASM_FILE_ */
+#endif /* IOPRIO_H_ */
@@ -0,0 +1,56 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IOSTAT_H_
+#define IOSTAT_H_
+#ifndef _ASM_FILE_
+
+	#include <sys/types.h>
+
+	/**
+	 * @brief Block device I/O statistics.
+	 * 
+	 * @details Average queue depth is given by depth/requests, average
+	 *          seek distance by seek/commands, and average latency by
+	 *          wait/(reads + writes + flushes). Times are in clock ticks.
+	 */
+	struct iostat
+	{
+		unsigned requests; /**< Requests issued to the device.           */
+		unsigned commands; /**< Commands sent to the device.             */
+		unsigned depth;    /**< Sum of queue depths seen by requests.    */
+		unsigned seek;     /**< Sum of seek distances (in blocks).       */
+		unsigned expired;  /**< Requests served out of order (deadline). */
+		unsigned queued;   /**< Requests currently in the queue.         */
+		unsigned reads;    /**< Read requests completed.                 */
+		unsigned writes;   /**< Write requests completed.                */
+		unsigned flushes;  /**< Write barriers completed.                */
+		unsigned rsectors; /**< Sectors read.                            */
+		unsigned wsectors; /**< Sectors written.                         */
+		unsigned merges;   /**< Requests merged into another command.    */
+		unsigned inflight; /**< Requests currently served by the device. */
+		unsigned busy;     /**< Time with requests in flight.            */
+		unsigned wait;     /**< Sum of request latencies.                */
+	};
+	
+	/* Forward definitions. */
+	extern int iostat(dev_t, struct iostat *);
+
+#endif /* _ASM_FILE_ */
+#endif /* IOSTAT_H_ */
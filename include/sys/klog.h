@@ -0,0 +1,31 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYS_KLOG_H_
+#define SYS_KLOG_H_
+
+	/**
+	 * @name klog ioctl() Commands
+	 */
+	/**@{*/
+	#define KLOG_SETLEVEL 0x4d100000 /**< Set log level (0 to 7). */
+	#define KLOG_GETLEVEL 0x4d200000 /**< Get log level.          */
+	/**@}*/
+
+#endif /* SYS_KLOG_H_ */
@@ -0,0 +1,57 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYS_KPROF_H_
+#define SYS_KPROF_H_
+
+	/**
+	 * @name kprof ioctl() Commands
+	 */
+	/**@{*/
+	#define KPROF_START   0x4c100000 /**< Start sampling.             */
+	#define KPROF_STOP    0x4c200000 /**< Stop sampling.              */
+	#define KPROF_GETLOST 0x4c300000 /**< Get number of samples lost. */
+	/**@}*/
+	
+	/**
+	 * @brief Highest sampling rate, in samples per clock tick.
+	 */
+	#define KPROF_RATE_MAX 100
+	
+	/**
+	 * @brief Sample taken in user mode.
+	 */
+	#define KPROF_USER 1
+
+#ifndef _ASM_FILE_
+
+	#include <stdint.h>
+
+	/**
+	 * @brief Profiler sample.
+	 */
+	struct kprof_sample
+	{
+		uint32_t eip;  /**< Interrupted instruction. */
+		uint16_t pid;  /**< Interrupted process ID.  */
+		uint16_t mode; /**< Sample flags.            */
+	};
+
+#endif /* _ASM_FILE_ */
+#endif /* SYS_KPROF_H_ */
@@ -0,0 +1,91 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYS_KTRACE_H_
+#define SYS_KTRACE_H_
+
+	/**
+	 * @name Trace Events
+	 */
+	/**@{*/
+	#define KTRACE_SWITCH    1 /**< Context switch (from, to).        */
+	#define KTRACE_IRQ       2 /**< Hardware interrupt (irq).         */
+	#define KTRACE_WAKEUP    3 /**< Process wakeup (pid, reason).     */
+	#define KTRACE_SLEEP     4 /**< Process sleep (chain, priority).  */
+	#define KTRACE_VFAULT    5 /**< Page fault (addr, write).         */
+	#define KTRACE_PFAULT    6 /**< Protection fault (addr).          */
+	#define KTRACE_BHIT      7 /**< Block cache hit (dev, num).       */
+	#define KTRACE_BMISS     8 /**< Block cache miss (dev, num).      */
+	#define KTRACE_BEVICT    9 /**< Block cache eviction (dev, num).  */
+	#define KTRACE_ATAQ     10 /**< ATA request queued (dev, lba).    */
+	#define KTRACE_ATADONE  11 /**< ATA request done (dev, lba).      */
+	#define KTRACE_SYSENTER 12 /**< System call entry (nr).           */
+	#define KTRACE_SYSEXIT  13 /**< System call exit (nr, ret).       */
+	#define KTRACE_USER     15 /**< User marker (two words).          */
+	#define KTRACE_EVENTS   16 /**< Number of event IDs.              */
+	/**@}*/
+	
+	/**
+	 * @name Trace Categories
+	 */
+	/**@{*/
+	#define KTRACE_SCHED \
+		((1 << KTRACE_SWITCH) | (1 << KTRACE_WAKEUP) | (1 << KTRACE_SLEEP))
+	#define KTRACE_MM \
+		((1 << KTRACE_VFAULT) | (1 << KTRACE_PFAULT))
+	#define KTRACE_BUF \
+		((1 << KTRACE_BHIT) | (1 << KTRACE_BMISS) | (1 << KTRACE_BEVICT))
+	#define KTRACE_ATA \
+		((1 << KTRACE_ATAQ) | (1 << KTRACE_ATADONE))
+	#define KTRACE_SYS \
+		((1 << KTRACE_SYSENTER) | (1 << KTRACE_SYSEXIT))
+	/**@}*/
+	
+	/**
+	 * @brief Event mask with all events on.
+	 */
+	#define KTRACE_ALL ((1 << KTRACE_EVENTS) - 1)
+	
+	/**
+	 * @name ktrace ioctl() Commands
+	 */
+	/**@{*/
+	#define KTRACE_SETMASK 0x4b100000 /**< Set event mask.                  */
+	#define KTRACE_GETRATE 0x4b200000 /**< Get TSC counts per clock tick.   */
+	#define KTRACE_GETLOST 0x4b300000 /**< Get number of records lost.      */
+	/**@}*/
+
+#ifndef _ASM_FILE_
+
+	#include <stdint.h>
+
+	/**
+	 * @brief Trace record.
+	 */
+	struct ktrace_record
+	{
+		uint64_t tsc;     /**< Time stamp counter.       */
+		uint32_t seq;     /**< Sequence number.          */
+		uint16_t id;      /**< Event ID.                 */
+		uint16_t pid;     /**< Current process ID.       */
+		uint32_t args[4]; /**< Event arguments.          */
+	};
+
+#endif /* _ASM_FILE_ */
+#endif /* SYS_KTRACE_H_ */
@@ -0,0 +1,70 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LOCKSTAT_H_
+#define LOCKSTAT_H_
+#ifndef _ASM_FILE_
+
+	/**
+	 * @brief Kernel lock classes.
+	 */
+	/**@{*/
+	#define LOCK_BUFFER     0 /**< Block buffer locks.  */
+	#define LOCK_INODE      1 /**< Inode locks.         */
+	#define LOCK_SUPERBLOCK 2 /**< Superblock locks.    */
+	#define LOCK_REGION     3 /**< Memory region locks. */
+	#define LOCK_CLASSES    4 /**< Number of classes.   */
+	/**@}*/
+	
+	/**
+	 * @brief Number of hottest locks reported.
+	 */
+	#define LOCKSTAT_HOT 8
+	
+	/**
+	 * @brief Contended lock.
+	 * 
+	 * @details Buffers are named by device and block number, inodes by
+	 *          device and inode number, superblocks by device and regions
+	 *          by their slot in the region table.
+	 */
+	struct lockhot
+	{
+		unsigned dev;   /**< Device.                      */
+		unsigned num;   /**< Object number.               */
+		unsigned waits; /**< Sleeps waiting for the lock. */
+	};
+	
+	/**
+	 * @brief Kernel lock statistics.
+	 */
+	struct lockstat
+	{
+		unsigned acquires;                /**< Locks taken.                */
+		unsigned waits;                   /**< Sleeps waiting for a lock.  */
+		unsigned boosts;                  /**< Owners boosted by waiters.  */
+		unsigned nhot;                    /**< Hot locks reported.         */
+		struct lockhot hot[LOCKSTAT_HOT]; /**< Most waited for locks.      */
+	};
+	
+	/* Forward definitions. */
+	extern int lockstat(int, struct lockstat *);
+
+#endif /* _ASM_FILE_ */
+#endif /* LOCKSTAT_H_ */
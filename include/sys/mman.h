@@ -0,0 +1,59 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MMAN_H_
+#define MMAN_H_
+
+	/* Protection options. */
+	#define PROT_NONE  0 /* Page cannot be accessed. */
+	#define PROT_READ  1 /* Page can be read.        */
+	#define PROT_WRITE 2 /* Page can be written.     */
+	#define PROT_EXEC  4 /* Page can be executed.    */
+	
+	/* Mapping flags. */
+	#define MAP_SHARED  1 /* Changes are shared.  */
+	#define MAP_PRIVATE 2 /* Changes are private. */
+	
+	/* Failed mapping. */
+	#define MAP_FAILED ((void *) -1)
+	
+	/* Memory advice. */
+	#define MADV_NORMAL   0 /* No special treatment.    */
+	#define MADV_WILLNEED 3 /* Pages will be needed.    */
+	#define MADV_DONTNEED 4 /* Pages may be released.   */
+	
+	/* Memory locking flags. */
+	#define MCL_CURRENT 1 /* Lock current mappings. */
+	#define MCL_FUTURE  2 /* Lock future mappings.  */
+
+#ifndef _ASM_FILE_
+
+	#include <sys/types.h>
+	
+	/* Forward definitions. */
+	extern void *mmap(void *, size_t, int, int, int, off_t);
+	extern int munmap(void *, size_t);
+	extern int madvise(void *, size_t, int);
+	extern int mlock(const void *, size_t);
+	extern int munlock(const void *, size_t);
+	extern int mlockall(int);
+	extern int munlockall(void);
+
+#endif /* _ASM_FILE_ */
+#endif /* MMAN_H_ */
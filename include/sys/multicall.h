@@ -0,0 +1,58 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file sys/multicall.h
+ * 
+ * @brief Batched system calls.
+ */
+
+#ifndef MULTICALL_H_
+#define MULTICALL_H_
+
+	/**
+	 * @brief Maximum number of system calls in a batch.
+	 */
+	#define MULTICALL_MAX 32
+
+	/**
+	 * @brief Stop at the first system call that fails.
+	 */
+	#define MULTICALL_STOP 1
+
+#ifndef _ASM_FILE_
+
+	#include <stdint.h>
+
+	/**
+	 * @brief System call descriptor.
+	 */
+	struct multicall
+	{
+		int nr;           /**< System call number.              */
+		uint32_t args[5]; /**< Arguments.                       */
+		int ret;          /**< Return value, or negative error. */
+	};
+
+	/* Forward definitions. */
+	extern int multicall(struct multicall *, unsigned, int);
+
+#endif /* _ASM_FILE_ */
+
+#endif /* MULTICALL_H_ */
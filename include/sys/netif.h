@@ -0,0 +1,76 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYS_NETIF_H_
+#define SYS_NETIF_H_
+
+	/**
+	 * @name Network Interface ioctl() Commands
+	 */
+	/**@{*/
+	#define NETIF_GETMAC  0x4e100000 /**< Get hardware address.   */
+	#define NETIF_GETSTAT 0x4e200000 /**< Get interface counters. */
+	#define NETIF_GETADDR 0x4e300000 /**< Get protocol addresses. */
+	#define NETIF_SETADDR 0x4e400000 /**< Set protocol addresses. */
+	#define NETIF_SETRAW  0x4e500000 /**< Take frames from stack. */
+	/**@}*/
+	
+	/**
+	 * @name Ethernet Frame Limits
+	 */
+	/**@{*/
+	#define ETH_ALEN      6    /**< Hardware address length. */
+	#define ETH_HLEN      14   /**< Frame header length.     */
+	#define ETH_FRAME_MAX 1514 /**< Largest frame, no FCS.   */
+	/**@}*/
+
+#ifndef _ASM_FILE_
+
+	#include <stdint.h>
+
+	/**
+	 * @brief Network interface counters.
+	 */
+	struct netif_stat
+	{
+		uint32_t rx_frames; /**< Frames received.            */
+		uint32_t rx_bytes;  /**< Bytes received.             */
+		uint32_t rx_trunc;  /**< Frames truncated on read(). */
+		uint32_t tx_frames; /**< Frames sent.                */
+		uint32_t tx_bytes;  /**< Bytes sent.                 */
+		uint32_t kicks;     /**< Device notifications.       */
+		uint32_t irqs;      /**< Interrupts taken.           */
+		uint32_t rx_drop;   /**< Frames dropped by the stack. */
+	};
+	
+	/**
+	 * @brief Protocol addresses of a network interface.
+	 * 
+	 * @details Addresses are in network byte order. A zero gateway means
+	 *          that only the local network is reachable.
+	 */
+	struct netif_addr
+	{
+		uint32_t addr;    /**< Interface address. */
+		uint32_t netmask; /**< Network mask.      */
+		uint32_t gateway; /**< Default gateway.   */
+	};
+
+#endif /* _ASM_FILE_ */
+#endif /* SYS_NETIF_H_ */
@@ -0,0 +1,54 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYS_PMC_H_
+#define SYS_PMC_H_
+
+	/*
+	 * Architectural performance events (event select and unit mask).
+	 * Other events are model specific and may be given raw.
+	 */
+	#define PMC_CYCLES        0x003c /* Unhalted core cycles.        */
+	#define PMC_INSTRUCTIONS  0x00c0 /* Instructions retired.        */
+	#define PMC_LLC_REFS      0x4f2e /* Last level cache references. */
+	#define PMC_LLC_MISSES    0x412e /* Last level cache misses.     */
+	#define PMC_BRANCHES      0x00c4 /* Branches retired.            */
+	#define PMC_BRANCH_MISSES 0x00c5 /* Branches mispredicted.       */
+	
+	/* Model specific events. */
+	#define PMC_DTLB_MISSES 0x0108 /* Data TLB load misses (Core 2 and later). */
+	
+	/* Privilege levels to count in (both if none given). */
+	#define PMC_USR (1 << 16) /* User mode.   */
+	#define PMC_OS  (1 << 17) /* Kernel mode. */
+	
+	/* Counters per process. */
+	#define PMC_MAX 4
+
+#ifndef _ASM_FILE_
+
+	#include <stdint.h>
+
+	/* Forward definitions. */
+	extern int pmc_open(unsigned, unsigned);
+	extern int pmc_read(int, uint64_t *);
+	extern int pmc_close(int);
+
+#endif /* _ASM_FILE_ */
+#endif /* SYS_PMC_H_ */
@@ -0,0 +1,109 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROCSTAT_H_
+#define PROCSTAT_H_
+
+	#include <limits.h>
+
+	/**
+	 * @brief Current version of the process snapshot interface.
+	 */
+	#define PROCSTAT_VERSION 1
+	
+	/**
+	 * @name Process States
+	 */
+	/**@{*/
+	#define PROCSTAT_ZOMBIE   1 /**< Zombie.                    */
+	#define PROCSTAT_RUNNING  2 /**< Running.                   */
+	#define PROCSTAT_READY    3 /**< Ready to execute.          */
+	#define PROCSTAT_WAITING  4 /**< Waiting (interruptible).   */
+	#define PROCSTAT_SLEEPING 5 /**< Waiting (uninterruptible). */
+	#define PROCSTAT_STOPPED  6 /**< Stopped.                   */
+	/**@}*/
+	
+	/**
+	 * @brief State mask for a process state.
+	 */
+	#define PROCSTAT_STATE(s) (1 << (s))
+	
+	/**
+	 * @name Snapshot Flags
+	 */
+	/**@{*/
+	#define PROCSTAT_RSS 1 /**< Count resident pages. */
+	/**@}*/
+	
+	/**
+	 * @brief Maximum number of process IDs in a filter.
+	 */
+	#define PROCSTAT_PIDS 16
+
+#ifndef _ASM_FILE_
+
+	#include <sys/types.h>
+
+	/**
+	 * @brief Process snapshot filter.
+	 * 
+	 * @details A zero state mask or pid count matches any process.
+	 */
+	struct procfilter
+	{
+		unsigned states;            /**< Mask of states to match.  */
+		unsigned flags;             /**< Snapshot flags.           */
+		unsigned npids;             /**< Number of process IDs.    */
+		pid_t pids[PROCSTAT_PIDS];  /**< Process IDs to match.     */
+	};
+
+	/**
+	 * @brief Process snapshot record.
+	 * 
+	 * @details Times are given in clock ticks and memory in pages. The
+	 *          resident set size is only filled in with PROCSTAT_RSS,
+	 *          because counting it walks the page tables of the process.
+	 */
+	struct procstat
+	{
+		pid_t pid;            /**< Process ID.                 */
+		pid_t ppid;           /**< Parent process ID.          */
+		uid_t uid;            /**< User ID.                    */
+		int state;            /**< Process state.              */
+		int priority;         /**< Priority.                   */
+		int nice;             /**< Nice value.                 */
+		unsigned utime;       /**< User CPU time.              */
+		unsigned ktime;       /**< Kernel CPU time.            */
+		unsigned rss;         /**< Resident pages.             */
+		unsigned maxrss;      /**< Peak resident pages.        */
+		unsigned minflt;      /**< Minor page faults.          */
+		unsigned majflt;      /**< Major page faults.          */
+		unsigned nvcsw;       /**< Voluntary context switches. */
+		unsigned nivcsw;      /**< Involuntary switches.       */
+		unsigned inblock;     /**< Blocks read.                */
+		unsigned oublock;     /**< Blocks written.             */
+		unsigned nsyscall;    /**< System calls.               */
+		char name[NAME_MAX];  /**< Process name.               */
+	};
+	
+	/* Forward definitions. */
+	extern int procstat(int, const struct procfilter *, struct procstat *, unsigned);
+
+#endif /* _ASM_FILE_ */
+#endif /* PROCSTAT_H_ */
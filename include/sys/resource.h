@@ -0,0 +1,55 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYS_RESOURCE_H_
+#define SYS_RESOURCE_H_
+#ifndef _ASM_FILE_
+
+	#include <sys/types.h>
+	#include <sys/select.h>
+
+	/**
+	 * @name Targets of getrusage()
+	 */
+	/**@{*/
+	#define RUSAGE_SELF      0 /**< Calling process.                */
+	#define RUSAGE_CHILDREN -1 /**< Terminated and waited children. */
+	/**@}*/
+
+	/**
+	 * @brief Resource usage.
+	 */
+	struct rusage
+	{
+		struct timeval ru_utime; /**< User CPU time.                */
+		struct timeval ru_stime; /**< System CPU time.              */
+		long ru_maxrss;          /**< Peak resident set (in KB).    */
+		long ru_minflt;          /**< Minor page faults.            */
+		long ru_majflt;          /**< Major page faults.            */
+		long ru_inblock;         /**< Blocks read.                  */
+		long ru_oublock;         /**< Blocks written.               */
+		long ru_nvcsw;           /**< Voluntary context switches.   */
+		long ru_nivcsw;          /**< Involuntary context switches. */
+		long ru_nsyscall;        /**< System calls made.            */
+	};
+	
+	extern int getrusage(int who, struct rusage *r_usage);
+
+#endif /* _ASM_FILE_ */
+#endif /* SYS_RESOURCE_H_ */
@@ -0,0 +1,75 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SELECT_H_
+#define SELECT_H_
+
+#ifndef _ASM_FILE_
+
+	#include <sys/types.h>
+	#include <limits.h>
+	#include <stdint.h>
+	#include <time.h>
+
+	/**
+	 * @brief Maximum number of file descriptors in a set.
+	 */
+	#define FD_SETSIZE OPEN_MAX
+
+	/**
+	 * @brief File descriptor set.
+	 */
+	typedef struct
+	{
+		uint32_t fds_bits[(FD_SETSIZE + 31)/32]; /**< Bitmap. */
+	} fd_set;
+
+	/**
+	 * @brief Time interval.
+	 */
+	struct timeval
+	{
+		time_t tv_sec; /**< Seconds.      */
+		long tv_usec;  /**< Microseconds. */
+	};
+
+	/**
+	 * @name File descriptor set operations
+	 */
+	/**@{*/
+	#define FD_ZERO(set)                                     \
+		do {                                                 \
+			int fd_;                                         \
+			for (fd_ = 0; fd_ < (FD_SETSIZE + 31)/32; fd_++) \
+				(set)->fds_bits[fd_] = 0;                    \
+		} while (0)
+	#define FD_SET(fd, set) \
+		((set)->fds_bits[(fd)/32] |= (1u << ((fd)%32)))
+	#define FD_CLR(fd, set) \
+		((set)->fds_bits[(fd)/32] &= ~(1u << ((fd)%32)))
+	#define FD_ISSET(fd, set) \
+		((set)->fds_bits[(fd)/32] & (1u << ((fd)%32)))
+	/**@}*/
+
+	/* Forward definitions. */
+	extern int select(int, fd_set *, fd_set *, fd_set *, struct timeval *);
+
+#endif /* _ASM_FILE_ */
+
+#endif /* SELECT_H_ */
@@ -0,0 +1,51 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SHM_H_
+#define SHM_H_
+
+	/**
+	 * @brief Comand values for shared memory segments.
+	 */
+	/**@{*/
+	#define IPC_STAT 2 /**< Gets segment information. */
+	#define IPC_RMID 3 /**< Destroys a segment.      */
+	/**@}*/
+
+#ifndef _ASM_FILE_
+
+	#include <sys/types.h>
+
+	/**
+	 * @brief Shared memory segment information.
+	 */
+	struct shmid_ds
+	{
+		size_t shm_segsz;    /**< Size of segment (in bytes). */
+		unsigned shm_nattch; /**< Number of attachments.      */
+	};
+
+	/* Forward definitions. */
+	extern int shmget(unsigned, size_t);
+	extern void *shmat(int);
+	extern int shmdt(const void *);
+	extern int shmctl(int, int, struct shmid_ds *);
+
+#endif /* _ASM_FILE_ */
+#endif /* SHM_H_ */
@@ -31,12 +31,14 @@
 	#define S_IFDIR  0040000
 	#define S_IFCHR  0020000
 	#define S_IFIFO  0010000
+	#define S_IFSOCK 0140000
 
 	#define S_ISREG(m)	(((m) & S_IFMT) == S_IFREG) /* Regular file?       */
 	#define S_ISDIR(m)	(((m) & S_IFMT) == S_IFDIR) /* Directory?          */
 	#define S_ISCHR(m)	(((m) & S_IFMT) == S_IFCHR) /* Char. special file? */
 	#define S_ISBLK(m)	(((m) & S_IFMT) == S_IFBLK) /* Block special file? */
 	#define S_ISFIFO(m)	(((m) & S_IFMT) == S_IFIFO) /* FIFO special file?  */
+	#define S_ISSOCK(m)	(((m) & S_IFMT) == S_IFSOCK) /* Socket?           */
 
 	/* Mode bits. */
     #ifndef __APPLE__
@@ -87,6 +89,26 @@
 	 * Gets file status.
 	 */
 	extern int stat(const char *path, struct stat *buf);
+	
+	/*
+	 * Gets status of an opened file.
+	 */
+	extern int fstat(int fd, struct stat *buf);
+	
+	/*
+	 * Gets file status relative to a directory.
+	 */
+	extern int fstatat(int fd, const char *path, struct stat *buf, int flag);
+	
+	/*
+	 * Creates a directory.
+	 */
+	extern int mkdir(const char *path, mode_t mode);
+	
+	/*
+	 * Creates a directory relative to a directory.
+	 */
+	extern int mkdirat(int fd, const char *path, mode_t mode);
 
 	/*
 	 * Sets and gets the file mode creation mask.
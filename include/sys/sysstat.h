@@ -0,0 +1,68 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYSSTAT_H_
+#define SYSSTAT_H_
+
+	/**
+	 * @name sysstat() Commands
+	 */
+	/**@{*/
+	#define SYSSTAT_GET   0 /**< Get statistics.   */
+	#define SYSSTAT_ON    1 /**< Start accounting. */
+	#define SYSSTAT_OFF   2 /**< Stop accounting.  */
+	#define SYSSTAT_RESET 3 /**< Clear statistics. */
+	/**@}*/
+	
+	/**
+	 * @brief System calls accounted.
+	 */
+	#define SYSSTAT_CALLS 126
+	
+	/**
+	 * @brief Latency histogram buckets.
+	 */
+	#define SYSSTAT_BUCKETS 32
+
+#ifndef _ASM_FILE_
+
+	#include <sys/types.h>
+	#include <stdint.h>
+
+	/**
+	 * @brief System call statistics.
+	 * 
+	 * @details Latencies are given in TSC counts. Bucket i of a histogram
+	 *          counts calls that took from 2^i up to 2^(i + 1) - 1 counts.
+	 *          Histograms are only kept system-wide.
+	 */
+	struct sysstat
+	{
+		int on;                                        /**< Accounting?      */
+		unsigned rate;                                 /**< Counts per tick. */
+		unsigned count[SYSSTAT_CALLS];                 /**< Calls.           */
+		uint64_t cycles[SYSSTAT_CALLS];                /**< Total latency.   */
+		unsigned hist[SYSSTAT_CALLS][SYSSTAT_BUCKETS]; /**< Histograms.      */
+	};
+	
+	/* Forward definitions. */
+	extern int sysstat(int, pid_t, struct sysstat *);
+
+#endif /* _ASM_FILE_ */
+#endif /* SYSSTAT_H_ */
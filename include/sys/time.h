@@ -0,0 +1,50 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYS_TIME_H_
+#define SYS_TIME_H_
+#ifndef _ASM_FILE_
+
+	#include <sys/types.h>
+	#include <sys/select.h>
+
+	/**
+	 * @name Interval timers
+	 */
+	/**@{*/
+	#define ITIMER_REAL    0 /**< Real time, delivers SIGALRM.            */
+	#define ITIMER_VIRTUAL 1 /**< User time, delivers SIGVTALRM.          */
+	#define ITIMER_PROF    2 /**< User and kernel time, delivers SIGPROF. */
+	/**@}*/
+
+	/**
+	 * @brief Interval timer value.
+	 */
+	struct itimerval
+	{
+		struct timeval it_interval; /**< Reload value.  */
+		struct timeval it_value;    /**< Current value. */
+	};
+
+	/* Forward definitions. */
+	extern int getitimer(int, struct itimerval *);
+	extern int setitimer(int, const struct itimerval *, struct itimerval *);
+
+#endif /* _ASM_FILE_ */
+#endif /* SYS_TIME_H_ */
@@ -66,6 +66,9 @@
 	/* Used for user IDs. */
 	typedef int uid_t;
 	
+	/* Used for time in microseconds. */
+	typedef unsigned useconds_t;
+	
 #endif /* _ASM_FILE */
 
 #endif /* TYPES_H_ */
@@ -0,0 +1,40 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UIO_H_
+#define UIO_H_
+#ifndef _ASM_FILE_
+
+	#include <sys/types.h>
+
+	/**
+	 * @brief I/O vector.
+	 */
+	struct iovec
+	{
+		void *iov_base; /**< Base address of the buffer. */
+		size_t iov_len; /**< Size of the buffer.         */
+	};
+	
+	/* Forward definitions. */
+	extern ssize_t readv(int, const struct iovec *, int);
+	extern ssize_t writev(int, const struct iovec *, int);
+
+#endif /* _ASM_FILE_ */
+#endif /* UIO_H_ */
@@ -0,0 +1,43 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UN_H_
+#define UN_H_
+
+	#include <sys/socket.h>
+
+	/**
+	 * @brief Maximum length of a socket path name.
+	 */
+	#define UNIX_PATH_MAX 108
+
+#ifndef _ASM_FILE_
+
+	/**
+	 * @brief UNIX domain socket address.
+	 */
+	struct sockaddr_un
+	{
+		sa_family_t sun_family;       /**< AF_UNIX.   */
+		char sun_path[UNIX_PATH_MAX]; /**< Path name. */
+	};
+
+#endif /* _ASM_FILE_ */
+
+#endif /* UN_H_ */
@@ -0,0 +1,54 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef VMSTAT_H_
+#define VMSTAT_H_
+#ifndef _ASM_FILE_
+
+	/**
+	 * @brief Virtual memory statistics.
+	 */
+	struct vmstat
+	{
+		unsigned frames;   /**< User page frames.             */
+		unsigned free;     /**< Free user page frames.        */
+		unsigned kpages;   /**< Kernel pages.                 */
+		unsigned kfree;    /**< Free kernel pages.            */
+		unsigned regions;  /**< Memory regions in use.        */
+		unsigned swap;     /**< Swap slots.                   */
+		unsigned swapfree; /**< Free swap slots.              */
+		unsigned zswap;    /**< Compressed swap cache pages.  */
+		unsigned zero;     /**< Zero fill page faults.        */
+		unsigned fill;     /**< File page faults.             */
+		unsigned swapins;  /**< Pages swapped in.             */
+		unsigned swapouts; /**< Pages swapped out.            */
+		unsigned cow;      /**< Copy on write page faults.    */
+		unsigned pgtabcow; /**< Page tables copied on write.  */
+		unsigned huge;     /**< Huge pages allocated.         */
+		unsigned split;    /**< Huge pages split.             */
+		unsigned scanned;  /**< Pages scanned for merging.    */
+		unsigned merged;   /**< Identical pages merged.       */
+		unsigned suspended; /**< Processes suspended.         */
+	};
+	
+	/* Forward definitions. */
+	extern int vmstat(struct vmstat *);
+
+#endif /* _ASM_FILE_ */
+#endif /* VMSTAT_H_ */
@@ -24,10 +24,25 @@
 	
 	#define _NEED_WSTATUS
 	#include <decl.h>
+	
+	/* Options for waitpid(). */
+	#define WNOHANG   1 /* Do not block.                */
+	#define WUNTRACED 2 /* Report stopped children too. */
     
     /*
 	 * Waits for a child process to stop or terminate.
 	 */
 	extern pid_t wait(int *stat_loc);
+	
+	/*
+	 * Waits for a specific child process to stop or terminate.
+	 */
+	extern pid_t waitpid(pid_t pid, int *stat_loc, int options);
+	
+	/*
+	 * Waits for a child process and gets its resource usage.
+	 */
+	struct rusage;
+	extern pid_t wait4(pid_t pid, int *stat_loc, int options, struct rusage *r_usage);
 
 #endif /* WAIT_H_ */
@@ -32,15 +32,18 @@
 	#define X_OK 4 /* May execute. */
 	
 	/* Starting positions for lseek() and fcntl(). */
-	#define SEEK_CUR 0 /* Set file offset to current plus offset. */
-	#define SEEK_END 1 /* Set file offset to EOF plus offset.     */
-	#define SEEK_SET 2 /* Set file offset to offset.              */
+	#define SEEK_CUR  0 /* Set file offset to current plus offset. */
+	#define SEEK_END  1 /* Set file offset to EOF plus offset.     */
+	#define SEEK_SET  2 /* Set file offset to offset.              */
+	#define SEEK_DATA 3 /* Set file offset to next data.           */
+	#define SEEK_HOLE 4 /* Set file offset to next hole.           */
 
 	extern unsigned alarm(unsigned seconds);
 	extern void _exit(int status);
 	extern pid_t getpid(void);
 	extern pid_t getpgrp(void);
 	extern int pause(void);
+	extern int usleep(useconds_t);
 	
 	/*
 	 * Checks user permissions for a file.
@@ -164,6 +167,22 @@
 	 */
 	extern int pipe(int fildes[2]);
 	
+	/*
+	 * Starts or stops execution time profiling.
+	 */
+	extern int profil(unsigned short *buf, size_t bufsiz, size_t offset,
+		unsigned scale);
+	
+	/*
+	 * Reads from a file at a given offset.
+	 */
+	extern ssize_t pread(int fd, void *buf, size_t n, off_t off);
+	
+	/*
+	 * Writes to a file at a given offset.
+	 */
+	extern ssize_t pwrite(int fd, const void *buf, size_t n, off_t off);
+	
 	/*
 	 * Reads from a file.
 	 */
@@ -205,11 +224,36 @@
 	 */
 	extern void sync(void);
 	
+	/*
+	 * Synchronizes changes to a file.
+	 */
+	extern int fsync(int fd);
+	
+	/*
+	 * Synchronizes the data of a file.
+	 */
+	extern int fdatasync(int fd);
+	
 	/*
 	 * Removes a directory entry.
 	 */
 	extern int unlink(const char *path);
 	
+	/*
+	 * Removes a directory entry relative to a directory.
+	 */
+	extern int unlinkat(int fd, const char *path, int flag);
+	
+	/*
+	 * Creates a new process and suspends the caller.
+	 */
+	extern pid_t vfork(void);
+
+	/*
+	 * Creates a thread that shares the caller's address space.
+	 */
+	extern pid_t clone(void (*fn)(void), void *stack);
+
 	/*
 	 * Writes to a file.
 	 */
@@ -217,10 +261,13 @@
 	
 	extern int shutdown(void);
 
+	/* Flags for ps(). */
+	#define PS_RUSAGE 1 /* Show resource usage. */
+
 	/*
 	 * Gets process information
 	 */
-	extern int ps(void);
+	extern int ps(int flags);
 
 	/*
 	 * Get system ticks
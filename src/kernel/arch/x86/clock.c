@@ -17,10 +17,16 @@
  * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <nanvix/clock.h>
 #include <nanvix/const.h>
+#include <nanvix/fs.h>
 #include <nanvix/hal.h>
 #include <nanvix/klib.h>
 #include <nanvix/pm.h>
+#include <nanvix/timer.h>
+#include <nanvix/timepage.h>
+#include <dev/kprof.h>
+#include <i386/pmc.h>
 
 /* Clock ticks since system initialization. */
 PUBLIC unsigned ticks = 0;
@@ -28,24 +34,384 @@ PUBLIC unsigned ticks = 0;
 /* Time at system startup. */
 PUBLIC unsigned startup_time = 0;
 
+/* Time page, alone in a page because it is mapped into user space. */
+PRIVATE union
+{
+	struct timepage tp;
+	char page[PAGE_SIZE];
+} timepage __attribute__((aligned(PAGE_SIZE)));
+
+/* PIT counts per clock tick. */
+PRIVATE unsigned freq_divisor = 0;
+
+/* Clock interrupts per tick, more than one while profiling. */
+PRIVATE unsigned prof_rate = 1;
+
+/* Clock interrupts left until the next tick. */
+PRIVATE unsigned prof_left = 1;
+
+#if (CLOCK_TICKLESS)
+
+/* Longest one-shot period (in ticks). */
+#define ONESHOT_MAX (0xffff/freq_divisor)
+
+/* Length of the pending one-shot period (in ticks), zero if periodic. */
+PRIVATE unsigned oneshot = 0;
+
+/* Time spent halted and time since initialization (in clock_cycles()). */
+PRIVATE uint64_t idle_cycles = 0;
+PRIVATE uint64_t start_cycles = 0;
+
+#endif
+
+#if (CLOCK_TSC)
+
+/* Ticks used to calibrate the TSC (must be a power of two). */
+#define TSC_CALIBRATION 16
+
+/* Is the TSC available? */
+PRIVATE int tsc_ok = 0;
+
+/* TSC at the last clock interrupt. */
+PRIVATE uint64_t tsc_last = 0;
+
+/* TSC and tick at calibration start. */
+PRIVATE uint64_t tsc_start = 0;
+PRIVATE unsigned tsc_start_tick = 0;
+
+/* TSC counts per clock tick, zero if not calibrated. */
+PRIVATE unsigned tsc_per_tick = 0;
+
+/*
+ * Reads the time stamp counter.
+ */
+PRIVATE uint64_t rdtsc(void)
+{
+	uint32_t lo, hi;
+	
+	__asm__ volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+	
+	return (((uint64_t)hi << 32) | lo);
+}
+
+/*
+ * Checks if the processor has a time stamp counter.
+ */
+PRIVATE int has_tsc(void)
+{
+	uint32_t eax, ebx, ecx, edx;
+	
+	__asm__ volatile (
+		"cpuid"
+		: "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
+		: "0" (1)
+	);
+	
+	return ((edx >> 4) & 1);
+}
+
+/*
+ * Calibrates the TSC against the clock.
+ */
+PRIVATE void tsc_tick(void)
+{
+	uint64_t delta;
+	
+	tsc_last = rdtsc();
+	
+	/* Already calibrated. */
+	if (tsc_per_tick)
+		return;
+		
+	if (tsc_start == 0)
+	{
+		tsc_start = tsc_last;
+		tsc_start_tick = ticks;
+	}
+	else if (ticks - tsc_start_tick == TSC_CALIBRATION)
+	{
+		delta = (tsc_last - tsc_start)/TSC_CALIBRATION;
+		tsc_per_tick = (delta >> 32) ? 0xffffffff : (unsigned)delta;
+		kprintf("dev: TSC runs at %d counts per clock tick", tsc_per_tick);
+	}
+}
+
+#endif
+
+/*
+ * Publishes the current time in the time page.
+ */
+PRIVATE void timepage_update(void)
+{
+	volatile struct timepage *tp = &timepage.tp;
+	
+	tp->seq++;
+	__asm__ volatile ("" ::: "memory");
+	
+	tp->ticks = ticks;
+	tp->startup_time = startup_time;
+	tp->freq = CLOCK_FREQ;
+#if (CLOCK_TSC)
+	tp->tsc_per_tick = (tsc_ok) ? tsc_per_tick : 0;
+	tp->tsc_last = tsc_last;
+#endif
+	
+	__asm__ volatile ("" ::: "memory");
+	tp->seq++;
+}
+
+/*
+ * Gets the time page that is shared with user space.
+ */
+PUBLIC struct timepage *clock_timepage(void)
+{
+	return (&timepage.tp);
+}
+
+/*
+ * Gets the current time (in ticks).
+ */
+PUBLIC unsigned clock_now(void)
+{
+#if (CLOCK_TSC)
+	uint64_t delta;
+	
+	/*
+	 * Account for ticks that were skipped while
+	 * the clock was in one-shot mode.
+	 */
+	if (tsc_per_tick)
+	{
+		delta = rdtsc() - tsc_last;
+		if (delta >> 32)
+			delta = 0xffffffff;
+		return (ticks + (unsigned)delta/tsc_per_tick);
+	}
+#endif
+
+	return (ticks);
+}
+
+/*
+ * Gets a fine-grained time stamp (in TSC counts, or
+ * in clock ticks if there is no TSC).
+ */
+PUBLIC uint64_t clock_cycles(void)
+{
+#if (CLOCK_TSC)
+	if (tsc_ok)
+		return (rdtsc());
+#endif
+
+	return (ticks);
+}
+
+/*
+ * Gets a time stamp like clock_cycles(), but that may
+ * be taken even before the clock is initialized.
+ */
+PUBLIC uint64_t clock_early(void)
+{
+#if (CLOCK_TSC)
+	if (has_tsc())
+		return (rdtsc());
+#endif
+
+	return (ticks);
+}
+
+/*
+ * Gets the number of clock_cycles() counts per clock tick,
+ * or zero if not known yet.
+ */
+PUBLIC unsigned clock_rate(void)
+{
+#if (CLOCK_TSC)
+	if (tsc_ok)
+		return (tsc_per_tick);
+#endif
+
+	return (1);
+}
+
+/*
+ * Halts the processor until the next interrupt, accounting for the time
+ * spent halted. Interrupts must be disabled, and are disabled on return.
+ */
+PUBLIC void clock_halt(void)
+{
+	uint64_t start;
+	
+	start = clock_cycles();
+	__asm__ volatile ("sti; hlt; cli");
+	idle_cycles += clock_cycles() - start;
+}
+
+/*
+ * Gets the time that the processor spent halted and the time elapsed since
+ * the clock was initialized, both in clock_cycles() counts.
+ */
+PUBLIC void clock_idlestat(uint64_t *idle, uint64_t *total)
+{
+	disable_interrupts();
+	*idle = idle_cycles;
+	*total = clock_cycles() - start_cycles;
+	enable_interrupts();
+}
+
+/*
+ * Programs the PIT.
+ */
+PRIVATE void pit_program(byte_t mode, unsigned count)
+{
+	outputb(PIT_CTRL, mode);
+	outputb(PIT_DATA, (byte_t)(count & 0xff));
+	outputb(PIT_DATA, (byte_t)((count >> 8) & 0xff));
+}
+
 /*
  * Handles a timer interrupt.
  */
 PRIVATE void do_clock()
 {
+	if ((kprof_on) && (pmc_sample(curr_proc)))
+		kprof_tick();
+	
+	/* Not a whole tick yet. */
+	if (--prof_left > 0)
+		return;
+	prof_left = prof_rate;
+	
+#if (CLOCK_TICKLESS)
+	/* Back from one-shot period. */
+	if (oneshot)
+	{
+		ticks += oneshot;
+		oneshot = 0;
+		pit_program(0x36, freq_divisor);
+	}
+	else
+		ticks++;
+#else
 	ticks++;
+#endif
+
+#if (CLOCK_TSC)
+	if (tsc_ok)
+		tsc_tick();
+#endif
+	
+	timepage_update();
+	
+	/* Run expired timers. */
+	timer_run();
 	
 	if (KERNEL_RUNNING(curr_proc))
 	{
 		curr_proc->ktime++;
+		itimer_tick(0);
+		sched_tick(0);
 		return;
 	}
 	
 	curr_proc->utime++;
+	itimer_tick(1);
+	sched_tick(1);
+}
+
+/*
+ * Runs the clock interrupt rate times per tick, so that the profiler
+ * samples more often. Ticks keep their length. Must be called with
+ * interrupts disabled.
+ */
+PUBLIC void clock_profile(unsigned rate)
+{
+	prof_rate = prof_left = rate;
+	pit_program(0x36, freq_divisor/rate);
+}
+
+/*
+ * Waits for an interrupt, stopping the clock if possible.
+ * 
+ * When no process is ready to run and no timer expires soon, the clock is
+ * switched to one-shot mode, so that the processor is not awaken on every
+ * tick. If some other interrupt comes first, elapsed ticks are accounted
+ * from the PIT counter and the clock goes back to periodic mode.
+ */
+PUBLIC void clock_idle(void)
+{
+#if (CLOCK_TICKLESS)
+	unsigned n;      /* One-shot period (in ticks). */
+	byte_t status;   /* PIT status.                 */
+	unsigned count;  /* PIT count.                  */
+	
+	disable_interrupts();
+	
+	/* Some process is ready to run. */
+	if (runnable())
+	{
+		enable_interrupts();
+		return;
+	}
+	
+	n = timer_idle(ONESHOT_MAX - 1) + 1;
+	
+	/* Profiling. */
+	if (prof_rate > 1)
+		n = 1;
+	
+#if (CLOCK_TSC)
+	/* Calibrating the TSC. */
+	if ((tsc_ok) && (!tsc_per_tick))
+		n = 1;
+#endif
+	
+	/* Not worthy. */
+	if (n < 2)
+	{
+		clock_halt();
+		enable_interrupts();
+		return;
+	}
+	
+	oneshot = n;
+	pit_program(0x30, n*freq_divisor);
+	
+	clock_halt();
+	
+	/* Awaken by some other interrupt. */
+	if (oneshot)
+	{
+		/* Read back status and count of channel 0. */
+		outputb(PIT_CTRL, 0xc2);
+		status = inputb(PIT_DATA);
+		count = inputb(PIT_DATA);
+		count |= inputb(PIT_DATA) << 8;
 		
-	/* Give up processor time. */
-	if (--curr_proc->counter == 0)
-		yield();
+		/*
+		 * Terminal count not reached, otherwise
+		 * leave it to the pending clock interrupt.
+		 */
+		if (!(status & 0x80))
+		{
+			ticks += (oneshot*freq_divisor - count)/freq_divisor;
+			oneshot = 0;
+			pit_program(0x36, freq_divisor);
+#if (CLOCK_TSC)
+			if (tsc_ok)
+				tsc_last = rdtsc();
+#endif
+			timepage_update();
+			timer_run();
+		}
+	}
+	
+	enable_interrupts();
+#else
+	disable_interrupts();
+	clock_halt();
+	enable_interrupts();
+#endif
 }
 
 /*
@@ -53,18 +419,19 @@ PRIVATE void do_clock()
  */
 PUBLIC void clock_init(unsigned freq)
 {
-	uint16_t freq_divisor;
-	
 	kprintf("dev: initializing clock device driver");
 	
 	set_hwint(INT_CLOCK, &do_clock);
+	timepage_update();
 	
 	freq_divisor = PIT_FREQUENCY/freq;
 	
-	/* Send control byte: adjust frequency divisor. */
-	outputb(PIT_CTRL, 0x36);
-	
-	/* Send data byte: divisor_low and divisor_high. */
-	outputb(PIT_DATA, (byte_t)(freq_divisor & 0xff));
-	outputb(PIT_DATA, (byte_t)((freq_divisor >> 8)));
+	/* Adjust frequency divisor, periodic mode. */
+	pit_program(0x36, freq_divisor);
+
+#if (CLOCK_TSC)
+	tsc_ok = has_tsc();
+#endif
+
+	start_cycles = clock_cycles();
 }
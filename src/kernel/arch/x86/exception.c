@@ -60,7 +60,6 @@ EXCEPTION(breakpoint,                  SIGTRAP, "breakpoint exception")
 EXCEPTION(overflow,                    SIGSEGV, "overflow exception")
 EXCEPTION(bounds,                      SIGSEGV, "bounds check exception")
 EXCEPTION(invalid_opcode,              SIGILL,  "invalid opcode exception")
-EXCEPTION(coprocessor_not_available,   SIGSEGV, "coprocessor not available")
 EXCEPTION(double_fault,                SIGSEGV, "double fault")
 EXCEPTION(coprocessor_segment_overrun, SIGFPE,  "coprocessor segment overrun")
 EXCEPTION(invalid_tss,                 SIGSEGV, "invalid tss")
@@ -97,7 +96,7 @@ PUBLIC void do_page_fault(addr_t addr, int err, int dummy0, int dummy1, struct i
 	/* Validty page fault. */
 	if (!(err & 1))
 	{
-		if (!vfault(addr))
+		if (!vfault(addr, err & 2))
 			return;
 	}
 	
@@ -0,0 +1,172 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/hal.h>
+#include <nanvix/pm.h>
+#include <i386/fpu.h>
+#include <stdint.h>
+
+/*
+ * FXSAVE area.
+ */
+struct fxarea
+{
+	uint8_t data[512];
+} __attribute__((aligned(16)));
+
+/* Process whose state is loaded in the FPU. */
+PUBLIC struct process *fpu_owner = NULL;
+
+/* Use fxsave/fxrstor? */
+PRIVATE int fxsr = 0;
+
+/* FXSAVE areas. */
+PRIVATE struct fxarea fxareas[PROC_MAX];
+
+/*
+ * Clears the task switched flag.
+ */
+#define clts() \
+	__asm__ volatile ("clts")
+
+/*
+ * Sets the task switched flag.
+ */
+PRIVATE void stts(void)
+{
+	dword_t cr0;
+	
+	__asm__ volatile ("movl %%cr0, %0" : "=r" (cr0));
+	__asm__ volatile ("movl %0, %%cr0" : : "r" (cr0 | CR0_TS));
+}
+
+/*
+ * Saves the FPU state of a process.
+ */
+PRIVATE void fpu_save(struct process *proc)
+{
+	if (fxsr)
+		__asm__ volatile ("fxsave %0" : "=m" (fxareas[proc - proctab]));
+	else
+		__asm__ volatile ("fnsave %0" : "=m" (proc->fss));
+}
+
+/*
+ * Restores the FPU state of a process.
+ */
+PRIVATE void fpu_restore(struct process *proc)
+{
+	if (fxsr)
+		__asm__ volatile ("fxrstor %0" : : "m" (fxareas[proc - proctab]));
+	else
+		__asm__ volatile ("frstor %0" : : "m" (proc->fss));
+}
+
+/*
+ * Handles a device not available exception.
+ *
+ * The FPU state is switched lazily: switch_to() only sets CR0.TS, and the
+ * first FPU instruction that a process issues afterwards lands here, so
+ * that the state of the previous owner is saved and the one of the current
+ * process is loaded.
+ */
+PUBLIC void do_coprocessor_not_available(int err, struct intstack s)
+{
+	((void) err);
+	((void) s);
+	
+	disable_interrupts();
+	
+	clts();
+	
+	if (fpu_owner != curr_proc)
+	{
+		if (fpu_owner != NULL)
+			fpu_save(fpu_owner);
+		fpu_restore(curr_proc);
+		fpu_owner = curr_proc;
+	}
+	
+	enable_interrupts();
+}
+
+/*
+ * Duplicates the FPU state of the current process.
+ */
+PUBLIC void fpu_dup(struct process *proc)
+{
+	disable_interrupts();
+	
+	/* Get FPU state up to date. */
+	if (fpu_owner == curr_proc)
+	{
+		clts();
+		fpu_save(curr_proc);
+		
+		/* fnsave resets the FPU. */
+		if (!fxsr)
+			fpu_restore(curr_proc);
+	}
+	
+	if (fxsr)
+		fxareas[proc - proctab] = fxareas[curr_proc - proctab];
+	else
+		proc->fss = curr_proc->fss;
+	
+	enable_interrupts();
+}
+
+/*
+ * Releases the FPU from a process.
+ */
+PUBLIC void fpu_release(struct process *proc)
+{
+	if (fpu_owner == proc)
+		fpu_owner = NULL;
+}
+
+/*
+ * Initializes the FPU.
+ */
+PUBLIC void fpu_init(void)
+{
+	uint32_t eax, ebx, ecx, edx;
+	dword_t cr4;
+	
+	__asm__ volatile (
+		"cpuid"
+		: "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
+		: "0" (1)
+	);
+	
+	/* FXSR supported. */
+	if ((edx >> 24) & 1)
+	{
+		__asm__ volatile ("movl %%cr4, %0" : "=r" (cr4));
+		__asm__ volatile ("movl %0, %%cr4" : : "r" (cr4 | CR4_OSFXSR));
+		fxsr = 1;
+	}
+	
+	/* Initial state, inherited by all processes. */
+	__asm__ volatile ("fninit");
+	fpu_save(curr_proc);
+	
+	stts();
+}
@@ -20,6 +20,7 @@
 #include <nanvix/const.h>
 #include <nanvix/hal.h>
 #include <nanvix/klib.h>
+#include <nanvix/ktrace.h>
 #include <errno.h>
 
 /* Forward definitions. */
@@ -35,6 +36,31 @@ PUBLIC void (*hwint_handlers[])(void) = {
 	&default_hwint, &default_hwint,	&default_hwint, &default_hwint
 };
 
+/**
+ * @brief Maximum number of extra handlers on a shared interrupt line.
+ */
+#define HWINT_SHARED_MAX 2
+
+/**
+ * @brief Extra handlers of shared hardware interrupt lines.
+ */
+PRIVATE void (*hwint_shared[16][HWINT_SHARED_MAX])(void);
+
+/**
+ * @brief Bottom half handlers.
+ */
+PRIVATE void (*bh_handlers[NR_BH])(void) = { NULL, NULL, NULL };
+
+/**
+ * @brief Bottom halves that are pending.
+ */
+PRIVATE volatile unsigned bh_pending = 0;
+
+/**
+ * @brief Are bottom halves running?
+ */
+PRIVATE int bh_running = 0;
+
 /**
  * @brief Default hardware interrupt handler.
  */
@@ -63,15 +89,125 @@ PUBLIC int set_hwint(int num, void (*handler)(void))
 	return (0);
 }
 
+/**
+ * @brief Adds a handler to a hardware interrupt line.
+ * 
+ * @details Sets @p handler as the interrupt handler of line @p num, just
+ *          like set_hwint(), or, if the line is taken, has @p handler called
+ *          after the current one. Handlers of a shared line shall check
+ *          whether their devices have actually raised the interrupt.
+ * 
+ * @param num     Interrupt number.
+ * @param handler Interrupt handler.
+ * 
+ * @returns Upon successful completion, zero is returned. Upon failure, a 
+ *          negative number is returned instead.
+ */
+PUBLIC int share_hwint(int num, void (*handler)(void))
+{
+	if (hwint_handlers[num] == &default_hwint)
+		return (set_hwint(num, handler));
+	
+	for (unsigned i = 0; i < HWINT_SHARED_MAX; i++)
+	{
+		if (hwint_shared[num][i] == NULL)
+		{
+			hwint_shared[num][i] = handler;
+			return (0);
+		}
+	}
+	
+	return (-EBUSY);
+}
+
+/**
+ * @brief Sets a bottom half handler.
+ * 
+ * @param num     Bottom half number.
+ * @param handler Bottom half handler.
+ * 
+ * @returns Upon successful completion, zero is returned. Upon failure, a 
+ *          negative number is returned instead.
+ */
+PUBLIC int set_bh(unsigned num, void (*handler)(void))
+{
+	/* Invalid bottom half. */
+	if (num >= NR_BH)
+		return (-EINVAL);
+	
+	/* Bottom half handler already set? */
+	if (bh_handlers[num] != NULL)
+		return (-EBUSY);
+	
+	bh_handlers[num] = handler;
+	
+	return (0);
+}
+
+/**
+ * @brief Marks a bottom half as pending.
+ * 
+ * @details Schedules the bottom half @p num to run once the outermost
+ *          hardware interrupt handler returns. This may be called from an
+ *          interrupt handler, with interrupts enabled, since the pending
+ *          mask is updated with a single instruction.
+ * 
+ * @param num Bottom half number.
+ */
+PUBLIC void mark_bh(unsigned num)
+{
+	__asm__ volatile ("orl %1, %0" : "+m" (bh_pending) : "r" (1 << num));
+}
+
+/**
+ * @brief Runs pending bottom halves.
+ * 
+ * @details Runs, with interrupts enabled and all interrupt sources unmasked,
+ *          every bottom half that is pending, until none is left. Bottom
+ *          halves marked meanwhile by nested interrupts are picked up by the
+ *          same loop, so bottom halves never nest.
+ * 
+ * @note This function must be called with interrupts disabled.
+ */
+PRIVATE void do_bh(void)
+{
+	unsigned pending; /* Bottom halves to run. */
+	
+	/* Already running on this stack. */
+	if (bh_running)
+		return;
+	
+	bh_running = 1;
+	
+	while ((pending = bh_pending) != 0)
+	{
+		bh_pending = 0;
+		
+		enable_interrupts();
+		
+		for (unsigned i = 0; i < NR_BH; i++)
+		{
+			if ((pending & (1 << i)) && (bh_handlers[i] != NULL))
+				bh_handlers[i]();
+		}
+		
+		disable_interrupts();
+	}
+	
+	bh_running = 0;
+}
+
 /**
  * @brief Hardware interrupt dispatcher.
  *
  * @details Dispatches the hardware interrupt to the appropriate interrupt
  *          handler. To do so, first the processor execution level is raised to
  *          block all interrupts from the same source, and then the specific
- *          interrupt handler routine is called. Finally, after that the
+ *          interrupt handler routine is called, followed by any other that
+ *          shares the same line. Finally, after that the
  *          interrupt handler has finished its work, the process level is
- *          restored back.
+ *          restored back. When the outermost interrupt handler returns,
+ *          pending bottom halves are run.
  *
  * @param irq Interrupt request number.
  *
@@ -83,10 +219,21 @@ PUBLIC void do_hwint(unsigned irq)
 	unsigned old_irqlvl;
 	
 	old_irqlvl = processor_raise(irq_lvl(irq));
+	
+	ktrace(KTRACE_IRQ, irq, 0);
 
 	enable_interrupts();
 	hwint_handlers[irq]();
+	for (unsigned i = 0; i < HWINT_SHARED_MAX; i++)
+	{
+		if (hwint_shared[irq][i] != NULL)
+			hwint_shared[irq][i]();
+	}
 	disable_interrupts();
 
 	processor_drop(old_irqlvl);
+	
+	/* Not nested in another interrupt handler. */
+	if (old_irqlvl == INT_LVL_5)
+		do_bh();
 }
@@ -0,0 +1,393 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/hal.h>
+#include <nanvix/klib.h>
+#include <nanvix/pm.h>
+#include <i386/pmc.h>
+#include <sys/pmc.h>
+#include <errno.h>
+#include <stdint.h>
+
+/*
+ * Event select bits that user processes may set: event, unit mask,
+ * privilege levels, edge detect, invert and counter mask.
+ */
+#define PERFEVTSEL_MASK 0xff87ffff
+
+/*
+ * Performance counters of a process.
+ */
+struct pmcs
+{
+	unsigned evtsel[PMC_MAX]; /* Event select, zero if free.   */
+	uint64_t count[PMC_MAX];  /* Events counted so far.        */
+	unsigned nopen;           /* Counters open.                */
+	uint64_t period;          /* Sampling period, if any.      */
+	uint64_t last;            /* Count at the last sample.     */
+	int sampling;             /* Sampling counter, -1 if none. */
+};
+
+/* Hardware counters. */
+PRIVATE unsigned npmcs = 0;
+
+/* Counter width mask. */
+PRIVATE uint64_t pmc_mask = 0;
+
+/* Architectural performance monitoring? */
+PRIVATE int arch_perfmon = 0;
+
+/* Performance counters of all processes. */
+PRIVATE struct pmcs pmcs[PROC_MAX];
+
+/*
+ * Writes a model specific register.
+ */
+PRIVATE void wrmsr(unsigned msr, unsigned value)
+{
+	__asm__ volatile ("wrmsr" : : "c" (msr), "a" (value), "d" (0));
+}
+
+/*
+ * Reads a performance counter.
+ */
+PRIVATE uint64_t rdpmc(unsigned i)
+{
+	uint32_t lo, hi;
+	
+	__asm__ volatile ("rdpmc" : "=a" (lo), "=d" (hi) : "c" (i));
+	
+	return ((((uint64_t)hi << 32) | lo) & pmc_mask);
+}
+
+/*
+ * Gets the current count of a counter of a process.
+ */
+PRIVATE uint64_t pmc_count(struct process *proc, int i)
+{
+	uint64_t count;
+	
+	count = pmcs[proc - proctab].count[i];
+	
+	/* Counter is live. */
+	if (proc == curr_proc)
+		count += rdpmc(i);
+	
+	return (count);
+}
+
+/*
+ * Stops the counters of a process and accumulates their counts.
+ */
+PRIVATE void pmc_unload(struct process *proc)
+{
+	unsigned i;
+	struct pmcs *p;
+	
+	p = &pmcs[proc - proctab];
+	
+	if (p->nopen == 0)
+		return;
+	
+	/* Stop all counters, the first one may enable others. */
+	for (i = 0; i < npmcs; i++)
+		wrmsr(MSR_PERFEVTSEL0 + i, 0);
+	
+	for (i = 0; i < npmcs; i++)
+	{
+		if (p->evtsel[i] != 0)
+			p->count[i] += rdpmc(i);
+	}
+}
+
+/*
+ * Starts the counters of a process from zero.
+ */
+PRIVATE void pmc_load(struct process *proc)
+{
+	unsigned i;
+	struct pmcs *p;
+	
+	p = &pmcs[proc - proctab];
+	
+	if (p->nopen == 0)
+		return;
+	
+	for (i = 0; i < npmcs; i++)
+	{
+		if (p->evtsel[i] == 0)
+			continue;
+		
+		wrmsr(MSR_PMC0 + i, 0);
+		wrmsr(MSR_PERFEVTSEL0 + i, p->evtsel[i]);
+	}
+	
+	/* P6 counters are enabled altogether in the first event select. */
+	if ((!arch_perfmon) && (p->evtsel[0] == 0))
+		wrmsr(MSR_PERFEVTSEL0, PERFEVTSEL_EN);
+}
+
+/*
+ * Switches performance counters from a process to another.
+ *
+ * Counters are virtualized: hardware counters only ever hold what the
+ * running process has counted since it was last scheduled in, and that is
+ * added to the totals of the process when it is scheduled out.
+ */
+PUBLIC void pmc_switch(struct process *from, struct process *to)
+{
+	if (npmcs == 0)
+		return;
+	
+	pmc_unload(from);
+	pmc_load(to);
+}
+
+/*
+ * Releases the performance counters of a process.
+ */
+PUBLIC void pmc_release(struct process *proc)
+{
+	unsigned i;
+	struct pmcs *p;
+	
+	if (npmcs == 0)
+		return;
+	
+	disable_interrupts();
+	
+	if (proc == curr_proc)
+		pmc_unload(proc);
+	
+	p = &pmcs[proc - proctab];
+	for (i = 0; i < PMC_MAX; i++)
+	{
+		p->evtsel[i] = 0;
+		p->count[i] = 0;
+	}
+	p->nopen = 0;
+	p->sampling = -1;
+	
+	enable_interrupts();
+}
+
+/*
+ * Asserts if the profiler shall take a sample of a process.
+ *
+ * There is no local APIC support, so counter overflows cannot raise
+ * interrupts. Instead, the profiler checks on every clock interrupt if the
+ * sampling counter of the interrupted process went past its period.
+ * Processes with no sampling counter are sampled on every clock interrupt.
+ */
+PUBLIC int pmc_sample(struct process *proc)
+{
+	uint64_t count;
+	struct pmcs *p;
+	
+	p = &pmcs[proc - proctab];
+	
+	if ((npmcs == 0) || (p->sampling < 0))
+		return (1);
+	
+	count = pmc_count(proc, p->sampling);
+	if (count - p->last < p->period)
+		return (0);
+	
+	p->last = count;
+	
+	return (1);
+}
+
+/*
+ * Opens a performance counter for the current process.
+ */
+PUBLIC int pmc_alloc(unsigned event, unsigned period)
+{
+	int i;
+	struct pmcs *p;
+	
+	if (npmcs == 0)
+		return (-ENOTSUP);
+	
+	/* Invalid event. */
+	if (event & ~PERFEVTSEL_MASK)
+		return (-EINVAL);
+	
+	p = &pmcs[curr_proc - proctab];
+	
+	/* Only one sampling counter. */
+	if ((period > 0) && (p->sampling >= 0))
+		return (-EBUSY);
+	
+	/* Count in both privilege levels by default. */
+	if (!(event & (PMC_USR | PMC_OS)))
+		event |= PMC_USR | PMC_OS;
+	
+	disable_interrupts();
+	
+	for (i = 0; i < (int)npmcs; i++)
+	{
+		if (p->evtsel[i] == 0)
+			break;
+	}
+	
+	/* No free counter. */
+	if (i == (int)npmcs)
+	{
+		enable_interrupts();
+		return (-ENOSPC);
+	}
+	
+	pmc_unload(curr_proc);
+	
+	p->evtsel[i] = event | PERFEVTSEL_EN;
+	p->count[i] = 0;
+	p->nopen++;
+	if (period > 0)
+	{
+		p->sampling = i;
+		p->period = period;
+		p->last = 0;
+	}
+	
+	pmc_load(curr_proc);
+	
+	enable_interrupts();
+	
+	return (i);
+}
+
+/*
+ * Reads a performance counter of the current process.
+ */
+PUBLIC int pmc_value(int i, uint64_t *value)
+{
+	struct pmcs *p;
+	
+	p = &pmcs[curr_proc - proctab];
+	
+	/* Invalid counter. */
+	if ((i < 0) || (i >= (int)npmcs) || (p->evtsel[i] == 0))
+		return (-EINVAL);
+	
+	disable_interrupts();
+	*value = pmc_count(curr_proc, i);
+	enable_interrupts();
+	
+	return (0);
+}
+
+/*
+ * Closes a performance counter of the current process.
+ */
+PUBLIC int pmc_free(int i)
+{
+	struct pmcs *p;
+	
+	p = &pmcs[curr_proc - proctab];
+	
+	/* Invalid counter. */
+	if ((i < 0) || (i >= (int)npmcs) || (p->evtsel[i] == 0))
+		return (-EINVAL);
+	
+	disable_interrupts();
+	
+	pmc_unload(curr_proc);
+	p->evtsel[i] = 0;
+	p->count[i] = 0;
+	p->nopen--;
+	if (p->sampling == i)
+		p->sampling = -1;
+	pmc_load(curr_proc);
+	
+	enable_interrupts();
+	
+	return (0);
+}
+
+/*
+ * Initializes performance counters.
+ */
+PUBLIC void pmc_init(void)
+{
+	unsigned i;
+	unsigned width;
+	uint32_t eax, ebx, ecx, edx;
+	uint32_t max;
+	
+	width = 0;
+	for (i = 0; i < PROC_MAX; i++)
+		pmcs[i].sampling = -1;
+	
+	__asm__ volatile (
+		"cpuid"
+		: "=a" (max), "=b" (ebx), "=c" (ecx), "=d" (edx)
+		: "0" (0)
+	);
+	
+	/* Not Intel. */
+	if ((ebx != 0x756e6547) || (edx != 0x49656e69) || (ecx != 0x6c65746e))
+		return;
+	
+	/* Architectural performance monitoring. */
+	if (max >= 0xa)
+	{
+		__asm__ volatile (
+			"cpuid"
+			: "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
+			: "0" (0xa)
+		);
+		
+		if ((eax & 0xff) > 0)
+		{
+			arch_perfmon = 1;
+			npmcs = (eax >> 8) & 0xff;
+			width = (eax >> 16) & 0xff;
+		}
+	}
+	
+	/* P6 family. */
+	if (!arch_perfmon)
+	{
+		__asm__ volatile (
+			"cpuid"
+			: "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
+			: "0" (1)
+		);
+		
+		if (((eax >> 8) & 0xf) != 6)
+			return;
+		
+		npmcs = 2;
+		width = 40;
+	}
+	
+	if (npmcs > PMC_MAX)
+		npmcs = PMC_MAX;
+	if ((width == 0) || (width > 48))
+		width = 40;
+	pmc_mask = ((uint64_t)1 << width) - 1;
+	
+	/* Stop all counters. */
+	for (i = 0; i < npmcs; i++)
+		wrmsr(MSR_PERFEVTSEL0 + i, 0);
+	
+	kprintf("cpu: %d performance counters", npmcs);
+}
@@ -19,6 +19,7 @@
 
 #include <i386/i386.h>
 #include <i386/int.h>
+#include <dev/bootlog.h>
 #include <nanvix/config.h>
 #include <nanvix/const.h>
 #include <nanvix/hal.h>
@@ -191,15 +192,52 @@ PRIVATE void idt_setup(void)
     idt_flush(&idtptr);
 }
 
+/*
+ * Writes a model specific register.
+ */
+PRIVATE void wrmsr(unsigned msr, unsigned value)
+{
+	__asm__ volatile ("wrmsr" : : "c" (msr), "a" (value), "d" (0));
+}
+
+/*
+ * Sets up fast system calls.
+ */
+PRIVATE void sysenter_setup(void)
+{
+	uint32_t eax, ebx, ecx, edx;
+	
+	__asm__ volatile (
+		"cpuid"
+		: "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
+		: "0" (1)
+	);
+	
+	/* SEP not supported (early Pentium Pro reports it wrongly). */
+	if (!((edx >> 11) & 1))
+		return;
+	if ((((eax >> 8) & 0xf) == 6) && (((eax >> 4) & 0xf) < 3) && ((eax & 0xf) < 3))
+		return;
+	
+	wrmsr(MSR_SYSENTER_CS, KERNEL_CS);
+	wrmsr(MSR_SYSENTER_ESP, (unsigned)&tss + TSS_ESP0);
+	wrmsr(MSR_SYSENTER_EIP, (unsigned)sysenter);
+	
+	kprintf("kernel: fast system calls enabled");
+}
+
 /*
  * Sets up machine.
  */
 PUBLIC void setup(void)
 {
+	boot_mark("setup");
+	
 	/* Setup descriptor tables. */
 	gdt_setup();
     kprintf("boot: loading global descriptor table");
 	tss_setup();
     kprintf("boot: loading interrupt descriptor table");
 	idt_setup();
+	sysenter_setup();
 }
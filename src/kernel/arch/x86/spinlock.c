@@ -0,0 +1,63 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/hal.h>
+#include <nanvix/spinlock.h>
+
+/*
+ * Atomically sets a lock word and returns its old value.
+ */
+PRIVATE inline int xchg(volatile int *ptr, int val)
+{
+	__asm__ volatile (
+		"xchgl %0, %1"
+		: "+r" (val), "+m" (*ptr)
+		:
+		: "memory"
+	);
+	
+	return (val);
+}
+
+/*
+ * Acquires a spinlock.
+ */
+PUBLIC void spin_lock(struct spinlock *lock)
+{
+	disable_interrupts();
+	
+	while (xchg(&lock->locked, 1))
+	{
+		/* Spin on plain reads, so the cache line is not bounced. */
+		while (lock->locked)
+			__asm__ volatile ("pause");
+	}
+}
+
+/*
+ * Releases a spinlock.
+ */
+PUBLIC void spin_unlock(struct spinlock *lock)
+{
+	__asm__ volatile ("" : : : "memory");
+	lock->locked = 0;
+	
+	enable_interrupts();
+}
@@ -0,0 +1,1326 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/clock.h>
+#include <nanvix/config.h>
+#include <nanvix/const.h>
+#include <nanvix/dev.h>
+#include <nanvix/fs.h>
+#include <nanvix/hal.h>
+#include <nanvix/klib.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include <dev/ahci.h>
+#include <dev/pci.h>
+#include <sys/iostat.h>
+#include <sys/types.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdint.h>
+
+/* Log 2 of sector size. */
+#define AHCI_SECTOR_SIZE_LOG2 9
+
+/* Sector size (in bytes). */
+#define AHCI_SECTOR_SIZE (1 << AHCI_SECTOR_SIZE_LOG2)
+
+/* Number of sectors in a block. */
+#define AHCI_BLOCK_SECTORS (BLOCK_SIZE >> AHCI_SECTOR_SIZE_LOG2)
+
+/* Maximum number of AHCI devices. */
+#define AHCI_DEV_MAX 4
+
+/* Number of command slots per port. */
+#define AHCI_NR_SLOTS 32
+
+/* Block operation queue size. */
+#define AHCI_QUEUE_SIZE 64
+
+/* Polling timeout (in iterations). */
+#define AHCI_TIMEOUT 1000000
+
+/* Size of HBA register space. */
+#define AHCI_ABAR_SIZE 0x1100
+
+/* HBA registers. */
+#define AHCI_REG_CAP 0x00 /* Host capabilities.   */
+#define AHCI_REG_GHC 0x04 /* Global host control. */
+#define AHCI_REG_IS  0x08 /* Interrupt status.    */
+#define AHCI_REG_PI  0x0c /* Ports implemented.   */
+
+/* Host capabilities register. */
+#define AHCI_CAP_SNCQ (1 << 30) /* Supports NCQ. */
+
+/*
+ * Returns the number of command slots per port.
+ */
+#define AHCI_CAP_NCS(cap) \
+	((((cap) >> 8) & 0x1f) + 1)
+
+/* Global host control register. */
+#define AHCI_GHC_IE (1 << 1)  /* Interrupt enable. */
+#define AHCI_GHC_AE (1U << 31) /* AHCI enable.      */
+
+/* Port registers. */
+#define AHCI_PX_CLB  0x00 /* Command list base address.      */
+#define AHCI_PX_CLBU 0x04 /* Command list base address high. */
+#define AHCI_PX_FB   0x08 /* FIS base address.               */
+#define AHCI_PX_FBU  0x0c /* FIS base address high.          */
+#define AHCI_PX_IS   0x10 /* Interrupt status.               */
+#define AHCI_PX_IE   0x14 /* Interrupt enable.               */
+#define AHCI_PX_CMD  0x18 /* Command and status.             */
+#define AHCI_PX_TFD  0x20 /* Task file data.                 */
+#define AHCI_PX_SIG  0x24 /* Signature.                      */
+#define AHCI_PX_SSTS 0x28 /* SATA status.                    */
+#define AHCI_PX_SERR 0x30 /* SATA error.                     */
+#define AHCI_PX_SACT 0x34 /* SATA active (NCQ tags).         */
+#define AHCI_PX_CI   0x38 /* Command issue.                  */
+
+/* Port command and status register. */
+#define AHCI_PX_CMD_ST  (1 << 0)  /* Start.                   */
+#define AHCI_PX_CMD_FRE (1 << 4)  /* FIS receive enable.      */
+#define AHCI_PX_CMD_FR  (1 << 14) /* FIS receive running.     */
+#define AHCI_PX_CMD_CR  (1 << 15) /* Command list running.    */
+
+/* Port interrupt status register. */
+#define AHCI_PX_IS_DHRS (1 << 0)  /* Device to host FIS.      */
+#define AHCI_PX_IS_PSS  (1 << 1)  /* PIO setup FIS.           */
+#define AHCI_PX_IS_SDBS (1 << 3)  /* Set device bits FIS.     */
+#define AHCI_PX_IS_DPS  (1 << 5)  /* Descriptor processed.    */
+#define AHCI_PX_IS_IFS  (1 << 27) /* Interface fatal error.   */
+#define AHCI_PX_IS_HBDS (1 << 28) /* Host bus data error.     */
+#define AHCI_PX_IS_HBFS (1 << 29) /* Host bus fatal error.    */
+#define AHCI_PX_IS_TFES (1 << 30) /* Task file error.         */
+
+/* Port errors. */
+#define AHCI_PX_IS_ERROR \
+	(AHCI_PX_IS_IFS | AHCI_PX_IS_HBDS | AHCI_PX_IS_HBFS | AHCI_PX_IS_TFES)
+
+/* Port interrupts that we care about. */
+#define AHCI_PX_IE_MASK                                 \
+	(AHCI_PX_IS_DHRS | AHCI_PX_IS_PSS | AHCI_PX_IS_SDBS | \
+	 AHCI_PX_IS_DPS | AHCI_PX_IS_ERROR)
+
+/* Task file data register. */
+#define AHCI_TFD_ERR  (1 << 0) /* Device error.  */
+#define AHCI_TFD_DRQ  (1 << 3) /* Data request.  */
+#define AHCI_TFD_BUSY (1 << 7) /* Device busy.   */
+
+/* SATA status register. */
+#define AHCI_SSTS_DET(ssts) ((ssts) & 0xf) /* Device detection.     */
+#define AHCI_DET_PRESENT    3              /* Device and PHY ready. */
+
+/* Signature of a SATA disk. */
+#define AHCI_SIG_ATA 0x00000101
+
+/* ATA device commands. */
+#define ATA_CMD_IDENTIFY        0xec /* Identify.                      */
+#define ATA_CMD_READ_DMA_EXT    0x25 /* Read DMA using LBA 48-bit.     */
+#define ATA_CMD_WRITE_DMA_EXT   0x35 /* Write DMA using LBA 48-bit.    */
+#define ATA_CMD_READ_FPDMA      0x60 /* Read FPDMA queued (NCQ).       */
+#define ATA_CMD_WRITE_FPDMA     0x61 /* Write FPDMA queued (NCQ).      */
+#define ATA_CMD_FLUSH_CACHE_EXT 0xea /* Flush cache using LBA 48-bit.  */
+
+/* ATA device information. */
+#define ATA_INFO_WORDS          256 /* # words returned by identify cmd. */
+#define ATA_INFO_LBA_CAPACITY_1  60 /* LBA addressable sectors 0.        */
+#define ATA_INFO_LBA_CAPACITY_2  61 /* LBA addressable sectors 1.        */
+#define ATA_INFO_QUEUE_DEPTH     75 /* Queue depth.                      */
+#define ATA_INFO_SATA_CAPS       76 /* SATA capabilities.                */
+#define ATA_INFO_COMMAND_SET_2   83 /* Supported command set 1.          */
+#define ATA_INFO_LBA48_CAPACITY 100 /* LBA 48 capacity.                  */
+
+/*
+ * Asserts if a SATA device supports NCQ.
+ */
+#define ata_info_has_ncq(info) \
+	((info)[ATA_INFO_SATA_CAPS] & (1 << 8))
+
+/*
+ * Asserts if a SATA device supports LBA 48-bit.
+ */
+#define ata_info_has_lba48(info) \
+	((info)[ATA_INFO_COMMAND_SET_2] & (1 << 10))
+
+/*
+ * Converts a kernel virtual address into a physical address.
+ */
+#define ahci_phys(x) \
+	((uint32_t)(x) - KBASE_VIRT + KBASE_PHYS)
+
+/*============================================================================*
+ *                            Hardware Structures                             *
+ *============================================================================*/
+
+/* Command header flags. */
+#define AHCI_CMD_CFL   5        /* Length of a H2D FIS (in dwords). */
+#define AHCI_CMD_WRITE (1 << 6) /* Device write.                    */
+
+/*
+ * Command header.
+ */
+struct cmdhdr
+{
+	uint16_t flags;          /* Flags (see above).             */
+	uint16_t prdtl;          /* Physical region table length.  */
+	volatile uint32_t prdbc; /* Bytes transferred.             */
+	uint32_t ctba;           /* Command table base address.    */
+	uint32_t ctbau;          /* Command table base address hi. */
+	uint32_t reserved[4];    /* Reserved.                      */
+} __attribute__((packed));
+
+/*
+ * Physical region descriptor.
+ */
+struct prd
+{
+	uint32_t dba;      /* Data base address.    */
+	uint32_t dbau;     /* Data base address hi. */
+	uint32_t reserved; /* Reserved.             */
+	uint32_t dbc;      /* Byte count minus one. */
+} __attribute__((packed));
+
+/* Register host to device FIS. */
+#define FIS_TYPE_H2D 0x27     /* FIS type.           */
+#define FIS_H2D_CMD  (1 << 7) /* Command update bit. */
+
+/*
+ * Command table.
+ */
+struct cmdtbl
+{
+	uint8_t cfis[64];             /* Command FIS.                  */
+	uint8_t acmd[16];             /* ATAPI command.                */
+	uint8_t reserved[48];         /* Reserved.                     */
+	struct prd prdt[AHCI_MERGE_MAX]; /* Physical region descriptors. */
+} __attribute__((packed, aligned(128)));
+
+/*
+ * Command lists. These shall be aligned on 1 KB boundaries.
+ */
+PRIVATE struct cmdhdr cmdlists[AHCI_DEV_MAX][AHCI_NR_SLOTS]
+	__attribute__((aligned(1024)));
+
+/*
+ * Received FIS areas. These shall be aligned on 256 byte boundaries.
+ */
+PRIVATE uint8_t rfis[AHCI_DEV_MAX][256]
+	__attribute__((aligned(256)));
+
+/*
+ * Command tables. These shall be aligned on 128 byte boundaries.
+ */
+PRIVATE struct cmdtbl cmdtbls[AHCI_DEV_MAX][AHCI_NR_SLOTS];
+
+/*
+ * Device information returned by identify command.
+ */
+PRIVATE uint16_t ahci_info[ATA_INFO_WORDS] __attribute__((aligned(2)));
+
+/*
+ * HBA registers, or NULL if there is no AHCI controller.
+ */
+PRIVATE volatile uint32_t *abar = NULL;
+
+/*
+ * Accesses a HBA register.
+ */
+#define hba_reg(reg) \
+	(abar[(reg) >> 2])
+
+/*
+ * Accesses a port register.
+ */
+#define port_reg(port, reg) \
+	(abar[(0x100 + ((port) << 7) + (reg)) >> 2])
+
+/*============================================================================*
+ *                               AHCI Devices                                 *
+ *============================================================================*/
+
+/* Request flags. */
+#define REQ_WRITE (1 << 0) /* Write request?    */
+#define REQ_BUF   (1 << 1) /* Buffered request? */
+#define REQ_SYNC  (1 << 2) /* Synchronous?      */
+#define REQ_FLUSH (1 << 3) /* Write barrier?    */
+
+/*
+ * Block operation request.
+ */
+struct request
+{
+	unsigned flags;        /* Flags (see above).            */
+	struct request *next;  /* Next request in the queue.    */
+	int done;              /* Completed?                    */
+	int status;            /* Completion status.            */
+	unsigned issued;       /* Issue time (in ticks).        */
+	struct waitq chain;    /* Owner waiting for completion. */
+	
+	union
+	{
+		/* Raw operation. */
+		struct
+		{
+			block_t num;        /* Block number.     */
+			size_t size;        /* Size.             */
+			unsigned char *buf; /* Buffer.           */
+			addr_t phys;        /* Physical address. */
+		} raw;
+		
+		/* Buffered operation. */
+		struct
+		{
+			buffer_t buf; /* Buffer. */
+		} buffered;
+	} u;
+};
+
+/* AHCI device flags. */
+#define AHCIDEV_VALID (1 << 0) /* Valid device? */
+#define AHCIDEV_NCQ   (1 << 1) /* Uses NCQ?     */
+
+/*
+ * AHCI devices.
+ */
+PRIVATE struct ahcidev
+{
+	unsigned flags;         /* Flags (see above).          */
+	int port;               /* HBA port.                   */
+	uint64_t nsectors;      /* Number of sectors.          */
+	unsigned depth;         /* Command slots that we use.  */
+	unsigned busy;          /* Command slots in flight.    */
+	uint64_t pos;           /* Last address served.        */
+	struct bdev_acct stats; /* I/O statistics.             */
+	
+	/* Requests served by each command slot. */
+	int nmerged[AHCI_NR_SLOTS];
+	struct request *inflight[AHCI_NR_SLOTS][AHCI_MERGE_MAX];
+	
+	/* Block operation queue. */
+	struct
+	{
+		int size;                                 /* Current size.       */
+		struct request *free;                     /* Free requests.      */
+		struct request *pending;                  /* Pending requests.   */
+		struct request *barrier;                  /* Pending barrier.    */
+		struct request *held;                     /* Held back requests. */
+		struct request requests[AHCI_QUEUE_SIZE]; /* Requests.           */
+		struct waitq chain;                       /* Waiting chain.      */
+	} queue;
+} ahci_devices[AHCI_DEV_MAX];
+
+/*============================================================================*
+ *                            Low-Level Routines                              *
+ *============================================================================*/
+
+/*
+ * Waits for a port register to clear some bits.
+ */
+PRIVATE int ahci_wait(int port, unsigned reg, uint32_t mask)
+{
+	int i;
+	
+	for (i = 0; i < AHCI_TIMEOUT; i++)
+	{
+		if (!(port_reg(port, reg) & mask))
+			return (0);
+	}
+	
+	return (-1);
+}
+
+/*
+ * Stops the command engine of a port.
+ */
+PRIVATE void ahci_port_stop(int port)
+{
+	port_reg(port, AHCI_PX_CMD) &= ~AHCI_PX_CMD_ST;
+	ahci_wait(port, AHCI_PX_CMD, AHCI_PX_CMD_CR);
+	
+	port_reg(port, AHCI_PX_CMD) &= ~AHCI_PX_CMD_FRE;
+	ahci_wait(port, AHCI_PX_CMD, AHCI_PX_CMD_FR);
+}
+
+/*
+ * Starts the command engine of a port.
+ */
+PRIVATE void ahci_port_start(int port)
+{
+	ahci_wait(port, AHCI_PX_CMD, AHCI_PX_CMD_CR);
+	
+	port_reg(port, AHCI_PX_CMD) |= AHCI_PX_CMD_FRE;
+	port_reg(port, AHCI_PX_CMD) |= AHCI_PX_CMD_ST;
+}
+
+/*
+ * Builds a register host to device FIS in a command table.
+ */
+PRIVATE void ahci_fis
+(struct cmdtbl *tbl, unsigned cmd, uint64_t lba, unsigned count, unsigned feat)
+{
+	uint8_t *fis;
+	
+	fis = tbl->cfis;
+	kmemset(fis, 0, sizeof(tbl->cfis));
+	
+	fis[0] = FIS_TYPE_H2D;
+	fis[1] = FIS_H2D_CMD;
+	fis[2] = cmd;
+	fis[3] = feat & 0xff;
+	fis[4] = (lba >> 0x00) & 0xff;
+	fis[5] = (lba >> 0x08) & 0xff;
+	fis[6] = (lba >> 0x10) & 0xff;
+	fis[7] = 0x40;
+	fis[8] = (lba >> 0x18) & 0xff;
+	fis[9] = (lba >> 0x20) & 0xff;
+	fis[10] = (lba >> 0x28) & 0xff;
+	fis[11] = (feat >> 8) & 0xff;
+	fis[12] = count & 0xff;
+	fis[13] = (count >> 8) & 0xff;
+}
+
+/*
+ * Fills in the command header of a slot.
+ */
+PRIVATE void ahci_cmdhdr(unsigned ahcidevid, int slot, int nprd, int write)
+{
+	struct cmdhdr *hdr;
+	
+	hdr = &cmdlists[ahcidevid][slot];
+	hdr->flags = AHCI_CMD_CFL | (write ? AHCI_CMD_WRITE : 0);
+	hdr->prdtl = nprd;
+	hdr->prdbc = 0;
+}
+
+/*
+ * Identifies the device attached to a port. Interrupts of the
+ * port are still disabled at this point, so we poll.
+ */
+PRIVATE int ahci_identify(unsigned ahcidevid)
+{
+	int port;           /* HBA port.      */
+	struct cmdtbl *tbl; /* Command table. */
+	
+	port = ahci_devices[ahcidevid].port;
+	tbl = &cmdtbls[ahcidevid][0];
+	
+	ahci_fis(tbl, ATA_CMD_IDENTIFY, 0, 0, 0);
+	tbl->cfis[7] = 0;
+	tbl->prdt[0].dba = ahci_phys(ahci_info);
+	tbl->prdt[0].dbau = 0;
+	tbl->prdt[0].dbc = sizeof(ahci_info) - 1;
+	ahci_cmdhdr(ahcidevid, 0, 1, 0);
+	
+	/* Device is not ready. */
+	if (ahci_wait(port, AHCI_PX_TFD, AHCI_TFD_BUSY | AHCI_TFD_DRQ))
+		return (-1);
+	
+	port_reg(port, AHCI_PX_CI) = 1;
+	
+	/* Wait for command completion. */
+	if (ahci_wait(port, AHCI_PX_CI, 1))
+		return (-1);
+	
+	/* Device error. */
+	if (port_reg(port, AHCI_PX_IS) & AHCI_PX_IS_ERROR)
+		return (-1);
+	
+	return (0);
+}
+
+/*
+ * Setups the device attached to a port.
+ */
+PRIVATE int ahci_setup(unsigned ahcidevid, int port, uint32_t cap)
+{
+	int i;               /* Loop index.  */
+	unsigned depth;      /* Queue depth. */
+	struct ahcidev *dev; /* AHCI device. */
+	
+	dev = &ahci_devices[ahcidevid];
+	kmemset(dev, 0, sizeof(struct ahcidev));
+	dev->port = port;
+	
+	/* No device attached. */
+	if (AHCI_SSTS_DET(port_reg(port, AHCI_PX_SSTS)) != AHCI_DET_PRESENT)
+		return (-1);
+	
+	/* Not a SATA disk. */
+	if (port_reg(port, AHCI_PX_SIG) != AHCI_SIG_ATA)
+		return (-1);
+	
+	ahci_port_stop(port);
+	
+	/* Setup command list and received FIS area. */
+	for (i = 0; i < AHCI_NR_SLOTS; i++)
+	{
+		cmdlists[ahcidevid][i].ctba = ahci_phys(&cmdtbls[ahcidevid][i]);
+		cmdlists[ahcidevid][i].ctbau = 0;
+	}
+	port_reg(port, AHCI_PX_CLB) = ahci_phys(cmdlists[ahcidevid]);
+	port_reg(port, AHCI_PX_CLBU) = 0;
+	port_reg(port, AHCI_PX_FB) = ahci_phys(rfis[ahcidevid]);
+	port_reg(port, AHCI_PX_FBU) = 0;
+	
+	/* Clear pending errors and interrupts. */
+	port_reg(port, AHCI_PX_IE) = 0;
+	port_reg(port, AHCI_PX_SERR) = 0xffffffff;
+	port_reg(port, AHCI_PX_IS) = 0xffffffff;
+	
+	ahci_port_start(port);
+	
+	if (ahci_identify(ahcidevid))
+		return (-1);
+	
+	/* Get device size. */
+	if (ata_info_has_lba48(ahci_info))
+	{
+		dev->nsectors = 
+			((uint64_t)ahci_info[ATA_INFO_LBA48_CAPACITY + 0] << 0x00) |
+			((uint64_t)ahci_info[ATA_INFO_LBA48_CAPACITY + 1] << 0x10) |
+			((uint64_t)ahci_info[ATA_INFO_LBA48_CAPACITY + 2] << 0x20) |
+			((uint64_t)ahci_info[ATA_INFO_LBA48_CAPACITY + 3] << 0x30);
+	}
+	else
+	{
+		dev->nsectors =
+			((uint64_t)ahci_info[ATA_INFO_LBA_CAPACITY_1] << 0x00) |
+			((uint64_t)ahci_info[ATA_INFO_LBA_CAPACITY_2] << 0x10);
+	}
+	
+	/*
+	 * Keep as many commands in flight as both the
+	 * HBA and the device can queue. Without NCQ,
+	 * commands are served one at a time.
+	 */
+	dev->depth = 1;
+	if ((cap & AHCI_CAP_SNCQ) && ata_info_has_ncq(ahci_info))
+	{
+		depth = (ahci_info[ATA_INFO_QUEUE_DEPTH] & 0x1f) + 1;
+		if (depth > AHCI_CAP_NCS(cap))
+			depth = AHCI_CAP_NCS(cap);
+		
+		dev->flags |= AHCIDEV_NCQ;
+		dev->depth = depth;
+	}
+	
+	/* Initialize block operation queue. */
+	dev->queue.size = 0;
+	dev->queue.free = &dev->queue.requests[0];
+	for (i = 0; i < AHCI_QUEUE_SIZE - 1; i++)
+		dev->queue.requests[i].next = &dev->queue.requests[i + 1];
+	dev->queue.requests[AHCI_QUEUE_SIZE - 1].next = NULL;
+	dev->queue.pending = NULL;
+	dev->queue.barrier = NULL;
+	dev->queue.held = NULL;
+	waitq_init(&dev->queue.chain);
+	
+	/* Enable port interrupts. */
+	port_reg(port, AHCI_PX_IS) = 0xffffffff;
+	port_reg(port, AHCI_PX_IE) = AHCI_PX_IE_MASK;
+	
+	dev->flags |= AHCIDEV_VALID;
+	
+	return (0);
+}
+
+/*
+ * Returns the physical address of the data buffer of a request.
+ */
+PRIVATE addr_t ahci_request_phys(struct request *req)
+{
+	if (req->flags & REQ_BUF)
+		return (ahci_phys(buffer_data(req->u.buffered.buf)));
+	
+	return (req->u.raw.phys);
+}
+
+/*
+ * Returns the size (in bytes) of a request.
+ */
+PRIVATE size_t ahci_request_size(struct request *req)
+{
+	if (req->flags & REQ_BUF)
+		return (BLOCK_SIZE);
+	
+	return (req->u.raw.size);
+}
+
+/*
+ * Returns the disk address (in sectors) of a request.
+ */
+PRIVATE uint64_t ahci_request_addr(struct request *req)
+{
+	block_t num;
+	
+	num = (req->flags & REQ_BUF) ?
+		buffer_num(req->u.buffered.buf) : req->u.raw.num;
+	
+	return ((uint64_t)num*AHCI_BLOCK_SECTORS);
+}
+
+/*============================================================================*
+ *                           Request Scheduling                               *
+ *============================================================================*/
+
+/*
+ * Inserts a request in the block operation queue of a device.
+ */
+PRIVATE void ahci_enqueue(struct ahcidev *dev, struct request *req)
+{
+	uint64_t addr;         /* Request address. */
+	struct request **link; /* Working link.    */
+	
+	/* Write barrier. */
+	if (req->flags & REQ_FLUSH)
+	{
+		dev->queue.barrier = req;
+		return;
+	}
+	
+	addr = ahci_request_addr(req);
+	
+	/*
+	 * Keep pending requests sorted by address, so that
+	 * requests on consecutive blocks can be merged. Requests
+	 * that arrive after a barrier are held back until the
+	 * barrier completes.
+	 */
+	link = (dev->queue.barrier != NULL) ? 
+		&dev->queue.held : &dev->queue.pending;
+	for (/* noop */; *link != NULL; link = &(*link)->next)
+	{
+		if (ahci_request_addr(*link) > addr)
+			break;
+	}
+	
+	req->next = *link;
+	*link = req;
+}
+
+/*
+ * Removes from the pending queue the next request to be served and
+ * the buffered requests of the same kind on consecutive blocks that
+ * follow it, so that all of them are served by a single command with
+ * one physical region per request. Requests are picked in C-SCAN
+ * order; the device reorders whatever is queued on it anyway.
+ */
+PRIVATE int ahci_merge(struct ahcidev *dev, int slot)
+{
+	int n;                 /* Number of requests. */
+	unsigned kind;         /* Kind of request.    */
+	uint64_t addr;         /* Next address.       */
+	struct request *req;   /* Working request.    */
+	struct request **link; /* Working link.       */
+	
+	for (link = &dev->queue.pending; *link != NULL; link = &(*link)->next)
+	{
+		if (ahci_request_addr(*link) >= dev->pos)
+			break;
+	}
+	if (*link == NULL)
+		link = &dev->queue.pending;
+	
+	req = *link;
+	kind = req->flags & (REQ_BUF | REQ_WRITE);
+	addr = ahci_request_addr(req);
+	
+	for (n = 0; (*link != NULL) && (n < AHCI_MERGE_MAX); n++)
+	{
+		req = *link;
+		
+		if (n > 0)
+		{
+			/* Raw requests are never merged. */
+			if (!(kind & REQ_BUF))
+				break;
+			
+			if ((req->flags & (REQ_BUF | REQ_WRITE)) != kind)
+				break;
+			
+			if (ahci_request_addr(req) != addr)
+				break;
+		}
+		
+		addr += ahci_request_size(req) >> AHCI_SECTOR_SIZE_LOG2;
+		dev->inflight[slot][n] = req;
+		*link = req->next;
+	}
+	
+	return (n);
+}
+
+/*
+ * Returns a free command slot of a device, or -1 if there is none.
+ */
+PRIVATE int ahci_slot(struct ahcidev *dev)
+{
+	unsigned i;
+	
+	for (i = 0; i < dev->depth; i++)
+	{
+		if (!(dev->busy & (1 << i)))
+			return (i);
+	}
+	
+	return (-1);
+}
+
+/*
+ * Issues a command on a slot of a device.
+ */
+PRIVATE void ahci_issue(struct ahcidev *dev, int slot, int queued)
+{
+	dev->busy |= 1 << slot;
+	bdev_acct_start(&dev->stats, dev->nmerged[slot]);
+	
+	if (queued)
+		port_reg(dev->port, AHCI_PX_SACT) = 1 << slot;
+	port_reg(dev->port, AHCI_PX_CI) = 1 << slot;
+}
+
+/*
+ * Issues a read/write command for the requests of a slot.
+ */
+PRIVATE void ahci_rw_op(unsigned ahcidevid, int slot)
+{
+	int i;               /* Loop index.        */
+	int n;               /* Number of regions. */
+	int write;           /* Write command?     */
+	size_t size;         /* Region size.       */
+	unsigned nsectors;   /* Number of sectors. */
+	uint64_t addr;       /* Command address.   */
+	struct cmdtbl *tbl;  /* Command table.     */
+	struct ahcidev *dev; /* AHCI device.       */
+	struct request *req; /* Working request.   */
+	
+	dev = &ahci_devices[ahcidevid];
+	tbl = &cmdtbls[ahcidevid][slot];
+	n = dev->nmerged[slot];
+	
+	req = dev->inflight[slot][0];
+	write = req->flags & REQ_WRITE;
+	addr = ahci_request_addr(req);
+	
+	/*
+	 * Buffers, kernel pages and pinned user pages are
+	 * physically contiguous, so one region per request
+	 * is enough.
+	 */
+	nsectors = 0;
+	for (i = 0; i < n; i++)
+	{
+		req = dev->inflight[slot][i];
+		size = ahci_request_size(req);
+		tbl->prdt[i].dba = ahci_request_phys(req);
+		tbl->prdt[i].dbau = 0;
+		tbl->prdt[i].dbc = size - 1;
+		nsectors += size >> AHCI_SECTOR_SIZE_LOG2;
+	}
+	
+	/* Update statistics. */
+	dev->stats.io.seek += ((addr > dev->pos) ? (addr - dev->pos) : 
+		(dev->pos - addr)) >> (BLOCK_SIZE_LOG2 - AHCI_SECTOR_SIZE_LOG2);
+	dev->pos = addr + nsectors;
+	
+	/*
+	 * Queued commands carry the sector count in the
+	 * features register and the tag in the count register.
+	 */
+	if (dev->flags & AHCIDEV_NCQ)
+	{
+		ahci_fis(tbl, (write) ? ATA_CMD_WRITE_FPDMA : ATA_CMD_READ_FPDMA,
+			addr, slot << 3, nsectors);
+	}
+	else
+	{
+		ahci_fis(tbl, (write) ? ATA_CMD_WRITE_DMA_EXT : ATA_CMD_READ_DMA_EXT,
+			addr, nsectors, 0);
+	}
+	
+	ahci_cmdhdr(ahcidevid, slot, n, write);
+	ahci_issue(dev, slot, dev->flags & AHCIDEV_NCQ);
+}
+
+/*
+ * Issues a flush cache command on a slot of a device.
+ */
+PRIVATE void ahci_flush_op(unsigned ahcidevid, int slot)
+{
+	struct cmdtbl *tbl;
+	
+	tbl = &cmdtbls[ahcidevid][slot];
+	
+	ahci_fis(tbl, ATA_CMD_FLUSH_CACHE_EXT, 0, 0, 0);
+	ahci_cmdhdr(ahcidevid, slot, 0, 0);
+	ahci_issue(&ahci_devices[ahcidevid], slot, 0);
+}
+
+/*
+ * Issues as many pending requests of a device as there are free
+ * command slots. A barrier is issued alone, once everything that
+ * came before it is done, since queued and non-queued commands
+ * cannot be mixed.
+ */
+PRIVATE void ahci_start(unsigned ahcidevid)
+{
+	int slot;            /* Command slot. */
+	struct ahcidev *dev; /* AHCI device.  */
+	
+	dev = &ahci_devices[ahcidevid];
+	
+	while (dev->queue.pending != NULL)
+	{
+		if ((slot = ahci_slot(dev)) < 0)
+			return;
+		
+		dev->nmerged[slot] = ahci_merge(dev, slot);
+		ahci_rw_op(ahcidevid, slot);
+	}
+	
+	if ((dev->queue.barrier != NULL) && (dev->busy == 0))
+	{
+		dev->nmerged[0] = 1;
+		dev->inflight[0][0] = dev->queue.barrier;
+		ahci_flush_op(ahcidevid, 0);
+	}
+}
+
+/*
+ * Schedules a block disk IO operation. Synchronous
+ * operations return their completion status.
+ */
+PRIVATE int ahci_sched(unsigned ahcidevid, unsigned flags, ...)
+{
+	int status;          /* Completion status. */
+	va_list args;        /* Variable arg list. */
+	struct ahcidev *dev; /* AHCI device.       */
+	struct request *req; /* Request.           */
+	
+	dev = &ahci_devices[ahcidevid];
+	status = 0;
+
+	disable_interrupts();
+	
+		/* Wait for a slot in the block operation queue. */
+		while ((dev->queue.free == NULL) ||
+			((flags & REQ_FLUSH) && (dev->queue.barrier != NULL)))
+			sleep_excl(&dev->queue.chain, PRIO_IO);
+		
+		req = dev->queue.free;
+		dev->queue.free = req->next;
+		
+		va_start(args, flags);
+		
+		/* Create request. */
+		req->flags = flags;
+		if (flags & REQ_BUF)
+			req->u.buffered.buf = va_arg(args, buffer_t);
+		else if (!(flags & REQ_FLUSH))
+		{
+			req->u.raw.num = va_arg(args, block_t);
+			req->u.raw.buf = va_arg(args, unsigned char *);
+			req->u.raw.phys = va_arg(args, addr_t);
+			req->u.raw.size = va_arg(args, size_t);
+		}
+		
+		va_end(args);
+		
+		/* Enqueue request. */
+		req->done = 0;
+		req->status = 0;
+		waitq_init(&req->chain);
+		req->issued = ticks;
+		ahci_enqueue(dev, req);
+		dev->queue.size++;
+		bdev_acct_issue(&dev->stats);
+		
+		ahci_start(ahcidevid);
+		
+		/*
+		 * Wait operation to complete. The interrupt handler
+		 * leaves synchronous requests for us to release.
+		 */
+		if (flags & REQ_SYNC)
+		{
+			while (!req->done)
+				sleep(&req->chain, PRIO_IO);
+			
+			status = req->status;
+			
+			req->next = dev->queue.free;
+			dev->queue.free = req;
+			wakeup(&dev->queue.chain);
+		}
+	
+	enable_interrupts();
+	
+	return (status);
+}
+
+/*============================================================================*
+ *                           High-Level Routines                              *
+ *============================================================================*/
+
+/*
+ * Asserts if a minor device is a valid AHCI device.
+ */
+#define ahci_valid(minor) \
+	(((minor) < AHCI_DEV_MAX) && (ahci_devices[minor].flags & AHCIDEV_VALID))
+
+/*
+ * Reads a block from a AHCI device.
+ */
+PRIVATE int ahci_readblk(unsigned minor, buffer_t buf)
+{
+	unsigned flags;
+	
+	/* Invalid minor device. */
+	if (!ahci_valid(minor))
+		return (-EINVAL);
+	
+	/* Nobody waits for read-ahead blocks. */
+	buffer_valid(buf, 0);
+	flags = REQ_BUF | (buffer_is_async(buf) ? 0 : REQ_SYNC);
+	
+	return (ahci_sched(minor, flags, buf));
+}
+
+/*
+ * Writes a block to a AHCI device.
+ */
+PRIVATE int ahci_writeblk(unsigned minor, buffer_t buf)
+{
+	unsigned flags;
+	
+	/* Invalid minor device. */
+	if (!ahci_valid(minor))
+		return (-EINVAL);
+	
+	flags = REQ_BUF | REQ_WRITE | (buffer_is_sync(buf) ? REQ_SYNC : 0);
+	
+	return (ahci_sched(minor, flags, buf));
+}
+
+/*
+ * Asserts if a buffer is a page-aligned user buffer. Transfers are
+ * split in page-sized chunks, so each of them then lies within a
+ * single user page and may be serviced with DMA straight to it.
+ */
+#define ahci_direct(buf)                                             \
+	(!((addr_t)(buf) & ~PAGE_MASK) &&                                 \
+	 ((addr_t)(buf) >= UBASE_VIRT) && ((addr_t)(buf) < KBASE_VIRT))
+
+/*
+ * Transfers bytes from/to a AHCI device, a page at a time.
+ */
+PRIVATE ssize_t
+ahci_transfer(unsigned minor, char *buf, size_t n, off_t off, int write)
+{
+	size_t i;           /* Loop index.                   */
+	size_t count;       /* # bytes to transfer.          */
+	block_t blknum;     /* Block number.                 */
+	block_t nblocks;    /* Number of blocks.             */
+	unsigned char *kpg; /* Kernel page used for copying. */
+	addr_t phys;        /* Physical page address.        */
+	int err;            /* Error code.                   */
+	
+	/* Invalid minor device. */
+	if (!ahci_valid(minor))
+		return (-EINVAL);
+	
+	/* Bad offset or size. */
+	if ((off & (BLOCK_SIZE - 1)) || (n & (BLOCK_SIZE - 1)))
+		return (-EINVAL);
+	
+	nblocks = ahci_devices[minor].nsectors/AHCI_BLOCK_SECTORS;
+	
+	/*
+	 * Page-aligned user buffers are transferred
+	 * straight from/to user memory, while anything
+	 * else bounces through a kernel page.
+	 */
+	kpg = NULL;
+	if (!ahci_direct(buf))
+	{
+		kpg = getkpg(0);
+		if (kpg == NULL)
+			return (-ENOMEM);
+	}
+	
+	for (i = 0; i < n; noop())
+	{
+		blknum = off >> BLOCK_SIZE_LOG2;
+		
+		/* End of disk. */
+		if (blknum >= nblocks)
+			break;
+		
+		count = ((n - i) >= PAGE_SIZE) ? PAGE_SIZE : (n - i);
+		
+		/* Transfer as much as we can. */
+		if (blknum + (count >> BLOCK_SIZE_LOG2) > nblocks)
+			count = (nblocks - blknum) << BLOCK_SIZE_LOG2;
+		
+		/* Zero-copy transfer. */
+		if (kpg == NULL)
+		{
+			err = -EFAULT;
+			if ((phys = pinupg((addr_t)(buf + i), !write)) != 0)
+			{
+				err = ahci_sched(minor, REQ_SYNC | (write ? REQ_WRITE : 0),
+					blknum, NULL, phys, count);
+				unpinupg((addr_t)(buf + i));
+			}
+		}
+		
+		else
+		{
+			if (write)
+				kmemcpy(kpg, buf + i, count);
+			
+			err = ahci_sched(minor, REQ_SYNC | (write ? REQ_WRITE : 0),
+				blknum, kpg, ahci_phys(kpg), count);
+			
+			if ((!write) && (err == 0))
+				kmemcpy(buf + i, kpg, count);
+		}
+		
+		/* Device error. */
+		if (err < 0)
+		{
+			if (kpg != NULL)
+				putkpg(kpg);
+			return ((i > 0) ? (ssize_t)i : err);
+		}
+		
+		i += count;
+		off += count;
+		
+		/* Avoid starvation. */
+		if ((n - i) > 0)
+			yield();
+	}
+	
+	if (kpg != NULL)
+		putkpg(kpg);
+	return ((ssize_t)i);
+}
+
+/*
+ * Reads bytes from a AHCI device.
+ */
+PRIVATE ssize_t ahci_read(unsigned minor, char *buf, size_t n, off_t off)
+{
+	return (ahci_transfer(minor, buf, n, off, 0));
+}
+
+/*
+ * Writes bytes to a AHCI device.
+ */
+PRIVATE ssize_t ahci_write(unsigned minor, const char *buf, size_t n, off_t off)
+{
+	return (ahci_transfer(minor, (char *)buf, n, off, 1));
+}
+
+/*
+ * Gets I/O statistics of a AHCI device.
+ */
+PRIVATE int ahci_stat(unsigned minor, struct iostat *buf)
+{
+	struct iostat st;
+	
+	/* Invalid minor device. */
+	if (!ahci_valid(minor))
+		return (-EINVAL);
+	
+	disable_interrupts();
+	bdev_acct_stat(&ahci_devices[minor].stats, &st);
+	enable_interrupts();
+	
+	kmemcpy(buf, &st, sizeof(struct iostat));
+	
+	return (0);
+}
+
+/*
+ * Flushes the write cache of a AHCI device.
+ */
+PRIVATE int ahci_flush(unsigned minor)
+{
+	/* Invalid minor device. */
+	if (!ahci_valid(minor))
+		return (-EINVAL);
+	
+	return (ahci_sched(minor, REQ_FLUSH | REQ_SYNC));
+}
+
+/*
+ * AHCI device operations.
+ */
+PRIVATE const struct bdev ahci_ops = {
+	&ahci_read,     /* read()     */
+	&ahci_write,    /* write()    */
+	&ahci_readblk,  /* readblk()  */
+	&ahci_writeblk, /* writeblk() */
+	&ahci_stat,     /* stat()     */
+	&ahci_flush,    /* flush()    */
+	NULL            /* direct()   */
+};
+
+/*============================================================================*
+ *                            Interrupt Handling                              *
+ *============================================================================*/
+
+/*
+ * Completes a request.
+ */
+PRIVATE void ahci_complete(struct ahcidev *dev, struct request *req, int err)
+{
+	/*
+	 * Barrier is done, so release
+	 * requests that were held back.
+	 */
+	if (req->flags & REQ_FLUSH)
+	{
+		dev->queue.barrier = NULL;
+		dev->queue.pending = dev->queue.held;
+		dev->queue.held = NULL;
+	}
+	
+	/* Write operation. */
+	else if (req->flags & REQ_WRITE)
+	{
+		/* Release buffer. */
+		if (req->flags & REQ_BUF)
+		{
+			buffer_dirty(req->u.buffered.buf, 0);
+			brelse(req->u.buffered.buf);
+		}
+	}
+	
+	/* Buffered read operation. */
+	else if (req->flags & REQ_BUF)
+	{
+		/* Block contents are garbage. */
+		if (err == 0)
+			buffer_valid(req->u.buffered.buf, 1);
+		
+		/* Release read-ahead buffer. */
+		if (!(req->flags & REQ_SYNC))
+			brelse(req->u.buffered.buf);
+	}
+	
+	dev->queue.size--;
+	
+	/* Update statistics. */
+	if (req->flags & REQ_FLUSH)
+		bdev_acct_done(&dev->stats, BDEV_FLUSH, 0, req->issued);
+	else
+	{
+		bdev_acct_done(&dev->stats,
+			(req->flags & REQ_WRITE) ? BDEV_WRITE : BDEV_READ,
+			ahci_request_size(req), req->issued);
+	}
+	
+	/* Wakeup owner, that will release the request. */
+	if (req->flags & REQ_SYNC)
+	{
+		req->status = err;
+		req->done = 1;
+		wakeup(&req->chain);
+	}
+	
+	/* Release request. */
+	else
+	{
+		req->next = dev->queue.free;
+		dev->queue.free = req;
+	}
+}
+
+/*
+ * Handles an interrupt on the port of a AHCI device.
+ */
+PRIVATE void ahci_port_handler(unsigned ahcidevid)
+{
+	int i;               /* Loop index.       */
+	int slot;            /* Command slot.     */
+	int err;             /* Error?            */
+	uint32_t is;         /* Interrupt status. */
+	uint32_t done;       /* Completed slots.  */
+	struct ahcidev *dev; /* AHCI device.      */
+	
+	dev = &ahci_devices[ahcidevid];
+	
+	is = port_reg(dev->port, AHCI_PX_IS);
+	port_reg(dev->port, AHCI_PX_IS) = is;
+	
+	/*
+	 * A failed NCQ command aborts all others that
+	 * are queued on the device, so fail all of them
+	 * and restart the port to clear the error.
+	 */
+	if (is & AHCI_PX_IS_ERROR)
+	{
+		kprintf("sd%c: device error", 'a' + ahcidevid);
+		err = -EIO;
+		done = dev->busy;
+		
+		ahci_port_stop(dev->port);
+		port_reg(dev->port, AHCI_PX_SERR) = 0xffffffff;
+		port_reg(dev->port, AHCI_PX_IS) = 0xffffffff;
+		ahci_port_start(dev->port);
+	}
+	
+	else
+	{
+		err = 0;
+		done = dev->busy & ~(port_reg(dev->port, AHCI_PX_SACT) |
+			port_reg(dev->port, AHCI_PX_CI));
+	}
+	
+	/* Complete all requests served by completed commands. */
+	for (slot = 0; slot < AHCI_NR_SLOTS; slot++)
+	{
+		if (!(done & (1 << slot)))
+			continue;
+		
+		for (i = 0; i < dev->nmerged[slot]; i++)
+			ahci_complete(dev, dev->inflight[slot][i], err);
+		
+		bdev_acct_end(&dev->stats, dev->nmerged[slot]);
+		dev->nmerged[slot] = 0;
+		dev->busy &= ~(1 << slot);
+	}
+	
+	/* Process next operations. */
+	ahci_start(ahcidevid);
+	
+	/*
+	 * Wakeup processes that were waiting for
+	 * an empty slot in the block operation queue.
+	 */
+	if (done)
+		wakeup(&dev->queue.chain);
+}
+
+/*
+ * AHCI interrupt handler.
+ */
+PRIVATE void ahci_handler(void)
+{
+	unsigned i;  /* Loop index.       */
+	uint32_t is; /* Interrupt status. */
+	
+	is = hba_reg(AHCI_REG_IS);
+	
+	for (i = 0; i < AHCI_DEV_MAX; i++)
+	{
+		if (!(ahci_devices[i].flags & AHCIDEV_VALID))
+			continue;
+		
+		if (is & (1 << ahci_devices[i].port))
+			ahci_port_handler(i);
+	}
+	
+	hba_reg(AHCI_REG_IS) = is;
+}
+
+/*============================================================================*
+ *                               ahci_init()                                  *
+ *============================================================================*/
+
+/**
+ * @brief Initializes the AHCI device driver.
+ */
+PUBLIC void ahci_init(void)
+{
+	int port;           /* HBA port.          */
+	unsigned irq;       /* Interrupt line.    */
+	unsigned n;         /* Number of devices. */
+	uint32_t cap;       /* HBA capabilities.  */
+	uint32_t pi;        /* Ports implemented. */
+	uint32_t reg;       /* Working register.  */
+	struct pci_dev pci; /* PCI SATA device.   */
+	
+	/* No SATA controller on PCI. */
+	if (pci_find(&pci, PCI_CLASS_STORAGE, PCI_STORAGE_SATA))
+		return;
+	
+	/* Not an AHCI controller. */
+	if (((pci_read(&pci, PCI_REG_CLASS) >> 8) & 0xff) != 0x01)
+		return;
+	
+	/* HBA registers must be in memory space. */
+	reg = pci_read(&pci, PCI_REG_BAR5);
+	if ((reg & 1) || ((reg & ~0xf) == 0))
+		return;
+	
+	irq = pci_read(&pci, PCI_REG_IRQ) & 0xff;
+	if (irq >= 16)
+	{
+		kprintf("ahci: no interrupt line");
+		return;
+	}
+	
+	abar = mapiomem(reg & ~0xf, AHCI_ABAR_SIZE);
+	if (abar == NULL)
+		return;
+	
+	/* Enable memory space and bus mastering. */
+	reg = pci_read(&pci, PCI_REG_COMMAND);
+	pci_write(&pci, PCI_REG_COMMAND, reg | PCI_CMD_MEMORY | PCI_CMD_MASTER);
+	
+	hba_reg(AHCI_REG_GHC) |= AHCI_GHC_AE;
+	cap = hba_reg(AHCI_REG_CAP);
+	pi = hba_reg(AHCI_REG_PI);
+	
+	/* Detect devices. */
+	for (port = 0, n = 0; (port < 32) && (n < AHCI_DEV_MAX); port++)
+	{
+		if (!(pi & (1 << port)))
+			continue;
+		
+		if (ahci_setup(n, port, cap))
+			continue;
+		
+		kprintf("sd%c: SATA HDD detected.", 'a' + n);
+		kprintf("sd%c: %d sectors.", 'a' + n,
+			(unsigned)ahci_devices[n].nsectors);
+		if (ahci_devices[n].flags & AHCIDEV_NCQ)
+			kprintf("sd%c: NCQ enabled, %d commands in flight.", 'a' + n,
+				ahci_devices[n].depth);
+		n++;
+	}
+	
+	/* Register interrupt handler. */
+	if (set_hwint(irq, &ahci_handler))
+	{
+		kprintf("ahci: IRQ %d busy", irq);
+		for (port = 0; port < AHCI_DEV_MAX; port++)
+			ahci_devices[port].flags = 0;
+		return;
+	}
+	
+	hba_reg(AHCI_REG_IS) = 0xffffffff;
+	hba_reg(AHCI_REG_GHC) |= AHCI_GHC_IE;
+	
+	bdev_register(AHCI_MAJOR, &ahci_ops);
+}
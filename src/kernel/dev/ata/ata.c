@@ -17,13 +17,19 @@
  * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <nanvix/clock.h>
+#include <nanvix/config.h>
 #include <nanvix/const.h>
 #include <nanvix/dev.h>
 #include <nanvix/fs.h>
 #include <nanvix/hal.h>
 #include <nanvix/klib.h>
+#include <nanvix/ktrace.h>
 #include <nanvix/mm.h>
 #include <nanvix/pm.h>
+#include <dev/pci.h>
+#include <sys/ioprio.h>
+#include <sys/iostat.h>
 #include <sys/types.h>
 #include <errno.h>
 #include <stdarg.h>
@@ -44,6 +50,14 @@
 /* ATA sector size (in bytes). */
 #define ATA_SECTOR_SIZE (1 << ATA_SECTOR_SIZE_LOG2)
 
+/*
+ * Merged commands shall fit in the
+ * low byte of the sector count register.
+ */
+#if ((ATA_MERGE_MAX << (BLOCK_SIZE_LOG2 - ATA_SECTOR_SIZE_LOG2)) > 255)
+	#error "ATA_MERGE_MAX too large"
+#endif
+
 /* ATA controller registers. */
 #define ATA_REG_DATA    0 /* Data register.             */
 #define ATA_REG_ERR     1 /* Error register.            */
@@ -58,6 +72,9 @@
 #define ATA_REG_STATUS  7 /* Status register.           */
 #define ATA_REG_ASTATUS 8 /* Alternate status register. */
 
+/* ATA device control register. */
+#define ATA_NIEN (1 << 1) /* Disable interrupts. */
+
 /* ATA status register. */
 #define ATA_ERR   (1 << 0) /* Device error. */
 #define ATA_DRQ   (1 << 3) /* Data request. */
@@ -72,8 +89,13 @@
 #define ATA_CMD_READ_SECTORS_EXT	0x24 /* Read sectors using LBA 48-bit.  */
 #define ATA_CMD_WRITE_SECTORS		0x30 /* Write sectors using LBA 28-bit. */
 #define ATA_CMD_WRITE_SECTORS_EXT	0x34 /* Write sectors using LBA 48-bit. */
+#define ATA_CMD_READ_DMA_EXT		0x25 /* Read DMA using LBA 48-bit.      */
+#define ATA_CMD_WRITE_DMA_EXT		0x35 /* Write DMA using LBA 48-bit.     */
 #define ATA_CMD_FLUSH_CACHE			0xe7 /* Flush cache using LBA 28-bit.   */
 #define ATA_CMD_FLUSH_CACHE_EXT		0xeA /* Flush cache using LBA 48-bit.   */
+#define ATA_CMD_READ_MULTIPLE_EXT	0x29 /* Read multiple using LBA 48-bit. */
+#define ATA_CMD_WRITE_MULTIPLE_EXT	0x39 /* Write multiple using LBA 48-bit.*/
+#define ATA_CMD_SET_MULTIPLE		0xc6 /* Set multiple mode.              */
 	
 /* ATA device information. */
 #define ATA_INFO_WORDS            256 /* # words returned by identify cmd. */
@@ -170,30 +192,71 @@ struct ata_info
 /* ATA device maximum queue size. */
 #define ATADEV_QUEUE_SIZE 64
 
+/*
+ * Maximum time (in clock ticks) that a synchronous
+ * read may wait in the queue before being served
+ * out of elevator order.
+ */
+#define ATA_READ_DEADLINE (CLOCK_FREQ/4)
+
+/* Time (in clock ticks) after which a synchronous request is reported. */
+#define ATA_TIMEOUT (5*CLOCK_FREQ)
+
+/*
+ * Maximum time (in 400 ns delays) that a device may
+ * take to answer the identify command, so that a
+ * missing device does not stall boot.
+ */
+#define ATA_PROBE_TIMEOUT 250000
+
+/*
+ * Weights of I/O scheduling classes. While several classes have
+ * pending requests, each one gets to start that many commands
+ * in every round.
+ */
+PRIVATE const int ata_weights[IOPRIO_CLASSES] = {
+	16, /* Real-time.   */
+	4,  /* Best-effort. */
+	1   /* Idle.        */
+};
+
 /* ATA device flags. */
-#define ATADEV_VALID   (1 << 0) /* Valid device?     */
-#define ATADEV_DISCARD (1 << 1) /* Discard next IRQ? */
+#define ATADEV_VALID   (1 << 0) /* Valid device?          */
+#define ATADEV_BMDMA   (1 << 2) /* Use bus master DMA?    */
+#define ATADEV_MULT    (1 << 3) /* Use multiple mode?     */
+
+/* Maximum number of sectors per DRQ block in multiple mode. */
+#define ATA_MULTSECT_MAX 16
 
 /* Request flags. */
 #define REQ_WRITE (1 << 0) /* Write request?         */
 #define REQ_BUF   (1 << 1) /* Buffered request?      */
 #define REQ_SYNC  (1 << 2) /* Synchronous operation? */
+#define REQ_FLUSH (1 << 3) /* Write barrier?         */
 
 /*
  * I/O operation request.
  */
 struct request
 {
-	unsigned flags; /* Flags (see above). */
+	unsigned flags;        /* Flags (see above).            */
+	int ioclass;           /* I/O scheduling class.         */
+	unsigned deadline;     /* Expiration time (in ticks).   */
+	unsigned issued;       /* Issue time (in ticks).        */
+	struct request *next;  /* Next request in the queue.    */
+	int done;              /* Completed?                    */
+	int status;            /* Completion status.            */
+	struct waitq chain;    /* Owner waiting for completion. */
 	
 	union
 	{
 		/* Raw request. */
 		struct
 		{
-			block_t num;        /* Block number. */
-			size_t size;        /* Buffer size.  */
-			unsigned char *buf; /* Buffer.       */
+			block_t num;        /* Block number.     */
+			size_t size;        /* Buffer size.      */
+			unsigned char *buf; /* Buffer.           */
+			addr_t phys;        /* Physical address. */
 		} raw;
 		
 		/* Buffered request. */
@@ -212,20 +275,60 @@ PRIVATE struct atadev
 	/* General information. */
 	int flags;             /* Flags (see above).                         */
 	struct ata_info info;  /* Device information.                        */
-	struct process *chain; /* Process waiting for operation to complete. */
+	struct bdev_acct stats; /* I/O statistics.                           */
+	
+	/* Current command. */
+	int nmerged;                              /* # requests served.    */
+	unsigned nsectors;                        /* # sectors to transfer.*/
+	unsigned sector;                          /* Next sector (PIO).    */
+	unsigned multsect;                        /* Sectors per DRQ block.*/
+	struct request *inflight[ATA_MERGE_MAX]; /* Requests served.      */
+	uint64_t pos;                             /* Head position (LBA).  */
 	
-	/* Block operation queue. */
+	/*
+	 * Block operation queue. Pending requests are kept
+	 * sorted by address, and are served in C-SCAN order.
+	 */
 	struct
 	{
 		int size;                                   /* Current size.         */
-		int head;                                   /* Head.                 */
-		int tail;                                   /* Tail.                 */
+		struct request *free;                       /* Free requests.        */
+		struct request *pending;                    /* Pending requests.     */
+		struct request *barrier;                    /* Pending barrier.      */
+		struct request *held;                       /* Requests held back by *
+		                                             * the pending barrier.  */
 		struct request requests[ATADEV_QUEUE_SIZE]; /* Blocks.               */
-		struct process *chain;                      /* Processes wanting for *
+		struct waitq chain;                         /* Processes wanting for *
 		                                             * a slot in the queue.  */
+		int credit[IOPRIO_CLASSES];                 /* Commands left to each *
+		                                             * class in this round.  */
 	} queue;
 } ata_devices[4];
 
+/*
+ * ATA buses. Each bus runs one command at a time, on
+ * behalf of one of its devices, independently of the other.
+ */
+PRIVATE struct
+{
+	int active;    /* Device with a command in flight, or -1. */
+	int pending;   /* IRQ waiting for the bottom half?         */
+	byte_t status; /* Status read when the IRQ was taken.      */
+} ata_buses[2] = {
+	{ -1, 0, 0 }, /* Primary bus.   */
+	{ -1, 0, 0 }  /* Secondary bus. */
+};
+
+/*
+ * Device probes. Both buses are probed at once, masters
+ * first and slaves next, with device interrupts disabled.
+ */
+PRIVATE struct
+{
+	int type;         /* Device type, or -1 while probing. */
+	unsigned timeout; /* Delays left before giving up.     */
+} ata_probes[4];
+
 /*
  * Default I/O ports for ATA controller.
  */
@@ -236,6 +339,55 @@ PRIVATE uint16_t pio_ports[2][9] = {
 	{ 0x170, 0x171, 0x172, 0x173, 0x174, 0x175, 0x176, 0x177, 0x376 }
 };
 
+/* Bus master IDE registers (offsets from the bus' base port). */
+#define BMIDE_REG_CMD    0 /* Command register.           */
+#define BMIDE_REG_STATUS 2 /* Status register.            */
+#define BMIDE_REG_PRDT   4 /* PRD table address register. */
+
+/* Bus master IDE command register. */
+#define BMIDE_START (1 << 0) /* Start transfer.              */
+#define BMIDE_READ  (1 << 3) /* Transfer to memory (read)?   */
+
+/* Bus master IDE status register. */
+#define BMIDE_ACTIVE (1 << 0) /* Transfer active?     */
+#define BMIDE_ERROR  (1 << 1) /* Transfer failed?     */
+#define BMIDE_IRQ    (1 << 2) /* Interrupt requested? */
+
+/* Maximum number of physical region descriptors per bus. */
+#define ATA_PRD_MAX ATA_MERGE_MAX
+
+/* Last physical region descriptor in a table. */
+#define PRD_EOT 0x8000
+
+/*
+ * Physical region descriptor.
+ */
+struct prd
+{
+	uint32_t addr;  /* Physical address of the region.  */
+	uint16_t size;  /* Region size (0 means 64 KB).     */
+	uint16_t flags; /* Flags (see above).               */
+} __attribute__((packed));
+
+/*
+ * Base I/O ports of bus master IDE controller,
+ * or zero if the bus does not support DMA.
+ */
+PRIVATE uint16_t bmide_ports[2] = { 0, 0 };
+
+/*
+ * Physical region descriptor tables. These shall not
+ * cross a 64 KB boundary, hence the alignment.
+ */
+PRIVATE struct prd prdt[2][ATA_PRD_MAX]
+	__attribute__((aligned(2*ATA_PRD_MAX*sizeof(struct prd))));
+
+/*
+ * Converts a kernel virtual address into a physical address.
+ */
+#define ata_phys(x) \
+	((uint32_t)(x) - KBASE_VIRT + KBASE_PHYS)
+
 /*============================================================================*
  *                            Low-Level Routines                              *
  *============================================================================*/
@@ -293,10 +445,410 @@ PRIVATE void ata_device_select(int atadevid)
  */
 PRIVATE void ata_bus_wait(int bus)
 {
-	while (inputb(pio_ports[bus][ATA_REG_ASTATUS] & ATA_BUSY))
+	while (inputb(pio_ports[bus][ATA_REG_ASTATUS]) & ATA_BUSY)
 		/* noop*/ ;
 }
 
+/*
+ * Waits ATA bus to be ready while probing, giving up
+ * after ATA_PROBE_TIMEOUT delays.
+ */
+PRIVATE int ata_bus_wait_probe(int bus)
+{
+	for (unsigned i = 0; i < ATA_PROBE_TIMEOUT; i++)
+	{
+		if (!(inputb(pio_ports[bus][ATA_REG_ASTATUS]) & ATA_BUSY))
+			return (0);
+		
+		ata_delay();
+	}
+	
+	return (-1);
+}
+
+/*
+ * Sends LBA 48-bit address and sector count to a ATA device.
+ */
+PRIVATE void ata_lba48(int atadevid, uint64_t addr, size_t size)
+{
+	int bus;
+	
+	bus = ata_bus(atadevid);
+	
+	/*
+	 * Set LBA bit, to specify that the address
+	 * is in LBA, keeping the device selected.
+	 */
+	outputb(pio_ports[bus][ATA_REG_DEVCTL], 0x40 | ((atadevid & 1) << 4));
+	
+	/* Send the three highest bytes of the address. */
+	outputb(pio_ports[bus][ATA_REG_NSECT], 0x00);
+	outputb(pio_ports[bus][ATA_REG_LBAL], (addr >> 0x18) & 0xff);
+	outputb(pio_ports[bus][ATA_REG_LBAM], (addr >> 0x20) & 0xff);
+	outputb(pio_ports[bus][ATA_REG_LBAH], (addr >> 0x28) & 0xff);
+
+	/* Send the three lowest bytes of the address. */
+	outputb(pio_ports[bus][ATA_REG_NSECT], size/ATA_SECTOR_SIZE);
+	outputb(pio_ports[bus][ATA_REG_LBAL], (addr >> 0x00) & 0xff);
+	outputb(pio_ports[bus][ATA_REG_LBAM], (addr >> 0x08) & 0xff);
+	outputb(pio_ports[bus][ATA_REG_LBAH], (addr >> 0x10) & 0xff);
+}
+
+/*
+ * Returns the ith request served by the current command of a device.
+ */
+PRIVATE struct request *ata_request(struct atadev *dev, int i)
+{
+	return (dev->inflight[i]);
+}
+
+/*
+ * Returns the data buffer of a request.
+ */
+PRIVATE unsigned char *ata_request_data(struct request *req)
+{
+	if (req->flags & REQ_BUF)
+		return (buffer_data(req->u.buffered.buf));
+	
+	return (req->u.raw.buf);
+}
+
+/*
+ * Returns the physical address of the data buffer of a request.
+ */
+PRIVATE addr_t ata_request_phys(struct request *req)
+{
+	if (req->flags & REQ_BUF)
+		return (ata_phys(buffer_data(req->u.buffered.buf)));
+	
+	return (req->u.raw.phys);
+}
+
+/*
+ * Returns the size (in bytes) of a request.
+ */
+PRIVATE size_t ata_request_size(struct request *req)
+{
+	if (req->flags & REQ_BUF)
+		return (BLOCK_SIZE);
+	
+	return (req->u.raw.size);
+}
+
+/*
+ * Returns the LBA address of a request.
+ */
+PRIVATE uint64_t ata_request_addr(struct request *req)
+{
+	block_t num;
+	
+	num = (req->flags & REQ_BUF) ? 
+		buffer_num(req->u.buffered.buf) : req->u.raw.num;
+	
+	return ((uint64_t)num << (BLOCK_SIZE_LOG2 - ATA_SECTOR_SIZE_LOG2));
+}
+
+/*
+ * Inserts a request in the block operation queue of a device.
+ */
+PRIVATE void ata_enqueue(struct atadev *dev, struct request *req)
+{
+	uint64_t addr;         /* Request address. */
+	struct request **link; /* Working link.    */
+	
+	/* Write barrier. */
+	if (req->flags & REQ_FLUSH)
+	{
+		dev->queue.barrier = req;
+		return;
+	}
+	
+	addr = ata_request_addr(req);
+	
+	/*
+	 * Keep pending requests sorted by address. Requests for the
+	 * same address are served in arrival order. Requests that
+	 * arrive after a barrier cannot be served before it, so 
+	 * they are held back until the barrier completes.
+	 */
+	link = (dev->queue.barrier != NULL) ? 
+		&dev->queue.held : &dev->queue.pending;
+	for (/* noop */; *link != NULL; link = &(*link)->next)
+	{
+		if (ata_request_addr(*link) > addr)
+			break;
+	}
+	
+	req->next = *link;
+	*link = req;
+}
+
+/*
+ * Picks the I/O scheduling class of the next command. The most urgent
+ * class with pending requests and commands left in the current round
+ * is chosen, and a new round starts when there is none.
+ */
+PRIVATE int ata_pick_class(struct atadev *dev)
+{
+	int c;               /* I/O scheduling class.  */
+	unsigned backlog;    /* Classes with requests. */
+	struct request *req; /* Working request.       */
+	
+	backlog = 0;
+	for (req = dev->queue.pending; req != NULL; req = req->next)
+		backlog |= 1 << req->ioclass;
+	
+	for (c = 0; c < IOPRIO_CLASSES; c++)
+	{
+		if ((backlog & (1 << c)) && (dev->queue.credit[c] > 0))
+			break;
+	}
+	
+	/* New round. */
+	if (c == IOPRIO_CLASSES)
+	{
+		for (c = 0; c < IOPRIO_CLASSES; c++)
+			dev->queue.credit[c] = ata_weights[c];
+		for (c = 0; !(backlog & (1 << c)); c++)
+			/* noop */;
+	}
+	
+	dev->queue.credit[c]--;
+	
+	return (c);
+}
+
+/*
+ * Picks the next pending request to be served and returns the
+ * link that points to it. Only requests of the class chosen by
+ * ata_pick_class() are considered. Among them, synchronous reads
+ * that have been waiting for too long are served first; otherwise,
+ * the first request at or after the current head position is chosen,
+ * wrapping around to the lowest address when there are none (C-SCAN).
+ */
+PRIVATE struct request **ata_pick(struct atadev *dev)
+{
+	int c;                    /* I/O scheduling class. */
+	struct request **link;    /* Working link.         */
+	struct request **first;   /* Lowest address.       */
+	struct request **next;    /* Next in C-SCAN order. */
+	struct request **expired; /* Oldest expired read.  */
+	
+	c = ata_pick_class(dev);
+	
+	first = NULL;
+	next = NULL;
+	expired = NULL;
+	
+	for (link = &dev->queue.pending; *link != NULL; link = &(*link)->next)
+	{
+		/* Some other class. */
+		if ((*link)->ioclass != c)
+			continue;
+		
+		if (first == NULL)
+			first = link;
+		
+		/* Starving synchronous read. */
+		if ((((*link)->flags & (REQ_SYNC | REQ_WRITE)) == REQ_SYNC) &&
+			((int)(ticks - (*link)->deadline) >= 0))
+		{
+			if ((expired == NULL) ||
+				((int)((*link)->deadline - (*expired)->deadline) < 0))
+				expired = link;
+		}
+		
+		if ((next == NULL) && (ata_request_addr(*link) >= dev->pos))
+			next = link;
+	}
+	
+	if (expired != NULL)
+	{
+		dev->stats.io.expired++;
+		return (expired);
+	}
+	
+	return ((next != NULL) ? next : first);
+}
+
+/*
+ * Removes from the pending queue the next request to be served and
+ * the buffered requests of the same kind on consecutive blocks that
+ * follow it, so that all of them are served by a single multi-sector
+ * command. Returns the number of requests removed.
+ */
+PRIVATE int ata_merge(struct atadev *dev)
+{
+	int n;                 /* # requests to merge. */
+	unsigned kind;         /* Kind of request.     */
+	block_t num;           /* First block.         */
+	struct request *req;   /* Working request.     */
+	struct request **link; /* Working link.        */
+	
+	link = ata_pick(dev);
+	req = *link;
+	
+	kind = req->flags & (REQ_BUF | REQ_WRITE);
+	num = (req->flags & REQ_BUF) ? buffer_num(req->u.buffered.buf) : 0;
+	
+	for (n = 0; (*link != NULL) && (n < ATA_MERGE_MAX); n++)
+	{
+		req = *link;
+		
+		if (n > 0)
+		{
+			/* Raw requests are never merged. */
+			if (!(kind & REQ_BUF))
+				break;
+			
+			if ((req->flags & (REQ_BUF | REQ_WRITE)) != kind)
+				break;
+			
+			if (buffer_num(req->u.buffered.buf) != num + n)
+				break;
+		}
+		
+		dev->inflight[n] = req;
+		*link = req->next;
+	}
+	
+	return (n);
+}
+
+/*
+ * Transfers the next DRQ block of the current command of a device
+ * from/to the data port, a whole sector at a time.
+ */
+PRIVATE void ata_pio_transfer(unsigned atadevid, int write)
+{
+	int bus;            /* Bus number.          */
+	unsigned i;         /* Loop index.          */
+	unsigned n;         /* # sectors to move.   */
+	unsigned spr;       /* Sectors per request. */
+	unsigned char *buf; /* Sector buffer.       */
+	struct atadev *dev; /* ATA device.          */
+	
+	bus = ata_bus(atadevid);
+	dev = &ata_devices[atadevid];
+	spr = ata_request_size(ata_request(dev, 0)) >> ATA_SECTOR_SIZE_LOG2;
+	
+	n = dev->nsectors - dev->sector;
+	if (n > dev->multsect)
+		n = dev->multsect;
+	
+	for (i = 0; i < n; i++, dev->sector++)
+	{
+		buf = ata_request_data(ata_request(dev, dev->sector/spr)) +
+			((dev->sector%spr) << ATA_SECTOR_SIZE_LOG2);
+		
+		if (write)
+			outputsw(pio_ports[bus][ATA_REG_DATA], buf, ATA_SECTOR_SIZE/2);
+		else
+			inputsw(pio_ports[bus][ATA_REG_DATA], buf, ATA_SECTOR_SIZE/2);
+	}
+}
+
+/*============================================================================*
+ *                              DMA Routines                                  *
+ *============================================================================*/
+
+/*
+ * Looks for a bus master IDE controller.
+ */
+PRIVATE void ata_dma_init(void)
+{
+	uint32_t reg;       /* Working register. */
+	struct pci_dev pci; /* PCI IDE device.   */
+	
+	/* No IDE controller on PCI. */
+	if (pci_find(&pci, PCI_CLASS_STORAGE, PCI_STORAGE_IDE))
+		return;
+	
+	/* Controller does not support bus mastering. */
+	if (!(pci_read(&pci, PCI_REG_CLASS) & (0x80 << 8)))
+		return;
+	
+	/* Bus master registers must be in I/O space. */
+	reg = pci_read(&pci, PCI_REG_BAR4);
+	if (!(reg & 1) || ((reg & 0xfffc) == 0))
+		return;
+	
+	bmide_ports[ATA_BUS_PRIMARY] = reg & 0xfffc;
+	bmide_ports[ATA_BUS_SECONDARY] = (reg & 0xfffc) + 8;
+	
+	/* Enable bus mastering. */
+	reg = pci_read(&pci, PCI_REG_COMMAND);
+	pci_write(&pci, PCI_REG_COMMAND, reg | PCI_CMD_IO | PCI_CMD_MASTER);
+}
+
+/*
+ * Programs the bus master IDE controller for a
+ * transfer of the first n requests in the queue.
+ */
+PRIVATE void ata_dma_setup(int bus, struct atadev *dev, int n, int read)
+{
+	int i;               /* Loop index.           */
+	uint16_t port;       /* Bus master base port. */
+	struct request *req; /* Working request.      */
+	
+	port = bmide_ports[bus];
+	
+	/*
+	 * Buffers and kernel pages are physically
+	 * contiguous and never cross a 64 KB boundary,
+	 * so a single region per request is enough.
+	 */
+	for (i = 0; i < n; i++)
+	{
+		req = ata_request(dev, i);
+		prdt[bus][i].addr = ata_request_phys(req);
+		prdt[bus][i].size = ata_request_size(req);
+		prdt[bus][i].flags = 0;
+	}
+	prdt[bus][n - 1].flags = PRD_EOT;
+	
+	outputb(port + BMIDE_REG_CMD, 0);
+	outputl(port + BMIDE_REG_PRDT, ata_phys(prdt[bus]));
+	outputb(port + BMIDE_REG_CMD, (read) ? BMIDE_READ : 0);
+	
+	/* Clear error and interrupt bits. */
+	outputb(port + BMIDE_REG_STATUS,
+		inputb(port + BMIDE_REG_STATUS) | BMIDE_ERROR | BMIDE_IRQ);
+}
+
+/*
+ * Starts a bus master DMA transfer.
+ */
+PRIVATE void ata_dma_start(int bus)
+{
+	uint16_t port;
+	
+	port = bmide_ports[bus];
+	
+	outputb(port + BMIDE_REG_CMD, inputb(port + BMIDE_REG_CMD) | BMIDE_START);
+}
+
+/*
+ * Stops a bus master DMA transfer and returns its status.
+ */
+PRIVATE byte_t ata_dma_stop(int bus)
+{
+	uint16_t port;  /* Bus master base port. */
+	byte_t status;  /* Transfer status.      */
+	
+	port = bmide_ports[bus];
+	
+	outputb(port + BMIDE_REG_CMD, inputb(port + BMIDE_REG_CMD) & ~BMIDE_START);
+	status = inputb(port + BMIDE_REG_STATUS);
+	outputb(port + BMIDE_REG_STATUS, status | BMIDE_ERROR | BMIDE_IRQ);
+	
+	return (status);
+}
+
+/*============================================================================*
+ *                            Device Routines                                 *
+ *============================================================================*/
+
 /*
  * Sets up PATA device.
  */
@@ -305,6 +857,7 @@ PRIVATE int pata_setup(int atadevid)
 	int i;                    /* Loop index.             */
 	int bus;                  /* Bus number.             */
 	uint16_t status;          /* Status register.        */
+	unsigned multsect;        /* Sectors per DRQ block.  */
 	struct atadev *dev;       /* ATA device.             */
 	struct ata_info *devinfo; /* ATA device information. */
 	
@@ -312,19 +865,10 @@ PRIVATE int pata_setup(int atadevid)
 	dev = &ata_devices[atadevid];
 	devinfo = &dev->info;
 	
-	/* Probe device. */
-	while (1)
-	{
-		status = inputb(pio_ports[bus][ATA_REG_ASTATUS]);
-				
-		/* Device is online. */
-		if (status & ATA_DRQ)
-			break;
-					
-		/* Error when probing. */
-		if (status & ATA_ERR)
-			return (-1);
-	}
+	/* Error when probing. */
+	status = inputb(pio_ports[bus][ATA_REG_ASTATUS]);
+	if (!(status & ATA_DRQ) || (status & ATA_ERR))
+		return (-1);
 			
 	/* Ready information. */
 	for(i = 0; i < 256; i++)
@@ -351,26 +895,66 @@ PRIVATE int pata_setup(int atadevid)
 	if (ata_info_supports_dma(devinfo->rawinfo))
 		devinfo->flags |= ATADEV_DMA;
 	
-	dev->flags = ATADEV_VALID | ATADEV_DISCARD;
-	dev->queue.chain = NULL;
+	dev->flags = ATADEV_VALID;
+	dev->nmerged = 0;
+	dev->pos = 0;
+	
+	/* Use bus master DMA, if we can. */
+	if ((devinfo->flags & ATADEV_DMA) && (bmide_ports[bus] != 0))
+		dev->flags |= ATADEV_BMDMA;
+	
+	/* Use multiple mode for PIO, if we can. */
+	dev->multsect = 1;
+	multsect = devinfo->rawinfo[ATA_INFO_MAX_MULTSECT] & 0xff;
+	if (multsect > ATA_MULTSECT_MAX)
+		multsect = ATA_MULTSECT_MAX;
+	if (multsect > 1)
+	{
+		outputb(pio_ports[bus][ATA_REG_NSECT], multsect);
+		outputb(pio_ports[bus][ATA_REG_CMD], ATA_CMD_SET_MULTIPLE);
+		ata_delay();
+		
+		if ((ata_bus_wait_probe(bus) == 0) &&
+			(!(inputb(pio_ports[bus][ATA_REG_STATUS]) & ATA_ERR)))
+		{
+			dev->flags |= ATADEV_MULT;
+			dev->multsect = multsect;
+		}
+	}
+	waitq_init(&dev->queue.chain);
 	dev->queue.size = 0;
-	dev->queue.head = 0;
-	dev->queue.tail = 0;
-	dev->queue.chain = NULL;
+	dev->queue.pending = NULL;
+	dev->queue.barrier = NULL;
+	dev->queue.held = NULL;
+	dev->queue.free = NULL;
+	for (i = 0; i < ATADEV_QUEUE_SIZE; i++)
+	{
+		dev->queue.requests[i].next = dev->queue.free;
+		dev->queue.free = &dev->queue.requests[i];
+	}
 	
 	return (0);
 }
 
 /*
- * Issues identify command.
+ * Issues identify command, without waiting for the device to answer.
  */
-PRIVATE int ata_identify(int atadevid)
+PRIVATE void ata_identify(int atadevid)
 {
-	int bus;              /* Bus number.       */
-	uint8_t signature[2]; /* Device signature. */
+	int bus;       /* Bus number.      */
+	byte_t status; /* Status register. */
 	
 	bus = ata_bus(atadevid);
 	
+	kmemset(&ata_devices[atadevid], 0, sizeof(struct atadev));
+	ata_probes[atadevid].type = -1;
+	ata_probes[atadevid].timeout = ATA_PROBE_TIMEOUT;
+	
+	/* The answer is polled for. */
+	outputb(pio_ports[bus][ATA_REG_ASTATUS], ATA_NIEN);
+	
+	ata_device_select(atadevid);
+	
 	/*
 	 * ATA specification says that we should set these
 	 * values to zero before issuing an IDENTIFY command,
@@ -385,11 +969,38 @@ PRIVATE int ata_identify(int atadevid)
 	/* identify command. */	
 	outputb(pio_ports[bus][ATA_REG_CMD], ATA_CMD_IDENTIFY);
 		
-	/* No device attached. */
-	if (inputb(pio_ports[bus][ATA_REG_ASTATUS]) == 0)
-		return (ATADEV_NULL);
+	/* No device attached (floating bus reads all ones). */
+	status = inputb(pio_ports[bus][ATA_REG_ASTATUS]);
+	if ((status == 0) || (status == 0xff))
+		ata_probes[atadevid].type = ATADEV_NULL;
+}
+
+/*
+ * Polls a device for the answer to the identify command. Returns
+ * the device type, or -1 if the device has not answered yet.
+ */
+PRIVATE int ata_identify_poll(int atadevid)
+{
+	int bus;              /* Bus number.       */
+	byte_t status;        /* Status register.  */
+	uint8_t signature[2]; /* Device signature. */
 	
-	ata_bus_wait(bus);
+	bus = ata_bus(atadevid);
+	
+	/* Already identified. */
+	if (ata_probes[atadevid].type >= 0)
+		return (ata_probes[atadevid].type);
+	
+	/* Device did not answer in time. */
+	if (ata_probes[atadevid].timeout-- == 0)
+	{
+		kprintf("hd%c: identify timed out.", 'a' + atadevid);
+		return (ata_probes[atadevid].type = ATADEV_NULL);
+	}
+	
+	status = inputb(pio_ports[bus][ATA_REG_ASTATUS]);
+	if (status & ATA_BUSY)
+		return (-1);
 		
 	/* Get device signature */
 	signature[0] = inputb(pio_ports[bus][ATA_REG_LBAM]);
@@ -397,180 +1008,196 @@ PRIVATE int ata_identify(int atadevid)
 	
 	/* ATAPI device.  */
 	if ((signature[0] == 0x14) && (signature[1] == 0xeb))
-		return (ATADEV_PATAPI);
+		return (ata_probes[atadevid].type = ATADEV_PATAPI);
 			
 	/* SATAPI device. */
 	else if ((signature[0] == 0x69) && (signature[1] == 0x96))
-		return (ATADEV_SATAPI);
+		return (ata_probes[atadevid].type = ATADEV_SATAPI);
 			
 	/* SATA device. */
 	else if ((signature[0] == 0x3c) && (signature[1] == 0xc3))
-		return (ATADEV_SATA);
+		return (ata_probes[atadevid].type = ATADEV_SATA);
 
-	/* PATA device. */
+	/* PATA device, once it is ready to send its information. */
 	else if ((signature[0] == 0) && (signature[1] == 0))
-		return (ATADEV_PATA);
+	{
+		if (!(status & (ATA_DRQ | ATA_ERR)))
+			return (-1);
+		
+		return (ata_probes[atadevid].type = ATADEV_PATA);
+	}
 
 	/* Unknown ATA device. */
 	else
-		return (ATADEV_UNKNOWN);
+		return (ata_probes[atadevid].type = ATADEV_UNKNOWN);
 }
 
 /*
- * Issues a read operation.
+ * Issues a read operation for the first n requests in the queue.
  */
-PRIVATE void ata_read_op(unsigned atadevid, struct request *req)
+PRIVATE void ata_read_op(unsigned atadevid, int n)
 {
-	int bus;       /* Bus number.        */
-	byte_t byte;   /* Byte used for I/O. */
-	uint64_t addr; /* Read address.      */
-	size_t size;    /* # bytes to read.   */
+	int bus;             /* Bus number.        */
+	uint64_t addr;       /* Read address.      */
+	size_t size;         /* # bytes to read.   */
+	struct atadev *dev;  /* ATA device.        */
+	struct request *req; /* First request.     */
 	
 	ata_device_select(atadevid);
 	bus = ata_bus(atadevid);
-
-	/* Buffered read. */
-	if (req->flags & REQ_BUF)
+	dev = &ata_devices[atadevid];
+	req = ata_request(dev, 0);
+	addr = ata_request_addr(req);
+	size = ata_request_size(req)*n;
+	dev->nsectors = size >> ATA_SECTOR_SIZE_LOG2;
+	dev->sector = 0;
+	
+	/* DMA transfer. */
+	if (dev->flags & ATADEV_BMDMA)
 	{
-		size = BLOCK_SIZE;
-		addr = buffer_num(req->u.buffered.buf) << 
-			(BLOCK_SIZE_LOG2 - ATA_SECTOR_SIZE_LOG2);
+		ata_dma_setup(bus, dev, n, 1);
+		ata_lba48(atadevid, addr, size);
+		outputb(pio_ports[bus][ATA_REG_CMD], ATA_CMD_READ_DMA_EXT);
+		ata_dma_start(bus);
+		return;
 	}
 	
-	/* Raw read. */
-	else
+	/* Data is transferred as each DRQ block gets ready. */
+	ata_lba48(atadevid, addr, size);
+	outputb(pio_ports[bus][ATA_REG_CMD], (dev->flags & ATADEV_MULT) ?
+		ATA_CMD_READ_MULTIPLE_EXT : ATA_CMD_READ_SECTORS_EXT);
+}
+
+/*
+ * Issues a write operation for the first n requests in the queue.
+ */
+PRIVATE void ata_write_op(unsigned atadevid, int n)
+{
+	int bus;             /* Bus number.         */
+	size_t size;         /* Write size.         */
+	byte_t byte;         /* Byte used for I/O.  */
+	uint64_t addr;       /* LBA 48-bit address. */
+	struct atadev *dev;  /* ATA device.         */
+	struct request *req; /* First request.      */
+	
+	ata_device_select(atadevid);
+	bus = ata_bus(atadevid);
+	dev = &ata_devices[atadevid];
+	req = ata_request(dev, 0);
+	addr = ata_request_addr(req);
+	size = ata_request_size(req)*n;
+	dev->nsectors = size >> ATA_SECTOR_SIZE_LOG2;
+	dev->sector = 0;
+	
+	/* DMA transfer. */
+	if (dev->flags & ATADEV_BMDMA)
 	{
-		size = req->u.raw.size;
-		addr = req->u.raw.num << (BLOCK_SIZE_LOG2 - ATA_SECTOR_SIZE_LOG2);
+		ata_dma_setup(bus, dev, n, 0);
+		ata_lba48(atadevid, addr, size);
+		outputb(pio_ports[bus][ATA_REG_CMD], ATA_CMD_WRITE_DMA_EXT);
+		ata_dma_start(bus);
+		return;
 	}
+	
+	ata_lba48(atadevid, addr, size);
+	outputb(pio_ports[bus][ATA_REG_CMD], (dev->flags & ATADEV_MULT) ?
+		ATA_CMD_WRITE_MULTIPLE_EXT : ATA_CMD_WRITE_SECTORS_EXT);
+	ata_delay();
+	ata_bus_wait(bus);
 
 	/*
-	 * Set LBA bit, to specify
-	 * that the address is in LBA.
+	 * Device error. The device will fire an
+	 * IRQ, and the handler will report it.
 	 */
-	outputb(pio_ports[bus][ATA_REG_DEVCTL], 0x40);
+	byte = inputb(pio_ports[bus][ATA_REG_ASTATUS]);
+	if (byte & (ATA_ERR | ATA_DF))
+		return;
 	
-	/* Send the three highest bytes of the address. */
-	outputb(pio_ports[bus][ATA_REG_NSECT], 0x00);
-	outputb(pio_ports[bus][ATA_REG_LBAL], (addr >> 0x18) & 0xff);
-	outputb(pio_ports[bus][ATA_REG_LBAM], (addr >> 0x20) & 0xff);
-	outputb(pio_ports[bus][ATA_REG_LBAH], (addr >> 0x28) & 0xff);
-
-	/* Send the three lowest bytes of the address. */
-	outputb(pio_ports[bus][ATA_REG_NSECT], size/ATA_SECTOR_SIZE);
-	outputb(pio_ports[bus][ATA_REG_LBAL], (addr >> 0x00) & 0xff);
-	outputb(pio_ports[bus][ATA_REG_LBAM], (addr >> 0x08) & 0xff);
-	outputb(pio_ports[bus][ATA_REG_LBAH], (addr >> 0x10) & 0xff);
-
-	outputb(pio_ports[bus][ATA_REG_CMD], ATA_CMD_READ_SECTORS_EXT);
-	ata_bus_wait(bus);
+	/*
+	 * Send first DRQ block. The remaining ones are
+	 * sent as the device asks for them, on IRQs.
+	 */
+	ata_pio_transfer(atadevid, 1);
+}
 
-	/* Query return value. */
-	byte = inputb(pio_ports[bus][ATA_REG_ASTATUS]);
-	if (byte & ATA_DF)
-		kprintf("ATA: device error");
+/*
+ * Issues a flush cache operation.
+ */
+PRIVATE void ata_flush_op(unsigned atadevid)
+{
+	int bus; /* Bus number. */
+	
+	ata_device_select(atadevid);
+	bus = ata_bus(atadevid);
+	
+	outputb(pio_ports[bus][ATA_REG_CMD], ATA_CMD_FLUSH_CACHE_EXT);
 }
 
 /*
- * Issues a write operation.
+ * Starts the next pending request, merging in
+ * the requests for adjacent blocks that follow it.
  */
-PRIVATE void ata_write_op(unsigned atadevid, struct request *req)
+PRIVATE void ata_start(unsigned atadevid)
 {
-	int bus;            /* Bus number.         */
-	size_t i;           /* Loop index.         */
-	size_t size;        /* Write size.         */
-	byte_t byte;        /* Byte used for I/O.  */
-	uint64_t addr;      /* LBA 48-bit address. */
-	word_t word;        /* Word used for I/O.  */
-	unsigned char *buf; /* Buffer to use.      */
+	uint64_t addr;       /* Command address. */
+	struct atadev *dev;  /* ATA device.      */
 	
-	ata_device_select(atadevid);
-	bus = ata_bus(atadevid);
-
-	/* Buffered I/O write. */
-	if (req->flags & REQ_BUF)
-	{
-		buf = buffer_data(req->u.buffered.buf);
-		size = BLOCK_SIZE;
-		addr = buffer_num(req->u.buffered.buf) << 
-			(BLOCK_SIZE_LOG2 - ATA_SECTOR_SIZE_LOG2);
-	}
+	dev = &ata_devices[atadevid];
+	ata_buses[ata_bus(atadevid)].active = atadevid;
 	
-	/* Raw I/O write. */
-	else
-	{
-		buf = req->u.raw.buf;
-		size = req->u.raw.size;
-		addr = req->u.raw.num << (BLOCK_SIZE_LOG2 - ATA_SECTOR_SIZE_LOG2);
-	}
-
 	/*
-	 * Set LBA bit, to specify
-	 * that the address is in LBA.
+	 * All requests that came before the
+	 * pending barrier are done, so flush.
 	 */
-	outputb(pio_ports[bus][ATA_REG_DEVCTL], 0x40);
-	
-	/* Send the three highest bytes of the address. */
-	outputb(pio_ports[bus][ATA_REG_NSECT], 0x00);
-	outputb(pio_ports[bus][ATA_REG_LBAL], (addr >> 0x18) & 0xff);
-	outputb(pio_ports[bus][ATA_REG_LBAM], (addr >> 0x20) & 0xff);
-	outputb(pio_ports[bus][ATA_REG_LBAH], (addr >> 0x28) & 0xff);
-
-	/* Send the three lowest bytes of the address. */
-	outputb(pio_ports[bus][ATA_REG_NSECT], size/ATA_SECTOR_SIZE);
-	outputb(pio_ports[bus][ATA_REG_LBAL], (addr >> 0x00) & 0xff);
-	outputb(pio_ports[bus][ATA_REG_LBAM], (addr >> 0x08) & 0xff);
-	outputb(pio_ports[bus][ATA_REG_LBAH], (addr >> 0x10) & 0xff);
-
-	outputb(pio_ports[bus][ATA_REG_CMD], ATA_CMD_WRITE_SECTORS_EXT);
-	ata_bus_wait(bus);
-
-	/* Query return value. */
-	byte = inputb(pio_ports[bus][ATA_REG_ASTATUS]);
-	if (byte & ATA_DF)
+	if (dev->queue.pending == NULL)
 	{
-		kprintf("ATA: device error");
+		dev->nmerged = 1;
+		dev->inflight[0] = dev->queue.barrier;
+		bdev_acct_start(&dev->stats, 1);
+		ata_flush_op(atadevid);
 		return;
-	}			
-		
-	/* Write block. */
-	for (i = 0; i < size; i += 2)
-	{
-		ata_bus_wait(bus);
-		word = buf[i];
-		word |= buf[i + 1] << 8;
-		outputw(pio_ports[bus][ATA_REG_DATA], word);
-		iowait();
 	}
 	
-	/*
-	 * Flushes ATA cache. Note that this will
-	 * generate a IRQ, which shall be discarded
-	 */
-	outputb(pio_ports[bus][ATA_REG_CMD], ATA_CMD_FLUSH_CACHE_EXT);
-	ata_bus_wait(bus);
-	iowait();
+	dev->nmerged = ata_merge(dev);
+	
+	/* Update statistics. */
+	bdev_acct_start(&dev->stats, dev->nmerged);
+	addr = ata_request_addr(ata_request(dev, 0));
+	dev->stats.io.seek += ((addr > dev->pos) ? (addr - dev->pos) : 
+		(dev->pos - addr)) >> (BLOCK_SIZE_LOG2 - ATA_SECTOR_SIZE_LOG2);
+	dev->pos = addr + ((ata_request_size(ata_request(dev, 0))*dev->nmerged)
+		>> ATA_SECTOR_SIZE_LOG2);
+	
+	if (ata_request(dev, 0)->flags & REQ_WRITE)
+		ata_write_op(atadevid, dev->nmerged);
+	else
+		ata_read_op(atadevid, dev->nmerged);
 }
 
 /*
- * Schedules a block disk IO operation.
+ * Schedules a block disk IO operation. Synchronous
+ * operations return their completion status.
  */
-PRIVATE void ata_sched(unsigned atadevid, unsigned flags, ...)
+PRIVATE int ata_sched(unsigned atadevid, unsigned flags, ...)
 {
+	int status;          /* Completion status. */
 	va_list args;        /* Variable arg list. */
 	struct atadev *dev;  /* ATA device.        */
 	buffer_t buf;        /* Buffer.            */
 	struct request *req; /* Request.           */
 	
 	dev = &ata_devices[atadevid];
+	status = 0;
 
 	disable_interrupts();
 	
 		/* Wait for a slot in the block operation queue. */
-		while (dev->queue.size == ATADEV_QUEUE_SIZE)
-			sleep(&dev->queue.chain, PRIO_IO);
+		while ((dev->queue.free == NULL) ||
+			((flags & REQ_FLUSH) && (dev->queue.barrier != NULL)))
+			sleep_excl(&dev->queue.chain, PRIO_IO);
 		
-		req = &dev->queue.requests[dev->queue.tail];
+		req = dev->queue.free;
+		dev->queue.free = req->next;
 		
 		va_start(args, flags);
 		
@@ -584,6 +1211,10 @@ PRIVATE void ata_sched(unsigned atadevid, unsigned flags, ...)
 			req->u.buffered.buf = buf;
 		}
 		
+		/* Write barrier. */
+		else if (flags & REQ_FLUSH)
+			req->flags = flags;
+		
 		/* Raw I/O operation. */
 		else
 		{
@@ -591,50 +1222,83 @@ PRIVATE void ata_sched(unsigned atadevid, unsigned flags, ...)
 			req->flags = flags;
 			req->u.raw.num = va_arg(args, block_t);
 			req->u.raw.buf = va_arg(args, unsigned char *);
+			req->u.raw.phys = va_arg(args, addr_t);
 			req->u.raw.size = va_arg(args, size_t);
 		}
 		
 		va_end(args);
 		
+		/*
+		 * Swap-ins are the most urgent, and asynchronous requests,
+		 * such as write-back and read-ahead, the least.
+		 */
+		if (curr_proc->flags & (1 << PROC_SWAPIN))
+			req->ioclass = IOPRIO_CLASS_RT;
+		else if (flags & REQ_SYNC)
+			req->ioclass = curr_proc->ioprio;
+		else
+			req->ioclass = IOPRIO_CLASS_IDLE;
+		
 		/* Enqueue request. */
-		dev->queue.tail = (dev->queue.tail + 1)%ATADEV_QUEUE_SIZE;
+		req->done = 0;
+		req->status = 0;
+		waitq_init(&req->chain);
+		req->deadline = ticks + ATA_READ_DEADLINE;
+		req->issued = ticks;
+		ata_enqueue(dev, req);
 		dev->queue.size++;
+		bdev_acct_issue(&dev->stats);
+		ktrace(KTRACE_ATAQ, atadevid,
+			(flags & REQ_FLUSH) ? 0 : ata_request_addr(req));
 		
 		/*
-		 * The queue was empty, therefore,
+		 * The bus is idle, therefore,
 		 * we can process this block right now.
 		 */
-		if (dev->queue.size == 1)
+		if (ata_buses[ata_bus(atadevid)].active < 0)
+			ata_start(atadevid);
+		
+		/*
+		 * Wait operation to complete. The interrupt handler
+		 * leaves synchronous requests for us to release.
+		 */
+		if (flags & REQ_SYNC)
 		{
-			if (flags & REQ_WRITE)
-				ata_write_op(atadevid, req);
-			else
-				ata_read_op(atadevid, req);
+			while (!req->done)
+			{
+				if (tsleep(&req->chain, PRIO_IO, ATA_TIMEOUT) == WAKE_TIMEOUT)
+					kprintf("ATA: request timed out, still waiting");
+			}
+			
+			status = req->status;
+			
+			req->next = dev->queue.free;
+			dev->queue.free = req;
+			wakeup(&dev->queue.chain);
 		}
-		
-		/* Wait operation to complete. */
-		if (req->flags & REQ_SYNC)
-			sleep(&dev->chain, PRIO_IO);
 	
 	enable_interrupts();
+	
+	return (status);
 }
 
 /*
  * Schedules a buffered I/O operation.
  */
-PRIVATE void
+PRIVATE int
 ata_sched_buffered(unsigned atadevid, buffer_t buf, unsigned flags)
 {
-	ata_sched(atadevid, flags, buf);
+	return (ata_sched(atadevid, flags, buf));
 }
 
 /*
- * Schedules a non-buffered I/O operation.
+ * Schedules a non-buffered I/O operation. Requests served with
+ * DMA straight from/to user memory have no buffer in kernel space.
  */
-PRIVATE void
-ata_sched_raw(unsigned atadevid, block_t num, void *buf, size_t size, unsigned flags)
+PRIVATE int ata_sched_raw
+(unsigned atadevid, block_t num, void *buf, addr_t phys, size_t size, unsigned flags)
 {	
-	ata_sched(atadevid, flags, num, buf, size);
+	return (ata_sched(atadevid, flags, num, buf, phys, size));
 }
 
 /*============================================================================*
@@ -646,7 +1310,8 @@ ata_sched_raw(unsigned atadevid, block_t num, void *buf, size_t size, unsigned f
  */
 PRIVATE int ata_readblk(unsigned minor, buffer_t buf)
 {
-	struct atadev *dev;
+	unsigned flags;     /* Request flags. */
+	struct atadev *dev; /* ATA device.    */
 	
 	/* Invalid minor device. */
 	if (minor >= 4)
@@ -658,9 +1323,11 @@ PRIVATE int ata_readblk(unsigned minor, buffer_t buf)
 	if (!(dev->flags & ATADEV_VALID))
 		return (-EINVAL);
 	
-	ata_sched_buffered(minor, buf, REQ_BUF | REQ_SYNC);
+	/* Nobody waits for read-ahead blocks. */
+	buffer_valid(buf, 0);
+	flags = REQ_BUF | (buffer_is_async(buf) ? 0 : REQ_SYNC);
 	
-	return (0);
+	return (ata_sched_buffered(minor, buf, flags));
 }
 
 /*
@@ -683,11 +1350,39 @@ PRIVATE int ata_writeblk(unsigned minor, buffer_t buf)
 	
 	flags = REQ_BUF | REQ_WRITE | (buffer_is_sync(buf) ? REQ_SYNC : 0);
 	
-	ata_sched_buffered(minor, buf, flags);
+	return (ata_sched_buffered(minor, buf, flags));
+}
+
+/*
+ * Flushes the write cache of a ATA device.
+ */
+PRIVATE int ata_flush(unsigned minor)
+{
+	struct atadev *dev; /* ATA device. */
 	
-	return (0);
+	/* Invalid minor device. */
+	if (minor >= 4)
+		return (-EINVAL);
+	
+	dev = &ata_devices[minor];
+	
+	/* Device not valid. */
+	if (!(dev->flags & ATADEV_VALID))
+		return (-EINVAL);
+	
+	return (ata_sched(minor, REQ_FLUSH | REQ_SYNC));
 }
 
+/*
+ * Asserts if a raw I/O operation on a ATA device can be served with
+ * zero copy, that is, the device does DMA and the buffer is a
+ * page-aligned user buffer. Transfers are split in page-sized
+ * chunks, so each of them then lies within a single user page.
+ */
+#define ata_direct(dev, buf)                                       \
+	(((dev)->flags & ATADEV_BMDMA) && !((addr_t)(buf) & ~PAGE_MASK) && \
+	 ((addr_t)(buf) >= UBASE_VIRT) && ((addr_t)(buf) < KBASE_VIRT))
+
 /*
  * Reads bytes from a ATA device.
  */
@@ -698,6 +1393,9 @@ PRIVATE ssize_t ata_read(unsigned minor, char *buf, size_t n, off_t off)
 	unsigned char *p;   /* Read pointer.                 */
 	unsigned char *kpg; /* Kernel page used for copying. */
 	block_t lastblk;    /* Last block.                   */
+	int direct;         /* Zero-copy transfer?           */
+	int err;            /* Error code.                   */
+	addr_t phys;        /* Physical page address.        */
 	
 	/* Invalid minor device. */
 	if (minor >= 4)
@@ -719,10 +1417,14 @@ PRIVATE ssize_t ata_read(unsigned minor, char *buf, size_t n, off_t off)
 	
 	lastblk = (dev->info.nsectors>>(BLOCK_SIZE_LOG2 - ATA_SECTOR_SIZE_LOG2))-1;
 	
-	/* Get a kernel page. */
-	kpg = getkpg(0);
-	if (kpg == NULL)
-		return (-ENOMEM);
+	/* Bounce through a kernel page. */
+	kpg = NULL;
+	if (!(direct = ata_direct(dev, buf)))
+	{
+		kpg = getkpg(0);
+		if (kpg == NULL)
+			return (-ENOMEM);
+	}
 	
 	p = (unsigned char *)buf;
 	
@@ -747,8 +1449,33 @@ PRIVATE ssize_t ata_read(unsigned minor, char *buf, size_t n, off_t off)
 																BLOCK_SIZE_LOG2;
 		}
 		    
-		ata_sched_raw(minor, blknum, kpg, count, REQ_SYNC);
-		kmemcpy(p, kpg, count);
+		/* Zero-copy transfer. */
+		if (direct)
+		{
+			err = -EFAULT;
+			if ((phys = pinupg((addr_t)p, 1)) != 0)
+			{
+				err = ata_sched_raw(minor, blknum, NULL, phys, count,
+					REQ_SYNC);
+				unpinupg((addr_t)p);
+			}
+		}
+		
+		else
+		{
+			err = ata_sched_raw(minor, blknum, kpg, ata_phys(kpg), count,
+				REQ_SYNC);
+			if (err == 0)
+				kmemcpy(p, kpg, count);
+		}
+		
+		/* Device error. */
+		if (err < 0)
+		{
+			if (kpg != NULL)
+				putkpg(kpg);
+			return ((i > 0) ? (ssize_t)i : err);
+		}
 		
 		p += count;
 		i += count;
@@ -759,7 +1486,8 @@ PRIVATE ssize_t ata_read(unsigned minor, char *buf, size_t n, off_t off)
 			yield();
 	}
 	
-	putkpg(kpg);
+	if (kpg != NULL)
+		putkpg(kpg);
 	return ((ssize_t)i);
 }
 
@@ -774,6 +1502,9 @@ PRIVATE ssize_t ata_write(unsigned minor, const char *buf, size_t n, off_t off)
 	unsigned char *p;   /* Write pointer.                */
 	unsigned char *kpg; /* Kernel page used for copying. */
 	block_t lastblk;    /* Last block.                   */
+	int direct;         /* Zero-copy transfer?           */
+	int err;            /* Error code.                   */
+	addr_t phys;        /* Physical page address.        */
 	
 	/* Invalid minor device. */
 	if (minor >= 4)
@@ -795,10 +1526,14 @@ PRIVATE ssize_t ata_write(unsigned minor, const char *buf, size_t n, off_t off)
 	
 	lastblk = (dev->info.nsectors>>(BLOCK_SIZE_LOG2 - ATA_SECTOR_SIZE_LOG2))-1;
 	
-	/* Get a kernel page. */
-	kpg = getkpg(0);
-	if (kpg == NULL)
-		return (-ENOMEM);
+	/* Bounce through a kernel page. */
+	kpg = NULL;
+	if (!(direct = ata_direct(dev, buf)))
+	{
+		kpg = getkpg(0);
+		if (kpg == NULL)
+			return (-ENOMEM);
+	}
 	
 	p = (unsigned char *)buf;
 	
@@ -823,8 +1558,32 @@ PRIVATE ssize_t ata_write(unsigned minor, const char *buf, size_t n, off_t off)
 																BLOCK_SIZE_LOG2;
 		}
 		
-		kmemcpy(kpg, p, count);
-		ata_sched_raw(minor, blknum, kpg, count, REQ_SYNC | REQ_WRITE);
+		/* Zero-copy transfer. */
+		if (direct)
+		{
+			err = -EFAULT;
+			if ((phys = pinupg((addr_t)p, 0)) != 0)
+			{
+				err = ata_sched_raw(minor, blknum, NULL, phys, count,
+					REQ_SYNC | REQ_WRITE);
+				unpinupg((addr_t)p);
+			}
+		}
+		
+		else
+		{
+			kmemcpy(kpg, p, count);
+			err = ata_sched_raw(minor, blknum, kpg, ata_phys(kpg), count,
+				REQ_SYNC | REQ_WRITE);
+		}
+		
+		/* Device error. */
+		if (err < 0)
+		{
+			if (kpg != NULL)
+				putkpg(kpg);
+			return ((i > 0) ? (ssize_t)i : err);
+		}
 		
 		p += count;
 		i += count;
@@ -835,130 +1594,280 @@ PRIVATE ssize_t ata_write(unsigned minor, const char *buf, size_t n, off_t off)
 			yield();
 	}
 	
-	putkpg(kpg);
+	if (kpg != NULL)
+		putkpg(kpg);
 	return ((ssize_t)i);
 }
 
+/*
+ * Gets I/O statistics of a ATA device.
+ */
+PRIVATE int ata_stat(unsigned minor, struct iostat *buf)
+{
+	struct iostat st;   /* Statistics. */
+	struct atadev *dev; /* ATA device. */
+	
+	/* Invalid minor device. */
+	if (minor >= 4)
+		return (-EINVAL);
+	
+	dev = &ata_devices[minor];
+	
+	/* Device not valid. */
+	if (!(dev->flags & ATADEV_VALID))
+		return (-EINVAL);
+	
+	disable_interrupts();
+	bdev_acct_stat(&dev->stats, &st);
+	enable_interrupts();
+	
+	kmemcpy(buf, &st, sizeof(struct iostat));
+	
+	return (0);
+}
+
 /*
  * ATA device operations.
  */
 PRIVATE const struct bdev ata_ops = {
-	&ata_read,    /* read()     */
-	&ata_write,   /* write()    */
-	&ata_readblk, /* readblk()  */
-	&ata_writeblk /* writeblk() */
+	&ata_read,     /* read()     */
+	&ata_write,    /* write()    */
+	&ata_readblk,  /* readblk()  */
+	&ata_writeblk, /* writeblk() */
+	&ata_stat,     /* stat()     */
+	&ata_flush,    /* flush()    */
+	NULL           /* direct()   */
 };
 
 /*
- * Generic ATA interrupt handler.
+ * Starts the next command on a ATA bus, if there is any work to do.
+ * The devices on the bus take turns, so that none of them starves.
+ */
+PRIVATE void ata_kick(int bus, int last)
+{
+	int i;              /* Loop index. */
+	int atadevid;       /* Device ID.  */
+	struct atadev *dev; /* ATA device. */
+	
+	for (i = 1; i <= 2; i++)
+	{
+		atadevid = 2*bus + (((last & 1) + i) & 1);
+		dev = &ata_devices[atadevid];
+		
+		/* No device here. */
+		if (!(dev->flags & ATADEV_VALID))
+			continue;
+		
+		if ((dev->queue.pending != NULL) || (dev->queue.barrier != NULL))
+		{
+			ata_start(atadevid);
+			return;
+		}
+	}
+}
+
+/*
+ * Completes an ATA command. This is the bottom half of the
+ * interrupt handler, which runs with all interrupts enabled:
+ * it moves PIO data, completes requests and starts the next
+ * command on the bus.
  */
-PRIVATE void ata_handler(int atadevid)
+PRIVATE void ata_handler(int bus)
 {
-	int bus;             /* Bus number.    */
-	size_t i;            /* Loop index.    */
+	int n;               /* Loop index.    */
+	int err;             /* Error?         */
+	int atadevid;        /* Device ID.     */
 	struct atadev *dev;  /* ATA device.    */
 	struct request *req; /* Request.       */
-	word_t word;         /* Working word.  */
-	size_t size;         /* Write size.    */
-	unsigned char *buf;  /* Buffer to use. */
+	byte_t status;       /* Status.        */
 	
-	bus = ata_bus(atadevid);
-	dev = &ata_devices[atadevid];
+	atadevid = ata_buses[bus].active;
 	
 	/*
-	 * That's weird! A non valid device
-	 * is firing an IRQ. Let's just ignore it so.
+	 * That's weird! No command is in flight on this
+	 * bus. The IRQ has been acknowledged already.
 	 */
-	if (!(dev->flags & ATADEV_VALID))
-	{
-		kprintf("ATA: non valid device %d fired an IRQ", atadevid);
-		return;
-	}
-		
-	/* We don't need to handle this IRQ. */
-	if (dev->flags & ATADEV_DISCARD)
+	if (atadevid < 0)
 	{
-		dev->flags &= ~ATADEV_DISCARD;
+		kprintf("ATA: spurious IRQ on bus %d", bus);
 		return;
 	}
 	
-	/* Broken block operation queue. */
-	if (dev->queue.size == 0)
+	dev = &ata_devices[atadevid];
+	
+	req = ata_request(dev, 0);
+	err = 0;
+	
+	/* Cache flush is done. */
+	if (req->flags & REQ_FLUSH)
 	{
-		kpanic("ATA: broken block operation queue?");
-		goto out;
+		if (ata_buses[bus].status & (ATA_ERR | ATA_DF))
+		{
+			kprintf("ATA: cache flush error");
+			err = -EIO;
+		}
 	}
 	
-	/* Get first request. */
-	req = &dev->queue.requests[dev->queue.head];
-	dev->queue.head = (dev->queue.head + 1)%ATADEV_QUEUE_SIZE;
-	dev->queue.size--;
-	
-	/* Buffered I/O operation. */
-	if (req->flags & REQ_BUF)
+	/* DMA transfer is done. */
+	else if (dev->flags & ATADEV_BMDMA)
 	{
-		buf = buffer_data(req->u.buffered.buf);
-		size = BLOCK_SIZE;
+		status = ata_dma_stop(bus);
+		
+		if ((status & BMIDE_ERROR) ||
+			(ata_buses[bus].status & (ATA_ERR | ATA_DF)))
+		{
+			kprintf("ATA: DMA transfer error");
+			err = -EIO;
+		}
 	}
 	
-	/* Raw I/O operation. */
+	/* PIO data phase. */
 	else
 	{
-		buf = req->u.raw.buf;
-		size = req->u.raw.size;
+		status = ata_buses[bus].status;
+		
+		if (status & (ATA_ERR | ATA_DF))
+		{
+			kprintf("ATA: device error");
+			dev->sector = dev->nsectors;
+			err = -EIO;
+		}
+		
+		/* Get next DRQ block. */
+		else if (!(req->flags & REQ_WRITE))
+			ata_pio_transfer(atadevid, 0);
+		
+		/* Device wants next DRQ block. */
+		else if (dev->sector < dev->nsectors)
+		{
+			ata_pio_transfer(atadevid, 1);
+			return;
+		}
+		
+		/* Wait for more data. */
+		if (dev->sector < dev->nsectors)
+			return;
 	}
 	
-	/* Write operation. */
+	/* Write is done. */
 	if (req->flags & REQ_WRITE)
+		ata_bus_wait(bus);
+	
+	/* Complete all requests served by this command. */
+	for (n = 0; n < dev->nmerged; n++)
 	{
+		req = ata_request(dev, n);
+		ktrace(KTRACE_ATADONE, atadevid,
+			(req->flags & REQ_FLUSH) ? 0 : ata_request_addr(req));
+		
 		/*
-		 * Write is done, so 
-		 * just ignore next IRQ.
+		 * Barrier is done, so release
+		 * requests that were held back.
 		 */
-		ata_bus_wait(bus);
-		dev->flags &= ~ATADEV_DISCARD;
-			
-		/* Release buffer. */
-		if (req->flags & REQ_BUF)
+		if (req->flags & REQ_FLUSH)
 		{
-			buffer_dirty(req->u.buffered.buf, 0);
-			brelse(req->u.buffered.buf);
+			dev->queue.barrier = NULL;
+			dev->queue.pending = dev->queue.held;
+			dev->queue.held = NULL;
 		}
-	}
-	
-	/* Read operation. */
-	else
-	{			
-		/* Read block. */
-		for (i = 0; i < size; i += 2)
+		
+		/* Write operation. */
+		else if (req->flags & REQ_WRITE)
 		{
-			ata_bus_wait(bus);
-			word = inputw(pio_ports[bus][ATA_REG_DATA]);
-			buf[i] = word & 0xff;
-			buf[i + 1] = (word >> 8) & 0xff;
+			/* Release buffer. */
+			if (req->flags & REQ_BUF)
+			{
+				buffer_dirty(req->u.buffered.buf, 0);
+				brelse(req->u.buffered.buf);
+			}
+		}
+		
+		/* Read operation. */
+		else
+		{			
+			/* Buffered read is done. */
+			if (req->flags & REQ_BUF)
+			{
+				/* Block contents are garbage. */
+				if (err == 0)
+					buffer_valid(req->u.buffered.buf, 1);
+				
+				/* Release read-ahead buffer. */
+				if (!(req->flags & REQ_SYNC))
+					brelse(req->u.buffered.buf);
+			}
+		}
+		
+		dev->queue.size--;
+		
+		/* Update statistics. */
+		if (req->flags & REQ_FLUSH)
+			bdev_acct_done(&dev->stats, BDEV_FLUSH, 0, req->issued);
+		else
+		{
+			bdev_acct_done(&dev->stats,
+				(req->flags & REQ_WRITE) ? BDEV_WRITE : BDEV_READ,
+				ata_request_size(req), req->issued);
+		}
+		
+		/* Wakeup owner, that will release the request. */
+		if (req->flags & REQ_SYNC)
+		{
+			req->status = err;
+			req->done = 1;
+			wakeup(&req->chain);
 		}
-	}
-	
-	/* Process next operation. */
-	if (dev->queue.size > 0)
-	{
-		req = &dev->queue.requests[dev->queue.head];
 		
-		if (req->flags & REQ_WRITE)
-			ata_write_op(atadevid, req);
+		/* Release request. */
 		else
-			ata_read_op(atadevid, req);
+		{
+			req->next = dev->queue.free;
+			dev->queue.free = req;
+		}
 	}
-
-out:
+	
+	bdev_acct_end(&dev->stats, dev->nmerged);
+	dev->nmerged = 0;
+	ata_buses[bus].active = -1;
+	
+	/* Process next operation. */
+	ata_kick(bus, atadevid);
 
 	/*
-	 * Wakeup the process that was waiting for this
-	 * operation and the processes that were waiting
-	 * for an empty slot in the block operation queue.
+	 * Wakeup processes that were waiting for
+	 * an empty slot in the block operation queue.
 	 */
 	wakeup(&dev->queue.chain);
-	wakeup(&dev->chain);
+}
+
+/*
+ * ATA bottom half.
+ */
+PRIVATE void ata_bh(void)
+{
+	int pending; /* IRQ taken on bus? */
+	
+	for (int bus = ATA_BUS_PRIMARY; bus <= ATA_BUS_SECONDARY; bus++)
+	{
+		disable_interrupts();
+		pending = ata_buses[bus].pending;
+		ata_buses[bus].pending = 0;
+		enable_interrupts();
+		
+		if (pending)
+			ata_handler(bus);
+	}
+}
+
+/*
+ * Generic ATA interrupt handler. Acknowledges the device, by
+ * reading its status, and leaves the rest to the bottom half.
+ */
+PRIVATE void ata_irq(int bus)
+{
+	ata_buses[bus].status = inputb(pio_ports[bus][ATA_REG_STATUS]);
+	ata_buses[bus].pending = 1;
+	mark_bh(BH_ATA);
 }
 
 /*
@@ -966,7 +1875,7 @@ out:
  */
 PRIVATE void ata1_handler(void)
 {
-	ata_handler(0);
+	ata_irq(ATA_BUS_PRIMARY);
 }
 
 /*
@@ -974,64 +1883,101 @@ PRIVATE void ata1_handler(void)
  */
 PRIVATE void ata2_handler(void)
 {
-	ata_handler(1);
+	ata_irq(ATA_BUS_SECONDARY);
 }
 
-/**
- * @brief Initializes the generic ATA device driver.
- * 
- * @todo Check for multiple read/write sectors capability.
+/*
+ * Sets up and reports a device that has been identified.
  */
-PUBLIC void ata_init(void)
+PRIVATE void ata_attach(int atadevid)
 {
-	int i;     /* Loop index.    */
 	char dvrl; /* Device letter. */
 	
-	/* Detect devices. */
-	for (i = 0, dvrl = 'a'; i < 4; i++, dvrl++)
+	dvrl = 'a' + atadevid;
+	
+	switch (ata_probes[atadevid].type)
 	{
-		kmemset(&ata_devices[i], 0, sizeof(struct atadev));
-		
-		ata_device_select(i);
-		
-		/* Setup ATA device. */
-		switch (ata_identify(i))
-		{
-			/* ATAPI.  */
-			case ATADEV_PATAPI:
-				kprintf("hd%c: ATAPI CD/DVD detected.", dvrl);
-				break;
-				
-			/* SATAPI. */
-			case ATADEV_SATAPI:
-				kprintf("hd%c: SATAPI CD/DVD detected.", dvrl);
-				break;
-					
-			/* SATA. */
-			case ATADEV_SATA:
-				kprintf("hd%c: SATA HDD detected.", dvrl);
-				break;
+		/* ATAPI.  */
+		case ATADEV_PATAPI:
+			kprintf("hd%c: ATAPI CD/DVD detected.", dvrl);
+			break;
 			
-			/* PATA. */
-			case ATADEV_PATA:
-				if (pata_setup(i))
-					kprintf("hd%c: device not found.", dvrl);
-				else
-				{
-					kprintf("hd%c: PATA HDD detected.", dvrl);
-					kprintf("hd%c: %d sectors.", dvrl, 
-												ata_devices[i].info.nsectors);
-				}
-				break;
+		/* SATAPI. */
+		case ATADEV_SATAPI:
+			kprintf("hd%c: SATAPI CD/DVD detected.", dvrl);
+			break;
+				
+		/* SATA. */
+		case ATADEV_SATA:
+			kprintf("hd%c: SATA HDD detected.", dvrl);
+			break;
+		
+		/* PATA. */
+		case ATADEV_PATA:
+			if (pata_setup(atadevid))
+				kprintf("hd%c: device not found.", dvrl);
+			else
+			{
+				kprintf("hd%c: PATA HDD detected.", dvrl);
+				kprintf("hd%c: %d sectors.", dvrl, 
+											ata_devices[atadevid].info.nsectors);
+				if (ata_devices[atadevid].flags & ATADEV_BMDMA)
+					kprintf("hd%c: bus master DMA enabled.", dvrl);
+				else if (ata_devices[atadevid].flags & ATADEV_MULT)
+					kprintf("hd%c: %d sectors per PIO block.", dvrl,
+											ata_devices[atadevid].multsect);
+			}
+			break;
 
-			/* UNKNOWN. */
-			case ATADEV_UNKNOWN:
-				kprintf("hd?: unknown ATA device.");
-				break;
-		}
+		/* UNKNOWN. */
+		case ATADEV_UNKNOWN:
+			kprintf("hd?: unknown ATA device.");
+			break;
 	}
+}
+
+/*
+ * Waits for a device on each bus to answer the identify
+ * command, and then sets them up. Both are polled in turn,
+ * so that their timeouts overlap.
+ */
+PRIVATE void ata_probe_pair(int atadevid)
+{
+	int done1, done2;
+	
+	do
+	{
+		done1 = (ata_identify_poll(atadevid) >= 0);
+		done2 = (ata_identify_poll(atadevid + 2) >= 0);
+		
+		if (!done1 || !done2)
+			ata_delay();
+	} while (!done1 || !done2);
+	
+	ata_attach(atadevid);
+	ata_attach(atadevid + 2);
+}
+
+/**
+ * @brief Initializes the generic ATA device driver.
+ * 
+ * @details Issues the identify command to the masters of both buses, and
+ *          returns without waiting for them. Probing is completed by
+ *          ata_probe().
+ * 
+ * @todo Check for multiple read/write sectors capability.
+ */
+PUBLIC void ata_init(void)
+{
+	ata_dma_init();
+	
+	/* Start probing masters. */
+	ata_identify(ATA_PRI_MASTER);
+	ata_identify(ATA_SEC_MASTER);
 	
 	/* Register interrupt handler. */
+	if (set_bh(BH_ATA, &ata_bh))
+		kpanic("BH_ATA busy");
 	if (set_hwint(INT_ATA1, &ata1_handler))
 		kpanic("INT_ATA1 busy");
 	if (set_hwint(INT_ATA2, &ata2_handler))
@@ -1039,3 +1985,26 @@ PUBLIC void ata_init(void)
 	
 	bdev_register(ATA_MAJOR, &ata_ops);
 }
+
+/**
+ * @brief Completes probing ATA devices.
+ * 
+ * @details Sets up the masters, whose identify command was issued by
+ *          ata_init(), and then probes the slaves of both buses at once.
+ *          Device interrupts are enabled afterwards.
+ */
+PUBLIC void ata_probe(void)
+{
+	ata_probe_pair(ATA_PRI_MASTER);
+	
+	ata_identify(ATA_PRI_SLAVE);
+	ata_identify(ATA_SEC_SLAVE);
+	ata_probe_pair(ATA_PRI_SLAVE);
+	
+	/* Acknowledge probe interrupts, and enable device interrupts. */
+	for (int bus = 0; bus < 2; bus++)
+	{
+		inputb(pio_ports[bus][ATA_REG_STATUS]);
+		outputb(pio_ports[bus][ATA_REG_ASTATUS], 0);
+	}
+}
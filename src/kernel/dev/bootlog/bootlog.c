@@ -0,0 +1,193 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/clock.h>
+#include <nanvix/config.h>
+#include <nanvix/const.h>
+#include <nanvix/dev.h>
+#include <nanvix/klib.h>
+#include <nanvix/mm.h>
+#include <dev/bootlog.h>
+#include <sys/bootlog.h>
+#include <sys/types.h>
+#include <errno.h>
+
+/**
+ * @brief Boot timeline.
+ * 
+ * @details Marks are never discarded, so that the timeline may be read at
+ *          any time after boot. Marks past #BOOTLOG_SIZE are dropped.
+ */
+PRIVATE struct
+{
+	unsigned n;                          /**< Number of marks. */
+	struct bootmark marks[BOOTLOG_SIZE]; /**< Marks.           */
+} bootlog;
+
+/**
+ * @brief Marks the start of a boot phase.
+ * 
+ * @details Records a time stamp for the boot phase named @p name. This may be
+ *          called before any device is initialized, even by the early setup
+ *          code, so it does not touch interrupts. It is never called from
+ *          interrupt handlers.
+ * 
+ * @param name Boot phase name.
+ */
+PUBLIC void boot_mark(const char *name)
+{
+	struct bootmark *m; /* Working mark. */
+	
+	/* Timeline is full. */
+	if (bootlog.n == BOOTLOG_SIZE)
+		return;
+	
+	m = &bootlog.marks[bootlog.n++];
+	m->stamp = clock_early();
+	kstrncpy(m->name, name, BOOTLOG_NAME_MAX - 1);
+	m->name[BOOTLOG_NAME_MAX - 1] = '\0';
+}
+
+/**
+ * @brief Reads the boot timeline.
+ * 
+ * @details Every read returns the timeline from its first mark, so it should
+ *          be read at once.
+ * 
+ * @param minor Minor device number (ignored).
+ * @param buf   Buffer where marks shall be placed.
+ * @param n     Number of bytes to read.
+ * 
+ * @returns The number of bytes actually read.
+ */
+PRIVATE ssize_t bootlog_read(unsigned minor, char *buf, size_t n)
+{
+	unsigned nmarks; /* Number of marks to read. */
+	
+	UNUSED(minor);
+	
+	nmarks = n/sizeof(struct bootmark);
+	if (nmarks > bootlog.n)
+		nmarks = bootlog.n;
+	kmemcpy(buf, bootlog.marks, nmarks*sizeof(struct bootmark));
+	
+	return ((ssize_t)(nmarks*sizeof(struct bootmark)));
+}
+
+/**
+ * @brief Marks the start of a user space boot phase.
+ * 
+ * @details The phase is named after the bytes written, up to the first
+ *          newline, so that init may mark the services that it starts.
+ * 
+ * @param minor Minor device number (ignored).
+ * @param buf   Boot phase name.
+ * @param n     Number of bytes to write.
+ * 
+ * @returns The number of bytes written.
+ */
+PRIVATE ssize_t bootlog_write(unsigned minor, const char *buf, size_t n)
+{
+	size_t len;                  /* Name length. */
+	char name[BOOTLOG_NAME_MAX]; /* Phase name.  */
+	
+	UNUSED(minor);
+	
+	for (len = 0; (len < n) && (len < BOOTLOG_NAME_MAX - 1); len++)
+	{
+		if (buf[len] == '\n')
+			break;
+		name[len] = buf[len];
+	}
+	name[len] = '\0';
+	
+	boot_mark(name);
+	
+	return ((ssize_t)n);
+}
+
+/**
+ * @brief Performs control operations on the boot timeline.
+ * 
+ * @details BOOTLOG_GETRATE gets the number of time stamp counts per clock
+ *          tick, which is zero until the time stamp counter is calibrated.
+ * 
+ * @param minor Minor device number (ignored).
+ * @param cmd   Command.
+ * @param arg   Command argument.
+ * 
+ * @returns Upon successful completion, zero is returned. Upon failure, a
+ *          negative error code is returned instead.
+ */
+PRIVATE int bootlog_ioctl(unsigned minor, unsigned cmd, unsigned arg)
+{
+	UNUSED(minor);
+	
+	switch (cmd)
+	{
+		/* Get time stamps per tick. */
+		case BOOTLOG_GETRATE:
+			if (!chkmem((void *)arg, sizeof(unsigned), MAY_WRITE))
+				return (-EFAULT);
+			*((unsigned *)arg) = clock_rate();
+			return (0);
+	}
+	
+	return (-EINVAL);
+}
+
+/**
+ * @brief Dummy open() operation.
+ */
+PRIVATE int bootlog_open(unsigned minor)
+{
+	UNUSED(minor);
+	
+	return (0);
+}
+
+/**
+ * @brief Dummy close() operation.
+ */
+PRIVATE int bootlog_close(unsigned minor)
+{
+	UNUSED(minor);
+	
+	return (0);
+}
+
+/**
+ * @brief Boot timeline driver.
+ */
+PRIVATE struct cdev bootlog_driver = {
+	&bootlog_open,  /* open()  */
+	&bootlog_read,  /* read()  */
+	&bootlog_write, /* write() */
+	&bootlog_ioctl, /* ioctl() */
+	&bootlog_close, /* close() */
+	NULL            /* poll()  */
+};
+
+/**
+ * @brief Initializes the boot timeline driver.
+ */
+PUBLIC void bootlog_init(void)
+{
+	cdev_register(BOOTLOG_MAJOR, &bootlog_driver);
+}
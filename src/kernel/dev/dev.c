@@ -18,31 +18,46 @@
  * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <dev/ahci.h>
 #include <dev/ata.h>
+#include <dev/bootlog.h>
 #include <dev/klog.h>
+#include <dev/kprof.h>
+#include <dev/ktrace.h>
 #include <dev/tty.h>
 #include <dev/ramdisk.h>
+#include <dev/uart.h>
+#include <dev/virtblk.h>
+#include <dev/virtnet.h>
+#include <i386/pmc.h>
 #include <nanvix/const.h>
 #include <nanvix/dev.h>
 #include <nanvix/klib.h>
 #include <nanvix/clock.h>
 #include <nanvix/pm.h>
 #include <errno.h>
+#include <poll.h>
 
 /*============================================================================*
  *                            Character Devices                               *
  *============================================================================*/
 
 /* Number of character devices. */
-#define NR_CHRDEV 3
+#define NR_CHRDEV 9
 
 /*
  * Character devices table.
  */
 PRIVATE const struct cdev *cdevsw[NR_CHRDEV] = {
-	NULL, /* /dev/null */
-	NULL, /* /dev/tty  */
-	NULL  /* /dev/klog */
+	NULL, /* /dev/null    */
+	NULL, /* /dev/tty     */
+	NULL, /* /dev/klog    */
+	NULL, /* /dev/ttyS0   */
+	NULL, /* /dev/ptyp0   */
+	NULL, /* /dev/ktrace  */
+	NULL, /* /dev/kprof   */
+	NULL, /* /dev/net0    */
+	NULL  /* /dev/bootlog */
 };
 
 /**
@@ -181,20 +196,42 @@ PUBLIC int cdev_close(dev_t dev)
 	return (cdevsw[MAJOR(dev)]->close(MINOR(dev)));
 }
 
+/*
+ * Asserts which operations on a character device would not block.
+ */
+PUBLIC int cdev_poll(dev_t dev)
+{
+	/* Null device. */
+	if (MAJOR(dev) == NULL_MAJOR)
+		return (POLLIN | POLLOUT);
+	
+	/* Invalid device. */
+	if (cdevsw[MAJOR(dev)] == NULL)
+		return (POLLERR);
+	
+	/* Device never blocks. */
+	if (cdevsw[MAJOR(dev)]->poll == NULL)
+		return (POLLIN | POLLOUT);
+	
+	return (cdevsw[MAJOR(dev)]->poll(MINOR(dev)));
+}
+
 
 /*============================================================================*
  *                              Block Devices                                 *
  *============================================================================*/
 
 /* Number of block devices. */
-#define NR_BLKDEV 2
+#define NR_BLKDEV 4
 
 /*
  * Block devices table.
  */
 PRIVATE const struct bdev *bdevsw[NR_BLKDEV] = {
 	NULL, /* /dev/ramdisk */
-	NULL  /* /dev/hdd     */
+	NULL, /* /dev/hdd     */
+	NULL, /* /dev/sd      */
+	NULL  /* /dev/vd      */
 };
 
 /*
@@ -296,19 +333,172 @@ PUBLIC void bdev_readblk(buffer_t buf)
 		kpanic("failed to read block from device");
 }
 
+/*
+ * Gets I/O statistics of a block device.
+ */
+PUBLIC int bdev_stat(dev_t dev, struct iostat *buf)
+{
+	/* Invalid device. */
+	if ((MAJOR(dev) >= NR_BLKDEV) || (bdevsw[MAJOR(dev)] == NULL))
+		return (-EINVAL);
+	
+	/* Operation not supported. */
+	if (bdevsw[MAJOR(dev)]->stat == NULL)
+		return (-ENOTSUP);
+	
+	return (bdevsw[MAJOR(dev)]->stat(MINOR(dev), buf));
+}
+
+/*
+ * Accounts a request that enters the queue of a block device.
+ */
+PUBLIC void bdev_acct_issue(struct bdev_acct *acct)
+{
+	acct->io.requests++;
+	acct->io.queued++;
+	acct->io.depth += acct->io.queued;
+}
+
+/*
+ * Accounts a request that has just completed.
+ */
+PUBLIC void bdev_acct_done(struct bdev_acct *acct, int op, size_t n,
+	unsigned issued)
+{
+	acct->io.queued--;
+	acct->io.wait += ticks - issued;
+	
+	if (op == BDEV_FLUSH)
+		acct->io.flushes++;
+	else if (op == BDEV_WRITE)
+	{
+		acct->io.writes++;
+		acct->io.wsectors += n >> 9;
+	}
+	else
+	{
+		acct->io.reads++;
+		acct->io.rsectors += n >> 9;
+	}
+}
+
+/*
+ * Accounts a command that is sent to a block device.
+ */
+PUBLIC void bdev_acct_start(struct bdev_acct *acct, int n)
+{
+	/* Device was idle. */
+	if (acct->io.inflight == 0)
+		acct->since = ticks;
+	
+	acct->io.commands++;
+	acct->io.merges += n - 1;
+	acct->io.inflight += n;
+}
+
+/*
+ * Accounts a command that is done.
+ */
+PUBLIC void bdev_acct_end(struct bdev_acct *acct, int n)
+{
+	acct->io.inflight -= n;
+	
+	/* Device is idle. */
+	if (acct->io.inflight == 0)
+		acct->io.busy += ticks - acct->since;
+}
+
+/*
+ * Takes a snapshot of the I/O statistics of a block device.
+ */
+PUBLIC void bdev_acct_stat(const struct bdev_acct *acct, struct iostat *buf)
+{
+	kmemcpy(buf, &acct->io, sizeof(struct iostat));
+	
+	/* Device is busy right now. */
+	if (acct->io.inflight > 0)
+		buf->busy += ticks - acct->since;
+}
+
+/*
+ * Maps a block of a block device in place.
+ */
+PUBLIC void *bdev_direct(dev_t dev, block_t num)
+{
+	/* Invalid device. */
+	if ((MAJOR(dev) >= NR_BLKDEV) || (bdevsw[MAJOR(dev)] == NULL))
+		return (NULL);
+	
+	/* Device is not directly accessible. */
+	if (bdevsw[MAJOR(dev)]->direct == NULL)
+		return (NULL);
+	
+	return (bdevsw[MAJOR(dev)]->direct(MINOR(dev), num));
+}
+
+/*
+ * Issues a write barrier to a block device.
+ */
+PUBLIC int bdev_flush(dev_t dev)
+{
+	/* Invalid device. */
+	if ((MAJOR(dev) >= NR_BLKDEV) || (bdevsw[MAJOR(dev)] == NULL))
+		return (-EINVAL);
+	
+	/* Device has no write cache. */
+	if (bdevsw[MAJOR(dev)]->flush == NULL)
+		return (0);
+	
+	return (bdevsw[MAJOR(dev)]->flush(MINOR(dev)));
+}
+
 /*============================================================================*
  *                                 Devices                                    *
  *============================================================================*/
 
+/*
+ * Initializes a device driver, and reports how long it took.
+ */
+PRIVATE void dev_init_timed(const char *name, void (*init)(void))
+{
+	uint64_t start; /* Time stamp at start. */
+	
+	boot_mark(name);
+	start = clock_cycles();
+	init();
+	kprintf("dev: %s took %d kcycles", name,
+		(unsigned)((clock_cycles() - start) >> 10));
+}
+
 /*
  * Initializes device drivers.
+ * 
+ * The clock goes first, so that the other drivers can be
+ * timed. ATA devices are probed in the background, while
+ * the rest of the kernel initializes, until dev_probe().
  */
 PUBLIC void dev_init(void)
 {
 	klog_init();
-	ata_init();
 	clock_init(CLOCK_FREQ);
-	fpu_init();
-	tty_init();
-	ramdisk_init();
+	dev_init_timed("bootlog", bootlog_init);
+	dev_init_timed("ktrace", ktrace_init);
+	dev_init_timed("kprof", kprof_init);
+	dev_init_timed("ata", ata_init);
+	dev_init_timed("ahci", ahci_init);
+	dev_init_timed("virtblk", virtblk_init);
+	dev_init_timed("virtnet", virtnet_init);
+	dev_init_timed("fpu", fpu_init);
+	dev_init_timed("pmc", pmc_init);
+	dev_init_timed("tty", tty_init);
+	dev_init_timed("uart", uart_init);
+	dev_init_timed("ramdisk", ramdisk_init);
+}
+
+/*
+ * Completes device probing.
+ */
+PUBLIC void dev_probe(void)
+{
+	dev_init_timed("ata probe", ata_probe);
 }
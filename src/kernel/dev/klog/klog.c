@@ -22,8 +22,12 @@
 #include <nanvix/const.h>
 #include <nanvix/dev.h>
 #include <nanvix/klib.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
 #include <nanvix/syscall.h>
+#include <sys/klog.h>
 #include <sys/types.h> 
+#include <errno.h>
 
 /* Error checking. */
 #if KLOG_SIZE > KBUFFER_SIZE
@@ -32,6 +36,11 @@
 
 #define TL_CONST 3
 
+/**
+ * @brief Messages whose log level is above this one are dropped.
+ */
+PUBLIC char klog_level = '7';
+
 /**
  * @brief Kernel log.
  */
@@ -204,6 +213,42 @@ PUBLIC ssize_t klog_read(unsigned minor, char *buffer, size_t n)
 	return ((ssize_t)(p - buffer));
 }
 
+/**
+ * @brief Performs control operations on the kernel log.
+ * 
+ * @param minor Minor device number (ignored).
+ * @param cmd   Command.
+ * @param arg   Command argument.
+ * 
+ * @returns Upon successful completion, zero is returned. Upon failure, a
+ *          negative error code is returned instead.
+ */
+PRIVATE int klog_ioctl(unsigned minor, unsigned cmd, unsigned arg)
+{
+	UNUSED(minor);
+	
+	switch (cmd)
+	{
+		/* Set log level. */
+		case KLOG_SETLEVEL:
+			if (!IS_SUPERUSER(curr_proc))
+				return (-EPERM);
+			if (arg > 7)
+				return (-EINVAL);
+			klog_level = '0' + arg;
+			return (0);
+		
+		/* Get log level. */
+		case KLOG_GETLEVEL:
+			if (!chkmem((void *)arg, sizeof(unsigned), MAY_WRITE))
+				return (-EFAULT);
+			*((unsigned *)arg) = klog_level - '0';
+			return (0);
+	}
+	
+	return (-EINVAL);
+}
+
 /**
  * @brief Dummy open() operation.
  */
@@ -231,8 +276,9 @@ PRIVATE struct cdev klog_driver = {
 	&klog_open,  /* open()  */
 	&klog_read,  /* read()  */
 	NULL,        /* write() */
-	NULL,        /* ioctl() */
-	&klog_close  /* close() */
+	&klog_ioctl, /* ioctl() */
+	&klog_close, /* close() */
+	NULL         /* poll()  */
 };
 	
 /**
@@ -0,0 +1,212 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/clock.h>
+#include <nanvix/config.h>
+#include <nanvix/const.h>
+#include <nanvix/dev.h>
+#include <nanvix/hal.h>
+#include <nanvix/klib.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include <dev/kprof.h>
+#include <i386/int.h>
+#include <sys/kprof.h>
+#include <sys/types.h>
+#include <errno.h>
+#include <stdint.h>
+
+/* Error checking. */
+#if (KPROF_SIZE & (KPROF_SIZE - 1))
+	#error "KPROF_SIZE must be a power of two"
+#endif
+
+/**
+ * @brief Is the profiler sampling?
+ */
+PUBLIC int kprof_on = 0;
+
+/**
+ * @brief Profiler samples.
+ */
+PRIVATE struct
+{
+	unsigned head;                           /**< Next slot to write. */
+	unsigned tail;                           /**< Next slot to read.  */
+	unsigned lost;                           /**< Samples lost.       */
+	struct kprof_sample samples[KPROF_SIZE]; /**< Ring buffer.        */
+} kprof;
+
+/**
+ * @brief Samples the interrupted context.
+ * 
+ * @details Records the instruction pointer, the privilege level and the
+ *          process that were interrupted by the clock. This is called from
+ *          the clock interrupt handler, whose interrupt stack frame is the
+ *          one pointed to by the kernel stack pointer of the current
+ *          process. When the ring is full, the sample is dropped and
+ *          accounted as lost.
+ */
+PUBLIC void kprof_tick(void)
+{
+	struct intstack *s;       /* Interrupt stack frame. */
+	struct kprof_sample *smp; /* Working sample.        */
+	
+	/* Ring is full. */
+	if (kprof.head - kprof.tail == KPROF_SIZE)
+	{
+		kprof.lost++;
+		return;
+	}
+	
+	s = (struct intstack *)curr_proc->kesp;
+	smp = &kprof.samples[kprof.head & (KPROF_SIZE - 1)];
+	
+	smp->eip = s->eip;
+	smp->pid = curr_proc->pid;
+	smp->mode = ((s->cs & 3) == 3) ? KPROF_USER : 0;
+	
+	kprof.head++;
+}
+
+/**
+ * @brief Reads profiler samples.
+ * 
+ * @param minor Minor device number (ignored).
+ * @param buf   Buffer where samples shall be placed.
+ * @param n     Number of bytes to read.
+ * 
+ * @returns The number of bytes actually read. Zero is returned if there are no
+ *          samples left.
+ */
+PRIVATE ssize_t kprof_read(unsigned minor, char *buf, size_t n)
+{
+	struct kprof_sample *p;   /* Write pointer. */
+	struct kprof_sample *end; /* End of buffer. */
+	
+	UNUSED(minor);
+	
+	p = (struct kprof_sample *)buf;
+	end = p + n/sizeof(struct kprof_sample);
+	
+	disable_interrupts();
+	
+		while ((p < end) && (kprof.tail != kprof.head))
+		{
+			kmemcpy(p++, &kprof.samples[kprof.tail & (KPROF_SIZE - 1)],
+				sizeof(struct kprof_sample));
+			kprof.tail++;
+		}
+	
+	enable_interrupts();
+	
+	return ((ssize_t)((char *)p - buf));
+}
+
+/**
+ * @brief Performs control operations on the kernel profiler.
+ * 
+ * @details KPROF_START discards samples that were not read yet and starts
+ *          sampling @p arg times per clock tick, by speeding up the clock.
+ *          Zero samples once per clock tick. KPROF_STOP stops sampling and
+ *          brings the clock back to its normal rate.
+ * 
+ * @param minor Minor device number (ignored).
+ * @param cmd   Command.
+ * @param arg   Command argument.
+ * 
+ * @returns Upon successful completion, zero is returned. Upon failure, a
+ *          negative error code is returned instead.
+ */
+PRIVATE int kprof_ioctl(unsigned minor, unsigned cmd, unsigned arg)
+{
+	UNUSED(minor);
+	
+	switch (cmd)
+	{
+		/* Start sampling. */
+		case KPROF_START:
+			if (arg > KPROF_RATE_MAX)
+				return (-EINVAL);
+			disable_interrupts();
+			kprof.tail = kprof.head;
+			kprof.lost = 0;
+			kprof_on = 1;
+			clock_profile((arg == 0) ? 1 : arg);
+			enable_interrupts();
+			return (0);
+		
+		/* Stop sampling. */
+		case KPROF_STOP:
+			disable_interrupts();
+			kprof_on = 0;
+			clock_profile(1);
+			enable_interrupts();
+			return (0);
+		
+		/* Get samples lost. */
+		case KPROF_GETLOST:
+			if (!chkmem((void *)arg, sizeof(unsigned), MAY_WRITE))
+				return (-EFAULT);
+			*((unsigned *)arg) = kprof.lost;
+			return (0);
+	}
+	
+	return (-EINVAL);
+}
+
+/**
+ * @brief Dummy open() operation.
+ */
+PRIVATE int kprof_open(unsigned minor)
+{
+	UNUSED(minor);
+	
+	return (0);
+}
+
+/**
+ * @brief Dummy close() operation.
+ */
+PRIVATE int kprof_close(unsigned minor)
+{
+	UNUSED(minor);
+	
+	return (0);
+}
+
+/**
+ * @brief Kernel profiler driver.
+ */
+PRIVATE struct cdev kprof_driver = {
+	&kprof_open,  /* open()  */
+	&kprof_read,  /* read()  */
+	NULL,         /* write() */
+	&kprof_ioctl, /* ioctl() */
+	&kprof_close, /* close() */
+	NULL          /* poll()  */
+};
+
+/**
+ * @brief Initializes the kernel profiler driver.
+ */
+PUBLIC void kprof_init(void)
+{
+	cdev_register(KPROF_MAJOR, &kprof_driver);
+}
@@ -0,0 +1,258 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/clock.h>
+#include <nanvix/config.h>
+#include <nanvix/const.h>
+#include <nanvix/dev.h>
+#include <nanvix/klib.h>
+#include <nanvix/ktrace.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include <dev/ktrace.h>
+#include <sys/types.h>
+#include <errno.h>
+#include <stdint.h>
+
+/* Error checking. */
+#if (KTRACE_SIZE & (KTRACE_SIZE - 1))
+	#error "KTRACE_SIZE must be a power of two"
+#endif
+
+/**
+ * @brief Compiler barrier.
+ */
+#define barrier() __asm__ volatile ("" ::: "memory")
+
+/**
+ * @brief Events that are being traced.
+ */
+PUBLIC unsigned ktrace_mask = 0;
+
+/**
+ * @brief Kernel trace.
+ */
+PRIVATE struct
+{
+	uint32_t head;                             /**< Next slot to reserve. */
+	uint32_t tail;                             /**< Next slot to read.    */
+	unsigned lost;                             /**< Records lost.         */
+	struct ktrace_record records[KTRACE_SIZE]; /**< Ring buffer.          */
+} ktrace;
+
+/**
+ * @brief Records a trace event.
+ * 
+ * @details A slot is first reserved with an atomic increment of the ring head,
+ *          so interrupt handlers that come in halfway through get slots of
+ *          their own, and nobody ever waits for a lock. The sequence number of
+ *          the record is written last, so that readers can tell records that
+ *          are complete from records that are not.
+ * 
+ * @param id Event ID.
+ * @param a0 First argument.
+ * @param a1 Second argument.
+ */
+PUBLIC void ktrace_emit(unsigned id, uint32_t a0, uint32_t a1)
+{
+	uint32_t slot;             /* Reserved slot.  */
+	struct ktrace_record *rec; /* Working record. */
+	
+	slot = __sync_fetch_and_add(&ktrace.head, 1);
+	rec = &ktrace.records[slot & (KTRACE_SIZE - 1)];
+	
+	rec->seq = 0;
+	barrier();
+	
+	rec->tsc = clock_cycles();
+	rec->id = id;
+	rec->pid = curr_proc->pid;
+	rec->args[0] = a0;
+	rec->args[1] = a1;
+	rec->args[2] = 0;
+	rec->args[3] = 0;
+	
+	barrier();
+	rec->seq = slot + 1;
+}
+
+/**
+ * @brief Reads from the kernel trace.
+ * 
+ * @details Copies whole records to the buffer pointed to by @p buf. When the
+ *          reader falls behind by more than a ring's worth of records, the
+ *          oldest ones are skipped and accounted as lost. Records are copied
+ *          first and validated after, so that records which are overwritten
+ *          during the copy are discarded too.
+ * 
+ * @param minor Minor device number (ignored).
+ * @param buf   Buffer where records shall be placed.
+ * @param n     Number of bytes to read.
+ * 
+ * @returns The number of bytes actually read. Zero is returned if there are no
+ *          new records.
+ */
+PRIVATE ssize_t ktrace_read(unsigned minor, char *buf, size_t n)
+{
+	uint32_t head;             /* Ring head.      */
+	struct ktrace_record rec;  /* Working record. */
+	struct ktrace_record *p;   /* Write pointer.  */
+	struct ktrace_record *end; /* End of buffer.  */
+	
+	UNUSED(minor);
+	
+	p = (struct ktrace_record *)buf;
+	end = p + n/sizeof(struct ktrace_record);
+	
+	head = ktrace.head;
+	
+	/* Overrun. */
+	if (head - ktrace.tail > KTRACE_SIZE)
+	{
+		ktrace.lost += head - ktrace.tail - KTRACE_SIZE;
+		ktrace.tail = head - KTRACE_SIZE;
+	}
+	
+	while ((p < end) && (ktrace.tail != head))
+	{
+		kmemcpy(&rec, &ktrace.records[ktrace.tail & (KTRACE_SIZE - 1)],
+			sizeof(struct ktrace_record));
+		barrier();
+		
+		/* Still being written. */
+		if (rec.seq == 0)
+			break;
+		
+		/* Overwritten. */
+		if ((rec.seq != ktrace.tail + 1) || 
+			(ktrace.records[ktrace.tail & (KTRACE_SIZE - 1)].seq != rec.seq))
+		{
+			ktrace.lost++;
+			ktrace.tail++;
+			continue;
+		}
+		
+		kmemcpy(p++, &rec, sizeof(struct ktrace_record));
+		ktrace.tail++;
+	}
+	
+	return ((ssize_t)((char *)p - buf));
+}
+
+/**
+ * @brief Writes a user marker to the kernel trace.
+ * 
+ * @param minor Minor device number (ignored).
+ * @param buf   Two words of marker arguments.
+ * @param n     Number of bytes to write.
+ * 
+ * @returns The number of bytes written.
+ */
+PRIVATE ssize_t ktrace_write(unsigned minor, const char *buf, size_t n)
+{
+	uint32_t args[2]; /* Marker arguments. */
+	
+	UNUSED(minor);
+	
+	args[0] = args[1] = 0;
+	kmemcpy(args, buf, (n < sizeof(args)) ? n : sizeof(args));
+	
+	ktrace(KTRACE_USER, args[0], args[1]);
+	
+	return ((ssize_t)n);
+}
+
+/**
+ * @brief Performs control operations on the kernel trace.
+ * 
+ * @param minor Minor device number (ignored).
+ * @param cmd   Command.
+ * @param arg   Command argument.
+ * 
+ * @returns Upon successful completion, zero is returned. Upon failure, a
+ *          negative error code is returned instead.
+ */
+PRIVATE int ktrace_ioctl(unsigned minor, unsigned cmd, unsigned arg)
+{
+	UNUSED(minor);
+	
+	switch (cmd)
+	{
+		/* Set event mask. */
+		case KTRACE_SETMASK:
+			ktrace_mask = arg & KTRACE_ALL;
+			return (0);
+		
+		/* Get TSC rate. */
+		case KTRACE_GETRATE:
+			if (!chkmem((void *)arg, sizeof(unsigned), MAY_WRITE))
+				return (-EFAULT);
+			*((unsigned *)arg) = clock_rate();
+			return (0);
+		
+		/* Get records lost. */
+		case KTRACE_GETLOST:
+			if (!chkmem((void *)arg, sizeof(unsigned), MAY_WRITE))
+				return (-EFAULT);
+			*((unsigned *)arg) = ktrace.lost;
+			return (0);
+	}
+	
+	return (-EINVAL);
+}
+
+/**
+ * @brief Dummy open() operation.
+ */
+PRIVATE int ktrace_open(unsigned minor)
+{
+	UNUSED(minor);
+	
+	return (0);
+}
+
+/**
+ * @brief Dummy close() operation.
+ */
+PRIVATE int ktrace_close(unsigned minor)
+{
+	UNUSED(minor);
+	
+	return (0);
+}
+
+/**
+ * @brief Kernel trace driver.
+ */
+PRIVATE struct cdev ktrace_driver = {
+	&ktrace_open,  /* open()  */
+	&ktrace_read,  /* read()  */
+	&ktrace_write, /* write() */
+	&ktrace_ioctl, /* ioctl() */
+	&ktrace_close, /* close() */
+	NULL           /* poll()  */
+};
+
+/**
+ * @brief Initializes the kernel trace driver.
+ */
+PUBLIC void ktrace_init(void)
+{
+	cdev_register(KTRACE_MAJOR, &ktrace_driver);
+}
@@ -0,0 +1,146 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/hal.h>
+#include <dev/pci.h>
+#include <stdint.h>
+
+/* PCI configuration mechanism #1 ports. */
+#define PCI_CONFIG_ADDRESS 0xcf8 /* Configuration address. */
+#define PCI_CONFIG_DATA    0xcfc /* Configuration data.    */
+
+/* Number of PCI buses, slots and functions. */
+#define PCI_NR_BUSES 256 /* Buses.              */
+#define PCI_NR_SLOTS  32 /* Slots per bus.      */
+#define PCI_NR_FUNCS   8 /* Functions per slot. */
+
+/* Invalid vendor ID. */
+#define PCI_VENDOR_NONE 0xffff
+
+/*
+ * Builds a configuration address.
+ */
+#define pci_address(dev, reg)                        \
+	((1 << 31) | ((dev)->bus << 16) |                \
+	((dev)->slot << 11) | ((dev)->func << 8) | ((reg) & 0xfc))
+
+/**
+ * @brief Reads a PCI configuration register.
+ * 
+ * @param dev PCI device.
+ * @param reg Configuration register (double word aligned).
+ * 
+ * @returns The value of the configuration register.
+ */
+PUBLIC uint32_t pci_read(const struct pci_dev *dev, unsigned reg)
+{
+	outputl(PCI_CONFIG_ADDRESS, pci_address(dev, reg));
+	return (inputl(PCI_CONFIG_DATA));
+}
+
+/**
+ * @brief Writes a PCI configuration register.
+ * 
+ * @param dev PCI device.
+ * @param reg Configuration register (double word aligned).
+ * @param val Value to write.
+ */
+PUBLIC void pci_write(const struct pci_dev *dev, unsigned reg, uint32_t val)
+{
+	outputl(PCI_CONFIG_ADDRESS, pci_address(dev, reg));
+	outputl(PCI_CONFIG_DATA, val);
+}
+
+/*
+ * Scans all PCI buses, looking for the nth function whose
+ * configuration register reg matches value under mask.
+ */
+PRIVATE int
+pci_scan(struct pci_dev *dev, unsigned reg, uint32_t mask, uint32_t value, unsigned n)
+{
+	for (dev->bus = 0; dev->bus < PCI_NR_BUSES; dev->bus++)
+	{
+		for (dev->slot = 0; dev->slot < PCI_NR_SLOTS; dev->slot++)
+		{
+			for (dev->func = 0; dev->func < PCI_NR_FUNCS; dev->func++)
+			{
+				/* No such function. */
+				if ((pci_read(dev, PCI_REG_ID) & 0xffff) == PCI_VENDOR_NONE)
+				{
+					/* No such device. */
+					if (dev->func == 0)
+						break;
+					continue;
+				}
+				
+				/* Found. */
+				if ((pci_read(dev, reg) & mask) == value)
+				{
+					if (n-- == 0)
+						return (0);
+				}
+				
+				/* Single function device. */
+				if ((dev->func == 0) &&
+					!(pci_read(dev, PCI_REG_HEADER) & (0x80 << 16)))
+					break;
+			}
+		}
+	}
+	
+	return (-1);
+}
+
+/**
+ * @brief Finds a PCI device by class.
+ * 
+ * @details Scans all PCI buses, looking for the first function whose class
+ *          code and subclass match @p class and @p subclass.
+ * 
+ * @param dev      Store location for the device address.
+ * @param class    Class code.
+ * @param subclass Subclass code.
+ * 
+ * @returns Zero if a matching device is found and -1 otherwise.
+ */
+PUBLIC int pci_find(struct pci_dev *dev, unsigned class, unsigned subclass)
+{
+	return (pci_scan(dev, PCI_REG_CLASS, 0xffff0000,
+		(class << 24) | (subclass << 16), 0));
+}
+
+/**
+ * @brief Finds a PCI device by vendor and device IDs.
+ * 
+ * @details Scans all PCI buses, looking for the nth function whose vendor
+ *          and device IDs match @p vendor and @p device.
+ * 
+ * @param dev    Store location for the device address.
+ * @param vendor Vendor ID.
+ * @param device Device ID.
+ * @param n      Number of matching functions to skip.
+ * 
+ * @returns Zero if a matching device is found and -1 otherwise.
+ */
+PUBLIC int
+pci_find_id(struct pci_dev *dev, unsigned vendor, unsigned device, unsigned n)
+{
+	return (pci_scan(dev, PCI_REG_ID, 0xffffffff, (device << 16) | vendor, n));
+}
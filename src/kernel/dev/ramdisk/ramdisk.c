@@ -17,11 +17,13 @@
  * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <nanvix/clock.h>
 #include <nanvix/config.h>
 #include <nanvix/const.h>
 #include <nanvix/dev.h>
 #include <nanvix/fs.h>
 #include <nanvix/hal.h>
+#include <nanvix/initrd.h>
 #include <nanvix/klib.h>
 #include <nanvix/mm.h>
 #include <sys/types.h>
@@ -32,51 +34,110 @@
 	#error "RAMDISK_SIZE > PGTAB_SIZE"
 #endif
 
-/* Number of RAM disks. */
-#define NR_RAMDISKS 1
+/* Memory disks, and a compressed INITRD, live in the kernel page pool. */
+#if NR_RAMDISKS*RAMDISK_SIZE > KPOOL_SIZE/2
+	#error "RAM disks too big"
+#endif
+
+/* Number of pages in a memory disk. */
+#define NR_RAMDISK_PAGES (RAMDISK_SIZE/PAGE_SIZE)
 
 /*
  * RAM disks.
  */
 PRIVATE struct
 {
-	addr_t start; /* Start address.   */
-	addr_t end;   /* End address.     */
-	size_t size;  /* Size (in bytes). */
+	addr_t start;                  /* Start address.   */
+	addr_t end;                    /* End address.     */
+	size_t size;                   /* Size (in bytes). */
+	char *pages[NR_RAMDISK_PAGES]; /* Backing pages.   */
+	struct bdev_acct stats;        /* I/O statistics.  */
 } ramdisks[NR_RAMDISKS];
 
+/*
+ * Accounts a request of n bytes to a RAM disk device. Requests
+ * are served right away, so they never wait nor keep it busy.
+ */
+PRIVATE void ramdisk_account(unsigned minor, int op, size_t n)
+{
+	disable_interrupts();
+	bdev_acct_issue(&ramdisks[minor].stats);
+	bdev_acct_start(&ramdisks[minor].stats, 1);
+	bdev_acct_done(&ramdisks[minor].stats, op, n, ticks);
+	bdev_acct_end(&ramdisks[minor].stats, 1);
+	enable_interrupts();
+}
+
+/*
+ * Gets a pointer to some offset in a RAM disk device.
+ * 
+ * An uncompressed INITRD is contiguous and always backed. The
+ * other RAM disks, and a compressed INITRD once it is inflated,
+ * are memory disks: they grab a kernel page the first time that
+ * some offset in it is written to, so they take as much memory
+ * as their contents need, up to RAMDISK_SIZE.
+ */
+PRIVATE char *ramdisk_ptr(unsigned minor, off_t off, int alloc)
+{
+	char **pg; /* Backing page. */
+	
+	/* Invalid offset. */
+	if ((off < 0) || ((size_t)off >= ramdisks[minor].size))
+		return (NULL);
+	
+	/* Contiguous RAM disk. */
+	if (ramdisks[minor].start != 0)
+		return ((char *)(ramdisks[minor].start + off));
+	
+	pg = &ramdisks[minor].pages[off >> PAGE_SHIFT];
+	
+	/* Back page. */
+	if ((*pg == NULL) && (alloc))
+	{
+		if ((*pg = getkpg(1)) == NULL)
+			kprintf("dev: ramdisk %d is out of memory", minor);
+	}
+	
+	return ((*pg != NULL) ? *pg + (off & ~PAGE_MASK) : NULL);
+}
+
 /*
  * Writes to a RAM disk device.
  */
 PRIVATE ssize_t ramdisk_write(unsigned minor, const char *buf, size_t n, off_t off)
 {
 	size_t i;     /* Loop index.       */
-	addr_t ptr;   /* Write pointer.    */
+	char *ptr;    /* Write pointer.    */
 	size_t count; /* # bytes to write. */
 	
 	/* Invalid device. */
 	if (minor >= NR_RAMDISKS)
 		return (-EINVAL);
 	
-	ptr = ramdisks[minor].start + off;
-	
 	/* Invalid offset. */
-	if (ptr >= ramdisks[minor].end)
+	if ((off < 0) || ((size_t)off >= ramdisks[minor].size))
 		return (-EINVAL);
 	
-	/* Read as much as possible. */
-	if (ptr + n >= ramdisks[minor].end)
-		n = ramdisks[minor].end - ptr;
+	/* Write as much as possible. */
+	if (off + n >= ramdisks[minor].size)
+		n = ramdisks[minor].size - off;
+	
+	ramdisk_account(minor, BDEV_WRITE, n);
 	
 	/* Write in bursts. */
 	for (i = 0; i < n; /* noop */)
 	{
 		count = ((n - i) > BLOCK_SIZE) ? BLOCK_SIZE : (n - i);
+		if (count > PAGE_SIZE - ((off + i) & ~PAGE_MASK))
+			count = PAGE_SIZE - ((off + i) & ~PAGE_MASK);
+		
+		/* Out of memory. */
+		if ((ptr = ramdisk_ptr(minor, off + i, 1)) == NULL)
+			return ((i > 0) ? (ssize_t)i : -ENOSPC);
 		
-		kmemcpy((void *)ptr, buf, count);
+		kmemcpy(ptr, buf + i, count);
 		
 		i += count;
-		ptr += count;
 		
 		/* Avoid starvation. */
 		if (n > 0)
@@ -92,32 +153,37 @@ PRIVATE ssize_t ramdisk_write(unsigned minor, const char *buf, size_t n, off_t o
 PRIVATE ssize_t ramdisk_read(unsigned minor, char *buf, size_t n, off_t off)
 {
 	size_t i;     /* Loop index.      */
-	addr_t ptr;   /* Write pointer.   */
+	char *ptr;    /* Read pointer.    */
 	size_t count; /* # bytes to read. */
 	
 	/* Invalid device. */
 	if (minor >= NR_RAMDISKS)
 		return (-EINVAL);
 	
-	ptr = ramdisks[minor].start + off;
-	
 	/* Invalid offset. */
-	if (ptr >= ramdisks[minor].end)
+	if ((off < 0) || ((size_t)off >= ramdisks[minor].size))
 		return (-EINVAL);
 	
 	/* Read as much as possible. */
-	if (ptr + n >= ramdisks[minor].end)
-		n = ramdisks[minor].end - ptr;
+	if (off + n >= ramdisks[minor].size)
+		n = ramdisks[minor].size - off;
+	
+	ramdisk_account(minor, BDEV_READ, n);
 	
 	/* Read in bursts. */
 	for (i = 0; i < n; /* noop */)
 	{
 		count = ((n - i) > BLOCK_SIZE) ? BLOCK_SIZE : (n - i);
+		if (count > PAGE_SIZE - ((off + i) & ~PAGE_MASK))
+			count = PAGE_SIZE - ((off + i) & ~PAGE_MASK);
 		
-		kmemcpy(buf, (void *)ptr, count);
+		/* Never written pages read as zeros. */
+		if ((ptr = ramdisk_ptr(minor, off + i, 0)) == NULL)
+			kmemset(buf + i, 0, count);
+		else
+			kmemcpy(buf + i, ptr, count);
 		
 		i += count;
-		ptr += count;
 		
 		/* Avoid starvation. */
 		if (n > 0)
@@ -132,11 +198,23 @@ PRIVATE ssize_t ramdisk_read(unsigned minor, char *buf, size_t n, off_t off)
  */
 PRIVATE int ramdisk_readblk(unsigned minor, buffer_t buf)
 {	
-	addr_t ptr;
+	char *ptr;
+	
+	ramdisk_account(minor, BDEV_READ, BLOCK_SIZE);
+	ptr = ramdisk_ptr(minor, buffer_num(buf) << BLOCK_SIZE_LOG2, 0);
 	
-	ptr = ramdisks[minor].start + (buffer_num(buf) << BLOCK_SIZE_LOG2);
+	/* Never written blocks read as zeros. */
+	if (ptr == NULL)
+		kmemset(buffer_data(buf), 0, BLOCK_SIZE);
+	else
+		kmemcpy(buffer_data(buf), ptr, BLOCK_SIZE);
 	
-	kmemcpy(buffer_data(buf), (void *)ptr, BLOCK_SIZE);
+	/* Release read-ahead buffer. */
+	if (buffer_is_async(buf))
+	{
+		buffer_valid(buf, 1);
+		brelse(buf);
+	}
 	
 	return (0);
 }
@@ -146,11 +224,14 @@ PRIVATE int ramdisk_readblk(unsigned minor, buffer_t buf)
  */
 PRIVATE int ramdisk_writeblk(unsigned minor, buffer_t buf)
 {	
-	addr_t ptr;
+	char *ptr;
 	
-	ptr = ramdisks[minor].start + (buffer_num(buf) << BLOCK_SIZE_LOG2);
+	ramdisk_account(minor, BDEV_WRITE, BLOCK_SIZE);
+	ptr = ramdisk_ptr(minor, buffer_num(buf) << BLOCK_SIZE_LOG2, 1);
 	
-	kmemcpy((void *)ptr, buffer_data(buf), BLOCK_SIZE);
+	/* Out of memory, so the block is lost. */
+	if (ptr != NULL)
+		kmemcpy(ptr, buffer_data(buf), BLOCK_SIZE);
 	
 	buffer_dirty(buf, 0);
 	brelse(buf);
@@ -158,6 +239,138 @@ PRIVATE int ramdisk_writeblk(unsigned minor, buffer_t buf)
 	return (0);
 }
 
+/*
+ * Gets I/O statistics of a RAM disk device.
+ */
+PRIVATE int ramdisk_stat(unsigned minor, struct iostat *buf)
+{
+	struct iostat st;
+	
+	/* Invalid device. */
+	if (minor >= NR_RAMDISKS)
+		return (-EINVAL);
+	
+	disable_interrupts();
+	bdev_acct_stat(&ramdisks[minor].stats, &st);
+	enable_interrupts();
+	
+	kmemcpy(buf, &st, sizeof(struct iostat));
+	
+	return (0);
+}
+
+/*
+ * Maps a block of a RAM disk device in place.
+ */
+PRIVATE void *ramdisk_direct(unsigned minor, block_t num)
+{
+	/* Invalid device. */
+	if (minor >= NR_RAMDISKS)
+		return (NULL);
+	
+	return (ramdisk_ptr(minor, num << BLOCK_SIZE_LOG2, 1));
+}
+
+/*
+ * Writes a byte of the INITRD while it is inflated.
+ * 
+ * Zeros are not written to pages that were never
+ * backed, since these already read as zeros.
+ */
+PRIVATE void initrd_put(size_t off, char c)
+{
+	char *ptr;
+	
+	if ((c == 0) && (ramdisks[0].pages[off >> PAGE_SHIFT] == NULL))
+		return;
+	
+	if ((ptr = ramdisk_ptr(0, off, 1)) == NULL)
+		kpanic("initrd is too big");
+	
+	*ptr = c;
+}
+
+/*
+ * Reads a byte of the INITRD while it is inflated.
+ */
+PRIVATE char initrd_get(size_t off)
+{
+	char *ptr;
+	
+	ptr = ramdisk_ptr(0, off, 0);
+	
+	return ((ptr != NULL) ? *ptr : 0);
+}
+
+/*
+ * Reads a length that does not fit in an LZ4 token.
+ */
+PRIVATE int initrd_len(const unsigned char *src, size_t csize, size_t *i, size_t *len)
+{
+	unsigned char c;
+	
+	do
+	{
+		/* Truncated length. */
+		if (*i >= csize)
+			return (-1);
+		
+		c = src[(*i)++];
+		*len += c;
+	} while (c == 255);
+	
+	return (0);
+}
+
+/*
+ * Inflates a compressed INITRD, which is a single LZ4 block,
+ * into pages of the kernel page pool.
+ */
+PRIVATE int initrd_inflate(const unsigned char *src, size_t csize, size_t size)
+{
+	size_t i;       /* Input position.  */
+	size_t o;       /* Output position. */
+	size_t len;     /* Working length.  */
+	size_t offset;  /* Match offset.    */
+	unsigned token; /* Sequence token.  */
+	
+	i = o = 0;
+	while (i < csize)
+	{
+		token = src[i++];
+		
+		/* Copy literals. */
+		len = token >> 4;
+		if ((len == 15) && (initrd_len(src, csize, &i, &len)))
+			return (-1);
+		if ((i + len > csize) || (o + len > size))
+			return (-1);
+		while (len-- > 0)
+			initrd_put(o++, src[i++]);
+		
+		/* Last sequence has no match. */
+		if (i == csize)
+			break;
+		
+		/* Copy match. */
+		if (i + 2 > csize)
+			return (-1);
+		offset = src[i] | (src[i + 1] << 8);
+		i += 2;
+		if ((offset == 0) || (offset > o))
+			return (-1);
+		len = (token & 15) + 4;
+		if (((token & 15) == 15) && (initrd_len(src, csize, &i, &len)))
+			return (-1);
+		if (o + len > size)
+			return (-1);
+		for (/* noop */; len > 0; len--, o++)
+			initrd_put(o, initrd_get(o - offset));
+	}
+	
+	return ((o == size) ? 0 : -1);
+}
+
 /*
  * RAM disk device driver interface.
  */
@@ -165,7 +378,10 @@ PRIVATE const struct bdev ramdisk_driver = {
 	&ramdisk_read,     /* read()     */
 	&ramdisk_write,    /* write()    */
 	&ramdisk_readblk,  /* readblk()  */
-	&ramdisk_writeblk  /* writeblk() */
+	&ramdisk_writeblk, /* writeblk() */
+	&ramdisk_stat,     /* stat()     */
+	NULL,              /* flush()    */
+	&ramdisk_direct    /* direct()   */
 };
 
 /*
@@ -174,6 +390,7 @@ PRIVATE const struct bdev ramdisk_driver = {
 PUBLIC void ramdisk_init(void)
 {
 	int err;
+	struct initrd_header *hdr;
 	
 	kprintf("dev: initializing ramdisk device driver");
 
@@ -182,6 +399,36 @@ PUBLIC void ramdisk_init(void)
 	ramdisks[0].end = INITRD_VIRT + INITRD_SIZE;
 	ramdisks[0].size = INITRD_SIZE;
 	
+	/* Inflate compressed INITRD. */
+	hdr = (struct initrd_header *)INITRD_VIRT;
+	if (hdr->magic == INITRD_MAGIC)
+	{
+		if ((hdr->size > RAMDISK_SIZE) ||
+			(hdr->csize > INITRD_SIZE - sizeof(struct initrd_header)))
+			kpanic("bad initrd size");
+		
+		ramdisks[0].start = 0;
+		ramdisks[0].end = hdr->size;
+		ramdisks[0].size = hdr->size;
+		for (unsigned j = 0; j < NR_RAMDISK_PAGES; j++)
+			ramdisks[0].pages[j] = NULL;
+		
+		if (initrd_inflate((unsigned char *)(hdr + 1), hdr->csize, hdr->size))
+			kpanic("corrupted initrd");
+		
+		kprintf("dev: initrd inflated to %d kB", hdr->size >> 10);
+	}
+	
+	/* Memory disks are backed on demand. */
+	for (unsigned i = 1; i < NR_RAMDISKS; i++)
+	{
+		ramdisks[i].start = 0;
+		ramdisks[i].end = RAMDISK_SIZE;
+		ramdisks[i].size = RAMDISK_SIZE;
+		for (unsigned j = 0; j < NR_RAMDISK_PAGES; j++)
+			ramdisks[i].pages[j] = NULL;
+	}
+	
 	err = bdev_register(RAMDISK_MAJOR, &ramdisk_driver);
 	
 	/* Failed to register ramdisk device driver. */
@@ -17,9 +17,13 @@
  * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <nanvix/config.h>
 #include <nanvix/const.h>
 #include <nanvix/dev.h>
 #include <nanvix/hal.h>
+#include <nanvix/klib.h>
+#include <nanvix/mm.h>
+#include <dev/pci.h>
 #include <sys/types.h>
 #include <stdint.h>
 #include "tty.h"
@@ -29,6 +33,10 @@
 #define VIDEO_ADDR  0xb8000 /* Video memory address. */
 #define VIDEO_WIDTH      80 /* Video width.          */
 #define VIDEO_HIGH       25 /* Video high.           */
+#define VIDEO_SIZE   0x8000 /* Video memory size.    */
+
+/* Rows in the video memory ring. */
+#define VIDEO_ROWS ((int)(VIDEO_SIZE/(VIDEO_WIDTH*sizeof(uint16_t))))
 
 /* Video registers. */
 #define VIDEO_CRTL_REG 0x3d4 /* Video control register. */
@@ -61,130 +69,495 @@
 #define VIDEO_CMC  0x17 /* CRT mode control.               */
 #define VIDEO_LCMP 0x18 /* Line compare.                   */
 
+/* Rows of video memory that each virtual console owns. */
+#define VT_ROWS (VIDEO_ROWS/NR_VTS)
+
+#if (FBCONSOLE)
+
+/* VGA sequencer and graphics controller registers. */
+#define VGA_SEQ_INDEX 0x3c4 /* Sequencer index.           */
+#define VGA_SEQ_DATA  0x3c5 /* Sequencer data.            */
+#define VGA_GC_INDEX  0x3ce /* Graphics controller index. */
+#define VGA_GC_DATA   0x3cf /* Graphics controller data.  */
+
+/* VGA font plane. */
+#define VGA_FONT_ADDR  0xa0000 /* Font plane address.       */
+#define VGA_FONT_PITCH      32 /* Bytes per glyph in plane. */
+
+/* Bochs graphics adapter (QEMU "std" VGA). */
+#define BGA_VENDOR 0x1234 /* PCI vendor ID.                    */
+#define BGA_DEVICE 0x1111 /* PCI device ID.                    */
+#define BGA_INDEX  0x01ce /* Index port.                       */
+#define BGA_DATA   0x01cf /* Data port.                        */
+#define BGA_ID_MIN 0xb0c2 /* First ID with 32 bits per pixel. */
+
+/* Bochs graphics adapter registers. */
+#define BGA_REG_ID     0 /* Version ID.      */
+#define BGA_REG_XRES   1 /* Horizontal size. */
+#define BGA_REG_YRES   2 /* Vertical size.   */
+#define BGA_REG_BPP    3 /* Bits per pixel.  */
+#define BGA_REG_ENABLE 4 /* Enable.          */
+
+/* Bochs graphics adapter enable flags. */
+#define BGA_ENABLED 0x01 /* Display enabled.     */
+#define BGA_LFB     0x40 /* Linear frame buffer. */
+
+/* Frame buffer specifications. */
+#define FONT_WIDTH 8                                 /* Glyph width.     */
+#define FONT_HIGH 16                                 /* Glyph high.      */
+#define FB_WIDTH  (VIDEO_WIDTH*FONT_WIDTH)           /* Width in pixels. */
+#define FB_HIGH   (VIDEO_HIGH*FONT_HIGH)             /* High in pixels.  */
+#define FB_SIZE   (FB_WIDTH*FB_HIGH*sizeof(uint32_t)) /* Size in bytes.   */
+
+#endif
+
 /*
- * Console cursor.
+ * Virtual consoles.
  */
-PRIVATE struct 
+PRIVATE struct vconsole
 {
-	int x; /* Horizontal axis position. */
-	int y; /* Vertical axis position.   */
-} cursor;
+	int base; /* First row of the ring slice.    */
+	int top;  /* First row that is on screen.   */
+	int x;    /* Horizontal cursor position.    */
+	int y;    /* Vertical cursor position.      */
+} consoles[NR_VTS];
+
+/* Virtual console on screen. */
+PRIVATE unsigned visible = 0;
 
 /* Video memory.*/
 PRIVATE uint16_t *video = (uint16_t*)VIDEO_ADDR;
 
+#if (FBCONSOLE)
+
+/*
+ * Frame buffer, if the console is on one. Cells then live
+ * in a shadow ring, and rows of the visible console that
+ * changed are drawn on the frame buffer at each flush.
+ */
+PRIVATE uint32_t *fb = NULL;
+
+/* Shadow video memory. */
+PRIVATE uint16_t shadow[VIDEO_SIZE/sizeof(uint16_t)];
+
+/* Font, captured from the VGA font plane. */
+PRIVATE uint8_t font[256*FONT_HIGH];
+
+/* Scanline being drawn. */
+PRIVATE uint32_t line[FB_WIDTH];
+
+/* Rows of the screen that need to be drawn. */
+PRIVATE uint32_t dirty = 0;
+
+/* Screen row where the cursor was drawn. */
+PRIVATE int fb_cursor = 0;
+
+/* Text mode palette. */
+PRIVATE const uint32_t palette[16] = {
+	0x000000, 0x0000aa, 0x00aa00, 0x00aaaa,
+	0xaa0000, 0xaa00aa, 0xaa5500, 0xaaaaaa,
+	0x555555, 0x5555ff, 0x55ff55, 0x55ffff,
+	0xff5555, 0xff55ff, 0xffff55, 0xffffff
+};
+
+/*
+ * Marks a row of the ring as changed.
+ */
+PRIVATE inline void damage(int row)
+{
+	int y;
+	
+	/* Text mode. */
+	if (fb == NULL)
+		return;
+	
+	y = row - consoles[visible].top;
+	
+	/* Not on screen. */
+	if ((y < 0) || (y >= VIDEO_HIGH))
+		return;
+	
+	dirty |= 1 << y;
+}
+
+/*
+ * Draws changed rows of a virtual console on the frame buffer.
+ */
+PRIVATE void fb_flush(struct vconsole *c)
+{
+	uint16_t *cells; /* Row of cells.   */
+	uint32_t fg, bg; /* Colors.         */
+	uint32_t *p;     /* Working pixel.  */
+	uint8_t bits;    /* Glyph scanline. */
+	
+	for (int y = 0; y < VIDEO_HIGH; y++)
+	{
+		/* Unchanged row. */
+		if (!(dirty & (1 << y)))
+			continue;
+		
+		cells = &video[(c->top + y)*VIDEO_WIDTH];
+		
+		/*
+		 * Build whole scanlines and copy them out in
+		 * bulk, so that writes to the frame buffer are
+		 * sequential and get combined into bursts.
+		 */
+		for (int s = 0; s < FONT_HIGH; s++)
+		{
+			p = line;
+			for (int x = 0; x < VIDEO_WIDTH; x++)
+			{
+				fg = palette[(cells[x] >> 8) & 0x0f];
+				bg = palette[(cells[x] >> 12) & 0x0f];
+				bits = font[(cells[x] & 0xff)*FONT_HIGH + s];
+				
+				/* Block cursor. */
+				if ((x == c->x) && (y == c->y))
+					bits = ~bits;
+				
+				for (int i = 0; i < FONT_WIDTH; i++)
+					*p++ = (bits & (0x80 >> i)) ? fg : bg;
+			}
+			
+			kmemcpy(&fb[(y*FONT_HIGH + s)*FB_WIDTH], line, sizeof(line));
+		}
+	}
+	
+	dirty = 0;
+}
+
+/*
+ * Writes a VGA indexed register, returning its old value.
+ */
+PRIVATE byte_t vga_write(word_t index, byte_t reg, byte_t val)
+{
+	byte_t old;
+	
+	outputb(index, reg);
+	old = inputb(index + 1);
+	outputb(index + 1, val);
+	
+	return (old);
+}
+
+/*
+ * Captures the text mode font from the VGA font plane.
+ */
+PRIVATE int font_capture(void)
+{
+	byte_t seq2, seq4;    /* Old sequencer registers.           */
+	byte_t gc4, gc5, gc6; /* Old graphics controller registers. */
+	const uint8_t *plane; /* Font plane.                        */
+	unsigned bits;        /* Glyph bits of a sample character.  */
+	
+	/* Map the font plane for sequential reads. */
+	seq2 = vga_write(VGA_SEQ_INDEX, 0x02, 0x04);
+	seq4 = vga_write(VGA_SEQ_INDEX, 0x04, 0x07);
+	gc4 = vga_write(VGA_GC_INDEX, 0x04, 0x02);
+	gc5 = vga_write(VGA_GC_INDEX, 0x05, 0x00);
+	gc6 = vga_write(VGA_GC_INDEX, 0x06, 0x00);
+	
+	plane = (const uint8_t *)VGA_FONT_ADDR;
+	for (int i = 0; i < 256; i++)
+		kmemcpy(&font[i*FONT_HIGH], &plane[i*VGA_FONT_PITCH], FONT_HIGH);
+	
+	/* Back to text mode. */
+	vga_write(VGA_SEQ_INDEX, 0x02, seq2);
+	vga_write(VGA_SEQ_INDEX, 0x04, seq4);
+	vga_write(VGA_GC_INDEX, 0x04, gc4);
+	vga_write(VGA_GC_INDEX, 0x05, gc5);
+	vga_write(VGA_GC_INDEX, 0x06, gc6);
+	
+	/* Sanity check: an 'A' has something in it. */
+	bits = 0;
+	for (int s = 0; s < FONT_HIGH; s++)
+		bits |= font['A'*FONT_HIGH + s];
+	
+	return ((bits != 0) ? 0 : -1);
+}
+
+/*
+ * Writes a Bochs graphics adapter register.
+ */
+PRIVATE void bga_write(word_t reg, word_t val)
+{
+	outputw(BGA_INDEX, reg);
+	outputw(BGA_DATA, val);
+}
+
+/*
+ * Reads a Bochs graphics adapter register.
+ */
+PRIVATE word_t bga_read(word_t reg)
+{
+	outputw(BGA_INDEX, reg);
+	return (inputw(BGA_DATA));
+}
+
+/*
+ * Puts the console on a linear frame buffer.
+ */
+PRIVATE void fb_init(void)
+{
+	struct pci_dev pci; /* PCI device.                    */
+	addr_t base;        /* Frame buffer physical address. */
+	uint32_t *mem;      /* Frame buffer.                  */
+	
+	/* No Bochs graphics adapter. */
+	if (pci_find_id(&pci, BGA_VENDOR, BGA_DEVICE, 0))
+		return;
+	if (bga_read(BGA_REG_ID) < BGA_ID_MIN)
+		return;
+	
+	/* Font must be read while still in text mode. */
+	if (font_capture())
+		return;
+	
+	base = pci_read(&pci, PCI_REG_BAR0) & ~0xf;
+	pci_write(&pci, PCI_REG_COMMAND,
+		pci_read(&pci, PCI_REG_COMMAND) | PCI_CMD_MEMORY);
+	
+	if ((mem = mapiomem_wc(base, FB_SIZE)) == NULL)
+		return;
+	
+	bga_write(BGA_REG_ENABLE, 0);
+	bga_write(BGA_REG_XRES, FB_WIDTH);
+	bga_write(BGA_REG_YRES, FB_HIGH);
+	bga_write(BGA_REG_BPP, 32);
+	bga_write(BGA_REG_ENABLE, BGA_ENABLED | BGA_LFB);
+	
+	fb = mem;
+	video = shadow;
+	dirty = ~0;
+}
+
+#endif
+
+/* Blank cell. */
+#define BLANK ((BLACK << 8) | (' '))
+
+/* Cell at a given screen position. */
+#define CELL(c, x, y) \
+	video[((c)->top + (y))*VIDEO_WIDTH + (x)]
+
+/*
+ * Writes a CRTC register pair.
+ */
+PRIVATE void crtc_write(byte_t hi, byte_t lo, word_t val)
+{
+	outputb(VIDEO_CRTL_REG, hi);
+	outputb(VIDEO_DATA_REG, (byte_t) ((val >> 8) & 0xFF));
+	outputb(VIDEO_CRTL_REG, lo);
+	outputb(VIDEO_DATA_REG, (byte_t) (val & 0xFF));
+}
+
 /*
  * Moves the hardware console cursor.
  */
-PRIVATE void cursor_move(void)
+PRIVATE void cursor_move(struct vconsole *c)
 {
-	word_t cursor_location = cursor.y*VIDEO_WIDTH + cursor.x;
+	/* Not on screen. */
+	if (c != &consoles[visible])
+		return;
 	
-	outputb(VIDEO_CRTL_REG, VIDEO_CLH);
-	outputb(VIDEO_DATA_REG, (byte_t) ((cursor_location >> 8) & 0xFF));
-	outputb(VIDEO_CRTL_REG, VIDEO_CLL);
-	outputb(VIDEO_DATA_REG, (byte_t) (cursor_location & 0xFF));
+#if (FBCONSOLE)
+	/* Draw cursor and changes. */
+	if (fb != NULL)
+	{
+		dirty |= (1 << fb_cursor) | (1 << c->y);
+		fb_cursor = c->y;
+		fb_flush(c);
+		return;
+	}
+#endif
+	
+	crtc_write(VIDEO_CLH, VIDEO_CLL, (c->top + c->y)*VIDEO_WIDTH + c->x);
 }
 
 /*
- * Scrolls down the console by one row.
+ * Moves the display start to a virtual console.
  */
-PRIVATE void console_scrolldown(void)
+PRIVATE void display_move(struct vconsole *c)
 {
-	uint16_t *p;
+	/* Not on screen. */
+	if (c != &consoles[visible])
+		return;
 	
-	/* Pull lines up. */
-	for (p = video; p < (video + (VIDEO_HIGH-1)*(VIDEO_WIDTH)); p++)
-		*p = *(p + VIDEO_WIDTH);
+#if (FBCONSOLE)
+	/* Whole screen changes. */
+	if (fb != NULL)
+	{
+		dirty = ~0;
+		return;
+	}
+#endif
+	
+	crtc_write(VIDEO_SAH, VIDEO_SAL, c->top*VIDEO_WIDTH);
+}
+
+/*
+ * Blanks rows of the ring.
+ */
+PRIVATE void console_blank(int row, int nrows)
+{
+	uint32_t *p;   /* Working cell pair. */
+	uint32_t *end; /* Last cell pair.    */
+	
+	p = (uint32_t *)&video[row*VIDEO_WIDTH];
+	end = p + (nrows*VIDEO_WIDTH)/2;
+	
+#if (FBCONSOLE)
+	for (int i = 0; i < nrows; i++)
+		damage(row + i);
+#endif
+	
+	/* Two cells at a time. */
+	while (p < end)
+		*p++ = (BLANK << 16) | BLANK;
+}
+
+/*
+ * Scrolls down a virtual console by one row.
+ */
+PRIVATE void console_scrolldown(struct vconsole *c)
+{
+	/*
+	 * Room left in the slice, so just
+	 * move the display start forward.
+	 */
+	if (c->top + VIDEO_HIGH < c->base + VT_ROWS)
+		c->top++;
+	
+	/* Wrap around, pulling lines to the start. */
+	else
+	{
+		kmemcpy(&video[c->base*VIDEO_WIDTH], &CELL(c, 0, 1),
+			(VIDEO_HIGH - 1)*VIDEO_WIDTH*sizeof(uint16_t));
+		c->top = c->base;
+	}
 	
 	/* Blank last line. */
-	for (; p < video + VIDEO_HIGH*VIDEO_WIDTH; p++)
-		*p = (BLACK << 8) | (' ');
+	console_blank(c->top + VIDEO_HIGH - 1, 1);
+	display_move(c);
 		
 	/* Set cursor position. */
-	cursor.x = 0; cursor.y = VIDEO_HIGH - 1;
+	c->x = 0; c->y = VIDEO_HIGH - 1;
 }
 
 /*
- * Outputs a colored ASCII character on the console device.
+ * Outputs a colored ASCII character, without
+ * updating the hardware cursor.
  */
-PUBLIC void console_put(uint8_t ch, uint8_t color)
+PRIVATE void console_putc(struct vconsole *c, uint8_t ch, uint8_t color)
 {	
 	/* Parse character. */
     switch (ch)
     {
         /* New line. */
         case '\n':
-            cursor.y++;
-            cursor.x = 0;
+            c->y++;
+            c->x = 0;
             break;
             
         /* Tabulation. */
         case '\t':
             /* FIXME. */
-            cursor.x += 4 - (cursor.x & 3);
+            c->x += 4 - (c->x & 3);
             break;
             
         /* Backspace. */
         case '\b':
-            if (cursor.x > 0)
-                cursor.x--;
-            else if (cursor.y > 0)
+            if (c->x > 0)
+                c->x--;
+            else if (c->y > 0)
             {
-                cursor.x = VIDEO_WIDTH - 1;
-                cursor.y--;
+                c->x = VIDEO_WIDTH - 1;
+                c->y--;
             }
-            video[cursor.y*VIDEO_WIDTH +cursor.x] = (color << 8) | (' ');
+            CELL(c, c->x, c->y) = (color << 8) | (' ');
+#if (FBCONSOLE)
+            damage(c->top + c->y);
+#endif
             break;			
         
         /* Any other. */
         default:
-            video[cursor.y*VIDEO_WIDTH +cursor.x] = (color << 8) | (ch);
-            cursor.x++;
+            CELL(c, c->x, c->y) = (color << 8) | (ch);
+#if (FBCONSOLE)
+            damage(c->top + c->y);
+#endif
+            c->x++;
             break;
     }
 
     /* Set cursor position. */
-    if (cursor.x >= VIDEO_WIDTH)
+    if (c->x >= VIDEO_WIDTH)
     {
-        cursor.x = 0;
-        cursor.y++;
+        c->x = 0;
+        c->y++;
     }
-    if (cursor.y >= VIDEO_HIGH)
-        console_scrolldown();
-    cursor_move();
+    if (c->y >= VIDEO_HIGH)
+        console_scrolldown(c);
 }
 
 /*
- * Clears the console.
+ * Outputs a colored ASCII character on a virtual console.
  */
-PUBLIC void console_clear(void)
+PUBLIC void console_put(unsigned vt, uint8_t ch, uint8_t color)
 {
-	uint16_t *p;
+	console_putc(&consoles[vt], ch, color);
+	cursor_move(&consoles[vt]);
+}
+
+/*
+ * Clears a virtual console.
+ */
+PUBLIC void console_clear(unsigned vt)
+{
+	struct vconsole *c = &consoles[vt];
 	
 	/* Blank all lines. */
-	for (p = video; p < (video + VIDEO_HIGH*VIDEO_WIDTH); p++)
-		*p = (BLACK << 8) | (' ');
+	c->top = c->base;
+	console_blank(c->base, VIDEO_HIGH);
+	display_move(c);
 	
 	/* Set console cursor position. */
-	cursor.x = cursor.y = 0;
-	cursor_move();
+	c->x = c->y = 0;
+	cursor_move(c);
 }
 
 /*
- * Flushes a buffer on the console device.
+ * Flushes a buffer on a virtual console.
  */
-PUBLIC void console_write(struct kbuffer *buffer)
+PUBLIC void console_write(unsigned vt, struct kbuffer *buffer)
 {
 	uint8_t ch;
 	
+	/* Nothing to flush. */
+	if (KBUFFER_EMPTY((*buffer)))
+		return;
+	
 	/* Outputs all characters. */
 	while (!KBUFFER_EMPTY((*buffer)))
 	{ 
 		KBUFFER_GET((*buffer), ch);
 	
-		console_put(ch, WHITE);
+		console_putc(&consoles[vt], ch, WHITE);
 	}
+	
+	/* Cursor goes once per flush. */
+	cursor_move(&consoles[vt]);
+}
+
+/*
+ * Puts a virtual console on screen.
+ */
+PUBLIC void console_switch(unsigned vt)
+{
+	visible = vt;
+	display_move(&consoles[vt]);
+	cursor_move(&consoles[vt]);
 }
 
 /*
@@ -192,12 +565,20 @@ PUBLIC void console_write(struct kbuffer *buffer)
  */
 PUBLIC void console_init(void)
 {
+#if (FBCONSOLE)
+	fb_init();
+#endif
+	
 	/* Set cursor shape. */
 	outputb(VIDEO_CRTL_REG, VIDEO_CS);
 	outputb(VIDEO_DATA_REG, 0x00);
 	outputb(VIDEO_CRTL_REG, VIDEO_CE);
 	outputb(VIDEO_DATA_REG, 0x1f);
 	
-	/* Clear the console. */
-	console_clear();
+	/* Clear the consoles. */
+	for (unsigned i = 0; i < NR_VTS; i++)
+	{
+		consoles[i].base = i*VT_ROWS;
+		console_clear(i);
+	}
 }
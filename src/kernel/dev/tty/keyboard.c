@@ -151,7 +151,8 @@ enum flags
 {
 	ANY   = (1 << 0), /**< Any key pressed.   */
 	SHIFT = (1 << 1), /**< Shift key pressed. */
-	CTRL  = (1 << 2)  /**< CTRL key pressed.  */
+	CTRL  = (1 << 2), /**< CTRL key pressed.  */
+	ALT   = (1 << 3)  /**< ALT key pressed.   */
 };
 
 /**
@@ -192,6 +193,11 @@ PRIVATE uint8_t parse_key_hit(void)
 				mode &= ~CTRL;
 				break;
 			
+			/* ALT. */
+			case KRLEFT_ALT:
+				mode &= ~ALT;
+				break;
+			
 			/* Any other. */
 			default:
 				mode &= ~ANY;
@@ -216,6 +222,11 @@ PRIVATE uint8_t parse_key_hit(void)
 				mode |= CTRL;
 				break;
 			
+			/* ALT. */
+			case KRLEFT_ALT:
+				mode |= ALT;
+				break;
+			
 			/* Any other. */
 			default:
 				mode |= ANY;
@@ -267,6 +278,13 @@ PUBLIC void do_keyboard_hit(void)
 	if (ascii_code == 0)
 		return;
    
+	/* ALT+Fn switches virtual terminals. */
+	if ((mode & ALT) && (ascii_code >= KF1) && (ascii_code <= KF12))
+	{
+		tty_switch(ascii_code - KF1);
+		return;
+	}
+   
 	/* Parse ASCII code. */
 	switch(ascii_code)
 	{
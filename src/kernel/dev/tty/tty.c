@@ -19,88 +19,176 @@
  */
 
 #include <dev/tty.h>
+#include <nanvix/clock.h>
 #include <nanvix/const.h>
 #include <nanvix/dev.h>
+#include <nanvix/fs.h>
 #include <nanvix/hal.h>
 #include <nanvix/klib.h>
 #include <nanvix/mm.h>
 #include <nanvix/pm.h>
 #include <nanvix/syscall.h>
 #include <errno.h>
+#include <poll.h>
 #include <termios.h>
 #include <stropts.h>
 #include "tty.h"
 
 /**
  * @brief TTY devices.
+ * 
+ * @details The first #NR_VTS devices are virtual terminals, and the next
+ *          #NR_PTYS devices are pseudo-terminal slaves.
  */
-PRIVATE struct tty tty;
+PRIVATE struct tty ttys[NR_VTS + NR_PTYS];
+
+/**
+ * @brief Gets a pseudo-terminal slave.
+ */
+#define PTY(i) (&ttys[NR_VTS + (i)])
 
 /**
  * @brief Currently active TTY device.
  */
-PRIVATE struct tty *active = &tty;
+PRIVATE struct tty *active = &ttys[0];
+
+/**
+ * @brief Size of the TTY interrupt queue.
+ */
+#define TTY_INTQ_SIZE 64
+
+/**
+ * @brief TTY interrupt queue.
+ * 
+ * @details Characters received by the keyboard interrupt handler, waiting
+ *          for line discipline processing in the TTY bottom half. The
+ *          interrupt handler is the only producer and the bottom half the
+ *          only consumer, so no locking is needed.
+ */
+PRIVATE struct
+{
+	struct tty *ttyp; /**< Target TTY device. */
+	unsigned char ch; /**< Character.         */
+} intq[TTY_INTQ_SIZE];
+
+/**
+ * @name TTY interrupt queue pointers.
+ */
+/**@{*/
+PRIVATE volatile unsigned intq_head = 0; /**< Next slot to read.  */
+PRIVATE volatile unsigned intq_tail = 0; /**< Next slot to write. */
+/**@}*/
 
 /**
  * @brief Sends a signal to process group.
  * 
- * @details Sends the signal @p sig to the process group of the currently active
- *          TTY device.
+ * @details Sends the signal @p sig to the process group of the TTY device
+ *          pointed to by @p ttyp.
+ * 
+ * @param ttyp TTY device.
+ * @param sig  Signal to be sent.         
+ */
+PRIVATE void tty_signal(struct tty *ttyp, int sig)
+{
+	/* No foreground process group. */
+	if (ttyp->pgrp == NULL)
+		return;
+	
+	for (struct process *p = ttyp->pgrp->members; p != NULL; p = p->gnext)
+		sndsig(p, sig);
+}
+
+/**
+ * @brief Echoes a character.
+ * 
+ * @details Echoes the character @p ch on the TTY device pointed to by @p ttyp.
+ *          Virtual terminals output it straight to their console, and
+ *          pseudo-terminals hand it to the master side, unless there is no
+ *          room left.
  * 
- * @param sig Signal to be sent.         
+ * @param ttyp TTY device.
+ * @param ch   Character to echo.
  */
-PRIVATE void tty_signal(int sig)
+PRIVATE void tty_echo(struct tty *ttyp, unsigned char ch)
 {
-	for (struct process *p = FIRST_PROC; p <= LAST_PROC; p++)
+	/* Virtual terminal. */
+	if (!(ttyp->flags & TTY_PTY))
 	{
-		/* Skip invalid processes. */
-		if (!IS_VALID(p))
-			continue;
-			
-		if (active->pgrp == p->pgrp)
-			sndsig(p, sig);
+		console_put(ttyp->vt, ch, WHITE);
+		return;
 	}
+	
+	if (!KBUFFER_FULL(ttyp->output))
+		KBUFFER_PUT(ttyp->output, ch);
+	wakeup(&ttyp->output.chain);
+	pollwakeup(NULL);
 }
 
 /**
- * @brief Handles a TTY interrupt.
+ * @brief Flushes the output buffer of a TTY device.
  * 
- * @details Handles a TTY interrupt, putting the received character @p ch in the
- *          raw input buffer of the currently active TTY device. Addiitonally, 
- *          if echo is enable for such device, @p ch is output to the terminal.
+ * @details Virtual terminals drain the output buffer to their console, unless
+ *          they are stopped. Pseudo-terminals leave the data for the master
+ *          side, which is awaken.
  * 
- * @param ch Received character.
+ * @param ttyp TTY device.
+ * 
+ * @note Interrupts must be disabled.
  */
-PUBLIC void tty_int(unsigned char ch)
+PRIVATE void tty_flush(struct tty *ttyp)
+{
+	/* Pseudo-terminal. */
+	if (ttyp->flags & TTY_PTY)
+	{
+		wakeup(&ttyp->output.chain);
+		pollwakeup(NULL);
+		return;
+	}
+	
+	if (!(ttyp->flags & TTY_STOPPED))
+		console_write(ttyp->vt, &ttyp->output);
+}
+
+/**
+ * @brief Handles an input character.
+ * 
+ * @details Puts the received character @p ch in the raw input buffer of the TTY
+ *          device pointed to by @p ttyp. Addiitonally, if echo is enable for
+ *          such device, @p ch is output to the terminal.
+ * 
+ * @param ttyp TTY device.
+ * @param ch   Received character.
+ */
+PRIVATE void tty_input(struct tty *ttyp, unsigned char ch)
 {
 	/* Output echo character. */
-	if (active->term.c_lflag & ECHO)
+	if (ttyp->term.c_lflag & ECHO)
 	{
 		/* Canonical mode. */
-		if (active->term.c_lflag & ICANON)
+		if (ttyp->term.c_lflag & ICANON)
 		{		
 			/* 
 			 * Let these characters be handled
 			 * when the line is being parsed.
 			 */
-			if ((ch == ERASE_CHAR(active->term)) ||
-				(ch == KILL_CHAR(active->term)) ||
-				(ch == EOL_CHAR(active->term)) ||
-				(ch == EOF_CHAR(active->term)))
+			if ((ch == ERASE_CHAR(ttyp->term)) ||
+				(ch == KILL_CHAR(ttyp->term)) ||
+				(ch == EOL_CHAR(ttyp->term)) ||
+				(ch == EOF_CHAR(ttyp->term)))
 				goto out1;
 		}
 		
 		/* Non-printable characters. */
 		if ((ch < 32) && (ch != '\n') && (ch != '\t'))
 		{
-			console_put('^', WHITE);
-			console_put(ch + 64, WHITE);
-			console_put('\n', WHITE);
+			tty_echo(ttyp, '^');
+			tty_echo(ttyp, ch + 64);
+			tty_echo(ttyp, '\n');
 		}
 		
 		/* Any character. */
 		else
-			console_put(ch, WHITE);
+			tty_echo(ttyp, ch);
 	}
 	
 	/*
@@ -108,52 +196,114 @@ PUBLIC void tty_int(unsigned char ch)
 	 * received, no character is put in the raw
 	 * input buffer. Otherwise, we could mess it up.
 	 */
-	if (active->term.c_lflag & ISIG)
+	if (ttyp->term.c_lflag & ISIG)
 	{
 		/*
 		 * Interrupt. Send signal to all
 		 * process in the same group.
 		 */
-		if (ch == INTR_CHAR(active->term))
+		if (ch == INTR_CHAR(ttyp->term))
 		{
-			tty_signal(SIGINT);
+			tty_signal(ttyp, SIGINT);
 			goto out0;
 		}
 		
 		/* Stop. */
-		else if (ch == STOP_CHAR(active->term))
+		else if (ch == STOP_CHAR(ttyp->term))
 		{
-			active->flags |= TTY_STOPPED;
+			ttyp->flags |= TTY_STOPPED;
 			return;
 		}
 				
 		/* Start. */
-		else if (ch == START_CHAR(active->term))
+		else if (ch == START_CHAR(ttyp->term))
 		{
-			active->flags &= ~TTY_STOPPED;
-			wakeup(&active->output.chain);
+			ttyp->flags &= ~TTY_STOPPED;
+			wakeup(&ttyp->output.chain);
+			pollwakeup(NULL);
 			return;
 		}
 		
 		/* Suspend. */
-		else if (ch == SUSP_CHAR(active->term))
+		else if (ch == SUSP_CHAR(ttyp->term))
 		{
-			tty_signal(SIGTSTP);
+			tty_signal(ttyp, SIGTSTP);
 			goto out0;
 		}
 		
 		/* Quit. */
-		else if (ch == QUIT_CHAR(active->term))
+		else if (ch == QUIT_CHAR(ttyp->term))
 		{
-			tty_signal(SIGQUIT);
+			tty_signal(ttyp, SIGQUIT);
 			goto out0;
 		}
 	}
 
 out1:		
-	KBUFFER_PUT(active->rinput, ch);
+	KBUFFER_PUT(ttyp->rinput, ch);
 out0:
-	wakeup(&active->rinput.chain);
+	wakeup(&ttyp->rinput.chain);
+	pollwakeup(NULL);
+}
+
+/**
+ * @brief Handles a TTY interrupt.
+ * 
+ * @details Handles a TTY interrupt, queueing the received character @p ch for
+ *          the currently active TTY device. Line discipline processing is
+ *          left to the TTY bottom half. If the queue is full, the character
+ *          is dropped.
+ * 
+ * @param ch Received character.
+ */
+PUBLIC void tty_int(unsigned char ch)
+{
+	unsigned next; /* Next tail. */
+	
+	next = (intq_tail + 1)%TTY_INTQ_SIZE;
+	
+	/* Overrun. */
+	if (next == intq_head)
+		return;
+	
+	intq[intq_tail].ttyp = active;
+	intq[intq_tail].ch = ch;
+	intq_tail = next;
+	
+	mark_bh(BH_TTY);
+}
+
+/**
+ * @brief TTY bottom half.
+ * 
+ * @details Hands characters queued by the TTY interrupt handler to their TTY
+ *          devices.
+ */
+PRIVATE void tty_bh(void)
+{
+	while (intq_head != intq_tail)
+	{
+		tty_input(intq[intq_head].ttyp, intq[intq_head].ch);
+		intq_head = (intq_head + 1)%TTY_INTQ_SIZE;
+	}
+}
+
+/**
+ * @brief Switches virtual terminals.
+ * 
+ * @details Makes the virtual terminal @p vt the active TTY device, and puts its
+ *          console on screen.
+ * 
+ * @param vt Target virtual terminal.
+ */
+PUBLIC void tty_switch(unsigned vt)
+{
+	/* Invalid virtual terminal. */
+	if (vt >= NR_VTS)
+		return;
+	
+	active = &ttys[vt];
+	console_switch(vt);
 }
 
 /**
@@ -168,7 +318,8 @@ out0:
  *          input buffer of the target TTY device is no longer empty. If while
  *          sleeping, the process gets awaken due to the deliver of a signal,
  *          -#EINTR is returned instead. In this later case, it is undefined
- *          whether the buffer is no longer empty.
+ *          whether the buffer is no longer empty. If the master side of a
+ *          pseudo-terminal goes away, -#EIO is returned.
  * 
  * @note @p ttyp must point to a valid TTY device.
  */
@@ -177,6 +328,10 @@ PRIVATE int tty_sleep_empty(struct tty *ttyp)
 	/* Sleep while raw input buffer is empty. */
 	while (KBUFFER_EMPTY(ttyp->rinput))
 	{
+		/* Hung up. */
+		if ((ttyp->flags & TTY_PTY) && (!(ttyp->flags & TTY_MASTER)))
+			return (-EIO);
+		
 		sleep(&ttyp->rinput.chain, PRIO_TTY);
 		
 		/* Awaken by signal. */
@@ -199,13 +354,18 @@ PRIVATE int tty_sleep_empty(struct tty *ttyp)
  *          output buffer of the target TTY device is no longer full. If while
  *          sleeping, the process gets awaken due to the deliver of a signal,
  *          -#EINTR is returned instead. In this later case, it is undefined
- *          whether the buffer is no longer full.
+ *          whether the buffer is no longer full. If the master side of a
+ *          pseudo-terminal goes away, -#EIO is returned.
  */
 PRIVATE int tty_sleep_full(struct tty *ttyp)
 {
 	/* Sleep while output buffer is full. */
 	while (KBUFFER_FULL(ttyp->output))
 	{
+		/* Hung up. */
+		if ((ttyp->flags & TTY_PTY) && (!(ttyp->flags & TTY_MASTER)))
+			return (-EIO);
+		
 		sleep(&ttyp->output.chain, PRIO_TTY);
 		
 		/* Awaken by signal. */
@@ -214,7 +374,7 @@ PRIVATE int tty_sleep_full(struct tty *ttyp)
 		
 		/* Awaken by START character. */
 		disable_interrupts();
-		console_write(&ttyp->output);
+		tty_flush(ttyp);
 		enable_interrupts();
 	}
 	
@@ -226,10 +386,11 @@ PRIVATE int tty_sleep_full(struct tty *ttyp)
  */
 PRIVATE ssize_t tty_write(unsigned minor, const char *buf, size_t n)
 {	
-	const char *p;
-	
-	UNUSED(minor);
+	int ret;          /* Return value.  */
+	const char *p;    /* Read pointer.  */
+	struct tty *ttyp; /* TTY device.    */
 	
+	ttyp = &ttys[minor];
 	p = buf;
 	
 	/* Write n characters. */
@@ -239,29 +400,106 @@ PRIVATE ssize_t tty_write(unsigned minor, const char *buf, size_t n)
 		 * Wait for free slots
 		 * in the output buffer.
 		 */
-		if (tty_sleep_full(&tty))
-			return (-EINTR);
+		if ((ret = tty_sleep_full(ttyp)))
+			return (ret);
+		
+		/* Hung up. */
+		if ((ttyp->flags & TTY_PTY) && (!(ttyp->flags & TTY_MASTER)))
+			return (-EIO);
 		
 		/* Copy data to output tty buffer. */
-		while ((n > 0) && (!KBUFFER_FULL(tty.output)))
+		while ((n > 0) && (!KBUFFER_FULL(ttyp->output)))
 		{
-			KBUFFER_PUT(tty.output, *p);
+			KBUFFER_PUT(ttyp->output, *p);
 			
 			p++, n--;
 		}
 		
 		/* Flushes tty output buffer. */
-		if (!(tty.flags & TTY_STOPPED))
-		{
-			disable_interrupts();
-			console_write(&tty.output);
-			enable_interrupts();
-		}
+		disable_interrupts();
+		tty_flush(ttyp);
+		enable_interrupts();
 	}
 		
 	return ((ssize_t)(p - buf));
 }
 
+/**
+ * @brief Reads data from a TTY device in non-canonical mode.
+ * 
+ * @details Reads up to @p n bytes from the raw input buffer of the TTY device
+ *          pointed to by @p ttyp to the buffer pointed to by @p buf, following
+ *          the MIN and TIME control characters. With MIN > 0 the read returns
+ *          once MIN bytes (or @p n, if less) have arrived; with TIME > 0 as
+ *          well, it also returns once TIME tenths of a second go by without
+ *          input after the first byte. With MIN = 0 and TIME > 0, the read
+ *          waits at most TIME tenths of a second for any input, and with both
+ *          zero it returns whatever is there.
+ * 
+ * @param ttyp TTY device.
+ * @param buf  Buffer where data shall be placed.
+ * @param n    Number of bytes to be read.
+ * 
+ * @returns The number of bytes actually read. If the calling process gets
+ *          awaken due to the deliver of a signal before anything is read,
+ *          -#EINTR is returned instead. If the master side of a
+ *          pseudo-terminal goes away, -#EIO is returned.
+ * 
+ * @note Interrupts must be disabled.
+ */
+PRIVATE ssize_t tty_read_raw(struct tty *ttyp, unsigned char *buf, size_t n)
+{
+	size_t i;         /* # bytes read.       */
+	size_t min;       /* Bytes to wait for.  */
+	unsigned char ch; /* Working character.  */
+	unsigned timeout; /* Inter-byte timeout. */
+	int expired;      /* Timer expired?      */
+	
+	i = 0;
+	expired = 0;
+	while (1)
+	{
+		/* Settings may change while we sleep. */
+		min = (MIN_CHAR(ttyp->term) < n) ? MIN_CHAR(ttyp->term) : n;
+		timeout = (TIME_CHAR(ttyp->term)*CLOCK_FREQ)/10;
+		if ((TIME_CHAR(ttyp->term) > 0) && (timeout == 0))
+			timeout = 1;
+		
+		/* Take what is there. */
+		while ((i < n) && (!KBUFFER_EMPTY(ttyp->rinput)))
+		{
+			KBUFFER_GET(ttyp->rinput, ch);
+			buf[i++] = ch;
+		}
+		
+		/* Done reading. */
+		if ((i >= min) && ((min > 0) || (i > 0) || (timeout == 0)))
+			break;
+		if (expired)
+			break;
+		
+		/* Hung up. */
+		if ((ttyp->flags & TTY_PTY) && (!(ttyp->flags & TTY_MASTER)))
+			return ((i > 0) ? (ssize_t)i : -EIO);
+		
+		/*
+		 * The timer only runs once there is
+		 * input, unless MIN is zero. Each new
+		 * character restarts it.
+		 */
+		if ((timeout > 0) && ((i > 0) || (min == 0)))
+			expired = (tsleep(&ttyp->rinput.chain, PRIO_TTY, timeout) == WAKE_TIMEOUT);
+		else
+			sleep(&ttyp->rinput.chain, PRIO_TTY);
+		
+		/* Awaken by signal. */
+		if (issig() != SIGNULL)
+			return ((i > 0) ? (ssize_t)i : -EINTR);
+	}
+	
+	return ((ssize_t)i);
+}
+
 /**
  * @brief Reads data from a TTY device.
  * 
@@ -276,150 +514,154 @@ PRIVATE ssize_t tty_write(unsigned minor, const char *buf, size_t n)
  */
 PRIVATE ssize_t tty_read(unsigned minor, char *buf, size_t n)
 {
+	ssize_t ret;      /* Return value.      */
 	size_t i;         /* # bytes read.      */
 	unsigned char ch; /* Working character. */
 	unsigned char *p; /* Write pointer.     */
+	struct tty *ttyp; /* TTY device.        */
 	
-	UNUSED(minor);
-	
+	ttyp = &ttys[minor];
 	i = n;
 	p = (unsigned char *)buf;
 	
 	/* Read characters. */
 	disable_interrupts();
+	
+	/* Non canonical mode. */
+	if (!(ttyp->term.c_lflag & ICANON))
+	{
+		ret = tty_read_raw(ttyp, p, n);
+		goto out1;
+	}
+	
+	/* Canonical mode. */
 	while (i > 0)
 	{
-		/* Canonical mode. */
-		if (tty.term.c_lflag & ICANON)
+		/* Wait for data to become available. */
+		if ((ret = tty_sleep_empty(ttyp)))
 		{
-			/* Wait for data to become available. */
-			if (tty_sleep_empty(&tty))
-			{
-				enable_interrupts();
-				return (-EINTR);
-			}
-			
-			KBUFFER_GET(tty.rinput, ch);
-			
-			/* Erase. */
-			if (ch == ERASE_CHAR(tty.term))
-			{
-				if (!KBUFFER_EMPTY(tty.cinput))
-				{
-					KBUFFER_TAKEOUT(tty.cinput);
-					console_put(ch, WHITE);
-				}
-			}
-			
-			/* Kill. */
-			else if (ch == KILL_CHAR(tty.term))
-			{
-				while (!KBUFFER_EMPTY(tty.cinput))
-				{
-					i = n;
-					p = (unsigned char *)buf;
-					KBUFFER_TAKEOUT(tty.cinput);
-					console_put('\b', WHITE);
-				}
-			}
-
-			else
+			enable_interrupts();
+			return (ret);
+		}
+		
+		KBUFFER_GET(ttyp->rinput, ch);
+		
+		/* Erase. */
+		if (ch == ERASE_CHAR(ttyp->term))
+		{
+			if (!KBUFFER_EMPTY(ttyp->cinput))
 			{
-				/* End of file. */
-				if (ch == EOF_CHAR(tty.term))
-					ch = '\0';
-				
-				/* End of line. */
-				else if (ch == EOL_CHAR(tty.term))
-					console_put(ch = '\n', WHITE);
-			
-				KBUFFER_PUT(tty.cinput, ch);
-			
-				/* Copy data to input buffer. */
-				if ((ch == '\n') || (KBUFFER_FULL(tty.cinput)) || (ch == '\0'))
-				{		
-					/* Copy data from input buffer. */
-					while ((i > 0) && (!KBUFFER_EMPTY(tty.cinput)))
-					{
-						KBUFFER_GET(tty.cinput, ch);
-						
-						/* EOF. */
-						if (ch == '\0')
-							goto out;
-						
-						i--;
-						*p++ = ch;
-						
-						/* Done reading. */
-						if (ch == '\n')
-							goto out;
-					}
-				}
+				KBUFFER_TAKEOUT(ttyp->cinput);
+				tty_echo(ttyp, ch);
 			}
 		}
 		
-		/* Non canonical mode. */
-		else
+		/* Kill. */
+		else if (ch == KILL_CHAR(ttyp->term))
 		{
-			if (MIN_CHAR(tty.term) > 0)
+			while (!KBUFFER_EMPTY(ttyp->cinput))
 			{
-				/* Case A: MIN>0, TIME>0 */
-				if (TIME_CHAR(tty.term) > 0)
-				{
-					kprintf("tty: MIN>0, TIME>0");
-					goto out;
-				}
-				
-				/* Case B: MIN>0, TIME=0 */
-				else
-				{
-					/* Wait for data to become available. */
-					if (tty_sleep_empty(&tty))
-					{
-						enable_interrupts();
-						return (-EINTR);
-					}
-					
-					/* Copy data from input buffer. */
-					while ((i > 0) && (!KBUFFER_EMPTY(tty.rinput)))
-					{
-						KBUFFER_GET(tty.rinput, ch);
-						i--;
-						*p++ = ch;
-					}
-				}
+				i = n;
+				p = (unsigned char *)buf;
+				KBUFFER_TAKEOUT(ttyp->cinput);
+				tty_echo(ttyp, '\b');
 			}
+		}
+
+		else
+		{
+			/* End of file. */
+			if (ch == EOF_CHAR(ttyp->term))
+				ch = '\0';
 			
-			else
-			{
-				/* Case C: MIN=0, TIME>0 */
-				if (TIME_CHAR(tty.term) > 0)
-				{
-					kprintf("tty: MIN=0, TIME>0");
-					goto out;
-				}
-				
-				/* Case D: MIN=0, TIME=0 */
-				else
+			/* End of line. */
+			else if (ch == EOL_CHAR(ttyp->term))
+				tty_echo(ttyp, ch = '\n');
+		
+			KBUFFER_PUT(ttyp->cinput, ch);
+		
+			/* Copy data to input buffer. */
+			if ((ch == '\n') || (KBUFFER_FULL(ttyp->cinput)) || (ch == '\0'))
+			{		
+				/* Copy data from input buffer. */
+				while ((i > 0) && (!KBUFFER_EMPTY(ttyp->cinput)))
 				{
-					/* Done reading. */
-					if (KBUFFER_EMPTY(tty.rinput))
+					KBUFFER_GET(ttyp->cinput, ch);
+					
+					/* EOF. */
+					if (ch == '\0')
 						goto out;
 					
-					KBUFFER_GET(tty.rinput, ch);
-						
 					i--;
 					*p++ = ch;
+					
+					/* Done reading. */
+					if (ch == '\n')
+						goto out;
 				}
-			}			
+			}
 		}
 	}
 
 out:
 
+	ret = (ssize_t)((char *)p - buf);
+
+out1:
+
+	/* The master side may be waiting for room. */
+	if (ttyp->flags & TTY_PTY)
+		wakeup(&ttyp->rinput.chain);
+
 	enable_interrupts();
 	
-	return ((ssize_t)((char *)p - buf));
+	return (ret);
+}
+
+/**
+ * @brief Asserts which operations on a TTY device would not block.
+ * 
+ * @details In canonical mode, input is ready once a whole line has been typed
+ *          in, since tty_read() would block otherwise. In non-canonical mode,
+ *          any character will do.
+ * 
+ * @param minor Minor device number of target TTY device.
+ * 
+ * @returns Poll events that are ready.
+ */
+PRIVATE int tty_poll(unsigned minor)
+{
+	unsigned i;       /* Loop index.        */
+	int revents;      /* Events ready.      */
+	unsigned char ch; /* Working character. */
+	struct tty *ttyp; /* TTY device.        */
+	
+	ttyp = &ttys[minor];
+	
+	/* Hung up. */
+	if ((ttyp->flags & TTY_PTY) && (!(ttyp->flags & TTY_MASTER)))
+		return (POLLHUP);
+	
+	revents = (KBUFFER_FULL(ttyp->output)) ? 0 : POLLOUT;
+	
+	/* Non canonical mode. */
+	if (!(ttyp->term.c_lflag & ICANON))
+		return (revents | ((KBUFFER_EMPTY(ttyp->rinput)) ? 0 : POLLIN));
+	
+	/* Line will be taken as it is. */
+	if (KBUFFER_FULL(ttyp->rinput))
+		return (revents | POLLIN);
+	
+	/* Look for a line delimiter. */
+	for (i = ttyp->rinput.head; i != ttyp->rinput.tail; i = (i + 1)&(KBUFFER_SIZE - 1))
+	{
+		ch = ttyp->rinput.buffer[i];
+		
+		if ((ch == '\n') || (ch == EOL_CHAR(ttyp->term)) || (ch == EOF_CHAR(ttyp->term)))
+			return (revents | POLLIN);
+	}
+	
+	return (revents);
 }
 
 /*
@@ -427,15 +669,27 @@ out:
  */
 PRIVATE int tty_open(unsigned minor)
 {	
+	struct tty *ttyp; /* TTY device. */
+	
+	/* Invalid device. */
+	if (minor >= NR_VTS + NR_PTYS)
+		return (-EINVAL);
+	
+	ttyp = &ttys[minor];
+	
+	/* No master side. */
+	if ((ttyp->flags & TTY_PTY) && (!(ttyp->flags & TTY_MASTER)))
+		return (-EIO);
+	
 	/* Assign controlling terminal. */
 	if ((IS_LEADER(curr_proc)) && (curr_proc->tty == NULL_DEV))
 	{
 		/* tty already assigned. */
-		if (tty.pgrp != NULL)
+		if (ttyp->pgrp != NULL)
 			return (-EBUSY);
 		
 		curr_proc->tty = DEVID(TTY_MAJOR, minor, CHRDEV);
-		tty.pgrp = curr_proc;
+		ttyp->pgrp = curr_proc;
 	}
 	
 	return (0);
@@ -476,6 +730,9 @@ PRIVATE int tty_sets(struct tty *tty, int options, struct termios *termiosp)
 		/* The change occurs immediately. */
 		case TCSANOW:
 			kmemcpy(&tty->term, termiosp, sizeof(struct termios));
+			
+			/* Readers must see new MIN and TIME values. */
+			wakeup(&tty->rinput.chain);
 			break;
 
 		/* Invalid operation. */
@@ -492,8 +749,10 @@ PRIVATE int tty_sets(struct tty *tty, int options, struct termios *termiosp)
  */
 PRIVATE int tty_clear(struct tty *tty)
 {
-	UNUSED(tty);
-	console_clear();
+	/* Pseudo-terminals have no console. */
+	if (!(tty->flags & TTY_PTY))
+		console_clear(tty->vt);
+	
 	return (0);
 }
 
@@ -503,25 +762,26 @@ PRIVATE int tty_clear(struct tty *tty)
 PRIVATE int tty_ioctl(unsigned minor, unsigned cmd, unsigned arg)
 {
 	int ret;
+	struct tty *ttyp;
 	
-	UNUSED(minor);
+	ttyp = &ttys[minor];
 	
 	/* Parse command. */
 	switch (IOCTL_MAJOR(cmd))
 	{
 		/* Get tty settings. */
 		case IOCTL_MAJOR(TTY_GETS):
-			ret = tty_gets(&tty, (struct termios *)arg);
+			ret = tty_gets(ttyp, (struct termios *)arg);
 			break;
 
 		/* Set tty settings */
 		case IOCTL_MAJOR(TTY_SETS):
-			ret = tty_sets(&tty, IOCTL_MINOR(cmd), (struct termios *)arg);
+			ret = tty_sets(ttyp, IOCTL_MINOR(cmd), (struct termios *)arg);
 			break;
 		
 		/* Clear console. */
 		case IOCTL_MAJOR(TTY_CLEAR):
-			ret = tty_clear(&tty);
+			ret = tty_clear(ttyp);
 			break;
 		
 		/* Invalid operation. */
@@ -544,9 +804,7 @@ PRIVATE int tty_ioctl(unsigned minor, unsigned cmd, unsigned arg)
  */
 PRIVATE int tty_close(unsigned minor)
 {
-	UNUSED(minor);
-	
-	tty.pgrp = NULL;
+	ttys[minor].pgrp = NULL;
 	
 	sys_kill(0, SIGHUP);
 	
@@ -561,7 +819,8 @@ PRIVATE struct cdev tty_driver = {
 	&tty_read,  /* read().  */
 	&tty_write, /* write(). */
 	&tty_ioctl, /* ioctl(). */
-	&tty_close  /* ioctl(). */
+	&tty_close, /* close(). */
+	&tty_poll   /* poll().  */
 };
 
 /**
@@ -581,6 +840,213 @@ PRIVATE tcflag_t init_c_cc[NCCS] = {
 	0x00       /**< TIME value.      */
 };
 
+/**
+ * @brief Resets the line settings of a TTY device.
+ * 
+ * @param ttyp Target TTY device.
+ */
+PRIVATE void tty_reset(struct tty *ttyp)
+{
+	ttyp->pgrp = NULL;
+	ttyp->output.head = ttyp->output.tail = 0;
+	ttyp->rinput.head = ttyp->rinput.tail = 0;
+	ttyp->cinput.head = ttyp->cinput.tail = 0;
+	ttyp->term.c_lflag = ICANON | ECHO | ISIG;
+	for (unsigned i = 0; i < NCCS; i++)
+		ttyp->term.c_cc[i] = init_c_cc[i];
+}
+
+/**
+ * @brief Opens a pseudo-terminal master.
+ * 
+ * @details Opens the master side of the pseudo-terminal @p minor, and resets
+ *          the line settings of its slave.
+ * 
+ * @param minor Target pseudo-terminal.
+ * 
+ * @returns Upon successful completion, zero is returned. Upon failure, a
+ *          negative error code is returned instead.
+ */
+PRIVATE int ptm_open(unsigned minor)
+{
+	struct tty *ttyp; /* Slave side. */
+	
+	/* Invalid device. */
+	if (minor >= NR_PTYS)
+		return (-EINVAL);
+	
+	ttyp = PTY(minor);
+	
+	/* Already open. */
+	if (ttyp->flags & TTY_MASTER)
+		return (-EBUSY);
+	
+	tty_reset(ttyp);
+	ttyp->flags = TTY_PTY | TTY_MASTER;
+	
+	return (0);
+}
+
+/**
+ * @brief Closes a pseudo-terminal master.
+ * 
+ * @details Closes the master side of the pseudo-terminal @p minor, and hangs
+ *          up its slave.
+ * 
+ * @param minor Target pseudo-terminal.
+ * 
+ * @returns Zero is always returned.
+ */
+PRIVATE int ptm_close(unsigned minor)
+{
+	struct tty *ttyp; /* Slave side. */
+	
+	ttyp = PTY(minor);
+	
+	ttyp->flags &= ~TTY_MASTER;
+	tty_signal(ttyp, SIGHUP);
+	ttyp->pgrp = NULL;
+	
+	/* Let sleepers see the hang up. */
+	wakeup(&ttyp->output.chain);
+	wakeup(&ttyp->rinput.chain);
+	pollwakeup(NULL);
+	
+	return (0);
+}
+
+/**
+ * @brief Reads from a pseudo-terminal master.
+ * 
+ * @details Reads up to @p n bytes that were output on the slave side of the
+ *          pseudo-terminal @p minor to the buffer pointed to by @p buf. The
+ *          caller blocks until there is some data.
+ * 
+ * @param minor Target pseudo-terminal.
+ * @param buf   Buffer where data shall be placed.
+ * @param n     Number of bytes to be read.
+ * 
+ * @returns The number of bytes actually read. If the calling process gets
+ *          awaken due to the deliver of a signal, -#EINTR is returned instead.
+ */
+PRIVATE ssize_t ptm_read(unsigned minor, char *buf, size_t n)
+{
+	unsigned char ch; /* Working character. */
+	char *p;          /* Write pointer.     */
+	struct tty *ttyp; /* Slave side.        */
+	
+	ttyp = PTY(minor);
+	p = buf;
+	
+	disable_interrupts();
+	
+	/* Wait for data. */
+	while (KBUFFER_EMPTY(ttyp->output))
+	{
+		sleep(&ttyp->output.chain, PRIO_TTY);
+		
+		/* Awaken by signal. */
+		if (issig() != SIGNULL)
+		{
+			enable_interrupts();
+			return (-EINTR);
+		}
+	}
+	
+	while ((n > 0) && (!KBUFFER_EMPTY(ttyp->output)))
+	{
+		KBUFFER_GET(ttyp->output, ch);
+		*p++ = ch;
+		n--;
+	}
+	
+	/* Slave writers may be waiting for room. */
+	wakeup(&ttyp->output.chain);
+	pollwakeup(NULL);
+	
+	enable_interrupts();
+	
+	return ((ssize_t)(p - buf));
+}
+
+/**
+ * @brief Writes to a pseudo-terminal master.
+ * 
+ * @details Feeds @p n bytes from the buffer pointed to by @p buf to the
+ *          pseudo-terminal @p minor, as if they were typed in on its slave.
+ * 
+ * @param minor Target pseudo-terminal.
+ * @param buf   Buffer where data is.
+ * @param n     Number of bytes to be written.
+ * 
+ * @returns The number of bytes actually written. If the calling process gets
+ *          awaken due to the deliver of a signal before it writes anything,
+ *          -#EINTR is returned instead.
+ */
+PRIVATE ssize_t ptm_write(unsigned minor, const char *buf, size_t n)
+{
+	const char *p;    /* Read pointer. */
+	struct tty *ttyp; /* Slave side.   */
+	
+	ttyp = PTY(minor);
+	p = buf;
+	
+	disable_interrupts();
+	
+	while (n > 0)
+	{
+		/* Wait for room. */
+		if (KBUFFER_FULL(ttyp->rinput))
+		{
+			sleep(&ttyp->rinput.chain, PRIO_TTY);
+			
+			/* Awaken by signal. */
+			if (issig() != SIGNULL)
+				break;
+			
+			continue;
+		}
+		
+		tty_input(ttyp, *p);
+		p++, n--;
+	}
+	
+	enable_interrupts();
+	
+	return (((n > 0) && (p == buf)) ? -EINTR : (ssize_t)(p - buf));
+}
+
+/**
+ * @brief Asserts which operations on a pseudo-terminal master would not block.
+ * 
+ * @param minor Target pseudo-terminal.
+ * 
+ * @returns Poll events that are ready.
+ */
+PRIVATE int ptm_poll(unsigned minor)
+{
+	int revents;      /* Events ready. */
+	struct tty *ttyp; /* Slave side.   */
+	
+	ttyp = PTY(minor);
+	
+	revents = (KBUFFER_FULL(ttyp->rinput)) ? 0 : POLLOUT;
+	
+	return (revents | ((KBUFFER_EMPTY(ttyp->output)) ? 0 : POLLIN));
+}
+
+/*
+ * Pseudo-terminal master driver interface.
+ */
+PRIVATE struct cdev ptm_driver = {
+	&ptm_open,  /* open().  */
+	&ptm_read,  /* read().  */
+	&ptm_write, /* write(). */
+	NULL,       /* ioctl(). */
+	&ptm_close, /* close(). */
+	&ptm_poll   /* poll().  */
+};
+
 /*
  * Initializes the tty device driver.
  */
@@ -588,21 +1054,26 @@ PUBLIC void tty_init(void)
 {		
 	kprintf("dev: initializing tty device driver");
 	
-	/* Initialize tty. */
-	tty.flags = 0;
-	tty.pgrp = NULL;
-	KBUFFER_INIT(tty.output);
-	KBUFFER_INIT(tty.cinput);
-	KBUFFER_INIT(tty.rinput);
-	tty.term.c_lflag = ICANON | ECHO | ISIG;
-	for (unsigned i = 0; i < NCCS; i++)
-		tty.term.c_cc[i] = init_c_cc[i];
+	/* Initialize ttys. */
+	for (unsigned i = 0; i < NR_VTS + NR_PTYS; i++)
+	{
+		KBUFFER_INIT(ttys[i].output);
+		KBUFFER_INIT(ttys[i].cinput);
+		KBUFFER_INIT(ttys[i].rinput);
+		tty_reset(&ttys[i]);
+		ttys[i].flags = (i < NR_VTS) ? 0 : TTY_PTY;
+		ttys[i].vt = (i < NR_VTS) ? i : 0;
+	}
 	
 	/* Initialize device drivers. */
+	if (set_bh(BH_TTY, &tty_bh))
+		kpanic("BH_TTY busy");
 	console_init();
 	keyboard_init();
 	
 	/* Register charecter device. */
 	if (cdev_register(TTY_MAJOR, &tty_driver))
 		kpanic("failed to register tty device driver");
+	if (cdev_register(PTM_MAJOR, &ptm_driver))
+		kpanic("failed to register pty device driver");
 }
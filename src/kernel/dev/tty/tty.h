@@ -43,12 +43,22 @@
     #define LIGHT_BROWN   0x0E
     #define WHITE         0x0F
 
+	/**
+	 * @name Number of TTY Devices
+	 */
+	/**@{*/
+	#define NR_VTS  4 /**< Virtual terminals.  */
+	#define NR_PTYS 4 /**< Pseudo-terminals.   */
+	/**@}*/
+
 	/**
 	 * @brief TTY flags.
 	 */
 	enum tty_flags
 	{
-		TTY_STOPPED = (1 << 0) /**< Stopped? */
+		TTY_STOPPED = (1 << 0), /**< Stopped?          */
+		TTY_PTY     = (1 << 1), /**< Pseudo-terminal?  */
+		TTY_MASTER  = (1 << 2)  /**< Master side open? */
 	};
 
 	/**
@@ -57,6 +67,7 @@
 	struct tty
 	{
 		enum tty_flags flags;  /**< Flags.               */
+		unsigned vt;           /**< Virtual console.     */
 		struct termios term;   /**< Terminal I/O.        */
 		struct process *pgrp;  /**< Process group.       */
 		struct kbuffer output; /**< Output buffer.       */
@@ -69,16 +80,18 @@
 	 */
 	/**@{*/
 	EXTERN void tty_int(unsigned char);
+	EXTERN void tty_switch(unsigned);
 	/**@}*/
 	
 	/**
 	 * @name Console Functions
 	 */
 	/**@{*/
-	EXTERN void console_put(uint8_t, uint8_t);
+	EXTERN void console_put(unsigned, uint8_t, uint8_t);
 	EXTERN void console_init(void);
-	EXTERN void console_clear(void);
-	EXTERN void console_write(struct kbuffer *);
+	EXTERN void console_clear(unsigned);
+	EXTERN void console_write(unsigned, struct kbuffer *);
+	EXTERN void console_switch(unsigned);
 	/**@}*/
 	
 	/**
@@ -0,0 +1,371 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/dev.h>
+#include <nanvix/fs.h>
+#include <nanvix/hal.h>
+#include <nanvix/klib.h>
+#include <nanvix/pm.h>
+#include <dev/uart.h>
+#include <sys/types.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+
+/* COM1 port. */
+#define UART_PORT 0x3f8
+
+/* UART registers. */
+#define UART_DATA 0 /* Transmit/receive buffer.   */
+#define UART_IER  1 /* Interrupt enable.          */
+#define UART_IIR  2 /* Interrupt identification.  */
+#define UART_FCR  2 /* FIFO control.              */
+#define UART_LCR  3 /* Line control.              */
+#define UART_MCR  4 /* Modem control.             */
+#define UART_LSR  5 /* Line status.               */
+#define UART_MSR  6 /* Modem status.              */
+#define UART_SCR  7 /* Scratch.                   */
+#define UART_DLL  0 /* Divisor latch (low byte).  */
+#define UART_DLM  1 /* Divisor latch (high byte). */
+
+/* Interrupt enable bits. */
+#define UART_IER_RDI  0x01 /* Received data available.  */
+#define UART_IER_THRI 0x02 /* Transmitter empty.        */
+
+/* Interrupt identification bits. */
+#define UART_IIR_NONE 0x01 /* No interrupt pending.     */
+#define UART_IIR_ID   0x0e /* Interrupt source mask.    */
+#define UART_IIR_MSI  0x00 /* Modem status.             */
+#define UART_IIR_THRI 0x02 /* Transmitter empty.        */
+#define UART_IIR_RDI  0x04 /* Received data available.  */
+#define UART_IIR_RLSI 0x06 /* Receiver line status.     */
+#define UART_IIR_CTI  0x0c /* Character timeout.        */
+
+/* Line status bits. */
+#define UART_LSR_DR   0x01 /* Data ready.               */
+#define UART_LSR_THRE 0x20 /* Transmitter holding empty. */
+
+/* Line control bits. */
+#define UART_LCR_8N1  0x03 /* 8 data bits, no parity, 1 stop bit. */
+#define UART_LCR_DLAB 0x80 /* Divisor latch access.     */
+
+/* FIFO control: enable, clear both FIFOs, 14 byte trigger. */
+#define UART_FCR_INIT 0xc7
+
+/* Modem control: DTR, RTS and OUT2 (interrupt gate). */
+#define UART_MCR_INIT 0x0b
+
+/* Depth of the transmit FIFO. */
+#define UART_FIFO_SIZE 16
+
+/* Baud rate divisor (115200 bps). */
+#define UART_DIVISOR 1
+
+/*
+ * Serial line.
+ */
+PRIVATE struct
+{
+	int present;           /* Was the UART found? */
+	struct kbuffer output; /* Transmit ring.      */
+	struct kbuffer input;  /* Receive ring.       */
+} uart;
+
+/*
+ * Fills the transmit FIFO from the transmit ring. Runs
+ * with interrupts disabled.
+ */
+PRIVATE void uart_start(void)
+{
+	int i;      /* Loop index.        */
+	uint8_t ch; /* Working character. */
+	
+	/* Room for a full FIFO. */
+	if (inputb(UART_PORT + UART_LSR) & UART_LSR_THRE)
+	{
+		for (i = 0; (i < UART_FIFO_SIZE) && (!KBUFFER_EMPTY(uart.output)); i++)
+		{
+			KBUFFER_GET(uart.output, ch);
+			outputb(UART_PORT + UART_DATA, ch);
+		}
+	}
+	
+	/* Ask the UART to call back when the FIFO drains. */
+	outputb(UART_PORT + UART_IER, (KBUFFER_EMPTY(uart.output)) ?
+		UART_IER_RDI : UART_IER_RDI | UART_IER_THRI);
+}
+
+/*
+ * Drains the transmit ring by polling, for
+ * writers that cannot sleep.
+ */
+PRIVATE void uart_drain(void)
+{
+	while (KBUFFER_FULL(uart.output))
+	{
+		while (!(inputb(UART_PORT + UART_LSR) & UART_LSR_THRE))
+			noop();
+		uart_start();
+	}
+}
+
+/*
+ * Handles a UART interrupt.
+ */
+PRIVATE void uart_handler(void)
+{
+	uint8_t iir; /* Interrupt identification. */
+	uint8_t ch;  /* Working character.        */
+	
+	while (!((iir = inputb(UART_PORT + UART_IIR)) & UART_IIR_NONE))
+	{
+		switch (iir & UART_IIR_ID)
+		{
+			/* Received data. */
+			case UART_IIR_RDI:
+			case UART_IIR_CTI:
+				while (inputb(UART_PORT + UART_LSR) & UART_LSR_DR)
+				{
+					ch = inputb(UART_PORT + UART_DATA);
+					
+					/* Drop characters on overrun. */
+					if (!KBUFFER_FULL(uart.input))
+						KBUFFER_PUT(uart.input, ch);
+				}
+				wakeup(&uart.input.chain);
+				pollwakeup(NULL);
+				break;
+			
+			/* Transmit FIFO drained. */
+			case UART_IIR_THRI:
+				uart_start();
+				wakeup(&uart.output.chain);
+				pollwakeup(NULL);
+				break;
+			
+			/* Line status. */
+			case UART_IIR_RLSI:
+				inputb(UART_PORT + UART_LSR);
+				break;
+			
+			/* Modem status. */
+			default:
+				inputb(UART_PORT + UART_MSR);
+				break;
+		}
+	}
+}
+
+/*
+ * Opens the serial line.
+ */
+PRIVATE int uart_open(unsigned minor)
+{
+	UNUSED(minor);
+	
+	return (0);
+}
+
+/*
+ * Closes the serial line.
+ */
+PRIVATE int uart_close(unsigned minor)
+{
+	UNUSED(minor);
+	
+	return (0);
+}
+
+/*
+ * Writes to the serial line.
+ */
+PRIVATE ssize_t uart_write(unsigned minor, const char *buf, size_t n)
+{
+	const char *p; /* Read pointer. */
+	
+	UNUSED(minor);
+	
+	p = buf;
+	
+	while (n > 0)
+	{
+		disable_interrupts();
+		
+		/* Copy data to the transmit ring. */
+		while ((n > 0) && (!KBUFFER_FULL(uart.output)))
+		{
+			KBUFFER_PUT(uart.output, *p);
+			p++, n--;
+		}
+		
+		uart_start();
+		
+		/*
+		 * The ring is full. Interrupt handlers and the
+		 * idle process cannot sleep, so they push it out
+		 * by hand; everybody else waits for the FIFO.
+		 */
+		if (n > 0)
+		{
+			if ((curr_proc == IDLE) || (curr_proc->irqlvl != INT_LVL_5))
+				uart_drain();
+			else
+			{
+				sleep(&uart.output.chain, PRIO_TTY);
+				
+				/* Awaken by signal. */
+				if (issig() != SIGNULL)
+				{
+					enable_interrupts();
+					return ((p == buf) ? -EINTR : (ssize_t)(p - buf));
+				}
+			}
+		}
+		
+		enable_interrupts();
+	}
+	
+	return ((ssize_t)(p - buf));
+}
+
+/*
+ * Reads from the serial line.
+ */
+PRIVATE ssize_t uart_read(unsigned minor, char *buf, size_t n)
+{
+	char *p;    /* Write pointer.     */
+	uint8_t ch; /* Working character. */
+	
+	UNUSED(minor);
+	
+	p = buf;
+	
+	disable_interrupts();
+	
+	/* Wait for data. */
+	while (KBUFFER_EMPTY(uart.input))
+	{
+		sleep(&uart.input.chain, PRIO_TTY);
+		
+		/* Awaken by signal. */
+		if (issig() != SIGNULL)
+		{
+			enable_interrupts();
+			return (-EINTR);
+		}
+	}
+	
+	/* Copy what has arrived. */
+	while ((n > 0) && (!KBUFFER_EMPTY(uart.input)))
+	{
+		KBUFFER_GET(uart.input, ch);
+		*p++ = ch;
+		n--;
+	}
+	
+	enable_interrupts();
+	
+	return ((ssize_t)(p - buf));
+}
+
+/*
+ * Asserts which operations on the serial line would not block.
+ */
+PRIVATE int uart_poll(unsigned minor)
+{
+	int revents; /* Events ready. */
+	
+	UNUSED(minor);
+	
+	revents = (KBUFFER_FULL(uart.output)) ? 0 : POLLOUT;
+	
+	return (revents | ((KBUFFER_EMPTY(uart.input)) ? 0 : POLLIN));
+}
+
+/*
+ * Serial line driver interface.
+ */
+PRIVATE const struct cdev uart_driver = {
+	&uart_open,  /* open().  */
+	&uart_read,  /* read().  */
+	&uart_write, /* write(). */
+	NULL,        /* ioctl(). */
+	&uart_close, /* close(). */
+	&uart_poll   /* poll().  */
+};
+
+/*
+ * Asserts if the serial line is present.
+ */
+PUBLIC int uart_present(void)
+{
+	return (uart.present);
+}
+
+/*
+ * Initializes the serial line driver.
+ */
+PUBLIC void uart_init(void)
+{
+	kprintf("dev: initializing serial line device driver");
+	
+	KBUFFER_INIT(uart.output);
+	KBUFFER_INIT(uart.input);
+	
+	/* Probe for the UART. */
+	outputb(UART_PORT + UART_SCR, 0xae);
+	if (inputb(UART_PORT + UART_SCR) != 0xae)
+	{
+		kprintf("ttyS0: no serial port found");
+		return;
+	}
+	
+	/* 115200 bps, 8N1. */
+	outputb(UART_PORT + UART_IER, 0);
+	outputb(UART_PORT + UART_LCR, UART_LCR_DLAB);
+	outputb(UART_PORT + UART_DLL, UART_DIVISOR & 0xff);
+	outputb(UART_PORT + UART_DLM, (UART_DIVISOR >> 8) & 0xff);
+	outputb(UART_PORT + UART_LCR, UART_LCR_8N1);
+	
+	/* FIFOs and interrupt gate. */
+	outputb(UART_PORT + UART_FCR, UART_FCR_INIT);
+	outputb(UART_PORT + UART_MCR, UART_MCR_INIT);
+	
+	if (set_hwint(INT_COM1, &uart_handler))
+	{
+		kprintf("ttyS0: IRQ %d busy", INT_COM1);
+		return;
+	}
+	
+	/* Discard stale state. */
+	inputb(UART_PORT + UART_LSR);
+	inputb(UART_PORT + UART_DATA);
+	inputb(UART_PORT + UART_IIR);
+	inputb(UART_PORT + UART_MSR);
+	outputb(UART_PORT + UART_IER, UART_IER_RDI);
+	
+	/* Register character device. */
+	if (cdev_register(SERIAL_MAJOR, &uart_driver))
+		kpanic("failed to register serial line device driver");
+	
+	uart.present = 1;
+	kprintf("ttyS0: 16550 UART at %x", UART_PORT);
+}
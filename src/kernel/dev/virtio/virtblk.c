@@ -0,0 +1,1103 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/clock.h>
+#include <nanvix/config.h>
+#include <nanvix/const.h>
+#include <nanvix/dev.h>
+#include <nanvix/fs.h>
+#include <nanvix/hal.h>
+#include <nanvix/klib.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include <dev/pci.h>
+#include <dev/virtblk.h>
+#include <dev/virtio.h>
+#include <sys/iostat.h>
+#include <sys/types.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdint.h>
+
+/* Log 2 of sector size. */
+#define VIRTBLK_SECTOR_SIZE_LOG2 9
+
+/* Number of sectors in a block. */
+#define VIRTBLK_BLOCK_SECTORS (BLOCK_SIZE >> VIRTBLK_SECTOR_SIZE_LOG2)
+
+/* Maximum number of virtio-blk devices. */
+#define VIRTBLK_DEV_MAX 4
+
+/* Maximum number of commands in flight per device. */
+#define VIRTBLK_CMD_MAX 32
+
+/* Block operation queue size. */
+#define VIRTBLK_QUEUE_SIZE 64
+
+/*
+ * Descriptors used by a command: one for the request header,
+ * one per merged block and one for the status byte.
+ */
+#define VIRTBLK_CMD_DESCS (VIRTBLK_MERGE_MAX + 2)
+
+/* virtio-blk PCI device ID. */
+#define VIRTIO_DEVICE_BLK 0x1001 /* Transitional block device. */
+
+/* Block device configuration. */
+#define VIRTBLK_CFG_CAPACITY (VIRTIO_REG_CONFIG + 0x00) /* # sectors.     */
+#define VIRTBLK_CFG_SEG_MAX  (VIRTIO_REG_CONFIG + 0x0c) /* Max. segments. */
+
+/* Block device features. */
+#define VIRTBLK_F_SEG_MAX (1 << 2) /* Segment limit.   */
+#define VIRTBLK_F_RO      (1 << 5) /* Read-only disk.  */
+#define VIRTBLK_F_FLUSH   (1 << 9) /* Write cache.     */
+
+/* Block request types. */
+#define VIRTBLK_T_IN    0 /* Read.        */
+#define VIRTBLK_T_OUT   1 /* Write.       */
+#define VIRTBLK_T_FLUSH 4 /* Flush cache. */
+
+/* Block request status. */
+#define VIRTBLK_S_OK 0 /* Success. */
+
+/*============================================================================*
+ *                                Virtqueues                                  *
+ *============================================================================*/
+
+/*
+ * Block request header.
+ */
+struct virtblk_hdr
+{
+	uint32_t type;     /* Request type. */
+	uint32_t reserved; /* Reserved.     */
+	uint64_t sector;   /* First sector. */
+} __attribute__((packed));
+
+/*
+ * Device side of a command.
+ */
+struct virtblk_cmd
+{
+	struct virtblk_hdr hdr; /* Request header. */
+	uint8_t status;         /* Request status. */
+};
+
+/*
+ * Virtqueues. These shall be aligned on page boundaries.
+ */
+PRIVATE uint8_t vrings[VIRTBLK_DEV_MAX][vring_size(VIRTIO_QUEUE_MAX)]
+	__attribute__((aligned(PAGE_SIZE)));
+
+/*
+ * Command headers and status bytes.
+ */
+PRIVATE struct virtblk_cmd vcmds[VIRTBLK_DEV_MAX][VIRTBLK_CMD_MAX];
+
+/*============================================================================*
+ *                            virtio-blk Devices                              *
+ *============================================================================*/
+
+/* Request flags. */
+#define REQ_WRITE (1 << 0) /* Write request?    */
+#define REQ_BUF   (1 << 1) /* Buffered request? */
+#define REQ_SYNC  (1 << 2) /* Synchronous?      */
+#define REQ_FLUSH (1 << 3) /* Write barrier?    */
+
+/*
+ * Block operation request.
+ */
+struct request
+{
+	unsigned flags;        /* Flags (see above).            */
+	struct request *next;  /* Next request in the queue.    */
+	int done;              /* Completed?                    */
+	int status;            /* Completion status.            */
+	unsigned issued;       /* Issue time (in ticks).        */
+	struct waitq chain;    /* Owner waiting for completion. */
+	
+	union
+	{
+		/* Raw operation. */
+		struct
+		{
+			block_t num;        /* Block number.     */
+			size_t size;        /* Size.             */
+			unsigned char *buf; /* Buffer.           */
+			addr_t phys;        /* Physical address. */
+		} raw;
+		
+		/* Buffered operation. */
+		struct
+		{
+			buffer_t buf; /* Buffer. */
+		} buffered;
+	} u;
+};
+
+/* virtio-blk device flags. */
+#define VIRTBLK_VALID (1 << 0) /* Valid device?       */
+#define VIRTBLK_FLUSH (1 << 1) /* Has a write cache?  */
+#define VIRTBLK_RO    (1 << 2) /* Read-only?          */
+
+/*
+ * virtio-blk devices.
+ */
+PRIVATE struct virtblk
+{
+	unsigned flags;         /* Flags (see above).          */
+	uint16_t iobase;        /* Base I/O port.              */
+	unsigned irq;           /* Interrupt line.             */
+	uint64_t nsectors;      /* Number of sectors.          */
+	unsigned merge;         /* Max. blocks per command.    */
+	unsigned ncmds;         /* Commands that fit in queue. */
+	unsigned busy;          /* Commands in flight.         */
+	uint64_t pos;           /* Last address served.        */
+	struct bdev_acct stats; /* I/O statistics.             */
+	
+	/* Virtqueue. */
+	unsigned qsize;                     /* Number of entries.    */
+	uint16_t next_avail;                /* Next available entry. */
+	uint16_t last_used;                 /* Last used entry seen. */
+	volatile struct vring_desc *desc;   /* Descriptor table.     */
+	volatile struct vring_avail *avail; /* Available ring.       */
+	volatile struct vring_used *used;   /* Used ring.            */
+	
+	/* Requests served by each command. */
+	int nmerged[VIRTBLK_CMD_MAX];
+	struct request *inflight[VIRTBLK_CMD_MAX][VIRTBLK_MERGE_MAX];
+	
+	/* Block operation queue. */
+	struct
+	{
+		int size;                                    /* Current size.       */
+		struct request *free;                        /* Free requests.      */
+		struct request *pending;                     /* Pending requests.   */
+		struct request *barrier;                     /* Pending barrier.    */
+		struct request *held;                        /* Held back requests. */
+		struct request requests[VIRTBLK_QUEUE_SIZE]; /* Requests.           */
+		struct waitq chain;                          /* Waiting chain.      */
+	} queue;
+} virtblk_devices[VIRTBLK_DEV_MAX];
+
+/*============================================================================*
+ *                            Low-Level Routines                              *
+ *============================================================================*/
+
+/*
+ * Setups a virtio-blk device.
+ */
+PRIVATE int virtblk_setup(unsigned minor, const struct pci_dev *pci)
+{
+	int i;               /* Loop index.         */
+	uint32_t reg;        /* Working register.   */
+	uint32_t features;   /* Features.           */
+	uint16_t iobase;     /* Base I/O port.      */
+	struct virtblk *dev; /* virtio-blk device.  */
+	
+	dev = &virtblk_devices[minor];
+	kmemset(dev, 0, sizeof(struct virtblk));
+	
+	/* Legacy registers must be in I/O space. */
+	reg = pci_read(pci, PCI_REG_BAR0);
+	if (!(reg & 1) || ((reg & 0xfffc) == 0))
+		return (-1);
+	
+	dev->iobase = iobase = reg & 0xfffc;
+	dev->irq = pci_read(pci, PCI_REG_IRQ) & 0xff;
+	if (dev->irq >= 16)
+		return (-1);
+	
+	/* Enable I/O space and bus mastering. */
+	reg = pci_read(pci, PCI_REG_COMMAND);
+	pci_write(pci, PCI_REG_COMMAND, reg | PCI_CMD_IO | PCI_CMD_MASTER);
+	
+	/* Reset device and say hello. */
+	outputb(iobase + VIRTIO_REG_STATUS, 0);
+	outputb(iobase + VIRTIO_REG_STATUS, VIRTIO_STATUS_ACK);
+	outputb(iobase + VIRTIO_REG_STATUS,
+		VIRTIO_STATUS_ACK | VIRTIO_STATUS_DRIVER);
+	
+	/* Negotiate features. */
+	features = inputl(iobase + VIRTIO_REG_HOST_FEATURES);
+	features &= VIRTBLK_F_SEG_MAX | VIRTBLK_F_RO | VIRTBLK_F_FLUSH;
+	outputl(iobase + VIRTIO_REG_GUEST_FEATURES, features);
+	
+	if (features & VIRTBLK_F_FLUSH)
+		dev->flags |= VIRTBLK_FLUSH;
+	if (features & VIRTBLK_F_RO)
+		dev->flags |= VIRTBLK_RO;
+	
+	/* Get device size. */
+	dev->nsectors = 
+		((uint64_t)inputl(iobase + VIRTBLK_CFG_CAPACITY + 0) << 0x00) |
+		((uint64_t)inputl(iobase + VIRTBLK_CFG_CAPACITY + 4) << 0x20);
+	
+	/* Honor segment limit. */
+	dev->merge = VIRTBLK_MERGE_MAX;
+	if (features & VIRTBLK_F_SEG_MAX)
+	{
+		reg = inputl(iobase + VIRTBLK_CFG_SEG_MAX);
+		if ((reg > 0) && (reg < dev->merge))
+			dev->merge = reg;
+	}
+	
+	/* Get request queue. */
+	outputw(iobase + VIRTIO_REG_QUEUE_SEL, 0);
+	dev->qsize = inputw(iobase + VIRTIO_REG_QUEUE_SIZE);
+	if ((dev->qsize == 0) || (dev->qsize > VIRTIO_QUEUE_MAX))
+		goto error;
+	
+	dev->ncmds = dev->qsize/VIRTBLK_CMD_DESCS;
+	if (dev->ncmds > VIRTBLK_CMD_MAX)
+		dev->ncmds = VIRTBLK_CMD_MAX;
+	if (dev->ncmds == 0)
+		goto error;
+	
+	/* Setup virtqueue. */
+	kmemset(vrings[minor], 0, sizeof(vrings[minor]));
+	dev->desc = (struct vring_desc *)vrings[minor];
+	dev->avail = (struct vring_avail *)&vrings[minor][16*dev->qsize];
+	dev->used = (struct vring_used *)&vrings[minor][vring_used_off(dev->qsize)];
+	outputl(iobase + VIRTIO_REG_QUEUE_PFN,
+		virtio_phys(vrings[minor]) >> PAGE_SHIFT);
+	
+	/* Initialize block operation queue. */
+	dev->queue.size = 0;
+	dev->queue.free = &dev->queue.requests[0];
+	for (i = 0; i < VIRTBLK_QUEUE_SIZE - 1; i++)
+		dev->queue.requests[i].next = &dev->queue.requests[i + 1];
+	dev->queue.requests[VIRTBLK_QUEUE_SIZE - 1].next = NULL;
+	dev->queue.pending = NULL;
+	dev->queue.barrier = NULL;
+	dev->queue.held = NULL;
+	waitq_init(&dev->queue.chain);
+	
+	outputb(iobase + VIRTIO_REG_STATUS,
+		VIRTIO_STATUS_ACK | VIRTIO_STATUS_DRIVER | VIRTIO_STATUS_DRIVER_OK);
+	
+	dev->flags |= VIRTBLK_VALID;
+	
+	return (0);
+
+error:
+	outputb(iobase + VIRTIO_REG_STATUS, VIRTIO_STATUS_FAILED);
+	return (-1);
+}
+
+/*
+ * Returns the physical address of the data buffer of a request.
+ */
+PRIVATE addr_t virtblk_request_phys(struct request *req)
+{
+	if (req->flags & REQ_BUF)
+		return (virtio_phys(buffer_data(req->u.buffered.buf)));
+	
+	return (req->u.raw.phys);
+}
+
+/*
+ * Returns the size (in bytes) of a request.
+ */
+PRIVATE size_t virtblk_request_size(struct request *req)
+{
+	if (req->flags & REQ_BUF)
+		return (BLOCK_SIZE);
+	
+	return (req->u.raw.size);
+}
+
+/*
+ * Returns the disk address (in sectors) of a request.
+ */
+PRIVATE uint64_t virtblk_request_addr(struct request *req)
+{
+	block_t num;
+	
+	num = (req->flags & REQ_BUF) ?
+		buffer_num(req->u.buffered.buf) : req->u.raw.num;
+	
+	return ((uint64_t)num*VIRTBLK_BLOCK_SECTORS);
+}
+
+/*
+ * Fills in a descriptor of a virtqueue.
+ */
+PRIVATE void virtblk_desc
+(struct virtblk *dev, unsigned i, addr_t addr, size_t len, unsigned flags)
+{
+	dev->desc[i].addr = addr;
+	dev->desc[i].len = len;
+	dev->desc[i].flags = flags;
+	dev->desc[i].next = (flags & VRING_DESC_F_NEXT) ? i + 1 : 0;
+}
+
+/*
+ * Places a command in the available ring of a device.
+ * The device is not told about it until virtblk_kick().
+ */
+PRIVATE void virtblk_push(struct virtblk *dev, int cmd)
+{
+	dev->avail->ring[dev->next_avail % dev->qsize] = cmd*VIRTBLK_CMD_DESCS;
+	dev->next_avail++;
+	dev->busy |= 1 << cmd;
+	bdev_acct_start(&dev->stats, dev->nmerged[cmd]);
+}
+
+/*
+ * Exposes all commands placed in the available ring of a device at
+ * once, and notifies the device unless it asked us not to.
+ */
+PRIVATE void virtblk_kick(struct virtblk *dev)
+{
+	virtio_wmb();
+	dev->avail->idx = dev->next_avail;
+	virtio_mb();
+	
+	if (!(dev->used->flags & VRING_USED_F_NO_NOTIFY))
+		outputw(dev->iobase + VIRTIO_REG_QUEUE_NOTIFY, 0);
+}
+
+/*============================================================================*
+ *                           Request Scheduling                               *
+ *============================================================================*/
+
+/*
+ * Inserts a request in the block operation queue of a device.
+ */
+PRIVATE void virtblk_enqueue(struct virtblk *dev, struct request *req)
+{
+	uint64_t addr;         /* Request address. */
+	struct request **link; /* Working link.    */
+	
+	/* Write barrier. */
+	if (req->flags & REQ_FLUSH)
+	{
+		dev->queue.barrier = req;
+		return;
+	}
+	
+	addr = virtblk_request_addr(req);
+	
+	/*
+	 * Keep pending requests sorted by address, so that
+	 * requests on consecutive blocks can be merged. Requests
+	 * that arrive after a barrier are held back until the
+	 * barrier completes.
+	 */
+	link = (dev->queue.barrier != NULL) ? 
+		&dev->queue.held : &dev->queue.pending;
+	for (/* noop */; *link != NULL; link = &(*link)->next)
+	{
+		if (virtblk_request_addr(*link) > addr)
+			break;
+	}
+	
+	req->next = *link;
+	*link = req;
+}
+
+/*
+ * Removes from the pending queue the next request to be served, in
+ * C-SCAN order, and the buffered requests of the same kind on
+ * consecutive blocks that follow it, so that all of them are served
+ * by a single command with one descriptor per block.
+ */
+PRIVATE int virtblk_merge(struct virtblk *dev, int cmd)
+{
+	unsigned n;            /* Number of requests. */
+	unsigned kind;         /* Kind of request.    */
+	uint64_t addr;         /* Next address.       */
+	struct request *req;   /* Working request.    */
+	struct request **link; /* Working link.       */
+	
+	for (link = &dev->queue.pending; *link != NULL; link = &(*link)->next)
+	{
+		if (virtblk_request_addr(*link) >= dev->pos)
+			break;
+	}
+	if (*link == NULL)
+		link = &dev->queue.pending;
+	
+	req = *link;
+	kind = req->flags & (REQ_BUF | REQ_WRITE);
+	addr = virtblk_request_addr(req);
+	
+	for (n = 0; (*link != NULL) && (n < dev->merge); n++)
+	{
+		req = *link;
+		
+		if (n > 0)
+		{
+			/* Raw requests are never merged. */
+			if (!(kind & REQ_BUF))
+				break;
+			
+			if ((req->flags & (REQ_BUF | REQ_WRITE)) != kind)
+				break;
+			
+			if (virtblk_request_addr(req) != addr)
+				break;
+		}
+		
+		addr += virtblk_request_size(req) >> VIRTBLK_SECTOR_SIZE_LOG2;
+		dev->inflight[cmd][n] = req;
+		*link = req->next;
+	}
+	
+	return (n);
+}
+
+/*
+ * Returns a free command of a device, or -1 if there is none.
+ */
+PRIVATE int virtblk_cmd(struct virtblk *dev)
+{
+	unsigned i;
+	
+	for (i = 0; i < dev->ncmds; i++)
+	{
+		if (!(dev->busy & (1 << i)))
+			return (i);
+	}
+	
+	return (-1);
+}
+
+/*
+ * Builds a read/write command for the requests of a command.
+ */
+PRIVATE void virtblk_rw_op(unsigned minor, int cmd)
+{
+	int i;               /* Loop index.          */
+	int write;           /* Write command?       */
+	unsigned d;          /* Working descriptor.  */
+	uint64_t addr;       /* Command address.     */
+	struct virtblk *dev; /* virtio-blk device.   */
+	struct request *req; /* Working request.     */
+	
+	dev = &virtblk_devices[minor];
+	
+	req = dev->inflight[cmd][0];
+	write = req->flags & REQ_WRITE;
+	addr = virtblk_request_addr(req);
+	
+	vcmds[minor][cmd].hdr.type = (write) ? VIRTBLK_T_OUT : VIRTBLK_T_IN;
+	vcmds[minor][cmd].hdr.reserved = 0;
+	vcmds[minor][cmd].hdr.sector = addr;
+	vcmds[minor][cmd].status = 0xff;
+	
+	d = cmd*VIRTBLK_CMD_DESCS;
+	virtblk_desc(dev, d++, virtio_phys(&vcmds[minor][cmd].hdr), 
+		sizeof(struct virtblk_hdr), VRING_DESC_F_NEXT);
+	
+	/* Buffers, kernel and pinned user pages are physically contiguous. */
+	for (i = 0; i < dev->nmerged[cmd]; i++)
+	{
+		req = dev->inflight[cmd][i];
+		virtblk_desc(dev, d++, virtblk_request_phys(req),
+			virtblk_request_size(req),
+			VRING_DESC_F_NEXT | ((write) ? 0 : VRING_DESC_F_WRITE));
+	}
+	
+	virtblk_desc(dev, d, virtio_phys(&vcmds[minor][cmd].status), 1,
+		VRING_DESC_F_WRITE);
+	
+	/* Update statistics. */
+	dev->stats.io.seek += ((addr > dev->pos) ? (addr - dev->pos) : 
+		(dev->pos - addr)) >> (BLOCK_SIZE_LOG2 - VIRTBLK_SECTOR_SIZE_LOG2);
+	dev->pos = virtblk_request_addr(req) +
+		(virtblk_request_size(req) >> VIRTBLK_SECTOR_SIZE_LOG2);
+	
+	virtblk_push(dev, cmd);
+}
+
+/*
+ * Builds a flush command.
+ */
+PRIVATE void virtblk_flush_op(unsigned minor, int cmd)
+{
+	unsigned d;
+	struct virtblk *dev;
+	
+	dev = &virtblk_devices[minor];
+	
+	vcmds[minor][cmd].hdr.type = VIRTBLK_T_FLUSH;
+	vcmds[minor][cmd].hdr.reserved = 0;
+	vcmds[minor][cmd].hdr.sector = 0;
+	vcmds[minor][cmd].status = 0xff;
+	
+	d = cmd*VIRTBLK_CMD_DESCS;
+	virtblk_desc(dev, d, virtio_phys(&vcmds[minor][cmd].hdr), 
+		sizeof(struct virtblk_hdr), VRING_DESC_F_NEXT);
+	virtblk_desc(dev, d + 1, virtio_phys(&vcmds[minor][cmd].status), 1,
+		VRING_DESC_F_WRITE);
+	
+	virtblk_push(dev, cmd);
+}
+
+/* Forward definitions. */
+PRIVATE void virtblk_complete(struct virtblk *, struct request *, int);
+
+/*
+ * Submits as many pending requests of a device as there are free
+ * commands, and then notifies the device once for the whole batch.
+ * A barrier is submitted once everything that came before it is
+ * done. Devices without a write cache have nothing to flush, so
+ * their barriers complete right away.
+ */
+PRIVATE void virtblk_start(unsigned minor)
+{
+	int cmd;             /* Command.           */
+	uint16_t avail;      /* Available index.   */
+	struct virtblk *dev; /* virtio-blk device. */
+	
+	dev = &virtblk_devices[minor];
+	avail = dev->next_avail;
+	
+	while (1)
+	{
+		while (dev->queue.pending != NULL)
+		{
+			if ((cmd = virtblk_cmd(dev)) < 0)
+				break;
+			
+			dev->nmerged[cmd] = virtblk_merge(dev, cmd);
+			virtblk_rw_op(minor, cmd);
+		}
+		
+		if ((dev->queue.pending != NULL) || (dev->queue.barrier == NULL) ||
+			(dev->busy != 0))
+			break;
+		
+		if (dev->flags & VIRTBLK_FLUSH)
+		{
+			dev->nmerged[0] = 1;
+			dev->inflight[0][0] = dev->queue.barrier;
+			virtblk_flush_op(minor, 0);
+			break;
+		}
+		
+		virtblk_complete(dev, dev->queue.barrier, 0);
+	}
+	
+	if (dev->next_avail != avail)
+		virtblk_kick(dev);
+}
+
+/*
+ * Schedules a block disk IO operation. Synchronous
+ * operations return their completion status.
+ */
+PRIVATE int virtblk_sched(unsigned minor, unsigned flags, ...)
+{
+	int status;          /* Completion status. */
+	va_list args;        /* Variable arg list. */
+	struct virtblk *dev; /* virtio-blk device. */
+	struct request *req; /* Request.           */
+	
+	dev = &virtblk_devices[minor];
+	status = 0;
+
+	disable_interrupts();
+	
+		/* Wait for a slot in the block operation queue. */
+		while ((dev->queue.free == NULL) ||
+			((flags & REQ_FLUSH) && (dev->queue.barrier != NULL)))
+			sleep_excl(&dev->queue.chain, PRIO_IO);
+		
+		req = dev->queue.free;
+		dev->queue.free = req->next;
+		
+		va_start(args, flags);
+		
+		/* Create request. */
+		req->flags = flags;
+		if (flags & REQ_BUF)
+			req->u.buffered.buf = va_arg(args, buffer_t);
+		else if (!(flags & REQ_FLUSH))
+		{
+			req->u.raw.num = va_arg(args, block_t);
+			req->u.raw.buf = va_arg(args, unsigned char *);
+			req->u.raw.phys = va_arg(args, addr_t);
+			req->u.raw.size = va_arg(args, size_t);
+		}
+		
+		va_end(args);
+		
+		/* Enqueue request. */
+		req->done = 0;
+		req->status = 0;
+		waitq_init(&req->chain);
+		req->issued = ticks;
+		virtblk_enqueue(dev, req);
+		dev->queue.size++;
+		bdev_acct_issue(&dev->stats);
+		
+		virtblk_start(minor);
+		
+		/*
+		 * Wait operation to complete. The interrupt handler
+		 * leaves synchronous requests for us to release.
+		 */
+		if (flags & REQ_SYNC)
+		{
+			while (!req->done)
+				sleep(&req->chain, PRIO_IO);
+			
+			status = req->status;
+			
+			req->next = dev->queue.free;
+			dev->queue.free = req;
+			wakeup(&dev->queue.chain);
+		}
+	
+	enable_interrupts();
+	
+	return (status);
+}
+
+/*============================================================================*
+ *                           High-Level Routines                              *
+ *============================================================================*/
+
+/*
+ * Asserts if a minor device is a valid virtio-blk device.
+ */
+#define virtblk_valid(minor) \
+	(((minor) < VIRTBLK_DEV_MAX) && \
+	 (virtblk_devices[minor].flags & VIRTBLK_VALID))
+
+/*
+ * Reads a block from a virtio-blk device.
+ */
+PRIVATE int virtblk_readblk(unsigned minor, buffer_t buf)
+{
+	unsigned flags;
+	
+	/* Invalid minor device. */
+	if (!virtblk_valid(minor))
+		return (-EINVAL);
+	
+	/* Nobody waits for read-ahead blocks. */
+	buffer_valid(buf, 0);
+	flags = REQ_BUF | (buffer_is_async(buf) ? 0 : REQ_SYNC);
+	
+	return (virtblk_sched(minor, flags, buf));
+}
+
+/*
+ * Writes a block to a virtio-blk device.
+ */
+PRIVATE int virtblk_writeblk(unsigned minor, buffer_t buf)
+{
+	unsigned flags;
+	
+	/* Invalid minor device. */
+	if (!virtblk_valid(minor))
+		return (-EINVAL);
+	
+	flags = REQ_BUF | REQ_WRITE | (buffer_is_sync(buf) ? REQ_SYNC : 0);
+	
+	return (virtblk_sched(minor, flags, buf));
+}
+
+/*
+ * Asserts if a buffer is a page-aligned user buffer. Transfers are
+ * split in page-sized chunks, so each of them then lies within a
+ * single user page and may be serviced with DMA straight to it.
+ */
+#define virtblk_direct(buf)                                             \
+	(!((addr_t)(buf) & ~PAGE_MASK) &&                                 \
+	 ((addr_t)(buf) >= UBASE_VIRT) && ((addr_t)(buf) < KBASE_VIRT))
+
+/*
+ * Transfers bytes from/to a virtio-blk device, a page at a time.
+ */
+PRIVATE ssize_t
+virtblk_transfer(unsigned minor, char *buf, size_t n, off_t off, int write)
+{
+	size_t i;           /* Loop index.                   */
+	size_t count;       /* # bytes to transfer.          */
+	block_t blknum;     /* Block number.                 */
+	block_t nblocks;    /* Number of blocks.             */
+	unsigned char *kpg; /* Kernel page used for copying. */
+	addr_t phys;        /* Physical page address.        */
+	int err;            /* Error code.                   */
+	
+	/* Invalid minor device. */
+	if (!virtblk_valid(minor))
+		return (-EINVAL);
+	
+	/* Bad offset or size. */
+	if ((off & (BLOCK_SIZE - 1)) || (n & (BLOCK_SIZE - 1)))
+		return (-EINVAL);
+	
+	nblocks = virtblk_devices[minor].nsectors/VIRTBLK_BLOCK_SECTORS;
+	
+	/*
+	 * Page-aligned user buffers are transferred
+	 * straight from/to user memory, while anything
+	 * else bounces through a kernel page.
+	 */
+	kpg = NULL;
+	if (!virtblk_direct(buf))
+	{
+		kpg = getkpg(0);
+		if (kpg == NULL)
+			return (-ENOMEM);
+	}
+	
+	for (i = 0; i < n; noop())
+	{
+		blknum = off >> BLOCK_SIZE_LOG2;
+		
+		/* End of disk. */
+		if (blknum >= nblocks)
+			break;
+		
+		count = ((n - i) >= PAGE_SIZE) ? PAGE_SIZE : (n - i);
+		
+		/* Transfer as much as we can. */
+		if (blknum + (count >> BLOCK_SIZE_LOG2) > nblocks)
+			count = (nblocks - blknum) << BLOCK_SIZE_LOG2;
+		
+		/* Zero-copy transfer. */
+		if (kpg == NULL)
+		{
+			err = -EFAULT;
+			if ((phys = pinupg((addr_t)(buf + i), !write)) != 0)
+			{
+				err = virtblk_sched(minor, REQ_SYNC | (write ? REQ_WRITE : 0),
+					blknum, NULL, phys, count);
+				unpinupg((addr_t)(buf + i));
+			}
+		}
+		
+		else
+		{
+			if (write)
+				kmemcpy(kpg, buf + i, count);
+			
+			err = virtblk_sched(minor, REQ_SYNC | (write ? REQ_WRITE : 0),
+				blknum, kpg, virtio_phys(kpg), count);
+			
+			if ((!write) && (err == 0))
+				kmemcpy(buf + i, kpg, count);
+		}
+		
+		/* Device error. */
+		if (err < 0)
+		{
+			if (kpg != NULL)
+				putkpg(kpg);
+			return ((i > 0) ? (ssize_t)i : err);
+		}
+		
+		i += count;
+		off += count;
+		
+		/* Avoid starvation. */
+		if ((n - i) > 0)
+			yield();
+	}
+	
+	if (kpg != NULL)
+		putkpg(kpg);
+	return ((ssize_t)i);
+}
+
+/*
+ * Reads bytes from a virtio-blk device.
+ */
+PRIVATE ssize_t virtblk_read(unsigned minor, char *buf, size_t n, off_t off)
+{
+	return (virtblk_transfer(minor, buf, n, off, 0));
+}
+
+/*
+ * Writes bytes to a virtio-blk device.
+ */
+PRIVATE ssize_t
+virtblk_write(unsigned minor, const char *buf, size_t n, off_t off)
+{
+	return (virtblk_transfer(minor, (char *)buf, n, off, 1));
+}
+
+/*
+ * Gets I/O statistics of a virtio-blk device.
+ */
+PRIVATE int virtblk_stat(unsigned minor, struct iostat *buf)
+{
+	struct iostat st;
+	
+	/* Invalid minor device. */
+	if (!virtblk_valid(minor))
+		return (-EINVAL);
+	
+	disable_interrupts();
+	bdev_acct_stat(&virtblk_devices[minor].stats, &st);
+	enable_interrupts();
+	
+	kmemcpy(buf, &st, sizeof(struct iostat));
+	
+	return (0);
+}
+
+/*
+ * Flushes the write cache of a virtio-blk device.
+ */
+PRIVATE int virtblk_flush(unsigned minor)
+{
+	/* Invalid minor device. */
+	if (!virtblk_valid(minor))
+		return (-EINVAL);
+	
+	return (virtblk_sched(minor, REQ_FLUSH | REQ_SYNC));
+}
+
+/*
+ * virtio-blk device operations.
+ */
+PRIVATE const struct bdev virtblk_ops = {
+	&virtblk_read,     /* read()     */
+	&virtblk_write,    /* write()    */
+	&virtblk_readblk,  /* readblk()  */
+	&virtblk_writeblk, /* writeblk() */
+	&virtblk_stat,     /* stat()     */
+	&virtblk_flush,    /* flush()    */
+	NULL               /* direct()   */
+};
+
+/*============================================================================*
+ *                            Interrupt Handling                              *
+ *============================================================================*/
+
+/*
+ * Completes a request.
+ */
+PRIVATE void virtblk_complete(struct virtblk *dev, struct request *req, int err)
+{
+	/*
+	 * Barrier is done, so release
+	 * requests that were held back.
+	 */
+	if (req->flags & REQ_FLUSH)
+	{
+		dev->queue.barrier = NULL;
+		dev->queue.pending = dev->queue.held;
+		dev->queue.held = NULL;
+	}
+	
+	/* Write operation. */
+	else if (req->flags & REQ_WRITE)
+	{
+		/* Release buffer. */
+		if (req->flags & REQ_BUF)
+		{
+			buffer_dirty(req->u.buffered.buf, 0);
+			brelse(req->u.buffered.buf);
+		}
+	}
+	
+	/* Buffered read operation. */
+	else if (req->flags & REQ_BUF)
+	{
+		/* Block contents are garbage. */
+		if (err == 0)
+			buffer_valid(req->u.buffered.buf, 1);
+		
+		/* Release read-ahead buffer. */
+		if (!(req->flags & REQ_SYNC))
+			brelse(req->u.buffered.buf);
+	}
+	
+	dev->queue.size--;
+	
+	/* Update statistics. */
+	if (req->flags & REQ_FLUSH)
+		bdev_acct_done(&dev->stats, BDEV_FLUSH, 0, req->issued);
+	else
+	{
+		bdev_acct_done(&dev->stats,
+			(req->flags & REQ_WRITE) ? BDEV_WRITE : BDEV_READ,
+			virtblk_request_size(req), req->issued);
+	}
+	
+	/* Wakeup owner, that will release the request. */
+	if (req->flags & REQ_SYNC)
+	{
+		req->status = err;
+		req->done = 1;
+		wakeup(&req->chain);
+	}
+	
+	/* Release request. */
+	else
+	{
+		req->next = dev->queue.free;
+		dev->queue.free = req;
+	}
+}
+
+/*
+ * Reaps the commands in the used ring of a virtio-blk device.
+ */
+PRIVATE void virtblk_reap(unsigned minor)
+{
+	int i;                                 /* Loop index.        */
+	int cmd;                               /* Command.           */
+	int err;                               /* Error?             */
+	int done;                              /* Commands done.     */
+	struct virtblk *dev;                   /* virtio-blk device. */
+	volatile struct vring_used_elem *elem; /* Used entry.        */
+	
+	dev = &virtblk_devices[minor];
+	done = 0;
+	
+	/*
+	 * Suppress interrupts while we drain the used ring. Once it is
+	 * empty, interrupts are enabled again and the ring is checked
+	 * once more, for commands that completed in between.
+	 */
+	dev->avail->flags |= VRING_AVAIL_F_NO_INTERRUPT;
+	while (1)
+	{
+		while (dev->last_used != dev->used->idx)
+		{
+			elem = &dev->used->ring[dev->last_used % dev->qsize];
+			cmd = elem->id/VIRTBLK_CMD_DESCS;
+			
+			err = 0;
+			if (vcmds[minor][cmd].status != VIRTBLK_S_OK)
+			{
+				kprintf("vd%c: device error", 'a' + minor);
+				err = -EIO;
+			}
+			
+			for (i = 0; i < dev->nmerged[cmd]; i++)
+				virtblk_complete(dev, dev->inflight[cmd][i], err);
+			
+			bdev_acct_end(&dev->stats, dev->nmerged[cmd]);
+			dev->nmerged[cmd] = 0;
+			dev->busy &= ~(1 << cmd);
+			dev->last_used++;
+			done++;
+		}
+		
+		dev->avail->flags &= ~VRING_AVAIL_F_NO_INTERRUPT;
+		virtio_mb();
+		
+		if (dev->last_used == dev->used->idx)
+			break;
+		
+		dev->avail->flags |= VRING_AVAIL_F_NO_INTERRUPT;
+	}
+	
+	/* Process next operations. */
+	virtblk_start(minor);
+	
+	/*
+	 * Wakeup processes that were waiting for
+	 * an empty slot in the block operation queue.
+	 */
+	if (done)
+		wakeup(&dev->queue.chain);
+}
+
+/*
+ * virtio-blk interrupt handler. Devices may share
+ * interrupt lines, so all of them are checked.
+ */
+PRIVATE void virtblk_handler(void)
+{
+	unsigned i;
+	
+	for (i = 0; i < VIRTBLK_DEV_MAX; i++)
+	{
+		if (!(virtblk_devices[i].flags & VIRTBLK_VALID))
+			continue;
+		
+		/* Reading ISR status acknowledges the interrupt. */
+		if (inputb(virtblk_devices[i].iobase + VIRTIO_REG_ISR) &
+			VIRTIO_ISR_QUEUE)
+			virtblk_reap(i);
+	}
+}
+
+/*============================================================================*
+ *                              virtblk_init()                                *
+ *============================================================================*/
+
+/**
+ * @brief Initializes the virtio-blk device driver.
+ */
+PUBLIC void virtblk_init(void)
+{
+	unsigned i, j, k;   /* Loop indexes.      */
+	unsigned n;         /* Number of devices. */
+	struct pci_dev pci; /* PCI device.        */
+	
+	/* Detect devices. */
+	for (i = 0, n = 0; n < VIRTBLK_DEV_MAX; i++)
+	{
+		if (pci_find_id(&pci, VIRTIO_VENDOR, VIRTIO_DEVICE_BLK, i))
+			break;
+		
+		if (virtblk_setup(n, &pci))
+			continue;
+		
+		kprintf("vd%c: virtio-blk disk detected.", 'a' + n);
+		kprintf("vd%c: %d sectors, %d commands in flight.", 'a' + n,
+			(unsigned)virtblk_devices[n].nsectors, virtblk_devices[n].ncmds);
+		if (virtblk_devices[n].flags & VIRTBLK_RO)
+			kprintf("vd%c: read-only disk.", 'a' + n);
+		n++;
+	}
+	
+	/* No devices. */
+	if (n == 0)
+		return;
+	
+	/* Register interrupt handlers, once per line. */
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < i; j++)
+		{
+			if (virtblk_devices[j].irq == virtblk_devices[i].irq)
+				break;
+		}
+		
+		/* Already registered. */
+		if (j < i)
+			continue;
+		
+		if (set_hwint(virtblk_devices[i].irq, &virtblk_handler))
+		{
+			kprintf("virtblk: IRQ %d busy", virtblk_devices[i].irq);
+			for (k = i; k < n; k++)
+			{
+				if (virtblk_devices[k].irq == virtblk_devices[i].irq)
+					virtblk_devices[k].flags = 0;
+			}
+		}
+	}
+	
+	bdev_register(VIRTBLK_MAJOR, &virtblk_ops);
+}
@@ -0,0 +1,1022 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/config.h>
+#include <nanvix/const.h>
+#include <nanvix/dev.h>
+#include <nanvix/fs.h>
+#include <nanvix/hal.h>
+#include <nanvix/klib.h>
+#include <nanvix/mm.h>
+#include <nanvix/net.h>
+#include <nanvix/pm.h>
+#include <dev/pci.h>
+#include <dev/virtio.h>
+#include <dev/virtnet.h>
+#include <sys/netif.h>
+#include <sys/types.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+
+/* Maximum number of virtio-net devices. */
+#define VIRTNET_DEV_MAX 2
+
+/* Receive buffers per device. */
+#define VIRTNET_RX_BUFS 64
+
+/*
+ * Transmit buffers per device. Each one takes two descriptors:
+ * one for the frame buffer and one for data sent in place.
+ */
+#define VIRTNET_TX_BUFS 32
+
+/*
+ * Receive buffers handed back to a device at once. Buffers are
+ * also handed back before a reader goes to sleep.
+ */
+#define VIRTNET_RX_BATCH 8
+
+/* Size of a frame buffer. Two of them fit in a page. */
+#define VIRTNET_BUF_SIZE (PAGE_SIZE/2)
+
+/* virtio-net PCI device ID. */
+#define VIRTIO_DEVICE_NET 0x1000 /* Transitional network device. */
+
+/* Network device configuration. */
+#define VIRTNET_CFG_MAC (VIRTIO_REG_CONFIG + 0x00) /* MAC address. */
+
+/* Network device features. */
+#define VIRTNET_F_MAC (1 << 5) /* Has a MAC address. */
+
+/* Virtqueues of a network device. */
+#define VIRTNET_RXQ 0 /* Receive queue.  */
+#define VIRTNET_TXQ 1 /* Transmit queue. */
+
+/*============================================================================*
+ *                                Virtqueues                                  *
+ *============================================================================*/
+
+/*
+ * Header that comes before every frame. No offloads are
+ * negotiated, so it is always zero on transmission.
+ */
+struct virtnet_hdr
+{
+	uint8_t flags;        /* Flags.                 */
+	uint8_t gso_type;     /* Segmentation offload.  */
+	uint16_t hdr_len;     /* Length of headers.     */
+	uint16_t gso_size;    /* Segment size.          */
+	uint16_t csum_start;  /* Checksum start.        */
+	uint16_t csum_offset; /* Checksum offset.       */
+} __attribute__((packed));
+
+/*
+ * Virtqueues. These shall be aligned on page boundaries.
+ */
+PRIVATE uint8_t vrings[VIRTNET_DEV_MAX][2][vring_size(VIRTIO_QUEUE_MAX)]
+	__attribute__((aligned(PAGE_SIZE)));
+
+/*
+ * Virtqueue. Descriptor i of the receive queue always points to
+ * frame buffer i, and descriptor 2*i of the transmit queue does.
+ */
+struct virtq
+{
+	unsigned num;                       /* Queue number.           */
+	unsigned qsize;                     /* Number of entries.      */
+	unsigned nbufs;                     /* Number of buffers.      */
+	uint16_t next_avail;                /* Next available entry.   */
+	uint16_t last_used;                 /* Last used entry seen.   */
+	volatile struct vring_desc *desc;   /* Descriptor table.       */
+	volatile struct vring_avail *avail; /* Available ring.         */
+	volatile struct vring_used *used;   /* Used ring.              */
+	volatile uint16_t *used_event;      /* Interrupt us past this. */
+	volatile uint16_t *avail_event;     /* Kick device past this.  */
+	char *bufs[VIRTNET_RX_BUFS];        /* Frame buffers.          */
+	struct waitq chain;                 /* Waiting chain.          */
+};
+
+/*============================================================================*
+ *                            virtio-net Devices                              *
+ *============================================================================*/
+
+/* virtio-net device flags. */
+#define VIRTNET_VALID     (1 << 0) /* Valid device?           */
+#define VIRTNET_EVENT_IDX (1 << 1) /* Has event indexes?      */
+#define VIRTNET_READY     (1 << 2) /* Frame buffers in place? */
+
+/*
+ * virtio-net devices.
+ */
+PRIVATE struct virtnet
+{
+	unsigned flags;                   /* Flags (see above).     */
+	uint16_t iobase;                  /* Base I/O port.         */
+	unsigned irq;                     /* Interrupt line.        */
+	uint8_t mac[ETH_ALEN];            /* Hardware address.      */
+	struct virtq rx;                  /* Receive queue.         */
+	struct virtq tx;                  /* Transmit queue.        */
+	unsigned ntxfree;                 /* Free transmit buffers. */
+	uint16_t txfree[VIRTNET_TX_BUFS]; /* Free transmit buffers. */
+	struct netif_stat stats;          /* Counters.              */
+} virtnet_devices[VIRTNET_DEV_MAX];
+
+/*
+ * Network interfaces of virtio-net devices.
+ */
+PRIVATE struct netif virtnet_ifs[VIRTNET_DEV_MAX];
+
+/*
+ * Names of network interfaces.
+ */
+PRIVATE const char *virtnet_names[VIRTNET_DEV_MAX] = { "net0", "net1" };
+
+/*============================================================================*
+ *                            Low-Level Routines                              *
+ *============================================================================*/
+
+/*
+ * Setups a virtqueue of a virtio-net device.
+ */
+PRIVATE int virtnet_vq_setup
+(struct virtnet *dev, struct virtq *q, unsigned num, uint8_t *mem, unsigned n)
+{
+	outputw(dev->iobase + VIRTIO_REG_QUEUE_SEL, num);
+	q->qsize = inputw(dev->iobase + VIRTIO_REG_QUEUE_SIZE);
+	if ((q->qsize == 0) || (q->qsize > VIRTIO_QUEUE_MAX))
+		return (-1);
+	
+	q->num = num;
+	q->nbufs = (q->qsize < n) ? q->qsize : n;
+	q->next_avail = 0;
+	q->last_used = 0;
+	waitq_init(&q->chain);
+	
+	kmemset(mem, 0, vring_size(VIRTIO_QUEUE_MAX));
+	q->desc = (struct vring_desc *)mem;
+	q->avail = (struct vring_avail *)&mem[16*q->qsize];
+	q->used = (struct vring_used *)&mem[vring_used_off(q->qsize)];
+	q->used_event = (uint16_t *)&mem[16*q->qsize + 4 + 2*q->qsize];
+	q->avail_event =
+		(uint16_t *)&mem[vring_used_off(q->qsize) + 4 + 8*q->qsize];
+	outputl(dev->iobase + VIRTIO_REG_QUEUE_PFN, virtio_phys(mem) >> PAGE_SHIFT);
+	
+	return (0);
+}
+
+/*
+ * Setups a virtio-net device.
+ */
+PRIVATE int virtnet_setup(unsigned minor, const struct pci_dev *pci)
+{
+	unsigned i;          /* Loop index.         */
+	uint32_t reg;        /* Working register.   */
+	uint32_t features;   /* Features.           */
+	uint16_t iobase;     /* Base I/O port.      */
+	struct virtnet *dev; /* virtio-net device.  */
+	
+	dev = &virtnet_devices[minor];
+	kmemset(dev, 0, sizeof(struct virtnet));
+	
+	/* Legacy registers must be in I/O space. */
+	reg = pci_read(pci, PCI_REG_BAR0);
+	if (!(reg & 1) || ((reg & 0xfffc) == 0))
+		return (-1);
+	
+	dev->iobase = iobase = reg & 0xfffc;
+	dev->irq = pci_read(pci, PCI_REG_IRQ) & 0xff;
+	if (dev->irq >= 16)
+		return (-1);
+	
+	/* Enable I/O space and bus mastering. */
+	reg = pci_read(pci, PCI_REG_COMMAND);
+	pci_write(pci, PCI_REG_COMMAND, reg | PCI_CMD_IO | PCI_CMD_MASTER);
+	
+	/* Reset device and say hello. */
+	outputb(iobase + VIRTIO_REG_STATUS, 0);
+	outputb(iobase + VIRTIO_REG_STATUS, VIRTIO_STATUS_ACK);
+	outputb(iobase + VIRTIO_REG_STATUS,
+		VIRTIO_STATUS_ACK | VIRTIO_STATUS_DRIVER);
+	
+	/* Negotiate features. */
+	features = inputl(iobase + VIRTIO_REG_HOST_FEATURES);
+	features &= VIRTNET_F_MAC | VIRTIO_RING_F_EVENT_IDX;
+	outputl(iobase + VIRTIO_REG_GUEST_FEATURES, features);
+	
+	if (features & VIRTIO_RING_F_EVENT_IDX)
+		dev->flags |= VIRTNET_EVENT_IDX;
+	
+	/* Get hardware address, or make up a local one. */
+	for (i = 0; i < ETH_ALEN; i++)
+	{
+		dev->mac[i] = (features & VIRTNET_F_MAC) ?
+			inputb(iobase + VIRTNET_CFG_MAC + i) : 0;
+	}
+	if (!(features & VIRTNET_F_MAC))
+	{
+		dev->mac[0] = 0x52;
+		dev->mac[1] = 0x54;
+		dev->mac[5] = minor + 1;
+	}
+	
+	/* Setup virtqueues. */
+	if (virtnet_vq_setup(dev, &dev->rx, VIRTNET_RXQ,
+		vrings[minor][VIRTNET_RXQ], VIRTNET_RX_BUFS))
+		goto error;
+	if (virtnet_vq_setup(dev, &dev->tx, VIRTNET_TXQ,
+		vrings[minor][VIRTNET_TXQ], VIRTNET_TX_BUFS))
+		goto error;
+	if (dev->tx.nbufs > dev->tx.qsize/2)
+		dev->tx.nbufs = dev->tx.qsize/2;
+	
+	/*
+	 * Nobody waits for transmissions to complete,
+	 * so the transmit queue starts out quiet.
+	 */
+	dev->tx.avail->flags |= VRING_AVAIL_F_NO_INTERRUPT;
+	*dev->tx.used_event = 0xffff;
+	
+	outputb(iobase + VIRTIO_REG_STATUS,
+		VIRTIO_STATUS_ACK | VIRTIO_STATUS_DRIVER | VIRTIO_STATUS_DRIVER_OK);
+	
+	dev->flags |= VIRTNET_VALID;
+	
+	return (0);
+
+error:
+	outputb(iobase + VIRTIO_REG_STATUS, VIRTIO_STATUS_FAILED);
+	return (-1);
+}
+
+/*
+ * Places a buffer in the available ring of a virtqueue.
+ * The device is not told about it until virtnet_kick().
+ */
+PRIVATE void virtnet_push(struct virtq *q, unsigned id)
+{
+	q->avail->ring[q->next_avail % q->qsize] = id;
+	q->next_avail++;
+}
+
+/*
+ * Exposes all buffers placed in the available ring of a virtqueue
+ * at once, and notifies the device unless it asked us not to.
+ */
+PRIVATE void virtnet_kick(struct virtnet *dev, struct virtq *q)
+{
+	int notify;   /* Notify device?      */
+	uint16_t old; /* Last exposed entry. */
+	
+	old = q->avail->idx;
+	if (old == q->next_avail)
+		return;
+	
+	virtio_wmb();
+	q->avail->idx = q->next_avail;
+	virtio_mb();
+	
+	if (dev->flags & VIRTNET_EVENT_IDX)
+		notify = vring_need_event(*q->avail_event, q->next_avail, old);
+	else
+		notify = !(q->used->flags & VRING_USED_F_NO_NOTIFY);
+	
+	if (notify)
+	{
+		outputw(dev->iobase + VIRTIO_REG_QUEUE_NOTIFY, q->num);
+		dev->stats.kicks++;
+	}
+}
+
+/*
+ * Asks a device to interrupt us once it uses another buffer of a
+ * virtqueue, and asserts if it has used some in the meantime.
+ */
+PRIVATE int virtnet_irq_on(struct virtnet *dev, struct virtq *q)
+{
+	if (dev->flags & VIRTNET_EVENT_IDX)
+		*q->used_event = q->last_used;
+	else
+		q->avail->flags &= ~VRING_AVAIL_F_NO_INTERRUPT;
+	virtio_mb();
+	
+	return (q->last_used != q->used->idx);
+}
+
+/*
+ * Asks a device not to interrupt us when it uses buffers of a virtqueue.
+ */
+PRIVATE void virtnet_irq_off(struct virtnet *dev, struct virtq *q)
+{
+	/* Move the event index out of the way. */
+	if (dev->flags & VIRTNET_EVENT_IDX)
+		*q->used_event = q->last_used - 1;
+	else
+		q->avail->flags |= VRING_AVAIL_F_NO_INTERRUPT;
+}
+
+/*
+ * Reclaims the transmit buffers that a virtio-net device is done with.
+ */
+PRIVATE void virtnet_reclaim(struct virtnet *dev)
+{
+	struct virtq *q;
+	
+	q = &dev->tx;
+	
+	while (q->last_used != q->used->idx)
+	{
+		dev->txfree[dev->ntxfree++] =
+			q->used->ring[q->last_used % q->qsize].id/2;
+		q->last_used++;
+	}
+}
+
+/*
+ * Releases the first n frame buffers of a virtqueue.
+ */
+PRIVATE void virtnet_putbufs(struct virtq *q, unsigned n)
+{
+	unsigned i;
+	
+	for (i = 0; i < n; i += 2)
+		putkpg(q->bufs[i]);
+}
+
+/*
+ * Allocates the frame buffers of a virtqueue, pointing every
+ * stride-th descriptor to them.
+ */
+PRIVATE int virtnet_getbufs(struct virtq *q, unsigned flags, unsigned stride)
+{
+	unsigned i;
+	
+	for (i = 0; i < q->nbufs; i++)
+	{
+		if (i & 1)
+			q->bufs[i] = q->bufs[i - 1] + VIRTNET_BUF_SIZE;
+		else if ((q->bufs[i] = getkpg(0)) == NULL)
+		{
+			virtnet_putbufs(q, i);
+			return (-ENOMEM);
+		}
+		
+		q->desc[i*stride].addr = virtio_phys(q->bufs[i]);
+		q->desc[i*stride].len = VIRTNET_BUF_SIZE;
+		q->desc[i*stride].flags = flags;
+		q->desc[i*stride].next = 0;
+	}
+	
+	return (0);
+}
+
+/*============================================================================*
+ *                           High-Level Routines                              *
+ *============================================================================*/
+
+/*
+ * Asserts if a minor device is a valid virtio-net device.
+ */
+#define virtnet_valid(minor) \
+	(((minor) < VIRTNET_DEV_MAX) && \
+	 (virtnet_devices[minor].flags & VIRTNET_VALID))
+
+/*
+ * Asserts if a minor device is a virtio-net device that is ready for I/O.
+ */
+#define virtnet_ready(minor) \
+	(virtnet_valid(minor) && (virtnet_devices[minor].flags & VIRTNET_READY))
+
+/*
+ * Gets a virtio-net device ready for I/O. Frame buffers come from the
+ * kernel page pool the first time, and then stay with the device for good.
+ */
+PRIVATE int virtnet_start(struct virtnet *dev)
+{
+	unsigned i; /* Loop index. */
+	
+	/* Nothing to do. */
+	if (dev->flags & VIRTNET_READY)
+		return (0);
+	
+	if (virtnet_getbufs(&dev->rx, VRING_DESC_F_WRITE, 1))
+		return (-ENOMEM);
+	if (virtnet_getbufs(&dev->tx, 0, 2))
+	{
+		virtnet_putbufs(&dev->rx, dev->rx.nbufs);
+		return (-ENOMEM);
+	}
+	
+	disable_interrupts();
+	
+		/* Prepost all receive buffers. */
+		for (i = 0; i < dev->rx.nbufs; i++)
+			virtnet_push(&dev->rx, i);
+		virtnet_kick(dev, &dev->rx);
+		
+		for (i = 0; i < dev->tx.nbufs; i++)
+			dev->txfree[dev->ntxfree++] = i;
+		
+		dev->flags |= VIRTNET_READY;
+	
+	enable_interrupts();
+	
+	return (0);
+}
+
+/*
+ * Opens a virtio-net device.
+ */
+PRIVATE int virtnet_open(unsigned minor)
+{
+	/* Invalid minor device. */
+	if (!virtnet_valid(minor))
+		return (-EINVAL);
+	
+	return (virtnet_start(&virtnet_devices[minor]));
+}
+
+/*
+ * Reads a frame from a virtio-net device.
+ */
+PRIVATE ssize_t virtnet_read(unsigned minor, char *buf, size_t n)
+{
+	unsigned id;                           /* Frame buffer.      */
+	size_t len;                            /* Frame length.      */
+	struct virtq *q;                       /* Receive queue.     */
+	struct virtnet *dev;                   /* virtio-net device. */
+	volatile struct vring_used_elem *elem; /* Used entry.        */
+	
+	/* Invalid minor device. */
+	if (!virtnet_ready(minor))
+		return (-EINVAL);
+	
+	/* Frames go to the network stack. */
+	if (netif_running(&virtnet_ifs[minor]))
+		return (-EBUSY);
+	
+	dev = &virtnet_devices[minor];
+	q = &dev->rx;
+	
+	disable_interrupts();
+	
+	/*
+	 * Wait for a frame. Interrupts stay off while there are frames
+	 * to read, and are only turned back on once the used ring is
+	 * drained, so a burst of frames costs a single interrupt.
+	 */
+	while (q->last_used == q->used->idx)
+	{
+		virtnet_kick(dev, q);
+		
+		/* Frames arrived meanwhile. */
+		if (virtnet_irq_on(dev, q))
+			continue;
+		
+		sleep(&q->chain, PRIO_TTY);
+		
+		/* Awaken by signal. */
+		if (issig() != SIGNULL)
+		{
+			enable_interrupts();
+			return (-EINTR);
+		}
+	}
+	
+	elem = &q->used->ring[q->last_used % q->qsize];
+	id = elem->id;
+	len = elem->len;
+	q->last_used++;
+	
+	enable_interrupts();
+	
+	/* Strip header, and whatever does not fit. */
+	len = (len > sizeof(struct virtnet_hdr)) ?
+		len - sizeof(struct virtnet_hdr) : 0;
+	if (len > n)
+	{
+		len = n;
+		dev->stats.rx_trunc++;
+	}
+	
+	kmemcpy(buf, q->bufs[id] + sizeof(struct virtnet_hdr), len);
+	
+	disable_interrupts();
+	
+		dev->stats.rx_frames++;
+		dev->stats.rx_bytes += len;
+		
+		/* Hand buffers back in batches. */
+		virtnet_push(q, id);
+		if ((uint16_t)(q->next_avail - q->avail->idx) >= VIRTNET_RX_BATCH)
+			virtnet_kick(dev, q);
+	
+	enable_interrupts();
+	
+	return ((ssize_t)len);
+}
+
+/*
+ * Writes a frame to a virtio-net device.
+ */
+PRIVATE ssize_t virtnet_write(unsigned minor, const char *buf, size_t n)
+{
+	unsigned id;         /* Frame buffer.      */
+	struct virtq *q;     /* Transmit queue.    */
+	struct virtnet *dev; /* virtio-net device. */
+	
+	/* Invalid minor device. */
+	if (!virtnet_ready(minor))
+		return (-EINVAL);
+	
+	/* Not a frame. */
+	if ((n < ETH_HLEN) || (n > ETH_FRAME_MAX))
+		return (-EINVAL);
+	
+	dev = &virtnet_devices[minor];
+	q = &dev->tx;
+	
+	disable_interrupts();
+	
+	/*
+	 * Transmit buffers are reclaimed lazily, and
+	 * we only ask to be interrupted if we run out.
+	 */
+	virtnet_reclaim(dev);
+	while (dev->ntxfree == 0)
+	{
+		if (!virtnet_irq_on(dev, q))
+		{
+			sleep(&q->chain, PRIO_TTY);
+			
+			/* Awaken by signal. */
+			if (issig() != SIGNULL)
+			{
+				virtnet_irq_off(dev, q);
+				enable_interrupts();
+				return (-EINTR);
+			}
+		}
+		
+		virtnet_reclaim(dev);
+	}
+	virtnet_irq_off(dev, q);
+	
+	id = dev->txfree[--dev->ntxfree];
+	
+	enable_interrupts();
+	
+	kmemset(q->bufs[id], 0, sizeof(struct virtnet_hdr));
+	kmemcpy(q->bufs[id] + sizeof(struct virtnet_hdr), buf, n);
+	
+	disable_interrupts();
+	
+		q->desc[2*id].len = sizeof(struct virtnet_hdr) + n;
+		q->desc[2*id].flags = 0;
+		virtnet_push(q, 2*id);
+		virtnet_kick(dev, q);
+		
+		dev->stats.tx_frames++;
+		dev->stats.tx_bytes += n;
+	
+	enable_interrupts();
+	
+	return ((ssize_t)n);
+}
+
+/*
+ * Handles an I/O control request on a virtio-net device.
+ */
+PRIVATE int virtnet_ioctl(unsigned minor, unsigned cmd, unsigned arg)
+{
+	struct netif *nif;     /* Network interface.  */
+	struct netif_stat st;  /* Counters.           */
+	struct netif_addr ad;  /* Protocol addresses. */
+	
+	/* Invalid minor device. */
+	if (!virtnet_valid(minor))
+		return (-EINVAL);
+	
+	nif = &virtnet_ifs[minor];
+	
+	switch (cmd)
+	{
+		/* Get hardware address. */
+		case NETIF_GETMAC:
+			if (!chkmem((void *)arg, ETH_ALEN, MAY_WRITE))
+				return (-EFAULT);
+			kmemcpy((void *)arg, virtnet_devices[minor].mac, ETH_ALEN);
+			return (0);
+		
+		/* Get counters. */
+		case NETIF_GETSTAT:
+			if (!chkmem((void *)arg, sizeof(struct netif_stat), MAY_WRITE))
+				return (-EFAULT);
+			disable_interrupts();
+			kmemcpy(&st, &virtnet_devices[minor].stats, sizeof(st));
+			enable_interrupts();
+			kmemcpy((void *)arg, &st, sizeof(struct netif_stat));
+			return (0);
+		
+		/* Get protocol addresses. */
+		case NETIF_GETADDR:
+			if (!chkmem((void *)arg, sizeof(struct netif_addr), MAY_WRITE))
+				return (-EFAULT);
+			disable_interrupts();
+			ad.addr = nif->addr;
+			ad.netmask = nif->netmask;
+			ad.gateway = nif->gateway;
+			enable_interrupts();
+			kmemcpy((void *)arg, &ad, sizeof(struct netif_addr));
+			return (0);
+		
+		/* Set protocol addresses. */
+		case NETIF_SETADDR:
+			if (!IS_SUPERUSER(curr_proc))
+				return (-EPERM);
+			if (!chkmem((void *)arg, sizeof(struct netif_addr), MAY_READ))
+				return (-EFAULT);
+			kmemcpy(&ad, (void *)arg, sizeof(struct netif_addr));
+			disable_interrupts();
+			nif->addr = ad.addr;
+			nif->netmask = ad.netmask;
+			nif->gateway = ad.gateway;
+			enable_interrupts();
+			return (0);
+		
+		/* Take frames away from the network stack, or give them back. */
+		case NETIF_SETRAW:
+			if (!IS_SUPERUSER(curr_proc))
+				return (-EPERM);
+			disable_interrupts();
+			if (arg)
+				nif->flags |= NETIF_RAW;
+			else
+			{
+				nif->flags &= ~NETIF_RAW;
+				net_rx();
+			}
+			enable_interrupts();
+			return (0);
+		
+		default:
+			break;
+	}
+	
+	return (-EINVAL);
+}
+
+/*
+ * Closes a virtio-net device.
+ */
+PRIVATE int virtnet_close(dev_t dev)
+{
+	unsigned minor;
+	
+	minor = MINOR(dev);
+	
+	/* Hand back the receive buffers of the last batch. */
+	if (virtnet_ready(minor))
+	{
+		disable_interrupts();
+		virtnet_kick(&virtnet_devices[minor], &virtnet_devices[minor].rx);
+		enable_interrupts();
+	}
+	
+	return (0);
+}
+
+/*
+ * Asserts which operations on a virtio-net device would not block.
+ * Interrupts are turned on for whatever would, so that pollers are
+ * awaken when it becomes ready.
+ */
+PRIVATE int virtnet_poll(unsigned minor)
+{
+	int revents;         /* Events ready.      */
+	struct virtnet *dev; /* virtio-net device. */
+	
+	/* Invalid minor device. */
+	if (!virtnet_ready(minor))
+		return (POLLERR);
+	
+	dev = &virtnet_devices[minor];
+	revents = 0;
+	
+	disable_interrupts();
+	
+		virtnet_kick(dev, &dev->rx);
+		if ((dev->rx.last_used != dev->rx.used->idx) ||
+			(virtnet_irq_on(dev, &dev->rx)))
+			revents |= POLLIN;
+		
+		virtnet_reclaim(dev);
+		if ((dev->ntxfree == 0) && (virtnet_irq_on(dev, &dev->tx)))
+			virtnet_reclaim(dev);
+		if (dev->ntxfree > 0)
+			revents |= POLLOUT;
+	
+	enable_interrupts();
+	
+	return (revents);
+}
+
+/*============================================================================*
+ *                          Network Stack Interface                           *
+ *============================================================================*/
+
+/*
+ * Gets a virtio-net device ready for the network stack.
+ */
+PRIVATE int virtnet_up(struct netif *nif)
+{
+	return (virtnet_start(&virtnet_devices[nif->minor]));
+}
+
+/*
+ * Takes a frame from a virtio-net device for the network stack.
+ * Frames are dropped if the stack is out of packets, so that the
+ * device never runs out of receive buffers.
+ */
+PRIVATE struct packet *virtnet_recv(struct netif *nif)
+{
+	unsigned id;                           /* Frame buffer.      */
+	size_t len;                            /* Frame length.      */
+	struct virtq *q;                       /* Receive queue.     */
+	struct virtnet *dev;                   /* virtio-net device. */
+	struct packet *pkt;                    /* Packet.            */
+	volatile struct vring_used_elem *elem; /* Used entry.        */
+	
+	dev = &virtnet_devices[nif->minor];
+	q = &dev->rx;
+	
+	do
+	{
+		/* Drained. */
+		while (q->last_used == q->used->idx)
+		{
+			virtnet_kick(dev, q);
+			
+			if (!virtnet_irq_on(dev, q))
+				return (NULL);
+		}
+		
+		elem = &q->used->ring[q->last_used % q->qsize];
+		id = elem->id;
+		len = elem->len;
+		q->last_used++;
+		
+		/* Strip header, and whatever does not fit. */
+		len = (len > sizeof(struct virtnet_hdr)) ?
+			len - sizeof(struct virtnet_hdr) : 0;
+		if (len > ETH_FRAME_MAX)
+		{
+			len = ETH_FRAME_MAX;
+			dev->stats.rx_trunc++;
+		}
+		
+		if ((pkt = net_alloc()) != NULL)
+		{
+			kmemcpy(pkt->buf, q->bufs[id] + sizeof(struct virtnet_hdr), len);
+			pkt->len = len;
+			dev->stats.rx_frames++;
+			dev->stats.rx_bytes += len;
+		}
+		else
+			dev->stats.rx_drop++;
+		
+		/* Hand buffers back in batches. */
+		virtnet_push(q, id);
+		if ((uint16_t)(q->next_avail - q->avail->idx) >= VIRTNET_RX_BATCH)
+			virtnet_kick(dev, q);
+	} while (pkt == NULL);
+	
+	return (pkt);
+}
+
+/*
+ * Sends a frame from the network stack on a virtio-net device. The
+ * frame is copied, but data that follows it is chained in place, so
+ * it shall be in the linear kernel mapping.
+ */
+PRIVATE int virtnet_xmit
+(struct netif *nif, const char *frame, size_t flen, const char *data, size_t dlen)
+{
+	unsigned id;                   /* Frame buffer.      */
+	struct virtq *q;               /* Transmit queue.    */
+	struct virtnet *dev;           /* virtio-net device. */
+	volatile struct vring_desc *d; /* Frame descriptor.  */
+	
+	dev = &virtnet_devices[nif->minor];
+	q = &dev->tx;
+	
+	virtnet_reclaim(dev);
+	if (dev->ntxfree == 0)
+	{
+		/* Get interrupted once the device catches up. */
+		if (!virtnet_irq_on(dev, q))
+			return (-ENOBUFS);
+		
+		virtnet_irq_off(dev, q);
+		virtnet_reclaim(dev);
+	}
+	
+	id = dev->txfree[--dev->ntxfree];
+	
+	kmemset(q->bufs[id], 0, sizeof(struct virtnet_hdr));
+	kmemcpy(q->bufs[id] + sizeof(struct virtnet_hdr), frame, flen);
+	
+	d = &q->desc[2*id];
+	d->len = sizeof(struct virtnet_hdr) + flen;
+	d->flags = 0;
+	
+	if (dlen > 0)
+	{
+		d->flags = VRING_DESC_F_NEXT;
+		d->next = 2*id + 1;
+		q->desc[2*id + 1].addr = virtio_phys(data);
+		q->desc[2*id + 1].len = dlen;
+		q->desc[2*id + 1].flags = 0;
+	}
+	
+	virtnet_push(q, 2*id);
+	virtnet_kick(dev, q);
+	
+	dev->stats.tx_frames++;
+	dev->stats.tx_bytes += flen + dlen;
+	
+	return (0);
+}
+
+/*
+ * virtio-net device operations.
+ */
+PRIVATE const struct cdev virtnet_ops = {
+	&virtnet_open,  /* open()  */
+	&virtnet_read,  /* read()  */
+	&virtnet_write, /* write() */
+	&virtnet_ioctl, /* ioctl() */
+	&virtnet_close, /* close() */
+	&virtnet_poll   /* poll()  */
+};
+
+/*============================================================================*
+ *                            Interrupt Handling                              *
+ *============================================================================*/
+
+/*
+ * virtio-net interrupt handler. Devices may share interrupt lines,
+ * with each other and with other virtio devices, so all of them are
+ * checked. Nothing is done here but waking up whoever waits, or
+ * handing over to the network stack: further interrupts are
+ * suppressed until they catch up.
+ */
+PRIVATE void virtnet_handler(void)
+{
+	unsigned i;          /* Loop index.        */
+	struct virtnet *dev; /* virtio-net device. */
+	
+	for (i = 0; i < VIRTNET_DEV_MAX; i++)
+	{
+		dev = &virtnet_devices[i];
+		
+		if (!(dev->flags & VIRTNET_VALID))
+			continue;
+		
+		/* Reading ISR status acknowledges the interrupt. */
+		if (!(inputb(dev->iobase + VIRTIO_REG_ISR) & VIRTIO_ISR_QUEUE))
+			continue;
+		
+		dev->stats.irqs++;
+		
+		if (dev->rx.last_used != dev->rx.used->idx)
+		{
+			virtnet_irq_off(dev, &dev->rx);
+			if (netif_running(&virtnet_ifs[i]))
+				net_rx();
+			else
+				wakeup(&dev->rx.chain);
+		}
+		
+		if (dev->tx.last_used != dev->tx.used->idx)
+		{
+			virtnet_irq_off(dev, &dev->tx);
+			if (netif_running(&virtnet_ifs[i]))
+				net_tx();
+			else
+				wakeup(&dev->tx.chain);
+		}
+		
+		if (!netif_running(&virtnet_ifs[i]))
+			pollwakeup(NULL);
+	}
+}
+
+/*============================================================================*
+ *                              virtnet_init()                                *
+ *============================================================================*/
+
+/*
+ * Formats a hardware address.
+ */
+PRIVATE void virtnet_mac(char *str, const uint8_t *mac)
+{
+	unsigned i;
+	const char *digits = "0123456789abcdef";
+	
+	for (i = 0; i < ETH_ALEN; i++)
+	{
+		*str++ = digits[mac[i] >> 4];
+		*str++ = digits[mac[i] & 0xf];
+		*str++ = (i < ETH_ALEN - 1) ? ':' : '\0';
+	}
+}
+
+/**
+ * @brief Initializes the virtio-net device driver.
+ */
+PUBLIC void virtnet_init(void)
+{
+	unsigned i, j, k;   /* Loop indexes.      */
+	unsigned n;         /* Number of devices. */
+	struct pci_dev pci; /* PCI device.        */
+	char mac[18];       /* Hardware address.  */
+	
+	/* Detect devices. */
+	for (i = 0, n = 0; n < VIRTNET_DEV_MAX; i++)
+	{
+		if (pci_find_id(&pci, VIRTIO_VENDOR, VIRTIO_DEVICE_NET, i))
+			break;
+		
+		if (virtnet_setup(n, &pci))
+			continue;
+		
+		virtnet_mac(mac, virtnet_devices[n].mac);
+		kprintf("net%d: virtio-net interface detected.", n);
+		kprintf("net%d: address %s, %d receive buffers.", n, mac,
+			virtnet_devices[n].rx.nbufs);
+		n++;
+	}
+	
+	/* No devices. */
+	if (n == 0)
+		return;
+	
+	/* Register interrupt handlers, once per line. */
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < i; j++)
+		{
+			if (virtnet_devices[j].irq == virtnet_devices[i].irq)
+				break;
+		}
+		
+		/* Already registered. */
+		if (j < i)
+			continue;
+		
+		if (share_hwint(virtnet_devices[i].irq, &virtnet_handler))
+		{
+			kprintf("virtnet: IRQ %d busy", virtnet_devices[i].irq);
+			for (k = i; k < n; k++)
+			{
+				if (virtnet_devices[k].irq == virtnet_devices[i].irq)
+					virtnet_devices[k].flags = 0;
+			}
+		}
+	}
+	
+	cdev_register(NET_MAJOR, &virtnet_ops);
+	
+	/* Hand interfaces over to the network stack. */
+	for (i = 0; i < n; i++)
+	{
+		if (!(virtnet_devices[i].flags & VIRTNET_VALID))
+			continue;
+		
+		virtnet_ifs[i].name = virtnet_names[i];
+		virtnet_ifs[i].minor = i;
+		kmemcpy(virtnet_ifs[i].mac, virtnet_devices[i].mac, ETH_ALEN);
+		virtnet_ifs[i].up = &virtnet_up;
+		virtnet_ifs[i].recv = &virtnet_recv;
+		virtnet_ifs[i].xmit = &virtnet_xmit;
+		netif_register(&virtnet_ifs[i]);
+	}
+}
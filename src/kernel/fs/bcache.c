@@ -0,0 +1,338 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ * 
+ * @brief Second-level block cache module implementation.
+ * 
+ * @details Clean blocks evicted from the block buffer cache are demoted to a
+ *          memory disk, and misses of the block buffer cache look there
+ *          before going to the device. The two levels are exclusive: a block
+ *          that is found in the memory disk leaves it, so that there is
+ *          never a stale copy of a block that was changed in the block
+ *          buffer cache. Blocks of directly accessible devices are never
+ *          demoted, since these are memory already.
+ * 
+ *          The memory disk #BCACHE_DEV is reserved to this module. Its pages
+ *          are taken from the kernel page pool as slots are first used.
+ */
+
+#include <nanvix/config.h>
+#include <nanvix/const.h>
+#include <nanvix/dev.h>
+#include <nanvix/fs.h>
+#include <nanvix/hal.h>
+#include <nanvix/klib.h>
+#include <sys/cachestat.h>
+#include <stdint.h>
+#include "fs.h"
+
+#if (BCACHE)
+
+/* Second-level cache too large. */
+#if (BCACHE_SIZE > RAMDISK_SIZE)
+	#error "BCACHE_SIZE > RAMDISK_SIZE"
+#endif
+
+/**
+ * @brief Number of slots in the second-level block cache.
+ */
+#define NR_BCACHE (BCACHE_SIZE/BLOCK_SIZE)
+
+/**
+ * @brief Hash table size of the second-level block cache.
+ */
+#define NR_BCACHE_HASH 257
+
+/**
+ * @brief Null slot.
+ */
+#define BCACHE_NULL 0xffff
+
+/**
+ * @brief Hash function for the second-level block cache.
+ */
+#define BCACHE_HASH(dev, num) \
+	(((dev)^(num))%NR_BCACHE_HASH)
+
+/**
+ * @brief Second-level block cache index.
+ * 
+ * @details Slot i holds block i of #BCACHE_DEV. Used slots are chained in a
+ *          hash table, and in a LRU list whose head is the most recently
+ *          demoted block. Free slots are chained in the free list through
+ *          their LRU links.
+ */
+PRIVATE struct
+{
+	uint16_t dev;   /**< Device number.           */
+	block_t num;    /**< Block number.            */
+	uint16_t hnext; /**< Next slot in hash chain. */
+	uint16_t prev;  /**< Previous slot in list.   */
+	uint16_t next;  /**< Next slot in list.       */
+} slots[NR_BCACHE];
+
+/**
+ * @brief Hash table of the second-level block cache.
+ */
+PRIVATE uint16_t hashtab[NR_BCACHE_HASH];
+
+/**
+ * @brief LRU list of used slots.
+ */
+PRIVATE uint16_t lru_head = BCACHE_NULL;
+PRIVATE uint16_t lru_tail = BCACHE_NULL;
+
+/**
+ * @brief List of free slots.
+ */
+PRIVATE uint16_t free_head = BCACHE_NULL;
+
+/**
+ * @brief Number of used slots.
+ */
+PRIVATE unsigned nused = 0;
+
+/**
+ * @brief Second-level block cache statistics.
+ */
+PRIVATE struct cachestat stats;
+
+/**
+ * @brief Gets a pointer to the data of a slot.
+ * 
+ * @param i Slot index.
+ * 
+ * @returns A pointer to the data of the slot, or NULL if the memory disk
+ *          cannot back it.
+ */
+PRIVATE inline char *bcache_data(unsigned i)
+{
+	return (bdev_direct(BCACHE_DEV, i));
+}
+
+/**
+ * @brief Looks up a block in the second-level block cache.
+ * 
+ * @param dev Device number.
+ * @param num Block number.
+ * 
+ * @returns The slot that holds the block, or #BCACHE_NULL if there is none.
+ */
+PRIVATE unsigned bcache_lookup(dev_t dev, block_t num)
+{
+	unsigned i; /* Slot index. */
+	
+	for (i = hashtab[BCACHE_HASH(dev, num)]; i != BCACHE_NULL; i = slots[i].hnext)
+	{
+		if ((slots[i].dev == dev) && (slots[i].num == num))
+			break;
+	}
+	
+	return (i);
+}
+
+/**
+ * @brief Removes a used slot from the second-level block cache.
+ * 
+ * @param i Slot index.
+ */
+PRIVATE void bcache_remove(unsigned i)
+{
+	uint16_t *p; /* Working link. */
+	
+	/* Remove from hash chain. */
+	p = &hashtab[BCACHE_HASH(slots[i].dev, slots[i].num)];
+	while (*p != i)
+		p = &slots[*p].hnext;
+	*p = slots[i].hnext;
+	
+	/* Remove from LRU list. */
+	if (slots[i].prev != BCACHE_NULL)
+		slots[slots[i].prev].next = slots[i].next;
+	else
+		lru_head = slots[i].next;
+	if (slots[i].next != BCACHE_NULL)
+		slots[slots[i].next].prev = slots[i].prev;
+	else
+		lru_tail = slots[i].prev;
+	
+	/* Put in free list. */
+	slots[i].next = free_head;
+	free_head = i;
+	nused--;
+}
+
+/**
+ * @brief Demotes a block to the second-level block cache.
+ * 
+ * @details Copies the block held by the block buffer pointed to by @p buf,
+ *          which is being reused, to the second-level block cache. When the
+ *          cache is full, the least recently demoted block is dropped.
+ * 
+ * @param buf Clean and valid block buffer.
+ * 
+ * @note Interrupts must be disabled.
+ */
+PUBLIC void bcache_put(const struct buffer *buf)
+{
+	unsigned i; /* Slot index.  */
+	char *data; /* Slot data.   */
+	unsigned h; /* Hash chain.  */
+	
+	/* Already cached. */
+	if ((i = bcache_lookup(buf->dev, buf->num)) != BCACHE_NULL)
+		bcache_remove(i);
+	
+	/* Drop least recently demoted block. */
+	if (free_head == BCACHE_NULL)
+	{
+		bcache_remove(lru_tail);
+		stats.evictions++;
+	}
+	
+	i = free_head;
+	
+	/* Memory disk cannot back this slot. */
+	if ((data = bcache_data(i)) == NULL)
+		return;
+	
+	free_head = slots[i].next;
+	kmemcpy(data, buf->data, BLOCK_SIZE);
+	
+	/* Insert in hash chain. */
+	slots[i].dev = buf->dev;
+	slots[i].num = buf->num;
+	h = BCACHE_HASH(buf->dev, buf->num);
+	slots[i].hnext = hashtab[h];
+	hashtab[h] = i;
+	
+	/* Insert in LRU list. */
+	slots[i].prev = BCACHE_NULL;
+	slots[i].next = lru_head;
+	if (lru_head != BCACHE_NULL)
+		slots[lru_head].prev = i;
+	else
+		lru_tail = i;
+	lru_head = i;
+	nused++;
+}
+
+/**
+ * @brief Gets a block from the second-level block cache.
+ * 
+ * @details Looks up the block to be held by the block buffer pointed to by
+ *          @p buf in the second-level block cache. If the block is found, it
+ *          is copied to the block buffer and leaves the cache.
+ * 
+ * @param buf Block buffer that has just been assigned to a block.
+ * 
+ * @returns Non-zero if the block was found, and zero otherwise.
+ * 
+ * @note Interrupts must be disabled.
+ */
+PUBLIC int bcache_get(struct buffer *buf)
+{
+	unsigned i; /* Slot index. */
+	
+	/* Miss. */
+	if ((i = bcache_lookup(buf->dev, buf->num)) == BCACHE_NULL)
+	{
+		stats.misses++;
+		return (0);
+	}
+	
+	kmemcpy(buf->data, bcache_data(i), BLOCK_SIZE);
+	bcache_remove(i);
+	stats.hits++;
+	
+	return (1);
+}
+
+/**
+ * @brief Invalidates a block in the second-level block cache.
+ * 
+ * @details Drops the copy of the block numbered @p num of the device numbered
+ *          @p dev, if any. This shall be called whenever a block is written
+ *          to its device without going through the block buffer cache, or the
+ *          stale copy would be read back later.
+ * 
+ * @param dev Device number.
+ * @param num Block number.
+ */
+PUBLIC void bcache_invalidate(dev_t dev, block_t num)
+{
+	unsigned i; /* Slot index. */
+	
+	disable_interrupts();
+	
+	if ((i = bcache_lookup(dev, num)) != BCACHE_NULL)
+		bcache_remove(i);
+	
+	enable_interrupts();
+}
+
+/**
+ * @brief Drops all blocks in the second-level block cache.
+ * 
+ * @note Interrupts must be disabled.
+ */
+PUBLIC void bcache_drop(void)
+{
+	while (lru_head != BCACHE_NULL)
+		bcache_remove(lru_head);
+}
+
+/**
+ * @brief Gets second-level block cache statistics.
+ * 
+ * @param buf Location where statistics shall be stored.
+ */
+PUBLIC void bcache_stat(struct cachestat *buf)
+{
+	disable_interrupts();
+	
+	stats.size = NR_BCACHE;
+	stats.used = nused;
+	stats.dirty = 0;
+	
+	kmemcpy(buf, &stats, sizeof(struct cachestat));
+	
+	enable_interrupts();
+}
+
+/**
+ * @brief Initializes the second-level block cache.
+ * 
+ * @note This function shall be called just once.
+ */
+PUBLIC void bcache_init(void)
+{
+	for (unsigned i = 0; i < NR_BCACHE_HASH; i++)
+		hashtab[i] = BCACHE_NULL;
+	
+	for (unsigned i = 0; i < NR_BCACHE; i++)
+		slots[i].next = (i + 1 < NR_BCACHE) ? i + 1 : BCACHE_NULL;
+	free_head = 0;
+	
+	kprintf("fs: %d slots in the second-level block cache", NR_BCACHE);
+}
+
+#endif /* BCACHE */
@@ -21,6 +21,7 @@
 #include <nanvix/clock.h>
 #include <nanvix/fs.h>
 #include <nanvix/klib.h>
+#include <sys/stat.h>
 #include <errno.h>
 #include "fs.h"
 
@@ -30,63 +31,192 @@
  * @brief Superblock module implementation.
  */
 
+/**
+ * @brief Deferred block frees.
+ * 
+ * @details Blocks released by inode_truncate() are queued here and given back
+ *          to the bitmap of blocks later on by the buffer flusher daemon, so
+ *          that truncating a large file does not walk its indirect blocks
+ *          while the caller waits. Queued blocks stay taken in the bitmap
+ *          until they are applied, so they cannot be reused too early.
+ */
+PRIVATE struct
+{
+	struct superblock *sb; /**< Superblock.           */
+	block_t num;           /**< Disk block number.    */
+	int lvl;               /**< Level of indirection. */
+} pending[NR_FREE_PENDING];
+
+/**
+ * @brief Number of deferred block frees.
+ */
+PRIVATE unsigned npending = 0;
+
+/* Forward definitions. */
+PRIVATE int block_apply(struct superblock *);
+
+/**
+ * @brief Asserts if a disk block is free.
+ * 
+ * @param sb  Superblock in which the disk block lies.
+ * @param num Number of the disk block that shall be checked.
+ * 
+ * @returns Non-zero if the disk block is a free data block, and zero
+ *          otherwise.
+ * 
+ * @note The superblock must be locked.
+ */
+PRIVATE int block_is_free(struct superblock *sb, block_t num)
+{
+	/* Not a data block. */
+	if ((num < sb->first_data_block) || (num >= sb->zones))
+		return (0);
+	
+	num -= sb->first_data_block;
+	
+	return (!bitmap_test(sb->zmap[num/(BLOCK_SIZE << 3)]->data,
+		num%(BLOCK_SIZE << 3)));
+}
+
+/**
+ * @brief Sets a disk block as used in the bitmap of blocks.
+ * 
+ * @param sb  Superblock in which the disk block lies.
+ * @param num Number of the disk block that shall be set as used.
+ * 
+ * @note The superblock must be locked.
+ */
+PRIVATE void block_take(struct superblock *sb, block_t num)
+{
+	if (num < sb->zones)
+		sb->gzfree[ZONE_GROUP(sb, num)]--;
+	
+	num -= sb->first_data_block;
+	
+	bitmap_set(sb->zmap[num/(BLOCK_SIZE << 3)]->data, num%(BLOCK_SIZE << 3));
+	journal_dirty(sb, sb->zmap[num/(BLOCK_SIZE << 3)]);
+	sb->zfree--;
+	sb->flags |= SUPERBLOCK_DIRTY;
+}
+
 /**
  * @brief Allocates a disk block.
  * 
- * @details Allocates a disk block by searching in the bitmap of blocks for a
- *          free block.
+ * @details Allocates a disk block to the file pointed to by @p ip. The block
+ *          is taken from the preallocation window of the file if @p goal
+ *          starts it. Otherwise, @p goal itself is allocated if free, and the
+ *          bitmap of blocks is searched for the next free block if not. A
+ *          file with no goal gets a block in the allocation group of its
+ *          inode, so that data lies near the inode that points to it.
+ * 
+ *          When a block is allocated to a regular file with an empty
+ *          preallocation window, the run of free blocks that follows it is
+ *          reserved to the file, so that interleaved appends to different
+ *          files still end up in contiguous blocks.
+ * 
+ *          Zones reserved to delayed writes are left alone, unless the file
+ *          holds such a reservation itself, in which case one of its reserved
+ *          zones is used up.
  * 
- * @param sb Superblock in which the disk block should be allocated.
+ * @param ip   File to which the disk block should be allocated.
+ * @param goal Preferred disk block number.
  * 
  * @return Upon successful completion, the block number of the allocated block
  *         is returned. Upon failed, #BLOCK_NULL is returned instead.
  * 
  * @note The superblock must be locked.
  */
-PRIVATE block_t block_alloc(struct superblock *sb)
+PRIVATE block_t block_alloc(struct inode *ip, block_t goal)
 {
-	bit_t bit;          /* Bit number in the bitmap. */
-	block_t num;        /* Block number.             */
-	block_t blk;        /* Working block.            */
-	block_t firstblk;   /* First block to check.     */
-	struct buffer *buf; /* Working buffer.           */
+	bit_t bit;             /* Bit number in the bitmap. */
+	block_t num;           /* Block number.             */
+	struct buffer *buf;    /* Working buffer.           */
+	struct superblock *sb; /* Superblock.               */
+	
+	sb = ip->sb;
+	
+	/* Use up a reserved zone. */
+	if (ip->ndelay > 0)
+	{
+		ip->ndelay--;
+		sb->zdelay--;
+	}
+	
+	/* Other zones are reserved. */
+	else
+	{
+		while (sb->zfree <= sb->zdelay)
+		{
+			if (!block_apply(sb))
+				return (BLOCK_NULL);
+		}
+	}
+	
+	/* Take preallocated block. */
+	if ((ip->pa_count > 0) && (goal == ip->pa_start))
+	{
+		num = ip->pa_start++;
+		ip->pa_count--;
+		goto clean;
+	}
+	
+	/* Place data in the allocation group of the inode. */
+	if ((goal < sb->first_data_block) || (goal >= sb->zones))
+		goal = GROUP_ZONE(sb, INODE_GROUP(sb, ip->num));
+	
+	/* Allocation goal is free. */
+	if (block_is_free(sb, goal))
+	{
+		num = goal;
+		goto found;
+	}
 
-	/* Search for a free block. */
-	firstblk = (sb->zsearch - sb->first_data_block)/(BLOCK_SIZE << 3);
-	blk = firstblk;
-	do
+again:
+
+	/* Search for a free block near the goal. */
+	bit = superblock_search(sb->zmap, sb->zmap_blocks, NR_DATA_ZONES(sb),
+		goal - sb->first_data_block);
+	
+	if (bit == BITMAP_FULL)
 	{
-		bit = bitmap_first_free(sb->zmap[blk]->data, BLOCK_SIZE);
+		/* Give deferred frees back and retry. */
+		if (block_apply(sb))
+			goto again;
 		
-		/* Found. */
-		if (bit != BITMAP_FULL)
-			goto found;
-		
-		/* Wrap around. */
-		blk = (blk + 1 < sb->zmap_blocks) ? blk + 1 : 0;
-	} while (blk != firstblk);
+		return (BLOCK_NULL);
+	}
 	
-	return (BLOCK_NULL);
+	num = sb->first_data_block + bit;
 
 found:
-
-	num =  sb->first_data_block + bit + blk*(BLOCK_SIZE << 3);
-	
-	/* 
-	 * Remember disk block number to 
-	 * speedup next block allocation.
-	 */
-	sb->zsearch = num;
 	
 	/* Allocate block. */
-	bitmap_set(sb->zmap[blk]->data, bit);
-	sb->zmap[blk]->flags |= BUFFER_DIRTY;
-	sb->flags |= SUPERBLOCK_DIRTY;
+	block_take(sb, num);
+	
+	/* Preallocate contiguous blocks. */
+	if (S_ISREG(ip->mode) && (ip->pa_count == 0))
+	{
+		ip->pa_start = num + 1;
+		while (ip->pa_count < PREALLOC_MAX - 1)
+		{
+			if (!block_is_free(sb, ip->pa_start + ip->pa_count))
+				break;
+			
+			/* Leave reserved zones alone. */
+			if (sb->zfree <= sb->zdelay)
+				break;
+			
+			block_take(sb, ip->pa_start + ip->pa_count++);
+		}
+	}
+
+clean:
 	
 	/* Clean block to avoid security issues. */
-	buf = bread(sb->dev, blk);	
+	buf = bget(sb->dev, num);
 	kmemset(buf->data, 0, BLOCK_SIZE);
-	buf->flags |= BUFFER_DIRTY;
+	journal_revoke(sb, buf);
+	buffer_attach(buf, ip);
 	brelse(buf);
 	
 	return (num);
@@ -112,12 +242,8 @@ PRIVATE void block_free_direct(struct superblock *sb, block_t num)
 	if (num == BLOCK_NULL)
 		return;
 		
-	/* 
-	 * Remember free disk block to
-	 * speedup next block allocation.
-	 */
-	if (num < sb->zsearch)
-		sb->zsearch = num;
+	if (num < sb->zones)
+		sb->gzfree[ZONE_GROUP(sb, num)]++;
 	
 	num -= sb->first_data_block;
 	
@@ -130,7 +256,8 @@ PRIVATE void block_free_direct(struct superblock *sb, block_t num)
 	
 	/* Free disk block. */
 	bitmap_clear(sb->zmap[idx]->data, off);
-	sb->zmap[idx]->flags |= BUFFER_DIRTY;
+	journal_dirty(sb, sb->zmap[idx]);
+	sb->zfree++;
 	sb->flags |= SUPERBLOCK_DIRTY;
 }
 
@@ -185,6 +312,9 @@ PRIVATE void block_free_dindirect(struct superblock *sb, block_t num)
 		return;
 	
 	buf = bread(sb->dev, num);
+	
+	/* Read all single indirect blocks at once. */
+	bread_vec(sb->dev, (block_t *)buf->data, NR_SINGLE, NULL);
 		
 	/* Free direct zone. */
 	for (i = 0; i < NR_SINGLE; i++)
@@ -206,7 +336,7 @@ PRIVATE void block_free_dindirect(struct superblock *sb, block_t num)
  * 
  * @note The superblock must be locked.
  */
-PUBLIC void block_free(struct superblock *sb, block_t num, int lvl)
+PRIVATE void block_free_now(struct superblock *sb, block_t num, int lvl)
 {
 	/* Free disk block. */
 	switch (lvl)
@@ -232,19 +362,325 @@ PUBLIC void block_free(struct superblock *sb, block_t num, int lvl)
 	}
 }
 
+/**
+ * @brief Applies deferred block frees.
+ * 
+ * @details Gives back to the bitmap of blocks all deferred frees that lie in
+ *          the file system of the superblock pointed to by @p sb. Frees are
+ *          applied in ascending block order, so that runs hitting the same
+ *          bitmap block are batched together.
+ * 
+ * @param sb Superblock whose deferred frees shall be applied.
+ * 
+ * @returns The number of deferred frees that were applied.
+ * 
+ * @note The superblock must be locked.
+ */
+PRIVATE int block_apply(struct superblock *sb)
+{
+	int n;        /* Frees applied.  */
+	int lvl;      /* Indirection.    */
+	block_t num;  /* Block number.   */
+	unsigned i;   /* Loop index.     */
+	unsigned min; /* Lowest pending. */
+	
+	n = 0;
+	
+	/*
+	 * No new frees for this file system get queued
+	 * while we hold its superblock locked, but other
+	 * ones may, because reading indirect blocks sleeps.
+	 */
+	while (1)
+	{
+		/* Look for the lowest deferred free. */
+		min = npending;
+		for (i = 0; i < npending; i++)
+		{
+			if (pending[i].sb != sb)
+				continue;
+			
+			if ((min == npending) || (pending[i].num < pending[min].num))
+				min = i;
+		}
+		
+		/* Done. */
+		if (min == npending)
+			break;
+		
+		num = pending[min].num;
+		lvl = pending[min].lvl;
+		pending[min] = pending[--npending];
+		
+		block_free_now(sb, num, lvl);
+		
+		/* Drop the reference held by the queue. */
+		sb->count--;
+		n++;
+		
+		/* Large truncations take a while. */
+		resched();
+	}
+	
+	return (n);
+}
+
+/**
+ * @brief Frees a disk block.
+ * 
+ * @details Queues the disk block @p num, and all underlying disk blocks, to be
+ *          freed later on by block_sync(). If the queue is full, the disk
+ *          block is freed right away.
+ * 
+ * @param sb  Superblock in which the disk block should be freed.
+ * @param num Number of the disk block that shall be freed.
+ * @param lvl Level of indirection to be parsed: zero for direct blocks, one for
+ *        single indirect blocks, and two for doubly indirect blocks.
+ * 
+ * @note The superblock must be locked.
+ */
+PUBLIC void block_free(struct superblock *sb, block_t num, int lvl)
+{
+	/* Nothing to be done. */
+	if (num == BLOCK_NULL)
+		return;
+	
+	/* Queue is full. */
+	if (npending == NR_FREE_PENDING)
+	{
+		block_free_now(sb, num, lvl);
+		bdflush_wakeup();
+		return;
+	}
+	
+	/* Keep the file system around. */
+	sb->count++;
+	
+	pending[npending].sb = sb;
+	pending[npending].num = num;
+	pending[npending].lvl = lvl;
+	npending++;
+}
+
+/**
+ * @brief Applies all deferred block frees.
+ * 
+ * @details Gives back to the bitmap of blocks all disk blocks that have been
+ *          queued by block_free(). This is called from the buffer flusher
+ *          daemon and before the block buffer cache is synchronized.
+ */
+PUBLIC void block_sync(void)
+{
+	struct superblock *sb;
+	
+	while (npending > 0)
+	{
+		superblock_lock(sb = pending[0].sb);
+		block_apply(sb);
+		superblock_unlock(sb);
+	}
+}
+
+/**
+ * @brief Trims the preallocation window of a file.
+ * 
+ * @details Gives back to the file system the disk blocks that were reserved
+ *          to the file pointed to by @p ip but not used.
+ * 
+ * @param ip File whose preallocation window shall be trimmed.
+ * 
+ * @note @p ip must be locked.
+ * @note The superblock must not be locked.
+ */
+PUBLIC void block_trim(struct inode *ip)
+{
+	/* Nothing to be done. */
+	if (ip->pa_count == 0)
+		return;
+	
+	superblock_lock(ip->sb);
+	
+	while (ip->pa_count > 0)
+	{
+		block_free_direct(ip->sb, ip->pa_start++);
+		ip->pa_count--;
+	}
+	
+	superblock_unlock(ip->sb);
+}
+
+/**
+ * @brief Reserves zones to a delayed write.
+ * 
+ * @details Reserves to the file pointed to by @p ip the zones that a newly
+ *          delayed block may need once it gets allocated. The first delayed
+ *          block of the file reserves an extra zone, which covers the single
+ *          indirect block.
+ * 
+ * @param ip File to which the zones shall be reserved.
+ * 
+ * @returns Upon successful completion, zero is returned. If there are not
+ *          enough free zones, non-zero is returned instead.
+ * 
+ * @note @p ip must be locked.
+ * @note The superblock must not be locked.
+ */
+PUBLIC int block_reserve(struct inode *ip)
+{
+	unsigned need;         /* Zones needed. */
+	struct superblock *sb; /* Superblock.   */
+	
+	need = (ip->ndelay == 0) ? 2 : 1;
+	
+	superblock_lock(sb = ip->sb);
+	
+	/* Not enough free zones. */
+	while (sb->zfree < sb->zdelay + need)
+	{
+		/* Give deferred frees back and retry. */
+		if (!block_apply(sb))
+		{
+			superblock_unlock(sb);
+			return (-1);
+		}
+	}
+	
+	if (ip->ndelay == 0)
+		ip->delay_time = ticks;
+	
+	sb->zdelay += need;
+	ip->ndelay += need;
+	
+	superblock_unlock(sb);
+	
+	return (0);
+}
+
+/**
+ * @brief Cancels a reservation made by block_reserve().
+ * 
+ * @param ip File whose last reservation shall be canceled.
+ * 
+ * @note @p ip must be locked.
+ * @note The superblock must not be locked.
+ */
+PUBLIC void block_unreserve(struct inode *ip)
+{
+	unsigned n; /* Zones given back. */
+	
+	n = (ip->ndelay == 2) ? 2 : 1;
+	
+	superblock_lock(ip->sb);
+	ip->sb->zdelay -= n;
+	ip->ndelay -= n;
+	superblock_unlock(ip->sb);
+}
+
+/**
+ * @brief Releases all zones reserved to delayed writes of a file.
+ * 
+ * @param ip File whose reservation shall be released.
+ * 
+ * @note @p ip must be locked.
+ * @note The superblock must not be locked.
+ */
+PUBLIC void block_release(struct inode *ip)
+{
+	/* Nothing to be done. */
+	if (ip->ndelay == 0)
+		return;
+	
+	superblock_lock(ip->sb);
+	ip->sb->zdelay -= ip->ndelay;
+	ip->ndelay = 0;
+	superblock_unlock(ip->sb);
+}
+
+/**
+ * @brief Maps an entry of an indirect block in a disk block number.
+ * 
+ * @details Looks up the entry @p idx of the indirect block numbered @p ind of
+ *          the file pointed to by @p ip. If @p create is not zero and the
+ *          entry is empty, a disk block is allocated for it. The run of
+ *          contiguous blocks that starts at the entry is cached in the inode,
+ *          as the translation of logical block @p logic past the direct
+ *          zones, so that sequential translations skip the indirect block.
+ * 
+ * @param ip     File to use.
+ * @param ind    Indirect block number.
+ * @param idx    Entry in the indirect block.
+ * @param logic  Logical block number past the direct zones.
+ * @param create Create entry?
+ * 
+ * @returns The disk block number held in the entry, or #BLOCK_NULL if none.
+ * 
+ * @note @p ip must be locked.
+ */
+PRIVATE block_t block_map_indirect
+(struct inode *ip, block_t ind, block_t idx, block_t logic, int create)
+{
+	block_t phys;       /* Physical block number. */
+	block_t goal;       /* Allocation goal.       */
+	struct buffer *buf; /* Underlying buffer.     */
+	
+	buf = bread(ip->dev, ind);
+	
+	/* Create direct block. */
+	if (((block_t *)buf->data)[idx] == BLOCK_NULL && create)
+	{
+		/* Follow previous block. */
+		goal = ip->goal;
+		if ((idx > 0) && (((block_t *)buf->data)[idx - 1] != BLOCK_NULL))
+			goal = ((block_t *)buf->data)[idx - 1] + 1;
+		
+		superblock_lock(ip->sb);
+		phys = block_alloc(ip, goal);
+		superblock_unlock(ip->sb);
+		
+		if (phys != BLOCK_NULL)
+		{
+			((block_t *)buf->data)[idx] = phys;
+			ip->goal = phys + 1;
+			journal_attach(buf, ip);
+			inode_touch(ip);
+		}
+	}
+	
+	/*
+	 * Cache the run of contiguous blocks
+	 * that starts here, so that sequential
+	 * translations skip the indirect block.
+	 */
+	if ((phys = ((block_t *)buf->data)[idx]) != BLOCK_NULL)
+	{
+		ip->map_logic = logic;
+		ip->map_phys = phys;
+		ip->map_len = 1;
+		while ((idx + ip->map_len < NR_SINGLE) &&
+			(((block_t *)buf->data)[idx + ip->map_len] == phys + ip->map_len))
+			ip->map_len++;
+	}
+	
+	brelse(buf);
+	
+	return (phys);
+}
+
 /**
  * @brief Maps a file byte offset in a disk block number.
  * 
  * @details Maps the offset @p off in the file pointed to by @p ip in a disk
  *          block number. If @p create is not zero and such file by offset is
  *          invalid, the file is expanded accordingly to make it valid.
+ *          Otherwise, holes of sparse files are left unallocated.
  * 
  * @param ip     File to use
  * @param off    File byte offset.
  * @param create Create offset?
  * 
  * @returns Upon successful completion, the disk block number that is associated
- *          with the file byte offset is returned. Upon failure, #BLOCK_NULL is
+ *          with the file byte offset is returned. Upon failure, or if the
+ *          offset lies in a hole and @p create is zero, #BLOCK_NULL is
  *          returned instead.
  * 
  * @note @p ip must be locked.
@@ -253,6 +689,8 @@ PUBLIC block_t block_map(struct inode *ip, off_t off, int create)
 {
 	block_t phys;       /* Physical block number. */
 	block_t logic;      /* Logical block number.  */
+	block_t goal;       /* Allocation goal.       */
+	block_t idx;        /* Double indirect entry. */
 	struct buffer *buf; /* Underlying buffer.     */
 	
 	logic = off/BLOCK_SIZE;
@@ -264,26 +702,26 @@ PUBLIC block_t block_map(struct inode *ip, off_t off, int create)
 		return (BLOCK_NULL);
 	}
 	
-	/* 
-	 * Create blocks that are
-	 * in a valid offset.
-	 */
-	if (off < ip->size)
-		create = 1;
-	
 	/* Direct block. */
 	if (logic < NR_ZONES_DIRECT)
 	{
 		/* Create direct block. */
 		if (ip->blocks[logic] == BLOCK_NULL && create)
 		{
+			/* Follow previous block. */
+			goal = ip->goal;
+			if ((logic > 0) && (ip->blocks[logic - 1] != BLOCK_NULL))
+				goal = ip->blocks[logic - 1] + 1;
+			
 			superblock_lock(ip->sb);
-			phys = block_alloc(ip->sb);
+			phys = block_alloc(ip, goal);
 			superblock_unlock(ip->sb);
 			
 			if (phys != BLOCK_NULL)
 			{
 				ip->blocks[logic] = phys;
+				ip->goal = phys + 1;
+				ip->flags |= INODE_LAYOUT;
 				inode_touch(ip);
 			}
 		}
@@ -293,6 +731,11 @@ PUBLIC block_t block_map(struct inode *ip, off_t off, int create)
 	
 	logic -= NR_ZONES_DIRECT;
 	
+	/* Cached translation. */
+	if ((logic >= ip->map_logic) &&
+		((unsigned)(logic - ip->map_logic) < ip->map_len))
+		return (ip->map_phys + (logic - ip->map_logic));
+	
 	/* Single indirect block. */
 	if (logic < NR_SINGLE)
 	{
@@ -300,12 +743,14 @@ PUBLIC block_t block_map(struct inode *ip, off_t off, int create)
 		if (ip->blocks[ZONE_SINGLE] == BLOCK_NULL && create)
 		{
 			superblock_lock(ip->sb);
-			phys = block_alloc(ip->sb);
+			phys = block_alloc(ip, ip->goal);
 			superblock_unlock(ip->sb);
 			
 			if (phys != BLOCK_NULL)
 			{
 				ip->blocks[ZONE_SINGLE] = phys;
+				ip->goal = phys + 1;
+				ip->flags |= INODE_LAYOUT;
 				inode_touch(ip);
 			}
 		}
@@ -313,35 +758,73 @@ PUBLIC block_t block_map(struct inode *ip, off_t off, int create)
 		/* We cannot go any further. */
 		if ((phys = ip->blocks[ZONE_SINGLE]) == BLOCK_NULL)
 			return (BLOCK_NULL);
+		
+		return (block_map_indirect(ip, phys, logic, logic, create));
+	}
+	
+	idx = (logic - NR_SINGLE)/NR_SINGLE;
 	
+	/*
+	 * Indirect block under the double indirect
+	 * one is cached too, so that translations
+	 * within it take a single block read.
+	 */
+	if ((ip->map_ind != BLOCK_NULL) && (ip->map_dind == idx))
+		phys = ip->map_ind;
+	
+	else
+	{
+		/* Create double indirect block. */
+		if (ip->blocks[ZONE_DOUBLE] == BLOCK_NULL && create)
+		{
+			superblock_lock(ip->sb);
+			phys = block_alloc(ip, ip->goal);
+			superblock_unlock(ip->sb);
+			
+			if (phys != BLOCK_NULL)
+			{
+				ip->blocks[ZONE_DOUBLE] = phys;
+				ip->goal = phys + 1;
+				ip->flags |= INODE_LAYOUT;
+				inode_touch(ip);
+			}
+		}
+		
+		/* We cannot go any further. */
+		if ((phys = ip->blocks[ZONE_DOUBLE]) == BLOCK_NULL)
+			return (BLOCK_NULL);
+		
 		buf = bread(ip->dev, phys);
 		
-		/* Create direct block. */
-		if (((block_t *)buf->data)[logic] == BLOCK_NULL && create)
+		/* Create single indirect block. */
+		if (((block_t *)buf->data)[idx] == BLOCK_NULL && create)
 		{
 			superblock_lock(ip->sb);
-			phys = block_alloc(ip->sb);
+			phys = block_alloc(ip, ip->goal);
 			superblock_unlock(ip->sb);
 			
 			if (phys != BLOCK_NULL)
 			{
-				((block_t *)buf->data)[logic] = phys;
-				buf->flags |= BUFFER_DIRTY;
+				((block_t *)buf->data)[idx] = phys;
+				ip->goal = phys + 1;
+				journal_attach(buf, ip);
 				inode_touch(ip);
 			}
 		}
 		
+		phys = ((block_t *)buf->data)[idx];
 		brelse(buf);
 		
-		return (((block_t *)buf->data)[logic]);
+		/* We cannot go any further. */
+		if (phys == BLOCK_NULL)
+			return (BLOCK_NULL);
+		
+		ip->map_dind = idx;
+		ip->map_ind = phys;
 	}
 	
-	logic -= NR_SINGLE;
-	
-	/* Double indirect zone. */
-	kpanic("double indirect zones not supported yet");
-	
-	return (BLOCK_NULL);
+	return (block_map_indirect(ip, phys,
+		(logic - NR_SINGLE)%NR_SINGLE, logic, create));
 }
 
 /**@}*/
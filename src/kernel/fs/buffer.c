@@ -17,25 +17,43 @@
  * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <nanvix/clock.h>
+#include <nanvix/config.h>
 #include <nanvix/const.h>
 #include <nanvix/dev.h>
 #include <nanvix/fs.h>
 #include <nanvix/hal.h>
 #include <nanvix/klib.h>
+#include <nanvix/ktrace.h>
 #include <nanvix/mm.h>
 #include <nanvix/pm.h>
+#include <nanvix/spinlock.h>
+#include <sys/cachestat.h>
 #include "fs.h"
 
+/**
+ * @brief Number of block buffers in the fixed buffer area.
+ */
+#define NR_BUFFERS (BUFFERS_SIZE/BLOCK_SIZE)
+
 /*
- * Too many buffers. The maximum value depends on
+ * Buffer area too large. The maximum value depends on
  * the amount of memory that is reserved to buffer
  * data. If you wanna change this, you shall take
  * a look on <nanvix/mm.h>
  */
-#if (NR_BUFFERS > 512)
+#if (BUFFERS_SIZE > 0x80000)
 	#error "too many buffers"
 #endif
 
+/*
+ * Block buffers borrowed from the kernel
+ * page pool shall not straddle pages.
+ */
+#if (BLOCK_SIZE > PAGE_SIZE)
+	#error "block size too large"
+#endif
+
 /*
  * Number of buffers should be great enough so that
  * the superblock, the inode map and the free blocks
@@ -48,32 +66,141 @@
 #endif
 
 /**
- * @brief Hash table size of the block buffer cache.
+ * @brief Maximum number of block buffers.
+ * 
+ * @details The first NR_BUFFERS block buffers have their data in the fixed
+ *          buffer area, and the remaining ones in pages borrowed from the
+ *          kernel page pool at system startup.
+ */
+#define NR_BUFFERS_MAX 2048
+
+/**
+ * @brief Share of memory given to the block buffer cache (1/n).
  */
-#define BUFFERS_HASHTAB_SIZE 53
+#define BUFFERS_MEM_SHARE 32
+
+/**
+ * @brief Maximum hash table size of the block buffer cache.
+ */
+#define BUFFERS_HASHTAB_MAX 769
 
 /**
  * @brief Block buffers.
  */
-PRIVATE struct buffer buffers[NR_BUFFERS];
+PRIVATE struct buffer buffers[NR_BUFFERS_MAX];
+
+/**
+ * @brief Number of block buffers.
+ */
+PRIVATE unsigned nr_buffers = 0;
+
+/**
+ * @brief Hash table size of the block buffer cache.
+ */
+PRIVATE unsigned nr_hash = 0;
 
 /**
  * @brief List of free block buffers.
+ * 
+ * @details When the scan-resistant replacement policy is enabled, this is the
+ *          A1 queue, holding block buffers that have been referenced only
+ *          once recently.
  */
 PRIVATE struct buffer free_buffers;
 
+#if (BUFFERS_2Q)
+
+/**
+ * @brief Maximum number of block buffers in the A1 queue.
+ */
+#define NR_COLD_MAX (nr_buffers/4)
+
+/**
+ * @brief Number of block numbers remembered after eviction from A1.
+ */
+#define NR_GHOSTS (nr_buffers/2)
+
+/**
+ * @brief List of free frequently used block buffers (Am queue).
+ */
+PRIVATE struct buffer hot_buffers;
+
+/**
+ * @brief Number of block buffers (free or not) in the A1 queue.
+ */
+PRIVATE unsigned ncold = 0;
+
+/**
+ * @brief Null slot in the A1out queue.
+ */
+#define GHOST_NULL 0xffff
+
+/**
+ * @brief Blocks recently evicted from the A1 queue (A1out queue).
+ */
+PRIVATE struct
+{
+	dev_t dev;      /**< Device.             */
+	block_t num;    /**< Block number.       */
+	uint16_t hnext; /**< Next in hash chain. */
+} ghosts[NR_BUFFERS_MAX/2];
+
+/**
+ * @brief Hash table of the A1out queue.
+ * 
+ * @details Uses the same hash function, and size, as the block buffer hash
+ *          table, so that looking up a block that misses the cache does not
+ *          take a scan of the A1out queue.
+ */
+PRIVATE uint16_t ghost_hash[BUFFERS_HASHTAB_MAX];
+
+/**
+ * @brief Next slot in the A1out queue.
+ */
+PRIVATE unsigned ghost_next = 0;
+
+#endif
+
 /**
  * @brief Processes waiting for any block.
  * 
  * @details Chain of processes that are sleeping, waiting for any block to
  *          become free.
  */
-PRIVATE struct process *chain = NULL;
+PRIVATE struct waitq chain = WAITQ_INITIALIZER;
+
+/**
+ * @brief Buffer flusher daemon.
+ * 
+ * @details Chain where the buffer flusher daemon sleeps, waiting for dirty
+ *          block buffers to write back.
+ */
+PRIVATE struct waitq bdflush_chain = WAITQ_INITIALIZER;
+
+/**
+ * @brief Number of dirty block buffers.
+ */
+PRIVATE unsigned ndirty = 0;
+
+/**
+ * @brief Lock for the dirty count and the per-file dirty lists.
+ */
+PRIVATE struct spinlock dirty_lock = SPINLOCK_INITIALIZER;
+
+/**
+ * @brief Block buffer cache statistics.
+ */
+PRIVATE struct cachestat stats;
+
+/**
+ * @brief Maximum number of dirty buffers before the flusher is awaken.
+ */
+#define NR_DIRTY_MAX ((nr_buffers*BDFLUSH_RATIO)/100)
 
 /**
  * @brief block buffer hash table.
  */
-PRIVATE struct buffer hashtab[BUFFERS_HASHTAB_SIZE];
+PRIVATE struct buffer hashtab[BUFFERS_HASHTAB_MAX];
 
 
 /**
@@ -83,7 +210,214 @@ PRIVATE struct buffer hashtab[BUFFERS_HASHTAB_SIZE];
  *          table slot.
  */
 #define HASH(dev, block) \
-	(((dev)^(block))%BUFFERS_HASHTAB_SIZE)
+	(((dev)^(block))%nr_hash)
+
+/**
+ * @brief Removes a block buffer from the free list.
+ * 
+ * @param buf Block buffer to be removed.
+ */
+PRIVATE inline void free_remove(struct buffer *buf)
+{
+	buf->free_prev->free_next = buf->free_next;
+	buf->free_next->free_prev = buf->free_prev;
+}
+
+/**
+ * @brief Inserts a block buffer in a free list.
+ * 
+ * @param head Head of the free list.
+ * @param buf  Block buffer to be inserted.
+ * @param tail Insert in the end of the list?
+ */
+PRIVATE void free_insert(struct buffer *head, struct buffer *buf, int tail)
+{
+	/* Frequently used buffer (insert in the end). */
+	if (tail)
+	{	
+		head->free_prev->free_next = buf;
+		buf->free_prev = head->free_prev;
+		head->free_prev = buf;
+		buf->free_next = head;
+	}
+		
+	/* Not frequently used buffer (insert in the begin). */
+	else
+	{	
+		head->free_next->free_prev = buf;
+		buf->free_prev = head;
+		buf->free_next = head->free_next;
+		head->free_next = buf;
+	}
+}
+
+/**
+ * @brief Chooses a free block buffer to be reused.
+ * 
+ * @details With the scan-resistant replacement policy, block buffers are
+ *          taken from the A1 queue while it is over its share of the block
+ *          buffer cache, or when there are no free buffers in the Am queue.
+ *          Thus, blocks that are read only once, as in a sequential scan, do
+ *          not flush frequently used ones.
+ * 
+ * @returns A free block buffer, or NULL if there is none.
+ * 
+ * @note Interrupts must be disabled.
+ */
+PRIVATE struct buffer *free_victim(void)
+{
+	struct buffer *buf; /* Buffer. */
+	
+	buf = free_buffers.free_next;
+	
+#if (BUFFERS_2Q)
+	
+	/* Keep A1 queue small. */
+	if ((buf == &free_buffers) || (ncold <= NR_COLD_MAX))
+	{
+		if (hot_buffers.free_next != &hot_buffers)
+			buf = hot_buffers.free_next;
+	}
+	
+#endif
+	
+	return ((buf == &free_buffers) ? NULL : buf);
+}
+
+#if (BUFFERS_2Q)
+
+/**
+ * @brief Takes a slot of the A1out queue out of its hash chain.
+ * 
+ * @param i Slot index.
+ * 
+ * @note Interrupts must be disabled.
+ */
+PRIVATE void ghost_remove(unsigned i)
+{
+	uint16_t *p; /* Working link. */
+	
+	p = &ghost_hash[HASH(ghosts[i].dev, ghosts[i].num)];
+	for (/* noop */; *p != GHOST_NULL; p = &ghosts[*p].hnext)
+	{
+		if (*p == i)
+		{
+			*p = ghosts[i].hnext;
+			break;
+		}
+	}
+	
+	ghosts[i].dev = 0;
+	ghosts[i].num = 0;
+}
+
+/**
+ * @brief Remembers a block evicted from the A1 queue.
+ * 
+ * @details The block takes the oldest slot of the A1out queue.
+ * 
+ * @param dev Device number.
+ * @param num Block number.
+ * 
+ * @note Interrupts must be disabled.
+ */
+PRIVATE void ghost_insert(dev_t dev, block_t num)
+{
+	unsigned h; /* Hash chain. */
+	
+	ghost_remove(ghost_next);
+	
+	h = HASH(dev, num);
+	ghosts[ghost_next].dev = dev;
+	ghosts[ghost_next].num = num;
+	ghosts[ghost_next].hnext = ghost_hash[h];
+	ghost_hash[h] = ghost_next;
+	
+	ghost_next = (ghost_next + 1)%NR_GHOSTS;
+}
+
+/**
+ * @brief Looks up and forgets a block in the A1out queue.
+ * 
+ * @param dev Device number.
+ * @param num Block number.
+ * 
+ * @returns Non-zero if the block was evicted from the A1 queue recently, and
+ *          zero otherwise.
+ * 
+ * @note Interrupts must be disabled.
+ */
+PRIVATE int ghost_find(dev_t dev, block_t num)
+{
+	unsigned i; /* Slot index. */
+	
+	for (i = ghost_hash[HASH(dev, num)]; i != GHOST_NULL; i = ghosts[i].hnext)
+	{
+		if ((ghosts[i].dev == dev) && (ghosts[i].num == num))
+		{
+			ghost_remove(i);
+			return (1);
+		}
+	}
+	
+	return (0);
+}
+
+/**
+ * @brief Empties the A1out queue.
+ * 
+ * @note Interrupts must be disabled.
+ */
+PRIVATE void ghost_clear(void)
+{
+	for (unsigned i = 0; i < nr_hash; i++)
+		ghost_hash[i] = GHOST_NULL;
+	
+	for (unsigned i = 0; i < NR_GHOSTS; i++)
+	{
+		ghosts[i].dev = 0;
+		ghosts[i].num = 0;
+	}
+}
+
+/**
+ * @brief Sets the replacement queue of a block buffer being reassigned.
+ * 
+ * @details Remembers the block held by the block buffer pointed to by buf if
+ *          it is evicted from the A1 queue, and then places the buffer in the
+ *          Am queue if its new block, the one numbered num on the device dev,
+ *          has been evicted from A1 recently. Otherwise, the buffer goes to
+ *          the A1 queue.
+ * 
+ * @param buf Block buffer to be reassigned.
+ * @param dev Device number.
+ * @param num Block number.
+ * 
+ * @note Interrupts must be disabled.
+ */
+PRIVATE void buffer_requeue(struct buffer *buf, dev_t dev, block_t num)
+{
+	/* Remember evicted block, unless it was used once. */
+	if (!(buf->flags & BUFFER_HOT))
+	{
+		ncold--;
+		
+		if ((buf->flags & (BUFFER_VALID | BUFFER_ONCE)) == BUFFER_VALID)
+			ghost_insert(buf->dev, buf->num);
+	}
+	
+	/* Block was evicted recently. */
+	if (ghost_find(dev, num))
+	{
+		buf->flags |= BUFFER_HOT;
+		return;
+	}
+	
+	buf->flags &= ~BUFFER_HOT;
+	ncold++;
+}
+
+#endif
 
 /**
  * @brief Gets a block buffer from the block buffer cache.
@@ -101,12 +435,15 @@ PRIVATE struct buffer hashtab[BUFFERS_HASHTAB_SIZE];
  */
 PRIVATE struct buffer *getblk(dev_t dev, block_t num)
 {
-	unsigned i;         /* Hash table index. */
-	struct buffer *buf; /* Buffer.           */
+	unsigned i;         /* Hash table index.         */
+	int waited;         /* Waited for a free buffer? */
+	struct buffer *buf; /* Buffer.                   */
 	
 	/* Should not happen. */
 	if ((dev == 0) && (num == 0))
 		kpanic("getblk(0, 0)");
+	
+	waited = 0;
 
 repeat:
 
@@ -127,17 +464,27 @@ repeat:
 		 */
 		if (buf->flags & BUFFER_LOCKED)
 		{
-			sleep(&buf->chain, PRIO_BUFFER);
+			stats.waits++;
+			buf->waits++;
+			lock_wait(LOCK_BUFFER, buf->holder, PRIO_BUFFER);
+			sleep_excl(&buf->chain, PRIO_BUFFER);
 			goto repeat;
 		}
 		
 		/* Remove buffer from the free list. */
 		if (buf->count++ == 0)
-		{
-			buf->free_prev->free_next = buf->free_next;
-			buf->free_next->free_prev = buf->free_prev;
-		}
+			free_remove(buf);
+		buf->flags &= ~BUFFER_ONCE;
+		
+		/*
+		 * We were awaken for a free buffer that
+		 * we don't need, so pass it on.
+		 */
+		if ((waited) && (free_victim() != NULL))
+			wakeup_one(&chain);
 		
+		stats.hits++;
+		ktrace(KTRACE_BHIT, dev, num);
 		blklock(buf);
 		enable_interrupts();
 		
@@ -148,17 +495,17 @@ repeat:
 	 * There are no free buffers so we need to
 	 * wait for one to become free.
 	 */
-	if (&free_buffers == free_buffers.free_next)
+	if ((buf = free_victim()) == NULL)
 	{
 		kprintf("fs: no free buffers");
-		sleep(&chain, PRIO_BUFFER);
+		stats.waits++;
+		sleep_excl(&chain, PRIO_BUFFER);
+		waited = 1;
 		goto repeat;
 	}
 	
 	/* Remove buffer from the free list. */
-	buf = free_buffers.free_next;
-	buf->free_prev->free_next = buf->free_next;
-	buf->free_next->free_prev = buf->free_prev;
+	free_remove(buf);
 	buf->count++;
 	
 	/* 
@@ -177,10 +524,44 @@ repeat:
 	buf->hash_prev->hash_next = buf->hash_next;
 	buf->hash_next->hash_prev = buf->hash_prev;
 	
+#if (BUFFERS_2Q)
+	buffer_requeue(buf, dev, num);
+#endif
+	
+	stats.misses++;
+	ktrace(KTRACE_BMISS, dev, num);
+	if (buf->flags & BUFFER_VALID)
+	{
+		stats.evictions++;
+		ktrace(KTRACE_BEVICT, buf->dev, buf->num);
+#if (BCACHE)
+		/* Demote block. */
+		if (!(buf->flags & (BUFFER_DIRECT | BUFFER_ONCE)))
+			bcache_put(buf);
+#endif
+	}
+	
 	/* Reassign device and block number. */
 	buf->dev = dev;
 	buf->num = num;
-	buf->flags &= ~BUFFER_VALID;
+	buf->waits = 0;
+	buf->flags &= ~(BUFFER_VALID | BUFFER_ASYNC | BUFFER_ONCE);
+	
+	/*
+	 * Blocks of directly accessible devices
+	 * are used in place instead of copied.
+	 */
+	if ((buf->data = bdev_direct(dev, num)) != NULL)
+		buf->flags |= BUFFER_DIRECT;
+	else
+	{
+		buf->data = buf->mem;
+		buf->flags &= ~BUFFER_DIRECT;
+#if (BCACHE)
+		if (bcache_get(buf))
+			buf->flags |= BUFFER_VALID;
+#endif
+	}
 	
 	/* Place buffer in a new hash queue. */
 	hashtab[i].hash_next->hash_prev = buf;
@@ -209,9 +590,16 @@ PUBLIC void blklock(struct buffer *buf)
 	
 	/* Wait for block buffer to become unlocked. */
 	while (buf->flags & BUFFER_LOCKED)
-		sleep(&buf->chain, PRIO_BUFFER);
+	{
+		stats.waits++;
+		buf->waits++;
+		lock_wait(LOCK_BUFFER, buf->holder, PRIO_BUFFER);
+		sleep_excl(&buf->chain, PRIO_BUFFER);
+	}
 		
 	buf->flags |= BUFFER_LOCKED;
+	buf->holder = curr_proc;
+	lock_acquire(LOCK_BUFFER);
 
 	enable_interrupts();
 }
@@ -220,7 +608,10 @@ PUBLIC void blklock(struct buffer *buf)
  * @brief Unlocks a block buffer.
  * 
  * @details Unlocks the block buffer pointed to by buf by marking it as not
- *          locked and waking up all processes that were waiting for it.
+ *          locked and waking up the process that has been waiting longer for
+ *          it. Since that process either locks the block buffer, or finds it
+ *          reassigned to another block by someone who will unlock it later,
+ *          the remaining waiters are awaken one at a time.
  *
  * @param buf Block buffer to be unlocked.
  * 
@@ -230,8 +621,10 @@ PUBLIC void blkunlock(struct buffer *buf)
 {
 	disable_interrupts();
 
+	lock_release(buf->holder);
+	buf->holder = NULL;
 	buf->flags &= ~BUFFER_LOCKED;
-	wakeup(&buf->chain);
+	wakeup_one(&buf->chain);
 
 	enable_interrupts();
 }
@@ -248,6 +641,8 @@ PUBLIC void blkunlock(struct buffer *buf)
  */
 PUBLIC void brelse(struct buffer *buf)
 {
+	struct buffer *head; /* Free list. */
+	
 	disable_interrupts();
 	
 	/* Double free. */
@@ -258,28 +653,22 @@ PUBLIC void brelse(struct buffer *buf)
 	if (--buf->count == 0)
 	{
 		/*
-		 * Wakeup processes that were waiting
+		 * Wakeup a process that was waiting
 		 * for any block to become free.
 		 */
-		wakeup(&chain);
+		wakeup_one(&chain);
 					
-		/* Frequently used buffer (insert in the end). */
-		if ((buf->flags & BUFFER_VALID) && (buf->flags & BUFFER_DIRTY))
-		{	
-			free_buffers.free_prev->free_next = buf;
-			buf->free_prev = free_buffers.free_prev;
-			free_buffers.free_prev = buf;
-			buf->free_next = &free_buffers;
-		}
-			
-		/* Not frequently used buffer (insert in the begin). */
-		else
-		{	
-			free_buffers.free_next->free_prev = buf;
-			buf->free_prev = &free_buffers;
-			buf->free_next = free_buffers.free_next;
-			free_buffers.free_next = buf;
-		}
+		head = &free_buffers;
+		
+#if (BUFFERS_2Q)
+		/* Frequently used buffer. */
+		if ((buf->flags & BUFFER_HOT) && (buf->flags & BUFFER_VALID))
+			head = &hot_buffers;
+#endif
+		
+		/* Blocks used once are reused first. */
+		free_insert(head, buf,
+			(buf->flags & (BUFFER_VALID | BUFFER_ONCE)) == BUFFER_VALID);
 	}
 
 	blkunlock(buf);
@@ -287,85 +676,398 @@ PUBLIC void brelse(struct buffer *buf)
 }
 
 /**
- * @brief Reads a block from a device.
+ * @brief Gets a block buffer without reading it from a device.
  * 
- * @details Reads the block numbered num synchronously from the device numbered
- *          dev.
+ * @details Gets a block buffer for the block numbered num of the device
+ *          numbered dev, and marks it as valid without reading it. This is
+ *          meant for callers that overwrite the whole block, so the previous
+ *          contents of the block are not read from the device in vain.
  * 
  * @param dev Device number.
  * @param num Block number.
  * 
- * @returns Upon successful completion, a pointer to a buffer holding the
- *          requested block is returned. In this case, the block buffer is 
- *          ensured to be locked. Upon failure, a NULL pointer is returned
- *          instead.
+ * @returns A pointer to a buffer for the requested block. The block buffer is
+ *          ensured to be locked, and its contents are undefined unless the
+ *          block was cached.
  * 
  * @note The device number should be valid.
  * @note The block number should be valid.
  */
-PUBLIC struct buffer *bread(dev_t dev, block_t num)
+PUBLIC struct buffer *bget(dev_t dev, block_t num)
 {
 	struct buffer *buf;
 	
 	buf = getblk(dev, num);
 	
-	/* Valid buffer? */
-	if (buf->flags & BUFFER_VALID)
-		return (buf);
-
-	bdev_readblk(buf);
-	
-	/* Update buffer flags. */
 	buf->flags |= BUFFER_VALID;
-	buf->flags &= ~BUFFER_DIRTY;
 	
 	return (buf);
 }
 
 /**
- * @brief Writes a block buffer to the underlying device.
+ * @brief Gets a block only if it is cached.
  * 
- * @details Writes the block buffer pointed to by buf asynchronously to the
- *          underlying device. After that the operation has completed, the
- *          buffer is released.
+ * @details Looks up the block numbered num of the device numbered dev in the
+ *          block buffer cache, without reading it from the device.
  * 
- * @param buf Block buffer to be written back.
+ * @param dev Device number.
+ * @param num Block number.
  * 
- * @note The block buffer must be locked.
+ * @returns If the block is cached, a pointer to its buffer is returned. In
+ *          this case, the block buffer is ensured to be locked. Otherwise, a
+ *          NULL pointer is returned.
+ * 
+ * @note The device number should be valid.
+ * @note The block number should be valid.
  */
-PUBLIC void bwrite(struct buffer *buf)
-{	
-	/*
-	 * We don't have to write back the buffer
-	 * to disk, so we just release it and we are done.
-	 */
-	if (!(buf->flags & BUFFER_DIRTY))
+PUBLIC struct buffer *bcached(dev_t dev, block_t num)
+{
+	unsigned i;         /* Hash table index. */
+	struct buffer *buf; /* Buffer.           */
+	
+	i = HASH(dev, num);
+	
+	disable_interrupts();
+	
+	for (buf = hashtab[i].hash_next; buf != &hashtab[i]; buf = buf->hash_next)
 	{
-		brelse(buf);
-		return;
+		if ((buf->dev == dev) && (buf->num == num))
+			break;
 	}
 	
-	/*
-	 * The low-level I/O function shall clean
-	 * the BUFFER_DIRTY flag and release the buffer.
+	enable_interrupts();
+	
+	/* Block is not cached. */
+	if (buf == &hashtab[i])
+		return (NULL);
+	
+	buf = getblk(dev, num);
+	
+	/* Evicted meanwhile. */
+	if (!(buf->flags & BUFFER_VALID))
+	{
+		brelse(buf);
+		return (NULL);
+	}
+	
+	return (buf);
+}
+
+/**
+ * @brief Reads a block from a device.
+ * 
+ * @details Reads the block numbered num synchronously from the device numbered
+ *          dev.
+ * 
+ * @param dev Device number.
+ * @param num Block number.
+ * 
+ * @returns Upon successful completion, a pointer to a buffer holding the
+ *          requested block is returned. In this case, the block buffer is 
+ *          ensured to be locked. Upon failure, a NULL pointer is returned
+ *          instead.
+ * 
+ * @note The device number should be valid.
+ * @note The block number should be valid.
+ */
+PUBLIC struct buffer *bread(dev_t dev, block_t num)
+{
+	struct buffer *buf;
+	
+	buf = getblk(dev, num);
+	
+	/* Valid buffer? */
+	if (buf->flags & BUFFER_VALID)
+		return (buf);
+
+	buf->flags &= ~BUFFER_ASYNC;
+	
+	/* Block is mapped in place. */
+	if (!(buf->flags & BUFFER_DIRECT))
+	{
+#if (BOOT_PREFETCH)
+		boot_record(dev, num);
+#endif
+		bdev_readblk(buf);
+		curr_proc->inblock++;
+	}
+	
+	/* Update buffer flags. */
+	buf->flags |= BUFFER_VALID;
+	buf->flags &= ~BUFFER_DIRTY;
+	
+	return (buf);
+}
+
+/**
+ * @brief Reads a block ahead from a device.
+ * 
+ * @details Starts an asynchronous read of the block numbered num from the
+ *          device numbered dev, so that a later call to bread() finds it in
+ *          the block buffer cache. Nothing is done if the block is already
+ *          cached, is being read, or if there are no free buffers.
+ * 
+ * @param dev Device number.
+ * @param num Block number.
+ * 
+ * @note The device number should be valid.
+ * @note The block number should be valid.
+ */
+PUBLIC void breada(dev_t dev, block_t num)
+{
+	unsigned i;         /* Hash table index. */
+	struct buffer *buf; /* Buffer.           */
+	
+	i = HASH(dev, num);
+	
+	disable_interrupts();
+	
+	/* Block is already cached. */
+	for (buf = hashtab[i].hash_next; buf != &hashtab[i]; buf = buf->hash_next)
+	{
+		if ((buf->dev == dev) && (buf->num == num))
+		{
+			enable_interrupts();
+			return;
+		}
+	}
+	
+	/* Do not wait for a free buffer. */
+	if (free_victim() == NULL)
+	{
+		enable_interrupts();
+		return;
+	}
+	
+	enable_interrupts();
+	
+	buf = getblk(dev, num);
+	
+	/* Someone else has read the block meanwhile. */
+	if (buf->flags & BUFFER_VALID)
+	{
+		brelse(buf);
+		return;
+	}
+	
+	/* Block is mapped in place. */
+	if (buf->flags & BUFFER_DIRECT)
+	{
+		buf->flags |= BUFFER_VALID;
+		buf->flags &= ~BUFFER_DIRTY;
+		brelse(buf);
+		return;
+	}
+	
+	/*
+	 * The low-level I/O function shall set
+	 * the BUFFER_VALID flag and release the buffer.
+	 */
+	buf->flags |= BUFFER_ASYNC;
+	buf->flags &= ~BUFFER_DIRTY;
+#if (BOOT_PREFETCH)
+	boot_record(dev, num);
+#endif
+	bdev_readblk(buf);
+	curr_proc->inblock++;
+}
+
+/**
+ * @brief Reads several blocks from a device.
+ * 
+ * @details Reads the @p n blocks listed in @p nums from the device numbered
+ *          @p dev. Blocks that are not cached are all submitted to the device
+ *          before waiting for any of them, so that they are read in a single
+ *          batch rather than one round trip at a time. If @p bufs is not a
+ *          NULL pointer, the blocks are returned in it, as if by bread().
+ *          Otherwise, they are only brought into the block buffer cache, as
+ *          if by breada(). #BLOCK_NULL entries are skipped.
+ * 
+ * @param dev  Device number.
+ * @param nums Block numbers.
+ * @param n    Number of blocks.
+ * @param bufs Where the locked block buffers shall be stored, or NULL.
+ * 
+ * @note The device number should be valid.
+ * @note The block numbers should be valid and distinct.
+ */
+PUBLIC void bread_vec(dev_t dev, const block_t *nums, unsigned n, struct buffer **bufs)
+{
+	unsigned i; /* Loop index. */
+	
+	/* Submit misses. */
+	for (i = 0; i < n; i++)
+	{
+		if (nums[i] != BLOCK_NULL)
+			breada(dev, nums[i]);
+	}
+	
+	if (bufs == NULL)
+		return;
+	
+	/* Wait for them. */
+	for (i = 0; i < n; i++)
+		bufs[i] = (nums[i] != BLOCK_NULL) ? bread(dev, nums[i]) : NULL;
+}
+
+/**
+ * @brief Drops a block from the block buffer cache.
+ * 
+ * @details If the block numbered num of the device numbered dev is cached,
+ *          clean and not in use, its block buffer is invalidated and becomes
+ *          the next one to be reused. Otherwise, nothing is done.
+ * 
+ * @param dev Device number.
+ * @param num Block number.
+ */
+PUBLIC void bforget(dev_t dev, block_t num)
+{
+	unsigned i;         /* Hash table index. */
+	struct buffer *buf; /* Buffer.           */
+	
+	i = HASH(dev, num);
+	
+	disable_interrupts();
+	
+	for (buf = hashtab[i].hash_next; buf != &hashtab[i]; buf = buf->hash_next)
+	{
+		if ((buf->dev != dev) || (buf->num != num))
+			continue;
+		
+		/* In use, or data not on disk yet. */
+		if ((buf->count > 0) || (buf->flags &
+			(BUFFER_DIRTY | BUFFER_LOCKED | BUFFER_JOURNAL | BUFFER_COMMIT)))
+			break;
+		
+		free_remove(buf);
+		buf->flags &= ~BUFFER_VALID;
+		free_insert(&free_buffers, buf, 0);
+		break;
+	}
+	
+	enable_interrupts();
+}
+
+/**
+ * @brief Writes a block buffer to the underlying device.
+ * 
+ * @details Writes the block buffer pointed to by buf asynchronously to the
+ *          underlying device. After that the operation has completed, the
+ *          buffer is released.
+ * 
+ * @param buf Block buffer to be written back.
+ * 
+ * @note The block buffer must be locked.
+ */
+PUBLIC void bwrite(struct buffer *buf)
+{	
+	/*
+	 * We don't have to write back the buffer
+	 * to disk, so we just release it and we are done.
+	 */
+	if (!(buf->flags & BUFFER_DIRTY))
+	{
+		brelse(buf);
+		return;
+	}
+	
+	/* Block is held back by the journal. */
+	if (buf->flags & (BUFFER_JOURNAL | BUFFER_COMMIT))
+	{
+		brelse(buf);
+		return;
+	}
+	
+	/* Block is mapped in place. */
+	if (buf->flags & BUFFER_DIRECT)
+	{
+		buffer_dirty(buf, 0);
+		brelse(buf);
+		return;
+	}
+	
+	stats.writebacks++;
+	
+	/*
+	 * The low-level I/O function shall clean
+	 * the BUFFER_DIRTY flag and release the buffer.
 	 */
 	bdev_writeblk(buf);
 }
 
 /**
- * @brief Synchronizes the block buffer cache.
+ * @brief Asserts if a block comes before another one on disk.
  * 
- * @details Flushes all valid block buffers onto underlying devices.
+ * @details Compares blocks in (device number, block number) order.
  */
-PUBLIC void bsync(void)
+#define BLOCK_BEFORE(dev1, num1, dev2, num2) \
+	(((dev1) < (dev2)) || (((dev1) == (dev2)) && ((num1) < (num2))))
+
+/**
+ * @brief Flushes dirty block buffers.
+ * 
+ * @details Flushes dirty block buffers that have been dirty for at least
+ *          age clock ticks onto underlying devices. Buffers are written back
+ *          in ascending (device, block number) order, so that adjacent blocks
+ *          reach the device driver as runs and disk seeks are minimized. Clean
+ *          buffers are not touched.
+ * 
+ * @param age Minimum age (in clock ticks).
+ */
+PRIVATE void bflush(unsigned age)
 {
+	dev_t dev;          /* Last device written back. */
+	block_t num;        /* Last block written back.  */
+	int first;          /* First write back?         */
+	struct buffer *buf; /* Next buffer to write.     */
+	
+	first = 1;
+	dev = 0;
+	num = 0;
+	
 	/* Synchronize buffers. */
-	for (struct buffer *buf = &buffers[0]; buf < &buffers[NR_BUFFERS]; buf++)
+	while (1)
 	{
-		blklock(buf);
+		disable_interrupts();
+		
+		/* Get next dirty buffer in disk order. */
+		buf = NULL;
+		for (struct buffer *b = &buffers[0]; b < &buffers[nr_buffers]; b++)
+		{
+			/* Skip clean buffers. */
+			if (!(b->flags & BUFFER_DIRTY) || !(b->flags & BUFFER_VALID))
+				continue;
 			
-		/* Skip invalid buffers. */
-		if (!(buf->flags & BUFFER_VALID))
+			/* Skip buffers held back by the journal. */
+			if (b->flags & (BUFFER_JOURNAL | BUFFER_COMMIT))
+				continue;
+			
+			/* Skip young buffers. */
+			if (ticks - b->age < age)
+				continue;
+			
+			/* Already written back. */
+			if (!first && !BLOCK_BEFORE(dev, num, b->dev, b->num))
+				continue;
+			
+			if ((buf == NULL) || BLOCK_BEFORE(b->dev, b->num, buf->dev, buf->num))
+				buf = b;
+		}
+		
+		enable_interrupts();
+		
+		/* Done. */
+		if (buf == NULL)
+			break;
+		
+		first = 0;
+		dev = buf->dev;
+		num = buf->num;
+		
+		blklock(buf);
+		
+		/* Buffer has been written back meanwhile. */
+		if (!(buf->flags & BUFFER_DIRTY))
 		{
 			blkunlock(buf);
 			continue;
@@ -377,10 +1079,7 @@ PUBLIC void bsync(void)
 		 */
 		disable_interrupts();
 		if (buf->count++ == 0)
-		{
-			buf->free_prev->free_next = buf->free_next;
-			buf->free_next->free_prev = buf->free_prev;
-		}
+			free_remove(buf);
 		enable_interrupts();
 		
 		/*
@@ -388,9 +1087,308 @@ PUBLIC void bsync(void)
 		 * written back to disk and then released.
 		 */
 		bwrite(buf);
+		
+		/* Let others run. */
+		resched();
+	}
+}
+
+/**
+ * @brief Issues write barriers.
+ * 
+ * @details Issues a write barrier to every device that has blocks in the
+ *          block buffer cache, so that all writes scheduled so far reach the
+ *          media.
+ */
+PRIVATE void bbarrier(void)
+{
+	dev_t dev;          /* Last device flushed.  */
+	dev_t next;         /* Next device to flush. */
+	int first;          /* First device?         */
+	int found;          /* Found next device?    */
+	struct buffer *buf; /* Working buffer.       */
+	
+	first = 1;
+	dev = 0;
+	
+	/* Flush devices in ascending order. */
+	while (1)
+	{
+		found = 0;
+		next = 0;
+		
+		disable_interrupts();
+		for (buf = &buffers[0]; buf < &buffers[nr_buffers]; buf++)
+		{
+			if (!(buf->flags & BUFFER_VALID))
+				continue;
+			
+			/* Already flushed. */
+			if (!first && (buf->dev <= dev))
+				continue;
+			
+			if (!found || (buf->dev < next))
+			{
+				next = buf->dev;
+				found = 1;
+			}
+		}
+		enable_interrupts();
+		
+		/* Done. */
+		if (!found)
+			break;
+		
+		bdev_flush(next);
+		dev = next;
+		first = 0;
+	}
+}
+
+/**
+ * @brief Synchronizes the block buffer cache.
+ * 
+ * @details Flushes all dirty block buffers onto underlying devices, and then
+ *          issues write barriers to these devices, so that data is committed
+ *          to the media.
+ */
+PUBLIC void bsync(void)
+{
+	block_sync();
+	bflush(0);
+	bbarrier();
+}
+
+/**
+ * @brief Drops the block buffer cache.
+ * 
+ * @details Synchronizes the block buffer cache and then invalidates every
+ *          block buffer that is neither in use nor dirty, so that the next
+ *          lookups of their blocks go to the device. Blocks remembered by
+ *          the scan-resistant replacement policy are forgotten as well.
+ */
+PUBLIC void bdrop(void)
+{
+	struct buffer *buf; /* Working buffer. */
+	
+	bsync();
+	
+	disable_interrupts();
+	
+	for (buf = &buffers[0]; buf < &buffers[nr_buffers]; buf++)
+	{
+		/* Skip buffers that are being used. */
+		if ((buf->count > 0) || (buf->flags & (BUFFER_LOCKED | BUFFER_DIRTY)))
+			continue;
+		
+		if (!(buf->flags & BUFFER_VALID))
+			continue;
+		
+		buf->flags &= ~BUFFER_VALID;
+		
+#if (BUFFERS_2Q)
+		if (buf->flags & BUFFER_HOT)
+		{
+			buf->flags &= ~BUFFER_HOT;
+			ncold++;
+		}
+#endif
+		
+		/* Reuse first. */
+		free_remove(buf);
+		free_insert(&free_buffers, buf, 0);
+	}
+	
+#if (BUFFERS_2Q)
+	ghost_clear();
+#endif
+
+#if (BCACHE)
+	bcache_drop();
+#endif
+	
+	enable_interrupts();
+}
+
+/**
+ * @brief Writes a block buffer back and waits for it.
+ * 
+ * @details Writes the block buffer pointed to by @p buf to the underlying
+ *          device, if it is dirty, waits for the write to complete, and then
+ *          releases the buffer.
+ * 
+ * @param buf Block buffer to be written back.
+ * 
+ * @note The block buffer must be locked.
+ */
+PUBLIC void bwritew(struct buffer *buf)
+{
+	/* Hold the buffer across the write. */
+	disable_interrupts();
+	buf->count++;
+	enable_interrupts();
+	
+	bwrite(buf);
+	
+	/* Drivers unlock the buffer once the write is done. */
+	blklock(buf);
+	brelse(buf);
+}
+
+/**
+ * @brief Synchronizes the data of a file.
+ * 
+ * @details Writes back the block buffers in the dirty list of the file
+ *          pointed to by @p ip, and waits for them to reach the device. All
+ *          writes are issued first, so that the device driver can sort and
+ *          merge them, and only then completion is awaited.
+ * 
+ * @param ip Target file.
+ * 
+ * @note The file must be locked.
+ */
+PUBLIC void bsync_inode(struct inode *ip)
+{
+	struct buffer *buf; /* Working buffer. */
+	
+	/* Issue writes. */
+	for (unsigned i = 0; i < nr_buffers; i++)
+	{
+		disable_interrupts();
+		
+		/* Skip buffers that are being written, used or logged. */
+		for (buf = ip->dirty; buf != NULL; buf = buf->owner_next)
+		{
+			if (!(buf->flags & (BUFFER_LOCKED | BUFFER_JOURNAL | BUFFER_COMMIT)))
+				break;
+		}
+		
+		/* Done. */
+		if (buf == NULL)
+		{
+			enable_interrupts();
+			break;
+		}
+		
+		/*
+		 * Prevent double free, since a call
+		 * to brelse() will follow.
+		 */
+		if (buf->count++ == 0)
+			free_remove(buf);
+		buf->flags |= BUFFER_LOCKED;
+		buf->holder = curr_proc;
+		lock_acquire(LOCK_BUFFER);
+		
+		enable_interrupts();
+		
+		bwrite(buf);
+	}
+	
+	/* Wait for writes. */
+	for (unsigned i = 0; i < nr_buffers; i++)
+	{
+		disable_interrupts();
+		
+		/* Skip buffers held back by the journal. */
+		for (buf = ip->dirty; buf != NULL; buf = buf->owner_next)
+		{
+			if (!(buf->flags & (BUFFER_JOURNAL | BUFFER_COMMIT)))
+				break;
+		}
+		
+		/* Done. */
+		if (buf == NULL)
+		{
+			enable_interrupts();
+			break;
+		}
+		
+		if (buf->count++ == 0)
+			free_remove(buf);
+		
+		enable_interrupts();
+		
+		blklock(buf);
+		
+		/* Still dirty, so write it now. */
+		if ((buf->owner == ip) && (buf->flags & BUFFER_DIRTY))
+			bwritew(buf);
+		else
+			brelse(buf);
+	}
+}
+
+/**
+ * @brief Buffer flusher daemon.
+ * 
+ * @details Periodically writes back block buffers that have been dirty for
+ *          longer than BDFLUSH_AGE seconds, or all dirty buffers when they
+ *          exceed BDFLUSH_RATIO percent of the block buffer cache. Writes
+ *          delayed for as long are given disk blocks beforehand, and metadata
+ *          changes older than JOURNAL_AGE seconds are committed. This keeps
+ *          write back off the path of processes that evict dirty buffers in
+ *          getblk().
+ * 
+ * @note This function never returns.
+ */
+PUBLIC void bdflush(void)
+{
+	kprintf("fs: buffer flusher daemon is running");
+	
+	while (1)
+	{
+		disable_interrupts();
+		tsleep(&bdflush_chain, PRIO_BUFFER, CLOCK_FREQ);
+		enable_interrupts();
+		
+		/* Leave buffers to the final sync. */
+		if (shutting_down)
+			die(0);
+		
+		inode_flush(BDFLUSH_AGE*CLOCK_FREQ);
+		block_sync();
+		journal_sync(JOURNAL_AGE*CLOCK_FREQ);
+		bflush((ndirty >= NR_DIRTY_MAX) ? 0 : BDFLUSH_AGE*CLOCK_FREQ);
 	}
 }
 
+/**
+ * @brief Wakes up the buffer flusher daemon.
+ * 
+ * @details Wakes up the buffer flusher daemon so that it looks for old dirty
+ *          block buffers to write back before its next periodic check.
+ */
+PUBLIC void bdflush_wakeup(void)
+{
+	wakeup(&bdflush_chain);
+}
+
+/**
+ * @brief Removes a block buffer from the dirty list of its file.
+ * 
+ * @param buf Block buffer to be removed.
+ * 
+ * @note Interrupts must be disabled.
+ */
+PRIVATE void buffer_unlink(struct buffer *buf)
+{
+	/* Not owned. */
+	if (buf->owner == NULL)
+		return;
+	
+	if (buf->owner_prev != NULL)
+		buf->owner_prev->owner_next = buf->owner_next;
+	else
+		buf->owner->dirty = buf->owner_next;
+	if (buf->owner_next != NULL)
+		buf->owner_next->owner_prev = buf->owner_prev;
+	
+	buf->owner = NULL;
+	buf->owner_next = NULL;
+	buf->owner_prev = NULL;
+}
+
 /**
  * @brief Sets/clears buffer's dirty flag.
  * 
@@ -402,9 +1400,116 @@ PUBLIC void bsync(void)
  * 
  * @note The buffer must be locked.
  */
-PUBLIC inline void buffer_dirty(struct buffer *buf, int set)
+PUBLIC void buffer_dirty(struct buffer *buf, int set)
 {
+	spin_lock(&dirty_lock);
+	
+	/* Buffer is getting dirty. */
+	if (set && !(buf->flags & BUFFER_DIRTY))
+	{
+		buf->age = ticks;
+		curr_proc->oublock++;
+		
+		/* Too many dirty buffers. */
+		if (++ndirty == NR_DIRTY_MAX)
+			wakeup(&bdflush_chain);
+	}
+	
+	/* Buffer is getting clean. */
+	else if (!set && (buf->flags & BUFFER_DIRTY))
+	{
+		ndirty--;
+		buffer_unlink(buf);
+	}
+	
 	buf->flags = (set) ? buf->flags | BUFFER_DIRTY : buf->flags & ~BUFFER_DIRTY;
+	
+	spin_unlock(&dirty_lock);
+}
+
+/**
+ * @brief Marks a block buffer as dirtied by a file.
+ * 
+ * @details Sets the dirty flag of the block buffer pointed to by @p buf and
+ *          links it to the dirty list of the file pointed to by @p ip, so that
+ *          the data of that file can be written back alone by bsync_inode().
+ * 
+ * @param buf Buffer to be marked dirty.
+ * @param ip  File that dirtied the buffer.
+ * 
+ * @note The buffer must be locked.
+ */
+PUBLIC void buffer_attach(struct buffer *buf, struct inode *ip)
+{
+	buffer_dirty(buf, 1);
+	
+	spin_lock(&dirty_lock);
+	
+	if (buf->owner != ip)
+	{
+		buffer_unlink(buf);
+		
+		buf->owner = ip;
+		buf->owner_prev = NULL;
+		buf->owner_next = ip->dirty;
+		if (ip->dirty != NULL)
+			ip->dirty->owner_prev = buf;
+		ip->dirty = buf;
+	}
+	
+	spin_unlock(&dirty_lock);
+}
+
+/**
+ * @brief Detaches dirty block buffers from a file.
+ * 
+ * @details Empties the dirty list of the file pointed to by @p ip. Buffers
+ *          stay dirty, and are written back later by the flusher daemon.
+ *          This is called when the in-core inode is released.
+ * 
+ * @param ip Target file.
+ */
+PUBLIC void buffer_detach(struct inode *ip)
+{
+	spin_lock(&dirty_lock);
+	
+	while (ip->dirty != NULL)
+		buffer_unlink(ip->dirty);
+	
+	spin_unlock(&dirty_lock);
+}
+
+/**
+ * @brief Sets/clears buffer's valid flag.
+ * 
+ * @details If set equals to non-zero, then the valid flag of the buffer pointed
+ *          to by buf is set, otherwise the flag is cleared.
+ * 
+ * @param buf Buffer in which the valid flag shall be set/cleared.
+ * @param set Set valid flag?
+ * 
+ * @note The buffer must be locked.
+ */
+PUBLIC inline void buffer_valid(struct buffer *buf, int set)
+{
+	buf->flags = (set) ? buf->flags | BUFFER_VALID : buf->flags & ~BUFFER_VALID;
+}
+
+/**
+ * @brief Marks a buffer as used once.
+ * 
+ * @details Once released, the buffer pointed to by buf is reused before the
+ *          others in its queue, and its block is not remembered as recently
+ *          evicted. Thus, streaming through a file does not flush blocks that
+ *          are used more often.
+ * 
+ * @param buf Buffer to be marked.
+ * 
+ * @note The buffer must be locked.
+ */
+PUBLIC void buffer_once(struct buffer *buf)
+{
+	buf->flags |= BUFFER_ONCE;
 }
 
 /**
@@ -473,49 +1578,187 @@ PUBLIC inline int buffer_is_sync(const struct buffer *buf)
 	return (buf->flags & BUFFER_SYNC);
 }
 
+/**
+ * @brief Asserts if a block buffer is valid.
+ * 
+ * @details Asserts if the block buffer pointed to by buf holds valid data.
+ * 
+ * @param buf Buffer to be asserted.
+ * 
+ * @returns Non-zero if the buffer is valid, and zero otherwise.
+ * 
+ * @note The buffer must be locked.
+ */
+PUBLIC inline int buffer_is_valid(const struct buffer *buf)
+{
+	return (buf->flags & BUFFER_VALID);
+}
+
+/**
+ * @brief Asserts if a block buffer is marked as asynchronous read.
+ * 
+ * @details Asserts if the block buffer pointed to by buf is marked as 
+ *          asynchronous read, meaning that nobody waits for the read to
+ *          complete.
+ * 
+ * @param buf Buffer to be asserted.
+ * 
+ * @returns Non-zero if the buffer is marked as asynchronous read, and zero
+ *          otherwise.
+ * 
+ * @note The buffer must be locked.
+ */
+PUBLIC inline int buffer_is_async(const struct buffer *buf)
+{
+	return (buf->flags & BUFFER_ASYNC);
+}
+
+/**
+ * @brief Gets block buffer cache statistics.
+ * 
+ * @details Gets statistics about the block buffer cache and stores them in the
+ *          location pointed to by buf.
+ * 
+ * @param buf Location where statistics shall be stored.
+ */
+PUBLIC void bstat(struct cachestat *buf)
+{
+	disable_interrupts();
+	
+	stats.size = nr_buffers;
+	stats.dirty = ndirty;
+	stats.used = 0;
+	for (unsigned i = 0; i < nr_buffers; i++)
+	{
+		if (buffers[i].count > 0)
+			stats.used++;
+	}
+	
+	kmemcpy(buf, &stats, sizeof(struct cachestat));
+	
+	enable_interrupts();
+}
+
+/**
+ * @brief Gets block buffer lock statistics.
+ * 
+ * @details Gets statistics about block buffer locks, along with the cached
+ *          blocks whose locks were waited for the most, and stores them in
+ *          the location pointed to by @p buf.
+ * 
+ * @param buf Location where statistics shall be stored.
+ */
+PUBLIC void blockstat(struct lockstat *buf)
+{
+	disable_interrupts();
+	
+	lock_stat(LOCK_BUFFER, buf);
+	for (unsigned i = 0; i < nr_buffers; i++)
+	{
+		if (buffers[i].flags & BUFFER_VALID)
+			lock_hot(buf, buffers[i].dev, buffers[i].num, buffers[i].waits);
+	}
+	
+	enable_interrupts();
+}
+
+/**
+ * @brief Hash table sizes of the block buffer cache.
+ */
+PRIVATE const unsigned hashtab_sizes[] = { 53, 97, 193, 389, BUFFERS_HASHTAB_MAX };
+
 /**
  * @brief Initializes the bock buffer cache.
  * 
  * @details Initializes the block buffer cache by putting all buffers in the
- *          free list and cleaning the block buffer hash table.
+ *          free list and cleaning the block buffer hash table. Besides the
+ *          block buffers in the fixed buffer area, a share of memory is
+ *          borrowed from the kernel page pool for additional block buffers,
+ *          and the hash table size is chosen accordingly.
  * 
  * @note This function shall be called just once. 
  */
 PUBLIC void binit(void)
 {
-	char *ptr;
+	char *ptr;      /* Buffer data.          */
+	unsigned nr;    /* Number of buffers.    */
+	unsigned extra; /* Pool backed buffers.  */
 	
 	kprintf("fs: initializing the block buffer cache");
 	
-	/* Initialize block buffers. */
+	extra = (mem_size/BUFFERS_MEM_SHARE)/BLOCK_SIZE;
+	if (extra > NR_BUFFERS_MAX - NR_BUFFERS)
+		extra = NR_BUFFERS_MAX - NR_BUFFERS;
+	
+	/* Assign data to block buffers. */
 	ptr = (char *)BUFFERS_VIRT;
-	for (unsigned i = 0; i < NR_BUFFERS; i++)
+	for (nr = 0; nr < NR_BUFFERS + extra; nr++)
+	{
+		/* Borrow a kernel page. */
+		if ((nr >= NR_BUFFERS) && (((nr - NR_BUFFERS) % (PAGE_SIZE/BLOCK_SIZE)) == 0))
+		{
+			if ((ptr = getkpg(0)) == NULL)
+				break;
+		}
+		
+		buffers[nr].data = ptr;
+		buffers[nr].mem = ptr;
+		ptr += BLOCK_SIZE;
+	}
+	nr_buffers = nr;
+	
+	/* Choose hash table size. */
+	for (unsigned i = 0; i < sizeof(hashtab_sizes)/sizeof(unsigned); i++)
+	{
+		nr_hash = hashtab_sizes[i];
+		if (nr_hash >= nr_buffers/4)
+			break;
+	}
+	
+	/* Initialize block buffers. */
+	for (unsigned i = 0; i < nr_buffers; i++)
 	{
 		buffers[i].dev = 0;
 		buffers[i].num = 0;
-		buffers[i].data = ptr;
 		buffers[i].count = 0;
 		buffers[i].flags = 
-			~(BUFFER_VALID | BUFFER_LOCKED | BUFFER_DIRTY | BUFFER_SYNC);
-		buffers[i].chain = NULL;
+			~(BUFFER_VALID | BUFFER_LOCKED | BUFFER_DIRTY | BUFFER_SYNC |
+			  BUFFER_ASYNC | BUFFER_HOT | BUFFER_DIRECT);
+		waitq_init(&buffers[i].chain);
+		buffers[i].age = 0;
+		buffers[i].holder = NULL;
+		buffers[i].waits = 0;
 		buffers[i].free_next = 
-			(i + 1 == NR_BUFFERS) ? &free_buffers : &buffers[i + 1];
+			(i + 1 == nr_buffers) ? &free_buffers : &buffers[i + 1];
 		buffers[i].free_prev = 
 			(i == 0) ? &free_buffers : &buffers[i - 1];
 		buffers[i].hash_next = &buffers[i];
 		buffers[i].hash_prev = &buffers[i];
-		
-		ptr += BLOCK_SIZE;
+		buffers[i].owner = NULL;
+		buffers[i].owner_next = NULL;
+		buffers[i].owner_prev = NULL;
 	}
 	
 	/* Initialize the buffer cache. */
 	free_buffers.free_next = &buffers[0];
-	free_buffers.free_prev = &buffers[NR_BUFFERS - 1];
-	for (unsigned i = 0; i < BUFFERS_HASHTAB_SIZE; i++)
+	free_buffers.free_prev = &buffers[nr_buffers - 1];
+#if (BUFFERS_2Q)
+	hot_buffers.free_next = &hot_buffers;
+	hot_buffers.free_prev = &hot_buffers;
+	ncold = nr_buffers;
+#endif
+	for (unsigned i = 0; i < nr_hash; i++)
 	{
 		hashtab[i].hash_prev = &hashtab[i];
 		hashtab[i].hash_next = &hashtab[i];
 	}
+#if (BUFFERS_2Q)
+	ghost_clear();
+#endif
+	
+	kprintf("fs: %d slots in the block buffer cache", nr_buffers);
 	
-	kprintf("fs: %d slots in the block buffer cache", NR_BUFFERS);
+#if (BCACHE)
+	bcache_init();
+#endif
 }
@@ -0,0 +1,284 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ * 
+ * @brief Directory name cache module implementation.
+ */
+
+#include <nanvix/config.h>
+#include <nanvix/const.h>
+#include <nanvix/fs.h>
+#include <nanvix/klib.h>
+#include <limits.h>
+#include "fs.h"
+
+/**
+ * @brief Hash table size.
+ */
+#define DCACHE_HASHTAB_SIZE 127
+
+/**
+ * @brief Directory name cache entry.
+ */
+struct dentry
+{
+	int valid;                /**< Valid entry?                           */
+	dev_t dev;                /**< Underlying device.                     */
+	ino_t dir;                /**< Parent directory.                      */
+	ino_t num;                /**< Inode number (#INODE_NULL if none).    */
+	char name[NAME_MAX];      /**< File name.                             */
+	struct dentry *lru_next;  /**< Next entry in the LRU list.            */
+	struct dentry *lru_prev;  /**< Previous entry in the LRU list.        */
+	struct dentry *hash_next; /**< Next entry in the hash table.          */
+	struct dentry *hash_prev; /**< Previous entry in the hash table.      */
+};
+
+/**
+ * @brief Directory name cache entries.
+ */
+PRIVATE struct dentry dentries[NR_DENTRIES];
+
+/**
+ * @brief LRU list, most recently used entries first.
+ */
+PRIVATE struct dentry lru;
+
+/**
+ * @brief Entries hash table.
+ */
+PRIVATE struct dentry *hashtab[DCACHE_HASHTAB_SIZE];
+
+/**
+ * @brief Hashes a directory name cache key.
+ * 
+ * @param dev  Underlying device.
+ * @param dir  Parent directory.
+ * @param name File name.
+ * 
+ * @returns The hash table index for the key.
+ */
+PRIVATE unsigned dcache_hash(dev_t dev, ino_t dir, const char *name)
+{
+	unsigned h;
+	
+	h = dev ^ (dir << 4);
+	for (unsigned i = 0; (i < NAME_MAX) && (name[i] != '\0'); i++)
+		h = (h << 5) + h + (unsigned char)name[i];
+	
+	return (h%DCACHE_HASHTAB_SIZE);
+}
+
+/**
+ * @brief Moves a directory name cache entry to the head of the LRU list.
+ * 
+ * @param d Target entry.
+ */
+PRIVATE void dcache_touch(struct dentry *d)
+{
+	d->lru_prev->lru_next = d->lru_next;
+	d->lru_next->lru_prev = d->lru_prev;
+	
+	d->lru_next = lru.lru_next;
+	d->lru_prev = &lru;
+	lru.lru_next->lru_prev = d;
+	lru.lru_next = d;
+}
+
+/**
+ * @brief Drops a directory name cache entry.
+ * 
+ * @details Removes the entry pointed to by @p d from the hash table and moves
+ *          it to the tail of the LRU list, so that it gets reused first.
+ * 
+ * @param d Target entry.
+ */
+PRIVATE void dcache_drop(struct dentry *d)
+{
+	if (d->hash_prev != NULL)
+		d->hash_prev->hash_next = d->hash_next;
+	else
+		hashtab[dcache_hash(d->dev, d->dir, d->name)] = d->hash_next;
+	if (d->hash_next != NULL)
+		d->hash_next->hash_prev = d->hash_prev;
+	
+	d->valid = 0;
+	
+	d->lru_prev->lru_next = d->lru_next;
+	d->lru_next->lru_prev = d->lru_prev;
+	
+	d->lru_prev = lru.lru_prev;
+	d->lru_next = &lru;
+	lru.lru_prev->lru_next = d;
+	lru.lru_prev = d;
+}
+
+/**
+ * @brief Searches for an entry in the directory name cache.
+ * 
+ * @param dip  Parent directory.
+ * @param name File name.
+ * 
+ * @returns If the entry is cached, a pointer to it is returned. Otherwise, a
+ *          #NULL pointer is returned instead.
+ */
+PRIVATE struct dentry *dcache_find(struct inode *dip, const char *name)
+{
+	struct dentry *d;
+	
+	d = hashtab[dcache_hash(dip->dev, dip->num, name)];
+	for (/* noop */; d != NULL; d = d->hash_next)
+	{
+		/* Found. */
+		if ((d->dev == dip->dev) && (d->dir == dip->num) &&
+			(!kstrncmp(d->name, name, NAME_MAX)))
+			return (d);
+	}
+	
+	return (NULL);
+}
+
+/**
+ * @brief Looks up a file name in the directory name cache.
+ * 
+ * @param dip  Parent directory.
+ * @param name File name.
+ * @param num  Place where the inode number of the file shall be stored.
+ *             #INODE_NULL is stored for files that are known not to exist.
+ * 
+ * @returns Non-zero if the file name is cached, and zero otherwise.
+ */
+PUBLIC int dcache_lookup(struct inode *dip, const char *name, ino_t *num)
+{
+	struct dentry *d;
+	
+	/* Miss. */
+	if ((d = dcache_find(dip, name)) == NULL)
+		return (0);
+	
+	dcache_touch(d);
+	*num = d->num;
+	
+	return (1);
+}
+
+/**
+ * @brief Caches a file name.
+ * 
+ * @details Caches that the file named @p name in the directory pointed to by
+ *          @p dip has the inode number @p num. If @p num is #INODE_NULL, that
+ *          the file does not exist is cached instead.
+ * 
+ * @param dip  Parent directory.
+ * @param name File name.
+ * @param num  Inode number of the file.
+ */
+PUBLIC void dcache_insert(struct inode *dip, const char *name, ino_t num)
+{
+	unsigned i;
+	struct dentry *d;
+	
+	/* Update existing entry. */
+	if ((d = dcache_find(dip, name)) != NULL)
+	{
+		d->num = num;
+		dcache_touch(d);
+		return;
+	}
+	
+	/* Evict least recently used entry. */
+	d = lru.lru_prev;
+	if (d->valid)
+		dcache_drop(d);
+	
+	d->valid = 1;
+	d->dev = dip->dev;
+	d->dir = dip->num;
+	d->num = num;
+	kstrncpy(d->name, name, NAME_MAX);
+	
+	/* Insert entry in the hash table. */
+	i = dcache_hash(d->dev, d->dir, d->name);
+	d->hash_next = hashtab[i];
+	d->hash_prev = NULL;
+	hashtab[i] = d;
+	if (d->hash_next != NULL)
+		d->hash_next->hash_prev = d;
+	
+	dcache_touch(d);
+}
+
+/**
+ * @brief Drops all cached names of a directory.
+ * 
+ * @details Drops all entries of the directory name cache whose parent is the
+ *          directory identified by @p dev and @p dir. This shall be called
+ *          when the directory is released, so that its inode number may be
+ *          reused.
+ * 
+ * @param dev Underlying device.
+ * @param dir Inode number of the directory.
+ */
+PUBLIC void dcache_purge(dev_t dev, ino_t dir)
+{
+	for (unsigned i = 0; i < NR_DENTRIES; i++)
+	{
+		if ((dentries[i].valid) && (dentries[i].dev == dev) &&
+			(dentries[i].dir == dir))
+			dcache_drop(&dentries[i]);
+	}
+}
+
+/**
+ * @brief Flushes the directory name cache.
+ * 
+ * @details Drops all entries of the directory name cache.
+ */
+PUBLIC void dcache_flush(void)
+{
+	for (unsigned i = 0; i < NR_DENTRIES; i++)
+	{
+		if (dentries[i].valid)
+			dcache_drop(&dentries[i]);
+	}
+}
+
+/**
+ * @brief Initializes the directory name cache.
+ */
+PUBLIC void dcache_init(void)
+{
+	kprintf("fs: initializing directory name cache");
+	
+	lru.lru_next = &lru;
+	lru.lru_prev = &lru;
+	
+	for (unsigned i = 0; i < NR_DENTRIES; i++)
+	{
+		dentries[i].valid = 0;
+		dentries[i].lru_next = lru.lru_next;
+		dentries[i].lru_prev = &lru;
+		lru.lru_next->lru_prev = &dentries[i];
+		lru.lru_next = &dentries[i];
+	}
+	
+	for (unsigned i = 0; i < DCACHE_HASHTAB_SIZE; i++)
+		hashtab[i] = NULL;
+}
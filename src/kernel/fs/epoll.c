@@ -0,0 +1,433 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/epoll.h>
+#include <nanvix/fs.h>
+#include <nanvix/hal.h>
+#include <nanvix/klib.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include <sys/epoll.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <poll.h>
+
+/**
+ * @brief Event poll instance table.
+ */
+PRIVATE struct eventpoll eptab[EPOLL_MAX];
+
+/**
+ * @brief Hash table of watched files, indexed by the object that signals
+ *        their readiness.
+ */
+PRIVATE struct epitem *hashtab[EPOLL_HASHTAB_SIZE];
+
+/**
+ * @brief Object that signals the readiness of a file.
+ * 
+ * @details Pipes signal their own inode. Character devices do not know the
+ *          inode through which they are opened, so they all go by NULL.
+ */
+#define WATCHED(f) \
+	((S_ISCHR((f)->inode->mode)) ? NULL : (f)->inode)
+
+/**
+ * @brief Hash function for watched objects.
+ */
+#define HASH(ip) \
+	((ADDR(ip)/sizeof(struct inode))%EPOLL_HASHTAB_SIZE)
+
+/**
+ * @brief Puts an item in the ready list of its instance.
+ * 
+ * @param it Item.
+ * 
+ * @note Interrupts must be disabled.
+ */
+PRIVATE void ready_insert(struct epitem *it)
+{
+	struct eventpoll *ep;
+	
+	/* Nothing to be done. */
+	if (it->ready)
+		return;
+	
+	ep = it->ep;
+	it->ready = 1;
+	it->rnext = NULL;
+	if (ep->rtail != NULL)
+		ep->rtail->rnext = it;
+	else
+		ep->rhead = it;
+	ep->rtail = it;
+	
+	wakeup(&ep->chain);
+}
+
+/**
+ * @brief Takes an item out of the ready list of its instance.
+ * 
+ * @param it Item.
+ * 
+ * @note Interrupts must be disabled.
+ */
+PRIVATE void ready_remove(struct epitem *it)
+{
+	struct epitem *p;     /* Previous item. */
+	struct eventpoll *ep; /* Instance.      */
+	
+	/* Nothing to be done. */
+	if (!it->ready)
+		return;
+	
+	ep = it->ep;
+	it->ready = 0;
+	
+	if (ep->rhead == it)
+	{
+		p = NULL;
+		ep->rhead = it->rnext;
+	}
+	else
+	{
+		for (p = ep->rhead; p->rnext != it; p = p->rnext)
+			/* noop */ ;
+		p->rnext = it->rnext;
+	}
+	
+	if (ep->rtail == it)
+		ep->rtail = p;
+}
+
+/**
+ * @brief Puts an item in the ready list if its file is ready.
+ * 
+ * @param it Item.
+ * 
+ * @note Interrupts must be disabled.
+ */
+PRIVATE void epoll_check(struct epitem *it)
+{
+	/* Disabled item. */
+	if (it->events == 0)
+		return;
+	
+	if (do_poll(it->file) & (it->events | POLLERR | POLLHUP))
+		ready_insert(it);
+}
+
+/**
+ * @brief Unlinks an item from its instance and from the hash table.
+ * 
+ * @param it Item.
+ * 
+ * @note Interrupts must be disabled.
+ */
+PRIVATE void epoll_unlink(struct epitem *it)
+{
+	struct epitem **pp;
+	
+	ready_remove(it);
+	
+	for (pp = &hashtab[HASH(WATCHED(it->file))]; *pp != it; pp = &(*pp)->hnext)
+		/* noop */ ;
+	*pp = it->hnext;
+	
+	for (pp = &it->ep->items; *pp != it; pp = &(*pp)->next)
+		/* noop */ ;
+	*pp = it->next;
+}
+
+/**
+ * @brief Allocates an event poll instance.
+ * 
+ * @returns A new event poll instance, or NULL if the table is full.
+ */
+PUBLIC struct eventpoll *epoll_alloc(void)
+{
+	struct eventpoll *ep;
+	
+	for (ep = &eptab[0]; ep < &eptab[EPOLL_MAX]; ep++)
+	{
+		/* Found. */
+		if (ep->count == 0)
+			goto found;
+	}
+	
+	return (NULL);
+
+found:
+
+	ep->count = 1;
+	ep->items = NULL;
+	ep->rhead = NULL;
+	ep->rtail = NULL;
+	waitq_init(&ep->chain);
+	
+	return (ep);
+}
+
+/**
+ * @brief Gets an event poll instance of the current process.
+ * 
+ * @param epfd ID of the instance.
+ * 
+ * @returns The instance whose ID is @p epfd, or NULL if the current process
+ *          has no such instance.
+ */
+PUBLIC struct eventpoll *epoll_get(int epfd)
+{
+	if ((epfd < 0) || (epfd >= EPOLL_MAX))
+		return (NULL);
+	
+	if (!(curr_proc->epmap & (1 << epfd)))
+		return (NULL);
+	
+	return (&eptab[epfd]);
+}
+
+/**
+ * @brief Gets the ID of an event poll instance.
+ * 
+ * @param ep Event poll instance.
+ * 
+ * @returns The ID of @p ep.
+ */
+PUBLIC int epoll_id(const struct eventpoll *ep)
+{
+	return (ep - eptab);
+}
+
+/**
+ * @brief Releases a reference to an event poll instance.
+ * 
+ * @details Watched files are forgotten along with the last reference.
+ * 
+ * @param ep Event poll instance.
+ */
+PUBLIC void epoll_put(struct eventpoll *ep)
+{
+	struct epitem *it;
+	
+	if (--ep->count > 0)
+		return;
+	
+	while ((it = ep->items) != NULL)
+		epoll_remove(it);
+}
+
+/**
+ * @brief Searches for a watched file descriptor.
+ * 
+ * @param ep Event poll instance.
+ * @param fd File descriptor.
+ * 
+ * @returns The item that watches @p fd, or NULL if there is none.
+ */
+PUBLIC struct epitem *epoll_find(struct eventpoll *ep, int fd)
+{
+	struct epitem *it;
+	
+	for (it = ep->items; it != NULL; it = it->next)
+	{
+		if ((it->fd == fd) && (it->file == curr_proc->ofiles[fd]))
+			return (it);
+	}
+	
+	return (NULL);
+}
+
+/**
+ * @brief Watches a file descriptor.
+ * 
+ * @param ep Event poll instance.
+ * @param fd File descriptor.
+ * @param f  Underlying file.
+ * @param ev Watched events and user data.
+ * 
+ * @returns Zero upon success, and a negative error code otherwise.
+ */
+PUBLIC int epoll_insert(struct eventpoll *ep, int fd, struct file *f,
+	const struct epoll_event *ev)
+{
+	struct epitem *it;
+	
+	if ((it = kmalloc(sizeof(struct epitem))) == NULL)
+		return (-ENOMEM);
+	
+	it->ep = ep;
+	it->fd = fd;
+	it->file = f;
+	it->events = ev->events;
+	it->data = ev->data;
+	it->ready = 0;
+	
+	disable_interrupts();
+	
+	it->next = ep->items;
+	ep->items = it;
+	it->hnext = hashtab[HASH(WATCHED(f))];
+	hashtab[HASH(WATCHED(f))] = it;
+	
+	/* Already ready. */
+	epoll_check(it);
+	
+	enable_interrupts();
+	
+	return (0);
+}
+
+/**
+ * @brief Changes the watched events of a file descriptor.
+ * 
+ * @param it Item.
+ * @param ev Watched events and user data.
+ */
+PUBLIC void epoll_modify(struct epitem *it, const struct epoll_event *ev)
+{
+	disable_interrupts();
+	
+	it->events = ev->events;
+	it->data = ev->data;
+	ready_remove(it);
+	epoll_check(it);
+	
+	enable_interrupts();
+}
+
+/**
+ * @brief Stops watching a file descriptor.
+ * 
+ * @param it Item.
+ */
+PUBLIC void epoll_remove(struct epitem *it)
+{
+	disable_interrupts();
+	epoll_unlink(it);
+	enable_interrupts();
+	
+	kfree(it);
+}
+
+/**
+ * @brief Takes ready events out of an event poll instance.
+ * 
+ * @details Only items in the ready list are looked at. Level-triggered items
+ *          that are still ready go back to the ready list, edge-triggered
+ *          items wait for the next change of readiness, and one-shot items
+ *          are disabled.
+ * 
+ * @param ep     Event poll instance.
+ * @param events Where to store the events.
+ * @param max    Maximum number of events.
+ * 
+ * @returns The number of events stored in @p events.
+ */
+PUBLIC int epoll_harvest(struct eventpoll *ep, struct epoll_event *events, int max)
+{
+	int n;              /* Events taken.    */
+	int done;           /* Done?            */
+	unsigned revents;   /* Events ready.    */
+	struct epitem *it;  /* Working item.    */
+	struct epitem *last; /* Last ready item. */
+	
+	disable_interrupts();
+	
+	last = ep->rtail;
+	
+	for (n = 0, done = (last == NULL); (!done) && (n < max); /* noop */)
+	{
+		it = ep->rhead;
+		done = (it == last);
+		
+		ep->rhead = it->rnext;
+		if (ep->rhead == NULL)
+			ep->rtail = NULL;
+		it->ready = 0;
+		
+		/* Not ready anymore. */
+		if ((it->events == 0) ||
+			((revents = do_poll(it->file) & (it->events | POLLERR | POLLHUP)) == 0))
+			continue;
+		
+		events[n].events = revents;
+		events[n].data = it->data;
+		n++;
+		
+		if (it->events & EPOLLONESHOT)
+			it->events = 0;
+		else if (!(it->events & EPOLLET))
+			ready_insert(it);
+	}
+	
+	enable_interrupts();
+	
+	return (n);
+}
+
+/**
+ * @brief Notifies a change of readiness.
+ * 
+ * @details Items that watch files signaled by @p ip, and that are ready now,
+ *          are put in the ready list of their instances.
+ * 
+ * @param ip Object whose readiness has changed.
+ */
+PUBLIC void epoll_notify(const struct inode *ip)
+{
+	struct epitem *it;
+	
+	disable_interrupts();
+	
+	for (it = hashtab[HASH(ip)]; it != NULL; it = it->hnext)
+	{
+		if ((WATCHED(it->file) == ip) && (!it->ready))
+			epoll_check(it);
+	}
+	
+	enable_interrupts();
+}
+
+/**
+ * @brief Forgets about a file that is being released.
+ * 
+ * @param f File.
+ */
+PUBLIC void epoll_forget(const struct file *f)
+{
+	struct epitem *it;   /* Working item. */
+	struct epitem *next; /* Next item.    */
+	
+	disable_interrupts();
+	
+	for (it = hashtab[HASH(WATCHED(f))]; it != NULL; it = next)
+	{
+		next = it->hnext;
+		
+		if (it->file == f)
+		{
+			epoll_unlink(it);
+			kfree(it);
+		}
+	}
+	
+	enable_interrupts();
+}
@@ -19,24 +19,70 @@
 
 #include <nanvix/clock.h>
 #include <nanvix/const.h>
+#include <nanvix/dev.h>
 #include <nanvix/fs.h>
 #include <nanvix/klib.h>
+#include <nanvix/mm.h>
+#include <nanvix/net.h>
+#include <nanvix/region.h>
 #include <sys/types.h>
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
 #include "fs.h"
 
 /**
- * @brief Searches for a directory entry.
+ * @brief Number of directory entries per block.
+ */
+#define DIRENTS_PER_BLOCK (BLOCK_SIZE/sizeof(struct d_dirent))
+
+/**
+ * @brief Number of directory blocks read at once by a linear search.
+ */
+#define DIRENT_BATCH 8
+
+/**
+ * @brief Reads ahead the blocks of a directory that a search is about to scan.
+ * 
+ * @param dip      Directory that is being searched.
+ * @param first    First directory entry to read ahead. It must start a block.
+ * @param nentries Number of directory entries.
+ * 
+ * @returns The first directory entry that was not read ahead.
+ * 
+ * @note @p dip must be locked.
+ */
+PRIVATE int dirent_readahead(struct inode *dip, int first, int nentries)
+{
+	unsigned n;                 /* Number of blocks. */
+	block_t nums[DIRENT_BATCH]; /* Block numbers.    */
+	
+	for (n = 0; (n < DIRENT_BATCH) && (first < nentries); n++)
+	{
+		nums[n] = block_map(dip, first*sizeof(struct d_dirent), 0);
+		first += DIRENTS_PER_BLOCK;
+	}
+	
+	/* A single block is just read. */
+	if (n > 1)
+		bread_vec(dip->dev, nums, n, NULL);
+	
+	return (first);
+}
+
+/**
+ * @brief Searches linearly for a directory entry.
  * 
  * @details Searches for a directory entry named @p filename in the directory
- *          pointed to be @p dip. If @p create is not zero and such file entry
- *          does not exist, the entry is created.
+ *          pointed to be @p dip, scanning entries from @p first on. If
+ *          @p create is not zero and such file entry does not exist, the
+ *          entry is created.
  * 
  * @param dip      Directory where the directory entry shall be searched.
  * @param filename Name of the directory entry that shall be searched.
  * @param buf      Buffer where the directory entry is loaded.
  * @param create   Create directory entry?
+ * @param first    First directory entry to scan. It must start a block.
  * 
  * @returns Upon successful completion, the directory entry is returned. In this
  *          case, @p buf is set to point to the (locked) buffer associated to
@@ -47,21 +93,24 @@
  * @note @p filename must point to a valid location.
  * @note @p buf must point to a valid location
  */
-PRIVATE struct d_dirent *dirent_search
-(struct inode *dip, const char *filename, struct buffer **buf, int create)
+PRIVATE struct d_dirent *dirent_search_linear
+(struct inode *dip, const char *filename, struct buffer **buf, int create, int first)
 {
 	int i;              /* Working directory entry index.       */
 	int entry;          /* Index of first free directory entry. */
+	int ahead;          /* First entry not read ahead.          */
 	block_t blk;        /* Working block number.                */
 	int nentries;       /* Number of directory entries.         */
 	struct d_dirent *d; /* Directory entry.                     */
 	
 	nentries = dip->size/sizeof(struct d_dirent);
 	
-	/* Search from very first block. */
-	i = 0;
+	/* Search from first block. */
+	i = first;
 	entry = -1;
-	blk = dip->blocks[0];		
+	ahead = first;
+	blk = (first == 0) ? dip->blocks[0] :
+		block_map(dip, first*sizeof(struct d_dirent), 0);
 	(*buf) = NULL;
 	d = NULL;
 	/* Search directory entry. */
@@ -82,6 +131,8 @@ PRIVATE struct d_dirent *dirent_search
 		/* Get buffer. */
 		if ((*buf) == NULL)
 		{
+			if (i >= ahead)
+				ahead = dirent_readahead(dip, i, nentries);
 			(*buf) = bread(dip->dev, blk);
 			d = (*buf)->data;
 		}
@@ -161,6 +212,344 @@ PRIVATE struct d_dirent *dirent_search
 	return (NULL);
 }
 
+/**
+ * @brief Hashes a file name.
+ * 
+ * @param filename Target file name.
+ * 
+ * @returns The hash of @p filename, as specified for hashed directories.
+ */
+PRIVATE unsigned dirhash(const char *filename)
+{
+	unsigned h;
+	
+	/* "." and ".." live in the first bucket. */
+	if (!kstrcmp(filename, ".") || !kstrcmp(filename, ".."))
+		return (0);
+	
+	h = 0;
+	for (unsigned i = 0; (i < NAME_MAX) && (filename[i] != '\0'); i++)
+		h = h*31 + (unsigned char)filename[i];
+	
+	return (h);
+}
+
+/**
+ * @brief Gets the number of hash buckets of a directory.
+ * 
+ * @details Gets the number of hash buckets of the directory pointed to by
+ *          @p dip, reading the hashed directory header the first time it is
+ *          asked for.
+ * 
+ * @param dip Target directory.
+ * 
+ * @returns The number of hash buckets of the directory, or zero if it is a
+ *          plain directory.
+ * 
+ * @note @p dip must be locked.
+ */
+PRIVATE unsigned dirhash_buckets(struct inode *dip)
+{
+	block_t blk;         /* First block.      */
+	struct buffer *buf;  /* Block buffer.     */
+	struct d_dirhash *h; /* Hashed directory. */
+	
+	/* Already known. */
+	if (dip->nbuckets != DIRHASH_UNKNOWN)
+		return (dip->nbuckets);
+	
+	dip->nbuckets = 0;
+	
+	/* Too small to be hashed. */
+	if (dip->size < BLOCK_SIZE)
+		return (0);
+	
+	if ((blk = dip->blocks[0]) == BLOCK_NULL)
+		return (0);
+	
+	buf = bread(dip->dev, blk);
+	h = &((struct d_dirhash *)buf->data)[DIRHASH_SLOT];
+	if ((h->h_ino == INODE_NULL) && (h->h_magic == DIRHASH_MAGIC))
+	{
+		/* Sanity check. */
+		if ((h->h_nbuckets > 0) &&
+			((off_t)(h->h_nbuckets*BLOCK_SIZE) <= dip->size))
+			dip->nbuckets = h->h_nbuckets;
+	}
+	brelse(buf);
+	
+	return (dip->nbuckets);
+}
+
+/**
+ * @brief Searches for a directory entry in a hashed directory.
+ * 
+ * @details Searches for a directory entry named @p filename in the hashed
+ *          directory pointed to be @p dip, probing buckets from the one the
+ *          name hashes to. If @p create is not zero and such file entry does
+ *          not exist, the entry is created in the first free entry found.
+ * 
+ * @param dip      Directory where the directory entry shall be searched.
+ * @param filename Name of the directory entry that shall be searched.
+ * @param buf      Buffer where the directory entry is loaded.
+ * @param create   Create directory entry?
+ * @param nbuckets Number of hash buckets of the directory.
+ * 
+ * @returns Upon successful completion, the directory entry is returned. In this
+ *          case, @p buf is set to point to the (locked) buffer associated to
+ *          the requested directory entry. However, upon failure, a #NULL
+ *          pointer is returned instead.
+ * 
+ * @note @p dip must be locked.
+ * @note @p filename must point to a valid location.
+ * @note @p buf must point to a valid location
+ */
+PRIVATE struct d_dirent *dirhash_search
+(struct inode *dip, const char *filename, struct buffer **buf, int create, unsigned nbuckets)
+{
+	unsigned b;         /* Working bucket.                      */
+	int end;            /* End of the probe reached?            */
+	int entry;          /* Index of first free directory entry. */
+	block_t blk;        /* Working block number.                */
+	struct d_dirent *d; /* Directory entry.                     */
+	
+	entry = -1;
+	end = 0;
+	b = dirhash(filename)%nbuckets;
+	for (unsigned n = 0; n < nbuckets; n++, b = (b + 1)%nbuckets)
+	{
+		blk = block_map(dip, b*BLOCK_SIZE, 0);
+		
+		/* Bucket was never used. */
+		if (blk == BLOCK_NULL)
+		{
+			if (entry < 0)
+				entry = b*DIRENTS_PER_BLOCK;
+			end = 1;
+			break;
+		}
+		
+		(*buf) = bread(dip->dev, blk);
+		d = (*buf)->data;
+		for (unsigned i = 0; i < DIRENTS_PER_BLOCK; i++, d++)
+		{
+			/* Valid entry. */
+			if (d->d_ino != INODE_NULL)
+			{
+				/* Found. */
+				if (!kstrncmp(d->d_name, filename, NAME_MAX))
+				{
+					/* Duplicated entry. */
+					if (create)
+					{
+						brelse((*buf));
+						d = NULL;
+						curr_proc->errno = EEXIST;
+					}
+					
+					return (d);
+				}
+				
+				continue;
+			}
+			
+			/* Hashed directory header. */
+			if ((b == 0) && (i == DIRHASH_SLOT))
+				continue;
+			
+			/* Remember entry index. */
+			if (entry < 0)
+				entry = b*DIRENTS_PER_BLOCK + i;
+			
+			/* Entry was never used. */
+			if (d->d_name[0] == '\0')
+			{
+				end = 1;
+				break;
+			}
+		}
+		
+		brelse((*buf));
+		(*buf) = NULL;
+		
+		if (end)
+			break;
+	}
+	
+	/* All buckets are full, so search overflow entries. */
+	if (!end)
+	{
+		d = dirent_search_linear(dip, filename, buf, 0,
+			nbuckets*DIRENTS_PER_BLOCK);
+		
+		if (d != NULL)
+		{
+			/* Duplicated entry. */
+			if (create)
+			{
+				brelse((*buf));
+				d = NULL;
+				curr_proc->errno = EEXIST;
+			}
+			
+			return (d);
+		}
+	}
+	
+	/* Create entry. */
+	if (create)
+	{
+		/* No free entry in buckets. */
+		if (entry < 0)
+		{
+			return (dirent_search_linear(dip, filename, buf, 1,
+				nbuckets*DIRENTS_PER_BLOCK));
+		}
+		
+		blk = block_map(dip, entry*sizeof(struct d_dirent), 1);
+		
+		/* Failed to create entry. */
+		if (blk == BLOCK_NULL)
+		{
+			curr_proc->errno = -ENOSPC;
+			return (NULL);
+		}
+		
+		(*buf) = bread(dip->dev, blk);
+		entry %= DIRENTS_PER_BLOCK;
+		d = &((struct d_dirent *)((*buf)->data))[entry];
+		
+		return (d);
+	}
+	
+	return (NULL);
+}
+
+/**
+ * @brief Searches for a directory entry.
+ * 
+ * @details Searches for a directory entry named @p filename in the directory
+ *          pointed to be @p dip. If @p create is not zero and such file entry
+ *          does not exist, the entry is created. Both plain and hashed
+ *          directories are supported.
+ * 
+ * @param dip      Directory where the directory entry shall be searched.
+ * @param filename Name of the directory entry that shall be searched.
+ * @param buf      Buffer where the directory entry is loaded.
+ * @param create   Create directory entry?
+ * 
+ * @returns Upon successful completion, the directory entry is returned. In this
+ *          case, @p buf is set to point to the (locked) buffer associated to
+ *          the requested directory entry. However, upon failure, a #NULL
+ *          pointer is returned instead.
+ * 
+ * @note @p dip must be locked.
+ * @note @p filename must point to a valid location.
+ * @note @p buf must point to a valid location
+ */
+PRIVATE struct d_dirent *dirent_search
+(struct inode *dip, const char *filename, struct buffer **buf, int create)
+{
+	unsigned nbuckets;
+	
+	(*buf) = NULL;
+	
+	/* Hashed directory. */
+	if ((nbuckets = dirhash_buckets(dip)) > 0)
+		return (dirhash_search(dip, filename, buf, create, nbuckets));
+	
+	return (dirent_search_linear(dip, filename, buf, create, 0));
+}
+
+/**
+ * @brief Allocates an entry in a plain directory.
+ * 
+ * @details Looks for a free entry in the plain directory pointed to by @p dip,
+ *          starting at the first free entry hint of the directory, and expands
+ *          the directory if there is none. Entries below the hint are known to
+ *          be in use, so in directories that only grow new entries go straight
+ *          to the tail.
+ * 
+ * @param dip Directory where the directory entry shall be allocated.
+ * @param buf Buffer where the directory entry is loaded.
+ * 
+ * @returns Upon successful completion, the directory entry is returned. In this
+ *          case, @p buf is set to point to the (locked) buffer associated to
+ *          the allocated directory entry. However, upon failure, a #NULL
+ *          pointer is returned instead.
+ * 
+ * @note @p dip must be locked.
+ * @note @p buf must point to a valid location
+ */
+PRIVATE struct d_dirent *dirent_alloc(struct inode *dip, struct buffer **buf)
+{
+	unsigned i;         /* Working directory entry index. */
+	block_t blk;        /* Working block number.          */
+	unsigned nentries;  /* Number of directory entries.   */
+	struct d_dirent *d; /* Directory entry.               */
+	
+	nentries = dip->size/sizeof(struct d_dirent);
+	
+	/* Search from the hint. */
+	(*buf) = NULL;
+	for (i = dip->dfree; i < nentries; i++)
+	{
+		/* Get next block. */
+		if (((*buf) == NULL) || ((i%DIRENTS_PER_BLOCK) == 0))
+		{
+			if ((*buf) != NULL)
+				brelse((*buf));
+			(*buf) = NULL;
+			
+			blk = block_map(dip, i*sizeof(struct d_dirent), 0);
+			
+			/* Skip invalid blocks. */
+			if (blk == BLOCK_NULL)
+			{
+				i += DIRENTS_PER_BLOCK - 1 - i%DIRENTS_PER_BLOCK;
+				continue;
+			}
+			
+			(*buf) = bread(dip->dev, blk);
+		}
+		
+		d = &((struct d_dirent *)((*buf)->data))[i%DIRENTS_PER_BLOCK];
+		
+		/* Found. */
+		if (d->d_ino == INODE_NULL)
+		{
+			dip->dfree = i + 1;
+			return (d);
+		}
+	}
+	
+	/* House keeping. */
+	if ((*buf) != NULL)
+	{
+		brelse((*buf));
+		(*buf) = NULL;
+	}
+	
+	/* Expand directory. */
+	blk = block_map(dip, nentries*sizeof(struct d_dirent), 1);
+	
+	/* Failed to create entry. */
+	if (blk == BLOCK_NULL)
+	{
+		curr_proc->errno = -ENOSPC;
+		return (NULL);
+	}
+	
+	dip->size += sizeof(struct d_dirent);
+	dip->dfree = nentries + 1;
+	inode_touch(dip);
+	
+	(*buf) = bread(dip->dev, blk);
+	d = &((struct d_dirent *)((*buf)->data))[nentries%DIRENTS_PER_BLOCK];
+	
+	return (d);
+}
+
 /**
  * @brief Searches for a file in a directory.
  * 
@@ -179,17 +568,23 @@ PRIVATE struct d_dirent *dirent_search
  */
 PUBLIC ino_t dir_search(struct inode *ip, const char *filename)
 {
+	ino_t num;          /* Inode number.    */
 	struct buffer *buf; /* Block buffer.    */
 	struct d_dirent *d; /* Directory entry. */
 	
+	/* Cached name. */
+	if (dcache_lookup(ip, filename, &num))
+		return (num);
+	
 	/* Search directory entry. */
 	d = dirent_search(ip, filename, &buf, 0);
-	if (d == NULL)
-		return (INODE_NULL);
+	num = (d != NULL) ? d->d_ino : INODE_NULL;
+	if (d != NULL)
+		brelse(buf);
 	
-	brelse(buf);
+	dcache_insert(ip, filename, num);
 	
-	return (d->d_ino);
+	return (num);
 }
 
 /*
@@ -245,7 +640,9 @@ PUBLIC int dir_remove(struct inode *dinode, const char *filename)
 	
 	/* Remove directory entry. */
 	d->d_ino = INODE_NULL;
-	buf->flags |= BUFFER_DIRTY;
+	dinode->dfree = 0;
+	dcache_insert(dinode, filename, INODE_NULL);
+	journal_attach(buf, dinode);
 	inode_touch(dinode);
 	file->nlinks--;
 	inode_touch(file);
@@ -256,79 +653,606 @@ PUBLIC int dir_remove(struct inode *dinode, const char *filename)
 }
 
 /*
- * Adds an entry to a directory.
+ * Points an entry of a directory to another inode, if it still points to
+ * the inode old. The entry is removed if num is INODE_NULL. Link counts
+ * are left to the caller.
  */
-PUBLIC int dir_add(struct inode *dinode, struct inode *inode, const char *name)
+PUBLIC int dir_set(struct inode *dinode, const char *filename, ino_t old, ino_t num)
 {
-	struct buffer *buf; /* Block buffer.         */
-	struct d_dirent *d; /* Disk directory entry. */
+	struct buffer *buf; /* Block buffer.    */
+	struct d_dirent *d; /* Directory entry. */
 	
-	d = dirent_search(dinode, name, &buf, 1);
+	d = dirent_search(dinode, filename, &buf, 0);
 	
-	/* Failed to create directory entry. */
+	/* Not found. */
 	if (d == NULL)
-		return (-1);
+		return (-ENOENT);
 	
-	kstrncpy(d->d_name, name, NAME_MAX);
-	d->d_ino = inode->num;
-	buf->flags |= BUFFER_DIRTY;
+	/* Changed under our feet. */
+	if (d->d_ino != old)
+	{
+		brelse(buf);
+		return (-ENOENT);
+	}
+	
+	d->d_ino = num;
+	if (num == INODE_NULL)
+		dinode->dfree = 0;
+	dcache_insert(dinode, filename, num);
+	journal_attach(buf, dinode);
+	inode_touch(dinode);
 	brelse(buf);
 	
 	return (0);
 }
 
 /*
- * Reads from a regular file.
+ * Renames an entry of a directory in place, if it still points to the
+ * inode num. Hashed directories place entries by name, so they are not
+ * renamed in place.
  */
-PUBLIC ssize_t file_read(struct inode *i, void *buf, size_t n, off_t off)
+PUBLIC int dir_rename(struct inode *dinode, const char *filename, ino_t num, const char *newname)
 {
-	char *p;             /* Writing pointer.      */
-	size_t blkoff;       /* Block offset.         */
-	size_t chunk;        /* Data chunk size.      */
-	block_t blk;         /* Working block number. */
-	struct buffer *bbuf; /* Working block buffer. */
-		
-	p = buf;
+	struct buffer *buf; /* Block buffer.    */
+	struct d_dirent *d; /* Directory entry. */
 	
-	inode_lock(i);
+	/* Hashed directory. */
+	if (dirhash_buckets(dinode) > 0)
+		return (-ENOTSUP);
 	
-	/* Read data. */
-	do
+	d = dirent_search(dinode, filename, &buf, 0);
+	
+	/* Not found. */
+	if (d == NULL)
+		return (-ENOENT);
+	
+	/* Changed under our feet. */
+	if (d->d_ino != num)
 	{
-		blk = block_map(i, off, 0);
-		
-		/* End of file reached. */
-		if (blk == BLOCK_NULL)
-			goto out;
+		brelse(buf);
+		return (-ENOENT);
+	}
+	
+	kstrncpy(d->d_name, newname, NAME_MAX);
+	dcache_insert(dinode, filename, INODE_NULL);
+	dcache_insert(dinode, newname, num);
+	journal_attach(buf, dinode);
+	inode_touch(dinode);
+	brelse(buf);
+	
+	return (0);
+}
+
+/*
+ * Adds an entry to a directory.
+ */
+PUBLIC int dir_add(struct inode *dinode, struct inode *inode, const char *name)
+{
+	struct buffer *buf; /* Block buffer.         */
+	struct d_dirent *d; /* Disk directory entry. */
+	
+	/* Hashed directory. */
+	if (dirhash_buckets(dinode) > 0)
+		d = dirent_search(dinode, name, &buf, 1);
+	
+	/*
+	 * Plain directory. Names are looked up through
+	 * the name cache first, so callers that have just
+	 * resolved the name do not scan the directory again.
+	 */
+	else
+	{
+		/* Duplicated entry. */
+		if (dir_search(dinode, name) != INODE_NULL)
+		{
+			curr_proc->errno = EEXIST;
+			return (-1);
+		}
 		
-		bbuf = bread(i->dev, blk);
+		d = dirent_alloc(dinode, &buf);
+	}
+	
+	/* Failed to create directory entry. */
+	if (d == NULL)
+		return (-1);
+	
+	kstrncpy(d->d_name, name, NAME_MAX);
+	d->d_ino = inode->num;
+	dcache_insert(dinode, name, inode->num);
+	journal_attach(buf, dinode);
+	brelse(buf);
+	
+	return (0);
+}
+
+/*
+ * Gets the type of a file in a packed directory entry.
+ */
+PRIVATE unsigned char dirent_type(dev_t dev, ino_t num)
+{
+	mode_t mode;
+	
+	mode = inode_mode(dev, num);
+	
+	if (S_ISREG(mode))
+		return (DT_REG);
+	if (S_ISDIR(mode))
+		return (DT_DIR);
+	if (S_ISCHR(mode))
+		return (DT_CHR);
+	if (S_ISBLK(mode))
+		return (DT_BLK);
+	if (S_ISFIFO(mode))
+		return (DT_FIFO);
+	if (S_ISSOCK(mode))
+		return (DT_SOCK);
+	
+	/* Not cached. */
+	return (DT_UNKNOWN);
+}
+
+/*
+ * Reads packed entries from a directory.
+ */
+PUBLIC ssize_t dir_getdents(struct inode *dip, void *buf, size_t n, off_t *off)
+{
+	size_t len;          /* Name length.                   */
+	size_t reclen;       /* Packed entry length.           */
+	size_t total;        /* Bytes packed.                  */
+	block_t blk;         /* Working block number.          */
+	unsigned i;          /* Working directory entry index. */
+	unsigned nentries;   /* Number of directory entries.   */
+	struct d_dirent *d;  /* Directory entry.               */
+	struct dent *e;      /* Packed entry.                  */
+	struct buffer *bbuf; /* Block buffer.                  */
+	
+	nentries = dip->size/sizeof(struct d_dirent);
+	
+	total = 0;
+	bbuf = NULL;
+	for (i = *off/sizeof(struct d_dirent); i < nentries; i++)
+	{
+		/* Get next block. */
+		if ((bbuf == NULL) || ((i%DIRENTS_PER_BLOCK) == 0))
+		{
+			if (bbuf != NULL)
+				brelse(bbuf);
+			bbuf = NULL;
+			
+			blk = block_map(dip, i*sizeof(struct d_dirent), 0);
+			
+			/* Skip invalid blocks. */
+			if (blk == BLOCK_NULL)
+			{
+				i += DIRENTS_PER_BLOCK - 1 - i%DIRENTS_PER_BLOCK;
+				continue;
+			}
 			
+			bbuf = bread(dip->dev, blk);
+		}
+		
+		d = &((struct d_dirent *)buffer_data(bbuf))[i%DIRENTS_PER_BLOCK];
+		
+		/* Free entry. */
+		if (d->d_ino == INODE_NULL)
+			continue;
+		
+		for (len = 0; (len < NAME_MAX) && (d->d_name[len] != '\0'); len++)
+			/* noop */;
+		reclen = (sizeof(struct dent) + len + 3) & ~3;
+		
+		/* Buffer is full. */
+		if (total + reclen > n)
+			break;
+		
+		e = (struct dent *)((char *)buf + total);
+		e->d_ino = d->d_ino;
+		e->d_reclen = reclen;
+		e->d_type = dirent_type(dip->dev, d->d_ino);
+		kmemcpy(e->d_name, d->d_name, len);
+		e->d_name[len] = '\0';
+		
+		total += reclen;
+	}
+	
+	if (bbuf != NULL)
+		brelse(bbuf);
+	
+	/* Buffer too small for the next entry. */
+	if ((total == 0) && (i < nentries))
+		return (-EINVAL);
+	
+	*off = i*sizeof(struct d_dirent);
+	
+	return (total);
+}
+
+/*
+ * Updates the read-ahead window of a file.
+ */
+PUBLIC unsigned file_readahead(struct file *f, size_t n)
+{
+	/* Random access advised: never read ahead. */
+	if (f->advice == POSIX_FADV_RANDOM)
+		f->ra_size = 0;
+	
+	/* Sequential access advised: keep a wide window. */
+	else if (f->advice == POSIX_FADV_SEQUENTIAL)
+		f->ra_size = READAHEAD_SEQ;
+	
+	/* Sequential access: grow window. */
+	else if (f->pos == f->ra_pos)
+	{
+		f->ra_size = (f->ra_size == 0) ? 1 : f->ra_size << 1;
+		if (f->ra_size > READAHEAD_MAX)
+			f->ra_size = READAHEAD_MAX;
+	}
+	
+	/* Random access: close window. */
+	else
+		f->ra_size = 0;
+	
+	f->ra_pos = f->pos + n;
+	
+	return (f->ra_size);
+}
+
+/*
+ * Reads ahead blocks first to last, relative to the block at offset off.
+ */
+PUBLIC void file_prefetch(struct inode *i, off_t off, unsigned first, unsigned last)
+{
+	block_t blk; /* Working block number. */
+	
+	off -= off % BLOCK_SIZE;
+	
+	for (unsigned k = first; k <= last; k++)
+	{
+		/* End of file reached. */
+		if (off + (off_t)(k*BLOCK_SIZE) >= i->size)
+			break;
+		
+		blk = block_map(i, off + k*BLOCK_SIZE, 0);
+		
+		if (blk == BLOCK_NULL)
+			break;
+		
+		breada(i->dev, blk);
+	}
+}
+
+/*
+ * Applies advice about the use of a range of a regular file.
+ */
+PUBLIC void file_advise(struct inode *i, off_t off, off_t len, int advice)
+{
+	off_t end;   /* End of range.         */
+	block_t blk; /* Working block number. */
+	
+	inode_lock(i);
+	
+	/* Up to the end of file. */
+	end = ((len == 0) || (len > i->size - off)) ? i->size : off + len;
+	
+	off -= off % BLOCK_SIZE;
+	
+	switch (advice)
+	{
+		/* Stream blocks through the cache. */
+		case POSIX_FADV_SEQUENTIAL:
+		case POSIX_FADV_NOREUSE:
+			i->flags |= INODE_ONCE;
+			break;
+		
+		/* Cache blocks as usual. */
+		case POSIX_FADV_NORMAL:
+		case POSIX_FADV_RANDOM:
+			i->flags &= ~INODE_ONCE;
+			break;
+		
+		/* Queue reads, but do not flood the cache. */
+		case POSIX_FADV_WILLNEED:
+			if (end > off + READAHEAD_SEQ*BLOCK_SIZE)
+				end = off + READAHEAD_SEQ*BLOCK_SIZE;
+			for ( ; off < end; off += BLOCK_SIZE)
+			{
+				if ((blk = block_map(i, off, 0)) != BLOCK_NULL)
+					breada(i->dev, blk);
+			}
+			break;
+		
+		/* Drop clean data, dirty data is kept. */
+		case POSIX_FADV_DONTNEED:
+			if (off >= end)
+				break;
+			pcache_forget(i, off >> PAGE_SHIFT, (end - 1) >> PAGE_SHIFT);
+			for ( ; off < end; off += BLOCK_SIZE)
+			{
+				if ((blk = block_map(i, off, 0)) != BLOCK_NULL)
+					bforget(i->dev, blk);
+			}
+			break;
+	}
+	
+	inode_unlock(i);
+}
+
+/*
+ * Zeroed block, read in place of holes.
+ */
+PRIVATE const char zeroes[BLOCK_SIZE] = { 0, };
+
+/*
+ * Fills a page of a regular file, starting at offset off.
+ */
+PUBLIC void file_fillpg(struct inode *i, void *pg, off_t off, unsigned ra)
+{
+	char *p;             /* Writing pointer.      */
+	size_t chunk;        /* Data chunk size.      */
+	block_t blk;         /* Working block number. */
+	struct buffer *bbuf; /* Working block buffer. */
+	
+	/* Queue reads of the whole page first. */
+	file_prefetch(i, off, 1, PAGE_SIZE/BLOCK_SIZE - 1);
+	
+	for (p = pg; p < (char *)pg + PAGE_SIZE; p += BLOCK_SIZE, off += BLOCK_SIZE)
+	{
+		/* Past the end of file. */
+		if (off >= i->size)
+		{
+			kmemset(p, 0, BLOCK_SIZE);
+			continue;
+		}
+		
+		chunk = ((off_t)BLOCK_SIZE > i->size - off) ? i->size - off : BLOCK_SIZE;
+		
+		blk = block_map(i, off, 0);
+		
+		/* Hole. */
+		if (blk == BLOCK_NULL)
+			kmemset(p, 0, chunk);
+		
+		else
+		{
+			bbuf = bread(i->dev, blk);
+			kmemcpy(p, bbuf->data, chunk);
+			if (i->flags & INODE_ONCE)
+				buffer_once(bbuf);
+			brelse(bbuf);
+		}
+		
+		/* Bytes past the end of file read as zero. */
+		if (chunk < BLOCK_SIZE)
+			kmemset(p + chunk, 0, BLOCK_SIZE - chunk);
+	}
+	
+	/* Keep the read-ahead window full past this page. */
+	if (ra > 0)
+		file_prefetch(i, off - BLOCK_SIZE, 1, ra);
+}
+
+/*
+ * Reads from a regular file.
+ */
+PUBLIC ssize_t file_read(struct inode *i, void *buf, size_t n, off_t off, unsigned ra)
+{
+	char *p;             /* Writing pointer.      */
+	char *pg;            /* Page cache page.      */
+	size_t blkoff;       /* Block offset.         */
+	size_t chunk;        /* Data chunk size.      */
+	block_t blk;         /* Working block number. */
+	struct buffer *bbuf; /* Working block buffer. */
+		
+	p = buf;
+	
+	inode_lock_shared(i);
+	
+	/* Read data. */
+	while ((n > 0) && (off < i->size))
+	{
+		/*
+		 * File data is served from the page
+		 * cache. Directories are changed through
+		 * block buffers, so they are not cached.
+		 */
+		if ((S_ISREG(i->mode)) &&
+			((pg = pcache_get(i, off >> PAGE_SHIFT, ra)) != NULL))
+		{
+			chunk = PAGE_SIZE - (off & ~PAGE_MASK);
+			if (chunk > n)
+				chunk = n;
+			if ((off_t)chunk > i->size - off)
+				chunk = i->size - off;
+			
+			kmemcpy(p, pg + (off & ~PAGE_MASK), chunk);
+			pcache_put(pg);
+			
+			n -= chunk;
+			off += chunk;
+			p += chunk;
+			continue;
+		}
+		
 		blkoff = off % BLOCK_SIZE;
 		
 		/* Calculate read chunk size. */
 		chunk = (n < BLOCK_SIZE - blkoff) ? n : BLOCK_SIZE - blkoff;
 		if ((off_t)chunk > i->size - off)
+			chunk = i->size - off;
+		
+		blk = block_map(i, off, 0);
+		
+		/* Hole. */
+		if (blk == BLOCK_NULL)
+			kmemset(p, 0, chunk);
+		
+		else
 		{
+			bbuf = bread(i->dev, blk);
+			
+			/*
+			 * Keep the read-ahead window full while
+			 * the current block is copied out: fill it
+			 * on the first block, then slide its edge.
+			 */
+			if (ra > 0)
+				file_prefetch(i, off, (p == buf) ? 1 : ra, ra);
+			
+			kmemcpy(p, (char *)bbuf->data + blkoff, chunk);
+			if (i->flags & INODE_ONCE)
+				buffer_once(bbuf);
+			brelse(bbuf);
+		}
+		
+		n -= chunk;
+		off += chunk;
+		p += chunk;
+	}
+	
+	inode_access(i);
+	inode_unlock_shared(i);
+	return ((ssize_t)(p - (char *)buf));
+}
+
+/*
+ * Sends data from a regular file to another open file.
+ */
+PUBLIC ssize_t file_send(struct inode *i, struct file *out, size_t n, off_t off, unsigned ra)
+{
+	size_t blkoff;       /* Block offset.         */
+	size_t chunk;        /* Data chunk size.      */
+	block_t blk;         /* Working block number. */
+	struct buffer *bbuf; /* Working block buffer. */
+	ssize_t count;       /* Bytes written.        */
+	ssize_t total;       /* Bytes sent.           */
+	
+	total = 0;
+	
+	/* Delayed writes are not in block buffers. */
+	if (i->ndelay > 0)
+	{
+		inode_lock(i);
+		file_flush(i);
+		inode_unlock(i);
+	}
+	
+	/* Send data. */
+	while (n > 0)
+	{
+		inode_lock_shared(i);
+		
+		/* End of file reached. */
+		if (off >= i->size)
+		{
+			inode_unlock_shared(i);
+			break;
+		}
+		
+		blkoff = off % BLOCK_SIZE;
+		
+		/* Calculate send chunk size. */
+		chunk = (n < BLOCK_SIZE - blkoff) ? n : BLOCK_SIZE - blkoff;
+		if ((off_t)chunk > i->size - off)
 			chunk = i->size - off;
-			if (chunk == 0)
+		
+		blk = block_map(i, off, 0);
+		
+		bbuf = NULL;
+		if (blk != BLOCK_NULL)
+		{
+			bbuf = bread(i->dev, blk);
+			
+			if (ra > 0)
+				file_prefetch(i, off, (total == 0) ? 1 : ra, ra);
+		}
+		
+		inode_access(i);
+		inode_unlock_shared(i);
+		
+		/* Hole. */
+		if (bbuf == NULL)
+			count = do_write(out, zeroes, chunk);
+		
+		/*
+		 * Hand the cached block straight to the
+		 * destination. Our reference keeps the buffer
+		 * from being reassigned, so it is unlocked
+		 * while the destination, which may sleep,
+		 * copies the data out.
+		 */
+		else
+		{
+			blkunlock(bbuf);
+			
+			/* TCP sockets send it in place, and release it once done. */
+			count = -ENOTSUP;
+			if (inet_zerocopy(out, buffer_data(bbuf)))
+				count = inet_sendbuf(out, bbuf, blkoff, chunk);
+			
+			/* Reference taken. */
+			if (count >= 0)
+				bbuf = NULL;
+			else if (count == -ENOTSUP)
+				count = do_write(out, (char *)buffer_data(bbuf) + blkoff, chunk);
+			
+			if (bbuf != NULL)
 			{
+				blklock(bbuf);
 				brelse(bbuf);
-				goto out;
 			}
 		}
 		
-		kmemcpy(p, (char *)bbuf->data + blkoff, chunk);
-		brelse(bbuf);
+		/* Failed to write. */
+		if (count < 0)
+			return ((total > 0) ? total : count);
 		
-		n -= chunk;
-		off += chunk;
-		p += chunk;
-	} while (n > 0);
+		n -= count;
+		off += count;
+		total += count;
+		
+		/* Short write. */
+		if ((size_t)count < chunk)
+			break;
+	}
+	
+	return (total);
+}
 
-out:
-	inode_touch(i);
-	inode_unlock(i);
-	return ((ssize_t)(p - (char *)buf));
+/*
+ * Seeks the next data or hole in a regular file.
+ */
+PUBLIC off_t file_seek(struct inode *i, off_t off, int hole)
+{
+	off_t o;     /* Working offset.       */
+	block_t blk; /* Working block number. */
+	
+	/* Delayed writes are not mapped yet. */
+	if (i->ndelay > 0)
+	{
+		inode_lock(i);
+		file_flush(i);
+		inode_unlock(i);
+	}
+	
+	inode_lock_shared(i);
+	
+	/* Walk blocks. */
+	for (o = off - off%BLOCK_SIZE; o < i->size; o += BLOCK_SIZE)
+	{
+		blk = block_map(i, o, 0);
+		
+		/* Found. */
+		if ((blk == BLOCK_NULL) == (hole != 0))
+		{
+			inode_unlock_shared(i);
+			return ((o > off) ? o : off);
+		}
+	}
+	
+	inode_unlock_shared(i);
+	
+	/* The end of file is a hole. */
+	return ((hole) ? i->size : -ENXIO);
 }
 
 /*
@@ -336,6 +1260,7 @@ out:
  */
 PUBLIC ssize_t file_write(struct inode *i, const void *buf, size_t n, off_t off)
 {
+	int ret;             /* Return value.         */
 	const char *p;       /* Reading pointer.      */
 	size_t blkoff;       /* Block offset.         */
 	size_t chunk;        /* Data chunk size.      */
@@ -344,26 +1269,59 @@ PUBLIC ssize_t file_write(struct inode *i, const void *buf, size_t n, off_t off)
 		
 	p = buf;
 	
+	/* Cached text is now stale. */
+	if (i->flags & INODE_TEXT)
+		droptext(i);
+	
 	inode_lock(i);
 	
 	/* Write data. */
 	do
 	{
+		blkoff = off % BLOCK_SIZE;
+		
+		chunk = (n < BLOCK_SIZE - blkoff) ? n : BLOCK_SIZE - blkoff;
+		
+		/*
+		 * Leave new blocks of regular files in the
+		 * page cache, and give them disk blocks only
+		 * when the file is flushed, so that appends
+		 * are allocated as contiguous runs.
+		 */
+		if ((S_ISREG(i->mode)) && (off < i->sb->max_size) &&
+			(block_map(i, off, 0) == BLOCK_NULL))
+		{
+			if (block_reserve(i) == 0)
+			{
+				if ((ret = pcache_delay(i, off, p, chunk)) <= 0)
+					block_unreserve(i);
+				
+				if (ret >= 0)
+					goto next;
+			}
+			
+			/* Allocate right away, but in file order. */
+			file_flush(i);
+		}
+		
 		blk = block_map(i, off, 1);
 		
 		/* End of file reached. */
 		if (blk == BLOCK_NULL)
 			goto out;
 		
-		bbuf = bread(i->dev, blk);
-		
-		blkoff = off % BLOCK_SIZE;
+		/* Whole block is overwritten, so don't read it. */
+		bbuf = (chunk == BLOCK_SIZE) ? bget(i->dev, blk) : bread(i->dev, blk);
 		
-		chunk = (n < BLOCK_SIZE - blkoff) ? n : BLOCK_SIZE - blkoff;
-		kmemcpy((char *)bbuf->data + blkoff, buf, chunk);
-		bbuf->flags |= BUFFER_DIRTY;
+		kmemcpy((char *)bbuf->data + blkoff, p, chunk);
+		buffer_attach(bbuf, i);
 		brelse(bbuf);
 		
+		/* Write through to the page cache. */
+		pcache_write(i, off, p, chunk);
+
+next:
+		
 		n -= chunk;
 		off += chunk;
 		p += chunk;
@@ -372,7 +1330,7 @@ PUBLIC ssize_t file_write(struct inode *i, const void *buf, size_t n, off_t off)
 		if (off > i->size)
 		{
 			i->size = off;
-			i->flags |= INODE_DIRTY;
+			i->flags |= INODE_DIRTY | INODE_LAYOUT;
 		}
 		
 	} while (n > 0);
@@ -383,3 +1341,220 @@ out:
 	inode_unlock(i);
 	return ((ssize_t)(p - (char *)buf));
 }
+
+/*
+ * Transfers a run of contiguous disk blocks straight between
+ * a user buffer and the device that holds a file.
+ */
+PRIVATE int file_direct_run(struct inode *i, char *p, block_t first, unsigned len, int write)
+{
+	ssize_t ret; /* Bytes transferred. */
+	size_t n;    /* Bytes in the run.  */
+	off_t off;   /* Device offset.     */
+	
+	n = (size_t)len << BLOCK_SIZE_LOG2;
+	off = (off_t)first << BLOCK_SIZE_LOG2;
+	
+	if (write)
+		ret = bdev_write(i->dev, p, n, off);
+	else
+		ret = bdev_read(i->dev, p, n, off);
+	
+	return ((ret == (ssize_t)n) ? 0 : -EIO);
+}
+
+/*
+ * Reads from or writes to a regular file, bypassing the block buffer
+ * and page caches. The user buffer, the file offset and the size must
+ * be multiples of the block size.
+ * 
+ * Runs of contiguous disk blocks go in a single request straight
+ * between the user buffer and the device, which uses DMA when the
+ * buffer is page aligned. To stay coherent with buffered users of the
+ * file, delayed writes get their disk blocks first, blocks found in
+ * the block buffer cache are served through it, and written data goes
+ * through to the page cache.
+ */
+PUBLIC ssize_t file_direct(struct inode *i, void *buf, size_t n, off_t off, int write)
+{
+	int err;             /* Error?                */
+	char *p;             /* Working pointer.      */
+	char *run;           /* Start of current run. */
+	unsigned len;        /* Blocks in the run.    */
+	block_t first;       /* First block of run.   */
+	block_t blk;         /* Working block number. */
+	struct buffer *bbuf; /* Working block buffer. */
+	
+	/* Misaligned transfer. */
+	if ((ADDR(buf) | (addr_t)off | n) & (BLOCK_SIZE - 1))
+	{
+		curr_proc->errno = -EINVAL;
+		return (-1);
+	}
+	
+	/* Cached text is now stale. */
+	if ((write) && (i->flags & INODE_TEXT))
+		droptext(i);
+	
+	inode_lock(i);
+	
+	file_flush(i);
+	
+	/* Do not read past the end of file. */
+	if (!write)
+	{
+		if (off >= i->size)
+			n = 0;
+		else if ((off_t)n > i->size - off)
+			n = (i->size - off + BLOCK_SIZE - 1) & ~(BLOCK_SIZE - 1);
+	}
+	
+	err = 0;
+	len = 0;
+	run = p = buf;
+	first = BLOCK_NULL;
+	for (/* noop */; p < (char *)buf + n; p += BLOCK_SIZE)
+	{
+		blk = block_map(i, off + (p - (char *)buf), write);
+		bbuf = (blk != BLOCK_NULL) ? bcached(i->dev, blk) : NULL;
+		
+#if (BCACHE)
+		/* Going raw, so the demoted copy goes stale. */
+		if ((write) && (blk != BLOCK_NULL) && (bbuf == NULL))
+			bcache_invalidate(i->dev, blk);
+#endif
+		
+		/* Grow the current run. */
+		if ((len > 0) && (bbuf == NULL) && (blk == first + len))
+		{
+			len++;
+			goto next;
+		}
+		
+		/* Transfer the current run. */
+		if ((len > 0) && ((err = file_direct_run(i, run, first, len, write)) < 0))
+		{
+			if (bbuf != NULL)
+				brelse(bbuf);
+			break;
+		}
+		len = 0;
+		
+		/* Hole, or end of file reached. */
+		if (blk == BLOCK_NULL)
+		{
+			if (write)
+				break;
+			kmemset(p, 0, BLOCK_SIZE);
+		}
+		
+		/* Cached block. */
+		else if (bbuf != NULL)
+		{
+			if (write)
+			{
+				kmemcpy(bbuf->data, p, BLOCK_SIZE);
+				buffer_attach(bbuf, i);
+			}
+			else
+				kmemcpy(p, bbuf->data, BLOCK_SIZE);
+			brelse(bbuf);
+		}
+		
+		/* Start a new run. */
+		else
+		{
+			run = p;
+			first = blk;
+			len = 1;
+		}
+		
+next:
+		/* Write through to the page cache. */
+		if (write)
+			pcache_write(i, off + (p - (char *)buf), p, BLOCK_SIZE);
+	}
+	
+	/* Transfer the last run. */
+	if ((len > 0) && ((err = file_direct_run(i, run, first, len, write)) < 0))
+		p = run;
+	
+	else if (err < 0)
+		p = run;
+	
+	n = p - (char *)buf;
+	
+	if (write)
+	{
+		/* Update file size. */
+		if (off + (off_t)n > i->size)
+		{
+			i->size = off + n;
+			i->flags |= INODE_DIRTY | INODE_LAYOUT;
+		}
+		inode_touch(i);
+	}
+	
+	/* Bytes past the end of file were not asked for. */
+	else if (off + (off_t)n > i->size)
+		n = i->size - off;
+	
+	inode_unlock(i);
+	
+	/* Device error. */
+	if ((n == 0) && (err < 0))
+	{
+		curr_proc->errno = err;
+		return (-1);
+	}
+	
+	return ((ssize_t)n);
+}
+
+/*
+ * Allocates disk blocks to the delayed writes of a regular file.
+ */
+PUBLIC void file_flush(struct inode *i)
+{
+	char *pg;            /* Page cache page.      */
+	off_t off;           /* Working offset.       */
+	unsigned mask;       /* Delayed blocks.       */
+	block_t blk;         /* Working block number. */
+	struct buffer *bbuf; /* Working block buffer. */
+	
+	/* Nothing to be done. */
+	if (i->ndelay == 0)
+		return;
+	
+	/* Walk pages in file order, so that blocks are contiguous. */
+	for (unsigned k = 0; (off_t)k << PAGE_SHIFT < i->size; k++)
+	{
+		if ((pg = pcache_undelay(i, k, &mask)) == NULL)
+			continue;
+		
+		for (unsigned j = 0; j < PAGE_SIZE/BLOCK_SIZE; j++)
+		{
+			if (!(mask & (1 << j)))
+				continue;
+			
+			off = ((off_t)k << PAGE_SHIFT) + j*BLOCK_SIZE;
+			
+			if ((blk = block_map(i, off, 1)) == BLOCK_NULL)
+			{
+				kprintf("fs: delayed write lost (inode %d, offset %d)",
+					i->num, (int)off);
+				continue;
+			}
+			
+			bbuf = bget(i->dev, blk);
+			kmemcpy(bbuf->data, pg + j*BLOCK_SIZE, BLOCK_SIZE);
+			buffer_attach(bbuf, i);
+			brelse(bbuf);
+		}
+		
+		pcache_put(pg);
+	}
+	
+	/* Give back zones that were not needed. */
+	block_release(i);
+}
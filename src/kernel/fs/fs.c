@@ -17,19 +17,28 @@
  * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <dev/bootlog.h>
+#include <nanvix/config.h>
 #include <nanvix/const.h>
+#include <nanvix/epoll.h>
 #include <nanvix/fs.h>
 #include <nanvix/klib.h>
 #include <nanvix/mm.h>
 #include <nanvix/pm.h>
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
 #include "fs.h"
 
 #if NR_FILES < OPEN_MAX*NR_PROCS
 	#error "file table too big"
 #endif
 
+#if OPEN_MAX > 32
+	#error "file descriptor bitmap too small"
+#endif
+
 /*
  * Root device.
  */
@@ -45,22 +54,25 @@ PUBLIC struct inode *root = NULL;
  */
 PUBLIC struct file filetab[NR_FILES];
 
+/*
+ * Free file table entries.
+ */
+PRIVATE struct file *free_files = NULL;
+
 /*
  * Gets an empty file descriptor table entry.
  */
 PUBLIC int getfildes(void)
 {
-	int i;
+	bit_t fd;
 	
-	/* Look for empty file descriptor table entry. */
-	for (i = 0; i < OPEN_MAX; i++)
-	{
-		/* Found. */
-		if (curr_proc->ofiles[i] == NULL)
-			return (i);
-	}
+	fd = bitmap_first_free(&curr_proc->ofmap, sizeof(curr_proc->ofmap));
+	
+	/* Too many opened files. */
+	if ((fd == BITMAP_FULL) || (fd >= OPEN_MAX))
+		return (-1);
 	
-	return (-1);
+	return (fd);
 }
 
 /*
@@ -70,15 +82,24 @@ PUBLIC struct file *getfile(void)
 {
 	struct file *f;
 	
-	/* Look for empty file table entry. */
-	for (f = &filetab[0]; f < &filetab[NR_FILES]; f++)
-	{
-		/* Found. */
-		if (f->count == 0)
-			return (f);
-	}
+	/* File table overflow. */
+	if ((f = free_files) == NULL)
+		return (NULL);
+	
+	free_files = f->free_next;
+	f->free_next = NULL;
 	
-	return (NULL);
+	return (f);
+}
+
+/*
+ * Puts back an unused file table entry.
+ */
+PUBLIC void putfile(struct file *f)
+{
+	f->count = 0;
+	f->free_next = free_files;
+	free_files = f;
 }
 
 
@@ -87,8 +108,7 @@ PUBLIC struct file *getfile(void)
  */
 PUBLIC void do_close(int fd)
 {
-	struct inode *i; /* Inode. */
-	struct file *f;  /* File.  */
+	struct file *f; /* File. */
 	
 	f = curr_proc->ofiles[fd];
 	
@@ -97,12 +117,27 @@ PUBLIC void do_close(int fd)
 		return;
 	
 	curr_proc->close &= ~(1 << fd);
+	curr_proc->ofmap &= ~(1 << fd);
 	curr_proc->ofiles[fd] = NULL;	
 	
+	releasefile(f);
+}
+
+/*
+ * Releases a reference to an open file.
+ */
+PUBLIC void releasefile(struct file *f)
+{
+	struct inode *i; /* Inode. */
+	
 	if (--f->count)
 		return;
 	
-	inode_lock(i = f->inode);
+	i = f->inode;
+	epoll_forget(f);
+	putfile(f);
+	
+	inode_lock(i);
 	inode_put(i);
 }
 
@@ -132,6 +167,11 @@ PUBLIC mode_t permission(mode_t mode, uid_t uid, gid_t gid, struct process *proc
 	return (mode);
 }
 
+/*
+ * Path names copied from user space.
+ */
+PRIVATE struct kcache names = KCACHE("names", PATH_MAX, NULL);
+
 /*
  * Gets a user file name
  */
@@ -142,8 +182,8 @@ PUBLIC char *getname(const char *name)
 	const char *r; /* Read pointer.        */
 	char *w;       /* Write pointer.       */
 	
-	/* Grab a kernel page. */
-	if ((kname = getkpg(0)) == NULL)
+	/* Grab a path name buffer. */
+	if ((kname = kcache_alloc(&names)) == NULL)
 	{
 		curr_proc->errno = -ENOMEM;
 		return (NULL);
@@ -155,16 +195,16 @@ PUBLIC char *getname(const char *name)
 		/* Bad user file name. */
 		if (ch < 0)
 		{
-			putkpg(kname);
+			kcache_free(kname);
 			curr_proc->errno = -EFAULT;
 			return (NULL);
 			
 		}
 		
 		/* File name too long. */
-		if ((w - kname) > PAGE_SIZE - 1)
+		if ((w - kname) >= PATH_MAX - 1)
 		{
-			putkpg(kname);
+			kcache_free(kname);
 			curr_proc->errno = -ENAMETOOLONG;
 			return (NULL);
 		}
@@ -182,7 +222,161 @@ PUBLIC char *getname(const char *name)
  */
 PUBLIC void putname(char *name)
 {
-	putkpg(name);
+	kcache_free(name);
+}
+
+/*
+ * Gets the directory that a relative path given to an *at() system call
+ * is looked up from.
+ */
+PUBLIC struct inode *getdirfd(int dirfd, const char *path)
+{
+	struct file *f; /* Directory file. */
+	
+	/* Absolute path or working directory. */
+	if ((*path == '/') || (dirfd == AT_FDCWD))
+		return (curr_proc->pwd);
+	
+	/* Invalid file descriptor. */
+	if ((dirfd < 0) || (dirfd >= OPEN_MAX) || ((f = curr_proc->ofiles[dirfd]) == NULL))
+	{
+		curr_proc->errno = -EBADF;
+		return (NULL);
+	}
+	
+	/* Not a directory. */
+	if (!S_ISDIR(f->inode->mode))
+	{
+		curr_proc->errno = -ENOTDIR;
+		return (NULL);
+	}
+	
+	return (f->inode);
+}
+
+/*
+ * Gets the absolute path name of a path, resolving dot and dot-dot
+ * entries against the working directory path. No symbolic links exist,
+ * so this agrees with path lookup.
+ */
+PUBLIC char *abspath(const char *path)
+{
+	char *abs;      /* Absolute path name. */
+	char *end;      /* End of that path.   */
+	const char *p;  /* Read pointer.       */
+	size_t len;     /* Name length.        */
+	
+	/* Working directory path is unknown. */
+	if ((*path != '/') && (curr_proc->cwd[0] == '\0'))
+		return (NULL);
+	
+	if ((abs = kcache_alloc(&names)) == NULL)
+		return (NULL);
+	
+	kstrcpy(abs, (*path == '/') ? "/" : curr_proc->cwd);
+	end = abs + kstrlen(abs);
+	
+	for (p = path; /* noop */ ; p += len)
+	{
+		while (*p == '/')
+			p++;
+		
+		for (len = 0; (p[len] != '\0') && (p[len] != '/'); len++)
+			/* noop */ ;
+		
+		/* Done. */
+		if (len == 0)
+			break;
+		
+		/* Dot. */
+		if ((len == 1) && (p[0] == '.'))
+			continue;
+		
+		/* Dot-dot. */
+		if ((len == 2) && (p[0] == '.') && (p[1] == '.'))
+		{
+			while ((end > abs + 1) && (*(end - 1) != '/'))
+				end--;
+			if (end > abs + 1)
+				end--;
+			*end = '\0';
+			continue;
+		}
+		
+		/* Path name too long. */
+		if ((end - abs) + len + 2 > PATH_MAX)
+		{
+			kcache_free(abs);
+			return (NULL);
+		}
+		
+		if (end > abs + 1)
+			*end++ = '/';
+		kmemcpy(end, p, len);
+		end += len;
+		*end = '\0';
+	}
+	
+	return (abs);
+}
+
+/*
+ * Fixes working directory paths after the directory from was renamed to
+ * to. Both are absolute paths as seen from the root directory of the
+ * current process. Paths of processes with other root directories can
+ * not be told apart, so they become unknown.
+ */
+PUBLIC void cwd_rename(const char *from, const char *to)
+{
+	size_t i;          /* Loop index.       */
+	size_t len;        /* Length of from.   */
+	size_t tolen;      /* Length of to.     */
+	size_t rest;       /* Remaining length. */
+	struct process *p; /* Working process.  */
+	
+	len = kstrlen(from);
+	tolen = kstrlen(to);
+	
+	for (p = IDLE; p <= LAST_PROC; p++)
+	{
+		/* Skip invalid processes. */
+		if ((!IS_VALID(p)) || (p->cwd[0] == '\0'))
+			continue;
+		
+		if (p->root != curr_proc->root)
+		{
+			p->cwd[0] = '\0';
+			continue;
+		}
+		
+		/* Not below the renamed directory. */
+		if ((kstrncmp(p->cwd, from, len)) ||
+			((p->cwd[len] != '/') && (p->cwd[len] != '\0')))
+			continue;
+		
+		rest = kstrlen(&p->cwd[len]);
+		
+		/* Path name too long. */
+		if (tolen + rest + 1 > PATH_MAX)
+		{
+			p->cwd[0] = '\0';
+			continue;
+		}
+		
+		/* Shift the rest of the path. */
+		if (tolen > len)
+		{
+			for (i = rest + 1; i-- > 0; /* noop */)
+				p->cwd[tolen + i] = p->cwd[len + i];
+		}
+		else
+		{
+			for (i = 0; i <= rest; i++)
+				p->cwd[tolen + i] = p->cwd[len + i];
+		}
+		
+		kmemcpy(p->cwd, to, tolen);
+	}
 }
 
 /*
@@ -190,14 +384,20 @@ PUBLIC void putname(char *name)
  */
 PUBLIC void fs_init(void)
 {
+	/* Build free list of file table entries. */
+	for (int k = NR_FILES - 1; k >= 0; k--)
+		putfile(&filetab[k]);
+	
 	binit();
 	inode_init();
+	dcache_init();
 	superblock_init();
 	
 	/* Sanity check. */
 	CHKSIZE(sizeof(struct d_dirent), sizeof(struct dirent));
 
-	rootdev = superblock_read(ROOT_DEV);
+	boot_mark("root mount");
+	rootdev = superblock_read(ROOT_DEV, ROOT_MNTOPT);
 	
 	/* Failed to read root super block. */
 	if (rootdev == NULL)
@@ -216,7 +416,12 @@ PUBLIC void fs_init(void)
 	/* Hand craft idle process. */
 	IDLE->pwd = root;
 	IDLE->root = root;
+	kstrcpy(IDLE->cwd, "/");
 	root->count += 2;
 	
 	inode_unlock(root);
+	
+#if (BOOT_PREFETCH)
+	boot_prefetch();
+#endif
 }
@@ -45,10 +45,16 @@
 	 */
 	enum buffer_flags
 	{
-		BUFFER_DIRTY  = (1 << 0), /**< Dirty?             */
-		BUFFER_VALID  = (1 << 1), /**< Valid?             */
-		BUFFER_LOCKED = (1 << 2), /**< Locked?            */
-		BUFFER_SYNC   = (1 << 3)  /**< Synchronous write? */
+		BUFFER_DIRTY   = (1 << 0), /**< Dirty?             */
+		BUFFER_VALID   = (1 << 1), /**< Valid?             */
+		BUFFER_LOCKED  = (1 << 2), /**< Locked?            */
+		BUFFER_SYNC    = (1 << 3), /**< Synchronous write? */
+		BUFFER_ASYNC   = (1 << 4), /**< Asynchronous read? */
+		BUFFER_HOT     = (1 << 5), /**< Frequently used?   */
+		BUFFER_DIRECT  = (1 << 6), /**< Mapped in place?   */
+		BUFFER_JOURNAL = (1 << 7), /**< Being logged?      */
+		BUFFER_COMMIT  = (1 << 8), /**< Being committed?   */
+		BUFFER_ONCE    = (1 << 9)  /**< Used once?         */
 	};
 
 	/**
@@ -63,6 +69,7 @@
 		dev_t dev;      /**< Device.          */
 		block_t num;    /**< Block number.    */
 		void *data;     /**< Underlying data. */
+		void *mem;      /**< Own data area.   */
 		unsigned count; /**< Reference count. */
 		/**@}*/
 		
@@ -70,8 +77,11 @@
 		 * @name Status information
 		 */
 		/**@{*/
-		enum buffer_flags flags; /**< Flags.          */
-		struct process *chain;   /**< Sleeping chain. */
+		enum buffer_flags flags; /**< Flags.                     */
+		struct waitq chain;      /**< Sleeping chain.            */
+		unsigned age;            /**< Dirty since (clock ticks). */
+		struct process *holder;  /**< Lock holder.               */
+		unsigned waits;          /**< Sleeps waiting for lock.   */
 		/**@}*/
 		
 		/**
@@ -83,19 +93,66 @@
 		struct buffer *hash_next; /**< Next buffer in the hash table.     */
 		struct buffer *hash_prev; /**< Previous buffer in the hash table. */
 		/**@}*/
+		
+		/**
+		 * @name Ownership information.
+		 */
+		/**@{*/
+		struct inode *owner;       /**< File that dirtied the buffer.     */
+		struct buffer *owner_next; /**< Next dirty buffer of the file.     */
+		struct buffer *owner_prev; /**< Previous dirty buffer of the file. */
+		/**@}*/
 	};
 	
+	/**
+	 * @brief Maximum read-ahead window (in blocks).
+	 */
+	#define READAHEAD_MAX 8
+	
+	/**
+	 * @brief Read-ahead window of files advised as sequential (in blocks).
+	 */
+	#define READAHEAD_SEQ (4*READAHEAD_MAX)
+	
 	/**@}*/
 	
 	/* Forward definitions. */
 	EXTERN void binit(void);
+	EXTERN void bwritew(struct buffer *);
+	EXTERN void bsync_inode(struct inode *);
+	EXTERN void buffer_attach(struct buffer *, struct inode *);
+	EXTERN void buffer_detach(struct inode *);
+	EXTERN void boot_prefetch(void);
+	EXTERN void boot_record(dev_t, block_t);
+	EXTERN void bcache_init(void);
+	EXTERN void bcache_put(const struct buffer *);
+	EXTERN int bcache_get(struct buffer *);
+	EXTERN void bcache_drop(void);
 	
 /*============================================================================*
  *                               Inode Library                                *
  *============================================================================*/
 	
+	/**
+	 * @brief Number of directory hash buckets of an inode is not known yet.
+	 */
+	#define DIRHASH_UNKNOWN 0xffffffff
+	
 	/* Forward definitions. */
 	EXTERN void inode_init(void);
+	EXTERN unsigned inode_busy(void);
+	EXTERN void inode_quiesce(void);
+
+/*============================================================================*
+ *                       Directory Name Cache Library                         *
+ *============================================================================*/
+	
+	/* Forward definitions. */
+	EXTERN void dcache_init(void);
+	EXTERN int dcache_lookup(struct inode *, const char *, ino_t *);
+	EXTERN void dcache_insert(struct inode *, const char *, ino_t);
+	EXTERN void dcache_purge(dev_t, ino_t);
+	EXTERN void dcache_flush(void);
 
 /*============================================================================*
  *                            Super Block Library                             *
@@ -107,26 +164,76 @@
  	/**@{*/
 	
 	/**
-	 * @brief Maximum inode map size (in bytes).
+	 * @brief Maximum inode map size (in blocks).
+	 */
+	#define IMAP_SIZE \
+		((HDD_SIZE + BLOCK_SIZE*BLOCK_SIZE*8 - 1)/(BLOCK_SIZE*BLOCK_SIZE*8))
+	
+	/**
+	 * @brief Maximum zone map size (in blocks).
+	 */
+	#define ZMAP_SIZE \
+		((HDD_SIZE + BLOCK_SIZE*BLOCK_SIZE*8 - 1)/(BLOCK_SIZE*BLOCK_SIZE*8))
+	
+	/**
+	 * @brief Maximum preallocation window of a file (in blocks).
 	 */
-	#define IMAP_SIZE (HDD_SIZE/(BLOCK_SIZE*BLOCK_SIZE*8))
+	#define PREALLOC_MAX 8
 	
 	/**
-	 * @brief Maximum zone map size (in bytes).
+	 * @brief Maximum number of deferred block frees.
 	 */
-	#define ZMAP_SIZE (HDD_SIZE/(BLOCK_SIZE*BLOCK_SIZE*8))
+	#define NR_FREE_PENDING 32
+	
+	/**
+	 * @brief Allocation group of an inode.
+	 */
+	#define INODE_GROUP(sb, num) \
+		((((num) - 1)*NR_GROUPS)/(sb)->ninodes)
+	
+	/**
+	 * @brief First inode of an allocation group.
+	 */
+	#define GROUP_INODE(sb, g) \
+		(((g)*(sb)->ninodes + NR_GROUPS - 1)/NR_GROUPS + 1)
+	
+	/**
+	 * @brief Number of data zones of a file system.
+	 */
+	#define NR_DATA_ZONES(sb) \
+		((sb)->zones - (sb)->first_data_block)
+	
+	/**
+	 * @brief Allocation group of a data zone.
+	 */
+	#define ZONE_GROUP(sb, num) \
+		((((num) - (sb)->first_data_block)*NR_GROUPS)/NR_DATA_ZONES(sb))
+	
+	/**
+	 * @brief First data zone of an allocation group.
+	 */
+	#define GROUP_ZONE(sb, g) \
+		((sb)->first_data_block + \
+		((g)*NR_DATA_ZONES(sb) + NR_GROUPS - 1)/NR_GROUPS)
 
 	/**
 	 * @brief Superblock flags.
 	 */
 	enum superblock_flags
 	{
-		SUPERBLOCK_RDONLY = (1 << 0), /**< Read only?        */
-		SUPERBLOCK_LOCKED = (1 << 1), /**< Locked?           */
-		SUPERBLOCK_DIRTY  = (1 << 2), /**< Dirty?            */
-		SUPERBLOCK_VALID  = (1 << 3)  /**< Valid superblock? */
+		SUPERBLOCK_RDONLY   = (1 << 0), /**< Read only?          */
+		SUPERBLOCK_LOCKED   = (1 << 1), /**< Locked?             */
+		SUPERBLOCK_DIRTY    = (1 << 2), /**< Dirty?              */
+		SUPERBLOCK_VALID    = (1 << 3), /**< Valid superblock?   */
+		SUPERBLOCK_NOATIME  = (1 << 4), /**< No access times?    */
+		SUPERBLOCK_RELATIME = (1 << 5)  /**< Lazy access times?  */
 	};
 	
+	/**
+	 * @brief Age (in seconds) after which a lazy access time is updated.
+	 */
+	#define RELATIME_AGE (24*60*60)
+	
 	/**
 	 * @brief In-core superblock.
 	 */
@@ -146,11 +253,32 @@
 		struct inode *mp;               /**< Inode mounted on.             */
 		dev_t dev;                      /**< Underlying device.            */
 		enum superblock_flags flags;    /**< Flags.                        */
-		ino_t isearch;		            /**< Inodes below this are in use. */
-		block_t zsearch;		        /**< Zones below this are in use.  */
-		struct process *chain;          /**< Waiting chain.                */
+		block_t zfree;                  /**< Number of free zones.         */
+		block_t gzfree[NR_GROUPS];      /**< Free zones per group.         */
+		block_t zdelay;                 /**< Zones held by delayed writes. */
+		ino_t ifree;                    /**< Number of free inodes.        */
+		ino_t gifree[NR_GROUPS];        /**< Free inodes per group.        */
+		struct waitq chain;             /**< Waiting chain.                */
+		struct process *holder;         /**< Lock holder.                  */
+		unsigned waits;                 /**< Sleeps waiting for the lock.  */
+		struct journal *journal;        /**< Metadata journal, if any.     */
 	};
 	
+	/* Forward definitions. */
+	EXTERN bit_t superblock_search(struct buffer **, block_t, bit_t, bit_t);
+	
 	/**@}*/
 
+/*============================================================================*
+ *                              Journal Library                               *
+ *============================================================================*/
+	
+	/* Forward definitions. */
+	EXTERN int journal_open(struct superblock *, dev_t, const struct d_superblock *);
+	EXTERN void journal_close(struct superblock *);
+	EXTERN void journal_dirty(struct superblock *, struct buffer *);
+	EXTERN void journal_attach(struct buffer *, struct inode *);
+	EXTERN void journal_revoke(struct superblock *, struct buffer *);
+	EXTERN void journal_commit(struct superblock *);
+
 #endif /* _FS_H_ */
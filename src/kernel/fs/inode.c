@@ -30,39 +30,141 @@
 #include <nanvix/fs.h>
 #include <nanvix/klib.h>
 #include <nanvix/mm.h>
+#include <nanvix/region.h>
+#include <nanvix/socket.h>
 #include <errno.h>
 #include <limits.h>
+#include <sys/cachestat.h>
+#include <sys/lockstat.h>
 #include "fs.h"
 
 /* Number of inodes per block. */
 #define INODES_PER_BLOCK (BLOCK_SIZE/sizeof(struct d_inode))
 
+/* Disk block that holds an inode. */
+#define INODE_BLOCK(sb, num) \
+	(2 + (sb)->imap_blocks + (sb)->zmap_blocks + ((num) - 1)/INODES_PER_BLOCK)
+
+/**
+ * @brief Number of in-core inodes.
+ */
+#define NR_INODES ((MEMORY_SIZE >> 20)*INODES_PER_MB)
+
+/**
+ * @brief Maximum hash table size.
+ */
+#define HASHTAB_MAX 1543
+
 /**
  * @brief In-core inodes table.
  */
 PRIVATE struct inode inodes[NR_INODES];
 
+/**
+ * @brief Pipe states.
+ */
+PRIVATE struct kcache pipes = KCACHE("pipes", sizeof(struct pipe), NULL);
+
 /**
  * @brief Hash table size.
  */
-#define HASHTAB_SIZE 227
+PRIVATE unsigned nr_hash = 0;
 
-/* Free inodes. */
-PRIVATE struct inode *free_inodes = NULL;
+/**
+ * @brief Unused inodes.
+ * 
+ * @details Inodes that are not referenced are kept in this list, invalid ones
+ *          at the head and valid ones at the tail, in least recently used
+ *          order. Valid inodes stay in the hash table, so that a file that
+ *          is opened again is found in the inode cache.
+ */
+PRIVATE struct inode *free_head = NULL;
+PRIVATE struct inode *free_tail = NULL;
 
 /* Inodes hash table. */
-PRIVATE struct inode *hashtab[HASHTAB_SIZE];
+PRIVATE struct inode *hashtab[HASHTAB_MAX];
+
+/* Inode cache statistics. */
+PRIVATE struct cachestat stats;
+
+/**
+ * @brief Number of inodes locked exclusively.
+ */
+PRIVATE unsigned nlocked = 0;
+
+/**
+ * @brief Processes waiting for no inode to be locked exclusively.
+ */
+PRIVATE struct waitq quiesce_chain = WAITQ_INITIALIZER;
 
 /**
  * @brief Hash function for the inode cache.
  */
 #define HASH(dev, num) \
-	(((dev)^(num))%HASHTAB_SIZE)
+	(((dev)^(num))%nr_hash)
+
+/**
+ * @brief Removes an inode from the unused inode list.
+ * 
+ * @param ip Inode to be removed.
+ */
+PRIVATE void free_remove(struct inode *ip)
+{
+	if (ip->free_prev != NULL)
+		ip->free_prev->free_next = ip->free_next;
+	else
+		free_head = ip->free_next;
+	if (ip->free_next != NULL)
+		ip->free_next->free_prev = ip->free_prev;
+	else
+		free_tail = ip->free_prev;
+	
+	ip->free_next = NULL;
+	ip->free_prev = NULL;
+}
+
+/**
+ * @brief Inserts an inode in the unused inode list.
+ * 
+ * @param ip   Inode to be inserted.
+ * @param tail Insert at the tail?
+ */
+PRIVATE void free_insert(struct inode *ip, int tail)
+{
+	/* Most recently used. */
+	if (tail)
+	{
+		ip->free_next = NULL;
+		ip->free_prev = free_tail;
+		if (free_tail != NULL)
+			free_tail->free_next = ip;
+		else
+			free_head = ip;
+		free_tail = ip;
+	}
+	
+	/* Reuse first. */
+	else
+	{
+		ip->free_prev = NULL;
+		ip->free_next = free_head;
+		if (free_head != NULL)
+			free_head->free_prev = ip;
+		else
+			free_tail = ip;
+		free_head = ip;
+	}
+}
+
+/* Forward definitions. */
+PRIVATE void inode_cache_remove(struct inode *);
 
 /**
  * @brief Evicts an free inode from the inode cache
  * 
- * @details Searches the inode cache for a free inode and returns it.
+ * @details Takes the least recently used inode out of the unused inode list.
+ *          If that inode still caches a file, it is dropped from the hash
+ *          table first.
  * 
  * @returns If a free inode is found, that inode is locked and then returned.
  *          However, no there is no free inode, a #NULL pointer is returned
@@ -78,19 +180,27 @@ PRIVATE struct inode *inode_cache_evict(void)
 	 * may indicate that inode cache
 	 * is too small.
 	 */
-	if (free_inodes == NULL)
+	if (free_head == NULL)
 	{
 		kprintf("fs: inode table overflow");
 		return (NULL);
 	}
 	
 	/* Remove inode from free list. */
-	ip = free_inodes;
-	free_inodes = free_inodes->free_next;
+	free_remove(ip = free_head);
 	
 	ip->count++;
 	inode_lock(ip);
 	
+	/* Forget cached file. */
+	if (ip->flags & INODE_VALID)
+	{
+		pcache_purge(ip);
+		inode_cache_remove(ip);
+		ip->flags &= ~INODE_VALID;
+		stats.evictions++;
+	}
+	
 	return (ip);
 }
 
@@ -108,6 +218,7 @@ PRIVATE void inode_cache_insert(struct inode *ip)
 	unsigned i;
 	
 	i = HASH(ip->dev, ip->num);
+	ip->waits = 0;
 	
 	/* Insert the inode in the hash table. */
 	ip->hash_next = hashtab[i];
@@ -137,6 +248,34 @@ PRIVATE void inode_cache_remove(struct inode *ip)
 		ip->hash_next->hash_prev = ip->hash_prev;
 }
 
+/**
+ * @brief Copies an inode to its disk inode.
+ * 
+ * @param ip  Inode to be copied.
+ * @param buf Buffer holding the inode block of @p ip.
+ * 
+ * @note The inode must be locked.
+ * @note The buffer must be locked.
+ */
+PRIVATE void inode_copy(struct inode *ip, struct buffer *buf)
+{
+	struct d_inode *d_i; /* Disk inode. */
+	
+	d_i = &(((struct d_inode *)buf->data)[(ip->num - 1)%INODES_PER_BLOCK]);
+	
+	/* Write inode to buffer. */
+	d_i->i_mode = ip->mode;
+	d_i->i_nlinks = ip->nlinks;
+	d_i->i_uid = ip->uid;
+	d_i->i_gid = ip->gid;
+	d_i->i_size = ip->size;
+	d_i->i_time = ip->time;
+	for (unsigned i = 0; i < NR_ZONES; i++)
+		d_i->i_zones[i] = ip->blocks[i];
+	ip->flags &= ~INODE_DIRTY;
+	stats.writebacks++;
+}
+
 /**
  * @brief Writes an inode to disk.
  * 
@@ -150,7 +289,6 @@ PRIVATE void inode_write(struct inode *ip)
 {
 	block_t blk;           /* Block.       */
 	struct buffer *buf;    /* Buffer.      */
-	struct d_inode *d_i;   /* Disk inode.  */
 	struct superblock *sb; /* Super block. */
 	
 	/* Nothing to be done. */
@@ -159,7 +297,7 @@ PRIVATE void inode_write(struct inode *ip)
 	
 	superblock_lock(sb = ip->sb);
 	
-	blk = 2 + sb->imap_blocks + sb->zmap_blocks + (ip->num - 1)/INODES_PER_BLOCK;
+	blk = INODE_BLOCK(sb, ip->num);
 	
 	/* Read chunk of disk inodes. */
 	buf = bread(ip->dev, blk);
@@ -169,19 +307,8 @@ PRIVATE void inode_write(struct inode *ip)
 		superblock_unlock(sb);
 	}
 	
-	d_i = &(((struct d_inode *)buf->data)[(ip->num - 1)%INODES_PER_BLOCK]);
-	
-	/* Write inode to buffer. */
-	d_i->i_mode = ip->mode;
-	d_i->i_nlinks = ip->nlinks;
-	d_i->i_uid = ip->uid;
-	d_i->i_gid = ip->gid;
-	d_i->i_size = ip->size;
-	d_i->i_time = ip->time;
-	for (unsigned i = 0; i < NR_ZONES; i++)
-		d_i->i_zones[i] = ip->blocks[i];
-	ip->flags &= ~INODE_DIRTY;
-	buffer_dirty(buf, 1);
+	inode_copy(ip, buf);
+	journal_dirty(sb, buf);
 	
 	brelse(buf);
 	superblock_unlock(sb);
@@ -216,7 +343,7 @@ PRIVATE struct inode *inode_read(dev_t dev, ino_t num)
 		goto error0;	
 	
 	/* Calculate block number. */
-	blk = 2 + sb->imap_blocks + sb->zmap_blocks + (num - 1)/INODES_PER_BLOCK;
+	blk = INODE_BLOCK(sb, num);
 	
 	/* Read chunk of disk inodes. */
 	buf = bread(dev, blk);
@@ -249,7 +376,16 @@ PRIVATE struct inode *inode_read(dev_t dev, ino_t num)
 	ip->dev = dev;
 	ip->num = num;
 	ip->sb = sb;
-	ip->flags &= ~(INODE_DIRTY | INODE_MOUNT | INODE_PIPE);
+	ip->goal = BLOCK_NULL;
+	ip->pa_count = 0;
+	ip->nbuckets = DIRHASH_UNKNOWN;
+	ip->dfree = 0;
+	ip->map_len = 0;
+	ip->map_ind = BLOCK_NULL;
+	ip->dirty = NULL;
+	ip->sock = NULL;
+	ip->flags &= ~(INODE_DIRTY | INODE_MOUNT | INODE_PIPE | INODE_LAYOUT);
+	ip->flags &= ~(INODE_TEXT | INODE_ONCE | INODE_SOCKET);
 	ip->flags |= INODE_VALID;
 	
 	brelse(buf);
@@ -277,13 +413,17 @@ PRIVATE void inode_free(struct inode *ip)
 	
 	blk = (ip->num - 1)/(BLOCK_SIZE << 3);
 	
+	/* Forget cached names of the directory. */
+	if (S_ISDIR(ip->mode))
+		dcache_purge(ip->dev, ip->num);
+	
 	superblock_lock(sb = ip->sb);
 	
 	bitmap_clear(sb->imap[blk]->data, (ip->num - 1)%(BLOCK_SIZE << 3));
 	
-	sb->imap[blk]->flags |= BUFFER_DIRTY;
-	if (ip->num < sb->isearch)
-		sb->isearch = ip->num;
+	journal_dirty(sb, sb->imap[blk]);
+	sb->ifree++;
+	sb->gifree[INODE_GROUP(sb, ip->num)]++;
 	sb->flags |= SUPERBLOCK_DIRTY;
 	
 	superblock_unlock(sb);
@@ -292,13 +432,85 @@ PRIVATE void inode_free(struct inode *ip)
 /**
  * @brief Locks an inode.
  * 
- * @details Locks the inode pointed to by @p ip.
+ * @details Locks the inode pointed to by @p ip exclusively, waiting for
+ *          shared holders to release it.
  */
 PUBLIC void inode_lock(struct inode *ip)
 {
-	while (ip->flags & INODE_LOCKED)
-		sleep(&ip->chain, PRIO_INODE);
+	while ((ip->flags & INODE_LOCKED) || (ip->readers > 0))
+	{
+		stats.waits++;
+		ip->waits++;
+		lock_wait(LOCK_INODE, ip->holder, PRIO_INODE);
+		ip->xwaiters++;
+		sleep_excl(&ip->chain, PRIO_INODE);
+		ip->xwaiters--;
+	}
 	ip->flags |= INODE_LOCKED;
+	ip->holder = curr_proc;
+	lock_acquire(LOCK_INODE);
+	nlocked++;
+}
+
+/**
+ * @brief Locks an inode in shared mode.
+ * 
+ * @details Locks the inode pointed to by @p ip for reading, along with
+ *          other shared holders. Processes waiting for an exclusive lock
+ *          go first, so that a stream of readers does not starve them.
+ * 
+ * @param ip Inode to be locked.
+ * 
+ * @note Shared holders must not change the file.
+ */
+PUBLIC void inode_lock_shared(struct inode *ip)
+{
+	while ((ip->flags & INODE_LOCKED) || (ip->xwaiters > 0))
+	{
+		stats.waits++;
+		ip->waits++;
+		lock_wait(LOCK_INODE, ip->holder, PRIO_INODE);
+		sleep(&ip->chain, PRIO_INODE);
+	}
+	ip->readers++;
+	lock_acquire(LOCK_INODE);
+}
+
+/**
+ * @brief Unlocks an inode locked in shared mode.
+ * 
+ * @param ip Inode to be unlocked.
+ * 
+ * @note The inode must be locked in shared mode.
+ */
+PUBLIC void inode_unlock_shared(struct inode *ip)
+{
+	if (--ip->readers == 0)
+		wakeup(&ip->chain);
+}
+
+/**
+ * @brief Turns a shared lock on an inode into an exclusive one.
+ * 
+ * @details The lock is taken over right away if the caller is its sole
+ *          holder. Otherwise, it is released and taken again.
+ * 
+ * @param ip Inode locked in shared mode.
+ */
+PRIVATE void inode_upgrade(struct inode *ip)
+{
+	/* Sole holder. */
+	if (ip->readers == 1)
+	{
+		ip->readers = 0;
+		ip->flags |= INODE_LOCKED;
+		ip->holder = curr_proc;
+		nlocked++;
+		return;
+	}
+	
+	inode_unlock_shared(ip);
+	inode_lock(ip);
 }
 
 /**
@@ -312,32 +524,185 @@ PUBLIC void inode_lock(struct inode *ip)
  */
 PUBLIC void inode_unlock(struct inode *ip)
 {
+	lock_release(ip->holder);
+	ip->holder = NULL;
 	wakeup(&ip->chain);
 	ip->flags &= ~INODE_LOCKED;
+	
+	if (--nlocked == 0)
+		wakeup(&quiesce_chain);
+}
+
+/**
+ * @brief Counts inodes locked exclusively.
+ * 
+ * @returns The number of inodes currently locked exclusively.
+ */
+PUBLIC unsigned inode_busy(void)
+{
+	return (nlocked);
+}
+
+/**
+ * @brief Waits for no inode to be locked exclusively.
+ * 
+ * @details Puts the calling process to sleep until no file is being changed,
+ *          which is when a journal commit gets whole operations only.
+ * 
+ * @note The calling process must not hold an inode lock.
+ */
+PUBLIC void inode_quiesce(void)
+{
+	while (nlocked > 0)
+		sleep(&quiesce_chain, PRIO_INODE);
+}
+
+/**
+ * @brief Asserts if an inode has to be written back.
+ */
+#define INODE_WRITEBACK(ip) \
+	(((ip)->flags & (INODE_VALID|INODE_DIRTY|INODE_PIPE|INODE_SOCKET)) == \
+		(INODE_VALID | INODE_DIRTY))
+
+/**
+ * @brief Allocates disk blocks to old delayed writes.
+ * 
+ * @details Flushes, with file_flush(), the files whose writes have been
+ *          delayed for at least @p age clock ticks.
+ * 
+ * @param age Minimum age (in clock ticks).
+ */
+PUBLIC void inode_flush(unsigned age)
+{
+	for (struct inode *ip = &inodes[0]; ip < &inodes[NR_INODES]; ip++)
+	{
+		if ((ip->ndelay == 0) || (ticks - ip->delay_time < age))
+			continue;
+		
+		inode_lock(ip);
+		file_flush(ip);
+		inode_unlock(ip);
+	}
 }
 
 /**
  * @brief Synchronizes the in-core inode table.
  * 
  * @details Synchronizes the in-core inode table by flushing all valid inodes 
- *          onto underlying devices.
+ *          onto underlying devices. Dirty inodes that share a block of the
+ *          inode table are copied to it together, so that each block is read
+ *          and dirtied once. Delayed writes are given disk blocks first.
  */
 PUBLIC void inode_sync(void)
 {
+	block_t blk;           /* Inode table block. */
+	struct buffer *buf;    /* Buffer.            */
+	struct superblock *sb; /* Super block.       */
+	
+	inode_flush(0);
+	
 	/* Write valid inodes to disk. */
 	for (struct inode *ip = &inodes[0]; ip < &inodes[NR_INODES]; ip++)
 	{
 		inode_lock(ip);
 		
-		/* Write only valid inodes. */
-		if (ip->flags & INODE_VALID)
+		/* Write only dirty inodes. */
+		if (!INODE_WRITEBACK(ip))
+		{
+			inode_unlock(ip);
+			continue;
+		}
+		
+		superblock_lock(sb = ip->sb);
+		
+		blk = INODE_BLOCK(sb, ip->num);
+		buf = bread(ip->dev, blk);
+		
+		inode_copy(ip, buf);
+		inode_unlock(ip);
+		
+		/*
+		 * Gather other dirty inodes in the same block. Locked
+		 * ones are skipped rather than waited for, since we are
+		 * holding the buffer, and they are written back when the
+		 * loop gets to them.
+		 */
+		for (struct inode *jp = ip + 1; jp < &inodes[NR_INODES]; jp++)
+		{
+			if (!INODE_WRITEBACK(jp) || (jp->flags & INODE_LOCKED) || (jp->readers > 0))
+				continue;
+			
+			if ((jp->sb != sb) || (INODE_BLOCK(sb, jp->num) != blk))
+				continue;
+			
+			inode_lock(jp);
+			inode_copy(jp, buf);
+			inode_unlock(jp);
+		}
+		
+		journal_dirty(sb, buf);
+		brelse(buf);
+		superblock_unlock(sb);
+		
+		/* Let others run. */
+		resched();
+	}
+}
+
+/**
+ * @brief Synchronizes a file.
+ * 
+ * @details Writes back the dirty blocks of the file pointed to by @p ip and,
+ *          unless @p datasync is set, its inode, waits for them to reach the
+ *          device and then issues a write barrier to it. When @p datasync is
+ *          set, the inode is written back only if the size or the zones of the
+ *          file are changed, since these are needed to get to the data.
+ * 
+ *          If the file system has a journal, metadata changes are committed
+ *          to the journal instead, along with those of other files, and the
+ *          inode is unlocked meanwhile.
+ * 
+ * @param ip       File to be synchronized.
+ * @param datasync Synchronize data only?
+ * 
+ * @returns Upon successful completion, zero is returned. Upon failure, a
+ *          negative error number is returned instead.
+ * 
+ * @note The inode must be locked.
+ */
+PUBLIC int inode_fsync(struct inode *ip, int datasync)
+{
+	struct buffer *buf; /* Buffer holding the inode. */
+	
+	file_flush(ip);
+	bsync_inode(ip);
+	
+	/* Write inode. */
+	if ((!datasync) || (ip->flags & INODE_LAYOUT))
+	{
+		inode_write(ip);
+		
+		if (ip->sb->journal == NULL)
 		{
-			if (!(ip->flags & INODE_PIPE))
-				inode_write(ip);
+			buf = bread(ip->dev, INODE_BLOCK(ip->sb, ip->num));
+			bwritew(buf);
 		}
 		
+		ip->flags &= ~INODE_LAYOUT;
+	}
+	
+	/* Commit metadata changes. */
+	if (ip->sb->journal != NULL)
+	{
 		inode_unlock(ip);
+		journal_commit(ip->sb);
+		inode_lock(ip);
+		
+		/* Blocks that were held back by revokes. */
+		bsync_inode(ip);
 	}
+	
+	return (bdev_flush(ip->dev));
 }
 
 /**
@@ -354,6 +719,14 @@ PUBLIC void inode_truncate(struct inode *ip)
 {
 	struct superblock *sb;
 	
+	/* Cached text is now stale. */
+	if (ip->flags & INODE_TEXT)
+		droptext(ip);
+	
+	block_release(ip);
+	pcache_purge(ip);
+	block_trim(ip);
+	
 	superblock_lock(sb = ip->sb);
 	
 	/* Free direct zone. */
@@ -380,55 +753,101 @@ PUBLIC void inode_truncate(struct inode *ip)
 	superblock_unlock(sb);
 	
 	ip->size = 0;
+	ip->dfree = 0;
+	ip->goal = BLOCK_NULL;
+	ip->map_len = 0;
+	ip->map_ind = BLOCK_NULL;
+	ip->flags |= INODE_LAYOUT;
 	inode_touch(ip);
 }
 
 /**
- * @brief Allocates an inode.
+ * @brief Picks the allocation group of a new directory.
  * 
- * @details Allocates an inode in the file system that is associated to the 
- *          superblock pointed to by @p sb.
+ * @details Picks an allocation group for a new directory in the directory
+ *          pointed to by @p dir, so that directories are spread over the file
+ *          system. Among the groups with at least the average number of free
+ *          inodes, the one with the most free zones is chosen, starting the
+ *          search after the group of @p dir, so that ties go to the next
+ *          group rather than to the same one.
  * 
- * @param sb Superblock where the inode shall be allocated.
+ * @param dir Parent directory.
  * 
- * @returns Upon successful completion, a pointed to the inode is returned. In 
- *          this case, the inode is ensured to be locked. Upon failure, a #NULL
- *          pointer is returned instead.
+ * @returns The chosen allocation group.
  * 
- * @note The superblock must not be locked.
- * 
- * @todo Use isearch.
+ * @note The superblock must be locked.
  */
-PUBLIC struct inode *inode_alloc(struct superblock *sb)
+PRIVATE unsigned inode_group_pick(struct inode *dir)
 {
-	ino_t num;        /* Inode number.             */
-	bit_t bit;        /* Bit number in the bitmap. */
-	unsigned i;       /* Number of current block.  */
-	struct inode *ip; /* Inode.                    */
+	unsigned g;            /* Working group.         */
+	unsigned best;         /* Best group so far.     */
+	ino_t avg;             /* Average free inodes.   */
+	struct superblock *sb; /* Underlying superblock. */
 	
-	superblock_lock(sb);
+	sb = dir->sb;
+	avg = sb->ifree/NR_GROUPS;
+	best = INODE_GROUP(sb, dir->num);
 	
-	/* Search for free inode. */
-	for (i = 0; i < sb->imap_blocks; i++)
+	for (unsigned i = 1; i <= NR_GROUPS; i++)
 	{
-		bit = bitmap_first_free(sb->imap[i]->data, BLOCK_SIZE);
+		g = (INODE_GROUP(sb, dir->num) + i)%NR_GROUPS;
 		
-		/* Found. */
-		if (bit != BITMAP_FULL)
-			goto found;
+		/* Short on inodes. */
+		if ((sb->gifree[g] == 0) || (sb->gifree[g] < avg))
+			continue;
+		
+		if ((sb->gifree[best] == 0) || (sb->gifree[best] < avg) ||
+			(sb->gzfree[g] > sb->gzfree[best]))
+			best = g;
 	}
 	
-	goto error0;
+	return (best);
+}
+
+/**
+ * @brief Allocates an inode.
+ * 
+ * @details Allocates an inode in the file system of the directory pointed
+ *          to by @p dir. A new directory gets the first free inode of the
+ *          allocation group picked by inode_group_pick(), and any other file
+ *          the first free inode after @p dir, so that the inodes of a
+ *          directory lie together. Data blocks of the new inode are later
+ *          placed in its allocation group.
+ * 
+ * @param dir  Directory where the new inode shall be linked.
+ * @param mode File type of the new inode.
+ * 
+ * @returns Upon successful completion, a pointed to the inode is returned. In 
+ *          this case, the inode is ensured to be locked. Upon failure, a #NULL
+ *          pointer is returned instead.
+ * 
+ * @note The superblock must not be locked.
+ */
+PUBLIC struct inode *inode_alloc(struct inode *dir, mode_t mode)
+{
+	ino_t num;             /* Inode number.             */
+	bit_t bit;             /* Bit number in the bitmap. */
+	bit_t from;            /* First bit to check.       */
+	unsigned i;            /* Number of current block.  */
+	struct inode *ip;      /* Inode.                    */
+	struct superblock *sb; /* Underlying superblock.    */
+	
+	superblock_lock(sb = dir->sb);
+	
+	/* Spread directories, keep other files near their parent. */
+	if (S_ISDIR(mode))
+		from = GROUP_INODE(sb, inode_group_pick(dir)) - 1;
+	else
+		from = dir->num - 1;
 	
-found:
+	/* Search for free inode. */
+	bit = superblock_search(sb->imap, sb->imap_blocks, sb->ninodes, from);
+	if (bit == BITMAP_FULL)
+		goto error0;
 	
-	num = bit + i*(BLOCK_SIZE << 3) + 1;
-
-	/*
-	 * Remember disk block number to
-	 * speedup next allocation. 
-	 */
-	sb->isearch = num;
+	num = bit + 1;
+	i = bit/(BLOCK_SIZE << 3);
+	bit %= (BLOCK_SIZE << 3);
 
 	/* Get a free in-core inode. */
 	ip = inode_cache_evict();
@@ -437,7 +856,9 @@ found:
 	
 	/* Allocate inode. */
 	bitmap_set(sb->imap[i]->data, bit);
-	sb->imap[i]->flags |= BUFFER_DIRTY;
+	journal_dirty(sb, sb->imap[i]);
+	sb->ifree--;
+	sb->gifree[INODE_GROUP(sb, num)]--;
 	sb->flags |= SUPERBLOCK_DIRTY;
 	
 	/* 
@@ -453,7 +874,17 @@ found:
 	ip->dev = sb->dev;
 	ip->num = num;
 	ip->sb = sb;
-	ip->flags &= ~(INODE_MOUNT | INODE_PIPE);
+	ip->goal = BLOCK_NULL;
+	ip->pa_count = 0;
+	ip->nbuckets = 0;
+	ip->dfree = 0;
+	ip->map_len = 0;
+	ip->map_ind = BLOCK_NULL;
+	ip->dirty = NULL;
+	ip->sock = NULL;
+	ip->flags &= ~(INODE_MOUNT | INODE_PIPE | INODE_TEXT | INODE_ONCE);
+	ip->flags &= ~INODE_SOCKET;
+	ip->flags |= INODE_LAYOUT;
 	ip->flags |= INODE_VALID;
 	inode_touch(ip);
 	
@@ -469,21 +900,13 @@ error0:
 }
 
 /**
- * @brief Gets an inode.
+ * @brief Gets an inode, locked in some mode.
  * 
- * @details Gets the inode with number @p num from the device @p dev.
- * 
- * @param dev Device where the inode is located.
- * @param num Number of the inode.
- * 
- * @returns Upon successful completion, a pointer to the inode is returned. In
- *          this case, the inode is ensured to be locked. Upon failure, a #NULL
- *          pointer is returned instead.
- * 
- * @note The device number must be valid.
- * @note The inode number must be valid.
+ * @details Gets the inode with number @p num from the device @p dev, and
+ *          locks it in shared mode if @p shared is not zero, or exclusively
+ *          otherwise.
  */
-PUBLIC struct inode *inode_get(dev_t dev, ino_t num)
+PRIVATE struct inode *inode_grab(dev_t dev, ino_t num, int shared)
 {
 	struct inode *ip;
 
@@ -499,6 +922,9 @@ repeat:
 		/* Inode is locked. */
 		if (ip->flags & INODE_LOCKED)
 		{
+			stats.waits++;
+			ip->waits++;
+			lock_wait(LOCK_INODE, ip->holder, PRIO_INODE);
 			sleep(&ip->chain, PRIO_INODE);
 			goto repeat;
 		}
@@ -510,35 +936,110 @@ repeat:
 			 goto repeat;
 		}
 		
-		ip->count++;
-		inode_lock(ip);
+		stats.hits++;
+		
+		/* Unused inode. */
+		if (ip->count++ == 0)
+			free_remove(ip);
+		
+		if (shared)
+			inode_lock_shared(ip);
+		else
+			inode_lock(ip);
 		
 		return (ip);
 	}
 	
 	/* Read inode. */
+	stats.misses++;
 	ip = inode_read(dev, num);
 	if (ip == NULL)
 		return (NULL);
 	
 	inode_cache_insert(ip);
 	
+	/* Let other readers in. */
+	if (shared)
+	{
+		ip->flags &= ~INODE_LOCKED;
+		ip->holder = NULL;
+		ip->readers++;
+		wakeup(&ip->chain);
+		
+		if (--nlocked == 0)
+			wakeup(&quiesce_chain);
+	}
+	
 	return (ip);
 }
 
+/**
+ * @brief Gets an inode.
+ * 
+ * @details Gets the inode with number @p num from the device @p dev.
+ * 
+ * @param dev Device where the inode is located.
+ * @param num Number of the inode.
+ * 
+ * @returns Upon successful completion, a pointer to the inode is returned. In
+ *          this case, the inode is ensured to be locked. Upon failure, a #NULL
+ *          pointer is returned instead.
+ * 
+ * @note The device number must be valid.
+ * @note The inode number must be valid.
+ */
+PUBLIC struct inode *inode_get(dev_t dev, ino_t num)
+{
+	return (inode_grab(dev, num, 0));
+}
+
+/**
+ * @brief Gets the mode of a cached inode.
+ * 
+ * @details Looks up the inode cache for the inode numbered @p num in the
+ *          device @p dev, without reading it from disk nor locking it.
+ * 
+ * @param dev Device where the inode is located.
+ * @param num Inode number.
+ * 
+ * @returns If the inode is cached, its mode is returned. Otherwise, zero is
+ *          returned instead.
+ */
+PUBLIC mode_t inode_mode(dev_t dev, ino_t num)
+{
+	struct inode *ip;
+	
+	for (ip = hashtab[HASH(dev, num)]; ip != NULL; ip = ip->hash_next)
+	{
+		/* Found. */
+		if ((ip->dev == dev) && (ip->num == num) && (ip->flags & INODE_VALID))
+			return (ip->mode);
+	}
+	
+	return (0);
+}
+
 /*
  * Gets a pipe inode.
  */
 PUBLIC struct inode *inode_pipe(void)
 {
-	void *pipe;          /* Pipe page.  */
+	unsigned i;          /* Loop index. */
+	struct pipe *pipe;   /* Pipe state. */
 	struct inode *inode; /* Pipe inode. */
 	
-	pipe = getkpg(0);
+	if ((pipe = kcache_alloc(&pipes)) == NULL)
+		return (NULL);
 	
-	/* Failed to get pipe page. */
-	if (pipe == NULL)
-		goto error0;
+	/* Get pipe pages. */
+	for (i = 0; i < PIPE_PAGES; i++)
+	{
+		pipe->pages[i] = getkpg(0);
+		
+		/* Failed to get pipe page. */
+		if (pipe->pages[i] == NULL)
+			goto error1;
+	}
 	
 	inode = inode_cache_evict();
 	
@@ -551,24 +1052,74 @@ PUBLIC struct inode *inode_pipe(void)
 	inode->nlinks = 0;
 	inode->uid = curr_proc->uid;
 	inode->gid = curr_proc->gid;
-	inode->size = PAGE_SIZE;
+	inode->size = PIPE_PAGES*PAGE_SIZE;
 	inode->time = CURRENT_TIME;
 	inode->dev = NULL_DEV;
 	inode->num = INODE_NULL;
+	inode->goal = BLOCK_NULL;
+	inode->pa_count = 0;
+	inode->nbuckets = 0;
+	inode->dfree = 0;
+	inode->map_len = 0;
+	inode->map_ind = BLOCK_NULL;
+	inode->dirty = NULL;
 	inode->count = 2;
 	inode->flags |= ~(INODE_DIRTY | INODE_MOUNT) & (INODE_VALID | INODE_PIPE);
 	inode->pipe = pipe;
-	inode->head = 0;
-	inode->tail = 0;
+	inode->sock = NULL;
+	pipe->head = 0;
+	pipe->tail = 0;
 	
 	return (inode);
 
 error1:
-	putkpg(pipe);
-error0:
+	while (i-- > 0)
+		putkpg(pipe->pages[i]);
+	kcache_free(pipe);
 	return (NULL);
 }
 
+/*
+ * Gets a socket inode.
+ */
+PUBLIC struct inode *inode_socket(void)
+{
+	struct inode *inode; /* Socket inode. */
+	
+	inode = inode_cache_evict();
+	
+	/* No free inode. */
+	if (inode == NULL)
+		return (NULL);
+	
+	/* Initialize inode. */
+	inode->mode = MAY_READ | MAY_WRITE | S_IFSOCK;
+	inode->nlinks = 0;
+	inode->uid = curr_proc->uid;
+	inode->gid = curr_proc->gid;
+	inode->size = 0;
+	inode->time = CURRENT_TIME;
+	inode->dev = NULL_DEV;
+	inode->num = INODE_NULL;
+	inode->goal = BLOCK_NULL;
+	inode->pa_count = 0;
+	inode->nbuckets = 0;
+	inode->dfree = 0;
+	inode->map_len = 0;
+	inode->map_ind = BLOCK_NULL;
+	inode->dirty = NULL;
+	inode->count = 1;
+	inode->flags &= ~(INODE_DIRTY | INODE_MOUNT | INODE_PIPE | INODE_LAYOUT);
+	inode->flags &= ~(INODE_TEXT | INODE_ONCE);
+	inode->flags |= INODE_VALID | INODE_SOCKET;
+	inode->pipe = NULL;
+	inode->sock = NULL;
+	
+	inode_unlock(inode);
+	
+	return (inode);
+}
+
 /**
  * @brief Updates the time stamp of an inode.
  * 
@@ -585,6 +1136,36 @@ PUBLIC inline void inode_touch(struct inode *ip)
 	ip->flags |= INODE_DIRTY;
 }
 
+/**
+ * @brief Updates the time stamp of an inode on access.
+ * 
+ * @details Updates the time stamp of the inode pointed to by @p ip to current
+ *          time, as the file has been read, honoring the mount options of the
+ *          underlying file system: with noatime the time stamp is left as is,
+ *          and with relatime it is only updated once it gets older than
+ *          #RELATIME_AGE, sparing read-only workloads from writing inodes
+ *          back.
+ * 
+ * @param ip Inode to be touched.
+ * 
+ * @note The inode must be locked.
+ */
+PUBLIC void inode_access(struct inode *ip)
+{
+	/* Pipes and sockets have no underlying file system. */
+	if (!(ip->flags & (INODE_PIPE | INODE_SOCKET)))
+	{
+		if (ip->sb->flags & SUPERBLOCK_NOATIME)
+			return;
+		
+		if ((ip->sb->flags & SUPERBLOCK_RELATIME) &&
+			(CURRENT_TIME - ip->time < RELATIME_AGE))
+			return;
+	}
+	
+	inode_touch(ip);
+}
+
 /**
  * @brief Releases a in-core inode.
  * 
@@ -603,37 +1184,90 @@ PUBLIC void inode_put(struct inode *ip)
 	if (ip->count == 0)
 		kpanic("freeing inode twice");
 	
+	/* Pollers of the other end of a pipe shall find it hung up. */
+	if (ip->flags & INODE_PIPE)
+		pollwakeup(ip);
+	
 	/* Release underlying resources. */
 	if (--ip->count == 0)
 	{
 		/* Pipe inode. */
 		if (ip->flags & INODE_PIPE)
-			putkpg(ip->pipe);
+		{
+			for (unsigned i = 0; i < (size_t)ip->size/PAGE_SIZE; i++)
+				putkpg(ip->pipe->pages[i]);
+			kcache_free(ip->pipe);
+			ip->pipe = NULL;
 			
-		/* File inode. */
-		else
-		{		
-			/* Free underlying disk blocks. */
-			if (ip->nlinks == 0)
-			{
-				inode_free(ip);
-				inode_truncate(ip);
-			}
+			ip->flags &= ~INODE_VALID;
+			free_insert(ip, 0);
+		}
+		
+		/* Socket inode. */
+		else if (ip->flags & INODE_SOCKET)
+		{
+			socket_release(ip->sock);
+			ip->sock = NULL;
 			
+			ip->flags &= ~INODE_VALID;
+			free_insert(ip, 0);
+		}
+		
+		/* Removed file. */
+		else if (ip->nlinks == 0)
+		{
+			block_trim(ip);
+			inode_free(ip);
+			inode_truncate(ip);
 			inode_write(ip);
+			buffer_detach(ip);
 			inode_cache_remove(ip);
+			
+			ip->flags &= ~INODE_VALID;
+			free_insert(ip, 0);
 		}
 		
-		/* Insert inode in the free list. */
-		ip->free_next = free_inodes;
-		free_inodes = ip;
-		
-		ip->flags &= ~INODE_VALID;
+		/*
+		 * Keep the file cached, but write it back
+		 * so that it can be evicted at no cost.
+		 */
+		else
+		{
+			file_flush(ip);
+			block_trim(ip);
+			inode_write(ip);
+			buffer_detach(ip);
+			
+			free_insert(ip, 1);
+		}
 	}
 	
 	inode_unlock(ip);
 }
 
+/**
+ * @brief Releases an in-core inode locked in shared mode.
+ * 
+ * @details Works like inode_put(), but for an inode locked in shared mode.
+ *          Other references are just dropped, while the last one is turned
+ *          exclusive so that underlying resources can be freed.
+ * 
+ * @param ip Inode that shall be released.
+ */
+PRIVATE void inode_put_shared(struct inode *ip)
+{
+	/* Not the last reference. */
+	if ((ip->count > 1) && !(ip->flags & INODE_PIPE))
+	{
+		ip->count--;
+		inode_unlock_shared(ip);
+		return;
+	}
+	
+	inode_upgrade(ip);
+	inode_put(ip);
+}
+
 /**
  * @brief Breaks a path
  * 
@@ -677,9 +1311,12 @@ PRIVATE const char *break_path(const char *pathname, char *filename)
 }
 
 /*
- * Gets inode of the topmost directory of a path.
+ * Walks a path up to its topmost directory, looking up relative paths
+ * from the directory dir. Directories are locked in shared mode along the
+ * way, so that lookups do not serialize each other, and so is the one
+ * returned.
  */
-PUBLIC struct inode *inode_dname(const char *path, const char **name)
+PRIVATE struct inode *inode_walk(struct inode *dir, const char *path, const char **name)
 {
 	dev_t dev;                   /* Current device.     */
 	ino_t ent;                   /* Directory entry.    */
@@ -696,7 +1333,7 @@ PUBLIC struct inode *inode_dname(const char *path, const char **name)
 	
 	/* Relative path. */
 	else if (*p != '\0')
-		i = curr_proc->pwd;
+		i = dir;
 		
 	/* Empty path name. */
 	else
@@ -706,7 +1343,7 @@ PUBLIC struct inode *inode_dname(const char *path, const char **name)
 	}
 	
 	i->count++;
-	inode_lock(i);
+	inode_lock_shared(i);
 	
 	p = break_path((*name) = p, filename);
 	
@@ -766,16 +1403,16 @@ again:
 		if ((i->num == INODE_ROOT) && (!kstrcmp(filename, "..")))
 		{
 			sb = i->sb;
-			inode_put(i);
+			inode_put_shared(i);
 			i = sb->mp;
-			inode_lock(i);
+			inode_lock_shared(i);
 			i->count++;
 			goto again;
 		}
 			
 		dev = i->dev;	
-		inode_put(i);
-		i = inode_get(dev, ent);
+		inode_put_shared(i);
+		i = inode_grab(dev, ent, 1);
 		
 		/* Failed to get inode. */
 		if (i == NULL)
@@ -798,21 +1435,44 @@ again:
 	return (i);
 
 error0:
-	inode_put(i);
+	inode_put_shared(i);
 	return (NULL);
 }
 
 /*
- * Converts a path name to inode.
+ * Gets inode of the topmost directory of a path, looking up relative
+ * paths from the directory dir.
  */
-PUBLIC struct inode *inode_name(const char *pathname)
+PUBLIC struct inode *inode_dname_at(struct inode *dir, const char *path, const char **name)
+{
+	struct inode *i;
+	
+	if ((i = inode_walk(dir, path, name)) != NULL)
+		inode_upgrade(i);
+	
+	return (i);
+}
+
+/*
+ * Gets inode of the topmost directory of a path.
+ */
+PUBLIC struct inode *inode_dname(const char *path, const char **name)
+{
+	return (inode_dname_at(curr_proc->pwd, path, name));
+}
+
+/*
+ * Converts a path name to inode, looking up relative paths from the
+ * directory dir.
+ */
+PUBLIC struct inode *inode_name_at(struct inode *dir, const char *pathname)
 {
 	dev_t dev;           /* Device number. */
 	ino_t num;           /* Inode number.  */
 	const char *name;    /* File name.     */
 	struct inode *inode; /* Working inode. */
 	
-	inode = inode_dname(pathname, &name);
+	inode = inode_walk(dir, pathname, &name);
 	
 	/* Failed to get directory inode. */
 	if (inode == NULL)
@@ -827,17 +1487,111 @@ PUBLIC struct inode *inode_name(const char *pathname)
 	/* File not found. */
 	if (num == INODE_NULL)
 	{	
-		inode_put(inode);
+		inode_put_shared(inode);
 		curr_proc->errno = -ENOENT;
 		return (NULL);
 	}
 
 	dev = inode->dev;	
-	inode_put(inode);
+	inode_put_shared(inode);
 	
 	return (inode_get(dev, num));
 }
 
+/*
+ * Converts a path name to inode.
+ */
+PUBLIC struct inode *inode_name(const char *pathname)
+{
+	return (inode_name_at(curr_proc->pwd, pathname));
+}
+
+/**
+ * @brief Drops the inode cache.
+ * 
+ * @details Synchronizes the in-core inode table and then forgets every
+ *          cached file that is not in use, along with the directory name
+ *          cache, so that the next lookups read inodes from the device.
+ */
+PUBLIC void inode_drop(void)
+{
+	inode_sync();
+	dcache_flush();
+	
+	for (struct inode *ip = &inodes[0]; ip < &inodes[NR_INODES]; ip++)
+	{
+		/* Skip inodes that are being used. */
+		if ((ip->count > 0) || !(ip->flags & INODE_VALID))
+			continue;
+		
+		inode_lock(ip);
+		
+		/* Inode has been taken meanwhile. */
+		if ((ip->count > 0) || !(ip->flags & INODE_VALID) ||
+			(ip->flags & (INODE_DIRTY | INODE_PIPE | INODE_SOCKET)))
+		{
+			inode_unlock(ip);
+			continue;
+		}
+		
+		free_remove(ip);
+		pcache_purge(ip);
+		inode_cache_remove(ip);
+		ip->flags &= ~INODE_VALID;
+		free_insert(ip, 0);
+		
+		inode_unlock(ip);
+	}
+}
+
+/**
+ * @brief Gets inode cache statistics.
+ * 
+ * @details Gets statistics about the inode cache and stores them in the
+ *          location pointed to by @p buf.
+ * 
+ * @param buf Location where statistics shall be stored.
+ */
+PUBLIC void inode_stat(struct cachestat *buf)
+{
+	stats.size = NR_INODES;
+	stats.used = 0;
+	stats.dirty = 0;
+	for (unsigned i = 0; i < NR_INODES; i++)
+	{
+		if (inodes[i].count > 0)
+			stats.used++;
+		if ((inodes[i].flags & (INODE_VALID | INODE_DIRTY)) == (INODE_VALID | INODE_DIRTY))
+			stats.dirty++;
+	}
+	
+	kmemcpy(buf, &stats, sizeof(struct cachestat));
+}
+
+/**
+ * @brief Gets inode lock statistics.
+ * 
+ * @details Gets statistics about inode locks, along with the cached inodes
+ *          whose locks were waited for the most, and stores them in the
+ *          location pointed to by @p buf.
+ * 
+ * @param buf Location where statistics shall be stored.
+ */
+PUBLIC void inode_lockstat(struct lockstat *buf)
+{
+	lock_stat(LOCK_INODE, buf);
+	for (unsigned i = 0; i < NR_INODES; i++)
+	{
+		if (inodes[i].flags & INODE_VALID)
+			lock_hot(buf, inodes[i].dev, inodes[i].num, inodes[i].waits);
+	}
+}
+
+/**
+ * @brief Hash table sizes.
+ */
+PRIVATE const unsigned hashtab_sizes[] = { 53, 97, 193, 389, 769, HASHTAB_MAX };
+
 /**
  * @brief Initializes the inode table.
  * 
@@ -848,19 +1602,33 @@ PUBLIC void inode_init(void)
 {
 	kprintf("fs: initializing inode cache");
 	
+	/* Choose hash table size. */
+	for (unsigned i = 0; i < sizeof(hashtab_sizes)/sizeof(unsigned); i++)
+	{
+		nr_hash = hashtab_sizes[i];
+		if (nr_hash >= NR_INODES/4)
+			break;
+	}
+	
 	/* Initialize inodes. */
 	for (unsigned i = 0; i < NR_INODES; i++)
 	{
 		inodes[i].count = 0;
 		inodes[i].flags = ~(INODE_LOCKED | INODE_VALID);
-		inodes[i].chain = NULL;
+		inodes[i].readers = 0;
+		inodes[i].xwaiters = 0;
+		inodes[i].holder = NULL;
+		inodes[i].waits = 0;
+		waitq_init(&inodes[i].chain);
 		inodes[i].free_next = ((i + 1) < NR_INODES) ? &inodes[i + 1] : NULL;
+		inodes[i].free_prev = (i > 0) ? &inodes[i - 1] : NULL;
 		inodes[i].hash_next = NULL;
 		inodes[i].hash_prev = NULL;
 	}
 	
 	/* Initialize inode cache. */
-	free_inodes = &inodes[0];
-	for (unsigned i = 0; i < HASHTAB_SIZE; i++)
+	free_head = &inodes[0];
+	free_tail = &inodes[NR_INODES - 1];
+	for (unsigned i = 0; i < nr_hash; i++)
 		hashtab[i] = NULL;
 }
@@ -0,0 +1,954 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ *
+ * This file is part of Nanvix.
+ *
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/clock.h>
+#include <nanvix/config.h>
+#include <nanvix/const.h>
+#include <nanvix/dev.h>
+#include <nanvix/fs.h>
+#include <nanvix/hal.h>
+#include <nanvix/klib.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include "fs.h"
+
+/**
+ * @file
+ *
+ * @brief Metadata journal implementation.
+ *
+ * @details Blocks of the inode map, the zone map, the inode table, indirect
+ *          blocks and directories that get dirty are gathered in a running
+ *          transaction, and held in the block buffer cache until it is
+ *          committed. A commit writes the images of these blocks to the
+ *          journal as one sequential record followed by a write barrier, and
+ *          only then lets the blocks go home through the usual write back.
+ *          Old records are dropped lazily: once the journal runs short of
+ *          space, every dirty buffer is written back, and the header is moved
+ *          past them.
+ *
+ *          Images are copied when no inode is locked exclusively, so that a
+ *          transaction never holds half of an operation. If the running
+ *          transaction fills up before that, further changes are written in
+ *          place, and replay is turned off until the next checkpoint.
+ */
+
+/**
+ * @brief Maximum number of blocks in a transaction.
+ *
+ * @details Blocks of the running transaction cannot be evicted from the block
+ *          buffer cache, so transactions are kept to a small share of it.
+ */
+#define JOURNAL_TRANS_MAX ((BUFFERS_SIZE/BLOCK_SIZE)/8)
+
+/**
+ * @brief Highest block number that can be replayed.
+ */
+#define JOURNAL_REPLAY_MAX (PAGE_SIZE << 3)
+
+/**
+ * @brief In-core journals.
+ */
+PRIVATE struct journal
+{
+	/**
+	 * @name General information
+	 */
+	/**@{*/
+	struct superblock *sb; /**< Superblock (NULL if free).    */
+	dev_t dev;             /**< Underlying device.            */
+	block_t start;         /**< First block of the journal.   */
+	unsigned nblocks;      /**< Number of blocks.             */
+	unsigned max;          /**< Blocks per transaction.       */
+	/**@}*/
+
+	/**
+	 * @name Log information
+	 */
+	/**@{*/
+	uint32_t seq;                   /**< Sequence number of next record. */
+	unsigned head;                  /**< Where the next record goes.     */
+	unsigned tail;                  /**< First live record.              */
+	unsigned used;                  /**< Blocks taken by live records.   */
+	block_t home[JOURNAL_SIZE_MAX]; /**< Homes of logged blocks.         */
+	int enabled;                    /**< Live records are replayed?      */
+	unsigned gen;                   /**< Changes written in place.       */
+	int resetting;                  /**< Turning replay off?             */
+	/**@}*/
+
+	/**
+	 * @name Transaction information
+	 */
+	/**@{*/
+	struct
+	{
+		struct buffer *buf; /**< Block buffer. */
+		int revoke;         /**< Revoked?      */
+	} run[JOURNAL_TRANS_MAX];                   /**< Running transaction.   */
+	unsigned nrun;                              /**< Its number of blocks.  */
+	unsigned since;                             /**< Started (clock ticks). */
+	struct buffer *cbuf[JOURNAL_TRANS_MAX];     /**< Blocks being logged.   */
+	struct buffer *jbuf[JOURNAL_TRANS_MAX + 2]; /**< Record being written.  */
+	int busy;                                   /**< Committing?            */
+	struct waitq chain;                         /**< Waiting chain.         */
+	/**@}*/
+} journals[NR_SUPERBLOCKS];
+
+/**
+ * @brief Checksums a block.
+ *
+ * @param sum  Checksum so far.
+ * @param data Block.
+ *
+ * @returns The updated checksum.
+ */
+PRIVATE uint32_t journal_sum(uint32_t sum, const void *data)
+{
+	const uint32_t *w = data;
+
+	for (unsigned i = 0; i < BLOCK_SIZE/sizeof(uint32_t); i++)
+		sum = ((sum << 1) | (sum >> 31)) ^ w[i];
+
+	return (sum);
+}
+
+/**
+ * @brief Writes the header of a journal.
+ *
+ * @details Writes the header of the journal pointed to by @p j, and waits for
+ *          it to reach the media.
+ *
+ * @param j     Target journal.
+ * @param start Journal block of the first record to be replayed.
+ * @param seq   Sequence number of that record.
+ */
+PRIVATE void journal_header(struct journal *j, unsigned start, uint32_t seq)
+{
+	struct buffer *buf;    /* Header buffer. */
+	struct d_jheader *hdr; /* Header.        */
+
+	buf = bget(j->dev, j->start);
+	hdr = buf->data;
+
+	kmemset(hdr, 0, BLOCK_SIZE);
+	hdr->h_magic = JOURNAL_MAGIC;
+	hdr->h_seq = seq;
+	hdr->h_start = start;
+
+	buffer_dirty(buf, 1);
+	bwritew(buf);
+	bdev_flush(j->dev);
+}
+
+/**
+ * @brief Locks a journal for a commit.
+ *
+ * @param j Journal to be locked.
+ */
+PRIVATE void journal_lock(struct journal *j)
+{
+	while (j->busy)
+		sleep(&j->chain, PRIO_BUFFER);
+	j->busy = 1;
+}
+
+/**
+ * @brief Unlocks a journal.
+ *
+ * @param j Journal to be unlocked.
+ */
+PRIVATE void journal_unlock(struct journal *j)
+{
+	j->busy = 0;
+	wakeup(&j->chain);
+}
+
+/**
+ * @brief Asserts if a block is logged in the live records of a journal.
+ *
+ * @param j   Target journal.
+ * @param num Block number.
+ *
+ * @returns Non-zero if the block is logged, and zero otherwise.
+ */
+PRIVATE int journal_logged(struct journal *j, block_t num)
+{
+	unsigned pos; /* Journal block. */
+
+	pos = j->tail;
+	for (unsigned i = 0; i < j->used; i++)
+	{
+		if (j->home[pos] == num)
+			return (1);
+
+		pos = (pos + 1 < j->nblocks) ? pos + 1 : 1;
+	}
+
+	return (0);
+}
+
+/**
+ * @brief Turns replay of a journal off.
+ *
+ * @details Called when a change cannot be added to the running transaction
+ *          of the journal pointed to by @p j, and is therefore written in
+ *          place. Replaying older records over it would then go back in time,
+ *          so the header of the journal is cleared before the caller goes on.
+ *          Replay is turned on again by the next checkpoint.
+ *
+ * @param j Target journal.
+ */
+PRIVATE void journal_fallback(struct journal *j)
+{
+	j->gen++;
+
+	/* Someone else is at it. */
+	while (j->resetting)
+		sleep(&j->chain, PRIO_BUFFER);
+
+	if (j->enabled)
+	{
+		j->enabled = 0;
+		j->tail = j->head;
+		j->used = 0;
+
+		j->resetting = 1;
+		journal_header(j, 0, j->seq);
+		j->resetting = 0;
+		wakeup(&j->chain);
+
+		kprintf("fs: journal transaction overflow");
+	}
+
+	bdflush_wakeup();
+}
+
+/**
+ * @brief Adds a block buffer to the running transaction of a journal.
+ *
+ * @param j      Target journal.
+ * @param buf    Block buffer to be added.
+ * @param revoke Revoke older images of the block, instead of logging it?
+ *
+ * @note The block buffer must be locked.
+ */
+PRIVATE void journal_add(struct journal *j, struct buffer *buf, int revoke)
+{
+	/* Already in the running transaction. */
+	if (buf->flags & BUFFER_JOURNAL)
+	{
+		for (unsigned i = 0; i < j->nrun; i++)
+		{
+			if (j->run[i].buf == buf)
+			{
+				j->run[i].revoke = revoke;
+				break;
+			}
+		}
+
+		return;
+	}
+
+	/* Running transaction is full. */
+	if (j->nrun == j->max)
+	{
+		journal_fallback(j);
+		return;
+	}
+
+	if (j->nrun == 0)
+		j->since = ticks;
+
+	/* Hold buffer until it is committed. */
+	disable_interrupts();
+	buf->count++;
+	buf->flags |= BUFFER_JOURNAL;
+	enable_interrupts();
+
+	j->run[j->nrun].buf = buf;
+	j->run[j->nrun].revoke = revoke;
+
+	/* Commit soon. */
+	if (++j->nrun == j->max/2)
+		bdflush_wakeup();
+}
+
+/**
+ * @brief Writes the running transaction of a journal.
+ *
+ * @details Writes the running transaction of the journal pointed to by @p j
+ *          as a record of the journal, issues a write barrier, and then
+ *          releases the logged block buffers, so that they get written back
+ *          in place.
+ *
+ * @param j    Target journal.
+ * @param wait Wait for no inode to be locked exclusively?
+ *
+ * @returns The journal block where the record was written is returned, or
+ *          zero if there was nothing to commit. If @p wait is not set and
+ *          files are being changed, -1 is returned instead.
+ *
+ * @note The journal must be locked.
+ */
+PRIVATE int journal_write(struct journal *j, int wait)
+{
+	unsigned n;              /* Blocks of the record.    */
+	unsigned nimg;           /* Logged blocks.           */
+	unsigned nrev;           /* Revoked blocks.          */
+	unsigned pos;            /* Where the record goes.   */
+	unsigned skip;           /* Blocks skipped at end.   */
+	unsigned ncommit;        /* Buffers being committed. */
+	uint32_t sum;            /* Checksum.                */
+	struct buffer *buf;      /* Working buffer.          */
+	struct d_jdesc *desc;    /* Descriptor block.        */
+	struct d_jcommit *cmt;   /* Commit block.            */
+
+again:
+
+	/* Nothing to commit. */
+	if (j->nrun == 0)
+		return (0);
+
+	n = j->nrun + 2;
+
+	/* Records do not wrap around. */
+	pos = j->head;
+	skip = 0;
+	if (pos + n > j->nblocks)
+	{
+		skip = j->nblocks - pos;
+		pos = 1;
+	}
+
+	/* Should not happen. */
+	if (j->used + skip + n > j->nblocks - 1)
+		kpanic("fs: journal overflow");
+
+	for (unsigned i = 0; i < n; i++)
+		j->jbuf[i] = bget(j->dev, j->start + pos + i);
+
+	/*
+	 * Images are taken only when no file is being
+	 * changed, so that whole operations get logged.
+	 */
+	if ((inode_busy() > 0) || (j->nrun + 2 != n))
+	{
+		for (unsigned i = 0; i < n; i++)
+			brelse(j->jbuf[i]);
+
+		if (!wait)
+			return (-1);
+
+		inode_quiesce();
+		goto again;
+	}
+
+	/* Build descriptor block and copy images. */
+	desc = j->jbuf[0]->data;
+	kmemset(desc, 0, BLOCK_SIZE);
+	desc->d_magic = JOURNAL_DESC;
+	desc->d_seq = j->seq;
+	nimg = 0;
+	for (unsigned i = 0; i < j->nrun; i++)
+	{
+		if (j->run[i].revoke)
+			continue;
+
+		desc->d_blocks[nimg] = j->run[i].buf->num;
+		kmemcpy(j->jbuf[1 + nimg]->data, j->run[i].buf->data, BLOCK_SIZE);
+		nimg++;
+	}
+	nrev = 0;
+	for (unsigned i = 0; i < j->nrun; i++)
+	{
+		if (j->run[i].revoke)
+			desc->d_blocks[nimg + nrev++] = j->run[i].buf->num;
+	}
+	desc->d_count = nimg;
+	desc->d_nrevoke = nrev;
+
+	/* Build commit block. */
+	sum = journal_sum(0, desc);
+	for (unsigned i = 0; i < nimg; i++)
+		sum = journal_sum(sum, j->jbuf[1 + i]->data);
+	cmt = j->jbuf[nimg + 1]->data;
+	kmemset(cmt, 0, BLOCK_SIZE);
+	cmt->c_magic = JOURNAL_COMMIT;
+	cmt->c_seq = j->seq;
+	cmt->c_sum = sum;
+
+	/* Revoked blocks take no room. */
+	for (unsigned i = nimg + 2; i < n; i++)
+		brelse(j->jbuf[i]);
+	n = nimg + 2;
+
+	/* Account record. */
+	for (unsigned i = 0; i < skip; i++)
+		j->home[j->head + i] = BLOCK_NULL;
+	for (unsigned i = 0; i < n; i++)
+		j->home[pos + i] = (i > 0 && i <= nimg) ? desc->d_blocks[i - 1] : BLOCK_NULL;
+	j->used += skip + n;
+	j->head = pos + n;
+	j->seq++;
+
+	/* Start a new transaction. */
+	disable_interrupts();
+	for (unsigned i = 0; i < j->nrun; i++)
+	{
+		buf = j->cbuf[i] = j->run[i].buf;
+		buf->flags &= ~BUFFER_JOURNAL;
+		buf->flags |= BUFFER_COMMIT;
+	}
+	ncommit = j->nrun;
+	j->nrun = 0;
+	enable_interrupts();
+
+	/*
+	 * Issue all writes, so that the device driver
+	 * merges them, and only then wait for them.
+	 */
+	for (unsigned i = 0; i < n; i++)
+	{
+		buf = j->jbuf[i];
+		buffer_dirty(buf, 1);
+		disable_interrupts();
+		buf->count++;
+		enable_interrupts();
+		bwrite(buf);
+	}
+	for (unsigned i = 0; i < n; i++)
+	{
+		blklock(j->jbuf[i]);
+		brelse(j->jbuf[i]);
+	}
+	bdev_flush(j->dev);
+
+	/* Logged blocks may go home now. */
+	for (unsigned i = 0; i < ncommit; i++)
+	{
+		buf = j->cbuf[i];
+		blklock(buf);
+		disable_interrupts();
+		buf->flags &= ~BUFFER_COMMIT;
+		enable_interrupts();
+		brelse(buf);
+	}
+
+	return (pos);
+}
+
+/**
+ * @brief Drops the live records of a journal.
+ *
+ * @details Writes back all dirty block buffers, so that the blocks logged in
+ *          the journal pointed to by @p j reach their homes, and then moves
+ *          the header of the journal past the records that log them. Blocks
+ *          held by the running transaction cannot be written back, so it is
+ *          committed first, and its record is kept.
+ *
+ * @param j Target journal.
+ *
+ * @note The journal must be locked.
+ */
+PRIVATE void journal_checkpoint(struct journal *j)
+{
+	int pos;      /* First record kept.  */
+	uint32_t seq; /* Its sequence number. */
+	unsigned gen; /* In place changes.   */
+
+	gen = j->gen;
+
+	bsync();
+
+	seq = j->seq;
+	if ((pos = journal_write(j, 1)) > 0)
+		seq--;
+	else
+		pos = j->head;
+
+	/* Changes have been written in place meanwhile. */
+	if (gen != j->gen)
+	{
+		j->tail = j->head;
+		j->used = 0;
+		return;
+	}
+
+	j->tail = pos;
+	j->used = j->head - pos;
+	j->enabled = 1;
+
+	journal_header(j, pos, seq);
+}
+
+/**
+ * @brief Commits the running transaction of a journal.
+ *
+ * @param j    Target journal.
+ * @param wait Wait for files to stop being changed?
+ */
+PRIVATE void journal_flush(struct journal *j, int wait)
+{
+	journal_lock(j);
+
+	if (journal_write(j, wait) >= 0)
+	{
+		/* Running short of space. */
+		if (!j->enabled || (j->nblocks - 1 - j->used < 4*(j->max + 2)))
+			journal_checkpoint(j);
+	}
+
+	journal_unlock(j);
+}
+
+/**
+ * @brief Checks a record of a journal.
+ *
+ * @param j   Target journal.
+ * @param pos Journal block of the record.
+ * @param seq Expected sequence number.
+ *
+ * @returns The number of blocks of the record, if it is valid, and zero
+ *          otherwise.
+ */
+PRIVATE unsigned journal_check(struct journal *j, unsigned pos, uint32_t seq)
+{
+	int valid;            /* Valid record?     */
+	block_t num;          /* Logged block.     */
+	unsigned count;       /* Logged blocks.    */
+	uint32_t sum;         /* Checksum.         */
+	struct buffer *buf;   /* Working buffer.   */
+	struct d_jdesc *desc; /* Descriptor block. */
+	struct d_jcommit *cmt; /* Commit block.    */
+
+	/* Out of the journal. */
+	if (pos + 2 > j->nblocks)
+		return (0);
+
+	buf = bread(j->dev, j->start + pos);
+	desc = buf->data;
+
+	valid = (desc->d_magic == JOURNAL_DESC) && (desc->d_seq == seq);
+	valid = valid && (desc->d_count + desc->d_nrevoke <= JOURNAL_DESC_MAX);
+	valid = valid && (pos + desc->d_count + 2 <= j->nblocks);
+	for (unsigned i = 0; valid && (i < desc->d_count + desc->d_nrevoke); i++)
+	{
+		num = desc->d_blocks[i];
+
+		/* Bad home. */
+		if ((num < 2) || (num >= JOURNAL_REPLAY_MAX))
+			valid = 0;
+		else if ((num >= j->start) && (num < j->start + j->nblocks))
+			valid = 0;
+	}
+	count = desc->d_count;
+	sum = journal_sum(0, desc);
+	brelse(buf);
+
+	if (!valid)
+		return (0);
+
+	for (unsigned i = 0; i < count; i++)
+	{
+		buf = bread(j->dev, j->start + pos + 1 + i);
+		sum = journal_sum(sum, buf->data);
+		brelse(buf);
+	}
+
+	buf = bread(j->dev, j->start + pos + 1 + count);
+	cmt = buf->data;
+	valid = (cmt->c_magic == JOURNAL_COMMIT) && (cmt->c_seq == seq);
+	valid = valid && (cmt->c_sum == sum);
+	brelse(buf);
+
+	return ((valid) ? count + 2 : 0);
+}
+
+/**
+ * @brief Replays a journal.
+ *
+ * @details Looks for the records of the journal pointed to by @p j, starting
+ *          at @p pos, and copies the images they hold to their homes. Records
+ *          are gone through from the newest to the oldest, so that each block
+ *          is copied once, and revoked blocks are skipped.
+ *
+ * @param j   Target journal.
+ * @param pos Journal block of the first record.
+ *
+ * @returns The number of records replayed is returned. Upon failure, a
+ *          negative number is returned instead.
+ */
+PRIVATE int journal_replay(struct journal *j, unsigned pos)
+{
+	unsigned n;           /* Blocks of a record.  */
+	unsigned nrec;        /* Number of records.   */
+	block_t num;          /* Logged block.        */
+	uint32_t *done;       /* Blocks already seen. */
+	struct buffer *dbuf;  /* Descriptor buffer.   */
+	struct buffer *ibuf;  /* Image buffer.        */
+	struct buffer *hbuf;  /* Home buffer.         */
+	struct d_jdesc *desc; /* Descriptor block.    */
+
+	/* Find records. */
+	for (nrec = 0; nrec < JOURNAL_SIZE_MAX/2; nrec++)
+	{
+		if ((n = journal_check(j, pos, j->seq)) == 0)
+		{
+			/* Next record may start over. */
+			if ((pos == 1) || ((n = journal_check(j, 1, j->seq)) == 0))
+				break;
+			pos = 1;
+		}
+
+		j->home[nrec] = pos;
+		pos += n;
+		j->seq++;
+	}
+
+	/* Nothing to replay. */
+	if (nrec == 0)
+		return (0);
+
+	if ((done = getkpg(1)) == NULL)
+	{
+		kprintf("fs: cannot replay journal");
+		return (-1);
+	}
+
+	for (unsigned i = nrec; i-- > 0; /* noop */)
+	{
+		dbuf = bread(j->dev, j->start + j->home[i]);
+		desc = dbuf->data;
+
+		for (unsigned k = 0; k < desc->d_count + desc->d_nrevoke; k++)
+		{
+			num = desc->d_blocks[k];
+
+			/* Newer image copied, or revoked. */
+			if (bitmap_test(done, num))
+				continue;
+			bitmap_set(done, num);
+
+			/* Revoked. */
+			if (k >= desc->d_count)
+				continue;
+
+			ibuf = bread(j->dev, j->start + j->home[i] + 1 + k);
+			hbuf = bget(j->dev, num);
+			kmemcpy(hbuf->data, ibuf->data, BLOCK_SIZE);
+			buffer_dirty(hbuf, 1);
+			brelse(hbuf);
+			brelse(ibuf);
+		}
+
+		brelse(dbuf);
+	}
+
+	putkpg(done);
+
+	return (nrec);
+}
+
+/**
+ * @brief Opens the journal of a file system.
+ *
+ * @details Looks for a journal in the file system whose disk superblock is
+ *          pointed to by @p d_sb, replays it, and attaches it to the in-core
+ *          superblock pointed to by @p sb. This is done before the inode and
+ *          zone maps are read, since they may be replayed.
+ *
+ * @param sb   In-core superblock.
+ * @param dev  Underlying device.
+ * @param d_sb Disk superblock.
+ *
+ * @returns Upon successful completion, zero is returned, even if the file
+ *          system has no journal. Upon failure, -1 is returned instead.
+ */
+PUBLIC int journal_open
+(struct superblock *sb, dev_t dev, const struct d_superblock *d_sb)
+{
+	int n;                 /* Records replayed. */
+	unsigned start;        /* First record.     */
+	struct journal *j;     /* Journal.          */
+	struct buffer *buf;    /* Header buffer.    */
+	struct d_jheader *hdr; /* Header.           */
+
+	sb->journal = NULL;
+
+	/* No journal. */
+	if (d_sb->s_journal_nblocks == 0)
+		return (0);
+
+	/* Bad journal area. */
+	if ((d_sb->s_journal_nblocks < JOURNAL_SIZE_MIN) ||
+		(d_sb->s_journal_nblocks > JOURNAL_SIZE_MAX) ||
+		(d_sb->s_journal_start < 2) ||
+		(d_sb->s_journal_start + d_sb->s_journal_nblocks > d_sb->s_first_data_block))
+	{
+		kprintf("fs: bad journal area");
+		return (-1);
+	}
+
+	/* Get empty journal. */
+	for (j = &journals[0]; j < &journals[NR_SUPERBLOCKS]; j++)
+	{
+		if (j->sb == NULL)
+			goto found;
+	}
+
+	kprintf("fs: journal table overflow");
+	return (-1);
+
+found:
+
+	buf = bread(dev, d_sb->s_journal_start);
+	hdr = buf->data;
+
+	/* Bad magic number. */
+	if (hdr->h_magic != JOURNAL_MAGIC)
+	{
+		brelse(buf);
+		kprintf("fs: bad journal magic number");
+		return (-1);
+	}
+
+	start = hdr->h_start;
+	j->seq = hdr->h_seq;
+	brelse(buf);
+
+	j->dev = dev;
+	j->start = d_sb->s_journal_start;
+	j->nblocks = d_sb->s_journal_nblocks;
+	j->max = (j->nblocks - 11)/5;
+	if (j->max > JOURNAL_TRANS_MAX)
+		j->max = JOURNAL_TRANS_MAX;
+	j->nrun = 0;
+	j->busy = 0;
+	j->resetting = 0;
+	j->gen = 0;
+	waitq_init(&j->chain);
+
+	/* Replay journal. */
+	if (start != 0)
+	{
+		if ((n = journal_replay(j, start)) < 0)
+			return (-1);
+
+		if (n > 0)
+		{
+			bsync();
+			kprintf("fs: replayed %d journal transactions", n);
+		}
+	}
+
+	/* Start over. */
+	kmemset(j->home, 0, sizeof(j->home));
+	j->head = 1;
+	j->tail = 1;
+	j->used = 0;
+	j->enabled = 1;
+	journal_header(j, 1, j->seq);
+
+	j->sb = sb;
+	sb->journal = j;
+
+	return (0);
+}
+
+/**
+ * @brief Closes the journal of a file system.
+ *
+ * @details Detaches the journal from the superblock pointed to by @p sb. The
+ *          running transaction is not committed, but written in place, and
+ *          replay is turned off.
+ *
+ * @param sb Target superblock.
+ */
+PUBLIC void journal_close(struct superblock *sb)
+{
+	struct journal *j;  /* Journal.        */
+	struct buffer *buf; /* Working buffer. */
+
+	/* No journal. */
+	if ((j = sb->journal) == NULL)
+		return;
+
+	journal_lock(j);
+
+	journal_fallback(j);
+
+	while (j->nrun > 0)
+	{
+		buf = j->run[--j->nrun].buf;
+		blklock(buf);
+		disable_interrupts();
+		buf->flags &= ~BUFFER_JOURNAL;
+		enable_interrupts();
+		brelse(buf);
+	}
+
+	journal_unlock(j);
+
+	j->sb = NULL;
+	sb->journal = NULL;
+}
+
+/**
+ * @brief Marks a metadata block buffer as dirty.
+ *
+ * @details Sets the dirty flag of the block buffer pointed to by @p buf and,
+ *          if the file system of the superblock pointed to by @p sb has a
+ *          journal, adds it to the running transaction.
+ *
+ * @param sb  Superblock of the file system.
+ * @param buf Buffer to be marked dirty.
+ *
+ * @note The buffer must be locked.
+ */
+PUBLIC void journal_dirty(struct superblock *sb, struct buffer *buf)
+{
+	buffer_dirty(buf, 1);
+
+	if (sb->journal != NULL)
+		journal_add(sb->journal, buf, 0);
+}
+
+/**
+ * @brief Marks a metadata block buffer as dirtied by a file.
+ *
+ * @details Same as buffer_attach(), but the buffer is added to the running
+ *          transaction of the journal of the file system, if any.
+ *
+ * @param buf Buffer to be marked dirty.
+ * @param ip  File that dirtied the buffer.
+ *
+ * @note The buffer must be locked.
+ */
+PUBLIC void journal_attach(struct buffer *buf, struct inode *ip)
+{
+	buffer_attach(buf, ip);
+
+	if (ip->sb->journal != NULL)
+		journal_add(ip->sb->journal, buf, 0);
+}
+
+/**
+ * @brief Revokes a block.
+ *
+ * @details Called when a disk block is allocated. If the block is logged in
+ *          the journal of the file system, its buffer is held back until a
+ *          transaction that revokes these images is committed, so that they
+ *          are not replayed over whatever the block gets to hold.
+ *
+ * @param sb  Superblock of the file system.
+ * @param buf Buffer of the allocated block.
+ *
+ * @note The buffer must be locked.
+ */
+PUBLIC void journal_revoke(struct superblock *sb, struct buffer *buf)
+{
+	struct journal *j;
+
+	/* No journal. */
+	if ((j = sb->journal) == NULL)
+		return;
+
+	/* Not logged. */
+	if (!(buf->flags & (BUFFER_JOURNAL | BUFFER_COMMIT)))
+	{
+		if (!journal_logged(j, buf->num))
+			return;
+	}
+
+	journal_add(j, buf, 1);
+}
+
+/**
+ * @brief Commits metadata changes of a file system.
+ *
+ * @details Commits the running transaction of the journal of the file system
+ *          of the superblock pointed to by @p sb, waiting for files to stop
+ *          being changed, and for the record to reach the media.
+ *
+ * @param sb Target superblock.
+ *
+ * @note No inode may be locked by the caller.
+ */
+PUBLIC void journal_commit(struct superblock *sb)
+{
+	if (sb->journal != NULL)
+		journal_flush(sb->journal, 1);
+}
+
+/**
+ * @brief Commits metadata changes.
+ *
+ * @details Commits the running transactions that are older than @p age clock
+ *          ticks, or that are half full. When @p age is not zero, commits are
+ *          skipped while files are being changed, rather than waited for.
+ *
+ * @param age Minimum age (in clock ticks).
+ *
+ * @note No inode may be locked by the caller.
+ */
+PUBLIC void journal_sync(unsigned age)
+{
+	for (struct journal *j = &journals[0]; j < &journals[NR_SUPERBLOCKS]; j++)
+	{
+		if (j->sb == NULL)
+			continue;
+
+		/* Replay is off, so go for a checkpoint. */
+		if (!j->enabled)
+			goto commit;
+
+		/* Nothing to commit. */
+		if (j->nrun == 0)
+			continue;
+
+		/* Young transaction. */
+		if ((ticks - j->since < age) && (j->nrun < j->max/2))
+			continue;
+
+commit:
+		journal_flush(j, age == 0);
+	}
+}
+
+/**
+ * @brief Empties journals.
+ *
+ * @details Commits all running transactions and drops all records, so that
+ *          nothing is replayed next time. This is called at shutdown.
+ *
+ * @note No inode may be locked by the caller.
+ */
+PUBLIC void journal_clean(void)
+{
+	for (struct journal *j = &journals[0]; j < &journals[NR_SUPERBLOCKS]; j++)
+	{
+		if (j->sb == NULL)
+			continue;
+
+		journal_lock(j);
+		journal_write(j, 1);
+		journal_checkpoint(j);
+		journal_unlock(j);
+	}
+}
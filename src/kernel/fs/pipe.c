@@ -19,102 +19,252 @@
 
 #include <nanvix/const.h>
 #include <nanvix/fs.h>
+#include <nanvix/klib.h>
+#include <nanvix/mm.h>
 #include <nanvix/pm.h>
 #include <errno.h>
+#include <limits.h>
+#include <poll.h>
+
+/*
+ * Number of bytes stored in a pipe.
+ */
+#define pipe_used(inode) \
+	((size_t)(((inode)->pipe->head - (inode)->pipe->tail + (inode)->size) \
+		%(inode)->size))
+
+/*
+ * Number of bytes that still fit in a pipe. One byte is left
+ * unused, so that a full pipe can be told from an empty one.
+ */
+#define pipe_room(inode) \
+	((size_t)(inode)->size - 1 - pipe_used(inode))
+
+/*
+ * Address of the byte at a given position of a pipe.
+ */
+#define pipe_data(inode, pos) \
+	(&(inode)->pipe->pages[(pos)/PAGE_SIZE][(pos)%PAGE_SIZE])
+
+/*
+ * Caps a chunk to the page boundary past a given position of a pipe.
+ */
+#define pipe_chunk(pos, chunk) \
+	(((chunk) > PAGE_SIZE - (pos)%PAGE_SIZE) ? PAGE_SIZE - (pos)%PAGE_SIZE : (chunk))
 
 /*
  * Reads data from a pipe.
  */
-PUBLIC ssize_t pipe_read(struct inode *inode, char *buf, size_t n)
+PUBLIC ssize_t pipe_read(struct inode *inode, char *buf, size_t n, int nonblock)
 {
-	char *r;
-	
-	r = buf;
-	
-	/* No writers. */
-	wakeup(&inode->chain);
-	if (inode->count != 2)
-		return (0);
+	size_t i;     /* Bytes read.                  */
+	size_t room;  /* Room in the pipe beforehand. */
+	size_t chunk; /* Contiguous chunk size.       */
 	
-	/* Read from pipe. */
-	while (n-- > 0)
-	{	
-		/* Sleep while pipe is empty. */
-		while (inode->head == inode->tail)
+	/* Sleep while pipe is empty. */
+	while (inode->pipe->head == inode->pipe->tail)
+	{
+		/* No writers. */
+		if (inode->count != 2)
+			return (0);
+		
+		/* Would block. */
+		if (nonblock)
 		{
-			/* No writers. */
-			wakeup(&inode->chain);
-			if (inode->count != 2)
-				return (r - buf);
-				
-			sleep(&inode->chain, PRIO_INODE);
-			
-			/* Awaken by a signal. */
-			if (issig())
-			{
-				curr_proc->errno = -EINTR;
-				return (-1);
-			}
+			curr_proc->errno = -EAGAIN;
+			return (-1);
+		}
 			
+		sleep(&inode->chain, PRIO_INODE);
+		
+		/* Awaken by a signal. */
+		if (issig())
+		{
+			curr_proc->errno = -EINTR;
+			return (-1);
 		}
+	}
+	
+	room = pipe_room(inode);
+	
+	/* Read as much as we can, a page at a time. */
+	for (i = 0; (i < n) && (inode->pipe->head != inode->pipe->tail); i += chunk)
+	{
+		chunk = ((inode->pipe->head > inode->pipe->tail) ?
+			inode->pipe->head : inode->size) - inode->pipe->tail;
+		if (chunk > n - i)
+			chunk = n - i;
+		chunk = pipe_chunk((size_t)inode->pipe->tail, chunk);
 		
-		*r++ = inode->pipe[inode->tail];
-		inode->tail = (inode->tail + 1)%inode->size;
-		wakeup(&inode->chain);
+		kmemcpy(&buf[i], pipe_data(inode, inode->pipe->tail), chunk);
+		inode->pipe->tail = (inode->pipe->tail + chunk)%inode->size;
 	}
 	
-	return (r - buf);
+	/*
+	 * Writers wait for PIPE_BUF bytes of room at most,
+	 * so wake them up only when crossing that mark.
+	 */
+	if ((room < PIPE_BUF) && (pipe_room(inode) >= PIPE_BUF))
+	{
+		wakeup(&inode->chain);
+		pollwakeup(inode);
+	}
 	
+	return (i);
 }
 
 /*
  * Writes data to a pipe.
  */
-PUBLIC ssize_t pipe_write(struct inode *inode, const char *buf, size_t n)
+PUBLIC ssize_t pipe_write(struct inode *inode, const char *buf, size_t n, int nonblock)
 {
-	const char *w;
+	size_t i;     /* Bytes written.          */
+	size_t want;  /* Room needed to go on.   */
+	size_t chunk; /* Contiguous chunk size.  */
+	int empty;    /* Was the pipe empty?     */
 	
-	w = buf;
+	/* Writes of up to PIPE_BUF bytes are atomic. */
+	want = (n <= PIPE_BUF) ? n : 1;
 	
-	/* No readers. */
-	wakeup(&inode->chain);
-	if (inode->count != 2)
+	for (i = 0; i < n; /* noop */)
 	{
-		curr_proc->errno = -EPIPE;
-		sndsig(curr_proc, SIGPIPE);
-		return (-1);
-	}
-	
-	/* Write to pipe. */
-	while (n-- > 0)
-	{
-		/* Sleep while pipe is full. */
-		while ((inode->head + 1)%inode->size == inode->tail)
+		/* No readers. */
+		if (inode->count != 2)
 		{
-			/* No readers. */
-			wakeup(&inode->chain);
-			if (inode->count != 2)
+			curr_proc->errno = -EPIPE;
+			sndsig(curr_proc, SIGPIPE);
+			return (-1);
+		}
+		
+		/* Sleep while there is not enough room. */
+		if (pipe_room(inode) < want)
+		{
+			/* Would block. */
+			if (nonblock)
 			{
-				curr_proc->errno = -EPIPE;
-				sndsig(curr_proc, SIGPIPE);
-				return (-1);
+				curr_proc->errno = -EAGAIN;
+				return ((i > 0) ? (ssize_t)i : -1);
 			}
-	
+			
 			sleep(&inode->chain, PRIO_INODE);
 			
 			/* Awaken by a signal. */
 			if (issig())
 			{
 				curr_proc->errno = -EINTR;
-				return (-1);
+				return ((i > 0) ? (ssize_t)i : -1);
 			}
+			
+			continue;
 		}
 		
-		inode->pipe[inode->head] = *w++;
-		inode->head = (inode->head + 1)%inode->size;
-		wakeup(&inode->chain);
+		empty = (inode->pipe->head == inode->pipe->tail);
+		
+		/* Write as much as we can, a page at a time. */
+		while ((i < n) && (pipe_room(inode) > 0))
+		{
+			if (inode->pipe->head >= inode->pipe->tail)
+				chunk = inode->size - inode->pipe->head -
+					((inode->pipe->tail == 0) ? 1 : 0);
+			else
+				chunk = inode->pipe->tail - inode->pipe->head - 1;
+			if (chunk > n - i)
+				chunk = n - i;
+			chunk = pipe_chunk((size_t)inode->pipe->head, chunk);
+			
+			kmemcpy(pipe_data(inode, inode->pipe->head), &buf[i], chunk);
+			inode->pipe->head = (inode->pipe->head + chunk)%inode->size;
+			i += chunk;
+		}
+		
+		/* Readers sleep on empty pipes only. */
+		if (empty)
+		{
+			wakeup(&inode->chain);
+			pollwakeup(inode);
+		}
 	}
 	
-	return (w - buf);
+	return (i);
+}
+
+/*
+ * Changes the capacity of a pipe.
+ */
+PUBLIC int pipe_resize(struct inode *inode, size_t size)
+{
+	size_t i;                    /* Loop index.          */
+	size_t used;                 /* Bytes in the pipe.   */
+	size_t chunk;                /* Contiguous chunk.    */
+	unsigned npages;             /* New number of pages. */
+	char *pages[PIPE_PAGES_MAX]; /* New pipe pages.      */
+	
+	npages = (size + PAGE_SIZE - 1)/PAGE_SIZE;
+	if (npages == 0)
+		npages = 1;
+	
+	/* Too big. */
+	if (npages > PIPE_PAGES_MAX)
+		return (-EINVAL);
+	
+	used = pipe_used(inode);
+	
+	/* Data would not fit. */
+	if (npages*PAGE_SIZE - 1 < used)
+		return (-EBUSY);
+	
+	/* Nothing to be done. */
+	if (npages*PAGE_SIZE == (size_t)inode->size)
+		return (inode->size);
+	
+	/* Get new pipe pages. */
+	for (i = 0; i < npages; i++)
+	{
+		if ((pages[i] = getkpg(0)) == NULL)
+		{
+			while (i-- > 0)
+				putkpg(pages[i]);
+			return (-ENOMEM);
+		}
+	}
+	
+	/* Move data to the start of the new pages. */
+	for (i = 0; i < used; i += chunk)
+	{
+		chunk = ((inode->pipe->head > inode->pipe->tail) ?
+			inode->pipe->head : inode->size) - inode->pipe->tail;
+		chunk = pipe_chunk((size_t)inode->pipe->tail, chunk);
+		chunk = pipe_chunk(i, chunk);
+		
+		kmemcpy(&pages[i/PAGE_SIZE][i%PAGE_SIZE],
+			pipe_data(inode, inode->pipe->tail), chunk);
+		inode->pipe->tail = (inode->pipe->tail + chunk)%inode->size;
+	}
+	
+	for (i = 0; i < (size_t)inode->size/PAGE_SIZE; i++)
+		putkpg(inode->pipe->pages[i]);
+	for (i = 0; i < npages; i++)
+		inode->pipe->pages[i] = pages[i];
+	inode->size = npages*PAGE_SIZE;
+	inode->pipe->head = used;
+	inode->pipe->tail = 0;
+	
+	/* Writers may have room now. */
+	wakeup(&inode->chain);
+	pollwakeup(inode);
+	
+	return (inode->size);
+}
+
+/*
+ * Asserts which operations on a pipe would not block.
+ */
+PUBLIC int pipe_poll(struct inode *inode)
+{
+	/* One end is gone, so nothing blocks. */
+	if (inode->count != 2)
+		return (POLLIN | POLLOUT | POLLHUP);
 	
+	return (((inode->pipe->head != inode->pipe->tail) ? POLLIN : 0) |
+		((pipe_room(inode) >= PIPE_BUF) ? POLLOUT : 0));
 }
@@ -0,0 +1,199 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ * 
+ * @brief Boot-time prefetch module implementation.
+ * 
+ * @details The first boot that finds an empty trace file records every
+ *          block read from disk, up to #BOOT_TRACE_SIZE blocks, during the
+ *          first #BOOT_TRACE_TIME seconds, and saves that trace to the file.
+ *          Every later boot reads the trace back, and issues its blocks as
+ *          sorted read-ahead requests before init starts, so that block
+ *          device drivers may merge them into large transfers. Truncate the
+ *          trace file to record a new trace on the next boot.
+ */
+
+#include <nanvix/clock.h>
+#include <nanvix/config.h>
+#include <nanvix/const.h>
+#include <nanvix/fs.h>
+#include <nanvix/klib.h>
+#include <nanvix/timer.h>
+#include <nanvix/work.h>
+#include "fs.h"
+
+#if (BOOT_PREFETCH)
+
+/**
+ * @brief Boot trace file.
+ */
+#define BOOT_TRACE_FILE "/etc/boottrace"
+
+/**
+ * @brief Boot trace record.
+ */
+struct btrace
+{
+	dev_t dev;   /**< Device number. */
+	block_t num; /**< Block number.  */
+};
+
+/**
+ * @brief Boot trace.
+ */
+PRIVATE struct
+{
+	struct inode *file;                  /**< Trace file.        */
+	int recording;                       /**< Recording?         */
+	unsigned n;                          /**< Number of records. */
+	struct btrace recs[BOOT_TRACE_SIZE]; /**< Records.           */
+	struct timer timer;                  /**< Stops recording.   */
+	struct work work;                    /**< Saves the trace.   */
+} boot;
+
+/**
+ * @brief Records a block read from disk.
+ * 
+ * @param dev Device number.
+ * @param num Block number.
+ */
+PUBLIC void boot_record(dev_t dev, block_t num)
+{
+	if (!boot.recording)
+		return;
+	
+	/* Trace is full. */
+	if (boot.n == BOOT_TRACE_SIZE)
+		return;
+	
+	boot.recs[boot.n].dev = dev;
+	boot.recs[boot.n].num = num;
+	boot.n++;
+}
+
+/**
+ * @brief Saves the boot trace.
+ * 
+ * @param arg Unused.
+ */
+PRIVATE void boot_save(void *arg)
+{
+	ssize_t n; /* Size of trace (in bytes). */
+	
+	UNUSED(arg);
+	
+	boot.recording = 0;
+	
+	n = boot.n*sizeof(struct btrace);
+	if ((n > 0) && (file_write(boot.file, boot.recs, n, 0) != n))
+		kprintf("fs: failed to save boot trace");
+	else
+		kprintf("fs: %d blocks in boot trace", boot.n);
+	
+	inode_put(boot.file);
+	boot.file = NULL;
+}
+
+/**
+ * @brief Stops recording the boot trace.
+ * 
+ * @param arg Unused.
+ */
+PRIVATE void boot_tick(void *arg)
+{
+	UNUSED(arg);
+	
+	boot.recording = 0;
+	work_queue(&boot.work);
+}
+
+/**
+ * @brief Asserts if a boot trace record comes before another.
+ * 
+ * @param r1 First record.
+ * @param r2 Second record.
+ * 
+ * @returns Non-zero if @p r1 comes before @p r2, or zero otherwise.
+ */
+PRIVATE inline int boot_before(const struct btrace *r1, const struct btrace *r2)
+{
+	return ((r1->dev < r2->dev) ||
+		((r1->dev == r2->dev) && (r1->num < r2->num)));
+}
+
+/**
+ * @brief Prefetches the blocks that were read during a previous boot.
+ * 
+ * @details Reads the boot trace file. The blocks that it lists are sorted
+ *          and read ahead. If the file is empty, a new trace is recorded
+ *          instead. Nothing is done if there is no such file.
+ */
+PUBLIC void boot_prefetch(void)
+{
+	ssize_t n;       /* Size of trace (in bytes). */
+	unsigned i, j;   /* Loop indexes.             */
+	struct btrace r; /* Working record.           */
+	
+	if ((boot.file = inode_name(BOOT_TRACE_FILE)) == NULL)
+		return;
+	
+	/* Record a new trace. */
+	if (boot.file->size == 0)
+	{
+		kprintf("fs: recording boot trace");
+		work_init(&boot.work, boot_save, NULL);
+		timer_init(&boot.timer, boot_tick, NULL);
+		timer_add(&boot.timer, ticks + BOOT_TRACE_TIME*CLOCK_FREQ);
+		boot.recording = 1;
+		return;
+	}
+	
+	n = file_read(boot.file, boot.recs, sizeof(boot.recs), 0, 0);
+	inode_put(boot.file);
+	boot.file = NULL;
+	
+	if (n < 0)
+		return;
+	
+	boot.n = n/sizeof(struct btrace);
+	
+	/* Sort blocks, so that adjacent ones are requested together. */
+	for (i = 1; i < boot.n; i++)
+	{
+		r = boot.recs[i];
+		for (j = i; (j > 0) && boot_before(&r, &boot.recs[j - 1]); j--)
+			boot.recs[j] = boot.recs[j - 1];
+		boot.recs[j] = r;
+	}
+	
+	/* Read blocks ahead. */
+	for (i = 0; i < boot.n; i++)
+	{
+		if ((i > 0) && !boot_before(&boot.recs[i - 1], &boot.recs[i]))
+			continue;
+		
+		breada(boot.recs[i].dev, boot.recs[i].num);
+	}
+	
+	kprintf("fs: prefetching %d blocks from boot trace", boot.n);
+}
+
+#endif /* BOOT_PREFETCH */
@@ -0,0 +1,1125 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/fs.h>
+#include <nanvix/klib.h>
+#include <nanvix/mm.h>
+#include <nanvix/net.h>
+#include <nanvix/pm.h>
+#include <nanvix/socket.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+
+/*
+ * Header of a datagram record.
+ */
+struct dgram
+{
+	unsigned len;     /* Data length.        */
+	unsigned namelen; /* Sender name length. */
+};
+
+/*
+ * Offset of the path name in a socket address.
+ */
+#define SUN_PATH_OFF (sizeof(sa_family_t))
+
+/*
+ * Address of the byte at a given position of a receive buffer.
+ */
+#define socket_data(so, pos) \
+	(&(so)->pages[((pos)%SOCK_BUFSIZ)/PAGE_SIZE][(pos)%PAGE_SIZE])
+
+/*
+ * Caps a chunk to the page boundary past a given position.
+ */
+#define socket_chunk(pos, chunk) \
+	(((chunk) > PAGE_SIZE - (pos)%PAGE_SIZE) ? PAGE_SIZE - (pos)%PAGE_SIZE : (chunk))
+
+/*
+ * Asserts if a position comes before another one.
+ */
+#define socket_before(a, b) \
+	((int)((a) - (b)) < 0)
+
+/* Socket cache. */
+PRIVATE struct kcache sockets = KCACHE("sockets", sizeof(struct socket), NULL);
+
+/* Cache of files in flight. */
+PRIVATE struct kcache rightq = KCACHE("rights", sizeof(struct rights), NULL);
+
+/*
+ * Wakes up all processes sleeping in a chain.
+ */
+PRIVATE void socket_wakeall(struct waitq *chain)
+{
+	while (!waitq_empty(chain))
+		wakeup_one(chain);
+}
+
+/*
+ * Gets the receive buffer of a socket.
+ */
+PRIVATE int socket_buffer(struct socket *so)
+{
+	unsigned i; /* Loop index. */
+	
+	/* Nothing to be done. */
+	if (so->pages[0] != NULL)
+		return (0);
+	
+	for (i = 0; i < SOCK_PAGES; i++)
+	{
+		/* Failed to get page. */
+		if ((so->pages[i] = getkpg(0)) == NULL)
+		{
+			while (i-- > 0)
+			{
+				putkpg(so->pages[i]);
+				so->pages[i] = NULL;
+			}
+			return (-ENOMEM);
+		}
+	}
+	
+	return (0);
+}
+
+/*
+ * Frees a socket whose last file has been closed and that
+ * no sender is writing to.
+ */
+PRIVATE void socket_free(struct socket *so)
+{
+	unsigned i; /* Loop index. */
+	
+	for (i = 0; i < SOCK_PAGES; i++)
+	{
+		if (so->pages[i] != NULL)
+			putkpg(so->pages[i]);
+	}
+	
+	kcache_free(so);
+}
+
+/*
+ * Drops a sender off a socket.
+ */
+PRIVATE void socket_unbusy(struct socket *so)
+{
+	if ((--so->busy == 0) && (so->flags & SOCKET_DEAD))
+		socket_free(so);
+}
+
+/*
+ * Copies data into the receive buffer of a socket.
+ */
+PRIVATE void socket_copyin(struct socket *so, const char *buf, size_t n)
+{
+	size_t i;     /* Bytes copied.          */
+	size_t chunk; /* Contiguous chunk size. */
+	
+	for (i = 0; i < n; i += chunk)
+	{
+		chunk = socket_chunk(so->head, n - i);
+		kmemcpy(socket_data(so, so->head), &buf[i], chunk);
+		so->head += chunk;
+	}
+}
+
+/*
+ * Copies data out of the receive buffer of a socket. If buf
+ * is a NULL pointer, data is just dropped.
+ */
+PRIVATE void socket_copyout(struct socket *so, char *buf, size_t n)
+{
+	size_t i;     /* Bytes copied.          */
+	size_t chunk; /* Contiguous chunk size. */
+	
+	for (i = 0; i < n; i += chunk)
+	{
+		chunk = socket_chunk(so->tail, n - i);
+		if (buf != NULL)
+			kmemcpy(&buf[i], socket_data(so, so->tail), chunk);
+		so->tail += chunk;
+	}
+}
+
+/*
+ * Copies data from an I/O vector into the receive buffer of a
+ * socket, skipping the first off bytes.
+ */
+PRIVATE size_t socket_gather(struct socket *so, const struct iovec *iov, int iovcnt, size_t off, size_t n)
+{
+	int k;        /* Loop index.            */
+	size_t i;     /* Bytes copied.          */
+	size_t chunk; /* Bytes from the buffer. */
+	
+	for (i = 0, k = 0; (k < iovcnt) && (i < n); k++)
+	{
+		/* Skip what has been sent already. */
+		if (off >= iov[k].iov_len)
+		{
+			off -= iov[k].iov_len;
+			continue;
+		}
+		
+		chunk = iov[k].iov_len - off;
+		if (chunk > n - i)
+			chunk = n - i;
+		socket_copyin(so, (char *)iov[k].iov_base + off, chunk);
+		off = 0;
+		i += chunk;
+	}
+	
+	return (i);
+}
+
+/*
+ * Copies data from the receive buffer of a socket into an
+ * I/O vector.
+ */
+PRIVATE size_t socket_scatter(struct socket *so, const struct iovec *iov, int iovcnt, size_t n)
+{
+	int k;        /* Loop index.          */
+	size_t i;     /* Bytes copied.        */
+	size_t chunk; /* Bytes to the buffer. */
+	
+	for (i = 0, k = 0; (k < iovcnt) && (i < n); k++)
+	{
+		chunk = iov[k].iov_len;
+		if (chunk > n - i)
+			chunk = n - i;
+		socket_copyout(so, iov[k].iov_base, chunk);
+		i += chunk;
+	}
+	
+	return (i);
+}
+
+/*
+ * Queues files in flight at a socket, tagged with its current
+ * head position.
+ */
+PRIVATE void socket_attach(struct socket *so, struct rights *r)
+{
+	struct rights **rp; /* Queue walker. */
+	
+	r->seq = so->head;
+	r->next = NULL;
+	for (rp = &so->rights; *rp != NULL; rp = &(*rp)->next)
+		/* noop */;
+	*rp = r;
+}
+
+/*
+ * Takes out files in flight whose data has been consumed.
+ */
+PRIVATE void socket_detach(struct socket *so, struct rights **r)
+{
+	struct rights *q; /* Files in flight. */
+	
+	while (((q = so->rights) != NULL) && socket_before(q->seq, so->tail))
+	{
+		so->rights = q->next;
+		q->next = NULL;
+		
+		/* Hand files to the caller. */
+		if ((r != NULL) && (*r == NULL))
+			*r = q;
+		
+		/* Nobody to take them. */
+		else
+			rights_free(q);
+	}
+}
+
+/*
+ * Gets files in flight.
+ */
+PUBLIC struct rights *rights_alloc(void)
+{
+	struct rights *r; /* Files in flight. */
+	
+	if ((r = kcache_alloc(&rightq)) == NULL)
+		return (NULL);
+	
+	r->seq = 0;
+	r->nfiles = 0;
+	r->next = NULL;
+	
+	return (r);
+}
+
+/*
+ * Closes files in flight that were not taken.
+ */
+PUBLIC void rights_free(struct rights *r)
+{
+	unsigned i; /* Loop index. */
+	
+	for (i = 0; i < r->nfiles; i++)
+	{
+		if (r->files[i] != NULL)
+			releasefile(r->files[i]);
+	}
+	
+	kcache_free(r);
+}
+
+/*
+ * Creates a socket.
+ */
+PUBLIC struct socket *socket_alloc(int domain, int type)
+{
+	unsigned i;        /* Loop index.   */
+	struct socket *so; /* Socket.       */
+	struct inode *ip;  /* Socket inode. */
+	
+	if ((so = kcache_alloc(&sockets)) == NULL)
+		return (NULL);
+	
+	so->domain = domain;
+	so->type = type;
+	so->flags = 0;
+	so->name = NULL;
+	so->dest = NULL;
+	so->peer = NULL;
+	so->pending = NULL;
+	so->next = NULL;
+	so->npending = 0;
+	so->backlog = 0;
+	so->busy = 0;
+	for (i = 0; i < SOCK_PAGES; i++)
+		so->pages[i] = NULL;
+	so->head = 0;
+	so->tail = 0;
+	so->rights = NULL;
+	waitq_init(&so->rchain);
+	waitq_init(&so->wchain);
+	so->path[0] = '\0';
+	so->pcb = NULL;
+	
+	/* Datagram sockets may be written to right away. */
+	if ((domain == AF_UNIX) && (type == SOCK_DGRAM) && (socket_buffer(so) < 0))
+		goto error0;
+	
+	/* Failed to get socket inode. */
+	if ((ip = inode_socket()) == NULL)
+		goto error0;
+	
+	ip->sock = so;
+	so->inode = ip;
+	
+	return (so);
+	
+error0:
+	socket_free(so);
+	return (NULL);
+}
+
+/*
+ * Releases a reference to a socket.
+ */
+PUBLIC void socket_put(struct socket *so)
+{
+	inode_lock(so->inode);
+	inode_put(so->inode);
+}
+
+/*
+ * Tears down a socket whose last file has been closed.
+ */
+PUBLIC void socket_release(struct socket *so)
+{
+	struct socket *ps; /* Pending connection. */
+	struct rights *r;  /* Files in flight.    */
+	struct inode *ip;  /* Name inode.         */
+	
+	so->flags |= SOCKET_DEAD;
+	
+	/* Hand over to the protocol. */
+	if (so->domain == AF_INET)
+		inet_release(so);
+	
+	/* Hang up peer. */
+	if (so->peer != NULL)
+	{
+		so->peer->peer = NULL;
+		so->peer->flags |= SOCKET_HUP;
+		socket_wakeall(&so->peer->rchain);
+		pollwakeup(so->peer->inode);
+		so->peer = NULL;
+	}
+	
+	/* Refuse pending connections. */
+	while ((ps = so->pending) != NULL)
+	{
+		so->pending = ps->next;
+		socket_put(ps);
+	}
+	
+	/* Close files in flight. */
+	while ((r = so->rights) != NULL)
+	{
+		so->rights = r->next;
+		rights_free(r);
+	}
+	
+	/* Unbind name. */
+	if ((ip = so->name) != NULL)
+	{
+		so->name = NULL;
+		ip->sock = NULL;
+		inode_lock(ip);
+		inode_put(ip);
+	}
+	
+	/* Drop default destination. */
+	if ((ip = so->dest) != NULL)
+	{
+		so->dest = NULL;
+		inode_lock(ip);
+		inode_put(ip);
+	}
+	
+	/* Senders shall find the socket gone. */
+	socket_wakeall(&so->rchain);
+	socket_wakeall(&so->wchain);
+	
+	if (so->busy == 0)
+		socket_free(so);
+}
+
+/*
+ * Gets the socket of a file descriptor.
+ */
+PUBLIC struct socket *socket_get(int fd)
+{
+	struct file *f; /* File. */
+	
+	/* Invalid file descriptor. */
+	if ((fd < 0) || (fd >= OPEN_MAX) || ((f = curr_proc->ofiles[fd]) == NULL))
+	{
+		curr_proc->errno = -EBADF;
+		return (NULL);
+	}
+	
+	/* Not a socket. */
+	if (!(f->inode->flags & INODE_SOCKET))
+	{
+		curr_proc->errno = -ENOTSOCK;
+		return (NULL);
+	}
+	
+	return (f->inode->sock);
+}
+
+/*
+ * Opens a file for a socket. On success, the file takes over
+ * the reference to the socket.
+ */
+PUBLIC int socket_install(struct socket *so)
+{
+	int fd;         /* File descriptor. */
+	struct file *f; /* File.            */
+	
+	/* Too many opened files. */
+	if ((fd = getfildes()) < 0)
+		return (-EMFILE);
+	
+	/* Too many files open in the system. */
+	if ((f = getfile()) == NULL)
+		return (-ENFILE);
+	
+	f->oflag = O_RDWR;
+	f->count = 1;
+	f->pos = 0;
+	f->inode = so->inode;
+	f->ra_pos = 0;
+	f->ra_size = 0;
+	f->advice = POSIX_FADV_NORMAL;
+	curr_proc->ofiles[fd] = f;
+	curr_proc->ofmap |= 1 << fd;
+	curr_proc->close &= ~(1 << fd);
+	
+	return (fd);
+}
+
+/*
+ * Copies the path name of a socket address into path, which
+ * shall have room for SOCK_PATH_MAX bytes.
+ */
+PUBLIC int socket_path(const struct sockaddr *addr, socklen_t len, char *path)
+{
+	size_t i;                      /* Loop index. */
+	const struct sockaddr_un *sun; /* Address.    */
+	
+	/* Invalid address. */
+	if ((len <= SUN_PATH_OFF) || (len > sizeof(struct sockaddr_un)))
+		return (-EINVAL);
+	if (!chkmem(addr, len, MAY_READ))
+		return (-EINVAL);
+	
+	sun = (const struct sockaddr_un *)addr;
+	
+	/* Unsupported address family. */
+	if (sun->sun_family != AF_UNIX)
+		return (-EAFNOSUPPORT);
+	
+	for (i = 0; (i < len - SUN_PATH_OFF) && (sun->sun_path[i] != '\0'); i++)
+	{
+		/* Path name too long. */
+		if (i == SOCK_PATH_MAX - 1)
+			return (-ENAMETOOLONG);
+		
+		path[i] = sun->sun_path[i];
+	}
+	path[i] = '\0';
+	
+	/* Unnamed address. */
+	if (i == 0)
+		return (-EINVAL);
+	
+	return (0);
+}
+
+/*
+ * Fills in the socket address of a path name. At most *lenp bytes
+ * are written, and *lenp is then set to the full address length.
+ */
+PUBLIC void socket_name(const char *path, struct sockaddr *addr, socklen_t *lenp)
+{
+	socklen_t len;          /* Address length. */
+	struct sockaddr_un sun; /* Address.        */
+	
+	sun.sun_family = AF_UNIX;
+	kstrncpy(sun.sun_path, path, SOCK_PATH_MAX);
+	len = SUN_PATH_OFF + kstrlen(path) + 1;
+	
+	kmemcpy(addr, &sun, (*lenp < len) ? *lenp : len);
+	*lenp = len;
+}
+
+/*
+ * Gets the inode of a name that a socket is bound to. The inode
+ * is returned unlocked.
+ */
+PUBLIC struct inode *socket_lookup(const char *path)
+{
+	struct inode *ip; /* Name inode. */
+	
+	if ((ip = inode_name(path)) == NULL)
+		return (NULL);
+	
+	/* Not a socket. */
+	if (!S_ISSOCK(ip->mode))
+	{
+		curr_proc->errno = -ECONNREFUSED;
+		goto error0;
+	}
+	
+	/* Not allowed to write to socket. */
+	if (!permission(ip->mode, ip->uid, ip->gid, curr_proc, MAY_WRITE, 0))
+	{
+		curr_proc->errno = -EACCES;
+		goto error0;
+	}
+	
+	inode_unlock(ip);
+	
+	return (ip);
+	
+error0:
+	inode_put(ip);
+	return (NULL);
+}
+
+/*
+ * Binds a socket to a name in the file system.
+ */
+PUBLIC int socket_bind(struct socket *so, const char *path)
+{
+	int ret;              /* Return value.     */
+	const char *filename; /* Socket file name. */
+	struct inode *dir;    /* Parent directory. */
+	struct inode *ip;     /* Name inode.       */
+	
+	/* Already bound. */
+	if (so->name != NULL)
+		return (-EINVAL);
+	
+	/* Failed to get parent directory. */
+	if ((dir = inode_dname(path, &filename)) == NULL)
+		return (curr_proc->errno);
+	
+	/* Not allowed to write in parent directory. */
+	if (!permission(dir->mode, dir->uid, dir->gid, curr_proc, MAY_WRITE, 0))
+	{
+		ret = -EACCES;
+		goto error0;
+	}
+	
+	/* Name in use. */
+	if ((*filename == '\0') || (*filename == '/') ||
+		(dir_search(dir, filename) != INODE_NULL))
+	{
+		ret = -EADDRINUSE;
+		goto error0;
+	}
+	
+	/* Failed to allocate inode. */
+	if ((ip = inode_alloc(dir, S_IFSOCK)) == NULL)
+	{
+		ret = curr_proc->errno;
+		goto error0;
+	}
+	
+	ip->mode = (MAY_ALL & ~curr_proc->umask) | S_IFSOCK;
+	
+	/* Failed to add directory entry. */
+	if (dir_add(dir, ip, filename))
+	{
+		ret = curr_proc->errno;
+		inode_put(ip);
+		goto error0;
+	}
+	
+	inode_put(dir);
+	
+	ip->sock = so;
+	so->name = ip;
+	kstrncpy(so->path, path, SOCK_PATH_MAX);
+	inode_unlock(ip);
+	
+	return (0);
+	
+error0:
+	inode_put(dir);
+	return (ret);
+}
+
+/*
+ * Connects a stream socket to a listening one, queuing a new
+ * socket for the connection to be accepted.
+ */
+PUBLIC int socket_connect(struct socket *so, struct socket *lso)
+{
+	int ret;           /* Return value.   */
+	struct socket *ss; /* Server side.    */
+	struct socket **q; /* Pending walker. */
+	
+	if ((ret = socket_buffer(so)) < 0)
+		return (ret);
+	
+	if ((ss = socket_alloc(AF_UNIX, SOCK_STREAM)) == NULL)
+		return (-ENOBUFS);
+	
+	/* Failed to get receive buffer. */
+	if ((ret = socket_buffer(ss)) < 0)
+	{
+		socket_put(ss);
+		return (ret);
+	}
+	
+	so->peer = ss;
+	ss->peer = so;
+	so->flags |= SOCKET_CONNECTED;
+	ss->flags |= SOCKET_CONNECTED;
+	kstrncpy(ss->path, lso->path, SOCK_PATH_MAX);
+	
+	/* Queue connection. */
+	for (q = &lso->pending; *q != NULL; q = &(*q)->next)
+		/* noop */;
+	*q = ss;
+	lso->npending++;
+	
+	wakeup(&lso->rchain);
+	pollwakeup(lso->inode);
+	
+	return (0);
+}
+
+/*
+ * Accepts a pending connection on a listening socket.
+ */
+PUBLIC struct socket *socket_accept(struct socket *so, int nonblock)
+{
+	struct socket *ss; /* Server side. */
+	
+	/* Sleep while there are no pending connections. */
+	while (so->pending == NULL)
+	{
+		/* Would block. */
+		if (nonblock)
+		{
+			curr_proc->errno = -EAGAIN;
+			return (NULL);
+		}
+		
+		sleep_excl(&so->rchain, PRIO_INODE);
+		
+		/* Awaken by a signal. */
+		if (issig())
+		{
+			curr_proc->errno = -EINTR;
+			return (NULL);
+		}
+	}
+	
+	ss = so->pending;
+	so->pending = ss->next;
+	ss->next = NULL;
+	so->npending--;
+	
+	/* Connectors may queue again. */
+	wakeup(&so->wchain);
+	
+	/* Pass on to the next acceptor. */
+	if (so->pending != NULL)
+		wakeup(&so->rchain);
+	
+	return (ss);
+}
+
+/*
+ * Connects two sockets to each other.
+ */
+PUBLIC int socket_pair(struct socket *a, struct socket *b)
+{
+	int ret; /* Return value. */
+	
+	if ((ret = socket_buffer(a)) < 0)
+		return (ret);
+	if ((ret = socket_buffer(b)) < 0)
+		return (ret);
+	
+	a->peer = b;
+	b->peer = a;
+	a->flags |= SOCKET_CONNECTED;
+	b->flags |= SOCKET_CONNECTED;
+	
+	return (0);
+}
+
+/*
+ * Gets the socket that data sent through a socket goes to.
+ */
+PRIVATE struct socket *socket_dest(struct socket *so)
+{
+	/* Connected peer. */
+	if (so->peer != NULL)
+		return (so->peer);
+	
+	/* Default destination. */
+	if (so->dest != NULL)
+		return (so->dest->sock);
+	
+	return (NULL);
+}
+
+/*
+ * Sends data through a stream socket.
+ */
+PRIVATE ssize_t socket_stream_send(struct socket *so, const struct iovec *iov, int iovcnt, size_t n, struct rights **r, int flags)
+{
+	size_t i;          /* Bytes sent.         */
+	size_t chunk;      /* Bytes sent at once. */
+	struct socket *to; /* Receiving socket.   */
+	
+	/* Not connected. */
+	if ((to = so->peer) == NULL)
+	{
+		if (!(so->flags & SOCKET_CONNECTED))
+		{
+			curr_proc->errno = -ENOTCONN;
+			return (-1);
+		}
+		
+		curr_proc->errno = -EPIPE;
+		if (!(flags & MSG_NOSIGNAL))
+			sndsig(curr_proc, SIGPIPE);
+		return (-1);
+	}
+	
+	to->busy++;
+	
+	for (i = 0; i < n; i += chunk)
+	{
+		/* Receiver gone. */
+		if (to->flags & SOCKET_DEAD)
+		{
+			curr_proc->errno = -EPIPE;
+			if (!(flags & MSG_NOSIGNAL))
+				sndsig(curr_proc, SIGPIPE);
+			goto out;
+		}
+		
+		/* Sleep while there is no room. */
+		if (socket_room(to) == 0)
+		{
+			/* Would block. */
+			if (flags & MSG_DONTWAIT)
+			{
+				curr_proc->errno = -EAGAIN;
+				goto out;
+			}
+			
+			sleep_excl(&to->wchain, PRIO_INODE);
+			
+			/* Awaken by a signal. */
+			if (issig())
+			{
+				curr_proc->errno = -EINTR;
+				goto out;
+			}
+			
+			chunk = 0;
+			continue;
+		}
+		
+		/* Files go along with the first byte. */
+		if ((r != NULL) && (*r != NULL))
+		{
+			socket_attach(to, *r);
+			*r = NULL;
+		}
+		
+		chunk = n - i;
+		if (chunk > socket_room(to))
+			chunk = socket_room(to);
+		chunk = socket_gather(to, iov, iovcnt, i, chunk);
+		
+		wakeup(&to->rchain);
+		pollwakeup(to->inode);
+	}
+	
+out:
+	/* Pass on to the next sender. */
+	if (socket_room(to) > 0)
+		wakeup(&to->wchain);
+	
+	socket_unbusy(to);
+	
+	return ((i > 0) ? (ssize_t)i : -1);
+}
+
+/*
+ * Sends a datagram.
+ */
+PRIVATE ssize_t socket_dgram_send(struct socket *so, const struct iovec *iov, int iovcnt, size_t n, struct socket *to, struct rights **r, int flags)
+{
+	ssize_t ret;     /* Return value.  */
+	size_t need;     /* Record size.   */
+	struct dgram hd; /* Record header. */
+	
+	/* No destination. */
+	if ((to == NULL) && ((to = socket_dest(so)) == NULL))
+	{
+		curr_proc->errno = (so->dest != NULL) ? -ECONNREFUSED : -EDESTADDRREQ;
+		return (-1);
+	}
+	
+	hd.len = n;
+	hd.namelen = kstrlen(so->path);
+	need = sizeof(struct dgram) + hd.namelen + n;
+	
+	/* Message too long. */
+	if (need > SOCK_BUFSIZ)
+	{
+		curr_proc->errno = -EMSGSIZE;
+		return (-1);
+	}
+	
+	to->busy++;
+	
+	/* Sleep while the record does not fit. */
+	while (socket_room(to) < need)
+	{
+		/* Receiver gone. */
+		if (to->flags & SOCKET_DEAD)
+		{
+			curr_proc->errno = -ECONNREFUSED;
+			ret = -1;
+			goto out;
+		}
+		
+		/* Would block. */
+		if (flags & MSG_DONTWAIT)
+		{
+			curr_proc->errno = -EAGAIN;
+			ret = -1;
+			goto out;
+		}
+		
+		sleep_excl(&to->wchain, PRIO_INODE);
+		
+		/* Awaken by a signal. */
+		if (issig())
+		{
+			curr_proc->errno = -EINTR;
+			ret = -1;
+			goto out;
+		}
+	}
+	
+	/* Receiver gone. */
+	if (to->flags & SOCKET_DEAD)
+	{
+		curr_proc->errno = -ECONNREFUSED;
+		ret = -1;
+		goto out;
+	}
+	
+	/* Files go along with the record. */
+	if ((r != NULL) && (*r != NULL))
+	{
+		socket_attach(to, *r);
+		*r = NULL;
+	}
+	
+	socket_copyin(to, (const char *)&hd, sizeof(struct dgram));
+	socket_copyin(to, so->path, hd.namelen);
+	socket_gather(to, iov, iovcnt, 0, n);
+	ret = n;
+	
+	wakeup(&to->rchain);
+	pollwakeup(to->inode);
+	
+out:
+	/* Pass on to the next sender. */
+	if (socket_room(to) > 0)
+		wakeup(&to->wchain);
+	
+	socket_unbusy(to);
+	
+	return (ret);
+}
+
+/*
+ * Sends data through a socket. Datagrams go to the socket to, or
+ * to the default destination if to is a NULL pointer. Files in
+ * flight that are sent along are taken out of *r.
+ */
+PUBLIC ssize_t socket_send(struct socket *so, const struct iovec *iov, int iovcnt, struct socket *to, struct rights **r, int flags)
+{
+	int k;    /* Loop index.  */
+	size_t n; /* Bytes to go. */
+	
+	n = 0;
+	for (k = 0; k < iovcnt; k++)
+		n += iov[k].iov_len;
+	
+	if (so->type == SOCK_DGRAM)
+		return (socket_dgram_send(so, iov, iovcnt, n, to, r, flags));
+	
+	/* Nothing to send. */
+	if (n == 0)
+		return (0);
+	
+	return (socket_stream_send(so, iov, iovcnt, n, r, flags));
+}
+
+/*
+ * Receives data from a socket. The sender name is copied to from,
+ * if not a NULL pointer, which shall have room for SOCK_PATH_MAX
+ * bytes. Files in flight that come along are handed in *r, or
+ * closed if r is a NULL pointer. Flags are passed in and out
+ * through *flags.
+ */
+PUBLIC ssize_t socket_recv(struct socket *so, const struct iovec *iov, int iovcnt, char *from, struct rights **r, int *flags)
+{
+	int k;            /* Loop index.           */
+	size_t n;         /* Bytes asked for.      */
+	size_t i;         /* Bytes received.       */
+	size_t avail;     /* Bytes to be received. */
+	struct dgram hd;  /* Record header.        */
+	struct rights *q; /* Files in flight.      */
+	
+	n = 0;
+	for (k = 0; k < iovcnt; k++)
+		n += iov[k].iov_len;
+	
+	/* Sleep while there is no data. */
+	while (socket_used(so) == 0)
+	{
+		if (so->type == SOCK_STREAM)
+		{
+			/* Peer gone. */
+			if (so->flags & SOCKET_HUP)
+				return (0);
+			
+			/* Not connected. */
+			if (!(so->flags & SOCKET_CONNECTED))
+			{
+				curr_proc->errno = -ENOTCONN;
+				return (-1);
+			}
+		}
+		
+		/* Would block. */
+		if (*flags & MSG_DONTWAIT)
+		{
+			curr_proc->errno = -EAGAIN;
+			return (-1);
+		}
+		
+		sleep_excl(&so->rchain, PRIO_INODE);
+		
+		/* Awaken by a signal. */
+		if (issig())
+		{
+			curr_proc->errno = -EINTR;
+			return (-1);
+		}
+	}
+	
+	*flags = 0;
+	
+	/* Stream socket. */
+	if (so->type == SOCK_STREAM)
+	{
+		avail = socket_used(so);
+		
+		/*
+		 * Do not read past files in flight, so that
+		 * each call hands at most one batch of them.
+		 */
+		if ((q = so->rights) != NULL)
+		{
+			if (q->seq == so->tail)
+				q = q->next;
+			if ((q != NULL) && (q->seq - so->tail < avail))
+				avail = q->seq - so->tail;
+		}
+		
+		if (avail > n)
+			avail = n;
+		i = socket_scatter(so, iov, iovcnt, avail);
+		
+		if (from != NULL)
+			kstrncpy(from, (so->peer != NULL) ? so->peer->path : "", SOCK_PATH_MAX);
+	}
+	
+	/* Datagram socket. */
+	else
+	{
+		socket_copyout(so, (char *)&hd, sizeof(struct dgram));
+		socket_copyout(so, from, hd.namelen);
+		if (from != NULL)
+			from[hd.namelen] = '\0';
+		
+		i = socket_scatter(so, iov, iovcnt, (hd.len < n) ? hd.len : n);
+		
+		/* Drop what does not fit. */
+		if (i < hd.len)
+		{
+			socket_copyout(so, NULL, hd.len - i);
+			*flags |= MSG_TRUNC;
+		}
+	}
+	
+	socket_detach(so, r);
+	
+	/* Senders may have room now. */
+	wakeup(&so->wchain);
+	pollwakeup((so->peer != NULL) ? so->peer->inode : so->inode);
+	
+	/* Pass on to the next receiver. */
+	if (socket_used(so) > 0)
+		wakeup(&so->rchain);
+	
+	return (i);
+}
+
+/*
+ * Reads data from a socket.
+ */
+PUBLIC ssize_t socket_read(struct inode *ip, char *buf, size_t n, int nonblock)
+{
+	int flags;        /* Message flags. */
+	struct iovec iov; /* Data buffer.   */
+	
+	iov.iov_base = buf;
+	iov.iov_len = n;
+	flags = (nonblock) ? MSG_DONTWAIT : 0;
+	
+	if (ip->sock->domain == AF_INET)
+		return (inet_recv(ip->sock, &iov, 1, NULL, NULL, &flags));
+	
+	return (socket_recv(ip->sock, &iov, 1, NULL, NULL, &flags));
+}
+
+/*
+ * Writes data to a socket.
+ */
+PUBLIC ssize_t socket_write(struct inode *ip, const char *buf, size_t n, int nonblock)
+{
+	struct iovec iov; /* Data buffer. */
+	
+	iov.iov_base = (void *)buf;
+	iov.iov_len = n;
+	
+	if (ip->sock->domain == AF_INET)
+	{
+		return (inet_send(ip->sock, &iov, 1, NULL, 0,
+			(nonblock) ? MSG_DONTWAIT : 0));
+	}
+	
+	return (socket_send(ip->sock, &iov, 1, NULL, NULL,
+		(nonblock) ? MSG_DONTWAIT : 0));
+}
+
+/*
+ * Asserts which operations on a socket would not block.
+ */
+PUBLIC int socket_poll(struct inode *ip)
+{
+	int revents;       /* Events ready.     */
+	struct socket *so; /* Socket.           */
+	struct socket *to; /* Receiving socket. */
+	
+	so = ip->sock;
+	
+	if (so->domain == AF_INET)
+		return (inet_poll(so));
+	
+	/* Listening socket. */
+	if (so->flags & SOCKET_LISTEN)
+		return ((so->pending != NULL) ? POLLIN : 0);
+	
+	revents = (socket_used(so) > 0) ? POLLIN : 0;
+	
+	/* Peer gone, so nothing blocks. */
+	if (so->flags & SOCKET_HUP)
+		return (revents | POLLIN | POLLOUT | POLLHUP);
+	
+	/* Datagrams to nowhere fail right away. */
+	if ((to = socket_dest(so)) == NULL)
+		return (revents | ((so->type == SOCK_DGRAM) ? POLLOUT : 0));
+	
+	if (socket_room(to) > ((so->type == SOCK_DGRAM) ? sizeof(struct dgram) : 0))
+		revents |= POLLOUT;
+	
+	return (revents);
+}
@@ -18,6 +18,7 @@
  */
 
 #include <nanvix/const.h>
+#include <nanvix/dev.h>
 #include <nanvix/klib.h>
 #include <nanvix/fs.h>
 #include <ustat.h>
@@ -119,6 +120,9 @@ PRIVATE void superblock_write(struct superblock *sb)
 	sb->buf->count++;
 	bwrite(sb->buf);
 	
+	/* Commit to the media. */
+	bdev_flush(sb->dev);
+	
 	sb->flags &= ~SUPERBLOCK_DIRTY;
 }
 
@@ -186,16 +190,22 @@ PUBLIC void superblock_lock(struct superblock *sb)
 {
 	/* Waits for superblock to become unlocked. */
 	while (sb->flags & SUPERBLOCK_LOCKED)
-		sleep(&sb->chain, PRIO_SUPERBLOCK);
+	{
+		sb->waits++;
+		lock_wait(LOCK_SUPERBLOCK, sb->holder, PRIO_SUPERBLOCK);
+		sleep_excl(&sb->chain, PRIO_SUPERBLOCK);
+	}
 		
 	sb->flags |= SUPERBLOCK_LOCKED;
+	sb->holder = curr_proc;
+	lock_acquire(LOCK_SUPERBLOCK);
 }
 
 /**
  * @brief Unlocks a superblock.
  * 
  * @details Unlocks a superblock by marking it as not locked and waking up
- *          all processes that were waiting for it.
+ *          the processes that were waiting for it.
  * 
  * @param sb Superblock to be unlocked.
  * 
@@ -204,6 +214,8 @@ PUBLIC void superblock_lock(struct superblock *sb)
  */
 PUBLIC void superblock_unlock(struct superblock *sb)
 {
+	lock_release(sb->holder);
+	sb->holder = NULL;
 	wakeup(&sb->chain);
 	sb->flags &= ~SUPERBLOCK_LOCKED;
 }
@@ -229,6 +241,7 @@ PUBLIC void superblock_put(struct superblock *sb)
 	/* Release underlying resources. */
 	if (--sb->count == 0)
 	{
+		journal_close(sb);
 		superblock_write(sb);
 			
 		/* Release inode map buffers. */
@@ -255,7 +268,8 @@ PUBLIC void superblock_put(struct superblock *sb)
  *          has completed, the magic number of the block is asserted and
  *          in-core fields are filled.
  * 
- * @param dev Device number.
+ * @param dev   Device number.
+ * @param flags Mount options.
  * 
  * @returns Upon successful completion, a pointer to the in-core superblock
  *          is returned. The superblock is ensured to be locked in this case.
@@ -265,11 +279,14 @@ PUBLIC void superblock_put(struct superblock *sb)
  * 
  * @todo Check for read error on bread().
  */
-PUBLIC struct superblock *superblock_read(dev_t dev)
+PUBLIC struct superblock *superblock_read(dev_t dev, int flags)
 {
-	struct buffer *buf;        /* Buffer disk superblock. */
-	struct superblock *sb;     /* In-core superblock.     */
-	struct d_superblock *d_sb; /* Disk superblock.        */
+	unsigned n;                                 /* Number of map blocks.   */
+	struct buffer *buf;                         /* Buffer disk superblock. */
+	struct superblock *sb;                      /* In-core superblock.     */
+	struct d_superblock *d_sb;                  /* Disk superblock.        */
+	block_t nums[IMAP_SIZE + ZMAP_SIZE];        /* Map blocks.             */
+	struct buffer *maps[IMAP_SIZE + ZMAP_SIZE]; /* Map buffers.            */
 		
 	/* Get empty superblock. */	
 	sb = superblock_empty();
@@ -287,6 +304,14 @@ PUBLIC struct superblock *superblock_read(dev_t dev)
 		goto error1;
 	}
 	
+	/* Block size not supported by this kernel. */
+	if (d_sb->s_log_block_size != BLOCK_SIZE_LOG2 - 10)
+	{
+		kprintf("fs: unsupported block size (%d bytes)",
+			1 << (d_sb->s_log_block_size + 10));
+		goto error1;
+	}
+	
 	/* Too many blocks in the inode/zone map. */
 	if ((d_sb->s_imap_nblocks > IMAP_SIZE)||(d_sb->s_bmap_nblocks > ZMAP_SIZE))
 	{
@@ -294,26 +319,74 @@ PUBLIC struct superblock *superblock_read(dev_t dev)
 		goto error1;
 	}
 	
+	/* Replay journal, which may hold the inode/zone maps. */
+	if (journal_open(sb, dev, d_sb) < 0)
+		goto error1;
+	
 	/* Initialize superblock. */
 	sb->buf = buf;
 	sb->ninodes = d_sb->s_ninodes;
 	sb->imap_blocks = d_sb->s_imap_nblocks;
-	for (unsigned i = 0; i < sb->imap_blocks; i++)
-		blkunlock(sb->imap[i] = bread(dev, 2 + i));
 	sb->zmap_blocks = d_sb->s_bmap_nblocks;
+	
+	/* Read inode and zone maps in one batch. */
+	n = sb->imap_blocks + sb->zmap_blocks;
+	for (unsigned i = 0; i < n; i++)
+		nums[i] = 2 + i;
+	bread_vec(dev, nums, n, maps);
+	for (unsigned i = 0; i < sb->imap_blocks; i++)
+		blkunlock(sb->imap[i] = maps[i]);
 	for (unsigned i = 0; i < sb->zmap_blocks; i++)
-		blkunlock(sb->zmap[i] = bread(dev, 2 + sb->imap_blocks + i));
+		blkunlock(sb->zmap[i] = maps[sb->imap_blocks + i]);
 	sb->first_data_block = d_sb->s_first_data_block;
 	sb->max_size = d_sb->s_max_size;
 	sb->zones = d_sb->s_nblocks;
 	sb->root = NULL;
 	sb->mp = NULL;
 	sb->dev = dev;
+	sb->waits = 0;
 	sb->flags &= ~(SUPERBLOCK_DIRTY | SUPERBLOCK_RDONLY);
+	sb->flags &= ~(SUPERBLOCK_NOATIME | SUPERBLOCK_RELATIME);
 	sb->flags |= SUPERBLOCK_VALID;
-	sb->isearch = 0;
-	sb->zsearch = d_sb->s_first_data_block;
-	sb->chain = NULL;
+	if (flags & MS_NOATIME)
+		sb->flags |= SUPERBLOCK_NOATIME;
+	else if (flags & MS_RELATIME)
+		sb->flags |= SUPERBLOCK_RELATIME;
+	
+	/* Count free zones and inodes. */
+	sb->zfree = 0;
+	sb->zdelay = 0;
+	for (unsigned i = 0; i < sb->zmap_blocks; i++)
+		sb->zfree += bitmap_nclear(sb->zmap[i]->data, BLOCK_SIZE);
+	sb->ifree = 0;
+	for (unsigned i = 0; i < sb->imap_blocks; i++)
+		sb->ifree += bitmap_nclear(sb->imap[i]->data, BLOCK_SIZE);
+	
+	/* Count free zones and inodes of each allocation group. */
+	for (unsigned g = 0; g < NR_GROUPS; g++)
+		sb->gzfree[g] = sb->gifree[g] = 0;
+	for (bit_t i = 0; i < (bit_t)NR_DATA_ZONES(sb); i++)
+	{
+		/* Zone map is too short. */
+		if (i >= sb->zmap_blocks*(BLOCK_SIZE << 3))
+			break;
+		
+		if (!bitmap_test(sb->zmap[i/(BLOCK_SIZE << 3)]->data,
+				i%(BLOCK_SIZE << 3)))
+			sb->gzfree[ZONE_GROUP(sb, sb->first_data_block + i)]++;
+	}
+	for (bit_t i = 0; i < sb->ninodes; i++)
+	{
+		/* Inode map is too short. */
+		if (i >= sb->imap_blocks*(BLOCK_SIZE << 3))
+			break;
+		
+		if (!bitmap_test(sb->imap[i/(BLOCK_SIZE << 3)]->data,
+				i%(BLOCK_SIZE << 3)))
+			sb->gifree[INODE_GROUP(sb, i + 1)]++;
+	}
+	
+	waitq_init(&sb->chain);
 	sb->count++;
 	
 	blkunlock(buf);
@@ -327,6 +400,64 @@ error0:
 	return (NULL);
 }
 
+/**
+ * @brief Searches an inode or zone map for a free bit.
+ * 
+ * @details Searches the first @p nbits bits of the map made of the
+ *          @p nblocks buffers pointed to by @p map for a free bit, starting at
+ *          the 32-bit chunk that holds bit @p from and wrapping around the end
+ *          of the map. This way, a free bit close to @p from is found, rather
+ *          than the lowest one.
+ * 
+ * @param map     Inode or zone map.
+ * @param nblocks Number of blocks in the map.
+ * @param nbits   Number of valid bits in the map.
+ * @param from    Bit where the search should start.
+ * 
+ * @returns If a free bit is found, its number in the map is returned.
+ *          Otherwise, #BITMAP_FULL is returned instead.
+ * 
+ * @note The superblock must be locked.
+ */
+PUBLIC bit_t superblock_search
+(struct buffer **map, block_t nblocks, bit_t nbits, bit_t from)
+{
+	bit_t bit;      /* Bit number in a map block. */
+	unsigned blk;   /* Working map block.         */
+	unsigned chunk; /* First chunk to check.      */
+	
+	blk = from/(BLOCK_SIZE << 3);
+	chunk = (from%(BLOCK_SIZE << 3)) >> 5;
+	
+	/* Start out of the map. */
+	if ((from >= nbits) || (blk >= nblocks))
+		blk = chunk = 0;
+	
+	/* The first block is checked twice, to cover its head. */
+	for (unsigned n = 0; n <= nblocks; n++)
+	{
+		bit = bitmap_first_free((uint32_t *)map[blk]->data + chunk,
+			BLOCK_SIZE - chunk*sizeof(uint32_t));
+		
+		/* Found. */
+		if (bit != BITMAP_FULL)
+		{
+			bit += blk*(BLOCK_SIZE << 3) + (chunk << 5);
+			if (bit < nbits)
+				return (bit);
+			
+			/* Past the valid bits. */
+			blk = nblocks - 1;
+		}
+		
+		/* Wrap around. */
+		blk = (blk + 1 < nblocks) ? blk + 1 : 0;
+		chunk = 0;
+	}
+	
+	return (BITMAP_FULL);
+}
+
 /**
  * @brief Synchronizes the superblock table.
  * 
@@ -355,7 +486,8 @@ PUBLIC void superblock_sync(void)
  * 
  * @details Gets file system statics from the superblock of the file system
  *          pointed to by sb, and stores information in the buffer pointed to
- *          by ubuf.
+ *          by ubuf. Free zones and inodes are not counted here, but are kept
+ *          up to date in the superblock as they get allocated and freed.
  * 
  * @param sb   Superblock of the file system to be inspected.
  * @param ubuf Place where statics should be stored.
@@ -366,33 +498,31 @@ PUBLIC void superblock_sync(void)
  */
 PUBLIC void superblock_stat(struct superblock *sb, struct ustat *ubuf)
 {
-	int tfree;     /* Total free blocks. */
-	int tinode;    /* Total free inodes. */
-	int bmap_size; /* Size of block map. */
-	int imap_size; /* Size of inode map. */
-	
-	/* Count number of free blocks. */
-	tfree = 0;
-	bmap_size = sb->zmap_blocks;
-	for (int i = 0; i < bmap_size; i++)
-	{
-		for (int j = 0; j < (BLOCK_SIZE >> 2); j++)
-			tfree += bitmap_nclear(sb->zmap[i]->data, BLOCK_SIZE);
-	}
+	ubuf->f_tfree = sb->zfree - sb->zdelay;
+	ubuf->f_tinode = sb->ifree;
+	ubuf->f_fname[0] = '\0';
+	ubuf->f_fpack[0] = '\0';
+}
+
+/**
+ * @brief Gets superblock lock statistics.
+ * 
+ * @details Gets statistics about superblock locks, along with the mounted
+ *          devices whose superblock locks were waited for the most, and
+ *          stores them in the location pointed to by @p buf.
+ * 
+ * @param buf Location where statistics shall be stored.
+ */
+PUBLIC void superblock_lockstat(struct lockstat *buf)
+{
+	struct superblock *sb;
 	
-	/* Count number of free inodes. */
-	tinode = 0;
-	imap_size = sb->zmap_blocks;
-	for (int i = 0; i < imap_size; i++)
+	lock_stat(LOCK_SUPERBLOCK, buf);
+	for (sb = &superblocks[0]; sb < &superblocks[NR_SUPERBLOCKS]; sb++)
 	{
-		for (int j = 0; j < (BLOCK_SIZE >> 2); j++)
-			tinode += bitmap_nclear(sb->imap[i]->data, BLOCK_SIZE);
+		if (sb->flags & SUPERBLOCK_VALID)
+			lock_hot(buf, sb->dev, 0, sb->waits);
 	}
-	
-	ubuf->f_tfree = tfree;
-	ubuf->f_tinode = tinode;
-	ubuf->f_fname[0] = '\0';
-	ubuf->f_fpack[0] = '\0';
 }
 
 /**
@@ -409,6 +539,8 @@ PUBLIC void superblock_init(void)
 	for (unsigned i = 0; i < NR_SUPERBLOCKS; i++)
 	{
 		superblocks[i].count = 0;
+		superblocks[i].holder = NULL;
+		superblocks[i].waits = 0;
 		superblocks[i].flags = ~(SUPERBLOCK_VALID | SUPERBLOCK_LOCKED | 
 			SUPERBLOCK_DIRTY | SUPERBLOCK_RDONLY);
 	}
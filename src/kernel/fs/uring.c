@@ -0,0 +1,651 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/clock.h>
+#include <nanvix/const.h>
+#include <nanvix/fs.h>
+#include <nanvix/hal.h>
+#include <nanvix/klib.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include <nanvix/uring.h>
+#include <sys/io_uring.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+
+/**
+ * @brief Offset of a field in the ring.
+ */
+#define RING_OFF(field) \
+	((addr_t)&((struct io_uring_ring *)0)->field)
+
+/**
+ * @brief Physical address of kernel data.
+ */
+#define KPHYS(p) \
+	(ADDR(p) - KBASE_VIRT)
+
+/**
+ * @brief I/O ring table.
+ */
+PRIVATE struct uring uringtab[URING_MAX];
+
+/**
+ * @brief Requests waiting for the asynchronous I/O daemon.
+ */
+PRIVATE struct
+{
+	struct aioreq *head; /**< First request. */
+	struct aioreq *tail; /**< Last request.  */
+} aioq = { NULL, NULL };
+
+/**
+ * @brief Asynchronous I/O daemon chain.
+ */
+PRIVATE struct waitq aiod_chain = WAITQ_INITIALIZER;
+
+/**
+ * @brief Staging area for ring accesses.
+ * 
+ * @details Rings are reached through their physical address, since they may
+ *          be unmapped, or not mapped at all in the current address space.
+ *          This lives in the kernel image so that it has a known physical
+ *          address.
+ */
+PRIVATE union
+{
+	uint32_t word;           /**< Ring counter.             */
+	struct io_uring_sqe sqe; /**< Submission queue entry.   */
+	struct io_uring_cqe cqe; /**< Completion queue entry.   */
+} scratch;
+
+/**
+ * @brief Bounce buffer of the asynchronous I/O daemon.
+ */
+PRIVATE char aiobuf[PAGE_SIZE];
+
+/**
+ * @brief Loads a counter from a ring.
+ * 
+ * @param ur  I/O ring.
+ * @param off Offset of the counter.
+ * 
+ * @returns The value of the counter.
+ * 
+ * @note Interrupts must be disabled.
+ */
+PRIVATE uint32_t ring_load(const struct uring *ur, addr_t off)
+{
+	physcpy(KPHYS(&scratch), ur->phys + off, sizeof(uint32_t));
+	return (scratch.word);
+}
+
+/**
+ * @brief Stores a counter to a ring.
+ * 
+ * @param ur  I/O ring.
+ * @param off Offset of the counter.
+ * @param val Value of the counter.
+ * 
+ * @note Interrupts must be disabled.
+ */
+PRIVATE void ring_store(const struct uring *ur, addr_t off, uint32_t val)
+{
+	scratch.word = val;
+	physcpy(ur->phys + off, KPHYS(&scratch), sizeof(uint32_t));
+}
+
+/**
+ * @brief Counts completions that were not taken yet.
+ * 
+ * @param ur I/O ring.
+ * 
+ * @returns The number of unread completion queue entries.
+ * 
+ * @note Interrupts must be disabled.
+ */
+PRIVATE unsigned ring_ready(const struct uring *ur)
+{
+	unsigned n;
+	
+	n = ring_load(ur, RING_OFF(cq_tail)) - ring_load(ur, RING_OFF(cq_head));
+	
+	/* The process messed up with the ring. */
+	if (n > ur->cq_entries)
+		n = ur->cq_entries;
+	
+	return (n);
+}
+
+/**
+ * @brief Posts a completion.
+ * 
+ * @param ur        I/O ring.
+ * @param user_data Completion tag.
+ * @param res       Result.
+ */
+PRIVATE void ring_post(struct uring *ur, uint64_t user_data, int res)
+{
+	uint32_t tail;
+	
+	disable_interrupts();
+	
+	tail = ring_load(ur, RING_OFF(cq_tail));
+	
+	/*
+	 * Submissions are throttled so that this does not
+	 * happen, unless the process messes up with the ring.
+	 */
+	if (tail - ring_load(ur, RING_OFF(cq_head)) >= ur->cq_entries)
+		ring_store(ur, RING_OFF(cq_overflow), ring_load(ur, RING_OFF(cq_overflow)) + 1);
+	
+	else
+	{
+		scratch.cqe.user_data = user_data;
+		scratch.cqe.res = res;
+		scratch.cqe.flags = 0;
+		physcpy(ur->phys + RING_OFF(cqes) + (tail & ur->cq_mask)*sizeof(struct io_uring_cqe),
+			KPHYS(&scratch), sizeof(struct io_uring_cqe));
+		ring_store(ur, RING_OFF(cq_tail), tail + 1);
+	}
+	
+	wakeup(&ur->chain);
+	
+	enable_interrupts();
+}
+
+/**
+ * @brief Allocates an I/O ring.
+ * 
+ * @returns A new I/O ring, or NULL if the table is full.
+ */
+PUBLIC struct uring *uring_alloc(void)
+{
+	struct uring *ur;
+	
+	for (ur = &uringtab[0]; ur < &uringtab[URING_MAX]; ur++)
+	{
+		/* Found. */
+		if (ur->count == 0)
+			goto found;
+	}
+	
+	return (NULL);
+
+found:
+
+	ur->count = 1;
+	ur->phys = 0;
+	ur->sq_head = 0;
+	ur->sq_mask = 0;
+	ur->cq_entries = 0;
+	ur->cq_mask = 0;
+	ur->inflight = 0;
+	waitq_init(&ur->chain);
+	
+	return (ur);
+}
+
+/**
+ * @brief Gets an I/O ring of the current process.
+ * 
+ * @param id ID of the ring.
+ * 
+ * @returns The ring whose ID is @p id, or NULL if the current process has no
+ *          such ring.
+ */
+PUBLIC struct uring *uring_get(int id)
+{
+	if ((id < 0) || (id >= URING_MAX))
+		return (NULL);
+	
+	if (!(curr_proc->urmap & (1 << id)))
+		return (NULL);
+	
+	return (&uringtab[id]);
+}
+
+/**
+ * @brief Gets the ID of an I/O ring.
+ * 
+ * @param ur I/O ring.
+ * 
+ * @returns The ID of @p ur.
+ */
+PUBLIC int uring_id(const struct uring *ur)
+{
+	return (ur - uringtab);
+}
+
+/**
+ * @brief Releases a reference to an I/O ring.
+ * 
+ * @details Requests in flight hold a reference to their ring, so the ring page
+ *          goes away only after the last of them completes.
+ * 
+ * @param ur I/O ring.
+ */
+PUBLIC void uring_put(struct uring *ur)
+{
+	if (--ur->count > 0)
+		return;
+	
+	if (ur->phys != 0)
+		putupg(ur->phys);
+}
+
+/**
+ * @brief Initializes an I/O ring.
+ * 
+ * @param ur      I/O ring.
+ * @param phys    Physical address of the ring page, as returned by getupg().
+ * @param entries Number of submission queue entries.
+ */
+PUBLIC void uring_init(struct uring *ur, addr_t phys, unsigned entries)
+{
+	ur->phys = phys;
+	ur->sq_mask = entries - 1;
+	ur->cq_entries = 2*entries;
+	ur->cq_mask = 2*entries - 1;
+	
+	disable_interrupts();
+	ring_store(ur, RING_OFF(sq_mask), ur->sq_mask);
+	ring_store(ur, RING_OFF(sq_entries), entries);
+	ring_store(ur, RING_OFF(cq_mask), ur->cq_mask);
+	ring_store(ur, RING_OFF(cq_entries), ur->cq_entries);
+	enable_interrupts();
+}
+
+/**
+ * @brief Builds an asynchronous I/O request.
+ * 
+ * @details The target file is referenced and the buffer is pinned, so that
+ *          both outlive the file descriptor and the mapping of the buffer.
+ * 
+ * @param ur  I/O ring.
+ * @param sqe Submission queue entry.
+ * @param req Request to fill in.
+ * 
+ * @returns Zero upon success, and a negative error code otherwise.
+ */
+PRIVATE int uring_prepare(struct uring *ur, const struct io_uring_sqe *sqe, struct aioreq *req)
+{
+	int write;       /* Write to buffer? */
+	addr_t base;     /* Buffer page.     */
+	struct file *f;  /* Target file.     */
+	struct inode *i; /* Target inode.    */
+	
+	req->ur = ur;
+	req->file = NULL;
+	req->opcode = sqe->opcode;
+	req->flags = sqe->op_flags;
+	req->off = sqe->off;
+	req->len = sqe->len;
+	req->pgoff = ADDR(sqe->addr) & ~PAGE_MASK;
+	req->npages = 0;
+	req->user_data = sqe->user_data;
+	req->next = NULL;
+	
+	/* Nothing to transfer. */
+	if (sqe->opcode == IORING_OP_NOP)
+		return (0);
+	
+	/* Invalid file descriptor. */
+	if ((sqe->fd < 0) || (sqe->fd >= OPEN_MAX) || ((f = curr_proc->ofiles[sqe->fd]) == NULL))
+		return (-EBADF);
+	
+	i = f->inode;
+	
+	switch (sqe->opcode)
+	{
+		case IORING_OP_FSYNC:
+			/* Only files and directories live in the buffer cache. */
+			if (!(S_ISREG(i->mode)) && !(S_ISDIR(i->mode)))
+				return (-EINVAL);
+			break;
+		
+		case IORING_OP_READ:
+		case IORING_OP_WRITE:
+			write = (sqe->opcode == IORING_OP_READ);
+			
+			/* Only regular files never block on something else than disk. */
+			if (!S_ISREG(i->mode))
+				return (-EINVAL);
+			
+			/* File not opened for that. */
+			if (ACCMODE(f->oflag) == ((write) ? O_WRONLY : O_RDONLY))
+				return (-EBADF);
+			
+			/* Invalid offset. */
+			if (sqe->off < 0)
+				return (-EINVAL);
+			
+			/* Buffer too big. */
+			if (req->pgoff + sqe->len > AIO_PAGES_MAX*PAGE_SIZE)
+				return (-EINVAL);
+			
+			/* Invalid buffer. */
+			if (!chkmem(sqe->addr, sqe->len, (write) ? MAY_WRITE : MAY_READ))
+				return (-EFAULT);
+			
+			base = ADDR(sqe->addr) & PAGE_MASK;
+			
+			while (req->npages*PAGE_SIZE < req->pgoff + sqe->len)
+			{
+				req->pages[req->npages] = getupg(base + req->npages*PAGE_SIZE, write);
+				
+				/* Failed to pin buffer. */
+				if (req->pages[req->npages] == 0)
+				{
+					while (req->npages > 0)
+						putupg(req->pages[--req->npages]);
+					return (-EFAULT);
+				}
+				
+				req->npages++;
+			}
+			break;
+		
+		/* Unknown operation. */
+		default:
+			return (-EINVAL);
+	}
+	
+	req->file = f;
+	f->count++;
+	
+	return (0);
+}
+
+/**
+ * @brief Submits requests of an I/O ring.
+ * 
+ * @details Submission queue entries are turned into requests and handed over
+ *          to the asynchronous I/O daemon. Submission stops when the
+ *          completion queue could not take the completions of all requests in
+ *          flight.
+ * 
+ * @param ur I/O ring.
+ * @param n  Number of entries to submit.
+ * 
+ * @returns The number of entries consumed, or a negative error code if none
+ *          could be.
+ */
+PUBLIC int uring_submit(struct uring *ur, unsigned n)
+{
+	int err;                 /* Error code.       */
+	int busy;                /* Throttled?        */
+	unsigned k;              /* Entries consumed. */
+	struct aioreq *req;      /* Working request.  */
+	struct io_uring_sqe sqe; /* Working entry.    */
+	
+	busy = 0;
+	
+	for (k = 0; k < n; k++)
+	{
+		disable_interrupts();
+		
+		/* No more pending entries. */
+		if (ring_load(ur, RING_OFF(sq_tail)) == ur->sq_head)
+		{
+			enable_interrupts();
+			break;
+		}
+		
+		/* Completion queue would overflow. */
+		if (ur->inflight + ring_ready(ur) >= ur->cq_entries)
+		{
+			enable_interrupts();
+			busy = 1;
+			break;
+		}
+		
+		physcpy(KPHYS(&scratch), ur->phys + RING_OFF(sqes) +
+			(ur->sq_head & ur->sq_mask)*sizeof(struct io_uring_sqe),
+			sizeof(struct io_uring_sqe));
+		kmemcpy(&sqe, &scratch.sqe, sizeof(struct io_uring_sqe));
+		ring_store(ur, RING_OFF(sq_head), ++ur->sq_head);
+		
+		enable_interrupts();
+		
+		if ((req = kmalloc(sizeof(struct aioreq))) == NULL)
+		{
+			ring_post(ur, sqe.user_data, -ENOMEM);
+			continue;
+		}
+		
+		/* Bad request. */
+		if ((err = uring_prepare(ur, &sqe, req)) < 0)
+		{
+			kfree(req);
+			ring_post(ur, sqe.user_data, err);
+			continue;
+		}
+		
+		ur->count++;
+		ur->inflight++;
+		
+		disable_interrupts();
+		if (aioq.tail != NULL)
+			aioq.tail->next = req;
+		else
+			aioq.head = req;
+		aioq.tail = req;
+		enable_interrupts();
+	}
+	
+	/* Nothing submitted. */
+	if ((k == 0) && (busy))
+		return (-EBUSY);
+	
+	wakeup(&aiod_chain);
+	
+	return (k);
+}
+
+/**
+ * @brief Waits for completions on an I/O ring.
+ * 
+ * @details Waiting stops early when no request is in flight, since no more
+ *          completions would come.
+ * 
+ * @param ur  I/O ring.
+ * @param min Minimum number of unread completions.
+ * 
+ * @returns Zero upon success, and a negative error code otherwise.
+ */
+PUBLIC int uring_wait(struct uring *ur, unsigned min)
+{
+	while (1)
+	{
+		disable_interrupts();
+		
+		/* Done. */
+		if ((ring_ready(ur) >= min) || (ur->inflight == 0))
+		{
+			enable_interrupts();
+			return (0);
+		}
+		
+		sleep(&ur->chain, PRIO_USER);
+		
+		enable_interrupts();
+		
+		/* Awaken by signal. */
+		if (issig() != SIGNULL)
+			return (-EINTR);
+	}
+}
+
+/**
+ * @brief Performs an asynchronous I/O request.
+ * 
+ * @param req Request.
+ * 
+ * @returns The number of bytes transferred, or a negative error code.
+ */
+PRIVATE int aio_run(struct aioreq *req)
+{
+	int ret;         /* Return value.      */
+	ssize_t n;       /* Bytes transferred. */
+	size_t done;     /* Bytes so far.      */
+	size_t chunk;    /* Chunk size.        */
+	unsigned pgoff;  /* Page offset.       */
+	struct inode *i; /* Target inode.      */
+	
+	switch (req->opcode)
+	{
+		case IORING_OP_FSYNC:
+			i = req->file->inode;
+			inode_lock(i);
+			ret = inode_fsync(i, req->flags & IORING_FSYNC_DATASYNC);
+			inode_unlock(i);
+			return (ret);
+		
+		case IORING_OP_READ:
+		case IORING_OP_WRITE:
+			pgoff = req->pgoff;
+			done = 0;
+			
+			/* Go through the buffer page by page. */
+			for (unsigned k = 0; k < req->npages; k++)
+			{
+				chunk = PAGE_SIZE - pgoff;
+				if (chunk > req->len - done)
+					chunk = req->len - done;
+				
+				if (req->opcode == IORING_OP_READ)
+				{
+					if ((n = do_pread(req->file, aiobuf, chunk, req->off + done)) > 0)
+						physcpy(req->pages[k] + pgoff, KPHYS(aiobuf), n);
+				}
+				else
+				{
+					physcpy(KPHYS(aiobuf), req->pages[k] + pgoff, chunk);
+					n = do_pwrite(req->file, aiobuf, chunk, req->off + done);
+				}
+				
+				/* Failed. */
+				if (n < 0)
+					return ((done > 0) ? (int)done : n);
+				
+				done += n;
+				
+				/* End of file reached. */
+				if ((size_t)n < chunk)
+					break;
+				
+				pgoff = 0;
+			}
+			
+			return (done);
+	}
+	
+	return (0);
+}
+
+/**
+ * @brief Completes an asynchronous I/O request.
+ * 
+ * @param req Request.
+ * @param res Result.
+ */
+PRIVATE void aio_complete(struct aioreq *req, int res)
+{
+	struct uring *ur;
+	
+	ur = req->ur;
+	
+	ring_post(ur, req->user_data, res);
+	
+	while (req->npages > 0)
+		putupg(req->pages[--req->npages]);
+	if (req->file != NULL)
+		releasefile(req->file);
+	
+	ur->inflight--;
+	wakeup(&ur->chain);
+	uring_put(ur);
+	
+	kfree(req);
+}
+
+/**
+ * @brief Asynchronous I/O daemon.
+ * 
+ * @details Performs the requests submitted to I/O rings, on behalf of their
+ *          processes. Requests are taken in batches, and disk reads are
+ *          queued for all read requests of a batch at once, so that the disk
+ *          works on them while the daemon copies data out of the block buffer
+ *          cache.
+ * 
+ * @note This function never returns.
+ */
+PUBLIC void aiod(void)
+{
+	struct inode *i;     /* Target inode.    */
+	struct aioreq *req;  /* Working request. */
+	struct aioreq *next; /* Next request.    */
+	
+	kprintf("fs: asynchronous i/o daemon is running");
+	
+	while (1)
+	{
+		disable_interrupts();
+		
+		if (aioq.head == NULL)
+			tsleep(&aiod_chain, PRIO_BUFFER, CLOCK_FREQ);
+		
+		req = aioq.head;
+		aioq.head = NULL;
+		aioq.tail = NULL;
+		
+		enable_interrupts();
+		
+		/* Nothing to be done. */
+		if (req == NULL)
+		{
+			if (shutting_down)
+				die(0);
+			continue;
+		}
+		
+		/* Queue disk reads for the whole batch. */
+		for (next = req; next != NULL; next = next->next)
+		{
+			if ((next->opcode != IORING_OP_READ) || (next->len == 0))
+				continue;
+			
+			i = next->file->inode;
+			inode_lock_shared(i);
+			file_prefetch(i, next->off, 0,
+				((next->off % BLOCK_SIZE) + next->len - 1)/BLOCK_SIZE);
+			inode_unlock_shared(i);
+		}
+		
+		for (/* noop */; req != NULL; req = next)
+		{
+			next = req->next;
+			aio_complete(req, aio_run(req));
+		}
+	}
+}
@@ -18,6 +18,7 @@
  * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <nanvix/clock.h>
 #include <nanvix/const.h>
 #include <nanvix/fs.h>
 #include <nanvix/hal.h>
@@ -25,7 +26,12 @@
 #include <nanvix/dev.h>
 #include <nanvix/pm.h>
 #include <nanvix/mm.h>
+#include <nanvix/net.h>
 #include <nanvix/syscall.h>
+#include <nanvix/uring.h>
+#include <nanvix/work.h>
+#include <dev/bootlog.h>
+#include <dev/uart.h>
 #include <fcntl.h>
 
 
@@ -105,25 +111,67 @@ PRIVATE void init(void)
 {
 	const char *argv[] = { "init", "/etc/inittab", NULL };
 	const char *envp[] = { "PATH=/bin:/sbin", "HOME=/", NULL };
-		
+	
+	boot_mark("execve init");
 	execve("/sbin/init", argv, envp);
 }
 
+/**
+ * @brief Selects the kernel console.
+ * 
+ * @details Looks for a console=ttyS0 option on the kernel command line, and
+ *          selects the serial line as the kernel output device if it is there
+ *          and the serial line was found. Otherwise, the tty is used.
+ * 
+ * @returns The kernel output device.
+ */
+PRIVATE dev_t kconsole(void)
+{
+	const char *p; /* Working option. */
+	
+	for (p = mboot_cmdline(); *p != '\0'; p++)
+	{
+		/* Not at the start of an option. */
+		if ((p != mboot_cmdline()) && (*(p - 1) != ' '))
+			continue;
+		
+		if (kstrncmp(p, "console=ttyS0", 13))
+			continue;
+		
+		if ((p[13] != '\0') && (p[13] != ' '))
+			continue;
+		
+		if (uart_present())
+			return (DEVID(SERIAL_MAJOR, 0, CHRDEV));
+	}
+	
+	return (DEVID(TTY_MAJOR, 0, CHRDEV));
+}
+
 /**
  * @brief Initializes the kernel.
  */
 PUBLIC void kmain(void)
 {		
-	pid_t pid;         /* Child process ID. */
-	struct process *p; /* Working process.  */
+	int i;                /* Loop index.       */
+	pid_t pid;            /* Child process ID. */
+	struct process *p;    /* Working process.  */
+	struct process *next; /* Next process.     */
 	
 	/* Initialize system modules. */
+	boot_mark("dev_init");
 	dev_init();
+	boot_mark("mm_init");
 	mm_init();
+	boot_mark("pm_init");
 	pm_init();
+	dev_probe();
+	boot_mark("fs_init");
 	fs_init();
+	boot_mark("net_init");
+	net_init();
 	
-	chkout(DEVID(TTY_MAJOR, 0, CHRDEV));
+	chkout(kconsole());
 	kprintf(KERN_INFO "kout is now initialized");
 	
 	/* Spawn init process. */
@@ -136,6 +184,27 @@ PUBLIC void kmain(void)
 		_exit(-1);
 	}
 	
+	/* Spawn buffer flusher daemon. */
+	if ((pid = fork()) < 0)
+		kpanic("failed to fork buffer flusher daemon");
+	else if (pid == 0)
+		bdflush();
+	
+	/* Spawn asynchronous I/O daemon. */
+	if ((pid = fork()) < 0)
+		kpanic("failed to fork asynchronous i/o daemon");
+	else if (pid == 0)
+		aiod();
+	
+	/* Spawn kernel workers. */
+	for (i = 0; i < NR_KWORKERS; i++)
+	{
+		if ((pid = fork()) < 0)
+			kpanic("failed to fork kernel worker");
+		else if (pid == 0)
+			kworker();
+	}
+	
 	/* idle process. */	
 	while (1)
 	{
@@ -143,9 +212,10 @@ PUBLIC void kmain(void)
 		if (shutting_down)
 		{
 			/* Bury zombie processes. */
-			for (p = FIRST_PROC; p <= LAST_PROC; p++)
+			for (p = curr_proc->children; p != NULL; p = next)
 			{
-				if ((p->state == PROC_ZOMBIE) && (p->father == curr_proc))
+				next = p->sibling;
+				if (p->state == PROC_ZOMBIE)
 					bury(p);
 			}
 			
@@ -153,13 +223,15 @@ PUBLIC void kmain(void)
 			if (nprocs == 1)
 			{	
 				kprintf("you may now turn off your computer");
+				kflush();
 				disable_interrupts();
 				while (1)
 					halt();
 			}
 		}
 		
-		halt();
+		kflush();
+		clock_idle();
 		yield();
 	}
 }
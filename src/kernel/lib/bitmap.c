@@ -20,6 +20,22 @@
 #include <nanvix/klib.h>
 #include <nanvix/const.h>
 
+/**
+ * @brief Returns the offset of the least significant bit set in a word.
+ * 
+ * @param word Target word. It must not be zero.
+ * 
+ * @returns The offset of the least significant bit that is set in @p word.
+ */
+PRIVATE inline unsigned bitmap_lsb(uint32_t word)
+{
+	uint32_t off;
+	
+	__asm__ ("bsfl %1, %0" : "=r" (off) : "rm" (word));
+	
+	return (off);
+}
+
 /**
  * @brief Returns the number of bits that are set in a bitmap.
  * 
@@ -45,6 +61,15 @@ PRIVATE unsigned bitmap_nset(uint32_t *bitmap, size_t size)
 	{
 		chunk = *idx;
 		
+		/* Fast paths. */
+		if (chunk == 0)
+			continue;
+		if (chunk == 0xffffffff)
+		{
+			count += 32;
+			continue;
+		}
+		
 		/*
 		 * Fast way for counting number of bits set in a bit map.
 		 * I have no idea how does it work. I just got it from here:
@@ -78,7 +103,8 @@ PUBLIC unsigned bitmap_nclear(uint32_t *bitmap, size_t size)
  * @brief Searches for the first free bit in a bitmap.
  * 
  * @details Searches for the first free bit in a bitmap. In order to speedup
- *          computation, bits are checked in chunks of 4 bytes.
+ *          computation, full chunks of 4 bytes are skipped, and the free bit
+ *          is located within a chunk with a single bit scan instruction.
  * 
  * @param bitmap Bitmap to be searched.
  * @param size   Size (in bytes) of the bitmap.
@@ -88,29 +114,89 @@ PUBLIC unsigned bitmap_nclear(uint32_t *bitmap, size_t size)
  */
 PUBLIC bit_t bitmap_first_free(uint32_t *bitmap, size_t size)
 {
-    uint32_t *max;          /* Bitmap bondary. */
-    register uint32_t off;  /* Bit offset.     */
-    register uint32_t *idx; /* Bit index.      */
-    
-    idx = bitmap;
-    max = (idx + (size >> 2));
-    
-    /* Find bit index. */
-    while (idx < max)
-    {
-		/* Index found. */
-		if (*idx != 0xffffffff)
+	uint32_t *max;          /* Bitmap bondary. */
+	register uint32_t *idx; /* Bit index.      */
+	
+	idx = bitmap;
+	max = (idx + (size >> 2));
+	
+	/* Skip full chunks. */
+	while ((idx < max) && (*idx == 0xffffffff))
+		idx++;
+	
+	/* Bitmap is full. */
+	if (idx == max)
+		return (BITMAP_FULL);
+	
+	return (((idx - bitmap) << 5) + bitmap_lsb(~*idx));
+}
+
+/**
+ * @brief Searches for the first run of free bits in a bitmap.
+ * 
+ * @details Searches for the first run of @p n contiguous free bits in a
+ *          bitmap. Full and empty chunks of 4 bytes are handled at once, so
+ *          only chunks with mixed bits are checked bit by bit.
+ * 
+ * @param bitmap Bitmap to be searched.
+ * @param size   Size (in bytes) of the bitmap.
+ * @param n      Number of contiguous free bits.
+ * 
+ * @returns If a run of @p n free bits is found, the number of the first bit in
+ *          that run is returned. However, if no such run is found #BITMAP_FULL
+ *          is returned instead.
+ */
+PUBLIC bit_t bitmap_first_free_n(uint32_t *bitmap, size_t size, size_t n)
+{
+	uint32_t chunk; /* Working chunk.            */
+	unsigned off;   /* Bit offset.               */
+	size_t run;     /* Length of current run.    */
+	bit_t start;    /* First bit of current run. */
+	uint32_t *idx;  /* Loop index.               */
+	uint32_t *end;  /* End of bitmap.            */
+	
+	/* Nothing to search for. */
+	if (n == 0)
+		return (BITMAP_FULL);
+	
+	run = 0;
+	start = 0;
+	end = (bitmap + (size >> 2));
+	for (idx = bitmap; idx < end; idx++)
+	{
+		chunk = *idx;
+		
+		/* Full chunk breaks the run. */
+		if (chunk == 0xffffffff)
+		{
+			run = 0;
+			continue;
+		}
+		
+		/* Empty chunk extends the run. */
+		if (chunk == 0)
 		{
-			off = 0;
+			if (run == 0)
+				start = (idx - bitmap) << 5;
+			if ((run += 32) >= n)
+				return (start);
+			continue;
+		}
+		
+		for (off = 0; off < 32; off++)
+		{
+			/* Bit set breaks the run. */
+			if (chunk & (0x1 << off))
+			{
+				run = 0;
+				continue;
+			}
 			
-			/* Find offset. */
-			while (*idx & (0x1 << off))
-				off++;
-				
-			return (((idx - bitmap) << 5) + off);
+			if (run++ == 0)
+				start = ((idx - bitmap) << 5) + off;
+			if (run >= n)
+				return (start);
 		}
-	
-		idx++;
 	}
 	
 	return (BITMAP_FULL);
@@ -0,0 +1,280 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/klib.h>
+#include <sys/types.h>
+#include <stdint.h>
+
+/**
+ * @name Compressed Stream Format
+ * 
+ * @details A compressed stream is a sequence of records. Each record starts
+ *          with a token byte, whose high nibble is a literal length and low
+ *          nibble a match length minus #KLZ_MINMATCH. A nibble of 15 is
+ *          followed by extra length bytes, which are added up until one is
+ *          not 255. Literals come next, and then a 2-byte little-endian match
+ *          offset. The last record holds literals only.
+ */
+/**@{*/
+#define KLZ_MINMATCH  4 /**< Minimum match length.     */
+#define KLZ_HASH_LOG 10 /**< Log2 of hash table size.  */
+/**@}*/
+
+/**
+ * @brief Positions of recently seen 4-byte sequences.
+ */
+PRIVATE uint16_t hashtab[1 << KLZ_HASH_LOG];
+
+/**
+ * @brief Reads 4 bytes.
+ */
+#define READ32(p) \
+	((uint32_t)(p)[0] | ((uint32_t)(p)[1] << 8) | \
+	((uint32_t)(p)[2] << 16) | ((uint32_t)(p)[3] << 24))
+
+/**
+ * @brief Hashes 4 bytes.
+ */
+#define HASH(p) \
+	((READ32(p)*2654435761U) >> (32 - KLZ_HASH_LOG))
+
+/**
+ * @brief Writes a record length.
+ * 
+ * @param op  Output pointer.
+ * @param len Length minus 15.
+ * 
+ * @returns The updated output pointer.
+ */
+PRIVATE unsigned char *klz_putlen(unsigned char *op, size_t len)
+{
+	while (len >= 255)
+	{
+		*op++ = 255;
+		len -= 255;
+	}
+	*op++ = (unsigned char) len;
+	
+	return (op);
+}
+
+/**
+ * @brief Writes a record.
+ * 
+ * @param op   Output pointer.
+ * @param oend End of output buffer.
+ * @param lit  Literals.
+ * @param nlit Number of literals.
+ * @param off  Match offset, or zero for the last record.
+ * @param mlen Match length.
+ * 
+ * @returns The updated output pointer, or NULL if it does not fit.
+ */
+PRIVATE unsigned char *klz_record
+(unsigned char *op, unsigned char *oend, const unsigned char *lit, size_t nlit,
+ size_t off, size_t mlen)
+{
+	unsigned char *token;
+	
+	/* Worst case record size. */
+	if (op + 1 + nlit + nlit/255 + 1 + 2 + mlen/255 + 1 > oend)
+		return (NULL);
+	
+	token = op++;
+	*token = (nlit >= 15) ? 0xf0 : (unsigned char)(nlit << 4);
+	if (nlit >= 15)
+		op = klz_putlen(op, nlit - 15);
+	kmemcpy(op, lit, nlit);
+	op += nlit;
+	
+	/* Last record. */
+	if (off == 0)
+		return (op);
+	
+	*op++ = off & 0xff;
+	*op++ = (off >> 8) & 0xff;
+	
+	mlen -= KLZ_MINMATCH;
+	*token |= (mlen >= 15) ? 0x0f : (unsigned char) mlen;
+	if (mlen >= 15)
+		op = klz_putlen(op, mlen - 15);
+	
+	return (op);
+}
+
+/**
+ * @brief Compresses data.
+ * 
+ * @details Compresses @p n bytes from @p src into @p dst using a simple and
+ *          fast LZ77 scheme, with a single hash table probe per position.
+ * 
+ * @param src Data to be compressed.
+ * @param n   Number of bytes to compress (at most 64 KB).
+ * @param dst Location where compressed data shall be stored.
+ * @param max Size of @p dst.
+ * 
+ * @returns The number of bytes of compressed data, or zero if it does not fit
+ *          in @p max bytes.
+ * 
+ * @note This function is not reentrant.
+ */
+PUBLIC size_t klz_compress(const void *src, size_t n, void *dst, size_t max)
+{
+	size_t len;               /* Match length.     */
+	unsigned h;               /* Hash value.       */
+	const unsigned char *in;  /* Input buffer.     */
+	const unsigned char *ip;  /* Input pointer.    */
+	const unsigned char *end; /* End of input.     */
+	const unsigned char *ref; /* Match candidate.  */
+	const unsigned char *lit; /* Pending literals. */
+	unsigned char *op;        /* Output pointer.   */
+	
+	in = src;
+	end = in + n;
+	op = dst;
+	
+	kmemset(hashtab, 0, sizeof(hashtab));
+	
+	lit = ip = in;
+	while (ip + KLZ_MINMATCH <= end)
+	{
+		h = HASH(ip);
+		ref = in + hashtab[h];
+		hashtab[h] = ip - in;
+		
+		/* No match. */
+		if ((ref >= ip) || (READ32(ref) != READ32(ip)))
+		{
+			ip++;
+			continue;
+		}
+		
+		/* Extend match. */
+		for (len = KLZ_MINMATCH; ip + len < end; len++)
+		{
+			if (ref[len] != ip[len])
+				break;
+		}
+		
+		op = klz_record(op, (unsigned char *)dst + max, lit, ip - lit,
+			ip - ref, len);
+		if (op == NULL)
+			return (0);
+		
+		lit = ip += len;
+	}
+	
+	/* Last literals. */
+	op = klz_record(op, (unsigned char *)dst + max, lit, end - lit, 0, 0);
+	if (op == NULL)
+		return (0);
+	
+	return (op - (unsigned char *)dst);
+}
+
+/**
+ * @brief Reads a record length.
+ * 
+ * @param ip   Input pointer.
+ * @param iend End of input.
+ * @param len  Location where the length shall be added.
+ * 
+ * @returns The updated input pointer, or NULL if the input ends early.
+ */
+PRIVATE const unsigned char *klz_getlen
+(const unsigned char *ip, const unsigned char *iend, size_t *len)
+{
+	unsigned char b;
+	
+	do
+	{
+		if (ip >= iend)
+			return (NULL);
+		b = *ip++;
+		*len += b;
+	} while (b == 255);
+	
+	return (ip);
+}
+
+/**
+ * @brief Decompresses data.
+ * 
+ * @param src Data to be decompressed.
+ * @param n   Number of bytes of compressed data.
+ * @param dst Location where decompressed data shall be stored.
+ * @param max Size of @p dst.
+ * 
+ * @returns The number of bytes of decompressed data, or zero if the
+ *          compressed data is malformed or does not fit in @p max bytes.
+ */
+PUBLIC size_t klz_decompress(const void *src, size_t n, void *dst, size_t max)
+{
+	size_t nlit;               /* Literal length. */
+	size_t mlen;               /* Match length.   */
+	size_t off;                /* Match offset.   */
+	unsigned char token;       /* Record token.   */
+	const unsigned char *ip;   /* Input pointer.  */
+	const unsigned char *iend; /* End of input.   */
+	unsigned char *op;         /* Output pointer. */
+	unsigned char *oend;       /* End of output.  */
+	unsigned char *ref;        /* Match source.   */
+	
+	ip = src;
+	iend = ip + n;
+	op = dst;
+	oend = op + max;
+	
+	while (ip < iend)
+	{
+		token = *ip++;
+		
+		/* Copy literals. */
+		nlit = token >> 4;
+		if ((nlit == 15) && ((ip = klz_getlen(ip, iend, &nlit)) == NULL))
+			return (0);
+		if ((ip + nlit > iend) || (op + nlit > oend))
+			return (0);
+		kmemcpy(op, ip, nlit);
+		ip += nlit;
+		op += nlit;
+		
+		/* Last record. */
+		if (ip == iend)
+			break;
+		
+		/* Copy match. */
+		if (ip + 2 > iend)
+			return (0);
+		off = ip[0] | (ip[1] << 8);
+		ip += 2;
+		mlen = token & 0x0f;
+		if ((mlen == 15) && ((ip = klz_getlen(ip, iend, &mlen)) == NULL))
+			return (0);
+		mlen += KLZ_MINMATCH;
+		ref = op - off;
+		if ((off == 0) || (ref < (unsigned char *)dst) || (op + mlen > oend))
+			return (0);
+		while (mlen-- > 0)
+			*op++ = *ref++;
+	}
+	
+	return (op - (unsigned char *)dst);
+}
@@ -42,6 +42,9 @@ PUBLIC void kpanic(const char *fmt, ...)
 	buffer[i++] = '\n';
 	va_end(args);
 
+	/* Get deferred messages out first. */
+	kflush();
+	
 	/* Save on kernel log and write on kout. */
 	cdev_write(kout, buffer, i);
 	klog_write(0, buffer, i);
@@ -20,15 +20,111 @@
 
 #include <nanvix/const.h>
 #include <nanvix/dev.h>
+#include <nanvix/hal.h>
 #include <nanvix/klib.h>
 #include <sys/types.h>
 #include <stdarg.h>
 
+/* Error checking. */
+#if (KMSG_SIZE & (KMSG_SIZE - 1))
+	#error "KMSG_SIZE must be a power of two"
+#endif
+
+/**
+ * @brief Interrupt enable flag.
+ */
+#define EFLAGS_IF (1 << 9)
+
+/**
+ * @brief Notice for dropped messages.
+ */
+#define KMSG_LOST "kernel: some messages were dropped\n"
+
 /**
  * @brief Kernel's output device.
  */
 PUBLIC dev_t kout = DEVID(NULL_MAJOR, 0, CHRDEV);
 
+/**
+ * @brief Characters waiting to be written to the kernel's output device.
+ */
+PUBLIC unsigned kmsg_pending = 0;
+
+/**
+ * @brief Deferred kernel messages.
+ */
+PRIVATE struct
+{
+	unsigned head;          /**< Next character to write out. */
+	unsigned tail;          /**< Next free slot.              */
+	unsigned lost;          /**< Messages dropped.            */
+	int busy;               /**< Being written out?           */
+	char buffer[KMSG_SIZE]; /**< Ring buffer.                 */
+} kmsg = { 0, 0, 0, 0, {0, }};
+
+/**
+ * @brief Disables interrupts.
+ * 
+ * @returns Non-zero if interrupts were enabled, and zero otherwise.
+ */
+PRIVATE int kmsg_lock(void)
+{
+	dword_t eflags;
+	
+	__asm__ volatile ("pushfl; popl %0; cli" : "=r" (eflags) : : "memory");
+	
+	return (eflags & EFLAGS_IF);
+}
+
+/**
+ * @brief Enables interrupts again, if they were enabled.
+ */
+PRIVATE void kmsg_unlock(int enabled)
+{
+	if (enabled)
+		enable_interrupts();
+}
+
+/**
+ * @brief Writes deferred kernel messages to the kernel's output device.
+ * 
+ * @details This is called from contexts where writing to the kernel's output
+ *          device may take long or sleep: the idle process and the return
+ *          path of system calls. Only one caller writes at a time.
+ */
+PUBLIC void kflush(void)
+{
+	int i;                     /* Interrupt state.               */
+	size_t n;                  /* Number of bytes to be flushed. */
+	unsigned lost;             /* Messages dropped.              */
+	char buffer[KBUFFER_SIZE]; /* Temporary buffer.              */
+	
+	if ((kmsg_pending == 0) || (kmsg.busy))
+		return;
+	
+	kmsg.busy = 1;
+	
+	while (kmsg_pending > 0)
+	{
+		i = kmsg_lock();
+		
+		for (n = 0; (n < KBUFFER_SIZE) && (kmsg.head != kmsg.tail); n++)
+			buffer[n] = kmsg.buffer[kmsg.head++ & (KMSG_SIZE - 1)];
+		kmsg_pending -= n;
+		lost = kmsg.lost;
+		kmsg.lost = 0;
+		
+		kmsg_unlock(i);
+		
+		cdev_write(kout, buffer, n);
+		
+		if (lost > 0)
+			cdev_write(kout, KMSG_LOST, sizeof(KMSG_LOST) - 1);
+	}
+	
+	kmsg.busy = 0;
+}
+
 /**
  * @brief Changes kernel's output device.
  * 
@@ -41,6 +137,10 @@ PUBLIC void chkout(dev_t dev)
 	
 	kout = dev;
 	
+	/* Deferred messages are in the kernel log. */
+	kmsg.head = kmsg.tail;
+	kmsg_pending = 0;
+	
 	/* Flush the content of kernel log. */
 	n = klog_read(0, buffer, KLOG_SIZE);
 	
@@ -86,23 +186,50 @@ PUBLIC char get_code(const char *buffer)
 /**
  * @brief Writes on the screen a formated string.
  * 
+ * @details Messages whose log level is above klog_level are dropped before
+ *          being formatted. Others are saved on the kernel log right away,
+ *          but only queued for the kernel's output device, so that callers
+ *          such as page fault handlers and interrupt handlers never wait
+ *          for the console. See kflush().
+ * 
  * @param fmt Formated string.
  */
 PUBLIC void kprintf(const char *fmt, ...)
 {
 	int i;                         /* Loop index.                              */
+	int j;                         /* Interrupt state.                         */
+	char level;                    /* Log level.                               */
 	va_list args;                  /* Variable arguments list.                 */
 	char buffer[KBUFFER_SIZE + 1]; /* Temporary buffer.                        */
 	const char *buffer_no_code;    /* Temporary buffer for log level printing. */
 	
+	/* Below log level. */
+	if ((level = get_code(fmt)) == 0)
+		level = KERN_DEFAULT_LEVEL;
+	if (level > klog_level)
+		return;
+	
 	/* Convert to raw string. */
 	va_start(args, fmt);
 	i = kvsprintf(buffer, fmt, args);
 	buffer[i++] = '\n';
 	va_end(args);
 
-	/* Save on kernel log, skip code in case it's not correctly done and write on kout. */
-	klog_write(0, buffer, i);
-	buffer_no_code = skip_code(buffer, &i);
-	cdev_write(kout, buffer_no_code, i);
+	/* Save on kernel log, skip code in case it's not correctly done and queue for kout. */
+	j = kmsg_lock();
+	
+		klog_write(0, buffer, i);
+		buffer_no_code = skip_code(buffer, &i);
+		
+		/* Drop whole messages that do not fit. */
+		if (KMSG_SIZE - kmsg_pending < (unsigned)i)
+			kmsg.lost++;
+		else
+		{
+			while (i-- > 0)
+				kmsg.buffer[kmsg.tail++ & (KMSG_SIZE - 1)] = *buffer_no_code++;
+			kmsg_pending = kmsg.tail - kmsg.head;
+		}
+	
+	kmsg_unlock(j);
 }
\ No newline at end of file
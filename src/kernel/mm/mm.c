@@ -17,11 +17,14 @@
  * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <nanvix/config.h>
 #include <nanvix/const.h>
+#include <nanvix/mboot.h>
 #include <nanvix/pm.h>
 #include <nanvix/region.h>
 #include <nanvix/klib.h>
 #include <nanvix/mm.h>
+#include "mm.h"
 
 /*
  * Bad KPOOL_PHYS ?
@@ -44,13 +47,27 @@
 	#error "bad KPOOL_VIRT"
 #endif
 
+/*
+ * Bad KEXT_VIRT ?
+ */
+#if ((KBASE_VIRT + KMEM_SIZE + KPOOL_SIZE) != KEXT_VIRT)
+	#error "bad KEXT_VIRT"
+#endif
+
 /*
  * Bad INITRD_VIRT ?
  */
-#if ((KBASE_VIRT + KMEM_SIZE + KPOOL_SIZE) != INITRD_VIRT)
+#if ((KEXT_VIRT + KEXT_SIZE) != INITRD_VIRT)
 	#error "bad INITRD_VIRT"
 #endif
 
+/*
+ * Bad IOMEM_VIRT ?
+ */
+#if ((INITRD_VIRT + PGTAB_SIZE) != IOMEM_VIRT)
+	#error "bad IOMEM_VIRT"
+#endif
+
 /*
  * Bad UBASE_VIRT ?
  */
@@ -62,15 +79,145 @@
  * Bad identity mapping?
  */
 #if (((KPOOL_VIRT   - KBASE_VIRT) != KPOOL_PHYS) || \
+    ((KEXT_VIRT    - KBASE_VIRT) != UBASE_PHYS) || \
     ((BUFFERS_VIRT - KBASE_VIRT) != BUFFERS_PHYS))
 	#error "bad identity mapping"
 #endif
 
+/*
+ * Too little memory?
+ */
+#if (MEMORY_SIZE <= UBASE_PHYS) || (MEMORY_MAX < MEMORY_SIZE)
+	#error "bad MEMORY_SIZE"
+#endif
+
+/**
+ * @brief Physical address of the multiboot information.
+ */
+EXTERN uint32_t mboot_info;
+
+/**
+ * @brief Memory size (in bytes).
+ */
+PUBLIC size_t mem_size = MEMORY_SIZE;
+
+/**
+ * @brief Returns a kernel pointer to multiboot data.
+ * 
+ * @param addr Physical address of the data.
+ * @param size Size of the data.
+ * 
+ * @returns A pointer to the data, or NULL if the data lies outside the kernel
+ *          memory and cannot be reached.
+ */
+PRIVATE void *mbootptr(uint32_t addr, size_t size)
+{
+	if ((addr == 0) || (addr + size > KMEM_SIZE) || (addr + size < addr))
+		return (NULL);
+	
+	return ((void *)(KBASE_VIRT + addr));
+}
+
+/**
+ * @brief Sizes physical memory.
+ * 
+ * @details Finds the end of the memory that is available from the start of
+ *          user memory on, from the memory map that the boot loader passes.
+ *          When there is no memory map, the size of upper memory is used, and
+ *          MEMORY_SIZE is assumed when there is neither. Memory beyond
+ *          MEMORY_MAX is ignored.
+ */
+PRIVATE void memdetect(void)
+{
+	int grown;                      /* Memory end moved?        */
+	uint64_t end;                   /* End of available memory. */
+	uint32_t off;                   /* Offset in memory map.    */
+	struct mboot_info *info;        /* Multiboot information.   */
+	struct mboot_mmap_entry *entry; /* Memory map entry.        */
+	
+	info = mbootptr(mboot_info, sizeof(struct mboot_info));
+	
+	/* No information. */
+	if (info == NULL)
+		goto out;
+	
+	/* Use memory map. */
+	if ((info->flags & MBOOT_INFO_MEM_MAP) && 
+		(mbootptr(info->mmap_addr, info->mmap_length) != NULL))
+	{
+		end = UBASE_PHYS;
+		
+		/* Extend end while available memory is contiguous. */
+		do
+		{
+			grown = 0;
+			
+			for (off = 0; off < info->mmap_length; off += entry->size + 4)
+			{
+				entry = mbootptr(info->mmap_addr + off, 
+					sizeof(struct mboot_mmap_entry));
+				
+				/* Not available. */
+				if (entry->type != MBOOT_MEMORY_AVAILABLE)
+					continue;
+				
+				/* Does not extend memory. */
+				if ((entry->addr > end) || (entry->addr + entry->len <= end))
+					continue;
+				
+				end = entry->addr + entry->len;
+				grown = 1;
+			}
+		} while (grown);
+	}
+	
+	/* Use upper memory size. */
+	else if (info->flags & MBOOT_INFO_MEMORY)
+		end = 0x100000 + ((uint64_t)info->mem_upper << 10);
+	
+	else
+		goto out;
+	
+	/* Too little memory. */
+	if (end <= UBASE_PHYS + PAGE_SIZE)
+		kpanic("mm: not enough memory");
+	
+	mem_size = (end > MEMORY_MAX) ? MEMORY_MAX : (size_t)(end & PAGE_MASK);
+
+out:
+	kprintf("mm: %d KB of memory", mem_size >> 10);
+}
+
+/**
+ * @brief Returns the kernel command line.
+ * 
+ * @returns The command line that the boot loader passes, or an empty string if
+ *          there is none.
+ */
+PUBLIC const char *mboot_cmdline(void)
+{
+	const char *cmdline;     /* Command line.          */
+	struct mboot_info *info; /* Multiboot information. */
+	
+	info = mbootptr(mboot_info, sizeof(struct mboot_info));
+	
+	/* No command line. */
+	if ((info == NULL) || (!(info->flags & MBOOT_INFO_CMDLINE)))
+		return ("");
+	
+	if ((cmdline = mbootptr(info->cmdline, 1)) == NULL)
+		return ("");
+	
+	return (cmdline);
+}
+
 /**
  * @brief Initializes the memory system.
  */
 PUBLIC void mm_init(void)
 {
+	memdetect();
+	initpg();
 	initreg();
 }
 
@@ -91,7 +238,7 @@ PUBLIC int chkmem(const void *addr, size_t size, mode_t mask)
 	
 	/* Get associated process memory region. */
 	if ((preg = findreg(curr_proc, ADDR(addr))) == NULL)
-		return (-1);
+		return (0);
 	
 	lockreg(reg = preg->reg);
 	
@@ -99,7 +246,7 @@ PUBLIC int chkmem(const void *addr, size_t size, mode_t mask)
 	if (!(accessreg(curr_proc, reg) & mask))
 	{
 		unlockreg(reg);
-		return (-1);
+		return (0);
 	}
 		
 	ret = withinreg(preg, ADDR(addr));
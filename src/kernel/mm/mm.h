@@ -25,10 +25,18 @@
 	#define PAGE_ZERO 1 /* Demand zero. */
 	
 	/* Forward definitions. */
+	EXTERN int cowpgtab(struct process *, struct pregion *, addr_t);
+	EXTERN int kpgshared(void *);
 	EXTERN void freeupg(struct pte *);
+	EXTERN void initpg(void);
+	EXTERN int lendupg(addr_t, struct pte *);
+	EXTERN void linkkpg(void *);
 	EXTERN void linkupg(struct pte *, struct pte *);
 	EXTERN void mappgtab(struct process *, addr_t, void *);
 	EXTERN void markpg(struct pte *, int);
+	EXTERN int moveupg(addr_t, struct pte *);
+	EXTERN void splitpgtab(struct process *, addr_t);
 	EXTERN void umappgtab(struct process *, addr_t);
+	EXTERN void wppgtab(struct process *, addr_t);
 
 #endif /* _MM_H_ */
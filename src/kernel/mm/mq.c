@@ -0,0 +1,323 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/hal.h>
+#include <nanvix/klib.h>
+#include <nanvix/mm.h>
+#include <nanvix/mq.h>
+#include <nanvix/pm.h>
+#include "mm.h"
+
+/**
+ * @brief Message queue table.
+ */
+PRIVATE struct mqueue mqtab[MQ_MAX];
+
+/**
+ * @brief Searches for a message queue.
+ * 
+ * @param name Name of the message queue.
+ * 
+ * @returns The message queue named @p name, or NULL if there is none.
+ */
+PUBLIC struct mqueue *mq_lookup(const char *name)
+{
+	struct mqueue *mq;
+	
+	for (mq = &mqtab[0]; mq < &mqtab[MQ_MAX]; mq++)
+	{
+		/* Free or unlinked queue. */
+		if ((mq->count == 0) || (mq->unlinked))
+			continue;
+		
+		if (!kstrncmp(mq->name, name, MQ_NAME_MAX))
+			return (mq);
+	}
+	
+	return (NULL);
+}
+
+/**
+ * @brief Allocates a message queue.
+ * 
+ * @details The name of the message queue holds a reference to it, so that
+ *          queued messages outlive the processes that have it open until
+ *          the queue is unlinked.
+ * 
+ * @param name    Name of the message queue.
+ * @param maxmsg  Maximum number of messages.
+ * @param msgsize Maximum message size.
+ * 
+ * @returns A new message queue, or NULL if the message queue table is full.
+ * 
+ * @note No message queue named @p name must exist.
+ */
+PUBLIC struct mqueue *mq_alloc(const char *name, long maxmsg, long msgsize)
+{
+	struct mqueue *mq;
+	
+	for (mq = &mqtab[0]; mq < &mqtab[MQ_MAX]; mq++)
+	{
+		/* Found. */
+		if (mq->count == 0)
+			goto found;
+	}
+	
+	return (NULL);
+
+found:
+
+	mq->count = 1;
+	mq->unlinked = 0;
+	kstrncpy(mq->name, name, MQ_NAME_MAX);
+	mq->name[MQ_NAME_MAX] = '\0';
+	mq->maxmsg = maxmsg;
+	mq->msgsize = msgsize;
+	mq->curmsgs = 0;
+	mq->head = NULL;
+	waitq_init(&mq->rchain);
+	waitq_init(&mq->wchain);
+	
+	return (mq);
+}
+
+/**
+ * @brief Releases a reference to a message queue.
+ * 
+ * @details The message queue is released along with its last reference,
+ *          and queued messages are thrown away.
+ * 
+ * @param mq Message queue.
+ */
+PUBLIC void mq_put(struct mqueue *mq)
+{
+	struct message *msg;
+	
+	if (--mq->count > 0)
+		return;
+	
+	while ((msg = mq->head) != NULL)
+	{
+		mq->head = msg->next;
+		mq_msgfree(msg);
+	}
+	
+	mq->curmsgs = 0;
+}
+
+/**
+ * @brief Removes the name of a message queue.
+ * 
+ * @param mq Message queue.
+ */
+PUBLIC void mq_remove(struct mqueue *mq)
+{
+	mq->unlinked = 1;
+	mq_put(mq);
+}
+
+/**
+ * @brief Copies a message in from the current process.
+ * 
+ * @details Whole pages of a page aligned message are lent, copy on write, so
+ *          that they are not copied at all. The remaining bytes, and pages
+ *          that may not be lent, are copied to kernel memory instead.
+ * 
+ * @param buf  Message buffer.
+ * @param size Message size.
+ * @param prio Message priority.
+ * 
+ * @returns A new message, or NULL if there is not enough memory.
+ * 
+ * @note The caller shall check the message buffer beforehand.
+ */
+PUBLIC struct message *mq_msgin(const char *buf, size_t size, unsigned prio)
+{
+	size_t n;            /* Bytes in page.   */
+	unsigned i;          /* Loop index.      */
+	const char *p;       /* Working page.    */
+	struct message *msg; /* Message.         */
+	
+	if ((msg = kmalloc(sizeof(struct message))) == NULL)
+		return (NULL);
+	
+	kmemset(msg, 0, sizeof(struct message));
+	msg->prio = prio;
+	msg->size = size;
+	
+	for (i = 0; i*PAGE_SIZE < size; i++)
+	{
+		p = buf + i*PAGE_SIZE;
+		n = ((size - i*PAGE_SIZE) > PAGE_SIZE) ? PAGE_SIZE : size - i*PAGE_SIZE;
+		
+		/* Lend whole page. */
+		if ((n == PAGE_SIZE) && (!(ADDR(p) & ~PAGE_MASK)))
+		{
+			if (!lendupg(ADDR(p), &msg->pages[i]))
+				continue;
+		}
+		
+		if ((msg->data[i] = kmalloc(n)) == NULL)
+			goto error;
+		
+		kmemcpy(msg->data[i], p, n);
+	}
+	
+	return (msg);
+
+error:
+	mq_msgfree(msg);
+	return (NULL);
+}
+
+/**
+ * @brief Copies a message out to the current process.
+ * 
+ * @details Lent pages are handed over to the current process if @p buf is
+ *          page aligned, and copied otherwise.
+ * 
+ * @param msg Message.
+ * @param buf Message buffer.
+ * 
+ * @returns Zero upon success, and non-zero otherwise.
+ * 
+ * @note The caller shall check the message buffer beforehand.
+ */
+PUBLIC int mq_msgout(struct message *msg, char *buf)
+{
+	size_t n;   /* Bytes in page.  */
+	unsigned i; /* Loop index.     */
+	char *p;    /* Working page.   */
+	void *kpg;  /* Bounce page.    */
+	
+	for (i = 0; i*PAGE_SIZE < msg->size; i++)
+	{
+		p = buf + i*PAGE_SIZE;
+		n = ((msg->size - i*PAGE_SIZE) > PAGE_SIZE) ?
+			PAGE_SIZE : msg->size - i*PAGE_SIZE;
+		
+		/* Copied page. */
+		if (msg->data[i] != NULL)
+		{
+			kmemcpy(p, msg->data[i], n);
+			continue;
+		}
+		
+		/* Hand lent page over. */
+		if ((!(ADDR(p) & ~PAGE_MASK)) && (!moveupg(ADDR(p), &msg->pages[i])))
+			continue;
+		
+		/* Bounce lent page. */
+		if ((kpg = getkpg(0)) == NULL)
+			return (-1);
+		physcpy(ADDR(kpg) - KBASE_VIRT, msg->pages[i].frame << PAGE_SHIFT,
+			PAGE_SIZE);
+		kmemcpy(p, kpg, PAGE_SIZE);
+		putkpg(kpg);
+	}
+	
+	return (0);
+}
+
+/**
+ * @brief Releases a message.
+ * 
+ * @param msg Message.
+ */
+PUBLIC void mq_msgfree(struct message *msg)
+{
+	unsigned i;
+	
+	for (i = 0; i < MQ_PAGES_MAX; i++)
+	{
+		if (msg->data[i] != NULL)
+			kfree(msg->data[i]);
+		else if (msg->pages[i].present)
+			freeupg(&msg->pages[i]);
+	}
+	
+	kfree(msg);
+}
+
+/**
+ * @brief Queues a message.
+ * 
+ * @details Messages are kept in decreasing order of priority, and in
+ *          first-in first-out order within the same priority.
+ * 
+ * @param mq  Message queue.
+ * @param msg Message.
+ */
+PUBLIC void mq_enqueue(struct mqueue *mq, struct message *msg)
+{
+	struct message **pp;
+	
+	for (pp = &mq->head; *pp != NULL; pp = &(*pp)->next)
+	{
+		if ((*pp)->prio < msg->prio)
+			break;
+	}
+	
+	msg->next = *pp;
+	*pp = msg;
+	mq->curmsgs++;
+	
+	wakeup(&mq->rchain);
+}
+
+/**
+ * @brief Takes the oldest message of highest priority out of a queue.
+ * 
+ * @param mq Message queue.
+ * 
+ * @returns The message, or NULL if the queue is empty.
+ */
+PUBLIC struct message *mq_dequeue(struct mqueue *mq)
+{
+	struct message *msg;
+	
+	if ((msg = mq->head) == NULL)
+		return (NULL);
+	
+	mq->head = msg->next;
+	mq->curmsgs--;
+	
+	wakeup(&mq->wchain);
+	
+	return (msg);
+}
+
+/**
+ * @brief Closes a message queue descriptor of the current process.
+ * 
+ * @param mqd Message queue descriptor.
+ */
+PUBLIC void do_mq_close(int mqd)
+{
+	struct mqueue *mq;
+	
+	/* Not opened. */
+	if ((mq = curr_proc->mqdes[mqd]) == NULL)
+		return;
+	
+	curr_proc->mqdes[mqd] = NULL;
+	curr_proc->mqnonblock &= ~(1 << mqd);
+	mq_put(mq);
+}
@@ -24,18 +24,106 @@
 #include <nanvix/fs.h>
 #include <nanvix/hal.h>
 #include <nanvix/klib.h>
+#include <nanvix/ktrace.h>
 #include <nanvix/mm.h>
 #include <nanvix/region.h>
+#include <nanvix/timepage.h>
+#include <nanvix/timer.h>
+#include <nanvix/work.h>
+#include <sys/cachestat.h>
+#include <errno.h>
 #include <signal.h>
 #include "mm.h"
 
+/* Maximum number of pages in the compressed swap cache. */
+#define ZSWAP_PAGES \
+	((((MEMORY_MAX/PAGE_SIZE)*ZSWAP_PERCENT/100) < (KPOOL_SIZE/PAGE_SIZE/2)) ? \
+		((MEMORY_MAX/PAGE_SIZE)*ZSWAP_PERCENT/100) : (KPOOL_SIZE/PAGE_SIZE/2))
+
+/* Maximum number of compressed pages. */
+#define NR_ZENTRIES (ZSWAP_PAGES*8 + 1)
+
+/* Bits of the slot number in a swap entry. */
+#define SWAP_AREA_SHIFT 18
+
+/*
+ * Swapping area too large?
+ */
+#if ((SWP_SIZE/PAGE_SIZE) > (1 << SWAP_AREA_SHIFT))
+	#error "swapping area too large"
+#endif
+
+/*
+ * Too many swapping areas?
+ */
+#if (NR_SWAPAREAS > (1 << (20 - SWAP_AREA_SHIFT)))
+	#error "too many swapping areas"
+#endif
+
+/*
+ * Too many compressed pages?
+ */
+#if (NR_ZENTRIES >= 0xffff)
+	#error "too many compressed pages"
+#endif
+
+/*
+ * Swap reference counts too narrow?
+ */
+#if (PROC_MAX > 255)
+	#error "swap reference counts too narrow"
+#endif
+
 /*
- * Swapping area too small?
+ * Swapping area not aligned to blocks?
  */
-#if (SWP_SIZE < MEMORY_SIZE)
-	#error "swapping area to small"
+#if (SWAP_OFF & (BLOCK_SIZE - 1))
+	#error "swapping area not aligned"
 #endif
 
+/**
+ * @brief Virtual memory statistics.
+ */
+PRIVATE struct
+{
+	unsigned zero;     /**< Zero fill page faults.       */
+	unsigned swapins;  /**< Pages swapped in.            */
+	unsigned swapouts; /**< Pages swapped out.           */
+	unsigned cow;      /**< Copy on write page faults.   */
+	unsigned pgtabcow; /**< Page tables copied on write. */
+	unsigned huge;     /**< Huge pages allocated.        */
+	unsigned split;    /**< Huge pages split.            */
+	unsigned scanned;  /**< Pages scanned for merging.   */
+	unsigned merged;   /**< Identical pages merged.      */
+} vmstats = { 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+/**
+ * @brief Are 4 MB pages enabled?
+ */
+PRIVATE int pse = 0;
+
+/**
+ * @brief Number of frames in a huge page.
+ */
+#define HUGE_FRAMES (PGTAB_SIZE/PAGE_SIZE)
+
+/**
+ * @brief Page tables of huge pages.
+ * 
+ * @details A page directory entry that maps a huge page points to the page
+ *          frames themselves, so the page table that still describes each of
+ *          these frames is kept here, indexed by the huge page frame.
+ */
+PRIVATE struct pte *hugepgtabs[UMEM_MAX/PGTAB_SIZE];
+
+/**
+ * @brief Gets the slot of a huge page in the table of page tables.
+ * 
+ * @param pde Page directory entry that maps the huge page.
+ */
+#define hugeslot(pde) \
+	(((pde)->frame - (UBASE_PHYS >> PAGE_SHIFT))/HUGE_FRAMES)
+
 /**
  * @brief Gets a page directory entry of a process.
  * 
@@ -47,6 +135,17 @@
 #define getpde(p, a) \
 	(&(p)->pgdir[PGTAB(a)])
 
+/**
+ * @brief Gets the page table of a page directory entry.
+ * 
+ * @param pde Page directory entry.
+ * 
+ * @returns The page table that describes the pages mapped by @p pde.
+ */
+#define pdepgtab(pde)                                         \
+	(((pde)->huge) ? hugepgtabs[hugeslot(pde)] :              \
+		(struct pte *)(((pde)->frame << PAGE_SHIFT) + KBASE_VIRT))
+
 /**
  * @brief Gets a page table entry of a process.
  * 
@@ -56,282 +155,2552 @@
  * @returns The requested page table entry.
  */
 #define getpte(p, a) \
-	(&((struct pte *)((getpde(p, a)->frame << PAGE_SHIFT) + KBASE_VIRT))[PG(a)])
+	(&pdepgtab(getpde(p, a))[PG(a)])
+
+/**
+ * @brief Gets the page table entry that maps a frame in a process.
+ * 
+ * @param proc  Process.
+ * @param addr  Address.
+ * @param frame Frame number.
+ * 
+ * @returns The page table entry that maps @p addr to @p frame in @p proc. If
+ *          the process is gone, or @p addr is not mapped to @p frame, NULL is
+ *          returned instead.
+ */
+PRIVATE struct pte *mappedpte(struct process *proc, addr_t addr, unsigned frame)
+{
+	struct pte *pg;
+	
+	/* Process is gone. */
+	if ((proc->state == PROC_DEAD) || (proc->state == PROC_ZOMBIE))
+		return (NULL);
+	
+	/* Page table not present, or huge page. */
+	if ((!getpde(proc, addr)->present) || (getpde(proc, addr)->huge))
+		return (NULL);
+	
+	pg = getpte(proc, addr);
+	
+	/* Mapped to some other frame. */
+	if ((!pg->present) || (pg->frame != frame))
+		return (NULL);
+	
+	return (pg);
+}
 
 
 /*============================================================================*
- *                             Swapping System                                *
+ *                             Kernel Page Pool                               *
  *============================================================================*/
 
+/* Kernel pages. */
+#define NR_KPAGES (KPOOL_SIZE/PAGE_SIZE)  /* Number of kernel pages.  */
+#define NR_KEXT   (KEXT_SIZE/PAGE_SIZE)   /* Borrowable user frames.  */
+PRIVATE int kpages[NR_KPAGES + NR_KEXT];  /* Reference count.         */
+PRIVATE unsigned nkfree = NR_KPAGES;      /* Free kernel pages.       */
+PRIVATE unsigned nkborrowed = 0;          /* Borrowed user frames.    */
+
 /**
- * @brief Swap space.
+ * @brief Kernel pages released so far, in LIFO order.
  */
 PRIVATE struct
 {
-	unsigned count[SWP_SIZE/PAGE_SIZE];         /**< Reference count. */
-	uint32_t bitmap[(SWP_SIZE/PAGE_SIZE) >> 5]; /**< Bitmap.          */
-} swap = {{0, }, {0, } };
+	unsigned brk;                  /**< First page never handed out. */
+	unsigned n;                    /**< Number of released pages.    */
+	unsigned short pgs[NR_KPAGES]; /**< Released pages.              */
+} kpgfree = { 0, 0, { 0, } };
+
+/* Forward definitions. */
+PRIVATE int kborrow(void);
+PRIVATE void kgiveback(int);
 
 /**
- * @brief Clears the swap space that is associated to a page.
+ * @brief Allocates a kernel page.
  * 
- * @param pg Page to be inspected.
+ * @details Pages are taken from the kernel page pool. Once it is exhausted,
+ *          a free user frame that is mapped by the kernel page pool extension
+ *          is borrowed, and it goes back to the user frame pool as soon as it
+ *          is released.
+ * 
+ * @param clean Should the page be cleaned?
+ * 
+ * @returns Upon success, a pointer to a page is returned. Upon failure, a NULL
+ *          pointer is returned instead.
  */
-PRIVATE void swap_clear(struct pte *pg)
+PUBLIC void *getkpg(int clean)
 {
-	unsigned i;
+	int i;     /* Page index.  */
+	void *kpg; /* Kernel page. */
 	
-	i = pg->frame;
+	/* Reuse a released page. */
+	if (kpgfree.n > 0)
+		i = kpgfree.pgs[--kpgfree.n];
 	
-	/* Free swap space. */
-	if (swap.count[i] > 0)
+	/* Take a page that was never used. */
+	else if (kpgfree.brk < NR_KPAGES)
+		i = kpgfree.brk++;
+	
+	/* Borrow a user frame. */
+	else if ((i = kborrow()) >= 0)
+	{
+		i += NR_KPAGES;
+		nkborrowed++;
+	}
+	
+	else
 	{
-		bitmap_clear(swap.bitmap, i);
-		swap.count[i]--;
+		kprintf("mm: kernel page pool overflow");
+		return (NULL);
 	}
+
+	/* Set page as used. */
+	kpg = (void *)(KPOOL_VIRT + (i << PAGE_SHIFT));
+	kpages[i]++;
+	if (i < NR_KPAGES)
+		nkfree--;
+	
+	/* Clean page. */
+	if (clean)
+		kpgzero(kpg);
+	
+	return (kpg);
 }
 
 /**
- * @brief Swaps a page out to disk.
- * 
- * @param proc Process where the page is located.
- * @param addr Address of the page to be swapped out.
+ * @brief Releases kernel page.
  * 
- * @returns Zero upon success, and non-zero otherwise.
+ * @param kpg Kernel page to be released.
  */
-PRIVATE int swap_out(struct process *proc, addr_t addr)
+PUBLIC void putkpg(void *kpg)
 {
-	unsigned blk;   /* Block number in swap device.  */
-	struct pte *pg; /* Page table entry.             */
-	off_t off;      /* Offset in swap device.        */
-	ssize_t n;      /* # bytes written.              */
-	void *kpg;      /* Kernel page used for copying. */
-	
-	addr &= PAGE_MASK;
-	pg = getpte(proc, addr);
+	unsigned i;
 	
-	/* Get kernel page. */
-	if ((kpg = getkpg(0)) == NULL)
-		goto error0;
+	i = ((addr_t)kpg - KPOOL_VIRT) >> PAGE_SHIFT;
 	
-	/* Get free block in swap device. */
-	blk = bitmap_first_free(swap.bitmap, (SWP_SIZE/PAGE_SIZE) >> 3);
-	if (blk == BITMAP_FULL)
-		goto error1;
+	/* Release page. */
+	kpages[i]--;
 	
-	/*
-	 * Set block on swap device as used
-	 * in advance, because we may sleep below.
-	 */
-	off = HDD_SIZE + blk*PAGE_SIZE;
-	bitmap_set(swap.bitmap, blk);
+	/* Double free. */
+	if (kpages[i] < 0)
+		kpanic("mm: releasing kernel page twice");
 	
-	/* Write page to disk. */
-	kmemcpy(kpg, (void *)addr, PAGE_SIZE);
-	n = bdev_write(SWAP_DEV, (void *)addr, PAGE_SIZE, off);
-	if (n != PAGE_SIZE)
-		goto error2;
-	swap.count[blk]++;
+	if (kpages[i] > 0)
+		return;
 	
-	/* Set page as non-present. */
-	pg->present = 0;
-	pg->frame = blk;
-	tlb_flush();
+	/* Give borrowed frame back. */
+	if (i >= NR_KPAGES)
+	{
+		kgiveback(i - NR_KPAGES);
+		nkborrowed--;
+		return;
+	}
 	
-	putkpg(kpg);
-	return (0);
+	kpgfree.pgs[kpgfree.n++] = i;
+	nkfree++;
+}
 
-error2:
-	bitmap_clear(swap.bitmap, blk);
-error1:
-	putkpg(kpg);
-error0:
-	return (-1);
+/**
+ * @brief Adds a reference to a kernel page.
+ * 
+ * @param kpg Target kernel page.
+ */
+PUBLIC void linkkpg(void *kpg)
+{
+	kpages[((addr_t)kpg - KPOOL_VIRT) >> PAGE_SHIFT]++;
 }
 
 /**
- * @brief Swaps a page in to disk.
+ * @brief Asserts if a kernel page is shared.
  * 
- * @param frame Frame number where the page should be placed.
- * @param addr  Address of the page to be swapped in.
+ * @param kpg Target kernel page.
  * 
- * @returns Zero upon success, and non-zero otherwise.
+ * @returns Non-zero if the kernel page has more than one reference, and zero
+ *          otherwise.
  */
-PRIVATE int swap_in(unsigned frame, addr_t addr)
+PUBLIC int kpgshared(void *kpg)
+{
+	return (kpages[((addr_t)kpg - KPOOL_VIRT) >> PAGE_SHIFT] > 1);
+}
+
+/*============================================================================*
+ *                             Swapping System                                *
+ *============================================================================*/
+
+/* Pages per swap cluster. */
+#define SWAP_CLUSTER 4
+
+/* Blocks per page. */
+#define SWAP_BLOCKS (PAGE_SIZE/BLOCK_SIZE)
+
+/* Null swap entry. */
+#define SWAP_NULL BITMAP_FULL
+
+/* Slots per swap area. */
+#define SWAP_SLOTS (SWP_SIZE/PAGE_SIZE)
+
+/**
+ * @name Swap Entries
+ * 
+ * @details The frame number of a swapped out page holds a swap entry, which
+ *          identifies a swap area and a slot in it.
+ */
+/**@{*/
+#define SWAP_ENTRY(a, s) (((a) << SWAP_AREA_SHIFT) | (s))        /**< Entry. */
+#define SWAP_AREA(e)     ((e) >> SWAP_AREA_SHIFT)                /**< Area.  */
+#define SWAP_SLOT(e)     ((e) & ((1 << SWAP_AREA_SHIFT) - 1))    /**< Slot.  */
+/**@}*/
+
+/**
+ * @brief Swap areas.
+ */
+PRIVATE struct swaparea
+{
+	dev_t dev;                        /**< Device.                   */
+	off_t off;                        /**< Offset in device.         */
+	unsigned nslots;                  /**< Number of slots.          */
+	int prio;                         /**< Priority.                 */
+	unsigned char count[SWAP_SLOTS];  /**< Reference count of slots. */
+	uint32_t bitmap[SWAP_SLOTS >> 5]; /**< Bitmap of slots.          */
+	unsigned short zent[SWAP_SLOTS];  /**< Compressed copies.        */
+} swapareas[NR_SWAPAREAS];
+
+/**
+ * @brief Next swap area to be tried.
+ */
+PRIVATE unsigned swap_next = 0;
+
+/**
+ * @brief Gets the first disk block of a swap slot.
+ * 
+ * @param a Swap area.
+ * @param s Slot number.
+ * 
+ * @returns The number of the first disk block of slot @p s in the device of
+ *          swap area @p a.
+ */
+#define swap_block(a, s) \
+	(((a)->off + (s)*PAGE_SIZE) >> BLOCK_SIZE_LOG2)
+
+/*----------------------------------------------------------------------------*
+ *                           Compressed Swap Cache                            *
+ *----------------------------------------------------------------------------*/
+
+/* Compressed swap cache chunks. */
+#define ZSWAP_CHUNK  256                    /* Chunk size.           */
+#define ZSWAP_CHUNKS (PAGE_SIZE/ZSWAP_CHUNK) /* Chunks per page.      */
+#define ZSWAP_MAXLEN ((3*PAGE_SIZE)/4)      /* Largest page kept.    */
+
+/* Chunk map of an empty pool page. */
+#define ZSWAP_EMPTY ((uint32_t)~((1 << ZSWAP_CHUNKS) - 1))
+
+/**
+ * @brief Compressed pages.
+ */
+PRIVATE struct
+{
+	unsigned e;            /**< Swap entry.         */
+	unsigned short len;    /**< Compressed length.  */
+	unsigned short page;   /**< Pool page.          */
+	unsigned char chunk;   /**< First chunk.        */
+	unsigned char nchunks; /**< Number of chunks.   */
+	int prev;              /**< Previous in list.   */
+	int next;              /**< Next in list.       */
+} zentries[NR_ZENTRIES];
+
+/**
+ * @brief Pool pages of the compressed swap cache.
+ */
+PRIVATE struct
+{
+	char *data;   /**< Kernel page, or NULL. */
+	uint32_t map; /**< Chunk map.            */
+} zpages[ZSWAP_PAGES + 1];
+
+/**
+ * @brief Compressed swap cache.
+ */
+PRIVATE struct
+{
+	int free;         /**< Free compressed pages.      */
+	int head;         /**< Least recently stored page. */
+	int tail;         /**< Most recently stored page.  */
+	unsigned npages;  /**< Pool pages in use.          */
+	unsigned max;     /**< Maximum pool pages.         */
+	char *scratch[2]; /**< Scratch kernel pages.       */
+} zswap = { -1, -1, -1, 0, 0, { NULL, NULL } };
+
+/**
+ * @brief Asserts if the compressed swap cache may not grow.
+ */
+#define zswap_full() \
+	((zswap.npages >= zswap.max) || (nkfree <= NR_KPAGES/4))
+
+/**
+ * @brief Releases a compressed page.
+ * 
+ * @param z Compressed page.
+ */
+PRIVATE void zswap_free(int z)
 {
-	unsigned blk;   /* Block number in swap device.  */
-	struct pte *pg; /* Page table entry.             */
-	off_t off;      /* Offset in swap device.        */
-	ssize_t n;      /* # bytes read.                 */
-	void *kpg;      /* Kernel page used for copying. */
+	unsigned p;         /* Pool page. */
+	struct swaparea *a; /* Swap area. */
 	
-	addr &= PAGE_MASK;
-	pg = getpte(curr_proc, addr);
+	a = &swapareas[SWAP_AREA(zentries[z].e)];
+	a->zent[SWAP_SLOT(zentries[z].e)] = 0;
 	
-	/* Get kernel page. */
-	if ((kpg = getkpg(0)) == NULL)
-		goto error0;
+	/* Release chunks. */
+	p = zentries[z].page;
+	zpages[p].map &= ~(((1 << zentries[z].nchunks) - 1) << zentries[z].chunk);
+	if (zpages[p].map == ZSWAP_EMPTY)
+	{
+		putkpg(zpages[p].data);
+		zpages[p].data = NULL;
+		zswap.npages--;
+	}
 	
-	/* Get block # in swap device. */
-	blk = pg->frame;
-	off = HDD_SIZE + blk*PAGE_SIZE;
+	/* Remove from list of stored pages. */
+	if (zentries[z].prev >= 0)
+		zentries[zentries[z].prev].next = zentries[z].next;
+	else
+		zswap.head = zentries[z].next;
+	if (zentries[z].next >= 0)
+		zentries[zentries[z].next].prev = zentries[z].prev;
+	else
+		zswap.tail = zentries[z].prev;
 	
-	/* Read page from disk. */
-	n = bdev_read(SWAP_DEV, kpg, PAGE_SIZE, off);
-	if (n != PAGE_SIZE)
-		goto error1;
-	swap_clear(pg);
+	zentries[z].next = zswap.free;
+	zswap.free = z;
+}
+
+/**
+ * @brief Stores a page in the compressed swap cache.
+ * 
+ * @param a     Swap area.
+ * @param slot  Slot of the page in @p a.
+ * @param phys  Physical address of the page.
+ * 
+ * @returns Zero if the page was stored, and non-zero if it does not compress
+ *          well enough or if there is no room for it.
+ * 
+ * @note This function does not sleep.
+ */
+PRIVATE int zswap_store(struct swaparea *a, unsigned slot, addr_t phys)
+{
+	int z;        /* Compressed page. */
+	unsigned p;   /* Pool page.       */
+	unsigned c;   /* First chunk.     */
+	unsigned nch; /* Chunks needed.   */
+	size_t len;   /* Compressed size. */
+	
+	/* Disabled or full. */
+	if ((zswap.scratch[0] == NULL) || ((z = zswap.free) < 0))
+		return (-1);
 	
-	/* Set page as present. */
-	pg->present = 1;
-	pg->frame = (UBASE_PHYS >> PAGE_SHIFT) + frame;
-	tlb_flush();
+	/* Compress page. */
+	physcpy(ADDR(zswap.scratch[0]) - KBASE_VIRT, phys, PAGE_SIZE);
+	len = klz_compress(zswap.scratch[0], PAGE_SIZE, zswap.scratch[1],
+		ZSWAP_MAXLEN);
+	if (len == 0)
+		return (-1);
+	nch = (len + ZSWAP_CHUNK - 1)/ZSWAP_CHUNK;
 	
-	/* Copy page. */
-	kmemcpy((void *)addr, kpg, PAGE_SIZE);
-	pg->accessed = 0;
-	pg->dirty = 0;
+	/* Search for room in pool pages. */
+	for (p = 0; p < ZSWAP_PAGES; p++)
+	{
+		if (zpages[p].data == NULL)
+			continue;
 		
-	putkpg(kpg);
+		c = bitmap_first_free_n(&zpages[p].map, sizeof(uint32_t), nch);
+		if (c != BITMAP_FULL)
+			goto found;
+	}
+	
+	/* Grow pool. */
+	if (zswap_full())
+		return (-1);
+	for (p = 0; zpages[p].data != NULL; p++)
+		noop();
+	if ((zpages[p].data = getkpg(0)) == NULL)
+		return (-1);
+	zpages[p].map = ZSWAP_EMPTY;
+	zswap.npages++;
+	c = 0;
+	
+found:
+
+	kmemcpy(zpages[p].data + c*ZSWAP_CHUNK, zswap.scratch[1], len);
+	zpages[p].map |= ((1 << nch) - 1) << c;
+	
+	zswap.free = zentries[z].next;
+	zentries[z].e = SWAP_ENTRY(a - swapareas, slot);
+	zentries[z].len = len;
+	zentries[z].page = p;
+	zentries[z].chunk = c;
+	zentries[z].nchunks = nch;
+	a->zent[slot] = z + 1;
+	
+	/* Append to list of stored pages. */
+	zentries[z].prev = zswap.tail;
+	zentries[z].next = -1;
+	if (zswap.tail >= 0)
+		zentries[zswap.tail].next = z;
+	else
+		zswap.head = z;
+	zswap.tail = z;
+	
 	return (0);
+}
 
-error1:
-	putkpg(kpg);
-error0:
-	return (-1);
+/**
+ * @brief Loads a page from the compressed swap cache.
+ * 
+ * @param a    Swap area.
+ * @param slot Slot of the page in @p a.
+ * @param phys Physical address where the page shall be placed.
+ * 
+ * @returns Zero if the page was found in the compressed swap cache, and
+ *          non-zero otherwise. The compressed copy is kept, since the slot
+ *          may be shared.
+ * 
+ * @note This function does not sleep.
+ */
+PRIVATE int zswap_load(struct swaparea *a, unsigned slot, addr_t phys)
+{
+	int z;
+	
+	/* Not cached. */
+	if ((z = a->zent[slot] - 1) < 0)
+		return (-1);
+	
+	klz_decompress(zpages[zentries[z].page].data + zentries[z].chunk*ZSWAP_CHUNK,
+		zentries[z].len, zswap.scratch[0], PAGE_SIZE);
+	physcpy(phys, ADDR(zswap.scratch[0]) - KBASE_VIRT, PAGE_SIZE);
+	
+	return (0);
 }
 
-/*============================================================================*
- *                             Kernel Page Pool                               *
- *============================================================================*/
+/**
+ * @brief Makes room in the compressed swap cache.
+ * 
+ * @details If the compressed swap cache may not grow, the least recently
+ *          stored pages are written back to their swap slots, so that
+ *          recently evicted pages, which are more likely to be faulted in,
+ *          are kept compressed instead.
+ */
+PRIVATE void zswap_shrink(void)
+{
+	int z;                      /* Compressed page.    */
+	unsigned j;                 /* Loop index.         */
+	unsigned n;                 /* Pages written back. */
+	unsigned e;                 /* Swap entry.         */
+	struct swaparea *a;         /* Swap area.          */
+	buffer_t bufs[SWAP_BLOCKS]; /* Block buffers.      */
+	
+	for (n = 0; (n < SWAP_CLUSTER) && (zswap_full()); n++)
+	{
+		if ((z = zswap.head) < 0)
+			break;
+		
+		e = zentries[z].e;
+		a = &swapareas[SWAP_AREA(e)];
+		
+		for (j = 0; j < SWAP_BLOCKS; j++)
+			bufs[j] = bget(a->dev, swap_block(a, SWAP_SLOT(e)) + j);
+		
+		/* Released meanwhile. */
+		if (a->zent[SWAP_SLOT(e)] != z + 1)
+		{
+			for (j = 0; j < SWAP_BLOCKS; j++)
+			{
+				buffer_valid(bufs[j], 0);
+				brelse(bufs[j]);
+			}
+			continue;
+		}
+		
+		klz_decompress(zpages[zentries[z].page].data +
+			zentries[z].chunk*ZSWAP_CHUNK, zentries[z].len,
+			zswap.scratch[0], PAGE_SIZE);
+		zswap_free(z);
+		
+		/* Write page to disk. */
+		for (j = 0; j < SWAP_BLOCKS; j++)
+		{
+			kmemcpy(buffer_data(bufs[j]), zswap.scratch[0] + j*BLOCK_SIZE,
+				BLOCK_SIZE);
+			buffer_dirty(bufs[j], 1);
+		}
+		for (j = 0; j < SWAP_BLOCKS; j++)
+			bwrite(bufs[j]);
+	}
+}
 
-/* Kernel pages. */
-#define NR_KPAGES (KPOOL_SIZE/PAGE_SIZE) /* Number of kernel pages.  */
-PRIVATE int kpages[NR_KPAGES] = { 0,  }; /* Reference count.         */
+/**
+ * @brief Drops the compressed copy of a swap slot, if any.
+ * 
+ * @param a    Swap area.
+ * @param slot Slot.
+ */
+#define zswap_drop(a, slot) \
+	{ if ((a)->zent[slot]) zswap_free((a)->zent[slot] - 1); }
 
 /**
- * @brief Allocates a kernel page.
+ * @brief Initializes the compressed swap cache.
+ */
+PRIVATE void zswap_init(void)
+{
+	int z;
+	
+	zswap.max = (mem_size/PAGE_SIZE)*ZSWAP_PERCENT/100;
+	if (zswap.max > ZSWAP_PAGES)
+		zswap.max = ZSWAP_PAGES;
+	
+	/* Disabled. */
+	if (zswap.max == 0)
+		return;
+	
+	zswap.scratch[0] = getkpg(0);
+	zswap.scratch[1] = getkpg(0);
+	
+	/* Build list of free compressed pages. */
+	for (z = NR_ZENTRIES - 1; z >= 0; z--)
+	{
+		zentries[z].next = zswap.free;
+		zswap.free = z;
+	}
+}
+
+/*----------------------------------------------------------------------------*/
+
+/**
+ * @brief Adds a reference to the swap slot of a page.
+ * 
+ * @param pg Page to be inspected.
+ */
+PRIVATE void swap_ref(struct pte *pg)
+{
+	swapareas[SWAP_AREA(pg->frame)].count[SWAP_SLOT(pg->frame)]++;
+}
+
+/**
+ * @brief Clears the swap space that is associated to a page.
+ * 
+ * @param pg Page to be inspected.
+ */
+PRIVATE void swap_clear(struct pte *pg)
+{
+	unsigned i;
+	struct swaparea *a;
+	
+	a = &swapareas[SWAP_AREA(pg->frame)];
+	i = SWAP_SLOT(pg->frame);
+	
+	/* Free swap space. */
+	if (a->count[i] > 0)
+	{
+		if (--a->count[i] == 0)
+		{
+			bitmap_clear(a->bitmap, i);
+			zswap_drop(a, i);
+		}
+	}
+}
+
+/**
+ * @brief Allocates contiguous slots in the swap space.
+ * 
+ * @details The swap area with the highest priority that has @p n contiguous
+ *          free slots is chosen. Swap areas with the same priority are tried
+ *          in round-robin, so that consecutive allocations are striped across
+ *          them.
+ * 
+ * @param n Number of slots.
+ * 
+ * @returns Upon success, the swap entry of the first slot is returned. Upon
+ *          failure, #SWAP_NULL is returned instead.
+ */
+PRIVATE unsigned swap_alloc(unsigned n)
+{
+	unsigned i;            /* Loop index.        */
+	unsigned k;            /* Working swap area. */
+	unsigned s;            /* Working slot.      */
+	unsigned slot;         /* First slot.        */
+	struct swaparea *a;    /* Working swap area. */
+	struct swaparea *best; /* Chosen swap area.  */
+	
+	best = NULL;
+	slot = SWAP_NULL;
+	for (i = 0; i < NR_SWAPAREAS; i++)
+	{
+		k = (swap_next + i) % NR_SWAPAREAS;
+		a = &swapareas[k];
+		
+		/* Unused or less preferred swap area. */
+		if ((a->nslots == 0) || ((best != NULL) && (a->prio <= best->prio)))
+			continue;
+		
+		s = bitmap_first_free_n(a->bitmap, (SWAP_SLOTS >> 3), n);
+		
+		/* No room. */
+		if ((s == BITMAP_FULL) || (s + n > a->nslots))
+			continue;
+		
+		best = a;
+		slot = s;
+	}
+	
+	/* No free slots. */
+	if (best == NULL)
+		return (SWAP_NULL);
+	
+	/* Set slots as used. */
+	for (i = 0; i < n; i++)
+		bitmap_set(best->bitmap, slot + i);
+	
+	k = best - swapareas;
+	swap_next = (k + 1) % NR_SWAPAREAS;
+	
+	return (SWAP_ENTRY(k, slot));
+}
+
+/**
+ * @brief Adds a swap area.
+ * 
+ * @param dev  Device.
+ * @param size Size of the swap area (in bytes).
+ * @param prio Priority.
+ * 
+ * @returns Upon successful completion, zero is returned. Upon failure, a
+ *          negative error code is returned instead.
+ */
+PUBLIC int swap_add(dev_t dev, size_t size, int prio)
+{
+	unsigned i;            /* Loop index.          */
+	struct swaparea *a;    /* Working swap area.   */
+	struct superblock *sb; /* Mounted file system. */
+	
+	/* Too small. */
+	if (size < PAGE_SIZE)
+		return (-EINVAL);
+	
+	/* Device holds a file system. */
+	if ((sb = superblock_get(dev)) != NULL)
+	{
+		superblock_put(sb);
+		return (-EBUSY);
+	}
+	
+	/* Search for a free swap area. */
+	a = NULL;
+	for (i = 0; i < NR_SWAPAREAS; i++)
+	{
+		/* Device is already used. */
+		if ((swapareas[i].nslots > 0) && (swapareas[i].dev == dev))
+			return (-EBUSY);
+		
+		if ((swapareas[i].nslots == 0) && (a == NULL))
+			a = &swapareas[i];
+	}
+	
+	/* Too many swap areas. */
+	if (a == NULL)
+		return (-ENOSPC);
+	
+	a->dev = dev;
+	a->off = 0;
+	a->prio = prio;
+	kmemset(a->count, 0, sizeof(a->count));
+	kmemset(a->bitmap, 0, sizeof(a->bitmap));
+	kmemset(a->zent, 0, sizeof(a->zent));
+	a->nslots = ((size/PAGE_SIZE) < SWAP_SLOTS) ? size/PAGE_SIZE : SWAP_SLOTS;
+	
+	return (0);
+}
+
+/**
+ * @brief Swaps a page in from disk.
+ * 
+ * @details The page is read through the block buffer cache, and read ahead
+ *          is started for the next #SWAP_CLUSTER - 1 blocks of the swap
+ *          space that are in use, since they are likely to hold neighbouring
+ *          pages that were swapped out together.
+ * 
+ * @param frame Frame number where the page should be placed.
+ * @param addr  Address of the page to be swapped in.
+ * 
+ * @returns Zero upon success, and non-zero otherwise.
+ */
+PRIVATE int swap_in(unsigned frame, addr_t addr)
+{
+	unsigned i;         /* Loop index.                */
+	unsigned s;         /* Slot in swap area.         */
+	struct pte *pg;     /* Page table entry.          */
+	struct swaparea *a; /* Swap area.                 */
+	buffer_t buf;       /* Working block buffer.      */
+	addr_t phys;        /* Physical address of frame. */
+	
+	addr &= PAGE_MASK;
+	pg = getpte(curr_proc, addr);
+	
+	/* Get slot in swap area. */
+	a = &swapareas[SWAP_AREA(pg->frame)];
+	s = SWAP_SLOT(pg->frame);
+	
+	phys = (UBASE_PHYS + (frame << PAGE_SHIFT));
+	
+	/* Compressed copy. */
+	if (!zswap_load(a, s, phys))
+		goto found;
+	
+	/* Disk schedulers serve swap-ins first. */
+	curr_proc->flags |= 1 << PROC_SWAPIN;
+	
+	/* Read neighbouring pages ahead. */
+	for (i = 1; i < SWAP_CLUSTER; i++)
+	{
+		unsigned j;
+		
+		if (s + i >= a->nslots)
+			break;
+		
+		if (!bitmap_test(a->bitmap, s + i))
+			break;
+		
+		/* Compressed copy. */
+		if (a->zent[s + i])
+			continue;
+		
+		for (j = 0; j < SWAP_BLOCKS; j++)
+			breada(a->dev, swap_block(a, s + i) + j);
+	}
+	
+	/* Read page from disk. */
+	for (i = 0; i < SWAP_BLOCKS; i++)
+	{
+		if ((buf = bread(a->dev, swap_block(a, s) + i)) == NULL)
+		{
+			curr_proc->flags &= ~(1 << PROC_SWAPIN);
+			return (-1);
+		}
+		
+		physcpy(phys + i*BLOCK_SIZE, ADDR(buffer_data(buf)) - KBASE_VIRT,
+			BLOCK_SIZE);
+		brelse(buf);
+	}
+	
+	curr_proc->flags &= ~(1 << PROC_SWAPIN);
+	
+found:
+
+	swap_clear(pg);
+	
+	/* Set page as present. */
+	pg->present = 1;
+	pg->frame = (UBASE_PHYS >> PAGE_SHIFT) + frame;
+	pg->accessed = 0;
+	pg->dirty = 0;
+	tlb_flush_page(addr);
+	
+	return (0);
+}
+
+/*============================================================================*
+ *                             Memory-Mapped IO                               *
+ *============================================================================*/
+
+/* Memory-mapped IO page table (set up at boot). */
+EXTERN struct pte iomem_pgtab[];
+
+/* Next free address in the memory-mapped IO window. */
+PRIVATE addr_t iomem_brk = IOMEM_VIRT;
+
+/**
+ * @brief Page attribute table MSR.
+ */
+#define MSR_PAT 0x277
+
+/**
+ * @brief Page attribute table with write-combining in entry 1.
+ * 
+ * @details This is the power-up table, except for entry 1 (PWT set, PCD
+ *          clear), which is write-combining instead of write-through. No
+ *          other mapping sets PWT alone.
+ */
+/**@{*/
+#define PAT_LOW  0x00070106 /**< Entries 0 to 3. */
+#define PAT_HIGH 0x00070406 /**< Entries 4 to 7. */
+/**@}*/
+
+/**
+ * @brief Is write-combining set up? (-1 if not known yet).
+ */
+PRIVATE int iomem_wc = -1;
+
+/**
+ * @brief Sets up write-combining through the page attribute table.
+ * 
+ * @details Write-combining in the page attribute table takes precedence over
+ *          uncached memory type range registers, which is what firmware sets
+ *          for device memory, so these are left alone.
+ * 
+ * @returns Non-zero if write-combining is supported, and zero otherwise.
+ */
+PRIVATE int patinit(void)
+{
+	uint32_t eax, ebx, ecx, edx;
+	
+	/* Already set up. */
+	if (iomem_wc >= 0)
+		return (iomem_wc);
+	
+	__asm__ volatile (
+		"cpuid"
+		: "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
+		: "0" (1)
+	);
+	
+	/* PAT not supported. */
+	if (!((edx >> 16) & 1))
+		return (iomem_wc = 0);
+	
+	__asm__ volatile ("wrmsr" : : "c" (MSR_PAT), "a" (PAT_LOW), "d" (PAT_HIGH));
+	
+	kprintf("mm: write-combining enabled");
+	
+	return (iomem_wc = 1);
+}
+
+/**
+ * @brief Maps device memory into the memory-mapped IO window.
+ * 
+ * @param addr Physical address of device memory.
+ * @param size Size of device memory.
+ * @param wc   Write-combining?
+ * 
+ * @returns Upon success, a pointer to the mapped device memory is returned.
+ *          Upon failure, a NULL pointer is returned instead.
+ */
+PRIVATE void *iomem_map(addr_t addr, size_t size, int wc)
+{
+	unsigned i;      /* Loop index.       */
+	addr_t virt;     /* Virtual address.  */
+	addr_t base;     /* Base address.     */
+	unsigned npages; /* Number of pages.  */
+	struct pte *pg;  /* Page table entry. */
+	
+	base = addr & PAGE_MASK;
+	npages = (((addr + size + PAGE_SIZE - 1) & PAGE_MASK) - base)>>PAGE_SHIFT;
+	
+	/* Memory-mapped IO window overflow. */
+	if (iomem_brk + (npages << PAGE_SHIFT) > TIMEPAGE_ADDR)
+	{
+		kprintf("mm: memory-mapped IO window overflow");
+		return (NULL);
+	}
+	
+	virt = iomem_brk;
+	iomem_brk += npages << PAGE_SHIFT;
+	
+	for (i = 0; i < npages; i++)
+	{
+		pg = &iomem_pgtab[PG(virt) + i];
+		pg->present = 1;
+		pg->writable = 1;
+		pg->nocache = !wc;
+		pg->wthrough = 1;
+		pg->global = 1;
+		pg->frame = (base >> PAGE_SHIFT) + i;
+	}
+	
+	tlb_flush_range(virt, npages << PAGE_SHIFT);
+	
+	return ((void *)(virt + (addr & ~PAGE_MASK)));
+}
+
+/**
+ * @brief Maps device memory into kernel address space.
+ * 
+ * @param addr Physical address of device memory.
+ * @param size Size of device memory.
+ * 
+ * @returns Upon success, a pointer to the mapped device memory is returned.
+ *          Upon failure, a NULL pointer is returned instead.
+ * 
+ * @note Device memory is mapped uncached and is never unmapped.
+ */
+PUBLIC void *mapiomem(addr_t addr, size_t size)
+{
+	return (iomem_map(addr, size, 0));
+}
+
+/**
+ * @brief Maps frame buffer memory into kernel address space.
+ * 
+ * @details Writes to frame buffer memory are combined into bursts, and are
+ *          not ordered nor read back, so they should be done in bulk. If the
+ *          processor does not support write-combining, the memory is mapped
+ *          uncached instead.
+ * 
+ * @param addr Physical address of frame buffer memory.
+ * @param size Size of frame buffer memory.
+ * 
+ * @returns Upon success, a pointer to the mapped memory is returned. Upon
+ *          failure, a NULL pointer is returned instead.
+ * 
+ * @note Frame buffer memory is never unmapped.
+ */
+PUBLIC void *mapiomem_wc(addr_t addr, size_t size)
+{
+	return (iomem_map(addr, size, patinit()));
+}
+
+/* Error checking. */
+#if (TIMEPAGE_ADDR != IOMEM_VIRT + IOMEM_SIZE - PAGE_SIZE)
+	#error "time page must be the last page of the memory-mapped IO window"
+#endif
+
+/**
+ * @brief Maps the time page into every address space.
+ * 
+ * @details The time page is the last page of the memory-mapped IO window,
+ *          whose page table is shared by all address spaces and is user
+ *          accessible at the directory level. The time page is the only
+ *          user page in there, and it is read-only.
+ */
+PRIVATE void maptimepg(void)
+{
+	struct pte *pg; /* Page table entry. */
+	
+	pg = &iomem_pgtab[PG(TIMEPAGE_ADDR)];
+	pg->present = 1;
+	pg->writable = 0;
+	pg->user = 1;
+	pg->global = 1;
+	pg->frame = (ADDR(clock_timepage()) - KBASE_VIRT) >> PAGE_SHIFT;
+	
+	tlb_flush_range(TIMEPAGE_ADDR, PAGE_SIZE);
+}
+
+/*============================================================================*
+ *                              Paging System                                 *
+ *============================================================================*/
+
+/* Maximum number of page frames. */
+#define NR_FRAMES (UMEM_MAX/PAGE_SIZE)
+
+/* Null frame. */
+#define FRAME_NULL (-1)
+
+/* Frame handed to the compressed swap cache. */
+#define FRAME_STORED (-2)
+
+/**
+ * @brief Page frames.
+ */
+PRIVATE struct
+{
+	unsigned count;        /**< Reference count.                   */
+	unsigned age;          /**< Age.                               */
+	struct process *owner; /**< Page owner.                        */
+	addr_t addr;           /**< Address of the page.               */
+	unsigned pinned;       /**< Pin count.                         */
+	int mark;              /**< Demand mark of a clean page, or -1. */
+	int prev;              /**< Previous frame.                    */
+	int next;              /**< Next frame.                        */
+} frames[NR_FRAMES] = {{0, 0, NULL, 0, 0, 0, 0, 0},  };
+
+/**
+ * @brief Number of page frames.
+ */
+PRIVATE int nframes = 0;
+
+/**
+ * @brief Free frames.
+ */
+PRIVATE int free_frames = FRAME_NULL;
+
+/**
+ * @brief Shared zero frame.
+ */
+PRIVATE int zero_frame = FRAME_NULL;
+
+/**
+ * @brief Frames in use, in clock order.
+ */
+PRIVATE struct
+{
+	int head; /**< Oldest frame. */
+	int tail; /**< Newest frame. */
+} used_frames = { FRAME_NULL, FRAME_NULL };
+
+/**
+ * @brief Removes a frame from the list of frames in use.
+ * 
+ * @param i Frame to be removed.
+ */
+PRIVATE void used_remove(int i)
+{
+	if (frames[i].prev != FRAME_NULL)
+		frames[frames[i].prev].next = frames[i].next;
+	else
+		used_frames.head = frames[i].next;
+	
+	if (frames[i].next != FRAME_NULL)
+		frames[frames[i].next].prev = frames[i].prev;
+	else
+		used_frames.tail = frames[i].prev;
+}
+
+/**
+ * @brief Appends a frame to the list of frames in use.
+ * 
+ * @param i Frame to be appended.
+ */
+PRIVATE void used_append(int i)
+{
+	frames[i].prev = used_frames.tail;
+	frames[i].next = FRAME_NULL;
+	
+	if (used_frames.tail != FRAME_NULL)
+		frames[used_frames.tail].next = i;
+	else
+		used_frames.head = i;
+	
+	used_frames.tail = i;
+}
+
+/**
+ * @brief Releases a page frame.
+ * 
+ * @param i Frame to be released.
+ */
+PRIVATE void freef(int i)
+{
+	frames[i].count = 0;
+	used_remove(i);
+	
+	frames[i].next = free_frames;
+	free_frames = i;
+}
+
+/* Forward definitions. */
+PRIVATE int lowf(void);
+
+/**
+ * @brief Borrows a free user frame for the kernel page pool.
+ * 
+ * @returns Upon success, the number of a free frame that is mapped by the
+ *          kernel page pool extension is returned. Upon failure, a negative
+ *          number is returned instead.
+ */
+PRIVATE int kborrow(void)
+{
+	int i; /* Working frame. */
+	
+	if ((i = lowf()) < 0)
+		return (-1);
+	
+	/* Ownerless and pinned frames are never evicted. */
+	frames[i].count = 1;
+	frames[i].owner = NULL;
+	frames[i].pinned = 1;
+	frames[i].mark = -1;
+	
+	return (i);
+}
+
+/**
+ * @brief Gives a borrowed frame back to the user frame pool.
+ * 
+ * @param i Frame to give back.
+ */
+PRIVATE void kgiveback(int i)
+{
+	frames[i].count = 0;
+	frames[i].pinned = 0;
+	frames[i].next = free_frames;
+	free_frames = i;
+}
+
+/**
+ * @brief Gets the page table entry that maps a frame.
+ * 
+ * @param i Frame to be inspected.
+ * 
+ * @returns The page table entry that maps the frame in its owner. If the frame
+ *          has no owner, or the mapping has gone away, NULL is returned
+ *          instead.
+ */
+PRIVATE struct pte *framepte(int i)
+{
+	if (frames[i].owner == NULL)
+		return (NULL);
+	
+	return (mappedpte(frames[i].owner, frames[i].addr,
+		(UBASE_PHYS >> PAGE_SHIFT) + i));
+}
+
+/**
+ * @brief Asserts if a frame is locked in memory.
+ * 
+ * @param i Frame to be inspected.
+ * 
+ * @returns Non-zero if the page held by the frame lies in a memory region
+ *          that is locked in memory, and zero otherwise.
+ */
+PRIVATE int lockedf(int i)
+{
+	struct process *p;    /* Owner.          */
+	struct pregion *preg; /* Process region. */
+	
+	p = frames[i].owner;
+	
+	/* Process is gone. */
+	if ((p == NULL) || (p->state == PROC_DEAD) || (p->state == PROC_ZOMBIE))
+		return (0);
+	
+	preg = findreg(p, frames[i].addr);
+	
+	return ((preg != NULL) && (preg->reg->nlocks > 0));
+}
+
+/**
+ * @brief Splits the huge page that holds a frame, if any.
+ * 
+ * @details Frames of a huge page cannot be evicted one at a time, so the huge
+ *          page is split back into regular pages first.
+ * 
+ * @param i Frame to be inspected.
+ */
+PRIVATE void splitf(int i)
+{
+	struct process *p; /* Owner. */
+	
+	p = frames[i].owner;
+	
+	/* Process is gone. */
+	if ((p == NULL) || (p->state == PROC_DEAD) || (p->state == PROC_ZOMBIE))
+		return;
+	
+	splitpgtab(p, frames[i].addr);
+}
+
+/**
+ * @brief Gets the page table entry of a neighbour of a frame.
+ * 
+ * @param i    Frame.
+ * @param addr Address of the neighbour page.
+ * 
+ * @returns If the page at @p addr in the owner of frame @p i may be swapped
+ *          out along with it, the page table entry of that page is returned.
+ *          Otherwise, NULL is returned instead.
+ */
+PRIVATE struct pte *neighbourpte(int i, addr_t addr)
+{
+	int j;             /* Frame of neighbour. */
+	struct pte *pg;    /* Neighbour page.     */
+	struct process *p; /* Owner.              */
+	
+	p = frames[i].owner;
+	
+	/* Page table not present, or huge page. */
+	if ((!getpde(p, addr)->present) || (getpde(p, addr)->huge))
+		return (NULL);
+	
+	pg = getpte(p, addr);
+	
+	/* Not in-core. */
+	if (!pg->present)
+		return (NULL);
+	
+	j = pg->frame - (UBASE_PHYS >> PAGE_SHIFT);
+	
+	/* Not a user frame. */
+	if ((j < 0) || (j >= nframes))
+		return (NULL);
+	
+	/* Shared, pinned, or recently used page. */
+	if ((frames[j].count > 1) || (frames[j].pinned) || (pg->accessed))
+		return (NULL);
+	
+	/* Not owned. */
+	if ((frames[j].owner != p) || (frames[j].addr != addr))
+		return (NULL);
+	
+	/* Locked in memory. */
+	if (lockedf(j))
+		return (NULL);
+	
+	/* May be discarded instead. */
+	if ((frames[j].mark >= 0) && (!pg->dirty))
+		return (NULL);
+	
+	return (pg);
+}
+
+/**
+ * @brief Swaps a cluster of pages out to disk.
+ * 
+ * @details Frame @p i is swapped out along with up to #SWAP_CLUSTER - 1 pages
+ *          that follow it in the address space of its owner, taking a run of
+ *          contiguous blocks in the swap space. Page contents are copied to the
+ *          block buffer cache and written asynchronously, so the pages are
+ *          released right away. Neighbour frames are put back on the free
+ *          list, whereas frame @p i is kept for the caller.
+ * 
+ *          Block buffers are obtained before any page is copied, since that
+ *          may sleep, and pages are checked again afterwards: the owner may
+ *          have changed or released them meanwhile.
+ * 
+ * @param i Frame to be swapped out.
+ * 
+ * @returns Zero upon success, and non-zero otherwise.
+ */
+PRIVATE int swap_out(int i)
+{
+	int n;                                    /* Pages in cluster.   */
+	int k;                                    /* Loop index.         */
+	unsigned j;                               /* Loop index.         */
+	unsigned e;                               /* First swap entry.   */
+	unsigned slot;                            /* First swap slot.    */
+	struct swaparea *a;                       /* Swap area.          */
+	addr_t base;                              /* First page.         */
+	struct pte *pg;                           /* Working page.       */
+	struct process *p;                        /* Owner of the pages. */
+	int nframes[SWAP_CLUSTER];                /* Frames in cluster.  */
+	buffer_t bufs[SWAP_CLUSTER][SWAP_BLOCKS]; /* Block buffers.      */
+	
+	p = frames[i].owner;
+	base = frames[i].addr;
+	
+	/* Gather cluster. */
+	nframes[0] = i;
+	for (n = 1; n < SWAP_CLUSTER; n++)
+	{
+		if ((pg = neighbourpte(i, base + n*PAGE_SIZE)) == NULL)
+			break;
+		
+		nframes[n] = pg->frame - (UBASE_PHYS >> PAGE_SHIFT);
+	}
+	
+	/* Get contiguous slots in swap space. */
+	while ((e = swap_alloc(n)) == SWAP_NULL)
+	{
+		if (--n == 0)
+			return (-1);
+	}
+	a = &swapareas[SWAP_AREA(e)];
+	slot = SWAP_SLOT(e);
+	
+	/* Store pages in the compressed swap cache. */
+	for (k = 0; k < n; k++)
+	{
+		pg = getpte(p, base + k*PAGE_SIZE);
+		
+		if (zswap_store(a, slot + k, pg->frame << PAGE_SHIFT))
+			continue;
+		
+		a->count[slot + k]++;
+		
+		/* Set page as non-present. */
+		pg->present = 0;
+		pg->frame = e + k;
+		
+		/* Release neighbour frame. */
+		if (k > 0)
+			freef(nframes[k]);
+		nframes[k] = FRAME_STORED;
+	}
+	tlb_flush_range(base, n*PAGE_SIZE);
+	
+	for (k = 0; k < n; k++)
+	{
+		if (nframes[k] >= 0)
+			frames[nframes[k]].pinned++;
+	}
+	
+	/* Get block buffers. */
+	for (k = 0; k < n; k++)
+	{
+		if (nframes[k] < 0)
+			continue;
+		
+		for (j = 0; j < SWAP_BLOCKS; j++)
+			bufs[k][j] = bget(a->dev, swap_block(a, slot + k) + j);
+	}
+	
+	/* Copy pages. */
+	for (k = 0; k < n; k++)
+	{
+		if (nframes[k] < 0)
+			continue;
+		
+		pg = mappedpte(p, base + k*PAGE_SIZE,
+			(UBASE_PHYS >> PAGE_SHIFT) + nframes[k]);
+		
+		frames[nframes[k]].pinned--;
+		
+		/* Page changed or released meanwhile. */
+		if ((pg == NULL) || (frames[nframes[k]].count > 1))
+		{
+			for (j = 0; j < SWAP_BLOCKS; j++)
+			{
+				buffer_valid(bufs[k][j], 0);
+				brelse(bufs[k][j]);
+			}
+			bitmap_clear(a->bitmap, slot + k);
+			nframes[k] = FRAME_NULL;
+			continue;
+		}
+		
+		for (j = 0; j < SWAP_BLOCKS; j++)
+		{
+			physcpy(ADDR(buffer_data(bufs[k][j])) - KBASE_VIRT,
+				(pg->frame << PAGE_SHIFT) + j*BLOCK_SIZE, BLOCK_SIZE);
+			buffer_dirty(bufs[k][j], 1);
+		}
+		a->count[slot + k]++;
+		
+		/* Set page as non-present. */
+		pg->present = 0;
+		pg->frame = e + k;
+	}
+	tlb_flush_range(base, n*PAGE_SIZE);
+	
+	/* Write pages to disk. */
+	for (k = 0; k < n; k++)
+	{
+		if (nframes[k] < 0)
+			continue;
+		
+		for (j = 0; j < SWAP_BLOCKS; j++)
+			bwrite(bufs[k][j]);
+		vmstats.swapouts++;
+		
+		/* Release neighbour frame. */
+		if (k > 0)
+			freef(nframes[k]);
+	}
+	
+	return ((nframes[0] == FRAME_NULL) ? -1 : 0);
+}
+
+/*============================================================================*
+ *                                Page Cache                                  *
+ *============================================================================*/
+
+/* Number of page cache hash chains. */
+#define PCACHE_HASHTAB_SIZE 251
+
+/* Page cache hash function. */
+#define PCACHE_HASH(ip, idx) \
+	((((unsigned)(ip) >> 4) + (idx))%PCACHE_HASHTAB_SIZE)
+
+/* Frames that may hold cached pages. */
+#define pcache_limit() \
+	((nframes < NR_KEXT) ? nframes : NR_KEXT)
+
+/* Kernel address of the page held by a frame. */
+#define pcache_data(i) \
+	((char *)(KEXT_VIRT + ((i) << PAGE_SHIFT)))
+
+/* Maximum number of pages holding delayed writes. */
+#define PCACHE_DELAY_MAX \
+	((unsigned)pcache_limit()/4)
+
+/* Does a frame hold a cached page? */
+#define pcache_cached(i) \
+	(((i) < NR_KEXT) && (pcache[(i)].inode != NULL))
+
+/**
+ * @brief Page cache.
+ * 
+ * @details Pages of regular files are cached in the lowest user frames, which
+ *          the kernel page pool extension keeps mapped in every address
+ *          space. The cache holds one reference to each of these frames, and
+ *          page tables that map the page hold the others.
+ */
+PRIVATE struct
+{
+	struct inode *inode; /**< Cached file, or NULL.        */
+	unsigned index;      /**< Page number in that file.    */
+	int busy;            /**< Is the page being filled?    */
+	int referenced;      /**< Read since the last sweep?   */
+	unsigned delayed;    /**< Blocks awaiting allocation.  */
+	int next;            /**< Next frame in the hash chain. */
+} pcache[NR_KEXT];
+
+/**
+ * @brief Page cache hash table.
+ */
+PRIVATE int pcache_hashtab[PCACHE_HASHTAB_SIZE];
+
+/**
+ * @brief Next frame to be inspected when reclaiming a low frame.
+ */
+PRIVATE int pcache_hand = 0;
+
+/**
+ * @brief Processes waiting for a page to be filled.
+ */
+PRIVATE struct waitq pcache_chain = WAITQ_INITIALIZER;
+
+/**
+ * @brief Page cache statistics.
+ */
+PRIVATE struct
+{
+	unsigned used;      /**< Cached pages.                   */
+	unsigned hits;      /**< Lookups found in the cache.     */
+	unsigned misses;    /**< Lookups not found in the cache. */
+	unsigned evictions; /**< Pages reclaimed.                */
+	unsigned waits;     /**< Sleeps waiting for a fill.      */
+	unsigned delayed;   /**< Pages holding delayed writes.   */
+} pcstats = { 0, 0, 0, 0, 0, 0 };
+
+/**
+ * @brief Searches for a page in the page cache.
+ * 
+ * @param ip    Cached file.
+ * @param index Page number in the file.
+ * 
+ * @returns If the page is cached, the frame that holds it is returned.
+ *          Otherwise, #FRAME_NULL is returned instead.
+ */
+PRIVATE int pcache_lookup(struct inode *ip, unsigned index)
+{
+	int i;
+	
+	i = pcache_hashtab[PCACHE_HASH(ip, index)];
+	for ( ; i != FRAME_NULL; i = pcache[i].next)
+	{
+		if ((pcache[i].inode == ip) && (pcache[i].index == index))
+			break;
+	}
+	
+	return (i);
+}
+
+/**
+ * @brief Inserts a frame in the page cache.
+ * 
+ * @param i     Frame.
+ * @param ip    Cached file.
+ * @param index Page number in the file.
+ */
+PRIVATE void pcache_insert(int i, struct inode *ip, unsigned index)
+{
+	unsigned h;
+	
+	h = PCACHE_HASH(ip, index);
+	
+	pcache[i].inode = ip;
+	pcache[i].index = index;
+	pcache[i].busy = 0;
+	pcache[i].referenced = 0;
+	pcache[i].delayed = 0;
+	pcache[i].next = pcache_hashtab[h];
+	pcache_hashtab[h] = i;
+	
+	ip->npages++;
+	pcstats.used++;
+}
+
+/**
+ * @brief Unlinks a frame from the page cache.
+ * 
+ * @details The frame is no longer found by lookups, but the reference that
+ *          the page cache holds is kept for the caller.
+ * 
+ * @param i Frame.
+ */
+PRIVATE void pcache_unlink(int i)
+{
+	int *p;
+	
+	p = &pcache_hashtab[PCACHE_HASH(pcache[i].inode, pcache[i].index)];
+	while (*p != i)
+		p = &pcache[*p].next;
+	*p = pcache[i].next;
+	
+	if (pcache[i].delayed)
+	{
+		pcache[i].delayed = 0;
+		pcstats.delayed--;
+	}
+	
+	pcache[i].inode->npages--;
+	pcache[i].inode = NULL;
+	pcstats.used--;
+}
+
+/**
+ * @brief Removes a frame from the page cache.
+ * 
+ * @details The reference that the page cache holds is dropped, so pages
+ *          that are still mapped live on as plain user pages.
+ * 
+ * @param i Frame.
+ */
+PRIVATE void pcache_remove(int i)
+{
+	pcache_unlink(i);
+	
+	if (--frames[i].count == 0)
+		freef(i);
+}
+
+/**
+ * @brief Attempts to reclaim a page cache frame.
+ * 
+ * @details A second chance is given to pages that have been read, or
+ *          accessed through a mapping, since the last sweep. A page mapped
+ *          by a single process is unmapped, and marked to be filled back
+ *          from the cache. Pages mapped more than once are kept, and so
+ *          are pages that hold delayed writes, since they are the only copy
+ *          of that data.
+ * 
+ * @param i Frame, which shall hold a cached page and not be pinned.
+ * 
+ * @returns If the frame is reclaimed, zero is returned, and the frame is
+ *          left with the single reference that the cache used to hold.
+ *          Otherwise, non-zero is returned instead.
+ */
+PRIVATE int pcache_reclaim(int i)
+{
+	struct pte *pg; /* Mapping of the page. */
+	
+	/* Awaiting write back. */
+	if (pcache[i].delayed)
+		return (-1);
+	
+	/* Mapped by a single process. */
+	if (frames[i].count == 2)
+	{
+		if ((pg = framepte(i)) == NULL)
+			return (-1);
+		
+		/* Give a second chance. */
+		if (pg->accessed)
+		{
+			pg->accessed = 0;
+			tlb_flush_page(frames[i].addr);
+			return (-1);
+		}
+		
+		kmemset(pg, 0, sizeof(struct pte));
+		markpg(pg, PAGE_FILL);
+		tlb_flush_page(frames[i].addr);
+		frames[i].count--;
+		frames[i].owner = NULL;
+	}
+	
+	/* Shared page. */
+	else if (frames[i].count > 1)
+		return (-1);
+	
+	/* Give a second chance. */
+	else if (pcache[i].referenced)
+	{
+		pcache[i].referenced = 0;
+		return (-1);
+	}
+	
+	pcache_unlink(i);
+	pcstats.evictions++;
+	
+	return (0);
+}
+
+/**
+ * @brief Takes a low frame.
+ * 
+ * @details Low frames are mapped by the kernel page pool extension. A free
+ *          one is taken if possible, and otherwise a page cache frame is
+ *          reclaimed with a second chance (CLOCK) policy of its own.
+ * 
+ * @returns Upon success, the number of a frame that is neither free nor in
+ *          the list of frames in use is returned. Upon failure, a negative
+ *          number is returned instead.
+ */
+PRIVATE int lowf(void)
+{
+	int i;    /* Working frame.    */
+	int n;    /* Frames inspected. */
+	int prev; /* Previous frame.   */
+	
+	/* Search for a low free frame. */
+	for (prev = FRAME_NULL, i = free_frames; i != FRAME_NULL; i = frames[i].next)
+	{
+		if (i < NR_KEXT)
+			break;
+		prev = i;
+	}
+	
+	if (i != FRAME_NULL)
+	{
+		/* Unlink frame. */
+		if (prev == FRAME_NULL)
+			free_frames = frames[i].next;
+		else
+			frames[prev].next = frames[i].next;
+		
+		return (i);
+	}
+	
+	/* Reclaim a page cache frame. */
+	for (n = 0; n < 2*pcache_limit(); n++)
+	{
+		i = pcache_hand;
+		pcache_hand = (pcache_hand + 1)%pcache_limit();
+		
+		if ((!pcache_cached(i)) || (frames[i].pinned) || (lockedf(i)))
+			continue;
+		
+		if (pcache_reclaim(i))
+			continue;
+		
+		used_remove(i);
+		return (i);
+	}
+	
+	return (-1);
+}
+
+/**
+ * @brief Gets a page from the page cache.
+ * 
+ * @details Looks up the page, and fills it from the file upon a miss. Waits
+ *          for pages that are being filled by someone else.
+ * 
+ * @param ip    Cached file.
+ * @param index Page number in the file.
+ * @param ra    Blocks to be read ahead past the page upon a miss.
+ * 
+ * @returns Upon success, the (pinned) frame that holds the page is returned.
+ *          If no frame is available, #FRAME_NULL is returned instead.
+ * 
+ * @note The inode must be locked.
+ */
+PRIVATE int pcache_page(struct inode *ip, unsigned index, unsigned ra)
+{
+	int i; /* Frame. */
+	
+again:
+
+	/* Cached page. */
+	if ((i = pcache_lookup(ip, index)) != FRAME_NULL)
+	{
+		/* Being filled. */
+		if (pcache[i].busy)
+		{
+			pcstats.waits++;
+			sleep(&pcache_chain, PRIO_IO);
+			goto again;
+		}
+		
+		pcstats.hits++;
+		pcache[i].referenced = 1;
+		frames[i].pinned++;
+		
+		return (i);
+	}
+	
+	pcstats.misses++;
+	
+	if ((i = lowf()) < 0)
+		return (FRAME_NULL);
+	
+	frames[i].age = ticks;
+	frames[i].count = 1;
+	frames[i].owner = NULL;
+	frames[i].pinned = 1;
+	frames[i].mark = -1;
+	used_append(i);
+	
+	/* Fill page. */
+	pcache_insert(i, ip, index);
+	pcache[i].busy = 1;
+	file_fillpg(ip, pcache_data(i), (off_t)index << PAGE_SHIFT, ra);
+	pcache[i].busy = 0;
+	wakeup(&pcache_chain);
+	
+	return (i);
+}
+
+/**
+ * @brief Gets a page of a file.
+ * 
+ * @param ip    File.
+ * @param index Page number in the file.
+ * @param ra    Blocks to be read ahead past the page upon a miss.
+ * 
+ * @returns Upon success, a pointer to the page is returned, and the page
+ *          stays in memory until it is released with pcache_put(). If no
+ *          page is available, a NULL pointer is returned instead.
+ * 
+ * @note The inode must be locked.
+ */
+PUBLIC void *pcache_get(struct inode *ip, unsigned index, unsigned ra)
+{
+	int i;
+	
+	if ((i = pcache_page(ip, index, ra)) == FRAME_NULL)
+		return (NULL);
+	
+	return (pcache_data(i));
+}
+
+/**
+ * @brief Releases a page of a file.
+ * 
+ * @param pg Page, as returned by pcache_get().
+ */
+PUBLIC void pcache_put(void *pg)
+{
+	frames[(ADDR(pg) - KEXT_VIRT) >> PAGE_SHIFT].pinned--;
+}
+
+/**
+ * @brief Writes data through to a cached page.
+ * 
+ * @details Block buffers remain the authoritative copy of file data, and
+ *          cached pages are updated as buffers are written.
+ * 
+ * @param ip  File.
+ * @param off File offset.
+ * @param buf Data.
+ * @param n   Number of bytes, which shall not cross a page boundary.
+ * 
+ * @note The inode must be locked exclusively.
+ */
+PUBLIC void pcache_write(struct inode *ip, off_t off, const void *buf, size_t n)
+{
+	int i;
+	
+	if (ip->npages == 0)
+		return;
+	
+	if ((i = pcache_lookup(ip, off >> PAGE_SHIFT)) == FRAME_NULL)
+		return;
+	
+	frames[i].pinned++;
+	kmemcpy(pcache_data(i) + (off & ~PAGE_MASK), buf, n);
+	frames[i].pinned--;
+}
+
+/**
+ * @brief Writes data to a page whose block is not allocated yet.
+ * 
+ * @details The data is stored in the cached page only, and the block that
+ *          holds @p off is marked as delayed, so that a disk block is
+ *          assigned to it when the file is flushed with file_flush(). This
+ *          keeps the page in the cache until then.
+ * 
+ * @param ip  File.
+ * @param off File offset.
+ * @param buf Data.
+ * @param n   Number of bytes, which shall not cross a block boundary.
+ * 
+ * @returns If the block is newly marked as delayed, one is returned. If it
+ *          was already delayed, zero is returned. If no page is available,
+ *          a negative number is returned instead, and nothing is written.
+ * 
+ * @note The inode must be locked exclusively.
+ */
+PUBLIC int pcache_delay(struct inode *ip, off_t off, const void *buf, size_t n)
+{
+	int i;        /* Frame.            */
+	int ret;      /* Return value.     */
+	unsigned bit; /* Bit of the block. */
+	
+	bit = 1 << ((off & ~PAGE_MASK)/BLOCK_SIZE);
+	
+	/* Too many pages hold delayed writes. */
+	i = pcache_lookup(ip, off >> PAGE_SHIFT);
+	if (((i == FRAME_NULL) || (!pcache[i].delayed)) &&
+		(pcstats.delayed >= PCACHE_DELAY_MAX))
+		return (-1);
+	
+	if ((i = pcache_page(ip, off >> PAGE_SHIFT, 0)) == FRAME_NULL)
+		return (-1);
+	
+	/* Checked again, since filling the page sleeps. */
+	if ((!pcache[i].delayed) && (pcstats.delayed >= PCACHE_DELAY_MAX))
+	{
+		frames[i].pinned--;
+		return (-1);
+	}
+	
+	kmemcpy(pcache_data(i) + (off & ~PAGE_MASK), buf, n);
+	
+	ret = 0;
+	if (!(pcache[i].delayed & bit))
+	{
+		if (pcache[i].delayed == 0)
+			pcstats.delayed++;
+		pcache[i].delayed |= bit;
+		ret = 1;
+	}
+	
+	frames[i].pinned--;
+	
+	return (ret);
+}
+
+/**
+ * @brief Takes the delayed writes of a page.
+ * 
+ * @param ip    File.
+ * @param index Page number in the file.
+ * @param mask  Location where the mask of delayed blocks shall be stored.
+ * 
+ * @returns If the page holds delayed writes, a pointer to it is returned,
+ *          its blocks are no longer marked as delayed, and the page stays in
+ *          memory until it is released with pcache_put(). Otherwise, a NULL
+ *          pointer is returned instead.
+ * 
+ * @note The inode must be locked exclusively.
+ */
+PUBLIC void *pcache_undelay(struct inode *ip, unsigned index, unsigned *mask)
+{
+	int i;
+	
+	if (ip->npages == 0)
+		return (NULL);
+	
+	if ((i = pcache_lookup(ip, index)) == FRAME_NULL)
+		return (NULL);
+	
+	if (!pcache[i].delayed)
+		return (NULL);
+	
+	*mask = pcache[i].delayed;
+	pcache[i].delayed = 0;
+	pcstats.delayed--;
+	frames[i].pinned++;
+	
+	return (pcache_data(i));
+}
+
+/**
+ * @brief Removes all pages of a file from the page cache.
+ * 
+ * @details Delayed writes are discarded along with the pages.
+ * 
+ * @param ip File.
+ * 
+ * @note The inode must be locked.
+ */
+PUBLIC void pcache_purge(struct inode *ip)
+{
+	for (int i = 0; (ip->npages > 0) && (i < pcache_limit()); i++)
+	{
+		if (pcache[i].inode == ip)
+			pcache_remove(i);
+	}
+}
+
+/**
+ * @brief Drops pages of a file that are not in use from the page cache.
+ * 
+ * @param ip    File.
+ * @param first First page number in the file.
+ * @param last  Last page number in the file.
+ * 
+ * @note The inode must be locked.
+ */
+PUBLIC void pcache_forget(struct inode *ip, unsigned first, unsigned last)
+{
+	for (int i = 0; (ip->npages > 0) && (i < pcache_limit()); i++)
+	{
+		if ((!pcache_cached(i)) || (pcache[i].inode != ip))
+			continue;
+		
+		if ((pcache[i].index < first) || (pcache[i].index > last))
+			continue;
+		
+		if ((frames[i].pinned) || (pcache[i].delayed))
+			continue;
+		
+		if (frames[i].count == 1)
+			pcache_remove(i);
+	}
+}
+
+/**
+ * @brief Drops pages that are not in use from the page cache.
+ */
+PUBLIC void pcache_drop(void)
+{
+	for (int i = 0; i < pcache_limit(); i++)
+	{
+		if ((!pcache_cached(i)) || (frames[i].pinned) || (pcache[i].delayed))
+			continue;
+		
+		if (frames[i].count == 1)
+			pcache_remove(i);
+	}
+}
+
+/**
+ * @brief Gets page cache statistics.
+ * 
+ * @param buf Location where statistics shall be stored.
+ */
+PUBLIC void pcache_stat(struct cachestat *buf)
+{
+	kmemset(buf, 0, sizeof(struct cachestat));
+	buf->size = pcache_limit();
+	buf->used = pcstats.used;
+	buf->hits = pcstats.hits;
+	buf->misses = pcstats.misses;
+	buf->evictions = pcstats.evictions;
+	buf->waits = pcstats.waits;
+}
+
+/**
+ * @brief Allocates a page frame.
+ * 
+ * @details Free frames are taken straight from the free list. When there is
+ *          none, a global second chance (CLOCK) policy is applied: frames in
+ *          use are taken from the head of the list, and moved to its tail.
+ *          Shared, pinned, locked and ownerless frames are skipped, and frames
+ *          whose page has been accessed get their accessed bit cleared. The
+ *          first frame that passes is evicted. Clean pages that can be demand
+ *          filled or zeroed are simply discarded, while other pages are
+ *          swapped out. Page cache frames are reclaimed along the same sweep,
+ *          so that file data competes with anonymous memory on equal terms.
+ * 
+ * @returns Upon success, the number of the frame is returned. Upon failure, a
+ *          negative number is returned instead.
+ */
+PRIVATE int allocf(void)
+{
+	int i;          /* Frame index.      */
+	int n;          /* Frames inspected. */
+	struct pte *pg; /* Page of frame.    */
+	
+again:
+
+	/* Take a free frame. */
+	if ((i = free_frames) != FRAME_NULL)
+	{
+		free_frames = frames[i].next;
+		goto found;
+	}
+	
+	/* Make room for pages to be swapped out. */
+	zswap_shrink();
+	
+	/* Sweep frames in use. */
+	for (n = 0; n < 2*nframes; n++)
+	{
+		/* No frame in use. */
+		if ((i = used_frames.head) == FRAME_NULL)
+			break;
+		
+		used_remove(i);
+		used_append(i);
+		
+		/* Skip pinned and locked pages. */
+		if ((frames[i].pinned) || (lockedf(i)))
+			continue;
+		
+		/* Reclaim page cache page. */
+		if (pcache_cached(i))
+		{
+			if (pcache_reclaim(i))
+				continue;
+			
+			used_remove(i);
+			goto found;
+		}
+		
+		/* Skip shared pages. */
+		if (frames[i].count > 1)
+			continue;
+		
+		splitf(i);
+		
+		if ((pg = framepte(i)) == NULL)
+			continue;
+		
+		/* Give a second chance. */
+		if (pg->accessed)
+		{
+			pg->accessed = 0;
+			tlb_flush_page(frames[i].addr);
+			continue;
+		}
+		
+		goto evict;
+	}
+	
+	/* Release cached text. */
+	if (!shrinktext())
+		goto again;
+	
+	/* No frame left. */
+	return (-1);
+
+evict:
+	
+	/* Discard clean page. */
+	if ((frames[i].mark >= 0) && (!pg->dirty))
+	{
+		kmemset(pg, 0, sizeof(struct pte));
+		markpg(pg, frames[i].mark);
+		tlb_flush_page(frames[i].addr);
+	}
+	
+	/* Swap page out. */
+	else if (swap_out(i))
+	{
+		/* Frames may have been released meanwhile. */
+		if (free_frames != FRAME_NULL)
+			goto again;
+		return (-1);
+	}
+	
+	used_remove(i);
+	
+found:		
+
+	frames[i].age = ticks;
+	frames[i].count = 1;
+	frames[i].owner = NULL;
+	frames[i].mark = -1;
+	used_append(i);
+	
+	return (i);
+}
+
+#if (LOADCTL)
+
+/*
+ * Load control sampling period (in ticks).
+ */
+#define LOADCTL_PERIOD CLOCK_FREQ
+
+/*
+ * Swap ins per period under which suspended processes are resumed.
+ */
+#define LOADCTL_LOW (LOADCTL_SWAPINS/4)
+
+/*
+ * Longest suspension (in periods).
+ */
+#define LOADCTL_HOLD 10
+
+/**
+ * @brief Load controller.
+ * 
+ * @details When processes demand more memory than there is, they steal
+ *          frames from each other and the system spends its time swapping.
+ *          The load controller samples the swap in rate and the working sets
+ *          of processes, and when the former gets high while the combined
+ *          working sets do not fit in memory, it suspends a low priority
+ *          process. A suspended process does not reference its pages, so
+ *          they are the first ones to be swapped out. Suspended processes
+ *          are resumed, oldest first, once their working sets fit again, or
+ *          after #LOADCTL_HOLD periods, so that none of them starves.
+ */
+PRIVATE struct
+{
+	struct timer timer;  /**< Sampling timer.           */
+	struct work work;    /**< Sampling work.            */
+	unsigned swapins;    /**< Swap ins at last sample.  */
+	unsigned nsuspended; /**< Suspended processes.      */
+} loadctl;
+
+/**
+ * @brief Estimates the working set of a process.
+ * 
+ * @details Pages referenced since the last sample are counted, and their
+ *          accessed bits are cleared for the next one. Pages brought in
+ *          from disk meanwhile are counted as well, since the process may
+ *          have lost them again to other processes.
+ * 
+ * @param proc Process.
+ * 
+ * @returns The working set size of @p proc (in pages).
+ * 
+ * @note @p proc shall not be the current process.
+ */
+PRIVATE unsigned wsestimate(struct process *proc)
+{
+	unsigned i, j, k;     /* Loop indexes.            */
+	unsigned n;           /* Referenced pages.        */
+	addr_t addr;          /* Page table address.      */
+	struct pde *pde;      /* Page directory entry.    */
+	struct pte *pgtab;    /* Working page table.      */
+	struct pregion *preg; /* Working process region.  */
+	
+	n = proc->majflt - proc->wsflt;
+	proc->wsflt = proc->majflt;
+	
+	for (i = 0; i < NR_PREGIONS; i++)
+	{
+		preg = &proc->pregs[i];
+		
+		if (preg->reg == NULL)
+			continue;
+		
+		for (j = 0; j < REGION_PGTABS; j++)
+		{
+			if ((pgtab = preg->reg->pgtab[j]) == NULL)
+				continue;
+			
+			addr = (preg->reg->flags & REGION_DOWNWARDS) ?
+				preg->start - (REGION_PGTABS - 1 - j)*PGTAB_SIZE :
+				preg->start + j*PGTAB_SIZE;
+			pde = getpde(proc, addr);
+			
+			/* Huge pages are referenced as a whole. */
+			if ((pde->present) && (pde->huge))
+			{
+				if (pde->accessed)
+				{
+					pde->accessed = 0;
+					n += HUGE_FRAMES;
+				}
+				continue;
+			}
+			
+			for (k = 0; k < PAGE_SIZE/PTE_SIZE; k++)
+			{
+				if ((pgtab[k].present) && (pgtab[k].accessed))
+				{
+					pgtab[k].accessed = 0;
+					n++;
+				}
+			}
+		}
+	}
+	
+	return (n);
+}
+
+/**
+ * @brief Samples memory load and suspends or resumes processes.
+ * 
+ * @param arg Unused.
+ */
+PRIVATE void loadctl_sample(void *arg)
+{
+	unsigned rate;          /* Swap ins in the last period.  */
+	unsigned demand;        /* Working sets of active ones.  */
+	unsigned nactive;       /* Active processes.             */
+	struct process *p;      /* Working process.              */
+	struct process *victim; /* Process to be suspended.      */
+	struct process *oldest; /* Longest suspended process.    */
+	
+	UNUSED(arg);
+	
+	rate = vmstats.swapins - loadctl.swapins;
+	loadctl.swapins = vmstats.swapins;
+	
+	demand = 0;
+	nactive = 0;
+	victim = NULL;
+	oldest = NULL;
+	loadctl.nsuspended = 0;
+	for (p = FIRST_PROC; p <= LAST_PROC; p++)
+	{
+		/* Not a user process. */
+		if ((!IS_VALID(p)) || (p->state == PROC_ZOMBIE) || (p->npregs == 0))
+			continue;
+		
+		/* Suspended. */
+		if (p->flags & (1 << PROC_SUSPEND))
+		{
+			loadctl.nsuspended++;
+			if ((oldest == NULL) || ((int)(p->wsusp - oldest->wsusp) < 0))
+				oldest = p;
+			continue;
+		}
+		
+		p->wss = wsestimate(p);
+		demand += p->wss;
+		nactive++;
+		
+		/* Neither init, real-time nor locked processes are suspended. */
+		if ((p == INIT) || (p->policy != SCHED_OTHER) || (lockedreg(p) > 0))
+			continue;
+		
+		/* Lowest priority first, then largest working set. */
+		if ((victim == NULL) || (p->nice > victim->nice) ||
+			((p->nice == victim->nice) && (p->wss > victim->wss)))
+			victim = p;
+	}
+	
+	/* Suspended for too long, take turns. */
+	if ((oldest != NULL) && (ticks - oldest->wsusp >= LOADCTL_HOLD*LOADCTL_PERIOD))
+		goto resume;
+	
+	/* Overcommitted memory. */
+	if ((rate >= LOADCTL_SWAPINS) && (demand > (unsigned)nframes))
+	{
+		/* Keep someone running. */
+		if ((victim == NULL) || (nactive < 2))
+			return;
+		
+		victim->wsusp = ticks;
+		sched_suspend(victim);
+		loadctl.nsuspended++;
+		kprintf(KERN_INFO "mm: suspending process %d", victim->pid);
+		return;
+	}
+	
+	/* Working set of the oldest suspended process does not fit yet. */
+	if ((oldest == NULL) || (rate >= LOADCTL_LOW))
+		return;
+	if (demand + oldest->wss > (unsigned)nframes)
+		return;
+
+resume:
+	sched_unsuspend(oldest);
+	loadctl.nsuspended--;
+}
+
+/**
+ * @brief Schedules the next load control sample.
+ * 
+ * @param arg Unused.
+ */
+PRIVATE void loadctl_tick(void *arg)
+{
+	UNUSED(arg);
+	
+	work_queue(&loadctl.work);
+	timer_add(&loadctl.timer, ticks + LOADCTL_PERIOD);
+}
+
+#endif
+
+#if (PGMERGE)
+
+/*
+ * Same-page merging scanning period (in ticks).
+ */
+#define PGMERGE_PERIOD CLOCK_FREQ
+
+/*
+ * Number of slots in the table of merge candidates.
+ */
+#define PGMERGE_SLOTS 256
+
+/**
+ * @brief Same-page merger.
+ * 
+ * @details Forked processes often end up with byte-identical private pages
+ *          once copy on write has broken their sharing. The merger sweeps
+ *          the frame table, at most #PGMERGE_PAGES pages per period, and
+ *          checksums private anonymous pages. Candidates are remembered in
+ *          a small table indexed by checksum and, when a later page matches
+ *          one of them byte for byte, both page table entries are pointed
+ *          at a single frame and made copy on write, just like fork() does.
+ *          Pages of zeros are merged into the shared zero frame. A write to
+ *          a merged page is a regular copy on write fault, so pfault()
+ *          breaks the sharing again.
+ */
+PRIVATE struct
+{
+	struct timer timer; /**< Scanning timer.            */
+	struct work work;   /**< Scanning work.             */
+	int hand;           /**< Next frame to be scanned.  */
+	unsigned zsum;      /**< Checksum of a zero page.   */
+	void *pg1;          /**< Copy of the scanned page.  */
+	void *pg2;          /**< Copy of the candidate.     */
+	struct
+	{
+		int frame;      /**< Frame, or #FRAME_NULL.     */
+		unsigned sum;   /**< Checksum of its contents.  */
+		int stable;     /**< Is the frame merged?       */
+	} slots[PGMERGE_SLOTS];
+} pgmerge;
+
+/**
+ * @brief Checksums a page.
+ * 
+ * @param pg Page to be checksummed.
+ * 
+ * @returns The FNV-1a checksum of the words of @p pg.
+ */
+PRIVATE unsigned pgmerge_sum(const void *pg)
+{
+	unsigned i;       /* Loop index.   */
+	unsigned sum;     /* Checksum.     */
+	const dword_t *p; /* Working word. */
+	
+	p = pg;
+	sum = 2166136261u;
+	for (i = 0; i < PAGE_SIZE/sizeof(dword_t); i++)
+		sum = (sum ^ p[i])*16777619u;
+	
+	return (sum);
+}
+
+/**
+ * @brief Asserts if two pages are identical.
  * 
- * @param clean Should the page be cleaned?
+ * @param pg1 First page.
+ * @param pg2 Second page, or NULL for a page of zeros.
  * 
- * @returns Upon success, a pointer to a page is returned. Upon failure, a NULL
- *          pointer is returned instead.
+ * @returns Non-zero if the pages are identical, and zero otherwise.
  */
-PUBLIC void *getkpg(int clean)
+PRIVATE int pgmerge_same(const void *pg1, const void *pg2)
 {
-	unsigned i; /* Loop index.  */
-	void *kpg;  /* Kernel page. */
+	unsigned i;        /* Loop index.  */
+	const dword_t *p1; /* First page.  */
+	const dword_t *p2; /* Second page. */
 	
-	/* Search for a free kernel page. */
-	for (i = 0; i < NR_KPAGES; i++)
+	p1 = pg1;
+	p2 = pg2;
+	for (i = 0; i < PAGE_SIZE/sizeof(dword_t); i++)
 	{
-		/* Found it. */
-		if (kpages[i] == 0)
-			goto found;
+		if (p1[i] != ((p2 != NULL) ? p2[i] : 0))
+			return (0);
 	}
-
-	kprintf("mm: kernel page pool overflow");
 	
-	return (NULL);
-
-found:
+	return (1);
+}
 
-	/* Set page as used. */
-	kpg = (void *)(KPOOL_VIRT + (i << PAGE_SHIFT));
-	kpages[i]++;
+/**
+ * @brief Gets the page table entry of a frame that may be merged.
+ * 
+ * @param i Frame to be inspected.
+ * 
+ * @returns If the frame holds a private, unpinned page of an anonymous region
+ *          that nobody is working on, the page table entry that maps it is
+ *          returned. Otherwise, NULL is returned instead.
+ */
+PRIVATE struct pte *pgmerge_pte(int i)
+{
+	struct pte *pg;       /* Mapping of the frame. */
+	struct pregion *preg; /* Process region.       */
 	
-	/* Clean page. */
-	if (clean)
-		kmemset(kpg, 0, PAGE_SIZE);
+	/* Shared, pinned or cached frame. */
+	if ((frames[i].count != 1) || (frames[i].pinned) || (i == zero_frame))
+		return (NULL);
+	if ((i < NR_KEXT) && (pcache[i].inode != NULL))
+		return (NULL);
 	
-	return (kpg);
+	if ((pg = framepte(i)) == NULL)
+		return (NULL);
+	
+	preg = findreg(frames[i].owner, frames[i].addr);
+	
+	/* Shared, file backed, busy or locked region. */
+	if ((preg == NULL) || (preg->reg->nlocks > 0))
+		return (NULL);
+	if (preg->reg->flags & (REGION_SHARED | REGION_MMAP | REGION_LOCKED))
+		return (NULL);
+	
+	return (pg);
 }
 
 /**
- * @brief Releases kernel page.
+ * @brief Merges a page into a frame.
  * 
- * @param kpg Kernel page to be released.
+ * @param pg Page to be merged.
+ * @param i  Frame that holds a copy of the page.
+ * 
+ * @note The page is mapped in another address space, so the caller needs not
+ *       flush the TLB.
  */
-PUBLIC void putkpg(void *kpg)
+PRIVATE void pgmerge_link(struct pte *pg, int i)
 {
-	unsigned i;
+	int j; /* Frame of the page. */
 	
-	i = ((addr_t)kpg - KPOOL_VIRT) >> PAGE_SHIFT;
+	j = pg->frame - (UBASE_PHYS >> PAGE_SHIFT);
 	
-	/* Release page. */
-	kpages[i]--;
+	/* Set copy on write. */
+	if (pg->writable)
+	{
+		pg->writable = 0;
+		pg->cow = 1;
+	}
 	
-	/* Double free. */
-	if (kpages[i] < 0)
-		kpanic("mm: releasing kernel page twice");
+	frames[i].count++;
+	pg->frame = (UBASE_PHYS >> PAGE_SHIFT) + i;
+	freef(j);
+	vmstats.merged++;
 }
 
-/*============================================================================*
- *                              Paging System                                 *
- *============================================================================*/
+/**
+ * @brief Scans some pages for identical ones and merges them.
+ * 
+ * @param arg Unused.
+ */
+PRIVATE void pgmerge_scan(void *arg)
+{
+	int i, j;       /* Frame indexes.            */
+	int n;          /* Frames inspected.         */
+	int scanned;    /* Pages checksummed.        */
+	unsigned k;     /* Candidate slot.           */
+	unsigned sum;   /* Checksum of scanned page. */
+	struct pte *pg; /* Scanned page.             */
+	struct pte *cg; /* Candidate page.           */
+	
+	UNUSED(arg);
+	
+	scanned = 0;
+	for (n = 0; (n < nframes) && (scanned < PGMERGE_PAGES); n++)
+	{
+		i = pgmerge.hand;
+		pgmerge.hand = (pgmerge.hand + 1)%nframes;
+		
+		if ((pg = pgmerge_pte(i)) == NULL)
+			continue;
+		
+		physcpy(ADDR(pgmerge.pg1) - KBASE_VIRT, UBASE_PHYS + (i << PAGE_SHIFT),
+			PAGE_SIZE);
+		sum = pgmerge_sum(pgmerge.pg1);
+		vmstats.scanned++;
+		scanned++;
+		
+		/* Page of zeros. */
+		if ((sum == pgmerge.zsum) && (pgmerge_same(pgmerge.pg1, NULL)))
+		{
+			pgmerge_link(pg, zero_frame);
+			continue;
+		}
+		
+		k = sum%PGMERGE_SLOTS;
+		j = pgmerge.slots[k].frame;
+		
+		/* No candidate yet. */
+		if ((j == FRAME_NULL) || (j == i) || (pgmerge.slots[k].sum != sum))
+			goto candidate;
+		
+		/*
+		 * A merged frame is write protected wherever it
+		 * is mapped, but a private candidate has to be
+		 * checked and write protected first.
+		 */
+		cg = NULL;
+		if (frames[j].count > 1)
+		{
+			if ((!pgmerge.slots[k].stable) || (frames[j].pinned))
+				goto candidate;
+			if ((j < NR_KEXT) && (pcache[j].inode != NULL))
+				goto candidate;
+		}
+		else if ((cg = pgmerge_pte(j)) == NULL)
+			goto candidate;
+		
+		/* Candidate has changed. */
+		physcpy(ADDR(pgmerge.pg2) - KBASE_VIRT, UBASE_PHYS + (j << PAGE_SHIFT),
+			PAGE_SIZE);
+		if (!pgmerge_same(pgmerge.pg1, pgmerge.pg2))
+			goto candidate;
+		
+		if ((cg != NULL) && (cg->writable))
+		{
+			cg->writable = 0;
+			cg->cow = 1;
+		}
+		
+		pgmerge_link(pg, j);
+		pgmerge.slots[k].stable = 1;
+		continue;
 
-/* Number of page frames. */
-#define NR_FRAMES (UMEM_SIZE/PAGE_SIZE)
+candidate:
+		pgmerge.slots[k].frame = i;
+		pgmerge.slots[k].sum = sum;
+		pgmerge.slots[k].stable = 0;
+	}
+}
 
 /**
- * @brief Page frames.
+ * @brief Schedules the next same-page merging scan.
+ * 
+ * @param arg Unused.
  */
-PRIVATE struct
+PRIVATE void pgmerge_tick(void *arg)
 {
-	unsigned count; /**< Reference count.     */
-	unsigned age;   /**< Age.                 */
-	pid_t owner;    /**< Page owner.          */
-	addr_t addr;    /**< Address of the page. */
-} frames[NR_FRAMES] = {{0, 0, 0, 0},  };
+	UNUSED(arg);
+	
+	work_queue(&pgmerge.work);
+	timer_add(&pgmerge.timer, ticks + PGMERGE_PERIOD);
+}
+
+#endif
 
 /**
- * @brief Allocates a page frame.
- * 
- * @returns Upon success, the number of the frame is returned. Upon failure, a
- *          negative number is returned instead.
+ * @brief Initializes the paging system.
  */
-PRIVATE int allocf(void)
+PUBLIC void initpg(void)
 {
-	int i;      /* Loop index.  */
-	int oldest; /* Oldest page. */
+	int i;       /* Loop index.       */
+	void *kpg;   /* Clean page.       */
+	dword_t cr4; /* Control register. */
 	
-	#define OLDEST(x, y) (frames[x].age < frames[y].age)
+	nframes = (mem_size - UBASE_PHYS)/PAGE_SIZE;
 	
-	/* Search for a free frame. */
-	oldest = -1;
-	for (i = 0; i < NR_FRAMES; i++)
+	/* 4 MB pages are enabled at boot, if supported. */
+	__asm__ volatile ("movl %%cr4, %0" : "=r" (cr4));
+	pse = (cr4 & CR4_PSE) ? 1 : 0;
+	
+	/*
+	 * Build list of free frames. High frames
+	 * come first, leaving low frames, which the
+	 * kernel can reach, to the page cache.
+	 */
+	for (i = 0; i < nframes; i++)
 	{
-		/* Found it. */
-		if (frames[i].count == 0)
-			goto found;
-		
-		/* Local page replacement policy. */
-		if (frames[i].owner == curr_proc->pid)
-		{
-			/* Skip shared pages. */
-			if (frames[i].count > 1)
-				continue;
-			
-			/* Oldest page found. */
-			if ((oldest < 0) || (OLDEST(i, oldest)))
-				oldest = i;
-		}
+		frames[i].next = free_frames;
+		free_frames = i;
 	}
 	
-	/* No frame left. */
-	if (oldest < 0)
-		return (-1);
+	for (i = 0; i < PCACHE_HASHTAB_SIZE; i++)
+		pcache_hashtab[i] = FRAME_NULL;
+	
+	/* Set up shared zero frame. */
+	zero_frame = free_frames;
+	free_frames = frames[zero_frame].next;
+	frames[zero_frame].count = 1;
+	frames[zero_frame].pinned = 1;
+	frames[zero_frame].mark = -1;
+	if ((kpg = getkpg(1)) == NULL)
+		kpanic("mm: cannot set up zero frame");
+	physcpy(UBASE_PHYS + (zero_frame << PAGE_SHIFT), ADDR(kpg) - KBASE_VIRT,
+		PAGE_SIZE);
+#if (PGMERGE)
+	pgmerge.zsum = pgmerge_sum(kpg);
+#endif
+	putkpg(kpg);
 	
-	/* Swap page out. */
-	if (swap_out(curr_proc, frames[i = oldest].addr))
-		return (-1);
+	zswap_init();
 	
-found:		
+	/* Default swap area. */
+	swapareas[0].dev = SWAP_DEV;
+	swapareas[0].off = SWAP_OFF;
+	swapareas[0].nslots = SWAP_SLOTS;
+	swapareas[0].prio = -1;
+	
+#if (LOADCTL)
+	work_init(&loadctl.work, loadctl_sample, NULL);
+	timer_init(&loadctl.timer, loadctl_tick, NULL);
+	timer_add(&loadctl.timer, ticks + LOADCTL_PERIOD);
+#endif
 
-	frames[i].age = ticks;
-	frames[i].count = 1;
+#if (PGMERGE)
+	if ((pgmerge.pg1 = getkpg(0)) == NULL)
+		kpanic("mm: cannot set up page merging");
+	if ((pgmerge.pg2 = getkpg(0)) == NULL)
+		kpanic("mm: cannot set up page merging");
+	for (i = 0; i < PGMERGE_SLOTS; i++)
+		pgmerge.slots[i].frame = FRAME_NULL;
+	work_init(&pgmerge.work, pgmerge_scan, NULL);
+	timer_init(&pgmerge.timer, pgmerge_tick, NULL);
+	timer_add(&pgmerge.timer, ticks + PGMERGE_PERIOD);
+#endif
 	
-	return (i);
+	maptimepg();
 }
 
 /**
@@ -382,7 +2751,7 @@ PRIVATE int allocupg(addr_t addr, int writable)
 		return (-1);
 	
 	/* Initialize page frame. */
-	frames[i].owner = curr_proc->pid;
+	frames[i].owner = curr_proc;
 	frames[i].addr = addr & PAGE_MASK;
 	
 	/* Allocate page. */
@@ -392,7 +2761,171 @@ PRIVATE int allocupg(addr_t addr, int writable)
 	pg->writable = (writable) ? 1 : 0;
 	pg->user = 1;
 	pg->frame = (UBASE_PHYS >> PAGE_SHIFT) + i;
-	tlb_flush();
+	tlb_flush_page(addr);
+	
+	return (0);
+}
+
+/**
+ * @brief Allocates a huge user page.
+ * 
+ * @details The page table at @p addr is backed by a single 4 MB page, if the
+ *          region asks for it, if none of its pages has been touched yet, and
+ *          if there is a run of free frames that is suitably aligned. Page
+ *          table entries are still filled in, so that the huge page may be
+ *          split back into regular pages at any time (see splitpgtab()).
+ * 
+ * @param preg Process region where the page resides.
+ * @param addr Address where the page resides.
+ * 
+ * @returns Zero upon successful completion, and non-zero otherwise.
+ */
+PRIVATE int allochuge(struct pregion *preg, addr_t addr)
+{
+	int i, j;           /* Frame indexes.        */
+	int prev;           /* Previous free frame.  */
+	unsigned k;         /* Loop index.           */
+	struct pde *pde;    /* Page directory entry. */
+	struct pte *pgtab;  /* Working page table.   */
+	struct region *reg; /* Working region.       */
+	
+	reg = preg->reg;
+	
+	/* Huge pages not supported, or not wanted. */
+	if ((!pse) || (!(reg->flags & REGION_HUGE)))
+		return (-1);
+	
+	/* Only private anonymous memory that grows upwards. */
+	if (reg->flags & (REGION_SHARED | REGION_DOWNWARDS | REGION_MMAP))
+		return (-1);
+	if (!(reg->mode & MAY_WRITE))
+		return (-1);
+	
+	pgtab = reg->pgtab[PGTAB(addr) - PGTAB(preg->start)];
+	
+	/* Page table is shared with a forked process. */
+	if (kpgshared(pgtab))
+		return (-1);
+	
+	/* Some page was touched, or lies outside the region. */
+	for (k = 0; k < HUGE_FRAMES; k++)
+	{
+		if ((pgtab[k].present) || (!pgtab[k].zero))
+			return (-1);
+	}
+	
+	/* Search for free frames, leaving the page cache alone. */
+	for (i = NR_KEXT; i + HUGE_FRAMES <= nframes; i += HUGE_FRAMES)
+	{
+		for (j = i; j < i + HUGE_FRAMES; j++)
+		{
+			if (frames[j].count != 0)
+				break;
+		}
+		
+		if (j == i + HUGE_FRAMES)
+			break;
+	}
+	
+	/* Physical memory is too fragmented. */
+	if (i + HUGE_FRAMES > nframes)
+		return (-1);
+	
+	/* Unlink frames. */
+	for (prev = FRAME_NULL, j = free_frames; j != FRAME_NULL; j = frames[j].next)
+	{
+		if ((j < i) || (j >= i + HUGE_FRAMES))
+		{
+			prev = j;
+			continue;
+		}
+		
+		if (prev == FRAME_NULL)
+			free_frames = frames[j].next;
+		else
+			frames[prev].next = frames[j].next;
+	}
+	
+	/*
+	 * Initialize page frames. Writes do not
+	 * go through page table entries anymore,
+	 * so pages are assumed to be dirty.
+	 */
+	for (k = 0; k < HUGE_FRAMES; k++)
+	{
+		j = i + k;
+		
+		frames[j].age = ticks;
+		frames[j].count = 1;
+		frames[j].owner = curr_proc;
+		frames[j].addr = (addr & PGTAB_MASK) + (k << PAGE_SHIFT);
+		frames[j].mark = -1;
+		used_append(j);
+		
+		kmemset(&pgtab[k], 0, sizeof(struct pte));
+		pgtab[k].present = 1;
+		pgtab[k].writable = 1;
+		pgtab[k].user = 1;
+		pgtab[k].accessed = 1;
+		pgtab[k].dirty = 1;
+		pgtab[k].frame = (UBASE_PHYS >> PAGE_SHIFT) + j;
+	}
+	
+	/* Map huge page. */
+	pde = getpde(curr_proc, addr);
+	pde->huge = 1;
+	pde->frame = (UBASE_PHYS >> PAGE_SHIFT) + i;
+	hugepgtabs[hugeslot(pde)] = pgtab;
+	tlb_flush_range(addr & PGTAB_MASK, PGTAB_SIZE);
+	
+	kmemset((void *)(addr & PGTAB_MASK), 0, PGTAB_SIZE);
+	vmstats.huge++;
+	
+	return (0);
+}
+
+/**
+ * @brief Maps a page cache page.
+ * 
+ * @details The page is mapped read-only, and copy on write if the region is
+ *          writable, so that the very frame of the page cache is shared.
+ * 
+ * @param preg Process region where the page resides.
+ * @param addr Address where the page should be mapped.
+ * @param off  File offset of the page.
+ * 
+ * @returns Zero upon successful completion, and non-zero upon failure.
+ */
+PRIVATE int mappg(struct pregion *preg, addr_t addr, off_t off)
+{
+	int i;               /* Frame index.              */
+	struct inode *inode; /* File inode.               */
+	struct pte *pg;      /* Working page table entry. */
+	struct region *reg;  /* Working memory region.    */
+	
+	reg = preg->reg;
+	inode = reg->file.inode;
+	
+	inode_lock_shared(inode);
+	i = pcache_page(inode, off >> PAGE_SHIFT, 0);
+	inode_unlock_shared(inode);
+	
+	if (i == FRAME_NULL)
+		return (-1);
+	
+	/* A single mapping may be reclaimed. */
+	frames[i].owner = (frames[i].count == 1) ? curr_proc : NULL;
+	frames[i].addr = addr;
+	frames[i].count++;
+	frames[i].pinned--;
+	
+	pg = getpte(curr_proc, addr);
+	kmemset(pg, 0, sizeof(struct pte));
+	pg->present = 1;
+	pg->user = 1;
+	pg->cow = (reg->mode & MAY_WRITE) ? 1 : 0;
+	pg->frame = (UBASE_PHYS >> PAGE_SHIFT) + i;
+	tlb_flush_page(addr);
 	
 	return (0);
 }
@@ -400,38 +2933,67 @@ PRIVATE int allocupg(addr_t addr, int writable)
 /**
  * @brief Reads a page from a file.
  * 
- * @param reg  Region where the page resides.
+ * @details Pages of private and read-only mappings come straight from the
+ *          page cache, as long as the whole page lies within the mapped
+ *          portion of the file. Pages of shared writable mappings get a frame
+ *          of their own, which is written back to the file.
+ * 
+ * @param preg Process region where the page resides.
  * @param addr Address where the page should be loaded. 
  * 
  * @returns Zero upon successful completion, and non-zero upon failure.
  */
-PRIVATE int readpg(struct region *reg, addr_t addr)
+PRIVATE int readpg(struct pregion *preg, addr_t addr)
 {
+	unsigned i;          /* Frame index.              */
 	char *p;             /* Read pointer.             */
 	off_t off;           /* Block offset.             */
 	ssize_t count;       /* Bytes read.               */
 	struct inode *inode; /* File inode.               */
 	struct pte *pg;      /* Working page table entry. */
+	struct region *reg;  /* Working memory region.    */
 	
 	addr &= PAGE_MASK;
+	reg = preg->reg;
+	off = reg->file.off + (addr - preg->start);
+	
+	/* Share page cache page. */
+	if (!((reg->flags & REGION_SHARED) && (reg->mode & MAY_WRITE)) &&
+		(!(reg->flags & REGION_DOWNWARDS)) &&
+		(S_ISREG(reg->file.inode->mode)) &&
+		((off & ~PAGE_MASK) == 0) &&
+		((addr - preg->start) + PAGE_SIZE <= reg->file.size))
+	{
+		if (!mappg(preg, addr, off))
+			return (0);
+	}
 	
-	/* Assign a user page. */
-	if (allocupg(addr, reg->mode & MAY_WRITE))
+	/*
+	 * Assign a user page. It is writable
+	 * until filled, since the kernel cannot
+	 * write to read-only user pages.
+	 */
+	if (allocupg(addr, 1))
 		return (-1);
 	
 	/* Find page table entry. */
 	pg = getpte(curr_proc, addr);
 	
+	/* Keep frame while we sleep below. */
+	i = pg->frame - (UBASE_PHYS >> PAGE_SHIFT);
+	frames[i].pinned++;
+	
 	/* Read page. */
-	off = reg->file.off + (PG(addr) << PAGE_SHIFT);
 	inode = reg->file.inode;
 	p = (char *)(addr & PAGE_MASK);
-	count = file_read(inode, p, PAGE_SIZE, off);
+	count = file_read(inode, p, PAGE_SIZE, off, 0);
 	
 	/* Failed to read page. */
 	if (count < 0)
 	{
+		frames[i].pinned--;
 		freeupg(pg);
+		tlb_flush_page(addr);
 		return (-1);
 	}
 	
@@ -439,7 +3001,205 @@ PRIVATE int readpg(struct region *reg, addr_t addr)
 	else if (count < PAGE_SIZE)
 		kmemset(p + count, 0, PAGE_SIZE - count);
 	
-	return (0);
+	/*
+	 * Pages of shared file mappings are written
+	 * back to the file, rather than swapped out.
+	 */
+	if (reg->flags & REGION_SHARED)
+		frames[i].owner = NULL;
+	
+	/* Clean private pages may be read again. */
+	else
+		frames[i].mark = PAGE_FILL;
+	
+	frames[i].pinned--;
+	
+	pg->writable = (reg->mode & MAY_WRITE) ? 1 : 0;
+	pg->dirty = 0;
+	tlb_flush_page(addr);
+	
+	return (0);
+}
+
+/**
+ * @brief Fault-around statistics.
+ */
+PRIVATE struct
+{
+	unsigned reads; /**< Pages read on demand.      */
+	unsigned saved; /**< Pages read ahead of fault. */
+} fastats = { 0, 0 };
+
+/**
+ * @brief Reads pages that follow a faulting page from a file.
+ * 
+ * @details Fills the pages of a file-backed region that follow the page at
+ *          @p addr, up to FAULT_AROUND pages in total, so that sequential
+ *          accesses take a single fault. The window stops at the first page
+ *          that is not pending a file fill, and prefetching never evicts a
+ *          page: it only takes frames that are already free.
+ * 
+ * @param preg Process region where the page resides.
+ * @param addr Address of the faulting page.
+ */
+PRIVATE void faultaround(struct pregion *preg, addr_t addr)
+{
+	int n;              /* Pages left in window.     */
+	struct pte *pg;     /* Working page table entry. */
+	struct region *reg; /* Working memory region.    */
+	
+	reg = preg->reg;
+	
+	/* Stack grows the other way. */
+	if (reg->flags & REGION_DOWNWARDS)
+		return;
+	
+	addr &= PAGE_MASK;
+	
+	for (n = FAULT_AROUND - 1; n > 0; n--)
+	{
+		addr += PAGE_SIZE;
+		
+		/* Outside region. */
+		if (!withinreg(preg, addr))
+			break;
+		
+		pg = &reg->pgtab[PGTAB(addr) - PGTAB(preg->start)][PG(addr)];
+		
+		/* Not pending a fill. */
+		if ((pg->present) || (!pg->fill))
+			break;
+		
+		/* Do not evict for prefetching. */
+		if (free_frames == FRAME_NULL)
+			break;
+		
+		if (readpg(preg, addr))
+			break;
+		
+		fastats.saved++;
+	}
+}
+
+/**
+ * @brief Gets fault-around statistics.
+ * 
+ * @details Reports pages read on demand as misses, and pages read ahead of
+ *          a fault (that is, faults saved) as hits. The window size is
+ *          reported as the number of slots.
+ * 
+ * @param buf Location where statistics shall be stored.
+ */
+PUBLIC void pgstat(struct cachestat *buf)
+{
+	kmemset(buf, 0, sizeof(struct cachestat));
+	buf->size = FAULT_AROUND;
+	buf->hits = fastats.saved;
+	buf->misses = fastats.reads;
+}
+
+/**
+ * @brief Gets virtual memory statistics.
+ * 
+ * @param buf Location where statistics shall be stored.
+ */
+PUBLIC void pgvmstat(struct vmstat *buf)
+{
+	int i;              /* Loop index.        */
+	unsigned j;         /* Loop index.        */
+	struct swaparea *a; /* Working swap area. */
+	
+	buf->frames = nframes;
+	buf->free = 0;
+	for (i = 0; i < nframes; i++)
+	{
+		if (frames[i].count == 0)
+			buf->free++;
+	}
+	
+	buf->kpages = NR_KPAGES + nkborrowed;
+	buf->kfree = nkfree;
+	
+	buf->swap = 0;
+	buf->swapfree = 0;
+	for (a = &swapareas[0]; a < &swapareas[NR_SWAPAREAS]; a++)
+	{
+		buf->swap += a->nslots;
+		for (j = 0; j < a->nslots; j++)
+		{
+			if (a->count[j] == 0)
+				buf->swapfree++;
+		}
+	}
+	
+	buf->zswap = zswap.npages;
+	buf->zero = vmstats.zero;
+	buf->fill = fastats.reads;
+	buf->swapins = vmstats.swapins;
+	buf->swapouts = vmstats.swapouts;
+	buf->cow = vmstats.cow;
+	buf->pgtabcow = vmstats.pgtabcow;
+	buf->huge = vmstats.huge;
+	buf->split = vmstats.split;
+	buf->scanned = vmstats.scanned;
+	buf->merged = vmstats.merged;
+#if (LOADCTL)
+	buf->suspended = loadctl.nsuspended;
+#else
+	buf->suspended = 0;
+#endif
+}
+
+/**
+ * @brief Gets the resident set size of a process.
+ * 
+ * @param proc Process.
+ * 
+ * @returns The number of pages of @p proc that are in core. Shared pages are
+ *          accounted to every process that maps them.
+ */
+PUBLIC unsigned pgrss(struct process *proc)
+{
+	unsigned i, j, k;   /* Loop indexes.   */
+	unsigned n;         /* Resident pages. */
+	struct pte *pgtab;  /* Page table.     */
+	struct region *reg; /* Working region. */
+	
+	n = 0;
+	for (i = 0; i < NR_PREGIONS; i++)
+	{
+		if ((reg = proc->pregs[i].reg) == NULL)
+			continue;
+		
+		for (j = 0; j < REGION_PGTABS; j++)
+		{
+			if ((pgtab = reg->pgtab[j]) == NULL)
+				continue;
+			
+			for (k = 0; k < PAGE_SIZE/PTE_SIZE; k++)
+			{
+				if (pgtab[k].present)
+					n++;
+			}
+		}
+	}
+	
+	return (n);
+}
+
+/**
+ * @brief Updates the peak resident set size of a process.
+ * 
+ * @param proc Target process.
+ * 
+ * @note Called before the memory of @p proc is torn down.
+ */
+PUBLIC void pgrss_peak(struct process *proc)
+{
+	unsigned n;
+	
+	if ((n = pgrss(proc)) > proc->maxrss)
+		proc->maxrss = n;
 }
 
 /**
@@ -459,15 +3219,15 @@ PUBLIC void mappgtab(struct process *proc, addr_t addr, void *pgtab)
 	if (pde->present)
 		kpanic("busy page table entry");
 	
-	/* Map kernel page. */
+	/* Map kernel page. Shared page tables are copied on write. */
 	pde->present = 1;
-	pde->writable = 1;
+	pde->writable = (kpgshared(pgtab)) ? 0 : 1;
 	pde->user = 1;
 	pde->frame = (ADDR(pgtab) - KBASE_VIRT) >> PAGE_SHIFT;
 	
 	/* Flush changes. */
 	if (proc == curr_proc)
-		tlb_flush();
+		tlb_flush_page(addr);
 }
 
 /**
@@ -487,28 +3247,171 @@ PUBLIC void umappgtab(struct process *proc, addr_t addr)
 	/* Bad page table. */
 	if (!(pde->present))
 		kpanic("unmap non-present page table");
+	
+	/* Forget huge page. */
+	if (pde->huge)
+		hugepgtabs[hugeslot(pde)] = NULL;
 
 	/* Unmap kernel page. */
 	kmemset(pde, 0, sizeof(struct pde));
 	
 	/* Flush changes. */
 	if (proc == curr_proc)
-		tlb_flush();
+		tlb_flush_range(addr & PGTAB_MASK, PGTAB_SIZE);
+}
+
+/**
+ * @brief Write protects a page table in user address space.
+ * 
+ * @param proc Process in which the page table is mapped.
+ * @param addr Address where the page table is mapped.
+ * 
+ * @note The caller shall flush the TLB.
+ */
+PUBLIC void wppgtab(struct process *proc, addr_t addr)
+{
+	struct pde *pde;
+	
+	/* Page table entries shall be honored. */
+	splitpgtab(proc, addr);
+	
+	pde = getpde(proc, addr);
+	
+	if (pde->present)
+		pde->writable = 0;
+}
+
+/**
+ * @brief Splits a huge page in user address space.
+ * 
+ * @details The page directory entry is pointed back to the page table, whose
+ *          entries are kept up to date, so the huge page is turned into
+ *          regular pages that may then be changed one at a time.
+ * 
+ * @param proc Process in which the page table is mapped.
+ * @param addr Address in the page table.
+ */
+PUBLIC void splitpgtab(struct process *proc, addr_t addr)
+{
+	struct pde *pde;   /* Page directory entry. */
+	struct pte *pgtab; /* Page table.           */
+	
+	pde = getpde(proc, addr);
+	
+	/* Not a huge page. */
+	if ((!pde->present) || (!pde->huge))
+		return;
+	
+	pgtab = pdepgtab(pde);
+	hugepgtabs[hugeslot(pde)] = NULL;
+	
+	pde->huge = 0;
+	pde->frame = (ADDR(pgtab) - KBASE_VIRT) >> PAGE_SHIFT;
+	vmstats.split++;
+	
+	/* Flush changes. */
+	if (proc == curr_proc)
+		tlb_flush_range(addr & PGTAB_MASK, PGTAB_SIZE);
+}
+
+/**
+ * @brief Breaks the sharing of a page table.
+ * 
+ * @details Page tables of private regions are shared by fork(), with the page
+ *          directory entries write protected in both processes. On the first
+ *          write, or on any fault that changes the page table, the faulting
+ *          process gets its own copy of the page table, whose pages are then
+ *          shared copy on write. The last process to hold a page table
+ *          just takes it over.
+ * 
+ * @param proc Process in which the page table is mapped.
+ * @param preg Process region where the page table resides.
+ * @param addr Address in the page table.
+ * 
+ * @returns Zero upon successful completion, and non-zero otherwise.
+ */
+PUBLIC int cowpgtab(struct process *proc, struct pregion *preg, addr_t addr)
+{
+	unsigned i, j;      /* Loop indexes.         */
+	int k;              /* Frame index.          */
+	struct pde *pde;    /* Page directory entry. */
+	struct pte *pgtab;  /* Shared page table.    */
+	struct pte *copy;   /* Private page table.   */
+	struct region *reg; /* Working region.       */
+	
+	pde = getpde(proc, addr);
+	
+	/* Page table is not shared. */
+	if ((!pde->present) || (pde->writable))
+		return (0);
+	
+	reg = preg->reg;
+	i = (reg->flags & REGION_DOWNWARDS) ?
+		REGION_PGTABS - (PGTAB(preg->start) - PGTAB(addr)) - 1 :
+		PGTAB(addr) - PGTAB(preg->start);
+	pgtab = reg->pgtab[i];
+	
+	/* Copy page table. */
+	if (kpgshared(pgtab))
+	{
+		if ((copy = getkpg(0)) == NULL)
+			return (-1);
+		
+		for (j = 0; j < PAGE_SIZE/PTE_SIZE; j++)
+			linkupg(&pgtab[j], &copy[j]);
+		
+		putkpg(pgtab);
+		reg->pgtab[i] = copy;
+		pde->frame = (ADDR(copy) - KBASE_VIRT) >> PAGE_SHIFT;
+		vmstats.pgtabcow++;
+	}
+	
+	/* Take over page table. */
+	else
+	{
+		for (j = 0; j < PAGE_SIZE/PTE_SIZE; j++)
+		{
+			/* Not in-core. */
+			if (!pgtab[j].present)
+				continue;
+			
+			k = pgtab[j].frame - (UBASE_PHYS >> PAGE_SHIFT);
+			
+			/* Shared page. */
+			if (frames[k].count > 1)
+				continue;
+			
+			frames[k].owner = proc;
+			frames[k].addr = (addr & PGTAB_MASK) + (j << PAGE_SHIFT);
+		}
+	}
+	
+	pde->writable = 1;
+	
+	/* Flush changes. */
+	if (proc == curr_proc)
+		tlb_flush_range(addr & PGTAB_MASK, PGTAB_SIZE);
+	
+	return (0);
 }
 
 /**
  * @brief Frees a user page.
  * 
  * @param pg Page to be freed.
+ * 
+ * @note The caller shall flush the TLB if the page is mapped in the current
+ *       address space.
  */
 PUBLIC void freeupg(struct pte *pg)
 {
 	unsigned i;
 	
-	/* In-disk page. */
+	/* In-disk page. Demand pages have no swap slot. */
 	if (!pg->present)
 	{
-		swap_clear(pg);
+		if ((!pg->zero) && (!pg->fill))
+			swap_clear(pg);
 		kmemset(pg, 0, sizeof(struct pte));
 		return;
 	}
@@ -521,9 +3424,10 @@ PUBLIC void freeupg(struct pte *pg)
 	
 	/* Free user page. */
 	if (--frames[i].count)
-		frames[i].owner = 0;
+		frames[i].owner = NULL;
+	else
+		freef(i);
 	kmemset(pg, 0, sizeof(struct pte));
-	tlb_flush();
 }
 
 /**
@@ -582,13 +3486,267 @@ PUBLIC void linkupg(struct pte *upg1, struct pte *upg2)
 	/* In-disk page. */
 	else
 	{
-		 i = upg1->frame;
-		 swap.count[i]++;
+		 swap_ref(upg1);
 	}
 	
 	kmemcpy(upg2, upg1, sizeof(struct pte));
 }
 
+/**
+ * @brief Pins a user page of the current process in memory.
+ * 
+ * @details The page is faulted in, and copy on write is broken if the page
+ *          shall be written, so that a device may transfer data straight
+ *          from/to the underlying frame. Pinned pages are never swapped out.
+ * 
+ * @param addr  Address of the page.
+ * @param write Shall the page be written?
+ * 
+ * @returns Upon success, the physical address of the page is returned. Upon
+ *          failure, zero is returned instead.
+ */
+PUBLIC addr_t pinupg(addr_t addr, int write)
+{
+	struct pte *pg;
+	
+	addr &= PAGE_MASK;
+	
+	/* Fault page in. */
+	if (write)
+		*((volatile char *)addr) = *((volatile char *)addr);
+	else
+		(void) *((volatile char *)addr);
+	
+	pg = getpte(curr_proc, addr);
+	
+	/* Page fault failed. */
+	if (!pg->present)
+		return (0);
+	
+	frames[pg->frame - (UBASE_PHYS >> PAGE_SHIFT)].pinned++;
+	
+	return (pg->frame << PAGE_SHIFT);
+}
+
+/**
+ * @brief Faults in a user page of the current process.
+ * 
+ * @details Unlike pinupg(), the page is faulted in through the fault handlers
+ *          straight away, so that a failure is reported back to the caller.
+ * 
+ * @param addr  Address of the page, which shall lie in an attached region.
+ * @param write Shall copy on write be broken?
+ * 
+ * @returns Zero upon success, and non-zero otherwise.
+ */
+PUBLIC int faultupg(addr_t addr, int write)
+{
+	struct pte *pg;
+	
+	addr &= PAGE_MASK;
+	
+	pg = getpte(curr_proc, addr);
+	
+	/* Fault page in. */
+	if (!pg->present)
+	{
+		if (vfault(addr, write))
+			return (-1);
+		pg = getpte(curr_proc, addr);
+	}
+	
+	/* Break copy on write. */
+	if ((write) && (!pg->writable) && (pg->cow))
+		return (pfault(addr));
+	
+	return (0);
+}
+
+/**
+ * @brief Asserts if a user page of the current process may be written.
+ * 
+ * @details Nothing is faulted in, so this may be called from interrupt
+ *          handlers, which cannot handle page faults.
+ * 
+ * @param addr Address in the page.
+ * 
+ * @returns Non-zero if @p addr may be written without faulting, and zero
+ *          otherwise.
+ */
+PUBLIC int writableupg(addr_t addr)
+{
+	struct pde *pde; /* Page directory entry. */
+	struct pte *pg;  /* Page table entry.     */
+	
+	pde = getpde(curr_proc, addr);
+	
+	/* Page table not present, or shared with a forked process. */
+	if ((!pde->present) || (!pde->writable))
+		return (0);
+	
+	/* Huge page. */
+	if (pde->huge)
+		return (1);
+	
+	pg = getpte(curr_proc, addr);
+	
+	return ((pg->present) && (pg->writable));
+}
+
+/**
+ * @brief Unpins a user page of the current process.
+ * 
+ * @param addr Address of the page.
+ */
+PUBLIC void unpinupg(addr_t addr)
+{
+	struct pte *pg;
+	
+	pg = getpte(curr_proc, addr);
+	frames[pg->frame - (UBASE_PHYS >> PAGE_SHIFT)].pinned--;
+}
+
+/**
+ * @brief Gets a reference to a user page of the current process.
+ * 
+ * @details The page is pinned, and the underlying frame is kept around until
+ *          released with putupg(), even if the process unmaps the page or
+ *          exits in the meantime. This allows the kernel to transfer data
+ *          from/to the frame later on, from the context of another process.
+ * 
+ * @param addr  Address of the page.
+ * @param write Shall the page be written?
+ * 
+ * @returns Upon success, the physical address of the page is returned. Upon
+ *          failure, zero is returned instead.
+ */
+PUBLIC addr_t getupg(addr_t addr, int write)
+{
+	addr_t phys;
+	
+	if ((phys = pinupg(addr, write)) != 0)
+		frames[(phys >> PAGE_SHIFT) - (UBASE_PHYS >> PAGE_SHIFT)].count++;
+	
+	return (phys);
+}
+
+/**
+ * @brief Releases a reference to a user page.
+ * 
+ * @param phys Physical address of the page, as returned by getupg().
+ */
+PUBLIC void putupg(addr_t phys)
+{
+	unsigned i;
+	
+	i = (phys >> PAGE_SHIFT) - (UBASE_PHYS >> PAGE_SHIFT);
+	
+	frames[i].pinned--;
+	if (--frames[i].count == 0)
+		freef(i);
+}
+
+/**
+ * @brief Lends a user page of the current process.
+ * 
+ * @details The page is faulted in and linked to @p pg, copy on write, so
+ *          that it may be handed over to another process later on without
+ *          copying it. Pages of shared regions are not lent, since writes to
+ *          them would no longer be seen by the other processes.
+ * 
+ * @param addr Address of the page.
+ * @param pg   Page table entry that shall hold the page.
+ * 
+ * @returns Zero upon success, and non-zero otherwise.
+ */
+PUBLIC int lendupg(addr_t addr, struct pte *pg)
+{
+	struct pte *upg;      /* User page.      */
+	struct pregion *preg; /* Process region. */
+	
+	addr &= PAGE_MASK;
+	
+	/* Shared page. */
+	if ((preg = findreg(curr_proc, addr)) == NULL)
+		return (-1);
+	if (preg->reg->flags & REGION_SHARED)
+		return (-1);
+	
+	/* Fault page in. */
+	(void) *((volatile char *)addr);
+	splitpgtab(curr_proc, addr);
+	
+	upg = getpte(curr_proc, addr);
+	
+	/* Page fault failed. */
+	if (!upg->present)
+		return (-1);
+	
+	linkupg(upg, pg);
+	tlb_flush_page(addr);
+	
+	return (0);
+}
+
+/**
+ * @brief Installs a lent page in the current process.
+ * 
+ * @details The page at @p addr is faulted in for writing first, so that both
+ *          the page and the page table that maps it are private, and then it
+ *          is replaced by the page held by @p pg. The reference held by @p pg
+ *          is handed over, and if no one else holds the underlying frame, the
+ *          page is stolen right away.
+ * 
+ * @param addr Address of the page.
+ * @param pg   Page table entry that holds the page.
+ * 
+ * @returns Zero upon success, and non-zero otherwise.
+ */
+PUBLIC int moveupg(addr_t addr, struct pte *pg)
+{
+	unsigned i;           /* Frame index.    */
+	struct pte *upg;      /* User page.      */
+	struct pregion *preg; /* Process region. */
+	
+	addr &= PAGE_MASK;
+	
+	/* Shared page. */
+	if ((preg = findreg(curr_proc, addr)) == NULL)
+		return (-1);
+	if (preg->reg->flags & REGION_SHARED)
+		return (-1);
+	
+	/* Fault page in. */
+	*((volatile char *)addr) = *((volatile char *)addr);
+	splitpgtab(curr_proc, addr);
+	
+	upg = getpte(curr_proc, addr);
+	
+	/* Page fault failed. */
+	if (!upg->present)
+		return (-1);
+	
+	freeupg(upg);
+	kmemcpy(upg, pg, sizeof(struct pte));
+	kmemset(pg, 0, sizeof(struct pte));
+	
+	i = upg->frame - (UBASE_PHYS >> PAGE_SHIFT);
+	
+	/* Steal page. */
+	if (frames[i].count == 1)
+	{
+		upg->cow = 0;
+		upg->writable = 1;
+		frames[i].owner = curr_proc;
+		frames[i].addr = addr;
+		frames[i].mark = -1;
+	}
+	
+	tlb_flush_page(addr);
+	
+	return (0);
+}
+
 /**
  * @brief Creates a page directory for a process.
  * 
@@ -617,10 +3775,12 @@ PUBLIC int crtpgdir(struct process *proc)
 	pgdir[0] = curr_proc->pgdir[0];
 	pgdir[PGTAB(KBASE_VIRT)] = curr_proc->pgdir[PGTAB(KBASE_VIRT)];
 	pgdir[PGTAB(KPOOL_VIRT)] = curr_proc->pgdir[PGTAB(KPOOL_VIRT)];
+	pgdir[PGTAB(KEXT_VIRT)] = curr_proc->pgdir[PGTAB(KEXT_VIRT)];
 	pgdir[PGTAB(INITRD_VIRT)] = curr_proc->pgdir[PGTAB(INITRD_VIRT)];
+	pgdir[PGTAB(IOMEM_VIRT)] = curr_proc->pgdir[PGTAB(IOMEM_VIRT)];
 	
 	/* Clone kernel stack. */
-	kmemcpy(kstack, curr_proc->kstack, KSTACK_SIZE);
+	kpgcpy(kstack, curr_proc->kstack);
 	
 	/* Adjust stack pointers. */
 	proc->kesp = (curr_proc->kesp -(dword_t)curr_proc->kstack)+(dword_t)kstack;
@@ -643,6 +3803,56 @@ err0:
 	return (-1);
 }
 
+/**
+ * @brief Shares the page directory of the current process.
+ * 
+ * @details The process pointed to by @p proc gets its own kernel stack, but
+ *          runs in the same address space as the current process. The page
+ *          directory is reference counted, so that it is released along with
+ *          the last process that uses it.
+ * 
+ * @param proc Target process.
+ * 
+ * @returns Zero upon success, and non-zero otherwise.
+ */
+PUBLIC int sharepgdir(struct process *proc)
+{
+	void *kstack; /* Kernel stack. */
+	
+	/* Get kernel page for kernel stack. */
+	if ((kstack = getkpg(0)) == NULL)
+		return (-1);
+	
+	/* Clone kernel stack. */
+	kpgcpy(kstack, curr_proc->kstack);
+	proc->kesp = (curr_proc->kesp -(dword_t)curr_proc->kstack)+(dword_t)kstack;
+	
+	/* Share page directory. */
+	linkkpg(curr_proc->pgdir);
+	proc->cr3 = curr_proc->cr3;
+	proc->pgdir = curr_proc->pgdir;
+	proc->kstack = kstack;
+	
+	return (0);
+}
+
+/**
+ * @brief Asserts if the page directory of a process is shared.
+ * 
+ * @param proc Target process.
+ * 
+ * @returns Non-zero if other processes (threads) share the page directory of
+ *          @p proc, and zero otherwise.
+ */
+PUBLIC int sharedpgdir(struct process *proc)
+{
+	/* IDLE runs on the boot page directory. */
+	if (proc == IDLE)
+		return (0);
+	
+	return (kpgshared(proc->pgdir));
+}
+
 /**
  * @brief Destroys the page directory of a process.
  * 
@@ -659,18 +3869,24 @@ PUBLIC void dstrypgdir(struct process *proc)
 /**
  * @brief Handles a validity page fault.
  * 
- * @brief addr Faulting address.
+ * @details Read faults on demand zero pages map the shared zero frame, copy on
+ *          write, so that a real frame is only allocated on a write.
+ * 
+ * @brief addr  Faulting address.
+ * @brief write Write fault?
  * 
  * @returns Upon successful completion, zero is returned. Upon failure, non-zero
  *          is returned instead.
  */
-PUBLIC int vfault(addr_t addr)
+PUBLIC int vfault(addr_t addr, int write)
 {
 	int frame;            /* Frame index of page to be swapped in. */
 	struct pte *pg;       /* Working page.                         */
 	struct region *reg;   /* Working region.                       */
 	struct pregion *preg; /* Working process region.               */
 	
+	ktrace(KTRACE_VFAULT, addr, write);
+	
 	/* Get associated region. */
 	preg = findreg(curr_proc, addr);
 	if (preg == NULL)
@@ -691,25 +3907,63 @@ PUBLIC int vfault(addr_t addr)
 		if (growreg(curr_proc,preg,(preg->start-reg->size)-(addr&~PGTAB_MASK)))
 			goto error1;
 	}
+	
+	/* Page table is shared with a forked process. */
+	if (cowpgtab(curr_proc, preg, addr))
+		goto error1;
 
 	pg = (reg->flags & REGION_DOWNWARDS) ?
 		&reg->pgtab[REGION_PGTABS-(PGTAB(preg->start)-PGTAB(addr))-1][PG(addr)]: 
 		&reg->pgtab[PGTAB(addr) - PGTAB(preg->start)][PG(addr)];
 		
+	/* Map zero frame. */
+	if ((pg->zero) && (!write))
+	{
+		frames[zero_frame].count++;
+		kmemset(pg, 0, sizeof(struct pte));
+		pg->present = 1;
+		pg->user = 1;
+		pg->cow = (reg->mode & MAY_WRITE) ? 1 : 0;
+		pg->frame = (UBASE_PHYS >> PAGE_SHIFT) + zero_frame;
+		tlb_flush_page(addr);
+		vmstats.zero++;
+		curr_proc->minflt++;
+	}
+	
+	/* Back the whole page table with a huge page. */
+	else if ((pg->zero) && (!allochuge(preg, addr)))
+	{
+		vmstats.zero++;
+		curr_proc->minflt++;
+	}
+	
 	/* Clear page. */
-	if (pg->zero)
+	else if (pg->zero)
 	{
-		if (allocupg(addr, reg->mode & MAY_WRITE))
+		if (allocupg(addr, 1))
 			goto error1;
-		kmemset((void *)(addr & PAGE_MASK), 0, PAGE_SIZE);
+		kpgzero((void *)(addr & PAGE_MASK));
+		
+		/* Clean page may be zeroed again. */
+		frames[pg->frame - (UBASE_PHYS >> PAGE_SHIFT)].mark = PAGE_ZERO;
+		pg->writable = (reg->mode & MAY_WRITE) ? 1 : 0;
+		pg->dirty = 0;
+		tlb_flush_page(addr);
+		vmstats.zero++;
+		curr_proc->minflt++;
 	}
 		
-	/* Load page from executable file. */
+	/* Load page from file. */
 	else if (pg->fill)
 	{
 		/* Read page. */
-		if (readpg(reg, addr))
+		if (readpg(preg, addr))
 			goto error1;
+		fastats.reads++;
+		curr_proc->majflt++;
+		
+		/* Read following pages. */
+		faultaround(preg, addr);
 	}
 		
 	/* Swap page in. */
@@ -719,14 +3973,17 @@ PUBLIC int vfault(addr_t addr)
 			goto error1;
 		if (swap_in(frame, addr))
 			goto error2;
+		frames[frame].owner = curr_proc;
 		frames[frame].addr = addr & PAGE_MASK;
+		vmstats.swapins++;
+		curr_proc->majflt++;
 	}
 	
 	unlockreg(reg);
 	return (0);
 
 error2:
-	frames[frame].count = 0;
+	freef(frame);
 error1:
 	unlockreg(reg);
 error0:
@@ -748,6 +4005,8 @@ PUBLIC int pfault(addr_t addr)
 	struct region *reg;   /* Working memory region.  */
 	struct pregion *preg; /* Working process region. */
 
+	ktrace(KTRACE_PFAULT, addr, 0);
+	
 	preg = findreg(curr_proc, addr);
 	
 	/* Outside virtual address space. */
@@ -755,10 +4014,21 @@ PUBLIC int pfault(addr_t addr)
 		goto error0;
 	
 	lockreg(reg = preg->reg);
+	
+	/* Page table is shared with a forked process. */
+	if (cowpgtab(curr_proc, preg, addr))
+		goto error1;
 
 	pg = (reg->flags & REGION_DOWNWARDS) ?
 		&reg->pgtab[REGION_PGTABS-(PGTAB(preg->start)-PGTAB(addr))-1][PG(addr)]: 
 		&reg->pgtab[PGTAB(addr) - PGTAB(preg->start)][PG(addr)];
+	
+	/* Page is writable now. */
+	if (pg->writable)
+	{
+		unlockreg(reg);
+		return (0);
+	}
 
 	/* Copy on write not enabled. */
 	if (!pg->cow)
@@ -769,8 +4039,14 @@ PUBLIC int pfault(addr_t addr)
 	/* Duplicate page. */
 	if (frames[i].count > 1)
 	{
+		/* Cached pages are reclaimed while shared. */
+		frames[i].pinned++;
 		if (cpypg(&new_pg, pg))
+		{
+			frames[i].pinned--;
 			goto error1;
+		}
+		frames[i].pinned--;
 		
 		new_pg.cow = 0;
 		new_pg.writable = 1;
@@ -787,6 +4063,14 @@ PUBLIC int pfault(addr_t addr)
 		pg->writable = 1;
 	}
 	
+	/* The page is now private to the current process. */
+	i = pg->frame - (UBASE_PHYS >> PAGE_SHIFT);
+	frames[i].owner = curr_proc;
+	frames[i].addr = addr & PAGE_MASK;
+	tlb_flush_page(addr);
+	vmstats.cow++;
+	curr_proc->minflt++;
+	
 	unlockreg(reg);
 	return(0);
 
@@ -35,6 +35,17 @@
  */
 PRIVATE struct region regtab[NR_REGIONS];
 
+/**
+ * @brief Returns the address where a page table of a region is mapped.
+ * 
+ * @param preg Process region where the memory region is attached.
+ * @param i    Index of the page table in the memory region.
+ */
+#define pgtabaddr(preg, i)                                          \
+	(((preg)->reg->flags & REGION_DOWNWARDS) ?                      \
+		(preg)->start - (REGION_PGTABS - 1 - (i))*PGTAB_SIZE :      \
+		(preg)->start + (i)*PGTAB_SIZE)
+
 /**
  * @brief Expands a memory region.
  * 
@@ -61,7 +72,7 @@ PRIVATE int expand(struct process *proc, struct region *reg, size_t size)
 	if (reg->flags & REGION_DOWNWARDS)
 	{		
 		/* Allocate first page table. */
-		if (reg->size == 0)
+		if ((reg->size == 0) && (reg->pgtab[REGION_PGTABS - 1] == NULL))
 		{
 			reg->pgtab[REGION_PGTABS - 1] = getkpg(1);
 			if (reg->pgtab[REGION_PGTABS - 1] == NULL)
@@ -115,7 +126,7 @@ PRIVATE int expand(struct process *proc, struct region *reg, size_t size)
 	else
 	{
 		/* Allocate first page table. */
-		if (reg->size == 0)
+		if ((reg->size == 0) && (reg->pgtab[0] == NULL))
 		{
 			reg->pgtab[0] = getkpg(1);
 			if (reg->pgtab[0] == NULL)
@@ -180,6 +191,7 @@ PRIVATE int contract(struct process *proc, struct region *reg, size_t size)
 {
 	unsigned i, j;        /* Loop indexes.                  */
 	unsigned npages;      /* Number of pages in the region. */
+	size_t oldsize;       /* Size before contracting.       */
 	struct pregion *preg; /* Working process region.        */
 	
 	size = ALIGN(size, PAGE_SIZE);
@@ -189,7 +201,8 @@ PRIVATE int contract(struct process *proc, struct region *reg, size_t size)
 		return (-1);
 
 	preg = reg->preg;
-	npages = reg->size >> PAGE_SHIFT;
+	npages = size >> PAGE_SHIFT;
+	oldsize = reg->size;
 	
 	/* Contract downwards. */
 	if (reg->flags & REGION_DOWNWARDS)
@@ -237,11 +250,14 @@ PRIVATE int contract(struct process *proc, struct region *reg, size_t size)
 			/* Reset. */
 			if (j == 0)
 			{
-				/* Unmap page table. */
-				if (proc != NULL)
-					umappgtab(proc, preg->start - reg->size);
-				putkpg(reg->pgtab[i]);
-				reg->pgtab[i] = NULL;
+				/* Release empty page table. */
+				if (reg->pgtab[i] != NULL)
+				{
+					if (proc != NULL)
+						umappgtab(proc, preg->start + reg->size);
+					putkpg(reg->pgtab[i]);
+					reg->pgtab[i] = NULL;
+				}
 				
 				i--;
 				j = PAGE_SIZE/PTE_SIZE;
@@ -253,8 +269,33 @@ PRIVATE int contract(struct process *proc, struct region *reg, size_t size)
 			npages--;
 			reg->size -= PAGE_SIZE;
 			
+			/* Huge pages cannot be partially released. */
+			if (proc != NULL)
+				splitpgtab(proc, pgtabaddr(preg, i));
+			
 			freeupg(&reg->pgtab[i][j]);
 		}
+		
+		/*
+		 * A page table that starts right at the end
+		 * of the region is allocated only when the
+		 * region expands into it (see expand()).
+		 */
+		if ((j == 0) && (reg->size != 0) && (reg->pgtab[i] != NULL))
+		{
+			if (proc != NULL)
+				umappgtab(proc, preg->start + reg->size);
+			putkpg(reg->pgtab[i]);
+			reg->pgtab[i] = NULL;
+		}
+	}
+	
+	/* Flush released pages. */
+	if (proc == curr_proc)
+	{
+		tlb_flush_range((reg->flags & REGION_DOWNWARDS) ?
+			preg->start + 1 - oldsize : preg->start + reg->size,
+			oldsize - reg->size);
 	}
 	
 	return (0);
@@ -269,9 +310,15 @@ PUBLIC void lockreg(struct region *reg)
 {	
 	/* Sleep until region is unlocked. */
 	while (reg->flags & REGION_LOCKED)
-		sleep(&reg->chain, PRIO_REGION);
+	{
+		reg->waits++;
+		lock_wait(LOCK_REGION, reg->holder, PRIO_REGION);
+		sleep_excl(&reg->chain, PRIO_REGION);
+	}
 	
 	reg->flags |= REGION_LOCKED;
+	reg->holder = curr_proc;
+	lock_acquire(LOCK_REGION);
 }
 
 /**
@@ -281,6 +328,8 @@ PUBLIC void lockreg(struct region *reg)
  */
 PUBLIC void unlockreg(struct region *reg)
 {
+	lock_release(reg->holder);
+	reg->holder = NULL;
 	reg->flags &= ~REGION_LOCKED;
 	wakeup(&reg->chain);
 }
@@ -318,7 +367,10 @@ found:
 	reg->flags = flags & ~(REGION_FREE | REGION_LOCKED);
 	reg->count = 0;
 	reg->size = 0;
-	reg->chain = NULL;
+	waitq_init(&reg->chain);
+	reg->holder = NULL;
+	reg->waits = 0;
+	reg->nlocks = 0;
 	reg->file.inode = NULL;
 	reg->file.off = 0;
 	reg->file.size = 0;
@@ -342,6 +394,66 @@ found:
 	return (reg);
 }
 
+/**
+ * @brief Writes back the dirty pages of a shared file mapping.
+ * 
+ * @param reg Memory region to be synchronized.
+ */
+PRIVATE void syncreg(struct region *reg)
+{
+	off_t off;           /* File offset.              */
+	size_t n;            /* Bytes to write.           */
+	void *kpg;           /* Kernel page.              */
+	struct pte *pg;      /* Working page table entry. */
+	struct inode *inode; /* Mapped file.              */
+	
+	/* Get kernel page. */
+	if ((kpg = getkpg(0)) == NULL)
+	{
+		kprintf("mm: failed to write back file mapping");
+		return;
+	}
+	
+	inode = reg->file.inode;
+	
+	for (unsigned i = 0; i < REGION_PGTABS; i++)
+	{
+		/* Skip invalid page tables. */
+		if (reg->pgtab[i] == NULL)
+			continue;
+		
+		for (unsigned j = 0; j < PAGE_SIZE/PTE_SIZE; j++)
+		{
+			pg = &reg->pgtab[i][j];
+			
+			/* Clean page. */
+			if ((!pg->present) || (!pg->dirty))
+				continue;
+			
+			off = ((i*(PAGE_SIZE/PTE_SIZE)) + j) << PAGE_SHIFT;
+			
+			/* Beyond the mapping. */
+			if ((size_t)off >= reg->file.size)
+				continue;
+			
+			off += reg->file.off;
+			
+			/* Mappings do not grow files. */
+			if (off >= inode->size)
+				continue;
+			
+			n = ((inode->size - off) < PAGE_SIZE) ? 
+				(size_t)(inode->size - off) : PAGE_SIZE;
+			
+			physcpy(ADDR(kpg) - KBASE_VIRT, pg->frame << PAGE_SHIFT, PAGE_SIZE);
+			file_write(inode, kpg, n, off);
+			pg->dirty = 0;
+		}
+	}
+	
+	putkpg(kpg);
+}
+
 /**
  * @brief Frees a memory region.
  * 
@@ -357,7 +469,13 @@ PUBLIC void freereg(struct region *reg)
 	
 	/* Release region inode. */
 	if (reg->file.inode != NULL)
+	{
+		/* Write back shared file mapping. */
+		if ((reg->flags & REGION_MMAP) && (reg->flags & REGION_SHARED))
+			syncreg(reg);
+		
 		inode_put(reg->file.inode);
+	}
 	
 	/* Free underlying page tables. */
 	for (i = 0; i < REGION_PGTABS; i++)
@@ -366,6 +484,13 @@ PUBLIC void freereg(struct region *reg)
 		if (reg->pgtab[i] == NULL)
 			continue;
 		
+		/* Pages are still in use by a forked region. */
+		if (kpgshared(reg->pgtab[i]))
+		{
+			putkpg(reg->pgtab[i]);
+			continue;
+		}
+		
 		/* Free underlying pages. */
 		for (j = 0; j < PAGE_SIZE/PTE_SIZE; j++)	
 			freeupg(&reg->pgtab[i][j]);
@@ -394,6 +519,60 @@ PUBLIC int editreg(struct region *reg, uid_t uid, gid_t gid, mode_t mode)
 	return (0);
 }
 
+/**
+ * @brief Gets the lowest address covered by a process region.
+ * 
+ * @param preg Process region.
+ * 
+ * @returns The lowest address that @p preg may ever cover.
+ */
+#define pregbase(preg)                            \
+	(((preg)->reg->flags & REGION_DOWNWARDS) ?    \
+		(preg)->start - REGION_SIZE : (preg)->start)
+
+/**
+ * @brief Inserts a process region in the sorted map of a process.
+ * 
+ * @param proc Process.
+ * @param preg Attached process region.
+ */
+PRIVATE void pmap_insert(struct process *proc, struct pregion *preg)
+{
+	unsigned i;
+	
+	/* Shift regions with higher addresses up. */
+	for (i = proc->npregs; i > 0; i--)
+	{
+		if (pregbase(proc->pmap[i - 1]) < pregbase(preg))
+			break;
+		proc->pmap[i] = proc->pmap[i - 1];
+	}
+	
+	proc->pmap[i] = preg;
+	proc->npregs++;
+}
+
+/**
+ * @brief Removes a process region from the sorted map of a process.
+ * 
+ * @param proc Process.
+ * @param preg Attached process region.
+ */
+PRIVATE void pmap_remove(struct process *proc, struct pregion *preg)
+{
+	unsigned i;
+	
+	for (i = 0; i < proc->npregs; i++)
+	{
+		if (proc->pmap[i] == preg)
+			break;
+	}
+	
+	proc->npregs--;
+	for (/* noop */; i < proc->npregs; i++)
+		proc->pmap[i] = proc->pmap[i + 1];
+}
+
 /**
  * @brief Attaches a memory region to a process.
  * 
@@ -483,13 +662,37 @@ PUBLIC int attachreg
 	/* Attach region. */
 	preg->start = start;
 	preg->reg = reg;
+	preg->locked = 0;
 	reg->count++;
 	reg->preg = preg;
 	proc->size += reg->size;
+	pmap_insert(proc, preg);
 	
 	return (0);
 }
 
+/**
+ * @brief Shares a memory region with a thread.
+ * 
+ * @details Attaches the memory region that is attached to @p src in the
+ *          current process to @p preg in the process pointed to by @p proc,
+ *          which shares the page directory of the current process. Page
+ *          tables are already mapped, so only the reference is taken.
+ * 
+ * @param proc Process where the memory region shall be attached.
+ * @param preg Process memory region where the memory shall be attached.
+ * @param src  Process memory region of the current process.
+ */
+PUBLIC void sharereg(struct process *proc, struct pregion *preg, struct pregion *src)
+{
+	preg->start = src->start;
+	preg->reg = src->reg;
+	preg->locked = 0;
+	src->reg->count++;
+	proc->size += src->reg->size;
+	pmap_insert(proc, preg);
+}
+
 /**
  * @brief Detaches a memory region from a process.
  * 
@@ -506,8 +709,17 @@ PUBLIC void detachreg(struct process *proc, struct pregion *preg)
 	if ((reg = preg->reg) == NULL)
 		return;
 	
+	munlockreg(preg);
+	
 	lockreg(reg);
 	
+	/*
+	 * Threads that share the address space still use
+	 * the region, so leave its page tables mapped.
+	 */
+	if ((sharedpgdir(proc)) && (reg->count > 1))
+		goto out;
+	
 	/* Detach region. */
 	addr = preg->start;
 	if (reg->flags & REGION_DOWNWARDS)
@@ -530,6 +742,9 @@ PUBLIC void detachreg(struct process *proc, struct pregion *preg)
 			addr += PGTAB_SIZE;
 		}
 	}
+
+out:
+	pmap_remove(proc, preg);
 	preg->reg = NULL;
 	proc->size -= reg->size;
 	if (--reg->count < 0)
@@ -545,14 +760,21 @@ PUBLIC void detachreg(struct process *proc, struct pregion *preg)
 /**
  * @brief Duplicates a memory region.
  * 
- * @param reg Memory region that shall be duplicated.
+ * @details Private regions share their page tables with the duplicate, and
+ *          these are write protected in the current process, so that the
+ *          page tables are copied only when one of the regions changes them
+ *          (see cowpgtab()).
+ * 
+ * @param reg Memory region that shall be duplicated. If the region is
+ *            private and attached, it shall be attached to the current
+ *            process.
  * 
  * @returns Upon success a pointer to the (duplicated) memory region is 
  *          returned. Upon failure, a NULL pointer is returned instead.
  */
 PUBLIC struct region *dupreg(struct region *reg)
 {
-	unsigned i, j;          /* Loop index.        */
+	unsigned i;             /* Loop index.        */
 	struct region *new_reg; /* New memory region. */
 		
 	/* Shared region. */
@@ -560,20 +782,30 @@ PUBLIC struct region *dupreg(struct region *reg)
 		return (reg);
 	
 	/* Failed to allocate new region. */
-	if ((new_reg = allocreg(reg->mode, reg->size, reg->flags)) == NULL)
+	if ((new_reg = allocreg(reg->mode, 0, reg->flags)) == NULL)
 		return (NULL);
 	
-	/* Link underlying page tables. */
+	/* Share underlying page tables. */
 	for (i = 0; i < REGION_PGTABS; i++)
 	{
+		if (new_reg->pgtab[i] != NULL)
+			putkpg(new_reg->pgtab[i]);
+		new_reg->pgtab[i] = reg->pgtab[i];
+		
 		/* Skip invalid page tables. */
 		if (reg->pgtab[i] == NULL)
 			continue;
+		
+		linkkpg(reg->pgtab[i]);
+		if (reg->count > 0)
+		{
+			wppgtab(curr_proc, pgtabaddr(reg->preg, i));
 			
-		/* Link underlying pages. */
-		for (j = 0; j < PAGE_SIZE/PTE_SIZE; j++)
-			linkupg(&reg->pgtab[i][j], &new_reg->pgtab[i][j]);
+			/* The region is locked, so we may yield. */
+			resched();
+		}
 	}
+	new_reg->size = reg->size;
 	
 	/* Copy region fields. */
 	if (reg->file.inode != NULL)
@@ -587,6 +819,343 @@ PUBLIC struct region *dupreg(struct region *reg)
 	return (new_reg);
 }
 
+/**
+ * @brief Gets a memory region that maps a file.
+ * 
+ * @details Gets a memory region that maps @p size bytes of the file
+ *          @p inode starting at offset @p off. Shared mappings of a file are
+ *          backed by a single memory region, so processes that map the same
+ *          part of a file share the same pages. Pages are loaded on demand.
+ * 
+ * @param inode Inode of the file to be mapped.
+ * @param off   File offset.
+ * @param size  Size of the mapping (in bytes).
+ * @param mode  Access permissions.
+ * @param flags Memory region flags.
+ * 
+ * @returns Upon success a pointer to a (locked) memory region is returned. Upon
+ *          failure, a NULL pointer is returned instead.
+ */
+PUBLIC struct region *mmapreg
+(struct inode *inode, off_t off, size_t size, mode_t mode, int flags)
+{
+	struct region *reg; /* Memory region. */
+	
+	flags |= REGION_MMAP;
+	
+	/* Share mapping. */
+	if (flags & REGION_SHARED)
+	{
+		for (reg = &regtab[0]; reg < &regtab[NR_REGIONS]; reg++)
+		{
+			/* Skip free and other kinds of regions. */
+			if ((reg->flags & ~REGION_LOCKED) != flags)
+				continue;
+			
+			/* Found. */
+			if ((reg->file.inode == inode) && (reg->file.off == off) &&
+				(reg->file.size == size) && (reg->mode == mode))
+			{
+				lockreg(reg);
+				return (reg);
+			}
+		}
+	}
+	
+	/* Failed to allocate region. */
+	if ((reg = allocreg(mode, size, flags)) == NULL)
+		return (NULL);
+	
+	loadreg(inode, reg, off, size);
+	
+	return (reg);
+}
+
+/**
+ * @brief Gets a memory region that holds the text of an executable.
+ * 
+ * @details Gets a read-only memory region that maps @p filesz bytes of the
+ *          file @p inode starting at offset @p off, and that spans @p memsz
+ *          bytes. Text regions are shared and sticky: processes that run the
+ *          same executable share the same pages, and these stay cached after
+ *          the last process detaches the region, until the executable is
+ *          modified or memory runs short.
+ * 
+ * @param inode  Inode of the executable file.
+ * @param off    File offset.
+ * @param filesz Size of the text in the file (in bytes).
+ * @param memsz  Size of the text in memory (in bytes).
+ * 
+ * @returns Upon success a pointer to a (locked) memory region is returned. Upon
+ *          failure, a NULL pointer is returned instead.
+ */
+PUBLIC struct region *textreg
+(struct inode *inode, off_t off, size_t filesz, size_t memsz)
+{
+	struct region *reg; /* Memory region. */
+	
+	/* Search text cache. */
+	for (reg = &regtab[0]; reg < &regtab[NR_REGIONS]; reg++)
+	{
+		/* Skip free and other kinds of regions. */
+		if ((reg->flags & ~REGION_LOCKED) != (REGION_SHARED | REGION_STICKY))
+			continue;
+		
+		/* Found. */
+		if ((reg->file.inode == inode) && (reg->file.off == off) &&
+			(reg->file.size == filesz) && 
+			(reg->size == ALIGN(memsz, PAGE_SIZE)))
+		{
+			lockreg(reg);
+			return (reg);
+		}
+	}
+	
+	/* Failed to allocate region. */
+	reg = allocreg(MAY_READ | MAY_EXEC, memsz, REGION_SHARED | REGION_STICKY);
+	if (reg == NULL)
+		return (NULL);
+	
+	loadreg(inode, reg, off, filesz);
+	inode->flags |= INODE_TEXT;
+	
+	return (reg);
+}
+
+/**
+ * @brief Drops the cached text of an executable.
+ * 
+ * @details Text regions of @p inode are no longer handed out by textreg(), so
+ *          that later executions see the new contents of the file. Regions
+ *          that are not attached to any process are freed right away, and
+ *          the others when the last process detaches them.
+ * 
+ * @param inode Inode of the executable file.
+ */
+PUBLIC void droptext(struct inode *inode)
+{
+	struct region *reg; /* Working memory region. */
+	
+	inode->flags &= ~INODE_TEXT;
+	dropexec(inode);
+	
+	for (reg = &regtab[0]; reg < &regtab[NR_REGIONS]; reg++)
+	{
+		/* Skip other regions. */
+		if (!(reg->flags & REGION_STICKY) || (reg->file.inode != inode))
+			continue;
+		
+		reg->flags &= ~REGION_STICKY;
+		
+		/* Not attached. */
+		if (reg->count == 0)
+			freereg(reg);
+	}
+}
+
+/**
+ * @brief Frees a cached text region that is not in use.
+ * 
+ * @returns Zero if a memory region was freed, and non-zero otherwise.
+ */
+PUBLIC int shrinktext(void)
+{
+	struct region *reg; /* Working memory region. */
+	
+	for (reg = &regtab[0]; reg < &regtab[NR_REGIONS]; reg++)
+	{
+		/* Skip regions in use. */
+		if (!(reg->flags & REGION_STICKY) || (reg->count > 0))
+			continue;
+		
+		/* Locked. */
+		if (reg->flags & REGION_LOCKED)
+			continue;
+		
+		reg->flags &= ~REGION_STICKY;
+		freereg(reg);
+		
+		return (0);
+	}
+	
+	return (-1);
+}
+
+/**
+ * @brief Discards pages of a memory region.
+ * 
+ * @details Pages in the range are released, and turned back into demand zero
+ *          pages, so that their frames and swap space are given back right
+ *          away while the range stays valid. Only private anonymous regions
+ *          may be discarded, since pages of shared regions may still be seen
+ *          by other processes, and pages of file mappings could not be told
+ *          apart from data read from the file.
+ * 
+ * @param proc Process where the memory region is attached to.
+ * @param preg Process region where the memory region is attached.
+ * @param addr Start address of the range (page aligned).
+ * @param size Size of the range (in bytes).
+ * 
+ * @returns Zero upon success, and a negative error code otherwise.
+ */
+PUBLIC int discardreg(struct process *proc, struct pregion *preg, addr_t addr, size_t size)
+{
+	addr_t a;           /* Working address.       */
+	struct pte *pg;     /* Working page.          */
+	struct region *reg; /* Working memory region. */
+	
+	reg = preg->reg;
+	size = ALIGN(size, PAGE_SIZE);
+	
+	/* Range not within region. */
+	if ((!withinreg(preg, addr)) || (!withinreg(preg, addr + size - 1)))
+		return (-ENOMEM);
+	
+	/* Not a private anonymous region. */
+	if ((reg->flags & REGION_SHARED) || (reg->file.inode != NULL))
+		return (-EINVAL);
+	
+	/* Locked in memory. */
+	if (reg->nlocks > 0)
+		return (-EINVAL);
+	
+	lockreg(reg);
+	
+	for (a = addr; a < addr + size; a += PAGE_SIZE)
+	{
+		/* Stop sharing page table with forked regions. */
+		if (cowpgtab(proc, preg, a))
+		{
+			unlockreg(reg);
+			return (-ENOMEM);
+		}
+		
+		/* Huge pages cannot be partially released. */
+		splitpgtab(proc, a);
+		
+		pg = (reg->flags & REGION_DOWNWARDS) ?
+			&reg->pgtab[REGION_PGTABS-(PGTAB(preg->start)-PGTAB(a))-1][PG(a)]:
+			&reg->pgtab[PGTAB(a) - PGTAB(preg->start)][PG(a)];
+		
+		/* Already demand zero. */
+		if ((!pg->present) && (pg->zero))
+			continue;
+		
+		freeupg(pg);
+		markpg(pg, PAGE_ZERO);
+	}
+	
+	/* Flush released pages. */
+	if (proc == curr_proc)
+		tlb_flush_range(addr, size);
+	
+	unlockreg(reg);
+	
+	return (0);
+}
+
+/**
+ * @brief Locks a memory region in memory.
+ * 
+ * @details The memory region is marked as locked, so that page replacement
+ *          skips its pages, and these are faulted in right away. Pages of
+ *          private writable regions are faulted in for writing, so that no
+ *          copy on write is left to be done later on. Memory locked by
+ *          processes of a user, other than the superuser, is bounded by
+ *          #MLOCK_MAX.
+ * 
+ * @param proc Process where the memory region is attached to, which shall be
+ *             the current process.
+ * @param preg Process region where the memory region is attached.
+ * 
+ * @returns Zero upon success, and a negative error code otherwise.
+ */
+PUBLIC int mlockreg(struct process *proc, struct pregion *preg)
+{
+	int write;          /* Fault pages for writing? */
+	size_t n;           /* Memory locked by user.   */
+	addr_t a;           /* Working address.         */
+	addr_t base;        /* Lowest address.          */
+	struct process *p;  /* Working process.         */
+	struct region *reg; /* Working memory region.   */
+	
+	/* Nothing to be done. */
+	if (preg->locked)
+		return (0);
+	
+	reg = preg->reg;
+	
+	/* Per-user limit exceeded. */
+	if (!IS_SUPERUSER(proc))
+	{
+		n = 0;
+		for (p = FIRST_PROC; p <= LAST_PROC; p++)
+		{
+			if ((IS_VALID(p)) && (p->uid == proc->uid))
+				n += lockedreg(p);
+		}
+		
+		if (n + reg->size > MLOCK_MAX)
+			return (-ENOMEM);
+	}
+	
+	preg->locked = 1;
+	reg->nlocks++;
+	
+	write = (!(reg->flags & REGION_SHARED)) && (reg->mode & MAY_WRITE);
+	base = (reg->flags & REGION_DOWNWARDS) ?
+		preg->start + 1 - reg->size : preg->start;
+	
+	/* Fault pages in. */
+	for (a = base; a < base + reg->size; a += PAGE_SIZE)
+	{
+		if (faultupg(a, write))
+		{
+			munlockreg(preg);
+			return (-EAGAIN);
+		}
+	}
+	
+	return (0);
+}
+
+/**
+ * @brief Unlocks a memory region.
+ * 
+ * @param preg Process region where the memory region is attached.
+ */
+PUBLIC void munlockreg(struct pregion *preg)
+{
+	/* Nothing to be done. */
+	if (!preg->locked)
+		return;
+	
+	preg->locked = 0;
+	preg->reg->nlocks--;
+}
+
+/**
+ * @brief Gets the amount of memory that a process has locked.
+ * 
+ * @param proc Process to be queried.
+ * 
+ * @returns The size (in bytes) of the memory regions that @p proc has locked
+ *          in memory.
+ */
+PUBLIC size_t lockedreg(struct process *proc)
+{
+	size_t n; /* Locked memory. */
+	
+	n = 0;
+	for (unsigned i = 0; i < proc->npregs; i++)
+	{
+		if (proc->pmap[i]->locked)
+			n += proc->pmap[i]->reg->size;
+	}
+	
+	return (n);
+}
+
 /**
  * @brief Changes the size of memory region.
  * 
@@ -598,7 +1167,8 @@ PUBLIC struct region *dupreg(struct region *reg)
  */
 PUBLIC int growreg(struct process *proc, struct pregion *preg, ssize_t size)
 {
-	struct region *reg;
+	unsigned i;         /* Loop index.            */
+	struct region *reg; /* Working memory region. */
 	
 	/* Attached shared regions may not grow. */
 	if ((reg = preg->reg)->flags & REGION_SHARED)
@@ -608,6 +1178,16 @@ PUBLIC int growreg(struct process *proc, struct pregion *preg, ssize_t size)
 	if (!(reg->flags & (REGION_DOWNWARDS | REGION_UPWARDS)))
 		return (-EINVAL);
 	
+	/* Stop sharing page tables with forked regions. */
+	for (i = 0; i < REGION_PGTABS; i++)
+	{
+		if (reg->pgtab[i] == NULL)
+			continue;
+		
+		if (cowpgtab(proc, preg, pgtabaddr(preg, i)))
+			return (-ENOMEM);
+	}
+	
 	/* Contract region */
 	if (size < 0)
 		contract(proc, reg, -size);
@@ -640,36 +1220,41 @@ PUBLIC int growreg(struct process *proc, struct pregion *preg, ssize_t size)
  *          returned. Upon failure, a NULL pointer is returned instead.
  */
 PUBLIC struct pregion *findreg(struct process *proc, addr_t addr)
-{        
-	struct region *reg;   /* Working memory region.  */
+{
+	unsigned lo, hi, mid; /* Search bounds.          */
 	struct pregion *preg; /* Working process region. */
 	
-	/* Find associated region. */
-	for (preg = &proc->pregs[0]; preg < &proc->pregs[NR_PREGIONS]; preg++)
+	/* Find last region that starts at or below addr. */
+	lo = 0;
+	hi = proc->npregs;
+	while (lo < hi)
 	{
-		/* Skip invalid regions. */
-		if ((reg = preg->reg) == NULL)
-			continue;
+		mid = (lo + hi)/2;
 		
-		/* Region grows downwards. */
-		if (reg->flags & REGION_DOWNWARDS)
-		{
-			if (addr <= preg->start)
-			{
-				if (addr >= preg->start - REGION_SIZE)
-					return (preg);
-			}
-		}
-		
-		/* Region grows upwards. */
+		if (pregbase(proc->pmap[mid]) <= addr)
+			lo = mid + 1;
 		else
-		{
-			if (addr >= preg->start)
-			{
-				if (addr < preg->start + REGION_SIZE)
-					return (preg);
-			}
-		}
+			hi = mid;
+	}
+	
+	/* No such region. */
+	if (lo == 0)
+		return (NULL);
+	
+	preg = proc->pmap[lo - 1];
+	
+	/* Region grows downwards. */
+	if (preg->reg->flags & REGION_DOWNWARDS)
+	{
+		if (addr <= preg->start)
+			return (preg);
+	}
+	
+	/* Region grows upwards. */
+	else
+	{
+		if (addr < preg->start + REGION_SIZE)
+			return (preg);
 	}
 
 	return (NULL);
@@ -743,6 +1328,44 @@ PUBLIC int loadreg
 	return (0);
 }
 
+/**
+ * @brief Gets memory region statistics.
+ * 
+ * @param buf Location where statistics shall be stored.
+ */
+PUBLIC void regstat(struct vmstat *buf)
+{
+	struct region *reg;
+	
+	buf->regions = 0;
+	for (reg = &regtab[0]; reg < &regtab[NR_REGIONS]; reg++)
+	{
+		if (!(reg->flags & REGION_FREE))
+			buf->regions++;
+	}
+}
+
+/**
+ * @brief Gets memory region lock statistics.
+ * 
+ * @details Gets statistics about memory region locks, along with the
+ *          regions in use whose locks were waited for the most, and stores
+ *          them in the location pointed to by @p buf.
+ * 
+ * @param buf Location where statistics shall be stored.
+ */
+PUBLIC void reglockstat(struct lockstat *buf)
+{
+	struct region *reg;
+	
+	lock_stat(LOCK_REGION, buf);
+	for (reg = &regtab[0]; reg < &regtab[NR_REGIONS]; reg++)
+	{
+		if (!(reg->flags & REGION_FREE))
+			lock_hot(buf, 0, reg - regtab, reg->waits);
+	}
+}
+
 /**
  * @brief Initializes memory regions.
  */
@@ -0,0 +1,146 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include <nanvix/region.h>
+#include <nanvix/shm.h>
+
+/**
+ * @brief Shared memory segment table.
+ */
+PRIVATE struct shm shmtab[SHM_MAX];
+
+/**
+ * @brief Searches for a shared memory segment.
+ * 
+ * @param key Key of the segment.
+ * 
+ * @returns The segment that has key @p key, or NULL if there is none.
+ */
+PUBLIC struct shm *shm_lookup(unsigned key)
+{
+	struct shm *shm;
+	
+	for (shm = &shmtab[0]; shm < &shmtab[SHM_MAX]; shm++)
+	{
+		if ((shm->reg != NULL) && (shm->key == key))
+			return (shm);
+	}
+	
+	return (NULL);
+}
+
+/**
+ * @brief Allocates a shared memory segment.
+ * 
+ * @details The segment is backed by a shared memory region whose pages are
+ *          zero filled on demand. The segment table holds a reference to the
+ *          region, so that the segment outlives its attachments until it is
+ *          destroyed.
+ * 
+ * @param key  Key of the segment.
+ * @param size Size of the segment (in bytes).
+ * 
+ * @returns A new segment, or NULL if there are no free segments or memory
+ *          regions.
+ * 
+ * @note No segment with key @p key must exist.
+ */
+PUBLIC struct shm *shm_alloc(unsigned key, size_t size)
+{
+	struct shm *shm;
+	struct region *reg;
+	
+	for (shm = &shmtab[0]; shm < &shmtab[SHM_MAX]; shm++)
+	{
+		/* Found. */
+		if (shm->reg == NULL)
+			goto found;
+	}
+	
+	return (NULL);
+
+found:
+	
+	if ((reg = allocreg(MAY_READ | MAY_WRITE, size, REGION_SHARED)) == NULL)
+		return (NULL);
+	
+	reg->count++;
+	unlockreg(reg);
+	
+	shm->key = key;
+	shm->size = size;
+	shm->reg = reg;
+	
+	return (shm);
+}
+
+/**
+ * @brief Gets a shared memory segment.
+ * 
+ * @param shmid ID of the segment.
+ * 
+ * @returns The segment whose ID is @p shmid, or NULL if @p shmid does not
+ *          identify a segment in use.
+ */
+PUBLIC struct shm *shm_get(int shmid)
+{
+	if ((shmid < 0) || (shmid >= SHM_MAX))
+		return (NULL);
+	
+	return ((shmtab[shmid].reg != NULL) ? &shmtab[shmid] : NULL);
+}
+
+/**
+ * @brief Gets the ID of a shared memory segment.
+ * 
+ * @param shm Shared memory segment.
+ * 
+ * @returns The ID of @p shm.
+ */
+PUBLIC int shm_id(const struct shm *shm)
+{
+	return (shm - shmtab);
+}
+
+/**
+ * @brief Destroys a shared memory segment.
+ * 
+ * @details The segment is removed from the table at once, but its memory
+ *          remains attached to the processes that are still using it, and
+ *          is released when the last of them detaches it.
+ * 
+ * @param shm Shared memory segment.
+ */
+PUBLIC void shm_free(struct shm *shm)
+{
+	struct region *reg;
+	
+	reg = shm->reg;
+	shm->reg = NULL;
+	
+	lockreg(reg);
+	reg->count--;
+	unlockreg(reg);
+	
+	if (reg->count == 0)
+		freereg(reg);
+}
@@ -0,0 +1,283 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/klib.h>
+#include <nanvix/mm.h>
+
+/**
+ * @brief Null object index.
+ */
+#define SLAB_NULL 0xffff
+
+/**
+ * @brief Slab.
+ * 
+ * @details A slab is a kernel page carved into objects of a cache. The slab
+ *          header sits at the start of the page, followed by the free list
+ *          links and the objects. Free objects are linked by index rather
+ *          than through their contents, so they stay in their constructed
+ *          state.
+ */
+struct kslab
+{
+	struct kcache *cache;   /**< Cache of the slab.            */
+	struct kslab *prev;     /**< Previous slab with free objs. */
+	struct kslab *next;     /**< Next slab with free objs.     */
+	unsigned inuse;         /**< Objects in use.               */
+	unsigned short free;    /**< First free object.            */
+	unsigned short link[1]; /**< Next free object.             */
+};
+
+/**
+ * @brief Returns the address of an object of a slab.
+ * 
+ * @param s Slab.
+ * @param i Object index.
+ */
+#define SLAB_OBJ(s, i) \
+	((void *)((char *)(s) + (s)->cache->offset + (i)*(s)->cache->size))
+
+/**
+ * @brief Size classes of the general purpose allocator.
+ */
+PRIVATE struct kcache kmalloc_caches[] = {
+	KCACHE("kmalloc-16",     16, NULL),
+	KCACHE("kmalloc-32",     32, NULL),
+	KCACHE("kmalloc-64",     64, NULL),
+	KCACHE("kmalloc-128",   128, NULL),
+	KCACHE("kmalloc-256",   256, NULL),
+	KCACHE("kmalloc-512",   512, NULL),
+	KCACHE("kmalloc-1024", 1024, NULL),
+	KCACHE("kmalloc-2048", 2048, NULL)
+};
+
+/**
+ * @brief Number of size classes.
+ */
+#define NR_KMALLOC_CACHES \
+	((int)(sizeof(kmalloc_caches)/sizeof(kmalloc_caches[0])))
+
+/**
+ * @brief Removes a slab from the list of slabs with free objects.
+ * 
+ * @param slab Target slab.
+ */
+PRIVATE void slab_unlink(struct kslab *slab)
+{
+	if (slab->prev != NULL)
+		slab->prev->next = slab->next;
+	else
+		slab->cache->slabs = slab->next;
+	if (slab->next != NULL)
+		slab->next->prev = slab->prev;
+	slab->prev = NULL;
+	slab->next = NULL;
+}
+
+/**
+ * @brief Inserts a slab in the list of slabs with free objects.
+ * 
+ * @param slab Target slab.
+ */
+PRIVATE void slab_link(struct kslab *slab)
+{
+	slab->prev = NULL;
+	slab->next = slab->cache->slabs;
+	if (slab->next != NULL)
+		slab->next->prev = slab;
+	slab->cache->slabs = slab;
+}
+
+/**
+ * @brief Adds a slab to a cache.
+ * 
+ * @details Grabs a kernel page, carves it into objects, and runs the cache
+ *          constructor on each of them.
+ * 
+ * @param cache Target cache.
+ * 
+ * @returns Upon success, a pointer to the new slab is returned. Upon failure,
+ *          a NULL pointer is returned instead.
+ */
+PRIVATE struct kslab *slab_grow(struct kcache *cache)
+{
+	unsigned i;         /* Loop index.    */
+	unsigned n;         /* Header size.   */
+	struct kslab *slab; /* Working slab.  */
+	
+	/* Lay out slabs. */
+	if (cache->nper == 0)
+	{
+		/* Objects must hold at least a word, and be word aligned. */
+		cache->size = ALIGN(cache->size, sizeof(int));
+		
+		cache->nper = (PAGE_SIZE - sizeof(struct kslab)) / 
+			(cache->size + sizeof(unsigned short));
+		
+		/* Too big. */
+		if ((cache->nper == 0) || (cache->nper >= SLAB_NULL))
+			kpanic("mm: bad object size for cache %s", cache->name);
+		
+		n = sizeof(struct kslab) + (cache->nper - 1)*sizeof(unsigned short);
+		cache->offset = ALIGN(n, sizeof(int));
+		
+		/* Alignment padding may have stolen the last object. */
+		if (cache->offset + cache->nper*cache->size > PAGE_SIZE)
+			cache->nper--;
+	}
+	
+	if ((slab = getkpg(0)) == NULL)
+		return (NULL);
+	
+	slab->cache = cache;
+	slab->inuse = 0;
+	slab->free = 0;
+	for (i = 0; i < cache->nper; i++)
+	{
+		slab->link[i] = (i + 1 < cache->nper) ? i + 1 : SLAB_NULL;
+		
+		if (cache->ctor != NULL)
+			cache->ctor(SLAB_OBJ(slab, i));
+	}
+	
+	slab_link(slab);
+	cache->nslabs++;
+	
+	return (slab);
+}
+
+/**
+ * @brief Allocates an object from a cache.
+ * 
+ * @param cache Target cache.
+ * 
+ * @returns Upon success, a pointer to a constructed object is returned. Upon
+ *          failure, a NULL pointer is returned instead.
+ */
+PUBLIC void *kcache_alloc(struct kcache *cache)
+{
+	unsigned i;         /* Object index. */
+	struct kslab *slab; /* Working slab. */
+	
+	/* Grow cache. */
+	if ((slab = cache->slabs) == NULL)
+	{
+		if ((slab = slab_grow(cache)) == NULL)
+			return (NULL);
+	}
+	
+	i = slab->free;
+	slab->free = slab->link[i];
+	slab->inuse++;
+	cache->nobjs++;
+	
+	/* Slab is now full. */
+	if (slab->free == SLAB_NULL)
+		slab_unlink(slab);
+	
+	return (SLAB_OBJ(slab, i));
+}
+
+/**
+ * @brief Releases an object to its cache.
+ * 
+ * @details The object shall be returned in its constructed state. A slab that
+ *          has no objects in use is given back to the kernel page pool, unless
+ *          it is the only slab of the cache with free objects.
+ * 
+ * @param obj Object to be released.
+ */
+PUBLIC void kcache_free(void *obj)
+{
+	unsigned i;           /* Object index.  */
+	struct kslab *slab;   /* Working slab.  */
+	struct kcache *cache; /* Working cache. */
+	
+	slab = (struct kslab *)(ADDR(obj) & PAGE_MASK);
+	cache = slab->cache;
+	i = ((char *)obj - (char *)SLAB_OBJ(slab, 0))/cache->size;
+	
+	/* Double free. */
+	if (slab->inuse == 0)
+		kpanic("mm: releasing object twice");
+	
+	/* Slab was full. */
+	if (slab->free == SLAB_NULL)
+		slab_link(slab);
+	
+	slab->link[i] = slab->free;
+	slab->free = i;
+	slab->inuse--;
+	cache->nobjs--;
+	
+	/* Give back empty slab. */
+	if ((slab->inuse == 0) && ((slab->prev != NULL) || (slab->next != NULL)))
+	{
+		slab_unlink(slab);
+		cache->nslabs--;
+		putkpg(slab);
+	}
+}
+
+/**
+ * @brief Allocates kernel memory.
+ * 
+ * @details Small requests are served from size class caches, and requests
+ *          larger than the biggest class take a whole kernel page.
+ * 
+ * @param size Number of bytes to allocate.
+ * 
+ * @returns Upon success, a pointer to the allocated memory is returned. Upon
+ *          failure, a NULL pointer is returned instead.
+ */
+PUBLIC void *kmalloc(size_t size)
+{
+	int i; /* Loop index. */
+	
+	for (i = 0; i < NR_KMALLOC_CACHES; i++)
+	{
+		if (size <= kmalloc_caches[i].size)
+			return (kcache_alloc(&kmalloc_caches[i]));
+	}
+	
+	/* Too big. */
+	if (size > PAGE_SIZE)
+		return (NULL);
+	
+	return (getkpg(0));
+}
+
+/**
+ * @brief Releases kernel memory.
+ * 
+ * @param ptr Memory allocated by kmalloc().
+ */
+PUBLIC void kfree(void *ptr)
+{
+	/* Nothing to be done. */
+	if (ptr == NULL)
+		return;
+	
+	/* Slab objects never start a page. */
+	if (!(ADDR(ptr) & ~PAGE_MASK))
+		putkpg(ptr);
+	else
+		kcache_free(ptr);
+}
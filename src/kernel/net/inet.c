@@ -0,0 +1,387 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/fs.h>
+#include <nanvix/klib.h>
+#include <nanvix/mm.h>
+#include <nanvix/net.h>
+#include <nanvix/pm.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+
+/*
+ * Ports that only the superuser may bind to.
+ */
+#define IPPORT_RESERVED 1024
+
+/*
+ * Gets an Internet socket address from user space.
+ */
+PRIVATE int inet_sockaddr(const struct sockaddr *addr, socklen_t len, struct sockaddr_in *sin)
+{
+	/* Bad address. */
+	if ((addr == NULL) || (len < sizeof(struct sockaddr_in)))
+		return (-EINVAL);
+	if (!chkmem(addr, sizeof(struct sockaddr_in), MAY_READ))
+		return (-EINVAL);
+	
+	kmemcpy(sin, addr, sizeof(struct sockaddr_in));
+	
+	/* Wrong address family. */
+	if (sin->sin_family != AF_INET)
+		return (-EAFNOSUPPORT);
+	
+	return (0);
+}
+
+/*
+ * Copies an Internet socket address out, truncating it to *lenp bytes.
+ */
+PRIVATE void inet_putaddr(const struct sockaddr_in *sin, struct sockaddr *addr, socklen_t *lenp)
+{
+	socklen_t len;
+	
+	len = (*lenp < sizeof(struct sockaddr_in)) ? *lenp : sizeof(struct sockaddr_in);
+	kmemcpy(addr, sin, len);
+	*lenp = sizeof(struct sockaddr_in);
+}
+
+/**
+ * @brief Attaches a protocol control block to an Internet socket.
+ * 
+ * @param so       Socket.
+ * @param protocol Protocol (zero for the default one).
+ * 
+ * @returns Zero on success, and a negative error code otherwise.
+ */
+PUBLIC int inet_attach(struct socket *so, int protocol)
+{
+	if (so->type == SOCK_STREAM)
+	{
+		/* Unsupported protocol. */
+		if ((protocol != 0) && (protocol != IPPROTO_TCP))
+			return (-EPROTONOSUPPORT);
+		
+		return (tcp_attach(so));
+	}
+	
+	/* Unsupported protocol. */
+	if ((protocol != 0) && (protocol != IPPROTO_UDP))
+		return (-EPROTONOSUPPORT);
+	
+	return (udp_attach(so));
+}
+
+/**
+ * @brief Detaches the protocol control block of an Internet socket.
+ * 
+ * @param so Socket.
+ */
+PUBLIC void inet_release(struct socket *so)
+{
+	/* Never attached. */
+	if (so->pcb == NULL)
+		return;
+	
+	if (so->type == SOCK_STREAM)
+		tcp_detach(so);
+	else
+		udp_detach(so);
+}
+
+/**
+ * @brief Binds an Internet socket to a local address.
+ * 
+ * @param so   Socket.
+ * @param addr Local address.
+ * @param len  Length of the local address.
+ * 
+ * @returns Zero on success, and a negative error code otherwise.
+ */
+PUBLIC int inet_bind(struct socket *so, const struct sockaddr *addr, socklen_t len)
+{
+	int ret;                /* Return value.  */
+	struct sockaddr_in sin; /* Local address. */
+	
+	if ((ret = inet_sockaddr(addr, len, &sin)) < 0)
+		return (ret);
+	
+	/* Not one of ours. */
+	if ((sin.sin_addr.s_addr != INADDR_ANY) &&
+		((net_if == NULL) || (sin.sin_addr.s_addr != net_if->addr)))
+		return (-EADDRNOTAVAIL);
+	
+	/* Reserved port. */
+	if ((sin.sin_port != 0) && (ntohs(sin.sin_port) < IPPORT_RESERVED) &&
+		(!IS_SUPERUSER(curr_proc)))
+		return (-EACCES);
+	
+	if (so->type == SOCK_STREAM)
+		return (tcp_bind(so, sin.sin_addr.s_addr, sin.sin_port));
+	
+	return (udp_bind(so, sin.sin_addr.s_addr, sin.sin_port));
+}
+
+/**
+ * @brief Listens for connections on an Internet socket.
+ * 
+ * @param so      Socket.
+ * @param backlog Connections that may wait to be accepted.
+ * 
+ * @returns Zero on success, and a negative error code otherwise.
+ */
+PUBLIC int inet_listen(struct socket *so, int backlog)
+{
+	int ret;
+	
+	if ((ret = tcp_listen(so, backlog)) < 0)
+		return (ret);
+	
+	so->flags |= SOCKET_LISTEN;
+	
+	return (0);
+}
+
+/**
+ * @brief Accepts a connection on an Internet socket.
+ * 
+ * @param so       Listening socket.
+ * @param nonblock Do not block?
+ * 
+ * @returns The socket of the new connection. Upon failure, NULL is returned
+ *          and the error code is left in the current process.
+ */
+PUBLIC struct socket *inet_accept(struct socket *so, int nonblock)
+{
+	return (tcp_accept(so, nonblock));
+}
+
+/**
+ * @brief Connects an Internet socket.
+ * 
+ * @details Stream sockets set up a connection, and datagram sockets
+ *          just take a default destination.
+ * 
+ * @param so       Socket.
+ * @param addr     Peer address.
+ * @param len      Length of the peer address.
+ * @param nonblock Do not wait for the connection?
+ * 
+ * @returns Zero on success, and a negative error code otherwise.
+ */
+PUBLIC int inet_connect(struct socket *so, const struct sockaddr *addr, socklen_t len, int nonblock)
+{
+	int ret;                /* Return value. */
+	struct sockaddr_in sin; /* Peer address. */
+	
+	if ((ret = inet_sockaddr(addr, len, &sin)) < 0)
+		return (ret);
+	
+	/* Bad address. */
+	if ((sin.sin_addr.s_addr == INADDR_ANY) || (sin.sin_port == 0))
+		return (-EADDRNOTAVAIL);
+	
+	if (so->type == SOCK_STREAM)
+		return (tcp_connect(so, sin.sin_addr.s_addr, sin.sin_port, nonblock));
+	
+	return (udp_connect(so, sin.sin_addr.s_addr, sin.sin_port));
+}
+
+/**
+ * @brief Sends data through an Internet socket.
+ * 
+ * @param so     Socket.
+ * @param iov    Data buffers.
+ * @param iovcnt Number of data buffers.
+ * @param addr   Destination address (may be NULL).
+ * @param alen   Length of the destination address.
+ * @param flags  Message flags.
+ * 
+ * @returns The number of bytes sent. Upon failure, -1 is returned and the
+ *          error code is left in the current process.
+ */
+PUBLIC ssize_t inet_send(struct socket *so, const struct iovec *iov, int iovcnt, const struct sockaddr *addr, socklen_t alen, int flags)
+{
+	int k;                  /* Loop index.   */
+	int ret;                /* Return value. */
+	size_t n;               /* Bytes to go.  */
+	struct sockaddr_in sin; /* Destination.  */
+	
+	n = 0;
+	for (k = 0; k < iovcnt; k++)
+		n += iov[k].iov_len;
+	
+	if (so->type == SOCK_STREAM)
+	{
+		/* Stream sockets have a fixed destination. */
+		if (addr != NULL)
+		{
+			curr_proc->errno = (so->flags & SOCKET_CONNECTED) ?
+				-EISCONN : -EOPNOTSUPP;
+			return (-1);
+		}
+		
+		/* Nothing to send. */
+		if (n == 0)
+			return (0);
+		
+		return (tcp_send(so, iov, iovcnt, n, flags));
+	}
+	
+	if (addr == NULL)
+		return (udp_send(so, iov, iovcnt, n, NULL, flags));
+	
+	/* Bad destination. */
+	if ((ret = inet_sockaddr(addr, alen, &sin)) < 0)
+	{
+		curr_proc->errno = ret;
+		return (-1);
+	}
+	
+	return (udp_send(so, iov, iovcnt, n, &sin, flags));
+}
+
+/**
+ * @brief Receives data from an Internet socket.
+ * 
+ * @param so     Socket.
+ * @param iov    Data buffers.
+ * @param iovcnt Number of data buffers.
+ * @param addr   Where to store the sender address (may be NULL).
+ * @param alenp  Length of the sender address, updated on return.
+ * @param flags  Message flags, updated on return.
+ * 
+ * @returns The number of bytes received. Upon failure, -1 is returned and
+ *          the error code is left in the current process.
+ */
+PUBLIC ssize_t inet_recv(struct socket *so, const struct iovec *iov, int iovcnt, struct sockaddr *addr, socklen_t *alenp, int *flags)
+{
+	int k;                  /* Loop index.   */
+	ssize_t ret;            /* Return value. */
+	size_t n;               /* Bytes wanted. */
+	struct sockaddr_in sin; /* Sender.       */
+	
+	n = 0;
+	for (k = 0; k < iovcnt; k++)
+		n += iov[k].iov_len;
+	
+	if (so->type == SOCK_STREAM)
+	{
+		if ((ret = tcp_recv(so, iov, iovcnt, n, flags)) < 0)
+			return (ret);
+		
+		if (addr != NULL)
+			inet_name(so, 1, addr, alenp);
+		
+		return (ret);
+	}
+	
+	if ((ret = udp_recv(so, iov, iovcnt, n, &sin, flags)) < 0)
+		return (ret);
+	
+	if (addr != NULL)
+		inet_putaddr(&sin, addr, alenp);
+	
+	return (ret);
+}
+
+/**
+ * @brief Asserts which operations on an Internet socket would not block.
+ * 
+ * @param so Socket.
+ * 
+ * @returns The events that are ready.
+ */
+PUBLIC int inet_poll(struct socket *so)
+{
+	if (so->type == SOCK_STREAM)
+		return (tcp_poll(so));
+	
+	return (udp_poll(so));
+}
+
+/**
+ * @brief Gets the local or peer address of an Internet socket.
+ * 
+ * @param so    Socket.
+ * @param peer  Peer address?
+ * @param addr  Where to store the address.
+ * @param lenp  Length of the address, updated on return.
+ */
+PUBLIC void inet_name(struct socket *so, int peer, struct sockaddr *addr, socklen_t *lenp)
+{
+	struct sockaddr_in sin;
+	
+	kmemset(&sin, 0, sizeof(struct sockaddr_in));
+	sin.sin_family = AF_INET;
+	
+	if (so->type == SOCK_STREAM)
+		tcp_name(so, peer, &sin);
+	else
+		udp_name(so, peer, &sin);
+	
+	inet_putaddr(&sin, addr, lenp);
+}
+
+/**
+ * @brief Asserts if data can be sent in place to a file.
+ * 
+ * @details That is the case for TCP sockets, provided that the data
+ *          is in the linear kernel mapping, so that devices can get it.
+ * 
+ * @param out  Destination file.
+ * @param data Data.
+ * 
+ * @returns Non-zero if the data can be sent in place, and zero otherwise.
+ */
+PUBLIC int inet_zerocopy(const struct file *out, const void *data)
+{
+	struct inode *ip;  /* Destination inode. */
+	struct socket *so; /* Socket.            */
+	
+	ip = out->inode;
+	
+	/* Not a socket. */
+	if (!S_ISSOCK(ip->mode) || ((so = ip->sock) == NULL) || (so->inode != ip))
+		return (0);
+	
+	/* Not a TCP socket. */
+	if ((so->domain != AF_INET) || (so->type != SOCK_STREAM))
+		return (0);
+	
+	return (((addr_t)data >= KBASE_VIRT) && ((addr_t)data < INITRD_VIRT));
+}
+
+/**
+ * @brief Sends part of a block buffer in place through a TCP socket.
+ * 
+ * @param out Destination file.
+ * @param buf Block buffer. On success, the reference to it is taken.
+ * @param off Offset in the block buffer.
+ * @param n   Number of bytes.
+ * 
+ * @returns The number of bytes sent, or a negative error code. -ENOTSUP is
+ *          returned if the data has to be copied instead.
+ */
+PUBLIC ssize_t inet_sendbuf(struct file *out, buffer_t buf, size_t off, size_t n)
+{
+	return (tcp_sendbuf(out->inode->sock, buf, off, n, out->oflag & O_NONBLOCK));
+}
@@ -0,0 +1,996 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/clock.h>
+#include <nanvix/config.h>
+#include <nanvix/const.h>
+#include <nanvix/fs.h>
+#include <nanvix/hal.h>
+#include <nanvix/klib.h>
+#include <nanvix/mm.h>
+#include <nanvix/net.h>
+#include <nanvix/pm.h>
+#include <nanvix/timer.h>
+#include <nanvix/work.h>
+#include <errno.h>
+
+/*
+ * Room taken by a packet. Two of them fit in a page.
+ */
+#define NET_PKTSIZE (PAGE_SIZE/2)
+
+/*
+ * Packets must fit in their room.
+ */
+#if (NET_PKTSIZE < 1600)
+	#error "packets do not fit in half a page"
+#endif
+
+/* ARP entry states. */
+#define ARP_FREE     0 /* Free entry.          */
+#define ARP_PENDING  1 /* Request on its way.  */
+#define ARP_RESOLVED 2 /* Address known.       */
+#define ARP_FAILED   3 /* Nobody answered.     */
+
+/* ARP timeouts (in timer periods). */
+#define ARP_RETRY   10 /* Between requests.                */
+#define ARP_TRIES    3 /* Requests before giving up.       */
+#define ARP_NEGATIVE 50 /* Failures remembered for so long. */
+
+/* ARP operations. */
+#define ARP_REQUEST 1 /* Request. */
+#define ARP_REPLY   2 /* Reply.   */
+
+/* ICMP message types. */
+#define ICMP_ECHOREPLY 0 /* Echo reply.   */
+#define ICMP_ECHO      8 /* Echo request. */
+
+/*
+ * Broadcast hardware address.
+ */
+PRIVATE const uint8_t eth_bcast[ETH_ALEN] = {
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff
+};
+
+/*
+ * ARP table.
+ */
+PRIVATE struct
+{
+	int state;             /* State (see above).  */
+	in_addr_t addr;        /* Protocol address.   */
+	uint8_t mac[ETH_ALEN]; /* Hardware address.   */
+	unsigned tries;        /* Requests sent.      */
+	unsigned timeout;      /* Timer periods left. */
+} arptab[ARP_ENTRIES];
+
+/* Next ARP entry to be replaced. */
+PRIVATE unsigned arp_victim = 0;
+
+/* Free packets. */
+PRIVATE struct packet *freepkts = NULL;
+
+/* Number of free packets. */
+PRIVATE unsigned nfreepkts = 0;
+
+/* Acknowledged packets whose block buffers are to be released. */
+PRIVATE struct packet *deadpkts = NULL;
+
+/* Releases block buffers in process context. */
+PRIVATE struct work net_work;
+
+/* Protocol timer. */
+PRIVATE struct timer net_timer;
+
+/* Protocol timer expired? */
+PRIVATE volatile int net_ticked = 0;
+
+/* Transmit buffers freed? */
+PRIVATE volatile int net_txready = 0;
+
+/* Next IP datagram identification. */
+PRIVATE uint16_t ip_id = 0;
+
+/* Registered interfaces. */
+PRIVATE struct netif *netifs = NULL;
+
+/**
+ * @brief Interface that the network stack runs on.
+ */
+PUBLIC struct netif *net_if = NULL;
+
+/**
+ * @brief Processes waiting for packets, transmit buffers or
+ *        address resolutions.
+ */
+PUBLIC struct waitq net_chain = WAITQ_INITIALIZER;
+
+/*============================================================================*
+ *                                 Packets                                    *
+ *============================================================================*/
+
+/**
+ * @brief Takes a packet from the pool.
+ * 
+ * @returns A pointer to the packet, or NULL if the pool is empty.
+ * 
+ * @note Interrupts must be disabled.
+ */
+PUBLIC struct packet *net_alloc(void)
+{
+	struct packet *pkt;
+	
+	/* Pool is empty. */
+	if ((pkt = freepkts) == NULL)
+		return (NULL);
+	
+	freepkts = pkt->next;
+	nfreepkts--;
+	
+	pkt->next = NULL;
+	pkt->len = 0;
+	pkt->off = 0;
+	pkt->dlen = 0;
+	pkt->seq = 0;
+	pkt->tflags = 0;
+	pkt->zdata = NULL;
+	pkt->zlen = 0;
+	pkt->zbuf = NULL;
+	pkt->saddr = 0;
+	pkt->sport = 0;
+	
+	return (pkt);
+}
+
+/**
+ * @brief Puts a packet back in the pool.
+ * 
+ * @param pkt Packet.
+ * 
+ * @note Interrupts must be disabled.
+ */
+PUBLIC void net_free(struct packet *pkt)
+{
+	pkt->next = freepkts;
+	freepkts = pkt;
+	
+	/* Someone may be waiting for it. */
+	if (nfreepkts++ == 0)
+		wakeup(&net_chain);
+}
+
+/**
+ * @brief Puts a packet back in the pool once its block buffer is released.
+ * 
+ * @details Block buffers may only be released in process context, so this
+ *          is left to a kernel worker.
+ * 
+ * @param pkt Packet.
+ * 
+ * @note Interrupts must be disabled.
+ */
+PUBLIC void net_dead(struct packet *pkt)
+{
+	/* Nothing to release. */
+	if (pkt->zbuf == NULL)
+	{
+		net_free(pkt);
+		return;
+	}
+	
+	pkt->next = deadpkts;
+	deadpkts = pkt;
+	work_queue(&net_work);
+}
+
+/*
+ * Releases the block buffers of acknowledged packets.
+ */
+PRIVATE void net_reap(void *arg)
+{
+	struct packet *pkt;  /* Working packet. */
+	struct packet *next; /* Next packet.    */
+	
+	UNUSED(arg);
+	
+	disable_interrupts();
+	pkt = deadpkts;
+	deadpkts = NULL;
+	enable_interrupts();
+	
+	for ( ; pkt != NULL; pkt = next)
+	{
+		next = pkt->next;
+		
+		blklock(pkt->zbuf);
+		brelse(pkt->zbuf);
+		
+		disable_interrupts();
+		net_free(pkt);
+		enable_interrupts();
+	}
+}
+
+/*============================================================================*
+ *                                Checksums                                   *
+ *============================================================================*/
+
+/**
+ * @brief Adds data to an Internet checksum.
+ * 
+ * @param sum  Partial sum.
+ * @param data Data.
+ * @param n    Number of bytes.
+ * 
+ * @returns The new partial sum.
+ */
+PUBLIC uint32_t net_cksum(uint32_t sum, const void *data, size_t n)
+{
+	const uint8_t *p;
+	
+	p = data;
+	
+	for ( ; n > 1; n -= 2, p += 2)
+		sum += (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+	
+	/* Odd byte. */
+	if (n > 0)
+		sum += p[0];
+	
+	return (sum);
+}
+
+/**
+ * @brief Folds a partial sum into an Internet checksum.
+ * 
+ * @param sum Partial sum.
+ * 
+ * @returns The Internet checksum, ready to be stored.
+ */
+PUBLIC uint16_t net_fold(uint32_t sum)
+{
+	while (sum >> 16)
+		sum = (sum & 0xffff) + (sum >> 16);
+	
+	return ((uint16_t)~sum);
+}
+
+/**
+ * @brief Sums the pseudo header of a transport segment.
+ * 
+ * @param src   Source address.
+ * @param dst   Destination address.
+ * @param proto Transport protocol.
+ * @param len   Segment length.
+ * 
+ * @returns The partial sum of the pseudo header.
+ */
+PUBLIC uint32_t net_pseudo(in_addr_t src, in_addr_t dst, unsigned proto, size_t len)
+{
+	uint32_t sum;
+	
+	sum = (src & 0xffff) + (src >> 16);
+	sum += (dst & 0xffff) + (dst >> 16);
+	sum += htons(proto);
+	sum += htons(len);
+	
+	return (sum);
+}
+
+/*============================================================================*
+ *                                  Copies                                    *
+ *============================================================================*/
+
+/**
+ * @brief Gathers bytes from a scatter-gather list.
+ * 
+ * @param buf    Target buffer.
+ * @param iov    Scatter-gather list.
+ * @param iovcnt Number of entries in the list.
+ * @param off    Position in the list.
+ * @param n      Number of bytes.
+ * 
+ * @returns The number of bytes gathered.
+ */
+PUBLIC size_t net_gather
+(char *buf, const struct iovec *iov, int iovcnt, size_t off, size_t n)
+{
+	int k;        /* Loop index.     */
+	size_t i;     /* Bytes gathered. */
+	size_t chunk; /* Working chunk.  */
+	
+	for (k = 0, i = 0; (k < iovcnt) && (i < n); k++)
+	{
+		/* Skip what was gathered before. */
+		if (off >= iov[k].iov_len)
+		{
+			off -= iov[k].iov_len;
+			continue;
+		}
+		
+		chunk = iov[k].iov_len - off;
+		if (chunk > n - i)
+			chunk = n - i;
+		
+		kmemcpy(buf + i, (char *)iov[k].iov_base + off, chunk);
+		i += chunk;
+		off = 0;
+	}
+	
+	return (i);
+}
+
+/**
+ * @brief Scatters bytes to a scatter-gather list.
+ * 
+ * @param iov    Scatter-gather list.
+ * @param iovcnt Number of entries in the list.
+ * @param off    Position in the list.
+ * @param buf    Source buffer.
+ * @param n      Number of bytes.
+ * 
+ * @returns The number of bytes scattered.
+ */
+PUBLIC size_t net_scatter
+(const struct iovec *iov, int iovcnt, size_t off, const char *buf, size_t n)
+{
+	int k;        /* Loop index.      */
+	size_t i;     /* Bytes scattered. */
+	size_t chunk; /* Working chunk.   */
+	
+	for (k = 0, i = 0; (k < iovcnt) && (i < n); k++)
+	{
+		/* Skip what was scattered before. */
+		if (off >= iov[k].iov_len)
+		{
+			off -= iov[k].iov_len;
+			continue;
+		}
+		
+		chunk = iov[k].iov_len - off;
+		if (chunk > n - i)
+			chunk = n - i;
+		
+		kmemcpy((char *)iov[k].iov_base + off, buf + i, chunk);
+		i += chunk;
+		off = 0;
+	}
+	
+	return (i);
+}
+
+/*============================================================================*
+ *                                   ARP                                      *
+ *============================================================================*/
+
+/*
+ * Looks up an address in the ARP table.
+ */
+PRIVATE int arp_lookup(in_addr_t addr)
+{
+	unsigned i;
+	
+	for (i = 0; i < ARP_ENTRIES; i++)
+	{
+		if ((arptab[i].state != ARP_FREE) && (arptab[i].addr == addr))
+			return (i);
+	}
+	
+	return (-1);
+}
+
+/*
+ * Gets an ARP entry for an address, replacing an old one if needed.
+ */
+PRIVATE int arp_enter(in_addr_t addr)
+{
+	unsigned i;
+	
+	for (i = 0; i < ARP_ENTRIES; i++)
+	{
+		if (arptab[i].state == ARP_FREE)
+			goto found;
+	}
+	
+	i = arp_victim;
+	arp_victim = (arp_victim + 1) % ARP_ENTRIES;
+	
+found:
+	arptab[i].state = ARP_FREE;
+	arptab[i].addr = addr;
+	arptab[i].tries = 0;
+	arptab[i].timeout = 0;
+	
+	return (i);
+}
+
+/*
+ * Sends an ARP packet.
+ */
+PRIVATE void arp_send
+(struct netif *nif, unsigned op, const uint8_t *tha, in_addr_t tpa)
+{
+	struct packet *pkt; /* Packet.          */
+	struct eth_hdr *eh; /* Ethernet header. */
+	struct arp_hdr *ah; /* ARP header.      */
+	
+	/* Out of packets. */
+	if ((pkt = net_alloc()) == NULL)
+		return;
+	
+	eh = (struct eth_hdr *)pkt->buf;
+	ah = (struct arp_hdr *)&pkt->buf[NET_L3OFF];
+	
+	kmemcpy(eh->dst, (op == ARP_REQUEST) ? eth_bcast : tha, ETH_ALEN);
+	kmemcpy(eh->src, nif->mac, ETH_ALEN);
+	eh->type = htons(ETH_P_ARP);
+	
+	ah->htype = htons(1);
+	ah->ptype = htons(ETH_P_IP);
+	ah->hlen = ETH_ALEN;
+	ah->plen = sizeof(in_addr_t);
+	ah->op = htons(op);
+	kmemcpy(ah->sha, nif->mac, ETH_ALEN);
+	ah->spa = nif->addr;
+	kmemset(ah->tha, 0, ETH_ALEN);
+	if (op == ARP_REPLY)
+		kmemcpy(ah->tha, tha, ETH_ALEN);
+	ah->tpa = tpa;
+	
+	/* Short frames are padded. */
+	pkt->len = 60;
+	kmemset(&pkt->buf[NET_L3OFF + sizeof(struct arp_hdr)], 0,
+		pkt->len - NET_L3OFF - sizeof(struct arp_hdr));
+	
+	nif->xmit(nif, pkt->buf, pkt->len, NULL, 0);
+	
+	net_free(pkt);
+}
+
+/*
+ * Resolves the hardware address of a next hop.
+ */
+PRIVATE int arp_resolve(struct netif *nif, in_addr_t addr, uint8_t *mac)
+{
+	int i; /* ARP entry. */
+	
+	if ((i = arp_lookup(addr)) >= 0)
+	{
+		switch (arptab[i].state)
+		{
+			case ARP_RESOLVED:
+				kmemcpy(mac, arptab[i].mac, ETH_ALEN);
+				return (0);
+			
+			case ARP_FAILED:
+				return (-EHOSTUNREACH);
+			
+			default:
+				return (-EAGAIN);
+		}
+	}
+	
+	/* Ask who has it. */
+	i = arp_enter(addr);
+	arptab[i].state = ARP_PENDING;
+	arptab[i].tries = 1;
+	arptab[i].timeout = ARP_RETRY;
+	arp_send(nif, ARP_REQUEST, NULL, addr);
+	net_arm();
+	
+	return (-EAGAIN);
+}
+
+/*
+ * Handles an incoming ARP packet.
+ */
+PRIVATE void arp_input(struct netif *nif, struct packet *pkt)
+{
+	int i;              /* ARP entry.  */
+	struct arp_hdr *ah; /* ARP header. */
+	
+	ah = (struct arp_hdr *)&pkt->buf[NET_L3OFF];
+	
+	/* Not for IPv4 over Ethernet. */
+	if ((pkt->len < NET_L3OFF + sizeof(struct arp_hdr)) ||
+		(ah->htype != htons(1)) || (ah->ptype != htons(ETH_P_IP)) ||
+		(ah->hlen != ETH_ALEN) || (ah->plen != sizeof(in_addr_t)))
+		goto out;
+	
+	/* Bogus sender. */
+	if ((ah->spa == 0) || (ah->spa == nif->addr))
+		goto out;
+	
+	/*
+	 * Refresh what we know about the sender, and
+	 * learn about it if it is talking to us.
+	 */
+	if ((i = arp_lookup(ah->spa)) < 0)
+	{
+		if (ah->tpa != nif->addr)
+			goto out;
+		i = arp_enter(ah->spa);
+	}
+	
+	if (arptab[i].state != ARP_RESOLVED)
+	{
+		arptab[i].state = ARP_RESOLVED;
+		kmemcpy(arptab[i].mac, ah->sha, ETH_ALEN);
+		
+		/* Senders waiting for it may go on now. */
+		wakeup(&net_chain);
+		tcp_kick();
+	}
+	else
+		kmemcpy(arptab[i].mac, ah->sha, ETH_ALEN);
+	
+	/* Tell who we are. */
+	if ((ah->op == htons(ARP_REQUEST)) && (ah->tpa == nif->addr))
+		arp_send(nif, ARP_REPLY, ah->sha, ah->spa);
+	
+out:
+	net_free(pkt);
+}
+
+/*
+ * Ages the pending and failed entries of the ARP table.
+ */
+PRIVATE int arp_timer(void)
+{
+	unsigned i; /* Loop index.           */
+	int busy;   /* Anything left to age? */
+	
+	busy = 0;
+	
+	for (i = 0; i < ARP_ENTRIES; i++)
+	{
+		if ((arptab[i].state != ARP_PENDING) &&
+			(arptab[i].state != ARP_FAILED))
+			continue;
+		
+		busy = 1;
+		
+		if (--arptab[i].timeout > 0)
+			continue;
+		
+		/* Failed entries are forgotten. */
+		if (arptab[i].state == ARP_FAILED)
+			arptab[i].state = ARP_FREE;
+		
+		/* Give up. */
+		else if (arptab[i].tries >= ARP_TRIES)
+		{
+			arptab[i].state = ARP_FAILED;
+			arptab[i].timeout = ARP_NEGATIVE;
+			wakeup(&net_chain);
+		}
+		
+		/* Ask again. */
+		else
+		{
+			arptab[i].tries++;
+			arptab[i].timeout = ARP_RETRY;
+			arp_send(net_if, ARP_REQUEST, NULL, arptab[i].addr);
+		}
+	}
+	
+	return (busy);
+}
+
+/*============================================================================*
+ *                                 IP Layer                                   *
+ *============================================================================*/
+
+/**
+ * @brief Sends an IP datagram.
+ * 
+ * @details Fills in the IP and Ethernet headers of the packet pointed to by
+ *          @p pkt, whose transport segment ends at pkt->len and is followed
+ *          by pkt->zlen bytes that are sent in place, and hands the frame to
+ *          the interface. The packet still belongs to the caller afterwards,
+ *          since interfaces copy out the headers.
+ * 
+ * @param pkt   Packet.
+ * @param src   Source address.
+ * @param dst   Destination address.
+ * @param proto Transport protocol.
+ * 
+ * @returns Zero if the frame was sent. Otherwise, -EAGAIN if the next hop is
+ *          being resolved, -ENOBUFS if the interface is busy, or another
+ *          negative error code.
+ * 
+ * @note Interrupts must be disabled.
+ */
+PUBLIC int ip_output(struct packet *pkt, in_addr_t src, in_addr_t dst, unsigned proto)
+{
+	int ret;               /* Return value.      */
+	in_addr_t hop;         /* Next hop.          */
+	struct netif *nif;     /* Interface.         */
+	struct eth_hdr *eh;    /* Ethernet header.   */
+	struct ip_hdr *ih;     /* IP header.         */
+	uint8_t mac[ETH_ALEN]; /* Next hop hardware. */
+	
+	nif = net_if;
+	
+	/* Interface down. */
+	if (!netif_running(nif) || (nif->addr == 0))
+		return (-ENETDOWN);
+	
+	/* Route datagram. */
+	if ((dst == INADDR_BROADCAST) || (dst == (nif->addr | ~nif->netmask)))
+		kmemcpy(mac, eth_bcast, ETH_ALEN);
+	else
+	{
+		hop = dst;
+		if ((dst & nif->netmask) != (nif->addr & nif->netmask))
+		{
+			/* No route to host. */
+			if ((hop = nif->gateway) == 0)
+				return (-ENETUNREACH);
+		}
+		
+		if ((ret = arp_resolve(nif, hop, mac)) < 0)
+			return (ret);
+	}
+	
+	eh = (struct eth_hdr *)pkt->buf;
+	ih = (struct ip_hdr *)&pkt->buf[NET_L3OFF];
+	
+	ih->vhl = 0x45;
+	ih->tos = 0;
+	ih->len = htons(pkt->len - NET_L3OFF + pkt->zlen);
+	ih->id = htons(ip_id);
+	ip_id++;
+	ih->off = htons(0x4000);
+	ih->ttl = 64;
+	ih->proto = proto;
+	ih->sum = 0;
+	ih->src = src;
+	ih->dst = dst;
+	ih->sum = net_fold(net_cksum(0, ih, IP_HLEN));
+	
+	kmemcpy(eh->dst, mac, ETH_ALEN);
+	kmemcpy(eh->src, nif->mac, ETH_ALEN);
+	eh->type = htons(ETH_P_IP);
+	
+	return (nif->xmit(nif, pkt->buf, pkt->len, pkt->zdata, pkt->zlen));
+}
+
+/*
+ * Answers an ICMP echo request.
+ */
+PRIVATE void icmp_input(struct packet *pkt)
+{
+	struct icmp_hdr *ic; /* ICMP header. */
+	
+	ic = (struct icmp_hdr *)&pkt->buf[pkt->off];
+	
+	/* Not an echo request. */
+	if ((pkt->dlen < sizeof(struct icmp_hdr)) || (ic->type != ICMP_ECHO))
+		goto out;
+	
+	/* Bad checksum. */
+	if (net_fold(net_cksum(0, ic, pkt->dlen)) != 0)
+		goto out;
+	
+	/* Drop IP options. Copying forward is safe here. */
+	if (pkt->off != NET_L4OFF)
+	{
+		kmemcpy(&pkt->buf[NET_L4OFF], ic, pkt->dlen);
+		ic = (struct icmp_hdr *)&pkt->buf[NET_L4OFF];
+	}
+	
+	ic->type = ICMP_ECHOREPLY;
+	ic->sum = 0;
+	ic->sum = net_fold(net_cksum(0, ic, pkt->dlen));
+	pkt->len = NET_L4OFF + pkt->dlen;
+	
+	/* Broadcast pings are answered from our own address. */
+	ip_output(pkt, net_if->addr, pkt->saddr, IPPROTO_ICMP);
+	
+out:
+	net_free(pkt);
+}
+
+/*
+ * Handles an incoming IP datagram.
+ */
+PRIVATE void ip_input(struct netif *nif, struct packet *pkt)
+{
+	unsigned hlen;     /* Header length. */
+	unsigned len;      /* Total length.  */
+	struct ip_hdr *ih; /* IP header.     */
+	
+	ih = (struct ip_hdr *)&pkt->buf[NET_L3OFF];
+	
+	/* Too short. */
+	if (pkt->len < NET_L4OFF)
+		goto drop;
+	
+	hlen = (ih->vhl & 0xf) << 2;
+	len = ntohs(ih->len);
+	
+	/* Bad header. */
+	if (((ih->vhl >> 4) != 4) || (hlen < IP_HLEN) || (len < hlen) ||
+		(NET_L3OFF + len > pkt->len))
+		goto drop;
+	
+	/* Bad checksum. */
+	if (net_fold(net_cksum(0, ih, hlen)) != 0)
+		goto drop;
+	
+	/* Fragments are not reassembled. */
+	if (ih->off & htons(0x3fff))
+		goto drop;
+	
+	/* Not for us. */
+	if ((ih->dst != nif->addr) && (ih->dst != INADDR_BROADCAST) &&
+		(ih->dst != (nif->addr | ~nif->netmask)))
+		goto drop;
+	
+	/* Strip link padding. */
+	pkt->len = NET_L3OFF + len;
+	pkt->off = NET_L3OFF + hlen;
+	pkt->dlen = len - hlen;
+	pkt->saddr = ih->src;
+	
+	switch (ih->proto)
+	{
+		case IPPROTO_ICMP:
+			icmp_input(pkt);
+			return;
+		
+		case IPPROTO_UDP:
+			udp_input(pkt, ih->dst);
+			return;
+		
+		case IPPROTO_TCP:
+			/* Broadcast segments make no sense. */
+			if (ih->dst != nif->addr)
+				break;
+			tcp_input(pkt, ih->dst);
+			return;
+		
+		default:
+			break;
+	}
+	
+drop:
+	net_free(pkt);
+}
+
+/*
+ * Handles an incoming frame.
+ */
+PRIVATE void eth_input(struct netif *nif, struct packet *pkt)
+{
+	struct eth_hdr *eh; /* Ethernet header. */
+	
+	eh = (struct eth_hdr *)pkt->buf;
+	
+	/* Runt frame. */
+	if (pkt->len < ETH_HLEN)
+	{
+		net_free(pkt);
+		return;
+	}
+	
+	if (eh->type == htons(ETH_P_ARP))
+		arp_input(nif, pkt);
+	else if (eh->type == htons(ETH_P_IP))
+		ip_input(nif, pkt);
+	else
+		net_free(pkt);
+}
+
+/*============================================================================*
+ *                              Bottom Half                                   *
+ *============================================================================*/
+
+/**
+ * @brief Arms the protocol timer, unless it is already ticking.
+ * 
+ * @note Interrupts must be disabled.
+ */
+PUBLIC void net_arm(void)
+{
+	if (!TIMER_PENDING(&net_timer) && !net_ticked)
+		timer_add(&net_timer, ticks + NET_TICK);
+}
+
+/*
+ * Protocol timer expired. Work is left to the bottom half.
+ */
+PRIVATE void net_clock(void *arg)
+{
+	UNUSED(arg);
+	
+	net_ticked = 1;
+	mark_bh(BH_NET);
+}
+
+/**
+ * @brief Tells the network stack that frames were received.
+ * 
+ * @details Called by interface drivers from interrupt context, with further
+ *          receive interrupts turned off.
+ */
+PUBLIC void net_rx(void)
+{
+	mark_bh(BH_NET);
+}
+
+/**
+ * @brief Tells the network stack that transmit buffers were freed.
+ * 
+ * @details Called by interface drivers from interrupt context.
+ */
+PUBLIC void net_tx(void)
+{
+	net_txready = 1;
+	mark_bh(BH_NET);
+}
+
+/*
+ * Network bottom half. Frames are taken a budget at a time, letting
+ * interrupts in between them. A device that has more to give is left
+ * with its interrupts off, and we come back for the rest.
+ */
+PRIVATE void net_bh(void)
+{
+	unsigned n;         /* Frames taken.   */
+	struct netif *nif;  /* Interface.      */
+	struct packet *pkt; /* Received frame. */
+	
+	nif = net_if;
+	
+	disable_interrupts();
+	
+		if (netif_running(nif))
+		{
+			for (n = 0; n < NET_BUDGET; n++)
+			{
+				if ((pkt = nif->recv(nif)) == NULL)
+					break;
+				
+				eth_input(nif, pkt);
+				
+				enable_interrupts();
+				disable_interrupts();
+			}
+			
+			/* Come back for more. */
+			if (n == NET_BUDGET)
+				mark_bh(BH_NET);
+		}
+		
+		/* Senders may go on. */
+		if (net_txready)
+		{
+			net_txready = 0;
+			wakeup(&net_chain);
+			tcp_kick();
+		}
+		
+		if (net_ticked)
+		{
+			net_ticked = 0;
+			
+			/* Keep ticking while there is work to do. */
+			if (arp_timer() | tcp_timer())
+				net_arm();
+		}
+	
+	enable_interrupts();
+}
+
+/*============================================================================*
+ *                               Interfaces                                   *
+ *============================================================================*/
+
+/**
+ * @brief Registers a network interface.
+ * 
+ * @param nif Interface.
+ * 
+ * @note The first interface registered is run by the network stack.
+ */
+PUBLIC void netif_register(struct netif *nif)
+{
+	struct netif **pp;
+	
+	nif->next = NULL;
+	for (pp = &netifs; *pp != NULL; pp = &(*pp)->next)
+		/* noop */ ;
+	*pp = nif;
+}
+
+/**
+ * @brief Initializes the network stack.
+ * 
+ * @details Fills the packet pool and brings up the first registered network
+ *          interface, with default addresses that suit QEMU user networking.
+ */
+PUBLIC void net_init(void)
+{
+	unsigned i, j;      /* Loop indexes.      */
+	char *pg;           /* Page of packets.   */
+	struct netif *nif;  /* Interface.         */
+	struct packet *pkt; /* Working packet.    */
+	in_addr_t addr;     /* Interface address. */
+	
+	/* No interfaces. */
+	if ((nif = netifs) == NULL)
+		return;
+	
+	/* Nobody else gets to the pool yet. */
+	for (i = 0; i < NET_PACKETS/(PAGE_SIZE/NET_PKTSIZE); i++)
+	{
+		/* Live with what we got. */
+		if ((pg = getkpg(0)) == NULL)
+			break;
+		
+		for (j = 0; j < PAGE_SIZE/NET_PKTSIZE; j++)
+			net_free((struct packet *)(pg + j*NET_PKTSIZE));
+	}
+	
+	/* Not enough memory. */
+	if (nfreepkts == 0)
+		goto error;
+	
+	/* Failed to bring up interface. */
+	if (nif->up(nif))
+	{
+		while ((pkt = freepkts) != NULL)
+		{
+			freepkts = pkt->next;
+			if (((addr_t)pkt & PAGE_MASK) == (addr_t)pkt)
+				putkpg(pkt);
+		}
+		nfreepkts = 0;
+		goto error;
+	}
+	
+	timer_init(&net_timer, &net_clock, NULL);
+	work_init(&net_work, &net_reap, NULL);
+	set_bh(BH_NET, &net_bh);
+	
+	disable_interrupts();
+	
+	nif->addr = htonl(NET_ADDR);
+	nif->netmask = htonl(NET_NETMASK);
+	nif->gateway = htonl(NET_GATEWAY);
+	nif->flags |= NETIF_UP;
+	net_if = nif;
+	
+	/* Frames may have queued up meanwhile. */
+	mark_bh(BH_NET);
+	
+	enable_interrupts();
+	
+	addr = nif->addr;
+	kprintf("net: %s is up at %d.%d.%d.%d, %d packets", nif->name,
+		addr & 0xff, (addr >> 8) & 0xff, (addr >> 16) & 0xff, addr >> 24,
+		nfreepkts);
+	
+	return;
+
+error:
+	kprintf("net: failed to bring up %s", nif->name);
+}
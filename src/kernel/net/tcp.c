@@ -0,0 +1,1792 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/clock.h>
+#include <nanvix/const.h>
+#include <nanvix/hal.h>
+#include <nanvix/klib.h>
+#include <nanvix/net.h>
+#include <nanvix/pm.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+
+/* Connection states. */
+#define TCP_CLOSED       0 /* No connection.                  */
+#define TCP_LISTEN       1 /* Waiting for connections.        */
+#define TCP_SYN_SENT     2 /* Connecting.                     */
+#define TCP_SYN_RCVD     3 /* Being connected to.             */
+#define TCP_ESTABLISHED  4 /* Connected.                      */
+#define TCP_FIN_WAIT1    5 /* Closed, FIN not acknowledged.   */
+#define TCP_FIN_WAIT2    6 /* Closed, waiting for peer FIN.   */
+#define TCP_CLOSE_WAIT   7 /* Peer closed.                    */
+#define TCP_CLOSING      8 /* Both closed, FIN not acked.     */
+#define TCP_LAST_ACK     9 /* Peer closed first, then we did. */
+#define TCP_TIME_WAIT   10 /* Waiting for strays to die out.  */
+
+/* Segment flags. */
+#define TH_FIN 0x01 /* No more data.        */
+#define TH_SYN 0x02 /* Synchronize.         */
+#define TH_RST 0x04 /* Reset.               */
+#define TH_PSH 0x08 /* Push.                */
+#define TH_ACK 0x10 /* Acknowledgment.      */
+
+/* Length of the MSS option. */
+#define TCP_OPT_MSS 4
+
+/* Timeouts (in timer periods). */
+#define TCP_RTO_INIT      10 /* Initial retransmission timeout.   */
+#define TCP_RTO_MAX      640 /* Largest retransmission timeout.   */
+#define TCP_RETRIES        8 /* Retransmissions before giving up. */
+#define TCP_MSL2          50 /* TIME_WAIT length.                 */
+#define TCP_FIN2_TIMEOUT 600 /* Orphans waiting for a peer FIN.   */
+
+/* First ephemeral port. */
+#define TCP_PORT_FIRST 49152
+
+/* Control block flags. */
+#define TCB_USED    (1 << 0) /* Slot taken?             */
+#define TCB_ORPHAN  (1 << 1) /* Socket closed?          */
+#define TCB_FIN     (1 << 2) /* FIN queued?             */
+#define TCB_RCVFIN  (1 << 3) /* FIN received?           */
+#define TCB_READING (1 << 4) /* Reader copying data?    */
+
+/*
+ * TCP control blocks. Sent segments stay queued until they are
+ * acknowledged, and are sent again as they are on timeouts, going
+ * back to the first unacknowledged one. Received data is kept in
+ * the packets it came in, in order, and out-of-order segments are
+ * dropped. There is no congestion control.
+ */
+PRIVATE struct tcpcb
+{
+	unsigned flags;         /* Flags (see above).                */
+	int state;              /* Connection state.                 */
+	int error;              /* Pending error.                    */
+	struct socket *so;      /* Socket (NULL if none).            */
+	struct tcpcb *parent;   /* Listener (if not yet accepted).   */
+	struct tcpcb *aq;       /* Connections ready to be accepted. */
+	struct tcpcb *anext;    /* Next connection to be accepted.   */
+	unsigned nchild;        /* Connections not yet accepted.     */
+	unsigned backlog;       /* Maximum of the above.             */
+	in_addr_t laddr;        /* Local address.                    */
+	in_addr_t faddr;        /* Peer address.                     */
+	in_port_t lport;        /* Local port.                       */
+	in_port_t fport;        /* Peer port.                        */
+	uint32_t iss;           /* Initial send sequence number.     */
+	uint32_t snd_una;       /* Oldest unacknowledged.            */
+	uint32_t snd_nxt;       /* Next to send.                     */
+	uint32_t snd_max;       /* Highest sent.                     */
+	uint32_t snd_end;       /* Past the last queued.             */
+	uint32_t snd_wnd;       /* Send window.                      */
+	unsigned mss;           /* Segment size.                     */
+	uint32_t rcv_nxt;       /* Next expected.                    */
+	uint32_t rcv_adv;       /* Right edge of advertised window.  */
+	struct packet *sndq;    /* Segments to send or acknowledge.  */
+	struct packet *sndtail; /* Last segment queued.              */
+	unsigned nsnd;          /* Segments queued for sending.      */
+	struct packet *rcvq;    /* Data to be read.                  */
+	struct packet *rcvtail; /* Last data received.               */
+	unsigned nrcv;          /* Segments queued for reading.      */
+	unsigned rcvbytes;      /* Bytes queued for reading.         */
+	unsigned rto;           /* Retransmission timeout.           */
+	unsigned rtx;           /* Retransmission timer.             */
+	unsigned nrtx;          /* Retransmissions in a row.         */
+	unsigned timeout;       /* TIME_WAIT and FIN_WAIT2 timer.    */
+} tcbs[TCP_PCBS];
+
+/* Next ephemeral port. */
+PRIVATE unsigned tcp_next_port = TCP_PORT_FIRST;
+
+/* Initial sequence number generator. */
+PRIVATE uint32_t tcp_seed = 0;
+
+/*
+ * Length of a segment in sequence space.
+ */
+#define tcp_seglen(seg) \
+	((seg)->dlen + (((seg)->tflags & TH_SYN) ? 1 : 0) + \
+	(((seg)->tflags & TH_FIN) ? 1 : 0))
+
+/*
+ * Asserts if a connection has been synchronized.
+ */
+#define tcp_synced(tp) \
+	((tp)->state >= TCP_ESTABLISHED)
+
+/*
+ * Asserts if data may be sent on a connection.
+ */
+#define tcp_can_send(tp) \
+	(((tp)->state == TCP_ESTABLISHED) || ((tp)->state == TCP_CLOSE_WAIT))
+
+/*============================================================================*
+ *                             Control Blocks                                 *
+ *============================================================================*/
+
+/*
+ * Picks an initial sequence number.
+ */
+PRIVATE uint32_t tcp_iss(void)
+{
+	tcp_seed += 0x3b9aca07;
+	return (tcp_seed + ticks*250000);
+}
+
+/*
+ * Takes a free control block.
+ */
+PRIVATE struct tcpcb *tcp_get(void)
+{
+	unsigned i;
+	
+	for (i = 0; i < TCP_PCBS; i++)
+	{
+		if (!(tcbs[i].flags & TCB_USED))
+		{
+			kmemset(&tcbs[i], 0, sizeof(struct tcpcb));
+			tcbs[i].flags = TCB_USED;
+			tcbs[i].state = TCP_CLOSED;
+			tcbs[i].mss = TCP_MSS;
+			tcbs[i].rto = TCP_RTO_INIT;
+			return (&tcbs[i]);
+		}
+	}
+	
+	return (NULL);
+}
+
+/*
+ * Asserts if a local port is taken.
+ */
+PRIVATE int tcp_port_used(in_port_t port)
+{
+	unsigned i;
+	
+	for (i = 0; i < TCP_PCBS; i++)
+	{
+		if (!(tcbs[i].flags & TCB_USED) || (tcbs[i].lport != port))
+			continue;
+		
+		/* Connections left behind do not count. */
+		if ((tcbs[i].so != NULL) || (tcbs[i].state == TCP_LISTEN))
+			return (1);
+	}
+	
+	return (0);
+}
+
+/*
+ * Picks a free ephemeral port.
+ */
+PRIVATE in_port_t tcp_port(void)
+{
+	unsigned i;     /* Loop index.   */
+	in_port_t port; /* Working port. */
+	
+	for (i = 0; i < 65536 - TCP_PORT_FIRST; i++)
+	{
+		port = htons(tcp_next_port);
+		if (++tcp_next_port > 65535)
+			tcp_next_port = TCP_PORT_FIRST;
+		
+		if (!tcp_port_used(port))
+			return (port);
+	}
+	
+	return (0);
+}
+
+/*
+ * Wakes up whoever waits on the socket of a connection.
+ */
+PRIVATE void tcp_wake(struct tcpcb *tp)
+{
+	if (tp->so == NULL)
+		return;
+	
+	wakeup(&tp->so->rchain);
+	wakeup(&tp->so->wchain);
+	pollwakeup(tp->so->inode);
+}
+
+/*
+ * Drops the segments queued for sending on a connection.
+ */
+PRIVATE void tcp_flush(struct tcpcb *tp)
+{
+	struct packet *seg;
+	
+	while ((seg = tp->sndq) != NULL)
+	{
+		tp->sndq = seg->next;
+		net_dead(seg);
+	}
+	
+	tp->sndtail = NULL;
+	tp->nsnd = 0;
+	tp->rtx = 0;
+}
+
+/*
+ * Frees a control block.
+ */
+PRIVATE void tcp_free(struct tcpcb *tp)
+{
+	struct packet *pkt; /* Received data.        */
+	struct tcpcb **pp;  /* Link in accept queue. */
+	
+	tcp_flush(tp);
+	
+	while ((pkt = tp->rcvq) != NULL)
+	{
+		tp->rcvq = pkt->next;
+		net_free(pkt);
+	}
+	
+	/* Leave listener. */
+	if (tp->parent != NULL)
+	{
+		for (pp = &tp->parent->aq; *pp != NULL; pp = &(*pp)->anext)
+		{
+			if (*pp == tp)
+			{
+				*pp = tp->anext;
+				break;
+			}
+		}
+		
+		tp->parent->nchild--;
+	}
+	
+	tp->flags = 0;
+	tp->state = TCP_CLOSED;
+	tp->so = NULL;
+	tp->parent = NULL;
+}
+
+/*
+ * Finishes off a connection. Data that was received can still be read.
+ */
+PRIVATE void tcp_drop(struct tcpcb *tp, int err)
+{
+	tcp_flush(tp);
+	tp->timeout = 0;
+	tp->state = TCP_CLOSED;
+	tp->error = err;
+	
+	/* Nobody to tell about it. */
+	if (tp->so == NULL)
+	{
+		tcp_free(tp);
+		return;
+	}
+	
+	tcp_wake(tp);
+}
+
+/*
+ * Finds the connection that a segment belongs to.
+ */
+PRIVATE struct tcpcb *tcp_lookup
+(in_addr_t laddr, in_port_t lport, in_addr_t faddr, in_port_t fport)
+{
+	unsigned i;       /* Loop index. */
+	struct tcpcb *tp; /* Listener.   */
+	
+	tp = NULL;
+	
+	for (i = 0; i < TCP_PCBS; i++)
+	{
+		if (!(tcbs[i].flags & TCB_USED) || (tcbs[i].lport != lport))
+			continue;
+		
+		if (tcbs[i].state == TCP_LISTEN)
+		{
+			if ((tcbs[i].laddr == 0) || (tcbs[i].laddr == laddr))
+				tp = &tcbs[i];
+			continue;
+		}
+		
+		if ((tcbs[i].state != TCP_CLOSED) && (tcbs[i].faddr == faddr) &&
+			(tcbs[i].fport == fport) && (tcbs[i].laddr == laddr))
+			return (&tcbs[i]);
+	}
+	
+	return (tp);
+}
+
+/*============================================================================*
+ *                                 Output                                     *
+ *============================================================================*/
+
+/*
+ * Room left in the receive window of a connection.
+ */
+PRIVATE unsigned tcp_wnd(struct tcpcb *tp)
+{
+	if (tp->nrcv >= TCP_RCVQ)
+		return (0);
+	
+	return (TCP_RCVBUF - tp->rcvbytes);
+}
+
+/*
+ * Sends a segment. The header is filled in anew each time, so
+ * that retransmissions carry up-to-date acknowledgments.
+ */
+PRIVATE int tcp_xmit(struct tcpcb *tp, struct packet *seg)
+{
+	int ret;            /* Return value.  */
+	unsigned hlen;      /* Header length. */
+	unsigned wnd;       /* Window.        */
+	uint32_t sum;       /* Checksum.      */
+	uint8_t *opt;       /* Options.       */
+	struct tcp_hdr *th; /* TCP header.    */
+	
+	th = (struct tcp_hdr *)&seg->buf[NET_L4OFF];
+	hlen = seg->off - NET_L4OFF;
+	wnd = tcp_wnd(tp);
+	
+	th->sport = tp->lport;
+	th->dport = tp->fport;
+	th->seq = htonl(seg->seq);
+	th->ack = htonl(tp->rcv_nxt);
+	th->off = (hlen >> 2) << 4;
+	th->flags = seg->tflags;
+	if (tp->state != TCP_SYN_SENT)
+		th->flags |= TH_ACK;
+	th->win = htons(wnd);
+	th->sum = 0;
+	th->urp = 0;
+	
+	/* Tell our segment size. */
+	if (hlen > TCP_HLEN)
+	{
+		opt = (uint8_t *)&seg->buf[NET_L4OFF + TCP_HLEN];
+		opt[0] = 2;
+		opt[1] = TCP_OPT_MSS;
+		opt[2] = TCP_MSS >> 8;
+		opt[3] = TCP_MSS & 0xff;
+	}
+	
+	/* Data sent in place follows the header. */
+	seg->len = seg->off + seg->dlen - seg->zlen;
+	sum = net_pseudo(tp->laddr, tp->faddr, IPPROTO_TCP, hlen + seg->dlen);
+	sum = net_cksum(sum, th, seg->len - NET_L4OFF);
+	if (seg->zlen > 0)
+		sum = net_cksum(sum, seg->zdata, seg->zlen);
+	th->sum = net_fold(sum);
+	
+	if ((ret = ip_output(seg, tp->laddr, tp->faddr, IPPROTO_TCP)) == 0)
+		tp->rcv_adv = tp->rcv_nxt + wnd;
+	
+	return (ret);
+}
+
+/*
+ * Sends a bare control segment.
+ */
+PRIVATE void tcp_control(struct tcpcb *tp, unsigned tflags)
+{
+	struct packet *pkt;
+	
+	/* Out of packets. Peer will ask again. */
+	if ((pkt = net_alloc()) == NULL)
+		return;
+	
+	pkt->off = NET_L4OFF + TCP_HLEN;
+	pkt->seq = tp->snd_nxt;
+	pkt->tflags = tflags;
+	tcp_xmit(tp, pkt);
+	
+	net_free(pkt);
+}
+
+/*
+ * Acknowledges what was received on a connection.
+ */
+#define tcp_ack(tp) \
+	tcp_control(tp, 0)
+
+/*
+ * Resets a connection and frees its control block.
+ */
+PRIVATE void tcp_abort(struct tcpcb *tp)
+{
+	if ((tcp_synced(tp)) || (tp->state == TCP_SYN_RCVD))
+		tcp_control(tp, TH_RST);
+	
+	tcp_free(tp);
+}
+
+/*
+ * Answers a segment that belongs to no connection with a reset.
+ * The segment's packet is reused for that.
+ */
+PRIVATE void tcp_reset(struct packet *pkt, in_addr_t dst, unsigned len)
+{
+	uint8_t flags;      /* Segment flags.    */
+	in_port_t sport;    /* Source port.      */
+	in_port_t dport;    /* Destination port. */
+	uint32_t seq;       /* Sequence number.  */
+	uint32_t ack;       /* Acknowledgment.   */
+	struct tcp_hdr *th; /* TCP header.       */
+	
+	th = (struct tcp_hdr *)&pkt->buf[pkt->off];
+	
+	/* Never answer a reset. */
+	if ((flags = th->flags) & TH_RST)
+		return;
+	
+	sport = th->sport;
+	dport = th->dport;
+	seq = ntohl(th->seq);
+	ack = ntohl(th->ack);
+	
+	th = (struct tcp_hdr *)&pkt->buf[NET_L4OFF];
+	th->sport = dport;
+	th->dport = sport;
+	if (flags & TH_ACK)
+	{
+		th->seq = htonl(ack);
+		th->ack = 0;
+		th->flags = TH_RST;
+	}
+	else
+	{
+		len += ((flags & TH_SYN) ? 1 : 0) + ((flags & TH_FIN) ? 1 : 0);
+		th->seq = 0;
+		th->ack = htonl(seq + len);
+		th->flags = TH_RST | TH_ACK;
+	}
+	th->off = (TCP_HLEN >> 2) << 4;
+	th->win = 0;
+	th->sum = 0;
+	th->urp = 0;
+	th->sum = net_fold(net_cksum(net_pseudo(dst, pkt->saddr, IPPROTO_TCP,
+		TCP_HLEN), th, TCP_HLEN));
+	
+	pkt->len = NET_L4OFF + TCP_HLEN;
+	ip_output(pkt, dst, pkt->saddr, IPPROTO_TCP);
+}
+
+/*
+ * Sends whatever the window lets out. Segments that were sent before
+ * are sent again once the sending point went back to them.
+ */
+PRIVATE void tcp_output(struct tcpcb *tp)
+{
+	struct packet *seg; /* Working segment. */
+	uint32_t end;       /* End of segment.  */
+	
+	for (seg = tp->sndq; seg != NULL; seg = seg->next)
+	{
+		end = seg->seq + tcp_seglen(seg);
+		
+		/* Already sent. */
+		if (seq_leq(end, tp->snd_nxt))
+			continue;
+		
+		/* Out of window. A segment is always let out, as a probe. */
+		if ((tp->snd_nxt != tp->snd_una) &&
+			(seq_lt(tp->snd_una + tp->snd_wnd, end)))
+			break;
+		
+		/* Try again later. */
+		if (tcp_xmit(tp, seg) < 0)
+			break;
+		
+		tp->snd_nxt = end;
+		if (seq_lt(tp->snd_max, end))
+			tp->snd_max = end;
+	}
+	
+	/* Wait for acknowledgments. */
+	if ((tp->sndq != NULL) && (tp->rtx == 0))
+	{
+		tp->rtx = tp->rto;
+		net_arm();
+	}
+}
+
+/*
+ * Queues a segment for sending.
+ */
+PRIVATE void tcp_enqueue(struct tcpcb *tp, struct packet *seg, unsigned tflags)
+{
+	seg->next = NULL;
+	seg->seq = tp->snd_end;
+	seg->tflags = tflags;
+	tp->snd_end += tcp_seglen(seg);
+	
+	if (tp->sndtail == NULL)
+		tp->sndq = seg;
+	else
+		tp->sndtail->next = seg;
+	tp->sndtail = seg;
+	tp->nsnd++;
+}
+
+/*
+ * Queues a FIN on a connection.
+ */
+PRIVATE int tcp_fin(struct tcpcb *tp)
+{
+	struct packet *seg;
+	
+	seg = tp->sndtail;
+	
+	/* Piggyback on a segment that was not sent yet. */
+	if ((seg != NULL) && !(seg->tflags & TH_SYN) &&
+		(seq_leq(tp->snd_max, seg->seq)))
+	{
+		seg->tflags |= TH_FIN;
+		tp->snd_end++;
+	}
+	else
+	{
+		/* Out of packets. */
+		if ((seg = net_alloc()) == NULL)
+			return (-ENOBUFS);
+		
+		seg->off = NET_L4OFF + TCP_HLEN;
+		tcp_enqueue(tp, seg, TH_FIN);
+	}
+	
+	tp->flags |= TCB_FIN;
+	tp->state = (tp->state == TCP_ESTABLISHED) ? TCP_FIN_WAIT1 : TCP_LAST_ACK;
+	tcp_output(tp);
+	
+	return (0);
+}
+
+/*============================================================================*
+ *                                  Input                                     *
+ *============================================================================*/
+
+/*
+ * Gets the segment size that the peer asks for.
+ */
+PRIVATE unsigned tcp_mss(const struct tcp_hdr *th, unsigned hlen)
+{
+	unsigned i;         /* Loop index.   */
+	unsigned mss;       /* Segment size. */
+	const uint8_t *opt; /* Options.      */
+	
+	opt = (const uint8_t *)th;
+	
+	for (i = TCP_HLEN; i < hlen; )
+	{
+		/* End of options. */
+		if (opt[i] == 0)
+			break;
+		
+		/* No operation. */
+		if (opt[i] == 1)
+		{
+			i++;
+			continue;
+		}
+		
+		/* Bad option. */
+		if ((i + 1 >= hlen) || (opt[i + 1] < 2) || (i + opt[i + 1] > hlen))
+			break;
+		
+		if ((opt[i] == 2) && (opt[i + 1] == TCP_OPT_MSS))
+		{
+			mss = (opt[i + 2] << 8) | opt[i + 3];
+			if ((mss > 0) && (mss < TCP_MSS))
+				return (mss);
+			break;
+		}
+		
+		i += opt[i + 1];
+	}
+	
+	return (TCP_MSS);
+}
+
+/*
+ * Handles acknowledgments and window updates.
+ */
+PRIVATE void tcp_acked(struct tcpcb *tp, uint32_t ack, unsigned win)
+{
+	struct packet *seg;
+	
+	/* Old or bogus. */
+	if (seq_lt(ack, tp->snd_una) || seq_lt(tp->snd_max, ack))
+		return;
+	
+	tp->snd_wnd = win;
+	
+	/* Nothing new. */
+	if (ack == tp->snd_una)
+		return;
+	
+	tp->snd_una = ack;
+	if (seq_lt(tp->snd_nxt, ack))
+		tp->snd_nxt = ack;
+	
+	/* Release what was fully acknowledged. */
+	while (((seg = tp->sndq) != NULL) &&
+		(seq_leq(seg->seq + tcp_seglen(seg), ack)))
+	{
+		if ((tp->sndq = seg->next) == NULL)
+			tp->sndtail = NULL;
+		tp->nsnd--;
+		net_dead(seg);
+	}
+	
+	tp->nrtx = 0;
+	tp->rto = TCP_RTO_INIT;
+	tp->rtx = (tp->sndq != NULL) ? tp->rto : 0;
+	
+	tcp_wake(tp);
+}
+
+/*
+ * Handles a connection request on a listening socket. The request's
+ * packet is reused for the answer, that stays queued until it is
+ * acknowledged.
+ */
+PRIVATE void tcp_listen_input(struct tcpcb *lp, struct packet *pkt,
+	in_addr_t dst, const struct tcp_hdr *th, unsigned hlen)
+{
+	struct tcpcb *tp; /* New connection. */
+	
+	/* Backlog is full. Peer will ask again. */
+	if ((lp->nchild >= lp->backlog) || ((tp = tcp_get()) == NULL))
+	{
+		net_free(pkt);
+		return;
+	}
+	
+	tp->state = TCP_SYN_RCVD;
+	tp->parent = lp;
+	tp->laddr = dst;
+	tp->lport = th->dport;
+	tp->faddr = pkt->saddr;
+	tp->fport = th->sport;
+	tp->rcv_nxt = ntohl(th->seq) + 1;
+	tp->snd_wnd = ntohs(th->win);
+	tp->mss = tcp_mss(th, hlen);
+	tp->iss = tcp_iss();
+	tp->snd_una = tp->snd_nxt = tp->snd_max = tp->snd_end = tp->iss;
+	lp->nchild++;
+	
+	pkt->next = NULL;
+	pkt->off = NET_L4OFF + TCP_HLEN + TCP_OPT_MSS;
+	pkt->dlen = 0;
+	tcp_enqueue(tp, pkt, TH_SYN);
+	tcp_output(tp);
+}
+
+/*
+ * Handles the answer to a connection request.
+ */
+PRIVATE void tcp_syn_sent_input(struct tcpcb *tp, struct packet *pkt,
+	in_addr_t dst, const struct tcp_hdr *th, unsigned hlen)
+{
+	uint32_t ack; /* Acknowledgment. */
+	
+	ack = ntohl(th->ack);
+	
+	/* Not for our request. */
+	if ((th->flags & TH_ACK) &&
+		(seq_leq(ack, tp->iss) || seq_lt(tp->snd_max, ack)))
+	{
+		tcp_reset(pkt, dst, 0);
+		goto out;
+	}
+	
+	/* Refused. */
+	if (th->flags & TH_RST)
+	{
+		if (th->flags & TH_ACK)
+			tcp_drop(tp, -ECONNREFUSED);
+		goto out;
+	}
+	
+	/* Simultaneous opens are not supported. */
+	if ((th->flags & (TH_SYN | TH_ACK)) != (TH_SYN | TH_ACK))
+		goto out;
+	
+	tp->rcv_nxt = ntohl(th->seq) + 1;
+	tp->mss = tcp_mss(th, hlen);
+	tp->state = TCP_ESTABLISHED;
+	tcp_acked(tp, ack, ntohs(th->win));
+	tcp_ack(tp);
+	tcp_wake(tp);
+
+out:
+	net_free(pkt);
+}
+
+/**
+ * @brief Handles an incoming TCP segment.
+ * 
+ * @param pkt Packet.
+ * @param dst Destination address.
+ * 
+ * @note Interrupts must be disabled.
+ */
+PUBLIC void tcp_input(struct packet *pkt, in_addr_t dst)
+{
+	int keep;           /* Packet queued?    */
+	unsigned hlen;      /* Header length.    */
+	unsigned len;       /* Data length.      */
+	unsigned delta;     /* Data seen before. */
+	unsigned flags;     /* Segment flags.    */
+	uint32_t seq;       /* Sequence number.  */
+	struct tcp_hdr *th; /* TCP header.       */
+	struct tcpcb *tp;   /* Connection.       */
+	
+	th = (struct tcp_hdr *)&pkt->buf[pkt->off];
+	keep = 0;
+	
+	/* Too short. */
+	if (pkt->dlen < TCP_HLEN)
+		goto drop;
+	
+	/* Bad checksum. */
+	if (net_fold(net_cksum(net_pseudo(pkt->saddr, dst, IPPROTO_TCP,
+		pkt->dlen), th, pkt->dlen)) != 0)
+		goto drop;
+	
+	/* Bad header length. */
+	hlen = (th->off >> 4) << 2;
+	if ((hlen < TCP_HLEN) || (hlen > pkt->dlen))
+		goto drop;
+	
+	len = pkt->dlen - hlen;
+	seq = ntohl(th->seq);
+	flags = th->flags;
+	
+	/* Nobody there. */
+	if ((tp = tcp_lookup(dst, th->dport, pkt->saddr, th->sport)) == NULL)
+	{
+		tcp_reset(pkt, dst, len);
+		goto drop;
+	}
+	
+	if (tp->state == TCP_LISTEN)
+	{
+		/* Not a connection request. */
+		if ((flags & (TH_SYN | TH_ACK | TH_RST)) != TH_SYN)
+		{
+			if (flags & TH_ACK)
+				tcp_reset(pkt, dst, len);
+			goto drop;
+		}
+		
+		tcp_listen_input(tp, pkt, dst, th, hlen);
+		return;
+	}
+	
+	if (tp->state == TCP_SYN_SENT)
+	{
+		tcp_syn_sent_input(tp, pkt, dst, th, hlen);
+		return;
+	}
+	
+	/* Reset. Only taken in order, so that strays do no harm. */
+	if (flags & TH_RST)
+	{
+		if (seq == tp->rcv_nxt)
+			tcp_drop(tp, (tp->state == TCP_SYN_RCVD) ? 0 : -ECONNRESET);
+		goto drop;
+	}
+	
+	if (flags & TH_SYN)
+	{
+		/* Our answer got lost. */
+		if ((tp->state == TCP_SYN_RCVD) && (seq + 1 == tp->rcv_nxt))
+		{
+			tp->snd_nxt = tp->snd_una;
+			tcp_output(tp);
+		}
+		else
+			tcp_ack(tp);
+		goto drop;
+	}
+	
+	if (!(flags & TH_ACK))
+		goto drop;
+	
+	/* Connection established. */
+	if (tp->state == TCP_SYN_RCVD)
+	{
+		if (seq_leq(ntohl(th->ack), tp->snd_una) ||
+			seq_lt(tp->snd_max, ntohl(th->ack)))
+		{
+			tcp_reset(pkt, dst, len);
+			goto drop;
+		}
+		
+		tp->state = TCP_ESTABLISHED;
+		tp->anext = tp->parent->aq;
+		tp->parent->aq = tp;
+		tcp_wake(tp->parent);
+	}
+	
+	tcp_acked(tp, ntohl(th->ack), ntohs(th->win));
+	
+	/* Our FIN was acknowledged. */
+	if ((tp->flags & TCB_FIN) && (tp->snd_una == tp->snd_end))
+	{
+		switch (tp->state)
+		{
+			case TCP_FIN_WAIT1:
+				tp->state = TCP_FIN_WAIT2;
+				tp->timeout = TCP_FIN2_TIMEOUT;
+				net_arm();
+				break;
+			
+			case TCP_CLOSING:
+				tp->state = TCP_TIME_WAIT;
+				tp->timeout = TCP_MSL2;
+				net_arm();
+				break;
+			
+			case TCP_LAST_ACK:
+				tcp_drop(tp, 0);
+				goto drop;
+			
+			default:
+				break;
+		}
+	}
+	
+	/* Pure acknowledgment. */
+	if ((len == 0) && !(flags & TH_FIN))
+	{
+		tcp_output(tp);
+		goto drop;
+	}
+	
+	/* Skip what we have already. */
+	if (seq_lt(seq, tp->rcv_nxt))
+	{
+		delta = tp->rcv_nxt - seq;
+		if (delta > len)
+		{
+			flags &= ~TH_FIN;
+			delta = len;
+		}
+		seq += delta;
+		len -= delta;
+		hlen += delta;
+	}
+	
+	/* Out of order. */
+	if (seq != tp->rcv_nxt)
+	{
+		len = 0;
+		flags &= ~TH_FIN;
+	}
+	
+	if (len > 0)
+	{
+		/* Peer is done sending. */
+		if ((tp->state != TCP_ESTABLISHED) &&
+			(tp->state != TCP_FIN_WAIT1) && (tp->state != TCP_FIN_WAIT2))
+		{
+			len = 0;
+			flags &= ~TH_FIN;
+		}
+		
+		/* Nobody is going to read it. */
+		else if (tp->flags & TCB_ORPHAN)
+		{
+			tcp_abort(tp);
+			goto drop;
+		}
+		
+		/* No room. */
+		else if ((tp->nrcv >= TCP_RCVQ) || (len > tcp_wnd(tp)))
+		{
+			len = 0;
+			flags &= ~TH_FIN;
+		}
+		
+		else
+		{
+			pkt->next = NULL;
+			pkt->off += hlen;
+			pkt->dlen = len;
+			
+			if (tp->rcvtail == NULL)
+				tp->rcvq = pkt;
+			else
+				tp->rcvtail->next = pkt;
+			tp->rcvtail = pkt;
+			tp->nrcv++;
+			tp->rcvbytes += len;
+			tp->rcv_nxt += len;
+			keep = 1;
+		}
+	}
+	
+	/* Peer is done sending. */
+	if ((flags & TH_FIN) && !(tp->flags & TCB_RCVFIN))
+	{
+		tp->rcv_nxt++;
+		tp->flags |= TCB_RCVFIN;
+		
+		switch (tp->state)
+		{
+			case TCP_ESTABLISHED:
+				tp->state = TCP_CLOSE_WAIT;
+				break;
+			
+			case TCP_FIN_WAIT1:
+				tp->state = TCP_CLOSING;
+				break;
+			
+			case TCP_FIN_WAIT2:
+				tp->state = TCP_TIME_WAIT;
+				tp->timeout = TCP_MSL2;
+				net_arm();
+				break;
+			
+			default:
+				break;
+		}
+	}
+	
+	tcp_wake(tp);
+	tcp_ack(tp);
+	tcp_output(tp);
+	
+drop:
+	if (!keep)
+		net_free(pkt);
+}
+
+/*============================================================================*
+ *                                 Timers                                     *
+ *============================================================================*/
+
+/**
+ * @brief Runs the TCP timers.
+ * 
+ * @returns Non-zero if some timer is still running.
+ * 
+ * @note Interrupts must be disabled.
+ */
+PUBLIC int tcp_timer(void)
+{
+	unsigned i;       /* Loop index.     */
+	int busy;         /* Timers running? */
+	struct tcpcb *tp; /* Connection.     */
+	
+	busy = 0;
+	
+	for (i = 0; i < TCP_PCBS; i++)
+	{
+		tp = &tcbs[i];
+		
+		if (!(tp->flags & TCB_USED))
+			continue;
+		
+		/* Retransmit, backing off. */
+		if ((tp->rtx > 0) && (--tp->rtx == 0))
+		{
+			if (++tp->nrtx > TCP_RETRIES)
+			{
+				tcp_drop(tp, -ETIMEDOUT);
+				continue;
+			}
+			
+			tp->rto = (tp->rto*2 > TCP_RTO_MAX) ? TCP_RTO_MAX : tp->rto*2;
+			tp->snd_nxt = tp->snd_una;
+			tcp_output(tp);
+		}
+		
+		/* Done waiting. */
+		if ((tp->timeout > 0) && (--tp->timeout == 0))
+		{
+			tcp_drop(tp, 0);
+			continue;
+		}
+		
+		if ((tp->rtx > 0) || (tp->timeout > 0))
+			busy = 1;
+	}
+	
+	return (busy);
+}
+
+/**
+ * @brief Sends what was held back on all connections.
+ * 
+ * @details Called once transmit buffers are freed, or next hops are resolved.
+ * 
+ * @note Interrupts must be disabled.
+ */
+PUBLIC void tcp_kick(void)
+{
+	unsigned i;
+	
+	for (i = 0; i < TCP_PCBS; i++)
+	{
+		if ((tcbs[i].flags & TCB_USED) && (tcbs[i].sndq != NULL))
+			tcp_output(&tcbs[i]);
+	}
+}
+
+/*============================================================================*
+ *                             Socket Interface                               *
+ *============================================================================*/
+
+/**
+ * @brief Attaches a TCP control block to a socket.
+ * 
+ * @param so Socket.
+ * 
+ * @returns Zero on success, and a negative error code otherwise.
+ */
+PUBLIC int tcp_attach(struct socket *so)
+{
+	struct tcpcb *tp;
+	
+	disable_interrupts();
+	
+	/* Too many connections. */
+	if ((tp = tcp_get()) == NULL)
+	{
+		enable_interrupts();
+		return (-ENOBUFS);
+	}
+	
+	tp->so = so;
+	so->pcb = tp;
+	
+	enable_interrupts();
+	
+	return (0);
+}
+
+/**
+ * @brief Detaches the TCP control block of a socket.
+ * 
+ * @details Connections with unread data are reset. Otherwise, they are
+ *          closed gracefully, and their control blocks stay around until
+ *          the peer is done.
+ * 
+ * @param so Socket.
+ */
+PUBLIC void tcp_detach(struct socket *so)
+{
+	unsigned i;       /* Loop index. */
+	struct tcpcb *tp; /* Connection. */
+	
+	tp = so->pcb;
+	
+	disable_interrupts();
+	
+	so->pcb = NULL;
+	tp->so = NULL;
+	
+	switch (tp->state)
+	{
+		/* Refuse pending connections. */
+		case TCP_LISTEN:
+			for (i = 0; i < TCP_PCBS; i++)
+			{
+				if ((tcbs[i].flags & TCB_USED) && (tcbs[i].parent == tp))
+					tcp_abort(&tcbs[i]);
+			}
+			tcp_free(tp);
+			break;
+		
+		case TCP_ESTABLISHED:
+		case TCP_CLOSE_WAIT:
+			if ((tp->rcvq != NULL) || (tcp_fin(tp) < 0))
+			{
+				tcp_abort(tp);
+				break;
+			}
+			tp->flags |= TCB_ORPHAN;
+			break;
+		
+		case TCP_CLOSED:
+		case TCP_SYN_SENT:
+			tcp_free(tp);
+			break;
+		
+		default:
+			tp->flags |= TCB_ORPHAN;
+			break;
+	}
+	
+	enable_interrupts();
+}
+
+/**
+ * @brief Binds a TCP socket to a local address and port.
+ * 
+ * @param so   Socket.
+ * @param addr Local address.
+ * @param port Local port (zero for any).
+ * 
+ * @returns Zero on success, and a negative error code otherwise.
+ */
+PUBLIC int tcp_bind(struct socket *so, in_addr_t addr, in_port_t port)
+{
+	int ret;          /* Return value. */
+	struct tcpcb *tp; /* Connection.   */
+	
+	tp = so->pcb;
+	ret = 0;
+	
+	disable_interrupts();
+	
+	/* Already bound. */
+	if ((tp->lport != 0) || (tp->state != TCP_CLOSED))
+		ret = -EINVAL;
+	
+	/* Port taken. */
+	else if ((port != 0) && (tcp_port_used(port)))
+		ret = -EADDRINUSE;
+	
+	/* Out of ports. */
+	else if ((port == 0) && ((port = tcp_port()) == 0))
+		ret = -EADDRINUSE;
+	
+	else
+	{
+		tp->laddr = addr;
+		tp->lport = port;
+	}
+	
+	enable_interrupts();
+	
+	return (ret);
+}
+
+/**
+ * @brief Listens for connections on a TCP socket.
+ * 
+ * @param so      Socket.
+ * @param backlog Connections that may wait to be accepted.
+ * 
+ * @returns Zero on success, and a negative error code otherwise.
+ */
+PUBLIC int tcp_listen(struct socket *so, unsigned backlog)
+{
+	int ret;          /* Return value. */
+	struct tcpcb *tp; /* Connection.   */
+	
+	tp = so->pcb;
+	
+	/* Not idle. */
+	if ((tp->state != TCP_CLOSED) && (tp->state != TCP_LISTEN))
+		return (-EINVAL);
+	
+	/* Bind to an ephemeral port. */
+	if ((tp->lport == 0) && ((ret = tcp_bind(so, 0, 0)) < 0))
+		return (ret);
+	
+	disable_interrupts();
+	tp->state = TCP_LISTEN;
+	tp->backlog = backlog;
+	enable_interrupts();
+	
+	return (0);
+}
+
+/**
+ * @brief Accepts a connection on a TCP socket.
+ * 
+ * @param so       Listening socket.
+ * @param nonblock Do not block?
+ * 
+ * @returns The socket of the new connection. Upon failure, NULL is returned
+ *          and the error code is left in the current process.
+ */
+PUBLIC struct socket *tcp_accept(struct socket *so, int nonblock)
+{
+	int err;           /* Error code.     */
+	struct tcpcb *lp;  /* Listener.       */
+	struct tcpcb *tp;  /* New connection. */
+	struct socket *ss; /* New socket.     */
+	
+	lp = so->pcb;
+	
+	if ((ss = socket_alloc(AF_INET, SOCK_STREAM)) == NULL)
+	{
+		curr_proc->errno = -ENOBUFS;
+		return (NULL);
+	}
+	
+	disable_interrupts();
+	
+	/* Wait for a connection. */
+	while ((tp = lp->aq) == NULL)
+	{
+		/* Would block. */
+		if (nonblock)
+		{
+			err = -EAGAIN;
+			goto error;
+		}
+		
+		sleep(&so->rchain, PRIO_INODE);
+		
+		/* Awaken by a signal. */
+		if (issig() != SIGNULL)
+		{
+			err = -EINTR;
+			goto error;
+		}
+	}
+	
+	lp->aq = tp->anext;
+	lp->nchild--;
+	tp->anext = NULL;
+	tp->parent = NULL;
+	tp->so = ss;
+	ss->pcb = tp;
+	ss->flags |= SOCKET_CONNECTED;
+	
+	enable_interrupts();
+	
+	return (ss);
+
+error:
+	enable_interrupts();
+	socket_put(ss);
+	curr_proc->errno = err;
+	return (NULL);
+}
+
+/**
+ * @brief Connects a TCP socket.
+ * 
+ * @param so       Socket.
+ * @param addr     Peer address.
+ * @param port     Peer port.
+ * @param nonblock Do not wait for the connection?
+ * 
+ * @returns Zero on success, and a negative error code otherwise.
+ */
+PUBLIC int tcp_connect(struct socket *so, in_addr_t addr, in_port_t port, int nonblock)
+{
+	int ret;            /* Return value.       */
+	struct tcpcb *tp;   /* Connection.         */
+	struct packet *pkt; /* Connection request. */
+	
+	tp = so->pcb;
+	
+	/* Connecting already. */
+	if (tp->state == TCP_SYN_SENT)
+		return (-EALREADY);
+	
+	/* Listening. */
+	if (tp->state == TCP_LISTEN)
+		return (-EINVAL);
+	
+	/* Connected. */
+	if ((tp->state != TCP_CLOSED) || (so->flags & SOCKET_CONNECTED))
+		return (-EISCONN);
+	
+	/* Bind to an ephemeral port. */
+	if ((tp->lport == 0) && ((ret = tcp_bind(so, 0, 0)) < 0))
+		return (ret);
+	
+	disable_interrupts();
+	
+	/* Interface down. */
+	if (!netif_running(net_if))
+	{
+		ret = -ENETDOWN;
+		goto out;
+	}
+	
+	/* Out of packets. */
+	if ((pkt = net_alloc()) == NULL)
+	{
+		ret = -ENOBUFS;
+		goto out;
+	}
+	
+	tp->laddr = net_if->addr;
+	tp->faddr = addr;
+	tp->fport = port;
+	tp->error = 0;
+	tp->iss = tcp_iss();
+	tp->snd_una = tp->snd_nxt = tp->snd_max = tp->snd_end = tp->iss;
+	tp->snd_wnd = 0;
+	tp->state = TCP_SYN_SENT;
+	so->flags |= SOCKET_CONNECTED;
+	
+	pkt->off = NET_L4OFF + TCP_HLEN + TCP_OPT_MSS;
+	tcp_enqueue(tp, pkt, TH_SYN);
+	tcp_output(tp);
+	
+	/* Do not wait. */
+	if (nonblock)
+	{
+		ret = -EINPROGRESS;
+		goto out;
+	}
+	
+	while (tp->state == TCP_SYN_SENT)
+	{
+		sleep(&so->wchain, PRIO_INODE);
+		
+		/* Awaken by a signal. */
+		if (issig() != SIGNULL)
+		{
+			ret = -EINTR;
+			goto out;
+		}
+	}
+	
+	ret = 0;
+	
+	/* Failed to connect. */
+	if (tp->state == TCP_CLOSED)
+	{
+		ret = (tp->error != 0) ? tp->error : -ECONNREFUSED;
+		tp->error = 0;
+		so->flags &= ~SOCKET_CONNECTED;
+	}
+
+out:
+	enable_interrupts();
+	return (ret);
+}
+
+/*
+ * Waits until a segment may be queued on a connection. The caller's
+ * progress is returned on errors, if there is any.
+ */
+PRIVATE int tcp_send_wait(struct socket *so, struct tcpcb *tp, unsigned nseg, int flags)
+{
+	int err; /* Error code. */
+	
+	while (1)
+	{
+		/* Connection failed. */
+		if ((err = tp->error) != 0)
+		{
+			tp->error = 0;
+			return (err);
+		}
+		
+		/* Not connected. */
+		if ((tp->state == TCP_SYN_SENT) || !(so->flags & SOCKET_CONNECTED))
+			return (-ENOTCONN);
+		
+		/* Peer gone, or we are done sending. */
+		if (!tcp_can_send(tp))
+		{
+			if (!(flags & MSG_NOSIGNAL))
+				sndsig(curr_proc, SIGPIPE);
+			return (-EPIPE);
+		}
+		
+		if (tp->nsnd + nseg <= TCP_SNDQ)
+			return (0);
+		
+		/* Would block. */
+		if (flags & MSG_DONTWAIT)
+			return (-EAGAIN);
+		
+		sleep(&so->wchain, PRIO_INODE);
+		
+		/* Awaken by a signal. */
+		if (issig() != SIGNULL)
+			return (-EINTR);
+	}
+}
+
+/*
+ * Waits for a packet.
+ */
+PRIVATE struct packet *tcp_alloc(int flags, int *err)
+{
+	struct packet *pkt;
+	
+	while ((pkt = net_alloc()) == NULL)
+	{
+		/* Would block. */
+		if (flags & MSG_DONTWAIT)
+		{
+			*err = -EAGAIN;
+			return (NULL);
+		}
+		
+		sleep(&net_chain, PRIO_INODE);
+		
+		/* Awaken by a signal. */
+		if (issig() != SIGNULL)
+		{
+			*err = -EINTR;
+			return (NULL);
+		}
+	}
+	
+	return (pkt);
+}
+
+/**
+ * @brief Sends data on a TCP socket.
+ * 
+ * @param so     Socket.
+ * @param iov    Data buffers.
+ * @param iovcnt Number of data buffers.
+ * @param n      Number of bytes.
+ * @param flags  Message flags.
+ * 
+ * @returns The number of bytes sent. Upon failure, -1 is returned and the
+ *          error code is left in the current process.
+ */
+PUBLIC ssize_t tcp_send(struct socket *so, const struct iovec *iov, int iovcnt, size_t n, int flags)
+{
+	int err;             /* Error code.   */
+	size_t i;            /* Bytes sent.   */
+	size_t chunk;        /* Segment data. */
+	struct tcpcb *tp;    /* Connection.   */
+	struct packet *pkt;  /* New segment.  */
+	struct packet *tail; /* Last segment. */
+	
+	tp = so->pcb;
+	i = 0;
+	err = 0;
+	
+	disable_interrupts();
+	
+	while (i < n)
+	{
+		if ((err = tcp_send_wait(so, tp, 1, flags)) < 0)
+			break;
+		
+		if ((pkt = tcp_alloc(flags, &err)) == NULL)
+			break;
+		
+		enable_interrupts();
+		
+		/* The packet is ours, so this may fault. */
+		chunk = (n - i < tp->mss) ? n - i : tp->mss;
+		pkt->off = NET_L4OFF + TCP_HLEN;
+		pkt->dlen = net_gather(&pkt->buf[pkt->off], iov, iovcnt, i, chunk);
+		
+		disable_interrupts();
+		
+		/* Connection changed meanwhile. */
+		if (!tcp_can_send(tp) || (tp->nsnd >= TCP_SNDQ))
+		{
+			net_free(pkt);
+			continue;
+		}
+		
+		tail = tp->sndtail;
+		
+		/* Coalesce with a segment that was not sent yet. */
+		if ((tail != NULL) && !(tail->tflags & (TH_SYN | TH_FIN)) &&
+			(tail->zlen == 0) && (seq_leq(tp->snd_max, tail->seq)) &&
+			(tail->dlen + chunk <= tp->mss))
+		{
+			kmemcpy(&tail->buf[tail->off + tail->dlen], &pkt->buf[pkt->off],
+				chunk);
+			tail->dlen += chunk;
+			tp->snd_end += chunk;
+			net_free(pkt);
+		}
+		else
+			tcp_enqueue(tp, pkt, TH_PSH);
+		
+		i += chunk;
+		tcp_output(tp);
+	}
+	
+	enable_interrupts();
+	
+	if (i > 0)
+		return ((ssize_t)i);
+	
+	curr_proc->errno = err;
+	return (-1);
+}
+
+/**
+ * @brief Sends data straight out of a block buffer on a TCP socket.
+ * 
+ * @details The data is not copied: segments refer to it until they are
+ *          acknowledged, and the reference to the block buffer is then
+ *          released by a kernel worker.
+ * 
+ * @param so       Socket.
+ * @param buf      Block buffer. The reference to it is taken on success.
+ * @param off      Offset in the block buffer.
+ * @param n        Number of bytes.
+ * @param nonblock Do not block?
+ * 
+ * @returns The number of bytes sent, or a negative error code. -ENOTSUP is
+ *          returned if the data cannot be sent in place.
+ */
+PUBLIC ssize_t tcp_sendbuf(struct socket *so, buffer_t buf, size_t off, size_t n, int nonblock)
+{
+	int err;             /* Error code.      */
+	unsigned i;          /* Loop index.      */
+	unsigned nseg;       /* Segments needed. */
+	size_t chunk;        /* Segment data.    */
+	const char *data;    /* Data.            */
+	struct tcpcb *tp;    /* Connection.      */
+	struct packet *segs; /* New segments.    */
+	struct packet *pkt;  /* Working segment. */
+	int flags;           /* Message flags.   */
+	
+	tp = so->pcb;
+	data = (const char *)buffer_data(buf) + off;
+	flags = (nonblock) ? MSG_DONTWAIT : 0;
+	
+	/* Segments are too small. */
+	if ((nseg = (n + tp->mss - 1)/tp->mss) > TCP_SNDQ)
+		return (-ENOTSUP);
+	
+	disable_interrupts();
+	
+again:
+	if ((err = tcp_send_wait(so, tp, nseg, flags)) < 0)
+		goto error;
+	
+	/* Get all packets at once. */
+	for (i = 0, segs = NULL; i < nseg; i++)
+	{
+		if ((pkt = net_alloc()) == NULL)
+		{
+			while ((pkt = segs) != NULL)
+			{
+				segs = pkt->next;
+				net_free(pkt);
+			}
+			
+			if ((pkt = tcp_alloc(flags, &err)) == NULL)
+				goto error;
+			net_free(pkt);
+			
+			goto again;
+		}
+		
+		pkt->next = segs;
+		segs = pkt;
+	}
+	
+	for (i = 0; i < nseg; i++)
+	{
+		pkt = segs;
+		segs = pkt->next;
+		
+		chunk = (n - i*tp->mss < tp->mss) ? n - i*tp->mss : tp->mss;
+		pkt->off = NET_L4OFF + TCP_HLEN;
+		pkt->zdata = data + i*tp->mss;
+		pkt->zlen = chunk;
+		pkt->dlen = chunk;
+		
+		/* The last segment to be acknowledged releases the buffer. */
+		if (i == nseg - 1)
+			pkt->zbuf = buf;
+		
+		tcp_enqueue(tp, pkt, TH_PSH);
+	}
+	
+	tcp_output(tp);
+	
+	enable_interrupts();
+	
+	return ((ssize_t)n);
+
+error:
+	enable_interrupts();
+	return (err);
+}
+
+/**
+ * @brief Receives data from a TCP socket.
+ * 
+ * @param so     Socket.
+ * @param iov    Data buffers.
+ * @param iovcnt Number of data buffers.
+ * @param n      Number of bytes.
+ * @param flags  Message flags, updated on return.
+ * 
+ * @returns The number of bytes received, or zero at the end of the stream.
+ *          Upon failure, -1 is returned and the error code is left in the
+ *          current process.
+ */
+PUBLIC ssize_t tcp_recv(struct socket *so, const struct iovec *iov, int iovcnt, size_t n, int *flags)
+{
+	int err;            /* Error code.     */
+	size_t i;           /* Bytes received. */
+	size_t chunk;       /* Bytes copied.   */
+	uint32_t edge;      /* Window edge.    */
+	struct tcpcb *tp;   /* Connection.     */
+	struct packet *pkt; /* Received data.  */
+	
+	tp = so->pcb;
+	i = 0;
+	
+	disable_interrupts();
+	
+	/* Wait for data, one reader at a time. */
+	while ((tp->rcvq == NULL) || (tp->flags & TCB_READING))
+	{
+		if (!(tp->flags & TCB_READING))
+		{
+			/* Connection failed. */
+			if ((err = tp->error) != 0)
+			{
+				tp->error = 0;
+				goto error;
+			}
+			
+			/* End of stream. */
+			if ((tp->flags & TCB_RCVFIN) ||
+				((tp->state == TCP_CLOSED) && (so->flags & SOCKET_CONNECTED)))
+				goto out;
+			
+			/* Not connected. */
+			if ((tp->state == TCP_CLOSED) || (tp->state == TCP_LISTEN))
+			{
+				err = -ENOTCONN;
+				goto error;
+			}
+		}
+		
+		/* Would block. */
+		if (*flags & MSG_DONTWAIT)
+		{
+			err = -EAGAIN;
+			goto error;
+		}
+		
+		sleep(&so->rchain, PRIO_INODE);
+		
+		/* Awaken by a signal. */
+		if (issig() != SIGNULL)
+		{
+			err = -EINTR;
+			goto error;
+		}
+	}
+	
+	/*
+	 * Packets only leave the queue here, so the
+	 * one at the head stays put while it is copied.
+	 */
+	tp->flags |= TCB_READING;
+	while ((i < n) && ((pkt = tp->rcvq) != NULL))
+	{
+		enable_interrupts();
+		
+		chunk = (pkt->dlen < n - i) ? pkt->dlen : n - i;
+		net_scatter(iov, iovcnt, i, &pkt->buf[pkt->off], chunk);
+		
+		disable_interrupts();
+		
+		i += chunk;
+		tp->rcvbytes -= chunk;
+		pkt->off += chunk;
+		
+		/* Partially read. */
+		if ((pkt->dlen -= chunk) > 0)
+			break;
+		
+		if ((tp->rcvq = pkt->next) == NULL)
+			tp->rcvtail = NULL;
+		tp->nrcv--;
+		net_free(pkt);
+	}
+	tp->flags &= ~TCB_READING;
+	
+	/* Pass on to the next reader. */
+	if (tp->rcvq != NULL)
+		wakeup(&so->rchain);
+	
+	/* Tell the peer that the window opened up. */
+	edge = tp->rcv_nxt + tcp_wnd(tp);
+	if (tcp_synced(tp) && !(tp->flags & TCB_RCVFIN) &&
+		((tp->rcv_adv == tp->rcv_nxt) || (edge - tp->rcv_adv >= 2*tp->mss)))
+		tcp_ack(tp);
+
+out:
+	enable_interrupts();
+	*flags = 0;
+	return ((ssize_t)i);
+
+error:
+	enable_interrupts();
+	curr_proc->errno = err;
+	return (-1);
+}
+
+/**
+ * @brief Asserts which operations on a TCP socket would not block.
+ * 
+ * @param so Socket.
+ * 
+ * @returns The events that are ready.
+ */
+PUBLIC int tcp_poll(struct socket *so)
+{
+	int revents;      /* Events ready. */
+	struct tcpcb *tp; /* Connection.   */
+	
+	tp = so->pcb;
+	
+	/* Listening socket. */
+	if (tp->state == TCP_LISTEN)
+		return ((tp->aq != NULL) ? POLLIN : 0);
+	
+	/* Connection gone, so nothing blocks. */
+	if ((tp->state == TCP_CLOSED) || (tp->error != 0))
+		return (POLLIN | POLLOUT | POLLHUP);
+	
+	revents = 0;
+	
+	if ((tp->rcvq != NULL) || (tp->flags & TCB_RCVFIN))
+		revents |= POLLIN;
+	
+	if (tcp_can_send(tp) && (tp->nsnd < TCP_SNDQ))
+		revents |= POLLOUT;
+	
+	return (revents);
+}
+
+/**
+ * @brief Gets the local or peer address of a TCP socket.
+ * 
+ * @param so   Socket.
+ * @param peer Peer address?
+ * @param sin  Where to store the address.
+ */
+PUBLIC void tcp_name(struct socket *so, int peer, struct sockaddr_in *sin)
+{
+	struct tcpcb *tp;
+	
+	tp = so->pcb;
+	
+	sin->sin_addr.s_addr = (peer) ? tp->faddr : tp->laddr;
+	sin->sin_port = (peer) ? tp->fport : tp->lport;
+}
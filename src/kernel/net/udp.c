@@ -0,0 +1,534 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/hal.h>
+#include <nanvix/klib.h>
+#include <nanvix/net.h>
+#include <nanvix/pm.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+
+/* First ephemeral port. */
+#define UDP_PORT_FIRST 49152
+
+/*
+ * UDP protocol control blocks.
+ */
+PRIVATE struct udppcb
+{
+	struct socket *so;   /* Socket (NULL if free).  */
+	in_addr_t laddr;     /* Local address.          */
+	in_addr_t faddr;     /* Peer address.           */
+	in_port_t lport;     /* Local port.             */
+	in_port_t fport;     /* Peer port.              */
+	struct packet *head; /* Oldest datagram queued. */
+	struct packet *tail; /* Newest datagram queued. */
+	unsigned nqueued;    /* Datagrams queued.       */
+} udppcbs[UDP_PCBS];
+
+/* Next ephemeral port. */
+PRIVATE unsigned udp_next_port = UDP_PORT_FIRST;
+
+/*
+ * Asserts if a local port is taken.
+ */
+PRIVATE int udp_port_used(in_port_t port)
+{
+	unsigned i;
+	
+	for (i = 0; i < UDP_PCBS; i++)
+	{
+		if ((udppcbs[i].so != NULL) && (udppcbs[i].lport == port))
+			return (1);
+	}
+	
+	return (0);
+}
+
+/*
+ * Picks a free ephemeral port.
+ */
+PRIVATE in_port_t udp_port(void)
+{
+	unsigned i;     /* Loop index.   */
+	in_port_t port; /* Working port. */
+	
+	for (i = 0; i < 65536 - UDP_PORT_FIRST; i++)
+	{
+		port = htons(udp_next_port);
+		if (++udp_next_port > 65535)
+			udp_next_port = UDP_PORT_FIRST;
+		
+		if (!udp_port_used(port))
+			return (port);
+	}
+	
+	return (0);
+}
+
+/**
+ * @brief Handles an incoming UDP datagram.
+ * 
+ * @param pkt Packet.
+ * @param dst Destination address.
+ * 
+ * @note Interrupts must be disabled.
+ */
+PUBLIC void udp_input(struct packet *pkt, in_addr_t dst)
+{
+	unsigned i;         /* Loop index. */
+	unsigned len;       /* UDP length. */
+	struct udp_hdr *uh; /* UDP header. */
+	struct udppcb *pcb; /* Receiver.   */
+	
+	uh = (struct udp_hdr *)&pkt->buf[pkt->off];
+	
+	/* Bad length. */
+	if ((pkt->dlen < UDP_HLEN) || ((len = ntohs(uh->len)) < UDP_HLEN) ||
+		(len > pkt->dlen))
+		goto drop;
+	
+	/* Bad checksum. */
+	if ((uh->sum != 0) &&
+		(net_fold(net_cksum(net_pseudo(pkt->saddr, dst, IPPROTO_UDP, len),
+		uh, len)) != 0))
+		goto drop;
+	
+	/* Find receiver. */
+	for (i = 0; i < UDP_PCBS; i++)
+	{
+		pcb = &udppcbs[i];
+		
+		if ((pcb->so == NULL) || (pcb->lport != uh->dport))
+			continue;
+		
+		/* Bound to another address. */
+		if ((pcb->laddr != 0) && (pcb->laddr != dst))
+			continue;
+		
+		/* Connected elsewhere. */
+		if ((pcb->faddr != 0) &&
+			((pcb->faddr != pkt->saddr) || (pcb->fport != uh->sport)))
+			continue;
+		
+		goto found;
+	}
+	
+drop:
+	net_free(pkt);
+	return;
+
+found:
+	/* Receiver is lagging behind. */
+	if (pcb->nqueued >= UDP_QUEUE_MAX)
+		goto drop;
+	
+	pkt->sport = uh->sport;
+	pkt->off += UDP_HLEN;
+	pkt->dlen = len - UDP_HLEN;
+	
+	if (pcb->tail == NULL)
+		pcb->head = pkt;
+	else
+		pcb->tail->next = pkt;
+	pcb->tail = pkt;
+	pcb->nqueued++;
+	
+	wakeup(&pcb->so->rchain);
+	pollwakeup(pcb->so->inode);
+}
+
+/**
+ * @brief Attaches a UDP control block to a socket.
+ * 
+ * @param so Socket.
+ * 
+ * @returns Zero on success, and a negative error code otherwise.
+ */
+PUBLIC int udp_attach(struct socket *so)
+{
+	unsigned i;
+	
+	disable_interrupts();
+	
+	for (i = 0; i < UDP_PCBS; i++)
+	{
+		if (udppcbs[i].so == NULL)
+			goto found;
+	}
+	
+	enable_interrupts();
+	return (-ENOBUFS);
+
+found:
+	kmemset(&udppcbs[i], 0, sizeof(struct udppcb));
+	udppcbs[i].so = so;
+	so->pcb = &udppcbs[i];
+	
+	enable_interrupts();
+	
+	return (0);
+}
+
+/**
+ * @brief Detaches the UDP control block of a socket.
+ * 
+ * @param so Socket.
+ */
+PUBLIC void udp_detach(struct socket *so)
+{
+	struct udppcb *pcb; /* Control block. */
+	struct packet *pkt; /* Datagram.      */
+	
+	pcb = so->pcb;
+	
+	disable_interrupts();
+	
+		while ((pkt = pcb->head) != NULL)
+		{
+			pcb->head = pkt->next;
+			net_free(pkt);
+		}
+		
+		pcb->so = NULL;
+		so->pcb = NULL;
+	
+	enable_interrupts();
+}
+
+/**
+ * @brief Binds a UDP socket to a local address and port.
+ * 
+ * @param so   Socket.
+ * @param addr Local address.
+ * @param port Local port (zero for any).
+ * 
+ * @returns Zero on success, and a negative error code otherwise.
+ */
+PUBLIC int udp_bind(struct socket *so, in_addr_t addr, in_port_t port)
+{
+	int ret;            /* Return value.  */
+	struct udppcb *pcb; /* Control block. */
+	
+	pcb = so->pcb;
+	ret = 0;
+	
+	disable_interrupts();
+	
+	/* Already bound. */
+	if (pcb->lport != 0)
+		ret = -EINVAL;
+	
+	/* Port taken. */
+	else if ((port != 0) && (udp_port_used(port)))
+		ret = -EADDRINUSE;
+	
+	/* Out of ports. */
+	else if ((port == 0) && ((port = udp_port()) == 0))
+		ret = -EADDRINUSE;
+	
+	else
+	{
+		pcb->laddr = addr;
+		pcb->lport = port;
+	}
+	
+	enable_interrupts();
+	
+	return (ret);
+}
+
+/**
+ * @brief Sets the default destination of a UDP socket.
+ * 
+ * @param so   Socket.
+ * @param addr Peer address (zero to disconnect).
+ * @param port Peer port.
+ * 
+ * @returns Zero on success, and a negative error code otherwise.
+ */
+PUBLIC int udp_connect(struct socket *so, in_addr_t addr, in_port_t port)
+{
+	int ret;            /* Return value.  */
+	struct udppcb *pcb; /* Control block. */
+	
+	pcb = so->pcb;
+	
+	/* Bind to an ephemeral port. */
+	if ((pcb->lport == 0) && ((ret = udp_bind(so, 0, 0)) < 0))
+		return (ret);
+	
+	disable_interrupts();
+	pcb->faddr = addr;
+	pcb->fport = (addr != 0) ? port : 0;
+	enable_interrupts();
+	
+	return (0);
+}
+
+/**
+ * @brief Sends a UDP datagram.
+ * 
+ * @param so     Socket.
+ * @param iov    Data buffers.
+ * @param iovcnt Number of data buffers.
+ * @param n      Number of bytes.
+ * @param to     Destination (NULL for the default one).
+ * @param flags  Message flags.
+ * 
+ * @returns The number of bytes sent. Upon failure, -1 is returned and the
+ *          error code is left in the current process.
+ */
+PUBLIC ssize_t udp_send(struct socket *so, const struct iovec *iov, int iovcnt,
+	size_t n, const struct sockaddr_in *to, int flags)
+{
+	int ret;            /* Return value.        */
+	in_addr_t dst;      /* Destination address. */
+	in_port_t dport;    /* Destination port.    */
+	struct udp_hdr *uh; /* UDP header.          */
+	struct udppcb *pcb; /* Control block.       */
+	struct packet *pkt; /* Datagram.            */
+	
+	pcb = so->pcb;
+	
+	/* Too big. */
+	if (n > UDP_DATA_MAX)
+	{
+		curr_proc->errno = -EMSGSIZE;
+		return (-1);
+	}
+	
+	if (to != NULL)
+	{
+		dst = to->sin_addr.s_addr;
+		dport = to->sin_port;
+	}
+	else
+	{
+		dst = pcb->faddr;
+		dport = pcb->fport;
+	}
+	
+	/* No destination. */
+	if ((dst == 0) || (dport == 0))
+	{
+		curr_proc->errno = (to != NULL) ? -EINVAL : -EDESTADDRREQ;
+		return (-1);
+	}
+	
+	/* Bind to an ephemeral port. */
+	if ((pcb->lport == 0) && ((ret = udp_bind(so, 0, 0)) < 0))
+	{
+		curr_proc->errno = ret;
+		return (-1);
+	}
+	
+	disable_interrupts();
+	
+	/* Wait for a packet. */
+	while ((pkt = net_alloc()) == NULL)
+	{
+		/* Would block. */
+		if (flags & MSG_DONTWAIT)
+		{
+			ret = -EAGAIN;
+			goto error0;
+		}
+		
+		sleep(&net_chain, PRIO_INODE);
+		
+		/* Awaken by a signal. */
+		if (issig() != SIGNULL)
+		{
+			ret = -EINTR;
+			goto error0;
+		}
+	}
+	
+	enable_interrupts();
+	
+	/* The packet is ours, so this may fault. */
+	net_gather(&pkt->buf[NET_L4OFF + UDP_HLEN], iov, iovcnt, 0, n);
+	
+	disable_interrupts();
+	
+	/* Interface down. */
+	if (!netif_running(net_if))
+	{
+		ret = -ENETDOWN;
+		goto error1;
+	}
+	
+	uh = (struct udp_hdr *)&pkt->buf[NET_L4OFF];
+	uh->sport = pcb->lport;
+	uh->dport = dport;
+	uh->len = htons(UDP_HLEN + n);
+	uh->sum = 0;
+	uh->sum = net_fold(net_cksum(net_pseudo(net_if->addr, dst, IPPROTO_UDP,
+		UDP_HLEN + n), uh, UDP_HLEN + n));
+	if (uh->sum == 0)
+		uh->sum = 0xffff;
+	pkt->len = NET_L4OFF + UDP_HLEN + n;
+	
+	/* Wait for the next hop and for transmit buffers. */
+	while ((ret = ip_output(pkt, net_if->addr, dst, IPPROTO_UDP)) < 0)
+	{
+		if ((ret != -EAGAIN) && (ret != -ENOBUFS))
+			goto error1;
+		
+		/* Would block. */
+		if (flags & MSG_DONTWAIT)
+		{
+			ret = -EAGAIN;
+			goto error1;
+		}
+		
+		sleep(&net_chain, PRIO_INODE);
+		
+		/* Awaken by a signal. */
+		if (issig() != SIGNULL)
+		{
+			ret = -EINTR;
+			goto error1;
+		}
+	}
+	
+	net_free(pkt);
+	enable_interrupts();
+	
+	return ((ssize_t)n);
+
+error1:
+	net_free(pkt);
+error0:
+	enable_interrupts();
+	curr_proc->errno = ret;
+	return (-1);
+}
+
+/**
+ * @brief Receives a UDP datagram.
+ * 
+ * @param so     Socket.
+ * @param iov    Data buffers.
+ * @param iovcnt Number of data buffers.
+ * @param n      Number of bytes.
+ * @param from   Where to store the sender (may be NULL).
+ * @param flags  Message flags, updated on return.
+ * 
+ * @returns The number of bytes received. Upon failure, -1 is returned and
+ *          the error code is left in the current process.
+ */
+PUBLIC ssize_t udp_recv(struct socket *so, const struct iovec *iov, int iovcnt,
+	size_t n, struct sockaddr_in *from, int *flags)
+{
+	size_t len;         /* Bytes received. */
+	struct udppcb *pcb; /* Control block.  */
+	struct packet *pkt; /* Datagram.       */
+	
+	pcb = so->pcb;
+	
+	disable_interrupts();
+	
+	/* Wait for a datagram. */
+	while ((pkt = pcb->head) == NULL)
+	{
+		/* Would block. */
+		if (*flags & MSG_DONTWAIT)
+		{
+			enable_interrupts();
+			curr_proc->errno = -EAGAIN;
+			return (-1);
+		}
+		
+		sleep(&so->rchain, PRIO_INODE);
+		
+		/* Awaken by a signal. */
+		if (issig() != SIGNULL)
+		{
+			enable_interrupts();
+			curr_proc->errno = -EINTR;
+			return (-1);
+		}
+	}
+	
+	if ((pcb->head = pkt->next) == NULL)
+		pcb->tail = NULL;
+	pcb->nqueued--;
+	
+	enable_interrupts();
+	
+	*flags = 0;
+	len = pkt->dlen;
+	if (len > n)
+	{
+		len = n;
+		*flags |= MSG_TRUNC;
+	}
+	net_scatter(iov, iovcnt, 0, &pkt->buf[pkt->off], len);
+	
+	if (from != NULL)
+	{
+		kmemset(from, 0, sizeof(struct sockaddr_in));
+		from->sin_family = AF_INET;
+		from->sin_port = pkt->sport;
+		from->sin_addr.s_addr = pkt->saddr;
+	}
+	
+	disable_interrupts();
+	net_free(pkt);
+	enable_interrupts();
+	
+	return ((ssize_t)len);
+}
+
+/**
+ * @brief Asserts which operations on a UDP socket would not block.
+ * 
+ * @param so Socket.
+ * 
+ * @returns The events that are ready.
+ */
+PUBLIC int udp_poll(struct socket *so)
+{
+	struct udppcb *pcb;
+	
+	pcb = so->pcb;
+	
+	return (((pcb->head != NULL) ? POLLIN : 0) | POLLOUT);
+}
+
+/**
+ * @brief Gets the local or peer address of a UDP socket.
+ * 
+ * @param so   Socket.
+ * @param peer Peer address?
+ * @param sin  Where to store the address.
+ */
+PUBLIC void udp_name(struct socket *so, int peer, struct sockaddr_in *sin)
+{
+	struct udppcb *pcb;
+	
+	pcb = so->pcb;
+	
+	sin->sin_addr.s_addr = (peer) ? pcb->faddr : pcb->laddr;
+	sin->sin_port = (peer) ? pcb->fport : pcb->lport;
+}
@@ -19,10 +19,16 @@
 
 #include <nanvix/const.h>
 #include <nanvix/dev.h>
+#include <nanvix/epoll.h>
 #include <nanvix/fs.h>
 #include <nanvix/klib.h>
 #include <nanvix/mm.h>
+#include <nanvix/mq.h>
 #include <nanvix/pm.h>
+#include <nanvix/syscall.h>
+#include <nanvix/uring.h>
+#include <nanvix/work.h>
+#include <i386/pmc.h>
 #include <signal.h>
 
 /**
@@ -30,6 +36,96 @@
  */
 PUBLIC int shutting_down = 0;
 
+/* Forward definitions. */
+PRIVATE void reap(void *);
+
+/**
+ * @brief Teardown of exited processes.
+ */
+PRIVATE struct work reaper = WORK_INITIALIZER(reap, NULL);
+
+/**
+ * @brief Is the reaper running?
+ */
+PRIVATE int reaping = 0;
+
+/**
+ * @brief Tears down the files and the address space of an exited process.
+ * 
+ * @details Closing the last reference to a file may write it back, and
+ *          freeing a large address space takes a while, so this is the
+ *          part of exiting that is usually left to the reaper.
+ * 
+ * @param proc Exited process.
+ */
+PRIVATE void teardown(struct process *proc)
+{
+	struct file *f; /* Working file. */
+	
+	/* Close file descriptors. */
+	for (unsigned i = 0; i < OPEN_MAX; i++)
+	{
+		if ((f = proc->ofiles[i]) == NULL)
+			continue;
+		
+		proc->ofiles[i] = NULL;
+		releasefile(f);
+	}
+	proc->ofmap = 0;
+	proc->close = 0;
+	
+	/* Detach process memory regions. */
+	for (unsigned i = 0; i < NR_PREGIONS; i++)
+		detachreg(proc, &proc->pregs[i]);
+	
+	/* Release root and pwd. */
+	inode_put(proc->root);
+	inode_put(proc->pwd);
+}
+
+/**
+ * @brief Tears down exited processes.
+ * 
+ * @details Processes flagged with #PROC_REAP are torn down one at a time.
+ *          Teardown may sleep, so processes that exit meanwhile are picked
+ *          up by another pass, rather than by a second worker. A process
+ *          that was buried meanwhile has its page directory destroyed here.
+ * 
+ * @param arg Unused.
+ */
+PRIVATE void reap(void *arg)
+{
+	int found;         /* Any process reaped? */
+	struct process *p; /* Working process.    */
+	
+	UNUSED(arg);
+	
+	/* Another worker is at it. */
+	if (reaping)
+		return;
+	reaping = 1;
+	
+	do
+	{
+		found = 0;
+		for (p = FIRST_PROC; p <= LAST_PROC; p++)
+		{
+			if (!(p->flags & (1 << PROC_REAP)))
+				continue;
+			
+			found = 1;
+			teardown(p);
+			p->flags &= ~(1 << PROC_REAP);
+			
+			/* Buried meanwhile. */
+			if (p->state == PROC_DEAD)
+				dstrypgdir(p);
+		}
+	} while (found);
+	
+	reaping = 0;
+}
+
 /**
  * @brief Kills the current running process.
  * 
@@ -45,6 +141,16 @@ PUBLIC void die(int status)
 	
 	curr_proc->status = status;
 	
+	/* Let a father suspended in vfork() go. */
+	vfrelease();
+	
+	/* FPU state is no longer needed. */
+	fpu_release(curr_proc);
+	
+	/* Performance counters and statistics too. */
+	pmc_release(curr_proc);
+	sysstat_release(curr_proc);
+	
 	/*
 	 * Ignore all signals since, 
 	 * process may sleep below.
@@ -52,59 +158,88 @@ PUBLIC void die(int status)
 	for (unsigned i = 0; i < NR_SIGNALS; i++)
 		curr_proc->handlers[i] = SIG_IGN;
 	
-	/* Close file descriptors. */
-	for (unsigned i = 0; i < OPEN_MAX; i++)
-		do_close(i);
+	/* Close message queues. */
+	for (unsigned i = 0; i < MQ_OPEN_MAX; i++)
+		do_mq_close(i);
+	
+	/* Close event poll instances. */
+	for (unsigned i = 0; i < EPOLL_MAX; i++)
+	{
+		if (curr_proc->epmap & (1 << i))
+			epoll_put(epoll_get(i));
+	}
+	curr_proc->epmap = 0;
+	
+	/* Close I/O rings. */
+	for (unsigned i = 0; i < URING_MAX; i++)
+	{
+		if (curr_proc->urmap & (1 << i))
+			uring_put(uring_get(i));
+	}
+	curr_proc->urmap = 0;
 	
 	/* Hangup terminal. */
 	if (IS_LEADER(curr_proc) && (curr_proc->tty != NULL_DEV))
 		cdev_close(curr_proc->tty);
 		
+	/* idle adopts all processes at shutdown. */
+	if (shutting_down)
+	{
+		for (p = FIRST_PROC; p <= LAST_PROC; p++)
+		{
+			/* Skip invalid processes. */
+			if (!IS_VALID(p))
+				continue;
+			
+			if (p->father != IDLE)
+				adopt(IDLE, p);
+		}
+	}
+	
 	/* init adopts orphan processes. */
-	for (p = FIRST_PROC; p <= LAST_PROC; p++)
+	else
 	{
-		/* Skip invalid processes. */
-		if (!IS_VALID(p))
-			continue;
-		
-		if (shutting_down)
-			p->father = IDLE;
-		else if (p->father == curr_proc)
+		while ((p = curr_proc->children) != NULL)
 		{
-			p->father = INIT;
-			p->father->nchildren++;
+			adopt(INIT, p);
 			sndsig(INIT, SIGCHLD);
 		}
 	}
 	
-	/* init adotps process in the same group. */
+	/* Members of the process group are left alone. */
 	if (curr_proc->pgrp == curr_proc)
 	{
-		for (p = FIRST_PROC; p <= LAST_PROC; p++)
+		while ((p = curr_proc->members) != NULL)
 		{
-			/* Skip invalid processes. */
-			if (!IS_VALID(p))
-				continue;
-			
-			if (p->pgrp == curr_proc)
-			{
-				p->pgrp = NULL;
-				sndsig(p, SIGHUP);
-				sndsig(p, SIGCONT);
-			}
+			curr_proc->members = p->gnext;
+			p->pgrp = NULL;
+			p->gnext = NULL;
+			sndsig(p, SIGHUP);
+			sndsig(p, SIGCONT);
 		}
 	}
 	
-	/* Detach process memory regions. */
-	for (unsigned i = 0; i < NR_PREGIONS; i++)
-		detachreg(curr_proc, &curr_proc->pregs[i]);
+	pgrss_peak(curr_proc);
 	
-	/* Release root and pwd. */
-	inode_put(curr_proc->root);
-	inode_put(curr_proc->pwd);
+	/*
+	 * Files and address space are torn down by the reaper,
+	 * so that the father may collect the exit status right
+	 * away. Workers are gone at shutdown, and a shared page
+	 * directory may be changed by its other user meanwhile.
+	 */
+	if ((shutting_down) || (sharedpgdir(curr_proc)))
+		teardown(curr_proc);
+	else
+		curr_proc->flags |= 1 << PROC_REAP;
+	
+	disable_interrupts();
 	
 	curr_proc->state = PROC_ZOMBIE;
-	curr_proc->alarm = 0;
+	curr_proc->itreal = 0;
+	setalarm(curr_proc, 0);
+	
+	if (curr_proc->flags & (1 << PROC_REAP))
+		work_queue(&reaper);
 	
 	sndsig(curr_proc->father, SIGCHLD);
 	
@@ -118,8 +253,13 @@ PUBLIC void die(int status)
  */
 PUBLIC void bury(struct process *proc)
 {
-	dstrypgdir(proc);
+	/* Otherwise, the reaper destroys it once done. */
+	if (!(proc->flags & (1 << PROC_REAP)))
+		dstrypgdir(proc);
+	
 	proc->state = PROC_DEAD;
-	proc->father->nchildren--;
+	pidhash_remove(proc);
+	setgrp(proc, NULL);
+	adopt(NULL, proc);
 	nprocs--;
 }
@@ -0,0 +1,171 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/clock.h>
+#include <nanvix/const.h>
+#include <nanvix/hal.h>
+#include <nanvix/klib.h>
+#include <nanvix/pm.h>
+#include <nanvix/work.h>
+#include <limits.h>
+
+/**
+ * @brief Interrupt enable flag.
+ */
+#define EFLAGS_IF (1 << 9)
+
+/**
+ * @brief Work queue.
+ */
+PRIVATE struct
+{
+	struct work *head; /**< First item. */
+	struct work *tail; /**< Last item.  */
+} workq = { NULL, NULL };
+
+/**
+ * @brief Idle workers.
+ */
+PRIVATE struct waitq kworker_chain = WAITQ_INITIALIZER;
+
+/**
+ * @brief Disables interrupts.
+ * 
+ * @returns Non-zero if interrupts were enabled, and zero otherwise.
+ */
+PRIVATE int workq_lock(void)
+{
+	dword_t eflags;
+	
+	__asm__ volatile ("pushfl; popl %0; cli" : "=r" (eflags) : : "memory");
+	
+	return (eflags & EFLAGS_IF);
+}
+
+/**
+ * @brief Enables interrupts again, if they were enabled.
+ */
+PRIVATE void workq_unlock(int enabled)
+{
+	if (enabled)
+		enable_interrupts();
+}
+
+/**
+ * @brief Initializes a deferred work item.
+ * 
+ * @param w    Work item to be initialized.
+ * @param func Function to call.
+ * @param arg  Argument to @p func.
+ */
+PUBLIC void work_init(struct work *w, void (*func)(void *), void *arg)
+{
+	w->next = NULL;
+	w->func = func;
+	w->arg = arg;
+	w->queued = 0;
+}
+
+/**
+ * @brief Submits a deferred work item to the kernel workers.
+ * 
+ * @details The function of @p w is later called by a kernel worker, in
+ *          process context and with interrupts enabled, so it may sleep.
+ *          This never sleeps itself and may be called from interrupt
+ *          handlers and bottom halves. A work item may be submitted again
+ *          as soon as its function starts running.
+ * 
+ * @param w Work item to be submitted.
+ * 
+ * @returns Zero if @p w was queued, and non-zero if it was already waiting
+ *          for a worker.
+ */
+PUBLIC int work_queue(struct work *w)
+{
+	int i;
+	
+	i = workq_lock();
+	
+	/* Already queued. */
+	if (w->queued)
+	{
+		workq_unlock(i);
+		return (-1);
+	}
+	
+	w->queued = 1;
+	w->next = NULL;
+	if (workq.head == NULL)
+		workq.head = w;
+	else
+		workq.tail->next = w;
+	workq.tail = w;
+	
+	wakeup_one(&kworker_chain);
+	
+	workq_unlock(i);
+	
+	return (0);
+}
+
+/**
+ * @brief Kernel worker.
+ * 
+ * @details Kernel workers are forked from the idle process at boot, so
+ *          they run in kernel mode on their own kernel stacks and are
+ *          scheduled like any other process, with nice value
+ *          #KWORKER_NICE. Each one takes work items off the work queue,
+ *          one at a time, and exits once the system is shutting down and
+ *          there is nothing left to be done.
+ */
+PUBLIC void kworker(void)
+{
+	struct work *w; /* Working item. */
+	
+	kstrncpy(curr_proc->name, "kworker", NAME_MAX);
+	curr_proc->nice = KWORKER_NICE;
+	
+	while (1)
+	{
+		disable_interrupts();
+		
+		if (workq.head == NULL)
+			tsleep(&kworker_chain, PRIO_BUFFER, CLOCK_FREQ);
+		
+		if ((w = workq.head) != NULL)
+		{
+			if ((workq.head = w->next) == NULL)
+				workq.tail = NULL;
+			w->next = NULL;
+			w->queued = 0;
+		}
+		
+		enable_interrupts();
+		
+		/* Nothing to be done. */
+		if (w == NULL)
+		{
+			if (shutting_down)
+				die(0);
+			continue;
+		}
+		
+		w->func(w->arg);
+	}
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/pm.h>
+#include <sys/lockstat.h>
+
+/**
+ * @brief Lock statistics, per lock class.
+ */
+PRIVATE struct
+{
+	unsigned acquires; /**< Locks taken.               */
+	unsigned waits;    /**< Sleeps waiting for a lock. */
+	unsigned boosts;   /**< Owners boosted by waiters. */
+} stats[LOCK_CLASSES];
+
+/**
+ * @brief Accounts for a lock being taken.
+ * 
+ * @param class Lock class.
+ */
+PUBLIC void lock_acquire(int class)
+{
+	stats[class].acquires++;
+}
+
+/**
+ * @brief Gets ready to sleep waiting for a lock.
+ * 
+ * @details Accounts for the wait, and lends the priority that the current
+ *          process is about to sleep with to the process @p owner that
+ *          holds the lock, if known. This way, a lock holder that would
+ *          otherwise run at some lower priority does not keep more urgent
+ *          waiters blocked.
+ * 
+ * @param class    Lock class.
+ * @param owner    Process that holds the lock (may be NULL).
+ * @param priority Priority that the current process shall sleep with.
+ */
+PUBLIC void lock_wait(int class, struct process *owner, int priority)
+{
+	stats[class].waits++;
+	
+	if ((owner != NULL) && (owner != curr_proc) && (sched_lend(owner, priority)))
+		stats[class].boosts++;
+}
+
+/**
+ * @brief Accounts for a lock being released.
+ * 
+ * @details If the lock is released by the process @p owner that took it,
+ *          any priority lent to that process is given back.
+ * 
+ * @param owner Process that held the lock (may be NULL).
+ * 
+ * @note A process that holds several contended locks loses the lent
+ *       priority as soon as it releases the first of them.
+ */
+PUBLIC void lock_release(struct process *owner)
+{
+	if (owner == curr_proc)
+		curr_proc->lent = PRIO_USER;
+}
+
+/**
+ * @brief Gets lock statistics.
+ * 
+ * @details Stores statistics about the lock class @p class in the location
+ *          pointed to by @p buf. The list of hot locks is left empty, to be
+ *          filled by the owner of the locked objects with lock_hot().
+ * 
+ * @param class Lock class.
+ * @param buf   Location where statistics shall be stored.
+ */
+PUBLIC void lock_stat(int class, struct lockstat *buf)
+{
+	buf->acquires = stats[class].acquires;
+	buf->waits = stats[class].waits;
+	buf->boosts = stats[class].boosts;
+	buf->nhot = 0;
+}
+
+/**
+ * @brief Reports a contended lock.
+ * 
+ * @details Inserts the lock of the object numbered @p num in the device
+ *          @p dev, which has been waited for @p waits times, in the list
+ *          of hot locks of @p buf. The list is kept sorted with the most
+ *          waited for locks first, and only the #LOCKSTAT_HOT hottest ones
+ *          are kept.
+ * 
+ * @param buf   Lock statistics.
+ * @param dev   Device of the locked object.
+ * @param num   Number of the locked object.
+ * @param waits Sleeps waiting for the lock.
+ */
+PUBLIC void lock_hot(struct lockstat *buf, unsigned dev, unsigned num, unsigned waits)
+{
+	unsigned i;
+	
+	/* Not contended. */
+	if (waits == 0)
+		return;
+	
+	/* Make room, dropping the coolest lock if the list is full. */
+	for (i = buf->nhot; (i > 0) && (buf->hot[i - 1].waits < waits); i--)
+	{
+		if (i < LOCKSTAT_HOT)
+			buf->hot[i] = buf->hot[i - 1];
+	}
+	
+	/* Not hot enough. */
+	if (i >= LOCKSTAT_HOT)
+		return;
+	
+	buf->hot[i].dev = dev;
+	buf->hot[i].num = num;
+	buf->hot[i].waits = waits;
+	
+	if (buf->nhot < LOCKSTAT_HOT)
+		buf->nhot++;
+}
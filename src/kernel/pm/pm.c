@@ -26,6 +26,7 @@
 #include <nanvix/hal.h>
 #include <nanvix/mm.h>
 #include <nanvix/pm.h>
+#include <nanvix/sem.h>
 #include <nanvix/klib.h>
 #include <sys/stat.h>
 #include <signal.h>
@@ -66,6 +67,144 @@ PUBLIC pid_t next_pid = 0;
  */
 PUBLIC unsigned nprocs = 0;
 
+/**
+ * @brief Process ID hash table.
+ */
+PRIVATE struct process *pidhash[PROC_MAX];
+
+/**
+ * @brief Hashes a process ID.
+ */
+#define PIDHASH(pid) ((unsigned)(pid)%PROC_MAX)
+
+/**
+ * @brief Inserts a process in the process ID hash table.
+ * 
+ * @param proc Process to be inserted.
+ */
+PUBLIC void pidhash_insert(struct process *proc)
+{
+	struct process **head;
+	
+	head = &pidhash[PIDHASH(proc->pid)];
+	proc->hnext = *head;
+	*head = proc;
+}
+
+/**
+ * @brief Removes a process from the process ID hash table.
+ * 
+ * @param proc Process to be removed.
+ */
+PUBLIC void pidhash_remove(struct process *proc)
+{
+	struct process **pp;
+	
+	for (pp = &pidhash[PIDHASH(proc->pid)]; *pp != NULL; pp = &(*pp)->hnext)
+	{
+		if (*pp == proc)
+		{
+			*pp = proc->hnext;
+			break;
+		}
+	}
+	
+	proc->hnext = NULL;
+}
+
+/**
+ * @brief Gets a process.
+ * 
+ * @param pid ID of the target process.
+ * 
+ * @returns The valid process whose ID is @p pid, or NULL if there is none.
+ */
+PUBLIC struct process *getproc(pid_t pid)
+{
+	struct process *p;
+	
+	for (p = pidhash[PIDHASH(pid)]; p != NULL; p = p->hnext)
+	{
+		if ((p->pid == pid) && (IS_VALID(p)))
+			return (p);
+	}
+	
+	return (NULL);
+}
+
+/**
+ * @brief Changes the father of a process.
+ * 
+ * @details Moves the process pointed to by @p proc from the children list of
+ *          its current father, if any, to the children list of @p father.
+ * 
+ * @param father New father process (NULL to only leave the current one).
+ * @param proc   Target process.
+ */
+PUBLIC void adopt(struct process *father, struct process *proc)
+{
+	struct process **pp;
+	
+	/* Leave current father. */
+	if (proc->father != NULL)
+	{
+		for (pp = &proc->father->children; *pp != proc; pp = &(*pp)->sibling)
+			noop();
+		*pp = proc->sibling;
+		proc->father->nchildren--;
+	}
+	
+	proc->father = father;
+	proc->sibling = NULL;
+	
+	/* Join new father. */
+	if (father != NULL)
+	{
+		proc->sibling = father->children;
+		father->children = proc;
+		father->nchildren++;
+	}
+}
+
+/**
+ * @brief Changes the process group of a process.
+ * 
+ * @details Moves the process pointed to by @p proc from the member list of its
+ *          current process group, if any, to the process group led by
+ *          @p leader.
+ * 
+ * @param proc   Target process.
+ * @param leader Leader of the new process group (NULL to only leave the
+ *               current one).
+ */
+PUBLIC void setgrp(struct process *proc, struct process *leader)
+{
+	struct process **pp;
+	
+	/* Leave current group. */
+	if (proc->pgrp != NULL)
+	{
+		for (pp = &proc->pgrp->members; *pp != NULL; pp = &(*pp)->gnext)
+		{
+			if (*pp == proc)
+			{
+				*pp = proc->gnext;
+				break;
+			}
+		}
+	}
+	
+	proc->pgrp = leader;
+	proc->gnext = NULL;
+	
+	/* Join new group. */
+	if (leader != NULL)
+	{
+		proc->gnext = leader->members;
+		leader->members = proc;
+	}
+}
+
 /**
  * @brief Initializes the process management system.
  */
@@ -83,6 +222,7 @@ PUBLIC void pm_init(void)
 	IDLE->intlvl = 1;
 	IDLE->flags = 0;
 	IDLE->received = 0;
+	IDLE->blocked = 0;
 	IDLE->kstack = idle_kstack;
 	IDLE->restorer = NULL;
 	for (i = 0; i < NR_SIGNALS; i++)
@@ -91,10 +231,12 @@ PUBLIC void pm_init(void)
 	IDLE->pgdir = idle_pgdir;
 	for (i = 0; i < NR_PREGIONS; i++)
 		IDLE->pregs[i].reg = NULL;
+	IDLE->npregs = 0;
 	IDLE->size = 0;
 	for (i = 0; i < OPEN_MAX; i++)
 		IDLE->ofiles[i] = NULL;
 	IDLE->close = 0;
+	IDLE->ofmap = 0;
 	IDLE->umask = S_IXUSR | S_IWGRP | S_IXGRP | S_IWOTH | S_IXOTH;
 	IDLE->tty = NULL_DEV;
 	IDLE->status = 0;
@@ -108,20 +250,38 @@ PUBLIC void pm_init(void)
 	IDLE->pid = next_pid++;
 	IDLE->pgrp = IDLE;
 	IDLE->father = NULL;
+	IDLE->children = NULL;
+	IDLE->sibling = NULL;
+	IDLE->members = IDLE;
+	IDLE->gnext = NULL;
+	pidhash_insert(IDLE);
 	kstrncpy(IDLE->name, "idle", NAME_MAX);
 	IDLE->utime = 0;
 	IDLE->ktime = 0;
 	IDLE->cutime = 0;
 	IDLE->cktime = 0;
+	IDLE->itreal = 0;
+	IDLE->itvirt = 0;
+	IDLE->itvirtint = 0;
+	IDLE->itprof = 0;
+	IDLE->itprofint = 0;
+	IDLE->profscale = 0;
 	IDLE->state = PROC_RUNNING;
 	IDLE->counter = PROC_QUANTUM;
 	IDLE->priority = PRIO_USER;
 	IDLE->nice = NZERO;
+	IDLE->level = 0;
+	IDLE->lent = PRIO_USER;
+	IDLE->policy = SCHED_OTHER;
+	IDLE->rtprio = 0;
+	IDLE->ioprio = IOPRIO_CLASS_BE;
 	IDLE->alarm = 0;
 	IDLE->next = NULL;
-	IDLE->chain = NULL;
+	IDLE->waitq = NULL;
 	
 	nprocs++;
+	
+	sem_init();
 
 	enable_interrupts();
 }
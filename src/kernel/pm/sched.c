@@ -21,18 +21,596 @@
 #include <nanvix/clock.h>
 #include <nanvix/const.h>
 #include <nanvix/hal.h>
+#include <nanvix/klib.h>
+#include <nanvix/ktrace.h>
+#include <nanvix/mm.h>
 #include <nanvix/pm.h>
+#include <nanvix/timepage.h>
+#include <i386/pmc.h>
+#include <limits.h>
 #include <signal.h>
+#include <stdint.h>
+
+/**
+ * @brief First ready queue of real-time processes.
+ */
+#define RTQ ((PRIO_USER - PRIO_IO)/(PRIO_BUFFER - PRIO_IO))
+
+/**
+ * @brief Ready queues of real-time processes.
+ */
+#define RTMASK (((1 << NR_RTQUEUES) - 1) << RTQ)
+
+/**
+ * @brief Ready queue of user processes.
+ */
+#define USERQ (RTQ + NR_RTQUEUES)
+
+/**
+ * @brief Ready queues.
+ * 
+ * @details Ready processes are kept in FIFO queues, one for each
+ *          priority level. Lower queue indexes correspond to higher
+ *          priorities.
+ */
+PRIVATE struct
+{
+	struct process *head; /**< First process in the queue. */
+	struct process *tail; /**< Last process in the queue.  */
+} readyq[NR_READYQ];
+
+/**
+ * @brief Bitmap of non-empty ready queues.
+ */
+PRIVATE unsigned readymap = 0;
+
+/**
+ * @brief Scheduler statistics.
+ */
+PRIVATE struct
+{
+	unsigned nready;   /**< Processes in the ready queues.           */
+	unsigned switches; /**< Context switches.                        */
+	unsigned idle;     /**< Times that IDLE was chosen.              */
+	unsigned stretch;  /**< Ticks others have waited for the kernel. */
+	unsigned maxstretch; /**< Longest such wait.                     */
+} stats = { 0, 0, 0, 0, 0 };
+
+/**
+ * @brief Should the current process yield at the next preemption point?
+ */
+PUBLIC int need_resched = 0;
+
+/**
+ * @brief Processes suspended by memory load control.
+ */
+PRIVATE struct waitq suspended = WAITQ_INITIALIZER;
+
+/**
+ * @brief Real-time bandwidth.
+ * 
+ * @details Real-time processes may run for at most #SCHED_RT_RUNTIME
+ *          ticks in every #SCHED_RT_PERIOD ticks while time sharing
+ *          processes are ready, so that a runaway real-time process
+ *          cannot lock the system up.
+ */
+PRIVATE struct
+{
+	unsigned used; /**< Ticks used in the current period. */
+	unsigned end;  /**< End of the current period.        */
+} rt = { 0, 0 };
+
+/**
+ * @brief Asserts if real-time processes used up their bandwidth.
+ */
+#define RT_THROTTLED() \
+	((rt.used >= SCHED_RT_RUNTIME) && (ticks < rt.end))
+
+#if (SCHED_MLFQ)
+
+/**
+ * @brief Next priority boost.
+ */
+PRIVATE unsigned nextboost = MLFQ_BOOST;
+
+#endif
+
+/**
+ * @brief Gets the ready queue of a process.
+ * 
+ * @param proc Process.
+ * 
+ * @returns The index of the ready queue where @p proc should be placed.
+ */
+PRIVATE int readyq_index(struct process *proc)
+{
+	int i;
+	int priority;
+	
+	/* Waiters for our locks may have lent us a higher priority. */
+	priority = (proc->lent < proc->priority) ? proc->lent : proc->priority;
+	
+	i = (priority - PRIO_IO)/(PRIO_BUFFER - PRIO_IO);
+	
+	if (i < 0)
+		return (0);
+	if (i >= RTQ)
+	{
+		/* Higher real-time priorities come first. */
+		if (proc->policy != SCHED_OTHER)
+			return (RTQ + SCHED_RTPRIO_MAX - proc->rtprio);
+		
+#if (SCHED_MLFQ)
+		return (USERQ + proc->level);
+#else
+		return (USERQ);
+#endif
+	}
+	
+	return (i);
+}
+
+/**
+ * @brief Computes the quantum of a process.
+ * 
+ * @details First in, first out real-time processes run until they block
+ *          or get preempted, and round robin ones get the plain quantum.
+ *          Otherwise, with #SCHED_MLFQ, lower feedback levels get longer
+ *          quanta, and the result is weighted by the nice value of the
+ *          process: a process with nice #NZERO gets the plain quantum of
+ *          its level, while smaller nice values stretch it up to twice as
+ *          long, and larger ones shrink it.
+ * 
+ * @param proc Process.
+ * 
+ * @returns The quantum of @p proc, in clock ticks.
+ */
+PRIVATE int quantum(struct process *proc)
+{
+	int q;
+	
+	/* Real-time process. */
+	if (proc->policy == SCHED_FIFO)
+		return (INT_MAX);
+	if ((proc->policy == SCHED_RR) || (proc == IDLE))
+		return (PROC_QUANTUM);
+	
+#if (SCHED_MLFQ)
+	q = ((PROC_QUANTUM/2) << proc->level);
+	q = (q*(2*NZERO - proc->nice))/NZERO;
+#else
+	q = PROC_QUANTUM;
+#endif
+	
+	return ((q > 0) ? q : 1);
+}
+
+/**
+ * @brief Inserts a process in a ready queue.
+ * 
+ * @param proc Process to be inserted.
+ * @param i    Ready queue.
+ * @param head Insert at the head of the queue, instead of at the tail?
+ */
+PRIVATE void readyq_insert(struct process *proc, int i, int head)
+{
+	if (readyq[i].head == NULL)
+	{
+		proc->rnext = NULL;
+		readyq[i].head = readyq[i].tail = proc;
+	}
+	else if (head)
+	{
+		proc->rnext = readyq[i].head;
+		readyq[i].head = proc;
+	}
+	else
+	{
+		proc->rnext = NULL;
+		readyq[i].tail->rnext = proc;
+		readyq[i].tail = proc;
+	}
+	readymap |= 1 << i;
+}
+
+/**
+ * @brief Removes a process from a ready queue.
+ * 
+ * @param proc Process to be removed.
+ * @param i    Ready queue.
+ * 
+ * @returns Non-zero if @p proc was found in the ready queue, and zero
+ *          otherwise.
+ */
+PRIVATE int readyq_remove(struct process *proc, int i)
+{
+	struct process *p; /* Working process. */
+	
+	if (readyq[i].head == proc)
+	{
+		if ((readyq[i].head = proc->rnext) == NULL)
+		{
+			readyq[i].tail = NULL;
+			readymap &= ~(1 << i);
+		}
+		
+		return (1);
+	}
+	
+	for (p = readyq[i].head; (p != NULL) && (p->rnext != proc); p = p->rnext)
+		noop();
+	
+	/* Not found. */
+	if (p == NULL)
+		return (0);
+	
+	if ((p->rnext = proc->rnext) == NULL)
+		readyq[i].tail = p;
+	
+	return (1);
+}
 
 /**
  * @brief Schedules a process to execution.
  * 
+ * @details A preempted first in, first out real-time process goes back to
+ *          the head of its ready queue, and a real-time process that gets
+ *          ready ahead of the current process has it yield as soon as
+ *          possible.
+ * 
  * @param proc Process to be scheduled.
  */
 PUBLIC void sched(struct process *proc)
 {
+	int i;
+	
+	/* Already scheduled. */
+	if (proc->state == PROC_READY)
+		return;
+	
 	proc->state = PROC_READY;
 	proc->counter = 0;
+	
+	/* IDLE runs only when no other process is ready. */
+	if (proc == IDLE)
+		return;
+	
+	/* Enqueue process. */
+	i = readyq_index(proc);
+	readyq_insert(proc, i, (proc == curr_proc) && (proc->policy == SCHED_FIFO));
+	stats.nready++;
+	
+	/* Preempt the current process. */
+	if ((proc->policy != SCHED_OTHER) && (curr_proc != IDLE))
+	{
+		if ((curr_proc != proc) && (i < readyq_index(curr_proc)))
+			need_resched = 1;
+	}
+}
+
+/**
+ * @brief Lends a priority to a process.
+ * 
+ * @details Lends the priority @p priority to the process @p proc, which
+ *          holds a lock that the current process is about to wait for. The
+ *          lent priority is used to choose the ready queue of @p proc until
+ *          it is given back, and @p proc is moved ahead right away if it is
+ *          already ready to run. This bounds priority inversion whenever a
+ *          lock holder sleeps at, or is preempted to, a lower priority than
+ *          its waiters, such as a process at a lower feedback level.
+ * 
+ * @param proc     Process that holds the lock.
+ * @param priority Priority to be lent.
+ * 
+ * @returns Non-zero if @p proc was boosted, and zero if it already ran at
+ *          least as urgently.
+ */
+PUBLIC int sched_lend(struct process *proc, int priority)
+{
+	int i, j; /* Ready queues. */
+	
+	/* Already as urgent. */
+	if (priority >= proc->lent)
+		return (0);
+	
+	i = readyq_index(proc);
+	proc->lent = priority;
+	
+	/* Not waiting in a ready queue. */
+	if ((proc->state != PROC_READY) || (proc == IDLE))
+		return (1);
+	
+	/* Same ready queue. */
+	if ((j = readyq_index(proc)) == i)
+		return (1);
+	
+	/* Not found, so leave it where it is. */
+	if (!readyq_remove(proc, i))
+		return (1);
+	
+	readyq_insert(proc, j, 0);
+	
+	return (1);
+}
+
+/**
+ * @brief Sets the scheduling policy of a process.
+ * 
+ * @details Sets the scheduling policy of the process @p proc to @p policy,
+ *          with real-time priority @p rtprio, and moves it to its new
+ *          ready queue if it is ready to run.
+ * 
+ * @param proc   Target process.
+ * @param policy Scheduling policy.
+ * @param rtprio Real-time priority, zero for #SCHED_OTHER.
+ * 
+ * @note Interrupts must be disabled.
+ */
+PUBLIC void sched_setpolicy(struct process *proc, int policy, int rtprio)
+{
+	int ready; /* In a ready queue? */
+	
+	ready = (proc->state == PROC_READY) && (proc != IDLE);
+	if (ready)
+		ready = readyq_remove(proc, readyq_index(proc));
+	
+	proc->policy = policy;
+	proc->rtprio = rtprio;
+	
+	if (ready)
+		readyq_insert(proc, readyq_index(proc), 0);
+	
+	/* Start over with the quantum of the new policy. */
+	if (proc == curr_proc)
+		proc->counter = quantum(proc);
+	
+	/* Let the scheduler have a new look. */
+	need_resched = 1;
+}
+
+/**
+ * @brief Accounts for a clock tick.
+ * 
+ * @details The tick is charged against the quantum of the current process
+ *          and, if it is a real-time process, against the real-time
+ *          bandwidth. Once the quantum is used up or some more urgent
+ *          process gets ready, the current process yields right away, if
+ *          the tick was spent in user mode, or at the next preemption point
+ *          otherwise. Kernel ticks during which other processes are ready to
+ *          run add up to the current non-preemptible stretch, and the longest
+ *          stretch is kept.
+ * 
+ * @param user Was the tick spent in user mode?
+ * 
+ * @note Interrupts must be disabled.
+ */
+PUBLIC void sched_tick(int user)
+{
+	/* New real-time bandwidth period. */
+	if (ticks >= rt.end)
+	{
+		rt.used = 0;
+		rt.end = ticks + SCHED_RT_PERIOD;
+	}
+	
+	/* IDLE only runs when nobody else can. */
+	if (curr_proc == IDLE)
+		return;
+	
+	/* Real-time bandwidth exhausted. */
+	if ((curr_proc->policy != SCHED_OTHER) && (++rt.used >= SCHED_RT_RUNTIME))
+		curr_proc->counter = 0;
+	
+	/* Others are waiting for us. */
+	if ((!user) && (runnable()))
+	{
+		if (++stats.stretch > stats.maxstretch)
+			stats.maxstretch = stats.stretch;
+	}
+	
+	if (--curr_proc->counter <= 0)
+		need_resched = 1;
+	
+	/* Process was suspended. */
+	if (curr_proc->flags & (1 << PROC_SUSPEND))
+		need_resched = 1;
+	
+	/* Give up processor time. */
+	if ((user) && (need_resched))
+		preempt();
+}
+
+/**
+ * @brief Preemption point.
+ * 
+ * @details Yields the processor if the quantum of the current process has
+ *          expired. Long-running kernel loops call this at points where
+ *          the kernel state is consistent, so that other processes do not
+ *          stall meanwhile. Sleep locks may be held across it, as they are
+ *          across any sleep.
+ */
+PUBLIC void resched(void)
+{
+	if (!need_resched)
+		return;
+	
+	disable_interrupts();
+	yield();
+	enable_interrupts();
+}
+
+/**
+ * @brief Yields the processor on the way back to user mode.
+ * 
+ * @details The process holds no sleep locks by now, so any priority lent
+ *          to it by lock waiters is given back. A process suspended by
+ *          load control sleeps here until it is resumed or signalled.
+ */
+PUBLIC void preempt(void)
+{
+	curr_proc->lent = PRIO_USER;
+	
+	if (curr_proc->flags & (1 << PROC_SUSPEND))
+	{
+		sleep(&suspended, PRIO_USER);
+		return;
+	}
+	
+	yield();
+}
+
+/**
+ * @brief Suspends a process.
+ * 
+ * @details The process stops on its way back to user mode, that is when it
+ *          holds no kernel resources, and does not run again until resumed
+ *          by sched_unsuspend(). Signals still awake it, so that it may be
+ *          killed, but it goes back to sleep afterwards.
+ * 
+ * @param proc Process to be suspended.
+ */
+PUBLIC void sched_suspend(struct process *proc)
+{
+	proc->flags |= (1 << PROC_SUSPEND);
+}
+
+/**
+ * @brief Resumes a suspended process.
+ * 
+ * @param proc Process to be resumed.
+ */
+PUBLIC void sched_unsuspend(struct process *proc)
+{
+	disable_interrupts();
+	
+	proc->flags &= ~(1 << PROC_SUSPEND);
+	
+	/* Sleeping in preempt(). */
+	if ((proc->state == PROC_WAITING) && (proc->waitq == &suspended))
+		wake(proc, WAKE_NORMAL);
+	
+	enable_interrupts();
+}
+
+/**
+ * @brief Asserts if any process is ready to run.
+ * 
+ * @returns Non-zero if some process other than IDLE is ready to run, and
+ *          zero otherwise.
+ */
+PUBLIC int runnable(void)
+{
+	return (readymap != 0);
+}
+
+/**
+ * @brief Gets scheduler statistics.
+ * 
+ * @param nready   Store location for the length of the ready queues.
+ * @param switches Store location for the number of context switches.
+ * @param idle     Store location for the number of times the processor
+ *                 was left idle.
+ * @param stretch  Store location for the longest time, in clock ticks,
+ *                 that ready processes waited for the kernel to yield.
+ */
+PUBLIC void sched_stat(unsigned *nready, unsigned *switches, unsigned *idle, unsigned *stretch)
+{
+	*nready = stats.nready;
+	*switches = stats.switches;
+	*idle = stats.idle;
+	*stretch = stats.maxstretch;
+}
+
+/**
+ * @brief Rings the alarm of a process.
+ * 
+ * @param arg Target process.
+ */
+PRIVATE void ringalarm(void *arg)
+{
+	struct process *proc = arg;
+	
+	proc->alarm = 0;
+	
+	/* Interval timer. */
+	if (proc->itreal)
+		setalarm(proc, ticks + proc->itreal);
+	
+	sndsig(proc, SIGALRM);
+}
+
+/**
+ * @brief Sets the alarm of a process.
+ * 
+ * @param proc  Target process.
+ * @param alarm Tick at which the alarm rings (zero to cancel).
+ * 
+ * @note Interrupts must be disabled.
+ */
+PUBLIC void setalarm(struct process *proc, unsigned alarm)
+{
+	proc->alarm = alarm;
+	
+	timer_cancel(&proc->alarmtm);
+	if (alarm)
+	{
+		timer_init(&proc->alarmtm, ringalarm, proc);
+		timer_add(&proc->alarmtm, alarm);
+	}
+}
+
+/**
+ * @brief Accounts a clock tick to the interval timers of the current process.
+ * 
+ * @details The virtual timer runs while the process executes in user mode,
+ *          and the profiling timer while it executes in either mode. When
+ *          user mode is interrupted and profil() is on, the histogram
+ *          bucket of the interrupted instruction is incremented as well.
+ *          The histogram cannot be faulted in from the clock interrupt, so
+ *          ticks whose bucket is not writable in core are not recorded.
+ * 
+ * @param user Was the process running in user mode?
+ * 
+ * @note Interrupts must be disabled.
+ */
+PUBLIC void itimer_tick(int user)
+{
+	uint64_t i;        /* Histogram bucket.      */
+	addr_t pc;         /* Interrupted address.   */
+	struct process *p; /* Current process.       */
+	
+	p = curr_proc;
+	
+	/* Virtual timer. */
+	if ((user) && (p->itvirt) && (--p->itvirt == 0))
+	{
+		p->itvirt = p->itvirtint;
+		sndsig(p, SIGVTALRM);
+	}
+	
+	/* Profiling timer. */
+	if ((p->itprof) && (--p->itprof == 0))
+	{
+		p->itprof = p->itprofint;
+		sndsig(p, SIGPROF);
+	}
+	
+	/* Not profiling. */
+	if ((!user) || (p->profscale == 0))
+		return;
+	
+	pc = ((struct intstack *)p->kesp)->eip;
+	
+	/* Outside profiled range. */
+	if (pc < p->profoff)
+		return;
+	
+	i = ((uint64_t)((pc - p->profoff) >> 1)*p->profscale) >> 16;
+	if (i >= p->profsize/sizeof(unsigned short))
+		return;
+	
+	if (writableupg((addr_t)&p->profbuf[i]))
+		p->profbuf[i]++;
 }
 
 /**
@@ -59,63 +637,140 @@ PUBLIC void resume(struct process *proc)
 		sched(proc);
 }
 
+#if (SCHED_MLFQ)
+
+/**
+ * @brief Updates the feedback level of the current process.
+ * 
+ * @details A process that used up its whole quantum is moved
+ *          one level down, whereas a process that blocked before
+ *          its quantum expired is moved one level up.
+ */
+PRIVATE void feedback(void)
+{
+	/* IDLE and real-time processes have no level. */
+	if ((curr_proc == IDLE) || (curr_proc->policy != SCHED_OTHER))
+		return;
+	
+	/* CPU hog. */
+	if (curr_proc->state == PROC_RUNNING)
+	{
+		if ((curr_proc->counter <= 0) && (curr_proc->level < MLFQ_LEVELS - 1))
+			curr_proc->level++;
+	}
+	
+	/* Blocked. */
+	else if (curr_proc->level > 0)
+		curr_proc->level--;
+}
+
+/**
+ * @brief Periodically moves all processes to the top feedback level.
+ * 
+ * @details This prevents processes in lower levels from starving.
+ */
+PRIVATE void boost(void)
+{
+	int i;
+	struct process *p;
+	
+	/* Not yet. */
+	if (ticks < nextboost)
+		return;
+	
+	nextboost = ticks + MLFQ_BOOST;
+	
+	for (p = FIRST_PROC; p <= LAST_PROC; p++)
+	{
+		if (IS_VALID(p))
+			p->level = 0;
+	}
+	
+	/* Merge lower user queues into the top one. */
+	for (i = USERQ + 1; i < NR_READYQ; i++)
+	{
+		if (readyq[i].head == NULL)
+			continue;
+		
+		if (readyq[USERQ].head == NULL)
+			readyq[USERQ].head = readyq[i].head;
+		else
+			readyq[USERQ].tail->rnext = readyq[i].head;
+		readyq[USERQ].tail = readyq[i].tail;
+		readyq[i].head = readyq[i].tail = NULL;
+		readymap = (readymap & ~(1 << i)) | (1 << USERQ);
+	}
+}
+
+#endif
+
 /**
  * @brief Yields the processor.
  */
 PUBLIC void yield(void)
 {
-	struct process *p;    /* Working process.     */
+	int i;                /* Ready queue.         */
+	int preempted;        /* Still runnable?      */
+	unsigned map;         /* Eligible queues.     */
 	struct process *next; /* Next process to run. */
 
+#if (SCHED_MLFQ)
+	feedback();
+	boost();
+#endif
+
+	/* The kernel gives up the processor. */
+	need_resched = 0;
+	stats.stretch = 0;
+
 	/* Re-schedule process for execution. */
-	if (curr_proc->state == PROC_RUNNING)
+	if ((preempted = (curr_proc->state == PROC_RUNNING)))
 		sched(curr_proc);
 
 	/* Remember this process. */
 	last_proc = curr_proc;
 
-	/* Check alarm. */
-	for (p = FIRST_PROC; p <= LAST_PROC; p++)
-	{
-		/* Skip invalid processes. */
-		if (!IS_VALID(p))
-			continue;
-		
-		/* Alarm has expired. */
-		if ((p->alarm) && (p->alarm < ticks))
-			p->alarm = 0, sndsig(p, SIGALRM);
-	}
+	/*
+	 * Real-time processes that used up their bandwidth
+	 * only run if no time sharing process is ready.
+	 */
+	map = readymap;
+	if ((RT_THROTTLED()) && (map & ~RTMASK))
+		map &= ~RTMASK;
 
 	/* Choose a process to run next. */
 	next = IDLE;
-	for (p = FIRST_PROC; p <= LAST_PROC; p++)
+	if (map)
 	{
-		/* Skip non-ready process. */
-		if (p->state != PROC_READY)
-			continue;
+		i = __builtin_ctz(map);
+		next = readyq[i].head;
 		
-		/*
-		 * Process with higher
-		 * waiting time found.
-		 */
-		if (p->counter > next->counter)
+		/* Dequeue process. */
+		if ((readyq[i].head = next->rnext) == NULL)
 		{
-			next->counter++;
-			next = p;
+			readyq[i].tail = NULL;
+			readymap &= ~(1 << i);
 		}
-			
-		/*
-		 * Increment waiting
-		 * time of process.
-		 */
-		else
-			p->counter++;
+		next->rnext = NULL;
+		stats.nready--;
 	}
+	else
+		stats.idle++;
 	
 	/* Switch to next process. */
 	next->priority = PRIO_USER;
 	next->state = PROC_RUNNING;
-	next->counter = PROC_QUANTUM;
+	next->counter = quantum(next);
 	if (curr_proc != next)
+	{
+		stats.switches++;
+		if (preempted)
+			curr_proc->nivcsw++;
+		else
+			curr_proc->nvcsw++;
+		ktrace(KTRACE_SWITCH, curr_proc->pid, next->pid);
+		pmc_switch(curr_proc, next);
+		clock_timepage()->pid = next->pid;
 		switch_to(next);
+	}
 }
@@ -0,0 +1,170 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/klib.h>
+#include <nanvix/pm.h>
+#include <nanvix/sem.h>
+
+/**
+ * @brief Semaphore table.
+ */
+PRIVATE struct semaphore semtab[SEM_MAX];
+
+/**
+ * @brief Hash table of semaphores, indexed by key.
+ */
+PRIVATE struct semaphore *hashtab[SEM_HASHTAB_SIZE];
+
+/**
+ * @brief Free semaphores.
+ */
+PRIVATE struct semaphore *free_sems = NULL;
+
+/**
+ * @brief Hash function for semaphore keys.
+ */
+#define HASH(key) ((key)%SEM_HASHTAB_SIZE)
+
+/**
+ * @brief Searches for a semaphore.
+ * 
+ * @param key Key of the semaphore.
+ * 
+ * @returns The semaphore that has key @p key, or NULL if there is none.
+ */
+PUBLIC struct semaphore *sem_lookup(unsigned key)
+{
+	struct semaphore *sem;
+	
+	for (sem = hashtab[HASH(key)]; sem != NULL; sem = sem->next)
+	{
+		if (sem->key == key)
+			return (sem);
+	}
+	
+	return (NULL);
+}
+
+/**
+ * @brief Allocates a semaphore.
+ * 
+ * @param key Key of the semaphore.
+ * 
+ * @returns A new semaphore with value zero, or NULL if the semaphore table
+ *          is full.
+ * 
+ * @note No semaphore with key @p key must exist.
+ */
+PUBLIC struct semaphore *sem_alloc(unsigned key)
+{
+	struct semaphore *sem;
+	
+	/* Semaphore table is full. */
+	if ((sem = free_sems) == NULL)
+		return (NULL);
+	
+	free_sems = sem->next;
+	
+	sem->valid = 1;
+	sem->value = 0;
+	sem->key = key;
+	waitq_init(&sem->chain);
+	waitq_init(&sem->zchain);
+	
+	/* Insert in the hash table. */
+	sem->next = hashtab[HASH(key)];
+	hashtab[HASH(key)] = sem;
+	
+	return (sem);
+}
+
+/**
+ * @brief Gets a semaphore.
+ * 
+ * @param semid ID of the semaphore.
+ * 
+ * @returns The semaphore whose ID is @p semid, or NULL if @p semid does not
+ *          identify a semaphore in use.
+ */
+PUBLIC struct semaphore *sem_get(int semid)
+{
+	if ((semid < 0) || (semid >= SEM_MAX))
+		return (NULL);
+	
+	return ((semtab[semid].valid) ? &semtab[semid] : NULL);
+}
+
+/**
+ * @brief Gets the ID of a semaphore.
+ * 
+ * @param sem Semaphore.
+ * 
+ * @returns The ID of @p sem.
+ */
+PUBLIC int sem_id(const struct semaphore *sem)
+{
+	return (sem - semtab);
+}
+
+/**
+ * @brief Releases a semaphore.
+ * 
+ * @details Removes the semaphore pointed to by @p sem from the hash table and
+ *          returns it to the free list. Sleeping processes are awaken, and
+ *          find out that the semaphore is gone.
+ * 
+ * @param sem Semaphore to be released.
+ */
+PUBLIC void sem_free(struct semaphore *sem)
+{
+	struct semaphore **pp;
+	
+	/* Remove from hash table. */
+	for (pp = &hashtab[HASH(sem->key)]; *pp != sem; pp = &(*pp)->next)
+		/* noop */ ;
+	*pp = sem->next;
+	
+	sem->valid = 0;
+	sem->seq++;
+	
+	while (!waitq_empty(&sem->chain))
+		wakeup_one(&sem->chain);
+	wakeup(&sem->zchain);
+	
+	sem->next = free_sems;
+	free_sems = sem;
+}
+
+/**
+ * @brief Initializes the semaphore table.
+ */
+PUBLIC void sem_init(void)
+{
+	int i;
+	
+	for (i = SEM_MAX - 1; i >= 0; i--)
+	{
+		semtab[i].valid = 0;
+		semtab[i].next = free_sems;
+		free_sems = &semtab[i];
+	}
+	
+	kmemset(hashtab, 0, sizeof(hashtab));
+}
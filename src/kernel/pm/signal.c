@@ -74,6 +74,8 @@ PUBLIC const sighandler_t sigdfl[NR_SIGNALS] = {
 	(sighandler_t)&_terminate, /* SIGUSR1 */
 	(sighandler_t)&_terminate, /* SIGUSR2 */
 	(sighandler_t)&_abort,     /* SIGTRAP */
+	(sighandler_t)&_terminate, /* SIGVTALRM */
+	(sighandler_t)&_terminate, /* SIGPROF   */
 };
 
 /**
@@ -119,20 +121,13 @@ PUBLIC void sndsig(struct process *proc, int sig)
 	/* Set signal flag. */
 	proc->received |= (1 << sig);
 	
+	/* Blocked signals stay pending, and do not interrupt sleeps. */
+	if ((proc->blocked & (1 << sig)) && (sig != SIGCONT))
+		return;
+	
 	/* Wake up process. */
 	if (proc->state == PROC_WAITING)
-	{
-		if (proc == *proc->chain)
-			*proc->chain = proc->next;
-		else
-		{
-			struct process *p;
-			for (p = *proc->chain; p->next != proc; p = p->next)
-				noop() ;
-			p->next = proc->next;
-		}
-		sched(proc);
-	}
+		wake(proc, WAKE_SIGNAL);
 }
 
 /**
@@ -143,16 +138,18 @@ PUBLIC void sndsig(struct process *proc, int sig)
  */
 PUBLIC int issig(void)
 {
-	int ret;
+	int i;            /* Signal number.   */
+	int ret;          /* Return value.    */
+	unsigned pending; /* Pending signals. */
 	
 	ret = SIGNULL;
+	pending = curr_proc->received & ~curr_proc->blocked;
 	
 	/* Find a pending signal that is not being ignored. */
-	for (int i = 1; i < NR_SIGNALS; i++)
+	while (pending != 0)
 	{
-		/* Skip. */
-		if (!(curr_proc->received & (1 << i)))
-			continue;
+		i = __builtin_ctz(pending);
+		pending &= ~(1 << i);
 		
 		/*
 		 * Default action for SIGCONT has already been taken. If the current
@@ -183,9 +180,10 @@ PUBLIC int issig(void)
 				curr_proc->received &= ~(1 << i);
 			
 				/* Bury zombie child processes. */
-				for (struct process *p = FIRST_PROC; p <= LAST_PROC; p++)
+				for (struct process *p = curr_proc->children, *next; p != NULL; p = next)
 				{
-					if ((p->father == curr_proc) && (p->state==PROC_ZOMBIE))
+					next = p->sibling;
+					if (p->state == PROC_ZOMBIE)
 						bury(p);
 				}
 				
@@ -233,3 +231,39 @@ PUBLIC int issig(void)
 	
 	return (ret);
 }
+
+/**
+ * @brief Sets up the signal mask for a signal handler.
+ * 
+ * @details Called by the signal delivery code right before the handler of
+ *          @p sig runs. The signals in the mask of the action are blocked,
+ *          along with @p sig itself, unless SA_NODEFER is set. The handler
+ *          is reset if SA_RESETHAND is set.
+ * 
+ * @param sig Signal being delivered.
+ * 
+ * @returns The signal mask to be restored once the handler returns.
+ */
+PUBLIC sigset_t sigenter(int sig)
+{
+	sigset_t old;
+	
+	old = curr_proc->blocked;
+	
+	/* sigsuspend() has changed the mask on behalf of this handler. */
+	if (curr_proc->flags & (1 << PROC_SIGSUSP))
+	{
+		curr_proc->flags &= ~(1 << PROC_SIGSUSP);
+		old = curr_proc->sigsaved;
+	}
+	
+	curr_proc->blocked |= curr_proc->sigmasks[sig];
+	if (!(curr_proc->sigflags[sig] & SA_NODEFER))
+		curr_proc->blocked |= (1 << sig);
+	curr_proc->blocked &= ~SIG_UNBLOCKABLE;
+	
+	if (curr_proc->sigflags[sig] & SA_RESETHAND)
+		curr_proc->handlers[sig] = SIG_DFL;
+	
+	return (old);
+}
@@ -17,44 +17,45 @@
  * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <nanvix/clock.h>
 #include <nanvix/const.h>
 #include <nanvix/hal.h>
 #include <nanvix/klib.h>
+#include <nanvix/ktrace.h>
 #include <nanvix/pm.h>
+#include <nanvix/waitq.h>
 
 /**
- * @brief Sleeping chain for idle process.
+ * @brief Wait queue for idle process.
  */
-PRIVATE struct process **idle_chain = NULL;
+PRIVATE struct waitq *idle_waitq = NULL;
 
 /**
- * @brief Puts the current process to sleep in a chain of sleeping processes.
+ * @brief Puts the current process to sleep in a wait queue.
  * 
- * @details Puts the current process to sleep in the chain of processes pointed
- *          to by @p chain, with a  priority @p priority.
- * 
- *          If @p priority if greater than or equal to zero, then the process
- *          is set to an interruptible sleeping state. Otherwise, it is put is
- *          an uninterruptible sleeping state.
- * 
- * @param chain    Sleeping chain where the process should be put.
+ * @param wq       Wait queue where the process should be put.
  * @param priority Priority that the process shall assume after waking up.
+ * @param excl     Exclusive waiter?
+ * 
+ * @returns The reason why the process was awaken.
  */
-PUBLIC void sleep(struct process **chain, int priority)
+PRIVATE int do_sleep(struct waitq *wq, int priority, int excl)
 {	
 	/*
 	 * Idle process trying to sleep. Although that may
 	 * sound weird, it happens at system startup. So,
-	 * let's enable interrupts and do some busy waiting,
-	 * hoping that the  interrupt handler will wake us up.
+	 * let's halt until the interrupt handler wakes us
+	 * up. Interrupts are only enabled while halted, so
+	 * that the wakeup cannot slip in before we halt.
 	 */
 	if (curr_proc == IDLE)
 	{
-		idle_chain = chain;
+		idle_waitq = wq;
+		disable_interrupts();
+		while (idle_waitq == wq)
+			clock_halt();
 		enable_interrupts();
-		while (idle_chain == chain)
-			noop();
-		return;
+		return (WAKE_NORMAL);
 	}
 
 	/*
@@ -62,44 +63,237 @@ PUBLIC void sleep(struct process **chain, int priority)
 	 * has already received a signal, so there is no
 	 * need to sleep.
 	 */
-	if ((priority >= 0) && (curr_proc->received))
-		return;
+	if ((priority >= 0) && (curr_proc->received & ~curr_proc->blocked))
+		return (WAKE_SIGNAL);
 		
-	/* Insert process in the sleeping chain. */
-	curr_proc->next = *chain;
-	*chain = curr_proc;
+	/* Insert process in the wait queue. */
+	curr_proc->next = NULL;
+	if (wq->head == NULL)
+		wq->head = curr_proc;
+	else
+		wq->tail->next = curr_proc;
+	wq->tail = curr_proc;
 	
 	/* Put process to sleep. */
 	curr_proc->state = (priority >= 0) ? PROC_WAITING : PROC_SLEEPING;
 	curr_proc->priority = priority;
-	curr_proc->chain = chain;
+	curr_proc->waitq = wq;
+	curr_proc->wexcl = excl;
+	curr_proc->wreason = WAKE_NORMAL;
+	ktrace(KTRACE_SLEEP, wq, priority);
 	
 	yield();
+	
+	return (curr_proc->wreason);
 }
 
 /**
- * @brief Wakes up all processes that are sleeping in a chain.
+ * @brief Puts the current process to sleep in a wait queue.
+ * 
+ * @details Puts the current process to sleep in the wait queue pointed to by
+ *          @p wq, with a  priority @p priority, as a non-exclusive waiter.
+ * 
+ *          If @p priority if greater than or equal to zero, then the process
+ *          is set to an interruptible sleeping state. Otherwise, it is put is
+ *          an uninterruptible sleeping state.
  * 
- * @param chain Chain of sleeping processes to be awaken.
+ * @param wq       Wait queue where the process should be put.
+ * @param priority Priority that the process shall assume after waking up.
+ * 
+ * @returns The reason why the process was awaken.
  */
-PUBLIC void wakeup(struct process **chain)
-{	
+PUBLIC int sleep(struct waitq *wq, int priority)
+{
+	return (do_sleep(wq, priority, 0));
+}
+
+/**
+ * @brief Puts the current process to sleep in a wait queue, exclusively.
+ * 
+ * @details Works like sleep(), but the process is an exclusive waiter, so
+ *          that wakeup() awakes it only if no older exclusive waiter is in
+ *          the queue. This is meant for resources that can be taken by a
+ *          single process at a time, so that processes that would go back
+ *          to sleep are not awaken in vain.
+ * 
+ * @param wq       Wait queue where the process should be put.
+ * @param priority Priority that the process shall assume after waking up.
+ * 
+ * @returns The reason why the process was awaken.
+ */
+PUBLIC int sleep_excl(struct waitq *wq, int priority)
+{
+	return (do_sleep(wq, priority, 1));
+}
+
+/**
+ * @brief Wakes up a sleeping process.
+ * 
+ * @details Removes the process pointed to by @p proc from the wait queue
+ *          where it is sleeping and schedules it for execution.
+ * 
+ * @param proc   Process to be awaken.
+ * @param reason Wakeup reason.
+ */
+PUBLIC void wake(struct process *proc, int reason)
+{
+	struct process *p;
+	struct waitq *wq;
+	
+	/* Not sleeping. */
+	if ((proc->state != PROC_WAITING) && (proc->state != PROC_SLEEPING))
+		return;
+	
+	ktrace(KTRACE_WAKEUP, proc->pid, reason);
+	
+	wq = proc->waitq;
+	
+	/* Remove process from wait queue. */
+	if (proc == wq->head)
+	{
+		if ((wq->head = proc->next) == NULL)
+			wq->tail = NULL;
+	}
+	else
+	{
+		for (p = wq->head; p->next != proc; p = p->next)
+			noop() ;
+		if ((p->next = proc->next) == NULL)
+			wq->tail = p;
+	}
+	
+	proc->next = NULL;
+	proc->wreason = reason;
+	sched(proc);
+}
+
+/**
+ * @brief Wakes up a process whose timed sleep has expired.
+ * 
+ * @param arg Sleeping process.
+ */
+PRIVATE void sleep_expire(void *arg)
+{
+	wake(arg, WAKE_TIMEOUT);
+}
+
+/**
+ * @brief Puts the current process to sleep for a bounded time.
+ * 
+ * @details Works like sleep(), but the process is also awaken once
+ *          @p timeout clock ticks have elapsed.
+ * 
+ * @param wq       Wait queue where the process should be put.
+ * @param priority Priority that the process shall assume after waking up.
+ * @param timeout  Maximum time to sleep (in clock ticks).
+ * 
+ * @returns The reason why the process was awaken.
+ * 
+ * @note Interrupts must be disabled.
+ * @note The idle process sleeps without a timeout.
+ */
+PUBLIC int tsleep(struct waitq *wq, int priority, unsigned timeout)
+{
+	int reason;
+	struct timer t;
+	
+	/* Idle process halts until awaken. */
+	if (curr_proc == IDLE)
+		return (sleep(wq, priority));
+	
+	timer_init(&t, sleep_expire, curr_proc);
+	timer_add(&t, ticks + timeout);
+	
+	reason = sleep(wq, priority);
+	
+	timer_cancel(&t);
+	
+	return (reason);
+}
+
+/**
+ * @brief Wakes up processes that are sleeping in a wait queue.
+ * 
+ * @details Wakes up all non-exclusive waiters and the oldest exclusive
+ *          waiter in the wait queue pointed to by @p wq.
+ * 
+ * @param wq     Wait queue.
+ * @param reason Wakeup reason.
+ */
+PUBLIC void wakeup_reason(struct waitq *wq, int reason)
+{
+	int excl;              /* Exclusive waiter awaken? */
+	struct process *p;     /* Working process.         */
+	struct process *next;  /* Next process.            */
+	struct process **pp;   /* Link to working process. */
+	
 	/*
 	 * Wakeup idle process. Note that here we don't
 	 * schedule the idle process for execution, once
 	 * we expect that it is the only process in the
 	 * system and it is doing some busy-waiting. 
 	 */
-	if (idle_chain == chain)
+	if (idle_waitq == wq)
 	{
-		idle_chain = NULL;
+		idle_waitq = NULL;
 		return;
 	}
 	
-	/* Wakeup sleeping processes. */
-	while (*chain != NULL)
+	excl = 0;
+	wq->tail = NULL;
+	for (pp = &wq->head; (p = *pp) != NULL; p = next)
+	{
+		next = p->next;
+		
+		/* Leave exclusive waiter in the queue. */
+		if ((p->wexcl) && (excl))
+		{
+			wq->tail = p;
+			pp = &p->next;
+			continue;
+		}
+		
+		excl |= p->wexcl;
+		*pp = next;
+		p->next = NULL;
+		p->wreason = reason;
+		sched(p);
+	}
+}
+
+/**
+ * @brief Wakes up processes that are sleeping in a wait queue.
+ * 
+ * @details Wakes up all non-exclusive waiters and the oldest exclusive
+ *          waiter in the wait queue pointed to by @p wq.
+ * 
+ * @param wq Wait queue.
+ */
+PUBLIC void wakeup(struct waitq *wq)
+{
+	wakeup_reason(wq, WAKE_NORMAL);
+}
+
+/**
+ * @brief Wakes up one process that is sleeping in a wait queue.
+ * 
+ * @details Wakes up the process that has been sleeping for the longest time
+ *          in the wait queue pointed to by @p wq, be it exclusive or not.
+ * 
+ * @param wq Wait queue.
+ */
+PUBLIC void wakeup_one(struct waitq *wq)
+{
+	/* Wakeup idle process. */
+	if (idle_waitq == wq)
 	{
-		sched(*chain);
-		*chain = (*chain)->next;
+		idle_waitq = NULL;
+		return;
 	}
+	
+	/* Nobody is sleeping. */
+	if (wq->head == NULL)
+		return;
+	
+	wake(wq->head, WAKE_NORMAL);
 }
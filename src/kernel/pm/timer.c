@@ -0,0 +1,254 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/clock.h>
+#include <nanvix/const.h>
+#include <nanvix/timer.h>
+
+/**
+ * @name Timer wheel geometry
+ */
+/**@{*/
+#define ROOT_BITS   8                    /**< Bits resolved by root level. */
+#define LEVEL_BITS  6                    /**< Bits resolved by upper ones. */
+#define NR_LEVELS   3                    /**< Number of upper levels.      */
+#define ROOT_SIZE   (1 << ROOT_BITS)     /**< Slots in root level.         */
+#define LEVEL_SIZE  (1 << LEVEL_BITS)    /**< Slots in upper levels.       */
+#define ROOT_MASK   (ROOT_SIZE - 1)      /**< Root level slot mask.        */
+#define LEVEL_MASK  (LEVEL_SIZE - 1)     /**< Upper levels slot mask.      */
+/**@}*/
+
+/**
+ * @brief Longest timeout that the wheel resolves (in ticks).
+ */
+#define TIMER_MAX ((1 << (ROOT_BITS + NR_LEVELS*LEVEL_BITS)) - 1)
+
+/**
+ * @brief Gets the slot of a time at some upper level.
+ */
+#define LEVEL_INDEX(t, n) \
+	(((t) >> (ROOT_BITS + (n)*LEVEL_BITS)) & LEVEL_MASK)
+
+/**
+ * @brief Root level, one slot per tick.
+ */
+PRIVATE struct timer *root[ROOT_SIZE];
+
+/**
+ * @brief Upper levels, each slot covering a whole lower level.
+ */
+PRIVATE struct timer *levels[NR_LEVELS][LEVEL_SIZE];
+
+/**
+ * @brief Next tick to be processed by the wheel.
+ */
+PRIVATE unsigned wheel_ticks = 0;
+
+/**
+ * @brief Places a timer in the wheel.
+ * 
+ * @param t Timer to be placed.
+ */
+PRIVATE void timer_place(struct timer *t)
+{
+	unsigned expires; /* Expiration time.    */
+	unsigned delta;   /* Time to expiration. */
+	struct timer **slot;
+	
+	expires = t->expires;
+	
+	/* Already expired, run on next tick. */
+	if ((int)(expires - wheel_ticks) < 0)
+	{
+		delta = 0;
+		expires = wheel_ticks;
+	}
+	else
+		delta = expires - wheel_ticks;
+	
+	if (delta < ROOT_SIZE)
+		slot = &root[expires & ROOT_MASK];
+	else if (delta < (1 << (ROOT_BITS + LEVEL_BITS)))
+		slot = &levels[0][LEVEL_INDEX(expires, 0)];
+	else if (delta < (1 << (ROOT_BITS + 2*LEVEL_BITS)))
+		slot = &levels[1][LEVEL_INDEX(expires, 1)];
+	else
+	{
+		/* Too far away, it will be placed again later. */
+		if (delta > TIMER_MAX)
+			expires = wheel_ticks + TIMER_MAX;
+		slot = &levels[2][LEVEL_INDEX(expires, 2)];
+	}
+	
+	/* Link timer. */
+	t->next = *slot;
+	if (*slot != NULL)
+		(*slot)->pprev = &t->next;
+	*slot = t;
+	t->pprev = slot;
+}
+
+/**
+ * @brief Initializes a timer.
+ * 
+ * @param t    Timer to be initialized.
+ * @param func Function to call when the timer expires.
+ * @param arg  Argument to @p func.
+ */
+PUBLIC void timer_init(struct timer *t, void (*func)(void *), void *arg)
+{
+	t->next = NULL;
+	t->pprev = NULL;
+	t->expires = 0;
+	t->func = func;
+	t->arg = arg;
+}
+
+/**
+ * @brief Cancels a timer.
+ * 
+ * @param t Timer to be cancelled.
+ * 
+ * @note Interrupts must be disabled.
+ */
+PUBLIC void timer_cancel(struct timer *t)
+{
+	/* Not armed. */
+	if (!TIMER_PENDING(t))
+		return;
+	
+	*t->pprev = t->next;
+	if (t->next != NULL)
+		t->next->pprev = t->pprev;
+	t->next = NULL;
+	t->pprev = NULL;
+}
+
+/**
+ * @brief Arms a timer.
+ * 
+ * @details Arms the timer pointed to by @p t to expire at @p expires ticks.
+ *          If the timer is already armed, it is re-armed. On expiry, the
+ *          function of the timer is called from the clock interrupt handler.
+ * 
+ * @param t       Timer to be armed.
+ * @param expires Expiration time (in ticks since system initialization).
+ * 
+ * @note Interrupts must be disabled.
+ */
+PUBLIC void timer_add(struct timer *t, unsigned expires)
+{
+	timer_cancel(t);
+	t->expires = expires;
+	timer_place(t);
+}
+
+/**
+ * @brief Moves the timers of an upper level slot to lower levels.
+ * 
+ * @param n   Upper level.
+ * @param idx Slot.
+ * 
+ * @returns @p idx.
+ */
+PRIVATE unsigned cascade(int n, unsigned idx)
+{
+	struct timer *t;
+	struct timer *list;
+	
+	list = levels[n][idx];
+	levels[n][idx] = NULL;
+	
+	while ((t = list) != NULL)
+	{
+		list = t->next;
+		timer_place(t);
+	}
+	
+	return (idx);
+}
+
+/**
+ * @brief Gets how long the timer wheel may stay idle.
+ * 
+ * @param max Maximum number of ticks of interest.
+ * 
+ * @returns The number of ticks, up to @p max, that may elapse from now on
+ *          without any timer expiring or being cascaded.
+ * 
+ * @note Interrupts must be disabled.
+ */
+PUBLIC unsigned timer_idle(unsigned max)
+{
+	unsigned n;   /* Idle ticks. */
+	unsigned idx; /* Root slot.  */
+	
+	for (n = 0; n < max; n++)
+	{
+		idx = (wheel_ticks + n) & ROOT_MASK;
+		
+		if ((idx == 0) || (root[idx] != NULL))
+			break;
+	}
+	
+	return (n);
+}
+
+/**
+ * @brief Runs expired timers.
+ * 
+ * @details Advances the timer wheel up to the current time, calling the
+ *          functions of the timers that expire on the way. This is called
+ *          on every tick from the clock interrupt handler.
+ */
+PUBLIC void timer_run(void)
+{
+	unsigned idx;        /* Root slot.         */
+	struct timer *t;     /* Working timer.     */
+	struct timer *work;  /* Expired timers.    */
+	
+	while ((int)(ticks - wheel_ticks) >= 0)
+	{
+		idx = wheel_ticks & ROOT_MASK;
+		
+		/* Refill root level from upper levels. */
+		if ((idx == 0) &&
+			(cascade(0, LEVEL_INDEX(wheel_ticks, 0)) == 0) &&
+			(cascade(1, LEVEL_INDEX(wheel_ticks, 1)) == 0))
+			cascade(2, LEVEL_INDEX(wheel_ticks, 2));
+		
+		wheel_ticks++;
+		
+		/* Detach expired timers. */
+		work = root[idx];
+		root[idx] = NULL;
+		if (work != NULL)
+			work->pprev = &work;
+		
+		/*
+		 * Callbacks may arm or cancel any timer,
+		 * including those still in the work list.
+		 */
+		while ((t = work) != NULL)
+		{
+			timer_cancel(t);
+			t->func(t->arg);
+		}
+	}
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/fs.h>
+#include <nanvix/mm.h>
+#include <nanvix/net.h>
+#include <nanvix/pm.h>
+#include <nanvix/socket.h>
+#include <errno.h>
+#include <fcntl.h>
+
+/*
+ * Accepts a new connection on a socket.
+ */
+PUBLIC int sys_accept(int fd, struct sockaddr *addr, socklen_t *len)
+{
+	int newfd;         /* New file descriptor. */
+	struct socket *so; /* Listening socket.    */
+	struct socket *ss; /* Accepted socket.     */
+	
+	if ((so = socket_get(fd)) == NULL)
+		return (curr_proc->errno);
+	
+	/* Not listening. */
+	if (!(so->flags & SOCKET_LISTEN))
+		return (-EINVAL);
+	
+	/* Invalid address. */
+	if (addr != NULL)
+	{
+		if (!chkmem(len, sizeof(socklen_t), MAY_WRITE))
+			return (-EINVAL);
+		if (!chkmem(addr, *len, MAY_WRITE))
+			return (-EINVAL);
+	}
+	
+	/* Too many opened files. */
+	if (getfildes() < 0)
+		return (-EMFILE);
+	
+	if (so->domain == AF_INET)
+		ss = inet_accept(so, curr_proc->ofiles[fd]->oflag & O_NONBLOCK);
+	else
+		ss = socket_accept(so, curr_proc->ofiles[fd]->oflag & O_NONBLOCK);
+	
+	/* Failed to accept connection. */
+	if (ss == NULL)
+		return (curr_proc->errno);
+	
+	/* Failed to open file. */
+	if ((newfd = socket_install(ss)) < 0)
+	{
+		socket_put(ss);
+		return (newfd);
+	}
+	
+	if ((addr != NULL) && (ss->domain == AF_INET))
+		inet_name(ss, 1, addr, len);
+	else if (addr != NULL)
+		socket_name((ss->peer != NULL) ? ss->peer->path : "", addr, len);
+	
+	return (newfd);
+}
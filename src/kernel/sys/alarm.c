@@ -19,6 +19,7 @@
 
 #include <nanvix/const.h>
 #include <nanvix/clock.h>
+#include <nanvix/hal.h>
 #include <nanvix/pm.h>
 
 /*
@@ -28,15 +29,20 @@ PUBLIC unsigned sys_alarm(unsigned seconds)
 {
 	unsigned oldalarm;
 	
+	disable_interrupts();
+	
 	oldalarm = curr_proc->alarm;
+	curr_proc->itreal = 0;
 	
 	/* Schedule alarm. */
 	if (seconds > 0)
-		curr_proc->alarm = ticks + seconds*CLOCK_FREQ;
+		setalarm(curr_proc, ticks + seconds*CLOCK_FREQ);
 		
 	/* Cancel alarm. */
 	else
-		curr_proc->alarm = 0;
+		setalarm(curr_proc, 0);
+	
+	enable_interrupts();
 	
 	/* Alarm would ring soon if we had not re-scheduled it. */
 	if (oldalarm <= ticks)
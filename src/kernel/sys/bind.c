@@ -0,0 +1,47 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/fs.h>
+#include <nanvix/net.h>
+#include <nanvix/pm.h>
+#include <nanvix/socket.h>
+#include <errno.h>
+
+/*
+ * Binds a name to a socket.
+ */
+PUBLIC int sys_bind(int fd, const struct sockaddr *addr, socklen_t len)
+{
+	int ret;                  /* Return value. */
+	struct socket *so;        /* Socket.       */
+	char path[SOCK_PATH_MAX]; /* Path name.    */
+	
+	if ((so = socket_get(fd)) == NULL)
+		return (curr_proc->errno);
+	
+	if (so->domain == AF_INET)
+		return (inet_bind(so, addr, len));
+	
+	/* Bad address. */
+	if ((ret = socket_path(addr, len, path)) < 0)
+		return (ret);
+	
+	return (socket_bind(so, path));
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/config.h>
+#include <nanvix/const.h>
+#include <nanvix/fs.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include <sys/cachestat.h>
+#include <errno.h>
+
+/**
+ * @brief Gets kernel cache statistics.
+ * 
+ * @details Gets statistics about the kernel cache cache, and stores them in
+ *          the buffer pointed to by buf.
+ * 
+ *          When @p cache is CACHE_DROP, the page, inode and block buffer
+ *          caches are written back and dropped instead, and @p buf is
+ *          ignored.
+ * 
+ * @param cache Kernel cache (CACHE_BUFFER, CACHE_INODE, CACHE_PAGE,
+ *              CACHE_FILE or CACHE_BLOCK2).
+ * @param buf   Location where statistics shall be stored.
+ * 
+ * @returns Upon successful completion, zero is returned. Upon failure, a 
+ *          negative error number is returned instead.
+ */
+PUBLIC int sys_cachestat(int cache, struct cachestat *buf)
+{
+	/* Drop caches. */
+	if (cache == CACHE_DROP)
+	{
+		if (!IS_SUPERUSER(curr_proc))
+			return (-EPERM);
+		
+		pcache_drop();
+		inode_drop();
+		superblock_sync();
+		bdrop();
+		
+		return (0);
+	}
+	
+	/* Valid buffer. */
+	if (!chkmem(buf, sizeof(struct cachestat), MAY_WRITE))
+		return (-EINVAL);
+	
+	switch (cache)
+	{
+		case CACHE_BUFFER:
+			bstat(buf);
+			break;
+		
+		case CACHE_INODE:
+			inode_stat(buf);
+			break;
+		
+		case CACHE_PAGE:
+			pgstat(buf);
+			break;
+		
+		case CACHE_FILE:
+			pcache_stat(buf);
+			break;
+		
+#if (BCACHE)
+		case CACHE_BLOCK2:
+			bcache_stat(buf);
+			break;
+#endif
+		
+		default:
+			return (-EINVAL);
+	}
+	
+	return (0);
+}
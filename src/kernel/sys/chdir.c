@@ -19,6 +19,7 @@
 
 #include <nanvix/const.h>
 #include <nanvix/fs.h>
+#include <nanvix/klib.h>
 #include <nanvix/pm.h>
 #include <errno.h>
 
@@ -27,18 +28,27 @@
  */
 PUBLIC int sys_chdir(const char *path)
 {
+	char *name;
+	char *abs;
 	struct inode *inode;
 	
-	inode = inode_name(path);
+	if ((name = getname(path)) == NULL)
+		return (curr_proc->errno);
+	
+	inode = inode_name(name);
 	
 	/* Failed to get inode. */
 	if (inode == NULL)
+	{
+		putname(name);
 		return (curr_proc->errno);
+	}
 	
 	/* Not a directory. */
 	if (!S_ISDIR(inode->mode))
 	{
 		inode_put(inode);
+		putname(name);
 		return (-ENOTDIR);
 	}
 	
@@ -47,5 +57,16 @@ PUBLIC int sys_chdir(const char *path)
 	curr_proc->pwd = inode;
 	inode_unlock(inode);
 	
+	/* Track working directory path. */
+	if ((abs = abspath(name)) != NULL)
+	{
+		kstrcpy(curr_proc->cwd, abs);
+		putname(abs);
+	}
+	else
+		curr_proc->cwd[0] = '\0';
+	
+	putname(name);
+	
 	return (0);
 }
@@ -19,26 +19,71 @@
 
 #include <nanvix/const.h>
 #include <nanvix/fs.h>
+#include <nanvix/klib.h>
 #include <nanvix/pm.h>
 #include <errno.h>
 
 /*
- * Changes working directory.
+ * Rebases the working directory path on a new root directory.
+ */
+PRIVATE void chroot_cwd(const char *name)
+{
+	char *abs;
+	size_t len;
+	
+	/* Root path is unknown. */
+	if ((abs = abspath(name)) == NULL)
+	{
+		curr_proc->cwd[0] = '\0';
+		return;
+	}
+	
+	len = kstrlen(abs);
+	
+	/* Same root directory. */
+	if (len == 1)
+		/* noop */ ;
+	
+	/* Working directory is the new root. */
+	else if (!kstrcmp(curr_proc->cwd, abs))
+		kstrcpy(curr_proc->cwd, "/");
+	
+	/* Working directory is below the new root. */
+	else if ((!kstrncmp(curr_proc->cwd, abs, len)) && (curr_proc->cwd[len] == '/'))
+		kmemcpy(curr_proc->cwd, &curr_proc->cwd[len], kstrlen(&curr_proc->cwd[len]) + 1);
+	
+	/* Working directory is out of reach. */
+	else
+		curr_proc->cwd[0] = '\0';
+	
+	putname(abs);
+}
+
+/*
+ * Changes root directory.
  */
 PUBLIC int sys_chroot(const char *path)
 {
+	char *name;
 	struct inode *inode;
 	
-	inode = inode_name(path);
+	if ((name = getname(path)) == NULL)
+		return (curr_proc->errno);
+	
+	inode = inode_name(name);
 	
 	/* Failed to get inode. */
 	if (inode == NULL)
+	{
+		putname(name);
 		return (curr_proc->errno);
+	}
 	
 	/* Not a directory. */
 	if (!S_ISDIR(inode->mode))
 	{
 		inode_put(inode);
+		putname(name);
 		return (-ENOTDIR);
 	}
 	
@@ -47,5 +92,8 @@ PUBLIC int sys_chroot(const char *path)
 	curr_proc->root = inode;
 	inode_unlock(inode);
 	
+	chroot_cwd(name);
+	putname(name);
+	
 	return (0);
 }
@@ -0,0 +1,53 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include <i386/int.h>
+#include <sys/types.h>
+#include <errno.h>
+
+/*
+ * Creates a thread.
+ */
+PUBLIC pid_t sys_clone(void (*fn)(void), void *stack)
+{
+	pid_t tid;            /* Thread ID.       */
+	struct process *proc; /* Thread.          */
+	struct intstack *s;   /* Interrupt stack. */
+	
+	/* Bad entry point or stack. */
+	if ((ADDR(fn) < UBASE_VIRT) || (ADDR(fn) >= KBASE_VIRT))
+		return (-EFAULT);
+	if ((ADDR(stack) <= UBASE_VIRT) || (ADDR(stack) > KBASE_VIRT))
+		return (-EFAULT);
+	
+	if ((tid = do_fork(1)) < 0)
+		return (tid);
+	
+	proc = getproc(tid);
+	
+	/* The thread returns to user mode at its entry point. */
+	s = (struct intstack *)proc->kesp;
+	s->eip = ADDR(fn);
+	s->useresp = ADDR(stack);
+	
+	return (tid);
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/fs.h>
+#include <nanvix/net.h>
+#include <nanvix/pm.h>
+#include <nanvix/socket.h>
+#include <errno.h>
+#include <fcntl.h>
+
+/*
+ * Connects a stream socket to the socket bound to a name.
+ */
+PRIVATE int do_connect(struct socket *so, struct inode *ip, int nonblock)
+{
+	struct socket *lso; /* Listening socket. */
+	
+	/* Already connected. */
+	if (so->flags & SOCKET_CONNECTED)
+		return (-EISCONN);
+	
+	/* Listening. */
+	if (so->flags & SOCKET_LISTEN)
+		return (-EINVAL);
+	
+	/* Wait for room in the backlog. */
+	while (1)
+	{
+		/* Nobody listening. */
+		if (((lso = ip->sock) == NULL) || !(lso->flags & SOCKET_LISTEN))
+			return (-ECONNREFUSED);
+		
+		/* Wrong socket type. */
+		if (lso->type != so->type)
+			return (-EPROTOTYPE);
+		
+		if (lso->npending < lso->backlog)
+			break;
+		
+		/* Would block. */
+		if (nonblock)
+			return (-EAGAIN);
+		
+		sleep_excl(&lso->wchain, PRIO_INODE);
+		
+		/* Awaken by a signal. */
+		if (issig())
+			return (-EINTR);
+		
+		/* Connected meanwhile. */
+		if (so->flags & SOCKET_CONNECTED)
+			return (-EISCONN);
+	}
+	
+	return (socket_connect(so, lso));
+}
+
+/*
+ * Connects a socket.
+ */
+PUBLIC int sys_connect(int fd, const struct sockaddr *addr, socklen_t len)
+{
+	int ret;                  /* Return value. */
+	struct inode *ip;         /* Name inode.   */
+	struct socket *so;        /* Socket.       */
+	char path[SOCK_PATH_MAX]; /* Path name.    */
+	
+	if ((so = socket_get(fd)) == NULL)
+		return (curr_proc->errno);
+	
+	if (so->domain == AF_INET)
+	{
+		return (inet_connect(so, addr, len,
+			curr_proc->ofiles[fd]->oflag & O_NONBLOCK));
+	}
+	
+	/* Bad address. */
+	if ((ret = socket_path(addr, len, path)) < 0)
+		return (ret);
+	
+	if ((ip = socket_lookup(path)) == NULL)
+		return (curr_proc->errno);
+	
+	/* Stream socket. */
+	if (so->type == SOCK_STREAM)
+	{
+		ret = do_connect(so, ip, curr_proc->ofiles[fd]->oflag & O_NONBLOCK);
+		goto out;
+	}
+	
+	/* Nobody bound. */
+	if (ip->sock == NULL)
+	{
+		ret = -ECONNREFUSED;
+		goto out;
+	}
+	
+	/* Wrong socket type. */
+	if (ip->sock->type != so->type)
+	{
+		ret = -EPROTOTYPE;
+		goto out;
+	}
+	
+	/* Set default destination. */
+	if (so->dest != NULL)
+	{
+		inode_lock(so->dest);
+		inode_put(so->dest);
+	}
+	so->dest = ip;
+	
+	return (0);
+	
+out:
+	inode_lock(ip);
+	inode_put(ip);
+	return (ret);
+}
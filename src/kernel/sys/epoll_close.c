@@ -18,27 +18,23 @@
  */
 
 #include <nanvix/const.h>
-#include <sys/types.h>
+#include <nanvix/epoll.h>
+#include <nanvix/pm.h>
+#include <errno.h>
 
-/**
- * @brief Copy bytes in memory.
- * 
- * @param dest Target memory area.
- * @param src  Source memory area.
- * @param n    Number of bytes to be copied.
- * 
- * @returns A pointer to the target memory area.
+/*
+ * Closes an event poll instance.
  */
-PUBLIC void *kmemcpy (void* dest, const void *src, size_t n)
+PUBLIC int sys_epoll_close(int epfd)
 {
-    char *d;       /* Write pointer. */
-    const char* s; /* Read pointer.  */
-    
-    s = src;
-    d = dest;
-    
-    while (n-- > 0)
-    	*d++ = *s++;
- 
-    return (d);
+	struct eventpoll *ep;
+	
+	/* Invalid instance. */
+	if ((ep = epoll_get(epfd)) == NULL)
+		return (-EBADF);
+	
+	curr_proc->epmap &= ~(1 << epfd);
+	epoll_put(ep);
+	
+	return (0);
 }
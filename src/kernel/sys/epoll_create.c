@@ -0,0 +1,43 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/epoll.h>
+#include <nanvix/pm.h>
+#include <errno.h>
+
+/*
+ * Creates an event poll instance.
+ */
+PUBLIC int sys_epoll_create(int size)
+{
+	struct eventpoll *ep;
+	
+	/* Invalid size hint. */
+	if (size <= 0)
+		return (-EINVAL);
+	
+	/* Instance table is full. */
+	if ((ep = epoll_alloc()) == NULL)
+		return (-ENFILE);
+	
+	curr_proc->epmap |= (1 << epoll_id(ep));
+	
+	return (epoll_id(ep));
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/epoll.h>
+#include <nanvix/fs.h>
+#include <nanvix/klib.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include <sys/epoll.h>
+#include <errno.h>
+#include <limits.h>
+
+/*
+ * Changes the file descriptors watched by an event poll instance.
+ */
+PUBLIC int sys_epoll_ctl(int epfd, int op, int fd, struct epoll_event *event)
+{
+	struct file *f;         /* Watched file.  */
+	struct epitem *it;      /* Watch item.    */
+	struct eventpoll *ep;   /* Instance.      */
+	struct epoll_event ev;  /* Kernel copy.   */
+	
+	/* Invalid instance. */
+	if ((ep = epoll_get(epfd)) == NULL)
+		return (-EBADF);
+	
+	/* Invalid file descriptor. */
+	if ((fd < 0) || (fd >= OPEN_MAX) || ((f = curr_proc->ofiles[fd]) == NULL))
+		return (-EBADF);
+	
+	/* Fetch event. */
+	if (op != EPOLL_CTL_DEL)
+	{
+		if (!chkmem(event, sizeof(struct epoll_event), MAY_READ))
+			return (-EFAULT);
+		kmemcpy(&ev, event, sizeof(struct epoll_event));
+	}
+	
+	it = epoll_find(ep, fd);
+	
+	switch (op)
+	{
+		/* Start watching. */
+		case EPOLL_CTL_ADD:
+			if (it != NULL)
+				return (-EEXIST);
+			return (epoll_insert(ep, fd, f, &ev));
+		
+		/* Change watched events. */
+		case EPOLL_CTL_MOD:
+			if (it == NULL)
+				return (-ENOENT);
+			epoll_modify(it, &ev);
+			return (0);
+		
+		/* Stop watching. */
+		case EPOLL_CTL_DEL:
+			if (it == NULL)
+				return (-ENOENT);
+			epoll_remove(it);
+			return (0);
+	}
+	
+	return (-EINVAL);
+}
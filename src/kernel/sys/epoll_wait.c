@@ -0,0 +1,101 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/clock.h>
+#include <nanvix/const.h>
+#include <nanvix/epoll.h>
+#include <nanvix/hal.h>
+#include <nanvix/klib.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include <sys/epoll.h>
+#include <errno.h>
+#include <signal.h>
+
+/* Milliseconds per clock tick. */
+#define MSEC_PER_TICK (1000/CLOCK_FREQ)
+
+/*
+ * Waits for events on an event poll instance.
+ */
+PUBLIC int sys_epoll_wait(int epfd, struct epoll_event *events,
+	int maxevents, int timeout)
+{
+	int n;                                  /* Events taken.  */
+	unsigned end;                           /* Wakeup time.   */
+	struct eventpoll *ep;                   /* Instance.      */
+	struct epoll_event buf[EPOLL_MAXEVENTS]; /* Kernel buffer. */
+	
+	/* Invalid instance. */
+	if ((ep = epoll_get(epfd)) == NULL)
+		return (-EBADF);
+	
+	/* Invalid number of events. */
+	if (maxevents <= 0)
+		return (-EINVAL);
+	
+	if (maxevents > EPOLL_MAXEVENTS)
+		maxevents = EPOLL_MAXEVENTS;
+	
+	/* Invalid buffer. */
+	if (!chkmem(events, maxevents*sizeof(struct epoll_event), MAY_WRITE))
+		return (-EFAULT);
+	
+	end = ticks + 1;
+	if (timeout > 0)
+		end += ((unsigned)timeout + MSEC_PER_TICK - 1)/MSEC_PER_TICK;
+	
+	while (1)
+	{
+		n = epoll_harvest(ep, buf, maxevents);
+		
+		/* Done. */
+		if ((n > 0) || (timeout == 0))
+			break;
+		
+		disable_interrupts();
+		
+		/*
+		 * Sleep unless some file got ready
+		 * while we were harvesting events.
+		 */
+		if (ep->rhead == NULL)
+		{
+			if (timeout < 0)
+				sleep(&ep->chain, PRIO_USER);
+			else if ((int)(end - ticks) > 0)
+				tsleep(&ep->chain, PRIO_USER, end - ticks);
+			else
+			{
+				enable_interrupts();
+				break;
+			}
+		}
+		
+		enable_interrupts();
+		
+		/* Awaken by signal. */
+		if (issig() != SIGNULL)
+			return (-EINTR);
+	}
+	
+	kmemcpy(events, buf, n*sizeof(struct epoll_event));
+	
+	return (n);
+}
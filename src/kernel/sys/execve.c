@@ -23,10 +23,55 @@
 #include <nanvix/hal.h>
 #include <nanvix/klib.h>
 #include <nanvix/mm.h>
+#include <nanvix/mq.h>
 #include <nanvix/pm.h>
 #include <elf.h>
 #include <errno.h>
 
+/* Maximum number of loadable segments in a cached layout. */
+#define EXEC_SEGS_MAX 8
+
+/* Maximum length of the path name of a shared library. */
+#define INTERP_MAX 32
+
+/*
+ * Loadable segment of an executable.
+ */
+struct segment
+{
+	addr_t addr;   /* Region address.              */
+	off_t off;     /* File offset.                 */
+	size_t filesz; /* Size in the file (in bytes). */
+	size_t memsz;  /* Size in memory (in bytes).   */
+	int text;      /* Text segment?                */
+};
+
+/*
+ * Segment layout of an executable.
+ */
+struct layout
+{
+	addr_t entry;                       /* Program entry point. */
+	int nsegs;                          /* Number of segments.  */
+	struct segment segs[EXEC_SEGS_MAX]; /* Loadable segments.   */
+	char interp[INTERP_MAX];            /* Shared library.      */
+};
+
+/*
+ * Cached segment layouts.
+ */
+PRIVATE struct
+{
+	struct inode *inode;  /* Executable file (NULL if free). */
+	dev_t dev;            /* Device of that file.            */
+	ino_t num;            /* Inode number of that file.      */
+	unsigned stamp;       /* Time of last use.               */
+	struct layout layout; /* Segment layout.                 */
+} exectab[NR_EXECS];
+
+/* Clock for exec layout cache replacement. */
+PRIVATE unsigned execclock = 0;
+
 /*
  * Asserts if a file is a ELF executable.
  */
@@ -41,28 +86,95 @@ PRIVATE int is_elf(struct elf32_fhdr *header)
 }
 
 /*
- * Loads an ELF 32 executable.
+ * Drops the cached segment layout of an executable.
  */
-PRIVATE addr_t load_elf32(struct inode *inode)
+PUBLIC void dropexec(struct inode *inode)
 {
-	int i;                  /* Loop index.                    */
-	addr_t addr;            /* Region address.                */
-	addr_t entry;           /* Program entry point.           */
-	struct elf32_fhdr *elf; /* ELF file header.               */
-	struct elf32_phdr *seg; /* ELF Program header.            */
-	block_t blk;            /* Working block number.          */
-	buffer_t header;        /* File headers block buffer.     */
-	struct region *reg;     /* Working memory region.         */
-	struct pregion *preg;   /* Working process memory region. */
+	for (int i = 0; i < NR_EXECS; i++)
+	{
+		if (exectab[i].inode == inode)
+			exectab[i].inode = NULL;
+	}
+}
+
+/*
+ * Looks up the cached segment layout of an executable.
+ */
+PRIVATE int getexec(struct inode *inode, struct layout *layout)
+{
+	/*
+	 * Cached layouts are only valid while the file has cached text:
+	 * writes and truncation drop both, and a file that is read
+	 * back from disk has none.
+	 */
+	if (!(inode->flags & INODE_TEXT))
+		return (-1);
+	
+	for (int i = 0; i < NR_EXECS; i++)
+	{
+		if ((exectab[i].inode != inode) || (exectab[i].dev != inode->dev) ||
+			(exectab[i].num != inode->num))
+			continue;
+		
+		exectab[i].stamp = ++execclock;
+		kmemcpy(layout, &exectab[i].layout, sizeof(struct layout));
+		
+		return (0);
+	}
+	
+	return (-1);
+}
+
+/*
+ * Caches the segment layout of an executable.
+ */
+PRIVATE void putexec(struct inode *inode, const struct layout *layout)
+{
+	int i, j;
+	
+	/* Replace least recently used entry. */
+	for (i = 0, j = 0; i < NR_EXECS; i++)
+	{
+		if (exectab[i].inode == NULL)
+		{
+			j = i;
+			break;
+		}
+		
+		if (exectab[i].stamp < exectab[j].stamp)
+			j = i;
+	}
+	
+	exectab[j].inode = inode;
+	exectab[j].dev = inode->dev;
+	exectab[j].num = inode->num;
+	exectab[j].stamp = ++execclock;
+	kmemcpy(&exectab[j].layout, layout, sizeof(struct layout));
+	
+	inode->flags |= INODE_TEXT;
+}
+
+/*
+ * Reads the segment layout of an ELF 32 executable.
+ */
+PRIVATE int readexec(struct inode *inode, struct layout *layout)
+{
+	int i;                  /* Loop index.                 */
+	struct elf32_fhdr *elf; /* ELF file header.            */
+	struct elf32_phdr *seg; /* ELF Program header.         */
+	block_t blk;            /* Working block number.       */
+	buffer_t header;        /* File headers block buffer.  */
+	off_t ioff;             /* Shared library name offset. */
+	size_t ilen;            /* Shared library name length. */
+	
+	/* Headers may still be in delayed writes. */
+	file_flush(inode);
 	
 	blk = block_map(inode, 0, 0);
 	
 	/* Empty file. */
 	if (blk == BLOCK_NULL)
-	{
-		curr_proc->errno = -ENOEXEC;
-		return (0);
-	}
+		return (-ENOEXEC);
 	
 	/* Read ELF file header. */
 	header = bread(inode->dev, blk);
@@ -72,82 +184,248 @@ PRIVATE addr_t load_elf32(struct inode *inode)
 	if (!is_elf(elf))
 	{
 		brelse(header);
-		curr_proc->errno = -ENOEXEC;
-		return (0);
+		return (-ENOEXEC);
 	}
 	
 	/* Bad ELF file. */
 	if (elf->e_phoff + elf->e_phnum*elf->e_phentsize > BLOCK_SIZE)
 	{
 		brelse(header);
-		curr_proc->errno = -ENOEXEC;
-		return (0);
+		return (-ENOEXEC);
 	}
 	
 	seg = (struct elf32_phdr *)((char *)buffer_data(header) + elf->e_phoff);
 	
-	/* Load segments. */
+	layout->entry = elf->e_entry;
+	layout->nsegs = 0;
+	ioff = 0;
+	ilen = 0;
+	
+	/* Parse segments. */
 	for (i = 0; i < elf->e_phnum; i++)
 	{
+		/* Linked against a shared library. */
+		if (seg[i].p_type == PT_INTERP)
+		{
+			/* Name too long. */
+			if ((seg[i].p_filesz == 0) || (seg[i].p_filesz > INTERP_MAX))
+			{
+				brelse(header);
+				return (-ENOEXEC);
+			}
+			
+			ioff = seg[i].p_offset;
+			ilen = seg[i].p_filesz;
+			continue;
+		}
+		
 		/* Not loadable. */
 		if (seg[i].p_type != PT_LOAD)
 			continue;
 		
 		/* Broken executable. */
-		if (seg[i].p_filesz > seg[i].p_memsz)
+		if ((seg[i].p_filesz > seg[i].p_memsz) ||
+			(layout->nsegs == EXEC_SEGS_MAX))
 		{
 			kprintf("broken executable");
 			
 			brelse(header);
-			curr_proc->errno = -ENOEXEC;
-			return (0);
+			return (-ENOEXEC);
 		}
 		
-		addr = ALIGN(seg[i].p_vaddr, seg[i].p_align);
+		layout->segs[layout->nsegs].addr = ALIGN(seg[i].p_vaddr, seg[i].p_align);
+		layout->segs[layout->nsegs].off = seg[i].p_offset;
+		layout->segs[layout->nsegs].filesz = seg[i].p_filesz;
+		layout->segs[layout->nsegs].memsz = seg[i].p_memsz;
+		layout->segs[layout->nsegs].text = !(seg[i].p_flags ^ (PF_R | PF_X));
+		layout->nsegs++;
+	}
+	
+	brelse(header);
+	
+	/* Get name of shared library. */
+	layout->interp[0] = '\0';
+	if (ilen > 0)
+	{
+		if (file_read(inode, layout->interp, ilen, ioff, 0) != (ssize_t)ilen)
+			return (-ENOEXEC);
+		layout->interp[ilen - 1] = '\0';
+	}
+	
+	return (0);
+}
+
+/*
+ * Gets the segment layout of an ELF 32 executable.
+ */
+PRIVATE int getlayout(struct inode *inode, struct layout *layout)
+{
+	int err;
+	
+	/* Parse headers, unless they are cached. */
+	if (getexec(inode, layout))
+	{
+		if ((err = readexec(inode, layout)) < 0)
+			return (err);
+		
+		putexec(inode, layout);
+	}
+	
+	return (0);
+}
+
+/*
+ * Attaches the segments of an ELF 32 executable.
+ */
+PRIVATE int loadsegs
+(struct inode *inode, struct layout *layout, struct pregion *text, struct pregion *data)
+{
+	struct segment *seg;    /* Working segment.               */
+	struct region *reg;     /* Working memory region.         */
+	struct pregion *preg;   /* Working process memory region. */
+	
+	for (int i = 0; i < layout->nsegs; i++)
+	{
+		seg = &layout->segs[i];
 		
 		/* Text section. */
-		if (!(seg[i].p_flags ^ (PF_R | PF_X)))
+		if (seg->text)
 		{
-			preg = TEXT(curr_proc);
-			reg = allocreg(S_IRUSR | S_IXUSR, seg[i].p_memsz, 0);
+			preg = text;
+			reg = textreg(inode, seg->off, seg->filesz, seg->memsz);
 		}
 		
 		/* Data section. */
 		else
 		{
-			preg = DATA(curr_proc);
-			reg = allocreg(S_IRUSR | S_IWUSR, seg[i].p_memsz, 0);
+			preg = data;
+			reg = allocreg(S_IRUSR | S_IWUSR, seg->memsz, 0);
 		}
 		
 		/* Failed to allocate region. */
 		if (reg == NULL)
-		{
-			brelse(header);
-			curr_proc->errno = -ENOMEM;
-			return (0);
-		}
+			return (-ENOMEM);
 		
 		/* Attach memory region. */
-		if (attachreg(curr_proc, preg, addr, reg))
+		if (attachreg(curr_proc, preg, seg->addr, reg))
 		{
-			freereg(reg);
-			brelse(header);
-			curr_proc->errno = -ENOMEM;
-			return (0);
+			/* Text stays cached. */
+			if (reg->flags & REGION_STICKY)
+				unlockreg(reg);
+			else
+				freereg(reg);
+			return (-ENOMEM);
 		}
 		
-		loadreg(inode, reg, seg[i].p_offset, seg[i].p_filesz);
+		/* Text regions come loaded. */
+		if (!(reg->flags & REGION_STICKY))
+			loadreg(inode, reg, seg->off, seg->filesz);
 		
 		unlockreg(reg);	
 	}
 	
-	entry = elf->e_entry;
+	return (0);
+}
+
+/*
+ * Loads a shared library.
+ * 
+ * Shared libraries are ELF 32 executables that are linked at addresses
+ * of their own and that programs are linked against with --just-symbols,
+ * so references to them are bound at link time and nothing needs to be
+ * relocated here. Their text is shared and cached like that of any other
+ * executable, and each process gets a private copy of their data.
+ */
+PRIVATE int load_shlib(const char *path)
+{
+	int err;              /* Error code.            */
+	struct inode *inode;  /* Shared library inode.  */
+	struct layout layout; /* Shared library layout. */
+	
+	if ((inode = inode_name(path)) == NULL)
+		return (curr_proc->errno);
+	
+	/* Not a regular file. */
+	if (!S_ISREG(inode->mode))
+	{
+		inode_put(inode);
+		return (-ENOEXEC);
+	}
+	
+	if ((err = getlayout(inode, &layout)) < 0)
+	{
+		inode_put(inode);
+		return (err);
+	}
 	
-	brelse(header);
+	/* Shared libraries are not chained. */
+	if (layout.interp[0] != '\0')
+	{
+		inode_put(inode);
+		return (-ENOEXEC);
+	}
+	
+	err = loadsegs(inode, &layout, LTEXT(curr_proc), LDATA(curr_proc));
+	
+	inode_put(inode);
 	
-	return (entry);
+	return (err);
 }
 
+/*
+ * Loads an ELF 32 executable.
+ */
+PRIVATE addr_t load_elf32(struct inode *inode)
+{
+	int err;              /* Error code.     */
+	struct layout layout; /* Segment layout. */
+	
+	if ((err = getlayout(inode, &layout)) < 0)
+		goto error;
+	
+	if ((err = loadsegs(inode, &layout, TEXT(curr_proc), DATA(curr_proc))) < 0)
+		goto error;
+	
+	/* Linked against a shared library. */
+	if (layout.interp[0] != '\0')
+	{
+		if ((err = load_shlib(layout.interp)) < 0)
+			goto error;
+	}
+	
+	return (layout.entry);
+
+error:
+	curr_proc->errno = err;
+	return (0);
+}
+
+/* Error checking. */
+#if (ARG_MAX & (PAGE_SIZE - 1))
+	#error "ARG_MAX must be a multiple of PAGE_SIZE"
+#endif
+
+/* Number of pages that hold arguments. */
+#define ARG_PAGES (ARG_MAX/PAGE_SIZE)
+
+/* Lowest address of arguments in the user stack. */
+#define ARG_BASE (USTACK_ADDR - ARG_MAX)
+
+/*
+ * Arguments of a new program.
+ * 
+ * This is built as an image of the lowest ARG_MAX bytes of the new user
+ * stack: a return address slot, argc, argv, envp, the argv and envp
+ * tables, and then the strings themselves. Strings are copied once, from
+ * the old address space straight to where they go, and the image is
+ * staged in kernel pages that are only taken as it grows.
+ */
+struct args
+{
+	char *pages[ARG_PAGES]; /* Staging pages.           */
+	size_t size;            /* Bytes used in the image. */
+};
+
 /*
  * Returns the number of strings of a null terminated vector of strings.
  */
@@ -174,136 +452,184 @@ PRIVATE int count(const char **str)
 }
 
 /*
- * Copy strings of a vector of strings to somewhere.
+ * Asserts if arguments may be read from somewhere.
  */
-PRIVATE int copy_strings(int count, const char **strings, char *where, int p, const int bypass)
+PRIVATE int argok(const char *str, size_t n)
+{
+	/* Kernel address space. */
+	if ((ADDR(str) < UBASE_VIRT) || (ADDR(str) >= KBASE_VIRT))
+		return (KERNEL_RUNNING(curr_proc) || (curr_proc == INIT));
+	
+	return (chkmem(str, n - 1, MAY_READ));
+}
+
+/*
+ * Gets a pointer to some offset of the arguments image.
+ */
+PRIVATE char *argptr(struct args *args, size_t off)
+{
+	char **pg; /* Staging page. */
+	
+	pg = &args->pages[off/PAGE_SIZE];
+	
+	if ((*pg == NULL) && ((*pg = getkpg(0)) == NULL))
+	{
+		curr_proc->errno = -ENOMEM;
+		return (NULL);
+	}
+	
+	return (*pg + (off & (PAGE_SIZE - 1)));
+}
+
+/*
+ * Appends a double word to the arguments image.
+ */
+PRIVATE int argword(struct args *args, size_t off, dword_t word)
+{
+	dword_t *w; /* Write pointer. */
+	
+	if ((w = (dword_t *)argptr(args, off)) == NULL)
+		return (-1);
+	
+	*w = word;
+	
+	return (0);
+}
+
+/*
+ * Copies strings of a vector of strings to the arguments image.
+ */
+PRIVATE int copy_strings(struct args *args, int count, const char **strings, size_t table)
 {
-	int ch;          /* Working character.     */
 	const char *str; /* Working string.        */
-	int length;      /* Working string length. */
+	char *w;         /* Write pointer.         */
+	size_t n;        /* Bytes in working page. */
+	size_t m;        /* Bytes copied.          */
 	
-	/* Copy strings. */
-	while (count-- > 0)
+	for (/* noop */; count > 0; count--, strings++, table += DWORD_SIZE)
 	{
-		str = (bypass) ? *strings : (const char *)fudword(strings + count);
-		length = 1;
+		str = (const char *)fudword(strings);
+		
+		/* Fill in table entry. */
+		if (argword(args, table, ARG_BASE + args->size))
+			return (-1);
 		
-		/* Get working string length. */
-		while ((ch = ((bypass) ? *str : fubyte(str))) != '\0')
-		{			
+		/* Copy string page by page. */
+		do
+		{
+			/* Strings too long. */
+			if (args->size >= ARG_MAX)
+			{
+				curr_proc->errno = -E2BIG;
+				return (-1);
+			}
+			
+			/* Chunk up to the end of either page. */
+			n = PAGE_SIZE - (ADDR(str) & (PAGE_SIZE - 1));
+			if (n > PAGE_SIZE - (args->size & (PAGE_SIZE - 1)))
+				n = PAGE_SIZE - (args->size & (PAGE_SIZE - 1));
+			
 			/* Bad string. */
-			if (ch < 0)
+			if (!argok(str, n))
 			{
 				curr_proc->errno = -EFAULT;
 				return (-1);
 			}
 			
-			length++;
-			str++;
-		}
-		
-		
-		/* Copy working string. */
-		while (length-- > 0)
-		{
-			where[p] = (char) fubyte(str);
-		
-			p--;
-			str--;
+			if ((w = argptr(args, args->size)) == NULL)
+				return (-1);
 			
-			/* Strings too long. */
-			if (p < 0)
+			for (m = 0; m < n; m++)
 			{
-				curr_proc->errno = -E2BIG;
-				return (-1);
+				if ((w[m] = str[m]) == '\0')
+				{
+					m++;
+					break;
+				}
 			}
-		}
+			
+			str += m;
+			args->size += m;
+		} while (w[m - 1] != '\0');
 	}
 	
-	return (p);
+	/* Null terminate table. */
+	return (argword(args, table, 0));
 }
 
 /*
- * Create string tables for argv and envp.
+ * Builds arguments.
  */
-PRIVATE addr_t create_tables(char *stack, size_t size, int p, int argc, int envc)
+PRIVATE addr_t buildargs
+(struct args *args, const char **argv, const char **envp)
 {
-	int argv; /* Argument variables table.    */
-	int envp; /* Environment variables table. */
-	int sp;   /* Stack pointer.               */
+	int argc;     /* argv length.         */
+	int envc;     /* envc length.         */
+	size_t avec;  /* argv table offset.   */
+	size_t evec;  /* envp table offset.   */
 	
-	sp = p & ~(DWORD_SIZE - 1);
-	sp -= (envc + 1)*DWORD_SIZE;
-	envp = sp;
-	sp -= (argc + 1)*DWORD_SIZE;
-	argv = sp;
+	/* Get argv count. */
+	if ((argc = count(argv)) < 0)
+		return (0);
+		
+	/* Get envp count. */
+	if ((envc = count(envp)) < 0)
+		return (0);
+	
+	avec = 4*DWORD_SIZE;
+	evec = avec + (argc + 1)*DWORD_SIZE;
+	args->size = evec + (envc + 1)*DWORD_SIZE;
 	
 	/* Arguments too long. */
-	if (sp < (4*DWORD_SIZE))
+	if (args->size >= ARG_MAX)
 	{
 		curr_proc->errno = -E2BIG;
 		return (0);
 	}
 	
-	sp -= DWORD_SIZE; (*((dword_t *)(stack + sp))) = USTACK_ADDR - size + envp;
-	sp -= DWORD_SIZE; (*((dword_t *)(stack + sp))) = USTACK_ADDR - size + argv;
-	sp -= DWORD_SIZE; (*((dword_t *)(stack + sp))) = argc;
-	sp -= DWORD_SIZE;
+	/* Return address slot, argc, argv and envp. */
+	if (argword(args, 0, 0) || argword(args, DWORD_SIZE, argc) ||
+		argword(args, 2*DWORD_SIZE, ARG_BASE + avec) ||
+		argword(args, 3*DWORD_SIZE, ARG_BASE + evec))
+		return (0);
 	
-	/* 
-	 * Build argv table.
-	 * p is the first byte available in the stack
-	 * so we need to increment it before checking strings.
-	 */
-	while (argc-- > 0)
-	{
-		(*((dword_t *)(stack + argv))) = USTACK_ADDR - size + p + 1;
-		while (stack[++p] != '\0') /* nothing. */ ;
-		argv += DWORD_SIZE;
-	}
-	(*((dword_t *)(stack + argv))) = 0;
+	/* Copy argv and envp. */
+	if (copy_strings(args, argc, argv, avec))
+		return (0);
+	if (copy_strings(args, envc, envp, evec))
+		return (0);
+		
+	return (ARG_BASE);
+}
+
+/*
+ * Moves arguments to the user stack.
+ */
+PRIVATE void putargs(struct args *args)
+{
+	size_t n;
 	
-	/* Build envp table. */
-	while (envc-- > 0)
+	for (unsigned i = 0; i < ARG_PAGES; i++)
 	{
-		(*((dword_t *)(stack + envp))) = USTACK_ADDR - size + p + 1;
-		while (stack[++p] != '\0') /* nothing. */ ;
-		envp += DWORD_SIZE;
+		if (args->pages[i] == NULL)
+			continue;
+		
+		n = (args->size > (i + 1)*PAGE_SIZE) ? 
+			PAGE_SIZE : args->size - i*PAGE_SIZE;
+		kmemcpy((void *)(ARG_BASE + i*PAGE_SIZE), args->pages[i], n);
 	}
-	(*((dword_t *)(stack + envp))) = 0;
-	
-	
-	return (USTACK_ADDR - size + sp);
 }
 
-
 /*
- * Builds arguments.
+ * Releases arguments.
  */
-PRIVATE addr_t buildargs
-(void *stack, size_t size, const char **argv, const char **envp)
+PRIVATE void freeargs(struct args *args)
 {
-	int p;        /* Stack pointer. */
-	int argc;     /* argv length.   */
-	int envc;     /* envc length.   */
-	
-	/* Get argv count. */
-	if ((argc = count(argv)) < 0)
-		return (0);
-		
-	/* Get envp count. */
-	if ((envc = count(envp)) < 0)
-		return (0);
-		
-	/* Copy argv and envp to stack. */
-	if ((p = copy_strings(envc, envp, stack, size - 1, 0)) < 0)
-		return (0);
-	if ((p = copy_strings(argc, argv, stack, p, 0)) < 0)
-		return (0);
-	if ((p = create_tables(stack, size, p, argc, envc)) == 0)
-		return (0);
-		
-	return (p);
+	for (unsigned i = 0; i < ARG_PAGES; i++)
+	{
+		if (args->pages[i] != NULL)
+			putkpg(args->pages[i]);
+	}
 }
 
 /**
@@ -339,16 +665,21 @@ PUBLIC int sys_execve(const char *filename, const char **argv, const char **envp
 	addr_t entry;         /* Program entry point. */
 	addr_t sp;            /* User stack pointer.  */
 	char *pathname;       /* Path name.           */
-	char stack[ARG_MAX];  /* Stack size.          */
+	struct args args;     /* Arguments.           */
+
+	/* Other threads run in this address space. */
+	if (sharedpgdir(curr_proc))
+		return (-EBUSY);
 
 	/* Get path name. */
 	if ((pathname = getname(filename)) == NULL)
 		return (curr_proc->errno);
 
 	/* Build arguments before freeing user memory. */
-	kmemset(stack, 0, ARG_MAX);
-	if (!(sp = buildargs(stack, ARG_MAX, argv, envp)))
+	kmemset(&args, 0, sizeof(struct args));
+	if (!(sp = buildargs(&args, argv, envp)))
 	{
+		freeargs(&args);
 		putname(pathname);
 		return (curr_proc->errno);
 	}
@@ -356,6 +687,7 @@ PUBLIC int sys_execve(const char *filename, const char **argv, const char **envp
 	/* Get file's inode. */
 	if ((inode = inode_name(pathname)) == NULL)
 	{
+		freeargs(&args);
 		putname(pathname);
 		return (curr_proc->errno);
 	}
@@ -363,6 +695,7 @@ PUBLIC int sys_execve(const char *filename, const char **argv, const char **envp
 	/* Not a regular file. */
 	if (!S_ISREG(inode->mode))
 	{
+		freeargs(&args);
 		putname(pathname);
 		inode_put(inode);
 		return (-EACCES);
@@ -371,6 +704,7 @@ PUBLIC int sys_execve(const char *filename, const char **argv, const char **envp
 	/* Not allowed. */
 	if (!permission(inode->mode, inode->uid, inode->gid, curr_proc, MAY_EXEC, 0))
 	{
+		freeargs(&args);
 		putname(pathname);
 		inode_put(inode);
 		return (-EACCES);
@@ -382,11 +716,19 @@ PUBLIC int sys_execve(const char *filename, const char **argv, const char **envp
 		if (curr_proc->close & (1 << i))
 			do_close(i);
 	}
+	
+	/* Close message queues. */
+	for (i = 0; i < MQ_OPEN_MAX; i++)
+		do_mq_close(i);
 
 	/* Detach process memory regions. */
+	pgrss_peak(curr_proc);
 	for (i = 0; i < NR_PREGIONS; i++)
 		detachreg(curr_proc, &curr_proc->pregs[i]);
 	
+	/* Histogram is gone. */
+	curr_proc->profscale = 0;
+	
 	/* Reset signal handlers. */
 	curr_proc->restorer = NULL;
 	for (i = 0; i < NR_SIGNALS; i++)
@@ -396,21 +738,27 @@ PUBLIC int sys_execve(const char *filename, const char **argv, const char **envp
 			if (curr_proc->handlers[i] != SIG_IGN)
 				curr_proc->handlers[i] = SIG_DFL;
 		}
+		curr_proc->sigmasks[i] = 0;
+		curr_proc->sigflags[i] = 0;
 	}
 	
+	/* Memory locks are not inherited. */
+	curr_proc->flags &= ~(1 << PROC_MLOCK);
+	
 	/* Load executable. */
 	if (!(entry = load_elf32(inode)))
 		goto die0;
 
 	/* Attach stack region. */
-	if ((reg = allocreg(S_IRUSR | S_IWUSR, PAGE_SIZE, REGION_DOWNWARDS)) == NULL)
+	if ((reg = allocreg(S_IRUSR | S_IWUSR, ARG_MAX, REGION_DOWNWARDS)) == NULL)
 		goto die0;
 	if (attachreg(curr_proc, STACK(curr_proc), USTACK_ADDR - 1, reg))
 		goto die1;
 	unlockreg(reg);
 
-	/* Attach heap region. */
-	if ((reg = allocreg(S_IRUSR | S_IWUSR, PAGE_SIZE, REGION_UPWARDS)) == NULL)
+	/* Attach heap region, which may be backed by 4 MB pages. */
+	reg = allocreg(S_IRUSR | S_IWUSR, PAGE_SIZE, REGION_UPWARDS | REGION_HUGE);
+	if (reg == NULL)
 		goto die0;
 	if (attachreg(curr_proc, HEAP(curr_proc), UHEAP_ADDR, reg))
 		goto die1;
@@ -422,7 +770,11 @@ PUBLIC int sys_execve(const char *filename, const char **argv, const char **envp
 	inode_put(inode);
 	putname(pathname);
 
-	kmemcpy((void *)(USTACK_ADDR - ARG_MAX), stack, ARG_MAX);
+	putargs(&args);
+	freeargs(&args);
+	
+	/* Let a father suspended in vfork() go. */
+	vfrelease();
 	
 	user_mode(entry, sp);
 	
@@ -433,6 +785,7 @@ die1:
 	unlockreg(reg);
 	freereg(reg);
 die0:
+	freeargs(&args);
 	inode_put(inode);
 	putname(pathname);
 	die(((SIGSEGV & 0xff) << 16) | (1 << 9));
@@ -19,6 +19,7 @@
  
 #include <nanvix/const.h>
 #include <nanvix/fs.h>
+#include <nanvix/klib.h>
 #include <nanvix/pm.h>
 #include <nanvix/syscall.h>
 #include <errno.h>
@@ -29,24 +30,20 @@
  */
 PRIVATE int do_dup(int oldfd, int newfd)
 {
+	uint32_t map;
+	
 	/* Invalid file descriptor. */
 	if ((newfd < 0) || (newfd >= OPEN_MAX))
 		return (-EINVAL);
 	
 	/* Look for first available file descriptor. */
-	while (newfd < OPEN_MAX)
-	{
-		if (curr_proc->ofiles[newfd] == NULL)
-			goto found;
-		
-		newfd++;
-	}
-
-	return (-EMFILE);
-	
-found:
+	map = curr_proc->ofmap | ((1 << newfd) - 1);
+	newfd = bitmap_first_free(&map, sizeof(map));
+	if ((newfd == (int)BITMAP_FULL) || (newfd >= OPEN_MAX))
+		return (-EMFILE);
 
 	curr_proc->close &= ~(1 << newfd);
+	curr_proc->ofmap |= 1 << newfd;
 	(curr_proc->ofiles[newfd] = curr_proc->ofiles[oldfd])->count++;
 
 	return (newfd);
@@ -100,6 +97,18 @@ PUBLIC int sys_fcntl(int fd, int cmd, int arg)
 			f->oflag |= arg & (O_APPEND | O_NONBLOCK);
 			return (0);
 		
+		case F_GETPIPE_SZ :
+			if (!(f->inode->flags & INODE_PIPE))
+				return (-EBADF);
+			return (f->inode->size);
+		
+		case F_SETPIPE_SZ :
+			if (!(f->inode->flags & INODE_PIPE))
+				return (-EBADF);
+			if (arg < 0)
+				return (-EINVAL);
+			return (pipe_resize(f->inode, arg));
+		
 		default :
 			return (-EINVAL);
 	};
@@ -19,17 +19,20 @@
 
 #include <nanvix/config.h>
 #include <nanvix/const.h>
+#include <nanvix/epoll.h>
 #include <nanvix/hal.h>
 #include <nanvix/klib.h>
 #include <nanvix/mm.h>
+#include <nanvix/mq.h>
 #include <nanvix/pm.h>
+#include <nanvix/uring.h>
 #include <sys/types.h>
 #include <errno.h>
 
 /*
- * Creates a new process.
+ * Creates a new process or thread.
  */
-PUBLIC pid_t sys_fork(void)
+PUBLIC pid_t do_fork(int thread)
 {
 	int i;                /* Loop index.     */
 	int err;              /* Error?          */
@@ -52,8 +55,8 @@ PUBLIC pid_t sys_fork(void)
 	/* Search for a free process. */
 	for (proc = FIRST_PROC; proc <= LAST_PROC; proc++)
 	{
-		/* Found. */
-		if (!IS_VALID(proc))
+		/* Found, and not being torn down. */
+		if ((!IS_VALID(proc)) && (!(proc->flags & (1 << PROC_REAP))))
 			goto found;
 	}
 
@@ -66,7 +69,8 @@ found:
 	/* Mark process as beeing created. */
 	proc->flags = 1 << PROC_NEW;
 
-	err = crtpgdir(proc);
+	proc->npregs = 0;
+	err = (thread) ? sharepgdir(proc) : crtpgdir(proc);
 	
 	/* Failed to create process page directory. */
 	if (err)
@@ -84,6 +88,13 @@ found:
 		/* Process region not in use. */
 		if (preg->reg == NULL)
 			continue;	
+		
+		/* Threads share regions. */
+		if (thread)
+		{
+			sharereg(proc, &proc->pregs[i], preg);
+			continue;
+		}
 			
 		lockreg(preg->reg);
 		reg = dupreg(preg->reg);
@@ -109,19 +120,34 @@ found:
 		unlockreg(reg);
 	}
 	
+	/* Our pages are now copy on write. */
+	tlb_flush();
+	
 	/* Initialize process. */
 	proc->intlvl = 1;
 	proc->received = 0;
+	proc->blocked = curr_proc->blocked;
 	proc->restorer = curr_proc->restorer;
-	kmemcpy(&proc->fss, &curr_proc->fss, sizeof(struct fpu));
+	fpu_dup(proc);
 	for (i = 0; i < NR_SIGNALS; i++)
+	{
 		proc->handlers[i] = curr_proc->handlers[i];
+		proc->sigmasks[i] = curr_proc->sigmasks[i];
+		proc->sigflags[i] = curr_proc->sigflags[i];
+	}
 	proc->irqlvl = curr_proc->irqlvl;
+	proc->nsyscall = 0;
 	proc->size = curr_proc->size;
+	proc->minflt = 0;
+	proc->majflt = 0;
+	proc->wss = 0;
+	proc->wsflt = 0;
+	proc->wsusp = 0;
 	proc->pwd = curr_proc->pwd;
 	proc->pwd->count++;
 	proc->root = curr_proc->root;
 	proc->root->count++;
+	kstrcpy(proc->cwd, curr_proc->cwd);
 	for (i = 0; i < OPEN_MAX; i++)
 	{
 		proc->ofiles[i] = curr_proc->ofiles[i];
@@ -131,8 +157,32 @@ found:
 			proc->ofiles[i]->count++;
 	}
 	proc->close = curr_proc->close;
+	proc->ofmap = curr_proc->ofmap;
 	proc->umask = curr_proc->umask;
 	proc->tty = curr_proc->tty;
+	for (i = 0; i < MQ_OPEN_MAX; i++)
+	{
+		proc->mqdes[i] = curr_proc->mqdes[i];
+		
+		/* Increment message queue reference count. */
+		if (proc->mqdes[i] != NULL)
+			proc->mqdes[i]->count++;
+	}
+	proc->mqnonblock = curr_proc->mqnonblock;
+	for (i = 0; i < EPOLL_MAX; i++)
+	{
+		/* Increment event poll instance reference count. */
+		if (curr_proc->epmap & (1 << i))
+			epoll_get(i)->count++;
+	}
+	proc->epmap = curr_proc->epmap;
+	for (i = 0; i < URING_MAX; i++)
+	{
+		/* Increment I/O ring reference count. */
+		if (curr_proc->urmap & (1 << i))
+			uring_get(i)->count++;
+	}
+	proc->urmap = curr_proc->urmap;
 	proc->status = 0;
 	proc->nchildren = 0;
 	proc->uid = curr_proc->uid;
@@ -142,21 +192,48 @@ found:
 	proc->egid = curr_proc->egid;
 	proc->sgid = curr_proc->sgid;
 	proc->pid = next_pid++;
-	proc->pgrp = curr_proc->pgrp;
-	proc->father = curr_proc;
+	proc->pgrp = NULL;
+	proc->father = NULL;
+	proc->children = NULL;
+	proc->members = NULL;
+	setgrp(proc, curr_proc->pgrp);
+	adopt(curr_proc, proc);
+	pidhash_insert(proc);
 	kstrncpy(proc->name, curr_proc->name, NAME_MAX);
 	proc->utime = 0;
 	proc->ktime = 0;
 	proc->cutime = 0;
 	proc->cktime = 0;
+	proc->itreal = 0;
+	proc->itvirt = 0;
+	proc->itvirtint = 0;
+	proc->itprof = 0;
+	proc->itprofint = 0;
+	proc->profscale = 0;
+	proc->nvcsw = 0;
+	proc->nivcsw = 0;
+	proc->inblock = 0;
+	proc->oublock = 0;
+	proc->maxrss = 0;
+	proc->cminflt = 0;
+	proc->cmajflt = 0;
+	proc->cnvcsw = 0;
+	proc->cnivcsw = 0;
+	proc->cinblock = 0;
+	proc->coublock = 0;
+	proc->cnsyscall = 0;
+	proc->cmaxrss = 0;
 	proc->priority = curr_proc->priority;
 	proc->nice = curr_proc->nice;
+	proc->level = 0;
+	proc->lent = PRIO_USER;
+	proc->policy = curr_proc->policy;
+	proc->rtprio = curr_proc->rtprio;
+	proc->ioprio = curr_proc->ioprio;
 	proc->alarm = 0;
 	proc->next = NULL;
-	proc->chain = NULL;
+	proc->waitq = NULL;
 	sched(proc);
-
-	curr_proc->nchildren++;
 	
 	nprocs++;
 
@@ -180,3 +257,11 @@ error0:
 	proc->flags = 0;
 	return (-ENOMEM);
 }
+
+/*
+ * Creates a new process.
+ */
+PUBLIC pid_t sys_fork(void)
+{
+	return (do_fork(0));
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/fs.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include <nanvix/syscall.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+
+/*
+ * Gets file status relative to a directory.
+ */
+PUBLIC int sys_fstatat(int dirfd, const char *path, struct stat *buf, int flag)
+{
+	char *name;
+	struct inode *dir;
+	struct inode *ip;
+	
+	/* Invalid flags. */
+	if (flag & ~AT_SYMLINK_NOFOLLOW)
+		return (-EINVAL);
+	
+	/* Invalid buffer. */
+	if (!chkmem(buf, sizeof(struct stat), MAY_WRITE))
+		return (-EFAULT);
+	
+	if ((name = getname(path)) == NULL)
+		return (curr_proc->errno);
+	
+	/* Bad directory. */
+	if ((dir = getdirfd(dirfd, name)) == NULL)
+	{
+		putname(name);
+		return (curr_proc->errno);
+	}
+	
+	ip = inode_name_at(dir, name);
+	putname(name);
+	
+	/* Failed to get inode. */
+	if (ip == NULL)
+		return (curr_proc->errno);
+	
+	do_stat(ip, buf);
+	inode_put(ip);
+	
+	return (0);
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/fs.h>
+#include <nanvix/pm.h>
+#include <sys/stat.h>
+#include <errno.h>
+
+/*
+ * Synchronizes a file.
+ */
+PRIVATE int do_fsync(int fd, int datasync)
+{
+	int ret;         /* Return value. */
+	struct file *f;  /* File.         */
+	struct inode *i; /* Inode.        */
+	
+	/* Invalid file descriptor. */
+	if ((fd < 0) || (fd >= OPEN_MAX) || ((f = curr_proc->ofiles[fd]) == NULL))
+		return (-EBADF);
+	
+	i = f->inode;
+	
+	/* Only files and directories live in the buffer cache. */
+	if (!(S_ISREG(i->mode)) && !(S_ISDIR(i->mode)))
+		return (-EINVAL);
+	
+	inode_lock(i);
+	ret = inode_fsync(i, datasync);
+	inode_unlock(i);
+	
+	return (ret);
+}
+
+/*
+ * Synchronizes changes to a file.
+ */
+PUBLIC int sys_fsync(int fd)
+{
+	return (do_fsync(fd, 0));
+}
+
+/*
+ * Synchronizes the data of a file.
+ */
+PUBLIC int sys_fdatasync(int fd)
+{
+	return (do_fsync(fd, 1));
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/hal.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include <sys/futex.h>
+#include <errno.h>
+#include <signal.h>
+
+/* Number of futex wait queues. */
+#define FUTEX_HASHTAB_SIZE 64
+
+/* Hash function for futex keys. */
+#define FUTEX_HASH(x) (((x) >> 2)%FUTEX_HASHTAB_SIZE)
+
+/*
+ * Futex wait queues. Processes are keyed by the physical address of the
+ * futex, so that processes sharing a page find each other.
+ */
+PRIVATE struct waitq hashtab[FUTEX_HASHTAB_SIZE];
+
+/*
+ * Sleeps on a futex, if it holds a given value.
+ */
+PRIVATE int futex_wait(int *addr, int val)
+{
+	int ret;
+	addr_t key;
+	struct waitq *wq;
+	
+	/* Pin the page, so that the key stays valid. */
+	if ((key = pinupg((addr_t)addr, 1)) == 0)
+		return (-EFAULT);
+	key += (addr_t)addr & ~PAGE_MASK;
+	wq = &hashtab[FUTEX_HASH(key)];
+	
+	ret = 0;
+	
+	disable_interrupts();
+	
+	/* Value has changed meanwhile. */
+	if (*addr != val)
+		ret = -EAGAIN;
+	
+	else
+	{
+		curr_proc->futex = key;
+		sleep(wq, PRIO_USER);
+		curr_proc->futex = 0;
+		
+		if (issig() != SIGNULL)
+			ret = -EINTR;
+	}
+	
+	enable_interrupts();
+	
+	unpinupg((addr_t)addr);
+	
+	return (ret);
+}
+
+/*
+ * Wakes up processes sleeping on a futex.
+ */
+PRIVATE int futex_wake(int *addr, int n)
+{
+	int nwoken;
+	addr_t key;
+	struct process *p;
+	struct process *next;
+	
+	if ((key = pinupg((addr_t)addr, 1)) == 0)
+		return (-EFAULT);
+	key += (addr_t)addr & ~PAGE_MASK;
+	
+	nwoken = 0;
+	
+	disable_interrupts();
+	
+	for (p = hashtab[FUTEX_HASH(key)].head; (p != NULL) && (nwoken < n); p = next)
+	{
+		next = p->next;
+		
+		if (p->futex == key)
+		{
+			wake(p, WAKE_NORMAL);
+			nwoken++;
+		}
+	}
+	
+	enable_interrupts();
+	
+	unpinupg((addr_t)addr);
+	
+	return (nwoken);
+}
+
+/*
+ * Waits on or wakes up processes waiting on a futex.
+ */
+PUBLIC int sys_futex(int *addr, int op, int val)
+{
+	/* Invalid futex. */
+	if (((addr_t)addr & 3) || (!chkmem(addr, sizeof(int), MAY_WRITE)))
+		return (-EINVAL);
+	
+	switch (op)
+	{
+		case FUTEX_WAIT:
+			return (futex_wait(addr, val));
+		
+		case FUTEX_WAKE:
+			return ((val > 0) ? futex_wake(addr, val) : 0);
+	}
+	
+	return (-EINVAL);
+}
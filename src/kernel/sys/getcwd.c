@@ -0,0 +1,50 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/klib.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include <errno.h>
+
+/*
+ * Gets the pathname of the current working directory.
+ */
+PUBLIC int sys_getcwd(char *buf, size_t size)
+{
+	size_t len;
+	
+	/* Working directory path is unknown. */
+	if (curr_proc->cwd[0] == '\0')
+		return (-ENOENT);
+	
+	len = kstrlen(curr_proc->cwd) + 1;
+	
+	/* Buffer too small. */
+	if (len > size)
+		return (-ERANGE);
+	
+	/* Valid buffer. */
+	if (!chkmem(buf, len, MAY_WRITE))
+		return (-EINVAL);
+	
+	kmemcpy(buf, curr_proc->cwd, len);
+	
+	return (0);
+}
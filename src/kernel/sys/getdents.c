@@ -0,0 +1,62 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/fs.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+
+/*
+ * Reads directory entries.
+ */
+PUBLIC ssize_t sys_getdents(int fd, void *buf, size_t n)
+{
+	ssize_t count;   /* Bytes read. */
+	struct file *f;  /* File.       */
+	struct inode *i; /* Inode.      */
+	
+	/* Invalid file descriptor. */
+	if ((fd < 0) || (fd >= OPEN_MAX) || ((f = curr_proc->ofiles[fd]) == NULL))
+		return (-EBADF);
+	
+	/* File not opened for reading. */
+	if (ACCMODE(f->oflag) == O_WRONLY)
+		return (-EBADF);
+	
+	i = f->inode;
+	
+	/* Not a directory. */
+	if (!S_ISDIR(i->mode))
+		return (-ENOTDIR);
+	
+	/* Invalid buffer. */
+	if (!chkmem(buf, n, MAY_WRITE))
+		return (-EFAULT);
+	
+	inode_lock_shared(i);
+	count = dir_getdents(i, buf, n, &f->pos);
+	if (count > 0)
+		inode_access(i);
+	inode_unlock_shared(i);
+	
+	return (count);
+}
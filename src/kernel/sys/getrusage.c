@@ -0,0 +1,100 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/clock.h>
+#include <nanvix/const.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include <nanvix/syscall.h>
+#include <sys/resource.h>
+#include <errno.h>
+
+/**
+ * @brief Converts clock ticks to a time interval.
+ * 
+ * @param tv    Target time interval.
+ * @param ticks Clock ticks.
+ */
+PRIVATE void ticks2tv(struct timeval *tv, unsigned ticks)
+{
+	tv->tv_sec = ticks/CLOCK_FREQ;
+	tv->tv_usec = (ticks%CLOCK_FREQ)*(1000000/CLOCK_FREQ);
+}
+
+/**
+ * @brief Gets the resource usage of a process.
+ * 
+ * @param proc    Target process.
+ * @param who     RUSAGE_SELF for @p proc itself, RUSAGE_CHILDREN for its
+ *                terminated and waited-for children, or RUSAGE_BOTH for
+ *                both.
+ * @param r_usage Store location for resource usage.
+ */
+PUBLIC void do_rusage(struct process *proc, int who, struct rusage *r_usage)
+{
+	unsigned self;     /* Count the process itself? */
+	unsigned children; /* Count its children?       */
+	unsigned maxrss;   /* Peak resident pages.      */
+	
+	self = (who != RUSAGE_CHILDREN);
+	children = (who != RUSAGE_SELF);
+	
+	ticks2tv(&r_usage->ru_utime, self*proc->utime + children*proc->cutime);
+	ticks2tv(&r_usage->ru_stime, self*proc->ktime + children*proc->cktime);
+	r_usage->ru_minflt = self*proc->minflt + children*proc->cminflt;
+	r_usage->ru_majflt = self*proc->majflt + children*proc->cmajflt;
+	r_usage->ru_inblock = self*proc->inblock + children*proc->cinblock;
+	r_usage->ru_oublock = self*proc->oublock + children*proc->coublock;
+	r_usage->ru_nvcsw = self*proc->nvcsw + children*proc->cnvcsw;
+	r_usage->ru_nivcsw = self*proc->nivcsw + children*proc->cnivcsw;
+	r_usage->ru_nsyscall = self*proc->nsyscall + children*proc->cnsyscall;
+	
+	maxrss = self*proc->maxrss;
+	if (children*proc->cmaxrss > maxrss)
+		maxrss = proc->cmaxrss;
+	r_usage->ru_maxrss = maxrss*(PAGE_SIZE/1024);
+}
+
+/**
+ * @brief Gets resource usage.
+ * 
+ * @param who     RUSAGE_SELF or RUSAGE_CHILDREN.
+ * @param r_usage Store location for resource usage.
+ * 
+ * @returns Zero upon successful completion, and a negative error code
+ *          otherwise.
+ */
+PUBLIC int sys_getrusage(int who, struct rusage *r_usage)
+{
+	/* Invalid target. */
+	if ((who != RUSAGE_SELF) && (who != RUSAGE_CHILDREN))
+		return (-EINVAL);
+	
+	/* Not a valid buffer. */
+	if (!chkmem(r_usage, sizeof(struct rusage), MAY_WRITE))
+		return (-EFAULT);
+	
+	/* Memory is still mapped, so peak may be now. */
+	if (who == RUSAGE_SELF)
+		pgrss_peak(curr_proc);
+	
+	do_rusage(curr_proc, who, r_usage);
+	
+	return (0);
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/uring.h>
+#include <errno.h>
+
+/*
+ * Submits requests and waits for completions on an I/O ring.
+ */
+PUBLIC int sys_io_uring_enter(int id, unsigned to_submit, unsigned min_complete)
+{
+	int err;          /* Error code.        */
+	int submitted;    /* Entries submitted. */
+	struct uring *ur; /* I/O ring.          */
+	
+	/* Invalid ring. */
+	if ((ur = uring_get(id)) == NULL)
+		return (-EBADF);
+	
+	if ((submitted = uring_submit(ur, to_submit)) < 0)
+		return (submitted);
+	
+	/* Interrupted, but some entries went through. */
+	if (((err = uring_wait(ur, min_complete)) < 0) && (submitted == 0))
+		return (err);
+	
+	return (submitted);
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include <nanvix/region.h>
+#include <nanvix/uring.h>
+#include <sys/io_uring.h>
+#include <errno.h>
+
+/*
+ * Sets up an I/O ring.
+ */
+PUBLIC int sys_io_uring_setup(unsigned entries, struct io_uring_params *params)
+{
+	int i;                /* Loop index.             */
+	addr_t start;         /* Mapping address.        */
+	addr_t phys;          /* Ring page.              */
+	struct uring *ur;     /* I/O ring.               */
+	struct region *reg;   /* Memory region.          */
+	struct pregion *preg; /* Working process region. */
+	
+	/* Invalid number of entries. */
+	if ((entries == 0) || (entries > IORING_ENTRIES_MAX) || (entries & (entries - 1)))
+		return (-EINVAL);
+	
+	/* Invalid parameters. */
+	if (!chkmem(params, sizeof(struct io_uring_params), MAY_WRITE))
+		return (-EFAULT);
+	
+	/* Get a free mapping slot. */
+	for (i = 0; i < NR_MMAPS; i++)
+	{
+		if (MMAP(curr_proc, i)->reg == NULL)
+			goto found;
+	}
+	
+	return (-EMFILE);
+
+found:
+	
+	preg = MMAP(curr_proc, i);
+	start = UMMAP_ADDR + i*REGION_SIZE;
+	
+	/* Ring table is full. */
+	if ((ur = uring_alloc()) == NULL)
+		return (-ENFILE);
+	
+	/* Rings are shared, so that fork() does not copy them on write. */
+	if ((reg = allocreg(MAY_READ | MAY_WRITE, PAGE_SIZE, REGION_SHARED)) == NULL)
+		goto error0;
+	
+	/* Failed to attach region. */
+	if (attachreg(curr_proc, preg, start, reg))
+	{
+		unlockreg(reg);
+		if (reg->count == 0)
+			freereg(reg);
+		goto error0;
+	}
+	
+	unlockreg(reg);
+	
+	/* Failed to get ring page. */
+	if ((phys = getupg(start, 1)) == 0)
+	{
+		detachreg(curr_proc, preg);
+		goto error0;
+	}
+	
+	uring_init(ur, phys, entries);
+	curr_proc->urmap |= (1 << uring_id(ur));
+	
+	params->sq_entries = entries;
+	params->cq_entries = 2*entries;
+	params->ring = (struct io_uring_ring *)start;
+	
+	return (uring_id(ur));
+
+error0:
+	uring_put(ur);
+	return (-ENOMEM);
+}
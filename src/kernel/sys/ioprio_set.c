@@ -0,0 +1,71 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/pm.h>
+#include <sys/ioprio.h>
+#include <errno.h>
+
+/**
+ * @brief Sets the I/O scheduling class of a process.
+ * 
+ * @details Sets the I/O scheduling class of the process whose ID is @p pid,
+ *          or of the calling process if @p pid is zero, to @p ioclass. If
+ *          @p ioclass is negative, the class is left unchanged. Only the
+ *          superuser may pick the real-time class.
+ * 
+ * @param pid     ID of the target process.
+ * @param ioclass I/O scheduling class (IOPRIO_CLASS_RT, IOPRIO_CLASS_BE or
+ *                IOPRIO_CLASS_IDLE).
+ * 
+ * @returns Upon successful completion, the former I/O scheduling class of
+ *          the target process is returned. Upon failure, a negative error
+ *          number is returned instead.
+ */
+PUBLIC int sys_ioprio_set(pid_t pid, int ioclass)
+{
+	int old;           /* Former class.   */
+	struct process *p; /* Target process. */
+	
+	/* Invalid class. */
+	if (ioclass >= IOPRIO_CLASSES)
+		return (-EINVAL);
+	
+	/* Get target process. */
+	if (pid < 0)
+		return (-EINVAL);
+	if ((p = (pid == 0) ? curr_proc : getproc(pid)) == NULL)
+		return (-ESRCH);
+	
+	old = p->ioprio;
+	
+	/* Query only. */
+	if (ioclass < 0)
+		return (old);
+	
+	/* Not authorized. */
+	if ((p == IDLE) || (!IS_SUPERUSER(curr_proc) && (p->uid != curr_proc->euid)))
+		return (-EPERM);
+	if ((ioclass == IOPRIO_CLASS_RT) && (!IS_SUPERUSER(curr_proc)))
+		return (-EPERM);
+	
+	p->ioprio = ioclass;
+	
+	return (old);
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/clock.h>
+#include <nanvix/const.h>
+#include <nanvix/hal.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include <nanvix/syscall.h>
+#include <sys/time.h>
+#include <errno.h>
+
+/*
+ * Microseconds per clock tick.
+ */
+#define USEC_PER_TICK (1000000/CLOCK_FREQ)
+
+/*
+ * Converts clock ticks to a time interval.
+ */
+PRIVATE void ticks2tv(struct timeval *tv, unsigned ticks)
+{
+	tv->tv_sec = ticks/CLOCK_FREQ;
+	tv->tv_usec = (ticks%CLOCK_FREQ)*USEC_PER_TICK;
+}
+
+/*
+ * Converts a time interval to clock ticks, rounding up.
+ */
+PRIVATE unsigned tv2ticks(const struct timeval *tv)
+{
+	return (tv->tv_sec*CLOCK_FREQ +
+		(tv->tv_usec + USEC_PER_TICK - 1)/USEC_PER_TICK);
+}
+
+/*
+ * Asserts if a time interval is valid.
+ */
+PRIVATE int validtv(const struct timeval *tv)
+{
+	return ((tv->tv_sec >= 0) && (tv->tv_usec >= 0) && (tv->tv_usec < 1000000));
+}
+
+/*
+ * Gets the value of an interval timer of the current process.
+ */
+PRIVATE void do_getitimer(int which, struct itimerval *value)
+{
+	switch (which)
+	{
+		case ITIMER_REAL:
+			ticks2tv(&value->it_interval, curr_proc->itreal);
+			ticks2tv(&value->it_value,
+				(curr_proc->alarm > ticks) ? curr_proc->alarm - ticks : 0);
+			break;
+		
+		case ITIMER_VIRTUAL:
+			ticks2tv(&value->it_interval, curr_proc->itvirtint);
+			ticks2tv(&value->it_value, curr_proc->itvirt);
+			break;
+		
+		default:
+			ticks2tv(&value->it_interval, curr_proc->itprofint);
+			ticks2tv(&value->it_value, curr_proc->itprof);
+			break;
+	}
+}
+
+/*
+ * Gets the value of an interval timer.
+ */
+PUBLIC int sys_getitimer(int which, struct itimerval *value)
+{
+	/* Invalid timer. */
+	if ((which < ITIMER_REAL) || (which > ITIMER_PROF))
+		return (-EINVAL);
+	
+	/* Invalid buffer. */
+	if (!chkmem(value, sizeof(struct itimerval), MAY_WRITE))
+		return (-EFAULT);
+	
+	disable_interrupts();
+	do_getitimer(which, value);
+	enable_interrupts();
+	
+	return (0);
+}
+
+/*
+ * Sets the value of an interval timer.
+ */
+PUBLIC int sys_setitimer(int which, const struct itimerval *value,
+	struct itimerval *ovalue)
+{
+	unsigned val;      /* Value (in ticks).    */
+	unsigned interval; /* Interval (in ticks). */
+	
+	/* Invalid timer. */
+	if ((which < ITIMER_REAL) || (which > ITIMER_PROF))
+		return (-EINVAL);
+	
+	/* Invalid buffers. */
+	if (!chkmem(value, sizeof(struct itimerval), MAY_READ))
+		return (-EFAULT);
+	if (ovalue != NULL)
+	{
+		if (!chkmem(ovalue, sizeof(struct itimerval), MAY_WRITE))
+			return (-EFAULT);
+	}
+	
+	/* Invalid time intervals. */
+	if ((!validtv(&value->it_value)) || (!validtv(&value->it_interval)))
+		return (-EINVAL);
+	
+	val = tv2ticks(&value->it_value);
+	interval = tv2ticks(&value->it_interval);
+	
+	disable_interrupts();
+	
+	if (ovalue != NULL)
+		do_getitimer(which, ovalue);
+	
+	switch (which)
+	{
+		case ITIMER_REAL:
+			curr_proc->itreal = interval;
+			setalarm(curr_proc, (val > 0) ? ticks + val : 0);
+			break;
+		
+		case ITIMER_VIRTUAL:
+			curr_proc->itvirtint = interval;
+			curr_proc->itvirt = val;
+			break;
+		
+		default:
+			curr_proc->itprofint = interval;
+			curr_proc->itprof = val;
+			break;
+	}
+	
+	enable_interrupts();
+	
+	return (0);
+}
@@ -33,6 +33,34 @@
 	 (p1->uid == p2->uid)  || (p1->euid == p2->uid) || \
 	 (p1->uid == p2->suid) || (p1->euid == p2->suid))) \
 
+/*
+ * Sends a signal to the members of a process group.
+ */
+PRIVATE int killgrp(struct process *leader, int sig)
+{
+	int err;
+	struct process *p;
+	
+	err = -ESRCH;
+	
+	/* No such process group. */
+	if (leader == NULL)
+		return (err);
+	
+	for (p = leader->members; p != NULL; p = p->gnext)
+	{
+		err = (err == 0) ? 0 : -EPERM;
+		
+		if (AUTHORIZED(curr_proc, p, sig))
+		{
+			err = 0;
+			sndsig(p, sig);
+		}
+	}
+	
+	return (err);
+}
+
 /*
  * Sends a signal to a process or a process group.
  */
@@ -50,50 +78,22 @@ PUBLIC int sys_kill(pid_t pid, int sig)
 	/* Send signal to process. */
 	if (pid > 0)
 	{
-		/* Search for process. */
-		for (p = FIRST_PROC; p <= LAST_PROC; p++)
-		{			
-			/* Skip invalid processes. */
-			if (!IS_VALID(p))
-				continue;
-		
-			/* Found. */
-			if (pid == p->pid)
+		/* Found. */
+		if ((p = getproc(pid)) != NULL)
+		{
+			err = -EPERM;
+			
+			if (AUTHORIZED(curr_proc, p, sig))
 			{
-				err = -EPERM;
-				
-				if (AUTHORIZED(curr_proc, p, sig))
-				{
-					err = 0;
-					sndsig(p, sig);
-				}
+				err = 0;
+				sndsig(p, sig);
 			}
 		}
 	}
 	
 	/* Send signal to process group. */
 	else if (pid == 0)
-	{
-		/* Search for processes. */
-		for (p = FIRST_PROC; p <= LAST_PROC; p++)
-		{			
-			/* Skip invalid processes. */
-			if (!IS_VALID(p))
-				continue;
-			
-			/* Found. */
-			if (curr_proc->pgrp == p->pgrp)
-			{
-				err = -EPERM;
-			
-				if (AUTHORIZED(curr_proc, p, sig))
-				{
-					err = 0;
-					sndsig(p, sig);
-				}
-			}
-		}
-	}
+		err = killgrp(curr_proc->pgrp, sig);
 	
 	/* Send signal to all processes. */
 	else if (pid == -1)
@@ -118,25 +118,13 @@ PUBLIC int sys_kill(pid_t pid, int sig)
 	/* Send signal to absolute proces group. */
 	else
 	{
-		/* Search for processes. */
-		for (p = FIRST_PROC; p <= LAST_PROC; p++)
-		{
-			/* Skip invalid processes. */
-			if (!IS_VALID(p))
-				continue;
-			
-			/* Found. */
-			if (p->pgrp->pid == -pid)
-			{
-				err = -EPERM;
-			
-				if (AUTHORIZED(curr_proc, p, sig))
-				{
-					err = 0;
-					sndsig(p, sig);
-				}
-			}
-		}
+		p = getproc(-pid);
+		
+		/* Not a process group leader. */
+		if ((p != NULL) && (p->pgrp != p))
+			p = NULL;
+		
+		err = killgrp(p, sig);
 	}
 	
 	return (err);
@@ -0,0 +1,64 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/fs.h>
+#include <nanvix/net.h>
+#include <nanvix/pm.h>
+#include <nanvix/socket.h>
+#include <errno.h>
+
+/*
+ * Listens for socket connections.
+ */
+PUBLIC int sys_listen(int fd, int backlog)
+{
+	struct socket *so; /* Socket. */
+	
+	if ((so = socket_get(fd)) == NULL)
+		return (curr_proc->errno);
+	
+	/* Not a stream socket. */
+	if (so->type != SOCK_STREAM)
+		return (-EOPNOTSUPP);
+	
+	/* Already connected. */
+	if (so->flags & SOCKET_CONNECTED)
+		return (-EINVAL);
+	
+	if (backlog < 1)
+		backlog = 1;
+	else if (backlog > SOMAXCONN)
+		backlog = SOMAXCONN;
+	
+	if (so->domain == AF_INET)
+		return (inet_listen(so, backlog));
+	
+	/* Not bound. */
+	if (so->name == NULL)
+		return (-EDESTADDRREQ);
+	
+	so->backlog = backlog;
+	so->flags |= SOCKET_LISTEN;
+	
+	/* Connectors may queue now. */
+	wakeup(&so->wchain);
+	
+	return (0);
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/fs.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include <nanvix/region.h>
+#include <sys/lockstat.h>
+#include <errno.h>
+
+/**
+ * @brief Gets kernel lock statistics.
+ * 
+ * @details Gets statistics about the kernel locks of class @p class, and
+ *          stores them in the buffer pointed to by @p buf.
+ * 
+ * @param class Lock class (LOCK_BUFFER, LOCK_INODE, LOCK_SUPERBLOCK or
+ *              LOCK_REGION).
+ * @param buf   Location where statistics shall be stored.
+ * 
+ * @returns Upon successful completion, zero is returned. Upon failure, a 
+ *          negative error number is returned instead.
+ */
+PUBLIC int sys_lockstat(int class, struct lockstat *buf)
+{
+	/* Valid buffer. */
+	if (!chkmem(buf, sizeof(struct lockstat), MAY_WRITE))
+		return (-EINVAL);
+	
+	switch (class)
+	{
+		case LOCK_BUFFER:
+			blockstat(buf);
+			break;
+		
+		case LOCK_INODE:
+			inode_lockstat(buf);
+			break;
+		
+		case LOCK_SUPERBLOCK:
+			superblock_lockstat(buf);
+			break;
+		
+		case LOCK_REGION:
+			reglockstat(buf);
+			break;
+		
+		default:
+			return (-EINVAL);
+	}
+	
+	return (0);
+}
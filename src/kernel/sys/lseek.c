@@ -37,8 +37,8 @@ PUBLIC off_t sys_lseek(int fd, off_t offset, int whence)
 	if ((fd < 0) || (fd >= OPEN_MAX) || ((f = curr_proc->ofiles[fd]) == NULL))
 		return (-EBADF);
 	
-	/* Pipe file. */
-	if (S_ISFIFO(f->inode->mode))
+	/* Pipe file or socket. */
+	if ((S_ISFIFO(f->inode->mode)) || (S_ISSOCK(f->inode->mode)))
 		return (-ESPIPE);
 	
 	/* Move read/write file offset. */
@@ -65,6 +65,22 @@ PUBLIC off_t sys_lseek(int fd, off_t offset, int whence)
 			f->pos = offset;
 			break;
 		
+		case SEEK_DATA :
+		case SEEK_HOLE :
+			/* Invalid offset. */
+			if ((offset < 0) || (offset >= f->inode->size))
+				return (-ENXIO);
+			
+			/* Files other than regular ones have no holes. */
+			if (!S_ISREG(f->inode->mode))
+				tmp = (whence == SEEK_DATA) ? offset : f->inode->size;
+			
+			else if ((tmp = file_seek(f->inode, offset, whence == SEEK_HOLE)) < 0)
+				return (tmp);
+			
+			f->pos = tmp;
+			break;
+		
 		default :
 			return (-EINVAL);
 	}
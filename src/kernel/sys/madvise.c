@@ -0,0 +1,62 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include <nanvix/region.h>
+#include <sys/mman.h>
+#include <errno.h>
+
+/*
+ * Gives advice about the use of memory.
+ */
+PUBLIC int sys_madvise(void *addr, size_t len, int advice)
+{
+	struct pregion *preg; /* Working process region. */
+	
+	/* Unaligned address. */
+	if ((addr_t)addr & ~PAGE_MASK)
+		return (-EINVAL);
+	
+	/* Nothing to be done. */
+	if (len == 0)
+		return (0);
+	
+	/* Range not mapped. */
+	if ((preg = findreg(curr_proc, (addr_t)addr)) == NULL)
+		return (-ENOMEM);
+	
+	switch (advice)
+	{
+		/* Pages are faulted in on demand anyway. */
+		case MADV_NORMAL:
+		case MADV_WILLNEED:
+			break;
+		
+		/* Release pages. */
+		case MADV_DONTNEED:
+			return (discardreg(curr_proc, preg, (addr_t)addr, len));
+		
+		default:
+			return (-EINVAL);
+	}
+	
+	return (0);
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/fs.h>
+#include <nanvix/pm.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <limits.h>
+
+/*
+ * Creates a directory relative to a directory.
+ */
+PUBLIC int sys_mkdirat(int dirfd, const char *path, mode_t mode)
+{
+	int ret;              /* Return value.        */
+	char *pathname;       /* Path name.           */
+	const char *filename; /* Directory name.      */
+	struct inode *start;  /* Lookup directory.    */
+	struct inode *dir;    /* Parent directory.    */
+	struct inode *ip;     /* Directory's inode.   */
+	
+	if ((pathname = getname(path)) == NULL)
+		return (curr_proc->errno);
+	
+	/* Bad directory. */
+	if ((start = getdirfd(dirfd, pathname)) == NULL)
+	{
+		ret = curr_proc->errno;
+		goto error0;
+	}
+	
+	/* Failed to get parent directory. */
+	if ((dir = inode_dname_at(start, pathname, &filename)) == NULL)
+	{
+		ret = curr_proc->errno;
+		goto error0;
+	}
+	
+	/* Not allowed to write in parent directory. */
+	if (!permission(dir->mode, dir->uid, dir->gid, curr_proc, MAY_WRITE, 0))
+	{
+		ret = -EACCES;
+		goto error1;
+	}
+	
+	/* File exists. */
+	if ((*filename == '\0') || (*filename == '/') ||
+		(dir_search(dir, filename) != INODE_NULL))
+	{
+		ret = -EEXIST;
+		goto error1;
+	}
+	
+	/* Too many links to parent directory. */
+	if (dir->nlinks >= LINK_MAX)
+	{
+		ret = -EMLINK;
+		goto error1;
+	}
+	
+	/* Failed to allocate inode. */
+	if ((ip = inode_alloc(dir, S_IFDIR)) == NULL)
+	{
+		ret = -ENOSPC;
+		goto error1;
+	}
+	
+	ip->mode = (mode & MAY_ALL & ~curr_proc->umask) | S_IFDIR;
+	
+	/* Failed to add directory entries. */
+	if ((dir_add(ip, ip, ".")) || (dir_add(ip, dir, "..")) ||
+		(dir_add(dir, ip, filename)))
+	{
+		ip->nlinks = 0;
+		inode_put(ip);
+		ret = -ENOSPC;
+		goto error1;
+	}
+	
+	/* Count links from "." and "..". */
+	ip->nlinks++;
+	inode_touch(ip);
+	dir->nlinks++;
+	inode_touch(dir);
+	
+	inode_put(ip);
+	inode_put(dir);
+	putname(pathname);
+	
+	return (0);
+
+error1:
+	inode_put(dir);
+error0:
+	putname(pathname);
+	return (ret);
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include <nanvix/region.h>
+#include <sys/mman.h>
+#include <errno.h>
+
+/*
+ * Locks or unlocks memory regions that overlap a range.
+ */
+PRIVATE int do_mlock(addr_t addr, size_t len, int lock)
+{
+	int ret;              /* Return value.            */
+	int found;            /* Any region in range?     */
+	addr_t base;          /* Lowest address.          */
+	struct pregion *preg; /* Working process region.  */
+	
+	/* Unaligned address. */
+	if (addr & ~PAGE_MASK)
+		return (-EINVAL);
+	
+	/* Nothing to be done. */
+	if (len == 0)
+		return (0);
+	
+	found = 0;
+	for (unsigned i = 0; i < curr_proc->npregs; i++)
+	{
+		preg = curr_proc->pmap[i];
+		
+		base = (preg->reg->flags & REGION_DOWNWARDS) ?
+			preg->start + 1 - preg->reg->size : preg->start;
+		
+		/* Does not overlap range. */
+		if ((base >= addr + len) || (base + preg->reg->size <= addr))
+			continue;
+		
+		found = 1;
+		
+		if (!lock)
+			munlockreg(preg);
+		else if ((ret = mlockreg(curr_proc, preg)) < 0)
+			return (ret);
+	}
+	
+	return ((found) ? 0 : -ENOMEM);
+}
+
+/*
+ * Locks a range of the address space in memory.
+ */
+PUBLIC int sys_mlock(const void *addr, size_t len)
+{
+	return (do_mlock((addr_t)addr, len, 1));
+}
+
+/*
+ * Unlocks a range of the address space.
+ */
+PUBLIC int sys_munlock(const void *addr, size_t len)
+{
+	return (do_mlock((addr_t)addr, len, 0));
+}
+
+/*
+ * Locks the address space in memory.
+ */
+PUBLIC int sys_mlockall(int flags)
+{
+	int ret; /* Return value. */
+	
+	/* Invalid flags. */
+	if ((flags == 0) || (flags & ~(MCL_CURRENT | MCL_FUTURE)))
+		return (-EINVAL);
+	
+	/* Lock current mappings. */
+	if (flags & MCL_CURRENT)
+	{
+		for (unsigned i = 0; i < curr_proc->npregs; i++)
+		{
+			if ((ret = mlockreg(curr_proc, curr_proc->pmap[i])) < 0)
+				return (ret);
+		}
+	}
+	
+	/* Lock future mappings. */
+	if (flags & MCL_FUTURE)
+		curr_proc->flags |= 1 << PROC_MLOCK;
+	
+	return (0);
+}
+
+/*
+ * Unlocks the address space.
+ */
+PUBLIC int sys_munlockall(void)
+{
+	for (unsigned i = 0; i < curr_proc->npregs; i++)
+		munlockreg(curr_proc->pmap[i]);
+	
+	curr_proc->flags &= ~(1 << PROC_MLOCK);
+	
+	return (0);
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/fs.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include <nanvix/region.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <errno.h>
+
+/*
+ * Maps a file into memory.
+ */
+PUBLIC void *sys_mmap(size_t len, int prot, int flags, int fd, off_t off)
+{
+	int i;                /* Loop index.             */
+	mode_t mode;          /* Access permissions.     */
+	addr_t start;         /* Mapping address.        */
+	struct file *f;       /* Mapped file.            */
+	struct region *reg;   /* Memory region.          */
+	struct pregion *preg; /* Working process region. */
+	
+	/* Invalid file descriptor. */
+	if ((fd < 0) || (fd >= OPEN_MAX) || ((f = curr_proc->ofiles[fd]) == NULL))
+		return ((void *)-EBADF);
+	
+	/* Only regular files may be mapped. */
+	if (!S_ISREG(f->inode->mode))
+		return ((void *)-ENODEV);
+	
+	/* Invalid length or offset. */
+	if ((len == 0) || (len > REGION_SIZE) || (off < 0) || (off & ~PAGE_MASK))
+		return ((void *)-EINVAL);
+	
+	/* Invalid flags. */
+	if ((flags != MAP_SHARED) && (flags != MAP_PRIVATE))
+		return ((void *)-EINVAL);
+	
+	/* File not opened for reading. */
+	if (ACCMODE(f->oflag) == O_WRONLY)
+		return ((void *)-EACCES);
+	
+	/* Shared writable mapping of a file not opened for writing. */
+	if ((flags == MAP_SHARED) && (prot & PROT_WRITE))
+	{
+		if (ACCMODE(f->oflag) != O_RDWR)
+			return ((void *)-EACCES);
+	}
+	
+	/* Get a free mapping slot. */
+	for (i = 0; i < NR_MMAPS; i++)
+	{
+		if (MMAP(curr_proc, i)->reg == NULL)
+			goto found;
+	}
+	
+	return ((void *)-ENOMEM);
+
+found:
+	
+	preg = MMAP(curr_proc, i);
+	start = UMMAP_ADDR + i*REGION_SIZE;
+	
+	mode = MAY_READ;
+	if (prot & PROT_WRITE)
+		mode |= MAY_WRITE;
+	if (prot & PROT_EXEC)
+		mode |= MAY_EXEC;
+	
+	reg = mmapreg(f->inode, off, len, mode,
+		(flags == MAP_SHARED) ? REGION_SHARED : 0);
+	
+	/* Failed to get memory region. */
+	if (reg == NULL)
+		return ((void *)-ENOMEM);
+	
+	/* Failed to attach region. */
+	if (attachreg(curr_proc, preg, start, reg))
+	{
+		unlockreg(reg);
+		if (reg->count == 0)
+			freereg(reg);
+		return ((void *)-ENOMEM);
+	}
+	
+	unlockreg(reg);
+	
+	/* Lock future mappings. */
+	if (curr_proc->flags & (1 << PROC_MLOCK))
+	{
+		if (mlockreg(curr_proc, preg))
+		{
+			detachreg(curr_proc, preg);
+			return ((void *)-EAGAIN);
+		}
+	}
+	
+	return ((void *)start);
+}
+
+/*
+ * Unmaps a file from memory.
+ */
+PUBLIC int sys_munmap(void *addr, size_t len)
+{
+	struct pregion *preg; /* Working process region. */
+	
+	/* Nothing to unmap. */
+	if (len == 0)
+		return (-EINVAL);
+	
+	for (int i = 0; i < NR_MMAPS; i++)
+	{
+		preg = MMAP(curr_proc, i);
+		
+		/* Found. */
+		if ((preg->reg != NULL) && (preg->start == (addr_t)addr))
+		{
+			detachreg(curr_proc, preg);
+			return (0);
+		}
+	}
+	
+	return (-EINVAL);
+}
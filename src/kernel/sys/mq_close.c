@@ -0,0 +1,38 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/mq.h>
+#include <nanvix/pm.h>
+#include <errno.h>
+#include <mqueue.h>
+
+/*
+ * Closes a message queue.
+ */
+PUBLIC int sys_mq_close(mqd_t mqd)
+{
+	/* Invalid descriptor. */
+	if ((mqd < 0) || (mqd >= MQ_OPEN_MAX) || (curr_proc->mqdes[mqd] == NULL))
+		return (-EBADF);
+	
+	do_mq_close(mqd);
+	
+	return (0);
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/fs.h>
+#include <nanvix/klib.h>
+#include <nanvix/mm.h>
+#include <nanvix/mq.h>
+#include <nanvix/pm.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <mqueue.h>
+
+/*
+ * Opens a message queue.
+ */
+PUBLIC mqd_t sys_mq_open(const char *name, int oflag, const struct mq_attr *attr)
+{
+	mqd_t mqd;         /* Message queue descriptor. */
+	mqd_t ret;         /* Return value.             */
+	char *kname;       /* Message queue name.       */
+	long maxmsg;       /* Maximum messages.         */
+	long msgsize;      /* Maximum message size.     */
+	struct mqueue *mq; /* Message queue.            */
+	
+	/* Get a free descriptor. */
+	for (mqd = 0; mqd < MQ_OPEN_MAX; mqd++)
+	{
+		if (curr_proc->mqdes[mqd] == NULL)
+			goto found;
+	}
+	
+	return (-EMFILE);
+
+found:
+	
+	/* Fetch name from user address space. */
+	if ((kname = getname(name)) == NULL)
+		return (curr_proc->errno);
+	
+	/* Name too long. */
+	if (kstrlen(kname) > MQ_NAME_MAX)
+	{
+		ret = -ENAMETOOLONG;
+		goto out;
+	}
+	
+	/* Existing queue. */
+	if ((mq = mq_lookup(kname)) != NULL)
+	{
+		if ((oflag & (O_CREAT | O_EXCL)) == (O_CREAT | O_EXCL))
+		{
+			ret = -EEXIST;
+			goto out;
+		}
+	}
+	
+	/* Create queue. */
+	else
+	{
+		if (!(oflag & O_CREAT))
+		{
+			ret = -ENOENT;
+			goto out;
+		}
+		
+		maxmsg = MQ_DEF_MAXMSG;
+		msgsize = MQ_DEF_MSGSIZE;
+		
+		if (attr != NULL)
+		{
+			if (!chkmem(attr, sizeof(struct mq_attr), MAY_READ))
+			{
+				ret = -EFAULT;
+				goto out;
+			}
+			
+			maxmsg = attr->mq_maxmsg;
+			msgsize = attr->mq_msgsize;
+			
+			/* Invalid attributes. */
+			if ((maxmsg <= 0) || (maxmsg > MQ_MAXMSG) ||
+				(msgsize <= 0) || (msgsize > MQ_MSGSIZE_MAX))
+			{
+				ret = -EINVAL;
+				goto out;
+			}
+		}
+		
+		if ((mq = mq_alloc(kname, maxmsg, msgsize)) == NULL)
+		{
+			ret = -ENOSPC;
+			goto out;
+		}
+	}
+	
+	mq->count++;
+	curr_proc->mqdes[mqd] = mq;
+	if (oflag & O_NONBLOCK)
+		curr_proc->mqnonblock |= 1 << mqd;
+	else
+		curr_proc->mqnonblock &= ~(1 << mqd);
+	ret = mqd;
+
+out:
+	putname(kname);
+	return (ret);
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/mm.h>
+#include <nanvix/mq.h>
+#include <nanvix/pm.h>
+#include <errno.h>
+#include <mqueue.h>
+#include <signal.h>
+
+/*
+ * Receives a message from a message queue.
+ */
+PUBLIC ssize_t sys_mq_receive(mqd_t mqd, char *buf, size_t len, unsigned *prio)
+{
+	ssize_t ret;         /* Return value.  */
+	struct mqueue *mq;   /* Message queue. */
+	struct message *msg; /* Message.       */
+	
+	/* Invalid descriptor. */
+	if ((mqd < 0) || (mqd >= MQ_OPEN_MAX) || ((mq = curr_proc->mqdes[mqd]) == NULL))
+		return (-EBADF);
+	
+	/* Buffer too small. */
+	if (len < (size_t)mq->msgsize)
+		return (-EMSGSIZE);
+	
+	/* Invalid buffer. */
+	if (!chkmem(buf, len, MAY_WRITE))
+		return (-EFAULT);
+	if ((prio != NULL) && (!chkmem(prio, sizeof(unsigned), MAY_WRITE)))
+		return (-EFAULT);
+	
+	/* Wait for a message. */
+	while ((msg = mq_dequeue(mq)) == NULL)
+	{
+		if (curr_proc->mqnonblock & (1 << mqd))
+			return (-EAGAIN);
+		
+		sleep(&mq->rchain, PRIO_USER);
+		
+		/* Awaken by signal. */
+		if (issig() != SIGNULL)
+			return (-EINTR);
+	}
+	
+	ret = msg->size;
+	
+	if (prio != NULL)
+		*prio = msg->prio;
+	
+	if (mq_msgout(msg, buf))
+		ret = -EFAULT;
+	
+	mq_msgfree(msg);
+	
+	return (ret);
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/mm.h>
+#include <nanvix/mq.h>
+#include <nanvix/pm.h>
+#include <errno.h>
+#include <limits.h>
+#include <mqueue.h>
+#include <signal.h>
+
+/*
+ * Sends a message to a message queue.
+ */
+PUBLIC int sys_mq_send(mqd_t mqd, const char *buf, size_t len, unsigned prio)
+{
+	int nonblock;        /* Non-blocking descriptor? */
+	struct mqueue *mq;   /* Message queue.           */
+	struct message *msg; /* Message.                 */
+	
+	/* Invalid descriptor. */
+	if ((mqd < 0) || (mqd >= MQ_OPEN_MAX) || ((mq = curr_proc->mqdes[mqd]) == NULL))
+		return (-EBADF);
+	
+	/* Message too large. */
+	if (len > (size_t)mq->msgsize)
+		return (-EMSGSIZE);
+	
+	/* Invalid priority. */
+	if (prio >= MQ_PRIO_MAX)
+		return (-EINVAL);
+	
+	/* Invalid buffer. */
+	if (!chkmem(buf, len, MAY_READ))
+		return (-EFAULT);
+	
+	nonblock = curr_proc->mqnonblock & (1 << mqd);
+	
+	/* Queue is full. */
+	if ((nonblock) && (mq->curmsgs >= mq->maxmsg))
+		return (-EAGAIN);
+	
+	/*
+	 * Grab the message before waiting for room,
+	 * since doing so may sleep on page faults.
+	 */
+	if ((msg = mq_msgin(buf, len, prio)) == NULL)
+		return (-ENOMEM);
+	
+	while (mq->curmsgs >= mq->maxmsg)
+	{
+		if (nonblock)
+		{
+			mq_msgfree(msg);
+			return (-EAGAIN);
+		}
+		
+		sleep(&mq->wchain, PRIO_USER);
+		
+		/* Awaken by signal. */
+		if (issig() != SIGNULL)
+		{
+			mq_msgfree(msg);
+			return (-EINTR);
+		}
+	}
+	
+	mq_enqueue(mq, msg);
+	
+	return (0);
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/mm.h>
+#include <nanvix/mq.h>
+#include <nanvix/pm.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <mqueue.h>
+
+/*
+ * Gets and sets message queue attributes.
+ */
+PUBLIC int sys_mq_setattr(mqd_t mqd, const struct mq_attr *attr, struct mq_attr *oattr)
+{
+	long flags;        /* New flags.     */
+	struct mqueue *mq; /* Message queue. */
+	
+	/* Invalid descriptor. */
+	if ((mqd < 0) || (mqd >= MQ_OPEN_MAX) || ((mq = curr_proc->mqdes[mqd]) == NULL))
+		return (-EBADF);
+	
+	/* Invalid buffers. */
+	if ((attr != NULL) && (!chkmem(attr, sizeof(struct mq_attr), MAY_READ)))
+		return (-EFAULT);
+	if ((oattr != NULL) && (!chkmem(oattr, sizeof(struct mq_attr), MAY_WRITE)))
+		return (-EFAULT);
+	
+	flags = (attr != NULL) ? attr->mq_flags : 0;
+	
+	/* Get attributes. */
+	if (oattr != NULL)
+	{
+		oattr->mq_flags = (curr_proc->mqnonblock & (1 << mqd)) ? O_NONBLOCK : 0;
+		oattr->mq_maxmsg = mq->maxmsg;
+		oattr->mq_msgsize = mq->msgsize;
+		oattr->mq_curmsgs = mq->curmsgs;
+	}
+	
+	/* Set flags (other attributes are ignored). */
+	if (attr != NULL)
+	{
+		if (flags & O_NONBLOCK)
+			curr_proc->mqnonblock |= 1 << mqd;
+		else
+			curr_proc->mqnonblock &= ~(1 << mqd);
+	}
+	
+	return (0);
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include <nanvix/syscall.h>
+#include <sys/multicall.h>
+#include <errno.h>
+#include <signal.h>
+
+/*
+ * Largest error number returned by system calls.
+ */
+#define ERRNO_MAX 4095
+
+/*
+ * System call handler, as seen by the system call hook.
+ */
+typedef int (*syscall_t)(uint32_t, uint32_t, uint32_t, uint32_t, uint32_t);
+
+/*
+ * Asserts if a system call may run in a batch. System calls that
+ * create processes or replace the program image rely on the
+ * interrupt stack of their own kernel entry, so they may not.
+ */
+PRIVATE int batchable(int nr)
+{
+	switch (nr)
+	{
+		case NR_fork:
+		case NR_vfork:
+		case NR_clone:
+		case NR_execve:
+		case NR_multicall:
+			return (0);
+	}
+	
+	return ((nr >= 0) && (nr < NR_SYSCALLS));
+}
+
+/*
+ * Executes a batch of system calls.
+ */
+PUBLIC int sys_multicall(struct multicall *calls, unsigned n, int flags)
+{
+	int nr;     /* System call number. */
+	int ret;    /* Return value.       */
+	unsigned k; /* Loop index.         */
+	
+	/* Too many system calls. */
+	if (n > MULTICALL_MAX)
+		return (-EINVAL);
+	
+	/* Invalid descriptors. */
+	if (!chkmem(calls, n*sizeof(struct multicall), MAY_WRITE))
+		return (-EFAULT);
+	
+	for (k = 0; k < n; k++)
+	{
+		nr = calls[k].nr;
+		
+		if (!batchable(nr))
+			ret = -ENOSYS;
+		else
+		{
+			ret = ((syscall_t)syscalls_table[nr])(calls[k].args[0],
+				calls[k].args[1], calls[k].args[2], calls[k].args[3],
+				calls[k].args[4]);
+		}
+		
+		calls[k].ret = ret;
+		
+		/* Failed. */
+		if ((unsigned)ret >= (unsigned)-ERRNO_MAX)
+		{
+			if ((flags & MULTICALL_STOP) || (ret == -EINTR))
+				return (k + 1);
+		}
+		
+		/* Let signals through. */
+		if (issig() != SIGNULL)
+			return (k + 1);
+	}
+	
+	return (n);
+}
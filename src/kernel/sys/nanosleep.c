@@ -0,0 +1,102 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/clock.h>
+#include <nanvix/const.h>
+#include <nanvix/hal.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <time.h>
+
+/* Nanoseconds per clock tick. */
+#define NSEC_PER_TICK (1000000000/CLOCK_FREQ)
+
+/* Sleeping chain. */
+PRIVATE struct waitq chain = WAITQ_INITIALIZER;
+
+/*
+ * High resolution sleep.
+ */
+PUBLIC int sys_nanosleep(const struct timespec *rqtp, struct timespec *rmtp)
+{
+	unsigned timeout; /* Sleep time (in ticks). */
+	unsigned end;     /* Wakeup time.           */
+	unsigned left;    /* Time left (in ticks).  */
+	
+	/* Invalid buffers. */
+	if (!chkmem(rqtp, sizeof(struct timespec), MAY_READ))
+		return (-EINVAL);
+	if ((rmtp != NULL) && (!chkmem(rmtp, sizeof(struct timespec), MAY_WRITE)))
+		return (-EINVAL);
+	
+	/* Invalid time. */
+	if ((rqtp->tv_sec < 0) || (rqtp->tv_nsec < 0) || (rqtp->tv_nsec >= 1000000000))
+		return (-EINVAL);
+	
+	/* Too long, clamp. */
+	if (rqtp->tv_sec >= (INT_MAX/CLOCK_FREQ - 1))
+		timeout = INT_MAX - CLOCK_FREQ;
+	else
+	{
+		timeout = rqtp->tv_sec*CLOCK_FREQ + 
+			(rqtp->tv_nsec + NSEC_PER_TICK - 1)/NSEC_PER_TICK;
+	}
+	
+	/* Nothing to do. */
+	if (timeout == 0)
+		return (0);
+	
+	/*
+	 * The current tick has partially elapsed,
+	 * so wait for one more to never undersleep.
+	 */
+	end = ticks + timeout + 1;
+	
+	disable_interrupts();
+	
+	while ((int)(end - ticks) > 0)
+	{
+		tsleep(&chain, PRIO_USER, end - ticks);
+		
+		/* Wakeup on signal receipt. */
+		if (issig() != SIGNULL)
+			goto awaken;
+	}
+	
+	enable_interrupts();
+	
+	return (0);
+
+awaken:
+
+	left = ((int)(end - ticks) > 0) ? end - ticks : 0;
+	
+	enable_interrupts();
+	
+	if (rmtp != NULL)
+	{
+		rmtp->tv_sec = left/CLOCK_FREQ;
+		rmtp->tv_nsec = (left%CLOCK_FREQ)*NSEC_PER_TICK;
+	}
+	
+	return (-EINTR);
+}
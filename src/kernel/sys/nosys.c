@@ -18,26 +18,17 @@
  */
 
 #include <nanvix/const.h>
-#include <sys/types.h>
+#include <nanvix/syscall.h>
+#include <errno.h>
 
 /**
- * @brief Sets bytes in memory.
+ * @brief Unimplemented system call.
  * 
- * @param ptr Pointer to target memory area.
- * @param c   Character to use.
- * @param n   Number of bytes to be set.
+ * @details Fills reserved slots in the system calls table.
  * 
- * @returns A pointer to the target memory area. 
+ * @returns Always -ENOSYS.
  */
-PUBLIC void *kmemset(void *ptr, int c, size_t n)
+PUBLIC int sys_nosys(void)
 {
-    unsigned char *p;
-    
-    p = ptr;
-    
-    /* Set bytes. */
-    while (n-- > 0)
-		*p++ = (unsigned char) c;
-
-    return (ptr);	
+	return (-ENOSYS);
 }
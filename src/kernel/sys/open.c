@@ -54,7 +54,7 @@ PRIVATE struct inode *do_creat(struct inode *d, const char *name, mode_t mode, i
 		return (NULL);
 	}	
 	
-	i = inode_alloc(d->sb);
+	i = inode_alloc(d, S_IFREG);
 	
 	/* Failed to allocate inode. */
 	if (i == NULL)
@@ -75,9 +75,9 @@ PRIVATE struct inode *do_creat(struct inode *d, const char *name, mode_t mode, i
 }
 
 /*
- * Opens a file.
+ * Opens a file, looking up relative paths from the directory dir.
  */
-PRIVATE struct inode *do_open(const char *path, int oflag, mode_t mode)
+PRIVATE struct inode *do_open(struct inode *dir, const char *path, int oflag, mode_t mode)
 {
 	int err;              /* Error?               */
 	const char *name;     /* File name.           */
@@ -86,7 +86,7 @@ PRIVATE struct inode *do_open(const char *path, int oflag, mode_t mode)
 	dev_t dev;            /* File's device.       */
 	struct inode *i;      /* File's inode.        */
 	
-	dinode = inode_dname(path, &name);
+	dinode = inode_dname_at(dir, path, &name);
 	
 	/* Failed to get directory. */
 	if (dinode == NULL)
@@ -133,6 +133,13 @@ PRIVATE struct inode *do_open(const char *path, int oflag, mode_t mode)
 		goto error;
 	}
 	
+	/* Direct I/O is only supported on regular files. */
+	if ((oflag & O_DIRECT) && (!S_ISREG(i->mode)))
+	{
+		curr_proc->errno = -EINVAL;
+		goto error;
+	}
+	
 	/* Character special file. */
 	if (S_ISCHR(i->mode))
 	{
@@ -159,6 +166,13 @@ PRIVATE struct inode *do_open(const char *path, int oflag, mode_t mode)
 		goto error;
 	}
 	
+	/* Sockets are reached through connect(). */
+	else if (S_ISSOCK(i->mode))
+	{
+		curr_proc->errno = -ENXIO;
+		goto error;
+	}
+	
 	/* Regular file. */
 	else if (S_ISREG(i->mode))
 	{
@@ -189,23 +203,31 @@ error:
 }
 
 /*
- * Opens a file.
+ * Opens a file relative to a directory.
  */
-PUBLIC int sys_open(const char *path, int oflag, mode_t mode)
+PUBLIC int sys_openat(int dirfd, const char *path, int oflag, mode_t mode)
 {
 	int fd;           /* File descriptor.  */
 	struct file *f;   /* File.             */
 	struct inode *i;  /* Underlying inode. */
+	struct inode *d;  /* Lookup directory. */
 	char *name;       /* Path name.        */
 	
 	/* Fetch path from user address space. */
 	if ((name = getname(path)) == NULL)
 		return (curr_proc->errno);
 	
+	/* Bad directory. */
+	if ((d = getdirfd(dirfd, name)) == NULL)
+	{
+		putname(name);
+		return (curr_proc->errno);
+	}
+	
 	fd = getfildes();
 	
 	/* Too many opened files. */
-	if (fd >= OPEN_MAX)
+	if (fd < 0)
 	{
 		putname(name);
 		return (-EMFILE);
@@ -226,10 +248,10 @@ PUBLIC int sys_open(const char *path, int oflag, mode_t mode)
 	f->count = 1;	
 	
 	/* Open file. */
-	if ((i = do_open(name, oflag, mode)) == NULL)
+	if ((i = do_open(d, name, oflag, mode)) == NULL)
 	{
 		putname(name);
-		f->count = 0;
+		putfile(f);
 		return (curr_proc->errno);
 	}
 	
@@ -237,11 +259,23 @@ PUBLIC int sys_open(const char *path, int oflag, mode_t mode)
 	f->oflag = oflag;
 	f->pos = 0;
 	f->inode = i;
+	f->ra_pos = 0;
+	f->ra_size = 0;
+	f->advice = POSIX_FADV_NORMAL;
 	
 	curr_proc->ofiles[fd] = f;
+	curr_proc->ofmap |= 1 << fd;
 	curr_proc->close &= ~(1 << fd);
 
 	putname(name);
 	
 	return (fd);
 }
+
+/*
+ * Opens a file.
+ */
+PUBLIC int sys_open(const char *path, int oflag, mode_t mode)
+{
+	return (sys_openat(AT_FDCWD, path, oflag, mode));
+}
@@ -23,7 +23,7 @@
 #include <signal.h>
 
 /* Sleeping chain. */
-PRIVATE struct process *chain = NULL;
+PRIVATE struct waitq chain = WAITQ_INITIALIZER;
 
 /*
  * Suspends the calling process until a signal is received.
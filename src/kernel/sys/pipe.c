@@ -38,20 +38,30 @@ PUBLIC int sys_pipe(int fildes[2])
 	/* Get empty file descriptors. */
 	if ((fd[0] = getfildes()) < 0)
 		return (-EMFILE);
-	if ((fd[1] = getfildes()) < 0)
+	curr_proc->ofmap |= 1 << fd[0];
+	fd[1] = getfildes();
+	curr_proc->ofmap &= ~(1 << fd[0]);
+	if (fd[1] < 0)
 		return (-EMFILE);
 	
 	/* Get empty files. */
 	if ((f[0] = getfile()) == NULL)
 		return (-ENFILE);
 	if ((f[1] = getfile()) == NULL)
+	{
+		putfile(f[0]);
 		return (-ENFILE);
+	}
 	
 	inode = inode_pipe();
 	
 	/* Failed to get pipe inode. */
 	if (inode == NULL)
+	{
+		putfile(f[1]);
+		putfile(f[0]);
 		return (-EAGAIN);
+	}
 	
 	/* Initialize files. */
 	f[0]->oflag = O_RDONLY;
@@ -60,6 +70,7 @@ PUBLIC int sys_pipe(int fildes[2])
 	f[0]->inode = f[1]->inode = inode;
 	curr_proc->ofiles[fd[0]] = f[0];
 	curr_proc->ofiles[fd[1]] = f[1];
+	curr_proc->ofmap |= (1 << fd[0]) | (1 << fd[1]);
 	
 	fildes[0] = fd[0];
 	fildes[1] = fd[1];
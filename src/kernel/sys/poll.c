@@ -0,0 +1,170 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/clock.h>
+#include <nanvix/const.h>
+#include <nanvix/dev.h>
+#include <nanvix/epoll.h>
+#include <nanvix/fs.h>
+#include <nanvix/hal.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include <nanvix/socket.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+
+/* Milliseconds per clock tick. */
+#define MSEC_PER_TICK (1000/CLOCK_FREQ)
+
+/*
+ * Processes that poll files. Objects do not keep track of who polls
+ * them, so any change of readiness wakes up all pollers, which then
+ * look at their files again.
+ */
+PRIVATE struct waitq pollq = WAITQ_INITIALIZER;
+
+/* Changes of readiness so far. */
+PRIVATE volatile unsigned pollseq = 0;
+
+/*
+ * Wakes up processes that poll files. Character devices do not know
+ * which inode they are opened through, so they pass a NULL inode.
+ */
+PUBLIC void pollwakeup(const struct inode *ip)
+{
+	pollseq++;
+	wakeup(&pollq);
+	epoll_notify(ip);
+}
+
+/*
+ * Asserts which operations on an open file would not block.
+ */
+PUBLIC int do_poll(struct file *f)
+{
+	int revents;     /* Events ready. */
+	struct inode *i; /* Inode.        */
+	
+	i = f->inode;
+	
+	/* Character special file. */
+	if (S_ISCHR(i->mode))
+		revents = cdev_poll(i->blocks[0]);
+	
+	/* Pipe file. */
+	else if (S_ISFIFO(i->mode))
+		revents = pipe_poll(i);
+	
+	/* Socket. */
+	else if (S_ISSOCK(i->mode))
+		revents = socket_poll(i);
+	
+	/* Regular files and block devices never block. */
+	else
+		revents = POLLIN | POLLOUT;
+	
+	/* File not opened for reading or writing. */
+	if (ACCMODE(f->oflag) == O_WRONLY)
+		revents &= ~POLLIN;
+	else if (ACCMODE(f->oflag) == O_RDONLY)
+		revents &= ~POLLOUT;
+	
+	return (revents);
+}
+
+/*
+ * Waits for events on file descriptors.
+ */
+PUBLIC int sys_poll(struct pollfd *fds, nfds_t nfds, int timeout)
+{
+	int n;          /* Ready descriptors.  */
+	nfds_t k;       /* Loop index.         */
+	unsigned seq;   /* Readiness sequence. */
+	unsigned end;   /* Wakeup time.        */
+	struct file *f; /* Polled file.        */
+	
+	/* Too many descriptors. */
+	if (nfds > OPEN_MAX)
+		return (-EINVAL);
+	
+	/* Invalid buffer. */
+	if (!chkmem(fds, nfds*sizeof(struct pollfd), MAY_WRITE))
+		return (-EFAULT);
+	
+	end = ticks + 1;
+	if (timeout > 0)
+		end += ((unsigned)timeout + MSEC_PER_TICK - 1)/MSEC_PER_TICK;
+	
+	while (1)
+	{
+		seq = pollseq;
+		
+		/* Look at all descriptors. */
+		for (n = 0, k = 0; k < nfds; k++)
+		{
+			fds[k].revents = 0;
+			
+			/* Ignored entry. */
+			if (fds[k].fd < 0)
+				continue;
+			
+			/* Invalid descriptor. */
+			if ((fds[k].fd >= OPEN_MAX) || ((f = curr_proc->ofiles[fds[k].fd]) == NULL))
+				fds[k].revents = POLLNVAL;
+			else
+				fds[k].revents = do_poll(f) & (fds[k].events | POLLERR | POLLHUP);
+			
+			if (fds[k].revents)
+				n++;
+		}
+		
+		/* Done. */
+		if ((n > 0) || (timeout == 0))
+			return (n);
+		
+		disable_interrupts();
+		
+		/*
+		 * Sleep unless something has changed
+		 * while we were looking at the files.
+		 */
+		if (seq == pollseq)
+		{
+			if (timeout < 0)
+				sleep(&pollq, PRIO_USER);
+			else if ((int)(end - ticks) > 0)
+				tsleep(&pollq, PRIO_USER, end - ticks);
+			else
+			{
+				enable_interrupts();
+				return (0);
+			}
+		}
+		
+		enable_interrupts();
+		
+		/* Awaken by signal. */
+		if (issig() != SIGNULL)
+			return (-EINTR);
+	}
+}
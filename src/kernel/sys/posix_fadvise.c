@@ -0,0 +1,71 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/fs.h>
+#include <nanvix/pm.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+
+/*
+ * Gives advice about the use of file data.
+ */
+PUBLIC int sys_posix_fadvise(int fd, off_t off, off_t len, int advice)
+{
+	struct file *f;  /* File.  */
+	struct inode *i; /* Inode. */
+	
+	/* Invalid file descriptor. */
+	if ((fd < 0) || (fd >= OPEN_MAX) || ((f = curr_proc->ofiles[fd]) == NULL))
+		return (-EBADF);
+	
+	i = f->inode;
+	
+	/* Pipes and sockets have no data to give advice about. */
+	if ((S_ISFIFO(i->mode)) || (S_ISSOCK(i->mode)))
+		return (-ESPIPE);
+	
+	/* Only regular files live in the caches. */
+	if ((!S_ISREG(i->mode)) || (off < 0) || (len < 0))
+		return (-EINVAL);
+	
+	switch (advice)
+	{
+		/* Advice on the access pattern. */
+		case POSIX_FADV_NORMAL:
+		case POSIX_FADV_RANDOM:
+		case POSIX_FADV_SEQUENTIAL:
+			f->advice = advice;
+			break;
+		
+		/* Advice on a range. */
+		case POSIX_FADV_WILLNEED:
+		case POSIX_FADV_DONTNEED:
+		case POSIX_FADV_NOREUSE:
+			break;
+		
+		default:
+			return (-EINVAL);
+	}
+	
+	file_advise(i, off, len, advice);
+	
+	return (0);
+}
@@ -0,0 +1,154 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/klib.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include <sys/procstat.h>
+#include <errno.h>
+
+/* Error checking. */
+#if (PROCSTAT_ZOMBIE != PROC_ZOMBIE) || (PROCSTAT_STOPPED != PROC_STOPPED)
+	#error "process states mismatch"
+#endif
+
+/**
+ * @brief Asserts if a process matches a snapshot filter.
+ * 
+ * @param p      Process.
+ * @param filter Snapshot filter.
+ * 
+ * @returns Non-zero if the process matches the filter, and zero otherwise.
+ */
+PRIVATE int procstat_match(struct process *p, const struct procfilter *filter)
+{
+	unsigned i;
+	
+	if ((filter->states) && !(filter->states & PROCSTAT_STATE(p->state)))
+		return (0);
+	
+	if (filter->npids == 0)
+		return (1);
+	
+	for (i = 0; i < filter->npids; i++)
+	{
+		if (filter->pids[i] == p->pid)
+			return (1);
+	}
+	
+	return (0);
+}
+
+/**
+ * @brief Gets a snapshot of the process table.
+ * 
+ * @details Stores a record for each process that matches the filter
+ *          pointed to by filter in the array pointed to by buf, up to n
+ *          records. If filter is a null pointer, all processes match.
+ *          Records are copied out without any formatting, so that
+ *          monitors can sample the process table at a low cost.
+ * 
+ * @param version Version of the interface expected by the caller.
+ * @param filter  Snapshot filter.
+ * @param buf     Location where records shall be stored.
+ * @param n       Number of records that fit in the buffer.
+ * 
+ * @returns Upon successful completion, the number of matching processes
+ *          is returned, which may be greater than n. Upon failure, a
+ *          negative error number is returned instead.
+ */
+PUBLIC int sys_procstat
+(int version, const struct procfilter *filter, struct procstat *buf, unsigned n)
+{
+	int nmatch;                /* Matching processes. */
+	struct process *p;         /* Working process.    */
+	struct procstat *r;        /* Working record.     */
+	struct procfilter any;     /* Default filter.     */
+	
+	if (version != PROCSTAT_VERSION)
+		return (-EINVAL);
+	
+	/* Match all processes. */
+	if (filter == NULL)
+	{
+		kmemset(&any, 0, sizeof(struct procfilter));
+		filter = &any;
+	}
+	
+	/* Valid filter. */
+	else if (!chkmem(filter, sizeof(struct procfilter), MAY_READ))
+		return (-EINVAL);
+	
+	if (filter->npids > PROCSTAT_PIDS)
+		return (-EINVAL);
+	
+	if (n > PROC_MAX)
+		n = PROC_MAX;
+	
+	/* Valid buffer. */
+	if ((n > 0) && (!chkmem(buf, n*sizeof(struct procstat), MAY_WRITE)))
+		return (-EINVAL);
+	
+	nmatch = 0;
+	for (p = IDLE; p <= LAST_PROC; p++)
+	{
+		/* Skip invalid processes. */
+		if (!IS_VALID(p))
+			continue;
+		
+		if (!procstat_match(p, filter))
+			continue;
+		
+		/* Buffer is full. */
+		if ((unsigned)nmatch++ >= n)
+			continue;
+		
+		r = &buf[nmatch - 1];
+		r->pid = p->pid;
+		r->ppid = (p->father != NULL) ? p->father->pid : 0;
+		r->uid = p->uid;
+		r->state = p->state;
+		r->priority = p->priority;
+		r->nice = p->nice;
+		r->utime = p->utime;
+		r->ktime = p->ktime;
+		r->rss = 0;
+		r->maxrss = p->maxrss;
+		r->minflt = p->minflt;
+		r->majflt = p->majflt;
+		r->nvcsw = p->nvcsw;
+		r->nivcsw = p->nivcsw;
+		r->inblock = p->inblock;
+		r->oublock = p->oublock;
+		r->nsyscall = p->nsyscall;
+		kstrncpy(r->name, p->name, NAME_MAX);
+		
+		/* Resident pages. */
+		if ((filter->flags & PROCSTAT_RSS) && (p != IDLE))
+		{
+			if (p->state != PROC_ZOMBIE)
+				r->rss = pgrss(p);
+			if (r->rss > r->maxrss)
+				r->maxrss = r->rss;
+		}
+	}
+	
+	return (nmatch);
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/hal.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include <nanvix/syscall.h>
+#include <errno.h>
+
+/*
+ * Starts or stops execution time profiling.
+ * 
+ * On every clock tick that interrupts the process in user mode, the
+ * interrupted address pc is mapped to the bucket
+ * ((pc - offset)/2)*scale/65536 of buf, which is incremented if it lies
+ * within bufsiz bytes. A scale of 0x10000 maps every two bytes of text to
+ * one bucket, and a scale of 0 or 1 stops profiling.
+ */
+PUBLIC int sys_profil(unsigned short *buf, size_t bufsiz, size_t offset,
+	unsigned scale)
+{
+	addr_t addr; /* Working page.     */
+	addr_t end;  /* End of histogram. */
+	
+	/* Stop profiling. */
+	if (scale <= 1)
+	{
+		curr_proc->profscale = 0;
+		return (0);
+	}
+	
+	/* Invalid buffer. */
+	if ((bufsiz == 0) || (!chkmem(buf, bufsiz, MAY_WRITE)))
+		return (-EFAULT);
+	
+	/*
+	 * Buckets are incremented from the clock interrupt,
+	 * which cannot take page faults, so bring the
+	 * histogram in now and break copy on write.
+	 */
+	end = ADDR(buf) + bufsiz;
+	for (addr = ADDR(buf) & PAGE_MASK; addr < end; addr += PAGE_SIZE)
+	{
+		if (faultupg(addr, 1))
+			return (-ENOMEM);
+	}
+	
+	disable_interrupts();
+	
+	curr_proc->profbuf = buf;
+	curr_proc->profsize = bufsiz;
+	curr_proc->profoff = offset;
+	curr_proc->profscale = scale;
+	
+	enable_interrupts();
+	
+	return (0);
+}
@@ -17,8 +17,11 @@
  * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <nanvix/clock.h>
 #include <nanvix/klib.h>
+#include <nanvix/mm.h>
 #include <nanvix/pm.h>
+#include <unistd.h>
 
 void reverse(char* s)
 {
@@ -67,18 +70,83 @@ void prepareValue(int value, char* s, int padding)
 	*(s+i) = '\0';
 }
 
+/*
+ * Prints resource usage of processes.
+ */
+PRIVATE void ps_rusage(void)
+{
+	struct process *p;
+	unsigned maxrss;
+	unsigned i;
+	int size;
+
+	char name   [26];
+	char pid    [26];
+	char minflt [26];
+	char majflt [26];
+	char nvcsw  [26];
+	char nivcsw [26];
+	char inblock[26];
+	char oublock[26];
+	char nsys   [26];
+	char rss    [26];
+
+	kprintf("------------------------------- Resource Usage"
+			" -------------------------------\n"
+		    "NAME           PID   MINFLT MAJFLT VCSW   IVCSW  "
+		    "INBLK  OUBLK  SYSCALL MAXRSS");
+
+	for (p = IDLE; p <= LAST_PROC; p++)
+	{
+		/* Skip invalid processes. */
+		if (!IS_VALID(p))
+			continue;
+
+		/* Name */
+		size = kstrlen(p->name);
+		kstrcpy(name, p->name);
+		for (i = size; i < 15; i++)
+			name[i] = ' ';
+		name[i] = '\0';
+
+		/* Peak resident pages, now included. */
+		maxrss = p->maxrss;
+		if ((p != IDLE) && (p->state != PROC_ZOMBIE) && (pgrss(p) > maxrss))
+			maxrss = pgrss(p);
+
+		prepareValue(p->pid, pid, 6);
+		prepareValue(p->minflt, minflt, 7);
+		prepareValue(p->majflt, majflt, 7);
+		prepareValue(p->nvcsw, nvcsw, 7);
+		prepareValue(p->nivcsw, nivcsw, 7);
+		prepareValue(p->inblock, inblock, 7);
+		prepareValue(p->oublock, oublock, 7);
+		prepareValue(p->nsyscall, nsys, 8);
+		prepareValue(maxrss, rss, 6);
+
+		kprintf("%s%s%s%s%s%s%s%s%s%s", name, pid, minflt, majflt,
+			nvcsw, nivcsw, inblock, oublock, nsys, rss);
+	}
+}
+
 /*
  * Gets process information and print on the screen
  */
 
-PUBLIC int sys_ps()
+PUBLIC int sys_ps(int flags)
 {
 	struct process *p;
+	
+	if (flags & PS_RUSAGE)
+	{
+		ps_rusage();
+		return (0);
+	}
 
 	kprintf("------------------------------- Process Status"
 			" -------------------------------\n"
-		    "NAME               PID   UID       PRIORITY   NICE"
-		    "   UTIME   KTIME     STATUS");
+		    "NAME               PID   UID   PRIO  NICE  "
+		    "UTIME  KTIME  RSS   MAJFLT STATUS");
 
 
 	char name    [26];
@@ -88,6 +156,8 @@ PUBLIC int sys_ps()
 	char nice    [26];
 	char utime   [26];
 	char ktime   [26];
+	char rss     [26];
+	char majflt  [26];
 
 	const char *states[7];
 	states[0] = "DEAD";
@@ -101,6 +171,8 @@ PUBLIC int sys_ps()
 	unsigned len = 0;
 	unsigned i;
 	int size;
+	unsigned nready, switches, idle, stretch;
+	uint64_t halted, elapsed;
 
 	for (p = IDLE; p <= LAST_PROC; p++)
 	{
@@ -122,24 +194,44 @@ PUBLIC int sys_ps()
 		prepareValue(p->pid, pid, 6);
 
 		/* Remaining Quantum */
-		prepareValue(p->uid, uid, 10);
+		prepareValue(p->uid, uid, 6);
 
 		/* Priority */
-		prepareValue(p->priority, priority, 11);
+		prepareValue(p->priority, priority, 6);
 
 		/* Nice */
-		prepareValue(p->nice, nice, 7);
+		prepareValue(p->nice, nice, 6);
 
 		/* Utime */
-		prepareValue(p->utime, utime, 8);
+		prepareValue(p->utime, utime, 7);
 
 		/* Ktime */
-		prepareValue(p->ktime, ktime, 10);
+		prepareValue(p->ktime, ktime, 7);
+		
+		/* Resident pages */
+		prepareValue((p == IDLE) ? 0 : pgrss(p), rss, 6);
 		
-		kprintf("%s%s%s%s%s%s%s%s",name, pid, 
-			uid, priority, nice, utime, ktime, states[(int)p->state] );
+		/* Major faults */
+		prepareValue(p->majflt, majflt, 7);
+		
+		kprintf("%s%s%s%s%s%s%s%s%s%s",name, pid, uid, priority, nice,
+			utime, ktime, rss, majflt, states[(int)p->state] );
 	}
 
-	kprintf("\nLast process: %s, pid: %d\n",last_proc->name, last_proc->pid);
+	sched_stat(&nready, &switches, &idle, &stretch);
+	kprintf("\nCPU 0: %d ready, %d switches, %d idle",
+		nready, switches, idle);
+	kprintf("longest non-preemptible stretch: %d ticks", stretch);
+	
+	/* Scale down, to get a percentage without 64-bit division. */
+	clock_idlestat(&halted, &elapsed);
+	while (elapsed >> 24)
+	{
+		halted >>= 1;
+		elapsed >>= 1;
+	}
+	kprintf("idle residency: %d%c",
+		(elapsed) ? (unsigned)halted*100/(unsigned)elapsed : 0, '%');
+	kprintf("Last process: %s, pid: %d\n",last_proc->name, last_proc->pid);
 	return 0;
 }
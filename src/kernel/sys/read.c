@@ -23,46 +23,34 @@
 #include <nanvix/fs.h>
 #include <nanvix/klib.h>
 #include <nanvix/mm.h>
+#include <nanvix/socket.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
 #include <errno.h>
 
 /*
- * Reads from a file.
+ * Reads from an open file at a given offset.
  */
-PUBLIC ssize_t sys_read(int fd, void *buf, size_t n)
+PRIVATE ssize_t do_readat(struct file *f, void *buf, size_t n, off_t off, unsigned ra)
 {
 	dev_t dev;       /* Device number.       */
-	struct file *f;  /* File.                */
 	struct inode *i; /* Inode.               */
 	ssize_t count;   /* Bytes actually read. */
 	
-	/* Invalid file descriptor. */
-	if ((fd < 0) || (fd >= OPEN_MAX) || ((f = curr_proc->ofiles[fd]) == NULL))
-		return (-EBADF);
-	
-	/* File not opened for reading. */
-	if (ACCMODE(f->oflag) == O_WRONLY)
-		return (-EBADF);
-
-#if (EDUCATIONAL_KERNEL == 0)
-	
-	/* Invalid buffer. */	
-	if (!chkmem(buf, n, MAY_WRITE))
-		return (-EINVAL);
-
-#endif
-
-	/* Nothing to do. */
-	if (n == 0)
-		return (0);
-	
-	 i = f->inode;
+	i = f->inode;
 	
 	/* Character special file. */
 	if (S_ISCHR(i->mode))
 	{		
 		dev = i->blocks[0];
+		
+		/* Would block. */
+		if ((f->oflag & O_NONBLOCK) && (!(cdev_poll(dev) & POLLIN)))
+			return (-EAGAIN);
+		
 		count = cdev_read(dev, buf, n);
 		return (count);
 	}
@@ -71,19 +59,26 @@ PUBLIC ssize_t sys_read(int fd, void *buf, size_t n)
 	else if (S_ISBLK(i->mode))
 	{
 		dev = i->blocks[0];
-		count = bdev_read(dev, buf, n, f->pos);
+		count = bdev_read(dev, buf, n, off);
 	}
 	
 	/* Pipe file. */
 	else if (S_ISFIFO(i->mode))
 	{
-		kprintf("read from pipe");
-		count = pipe_read(i, buf, n);
+		count = pipe_read(i, buf, n, f->oflag & O_NONBLOCK);
 	}
 	
+	/* Socket. */
+	else if (S_ISSOCK(i->mode))
+		count = socket_read(i, buf, n, f->oflag & O_NONBLOCK);
+	
+	/* Direct I/O. */
+	else if ((S_ISREG(i->mode)) && (f->oflag & O_DIRECT))
+		count = file_direct(i, buf, n, off, 0);
+	
 	/* Regular file/directory. */
 	else if ((S_ISDIR(i->mode)) || (S_ISREG(i->mode)))
-		count = file_read(i, buf, n, f->pos);
+		count = file_read(i, buf, n, off, ra);
 	
 	/* Unknown file type. */
 	else
@@ -93,8 +88,172 @@ PUBLIC ssize_t sys_read(int fd, void *buf, size_t n)
 	if (count < 0)
 		return (curr_proc->errno);
 
-	inode_touch(i);
-	f->pos += count;
+	inode_access(i);
+
+	return (count);
+}
+
+/*
+ * Reads from an open file.
+ */
+PUBLIC ssize_t do_read(struct file *f, void *buf, size_t n)
+{
+	ssize_t count; /* Bytes actually read. */
+	
+	count = do_readat(f, buf, n, f->pos, file_readahead(f, n));
+	
+	/* Character devices have no file offset. */
+	if ((count > 0) && (!S_ISCHR(f->inode->mode)))
+		f->pos += count;
+	
+	return (count);
+}
+
+/*
+ * Reads from an open file at a given offset.
+ */
+PUBLIC ssize_t do_pread(struct file *f, void *buf, size_t n, off_t off)
+{
+	/* Pipes and sockets cannot seek. */
+	if ((S_ISFIFO(f->inode->mode)) || (S_ISSOCK(f->inode->mode)))
+		return (-ESPIPE);
+	
+	/* Invalid offset. */
+	if (off < 0)
+		return (-EINVAL);
+	
+	return (do_readat(f, buf, n, off, 0));
+}
+
+/*
+ * Gets a file that may be read.
+ */
+PRIVATE struct file *rdfile(int fd)
+{
+	struct file *f; /* File. */
+	
+	/* Invalid file descriptor. */
+	if ((fd < 0) || (fd >= OPEN_MAX) || ((f = curr_proc->ofiles[fd]) == NULL))
+		return (NULL);
+	
+	/* File not opened for reading. */
+	if (ACCMODE(f->oflag) == O_WRONLY)
+		return (NULL);
+	
+	return (f);
+}
+
+/*
+ * Reads from a file.
+ */
+PUBLIC ssize_t sys_read(int fd, void *buf, size_t n)
+{
+	struct file *f; /* File. */
+	
+	if ((f = rdfile(fd)) == NULL)
+		return (-EBADF);
+
+#if (EDUCATIONAL_KERNEL == 0)
+	
+	/* Invalid buffer. */	
+	if (!chkmem(buf, n, MAY_WRITE))
+		return (-EINVAL);
+
+#endif
+
+	/* Nothing to do. */
+	if (n == 0)
+		return (0);
+	
+	return (do_read(f, buf, n));
+}
+
+/*
+ * Reads from a file at a given offset.
+ */
+PUBLIC ssize_t sys_pread(int fd, void *buf, size_t n, off_t off)
+{
+	struct file *f; /* File. */
+	
+	if ((f = rdfile(fd)) == NULL)
+		return (-EBADF);
+
+#if (EDUCATIONAL_KERNEL == 0)
+	
+	/* Invalid buffer. */	
+	if (!chkmem(buf, n, MAY_WRITE))
+		return (-EINVAL);
+
+#endif
 
+	/* Nothing to do. */
+	if (n == 0)
+		return (0);
+	
+	return (do_pread(f, buf, n, off));
+}
+
+/*
+ * Reads from a file into multiple buffers.
+ */
+PUBLIC ssize_t sys_readv(int fd, const struct iovec *iov, int iovcnt)
+{
+	int k;          /* Loop index.           */
+	size_t total;   /* Bytes requested.      */
+	ssize_t count;  /* Bytes actually read.  */
+	ssize_t n;      /* Bytes read in buffer. */
+	struct file *f; /* File.                 */
+	
+	if ((f = rdfile(fd)) == NULL)
+		return (-EBADF);
+	
+	/* Invalid vector count. */
+	if ((iovcnt <= 0) || (iovcnt > IOV_MAX))
+		return (-EINVAL);
+	
+	/* Invalid vector. */
+	if (!chkmem(iov, iovcnt*sizeof(struct iovec), MAY_READ))
+		return (-EINVAL);
+	
+	/* Check buffers. */
+	total = 0;
+	for (k = 0; k < iovcnt; k++)
+	{
+		/* Too many bytes. */
+		if (iov[k].iov_len > SSIZE_MAX - total)
+			return (-EINVAL);
+		
+#if (EDUCATIONAL_KERNEL == 0)
+		
+		/* Invalid buffer. */
+		if (!chkmem(iov[k].iov_base, iov[k].iov_len, MAY_WRITE))
+			return (-EINVAL);
+		
+#endif
+		
+		total += iov[k].iov_len;
+	}
+	
+	/* Read data. */
+	count = 0;
+	for (k = 0; k < iovcnt; k++)
+	{
+		/* Skip empty buffers. */
+		if (iov[k].iov_len == 0)
+			continue;
+		
+		n = do_read(f, iov[k].iov_base, iov[k].iov_len);
+		
+		/* Failed to read. */
+		if (n < 0)
+			return ((count > 0) ? count : n);
+		
+		count += n;
+		
+		/* Short read. */
+		if ((size_t)n < iov[k].iov_len)
+			break;
+	}
+	
 	return (count);
 }
@@ -0,0 +1,173 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/fs.h>
+#include <nanvix/mm.h>
+#include <nanvix/net.h>
+#include <nanvix/pm.h>
+#include <nanvix/socket.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+
+/*
+ * Opens files passed along with a message, writing their file
+ * descriptors to a control message.
+ */
+PRIVATE void putrights(struct msghdr *msg, struct rights *r)
+{
+	int fd;               /* File descriptor. */
+	unsigned i;           /* Loop index.      */
+	unsigned nfds;        /* Files that fit.  */
+	struct cmsghdr *cmsg; /* Control message. */
+	
+	/* No room for control message. */
+	if (msg->msg_controllen < CMSG_LEN(sizeof(int)))
+	{
+		msg->msg_flags |= MSG_CTRUNC;
+		msg->msg_controllen = 0;
+		return;
+	}
+	
+	nfds = (msg->msg_controllen - CMSG_LEN(0))/sizeof(int);
+	if (nfds > r->nfiles)
+		nfds = r->nfiles;
+	
+	cmsg = msg->msg_control;
+	for (i = 0; i < nfds; i++)
+	{
+		/* Too many opened files. */
+		if ((fd = getfildes()) < 0)
+			break;
+		
+		curr_proc->ofiles[fd] = r->files[i];
+		curr_proc->ofmap |= 1 << fd;
+		curr_proc->close &= ~(1 << fd);
+		r->files[i] = NULL;
+		
+		((int *)CMSG_DATA(cmsg))[i] = fd;
+	}
+	
+	/* Some files were not taken. */
+	if (i < r->nfiles)
+		msg->msg_flags |= MSG_CTRUNC;
+	
+	cmsg->cmsg_len = CMSG_LEN(i*sizeof(int));
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	msg->msg_controllen = cmsg->cmsg_len;
+}
+
+/*
+ * Receives a message from a socket.
+ */
+PUBLIC ssize_t sys_recvmsg(int fd, struct msghdr *msg, int flags)
+{
+	int k;                    /* Loop index.      */
+	ssize_t ret;              /* Return value.    */
+	size_t total;             /* Bytes asked for. */
+	struct socket *so;        /* Socket.          */
+	struct rights *r;         /* Files in flight. */
+	char path[SOCK_PATH_MAX]; /* Sender path.     */
+	
+	if ((so = socket_get(fd)) == NULL)
+		return (curr_proc->errno);
+	
+	/* Invalid message. */
+	if (!chkmem(msg, sizeof(struct msghdr), MAY_WRITE))
+		return (-EINVAL);
+	
+	/* Invalid vector count. */
+	if ((msg->msg_iovlen < 0) || (msg->msg_iovlen > IOV_MAX))
+		return (-EINVAL);
+	
+	/* Invalid vector. */
+	if ((msg->msg_iovlen > 0) &&
+		(!chkmem(msg->msg_iov, msg->msg_iovlen*sizeof(struct iovec), MAY_READ)))
+		return (-EINVAL);
+	
+	/* Check buffers. */
+	total = 0;
+	for (k = 0; k < msg->msg_iovlen; k++)
+	{
+		/* Too many bytes. */
+		if (msg->msg_iov[k].iov_len > SSIZE_MAX - total)
+			return (-EINVAL);
+		
+		/* Invalid buffer. */
+		if ((msg->msg_iov[k].iov_len > 0) &&
+			(!chkmem(msg->msg_iov[k].iov_base, msg->msg_iov[k].iov_len, MAY_WRITE)))
+			return (-EINVAL);
+		
+		total += msg->msg_iov[k].iov_len;
+	}
+	
+	/* Invalid address buffer. */
+	if ((msg->msg_name != NULL) &&
+		(!chkmem(msg->msg_name, msg->msg_namelen, MAY_WRITE)))
+		return (-EINVAL);
+	
+	/* Invalid control buffer. */
+	if ((msg->msg_control != NULL) &&
+		(!chkmem(msg->msg_control, msg->msg_controllen, MAY_WRITE)))
+		return (-EINVAL);
+	
+	if (curr_proc->ofiles[fd]->oflag & O_NONBLOCK)
+		flags |= MSG_DONTWAIT;
+	
+	if (so->domain == AF_INET)
+	{
+		ret = inet_recv(so, msg->msg_iov, msg->msg_iovlen, msg->msg_name,
+			&msg->msg_namelen, &flags);
+		
+		/* Failed to receive. */
+		if (ret < 0)
+			return (curr_proc->errno);
+		
+		msg->msg_flags = flags;
+		msg->msg_controllen = 0;
+		
+		return (ret);
+	}
+	
+	r = NULL;
+	ret = socket_recv(so, msg->msg_iov, msg->msg_iovlen, path,
+		(msg->msg_control != NULL) ? &r : NULL, &flags);
+	
+	/* Failed to receive. */
+	if (ret < 0)
+		return (curr_proc->errno);
+	
+	msg->msg_flags = flags;
+	
+	if (msg->msg_name != NULL)
+		socket_name(path, msg->msg_name, &msg->msg_namelen);
+	
+	/* Hand files over. */
+	if (r != NULL)
+	{
+		putrights(msg, r);
+		rights_free(r);
+	}
+	else
+		msg->msg_controllen = 0;
+	
+	return (ret);
+}
@@ -0,0 +1,309 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/fs.h>
+#include <nanvix/klib.h>
+#include <nanvix/pm.h>
+#include <errno.h>
+#include <limits.h>
+
+/*
+ * Asserts if a file name may not be renamed.
+ */
+PRIVATE int badname(const char *name)
+{
+	return ((*name == '\0') || (*name == '/') ||
+		(!kstrcmp(name, ".")) || (!kstrcmp(name, "..")));
+}
+
+/*
+ * Looks up the file to be renamed. Upon success, the parent directory and
+ * the file are returned referenced, but unlocked.
+ */
+PRIVATE int rename_source
+(const char *path, const char **name, struct inode **dir, struct inode **file)
+{
+	int ret;          /* Return value.    */
+	ino_t num;        /* Inode number.    */
+	struct inode *d;  /* Parent directory. */
+	struct inode *f;  /* File.            */
+	
+	if ((d = inode_dname(path, name)) == NULL)
+		return (curr_proc->errno);
+	
+	/* Invalid file name. */
+	if (badname(*name))
+	{
+		ret = -EINVAL;
+		goto error0;
+	}
+	
+	/* Not allowed to write in parent directory. */
+	if (!permission(d->mode, d->uid, d->gid, curr_proc, MAY_WRITE, 0))
+	{
+		ret = -EACCES;
+		goto error0;
+	}
+	
+	/* No such file. */
+	if ((num = dir_search(d, *name)) == INODE_NULL)
+	{
+		ret = -ENOENT;
+		goto error0;
+	}
+	
+	/* Failed to get inode. */
+	if ((f = inode_get(d->dev, num)) == NULL)
+	{
+		ret = -ENFILE;
+		goto error0;
+	}
+	
+	/* Mount point. */
+	if (f->flags & INODE_MOUNT)
+	{
+		inode_put(f);
+		ret = -EBUSY;
+		goto error0;
+	}
+	
+	inode_unlock(f);
+	inode_unlock(d);
+	*dir = d;
+	*file = f;
+	
+	return (0);
+
+error0:
+	inode_put(d);
+	return (ret);
+}
+
+/*
+ * Renames a file.
+ * 
+ * Only one directory is locked at a time. The new name is made to point to
+ * the file before the old name is removed, so the new name refers either
+ * to the file it replaces or to the renamed file all along. A replaced
+ * file is swapped in place in its directory entry, and a file renamed
+ * within a plain directory just has its entry renamed.
+ */
+PUBLIC int sys_rename(const char *path1, const char *path2)
+{
+	int ret;              /* Return value.          */
+	int isdir;            /* Renaming a directory?  */
+	int moved;            /* Changing parent?       */
+	size_t len;           /* Length of source path. */
+	ino_t num;            /* Renamed inode.         */
+	ino_t nnum;           /* Replaced inode.        */
+	ino_t onum;           /* Old parent directory.  */
+	ino_t dnum;           /* New parent directory.  */
+	char *old, *new;      /* Path names.            */
+	char *oabs, *nabs;    /* Absolute path names.   */
+	const char *oname;    /* Old file name.         */
+	const char *nname;    /* New file name.         */
+	struct inode *dold;   /* Old parent directory.  */
+	struct inode *dnew;   /* New parent directory.  */
+	struct inode *src;    /* Renamed file.          */
+	struct inode *tgt;    /* Replaced file.         */
+	
+	if ((old = getname(path1)) == NULL)
+		return (curr_proc->errno);
+	
+	if ((new = getname(path2)) == NULL)
+	{
+		putname(old);
+		return (curr_proc->errno);
+	}
+	
+	oabs = nabs = NULL;
+	
+	if ((ret = rename_source(old, &oname, &dold, &src)) != 0)
+		goto out0;
+	
+	num = src->num;
+	onum = dold->num;
+	isdir = S_ISDIR(src->mode);
+	
+	/* Directory paths are needed to fix working directories. */
+	if (isdir)
+	{
+		oabs = abspath(old);
+		nabs = abspath(new);
+		
+		if ((oabs == NULL) || (nabs == NULL))
+		{
+			ret = -ENOTSUP;
+			goto out1;
+		}
+		
+		/* Moving a directory below itself. */
+		len = kstrlen(oabs);
+		if ((!kstrncmp(nabs, oabs, len)) && (nabs[len] == '/'))
+		{
+			ret = -EINVAL;
+			goto out1;
+		}
+	}
+	
+	if ((dnew = inode_dname(new, &nname)) == NULL)
+	{
+		ret = curr_proc->errno;
+		goto out1;
+	}
+	
+	/* Invalid file name. */
+	if (badname(nname))
+	{
+		ret = -EINVAL;
+		goto out2;
+	}
+	
+	/* Cross-device rename. */
+	if (dnew->dev != src->dev)
+	{
+		ret = -EXDEV;
+		goto out2;
+	}
+	
+	/* Not allowed to write in new parent directory. */
+	if (!permission(dnew->mode, dnew->uid, dnew->gid, curr_proc, MAY_WRITE, 0))
+	{
+		ret = -EACCES;
+		goto out2;
+	}
+	
+	dnum = dnew->num;
+	moved = (dnum != onum);
+	nnum = dir_search(dnew, nname);
+	
+	/* Same file. */
+	if (nnum == num)
+	{
+		ret = 0;
+		goto out2;
+	}
+	
+	/* Replace existing file. */
+	if (nnum != INODE_NULL)
+	{
+		if ((tgt = inode_get(dnew->dev, nnum)) == NULL)
+		{
+			ret = -ENFILE;
+			goto out2;
+		}
+		
+		/* Directories are not replaced. */
+		if ((isdir) || (S_ISDIR(tgt->mode)))
+		{
+			ret = (isdir) ? ((S_ISDIR(tgt->mode)) ? -EEXIST : -ENOTDIR) : -EISDIR;
+			inode_put(tgt);
+			goto out2;
+		}
+		
+		if ((ret = dir_set(dnew, nname, nnum, num)) != 0)
+		{
+			inode_put(tgt);
+			goto out2;
+		}
+		
+		tgt->nlinks--;
+		inode_touch(tgt);
+		inode_put(tgt);
+	}
+	
+	/* Rename entry in place. */
+	else if ((!moved) && (dir_rename(dnew, oname, num, nname) == 0))
+	{
+		inode_put(dnew);
+		inode_lock(dold);
+		goto out3;
+	}
+	
+	/* Add new name. */
+	else
+	{
+		/* Too many links to new parent directory. */
+		if ((isdir) && (moved) && (dnew->nlinks >= LINK_MAX))
+		{
+			ret = -EMLINK;
+			goto out2;
+		}
+		
+		if (dir_add(dnew, src, nname))
+		{
+			ret = -ENOSPC;
+			goto out2;
+		}
+	}
+	
+	/* Directory gets a new parent. */
+	if ((isdir) && (moved))
+	{
+		dnew->nlinks++;
+		inode_touch(dnew);
+	}
+	
+	inode_put(dnew);
+	
+	/* Remove old name. */
+	inode_lock(dold);
+	dir_set(dold, oname, num, INODE_NULL);
+	if ((isdir) && (moved))
+	{
+		dold->nlinks--;
+		inode_touch(dold);
+	}
+	
+	/* Fix parent directory entry. */
+	if ((isdir) && (moved))
+	{
+		inode_lock(src);
+		dir_set(src, "..", onum, dnum);
+		inode_unlock(src);
+	}
+
+out3:
+	inode_put(dold);
+	inode_lock(src);
+	inode_put(src);
+	
+	if (isdir)
+		cwd_rename(oabs, nabs);
+	
+	ret = 0;
+	goto out0;
+
+out2:
+	inode_put(dnew);
+out1:
+	inode_lock(src);
+	inode_put(src);
+	inode_lock(dold);
+	inode_put(dold);
+out0:
+	if (nabs != NULL)
+		putname(nabs);
+	if (oabs != NULL)
+		putname(oabs);
+	putname(new);
+	putname(old);
+	return (ret);
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/hal.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include <errno.h>
+#include <sched.h>
+
+/**
+ * @brief Sets the scheduling policy and parameters of a process.
+ * 
+ * @details Sets the scheduling policy of the process whose ID is @p pid,
+ *          or of the calling process if @p pid is zero, to @p policy, with
+ *          the real-time priority found in the buffer pointed to by
+ *          @p param. Only the superuser may pick a real-time policy.
+ * 
+ * @param pid    ID of the target process.
+ * @param policy Scheduling policy (SCHED_OTHER, SCHED_FIFO or SCHED_RR).
+ * @param param  Scheduling parameters.
+ * 
+ * @returns Upon successful completion, the former scheduling policy of the
+ *          target process is returned. Upon failure, a negative error number
+ *          is returned instead.
+ */
+PUBLIC int sys_sched_setscheduler(pid_t pid, int policy, const struct sched_param *param)
+{
+	int old;           /* Former policy.   */
+	int rtprio;        /* Priority.        */
+	struct process *p; /* Target process.  */
+	
+	/* Invalid buffer. */
+	if (!chkmem(param, sizeof(struct sched_param), MAY_READ))
+		return (-EINVAL);
+	
+	rtprio = param->sched_priority;
+	
+	/* Invalid policy or priority. */
+	if (policy == SCHED_OTHER)
+	{
+		if (rtprio != 0)
+			return (-EINVAL);
+	}
+	else if ((policy == SCHED_FIFO) || (policy == SCHED_RR))
+	{
+		if ((rtprio < SCHED_RTPRIO_MIN) || (rtprio > SCHED_RTPRIO_MAX))
+			return (-EINVAL);
+	}
+	else
+		return (-EINVAL);
+	
+	/* Get target process. */
+	if (pid < 0)
+		return (-EINVAL);
+	if ((p = (pid == 0) ? curr_proc : getproc(pid)) == NULL)
+		return (-ESRCH);
+	
+	/* Not authorized. */
+	if ((p == IDLE) || (!IS_SUPERUSER(curr_proc) && (p->uid != curr_proc->euid)))
+		return (-EPERM);
+	if ((policy != SCHED_OTHER) && (!IS_SUPERUSER(curr_proc)))
+		return (-EPERM);
+	
+	old = p->policy;
+	
+	disable_interrupts();
+	sched_setpolicy(p, policy, rtprio);
+	enable_interrupts();
+	
+	return (old);
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/hal.h>
+#include <nanvix/pm.h>
+#include <nanvix/sem.h>
+#include <sys/sem.h>
+#include <errno.h>
+
+/*
+ * Controls a semaphore.
+ */
+PUBLIC int sys_semctl(int semid, int cmd, int val)
+{
+	int ret;
+	struct semaphore *sem;
+	
+	ret = 0;
+	
+	disable_interrupts();
+	
+	/* Invalid semaphore. */
+	if ((sem = sem_get(semid)) == NULL)
+	{
+		ret = -EINVAL;
+		goto out;
+	}
+	
+	switch (cmd)
+	{
+		/* Get value. */
+		case GETVAL:
+			ret = sem->value;
+			break;
+		
+		/* Set value. */
+		case SETVAL:
+			if (val < 0)
+			{
+				ret = -EINVAL;
+				break;
+			}
+			
+			sem->value = val;
+			if (val == 0)
+				wakeup(&sem->zchain);
+			else
+				wakeup_one(&sem->chain);
+			break;
+		
+		/* Destroy semaphore. */
+		case IPC_RMID:
+			sem_free(sem);
+			break;
+		
+		/* Invalid command. */
+		default:
+			ret = -EINVAL;
+			break;
+	}
+
+out:
+	enable_interrupts();
+	
+	return (ret);
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/hal.h>
+#include <nanvix/sem.h>
+#include <errno.h>
+
+/*
+ * Gets a semaphore.
+ */
+PUBLIC int sys_semget(unsigned key)
+{
+	int semid;
+	struct semaphore *sem;
+	
+	disable_interrupts();
+	
+	/* Create semaphore. */
+	if ((sem = sem_lookup(key)) == NULL)
+		sem = sem_alloc(key);
+	
+	semid = (sem != NULL) ? sem_id(sem) : -ENOSPC;
+	
+	enable_interrupts();
+	
+	return (semid);
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/hal.h>
+#include <nanvix/pm.h>
+#include <nanvix/sem.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+
+/*
+ * Operates on a semaphore.
+ */
+PUBLIC int sys_semop(int semid, int op)
+{
+	int ret;
+	unsigned seq;
+	struct semaphore *sem;
+	
+	ret = 0;
+	
+	disable_interrupts();
+	
+	/* Invalid semaphore. */
+	if ((sem = sem_get(semid)) == NULL)
+	{
+		ret = -EINVAL;
+		goto out;
+	}
+	
+	seq = sem->seq;
+	
+	/* Up. */
+	if (op > 0)
+	{
+		if (sem->value > INT_MAX - op)
+		{
+			ret = -ERANGE;
+			goto out;
+		}
+		
+		sem->value += op;
+		wakeup_one(&sem->chain);
+	}
+	
+	/* Down. */
+	else if (op < 0)
+	{
+		while (sem->value + op < 0)
+		{
+			/*
+			 * Still not enough for us, but maybe
+			 * for someone else waiting in line.
+			 */
+			if (sem->value > 0)
+				wakeup_one(&sem->chain);
+			
+			sleep_excl(&sem->chain, PRIO_USER);
+			
+			/* Semaphore was destroyed. */
+			if (sem->seq != seq)
+			{
+				ret = -EIDRM;
+				goto out;
+			}
+			
+			/* Awaken by signal. */
+			if (issig() != SIGNULL)
+			{
+				ret = -EINTR;
+				goto out;
+			}
+		}
+		
+		sem->value += op;
+		
+		/* Pass on what is left. */
+		if (sem->value == 0)
+			wakeup(&sem->zchain);
+		else
+			wakeup_one(&sem->chain);
+	}
+	
+	/* Wait for zero. */
+	else
+	{
+		while (sem->value != 0)
+		{
+			sleep(&sem->zchain, PRIO_USER);
+			
+			/* Semaphore was destroyed. */
+			if (sem->seq != seq)
+			{
+				ret = -EIDRM;
+				goto out;
+			}
+			
+			/* Awaken by signal. */
+			if (issig() != SIGNULL)
+			{
+				ret = -EINTR;
+				goto out;
+			}
+		}
+	}
+
+out:
+	enable_interrupts();
+	
+	return (ret);
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/fs.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <errno.h>
+
+/*
+ * Sends data through a kernel page.
+ */
+PRIVATE ssize_t sendpage(struct file *out, struct file *in, size_t n)
+{
+	char *page;    /* Bounce page.     */
+	size_t chunk;  /* Data chunk size. */
+	ssize_t nread; /* Bytes read.      */
+	ssize_t count; /* Bytes written.   */
+	ssize_t off;   /* Page offset.     */
+	ssize_t total; /* Bytes sent.      */
+	
+	if ((page = getkpg(0)) == NULL)
+		return (-ENOMEM);
+	
+	total = 0;
+	
+	/* Send data. */
+	while (n > 0)
+	{
+		chunk = (n < PAGE_SIZE) ? n : PAGE_SIZE;
+		
+		/* End of file or failed to read. */
+		if ((nread = do_read(in, page, chunk)) <= 0)
+		{
+			if ((nread < 0) && (total == 0))
+				total = nread;
+			break;
+		}
+		
+		/* Flush page. */
+		for (off = 0; off < nread; off += count)
+		{
+			count = do_write(out, page + off, nread - off);
+			
+			/* Failed to write. */
+			if (count <= 0)
+			{
+				total += off;
+				goto out;
+			}
+		}
+		
+		n -= nread;
+		total += nread;
+		
+		/* Do not wait for more data. */
+		if ((size_t)nread < chunk)
+			break;
+	}
+
+out:
+	putkpg(page);
+	return (total);
+}
+
+/*
+ * Sends data from a file to another file.
+ */
+PUBLIC ssize_t sys_sendfile(int out_fd, int in_fd, size_t n)
+{
+	ssize_t count;       /* Bytes sent.   */
+	struct file *in;     /* Input file.   */
+	struct file *out;    /* Output file.  */
+	struct inode *inode; /* Input inode.  */
+	
+	/* Invalid input file descriptor. */
+	if ((in_fd < 0) || (in_fd >= OPEN_MAX) || ((in = curr_proc->ofiles[in_fd]) == NULL))
+		return (-EBADF);
+	
+	/* Invalid output file descriptor. */
+	if ((out_fd < 0) || (out_fd >= OPEN_MAX) || ((out = curr_proc->ofiles[out_fd]) == NULL))
+		return (-EBADF);
+	
+	/* File not opened for reading. */
+	if (ACCMODE(in->oflag) == O_WRONLY)
+		return (-EBADF);
+	
+	/* File not opened for writing. */
+	if (ACCMODE(out->oflag) == O_RDONLY)
+		return (-EBADF);
+	
+	inode = in->inode;
+	
+	/* Cannot send a directory, nor a file to itself. */
+	if ((S_ISDIR(inode->mode)) || (inode == out->inode))
+		return (-EINVAL);
+	
+	/* Nothing to do. */
+	if (n == 0)
+		return (0);
+	
+	/* Regular file: send straight from the block buffer cache. */
+	if (S_ISREG(inode->mode))
+	{
+		count = file_send(inode, out, n, in->pos, file_readahead(in, n));
+		
+		if (count > 0)
+			in->pos += count;
+		
+		return (count);
+	}
+	
+	return (sendpage(out, in, n));
+}
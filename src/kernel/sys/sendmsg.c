@@ -0,0 +1,217 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/fs.h>
+#include <nanvix/mm.h>
+#include <nanvix/net.h>
+#include <nanvix/pm.h>
+#include <nanvix/socket.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+
+/*
+ * Takes references to files passed in a control message.
+ */
+PRIVATE int getrights(const struct msghdr *msg, struct rights **rp)
+{
+	int fd;               /* File descriptor.  */
+	unsigned i;           /* Loop index.       */
+	unsigned nfds;        /* Files in message. */
+	struct file *f;       /* File.             */
+	struct rights *r;     /* Files in flight.  */
+	struct cmsghdr *cmsg; /* Control message.  */
+	
+	*rp = NULL;
+	
+	/* No control data. */
+	if ((msg->msg_control == NULL) || (msg->msg_controllen == 0))
+		return (0);
+	
+	if (!chkmem(msg->msg_control, msg->msg_controllen, MAY_READ))
+		return (-EINVAL);
+	
+	for (cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL; cmsg = CMSG_NXTHDR(msg, cmsg))
+	{
+		/* Bad control message. */
+		if ((cmsg->cmsg_len < CMSG_LEN(0)) ||
+			(cmsg->cmsg_len > msg->msg_controllen -
+			((char *)cmsg - (char *)msg->msg_control)))
+			goto error;
+		
+		/* Unsupported control message. */
+		if ((cmsg->cmsg_level != SOL_SOCKET) || (cmsg->cmsg_type != SCM_RIGHTS))
+			goto error;
+		
+		nfds = (cmsg->cmsg_len - CMSG_LEN(0))/sizeof(int);
+		
+		/* Too many files. */
+		if (((r = *rp) != NULL) && (r->nfiles + nfds > SOCK_FDS_MAX))
+			goto error;
+		if (nfds > SOCK_FDS_MAX)
+			goto error;
+		
+		if ((r == NULL) && ((r = *rp = rights_alloc()) == NULL))
+		{
+			*rp = NULL;
+			return (-ENOMEM);
+		}
+		
+		for (i = 0; i < nfds; i++)
+		{
+			fd = ((int *)CMSG_DATA(cmsg))[i];
+			
+			/* Invalid file descriptor. */
+			if ((fd < 0) || (fd >= OPEN_MAX) ||
+				((f = curr_proc->ofiles[fd]) == NULL))
+			{
+				rights_free(r);
+				*rp = NULL;
+				return (-EBADF);
+			}
+			
+			f->count++;
+			r->files[r->nfiles++] = f;
+		}
+	}
+	
+	return (0);
+	
+error:
+	if (*rp != NULL)
+		rights_free(*rp);
+	*rp = NULL;
+	return (-EINVAL);
+}
+
+/*
+ * Sends a message through a socket.
+ */
+PUBLIC ssize_t sys_sendmsg(int fd, const struct msghdr *msg, int flags)
+{
+	int k;                    /* Loop index.       */
+	ssize_t ret;              /* Return value.     */
+	size_t total;             /* Bytes to send.    */
+	struct inode *ip;         /* Destination name. */
+	struct socket *so;        /* Socket.           */
+	struct socket *to;        /* Destination.      */
+	struct rights *r;         /* Files in flight.  */
+	char path[SOCK_PATH_MAX]; /* Destination path. */
+	
+	if ((so = socket_get(fd)) == NULL)
+		return (curr_proc->errno);
+	
+	/* Invalid message. */
+	if (!chkmem(msg, sizeof(struct msghdr), MAY_READ))
+		return (-EINVAL);
+	
+	/* Invalid vector count. */
+	if ((msg->msg_iovlen < 0) || (msg->msg_iovlen > IOV_MAX))
+		return (-EINVAL);
+	
+	/* Invalid vector. */
+	if ((msg->msg_iovlen > 0) &&
+		(!chkmem(msg->msg_iov, msg->msg_iovlen*sizeof(struct iovec), MAY_READ)))
+		return (-EINVAL);
+	
+	/* Check buffers. */
+	total = 0;
+	for (k = 0; k < msg->msg_iovlen; k++)
+	{
+		/* Too many bytes. */
+		if (msg->msg_iov[k].iov_len > SSIZE_MAX - total)
+			return (-EINVAL);
+		
+		/* Invalid buffer. */
+		if ((msg->msg_iov[k].iov_len > 0) &&
+			(!chkmem(msg->msg_iov[k].iov_base, msg->msg_iov[k].iov_len, MAY_READ)))
+			return (-EINVAL);
+		
+		total += msg->msg_iov[k].iov_len;
+	}
+	
+	if (curr_proc->ofiles[fd]->oflag & O_NONBLOCK)
+		flags |= MSG_DONTWAIT;
+	
+	if (so->domain == AF_INET)
+	{
+		/* Files can only be passed locally. */
+		if ((msg->msg_control != NULL) && (msg->msg_controllen > 0))
+			return (-EOPNOTSUPP);
+		
+		ret = inet_send(so, msg->msg_iov, msg->msg_iovlen, msg->msg_name,
+			msg->msg_namelen, flags);
+		
+		return ((ret < 0) ? curr_proc->errno : ret);
+	}
+	
+	/* Look up destination. */
+	ip = NULL;
+	to = NULL;
+	if (msg->msg_name != NULL)
+	{
+		/* Stream sockets have a fixed destination. */
+		if (so->type == SOCK_STREAM)
+			return ((so->flags & SOCKET_CONNECTED) ? -EISCONN : -EOPNOTSUPP);
+		
+		if ((ret = socket_path(msg->msg_name, msg->msg_namelen, path)) < 0)
+			return (ret);
+		
+		if ((ip = socket_lookup(path)) == NULL)
+			return (curr_proc->errno);
+		
+		/* Nobody bound. */
+		if ((to = ip->sock) == NULL)
+		{
+			ret = -ECONNREFUSED;
+			goto out;
+		}
+		
+		/* Wrong socket type. */
+		if (to->type != so->type)
+		{
+			ret = -EPROTOTYPE;
+			goto out;
+		}
+	}
+	
+	/* Bad control data. */
+	if ((ret = getrights(msg, &r)) < 0)
+		goto out;
+	
+	ret = socket_send(so, msg->msg_iov, msg->msg_iovlen, to, &r, flags);
+	
+	/* Files were not sent. */
+	if (r != NULL)
+		rights_free(r);
+	
+	/* Failed to send. */
+	if (ret < 0)
+		ret = curr_proc->errno;
+	
+out:
+	if (ip != NULL)
+	{
+		inode_lock(ip);
+		inode_put(ip);
+	}
+	
+	return (ret);
+}
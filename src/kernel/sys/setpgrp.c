@@ -30,7 +30,7 @@ PUBLIC pid_t sys_setpgrp()
 	/* Create a new session. */
 	if (!IS_LEADER(curr_proc))
 	{
-		curr_proc->pgrp = curr_proc;
+		setgrp(curr_proc, curr_proc);
 		curr_proc->tty = NULL_DEV;
 	}
 	
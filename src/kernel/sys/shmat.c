@@ -0,0 +1,77 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include <nanvix/region.h>
+#include <nanvix/shm.h>
+#include <errno.h>
+
+/*
+ * Attaches a shared memory segment.
+ */
+PUBLIC void *sys_shmat(int shmid)
+{
+	int i;                /* Loop index.             */
+	addr_t start;         /* Attaching address.      */
+	struct shm *shm;      /* Shared memory segment.  */
+	struct pregion *preg; /* Working process region. */
+	
+	/* Invalid segment. */
+	if ((shm = shm_get(shmid)) == NULL)
+		return ((void *)-EINVAL);
+	
+	/* Get a free mapping slot. */
+	for (i = 0; i < NR_MMAPS; i++)
+	{
+		if (MMAP(curr_proc, i)->reg == NULL)
+			goto found;
+	}
+	
+	return ((void *)-EMFILE);
+
+found:
+	
+	preg = MMAP(curr_proc, i);
+	start = UMMAP_ADDR + i*REGION_SIZE;
+	
+	lockreg(shm->reg);
+	
+	/* Failed to attach region. */
+	if (attachreg(curr_proc, preg, start, shm->reg))
+	{
+		unlockreg(shm->reg);
+		return ((void *)-ENOMEM);
+	}
+	
+	unlockreg(shm->reg);
+	
+	/* Lock future mappings. */
+	if (curr_proc->flags & (1 << PROC_MLOCK))
+	{
+		if (mlockreg(curr_proc, preg))
+		{
+			detachreg(curr_proc, preg);
+			return ((void *)-ENOMEM);
+		}
+	}
+	
+	return ((void *)start);
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/mm.h>
+#include <nanvix/region.h>
+#include <nanvix/shm.h>
+#include <sys/shm.h>
+#include <errno.h>
+
+/*
+ * Controls a shared memory segment.
+ */
+PUBLIC int sys_shmctl(int shmid, int cmd, struct shmid_ds *buf)
+{
+	struct shm *shm;
+	
+	/* Invalid segment. */
+	if ((shm = shm_get(shmid)) == NULL)
+		return (-EINVAL);
+	
+	switch (cmd)
+	{
+		/* Get segment information. */
+		case IPC_STAT:
+			if (!chkmem(buf, sizeof(struct shmid_ds), MAY_WRITE))
+				return (-EINVAL);
+			
+			buf->shm_segsz = shm->size;
+			buf->shm_nattch = shm->reg->count - 1;
+			return (0);
+		
+		/* Destroy segment. */
+		case IPC_RMID:
+			shm_free(shm);
+			return (0);
+	}
+	
+	return (-EINVAL);
+}
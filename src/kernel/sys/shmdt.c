@@ -0,0 +1,50 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include <nanvix/region.h>
+#include <errno.h>
+
+/*
+ * Detaches a shared memory segment.
+ */
+PUBLIC int sys_shmdt(const void *addr)
+{
+	struct pregion *preg; /* Working process region. */
+	
+	for (int i = 0; i < NR_MMAPS; i++)
+	{
+		preg = MMAP(curr_proc, i);
+		
+		/* Skip free slots and file mappings. */
+		if ((preg->reg == NULL) || (preg->reg->flags & REGION_MMAP))
+			continue;
+		
+		/* Found. */
+		if (preg->start == (addr_t)addr)
+		{
+			detachreg(curr_proc, preg);
+			return (0);
+		}
+	}
+	
+	return (-EINVAL);
+}
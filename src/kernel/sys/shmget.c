@@ -0,0 +1,52 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/pm.h>
+#include <nanvix/region.h>
+#include <nanvix/shm.h>
+#include <errno.h>
+
+/*
+ * Gets a shared memory segment.
+ */
+PUBLIC int sys_shmget(unsigned key, size_t size)
+{
+	struct shm *shm;
+	
+	/* Existing segment. */
+	if ((shm = shm_lookup(key)) != NULL)
+	{
+		/* Segment is too small. */
+		if (size > shm->size)
+			return (-EINVAL);
+		
+		return (shm_id(shm));
+	}
+	
+	/* Invalid size. */
+	if ((size == 0) || (size > REGION_SIZE))
+		return (-EINVAL);
+	
+	/* Create segment. */
+	if ((shm = shm_alloc(key, size)) == NULL)
+		return (-ENOSPC);
+	
+	return (shm_id(shm));
+}
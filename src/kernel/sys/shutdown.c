@@ -20,6 +20,7 @@
 #include <dev/tty.h>
 #include <nanvix/const.h>
 #include <nanvix/dev.h>
+#include <nanvix/fs.h>
 #include <nanvix/klib.h>
 #include <nanvix/pm.h>
 #include <nanvix/syscall.h>
@@ -41,6 +42,7 @@ PUBLIC int sys_shutdown(void)
 	kprintf("system is going to shutdown NOW");
 	kprintf("synchronizing data...");
 	sys_sync();
+	journal_clean();
 	kprintf("asking process to terminate...");
 	sys_kill(-1, SIGKILL);
 	
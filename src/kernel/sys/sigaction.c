@@ -0,0 +1,74 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/klib.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include <errno.h>
+#include <signal.h>
+
+/*
+ * Examines and changes a signal action.
+ */
+PUBLIC int sys_sigaction(int sig, const struct sigaction *act,
+	struct sigaction *oact, void (*restorer)(void))
+{
+	struct sigaction new; /* New action. */
+	
+	/* Invalid signal. */
+	if ((sig <= 0) || (sig >= NR_SIGNALS))
+		return (-EINVAL);
+	
+	/* Invalid buffers. */
+	if ((act != NULL) && (!chkmem(act, sizeof(struct sigaction), MAY_READ)))
+		return (-EFAULT);
+	if ((oact != NULL) && (!chkmem(oact, sizeof(struct sigaction), MAY_WRITE)))
+		return (-EFAULT);
+	
+	if (act != NULL)
+	{
+		kmemcpy(&new, act, sizeof(struct sigaction));
+		
+		/* Cannot be caught or ignored. */
+		if ((sig == SIGKILL) || (sig == SIGSTOP))
+			return (-EINVAL);
+	}
+	
+	if (oact != NULL)
+	{
+		oact->sa_handler = curr_proc->handlers[sig];
+		oact->sa_mask = curr_proc->sigmasks[sig];
+		oact->sa_flags = curr_proc->sigflags[sig];
+	}
+	
+	if (act != NULL)
+	{
+		curr_proc->restorer = restorer;
+		curr_proc->handlers[sig] = new.sa_handler;
+		curr_proc->sigmasks[sig] = new.sa_mask & ~SIG_UNBLOCKABLE;
+		curr_proc->sigflags[sig] = new.sa_flags & (SA_RESETHAND | SA_NODEFER);
+		
+		/* Discard pending signals that are now ignored. */
+		if (new.sa_handler == SIG_IGN)
+			curr_proc->received &= ~(1 << sig);
+	}
+	
+	return (0);
+}
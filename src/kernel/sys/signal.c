@@ -42,6 +42,8 @@ PUBLIC sighandler_t sys_signal
 	old_func = curr_proc->handlers[sig];
 	curr_proc->restorer = restorer;
 	curr_proc->handlers[sig] = func;
+	curr_proc->sigmasks[sig] = 0;
+	curr_proc->sigflags[sig] = SA_RESETHAND | SA_NODEFER;
 	
 	return (old_func);
 }
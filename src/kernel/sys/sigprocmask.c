@@ -0,0 +1,71 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include <errno.h>
+#include <signal.h>
+
+/*
+ * Examines and changes blocked signals.
+ */
+PUBLIC int sys_sigprocmask(int how, const sigset_t *set, sigset_t *oset)
+{
+	sigset_t mask; /* New mask. */
+	
+	/* Invalid buffers. */
+	if ((set != NULL) && (!chkmem(set, sizeof(sigset_t), MAY_READ)))
+		return (-EFAULT);
+	if ((oset != NULL) && (!chkmem(oset, sizeof(sigset_t), MAY_WRITE)))
+		return (-EFAULT);
+	
+	if (oset != NULL)
+		*oset = curr_proc->blocked;
+	
+	/* Nothing else to do. */
+	if (set == NULL)
+		return (0);
+	
+	switch (how)
+	{
+		case SIG_BLOCK:
+			mask = curr_proc->blocked | *set;
+			break;
+		
+		case SIG_UNBLOCK:
+			mask = curr_proc->blocked & ~(*set);
+			break;
+		
+		case SIG_SETMASK:
+			mask = *set;
+			break;
+		
+		default:
+			return (-EINVAL);
+	}
+	
+	/*
+	 * Signals that get unblocked and are
+	 * pending are delivered on the way out.
+	 */
+	curr_proc->blocked = mask & ~SIG_UNBLOCKABLE;
+	
+	return (0);
+}
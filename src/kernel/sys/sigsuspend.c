@@ -0,0 +1,61 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include <errno.h>
+#include <signal.h>
+
+/* Sleeping chain. */
+PRIVATE struct waitq chain = WAITQ_INITIALIZER;
+
+/*
+ * Waits for a signal with a given signal mask.
+ */
+PUBLIC int sys_sigsuspend(const sigset_t *mask)
+{
+	int sig;      /* Signal received. */
+	sigset_t old; /* Old mask.        */
+	
+	/* Invalid buffer. */
+	if (!chkmem(mask, sizeof(sigset_t), MAY_READ))
+		return (-EFAULT);
+	
+	old = curr_proc->blocked;
+	curr_proc->blocked = *mask & ~SIG_UNBLOCKABLE;
+	
+	/* Suspend process. */
+	while ((sig = issig()) == SIGNULL)
+		sleep(&chain, PRIO_USER);
+	
+	/*
+	 * The handler runs with the mask that we were asked
+	 * for. The old mask comes back once it returns.
+	 */
+	if ((curr_proc->handlers[sig] != SIG_DFL) && (curr_proc->handlers[sig] != SIG_IGN))
+	{
+		curr_proc->sigsaved = old;
+		curr_proc->flags |= (1 << PROC_SIGSUSP);
+	}
+	else
+		curr_proc->blocked = old;
+	
+	return (-EINTR);
+}
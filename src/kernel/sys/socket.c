@@ -0,0 +1,63 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/fs.h>
+#include <nanvix/net.h>
+#include <nanvix/pm.h>
+#include <nanvix/socket.h>
+#include <errno.h>
+
+/*
+ * Creates a socket.
+ */
+PUBLIC int sys_socket(int domain, int type, int protocol)
+{
+	int fd;            /* File descriptor. */
+	int ret;           /* Return value.    */
+	struct socket *so; /* Socket.          */
+	
+	/* Unsupported address family. */
+	if ((domain != AF_UNIX) && (domain != AF_INET))
+		return (-EAFNOSUPPORT);
+	
+	/* Unsupported socket type. */
+	if ((type != SOCK_STREAM) && (type != SOCK_DGRAM))
+		return (-EPROTOTYPE);
+	
+	/* Unsupported protocol. */
+	if ((domain == AF_UNIX) && (protocol != 0))
+		return (-EPROTONOSUPPORT);
+	
+	if ((so = socket_alloc(domain, type)) == NULL)
+		return (-ENOBUFS);
+	
+	/* Failed to attach protocol. */
+	if ((domain == AF_INET) && ((ret = inet_attach(so, protocol)) < 0))
+	{
+		socket_put(so);
+		return (ret);
+	}
+	
+	/* Failed to open file. */
+	if ((fd = socket_install(so)) < 0)
+		socket_put(so);
+	
+	return (fd);
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/fs.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include <nanvix/socket.h>
+#include <errno.h>
+
+/*
+ * Creates a pair of connected sockets.
+ */
+PUBLIC int sys_socketpair(int domain, int type, int protocol, int sv[2])
+{
+	int ret;              /* Return value.     */
+	int fd[2];            /* File descriptors. */
+	struct socket *so[2]; /* Sockets.          */
+	
+	/* Unsupported address family. */
+	if (domain != AF_UNIX)
+		return (-EAFNOSUPPORT);
+	
+	/* Unsupported socket type. */
+	if ((type != SOCK_STREAM) && (type != SOCK_DGRAM))
+		return (-EPROTOTYPE);
+	
+	/* Unsupported protocol. */
+	if (protocol != 0)
+		return (-EPROTONOSUPPORT);
+	
+	if (!chkmem(sv, 2*sizeof(int), MAY_WRITE))
+		return (-EINVAL);
+	
+	if ((so[0] = socket_alloc(AF_UNIX, type)) == NULL)
+		return (-ENOBUFS);
+	if ((so[1] = socket_alloc(AF_UNIX, type)) == NULL)
+	{
+		ret = -ENOBUFS;
+		goto error0;
+	}
+	
+	/* Failed to connect sockets. */
+	if ((ret = socket_pair(so[0], so[1])) < 0)
+		goto error1;
+	
+	/* Failed to open files. */
+	if ((ret = fd[0] = socket_install(so[0])) < 0)
+		goto error1;
+	if ((ret = fd[1] = socket_install(so[1])) < 0)
+	{
+		socket_put(so[1]);
+		do_close(fd[0]);
+		return (ret);
+	}
+	
+	sv[0] = fd[0];
+	sv[1] = fd[1];
+	
+	return (0);
+	
+error1:
+	socket_put(so[1]);
+error0:
+	socket_put(so[0]);
+	return (ret);
+}
@@ -20,26 +20,16 @@
 #include <nanvix/const.h>
 #include <nanvix/fs.h>
 #include <nanvix/mm.h>
+#include <nanvix/syscall.h>
 #include <sys/stat.h>
 #include <errno.h>
+#include <fcntl.h>
 
 /*
- * Gets file status.
+ * Fills in the status of a file.
  */
-PUBLIC int sys_stat(const char *path, struct stat *buf)
+PUBLIC void do_stat(struct inode *ip, struct stat *buf)
 {
-	struct inode *ip;
-	
-	/* Invalid buffer. */
-	if (!chkmem(buf, sizeof(struct stat), MAY_WRITE))
-		return (-EFAULT);
-	
-	ip = inode_name(path);
-	
-	/* Failed to get inode. */
-	if (ip == NULL)
-		return (curr_proc->errno);
-	
 	buf->st_dev = ip->dev;
 	buf->st_ino = ip->num;
 	buf->st_mode = ip->mode;
@@ -50,8 +40,12 @@ PUBLIC int sys_stat(const char *path, struct stat *buf)
 	buf->st_atime = ip->time;
 	buf->st_mtime = ip->time;
 	buf->st_ctime = ip->time;
-	
-	inode_put(ip);
-	
-	return (0);
+}
+
+/*
+ * Gets file status.
+ */
+PUBLIC int sys_stat(const char *path, struct stat *buf)
+{
+	return (sys_fstatat(AT_FDCWD, path, buf, 0));
 }
@@ -27,6 +27,7 @@ PUBLIC void sys_sync(void)
 {
 	inode_sync();
 	superblock_sync();
+	journal_sync(0);
 	
 	/*
 	 * This will cause all dirty buffers
@@ -72,5 +72,83 @@ PUBLIC void (*syscalls_table[NR_SYSCALLS])(void)  = {
 	(void (*)(void))&sys_times,
 	(void (*)(void))&sys_shutdown,
 	(void (*)(void))&sys_ps,
-	(void (*)(void))&sys_gticks
+	(void (*)(void))&sys_gticks,
+	(void (*)(void))&sys_semget,
+	(void (*)(void))&sys_semctl,
+	(void (*)(void))&sys_semop,
+	(void (*)(void))&sys_cachestat,
+	(void (*)(void))&sys_iostat,
+	(void (*)(void))&sys_sendfile,
+	(void (*)(void))&sys_readv,
+	(void (*)(void))&sys_writev,
+	(void (*)(void))&sys_pread,
+	(void (*)(void))&sys_pwrite,
+	(void (*)(void))&sys_fsync,
+	(void (*)(void))&sys_fdatasync,
+	(void (*)(void))&sys_mmap,
+	(void (*)(void))&sys_munmap,
+	(void (*)(void))&sys_getdents,
+	(void (*)(void))&sys_swapon,
+	(void (*)(void))&sys_vfork,
+	(void (*)(void))&sys_vmstat,
+	(void (*)(void))&sys_nanosleep,
+	(void (*)(void))&sys_futex,
+	(void (*)(void))&sys_shmget,
+	(void (*)(void))&sys_shmat,
+	(void (*)(void))&sys_shmdt,
+	(void (*)(void))&sys_shmctl,
+	(void (*)(void))&sys_clone,
+	(void (*)(void))&sys_mq_open,
+	(void (*)(void))&sys_mq_close,
+	(void (*)(void))&sys_mq_unlink,
+	(void (*)(void))&sys_mq_send,
+	(void (*)(void))&sys_mq_receive,
+	(void (*)(void))&sys_mq_setattr,
+	(void (*)(void))&sys_poll,
+	(void (*)(void))&sys_epoll_create,
+	(void (*)(void))&sys_epoll_ctl,
+	(void (*)(void))&sys_epoll_wait,
+	(void (*)(void))&sys_epoll_close,
+	(void (*)(void))&sys_io_uring_setup,
+	(void (*)(void))&sys_io_uring_enter,
+	(void (*)(void))&sys_io_uring_close,
+	(void (*)(void))&sys_multicall,
+	(void (*)(void))&sys_sigaction,
+	(void (*)(void))&sys_sigprocmask,
+	(void (*)(void))&sys_sigsuspend,
+	(void (*)(void))&sys_sigpending,
+	(void (*)(void))&sys_pmc_open,
+	(void (*)(void))&sys_pmc_read,
+	(void (*)(void))&sys_pmc_close,
+	(void (*)(void))&sys_sysstat,
+	(void (*)(void))&sys_wait4,
+	(void (*)(void))&sys_getrusage,
+	(void (*)(void))&sys_procstat,
+	(void (*)(void))&sys_getcwd,
+	(void (*)(void))&sys_fstat,
+	(void (*)(void))&sys_openat,
+	(void (*)(void))&sys_fstatat,
+	(void (*)(void))&sys_unlinkat,
+	(void (*)(void))&sys_mkdirat,
+	(void (*)(void))&sys_rename,
+	(void (*)(void))&sys_lockstat,
+	(void (*)(void))&sys_sched_setscheduler,
+	(void (*)(void))&sys_ioprio_set,
+	(void (*)(void))&sys_madvise,
+	(void (*)(void))&sys_posix_fadvise,
+	(void (*)(void))&sys_mlock,
+	(void (*)(void))&sys_munlock,
+	(void (*)(void))&sys_mlockall,
+	(void (*)(void))&sys_munlockall,
+	(void (*)(void))&sys_socket,
+	(void (*)(void))&sys_socketpair,
+	(void (*)(void))&sys_bind,
+	(void (*)(void))&sys_listen,
+	(void (*)(void))&sys_accept,
+	(void (*)(void))&sys_connect,
+	(void (*)(void))&sys_sendmsg,
+	(void (*)(void))&sys_recvmsg,
+	(void (*)(void))&sys_getitimer,
+	(void (*)(void))&sys_setitimer,
+	(void (*)(void))&sys_profil
 };
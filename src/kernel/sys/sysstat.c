@@ -0,0 +1,188 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/clock.h>
+#include <nanvix/const.h>
+#include <nanvix/hal.h>
+#include <nanvix/klib.h>
+#include <nanvix/mm.h>
+#include <nanvix/pm.h>
+#include <nanvix/syscall.h>
+#include <sys/sysstat.h>
+#include <errno.h>
+#include <stdint.h>
+
+/* Error checking. */
+#if (NR_SYSCALLS > SYSSTAT_CALLS)
+	#error "SYSSTAT_CALLS is too small"
+#endif
+
+/**
+ * @brief System call handler.
+ */
+typedef int (*syscall_t)(unsigned, unsigned, unsigned, unsigned, unsigned);
+
+/**
+ * @brief Are system calls being accounted?
+ */
+PUBLIC int sysstat_on = 0;
+
+/**
+ * @brief System-wide statistics.
+ */
+PRIVATE struct
+{
+	unsigned count[NR_SYSCALLS];                 /**< Calls.         */
+	uint64_t cycles[NR_SYSCALLS];                /**< Total latency. */
+	unsigned hist[NR_SYSCALLS][SYSSTAT_BUCKETS]; /**< Histograms.    */
+} stats;
+
+/**
+ * @brief Per-process statistics.
+ */
+PRIVATE struct
+{
+	unsigned count[NR_SYSCALLS];  /**< Calls.         */
+	uint64_t cycles[NR_SYSCALLS]; /**< Total latency. */
+} pstats[PROC_MAX];
+
+/**
+ * @brief Does a system call and accounts for it.
+ * 
+ * @details Called from the system call hook instead of the system call
+ *          itself, while accounting is on. Latency is measured with the
+ *          time stamp counter and accounted both to the calling process
+ *          and system-wide, so it includes time spent sleeping.
+ * 
+ * @param nr System call number.
+ * 
+ * @returns The return value of the system call.
+ */
+PUBLIC int syscall_timed
+(unsigned nr, unsigned a, unsigned b, unsigned c, unsigned d, unsigned e)
+{
+	int ret;        /* Return value.     */
+	unsigned i;     /* Histogram bucket. */
+	unsigned delta; /* Latency.          */
+	uint64_t t0;    /* Start time.       */
+	uint64_t t;     /* Elapsed time.     */
+	
+	t0 = clock_cycles();
+	ret = ((syscall_t)syscalls_table[nr])(a, b, c, d, e);
+	t = clock_cycles() - t0;
+	
+	delta = (t >> 32) ? 0xffffffff : (unsigned)t;
+	i = (delta == 0) ? 0 : 31 - __builtin_clz(delta);
+	
+	stats.count[nr]++;
+	stats.cycles[nr] += t;
+	stats.hist[nr][i]++;
+	pstats[curr_proc - proctab].count[nr]++;
+	pstats[curr_proc - proctab].cycles[nr] += t;
+	
+	return (ret);
+}
+
+/**
+ * @brief Clears the system call statistics of a process.
+ * 
+ * @param proc Target process.
+ */
+PUBLIC void sysstat_release(struct process *proc)
+{
+	kmemset(&pstats[proc - proctab], 0, sizeof(pstats[0]));
+}
+
+/**
+ * @brief Gets or controls system call statistics.
+ * 
+ * @param cmd Command.
+ * @param pid Target process, or zero for system-wide statistics.
+ * @param buf Location where statistics shall be stored.
+ * 
+ * @returns Upon successful completion, zero is returned. Upon failure, a 
+ *          negative error number is returned instead.
+ */
+PUBLIC int sys_sysstat(int cmd, pid_t pid, struct sysstat *buf)
+{
+	unsigned i;        /* Loop index.     */
+	struct process *p; /* Target process. */
+	
+	switch (cmd)
+	{
+		/* Control accounting. */
+		case SYSSTAT_ON:
+		case SYSSTAT_OFF:
+		case SYSSTAT_RESET:
+			if (!IS_SUPERUSER(curr_proc))
+				return (-EPERM);
+			if (cmd == SYSSTAT_RESET)
+			{
+				kmemset(&stats, 0, sizeof(stats));
+				kmemset(pstats, 0, sizeof(pstats));
+			}
+			else
+				sysstat_on = (cmd == SYSSTAT_ON);
+			return (0);
+		
+		case SYSSTAT_GET:
+			break;
+		
+		default:
+			return (-EINVAL);
+	}
+	
+	/* Valid buffer. */
+	if (!chkmem(buf, sizeof(struct sysstat), MAY_WRITE))
+		return (-EINVAL);
+	
+	kmemset(buf, 0, sizeof(struct sysstat));
+	buf->on = sysstat_on;
+	buf->rate = clock_rate();
+	
+	/* System-wide statistics. */
+	if (pid == 0)
+	{
+		for (i = 0; i < NR_SYSCALLS; i++)
+		{
+			buf->count[i] = stats.count[i];
+			buf->cycles[i] = stats.cycles[i];
+			kmemcpy(buf->hist[i], stats.hist[i], sizeof(stats.hist[i]));
+		}
+		
+		return (0);
+	}
+	
+	/* Per-process statistics. */
+	for (p = FIRST_PROC; p <= LAST_PROC; p++)
+	{
+		if ((!IS_VALID(p)) || (p->pid != pid))
+			continue;
+		
+		for (i = 0; i < NR_SYSCALLS; i++)
+		{
+			buf->count[i] = pstats[p - proctab].count[i];
+			buf->cycles[i] = pstats[p - proctab].cycles[i];
+		}
+		
+		return (0);
+	}
+	
+	return (-ESRCH);
+}
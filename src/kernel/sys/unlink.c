@@ -21,21 +21,39 @@
 #include <nanvix/const.h>
 #include <nanvix/klib.h>
 #include <nanvix/fs.h>
+#include <nanvix/pm.h>
 #include <errno.h>
+#include <fcntl.h>
 
 /*
- * Removes a directory entry.
+ * Removes a directory entry relative to a directory.
  */
-PUBLIC int sys_unlink(const char *path)
+PUBLIC int sys_unlinkat(int dirfd, const char *path, int flag)
 {
 	int ret;              /* Return value.      */
+	int isdir;            /* Directory?         */
+	ino_t num;            /* Entry inode.       */
+	struct inode *file;   /* Entry.             */
+	struct inode *start;  /* Lookup directory.  */
 	struct inode *dir;    /* Working directory. */
 	const char *filename; /* Working file name. */
 	char *pathname;       /* Path name.         */
 	
-	pathname = getname(path);
+	/* Invalid flags. */
+	if (flag & ~AT_REMOVEDIR)
+		return (-EINVAL);
 	
-	dir = inode_dname(pathname, &filename);
+	if ((pathname = getname(path)) == NULL)
+		return (curr_proc->errno);
+	
+	/* Bad directory. */
+	if ((start = getdirfd(dirfd, pathname)) == NULL)
+	{
+		putname(pathname);
+		return (curr_proc->errno);
+	}
+	
+	dir = inode_dname_at(start, pathname, &filename);
 	
 	/* Failed to get directory. */
 	if (dir == NULL)
@@ -51,6 +69,26 @@ PUBLIC int sys_unlink(const char *path)
 		putname(pathname);
 		return (-EPERM);
 	}
+	
+	/* Only remove directories when asked to. */
+	if (flag & AT_REMOVEDIR)
+	{
+		num = dir_search(dir, filename);
+		
+		if ((num != INODE_NULL) && (num != dir->num) &&
+			((file = inode_get(dir->dev, num)) != NULL))
+		{
+			isdir = S_ISDIR(file->mode);
+			inode_put(file);
+			
+			if (!isdir)
+			{
+				inode_put(dir);
+				putname(pathname);
+				return (-ENOTDIR);
+			}
+		}
+	}
 
 	ret = dir_remove(dir, filename);
 	
@@ -59,3 +97,11 @@ PUBLIC int sys_unlink(const char *path)
 	
 	return (ret);
 }
+
+/*
+ * Removes a directory entry.
+ */
+PUBLIC int sys_unlink(const char *path)
+{
+	return (sys_unlinkat(AT_FDCWD, path, 0));
+}
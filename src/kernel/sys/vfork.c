@@ -0,0 +1,76 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/pm.h>
+#include <nanvix/syscall.h>
+#include <sys/types.h>
+#include <signal.h>
+
+/* Sleeping chain. */
+PRIVATE struct waitq chain = WAITQ_INITIALIZER;
+
+/*
+ * Releases the father of a vfork() child.
+ */
+PUBLIC void vfrelease(void)
+{
+	/* Not a vfork() child. */
+	if (!(curr_proc->flags & (1 << PROC_VFORK)))
+		return;
+	
+	curr_proc->flags &= ~(1 << PROC_VFORK);
+	wakeup(&chain);
+}
+
+/*
+ * Creates a new process and suspends the caller.
+ */
+PUBLIC pid_t sys_vfork(void)
+{
+	int sig;              /* Pending signal. */
+	pid_t pid;            /* Child ID.       */
+	struct process *proc; /* Child process.  */
+	
+	/*
+	 * The child gets its own copy on write address space,
+	 * which is cheap since page tables are shared lazily.
+	 * We still suspend the father, so the child runs first
+	 * and the father does not dirty the shared page tables.
+	 */
+	if ((pid = sys_fork()) < 0)
+		return (pid);
+	
+	proc = getproc(pid);
+	
+	proc->flags |= 1 << PROC_VFORK;
+	
+	/* Wait for the child to call execve() or _exit(). */
+	while ((proc->pid == pid) && (proc->flags & (1 << PROC_VFORK)))
+	{
+		sleep(&chain, PRIO_USER);
+		sig = issig();
+		
+		/* Stop waiting on signal. */
+		if ((sig != SIGNULL) && (sig != SIGCHLD))
+			break;
+	}
+	
+	return (pid);
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/const.h>
+#include <nanvix/klib.h>
+#include <nanvix/mm.h>
+#include <nanvix/region.h>
+#include <sys/vmstat.h>
+#include <errno.h>
+
+/**
+ * @brief Gets virtual memory statistics.
+ * 
+ * @param buf Location where statistics shall be stored.
+ * 
+ * @returns Upon successful completion, zero is returned. Upon failure, a 
+ *          negative error number is returned instead.
+ */
+PUBLIC int sys_vmstat(struct vmstat *buf)
+{
+	/* Valid buffer. */
+	if (!chkmem(buf, sizeof(struct vmstat), MAY_WRITE))
+		return (-EINVAL);
+	
+	kmemset(buf, 0, sizeof(struct vmstat));
+	pgvmstat(buf);
+	regstat(buf);
+	
+	return (0);
+}
@@ -20,24 +20,73 @@
 #include <nanvix/const.h>
 #include <nanvix/mm.h>
 #include <nanvix/pm.h>
+#include <nanvix/syscall.h>
+#include <sys/resource.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <errno.h>
 
 /* Sleeping chain. */
-PRIVATE struct process *chain = NULL;
+PRIVATE struct waitq chain = WAITQ_INITIALIZER;
 
 /*
- * Waits for a child process to terminate.
+ * Asserts if a child process is waited for.
  */
-PUBLIC pid_t sys_wait(int *stat_loc)
+PRIVATE int waited(struct process *p, pid_t pid)
+{
+	if (pid == -1)
+		return (1);
+	else if (pid > 0)
+		return (p->pid == pid);
+	else if (pid == 0)
+		return (p->pgrp == curr_proc->pgrp);
+	
+	return (p->pgrp->pid == -pid);
+}
+
+/*
+ * Adds the resource usage of a child and its waited-for children.
+ */
+PRIVATE void collect(struct process *p)
+{
+	unsigned maxrss;
+	
+	curr_proc->cutime += p->utime + p->cutime;
+	curr_proc->cktime += p->ktime + p->cktime;
+	curr_proc->cminflt += p->minflt + p->cminflt;
+	curr_proc->cmajflt += p->majflt + p->cmajflt;
+	curr_proc->cnvcsw += p->nvcsw + p->cnvcsw;
+	curr_proc->cnivcsw += p->nivcsw + p->cnivcsw;
+	curr_proc->cinblock += p->inblock + p->cinblock;
+	curr_proc->coublock += p->oublock + p->coublock;
+	curr_proc->cnsyscall += p->nsyscall + p->cnsyscall;
+	
+	maxrss = (p->maxrss > p->cmaxrss) ? p->maxrss : p->cmaxrss;
+	if (maxrss > curr_proc->cmaxrss)
+		curr_proc->cmaxrss = maxrss;
+}
+
+/*
+ * Waits for a child process to stop or terminate.
+ */
+PUBLIC pid_t sys_wait4(pid_t pid, int *stat_loc, int options, struct rusage *r_usage)
 {
 	int sig;
-	pid_t pid;
+	int found;
+	pid_t ret;
 	struct process *p;
 
 	/* Has no permissions to write at stat_loc. */
 	if ((stat_loc != NULL) && (!chkmem(stat_loc, sizeof(int), MAY_WRITE)))
 		return (-EINVAL);
+	
+	/* Has no permissions to write at r_usage. */
+	if ((r_usage != NULL) && (!chkmem(r_usage, sizeof(struct rusage), MAY_WRITE)))
+		return (-EINVAL);
+	
+	/* Invalid options. */
+	if (options & ~(WNOHANG | WUNTRACED))
+		return (-EINVAL);
 
 repeat:
 
@@ -46,53 +95,66 @@ repeat:
 		return (-ECHILD);
 
 	/* Look for child processes. */
-	for (p = FIRST_PROC; p <= LAST_PROC; p++)
+	found = 0;
+	for (p = curr_proc->children; p != NULL; p = p->sibling)
 	{
-		/* Skip invalid processes. */
-		if (!IS_VALID(p))
+		if (!waited(p, pid))
 			continue;
+		
+		found = 1;
+		
+		/* Stopped. */
+		if (p->state == PROC_STOPPED)
+		{
+			/* Already reported, or not asked for. */
+			if ((p->status) || !(options & WUNTRACED))
+				continue;
+			
+			p->status = 1 << 10;
+			
+			/* Get exit code. */
+			if (stat_loc != NULL)
+				*stat_loc = p->status;
+			
+			/* Get resource usage. */
+			if (r_usage != NULL)
+				do_rusage(p, RUSAGE_BOTH, r_usage);
 			
-		 /* Found. */
-		if (p->father == curr_proc)
+			return (p->pid);
+		}
+		
+		/* Terminated. */
+		else if (p->state == PROC_ZOMBIE)
 		{
-			/* Stopped. */
-			if (p->state == PROC_STOPPED)
-			{
-				/* Already reported. */
-				if (p->status)
-					continue;
-				
-				p->status = 1 << 10;
-				
-				/* Get exit code. */
-				if (stat_loc != NULL)
-					*stat_loc = p->status;
-				
-				return (p->pid);
-			}
+			/* Get exit code. */
+			if (stat_loc != NULL)
+				*stat_loc = p->status;
+			
+			/* 
+			 * Get information from child
+			 * process before burying it.
+			 */
+			ret = p->pid;
+			collect(p);
 			
-			/* Terminated. */
-			else if (p->state == PROC_ZOMBIE)
-			{
-				/* Get exit code. */
-				if (stat_loc != NULL)
-					*stat_loc = p->status;
-				
-				/* 
-				 * Get information from child
-				 * process before burying it.
-				 */
-				pid = p->pid;
-				curr_proc->cutime += p->utime;
-				curr_proc->cktime += p->ktime;
+			/* Get resource usage. */
+			if (r_usage != NULL)
+				do_rusage(p, RUSAGE_BOTH, r_usage);
 
-				/* Bury child process. */
-				bury(p);
-				
-				return (pid);
-			}
+			/* Bury child process. */
+			bury(p);
+			
+			return (ret);
 		}
 	}
+	
+	/* No such child. */
+	if (!found)
+		return (-ECHILD);
+	
+	/* Do not block. */
+	if (options & WNOHANG)
+		return (0);
 
 	sleep(&chain, PRIO_USER);
 	sig = issig();
@@ -103,3 +165,11 @@ repeat:
 		
 	return (-EINTR);
 }
+
+/*
+ * Waits for a child process to terminate.
+ */
+PUBLIC pid_t sys_wait(int *stat_loc)
+{
+	return (sys_wait4(-1, stat_loc, WUNTRACED, NULL));
+}
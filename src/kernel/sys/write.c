@@ -23,50 +23,34 @@
 #include <nanvix/fs.h>
 #include <nanvix/klib.h>
 #include <nanvix/mm.h>
+#include <nanvix/socket.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
 #include <errno.h>
 #include <nanvix/klib.h>
 /*
- * Writes to a file.
+ * Writes to an open file at a given offset.
  */
-PUBLIC ssize_t sys_write(int fd, const void *buf, size_t n)
+PRIVATE ssize_t do_writeat(struct file *f, const void *buf, size_t n, off_t off)
 {
 	dev_t dev;         /* Device number.          */
-	struct file *f;    /* File.                   */
 	struct inode *i;   /* Inode.                  */
 	ssize_t count = 0; /* Bytes actually written. */
-	
-	/* Invalid file descriptor. */
-	if ((fd < 0) || (fd >= OPEN_MAX) || ((f = curr_proc->ofiles[fd]) == NULL))
-		return (-EBADF);
-	
-	/* File not opened for writing. */
-	if (ACCMODE(f->oflag) == O_RDONLY)
-		return (-EBADF);
-
-#if (EDUCATIONAL_KERNEL == 0)
-	
-	/* Invalid buffer. */
-	if (!chkmem(buf, n, MAY_READ))
-		return (-EINVAL);
-	
-#endif
-
-	/* Nothing to do. */
-	if (n == 0)
-		return (0);
 
 	i = f->inode;
 	
-	/* Append mode. */
-	if (f->oflag & O_APPEND)
-		f->pos = i->size;
-	
 	/* Character special file. */
 	if (S_ISCHR(i->mode))
 	{
 		dev = i->blocks[0];
+		
+		/* Would block. */
+		if ((f->oflag & O_NONBLOCK) && (!(cdev_poll(dev) & POLLOUT)))
+			return (-EAGAIN);
+		
 		count = cdev_write(dev, buf, n);
 		return (count);
 	}
@@ -75,25 +59,205 @@ PUBLIC ssize_t sys_write(int fd, const void *buf, size_t n)
 	else if (S_ISBLK(i->mode))
 	{
 		dev = i->blocks[0];
-		count = bdev_write(dev, buf, n, f->pos);
+		count = bdev_write(dev, buf, n, off);
+		
+#if (BCACHE)
+		/* Written raw, so demoted copies go stale. */
+		for (off_t o = off & ~(BLOCK_SIZE - 1); o < off + count; o += BLOCK_SIZE)
+			bcache_invalidate(dev, o >> BLOCK_SIZE_LOG2);
+#endif
 	}
 	
 	/* Pipe file. */
 	else if (S_ISFIFO(i->mode))
 	{
-		kprintf("write to pipe");
-		count = pipe_write(i, buf, n);
+		count = pipe_write(i, buf, n, f->oflag & O_NONBLOCK);
 	}
 	
+	/* Socket. */
+	else if (S_ISSOCK(i->mode))
+		count = socket_write(i, buf, n, f->oflag & O_NONBLOCK);
+	
+	/* Direct I/O. */
+	else if ((S_ISREG(i->mode)) && (f->oflag & O_DIRECT))
+		count = file_direct(i, (void *)buf, n, off, 1);
+	
 	/* Regular file. */
 	else if (S_ISREG(i->mode))
-		count = file_write(i, buf, n, f->pos);
+		count = file_write(i, buf, n, off);
 
 	/* Failed to write. */
 	if (count < 0)
 		return (curr_proc->errno);
 	
-	f->pos += count;
+	return (count);
+}
+
+/*
+ * Writes to an open file.
+ */
+PUBLIC ssize_t do_write(struct file *f, const void *buf, size_t n)
+{
+	ssize_t count; /* Bytes actually written. */
+	
+	/* Append mode. */
+	if (f->oflag & O_APPEND)
+		f->pos = f->inode->size;
+	
+	count = do_writeat(f, buf, n, f->pos);
+	
+	/* Character devices have no file offset. */
+	if ((count > 0) && (!S_ISCHR(f->inode->mode)))
+		f->pos += count;
+	
+	return (count);
+}
+
+/*
+ * Writes to an open file at a given offset.
+ */
+PUBLIC ssize_t do_pwrite(struct file *f, const void *buf, size_t n, off_t off)
+{
+	/* Pipes and sockets cannot seek. */
+	if ((S_ISFIFO(f->inode->mode)) || (S_ISSOCK(f->inode->mode)))
+		return (-ESPIPE);
+	
+	/* Invalid offset. */
+	if (off < 0)
+		return (-EINVAL);
+	
+	return (do_writeat(f, buf, n, off));
+}
+
+/*
+ * Gets a file that may be written.
+ */
+PRIVATE struct file *wrfile(int fd)
+{
+	struct file *f; /* File. */
+	
+	/* Invalid file descriptor. */
+	if ((fd < 0) || (fd >= OPEN_MAX) || ((f = curr_proc->ofiles[fd]) == NULL))
+		return (NULL);
+	
+	/* File not opened for writing. */
+	if (ACCMODE(f->oflag) == O_RDONLY)
+		return (NULL);
+	
+	return (f);
+}
+
+/*
+ * Writes to a file.
+ */
+PUBLIC ssize_t sys_write(int fd, const void *buf, size_t n)
+{
+	struct file *f; /* File. */
+	
+	if ((f = wrfile(fd)) == NULL)
+		return (-EBADF);
+
+#if (EDUCATIONAL_KERNEL == 0)
+	
+	/* Invalid buffer. */
+	if (!chkmem(buf, n, MAY_READ))
+		return (-EINVAL);
+	
+#endif
+
+	/* Nothing to do. */
+	if (n == 0)
+		return (0);
+
+	return (do_write(f, buf, n));
+}
+
+/*
+ * Writes to a file at a given offset.
+ */
+PUBLIC ssize_t sys_pwrite(int fd, const void *buf, size_t n, off_t off)
+{
+	struct file *f; /* File. */
+	
+	if ((f = wrfile(fd)) == NULL)
+		return (-EBADF);
+
+#if (EDUCATIONAL_KERNEL == 0)
+	
+	/* Invalid buffer. */
+	if (!chkmem(buf, n, MAY_READ))
+		return (-EINVAL);
+	
+#endif
+
+	/* Nothing to do. */
+	if (n == 0)
+		return (0);
+
+	return (do_pwrite(f, buf, n, off));
+}
+
+/*
+ * Writes to a file from multiple buffers.
+ */
+PUBLIC ssize_t sys_writev(int fd, const struct iovec *iov, int iovcnt)
+{
+	int k;          /* Loop index.              */
+	size_t total;   /* Bytes requested.         */
+	ssize_t count;  /* Bytes actually written.  */
+	ssize_t n;      /* Bytes written by buffer. */
+	struct file *f; /* File.                    */
+	
+	if ((f = wrfile(fd)) == NULL)
+		return (-EBADF);
+	
+	/* Invalid vector count. */
+	if ((iovcnt <= 0) || (iovcnt > IOV_MAX))
+		return (-EINVAL);
+	
+	/* Invalid vector. */
+	if (!chkmem(iov, iovcnt*sizeof(struct iovec), MAY_READ))
+		return (-EINVAL);
+	
+	/* Check buffers. */
+	total = 0;
+	for (k = 0; k < iovcnt; k++)
+	{
+		/* Too many bytes. */
+		if (iov[k].iov_len > SSIZE_MAX - total)
+			return (-EINVAL);
+		
+#if (EDUCATIONAL_KERNEL == 0)
+		
+		/* Invalid buffer. */
+		if (!chkmem(iov[k].iov_base, iov[k].iov_len, MAY_READ))
+			return (-EINVAL);
+		
+#endif
+		
+		total += iov[k].iov_len;
+	}
+	
+	/* Write data. */
+	count = 0;
+	for (k = 0; k < iovcnt; k++)
+	{
+		/* Skip empty buffers. */
+		if (iov[k].iov_len == 0)
+			continue;
+		
+		n = do_write(f, iov[k].iov_base, iov[k].iov_len);
+		
+		/* Failed to write. */
+		if (n < 0)
+			return ((count > 0) ? count : n);
+		
+		count += n;
+		
+		/* Short write. */
+		if ((size_t)n < iov[k].iov_len)
+			break;
+	}
 	
 	return (count);
 }
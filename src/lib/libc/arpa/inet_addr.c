@@ -0,0 +1,64 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+/*
+ * Converts an address in dotted decimal notation into an Internet address.
+ */
+in_addr_t inet_addr(const char *cp)
+{
+	int i;       /* Loop index.   */
+	unsigned n;  /* Working part. */
+	in_addr_t a; /* Address.      */
+	
+	a = 0;
+	
+	for (i = 0; i < 4; i++)
+	{
+		/* Not a number. */
+		if ((*cp < '0') || (*cp > '9'))
+			return (INADDR_NONE);
+		
+		for (n = 0; (*cp >= '0') && (*cp <= '9'); cp++)
+		{
+			n = n*10 + (*cp - '0');
+			
+			/* Too large. */
+			if (n > 255)
+				return (INADDR_NONE);
+		}
+		
+		a = (a << 8) | n;
+		
+		/* Parts are separated by dots. */
+		if (i < 3)
+		{
+			if (*cp++ != '.')
+				return (INADDR_NONE);
+		}
+	}
+	
+	/* Trailing garbage. */
+	if (*cp != '\0')
+		return (INADDR_NONE);
+	
+	return (htonl(a));
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+/*
+ * Converts an Internet address into dotted decimal notation. The
+ * string is overwritten by the next call.
+ */
+char *inet_ntoa(struct in_addr in)
+{
+	int i;                            /* Loop index.     */
+	char *p;                          /* Write pointer.  */
+	unsigned n;                       /* Working part.   */
+	uint32_t a;                       /* Address.        */
+	static char buf[INET_ADDRSTRLEN]; /* Dotted address. */
+	
+	a = ntohl(in.s_addr);
+	p = buf;
+	
+	for (i = 3; i >= 0; i--)
+	{
+		n = (a >> (i*8)) & 0xff;
+		
+		if (n >= 100)
+			*p++ = '0' + n/100;
+		if (n >= 10)
+			*p++ = '0' + (n/10)%10;
+		*p++ = '0' + n%10;
+		
+		*p++ = (i > 0) ? '.' : '\0';
+	}
+	
+	return (buf);
+}
@@ -20,11 +20,42 @@
 #include <stdlib.h>
 #include <unistd.h>
 
+/*
+ * Shared C library (only kept by lib/link-shared.ld).
+ */
+const char __interp[] __attribute__((section(".interp"))) = "/lib/libc.so";
+
 /*
  * Main routine.
  */
 extern int main(int argc, char **argv);
 
+/* System call entries. */
+extern void (*__syscall_entry)(void);
+extern void __syscall_sysenter(void);
+
+/*
+ * Selects the fastest system call entry.
+ */
+static void syscall_setup(void)
+{
+	unsigned eax, ebx, ecx, edx;
+	
+	__asm__ volatile (
+		"cpuid"
+		: "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
+		: "0" (1)
+	);
+	
+	/* SEP not supported (early Pentium Pro reports it wrongly). */
+	if (!((edx >> 11) & 1))
+		return;
+	if ((((eax >> 8) & 0xf) == 6) && (((eax >> 4) & 0xf) < 3) && ((eax & 0xf) < 3))
+		return;
+	
+	__syscall_entry = __syscall_sysenter;
+}
+
 /*
  * Entry point of the program.
  */
@@ -32,6 +63,8 @@ void _start(int argc, char **argv, char **envp)
 {
 	int ret;
 	
+	syscall_setup();
+	
 	environ = envp;
 	
 	ret= main(argc, argv);
@@ -17,19 +17,18 @@
  * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <nanvix/fs.h>
 #include <dirent.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
-#include <stdio.h>
 
 /*
  * Reads a directory.
  */
 struct dirent *readdir(DIR *dirp)
 {
-	struct dirent *buf; /* Buffer.         */
-	struct dirent *dp;  /* Working dirent. */
+	char *buf;      /* Buffer.        */
+	struct dent *e; /* Packed entry.  */
 	
 	/* End of directory. */
 	if (dirp->flags & _DIR_EOD)
@@ -37,14 +36,17 @@ struct dirent *readdir(DIR *dirp)
 	
 	do
 	{
-		/* Get next non-empty directory entry. */
-		while (--dirp->count >= 0)
+		/* Get next packed directory entry. */
+		if (dirp->count > 0)
 		{
-			dp = dirp->ptr++;
+			e = (struct dent *)dirp->ptr;
+			dirp->ptr += e->d_reclen;
+			dirp->count -= e->d_reclen;
 			
-			/* Found. */
-			if (dp->d_ino != INODE_NULL)
-				return (dp);
+			dirp->ent.d_ino = e->d_ino;
+			strncpy(dirp->ent.d_name, e->d_name, NAME_MAX);
+			
+			return (&dirp->ent);
 		}
 		
 		/* Allocate buffer. */
@@ -56,7 +58,8 @@ struct dirent *readdir(DIR *dirp)
 				return (NULL);
 		}
 		
-		dirp->count = read(dirp->fd, buf, _DIR_BUFSIZ)/sizeof(struct dirent);
+		/* Free slots are skipped by the kernel. */
+		dirp->count = getdents(dirp->fd, buf, _DIR_BUFSIZ);
 		
 		/* Reset buffer. */
 		dirp->ptr = buf;
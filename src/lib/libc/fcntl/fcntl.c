@@ -41,7 +41,7 @@ int fcntl(int fd, int cmd, ...)
 	}
 	
 	__asm__ volatile (
-		"int $0x80"
+		SYSCALL_TRAP
 		: "=a" (ret)
 		: "0" (NR_fcntl),
 		  "b" (fd),
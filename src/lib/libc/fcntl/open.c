@@ -41,7 +41,7 @@ int open(const char *path, int oflag, ...)
 	}
 	
 	__asm__ volatile (
-		"int $0x80"
+		SYSCALL_TRAP
 		: "=a" (ret)
 		: "0" (NR_open),
 		  "b" (path),
@@ -0,0 +1,63 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/syscall.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <mqueue.h>
+#include <stdarg.h>
+
+/*
+ * Opens a message queue.
+ */
+mqd_t mq_open(const char *name, int oflag, ...)
+{
+	mqd_t ret;            /* Return value.        */
+	struct mq_attr *attr; /* Queue attributes.    */
+	va_list arg;          /* Variable argument.   */
+	
+	attr = NULL;
+	
+	/* Creation mode is not used. */
+	if (oflag & O_CREAT)
+	{
+		va_start(arg, oflag);
+		(void) va_arg(arg, int);
+		attr = va_arg(arg, struct mq_attr *);
+		va_end(arg);
+	}
+	
+	__asm__ volatile (
+		SYSCALL_TRAP
+		: "=a" (ret)
+		: "0" (NR_mq_open),
+		  "b" (name),
+		  "c" (oflag),
+		  "d" (attr)
+	);
+	
+	/* Error. */
+	if (ret < 0)
+	{
+		errno = -ret;
+		return (-1);
+	}
+	
+	return (ret);
+}
@@ -0,0 +1,256 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <sys/wait.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+
+/*
+ * Thread table.
+ */
+static struct pthread threads[PTHREAD_MAX];
+
+/*
+ * Main thread.
+ */
+static struct pthread main_thread;
+
+/*
+ * Thread table lock.
+ */
+static mutex_t lock = MUTEX_INITIALIZER;
+
+/*
+ * Returns the thread that owns a stack address.
+ */
+static struct pthread *pthread_lookup(const char *sp)
+{
+	int i;
+	
+	for (i = 0; i < PTHREAD_MAX; i++)
+	{
+		if (threads[i].stack == NULL)
+			continue;
+		
+		if ((sp >= threads[i].stack) &&
+			(sp < threads[i].stack + PTHREAD_STACK_SIZE))
+			return (&threads[i]);
+	}
+	
+	return (&main_thread);
+}
+
+/*
+ * Thread entry point. The kernel drops the new thread here, on its own
+ * stack, so it finds its descriptor from the stack pointer itself.
+ */
+static void pthread_start(void)
+{
+	struct pthread *self;
+	char sp = 0;
+	
+	self = pthread_lookup(&sp);
+	self->retval = self->start(self->arg);
+	
+	_exit(0);
+}
+
+/*
+ * Creates a thread.
+ */
+int pthread_create(pthread_t *thread, const void *attr,
+	void *(*start)(void *), void *arg)
+{
+	int i;
+	char *sp;
+	pid_t tid;
+	char *stack;
+	struct pthread *t;
+	
+	((void) attr);
+	
+	if ((stack = malloc(PTHREAD_STACK_SIZE)) == NULL)
+		return (EAGAIN);
+	
+	mutex_lock(&lock);
+	
+	/* Get a free thread slot. */
+	for (i = 0; i < PTHREAD_MAX; i++)
+	{
+		if (threads[i].stack == NULL)
+			goto found;
+	}
+	
+	mutex_unlock(&lock);
+	free(stack);
+	return (EAGAIN);
+
+found:
+
+	t = &threads[i];
+	t->start = start;
+	t->arg = arg;
+	t->retval = NULL;
+	t->done = 0;
+	t->stack = stack;
+	
+	mutex_unlock(&lock);
+	
+	/* Fake return address for pthread_start(). */
+	sp = stack + PTHREAD_STACK_SIZE - sizeof(int);
+	*((int *)sp) = 0;
+	
+	if ((tid = clone(pthread_start, sp)) < 0)
+	{
+		mutex_lock(&lock);
+		t->stack = NULL;
+		mutex_unlock(&lock);
+		free(stack);
+		return (errno);
+	}
+	
+	t->tid = tid;
+	*thread = t;
+	
+	return (0);
+}
+
+/*
+ * Waits for a thread to terminate.
+ */
+int pthread_join(pthread_t thread, void **retval)
+{
+	int i;
+	pid_t pid;
+	int status;
+	char *stack;
+	
+	if ((thread == NULL) || (thread->stack == NULL))
+		return (ESRCH);
+	
+	if (thread == pthread_self())
+		return (EDEADLK);
+	
+	/*
+	 * Threads are children of their creator, so reap
+	 * them until the one that we are waiting for shows up.
+	 */
+	while (!thread->done)
+	{
+		if ((pid = wait(&status)) < 0)
+			return (ESRCH);
+		
+		mutex_lock(&lock);
+		for (i = 0; i < PTHREAD_MAX; i++)
+		{
+			if ((threads[i].stack != NULL) && (threads[i].tid == pid))
+				threads[i].done = 1;
+		}
+		mutex_unlock(&lock);
+	}
+	
+	if (retval != NULL)
+		*retval = thread->retval;
+	
+	/* Release thread slot. */
+	mutex_lock(&lock);
+	stack = thread->stack;
+	thread->stack = NULL;
+	mutex_unlock(&lock);
+	free(stack);
+	
+	return (0);
+}
+
+/*
+ * Terminates the calling thread.
+ */
+void pthread_exit(void *retval)
+{
+	struct pthread *self;
+	
+	self = pthread_self();
+	
+	/* Main thread. */
+	if (self == &main_thread)
+		exit(0);
+	
+	self->retval = retval;
+	_exit(0);
+}
+
+/*
+ * Returns the calling thread.
+ */
+pthread_t pthread_self(void)
+{
+	char sp = 0;
+	
+	return (pthread_lookup(&sp));
+}
+
+/*
+ * Initializes a mutex.
+ */
+int pthread_mutex_init(pthread_mutex_t *m, const void *attr)
+{
+	((void) attr);
+	
+	mutex_init(m);
+	
+	return (0);
+}
+
+/*
+ * Destroys a mutex.
+ */
+int pthread_mutex_destroy(pthread_mutex_t *m)
+{
+	return ((m->state != 0) ? EBUSY : 0);
+}
+
+/*
+ * Locks a mutex.
+ */
+int pthread_mutex_lock(pthread_mutex_t *m)
+{
+	mutex_lock(m);
+	
+	return (0);
+}
+
+/*
+ * Tries to lock a mutex.
+ */
+int pthread_mutex_trylock(pthread_mutex_t *m)
+{
+	return ((mutex_trylock(m) == 0) ? 0 : EBUSY);
+}
+
+/*
+ * Unlocks a mutex.
+ */
+int pthread_mutex_unlock(pthread_mutex_t *m)
+{
+	mutex_unlock(m);
+	
+	return (0);
+}
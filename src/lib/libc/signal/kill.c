@@ -29,7 +29,7 @@ int kill(pid_t pid, int sig)
 	int ret;
 	
 	__asm__ volatile (
-		"int $0x80"
+		SYSCALL_TRAP
 		: "=a" (ret)
 		: "0" (NR_kill),
 		  "b" (pid),
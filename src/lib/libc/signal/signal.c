@@ -33,7 +33,7 @@ sighandler_t signal(int sig, sighandler_t func)
 	sighandler_t ret;
 	
 	__asm__ volatile (
-		"int $0x80"
+		SYSCALL_TRAP
 		: "=a" (ret)
 		: "0" (NR_signal),
 		  "b" (sig),
@@ -0,0 +1,145 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <spawn.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Appends an action to a file action list.
+ */
+static struct spawn_action *addaction(posix_spawn_file_actions_t *fa)
+{
+	int max;                  /* New room.    */
+	struct spawn_action *act; /* New actions. */
+	
+	/* Grow list. */
+	if (fa->nactions == fa->maxactions)
+	{
+		max = (fa->maxactions == 0) ? 4 : 2*fa->maxactions;
+		act = realloc(fa->actions, max*sizeof(struct spawn_action));
+		if (act == NULL)
+			return (NULL);
+		fa->actions = act;
+		fa->maxactions = max;
+	}
+	
+	act = &fa->actions[fa->nactions++];
+	act->path = NULL;
+	
+	return (act);
+}
+
+/*
+ * Initializes a file action list.
+ */
+int posix_spawn_file_actions_init(posix_spawn_file_actions_t *fa)
+{
+	fa->nactions = 0;
+	fa->maxactions = 0;
+	fa->actions = NULL;
+	
+	return (0);
+}
+
+/*
+ * Destroys a file action list.
+ */
+int posix_spawn_file_actions_destroy(posix_spawn_file_actions_t *fa)
+{
+	int i;
+	
+	for (i = 0; i < fa->nactions; i++)
+		free(fa->actions[i].path);
+	free(fa->actions);
+	
+	return (posix_spawn_file_actions_init(fa));
+}
+
+/*
+ * Adds an open() action to a file action list.
+ */
+int posix_spawn_file_actions_addopen
+(posix_spawn_file_actions_t *fa, int fd, const char *path, int oflag, mode_t mode)
+{
+	char *p;                  /* Path name copy. */
+	struct spawn_action *act; /* New action.     */
+	
+	if (fd < 0)
+		return (EBADF);
+	
+	if ((p = malloc(strlen(path) + 1)) == NULL)
+		return (ENOMEM);
+	strcpy(p, path);
+	
+	if ((act = addaction(fa)) == NULL)
+	{
+		free(p);
+		return (ENOMEM);
+	}
+	
+	act->type = SPAWN_OPEN;
+	act->fd = fd;
+	act->oflag = oflag;
+	act->mode = mode;
+	act->path = p;
+	
+	return (0);
+}
+
+/*
+ * Adds a close() action to a file action list.
+ */
+int posix_spawn_file_actions_addclose(posix_spawn_file_actions_t *fa, int fd)
+{
+	struct spawn_action *act;
+	
+	if (fd < 0)
+		return (EBADF);
+	
+	if ((act = addaction(fa)) == NULL)
+		return (ENOMEM);
+	
+	act->type = SPAWN_CLOSE;
+	act->fd = fd;
+	
+	return (0);
+}
+
+/*
+ * Adds a dup2() action to a file action list.
+ */
+int posix_spawn_file_actions_adddup2
+(posix_spawn_file_actions_t *fa, int fd, int newfd)
+{
+	struct spawn_action *act;
+	
+	if ((fd < 0) || (newfd < 0))
+		return (EBADF);
+	
+	if ((act = addaction(fa)) == NULL)
+		return (ENOMEM);
+	
+	act->type = SPAWN_DUP2;
+	act->fd = fd;
+	act->newfd = newfd;
+	
+	return (0);
+}
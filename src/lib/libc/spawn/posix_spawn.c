@@ -0,0 +1,141 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <stddef.h>
+#include <unistd.h>
+
+/*
+ * Exit status of a child that failed to execute.
+ */
+#define SPAWN_FAILED 127
+
+/*
+ * Applies file actions and attributes in the child.
+ */
+static int spawnchild
+(const posix_spawn_file_actions_t *fa, const posix_spawnattr_t *attr)
+{
+	int i;                    /* Loop index.       */
+	int fd;                   /* File descriptor.  */
+	struct spawn_action *act; /* Working action.   */
+	
+	if (attr != NULL)
+	{
+		if (attr->flags & POSIX_SPAWN_SETPGROUP)
+			setpgrp();
+		
+		if (attr->flags & POSIX_SPAWN_RESETIDS)
+		{
+			if ((setgid(getgid()) < 0) || (setuid(getuid()) < 0))
+				return (-1);
+		}
+	}
+	
+	if (fa == NULL)
+		return (0);
+	
+	for (i = 0; i < fa->nactions; i++)
+	{
+		act = &fa->actions[i];
+		
+		switch (act->type)
+		{
+			case SPAWN_OPEN:
+				if ((fd = open(act->path, act->oflag, act->mode)) < 0)
+					return (-1);
+				if (fd != act->fd)
+				{
+					if (dup2(fd, act->fd) < 0)
+						return (-1);
+					close(fd);
+				}
+				break;
+			
+			case SPAWN_CLOSE:
+				close(act->fd);
+				break;
+			
+			case SPAWN_DUP2:
+				if (dup2(act->fd, act->newfd) < 0)
+					return (-1);
+				break;
+		}
+	}
+	
+	return (0);
+}
+
+/*
+ * Spawns a process.
+ */
+static int spawn
+(pid_t *pid, const char *file, const posix_spawn_file_actions_t *fa,
+ const posix_spawnattr_t *attr, char *const argv[], char *const envp[],
+ int search)
+{
+	pid_t child;
+	
+	if ((child = vfork()) < 0)
+		return (errno);
+	
+	/* Child process. */
+	if (child == 0)
+	{
+		if (spawnchild(fa, attr) == 0)
+		{
+			if (search)
+			{
+				environ = (char **)envp;
+				execvp(file, argv);
+			}
+			else
+				execve(file, argv, envp);
+		}
+		
+		_exit(SPAWN_FAILED);
+	}
+	
+	if (pid != NULL)
+		*pid = child;
+	
+	return (0);
+}
+
+/*
+ * Spawns a process.
+ */
+int posix_spawn
+(pid_t *pid, const char *path, const posix_spawn_file_actions_t *fa,
+ const posix_spawnattr_t *attr, char *const argv[], char *const envp[])
+{
+	return (spawn(pid, path, fa, attr, argv, envp, 0));
+}
+
+/*
+ * Spawns a process, searching for the executable in PATH.
+ */
+int posix_spawnp
+(pid_t *pid, const char *file, const posix_spawn_file_actions_t *fa,
+ const posix_spawnattr_t *attr, char *const argv[], char *const envp[])
+{
+	return (spawn(pid, file, fa, attr, argv, envp, 1));
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+
+/**
+ * @brief Picks the buffering mode of a stream on its first write.
+ * 
+ * @details Streams that have not picked a buffering mode yet stay line
+ *          buffered on terminals, and become fully buffered otherwise, so
+ *          that writing to pipes and files does not take one write() per
+ *          line.
+ * 
+ * @param stream Target stream.
+ */
+void _autobuf(FILE *stream)
+{
+	/* Already picked. */
+	if (!(stream->flags & _IOAUTO))
+		return;
+	
+	stream->flags &= ~_IOAUTO;
+	
+	if (!isatty(fileno(stream)))
+	{
+		stream->flags &= ~_IOLBF;
+		stream->flags |= _IOFBF;
+	}
+}
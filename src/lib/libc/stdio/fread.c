@@ -0,0 +1,110 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "stdio.h"
+
+/*
+ * Reads an array from a file.
+ */
+size_t fread(void *ptr, size_t size, size_t nmemb, FILE *stream)
+{
+	char *p;        /* Write pointer.       */
+	int c;          /* Working character.   */
+	size_t n;       /* Bytes left to read.  */
+	size_t chunk;   /* Bytes in this chunk. */
+	size_t bufsiz;  /* Stream buffer size.  */
+	ssize_t ret;    /* Bytes actually read. */
+	
+	/* Nothing to be done. */
+	if ((size == 0) || (nmemb == 0))
+		return (0);
+	
+	/* Too big. */
+	if (nmemb > ((size_t)-1)/size)
+	{
+		errno = EINVAL;
+		return (0);
+	}
+	
+	p = ptr;
+	n = size*nmemb;
+	
+	while (n > 0)
+	{
+		/* Copy out of the stream buffer. */
+		if ((stream->flags & _IOREAD) && (stream->count > 0))
+		{
+			chunk = ((size_t)stream->count < n) ? (size_t)stream->count : n;
+			memcpy(p, stream->ptr, chunk);
+			stream->ptr += chunk;
+			stream->count -= chunk;
+			p += chunk;
+			n -= chunk;
+			continue;
+		}
+		
+		bufsiz = (stream->bufsiz > 0) ? stream->bufsiz : BUFSIZ;
+		
+		/* Small transfer, so refill the stream buffer. */
+		if (!(stream->flags & _IONBF) && (n < bufsiz))
+		{
+			if ((c = getc(stream)) == EOF)
+				break;
+			
+			*p++ = c;
+			n--;
+			continue;
+		}
+		
+		/* Now reading. */
+		if (stream->flags & _IORW)
+		{
+			/* Write out what is buffered first. */
+			if ((stream->flags & _IOWRITE) && (fflush(stream) == EOF))
+				break;
+			
+			stream->flags &= ~_IOWRITE;
+			stream->flags |= _IOREAD;
+		}
+		
+		/* File is not readable. */
+		if (!(stream->flags & _IOREAD))
+			break;
+		
+		/* End of file reached. */
+		if (stream->flags & _IOEOF)
+			break;
+		
+		/* Large transfer, so bypass the stream buffer. */
+		if ((ret = read(fileno(stream), p, n)) <= 0)
+		{
+			stream->flags |= (ret == 0) ? _IOEOF : _IOERROR;
+			break;
+		}
+		
+		p += ret;
+		n -= ret;
+	}
+	
+	return ((size*nmemb - n)/size);
+}
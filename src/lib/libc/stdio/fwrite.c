@@ -0,0 +1,127 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "stdio.h"
+
+/*
+ * Writes an array to a file.
+ */
+size_t fwrite(const void *ptr, size_t size, size_t nmemb, FILE *stream)
+{
+	const char *p;  /* Read pointer.           */
+	size_t n;       /* Bytes left to write.    */
+	size_t chunk;   /* Bytes in this chunk.    */
+	size_t bufsiz;  /* Stream buffer size.     */
+	ssize_t ret;    /* Bytes actually written. */
+	
+	/* Nothing to be done. */
+	if ((size == 0) || (nmemb == 0))
+		return (0);
+	
+	/* Too big. */
+	if (nmemb > ((size_t)-1)/size)
+	{
+		errno = EINVAL;
+		return (0);
+	}
+	
+	/* Pick buffering mode. */
+	if (stream->flags & (_IOWRITE | _IORW))
+		_autobuf(stream);
+	
+	p = ptr;
+	n = size*nmemb;
+	
+	while (n > 0)
+	{
+		/* Copy into the stream buffer. */
+		if ((stream->flags & _IOWRITE) && (stream->count > 0))
+		{
+			chunk = ((size_t)stream->count < n) ? (size_t)stream->count : n;
+			memcpy(stream->ptr, p, chunk);
+			stream->ptr += chunk;
+			stream->count -= chunk;
+			p += chunk;
+			n -= chunk;
+			continue;
+		}
+		
+		bufsiz = (stream->bufsiz > 0) ? stream->bufsiz : BUFSIZ;
+		
+		/* Small transfer, so go through the stream buffer. */
+		if (!(stream->flags & _IONBF) && (n < bufsiz))
+		{
+			if (putc(*p, stream) == EOF)
+				break;
+			
+			p++;
+			n--;
+			continue;
+		}
+		
+		/* Now writing. */
+		if (stream->flags & _IORW)
+		{
+			/* Drop what is buffered for reading. */
+			if (stream->flags & _IOREAD)
+			{
+				stream->ptr = stream->buf;
+				stream->count = 0;
+			}
+			
+			stream->flags &= ~_IOREAD;
+			stream->flags |= _IOWRITE;
+		}
+		
+		/* File is not writable. */
+		if (!(stream->flags & _IOWRITE))
+			break;
+		
+		/* Write out what is buffered first. */
+		if (fflush(stream) == EOF)
+			break;
+		
+		/* Synchronize file position. */
+		if ((stream->flags & (_IOSYNC | _IOAPPEND)) == (_IOSYNC | _IOAPPEND))
+		{
+			/* Failed. */
+			if (lseek(fileno(stream), 0, SEEK_END) < 0)
+			{
+				stream->flags |= _IOERROR;
+				break;
+			}
+		}
+		
+		/* Large transfer, so bypass the stream buffer. */
+		if ((ret = write(fileno(stream), p, n)) <= 0)
+		{
+			stream->flags |= _IOERROR;
+			break;
+		}
+		
+		p += ret;
+		n -= ret;
+	}
+	
+	return ((size*nmemb - n)/size);
+}
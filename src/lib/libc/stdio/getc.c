@@ -86,7 +86,7 @@ again:
 		}
 		
 		/* Setup read parameters. */
-		count = BUFSIZ;
+		count = stream->bufsiz;
 	}
 	
 	stream->count = read(fileno(stream), buf, count);
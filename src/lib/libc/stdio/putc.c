@@ -45,6 +45,9 @@ int putc(int c, FILE *stream)
 	/* File is not writable. */
 	if (!(stream->flags & _IOWRITE))
 		return (EOF);
+	
+	/* Pick buffering mode. */
+	_autobuf(stream);
 
 	/* Synchronize file position. */
 	if (!(stream->flags & _IOEOF))
@@ -35,6 +35,9 @@ int setvbuf(FILE *stream, char *buf, int type, size_t size)
 	if (stream->buf != NULL)
 		return (errno = EBUSY);
 	
+	/* Buffering is no longer picked at first use. */
+	stream->flags &= ~_IOAUTO;
+	
 	/* Not buffered. */
 	if (type == _IONBF)
 	{
@@ -60,7 +63,7 @@ int setvbuf(FILE *stream, char *buf, int type, size_t size)
 			stream->flags |= _IOMYBUF;
 		}
 		
-		stream->flags &= ~(_IOFBF | _IONBF | _IOFBF);
+		stream->flags &= ~(_IOFBF | _IONBF | _IOLBF);
 		stream->flags |= (type == _IOLBF) ? _IOLBF : _IOFBF;
 		stream->buf = buf;
 		stream->ptr = buf;
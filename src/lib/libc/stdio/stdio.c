@@ -23,7 +23,7 @@
 /* File streams table. */
 FILE streams[FOPEN_MAX] = {
 	{ 0, _IOREAD  | _IOLBF, NULL, NULL, 0, 0 },
-	{ 1, _IOWRITE | _IOLBF, NULL, NULL, 0, 0 },
+	{ 1, _IOWRITE | _IOLBF | _IOAUTO, NULL, NULL, 0, 0 },
 	{ 2, _IOWRITE | _IONBF, NULL, NULL, 0, 0 },
 };
 
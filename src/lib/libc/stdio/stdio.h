@@ -25,6 +25,7 @@
 	/* Forward definitions. */
 	extern FILE *_getstream(void);
 	extern int _sflags(const char *, int *);
+	extern void _autobuf(FILE *);
 	
 	/* File streams table. */
 	extern FILE streams[FOPEN_MAX];
@@ -17,24 +17,281 @@
  * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <stdio.h>
 #include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "stdio.h"
+
+/* Size of temporary buffer for unbuffered streams. */
+#define TMPBUF_SIZE 256
+
+/*
+ * Two-digit decimal lookup table.
+ */
+static const char digits[] =
+	"0001020304050607080910111213141516171819"
+	"2021222324252627282930313233343536373839"
+	"4041424344454647484950515253545556575859"
+	"6061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+/*
+ * Hexadecimal digits.
+ */
+static const char xdigits[] = "0123456789abcdef";
+
+/*
+ * Converts an unsigned integer to decimal, backwards from the end of a buffer.
+ */
+static char *utoa10(char *end, unsigned num)
+{
+	unsigned i;
+	
+	while (num >= 100)
+	{
+		i = (num % 100)*2;
+		num /= 100;
+		*--end = digits[i + 1];
+		*--end = digits[i];
+	}
+	
+	if (num >= 10)
+	{
+		*--end = digits[num*2 + 1];
+		*--end = digits[num*2];
+	}
+	else
+		*--end = num + '0';
+	
+	return (end);
+}
+
+/*
+ * Converts an unsigned integer to hexadecimal, backwards from the end of a
+ * buffer. Like the rest of the library, this pads to eight digits and adds
+ * a 0x prefix.
+ */
+static char *utoa16(char *end, unsigned num)
+{
+	for (int i = 0; i < 8; i++, num >>= 4)
+		*--end = xdigits[num & 0xf];
+	
+	*--end = 'x';
+	*--end = '0';
+	
+	return (end);
+}
+
+/*
+ * Writes padding characters to a file.
+ */
+static int pad(FILE *stream, int c, int width)
+{
+	int n;
+	
+	for (n = 0; n < width; n++)
+		putc(c, stream);
+	
+	return (n);
+}
+
+/*
+ * Writes formated output to a file.
+ * 
+ * Field widths, the '-' and '0' flags and string precisions are honored.
+ * The 'l' length modifier is accepted, as long and int have the same size.
+ */
+static int doprnt(FILE *stream, const char *format, va_list ap)
+{
+	int n;           /* Characters written.  */
+	int num;         /* Working number.      */
+	const char *p;   /* Working run.         */
+	size_t len;      /* Length of that run.  */
+	char *q;         /* Start of number.     */
+	char *end;       /* End of number.       */
+	char tmp[12];    /* Number buffer.       */
+	int left;        /* Left justify?        */
+	int zero;        /* Pad with zeros?      */
+	int width;       /* Field width.         */
+	int prec;        /* Precision.           */
+	
+	n = 0;
+	
+	while (*format != '\0')
+	{
+		/* Literal run. */
+		for (p = format; (*format != '\0') && (*format != '%'); format++)
+			/* noop */ ;
+		if ((len = format - p) > 0)
+		{
+			n += fwrite(p, 1, len, stream);
+			continue;
+		}
+		
+		len = 0;
+		end = &tmp[sizeof(tmp)];
+		left = zero = width = 0;
+		prec = -1;
+		
+		/* Parse flags. */
+		for (format++; (*format == '-') || (*format == '0'); format++)
+		{
+			if (*format == '-')
+				left = 1;
+			else
+				zero = 1;
+		}
+		
+		/* Parse field width. */
+		while ((*format >= '0') && (*format <= '9'))
+			width = width*10 + (*format++ - '0');
+		
+		/* Parse precision. */
+		if (*format == '.')
+		{
+			for (prec = 0, format++; (*format >= '0') && (*format <= '9'); format++)
+				prec = prec*10 + (*format - '0');
+		}
+		
+		/* Length modifier. */
+		if (*format == 'l')
+			format++;
+		
+		/* Parse format. */
+		switch (*format)
+		{
+			/* Character. */
+			case 'c':
+				tmp[0] = (char)va_arg(ap, int);
+				p = tmp;
+				len = 1;
+				break;
+			
+			/* Signed decimal. */
+			case 'd':
+				num = va_arg(ap, int);
+				q = utoa10(end, (num < 0) ? -(unsigned)num : (unsigned)num);
+				if (num < 0)
+					*--q = '-';
+				p = q;
+				len = end - p;
+				break;
+			
+			/* Unsigned decimal. */
+			case 'u':
+				p = utoa10(end, va_arg(ap, unsigned));
+				len = end - p;
+				break;
+			
+			/* Hexadecimal. */
+			case 'X':
+			case 'x':
+				p = utoa16(end, va_arg(ap, unsigned));
+				len = end - p;
+				break;
+			
+			/* String. */
+			case 's':
+				p = va_arg(ap, const char *);
+				len = strlen(p);
+				if ((prec >= 0) && (len > (size_t)prec))
+					len = prec;
+				zero = 0;
+				break;
+			
+			/* Percent sign. */
+			case '%':
+				p = format;
+				len = 1;
+				break;
+			
+			/* Ignore. */
+			default:
+				if (*format == '\0')
+					return (n);
+				break;
+		}
+		
+		width -= len;
+		
+		/* Sign goes before zero padding. */
+		if ((zero) && (!left) && (width > 0) && (len > 0) && (*p == '-'))
+		{
+			n += fwrite(p++, 1, 1, stream);
+			len--;
+		}
+		
+		if ((!left) && (width > 0))
+			n += pad(stream, (zero) ? '0' : ' ', width);
+		
+		if (len > 0)
+			n += fwrite(p, 1, len, stream);
+		
+		if ((left) && (width > 0))
+			n += pad(stream, ' ', width);
+		
+		format++;
+	}
+	
+	return (n);
+}
 
 /*
  * Writes format output of a stdarg argument list to a file.
+ * 
+ * Output is gathered in the stream buffer and written out at once: line
+ * buffered streams are flushed once at the end, if a new line was written,
+ * and unbuffered streams borrow a temporary buffer.
  */
 int vfprintf(FILE *stream, const char *format, va_list ap)
 {
-	int n;             /* Characters written. */
-	char buffer[1024]; /* Buffer.             */
+	int n;                  /* Characters written.  */
+	int flags;              /* Buffering mode.      */
+	int nl;                 /* Flush line?          */
+	char tmp[TMPBUF_SIZE];  /* Temporary buffer.    */
 	
-	/* Format string. */
-	n = vsprintf(buffer, format, ap);
+	/* Pick buffering mode. */
+	if (stream->flags & (_IOWRITE | _IORW))
+		_autobuf(stream);
 	
-	/* Write formated string to file. */
-	if (n > 0)
-		fputs(buffer, stream);
+	flags = stream->flags & (_IOLBF | _IONBF);
+	
+	/* Unbuffered. */
+	if (flags & _IONBF)
+	{
+		stream->buf = tmp;
+		stream->ptr = tmp;
+		stream->bufsiz = TMPBUF_SIZE;
+		stream->count = (stream->flags & _IOWRITE) ? TMPBUF_SIZE : 0;
+	}
+	
+	/* Line buffered, with room left in the buffer. */
+	else if ((flags & _IOLBF) && (stream->buf != NULL) && (stream->flags & _IOWRITE))
+		stream->count = stream->bufsiz - (stream->ptr - stream->buf);
+	
+	stream->flags = (stream->flags & ~(_IOLBF | _IONBF)) | _IOFBF;
+	
+	n = doprnt(stream, format, ap);
+	
+	/* Restore buffering mode. */
+	if (flags)
+	{
+		nl = (flags & _IONBF) || ((stream->buf != NULL) &&
+			(memchr(stream->buf, '\n', stream->ptr - stream->buf) != NULL));
+		
+		if (nl)
+			fflush(stream);
+		
+		stream->flags = (stream->flags & ~_IOFBF) | flags;
+		stream->count = 0;
+		
+		if (flags & _IONBF)
+		{
+			stream->buf = NULL;
+			stream->ptr = NULL;
+			stream->bufsiz = 0;
+		}
+	}
 	
 	return (n);
 }
-
@@ -16,23 +16,57 @@
  * You should have received a copy of the GNU General Public License
  * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
  */
-
 /**
  * @file
  * 
  * @brief malloc() and free() implementation.
+ * 
+ * @details Small requests are served from segregated size classes, each one
+ *          with its own free list, so they cost a few instructions. Large
+ *          requests are served first-fit from an address ordered free list,
+ *          which is where coalescing happens. Memory of large freed blocks is
+ *          handed back to the kernel, either by shrinking the heap or by
+ *          discarding the pages.
  */
 
+#include <nanvix/mm.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <errno.h>
+#include <malloc.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
 /**
- * @brief expand() in at least NALLOC blocks.
+ * @brief Minimum heap expansion (in bytes).
+ */
+#define MALLOC_CHUNK 16384
+
+/**
+ * @brief Free space at the end of the heap that triggers trimming (in bytes).
+ */
+#define MALLOC_TRIM 131072
+
+/**
+ * @brief Smallest freed block whose pages are discarded (in bytes).
+ */
+#define MALLOC_DISCARD 65536
+
+/**
+ * @brief Number of small size classes.
+ */
+#define NR_CLASSES 7
+
+/**
+ * @brief Largest small object (in blocks, including header).
+ */
+#define SMALL_MAX (2 << (NR_CLASSES - 1))
+
+/**
+ * @brief Size of a small object run (in blocks).
  */
-#define NALLOC 511
+#define SMALL_RUN 512
 
 /**
  * @brief Size of block structure.
@@ -44,31 +78,57 @@
  */
 struct block
 {
-	struct block *nextp; /* Next free block.  */
-	unsigned nblocks;    /* Size (in blocks). */
+	struct block *nextp; /* Next free block.                    */
+	unsigned nblocks;    /* Size (in blocks, including header). */
 };
 
 /**
- * @brief Free list of blocks.
+ * @brief Free list of large blocks.
  */
 static struct block head;
 static struct block *freep = NULL;
 
 /**
- * @brief Frees allocated memory.
+ * @brief Free lists of small objects.
+ */
+static struct block *classes[NR_CLASSES];
+
+/**
+ * @brief Allocator statistics.
+ */
+static struct
+{
+	size_t arena; /* Bytes obtained from the kernel. */
+	size_t inuse; /* Bytes handed out to callers.    */
+} mstats = { 0, 0 };
+
+/**
+ * @brief Computes the size class of a small request.
  * 
- * @param ptr Memory area to free.
+ * @param nblocks Request size (in blocks).
+ * 
+ * @returns The size class that fits @p nblocks.
  */
-void free(void *ptr)
+static int getclass(unsigned nblocks)
 {
-	struct block *p;  /* Working block.     */
-	struct block *bp; /* Block being freed. */
+	int i;
 	
-	/* Nothing to be done. */
-	if (ptr == NULL)
-		return;
+	for (i = 0; (2U << i) < nblocks; i++)
+		/* noop */;
 	
-	bp = (struct block *)ptr - 1;
+	return (i);
+}
+
+/**
+ * @brief Inserts a block in the large free list.
+ * 
+ * @param bp Block to insert.
+ * 
+ * @returns The free block that holds @p bp after coalescing.
+ */
+static struct block *lfree(struct block *bp)
+{
+	struct block *p; /* Working block. */
 	
 	/* Look for insertion point. */
 	for (p = freep; p > bp || p->nextp < bp; p = p->nextp)
@@ -81,75 +141,118 @@ void free(void *ptr)
 	/* Merge with upper block. */
 	if (bp + bp->nblocks == p->nextp)
 	{
-		bp->nblocks += p->nextp->nblocks + 1;
+		bp->nblocks += p->nextp->nblocks;
 		bp->nextp = p->nextp->nextp;
 	}
 	else
 		bp->nextp = p->nextp;
 	
+	freep = p;
+	
 	/* Merge with lower block. */
 	if (p + p->nblocks == bp)
 	{
-		p->nblocks += bp->nblocks + 1;
+		p->nblocks += bp->nblocks;
 		p->nextp = bp->nextp;
+		return (p);
 	}
-	else
-		p->nextp = bp;
 	
-	freep = p;
+	p->nextp = bp;
+	
+	return (bp);
+}
+
+/**
+ * @brief Gives memory of a large free block back to the kernel.
+ * 
+ * @details If the block lies at the end of the heap, the heap is shrunk,
+ *          keeping one chunk for later requests. Otherwise, whole pages of the
+ *          block that was freed are discarded, and these are zero filled again
+ *          on the next touch.
+ * 
+ * @param bp    Free block that holds the freed block, after coalescing.
+ * @param freed Freed block.
+ * @param size  Size of the freed block (in bytes).
+ */
+static void trim(struct block *bp, struct block *freed, size_t size)
+{
+	size_t n;    /* Bytes to release. */
+	char *start; /* Discarded range.  */
+	char *end;   /* End of range.     */
+	
+	/* Shrink heap. */
+	if ((bp->nblocks*SIZEOF_BLOCK >= MALLOC_TRIM) &&
+		((void *)(bp + bp->nblocks) == sbrk(0)))
+	{
+		n = (bp->nblocks*SIZEOF_BLOCK - MALLOC_CHUNK) & ~(PAGE_SIZE - 1);
+		
+		/* sbrk() takes an unsigned increment. */
+		if (sbrk(-n) == (void *)-1)
+			return;
+		
+		bp->nblocks -= n/SIZEOF_BLOCK;
+		mstats.arena -= n;
+		
+		return;
+	}
+	
+	if (size < MALLOC_DISCARD)
+		return;
+	
+	/* Leave the block header alone. */
+	start = (char *)(((unsigned)(freed + 1) + (PAGE_SIZE - 1)) & ~(PAGE_SIZE - 1));
+	end = (char *)(((unsigned)freed + size) & ~(PAGE_SIZE - 1));
+	
+	if (start < end)
+		madvise(start, end - start, MADV_DONTNEED);
 }
 
 /**
  * @brief Expands the heap.
  * 
- * @details Expands the heap by @p nblocks.
+ * @details Expands the heap by at least @p nblocks.
  * 
  * @param nblocks Number of blocks to expand.
  * 
- * @returns Upon successful completion a pointed to the expansion is returned.
- *          Upon failure, a null pointed is returned instead and errno is set
- *          to indicate the error.
+ * @returns Upon successful completion a pointed to the free list is returned.
+ *          Upon failure, a null pointed is returned instead.
  */
-static void *expand(unsigned nblocks)
+static struct block *expand(unsigned nblocks)
 {
-	struct block *p;
+	size_t size;     /* Expansion size (in bytes). */
+	struct block *p; /* New block.                 */
 
-	/* Expand in at least NALLOC blocks. */
-	if (nblocks < NALLOC)
-		nblocks = NALLOC;
+	size = nblocks*SIZEOF_BLOCK;
+	
+	/* Expand in at least MALLOC_CHUNK bytes. */
+	if (size < MALLOC_CHUNK)
+		size = MALLOC_CHUNK;
+	size = (size + (MALLOC_CHUNK - 1)) & ~(MALLOC_CHUNK - 1);
 	
 	/* Request more memory to the kernel. */
-	if ((p = sbrk((nblocks + 1)*SIZEOF_BLOCK)) == (void *)-1)
+	if ((p = sbrk(size)) == (void *)-1)
 		return (NULL);
 	
-	p->nblocks = nblocks;
-	free(p + 1);
+	mstats.arena += size;
+	
+	p->nblocks = size/SIZEOF_BLOCK;
+	lfree(p);
 	
 	return (freep);
 }
 
 /**
- * @brief Allocates memory.
+ * @brief Allocates a large block.
  * 
- * @param size Number of bytes to allocate.
+ * @param nblocks Request size (in blocks).
  * 
- * @returns Upon successful completion with size not equal to 0, malloc() 
- *          returns a pointer to the allocated space. If size is 0, either a
- *          null pointer or a unique pointer that can be successfully passed to
- *          free() is returned. Otherwise, it returns a null pointer and set
- *          errno to indicate the error.
+ * @returns Upon successful completion a pointer to the allocated block is
+ *          returned. Upon failure, a null pointer is returned instead.
  */
-void *malloc(size_t size)
+static struct block *lalloc(unsigned nblocks)
 {
-	struct block *p;     /* Working block.            */
-	struct block *prevp; /* Previous working block.   */
-	unsigned nblocks;    /* Request size (in blocks). */
-	
-	/* Nothing to be done. */
-	if (size == 0)
-		return (NULL);
-	
-	nblocks = (size + (SIZEOF_BLOCK - 1))/SIZEOF_BLOCK + 1;
+	struct block *p;     /* Working block.          */
+	struct block *prevp; /* Previous working block. */
 	
 	/* Create free list. */
 	if ((prevp = freep) == NULL)
@@ -178,7 +281,7 @@ void *malloc(size_t size)
 			
 			freep = prevp;
 			
-			return (p + 1);
+			return (p);
 		}
 		
 		/* Wrapped around free list. */
@@ -193,6 +296,169 @@ void *malloc(size_t size)
 	return (NULL);
 }
 
+/**
+ * @brief Refills the free list of a small size class.
+ * 
+ * @param class Size class.
+ * 
+ * @returns Upon successful completion, zero is returned. Upon failure, non
+ *          zero is returned instead.
+ */
+static int refill(int class)
+{
+	unsigned n;      /* Object size (in blocks). */
+	struct block *p; /* Run of objects.          */
+	struct block *q; /* Working object.          */
+	
+	if ((p = lalloc(SMALL_RUN)) == NULL)
+		return (-1);
+	
+	/* Carve run into objects. */
+	n = 2 << class;
+	for (q = p; q + n <= p + SMALL_RUN; q += n)
+	{
+		q->nblocks = n;
+		q->nextp = classes[class];
+		classes[class] = q;
+	}
+	
+	return (0);
+}
+
+/**
+ * @brief Frees allocated memory.
+ * 
+ * @param ptr Memory area to free.
+ */
+void free(void *ptr)
+{
+	int class;        /* Size class.        */
+	size_t size;      /* Size of block.     */
+	struct block *bp; /* Block being freed. */
+	
+	/* Nothing to be done. */
+	if (ptr == NULL)
+		return;
+	
+	bp = (struct block *)ptr - 1;
+	
+	size = bp->nblocks*SIZEOF_BLOCK;
+	mstats.inuse -= size;
+	
+	/* Small object. */
+	if (bp->nblocks <= SMALL_MAX)
+	{
+		class = getclass(bp->nblocks);
+		bp->nextp = classes[class];
+		classes[class] = bp;
+		return;
+	}
+	
+	trim(lfree(bp), bp, size);
+}
+
+/**
+ * @brief Allocates memory.
+ * 
+ * @param size Number of bytes to allocate.
+ * 
+ * @returns Upon successful completion with size not equal to 0, malloc() 
+ *          returns a pointer to the allocated space. If size is 0, either a
+ *          null pointer or a unique pointer that can be successfully passed to
+ *          free() is returned. Otherwise, it returns a null pointer and set
+ *          errno to indicate the error.
+ */
+void *malloc(size_t size)
+{
+	int class;        /* Size class.               */
+	struct block *p;  /* Working block.            */
+	unsigned nblocks; /* Request size (in blocks). */
+	
+	/* Nothing to be done. */
+	if (size == 0)
+		return (NULL);
+	
+	nblocks = (size + (SIZEOF_BLOCK - 1))/SIZEOF_BLOCK + 1;
+	
+	/* Small object. */
+	if (nblocks <= SMALL_MAX)
+	{
+		class = getclass(nblocks);
+		
+		if ((classes[class] == NULL) && (refill(class)))
+			goto error;
+		
+		p = classes[class];
+		classes[class] = p->nextp;
+	}
+	
+	/* Large block. */
+	else if ((p = lalloc(nblocks)) == NULL)
+		goto error;
+	
+	mstats.inuse += p->nblocks*SIZEOF_BLOCK;
+	
+	return (p + 1);
+
+error:
+	errno = ENOMEM;
+	return (NULL);
+}
+
+/**
+ * @brief Grows a large block in place.
+ * 
+ * @param bp      Target block.
+ * @param nblocks New size (in blocks).
+ * 
+ * @returns Upon successful completion, zero is returned. Upon failure, non
+ *          zero is returned and @p bp is left untouched.
+ */
+static int grow(struct block *bp, unsigned nblocks)
+{
+	struct block *p;     /* Working block.          */
+	struct block *prevp; /* Previous working block. */
+	
+	if (freep == NULL)
+		return (-1);
+	
+	/* Look for a free block right above. */
+	for (prevp = freep, p = freep->nextp; /* void */ ; prevp = p, p = p->nextp)
+	{
+		/* Found. */
+		if (p == bp + bp->nblocks)
+			break;
+			
+		/* Wrapped around free list. */
+		if (p == freep)
+			return (-1);
+	}
+	
+	/* Not big enough. */
+	if (bp->nblocks + p->nblocks < nblocks)
+		return (-1);
+	
+	/* Take whole block. */
+	if (bp->nblocks + p->nblocks - nblocks <= SMALL_MAX)
+	{
+		prevp->nextp = p->nextp;
+		bp->nblocks += p->nblocks;
+	}
+	
+	/* Take only what we need. */
+	else
+	{
+		prevp->nextp = bp + nblocks;
+		prevp->nextp->nextp = p->nextp;
+		prevp->nextp->nblocks = bp->nblocks + p->nblocks - nblocks;
+		bp->nblocks = nblocks;
+	}
+	
+	freep = prevp;
+	
+	return (0);
+}
+
 /**
  * @brief Reallocates a memory chunk.
  * 
@@ -201,25 +467,86 @@ void *malloc(size_t size)
  * 
  * @returns Upon successful completion, realloc() returns a pointer to the
  *           allocated space. Upon failure, a null pointer is returned instead.
- * 
- * @todo Check if we can simply expand.
  */
 void *realloc(void *ptr, size_t size)
 {
-	void *newptr;
+	void *newptr;     /* New object.               */
+	struct block *bp; /* Old block.                */
+	unsigned nblocks; /* Request size (in blocks). */
+	unsigned oldsize; /* Old size (in blocks).     */
 	
-	/* Nothing to be done. */
+	/* Same as malloc(). */
+	if (ptr == NULL)
+		return (malloc(size));
+	
+	/* Same as free(). */
 	if (size == 0)
 	{
-		errno = EINVAL;
+		free(ptr);
 		return (NULL);
 	}
 	
-	newptr = malloc(size);
-	if (ptr != NULL)
-		memcpy(newptr, ptr, size);
-		
+	bp = (struct block *)ptr - 1;
+	oldsize = bp->nblocks;
+	nblocks = (size + (SIZEOF_BLOCK - 1))/SIZEOF_BLOCK + 1;
+	
+	/* Fits. */
+	if (nblocks <= oldsize)
+		return (ptr);
+	
+	/* Grow large block in place. */
+	if ((oldsize > SMALL_MAX) && (!grow(bp, nblocks)))
+	{
+		mstats.inuse += (bp->nblocks - oldsize)*SIZEOF_BLOCK;
+		return (ptr);
+	}
+	
+	if ((newptr = malloc(size)) == NULL)
+		return (NULL);
+	
+	memcpy(newptr, ptr, (oldsize - 1)*SIZEOF_BLOCK);
 	free(ptr);
 	
 	return (newptr);
 }
+
+/**
+ * @brief Gets allocator statistics.
+ * 
+ * @returns Allocator statistics.
+ */
+struct mallinfo mallinfo(void)
+{
+	int i;              /* Loop index.    */
+	struct block *p;    /* Working block. */
+	struct mallinfo mi; /* Statistics.    */
+	
+	mi.arena = mstats.arena;
+	mi.uordblks = mstats.inuse;
+	mi.ordblks = 0;
+	mi.smblks = 0;
+	mi.fordblks = 0;
+	mi.fsmblks = 0;
+	
+	/* Large free blocks. */
+	if (freep != NULL)
+	{
+		for (p = head.nextp; p != &head; p = p->nextp)
+		{
+			mi.ordblks++;
+			mi.fordblks += p->nblocks*SIZEOF_BLOCK;
+		}
+	}
+	
+	/* Small free objects. */
+	for (i = 0; i < NR_CLASSES; i++)
+	{
+		for (p = classes[i]; p != NULL; p = p->nextp)
+		{
+			mi.smblks++;
+			mi.fsmblks += p->nblocks*SIZEOF_BLOCK;
+		}
+	}
+	
+	return (mi);
+}
@@ -59,109 +59,180 @@
 #include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
+#include "../string/word.h"
 
 /**
- * @brief Compare function.
+ * @brief Partitions of up to this many elements are insertion sorted.
  */
-static int (*_cmp)(const void *, const void *) = NULL;
+#define ISORT_MAX 16
 
 /**
- * @brief Finds sorting pivot.
+ * @brief Comparison function.
  */
-static int find_pivot(void *base, int i, int j, size_t size)
-{
-	void *first_key;
-	void *next_key;
-
-	first_key = (void *) (((char *) base) + (i*size));
-	next_key = first_key;
+typedef int (*cmp_t)(const void *, const void *);
 
-	for (int k = i + 1; k <= j; k++)
-    {
-		int res;
+/**
+ * @brief Swaps two elements.
+ * 
+ * @details Elements are swapped a word at a time if both are word aligned
+ *          and their size is a multiple of the word size.
+ */
+static void swap(char *a, char *b, size_t size)
+{
+	char c;
+	word_t w;
+	word_t *wa, *wb;
+	
+	/* Word-wise. */
+	if (ALIGNED(a) && ALIGNED(b) && !(size & WORD_MASK))
+	{
+		wa = (word_t *)a;
+		wb = (word_t *)b;
+		for (/* noop */; size > 0; size -= WORD_SIZE)
+		{
+			w = *wa;
+			*wa++ = *wb;
+			*wb++ = w;
+		}
 		
-		next_key = (void *) (((char *) next_key) + size);
-		res = (*_cmp) (next_key, first_key);
-
-		if (res > 0)
-			return (k);
-		else if (res < 0)
-			return (i);
+		return;
+	}
+	
+	while (size-- > 0)
+	{
+		c = *a;
+		*a++ = *b;
+		*b++ = c;
 	}
-
-	return (-1);
 }
 
 /**
- * @brief Swaps two elements.
+ * @brief Sorts a small array with insertion sort.
  */
-static void swap(void *base, int i, int j, size_t size)
+static void isort(char *base, size_t nmemb, size_t size, cmp_t cmp)
 {
-	static void *temp = NULL;
-	static size_t max_size = 0;
-	void *elem1, *elem2;
-
-	if (size > max_size)
+	char *p;
+	
+	for (size_t i = 1; i < nmemb; i++)
 	{
-		temp = realloc(temp, size);
-		max_size = size;
+		for (p = base + i*size; (p > base) && (cmp(p - size, p) > 0); p -= size)
+			swap(p - size, p, size);
 	}
-
-	elem1 = ((char *) base) + (i * size);
-	elem2 = ((char *) base) + (j * size);
-
-	memcpy (temp, elem1, size);
-	memcpy (elem1, elem2, size);
-	memcpy (elem2, temp, size);
 }
 
 /**
- * @brief Partitions the array.
+ * @brief Restores the heap property below some element.
  */
-static int partition(void *base, int i, int j, int pivot_index, size_t size)
+static void siftdown(char *base, size_t root, size_t nmemb, size_t size, cmp_t cmp)
 {
-	int left, right;
-
-	left = i;
-	right = j;
-
-	do
+	size_t child;
+	
+	while ((child = 2*root + 1) < nmemb)
 	{
-		swap (base, left, right, size);
-
-		if (pivot_index == left)
-			pivot_index = right;
-		else if (pivot_index == right)
-			pivot_index = left;
-
-		while (_cmp ((void *) (((char *) base) + (left * size)),
-			(void *) (((char *) base) + (pivot_index * size))) < 0)
-			left++;
-
-		while (_cmp ((void *) (((char *) base) + (right * size)),
-			(void *) (((char *) base) + (pivot_index * size))) >= 0)
-			right--;
-	} while (left <= right);
+		/* Pick larger child. */
+		if ((child + 1 < nmemb) && (cmp(base + child*size, base + (child + 1)*size) < 0))
+			child++;
+		
+		/* Done. */
+		if (cmp(base + root*size, base + child*size) >= 0)
+			return;
+		
+		swap(base + root*size, base + child*size, size);
+		root = child;
+	}
+}
 
-	return (left);
+/**
+ * @brief Sorts an array with heapsort.
+ */
+static void hsort(char *base, size_t nmemb, size_t size, cmp_t cmp)
+{
+	/* Build heap. */
+	for (size_t i = nmemb/2; i > 0; i--)
+		siftdown(base, i - 1, nmemb, size, cmp);
+	
+	/* Pop elements. */
+	for (size_t i = nmemb - 1; i > 0; i--)
+	{
+		swap(base, base + i*size, size);
+		siftdown(base, 0, i, size, cmp);
+	}
 }
 
 /**
  * @brief Internal qsort().
+ * 
+ * @details Introsort: quicksort with median-of-three pivots that recurses
+ *          on the smaller partition, falls back to heapsort once @p depth
+ *          runs out, and leaves small partitions to insertion sort.
  */
-static void _qsort(void *base, int i, int j, size_t size)
+static void _qsort(char *base, size_t nmemb, size_t size, int depth, cmp_t cmp)
 {
-	int pivot_index, mid;
-
-	pivot_index = find_pivot(base, i, j, size);
-
-	if (pivot_index == -1)
-		return;
-
-	/* Sort. */
-	mid = partition (base, i, j, pivot_index, size);
-	_qsort (base, i, mid - 1, size);
-	_qsort (base, mid, j, size);
+	char *lo, *mid, *hi; /* Pivot candidates.     */
+	char *i, *j;         /* Partition pointers.   */
+	size_t nleft;        /* Left partition size.  */
+	size_t nright;       /* Right partition size. */
+	
+	while (nmemb > ISORT_MAX)
+	{
+		/* Too many bad pivots. */
+		if (depth-- == 0)
+		{
+			hsort(base, nmemb, size, cmp);
+			return;
+		}
+		
+		/* Median of three, moved to the front. */
+		lo = base;
+		mid = base + (nmemb/2)*size;
+		hi = base + (nmemb - 1)*size;
+		if (cmp(mid, lo) < 0)
+			swap(mid, lo, size);
+		if (cmp(hi, mid) < 0)
+		{
+			swap(hi, mid, size);
+			if (cmp(mid, lo) < 0)
+				swap(mid, lo, size);
+		}
+		swap(lo, mid, size);
+		
+		/* Partition. */
+		i = lo + size;
+		j = hi;
+		while (1)
+		{
+			while (cmp(i, lo) < 0)
+				i += size;
+			while (cmp(lo, j) < 0)
+				j -= size;
+			
+			if (i >= j)
+				break;
+			
+			swap(i, j, size);
+			i += size;
+			j -= size;
+		}
+		swap(lo, j, size);
+		
+		nleft = (j - base)/size;
+		nright = nmemb - nleft - 1;
+		
+		/* Recurse on the smaller side. */
+		if (nleft < nright)
+		{
+			_qsort(base, nleft, size, depth, cmp);
+			base = j + size;
+			nmemb = nright;
+		}
+		else
+		{
+			_qsort(j + size, nright, size, depth, cmp);
+			nmemb = nleft;
+		}
+	}
+	
+	isort(base, nmemb, size, cmp);
 }
 
 /**
@@ -175,6 +246,15 @@ static void _qsort(void *base, int i, int j, size_t size)
 void qsort
 (void *base, size_t nmemb, size_t size, int (*cmp)(const void *, const void *))
 {
-	_cmp = cmp;
-	_qsort(base, 0, nmemb - 1, size);
+	int depth;
+	
+	/* Nothing to be done. */
+	if ((nmemb < 2) || (size == 0))
+		return;
+	
+	/* Depth limit is twice log2(nmemb). */
+	for (depth = 0; (nmemb >> depth) > 1; depth++)
+		/* noop */ ;
+	
+	_qsort(base, nmemb, size, 2*depth, cmp);
 }
@@ -27,6 +27,7 @@
 #include <sys/wait.h>
 
 #include <unistd.h>
+#include <spawn.h>
 #include <stdlib.h>
 #include <signal.h>
 
@@ -59,18 +60,17 @@ int system(const char *command)
 	argv[2] = (command == NULL) ? "exit 0" : command;
 	argv[3] = NULL;
 
-	if ((pid = fork()) < 0)
-		return ((command == NULL) ? 0 : -1);
-	
 	/* Execute command. */
-	else if (pid == 0)
+	if (posix_spawnp(&pid, "sh", NULL, NULL, (char * const *)argv, environ))
 	{
-		execvp("sh", (char * const *)argv);
-		exit(-1);
+		signal(SIGINT, sigint_handler);
+		signal(SIGQUIT, sigquit_handler);
+		return ((command == NULL) ? 0 : -1);
 	}
 	
 	/* Wait for child. */
-	wait(&status);
+	while (wait(&status) != pid)
+		/* noop */;
 		
 	/* Restore signal handlers. */
 	signal(SIGINT, sigint_handler);
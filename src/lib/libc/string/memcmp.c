@@ -24,6 +24,7 @@
  */
 
 #include <sys/types.h>
+#include "word.h"
 
 /**
  * @brief Compares bytes in memory.
@@ -46,6 +47,23 @@ int memcmp(const void *s1, const void *s2, size_t n)
 	p1 = s1;
 	p2 = s2;
 	
+	/* Compare words when both objects can be aligned. */
+	if (((unsigned) p1 & WORD_MASK) == ((unsigned) p2 & WORD_MASK))
+	{
+		for (/* noop */; (n > 0) && !ALIGNED(p1); n--, p1++, p2++)
+		{
+			if (*p1 != *p2)
+				return (*p1 - *p2);
+		}
+		
+		while ((n >= WORD_SIZE) && (*(const word_t *)p1 == *(const word_t *)p2))
+		{
+			p1 += WORD_SIZE;
+			p2 += WORD_SIZE;
+			n -= WORD_SIZE;
+		}
+	}
+	
 	while (n-- > 0)
 	{
 		if (*p1++ != *p2++)
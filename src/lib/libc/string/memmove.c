@@ -57,6 +57,8 @@
  */
 
 #include <sys/types.h>
+#include <string.h>
+#include "word.h"
 
 /**
  * @brief Copies bytes in memory with overlapping areas.
@@ -77,20 +79,29 @@ void *memmove(void *s1, const void *s2, size_t n)
 	p1 = s1;
 	p2 = s2;
 
+	/* Forward copy is safe. */
+	if (!(p2 < p1 && p1 < p2 + n))
+		return (memcpy(s1, s2, n));
+	
 	/* Have to copy backwards */
-	if (p2 < p1 && p1 < p2 + n)
+	p2 += n; p1 += n;
+	
+	/* Copy words when both objects can be aligned. */
+	if (((unsigned) p1 & WORD_MASK) == ((unsigned) p2 & WORD_MASK))
 	{
-		p2 += n; p1 += n;
-		
-		while (n-- > 0)
+		for (/* noop */; (n > 0) && !ALIGNED(p1); n--)
 			*--p1 = *--p2;
+		
+		for (/* noop */; n >= WORD_SIZE; n -= WORD_SIZE)
+		{
+			p1 -= WORD_SIZE;
+			p2 -= WORD_SIZE;
+			*(word_t *)p1 = *(const word_t *)p2;
+		}
 	}
 	
-	else
-	{
-		while (n-- > 0)
-			*p1++ = *p2++;
-	}
+	while (n-- > 0)
+		*--p1 = *--p2;
 
 	return (s1);
 }
@@ -25,6 +25,7 @@
 
 #include <stdlib.h>
 #include <sys/types.h>
+#include "word.h"
 
 /**
  * @brief Finds a byte in string.
@@ -38,11 +39,28 @@
  */
 char *strchr(const char *s, int c)
 {
+	word_t cc;       /* Repeated character. */
+	const word_t *w; /* Working word.       */
+	
+	/* Align. */
+	for (/* noop */; !ALIGNED(s); s++)
+	{
+		if (*s == (char) c)
+			return ((char *) s);
+		if (*s == '\0')
+			return (NULL);
+	}
+	
+	/* Skip words without the byte or a null byte. */
+	cc = REPEAT(c);
+	for (w = (const word_t *)s; !HASZERO(*w) && !HASZERO(*w ^ cc); w++)
+		/* noop */;
+	
 	/* Scan string. */
-	while (*s != '\0')
+	for (s = (const char *)w; *s != '\0'; /* noop */)
 	{
 		/* Found. */
-		if (*s == c)
+		if (*s == (char) c)
 			return ((char *) s);
 		
 		s++;
@@ -23,6 +23,8 @@
  * @brief strcmp() implementation.
  */
 
+#include "word.h"
+
 /**
  * @brief Compares two strings.
  * 
@@ -37,6 +39,27 @@
  */
 int strcmp(const char *s1, const char *s2)
 {
+	const word_t *w1; /* Working word of s1. */
+	const word_t *w2; /* Working word of s2. */
+	
+	/* Compare words when both strings can be aligned. */
+	if (((unsigned) s1 & WORD_MASK) == ((unsigned) s2 & WORD_MASK))
+	{
+		for (/* noop */; !ALIGNED(s1); s1++, s2++)
+		{
+			if ((*s1 != *s2) || (*s1 == '\0'))
+				return ((*(unsigned char *) s1 - *(unsigned char *) s2));
+		}
+		
+		w1 = (const word_t *)s1;
+		w2 = (const word_t *)s2;
+		while ((*w1 == *w2) && !HASZERO(*w1))
+			w1++, w2++;
+		
+		s1 = (const char *)w1;
+		s2 = (const char *)w2;
+	}
+	
 	/* Compare strings. */
 	while (*s1 == *s2)
 	{
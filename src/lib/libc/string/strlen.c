@@ -24,6 +24,7 @@
  */
 
 #include <sys/types.h>
+#include "word.h"
 
 /**
  * @brief Gets string length.
@@ -37,9 +38,21 @@
 size_t strlen(const char *str)
 {
 	const char *p;
+	const word_t *w;
+	
+	/* Align. */
+	for (p = str; !ALIGNED(p); p++)
+	{
+		if (*p == '\0')
+			return (p - str);
+	}
+	
+	/* Skip words without a null byte. */
+	for (w = (const word_t *)p; !HASZERO(*w); w++)
+		/* No operation.*/;
 	
 	/* Count the number of characters. */
-	for (p = str; *p != '\0'; p++)
+	for (p = (const char *)w; *p != '\0'; p++)
 		/* No operation.*/;
 	
 	return (p - str);
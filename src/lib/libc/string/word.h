@@ -0,0 +1,61 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ * 
+ * @brief Word-at-a-time helpers for string functions.
+ */
+
+#ifndef _WORD_H_
+#define _WORD_H_
+
+	/**
+	 * @brief Machine word.
+	 * 
+	 * @details Words may alias any object we scan.
+	 */
+	typedef unsigned __attribute__((__may_alias__)) word_t;
+
+	/**
+	 * @brief Word size (in bytes).
+	 */
+	#define WORD_SIZE (sizeof(word_t))
+
+	/**
+	 * @brief Word alignment mask.
+	 */
+	#define WORD_MASK (WORD_SIZE - 1)
+
+	/**
+	 * @brief Asserts if a pointer is word aligned.
+	 */
+	#define ALIGNED(p) (!((unsigned)(p) & WORD_MASK))
+
+	/**
+	 * @brief Replicates a byte across a word.
+	 */
+	#define REPEAT(c) ((word_t)(unsigned char)(c)*0x01010101U)
+
+	/**
+	 * @brief Asserts if a word has a zero byte.
+	 */
+	#define HASZERO(w) (((w) - 0x01010101U) & ~(w) & 0x80808080U)
+
+#endif /* _WORD_H_ */
@@ -17,33 +17,31 @@
  * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
  */
 
-/**
- * @file
- * 
- * @brief memset() implementation.
- */
-
-#include <sys/types.h>
+#include <nanvix/syscall.h>
+#include <sys/cachestat.h>
+#include <errno.h>
 
 /**
- * @brief Sets bytes in memory.
- * 
- * @param s Pointer to target object.
- * @param c Character to copy.
- * @param n Number of bytes to set.
- * 
- * @returns @p s is returned.
- * 
- * @version IEEE Std 1003.1, 2013 Edition
+ * @brief Gets kernel cache statistics.
  */
-void *memset(void *s, int c, size_t n)
+int cachestat(int cache, struct cachestat *buf)
 {
-	unsigned char *p;
+	int ret;
 	
-	p = s;
+	__asm__ volatile (
+		SYSCALL_TRAP
+		: "=a" (ret)
+		: "0" (NR_cachestat),
+		  "b" (cache),
+		  "c" (buf)
+	);
 	
-	while (n-- > 0)
-		*p++ = c;
+	/* Error. */
+	if (ret < 0)
+	{
+		errno = -ret;
+		return (-1);
+	}
 	
-	return (s);
+	return (ret);
 }
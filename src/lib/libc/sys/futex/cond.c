@@ -0,0 +1,79 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <sys/futex.h>
+#include <limits.h>
+
+/*
+ * Atomically exchanges the state of a mutex.
+ */
+static inline int xchg(volatile int *ptr, int val)
+{
+	__asm__ volatile (
+		"xchgl %0, %1"
+		: "+r" (val), "+m" (*ptr)
+		:
+		: "memory"
+	);
+	
+	return (val);
+}
+
+/*
+ * Initializes a condition variable.
+ */
+void cond_init(cond_t *c)
+{
+	c->seq = 0;
+}
+
+/*
+ * Waits on a condition variable.
+ */
+void cond_wait(cond_t *c, mutex_t *m)
+{
+	int seq;
+	
+	seq = c->seq;
+	
+	mutex_unlock(m);
+	futex((int *)&c->seq, FUTEX_WAIT, seq);
+	
+	/* Others may be waiting too, so take the mutex as contended. */
+	while (xchg(&m->state, 2) != 0)
+		futex((int *)&m->state, FUTEX_WAIT, 2);
+}
+
+/*
+ * Wakes up one process waiting on a condition variable.
+ */
+void cond_signal(cond_t *c)
+{
+	__asm__ volatile ("lock; incl %0" : "+m" (c->seq) : : "memory");
+	futex((int *)&c->seq, FUTEX_WAKE, 1);
+}
+
+/*
+ * Wakes up all processes waiting on a condition variable.
+ */
+void cond_broadcast(cond_t *c)
+{
+	__asm__ volatile ("lock; incl %0" : "+m" (c->seq) : : "memory");
+	futex((int *)&c->seq, FUTEX_WAKE, INT_MAX);
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <sys/futex.h>
+
+/*
+ * Atomically exchanges the state of a mutex.
+ */
+static inline int xchg(volatile int *ptr, int val)
+{
+	__asm__ volatile (
+		"xchgl %0, %1"
+		: "+r" (val), "+m" (*ptr)
+		:
+		: "memory"
+	);
+	
+	return (val);
+}
+
+/*
+ * Initializes a mutex.
+ */
+void mutex_init(mutex_t *m)
+{
+	m->state = 0;
+}
+
+/*
+ * Locks a mutex. The kernel is entered only if the mutex is contended.
+ */
+void mutex_lock(mutex_t *m)
+{
+	/* Fast path. */
+	if (xchg(&m->state, 1) == 0)
+		return;
+	
+	/* Mark as contended and wait. */
+	while (xchg(&m->state, 2) != 0)
+		futex((int *)&m->state, FUTEX_WAIT, 2);
+}
+
+/*
+ * Tries to lock a mutex.
+ */
+int mutex_trylock(mutex_t *m)
+{
+	int old;
+	
+	/* Fail without disturbing a contended mutex. */
+	if (m->state != 0)
+		return (-1);
+	
+	if ((old = xchg(&m->state, 1)) == 0)
+		return (0);
+	
+	/* Someone got it first, keep waiters marked. */
+	if (old == 2)
+		m->state = 2;
+	
+	return (-1);
+}
+
+/*
+ * Unlocks a mutex. The kernel is entered only if there are waiters.
+ */
+void mutex_unlock(mutex_t *m)
+{
+	if (xchg(&m->state, 0) == 2)
+		futex((int *)&m->state, FUTEX_WAKE, 1);
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/clock.h>
+#include <sys/gmon.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/*
+ * Profiling state.
+ */
+static struct
+{
+	unsigned short *buf;  /* Histogram.                */
+	size_t size;          /* Histogram size.           */
+	unsigned long lowpc;  /* Lowest profiled address.  */
+	unsigned long highpc; /* Highest profiled address. */
+} gmon = { NULL, 0, 0, 0 };
+
+/*
+ * Histogram scale. Each bucket covers 2*HISTFRACTION bytes of text.
+ */
+#define GMON_SCALE (0x10000/HISTFRACTION)
+
+/*
+ * Starts profiling the text between two addresses.
+ */
+void monstartup(unsigned long lowpc, unsigned long highpc)
+{
+	/* Already profiling. */
+	if (gmon.buf != NULL)
+		return;
+	
+	lowpc &= ~(2*HISTFRACTION - 1ul);
+	highpc = (highpc + 2*HISTFRACTION - 1) & ~(2*HISTFRACTION - 1ul);
+	
+	/* Empty range. */
+	if (highpc <= lowpc)
+		return;
+	
+	gmon.size = (highpc - lowpc)/HISTFRACTION;
+	if ((gmon.buf = calloc(1, gmon.size)) == NULL)
+		return;
+	
+	gmon.lowpc = lowpc;
+	gmon.highpc = highpc;
+	
+	moncontrol(1);
+}
+
+/*
+ * Turns profiling on or off.
+ */
+void moncontrol(int mode)
+{
+	if (gmon.buf == NULL)
+		return;
+	
+	if (mode)
+		profil(gmon.buf, gmon.size, gmon.lowpc, GMON_SCALE);
+	else
+		profil(NULL, 0, 0, 0);
+}
+
+/*
+ * Stops profiling and writes the profile out.
+ */
+void _mcleanup(void)
+{
+	int fd;             /* Profile file. */
+	struct gmonhdr hdr; /* File header.  */
+	
+	if (gmon.buf == NULL)
+		return;
+	
+	moncontrol(0);
+	
+	hdr.magic = GMON_MAGIC;
+	hdr.lowpc = gmon.lowpc;
+	hdr.highpc = gmon.highpc;
+	hdr.ncnt = gmon.size/sizeof(unsigned short);
+	hdr.scale = GMON_SCALE;
+	hdr.rate = CLOCK_FREQ;
+	
+	if ((fd = open(GMON_OUT, O_WRONLY | O_CREAT | O_TRUNC, 0644)) >= 0)
+	{
+		write(fd, &hdr, sizeof(hdr));
+		write(fd, gmon.buf, gmon.size);
+		close(fd);
+	}
+	
+	free(gmon.buf);
+	gmon.buf = NULL;
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <sys/io_uring.h>
+#include <stddef.h>
+
+/*
+ * Gets the next free submission queue entry of a ring.
+ */
+struct io_uring_sqe *io_uring_get_sqe(struct io_uring_ring *ring)
+{
+	volatile struct io_uring_ring *r = ring;
+	
+	/* Submission queue is full. */
+	if (r->sq_tail - r->sq_head >= r->sq_entries)
+		return (NULL);
+	
+	return (&ring->sqes[r->sq_tail & r->sq_mask]);
+}
+
+/*
+ * Hands the last entry returned by io_uring_get_sqe() over to the kernel.
+ */
+void io_uring_push_sqe(struct io_uring_ring *ring)
+{
+	volatile struct io_uring_ring *r = ring;
+	
+	r->sq_tail++;
+}
+
+/*
+ * Gets the oldest unread completion queue entry of a ring.
+ */
+struct io_uring_cqe *io_uring_peek_cqe(struct io_uring_ring *ring)
+{
+	volatile struct io_uring_ring *r = ring;
+	
+	/* No completions. */
+	if (r->cq_head == r->cq_tail)
+		return (NULL);
+	
+	return (&ring->cqes[r->cq_head & r->cq_mask]);
+}
+
+/*
+ * Gives the last entry returned by io_uring_peek_cqe() back to the kernel.
+ */
+void io_uring_cqe_seen(struct io_uring_ring *ring)
+{
+	volatile struct io_uring_ring *r = ring;
+	
+	r->cq_head++;
+}
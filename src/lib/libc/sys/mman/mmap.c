@@ -0,0 +1,59 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/syscall.h>
+#include <sys/mman.h>
+#include <errno.h>
+
+/*
+ * Largest error number returned by the kernel.
+ */
+#define ERRNO_MAX 4095
+
+/**
+ * @brief Maps a file into memory.
+ * 
+ * @note The mapping address is chosen by the kernel, so @p addr is ignored.
+ */
+void *mmap(void *addr, size_t len, int prot, int flags, int fd, off_t off)
+{
+	unsigned long ret;
+	
+	((void) addr);
+	
+	__asm__ volatile (
+		"int $0x80"
+		: "=a" (ret)
+		: "0" (NR_mmap),
+		  "b" (len),
+		  "c" (prot),
+		  "d" (flags),
+		  "S" (fd),
+		  "D" (off)
+	);
+	
+	/* Error. */
+	if (ret >= (unsigned long)-ERRNO_MAX)
+	{
+		errno = -ret;
+		return (MAP_FAILED);
+	}
+	
+	return ((void *)ret);
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <sys/select.h>
+#include <errno.h>
+#include <poll.h>
+#include <stddef.h>
+
+/*
+ * Waits for file descriptors to become ready. This is built on top
+ * of poll(), so exceptional conditions are reported as hang ups and
+ * errors.
+ */
+int select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *errorfds,
+	struct timeval *timeout)
+{
+	int fd;                        /* Loop index.         */
+	int n;                         /* Polled descriptors. */
+	int ret;                       /* Ready descriptors.  */
+	int ms;                        /* Timeout.            */
+	struct pollfd fds[FD_SETSIZE]; /* Poll list.          */
+	
+	/* Invalid number of descriptors. */
+	if ((nfds < 0) || (nfds > FD_SETSIZE))
+	{
+		errno = EINVAL;
+		return (-1);
+	}
+	
+	/* Build poll list. */
+	for (n = 0, fd = 0; fd < nfds; fd++)
+	{
+		fds[n].fd = fd;
+		fds[n].events = 0;
+		fds[n].revents = 0;
+		
+		if ((readfds != NULL) && (FD_ISSET(fd, readfds)))
+			fds[n].events |= POLLIN;
+		if ((writefds != NULL) && (FD_ISSET(fd, writefds)))
+			fds[n].events |= POLLOUT;
+		if ((errorfds != NULL) && (FD_ISSET(fd, errorfds)))
+			fds[n].events |= POLLPRI;
+		
+		if (fds[n].events != 0)
+			n++;
+	}
+	
+	ms = -1;
+	if (timeout != NULL)
+		ms = timeout->tv_sec*1000 + timeout->tv_usec/1000;
+	
+	if ((ret = poll(fds, n, ms)) < 0)
+		return (-1);
+	
+	/* Bad descriptor. */
+	for (fd = 0; fd < n; fd++)
+	{
+		if (fds[fd].revents & POLLNVAL)
+		{
+			errno = EBADF;
+			return (-1);
+		}
+	}
+	
+	if (readfds != NULL)
+		FD_ZERO(readfds);
+	if (writefds != NULL)
+		FD_ZERO(writefds);
+	if (errorfds != NULL)
+		FD_ZERO(errorfds);
+	
+	/* Report ready descriptors. */
+	for (ret = 0, fd = 0; fd < n; fd++)
+	{
+		if ((fds[fd].events & POLLIN) && (fds[fd].revents & (POLLIN | POLLHUP)))
+		{
+			FD_SET(fds[fd].fd, readfds);
+			ret++;
+		}
+		if ((fds[fd].events & POLLOUT) && (fds[fd].revents & (POLLOUT | POLLERR)))
+		{
+			FD_SET(fds[fd].fd, writefds);
+			ret++;
+		}
+		if ((fds[fd].events & POLLPRI) && (fds[fd].revents & (POLLPRI | POLLERR)))
+		{
+			FD_SET(fds[fd].fd, errorfds);
+			ret++;
+		}
+	}
+	
+	return (ret);
+}
@@ -28,7 +28,7 @@ int semctl(int semid, int cmd, int val)
 	int ret;
 	
 	__asm__ volatile (
-		"int $0x80"
+		SYSCALL_TRAP
 		: "=a" (ret)
 		: "0" (NR_semctl),
 		  "b" (semid),
@@ -28,7 +28,7 @@ int semop(int semid, int op)
 	int ret;
 	
 	__asm__ volatile (
-		"int $0x80"
+		SYSCALL_TRAP
 		: "=a" (ret)
 		: "0" (NR_semop),
 		  "b" (semid),
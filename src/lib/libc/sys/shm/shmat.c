@@ -0,0 +1,51 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/syscall.h>
+#include <sys/shm.h>
+#include <errno.h>
+
+/*
+ * Largest error number returned by the kernel.
+ */
+#define ERRNO_MAX 4095
+
+/*
+ * Attaches a shared memory segment.
+ */
+void *shmat(int shmid)
+{
+	unsigned long ret;
+	
+	__asm__ volatile (
+		SYSCALL_TRAP
+		: "=a" (ret)
+		: "0" (NR_shmat),
+		  "b" (shmid)
+	);
+	
+	/* Error. */
+	if (ret >= (unsigned long)-ERRNO_MAX)
+	{
+		errno = -ret;
+		return ((void *)-1);
+	}
+	
+	return ((void *)ret);
+}
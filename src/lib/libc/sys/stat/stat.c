@@ -29,7 +29,7 @@ int stat(const char *path, struct stat *buf)
 	int ret;
 	
 	__asm__ volatile (
-		"int $0x80"
+		SYSCALL_TRAP
 		: "=a" (ret)
 		: "0" (NR_stat),
 		  "b" (path),
@@ -36,7 +36,7 @@ clock_t times(struct tms *buffer)
 	clock_t elapsed;
 	
 	__asm__ volatile (
-		"int $0x80"
+		SYSCALL_TRAP
 		: "=a" (elapsed)
 		: "0" (NR_times),
 		  "b" (buffer)
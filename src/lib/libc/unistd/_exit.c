@@ -27,7 +27,7 @@
 void _exit(int status)
 {
 	__asm__ volatile(
-		"int $0x80"
+		SYSCALL_TRAP
 		: /* empty. */
 		: "a" (NR__exit),
 		"b" (status)
@@ -28,7 +28,7 @@ unsigned alarm(unsigned seconds)
     unsigned ret;
 
 	__asm__ volatile (
-		"int $0x80"
+		SYSCALL_TRAP
 		: "=a" (ret)
 		: "0" (NR_alarm),
           "b" (seconds)
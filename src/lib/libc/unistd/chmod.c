@@ -29,7 +29,7 @@ int chmod(const char *path, mode_t mode)
 	int ret;
 	
 	__asm__ volatile (
-		"int $0x80"
+		SYSCALL_TRAP
 		: "=a" (ret)
 		: "0" (NR_chmod),
 		  "b" (path),
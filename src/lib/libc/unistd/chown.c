@@ -29,7 +29,7 @@ int chown(const char *path, uid_t owner, gid_t group)
 	int ret;
 	
 	__asm__ volatile (
-		"int $0x80"
+		SYSCALL_TRAP
 		: "=a" (ret)
 		: "0" (NR_chown),
 		  "b" (path),
@@ -29,7 +29,7 @@ int close(int fd)
 	int ret;
 	
 	__asm__ volatile (
-		"int $0x80"
+		SYSCALL_TRAP
 		: "=a" (ret)
 		: "0" (NR_close),
 		  "b" (fd)
@@ -31,7 +31,7 @@ int execve(const char *filename, char *const argv[],  char *const envp[])
 	int ret;
 	
 	__asm__ volatile (
-		"int $0x80"
+		SYSCALL_TRAP
 		: "=a" (ret)
 		: "0" (NR_execve),
 		  "b" (filename),
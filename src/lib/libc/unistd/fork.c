@@ -28,7 +28,7 @@ pid_t fork(void)
 	pid_t pid;
 	
 	__asm__ volatile (
-		"int $0x80"
+		SYSCALL_TRAP
 		: "=a" (pid)
 		: "0" (NR_fork)
 	);
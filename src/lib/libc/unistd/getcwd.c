@@ -17,6 +17,7 @@
  * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <nanvix/syscall.h>
 #include <dirent.h>
 #include <errno.h>
 #include <stdlib.h>
@@ -81,9 +82,10 @@ static int prepend(char *pathname, const char *dirname, size_t n)
 }
 
 /*
- * Gets the pathname of the current working directory.
+ * Rebuilds the pathname of the current working directory by walking up
+ * the directory tree.
  */
-char *getcwd(char *buf, size_t size)
+static char *walkcwd(char *buf, size_t size)
 {
 	ino_t cino;            /* Current dir inode number.  */
 	dev_t cdev;            /* Current dir inode pointer. */
@@ -94,13 +96,6 @@ char *getcwd(char *buf, size_t size)
 	struct dirent *dp;     /* Working directory entry.   */
 	char curdir[PATH_MAX]; /* Current directory.         */
 
-	/* Invalid size. */
-	if (size == 0)
-	{
-		errno = EINVAL;
-		return (NULL);
-	}
-
 	buf[0] = '\0';
 	strcpy(curdir, ".");
 
@@ -162,3 +157,40 @@ error1:
 error0:
 	return (NULL);
 }
+
+/*
+ * Gets the pathname of the current working directory.
+ */
+char *getcwd(char *buf, size_t size)
+{
+	int ret;
+	
+	/* Invalid size. */
+	if (size == 0)
+	{
+		errno = EINVAL;
+		return (NULL);
+	}
+	
+	__asm__ volatile (
+		SYSCALL_TRAP
+		: "=a" (ret)
+		: "0" (NR_getcwd),
+		  "b" (buf),
+		  "c" (size)
+		: "memory"
+	);
+	
+	/* The kernel does not know the path. */
+	if (ret == -ENOENT)
+		return (walkcwd(buf, size));
+	
+	/* Error. */
+	if (ret < 0)
+	{
+		errno = -ret;
+		return (NULL);
+	}
+	
+	return (buf);
+}
@@ -18,6 +18,7 @@
  */
 
 #include <nanvix/syscall.h>
+#include <nanvix/timepage.h>
 #include <unistd.h>
 
 /**
@@ -27,8 +28,12 @@ pid_t getpid(void)
 {
 	pid_t pid;
 	
+	/* Read it from the time page. */
+	if ((pid = TIMEPAGE->pid) != 0)
+		return (pid);
+	
 	__asm__ volatile (
-		"int $0x80"
+		SYSCALL_TRAP
 		: "=a" (pid)
 		: "0" (NR_getpid)
 	);
@@ -29,7 +29,7 @@ uid_t getuid(void)
 	uid_t ret;
 	
 	__asm__ volatile (
-		"int $0x80"
+		SYSCALL_TRAP
 		: "=a" (ret)
 		: "0" (NR_getuid)
 	);
@@ -18,19 +18,64 @@
  */
 
 #include <nanvix/syscall.h>
+#include <nanvix/timepage.h>
 #include <unistd.h>
 #include <errno.h>
+#include <stdint.h>
+
+/*
+ * Reads the time stamp counter.
+ */
+static uint64_t rdtsc(void)
+{
+	uint32_t lo, hi;
+	
+	__asm__ volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+	
+	return (((uint64_t)hi << 32) | lo);
+}
 
 /*
  * Gets sys ticks since initialization, may be useful
  * as seed for random numbers, but mktime would be better.
+ * 
+ * Ticks are read from the time page. Ticks that the clock skipped
+ * while idle are accounted from the time stamp counter, as the
+ * kernel does.
  */
 int gticks()
 {
+	unsigned seq;      /* Sequence counter.   */
+	unsigned t;        /* Ticks.              */
+	unsigned per_tick; /* TSC counts per tick. */
+	uint64_t last;     /* TSC at last tick.   */
+	uint64_t delta;    /* TSC counts since.   */
 	ssize_t ret = 0;
+	
+	/* Time page is available. */
+	if (TIMEPAGE->freq != 0)
+	{
+		do
+		{
+			seq = TIMEPAGE->seq;
+			t = TIMEPAGE->ticks;
+			per_tick = TIMEPAGE->tsc_per_tick;
+			last = TIMEPAGE->tsc_last;
+		} while ((seq & 1) || (seq != TIMEPAGE->seq));
+		
+		if (per_tick)
+		{
+			delta = rdtsc() - last;
+			if (delta >> 32)
+				delta = 0xffffffff;
+			t += (unsigned)delta/per_tick;
+		}
+		
+		return (t);
+	}
 
 	__asm__ volatile (
-		"int $0x80"
+		SYSCALL_TRAP
 		: "=a" (ret)
 		: "0" (NR_gticks)
 	);
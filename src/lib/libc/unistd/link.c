@@ -28,7 +28,7 @@ int link(const char *path1, const char *path2)
 	int ret;
 	
 	__asm__ volatile (
-		"int $0x80"
+		SYSCALL_TRAP
 		: "=a" (ret)
 		: "0" (NR_link),
 		  "b" (path1),
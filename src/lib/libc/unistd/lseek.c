@@ -27,7 +27,7 @@
 off_t lseek(int fd, off_t offset, int whence)
 {
 	__asm__ volatile (
-		"int $0x80"
+		SYSCALL_TRAP
 		: "=a" (offset)
 		: "0" (NR_lseek),
 		  "b" (fd),
@@ -28,7 +28,7 @@ int nice(int incr)
 	int ret;
 	
 	__asm__ volatile (
-		"int $0x80"
+		SYSCALL_TRAP
 		: "=a" (ret)
 		: "0" (NR_nice),
 		  "b" (incr)
@@ -24,14 +24,15 @@
 /*
  * Gets process information
  */
-int ps()
+int ps(int flags)
 {
 	ssize_t ret;
 
 	__asm__ volatile (
-		"int $0x80"
+		SYSCALL_TRAP
 		: "=a" (ret)
-		: "0" (NR_ps)
+		: "0" (NR_ps),
+		  "b" (flags)
 	);
 
 	/* Error. */
@@ -28,7 +28,7 @@ pid_t setpgrp(void)
 	pid_t ret;
 	
 	__asm__ volatile (
-		"int $0x80"
+		SYSCALL_TRAP
 		: "=a" (ret)
 		: "0" (NR_setpgrp)
 	);
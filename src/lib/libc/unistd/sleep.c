@@ -17,32 +17,22 @@
  * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <stdio.h>
+#include <time.h>
 #include <unistd.h>
-#include <signal.h>
-#include <stdlib.h>
-
-/* Signal received */
-volatile int sig_received = SIGALRM;
-
-/* Update signal */
-static void handle_alarm(int signo)
-{
-   sig_received = signo;
-}
 
 /*
  * Puts the current process to sleep.
  */
 unsigned sleep(unsigned seconds)
 {
-    alarm(seconds);
-    signal(SIGALRM, handle_alarm);   
-
-    pause();
-    
-    if (sig_received != SIGALRM)
-        return -1;
-
-    return 0;
+	struct timespec ts;
+	
+	ts.tv_sec = seconds;
+	ts.tv_nsec = 0;
+	
+	/* Interrupted. */
+	if (nanosleep(&ts, &ts) < 0)
+		return (ts.tv_sec + ((ts.tv_nsec > 0) ? 1 : 0));
+	
+	return (0);
 }
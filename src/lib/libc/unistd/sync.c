@@ -26,7 +26,7 @@
 void sync(void)
 {
 	__asm__ volatile(
-		"int $0x80"
+		SYSCALL_TRAP
 		: /* empty. */
 		: "a" (NR_sync)
 	);
@@ -0,0 +1,35 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Suspends execution for microsecond intervals.
+ */
+int usleep(useconds_t useconds)
+{
+	struct timespec ts;
+	
+	ts.tv_sec = useconds/1000000;
+	ts.tv_nsec = (useconds%1000000)*1000;
+	
+	return (nanosleep(&ts, NULL));
+}
@@ -29,7 +29,7 @@ ssize_t write(int fd, const void *buf, size_t n)
 	ssize_t ret;
 	
 	__asm__ volatile (
-		"int $0x80"
+		SYSCALL_TRAP
 		: "=a" (ret)
 		: "0" (NR_write),
 		  "b" (fd),
@@ -28,7 +28,7 @@ int utime(const char *path, struct utimbuf *times)
 	int ret;
 	
 	__asm__ volatile (
-		"int $0x80"
+		SYSCALL_TRAP
 		: "=a" (ret)
 		: "0" (NR_utime),
 		  "b" (path),
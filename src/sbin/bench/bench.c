@@ -0,0 +1,541 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna   <pedrohenriquepenna@gmail.com>
+ *              2016-2016 Davidson Francis <davidsondfgl@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <i386/paging.h>
+#include <nanvix/clock.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "tsc.h"
+
+/* Number of iterations. */
+#define NR_SYSCALL   10000 /* Null and I/O system calls.  */
+#define NR_PIPE       1000 /* Pipe round trips.           */
+#define NR_FORK        100 /* fork() + exit() + wait().   */
+#define NR_EXEC         50 /* fork() + execve() + wait(). */
+#define NR_PAGES       256 /* Pages touched by faults.    */
+
+/* Pipe bandwidth test parameters. */
+#define PIPE_CHUNK (64*1024)     /* Bytes moved per write(). */
+#define PIPE_TOTAL (4*1024*1024) /* Total bytes moved.       */
+
+/* Program re-executed by the execve() benchmark. */
+#define BENCH_PATH "/sbin/bench"
+
+/* Pipe bandwidth buffer. */
+static char pipebuf[PIPE_CHUNK];
+
+/*============================================================================*
+ *                                 helpers                                    *
+ *============================================================================*/
+
+/**
+ * @brief Prints the result of a benchmark.
+ * 
+ * @details One line per benchmark: name, number of operations, cycles per
+ *          operation and nanoseconds per operation.
+ * 
+ * @param name   Benchmark name.
+ * @param n      Number of operations.
+ * @param cycles Elapsed time stamp counter ticks.
+ */
+static void report(const char *name, unsigned n, uint64_t cycles)
+{
+	unsigned cpo; /* Cycles per operation. */
+	
+	cpo = div64(cycles, n);
+	
+	printf("%s %d %d %d\n", name, n, cpo,
+		div64((uint64_t)cpo*1000, tsc_per_us));
+}
+
+/**
+ * @brief Forks the calling process.
+ * 
+ * @details Flushes the standard output first, so that pending output is
+ *          not duplicated in the child.
+ * 
+ * @returns See fork().
+ */
+static pid_t bfork(void)
+{
+	fflush(stdout);
+	
+	return (fork());
+}
+
+/*============================================================================*
+ *                              system calls                                  *
+ *============================================================================*/
+
+/**
+ * @brief Measures the cost of a null system call.
+ * 
+ * @returns Zero on success, and non-zero otherwise.
+ */
+static int bench_null(void)
+{
+	uint64_t t0; /* Starting stamp. */
+	
+	t0 = rdtsc();
+	for (int i = 0; i < NR_SYSCALL; i++)
+		getpid();
+	report("null", NR_SYSCALL, rdtsc() - t0);
+	
+	return (0);
+}
+
+/**
+ * @brief Measures the cost of 1-byte reads and writes on the null device.
+ * 
+ * @returns Zero on success, and non-zero otherwise.
+ */
+static int bench_rw(void)
+{
+	int fd;      /* Null device.    */
+	char c;      /* Byte moved.     */
+	uint64_t t0; /* Starting stamp. */
+	
+	if ((fd = open("/dev/null", O_RDWR)) < 0)
+		return (-1);
+	
+	c = 0;
+	
+	t0 = rdtsc();
+	for (int i = 0; i < NR_SYSCALL; i++)
+		read(fd, &c, 1);
+	report("read", NR_SYSCALL, rdtsc() - t0);
+	
+	t0 = rdtsc();
+	for (int i = 0; i < NR_SYSCALL; i++)
+		write(fd, &c, 1);
+	report("write", NR_SYSCALL, rdtsc() - t0);
+	
+	close(fd);
+	
+	return (0);
+}
+
+/*============================================================================*
+ *                                  pipes                                     *
+ *============================================================================*/
+
+/**
+ * @brief Measures the round trip latency of a pipe.
+ * 
+ * @details Parent and child bounce a single byte over a pair of pipes.
+ * 
+ * @returns Zero on success, and non-zero otherwise.
+ */
+static int bench_pipe_lat(void)
+{
+	int p1[2];   /* Parent to child. */
+	int p2[2];   /* Child to parent. */
+	pid_t pid;   /* Child process.   */
+	char c;      /* Byte moved.      */
+	uint64_t t0; /* Starting stamp.  */
+	
+	if (pipe(p1) < 0)
+		return (-1);
+	if (pipe(p2) < 0)
+		return (-1);
+	
+	if ((pid = bfork()) < 0)
+		return (-1);
+	
+	/* Child. */
+	if (pid == 0)
+	{
+		for (int i = 0; i < NR_PIPE; i++)
+		{
+			if (read(p1[0], &c, 1) != 1)
+				break;
+			if (write(p2[1], &c, 1) != 1)
+				break;
+		}
+		_exit(EXIT_SUCCESS);
+	}
+	
+	c = 0;
+	
+	t0 = rdtsc();
+	for (int i = 0; i < NR_PIPE; i++)
+	{
+		if (write(p1[1], &c, 1) != 1)
+			break;
+		if (read(p2[0], &c, 1) != 1)
+			break;
+	}
+	report("pipe_lat", NR_PIPE, rdtsc() - t0);
+	
+	wait(NULL);
+	
+	close(p1[0]); close(p1[1]);
+	close(p2[0]); close(p2[1]);
+	
+	return (0);
+}
+
+/**
+ * @brief Measures the bandwidth of a pipe.
+ * 
+ * @details The parent streams PIPE_TOTAL bytes to the child, which drains
+ *          them. One operation is one kilobyte moved, so the bandwidth in
+ *          kilobytes per second is 10^9 divided by the last column.
+ * 
+ * @returns Zero on success, and non-zero otherwise.
+ */
+static int bench_pipe_bw(void)
+{
+	int p[2];    /* Pipe.           */
+	pid_t pid;   /* Child process.  */
+	ssize_t n;   /* Bytes moved.    */
+	uint64_t t0; /* Starting stamp. */
+	
+	if (pipe(p) < 0)
+		return (-1);
+	
+	if ((pid = bfork()) < 0)
+		return (-1);
+	
+	/* Child. */
+	if (pid == 0)
+	{
+		close(p[1]);
+		while (read(p[0], pipebuf, PIPE_CHUNK) > 0)
+			/* noop */ ;
+		_exit(EXIT_SUCCESS);
+	}
+	
+	close(p[0]);
+	
+	t0 = rdtsc();
+	for (int i = 0; i < PIPE_TOTAL; i += n)
+	{
+		if ((n = write(p[1], pipebuf, PIPE_CHUNK)) <= 0)
+			break;
+	}
+	close(p[1]);
+	wait(NULL);
+	report("pipe_bw", PIPE_TOTAL/1024, rdtsc() - t0);
+	
+	return (0);
+}
+
+/*============================================================================*
+ *                                processes                                   *
+ *============================================================================*/
+
+/**
+ * @brief Measures the cost of creating a process that exits at once.
+ * 
+ * @returns Zero on success, and non-zero otherwise.
+ */
+static int bench_fork(void)
+{
+	pid_t pid;   /* Child process.  */
+	uint64_t t0; /* Starting stamp. */
+	
+	fflush(stdout);
+	
+	t0 = rdtsc();
+	for (int i = 0; i < NR_FORK; i++)
+	{
+		if ((pid = fork()) < 0)
+			return (-1);
+		
+		/* Child. */
+		if (pid == 0)
+			_exit(EXIT_SUCCESS);
+		
+		wait(NULL);
+	}
+	report("fork", NR_FORK, rdtsc() - t0);
+	
+	return (0);
+}
+
+/**
+ * @brief Measures the cost of creating a process that runs a new program.
+ * 
+ * @details The child re-executes this program with the "nop" argument,
+ *          which makes it exit right away.
+ * 
+ * @returns Zero on success, and non-zero otherwise.
+ */
+static int bench_exec(void)
+{
+	pid_t pid;   /* Child process.  */
+	uint64_t t0; /* Starting stamp. */
+	char *const args[] = { "bench", "nop", NULL };
+	
+	fflush(stdout);
+	
+	t0 = rdtsc();
+	for (int i = 0; i < NR_EXEC; i++)
+	{
+		if ((pid = fork()) < 0)
+			return (-1);
+		
+		/* Child. */
+		if (pid == 0)
+		{
+			execve(BENCH_PATH, args, environ);
+			_exit(EXIT_FAILURE);
+		}
+		
+		wait(NULL);
+	}
+	report("exec", NR_EXEC, rdtsc() - t0);
+	
+	return (0);
+}
+
+/*============================================================================*
+ *                               page faults                                  *
+ *============================================================================*/
+
+/**
+ * @brief Touches pages.
+ * 
+ * @param p      Start address.
+ * @param npages Number of pages.
+ * @param wr     Write to pages?
+ * 
+ * @returns Elapsed time stamp counter ticks.
+ */
+static uint64_t touch(volatile char *p, int npages, int wr)
+{
+	char c;      /* Byte read.      */
+	uint64_t t0; /* Starting stamp. */
+	
+	c = 0;
+	
+	t0 = rdtsc();
+	for (int i = 0; i < npages; i++)
+	{
+		if (wr)
+			p[i*PAGE_SIZE] = 1;
+		else
+			c += p[i*PAGE_SIZE];
+	}
+	
+	((void)c);
+	
+	return (rdtsc() - t0);
+}
+
+/**
+ * @brief Measures the cost of a demand zero page fault.
+ * 
+ * @details Runs in a child, so that the grown heap is released afterwards.
+ * 
+ * @returns Zero on success, and non-zero otherwise.
+ */
+static int bench_fault_zero(void)
+{
+	char *p;   /* Fresh memory.  */
+	pid_t pid; /* Child process. */
+	
+	if ((pid = bfork()) < 0)
+		return (-1);
+	
+	/* Child. */
+	if (pid == 0)
+	{
+		if ((p = sbrk(NR_PAGES*PAGE_SIZE)) == (void *)-1)
+			exit(EXIT_FAILURE);
+		
+		report("fault_zero", NR_PAGES, touch(p, NR_PAGES, 1));
+		exit(EXIT_SUCCESS);
+	}
+	
+	wait(NULL);
+	
+	return (0);
+}
+
+/**
+ * @brief Measures the cost of a page fault filled from a file.
+ * 
+ * @details Maps this program's own image privately and reads every page
+ *          of it once.
+ * 
+ * @returns Zero on success, and non-zero otherwise.
+ */
+static int bench_fault_fill(void)
+{
+	int fd;     /* Mapped file.   */
+	int npages; /* Pages in file. */
+	off_t size; /* File size.     */
+	char *p;    /* Mapping.       */
+	
+	if ((fd = open(BENCH_PATH, O_RDONLY)) < 0)
+		return (-1);
+	
+	if ((size = lseek(fd, 0, SEEK_END)) < 0)
+		goto error0;
+	
+	if ((npages = size/PAGE_SIZE) == 0)
+		goto error0;
+	
+	p = mmap(NULL, npages*PAGE_SIZE, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (p == MAP_FAILED)
+		goto error0;
+	
+	report("fault_fill", npages, touch(p, npages, 0));
+	
+	munmap(p, npages*PAGE_SIZE);
+	close(fd);
+	
+	return (0);
+
+error0:
+	close(fd);
+	return (-1);
+}
+
+/**
+ * @brief Measures the cost of a copy-on-write page fault.
+ * 
+ * @details The parent dirties a buffer and forks; the child then writes to
+ *          every page of it, breaking the sharing one page at a time.
+ * 
+ * @returns Zero on success, and non-zero otherwise.
+ */
+static int bench_fault_cow(void)
+{
+	char *p;   /* Shared buffer. */
+	pid_t pid; /* Child process. */
+	
+	if ((p = malloc(NR_PAGES*PAGE_SIZE)) == NULL)
+		return (-1);
+	
+	memset(p, 1, NR_PAGES*PAGE_SIZE);
+	
+	if ((pid = bfork()) < 0)
+	{
+		free(p);
+		return (-1);
+	}
+	
+	/* Child. */
+	if (pid == 0)
+	{
+		report("fault_cow", NR_PAGES, touch(p, NR_PAGES, 1));
+		exit(EXIT_SUCCESS);
+	}
+	
+	wait(NULL);
+	free(p);
+	
+	return (0);
+}
+
+/*============================================================================*
+ *                                  main                                      *
+ *============================================================================*/
+
+/**
+ * @brief Benchmarks.
+ */
+static struct
+{
+	const char *name;   /* Name.      */
+	int (*fn)(void);    /* Benchmark. */
+} benchmarks[] = {
+	{ "null",       bench_null       },
+	{ "rw",         bench_rw         },
+	{ "pipe_lat",   bench_pipe_lat   },
+	{ "pipe_bw",    bench_pipe_bw    },
+	{ "fork",       bench_fork       },
+	{ "exec",       bench_exec       },
+	{ "fault_zero", bench_fault_zero },
+	{ "fault_fill", bench_fault_fill },
+	{ "fault_cow",  bench_fault_cow  },
+	{ NULL,         NULL             }
+};
+
+/**
+ * @brief Prints program usage and exits.
+ */
+static void usage(void)
+{
+	printf("Usage: bench [benchmark...]\n\n");
+	printf("Runs all benchmarks when none is given. Benchmarks:\n");
+	for (int i = 0; benchmarks[i].name != NULL; i++)
+		printf("  %s\n", benchmarks[i].name);
+	printf("\nOutput: <name> <operations> <cycles/op> <ns/op>\n");
+	
+	exit(EXIT_SUCCESS);
+}
+
+/**
+ * @brief Runs a benchmark.
+ * 
+ * @param name Benchmark name.
+ */
+static void run(const char *name)
+{
+	for (int i = 0; benchmarks[i].name != NULL; i++)
+	{
+		if (!strcmp(benchmarks[i].name, name))
+		{
+			if (benchmarks[i].fn())
+				fprintf(stderr, "bench: %s failed\n", name);
+			return;
+		}
+	}
+	
+	usage();
+}
+
+/**
+ * @brief Runs microbenchmarks.
+ */
+int main(int argc, char **argv)
+{
+	/* Re-executed by the execve() benchmark. */
+	if ((argc == 2) && (!strcmp(argv[1], "nop")))
+		return (EXIT_SUCCESS);
+	
+	calibrate();
+	printf("# tsc %d MHz\n", tsc_per_us);
+	
+	/* Run all benchmarks. */
+	if (argc <= 1)
+	{
+		for (int i = 0; benchmarks[i].name != NULL; i++)
+			run(benchmarks[i].name);
+	}
+	
+	/* Run selected benchmarks. */
+	else
+	{
+		for (int i = 1; i < argc; i++)
+			run(argv[i]);
+	}
+	
+	return (EXIT_SUCCESS);
+}
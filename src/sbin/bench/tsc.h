@@ -0,0 +1,106 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna   <pedrohenriquepenna@gmail.com>
+ *              2016-2016 Davidson Francis <davidsondfgl@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TSC_H_
+#define TSC_H_
+
+	#include <nanvix/clock.h>
+	#include <stdint.h>
+	#include <unistd.h>
+
+	/* Time stamp counter ticks per microsecond. */
+	static unsigned tsc_per_us = 0;
+
+	/**
+	 * @brief Reads the time stamp counter.
+	 * 
+	 * @returns The current value of the time stamp counter.
+	 */
+	static inline uint64_t rdtsc(void)
+	{
+		uint32_t lo, hi;
+		
+		__asm__ volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+		
+		return (((uint64_t)hi << 32) | lo);
+	}
+
+	/**
+	 * @brief Divides a 64-bit number by a 32-bit one.
+	 * 
+	 * @details Long division by hand, so that no 64-bit division helper from
+	 *          the compiler runtime is required. The quotient is clamped to
+	 *          32 bits.
+	 * 
+	 * @param n Dividend.
+	 * @param d Divisor.
+	 * 
+	 * @returns n/d.
+	 */
+	static inline unsigned div64(uint64_t n, unsigned d)
+	{
+		uint64_t q; /* Quotient.  */
+		uint64_t r; /* Remainder. */
+		
+		if (d == 0)
+			return (0);
+		
+		q = r = 0;
+		for (int i = 63; i >= 0; i--)
+		{
+			r = (r << 1) | ((n >> i) & 1);
+			if (r >= d)
+			{
+				r -= d;
+				q |= (uint64_t)1 << i;
+			}
+		}
+		
+		return ((q >> 32) ? 0xffffffff : (unsigned)q);
+	}
+
+	/**
+	 * @brief Calibrates the time stamp counter against the system clock.
+	 * 
+	 * @details Aligns to a clock tick edge and counts time stamp counter
+	 *          ticks across ten clock ticks.
+	 */
+	static inline void calibrate(void)
+	{
+		int t;       /* Starting tick.  */
+		uint64_t t0; /* Starting stamp. */
+		uint64_t t1; /* Ending stamp.   */
+		
+		t = gticks();
+		while (gticks() == t)
+			/* noop */ ;
+		
+		t = gticks();
+		t0 = rdtsc();
+		while (gticks() < t + 10)
+			/* noop */ ;
+		t1 = rdtsc();
+		
+		tsc_per_us = div64(t1 - t0, 10*(1000000/CLOCK_FREQ));
+		if (tsc_per_us == 0)
+			tsc_per_us = 1;
+	}
+
+#endif /* TSC_H_ */
@@ -0,0 +1,102 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna   <pedrohenriquepenna@gmail.com>
+ *              2016-2016 Davidson Francis <davidsondfgl@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <sys/wait.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/**
+ * @brief Benchmark suites, in the order they are run.
+ */
+static const struct
+{
+	const char *name;    /* Suite name.          */
+	char *const argv[4]; /* Program and options. */
+} suites[] = {
+	{ "bench",        { "/sbin/bench",      NULL, NULL, NULL } },
+	{ "fsbench",      { "/sbin/fsbench",    NULL, NULL, NULL } },
+	{ "fsbench-cold", { "/sbin/fsbench",    "-c", NULL, NULL } },
+	{ "mmbench",      { "/sbin/mmbench",    NULL, NULL, NULL } },
+	{ "schedbench",   { "/sbin/schedbench", NULL, NULL, NULL } },
+	{ NULL,           { NULL,               NULL, NULL, NULL } }
+};
+
+/**
+ * @brief Runs a benchmark suite and waits for it.
+ * 
+ * @param i Suite number.
+ * 
+ * @returns The exit status of the suite.
+ */
+static int suite_run(int i)
+{
+	pid_t pid;  /* Child process. */
+	int status; /* Exit status.   */
+	
+	fflush(stdout);
+	
+	if ((pid = fork()) < 0)
+		return (-1);
+	
+	/* Child. */
+	if (pid == 0)
+	{
+		execve(suites[i].argv[0], suites[i].argv, (char *const *)environ);
+		_exit(EXIT_FAILURE);
+	}
+	
+	/* Wait for the suite, reaping anything else it left behind. */
+	while (wait(&status) != pid)
+	{
+		if (errno == ECHILD)
+			return (-1);
+	}
+	
+	return (status);
+}
+
+/**
+ * @brief Runs all benchmark suites and shuts the system down.
+ * 
+ * @details Meant to be started by init on the serial console, so that a
+ *          host can capture results. Every suite is delimited by markers
+ *          that the host side scripts look for.
+ */
+int main(int argc, char **argv)
+{
+	((void)argc);
+	((void)argv);
+	
+	for (int i = 0; suites[i].name != NULL; i++)
+	{
+		printf("### suite %s\n", suites[i].name);
+		printf("### end %s %d\n", suites[i].name, suite_run(i));
+	}
+	
+	printf("### done\n");
+	fflush(stdout);
+	
+	sync();
+	shutdown();
+	
+	return (EXIT_SUCCESS);
+}
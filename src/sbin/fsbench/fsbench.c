@@ -0,0 +1,511 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna   <pedrohenriquepenna@gmail.com>
+ *              2016-2016 Davidson Francis <davidsondfgl@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <sys/cachestat.h>
+#include <sys/stat.h>
+#include <nanvix/clock.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../bench/tsc.h"
+
+/* Test parameters. */
+#define FILE_SIZE   (1024*1024) /* Size of the test file.          */
+#define NR_RANDOM           256 /* Random requests per test.       */
+#define NR_FILES             64 /* Small files in a directory.     */
+#define SMALL_SIZE          128 /* Size of a small file.           */
+#define NR_LOOKUP           200 /* Deep path lookups.              */
+#define LOOKUP_DEPTH         16 /* Components in a deep path.      */
+#define NR_SYNC              16 /* sync() calls.                   */
+#define SYNC_SIZE   (16*1024)   /* Bytes dirtied before a sync().  */
+#define NR_OPS_MAX   (FILE_SIZE/512) /* Maximum operations per test. */
+
+/* Request sizes for data tests. */
+static const unsigned sizes[] = { 512, 4096, 65536, 0 };
+
+/* Drop caches before each measurement? */
+static int cold = 0;
+
+/* Working directory. */
+static const char *dir = "/home";
+
+/* Latencies of the current test (in time stamp counter ticks). */
+static unsigned lat[NR_OPS_MAX];
+
+/* Number of operations in the current test. */
+static unsigned nops = 0;
+
+/* Data buffer. */
+static char buffer[65536];
+
+/*============================================================================*
+ *                                 helpers                                    *
+ *============================================================================*/
+
+/**
+ * @brief Drops kernel caches, if running cache-cold.
+ */
+static void drop(void)
+{
+	if (!cold)
+		return;
+	
+	if (cachestat(CACHE_DROP, NULL) < 0)
+	{
+		fprintf(stderr, "fsbench: cannot drop caches\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+/**
+ * @brief Builds a path name in the working directory.
+ * 
+ * @param path   Location where the path name shall be stored.
+ * @param prefix File name prefix.
+ * @param n      File number.
+ */
+static void mkpath(char *path, const char *prefix, unsigned n)
+{
+	char digits[12]; /* File number, reversed. */
+	int i;           /* Number of digits.      */
+	
+	strcpy(path, dir);
+	strcat(path, "/");
+	strcat(path, prefix);
+	
+	i = 0;
+	do
+	{
+		digits[i++] = '0' + n%10;
+		n /= 10;
+	} while (n > 0);
+	
+	path += strlen(path);
+	while (i > 0)
+		*path++ = digits[--i];
+	*path = '\0';
+}
+
+/**
+ * @brief Starts a test.
+ */
+static void start(void)
+{
+	nops = 0;
+}
+
+/**
+ * @brief Records the latency of an operation.
+ * 
+ * @param t0 Time stamp taken when the operation started.
+ */
+static void record(uint64_t t0)
+{
+	uint64_t dt; /* Elapsed ticks. */
+	
+	dt = rdtsc() - t0;
+	
+	if (nops < NR_OPS_MAX)
+		lat[nops++] = (dt >> 32) ? 0xffffffff : (unsigned)dt;
+}
+
+/**
+ * @brief Compares two latencies.
+ */
+static int cmp(const void *a, const void *b)
+{
+	unsigned x = *(const unsigned *)a;
+	unsigned y = *(const unsigned *)b;
+	
+	return ((x < y) ? -1 : (x > y));
+}
+
+/**
+ * @brief Converts time stamp counter ticks to nanoseconds.
+ */
+static unsigned ns(unsigned cycles)
+{
+	return (div64((uint64_t)cycles*1000, tsc_per_us));
+}
+
+/**
+ * @brief Prints the result of a test.
+ * 
+ * @details One line per test: name, request size, number of operations,
+ *          MB/s, operations per second and the 50th, 90th and 99th
+ *          percentiles and maximum of the operation latency, in
+ *          nanoseconds. Throughput is computed over the operations alone,
+ *          excluding cache drops.
+ * 
+ * @param name  Test name.
+ * @param size  Request size (zero for metadata tests).
+ * @param bytes Bytes moved.
+ */
+static void report(const char *name, unsigned size, unsigned bytes)
+{
+	uint64_t total; /* Total latency.         */
+	unsigned us;    /* Total latency (in us). */
+	unsigned mbps;  /* Hundredths of MB/s.    */
+	
+	if (nops == 0)
+	{
+		printf("%s %d 0 0.00 0 0 0 0 0\n", name, size);
+		return;
+	}
+	
+	total = 0;
+	for (unsigned i = 0; i < nops; i++)
+		total += lat[i];
+	if ((us = div64(total, tsc_per_us)) == 0)
+		us = 1;
+	
+	mbps = div64(((uint64_t)(bytes/1024)*100000000) >> 10, us);
+	
+	qsort(lat, nops, sizeof(unsigned), cmp);
+	
+	printf("%s %d %d %d.%d%d %d %d %d %d %d\n",
+		name, size, nops,
+		mbps/100, (mbps/10)%10, mbps%10,
+		div64((uint64_t)nops*1000000, us),
+		ns(lat[(nops*50)/100]), ns(lat[(nops*90)/100]),
+		ns(lat[(nops*99)/100]), ns(lat[nops - 1]));
+}
+
+/*============================================================================*
+ *                                data tests                                  *
+ *============================================================================*/
+
+/**
+ * @brief Measures sequential and random reads and writes.
+ * 
+ * @param size Request size.
+ * 
+ * @returns Zero on success, and non-zero otherwise.
+ */
+static int data_test(unsigned size)
+{
+	int fd;           /* Test file.        */
+	off_t off;        /* File offset.      */
+	uint64_t t0;      /* Starting stamp.   */
+	char path[64];    /* Test file name.   */
+	unsigned nblocks; /* Requests in file. */
+	
+	mkpath(path, "fsbench.", size);
+	nblocks = FILE_SIZE/size;
+	
+	if ((fd = open(path, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR)) < 0)
+		return (-1);
+	
+	/* Sequential write. */
+	start();
+	for (unsigned i = 0; i < nblocks; i++)
+	{
+		t0 = rdtsc();
+		if (write(fd, buffer, size) != (ssize_t)size)
+			goto error0;
+		record(t0);
+	}
+	fsync(fd);
+	report("seq_write", size, FILE_SIZE);
+	
+	/* Sequential read. */
+	drop();
+	lseek(fd, 0, SEEK_SET);
+	start();
+	for (unsigned i = 0; i < nblocks; i++)
+	{
+		t0 = rdtsc();
+		if (read(fd, buffer, size) != (ssize_t)size)
+			goto error0;
+		record(t0);
+	}
+	report("seq_read", size, FILE_SIZE);
+	
+	/* Random read. */
+	drop();
+	srand(size);
+	start();
+	for (unsigned i = 0; i < NR_RANDOM; i++)
+	{
+		off = (rand()%nblocks)*size;
+		
+		t0 = rdtsc();
+		lseek(fd, off, SEEK_SET);
+		if (read(fd, buffer, size) != (ssize_t)size)
+			goto error0;
+		record(t0);
+	}
+	report("rand_read", size, NR_RANDOM*size);
+	
+	/* Random write. */
+	drop();
+	start();
+	for (unsigned i = 0; i < NR_RANDOM; i++)
+	{
+		off = (rand()%nblocks)*size;
+		
+		t0 = rdtsc();
+		lseek(fd, off, SEEK_SET);
+		if (write(fd, buffer, size) != (ssize_t)size)
+			goto error0;
+		record(t0);
+	}
+	fsync(fd);
+	report("rand_write", size, NR_RANDOM*size);
+	
+	close(fd);
+	unlink(path);
+	
+	return (0);
+
+error0:
+	close(fd);
+	unlink(path);
+	return (-1);
+}
+
+/*============================================================================*
+ *                              metadata tests                                *
+ *============================================================================*/
+
+/**
+ * @brief Measures creation, lookup and removal of small files.
+ * 
+ * @returns Zero on success, and non-zero otherwise.
+ */
+static int meta_test(void)
+{
+	int fd;         /* Small file.     */
+	uint64_t t0;    /* Starting stamp. */
+	char path[64];  /* File name.      */
+	struct stat st; /* File status.    */
+	
+	/* Create. */
+	start();
+	for (unsigned i = 0; i < NR_FILES; i++)
+	{
+		mkpath(path, "f", i);
+		
+		t0 = rdtsc();
+		if ((fd = creat(path, S_IRUSR | S_IWUSR)) < 0)
+			return (-1);
+		write(fd, buffer, SMALL_SIZE);
+		close(fd);
+		record(t0);
+	}
+	report("create", SMALL_SIZE, NR_FILES*SMALL_SIZE);
+	
+	/* Stat. */
+	drop();
+	start();
+	for (unsigned i = 0; i < NR_FILES; i++)
+	{
+		mkpath(path, "f", i);
+		
+		t0 = rdtsc();
+		if (stat(path, &st) < 0)
+			return (-1);
+		record(t0);
+	}
+	report("stat", 0, 0);
+	
+	/* Unlink. */
+	drop();
+	start();
+	for (unsigned i = 0; i < NR_FILES; i++)
+	{
+		mkpath(path, "f", i);
+		
+		t0 = rdtsc();
+		if (unlink(path) < 0)
+			return (-1);
+		record(t0);
+	}
+	report("unlink", 0, 0);
+	
+	return (0);
+}
+
+/**
+ * @brief Measures lookups of deep path names.
+ * 
+ * @details Deep paths are built by walking in and out of /dev, so that no
+ *          directory tree has to be created. In cache-cold mode, caches are
+ *          dropped before every lookup.
+ * 
+ * @returns Zero on success, and non-zero otherwise.
+ */
+static int lookup_test(void)
+{
+	uint64_t t0;    /* Starting stamp. */
+	struct stat st; /* File status.    */
+	char path[LOOKUP_DEPTH*8 + 16];
+	
+	path[0] = '\0';
+	for (int i = 0; i < LOOKUP_DEPTH/2; i++)
+		strcat(path, "/dev/..");
+	strcat(path, "/dev/null");
+	
+	start();
+	for (unsigned i = 0; i < NR_LOOKUP; i++)
+	{
+		drop();
+		
+		t0 = rdtsc();
+		if (stat(path, &st) < 0)
+			return (-1);
+		record(t0);
+	}
+	report("lookup", LOOKUP_DEPTH + 2, 0);
+	
+	return (0);
+}
+
+/**
+ * @brief Measures the latency of sync().
+ * 
+ * @details Each sync() follows SYNC_SIZE bytes of fresh writes.
+ * 
+ * @returns Zero on success, and non-zero otherwise.
+ */
+static int sync_test(void)
+{
+	int fd;        /* Test file.      */
+	uint64_t t0;   /* Starting stamp. */
+	char path[64]; /* Test file name. */
+	
+	mkpath(path, "fsbench.", 0);
+	
+	if ((fd = creat(path, S_IRUSR | S_IWUSR)) < 0)
+		return (-1);
+	
+	sync();
+	
+	start();
+	for (unsigned i = 0; i < NR_SYNC; i++)
+	{
+		lseek(fd, 0, SEEK_SET);
+		if (write(fd, buffer, SYNC_SIZE) != SYNC_SIZE)
+			break;
+		
+		t0 = rdtsc();
+		sync();
+		record(t0);
+	}
+	report("sync", SYNC_SIZE, NR_SYNC*SYNC_SIZE);
+	
+	close(fd);
+	unlink(path);
+	
+	return (0);
+}
+
+/*============================================================================*
+ *                                  main                                      *
+ *============================================================================*/
+
+/**
+ * @brief Prints program usage and exits.
+ */
+static void usage(void)
+{
+	printf("Usage: fsbench [-c] [-d dir] [test...]\n\n");
+	printf("Tests: data, meta, lookup, sync (default: all)\n");
+	printf("  -c     Drop caches before each measurement (cache-cold)\n");
+	printf("  -d dir Run in directory dir (default: /home)\n\n");
+	printf("Output: <test> <size> <ops> <MB/s> <ops/s> ");
+	printf("<p50 ns> <p90 ns> <p99 ns> <max ns>\n");
+	
+	exit(EXIT_SUCCESS);
+}
+
+/**
+ * @brief Runs a test.
+ * 
+ * @param name Test name.
+ */
+static void run(const char *name)
+{
+	int ret; /* Test failed? */
+	
+	ret = 0;
+	
+	if (!strcmp(name, "data"))
+	{
+		for (int i = 0; sizes[i] != 0; i++)
+			ret |= data_test(sizes[i]);
+	}
+	else if (!strcmp(name, "meta"))
+		ret = meta_test();
+	else if (!strcmp(name, "lookup"))
+		ret = lookup_test();
+	else if (!strcmp(name, "sync"))
+		ret = sync_test();
+	else
+		usage();
+	
+	if (ret)
+		fprintf(stderr, "fsbench: %s test failed\n", name);
+}
+
+/**
+ * @brief Runs filesystem benchmarks.
+ */
+int main(int argc, char **argv)
+{
+	int i; /* Loop index. */
+	
+	/* Parse options. */
+	for (i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-c"))
+			cold = 1;
+		else if ((!strcmp(argv[i], "-d")) && (i + 1 < argc))
+			dir = argv[++i];
+		else if (argv[i][0] == '-')
+			usage();
+		else
+			break;
+	}
+	
+	calibrate();
+	memset(buffer, 'x', sizeof(buffer));
+	printf("# tsc %d MHz, cache %s\n", tsc_per_us, (cold) ? "cold" : "warm");
+	
+	/* Run all tests. */
+	if (i == argc)
+	{
+		run("data");
+		run("meta");
+		run("lookup");
+		run("sync");
+	}
+	
+	/* Run selected tests. */
+	else
+	{
+		for ( ; i < argc; i++)
+			run(argv[i]);
+	}
+	
+	return (EXIT_SUCCESS);
+}
@@ -17,15 +17,20 @@
  * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <nanvix/clock.h>
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
 #include <unistd.h>
 #include <stdarg.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+
 /**
  * @brief Init table size.
  */
@@ -34,26 +39,122 @@
 /**
  * @brief Line size.
  */
-#define LINE_SIZE 80
+#define LINE_SIZE 128
 
 /**
  * @brief Maximum number of arguments.
  */
 #define NARGS 5
 
+/**
+ * @brief File descriptor on which services report readiness.
+ */
+#define READY_FD 3
+
+/**
+ * @brief Poll timeout while services are becoming ready (in ms).
+ */
+#define BOOT_POLL 10
+
+/**
+ * @name Init table actions.
+ */
+/**@{*/
+#define ACTION_RESPAWN 'y' /**< Re-spawn, ready once started.     */
+#define ACTION_ONCE    'n' /**< Run once, ready once started.     */
+#define ACTION_WAIT    'w' /**< Run once, ready on success.       */
+#define ACTION_NOTIFY  'r' /**< Run once, ready on notification. */
+/**@}*/
+
+/**
+ * @name Service states.
+ */
+/**@{*/
+#define STATE_WAITING 0 /**< Dependencies not ready. */
+#define STATE_STARTED 1 /**< Started, not ready.     */
+#define STATE_READY   2 /**< Ready.                  */
+#define STATE_FAILED  3 /**< Failed or skipped.      */
+/**@}*/
+
 /**
  * @brief Init table.
  */
 struct
 {
-	int used;                   /**< Slot in use? */
-	int respaw;                 /**< Re-spawn?    */
-	pid_t pid;                  /**< Process ID.  */
-	char line[LINE_SIZE];       /**< Raw line.    */                 
-	const char *cmd[NARGS + 1]; /**< Command.     */
+	int used;                   /**< Slot in use?          */
+	int respaw;                 /**< Re-spawn?             */
+	int action;                 /**< Action.               */
+	int state;                  /**< Service state.        */
+	int readyfd;                /**< Readiness pipe.       */
+	pid_t pid;                  /**< Process ID.           */
+	clock_t start;              /**< Start time.           */
+	const char *name;           /**< Service name.         */
+	const char *deps;           /**< Dependencies.         */
+	const char *tty;            /**< Terminal.             */
+	char line[LINE_SIZE];       /**< Raw line.             */                 
+	const char *cmd[NARGS + 1]; /**< Command.              */
 	
 } inittab[INITTAB_SIZE];
 
+/**
+ * @brief Boot log.
+ */
+static int logfd = -1;
+
+/**
+ * @brief Boot timeline.
+ */
+static int markfd = -1;
+
+/**
+ * @brief Boot start time.
+ */
+static clock_t boot;
+
+/**
+ * @brief Writes a message to the boot log.
+ * 
+ * @param fmt Message format.
+ */
+static void bootlog(const char *fmt, ...)
+{
+	va_list args;          /* Variable arguments. */
+	char buf[2*LINE_SIZE]; /* Message buffer.     */
+	
+	if (logfd < 0)
+		return;
+	
+	va_start(args, fmt);
+	vsprintf(buf, fmt, args);
+	va_end(args);
+	
+	write(logfd, buf, strlen(buf));
+}
+
+/**
+ * @brief Marks a boot phase in the boot timeline.
+ * 
+ * @param name Service name.
+ * @param what What the service has just done.
+ */
+static void bootmark(const char *name, const char *what)
+{
+	char buf[2*LINE_SIZE]; /* Phase name. */
+	
+	if (markfd < 0)
+		return;
+	
+	strcpy(buf, name);
+	strcat(buf, " ");
+	strcat(buf, what);
+	write(markfd, buf, strlen(buf));
+}
+
+/**
+ * @brief Converts clock ticks to milliseconds.
+ */
+#define TICKS_TO_MS(t) ((t)*(1000/CLOCK_FREQ))
+
 /**
  * @brief Reads a line from a file.
  * 
@@ -88,11 +189,19 @@ static int readline(int fd, char *buf, size_t length)
 /**
  * @brief Reads init table into memory.
  * 
+ * @details Each line reads
+ * 
+ *     action [@name] [<dep,...] [/dev/ttyN] path argv...
+ * 
+ *          where action is one of the ACTION_* characters. A line is
+ *          started only when all the services it depends on are ready.
+ * 
  * @returns Zero on successful completion and non-zero otherwise.
  */
 static int inittab_read(void)
 {	
 	int fd;
+	const char *tok;
 	
 	/* Failed to open inittab. */
 	if ((fd = open("/etc/inittab", O_RDONLY)) < 0)
@@ -110,16 +219,53 @@ static int inittab_read(void)
 			break;
 		
 		inittab[i].used = 1;
-		inittab[i].respaw = (inittab[i].line[0] == 'y') ? 1 : 0;
+		inittab[i].action = inittab[i].line[0];
+		inittab[i].respaw = (inittab[i].action == ACTION_RESPAWN) ? 1 : 0;
+		inittab[i].state = STATE_WAITING;
+		inittab[i].readyfd = -1;
+		inittab[i].pid = -1;
+		inittab[i].name = NULL;
+		inittab[i].deps = NULL;
 		
 		/* Parse command. */
-		inittab[i].cmd[0] = strtok(&inittab[i].line[2], " ");
+		inittab[i].tty = "/dev/tty";
+		tok = strtok(&inittab[i].line[2], " ");
+		
+		/* Service name given. */
+		if ((tok != NULL) && (*tok == '@'))
+		{
+			inittab[i].name = tok + 1;
+			tok = strtok(NULL, " ");
+		}
+		
+		/* Dependencies given. */
+		if ((tok != NULL) && (*tok == '<'))
+		{
+			inittab[i].deps = tok + 1;
+			tok = strtok(NULL, " ");
+		}
+		
+		/* Terminal given. */
+		if ((tok != NULL) && (!strncmp(tok, "/dev/", 5)))
+		{
+			inittab[i].tty = tok;
+			tok = strtok(NULL, " ");
+		}
+		inittab[i].cmd[0] = tok;
 		for (int j = 1; j < NARGS; j++)
 		{
 			if ((inittab[i].cmd[j] = strtok(NULL, " ")) == NULL)
 				break;
 		}
 		inittab[i].cmd[NARGS] = NULL;
+		
+		/* No command. */
+		if (inittab[i].cmd[0] == NULL)
+			inittab[i].state = STATE_FAILED;
+		
+		/* Unnamed services are known by their command. */
+		if (inittab[i].name == NULL)
+			inittab[i].name = inittab[i].cmd[0];
 	}
 	
 	/* House keeping. */
@@ -133,11 +279,32 @@ static int inittab_read(void)
  */
 static void spawn(int i)
 {
+	int fd[2];
+	
+	fd[0] = fd[1] = -1;
+	
+	/* Readiness pipe. */
+	if (inittab[i].action == ACTION_NOTIFY)
+	{
+		if (pipe(fd) < 0)
+		{
+			inittab[i].pid = -1;
+			return;
+		}
+	}
+	
 	inittab[i].pid = fork();
 			
 	/* Failed to fork. */
 	if (inittab[i].pid < 0)
+	{
+		if (fd[0] >= 0)
+		{
+			close(fd[0]);
+			close(fd[1]);
+		}
 		return;
+	}
 			
 	/* Child process. */
 	if (inittab[i].pid == 0)
@@ -147,16 +314,264 @@ static void spawn(int i)
 		
 		setpgrp();
 		
+		/* Keep only the readiness pipe. */
+		if ((fd[1] >= 0) && (fd[1] != READY_FD))
+		{
+			dup2(fd[1], READY_FD);
+			fd[1] = READY_FD;
+		}
+		for (int j = 0; j < OPEN_MAX; j++)
+		{
+			if (j != fd[1])
+				close(j);
+		}
+		
 		/* Open standard output streams. */
-		open("/dev/tty", O_RDONLY);
-		open("/dev/tty", O_WRONLY);
-		open("/dev/tty", O_WRONLY);
+		open(inittab[i].tty, O_RDONLY);
+		open(inittab[i].tty, O_WRONLY);
+		open(inittab[i].tty, O_WRONLY);
 		
 		/* Execute! */
 		cmd = inittab[i].cmd[0];
 		args = &inittab[i].cmd[1];
 		_exit(execve(cmd, (char *const*)args, (char *const*)environ));
 	}
+	
+	inittab[i].start = gticks();
+	bootmark(inittab[i].name, "started");
+	
+	if (fd[0] >= 0)
+	{
+		close(fd[1]);
+		inittab[i].readyfd = fd[0];
+	}
+}
+
+/**
+ * @brief Marks a service as ready or failed.
+ */
+static void settle(int i, int state)
+{
+	if (inittab[i].readyfd >= 0)
+	{
+		close(inittab[i].readyfd);
+		inittab[i].readyfd = -1;
+	}
+	
+	inittab[i].state = state;
+	
+	bootmark(inittab[i].name, (state == STATE_READY) ? "ready" : "failed");
+	bootlog("init: %s %s after %d ms\n", inittab[i].name,
+		(state == STATE_READY) ? "ready" : "failed",
+		(int)TICKS_TO_MS(gticks() - inittab[i].start));
+}
+
+/**
+ * @brief Gets the state of the dependencies of a service.
+ * 
+ * @returns STATE_READY if all dependencies are ready, STATE_FAILED if
+ *          any of them failed or does not exist, and STATE_WAITING
+ *          otherwise.
+ */
+static int depstate(int i)
+{
+	int ret;         /* Return value.       */
+	int found;       /* Dependency found?   */
+	size_t len;      /* Dependency length.  */
+	const char *dep; /* Working dependency. */
+	
+	ret = STATE_READY;
+	
+	for (dep = inittab[i].deps; (dep != NULL) && (*dep != '\0'); dep += len)
+	{
+		if (*dep == ',')
+		{
+			len = 1;
+			continue;
+		}
+		
+		len = strcspn(dep, ",");
+		
+		found = 0;
+		for (int j = 0; inittab[j].used; j++)
+		{
+			if ((inittab[j].name == NULL) || (strlen(inittab[j].name) != len))
+				continue;
+			if (strncmp(inittab[j].name, dep, len))
+				continue;
+			
+			found = 1;
+			if (inittab[j].state == STATE_FAILED)
+				return (STATE_FAILED);
+			if (inittab[j].state != STATE_READY)
+				ret = STATE_WAITING;
+		}
+		
+		if (!found)
+			return (STATE_FAILED);
+	}
+	
+	return (ret);
+}
+
+/**
+ * @brief Starts every service whose dependencies are ready.
+ * 
+ * @returns The number of services that are started but not ready.
+ */
+static int start(void)
+{
+	int pending; /* Services not ready. */
+	int changed; /* Something changed?  */
+	
+	do
+	{
+		changed = 0;
+		pending = 0;
+		
+		for (int i = 0; inittab[i].used; i++)
+		{
+			if (inittab[i].state == STATE_STARTED)
+				pending++;
+			
+			if (inittab[i].state != STATE_WAITING)
+				continue;
+			
+			switch (depstate(i))
+			{
+				case STATE_WAITING:
+					continue;
+				
+				case STATE_FAILED:
+					inittab[i].state = STATE_FAILED;
+					bootlog("init: %s skipped\n", inittab[i].name);
+					changed = 1;
+					continue;
+			}
+			
+			spawn(i);
+			changed = 1;
+			
+			/* Failed to spawn. */
+			if (inittab[i].pid < 0)
+			{
+				inittab[i].start = gticks();
+				settle(i, STATE_FAILED);
+			}
+			
+			/* Ready as soon as started. */
+			else if ((inittab[i].action != ACTION_WAIT) && (inittab[i].action != ACTION_NOTIFY))
+				settle(i, STATE_READY);
+			
+			else
+			{
+				inittab[i].state = STATE_STARTED;
+				pending++;
+			}
+		}
+	} while (changed);
+	
+	return (pending);
+}
+
+/**
+ * @brief Handles the termination of a child process.
+ */
+static void reap(pid_t pid, int status)
+{
+	for (int i = 0; inittab[i].used; i++)
+	{
+		/* Not this process. */
+		if (inittab[i].pid != pid)
+			continue;
+		
+		inittab[i].pid = -1;
+		
+		/* Exit status tells readiness. */
+		if (inittab[i].state == STATE_STARTED)
+		{
+			settle(i, (WIFEXITED(status) && (WEXITSTATUS(status) == 0)) ?
+				STATE_READY : STATE_FAILED);
+		}
+		
+		/* Re-spawn process? */
+		if (inittab[i].respaw)
+			spawn(i);
+	}
+}
+
+/**
+ * @brief Starts services concurrently, in dependency order.
+ * 
+ * @details Readiness is tracked through exit status and readiness
+ *          pipes, which are polled while waiting for children.
+ */
+static void bootstrap(void)
+{
+	int n;                           /* Number of pipes.  */
+	int status;                      /* Exit status.      */
+	pid_t pid;                       /* Child process ID. */
+	int map[INITTAB_SIZE];           /* Pipe to service.  */
+	struct pollfd fds[INITTAB_SIZE]; /* Readiness pipes.  */
+	
+	boot = gticks();
+	
+	while (start() > 0)
+	{
+		/* Gather readiness pipes. */
+		n = 0;
+		for (int i = 0; inittab[i].used; i++)
+		{
+			if ((inittab[i].state != STATE_STARTED) || (inittab[i].readyfd < 0))
+				continue;
+			
+			fds[n].fd = inittab[i].readyfd;
+			fds[n].events = POLLIN;
+			fds[n].revents = 0;
+			map[n++] = i;
+		}
+		
+		/* Readiness notifications. */
+		if ((n > 0) && (poll(fds, n, BOOT_POLL) > 0))
+		{
+			for (int j = 0; j < n; j++)
+			{
+				char ch;
+				
+				if (fds[j].revents == 0)
+					continue;
+				
+				/* Notified. */
+				if (read(fds[j].fd, &ch, 1) == 1)
+					settle(map[j], STATE_READY);
+				
+				/* Closed, exit status will tell. */
+				else
+				{
+					close(inittab[map[j]].readyfd);
+					inittab[map[j]].readyfd = -1;
+				}
+			}
+		}
+		
+		/* Bury children, blocking only if there is nothing to poll. */
+		while ((pid = waitpid(-1, &status, (n > 0) ? WNOHANG : 0)) > 0)
+		{
+			reap(pid, status);
+			if (n == 0)
+				break;
+		}
+	}
+	
+	bootlog("init: boot completed in %d ms\n", (int)TICKS_TO_MS(gticks() - boot));
+	
+	/* Re-spawns are not part of the boot. */
+	bootmark("boot", "completed");
+	if (markfd >= 0)
+	{
+		close(markfd);
+		markfd = -1;
+	}
 }
 
 /*
@@ -171,31 +586,24 @@ int main(int argc, char **argv)
 	if (inittab_read())
 		goto out;
 	
+	logfd = open("/dev/klog", O_WRONLY);
+	markfd = open("/dev/bootlog", O_WRONLY);
+	bootmark("init", "started");
+	
 	/* Spawn processes in the inittab. */
-	for (int i = 0; inittab[i].used; i++)
-		spawn(i);
+	bootstrap();
 	
 	/* Wait child processes. */
 	while (1)
 	{
 		pid_t pid;
+		int status;
 		
 		sync();
-		pid = wait(NULL);
-			
-		/* Re-spawn process? */
-		for (int i = 0; inittab[i].used; i++)
-		{
-			/* Not this process. */
-			if (inittab[i].pid != pid)
-				continue;
-			
-			/* Do not respawn. */
-			if (!inittab[i].respaw)
-				continue;
-				
-			spawn(i);
-		}
+		if ((pid = wait(&status)) < 0)
+			continue;
+		
+		reap(pid, status);
 	}
 
 out:
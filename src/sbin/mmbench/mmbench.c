@@ -0,0 +1,492 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna   <pedrohenriquepenna@gmail.com>
+ *              2016-2016 Davidson Francis <davidsondfgl@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <i386/paging.h>
+#include <nanvix/clock.h>
+#include <sys/vmstat.h>
+#include <sys/wait.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../bench/tsc.h"
+
+/* Test parameters. */
+#define NR_PASSES      3 /* Timed passes over a working set.   */
+#define NR_FORKS      20 /* fork() calls per parent size.      */
+#define NR_MALLOC  20000 /* malloc() and free() calls.         */
+#define NR_SLOTS     256 /* Live allocations in malloc() test. */
+
+/* Working set sizes (in percent of user memory). */
+static const unsigned wsets[] = { 25, 50, 75, 100, 125, 150, 0 };
+
+/* Parent sizes for copy-on-write tests (in pages). */
+static const unsigned parents[] = { 16, 64, 256, 1024, 0 };
+
+/**
+ * @brief Allocation size distributions.
+ */
+static const struct
+{
+	const char *name; /* Name.                             */
+	unsigned min;     /* Smallest size.                    */
+	unsigned max;     /* Largest size.                     */
+	unsigned skew;    /* Keep halving with odds 1-1/skew.  */
+} dists[] = {
+	{ "small",  16,    128,   0 },
+	{ "medium", 256,   4096,  0 },
+	{ "large",  8192,  65536, 0 },
+	{ "mixed",  16,    65536, 4 },
+	{ NULL,     0,     0,     0 }
+};
+
+/* Policy being measured. */
+static const char *tag = "default";
+
+/* Live allocations. */
+static void *slots[NR_SLOTS];
+
+/*============================================================================*
+ *                                 helpers                                    *
+ *============================================================================*/
+
+/**
+ * @brief Converts time stamp counter ticks to microseconds.
+ */
+static unsigned usecs(uint64_t cycles)
+{
+	unsigned us;
+	
+	us = div64(cycles, tsc_per_us);
+	
+	return ((us == 0) ? 1 : us);
+}
+
+/**
+ * @brief Converts time stamp counter ticks per operation to nanoseconds.
+ */
+static unsigned nsecs(uint64_t cycles, unsigned n)
+{
+	return (div64((uint64_t)div64(cycles, n)*1000, tsc_per_us));
+}
+
+/**
+ * @brief Writes to every page of a buffer.
+ * 
+ * @param p      Buffer.
+ * @param npages Number of pages.
+ */
+static void touch(volatile char *p, unsigned npages)
+{
+	for (unsigned i = 0; i < npages; i++)
+		p[i*PAGE_SIZE]++;
+}
+
+/**
+ * @brief Reads every page of a buffer.
+ * 
+ * @param p      Buffer.
+ * @param npages Number of pages.
+ */
+static void scan(volatile char *p, unsigned npages)
+{
+	char c = 0;
+	
+	for (unsigned i = 0; i < npages; i++)
+		c += p[i*PAGE_SIZE];
+	
+	((void)c);
+}
+
+/**
+ * @brief Forks the calling process.
+ * 
+ * @details Flushes the standard output first, so that pending output is
+ *          not duplicated in the child.
+ * 
+ * @returns See fork().
+ */
+static pid_t mfork(void)
+{
+	fflush(stdout);
+	
+	return (fork());
+}
+
+/*============================================================================*
+ *                               working set                                  *
+ *============================================================================*/
+
+/**
+ * @brief Measures page access time for a working set.
+ * 
+ * @details Runs in a child, so that memory is released afterwards. Pages
+ *          are touched once to fault them in, and then NR_PASSES times
+ *          more under the clock.
+ * 
+ * @param npages Working set size (in pages).
+ * @param pct    Working set size (in percent of user memory).
+ */
+static void wset(unsigned npages, unsigned pct)
+{
+	char *p;          /* Working set.    */
+	uint64_t t0;      /* Starting stamp. */
+	uint64_t dt;      /* Elapsed time.   */
+	struct vmstat v0; /* Stats before.   */
+	struct vmstat v1; /* Stats after.    */
+	
+	if ((p = malloc(npages*PAGE_SIZE)) == NULL)
+	{
+		printf("policy=%s test=wset pct=%d pages=%d error=nomem\n",
+			tag, pct, npages);
+		exit(EXIT_FAILURE);
+	}
+	
+	touch(p, npages);
+	
+	vmstat(&v0);
+	t0 = rdtsc();
+	for (int i = 0; i < NR_PASSES; i++)
+		touch(p, npages);
+	dt = rdtsc() - t0;
+	vmstat(&v1);
+	
+	printf("policy=%s test=wset pct=%d pages=%d ns_per_page=%d "
+		"swapins=%d swapouts=%d\n", tag, pct, npages,
+		nsecs(dt, NR_PASSES*npages),
+		v1.swapins - v0.swapins, v1.swapouts - v0.swapouts);
+	
+	exit(EXIT_SUCCESS);
+}
+
+/**
+ * @brief Measures swap bandwidth.
+ * 
+ * @details Runs in a child over a working set half again as large as user
+ *          memory. A write pass forces dirty pages out while others come
+ *          in; a read pass brings pages in with little write back.
+ * 
+ * @param npages Working set size (in pages).
+ */
+static void swapbw(unsigned npages)
+{
+	char *p;          /* Working set.    */
+	uint64_t t0;      /* Starting stamp. */
+	unsigned us;      /* Elapsed time.   */
+	unsigned n;       /* Pages moved.    */
+	struct vmstat v0; /* Stats before.   */
+	struct vmstat v1; /* Stats after.    */
+	
+	if ((p = malloc(npages*PAGE_SIZE)) == NULL)
+	{
+		printf("policy=%s test=swap pages=%d error=nomem\n", tag, npages);
+		exit(EXIT_FAILURE);
+	}
+	
+	touch(p, npages);
+	
+	/* Write pass. */
+	vmstat(&v0);
+	t0 = rdtsc();
+	touch(p, npages);
+	us = usecs(rdtsc() - t0);
+	vmstat(&v1);
+	n = (v1.swapins - v0.swapins) + (v1.swapouts - v0.swapouts);
+	printf("policy=%s test=swap_write pages=%d swapins=%d swapouts=%d "
+		"kbps=%d\n", tag, npages, v1.swapins - v0.swapins,
+		v1.swapouts - v0.swapouts,
+		div64((uint64_t)n*(PAGE_SIZE/1024)*1000000, us));
+	
+	/* Read pass. */
+	vmstat(&v0);
+	t0 = rdtsc();
+	scan(p, npages);
+	us = usecs(rdtsc() - t0);
+	vmstat(&v1);
+	n = (v1.swapins - v0.swapins) + (v1.swapouts - v0.swapouts);
+	printf("policy=%s test=swap_read pages=%d swapins=%d swapouts=%d "
+		"kbps=%d\n", tag, npages, v1.swapins - v0.swapins,
+		v1.swapouts - v0.swapouts,
+		div64((uint64_t)n*(PAGE_SIZE/1024)*1000000, us));
+	
+	exit(EXIT_SUCCESS);
+}
+
+/**
+ * @brief Runs working set and swap tests.
+ * 
+ * @returns Zero on success, and non-zero otherwise.
+ */
+static int wset_test(void)
+{
+	pid_t pid;       /* Child process. */
+	struct vmstat v; /* Memory stats.  */
+	
+	if (vmstat(&v) < 0)
+		return (-1);
+	
+	for (int i = 0; wsets[i] != 0; i++)
+	{
+		if ((pid = mfork()) < 0)
+			return (-1);
+		
+		/* Child. */
+		if (pid == 0)
+			wset((v.frames*wsets[i])/100, wsets[i]);
+		
+		wait(NULL);
+	}
+	
+	/* Swap bandwidth. */
+	if ((pid = mfork()) < 0)
+		return (-1);
+	if (pid == 0)
+		swapbw((v.frames*3)/2);
+	wait(NULL);
+	
+	return (0);
+}
+
+/*============================================================================*
+ *                              copy on write                                 *
+ *============================================================================*/
+
+/**
+ * @brief Measures fork() cost versus parent size.
+ * 
+ * @details For every parent size, reports the cost of a fork() whose child
+ *          exits at once, and the cost per page of a child that writes to
+ *          the whole parent heap.
+ * 
+ * @returns Zero on success, and non-zero otherwise.
+ */
+static int cow_test(void)
+{
+	char *p;     /* Parent heap.    */
+	pid_t pid;   /* Child process.  */
+	uint64_t t0; /* Starting stamp. */
+	uint64_t dt; /* Elapsed time.   */
+	
+	for (int i = 0; parents[i] != 0; i++)
+	{
+		if ((p = malloc(parents[i]*PAGE_SIZE)) == NULL)
+			return (-1);
+		touch(p, parents[i]);
+		
+		fflush(stdout);
+		
+		/* Fork and exit. */
+		t0 = rdtsc();
+		for (int j = 0; j < NR_FORKS; j++)
+		{
+			if ((pid = fork()) < 0)
+				return (-1);
+			if (pid == 0)
+				_exit(EXIT_SUCCESS);
+			wait(NULL);
+		}
+		dt = rdtsc() - t0;
+		printf("policy=%s test=cow_fork pages=%d ns_per_fork=%d\n",
+			tag, parents[i], nsecs(dt, NR_FORKS));
+		
+		/* Fork and write all pages. */
+		if ((pid = mfork()) < 0)
+			return (-1);
+		if (pid == 0)
+		{
+			t0 = rdtsc();
+			touch(p, parents[i]);
+			dt = rdtsc() - t0;
+			printf("policy=%s test=cow_touch pages=%d ns_per_page=%d\n",
+				tag, parents[i], nsecs(dt, parents[i]));
+			exit(EXIT_SUCCESS);
+		}
+		wait(NULL);
+		
+		free(p);
+	}
+	
+	return (0);
+}
+
+/*============================================================================*
+ *                                 malloc                                     *
+ *============================================================================*/
+
+/**
+ * @brief Picks an allocation size.
+ * 
+ * @param d Size distribution.
+ * 
+ * @returns An allocation size.
+ */
+static unsigned pick(int d)
+{
+	unsigned size;
+	
+	size = dists[d].min + rand()%(dists[d].max - dists[d].min + 1);
+	
+	/* Skew towards small sizes. */
+	if (dists[d].skew != 0)
+	{
+		while ((size > dists[d].min) && (rand()%dists[d].skew != 0))
+			size /= 2;
+	}
+	
+	return ((size < dists[d].min) ? dists[d].min : size);
+}
+
+/**
+ * @brief Measures malloc() and free() throughput.
+ * 
+ * @details Runs a random mix of allocations and releases over NR_SLOTS
+ *          live blocks, for every size distribution. Runs in a child, so
+ *          that every distribution starts on a fresh heap.
+ * 
+ * @returns Zero on success, and non-zero otherwise.
+ */
+static int malloc_test(void)
+{
+	pid_t pid;     /* Child process.   */
+	unsigned s;    /* Slot.            */
+	unsigned nops; /* Operations done. */
+	uint64_t t0;   /* Starting stamp.  */
+	uint64_t dt;   /* Elapsed time.    */
+	
+	for (int d = 0; dists[d].name != NULL; d++)
+	{
+		if ((pid = mfork()) < 0)
+			return (-1);
+		
+		if (pid > 0)
+		{
+			wait(NULL);
+			continue;
+		}
+		
+		/* Child. */
+		srand(d + 1);
+		nops = 0;
+		t0 = rdtsc();
+		for (int i = 0; i < NR_MALLOC; i++)
+		{
+			s = rand()%NR_SLOTS;
+			
+			if (slots[s] != NULL)
+			{
+				free(slots[s]);
+				slots[s] = NULL;
+			}
+			else if ((slots[s] = malloc(pick(d))) == NULL)
+				break;
+			
+			nops++;
+		}
+		dt = rdtsc() - t0;
+		
+		printf("policy=%s test=malloc dist=%s ops=%d ops_per_sec=%d "
+			"ns_per_op=%d\n", tag, dists[d].name, nops,
+			div64((uint64_t)nops*1000000, usecs(dt)), nsecs(dt, nops));
+		
+		exit(EXIT_SUCCESS);
+	}
+	
+	return (0);
+}
+
+/*============================================================================*
+ *                                  main                                      *
+ *============================================================================*/
+
+/**
+ * @brief Prints program usage and exits.
+ */
+static void usage(void)
+{
+	printf("Usage: mmbench [-t tag] [test...]\n\n");
+	printf("Tests: wset, cow, malloc (default: all)\n");
+	printf("  -t tag Label results with the policy under test\n");
+	
+	exit(EXIT_SUCCESS);
+}
+
+/**
+ * @brief Runs a test.
+ * 
+ * @param name Test name.
+ */
+static void run(const char *name)
+{
+	int ret; /* Test failed? */
+	
+	ret = 0;
+	
+	if (!strcmp(name, "wset"))
+		ret = wset_test();
+	else if (!strcmp(name, "cow"))
+		ret = cow_test();
+	else if (!strcmp(name, "malloc"))
+		ret = malloc_test();
+	else
+		usage();
+	
+	if (ret)
+		fprintf(stderr, "mmbench: %s test failed\n", name);
+}
+
+/**
+ * @brief Runs memory benchmarks.
+ */
+int main(int argc, char **argv)
+{
+	int i; /* Loop index. */
+	
+	/* Parse options. */
+	for (i = 1; i < argc; i++)
+	{
+		if ((!strcmp(argv[i], "-t")) && (i + 1 < argc))
+			tag = argv[++i];
+		else if (argv[i][0] == '-')
+			usage();
+		else
+			break;
+	}
+	
+	calibrate();
+	printf("# tsc %d MHz\n", tsc_per_us);
+	
+	/* Run all tests. */
+	if (i == argc)
+	{
+		run("wset");
+		run("cow");
+		run("malloc");
+	}
+	
+	/* Run selected tests. */
+	else
+	{
+		for ( ; i < argc; i++)
+			run(argv[i]);
+	}
+	
+	return (EXIT_SUCCESS);
+}
@@ -0,0 +1,436 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna   <pedrohenriquepenna@gmail.com>
+ *              2016-2016 Davidson Francis <davidsondfgl@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/clock.h>
+#include <nanvix/config.h>
+#include <sys/times.h>
+#include <sys/wait.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../bench/tsc.h"
+
+/* Test parameters. */
+#define NR_WAKEUPS    64 /* Wakeups sampled per sleeper.         */
+#define SLEEP_US   30000 /* Sleep length of a sleeper.           */
+#define NICE_STEP      5 /* Nice increment between CPU hogs.     */
+#define SCALE_SECS     2 /* Length of a throughput run (in s).   */
+#define SCALE_SPARE   16 /* Process slots left free when scaling. */
+
+/* Kinds of workers. */
+#define HOG     0 /* CPU hog.             */
+#define SLEEPER 1 /* Interactive sleeper. */
+
+/**
+ * @brief Worker result.
+ * 
+ * @details Small enough to be written atomically to a pipe.
+ */
+struct result
+{
+	int kind;                 /* Kind of worker.            */
+	int nice;                 /* Nice increment.            */
+	unsigned iters;           /* Work units done.           */
+	unsigned utime;           /* User CPU time (in ticks).  */
+	unsigned n;               /* Wakeups sampled.           */
+	unsigned lat[NR_WAKEUPS]; /* Wakeup latencies (in us).  */
+};
+
+/* Number of CPU hogs. */
+static int nhogs = 4;
+
+/* Number of sleepers. */
+static int nsleepers = 2;
+
+/* Test length (in seconds). */
+static int secs = 5;
+
+/* Result pipe. */
+static int results[2];
+
+/* Merged wakeup latencies. */
+static unsigned lat[PROC_MAX*NR_WAKEUPS];
+
+/*============================================================================*
+ *                                 helpers                                    *
+ *============================================================================*/
+
+/**
+ * @brief Compares two latencies.
+ */
+static int cmp(const void *a, const void *b)
+{
+	unsigned x = *(const unsigned *)a;
+	unsigned y = *(const unsigned *)b;
+	
+	return ((x < y) ? -1 : (x > y));
+}
+
+/*============================================================================*
+ *                                 workers                                    *
+ *============================================================================*/
+
+/**
+ * @brief Sends the result of a worker and exits.
+ * 
+ * @param r Result.
+ */
+static void done(struct result *r)
+{
+	struct tms t; /* Timing information. */
+	
+	times(&t);
+	r->utime = t.tms_utime;
+	
+	write(results[1], r, sizeof(struct result));
+	_exit(EXIT_SUCCESS);
+}
+
+/**
+ * @brief CPU hog.
+ * 
+ * @details Counts work units until the deadline.
+ * 
+ * @param incr Nice increment.
+ * @param end  Deadline (in clock ticks).
+ */
+static void hog(int incr, int end)
+{
+	struct result r; /* Result. */
+	
+	memset(&r, 0, sizeof(struct result));
+	r.kind = HOG;
+	r.nice = incr;
+	
+	nice(incr);
+	
+	while (1)
+	{
+		for (volatile int k = 0; k < 1000; k++)
+			/* noop */ ;
+		
+		/* Check the deadline every now and then. */
+		if ((++r.iters & 63) == 0)
+		{
+			if (gticks() >= end)
+				break;
+		}
+	}
+	
+	done(&r);
+}
+
+/**
+ * @brief Interactive sleeper.
+ * 
+ * @details Sleeps repeatedly until the deadline and records how late each
+ *          wakeup is, from the end of the requested sleep to the moment it
+ *          runs again.
+ * 
+ * @param end Deadline (in clock ticks).
+ */
+static void sleeper(int end)
+{
+	unsigned us;     /* Time asleep.    */
+	uint64_t t0;     /* Starting stamp. */
+	struct result r; /* Result.         */
+	
+	memset(&r, 0, sizeof(struct result));
+	r.kind = SLEEPER;
+	
+	while ((gticks() < end) && (r.n < NR_WAKEUPS))
+	{
+		t0 = rdtsc();
+		usleep(SLEEP_US);
+		us = div64(rdtsc() - t0, tsc_per_us);
+		
+		r.lat[r.n++] = (us > SLEEP_US) ? us - SLEEP_US : 0;
+		r.iters++;
+	}
+	
+	done(&r);
+}
+
+/**
+ * @brief Runs CPU hogs and sleepers, and collects their results.
+ * 
+ * @param n     Number of CPU hogs.
+ * @param m     Number of sleepers.
+ * @param ticks Test length (in clock ticks).
+ * @param nices Give hogs increasing nice values?
+ * @param r     Location where results shall be stored.
+ * 
+ * @returns The number of results collected, or a negative number on
+ *          failure.
+ */
+static int spawn(int n, int m, int ticks, int nices, struct result *r)
+{
+	int end;      /* Deadline.        */
+	ssize_t k;    /* Bytes read.      */
+	pid_t pid;    /* Child process.   */
+	int nworkers; /* Workers spawned. */
+	
+	if (pipe(results) < 0)
+		return (-1);
+	
+	fflush(stdout);
+	
+	end = gticks() + ticks;
+	nworkers = 0;
+	for (int i = 0; i < n + m; i++)
+	{
+		if ((pid = fork()) < 0)
+			break;
+		
+		/* Child. */
+		if (pid == 0)
+		{
+			close(results[0]);
+			
+			if (i < n)
+				hog((nices) ? (i*NICE_STEP)%NZERO : 0, end);
+			sleeper(end);
+		}
+		
+		nworkers++;
+	}
+	
+	close(results[1]);
+	
+	/* Collect results. */
+	for (int i = 0; i < nworkers; i++)
+	{
+		for (size_t j = 0; j < sizeof(struct result); j += k)
+		{
+			k = read(results[0], (char *)&r[i] + j, sizeof(struct result) - j);
+			if (k <= 0)
+			{
+				nworkers = i;
+				break;
+			}
+		}
+	}
+	
+	close(results[0]);
+	
+	while (wait(NULL) > 0)
+		/* noop */ ;
+	
+	return (nworkers);
+}
+
+/*============================================================================*
+ *                                  tests                                     *
+ *============================================================================*/
+
+/* Worker results. */
+static struct result res[PROC_MAX];
+
+/**
+ * @brief Measures wakeup latency and CPU share versus nice.
+ * 
+ * @details Runs the CPU hogs, with increasing nice values, alongside the
+ *          sleepers. Reports the share of each hog in the work done, and
+ *          percentiles of the wakeup latency of all sleepers together.
+ * 
+ * @returns Zero on success, and non-zero otherwise.
+ */
+static int latency_test(void)
+{
+	int n;          /* Workers.          */
+	unsigned total; /* Total work units. */
+	unsigned nlat;  /* Wakeups sampled.  */
+	
+	if ((n = spawn(nhogs, nsleepers, secs*CLOCK_FREQ, 1, res)) < 0)
+		return (-1);
+	
+	total = 0;
+	nlat = 0;
+	for (int i = 0; i < n; i++)
+	{
+		if (res[i].kind == HOG)
+			total += res[i].iters;
+		
+		for (unsigned j = 0; j < res[i].n; j++)
+			lat[nlat++] = res[i].lat[j];
+	}
+	
+	/* CPU share of each hog. */
+	for (int i = 0; i < n; i++)
+	{
+		if (res[i].kind != HOG)
+			continue;
+		
+		printf("test=share nice=%d iters=%d utime=%d share_permille=%d\n",
+			res[i].nice, res[i].iters, res[i].utime,
+			(total > 0) ? div64((uint64_t)res[i].iters*1000, total) : 0);
+	}
+	
+	/* Wakeup latencies. */
+	if (nlat == 0)
+	{
+		printf("test=wakeup hogs=%d sleepers=%d samples=0\n",
+			nhogs, nsleepers);
+		return (0);
+	}
+	
+	qsort(lat, nlat, sizeof(unsigned), cmp);
+	printf("test=wakeup hogs=%d sleepers=%d samples=%d p50_us=%d p90_us=%d "
+		"p99_us=%d max_us=%d\n", nhogs, nsleepers, nlat,
+		lat[(nlat*50)/100], lat[(nlat*90)/100], lat[(nlat*99)/100],
+		lat[nlat - 1]);
+	
+	return (0);
+}
+
+/**
+ * @brief Measures throughput as the number of CPU hogs scales.
+ * 
+ * @details Doubles the number of equally nice CPU hogs up to near PROC_MAX,
+ *          and reports the work done per second and how far the least and
+ *          most served hogs are from an even share.
+ * 
+ * @returns Zero on success, and non-zero otherwise.
+ */
+static int scale_test(void)
+{
+	int n;          /* Workers.          */
+	unsigned total; /* Total work units. */
+	unsigned avg;   /* Even share.       */
+	unsigned min;   /* Least served.     */
+	unsigned max;   /* Most served.      */
+	
+	for (int hogs = 1; hogs <= PROC_MAX - SCALE_SPARE; hogs *= 2)
+	{
+		if ((n = spawn(hogs, 0, SCALE_SECS*CLOCK_FREQ, 0, res)) <= 0)
+			return (-1);
+		
+		total = 0;
+		min = 0xffffffff;
+		max = 0;
+		for (int i = 0; i < n; i++)
+		{
+			total += res[i].iters;
+			if (res[i].iters < min)
+				min = res[i].iters;
+			if (res[i].iters > max)
+				max = res[i].iters;
+		}
+		
+		if ((avg = total/n) == 0)
+			avg = 1;
+		
+		printf("test=scale hogs=%d iters_per_sec=%d min_pct=%d max_pct=%d\n",
+			n, total/SCALE_SECS, div64((uint64_t)min*100, avg),
+			div64((uint64_t)max*100, avg));
+	}
+	
+	return (0);
+}
+
+/*============================================================================*
+ *                                  main                                      *
+ *============================================================================*/
+
+/**
+ * @brief Prints program usage and exits.
+ */
+static void usage(void)
+{
+	printf("Usage: schedbench [options] [test...]\n\n");
+	printf("Tests: latency, scale (default: all)\n");
+	printf("  -n hogs     Number of CPU hogs (default: 4)\n");
+	printf("  -m sleepers Number of sleepers (default: 2)\n");
+	printf("  -t secs     Length of the latency test (default: 5)\n");
+	
+	exit(EXIT_SUCCESS);
+}
+
+/**
+ * @brief Runs a test.
+ * 
+ * @param name Test name.
+ */
+static void run(const char *name)
+{
+	int ret; /* Test failed? */
+	
+	ret = 0;
+	
+	if (!strcmp(name, "latency"))
+		ret = latency_test();
+	else if (!strcmp(name, "scale"))
+		ret = scale_test();
+	else
+		usage();
+	
+	if (ret)
+		fprintf(stderr, "schedbench: %s test failed\n", name);
+}
+
+/**
+ * @brief Runs scheduler benchmarks.
+ */
+int main(int argc, char **argv)
+{
+	int i; /* Loop index. */
+	
+	/* Parse options. */
+	for (i = 1; i < argc; i++)
+	{
+		if ((!strcmp(argv[i], "-n")) && (i + 1 < argc))
+			nhogs = atoi(argv[++i]);
+		else if ((!strcmp(argv[i], "-m")) && (i + 1 < argc))
+			nsleepers = atoi(argv[++i]);
+		else if ((!strcmp(argv[i], "-t")) && (i + 1 < argc))
+			secs = atoi(argv[++i]);
+		else if (argv[i][0] == '-')
+			usage();
+		else
+			break;
+	}
+	
+	/* Keep clear of the process table limit. */
+	if ((nhogs < 0) || (nsleepers < 0) || (secs <= 0) ||
+		(nhogs + nsleepers > PROC_MAX - SCALE_SPARE))
+		usage();
+	
+	calibrate();
+	printf("# tsc %d MHz\n", tsc_per_us);
+	
+	/* Run all tests. */
+	if (i == argc)
+	{
+		run("latency");
+		run("scale");
+	}
+	
+	/* Run selected tests. */
+	else
+	{
+		for ( ; i < argc; i++)
+			run(argv[i]);
+	}
+	
+	return (EXIT_SUCCESS);
+}
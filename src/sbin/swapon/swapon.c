@@ -0,0 +1,115 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <sys/swap.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Software versioning. */
+#define VERSION_MAJOR 1 /* Major version. */
+#define VERSION_MINOR 0 /* Minor version. */
+
+/* Program arguments. */
+static char *pathname = NULL; /* Block device.       */
+static long size = 0;         /* Size (in KB).       */
+static int prio = 0;          /* Swap area priority. */
+
+/*
+ * Prints program version and exits.
+ */
+static void version(void)
+{
+	printf("swapon (Nanvix Coreutils) %d.%d\n\n", VERSION_MAJOR, VERSION_MINOR);
+	printf("Copyright(C) 2011-2016 Pedro H. Penna\n");
+	printf("This is free software under the "); 
+	printf("GNU General Public License Version 3.\n");
+	printf("There is NO WARRANTY, to the extent permitted by law.\n\n");
+	
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ * Prints program usage and exits.
+ */
+static void usage(void)
+{
+	printf("Usage: swapon [options] <device> <size>\n\n");
+	printf("Brief: Adds a swap area of size KB on a block device.\n\n");
+	printf("Options:\n");
+	printf("  -p, --priority <prio> Set swap area priority\n");
+	printf("      --help            Display this information and exit\n");
+	printf("      --version         Display program version and exit\n");
+	
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ * Gets program arguments.
+ */
+static void getargs(int argc, char *const argv[])
+{
+	int i;     /* Loop index.       */
+	char *arg; /* Current argument. */
+	
+	/* Read command line arguments. */
+	for (i = 1; i < argc; i++)
+	{
+		arg = argv[i];
+		
+		/* Parse command line argument. */
+		if (!strcmp(arg, "--help")) {
+			usage();
+		}
+		else if (!strcmp(arg, "--version")) {
+			version();
+		}
+		else if ((!strcmp(arg, "-p")) || (!strcmp(arg, "--priority"))) {
+			if (++i >= argc)
+				usage();
+			prio = atoi(argv[i]);
+		}
+		else if (pathname == NULL) {
+			pathname = arg;
+		}
+		else {
+			size = strtol(arg, NULL, 10);
+		}
+	}
+	
+	/* Missing arguments. */
+	if ((pathname == NULL) || (size <= 0))
+		usage();
+}
+
+/*
+ * Adds a swap area.
+ */
+int main(int argc, char *const argv[])
+{
+	getargs(argc, argv);
+	
+	if (swapon(pathname, (size_t)size*1024, prio) < 0)
+	{
+		fprintf(stderr, "swapon: cannot add swap area on %s\n", pathname);
+		return (EXIT_FAILURE);
+	}
+	
+	return (EXIT_SUCCESS);
+}
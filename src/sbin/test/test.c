@@ -20,14 +20,21 @@
 
 #include <assert.h>
 #include <nanvix/config.h>
+#include <nanvix/timepage.h>
+#include <sys/cachestat.h>
 #include <sys/times.h>
 #include <sys/wait.h>
 #include <sys/sem.h>
 #include <stdio.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
 #include <signal.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <time.h>
 
 /* Test flags. */
 #define EXTENDED (1 << 0)
@@ -369,6 +376,114 @@ static int sched_test3(void)
 	return (0);
 }
 
+/**
+ * @brief Number of wakeups measured by the latency test.
+ */
+#define NR_WAKEUPS 32
+
+/**
+ * @brief Worst-case wakeup latency allowed (in clock ticks).
+ */
+#define LATENCY_MAX 2
+
+/**
+ * @brief Reads the time stamp counter.
+ */
+static uint64_t rdtsc(void)
+{
+	uint32_t lo, hi;
+	
+	__asm__ volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+	
+	return (((uint64_t)hi << 32) | lo);
+}
+
+/**
+ * @brief Scheduling test 4.
+ * 
+ * @details Measures the worst-case wakeup latency of a real-time process
+ *          that sleeps for one clock tick over and over, while a time
+ *          sharing process hogs the processor. The latency is how much
+ *          longer than the shortest sleep each sleep took, and it should
+ *          stay well below the quantum of the hog.
+ * 
+ * @returns Zero if passed on test, and non-zero otherwise.
+ */
+static int sched_test4(void)
+{
+	int status;               /* Exit status.          */
+	pid_t hog, rt;            /* Child processes.      */
+	unsigned per_usec;        /* TSC counts per usec.  */
+	unsigned latency;         /* Worst-case latency.   */
+	uint64_t t0, t, min, max; /* Sleep times.          */
+	struct sched_param param; /* Real-time priority.   */
+	struct timespec tick;     /* One clock tick.       */
+	
+	hog = fork();
+	
+	/* Failed to fork(). */
+	if (hog < 0)
+		return (-1);
+	
+	/* CPU hog. */
+	else if (hog == 0)
+	{
+		while (1)
+			work_cpu();
+	}
+	
+	rt = fork();
+	
+	/* Real-time process. */
+	if (rt == 0)
+	{
+		param.sched_priority = SCHED_RTPRIO_MAX;
+		if (sched_setscheduler(0, SCHED_FIFO, &param) < 0)
+			_exit(EXIT_FAILURE);
+		
+		tick.tv_sec = 0;
+		tick.tv_nsec = 1000000000/TIMEPAGE->freq;
+		
+		min = ~0ULL;
+		max = 0;
+		for (int i = 0; i < NR_WAKEUPS; i++)
+		{
+			t0 = rdtsc();
+			nanosleep(&tick, NULL);
+			t = rdtsc() - t0;
+			
+			if (t < min)
+				min = t;
+			if (t > max)
+				max = t;
+		}
+		
+		/* No time stamp counter rate. */
+		if ((per_usec = TIMEPAGE->tsc_per_tick/(1000000/TIMEPAGE->freq)) == 0)
+			_exit(EXIT_FAILURE);
+		
+		/* Keep the division in 32 bits. */
+		t = max - min;
+		latency = (t >> 32) ? 0xffffffff : (unsigned)t/per_usec;
+		
+		if (flags & VERBOSE)
+			printf("  worst-case wakeup latency: %d us\n", latency);
+		
+		_exit((latency <= LATENCY_MAX*(1000000/TIMEPAGE->freq)) ?
+			EXIT_SUCCESS : EXIT_FAILURE);
+	}
+	
+	status = EXIT_FAILURE;
+	if (rt > 0)
+		waitpid(rt, &status, 0);
+	
+	kill(hog, SIGKILL);
+	waitpid(hog, NULL, 0);
+	
+	return ((rt > 0) && WIFEXITED(status) && (WEXITSTATUS(status) == EXIT_SUCCESS) ?
+		0 : -1);
+}
+
 /*============================================================================*
  *                             Semaphores Test                                *
  *============================================================================*/
@@ -587,6 +702,228 @@ int fpu_test(void)
 }
 
 
+/*============================================================================*
+ *                                bcache_test                                 *
+ *============================================================================*/
+
+/**
+ * @brief File system block size.
+ */
+#define FS_BLOCK (1 << BLOCK_SIZE_LOG2)
+
+/**
+ * @name Files used by the block cache test.
+ */
+/**@{*/
+#define BCACHE_FILE "/home/bcache.tmp" /**< Block under test. */
+#define BCACHE_FILL "/home/bfill.tmp"  /**< Filler.           */
+/**@}*/
+
+/**
+ * @brief Creates a file filled with a character.
+ * 
+ * @param path    Path to file.
+ * @param c       Fill character.
+ * @param nblocks Size of the file (in blocks).
+ * @param blk     Block buffer.
+ * 
+ * @returns Zero on success, and non-zero otherwise.
+ */
+static int mkfile(const char *path, char c, unsigned nblocks, char *blk)
+{
+	int fd; /* File descriptor. */
+	
+	if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0)
+		return (-1);
+	
+	memset(blk, c, FS_BLOCK);
+	for (unsigned i = 0; i < nblocks; i++)
+	{
+		if (write(fd, blk, FS_BLOCK) != FS_BLOCK)
+		{
+			close(fd);
+			return (-1);
+		}
+	}
+	
+	fsync(fd);
+	close(fd);
+	
+	return (0);
+}
+
+/**
+ * @brief Reads the first block of a file through the caches.
+ * 
+ * @param path Path to file.
+ * @param blk  Block buffer.
+ * @param drop Drop cached pages first?
+ */
+static void readblk(const char *path, char *blk, int drop)
+{
+	int fd; /* File descriptor. */
+	
+	if ((fd = open(path, O_RDONLY)) < 0)
+		return;
+	
+	if (drop)
+		posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+	
+	memset(blk, 0, FS_BLOCK);
+	read(fd, blk, FS_BLOCK);
+	close(fd);
+}
+
+/**
+ * @brief Block cache testing module.
+ * 
+ * @details Pushes a block out of the block buffer cache into the
+ *          second-level block cache, overwrites it with direct I/O, and
+ *          checks that reading it back through the caches returns the new
+ *          data.
+ * 
+ * @returns Zero if passed on test, and non-zero otherwise.
+ */
+static int bcache_test(void)
+{
+	int fd;                      /* File descriptor.          */
+	int ret;                     /* Test result.              */
+	unsigned nfill;              /* Filler size (in blocks).  */
+	struct cachestat st;         /* Buffer cache statistics.  */
+	char *blk;                   /* Block-aligned buffer.     */
+	static char raw[2*FS_BLOCK]; /* Room for aligned buffer.  */
+	
+	blk = (char *)(((unsigned long)raw + FS_BLOCK - 1) & ~(FS_BLOCK - 1));
+	
+	/*
+	 * Enough to push a block out of the block buffer
+	 * cache, but not out of the second-level one.
+	 */
+	if (cachestat(CACHE_BUFFER, &st) < 0)
+		return (-1);
+	nfill = st.size + st.size/2;
+	
+	if (mkfile(BCACHE_FILE, 'a', 1, blk) || mkfile(BCACHE_FILL, 'f', nfill, blk))
+		return (-1);
+	
+	/* Read block in. */
+	readblk(BCACHE_FILE, blk, 1);
+	
+	/* Push it out. */
+	if ((fd = open(BCACHE_FILL, O_RDONLY)) < 0)
+		return (-1);
+	for (unsigned i = 0; i < nfill; i++)
+		read(fd, blk, FS_BLOCK);
+	close(fd);
+	
+	ret = -1;
+	
+	/* Overwrite it with direct I/O. */
+	if ((fd = open(BCACHE_FILE, O_WRONLY | O_DIRECT)) < 0)
+		goto out;
+	memset(blk, 'b', FS_BLOCK);
+	if (write(fd, blk, FS_BLOCK) != FS_BLOCK)
+	{
+		close(fd);
+		goto out;
+	}
+	close(fd);
+	
+	/* Read it back. */
+	readblk(BCACHE_FILE, blk, 1);
+	ret = 0;
+	for (int i = 0; i < FS_BLOCK; i++)
+	{
+		if (blk[i] != 'b')
+			ret = -1;
+	}
+	
+out:
+	unlink(BCACHE_FILE);
+	unlink(BCACHE_FILL);
+	
+	return (ret);
+}
+
+/*============================================================================*
+ *                                stdio_test                                  *
+ *============================================================================*/
+
+/**
+ * @brief Line written by the child half of the stdio test.
+ */
+#define STDIO_LINE "stdio\n"
+
+/**
+ * @brief Child half of the stdio test.
+ * 
+ * @details Prints a line on the standard output, which is a pipe, and
+ *          holds it for a while before exiting.
+ */
+static void stdio_child(void)
+{
+	printf(STDIO_LINE);
+	sleep(2);
+}
+
+/**
+ * @brief Stdio testing module.
+ * 
+ * @details Runs a fresh copy of this program with the standard output
+ *          redirected to a pipe, and checks that a printf() there is fully
+ *          buffered: nothing reaches the pipe until the child exits.
+ * 
+ * @returns Zero if passed on test, and non-zero otherwise.
+ */
+static int stdio_test(void)
+{
+	int fd[2];          /* Pipe.              */
+	pid_t pid;          /* Child process ID.  */
+	struct pollfd pfd;  /* Poll descriptor.   */
+	char buf[16];       /* Output read back.  */
+	ssize_t n;          /* Bytes read back.   */
+	int ret;            /* Test result.       */
+	char *args[] = { "test", "stdio-child", NULL };
+	
+	if (pipe(fd) < 0)
+		return (-1);
+	
+	fflush(stdout);
+	
+	pid = fork();
+	
+	/* Failed to fork(). */
+	if (pid < 0)
+		return (-1);
+	
+	/* Child process. */
+	else if (pid == 0)
+	{
+		close(fd[0]);
+		dup2(fd[1], 1);
+		close(fd[1]);
+		execve("/sbin/test", args, environ);
+		_exit(EXIT_FAILURE);
+	}
+	
+	close(fd[1]);
+	
+	/* Nothing reaches the pipe while the child sleeps. */
+	pfd.fd = fd[0];
+	pfd.events = POLLIN;
+	ret = (poll(&pfd, 1, 1000) == 0) ? 0 : -1;
+	
+	/* Everything reaches the pipe on exit. */
+	n = read(fd[0], buf, sizeof(buf));
+	if ((n != sizeof(STDIO_LINE) - 1) || strncmp(buf, STDIO_LINE, n))
+		ret = -1;
+	
+	close(fd[0]);
+	wait(NULL);
+	
+	return (ret);
+}
+
 /*============================================================================*
  *                                   main                                     *
  *============================================================================*/
@@ -601,11 +938,13 @@ static void usage(void)
 	printf("Usage: test [options]\n\n");
 	printf("Brief: Performs regression tests on Nanvix.\n\n");
 	printf("Options:\n");
+	printf("  bc    Block Cache Test\n");
 	printf("  fpu   Floating Point Unit Test\n");
 	printf("  io    I/O Test\n");
 	printf("  ipc   Interprocess Communication Test\n");
 	printf("  swp   Swapping Test\n");
 	printf("  sched Scheduling Test\n");
+	printf("  stdio Standard I/O Test\n");
 	
 	exit(EXIT_SUCCESS);
 }
@@ -647,6 +986,8 @@ int main(int argc, char **argv)
 				(!sched_test1()) ? "PASSED" : "FAILED");
 			printf("  scheduler stress   [%s]\n",
 				(!sched_test2() && !sched_test3()) ? "PASSED" : "FAILED");
+			printf("  real-time latency  [%s]\n",
+				(!sched_test4()) ? "PASSED" : "FAILED");
 		}
 		
 		/* IPC test. */
@@ -666,6 +1007,26 @@ int main(int argc, char **argv)
 		}
 	
 	
+		/* Block cache test. */
+		else if (!strcmp(argv[i], "bc"))
+		{
+			printf("Block Cache Test\n");
+			printf("  direct write coherence [%s]\n",
+				(!bcache_test()) ? "PASSED" : "FAILED");
+		}
+		
+		/* Stdio test. */
+		else if (!strcmp(argv[i], "stdio"))
+		{
+			printf("Standard I/O Test\n");
+			printf("  pipe fully buffered [%s]\n",
+				(!stdio_test()) ? "PASSED" : "FAILED");
+		}
+		
+		/* Child half of the stdio test. */
+		else if (!strcmp(argv[i], "stdio-child"))
+			stdio_child();
+	
 		/* Wrong usage. */
 		else
 			usage();
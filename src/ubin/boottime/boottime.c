@@ -0,0 +1,208 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/clock.h>
+#include <sys/bootlog.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stropts.h>
+#include <unistd.h>
+
+/* Software versioning. */
+#define VERSION_MAJOR 1 /* Major version. */
+#define VERSION_MINOR 0 /* Minor version. */
+
+/* Boot timeline device. */
+#define BOOTLOG_DEV "/dev/bootlog"
+
+/* Maximum number of marks. */
+#define NR_MARKS 64
+
+/* Default number of phases to report. */
+#define NR_TOP 5
+
+/* Number of phases to report. */
+static unsigned top = NR_TOP;
+
+/* Time stamps per clock tick. */
+static unsigned rate = 0;
+
+/*
+ * Prints program version and exits.
+ */
+static void version(void)
+{
+	printf("boottime (Nanvix Coreutils) %d.%d\n\n", VERSION_MAJOR, VERSION_MINOR);
+	printf("Copyright(C) 2011-2016 Pedro H. Penna\n");
+	printf("This is free software under the "); 
+	printf("GNU General Public License Version 3.\n");
+	printf("There is NO WARRANTY, to the extent permitted by law.\n\n");
+	
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ * Prints program usage and exits.
+ */
+static void usage(void)
+{
+	printf("Usage: boottime [options]\n\n");
+	printf("Brief: Prints the boot timeline.\n\n");
+	printf("Options:\n");
+	printf("  --top <n> Report the n longest boot phases\n");
+	printf("  --help    Display this information and exit\n");
+	printf("  --version Display program version and exit\n");
+	
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ * Gets program arguments.
+ */
+static void getargs(int argc, char *const argv[])
+{
+	int i;     /* Loop index.       */
+	char *arg; /* Current argument. */
+	
+	/* Read command line arguments. */
+	for (i = 1; i < argc; i++)
+	{
+		arg = argv[i];
+		
+		/* Parse command line argument. */
+		if (!strcmp(arg, "--help")) {
+			usage();
+		}
+		else if (!strcmp(arg, "--version")) {
+			version();
+		}
+		else if ((!strcmp(arg, "--top")) && (i + 1 < argc)) {
+			top = strtoul(argv[++i], NULL, 0);
+		}
+		else {
+			fprintf(stderr, "boottime: bad argument\n");
+			usage();
+		}
+	}
+}
+
+/*
+ * Converts time stamp counts to microseconds.
+ * 
+ * Counts are scaled down to kilocounts, so
+ * that no 64-bit division is needed.
+ */
+static unsigned tous(uint64_t d)
+{
+	unsigned n;   /* Kilocounts.        */
+	unsigned kpm; /* Kilocounts per ms. */
+	
+	/* Time stamps are clock ticks. */
+	if (rate == 1)
+		return ((unsigned)d*(1000000/CLOCK_FREQ));
+	
+	n = (unsigned)(d >> 10);
+	kpm = (rate/(1000/CLOCK_FREQ)) >> 10;
+	
+	return ((n/kpm)*1000 + ((n%kpm)*1000)/kpm);
+}
+
+/*
+ * Prints a time in milliseconds.
+ */
+static void printms(unsigned us)
+{
+	printf("%6u.%03u", us/1000, us%1000);
+}
+
+/*
+ * Prints the boot timeline.
+ */
+int main(int argc, char *const argv[])
+{
+	int fd;                          /* Boot timeline.   */
+	ssize_t n;                       /* Bytes read.      */
+	unsigned nmarks;                 /* Number of marks. */
+	unsigned best;                   /* Longest phase.   */
+	unsigned us[NR_MARKS];           /* Phase lengths.   */
+	struct bootmark marks[NR_MARKS]; /* Marks.           */
+	
+	getargs(argc, argv);
+	
+	if ((fd = open(BOOTLOG_DEV, O_RDONLY)) < 0)
+	{
+		fprintf(stderr, "boottime: cannot open %s\n", BOOTLOG_DEV);
+		return (EXIT_FAILURE);
+	}
+	
+	/* Time stamps are not calibrated. */
+	if ((ioctl(fd, BOOTLOG_GETRATE, &rate) < 0) ||
+		((rate != 1) && ((rate/(1000/CLOCK_FREQ)) >> 10) == 0))
+	{
+		fprintf(stderr, "boottime: unknown time stamp rate\n");
+		close(fd);
+		return (EXIT_FAILURE);
+	}
+	
+	n = read(fd, marks, sizeof(marks));
+	close(fd);
+	
+	if (n <= 0)
+	{
+		fprintf(stderr, "boottime: empty boot timeline\n");
+		return (EXIT_FAILURE);
+	}
+	nmarks = n/sizeof(struct bootmark);
+	
+	/* Print timeline. */
+	printf("  time (ms)  phase (ms)  phase\n");
+	for (unsigned i = 0; i < nmarks; i++)
+	{
+		us[i] = (i + 1 < nmarks) ?
+			tous(marks[i + 1].stamp - marks[i].stamp) : 0;
+		
+		printf(" ");
+		printms(tous(marks[i].stamp - marks[0].stamp));
+		printf("  ");
+		printms(us[i]);
+		printf("  %s\n", marks[i].name);
+	}
+	
+	/* Print longest phases. */
+	printf("\nlongest phases:\n");
+	for (unsigned k = 0; (k < top) && (k + 1 < nmarks); k++)
+	{
+		best = 0;
+		for (unsigned i = 1; i < nmarks; i++)
+		{
+			if (us[i] > us[best])
+				best = i;
+		}
+		
+		printf(" ");
+		printms(us[best]);
+		printf("  %s\n", marks[best].name);
+		us[best] = 0;
+	}
+	
+	return (EXIT_SUCCESS);
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <sys/cachestat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Software versioning. */
+#define VERSION_MAJOR 1 /* Major version. */
+#define VERSION_MINOR 0 /* Minor version. */
+
+/* Drop caches? */
+static int drop = 0;
+
+/*
+ * Prints program version and exits.
+ */
+static void version(void)
+{
+	printf("cachestat (Nanvix Coreutils) %d.%d\n\n", VERSION_MAJOR, VERSION_MINOR);
+	printf("Copyright(C) 2011-2016 Pedro H. Penna\n");
+	printf("This is free software under the "); 
+	printf("GNU General Public License Version 3.\n");
+	printf("There is NO WARRANTY, to the extent permitted by law.\n\n");
+	
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ * Prints program usage and exits.
+ */
+static void usage(void)
+{
+	printf("Usage: cachestat [options]\n\n");
+	printf("Brief: Prints kernel cache statistics.\n\n");
+	printf("Options:\n");
+	printf("  --drop    Write back and drop caches first\n");
+	printf("  --help    Display this information and exit\n");
+	printf("  --version Display program version and exit\n");
+	
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ * Gets program arguments.
+ */
+static void getargs(int argc, char *const argv[])
+{
+	int i;     /* Loop index.       */
+	char *arg; /* Current argument. */
+	
+	/* Read command line arguments. */
+	for (i = 1; i < argc; i++)
+	{
+		arg = argv[i];
+		
+		/* Parse command line argument. */
+		if (!strcmp(arg, "--drop")) {
+			drop = 1;
+		}
+		else if (!strcmp(arg, "--help")) {
+			usage();
+		}
+		else if (!strcmp(arg, "--version")) {
+			version();
+		}
+		else {
+			fprintf(stderr, "cachestat: bad argument\n");
+			usage();
+		}
+	}
+}
+
+/*
+ * Prints statistics of a kernel cache.
+ */
+static int print(int cache, const char *name)
+{
+	struct cachestat st; /* Cache statistics. */
+	
+	if (cachestat(cache, &st) < 0)
+	{
+		fprintf(stderr, "cachestat: cannot get %s statistics\n", name);
+		return (-1);
+	}
+	
+	printf("%s:\n", name);
+	printf("  slots:      %d (%d in use, %d dirty)\n", st.size, st.used, st.dirty);
+	printf("  hits:       %u\n", st.hits);
+	printf("  misses:     %u\n", st.misses);
+	printf("  evictions:  %u\n", st.evictions);
+	printf("  writebacks: %u\n", st.writebacks);
+	printf("  waits:      %u\n", st.waits);
+	
+	return (0);
+}
+
+/*
+ * Prints kernel cache statistics.
+ */
+int main(int argc, char *const argv[])
+{
+	int ret;
+	
+	getargs(argc, argv);
+	
+	if ((drop) && (cachestat(CACHE_DROP, NULL) < 0))
+	{
+		fprintf(stderr, "cachestat: cannot drop caches\n");
+		return (EXIT_FAILURE);
+	}
+	
+	ret = print(CACHE_BUFFER, "block buffer cache");
+	ret |= print(CACHE_INODE, "inode cache");
+	ret |= print(CACHE_PAGE, "file page fault-around");
+	ret |= print(CACHE_FILE, "file page cache");
+	ret |= print(CACHE_BLOCK2, "RAM disk block cache");
+	
+	return ((ret == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -17,6 +17,7 @@
  * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
  */
  
+#include <sys/sendfile.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <errno.h>
@@ -30,6 +31,9 @@
 #define VERSION_MAJOR 1 /* Major version. */
 #define VERSION_MINOR 0 /* Minor version. */
 
+/* Bytes sent per call. */
+#define CHUNK_SIZE (1024*1024)
+
 /* Program arguments. */
 static char *const *filenames; /* Files to concatenate.           */
 static int nfiles = 0;         /* Number of files to concatenate. */
@@ -39,11 +43,8 @@ static int nfiles = 0;         /* Number of files to concatenate. */
  */
 static void cat(char *filename)
 {
-	int fd;           /* File descriptor.        */
-	int off;          /* Buffer offset.          */
-	char buf[BUFSIZ]; /* Buffer.                 */
-	ssize_t n, nread; /* Bytes actually read.    */
-	ssize_t nwritten; /* Bytes actually written. */
+	int fd;    /* File descriptor. */
+	ssize_t n; /* Bytes sent.      */
 	
 	fd = open(filename, O_RDONLY);
 	
@@ -55,28 +56,15 @@ static void cat(char *filename)
 	}
 	
 	/* Concatenate file. */
-	do
-	{	
-		/* Error while reading. */
-		if ((nread = read(fd, buf, BUFSIZ)) < 0)
-			fprintf(stderr, "cat: cannot read %s\n", filename);
-		
-		n = nread;
-		
-		off = 0;
-		do
-		{
-			nwritten = write(fileno(stdout), &buf[off], nread);
-			
-			/* Failed to write. */
-			if (nwritten < 0)
-			{
-				fprintf(stderr, "cat: write error\n");
-				exit(errno);
-			}
-			off += nwritten;
-		} while ((nread -= nwritten) > 0);
-	} while (n == BUFSIZ);	
+	while ((n = sendfile(fileno(stdout), fd, CHUNK_SIZE)) > 0)
+		/* noop */;
+	
+	/* Failed to send. */
+	if (n < 0)
+	{
+		fprintf(stderr, "cat: cannot concatenate %s\n", filename);
+		exit(errno);
+	}
 	
 	close(fd);
 }
@@ -17,8 +17,10 @@
  * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <sys/sendfile.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -29,6 +31,9 @@
 #define VERSION_MAJOR 1 /* Major version. */
 #define VERSION_MINOR 0 /* Minor version. */
 
+/* Bytes sent per call. */
+#define CHUNK_SIZE (1024*1024)
+
 /* Filenames. */
 static const char *src = NULL;  /* Source file. */
 static const char *dest = NULL; /* Destination file. */
@@ -38,25 +43,62 @@ static const char *dest = NULL; /* Destination file. */
  */
 static void do_cp(int src, int dest)
 {
-	ssize_t count;    /* Bytes read/written.  */
-	char buf[BUFSIZ]; /* Buffer.              */
+	ssize_t count; /* Bytes sent. */
 	
 	/* Copy source file into destination file. */
-	while ((count = read(src, buf, BUFSIZ)) > 0) {
-		count = write(dest, buf, count);
+	while ((count = sendfile(dest, src, CHUNK_SIZE)) > 0)
+		/* noop */;
+	
+	/* Copy error. */
+	if (count < 0) {
+		fprintf(stderr, "cp: copy error\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+/*
+ * Copies a regular file, leaving its holes unallocated.
+ */
+static void do_cp_sparse(int src, int dest, off_t size)
+{
+	off_t data;    /* Start of data region. */
+	off_t hole;    /* End of data region.   */
+	size_t n;      /* Bytes to send.        */
+	ssize_t count; /* Bytes sent.           */
+	
+	/* Copy data regions only. */
+	for (data = 0; (data = lseek(src, data, SEEK_DATA)) >= 0; data = hole) {
+		if ((hole = lseek(src, data, SEEK_HOLE)) < 0)
+			goto error;
 		
-		/* Write error. */
-		if (count < 0) {
-			fprintf(stderr, "cp: write error\n");
-			exit(EXIT_FAILURE);
+		if ((lseek(src, data, SEEK_SET) < 0) || (lseek(dest, data, SEEK_SET) < 0))
+			goto error;
+		
+		while (data < hole) {
+			n = ((hole - data) < CHUNK_SIZE) ? (size_t)(hole - data) : CHUNK_SIZE;
+			
+			if ((count = sendfile(dest, src, n)) <= 0)
+				goto error;
+			
+			data += count;
 		}
 	}
 	
-	/* Error while reading. */
-	if (count < 0) {
-		fprintf(stderr, "cp: read error\n");
-		exit(EXIT_FAILURE);
+	/* No more data. */
+	if (errno != ENXIO)
+		goto error;
+	
+	/* Trailing hole still has to count for the size. */
+	if ((size > 0) && (lseek(dest, 0, SEEK_END) < size)) {
+		if ((lseek(dest, size - 1, SEEK_SET) < 0) || (write(dest, "", 1) != 1))
+			goto error;
 	}
+	
+	return;
+
+error:
+	fprintf(stderr, "cp: copy error\n");
+	exit(EXIT_FAILURE);
 }
 
 /*
@@ -70,6 +112,7 @@ static void cp(const char *dest, const char *src)
 	int destfd;       /* Destination file file descriptor. */
 	struct stat st;   /* Working file's status.            */
 	mode_t mode;      /* Creation mode.                    */
+	off_t size;       /* Source file size.                 */
 	
 	/* Cannot stat source file. */
 	if (stat(src, &st) == -1) {
@@ -86,6 +129,7 @@ static void cp(const char *dest, const char *src)
 	dev = st.st_dev;
 	ino = st.st_ino;
 	mode = st.st_mode;
+	size = st.st_size;
 	
 	/* Destination file already exists. */
 	if (stat(dest, &st) != -1) {
@@ -118,7 +162,10 @@ static void cp(const char *dest, const char *src)
 		exit(EXIT_FAILURE);
 	}
 	
-	do_cp(srcfd, destfd);
+	if (S_ISREG(mode))
+		do_cp_sparse(srcfd, destfd, size);
+	else
+		do_cp(srcfd, destfd);
 	
 	close(destfd);
 	close(srcfd);
@@ -0,0 +1,434 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <sys/gmon.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Software versioning. */
+#define VERSION_MAJOR 1 /* Major version. */
+#define VERSION_MINOR 0 /* Minor version. */
+
+/* Default number of symbols to report. */
+#define NR_TOP 20
+
+/*
+ * Program arguments.
+ */
+static struct
+{
+	unsigned top;        /* Symbols to report. */
+	const char *program; /* Profiled program.  */
+	const char *profile; /* Profile file.      */
+} args = { NR_TOP, NULL, GMON_OUT };
+
+/*
+ * Symbol.
+ */
+struct sym
+{
+	unsigned addr;    /* Start address.   */
+	unsigned size;    /* Size (in bytes). */
+	const char *name; /* Name.            */
+	unsigned count;   /* Samples hit.     */
+};
+
+/*
+ * Symbol table.
+ */
+static struct
+{
+	struct sym *syms; /* Symbols.           */
+	int nsyms;        /* Number of symbols. */
+	struct sym other; /* Unknown symbol.    */
+} symtab = { NULL, 0, { 0, 0, "[unknown]", 0 } };
+
+/*
+ * Prints program version and exits.
+ */
+static void version(void)
+{
+	printf("gprof (Nanvix Coreutils) %d.%d\n\n", VERSION_MAJOR, VERSION_MINOR);
+	printf("Copyright(C) 2011-2016 Pedro H. Penna\n");
+	printf("This is free software under the "); 
+	printf("GNU General Public License Version 3.\n");
+	printf("There is NO WARRANTY, to the extent permitted by law.\n\n");
+	
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ * Prints program usage and exits.
+ */
+static void usage(void)
+{
+	printf("Usage: gprof [options] <program> [profile]\n\n");
+	printf("Brief: Reports the flat profile of a program.\n\n");
+	printf("The profile defaults to %s, as written by _mcleanup().\n\n",
+		GMON_OUT);
+	printf("Options:\n");
+	printf("  --top <n>       Report the n hottest functions\n");
+	printf("  --help          Display this information and exit\n");
+	printf("  --version       Display program version and exit\n");
+	
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ * Gets program arguments.
+ */
+static void getargs(int argc, char *const argv[])
+{
+	int i;     /* Loop index.       */
+	char *arg; /* Current argument. */
+	
+	/* Read command line arguments. */
+	for (i = 1; i < argc; i++)
+	{
+		arg = argv[i];
+		
+		/* Parse command line argument. */
+		if (!strcmp(arg, "--help")) {
+			usage();
+		}
+		else if (!strcmp(arg, "--version")) {
+			version();
+		}
+		else if ((!strcmp(arg, "--top")) && (i + 1 < argc)) {
+			args.top = strtoul(argv[++i], NULL, 0);
+		}
+		else if (args.program == NULL) {
+			args.program = arg;
+		}
+		else {
+			args.profile = arg;
+		}
+	}
+	
+	/* Missing program. */
+	if (args.program == NULL)
+	{
+		fprintf(stderr, "gprof: missing program\n");
+		usage();
+	}
+}
+
+/*
+ * Reads n bytes at offset off of a file.
+ */
+static int readat(int fd, void *buf, size_t n, off_t off)
+{
+	if (lseek(fd, off, SEEK_SET) < 0)
+		return (-1);
+	
+	return ((read(fd, buf, n) == (ssize_t)n) ? 0 : -1);
+}
+
+/*
+ * Compares two symbols by address.
+ */
+static int symcmp(const void *a, const void *b)
+{
+	const struct sym *s1 = a;
+	const struct sym *s2 = b;
+	
+	if (s1->addr < s2->addr)
+		return (-1);
+	
+	return (s1->addr > s2->addr);
+}
+
+/*
+ * Loads the function symbols of an ELF file.
+ */
+static int loadsyms(const char *path)
+{
+	int fd;                   /* ELF file.            */
+	unsigned i;               /* Loop index.          */
+	char *strtab;             /* String table.        */
+	struct elf32_fhdr fhdr;   /* File header.         */
+	struct elf32_shdr shdr;   /* Section header.      */
+	struct elf32_shdr strhdr; /* String table header. */
+	struct elf32_sym esym;    /* ELF symbol.          */
+	
+	if ((fd = open(path, O_RDONLY)) < 0)
+		goto error0;
+	
+	if (readat(fd, &fhdr, sizeof(fhdr), 0) < 0)
+		goto error1;
+	
+	/* Not an ELF file. */
+	if ((fhdr.e_ident[0] != ELFMAG0) || (fhdr.e_ident[1] != ELFMAG1) ||
+		(fhdr.e_ident[2] != ELFMAG2) || (fhdr.e_ident[3] != ELFMAG3))
+		goto error1;
+	
+	/* Look for the symbol table. */
+	for (i = 0; i < fhdr.e_shnum; i++)
+	{
+		if (readat(fd, &shdr, sizeof(shdr),
+			fhdr.e_shoff + i*fhdr.e_shentsize) < 0)
+			goto error1;
+		if (shdr.sh_type == SHT_SYMTAB)
+			break;
+	}
+	
+	/* Stripped. */
+	if (i == fhdr.e_shnum)
+		goto error1;
+	
+	/* Load string table. */
+	if (readat(fd, &strhdr, sizeof(strhdr),
+		fhdr.e_shoff + shdr.sh_link*fhdr.e_shentsize) < 0)
+		goto error1;
+	if ((strtab = malloc(strhdr.sh_size + 1)) == NULL)
+		goto error1;
+	if (readat(fd, strtab, strhdr.sh_size, strhdr.sh_offset) < 0)
+		goto error2;
+	strtab[strhdr.sh_size] = '\0';
+	
+	symtab.syms = malloc((shdr.sh_size/sizeof(esym))*sizeof(struct sym));
+	if (symtab.syms == NULL)
+		goto error2;
+	
+	/* Load function symbols. */
+	for (i = 0; i < shdr.sh_size/sizeof(esym); i++)
+	{
+		if (readat(fd, &esym, sizeof(esym),
+			shdr.sh_offset + i*sizeof(esym)) < 0)
+			break;
+		
+		if (ELF32_ST_TYPE(esym.st_info) != STT_FUNC)
+			continue;
+		if (esym.st_name >= strhdr.sh_size)
+			continue;
+		
+		symtab.syms[symtab.nsyms].addr = esym.st_value;
+		symtab.syms[symtab.nsyms].size = esym.st_size;
+		symtab.syms[symtab.nsyms].name = &strtab[esym.st_name];
+		symtab.syms[symtab.nsyms].count = 0;
+		symtab.nsyms++;
+	}
+	
+	qsort(symtab.syms, symtab.nsyms, sizeof(struct sym), symcmp);
+	
+	close(fd);
+	
+	return (0);
+
+error2:
+	free(strtab);
+error1:
+	close(fd);
+error0:
+	fprintf(stderr, "gprof: cannot load symbols from %s\n", path);
+	return (-1);
+}
+
+/*
+ * Finds the symbol that holds an address.
+ */
+static struct sym *lookup(unsigned addr)
+{
+	int lo, hi, mid; /* Search bounds.  */
+	struct sym *sym; /* Working symbol. */
+	
+	sym = NULL;
+	lo = 0;
+	hi = symtab.nsyms - 1;
+	
+	/* Last symbol that starts at or before addr. */
+	while (lo <= hi)
+	{
+		mid = (lo + hi)/2;
+		
+		if (symtab.syms[mid].addr <= addr)
+		{
+			sym = &symtab.syms[mid];
+			lo = mid + 1;
+		}
+		else
+			hi = mid - 1;
+	}
+	
+	/* Outside of any symbol. */
+	if ((sym == NULL) || ((sym->size > 0) && (addr >= sym->addr + sym->size)))
+		return (&symtab.other);
+	
+	return (sym);
+}
+
+/*
+ * Compares two symbols by samples hit, in descending order.
+ */
+static int hotcmp(const void *a, const void *b)
+{
+	const struct sym *s1 = *(struct sym *const *)a;
+	const struct sym *s2 = *(struct sym *const *)b;
+	
+	if (s1->count > s2->count)
+		return (-1);
+	
+	return (s1->count < s2->count);
+}
+
+/*
+ * Loads a profile and attributes its samples to functions.
+ */
+static int loadprof(const char *path, struct gmonhdr *hdr)
+{
+	int fd;                /* Profile file.      */
+	unsigned i;            /* Loop index.        */
+	unsigned short *hist;  /* Histogram.         */
+	unsigned addr;         /* Start of a bucket. */
+	unsigned q, r;         /* Bucket span.       */
+	
+	if ((fd = open(path, O_RDONLY)) < 0)
+		goto error0;
+	
+	if (readat(fd, hdr, sizeof(struct gmonhdr), 0) < 0)
+		goto error1;
+	
+	/* Not a profile. */
+	if ((hdr->magic != GMON_MAGIC) || (hdr->scale == 0) || (hdr->rate == 0))
+		goto error1;
+	
+	if ((hist = malloc(hdr->ncnt*sizeof(unsigned short))) == NULL)
+		goto error1;
+	if (read(fd, hist, hdr->ncnt*sizeof(unsigned short)) !=
+		(ssize_t)(hdr->ncnt*sizeof(unsigned short)))
+		goto error2;
+	
+	/*
+	 * Bucket i starts at the lowest address that
+	 * profil() maps to it, 2*ceil(i*0x10000/scale)
+	 * bytes above the lowest profiled address.
+	 */
+	q = 0x10000/hdr->scale;
+	r = 0x10000%hdr->scale;
+	for (i = 0; i < hdr->ncnt; i++)
+	{
+		if (hist[i] == 0)
+			continue;
+		
+		addr = hdr->lowpc + 2*(i*q + (i*r + hdr->scale - 1)/hdr->scale);
+		lookup(addr)->count += hist[i];
+	}
+	
+	free(hist);
+	close(fd);
+	
+	return (0);
+
+error2:
+	free(hist);
+error1:
+	close(fd);
+error0:
+	fprintf(stderr, "gprof: cannot load profile from %s\n", path);
+	return (-1);
+}
+
+/*
+ * Prints a duration given in samples.
+ */
+static void printsecs(unsigned count, unsigned rate)
+{
+	printf("%6u.%02u", count/rate, ((count%rate)*100)/rate);
+}
+
+/*
+ * Reports the flat profile.
+ */
+static void report(const struct gmonhdr *hdr)
+{
+	int i;            /* Loop index.          */
+	int nhot;         /* Hot symbols.         */
+	unsigned total;   /* Samples taken.       */
+	unsigned cumul;   /* Cumulative samples.  */
+	struct sym **hot; /* Hot symbols.         */
+	
+	hot = malloc((symtab.nsyms + 1)*sizeof(struct sym *));
+	if (hot == NULL)
+	{
+		fprintf(stderr, "gprof: out of memory\n");
+		return;
+	}
+	
+	total = symtab.other.count;
+	nhot = 0;
+	for (i = 0; i < symtab.nsyms; i++)
+	{
+		total += symtab.syms[i].count;
+		if (symtab.syms[i].count > 0)
+			hot[nhot++] = &symtab.syms[i];
+	}
+	if (symtab.other.count > 0)
+		hot[nhot++] = &symtab.other;
+	
+	if (total == 0)
+	{
+		printf("gprof: no samples\n");
+		free(hot);
+		return;
+	}
+	
+	qsort(hot, nhot, sizeof(struct sym *), hotcmp);
+	
+	printf("Flat profile, %u samples at %u per second:\n\n", total,
+		hdr->rate);
+	printf("  %%    cumulative      self\n");
+	printf(" time     seconds   seconds  samples  name\n");
+	
+	cumul = 0;
+	for (i = 0; (i < nhot) && (i < (int)args.top); i++)
+	{
+		cumul += hot[i]->count;
+		printf("%5u   ", (hot[i]->count*100)/total);
+		printsecs(cumul, hdr->rate);
+		printf("   ");
+		printsecs(hot[i]->count, hdr->rate);
+		printf(" %8u  %s\n", hot[i]->count, hot[i]->name);
+	}
+	
+	free(hot);
+}
+
+/*
+ * Reports the flat profile of a program.
+ */
+int main(int argc, char *const argv[])
+{
+	struct gmonhdr hdr; /* Profile header. */
+	
+	getargs(argc, argv);
+	
+	if (loadsyms(args.program) < 0)
+		return (EXIT_FAILURE);
+	
+	if (loadprof(args.profile, &hdr) < 0)
+		return (EXIT_FAILURE);
+	
+	report(&hdr);
+	
+	return (EXIT_SUCCESS);
+}
@@ -0,0 +1,197 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <sys/ioprio.h>
+#include <sys/types.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Software versioning. */
+#define VERSION_MAJOR 1 /* Major version. */
+#define VERSION_MINOR 0 /* Minor version. */
+
+/* Names of I/O scheduling classes. */
+static const char *classes[IOPRIO_CLASSES] = {
+	"realtime", "best-effort", "idle"
+};
+
+/*
+ * Program arguments.
+ */
+static struct
+{
+	int ioclass;    /* I/O scheduling class.        */
+	pid_t pid;      /* Target process.              */
+	char **command; /* Program to execute.          */
+} args = { -1, 0, NULL };
+
+/*
+ * Prints program version and exits.
+ */
+static void version(void)
+{
+	printf("ionice (Nanvix Coreutils) %d.%d\n\n", VERSION_MAJOR, VERSION_MINOR);
+	printf("Copyright(C) 2011-2016 Pedro H. Penna\n");
+	printf("This is free software under the "); 
+	printf("GNU General Public License Version 3.\n");
+	printf("There is NO WARRANTY, to the extent permitted by law.\n\n");
+	
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ * Prints program usage and exits.
+ */
+static void usage(void)
+{
+	printf("Usage: ionice [options] [<command> [arguments...]]\n\n");
+	printf("Brief: Gets or sets the I/O scheduling class of a process.\n\n");
+	printf("Options:\n");
+	printf("  -c <class>     I/O scheduling class: 0 (realtime),\n");
+	printf("                 1 (best-effort) or 2 (idle)\n");
+	printf("  --help         Display this information and exit\n");
+	printf("  -p <pid>       Act on a running process\n");
+	printf("  --version      Display program version and exit\n");
+	
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ * Gets program arguments.
+ */
+static void getargs(int argc, char *const argv[])
+{
+	int i;           /* Loop index.       */
+	char *arg;       /* Current argument. */
+	int state;       /* Processing state. */
+	
+	/* State values. */
+	#define READ_ARG  0 /* Read argument.            */
+	#define SET_CLASS 1 /* Set I/O scheduling class. */
+	#define SET_PID   2 /* Set target process.       */
+	
+	state = READ_ARG;
+	
+	/* Read command line arguments. */
+	for (i = 1; i < argc; i++)
+	{
+		arg = argv[i];
+		
+		/* Set value. */
+		if (state != READ_ARG)
+		{
+			switch (state)
+			{
+				/* Set I/O scheduling class. */
+				case SET_CLASS:
+					args.ioclass = atoi(arg);
+					state = READ_ARG;
+					break;
+				
+				/* Set target process. */
+				case SET_PID:
+					args.pid = atoi(arg);
+					state = READ_ARG;
+					break;
+				
+				/* Bad usage.*/
+				default:
+					usage();
+			}
+			
+			continue;
+		}
+		
+		/* Parse command line argument. */
+		if (!strcmp(arg, "--help")) {
+			usage();
+		}
+		else if (!strcmp(arg, "--version")) {
+			version();
+		}
+		else if (!strcmp(arg, "-c")) {
+			state = SET_CLASS;
+		}
+		else if (!strcmp(arg, "-p")) {
+			state = SET_PID;
+		}
+		else
+		{
+			args.command = (char **)&argv[i];
+			break;
+		}
+	}
+	
+	/* Check if arguments are valid. */
+	if ((args.ioclass < -1) || (args.ioclass >= IOPRIO_CLASSES))
+	{
+		fprintf(stderr, "ionice: bad class\n");
+		usage();
+	}
+	if ((args.command != NULL) && (args.pid != 0))
+	{
+		fprintf(stderr, "ionice: both command and process given\n");
+		usage();
+	}
+	if ((args.command != NULL) && (args.ioclass < 0))
+	{
+		fprintf(stderr, "ionice: missing class\n");
+		usage();
+	}
+}
+
+/*
+ * Gets or sets the I/O scheduling class of a process.
+ */
+int main(int argc, char *const argv[])
+{
+	int ioclass;
+	
+	getargs(argc, argv);
+	
+	/* Run a command. */
+	if (args.command != NULL)
+	{
+		if (ioprio_set(0, args.ioclass) < 0)
+		{
+			fprintf(stderr, "ionice: cannot ioprio_set()\n");
+			return (EXIT_FAILURE);
+		}
+		
+		execvp(args.command[0], &args.command[0]);
+		
+		fprintf(stderr, "ionice: cannot execvp()\n");
+		return (EXIT_FAILURE);
+	}
+	
+	/* Same process, or another one. */
+	if ((ioclass = ioprio_set(args.pid, args.ioclass)) < 0)
+	{
+		fprintf(stderr, "ionice: cannot ioprio_set()\n");
+		return (EXIT_FAILURE);
+	}
+	
+	/* Query only. */
+	if (args.ioclass < 0)
+		printf("%s\n", classes[ioclass]);
+	
+	return (EXIT_SUCCESS);
+}
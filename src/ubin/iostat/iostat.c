@@ -0,0 +1,192 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <nanvix/clock.h>
+#include <sys/iostat.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Software versioning. */
+#define VERSION_MAJOR 1 /* Major version. */
+#define VERSION_MINOR 0 /* Minor version. */
+
+/* Program arguments. */
+static char *pathname = "/";  /* File in the device.          */
+static unsigned interval = 0; /* Seconds between reports.     */
+static unsigned count = 0;    /* Number of reports (0: ever). */
+
+/*
+ * Prints program version and exits.
+ */
+static void version(void)
+{
+	printf("iostat (Nanvix Coreutils) %d.%d\n\n", VERSION_MAJOR, VERSION_MINOR);
+	printf("Copyright(C) 2011-2016 Pedro H. Penna\n");
+	printf("This is free software under the "); 
+	printf("GNU General Public License Version 3.\n");
+	printf("There is NO WARRANTY, to the extent permitted by law.\n\n");
+	
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ * Prints program usage and exits.
+ */
+static void usage(void)
+{
+	printf("Usage: iostat [options] [file] [interval [count]]\n\n");
+	printf("Brief: Prints I/O statistics of the device holding a file.\n");
+	printf("       Given an interval, prints rates every interval seconds.\n\n");
+	printf("Options:\n");
+	printf("  --help    Display this information and exit\n");
+	printf("  --version Display program version and exit\n");
+	
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ * Gets program arguments.
+ */
+static void getargs(int argc, char *const argv[])
+{
+	int i;     /* Loop index.        */
+	int n;     /* # numeric args.    */
+	char *arg; /* Current argument.  */
+	
+	n = 0;
+	
+	/* Read command line arguments. */
+	for (i = 1; i < argc; i++)
+	{
+		arg = argv[i];
+		
+		/* Parse command line argument. */
+		if (!strcmp(arg, "--help")) {
+			usage();
+		}
+		else if (!strcmp(arg, "--version")) {
+			version();
+		}
+		else if ((arg[0] >= '0') && (arg[0] <= '9'))
+		{
+			if (n++ == 0)
+				interval = atoi(arg);
+			else
+				count = atoi(arg);
+		}
+		else {
+			pathname = arg;
+		}
+	}
+}
+
+/*
+ * Prints the rates of a block device over an interval.
+ */
+static void rates(const struct iostat *old, const struct iostat *io, int dt)
+{
+	unsigned done; /* Requests completed. */
+	
+	done = (io->reads - old->reads) + (io->writes - old->writes) +
+		(io->flushes - old->flushes);
+	
+	printf("%5u %5u %7u %7u %5u %5u %4u%% %5u\n",
+		((io->reads - old->reads)*CLOCK_FREQ)/dt,
+		((io->writes - old->writes)*CLOCK_FREQ)/dt,
+		((io->rsectors - old->rsectors)*CLOCK_FREQ)/(2*dt),
+		((io->wsectors - old->wsectors)*CLOCK_FREQ)/(2*dt),
+		((io->merges - old->merges)*CLOCK_FREQ)/dt,
+		(done) ? ((io->wait - old->wait)*1000)/(CLOCK_FREQ*done) : 0,
+		((io->busy - old->busy)*100)/dt,
+		io->queued);
+}
+
+/*
+ * Prints I/O statistics of a block device.
+ */
+int main(int argc, char *const argv[])
+{
+	int t0;            /* Last report time. */
+	int t;             /* Current time.     */
+	unsigned done;     /* Requests done.    */
+	struct stat st;    /* File status.      */
+	struct iostat io;  /* I/O statistics.   */
+	struct iostat old; /* Last statistics.  */
+	
+	getargs(argc, argv);
+	
+	if (stat(pathname, &st) < 0)
+	{
+		fprintf(stderr, "iostat: cannot stat %s\n", pathname);
+		return (EXIT_FAILURE);
+	}
+	
+	if (iostat(st.st_dev, &io) < 0)
+	{
+		fprintf(stderr, "iostat: cannot get device statistics\n");
+		return (EXIT_FAILURE);
+	}
+	t0 = gticks();
+	
+	done = io.reads + io.writes + io.flushes;
+	
+	printf("device %x:\n", st.st_dev);
+	printf("  requests:   %u (%u queued, %u in flight)\n", io.requests,
+		io.queued, io.inflight);
+	printf("  reads:      %u (%u kB)\n", io.reads, io.rsectors/2);
+	printf("  writes:     %u (%u kB)\n", io.writes, io.wsectors/2);
+	printf("  flushes:    %u\n", io.flushes);
+	printf("  commands:   %u (%u merges)\n", io.commands, io.merges);
+	printf("  expired:    %u\n", io.expired);
+	printf("  busy:       %u ms\n", (io.busy*1000)/CLOCK_FREQ);
+	printf("  avg. wait:  %u ms\n", (done) ? (io.wait*1000)/(CLOCK_FREQ*done) : 0);
+	printf("  avg. depth: %u\n", (io.requests) ? io.depth/io.requests : 0);
+	printf("  avg. seek:  %u blocks\n", (io.commands) ? io.seek/io.commands : 0);
+	
+	if (interval == 0)
+		return (EXIT_SUCCESS);
+	
+	printf("\n  r/s   w/s   rkB/s   wkB/s mrg/s  wait  util queue\n");
+	
+	/* Print rates at every interval. */
+	while (1)
+	{
+		old = io;
+		sleep(interval);
+		
+		if (iostat(st.st_dev, &io) < 0)
+		{
+			fprintf(stderr, "iostat: cannot get device statistics\n");
+			return (EXIT_FAILURE);
+		}
+		t = gticks();
+		
+		if (t > t0)
+			rates(&old, &io, t - t0);
+		t0 = t;
+		
+		if ((count > 0) && (--count == 0))
+			break;
+	}
+	
+	return (EXIT_SUCCESS);
+}
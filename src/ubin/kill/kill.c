@@ -95,6 +95,8 @@ static int getsig(char *signame)
 	else if (!strcmp(signame, "SIGUSR1")) return(SIGUSR1);
 	else if (!strcmp(signame, "SIGUSR2")) return(SIGUSR2);
 	else if (!strcmp(signame, "SIGTRAP")) return(SIGTRAP);
+	else if (!strcmp(signame, "SIGVTALRM")) return(SIGVTALRM);
+	else if (!strcmp(signame, "SIGPROF")) return(SIGPROF);
 	
 	return (-1);
 }
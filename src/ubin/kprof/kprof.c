@@ -0,0 +1,449 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <sys/kprof.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stropts.h>
+#include <unistd.h>
+
+/* Software versioning. */
+#define VERSION_MAJOR 1 /* Major version. */
+#define VERSION_MINOR 0 /* Minor version. */
+
+/* Profiler device. */
+#define KPROF_DEV "/dev/kprof"
+
+/* Samples read at once. */
+#define NR_SAMPLES 256
+
+/* Default number of symbols to report. */
+#define NR_TOP 20
+
+/*
+ * Program arguments.
+ */
+static struct
+{
+	int start;          /* Start sampling?        */
+	int stop;           /* Stop sampling?         */
+	unsigned rate;      /* Samples per tick.      */
+	unsigned top;       /* Symbols to report.     */
+	const char *kernel; /* Kernel ELF file.       */
+	const char *user;   /* User ELF file.         */
+} args = { 0, 0, 1, NR_TOP, NULL, NULL };
+
+/*
+ * Symbol.
+ */
+struct sym
+{
+	unsigned addr;    /* Start address.   */
+	unsigned size;    /* Size (in bytes). */
+	const char *name; /* Name.            */
+	unsigned count;   /* Samples hit.     */
+	int user;         /* User symbol?     */
+};
+
+/*
+ * Symbol table.
+ */
+struct symtab
+{
+	struct sym *syms; /* Symbols.           */
+	int nsyms;        /* Number of symbols. */
+	struct sym other; /* Unknown symbol.    */
+};
+
+/* Kernel and user symbols. */
+static struct symtab ksyms = { NULL, 0, { 0, 0, "[kernel]", 0, 0 } };
+static struct symtab usyms = { NULL, 0, { 0, 0, "[user]", 0, 1 } };
+
+/*
+ * Prints program version and exits.
+ */
+static void version(void)
+{
+	printf("kprof (Nanvix Coreutils) %d.%d\n\n", VERSION_MAJOR, VERSION_MINOR);
+	printf("Copyright(C) 2011-2016 Pedro H. Penna\n");
+	printf("This is free software under the "); 
+	printf("GNU General Public License Version 3.\n");
+	printf("There is NO WARRANTY, to the extent permitted by law.\n\n");
+	
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ * Prints program usage and exits.
+ */
+static void usage(void)
+{
+	printf("Usage: kprof [options]\n\n");
+	printf("Brief: Controls the kernel profiler and reports samples.\n\n");
+	printf("Options:\n");
+	printf("  --start         Start sampling\n");
+	printf("  --stop          Stop sampling\n");
+	printf("  --rate <n>      Take n samples per clock tick\n");
+	printf("  --kernel <file> Symbolize kernel samples against file\n");
+	printf("  --user <file>   Symbolize user samples against file\n");
+	printf("  --top <n>       Report the n hottest symbols\n");
+	printf("  --help          Display this information and exit\n");
+	printf("  --version       Display program version and exit\n");
+	
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ * Gets program arguments.
+ */
+static void getargs(int argc, char *const argv[])
+{
+	int i;     /* Loop index.       */
+	char *arg; /* Current argument. */
+	
+	/* Read command line arguments. */
+	for (i = 1; i < argc; i++)
+	{
+		arg = argv[i];
+		
+		/* Parse command line argument. */
+		if (!strcmp(arg, "--help")) {
+			usage();
+		}
+		else if (!strcmp(arg, "--version")) {
+			version();
+		}
+		else if (!strcmp(arg, "--start")) {
+			args.start = 1;
+		}
+		else if (!strcmp(arg, "--stop")) {
+			args.stop = 1;
+		}
+		else if ((!strcmp(arg, "--rate")) && (i + 1 < argc)) {
+			args.rate = strtoul(argv[++i], NULL, 0);
+		}
+		else if ((!strcmp(arg, "--kernel")) && (i + 1 < argc)) {
+			args.kernel = argv[++i];
+		}
+		else if ((!strcmp(arg, "--user")) && (i + 1 < argc)) {
+			args.user = argv[++i];
+		}
+		else if ((!strcmp(arg, "--top")) && (i + 1 < argc)) {
+			args.top = strtoul(argv[++i], NULL, 0);
+		}
+		else {
+			fprintf(stderr, "kprof: bad argument\n");
+			usage();
+		}
+	}
+}
+
+/*
+ * Reads n bytes at offset off of a file.
+ */
+static int readat(int fd, void *buf, size_t n, off_t off)
+{
+	if (lseek(fd, off, SEEK_SET) < 0)
+		return (-1);
+	
+	return ((read(fd, buf, n) == (ssize_t)n) ? 0 : -1);
+}
+
+/*
+ * Compares two symbols by address.
+ */
+static int symcmp(const void *a, const void *b)
+{
+	const struct sym *s1 = a;
+	const struct sym *s2 = b;
+	
+	if (s1->addr < s2->addr)
+		return (-1);
+	
+	return (s1->addr > s2->addr);
+}
+
+/*
+ * Loads the function symbols of an ELF file.
+ */
+static int loadsyms(struct symtab *tab, const char *path)
+{
+	int fd;                   /* ELF file.            */
+	unsigned i;               /* Loop index.          */
+	char *strtab;             /* String table.        */
+	struct elf32_fhdr fhdr;   /* File header.         */
+	struct elf32_shdr shdr;   /* Section header.      */
+	struct elf32_shdr strhdr; /* String table header. */
+	struct elf32_sym esym;    /* ELF symbol.          */
+	
+	if ((fd = open(path, O_RDONLY)) < 0)
+		goto error0;
+	
+	if (readat(fd, &fhdr, sizeof(fhdr), 0) < 0)
+		goto error1;
+	
+	/* Not an ELF file. */
+	if ((fhdr.e_ident[0] != ELFMAG0) || (fhdr.e_ident[1] != ELFMAG1) ||
+		(fhdr.e_ident[2] != ELFMAG2) || (fhdr.e_ident[3] != ELFMAG3))
+		goto error1;
+	
+	/* Look for the symbol table. */
+	for (i = 0; i < fhdr.e_shnum; i++)
+	{
+		if (readat(fd, &shdr, sizeof(shdr),
+			fhdr.e_shoff + i*fhdr.e_shentsize) < 0)
+			goto error1;
+		if (shdr.sh_type == SHT_SYMTAB)
+			break;
+	}
+	
+	/* Stripped. */
+	if (i == fhdr.e_shnum)
+		goto error1;
+	
+	/* Load string table. */
+	if (readat(fd, &strhdr, sizeof(strhdr),
+		fhdr.e_shoff + shdr.sh_link*fhdr.e_shentsize) < 0)
+		goto error1;
+	if ((strtab = malloc(strhdr.sh_size + 1)) == NULL)
+		goto error1;
+	if (readat(fd, strtab, strhdr.sh_size, strhdr.sh_offset) < 0)
+		goto error2;
+	strtab[strhdr.sh_size] = '\0';
+	
+	tab->syms = malloc((shdr.sh_size/sizeof(esym))*sizeof(struct sym));
+	if (tab->syms == NULL)
+		goto error2;
+	
+	/* Load function symbols. */
+	for (i = 0; i < shdr.sh_size/sizeof(esym); i++)
+	{
+		if (readat(fd, &esym, sizeof(esym),
+			shdr.sh_offset + i*sizeof(esym)) < 0)
+			break;
+		
+		if (ELF32_ST_TYPE(esym.st_info) != STT_FUNC)
+			continue;
+		if (esym.st_name >= strhdr.sh_size)
+			continue;
+		
+		tab->syms[tab->nsyms].addr = esym.st_value;
+		tab->syms[tab->nsyms].size = esym.st_size;
+		tab->syms[tab->nsyms].name = &strtab[esym.st_name];
+		tab->syms[tab->nsyms].count = 0;
+		tab->syms[tab->nsyms].user = tab->other.user;
+		tab->nsyms++;
+	}
+	
+	qsort(tab->syms, tab->nsyms, sizeof(struct sym), symcmp);
+	
+	close(fd);
+	
+	return (0);
+
+error2:
+	free(strtab);
+error1:
+	close(fd);
+error0:
+	fprintf(stderr, "kprof: cannot load symbols from %s\n", path);
+	return (-1);
+}
+
+/*
+ * Finds the symbol that holds an address.
+ */
+static struct sym *lookup(struct symtab *tab, unsigned addr)
+{
+	int lo, hi, mid; /* Search bounds.  */
+	struct sym *sym; /* Working symbol. */
+	
+	sym = NULL;
+	lo = 0;
+	hi = tab->nsyms - 1;
+	
+	/* Last symbol that starts at or before addr. */
+	while (lo <= hi)
+	{
+		mid = (lo + hi)/2;
+		
+		if (tab->syms[mid].addr <= addr)
+		{
+			sym = &tab->syms[mid];
+			lo = mid + 1;
+		}
+		else
+			hi = mid - 1;
+	}
+	
+	/* Outside of any symbol. */
+	if ((sym == NULL) || ((sym->size > 0) && (addr >= sym->addr + sym->size)))
+		return (&tab->other);
+	
+	return (sym);
+}
+
+/*
+ * Compares two symbols by samples hit, in descending order.
+ */
+static int hotcmp(const void *a, const void *b)
+{
+	const struct sym *s1 = *(struct sym *const *)a;
+	const struct sym *s2 = *(struct sym *const *)b;
+	
+	if (s1->count > s2->count)
+		return (-1);
+	
+	return (s1->count < s2->count);
+}
+
+/*
+ * Collects symbols that were hit at least once.
+ */
+static int collect(struct symtab *tab, struct sym **hot, int n)
+{
+	int i;
+	
+	for (i = 0; i < tab->nsyms; i++)
+	{
+		if (tab->syms[i].count > 0)
+			hot[n++] = &tab->syms[i];
+	}
+	
+	if (tab->other.count > 0)
+		hot[n++] = &tab->other;
+	
+	return (n);
+}
+
+/*
+ * Reports where samples were taken.
+ */
+static void report(int fd)
+{
+	int i;                                    /* Loop index.            */
+	int nhot;                                 /* Hot symbols.           */
+	ssize_t n;                                /* Bytes read.            */
+	unsigned lost;                            /* Samples lost.          */
+	unsigned total;                           /* Samples taken.         */
+	unsigned nuser;                           /* Samples in user mode.  */
+	struct sym *sym;                          /* Working symbol.        */
+	struct sym **hot;                         /* Hot symbols.           */
+	struct kprof_sample samples[NR_SAMPLES];  /* Samples.               */
+	
+	total = nuser = 0;
+	
+	/* Symbolize samples. */
+	while ((n = read(fd, samples, sizeof(samples))) > 0)
+	{
+		for (i = 0; i < (int)(n/sizeof(struct kprof_sample)); i++)
+		{
+			if (samples[i].mode & KPROF_USER)
+			{
+				sym = lookup(&usyms, samples[i].eip);
+				nuser++;
+			}
+			else
+				sym = lookup(&ksyms, samples[i].eip);
+			
+			sym->count++;
+			total++;
+		}
+	}
+	
+	if (total == 0)
+	{
+		printf("kprof: no samples\n");
+		return;
+	}
+	
+	printf("%u samples, %u%% kernel, %u%% user\n\n", total,
+		((total - nuser)*100)/total, (nuser*100)/total);
+	
+	hot = malloc((ksyms.nsyms + usyms.nsyms + 2)*sizeof(struct sym *));
+	if (hot == NULL)
+	{
+		fprintf(stderr, "kprof: out of memory\n");
+		return;
+	}
+	
+	nhot = collect(&ksyms, hot, 0);
+	nhot = collect(&usyms, hot, nhot);
+	qsort(hot, nhot, sizeof(struct sym *), hotcmp);
+	
+	printf("  %%   samples  symbol\n");
+	for (i = 0; (i < nhot) && (i < (int)args.top); i++)
+	{
+		printf("%3u %9u  %s%s\n", (hot[i]->count*100)/total, hot[i]->count,
+			hot[i]->name, (hot[i]->user) ? " (user)" : "");
+	}
+	
+	if ((ioctl(fd, KPROF_GETLOST, &lost) == 0) && (lost > 0))
+		printf("\nkprof: %u samples lost\n", lost);
+	
+	free(hot);
+}
+
+/*
+ * Controls the kernel profiler and reports samples.
+ */
+int main(int argc, char *const argv[])
+{
+	int fd; /* Profiler device. */
+	
+	getargs(argc, argv);
+	
+	if ((fd = open(KPROF_DEV, O_RDONLY)) < 0)
+	{
+		fprintf(stderr, "kprof: cannot open %s\n", KPROF_DEV);
+		return (EXIT_FAILURE);
+	}
+	
+	/* Start sampling. */
+	if (args.start)
+	{
+		if (ioctl(fd, KPROF_START, args.rate) < 0)
+		{
+			fprintf(stderr, "kprof: cannot start profiler\n");
+			return (EXIT_FAILURE);
+		}
+		
+		close(fd);
+		return (EXIT_SUCCESS);
+	}
+	
+	/* Stop sampling. */
+	if (args.stop)
+		ioctl(fd, KPROF_STOP, 0);
+	
+	if (args.kernel != NULL)
+		loadsyms(&ksyms, args.kernel);
+	if (args.user != NULL)
+		loadsyms(&usyms, args.user);
+	
+	report(fd);
+	
+	close(fd);
+	
+	return (EXIT_SUCCESS);
+}
@@ -0,0 +1,282 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <sys/ktrace.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stropts.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* Software versioning. */
+#define VERSION_MAJOR 1 /* Major version. */
+#define VERSION_MINOR 0 /* Minor version. */
+
+/* Trace device. */
+#define KTRACE_DEV "/dev/ktrace"
+
+/* Microseconds per clock tick. */
+#define USECS_PER_TICK 10000
+
+/* Records read at once. */
+#define NR_RECORDS 64
+
+/*
+ * Program arguments.
+ */
+static struct
+{
+	int setmask;   /* Change event mask? */
+	unsigned mask; /* New event mask.    */
+	int mark;      /* Write a marker?    */
+	unsigned arg;  /* Marker argument.   */
+} args = { 0, 0, 0, 0 };
+
+/*
+ * Event names.
+ */
+static const char *names[KTRACE_EVENTS] = {
+	NULL, "switch", "irq", "wakeup", "sleep", "vfault", "pfault", "bhit",
+	"bmiss", "bevict", "ataq", "atadone", "sysenter", "sysexit", NULL, "user"
+};
+
+/*
+ * Prints program version and exits.
+ */
+static void version(void)
+{
+	printf("ktrace (Nanvix Coreutils) %d.%d\n\n", VERSION_MAJOR, VERSION_MINOR);
+	printf("Copyright(C) 2011-2016 Pedro H. Penna\n");
+	printf("This is free software under the ");
+	printf("GNU General Public License Version 3.\n");
+	printf("There is NO WARRANTY, to the extent permitted by law.\n\n");
+	
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ * Prints program usage and exits.
+ */
+static void usage(void)
+{
+	printf("Usage: ktrace [options]\n\n");
+	printf("Brief: Controls and dumps the kernel trace.\n\n");
+	printf("Options:\n");
+	printf("  --on         Trace all events\n");
+	printf("  --off        Stop tracing\n");
+	printf("  --mask <n>   Trace events in mask n\n");
+	printf("  --cat <name> Trace events in category name\n");
+	printf("               (sched, mm, buf, ata or sys)\n");
+	printf("  --mark <n>   Write a user marker with argument n\n");
+	printf("  --help       Display this information and exit\n");
+	printf("  --version    Display program version and exit\n");
+	
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ * Returns the event mask of a trace category.
+ */
+static unsigned category(const char *name)
+{
+	if (!strcmp(name, "sched"))
+		return (KTRACE_SCHED);
+	else if (!strcmp(name, "mm"))
+		return (KTRACE_MM);
+	else if (!strcmp(name, "buf"))
+		return (KTRACE_BUF);
+	else if (!strcmp(name, "ata"))
+		return (KTRACE_ATA);
+	else if (!strcmp(name, "sys"))
+		return (KTRACE_SYS);
+	
+	fprintf(stderr, "ktrace: unknown category %s\n", name);
+	usage();
+	
+	return (0);
+}
+
+/*
+ * Gets program arguments.
+ */
+static void getargs(int argc, char *const argv[])
+{
+	int i;     /* Loop index.       */
+	char *arg; /* Current argument. */
+	
+	/* Read command line arguments. */
+	for (i = 1; i < argc; i++)
+	{
+		arg = argv[i];
+		
+		/* Parse command line argument. */
+		if (!strcmp(arg, "--help")) {
+			usage();
+		}
+		else if (!strcmp(arg, "--version")) {
+			version();
+		}
+		else if (!strcmp(arg, "--on")) {
+			args.setmask = 1;
+			args.mask = KTRACE_ALL;
+		}
+		else if (!strcmp(arg, "--off")) {
+			args.setmask = 1;
+			args.mask = 0;
+		}
+		else if ((!strcmp(arg, "--mask")) && (i + 1 < argc)) {
+			args.setmask = 1;
+			args.mask = strtoul(argv[++i], NULL, 0);
+		}
+		else if ((!strcmp(arg, "--cat")) && (i + 1 < argc)) {
+			args.setmask = 1;
+			args.mask |= category(argv[++i]);
+		}
+		else if ((!strcmp(arg, "--mark")) && (i + 1 < argc)) {
+			args.mark = 1;
+			args.arg = strtoul(argv[++i], NULL, 0);
+		}
+		else {
+			fprintf(stderr, "ktrace: bad argument\n");
+			usage();
+		}
+	}
+}
+
+/*
+ * Converts TSC counts to microseconds.
+ */
+static unsigned tsc2usecs(uint64_t delta, unsigned rate)
+{
+	unsigned per_usec; /* TSC counts per microsecond. */
+	
+	/* Counts are clock ticks. */
+	if (rate <= 1)
+		return ((unsigned)delta*USECS_PER_TICK);
+	
+	if ((per_usec = rate/USECS_PER_TICK) == 0)
+		per_usec = 1;
+	
+	/* Keep the division in 32 bits. */
+	if (delta >> 32)
+		return (0xffffffff);
+	
+	return ((unsigned)delta/per_usec);
+}
+
+/*
+ * Prints a trace record.
+ */
+static void print(const struct ktrace_record *rec, unsigned usecs)
+{
+	const char *name; /* Event name. */
+	
+	name = (rec->id < KTRACE_EVENTS) ? names[rec->id] : NULL;
+	
+	printf("%u.%u%u%u%u%u%u [%d] ", usecs/1000000, (usecs/100000)%10,
+		(usecs/10000)%10, (usecs/1000)%10, (usecs/100)%10, (usecs/10)%10,
+		usecs%10, rec->pid);
+	
+	if (name != NULL)
+		printf("%s", name);
+	else
+		printf("event %d", rec->id);
+	
+	printf(" %x %x\n", rec->args[0], rec->args[1]);
+}
+
+/*
+ * Controls and dumps the kernel trace.
+ */
+int main(int argc, char *const argv[])
+{
+	int i;                               /* Loop index.          */
+	int fd;                              /* Trace device.        */
+	ssize_t n;                           /* Bytes read.          */
+	unsigned rate;                       /* TSC rate.            */
+	unsigned lost;                       /* Records lost.        */
+	unsigned usecs;                      /* Elapsed time.        */
+	uint64_t last;                       /* Last time stamp.     */
+	int first;                           /* First record?        */
+	struct ktrace_record recs[NR_RECORDS]; /* Records.           */
+	
+	getargs(argc, argv);
+	
+	if ((fd = open(KTRACE_DEV, O_RDWR)) < 0)
+	{
+		fprintf(stderr, "ktrace: cannot open %s\n", KTRACE_DEV);
+		return (EXIT_FAILURE);
+	}
+	
+	/* Change event mask. */
+	if (args.setmask)
+	{
+		if (ioctl(fd, KTRACE_SETMASK, args.mask) < 0)
+		{
+			fprintf(stderr, "ktrace: cannot set event mask\n");
+			return (EXIT_FAILURE);
+		}
+	}
+	
+	/* Write user marker. */
+	if (args.mark)
+	{
+		if (write(fd, &args.arg, sizeof(args.arg)) < 0)
+		{
+			fprintf(stderr, "ktrace: cannot write marker\n");
+			return (EXIT_FAILURE);
+		}
+	}
+	
+	/* Nothing to dump. */
+	if ((args.setmask) || (args.mark))
+	{
+		close(fd);
+		return (EXIT_SUCCESS);
+	}
+	
+	if (ioctl(fd, KTRACE_GETRATE, &rate) < 0)
+		rate = 0;
+	
+	/* Dump records. */
+	usecs = 0;
+	first = 1;
+	last = 0;
+	while ((n = read(fd, recs, sizeof(recs))) > 0)
+	{
+		for (i = 0; i < (int)(n/sizeof(struct ktrace_record)); i++)
+		{
+			if (!first)
+				usecs += tsc2usecs(recs[i].tsc - last, rate);
+			first = 0;
+			last = recs[i].tsc;
+			
+			print(&recs[i], usecs);
+		}
+	}
+	
+	if ((ioctl(fd, KTRACE_GETLOST, &lost) == 0) && (lost > 0))
+		printf("ktrace: %u records lost\n", lost);
+	
+	close(fd);
+	
+	return (EXIT_SUCCESS);
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <sys/lockstat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Software versioning. */
+#define VERSION_MAJOR 1 /* Major version. */
+#define VERSION_MINOR 0 /* Minor version. */
+
+/*
+ * Prints program version and exits.
+ */
+static void version(void)
+{
+	printf("lockstat (Nanvix Coreutils) %d.%d\n\n", VERSION_MAJOR, VERSION_MINOR);
+	printf("Copyright(C) 2011-2016 Pedro H. Penna\n");
+	printf("This is free software under the "); 
+	printf("GNU General Public License Version 3.\n");
+	printf("There is NO WARRANTY, to the extent permitted by law.\n\n");
+	
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ * Prints program usage and exits.
+ */
+static void usage(void)
+{
+	printf("Usage: lockstat [options]\n\n");
+	printf("Brief: Prints kernel lock statistics.\n\n");
+	printf("Options:\n");
+	printf("  --help    Display this information and exit\n");
+	printf("  --version Display program version and exit\n");
+	
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ * Gets program arguments.
+ */
+static void getargs(int argc, char *const argv[])
+{
+	int i;     /* Loop index.       */
+	char *arg; /* Current argument. */
+	
+	/* Read command line arguments. */
+	for (i = 1; i < argc; i++)
+	{
+		arg = argv[i];
+		
+		/* Parse command line argument. */
+		if (!strcmp(arg, "--help")) {
+			usage();
+		}
+		else if (!strcmp(arg, "--version")) {
+			version();
+		}
+		else {
+			fprintf(stderr, "lockstat: bad argument\n");
+			usage();
+		}
+	}
+}
+
+/*
+ * Prints statistics of a kernel lock class.
+ */
+static int print(int class, const char *name, const char *what)
+{
+	unsigned i;         /* Loop index.       */
+	struct lockstat st; /* Lock statistics. */
+	
+	if (lockstat(class, &st) < 0)
+	{
+		fprintf(stderr, "lockstat: cannot get %s statistics\n", name);
+		return (-1);
+	}
+	
+	printf("%s:\n", name);
+	printf("  acquires: %u\n", st.acquires);
+	printf("  waits:    %u\n", st.waits);
+	printf("  boosts:   %u\n", st.boosts);
+	
+	/* Hottest locks. */
+	for (i = 0; i < st.nhot; i++)
+	{
+		printf("  %-6s dev %3u %-8u %u waits\n",
+			what, st.hot[i].dev, st.hot[i].num, st.hot[i].waits);
+	}
+	
+	return (0);
+}
+
+/*
+ * Prints kernel lock statistics.
+ */
+int main(int argc, char *const argv[])
+{
+	int ret;
+	
+	getargs(argc, argv);
+	
+	ret = print(LOCK_BUFFER, "block buffer locks", "block");
+	ret |= print(LOCK_INODE, "inode locks", "inode");
+	ret |= print(LOCK_SUPERBLOCK, "superblock locks", "super");
+	ret |= print(LOCK_REGION, "memory region locks", "region");
+	
+	return ((ret == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
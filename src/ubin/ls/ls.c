@@ -19,20 +19,26 @@
 
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 /* Software versioning. */
 #define VERSION_MAJOR 1 /* Major version. */
 #define VERSION_MINOR 0 /* Minor version. */
 
 /* Program flags. */
-#define LS_ALL   001     /* Print entries starting with dot? */
-#define LS_INODE 002     /* Print inode numbers.             */
+#define LS_ALL      001  /* Print entries starting with dot? */
+#define LS_INODE    002  /* Print inode numbers.             */
+#define LS_CLASSIFY 004  /* Append file type indicators.     */
 static int ls_flags = 0; /* Flags.                           */
 
+/* Buffer of packed directory entries. */
+static char buf[1024];
+
 /* Name of the directory to list. */
 static char *dirname = NULL;
 
@@ -41,39 +47,54 @@ static char *dirname = NULL;
  */
 int ls(const char *pathname)
 {
-	DIR *dirp;                   /* Directory.               */
-	struct dirent *dp;           /* Working directory entry. */
+	int fd;                      /* Directory.               */
+	int n;                       /* Bytes read.              */
+	char *p;                     /* Working buffer pointer.  */
+	struct dent *dp;             /* Working directory entry. */
 	char filename[NAME_MAX + 1]; /* Working file name.       */
 	
 	/* Open directory. */
-	if ((dirp = opendir(pathname)) == NULL)
+	if ((fd = open(pathname, O_RDONLY)) < 0)
 	{
 		fprintf(stderr, "ls: cannot open %s\n", pathname);
 		return (errno);
 	}
 	
-	errno = 0;
-	
 	/* Read directory entries. */
 	filename[NAME_MAX] = '\0';
-	while ((dp = readdir(dirp)) != NULL)
+	while ((n = getdents(fd, buf, sizeof(buf))) > 0)
 	{
-		strncpy(filename, dp->d_name, NAME_MAX);
-		
-		/* Suppress entries starting with dot. */
-		if ((filename[0] == '.') && !(ls_flags & LS_ALL))
-			continue;
-		
-		/* Print inode number. */
-		if (ls_flags & LS_INODE)
-			printf("%d ", (int)dp->d_ino);
-		
-		printf("%s\n", filename);
+		for (p = buf; p < &buf[n]; p += dp->d_reclen)
+		{
+			dp = (struct dent *)p;
+			strncpy(filename, dp->d_name, NAME_MAX);
+			
+			/* Suppress entries starting with dot. */
+			if ((filename[0] == '.') && !(ls_flags & LS_ALL))
+				continue;
+			
+			/* Print inode number. */
+			if (ls_flags & LS_INODE)
+				printf("%d ", (int)dp->d_ino);
+			
+			printf("%s", filename);
+			
+			/* Print file type indicator. */
+			if (ls_flags & LS_CLASSIFY)
+			{
+				if (dp->d_type == DT_DIR)
+					putchar('/');
+				else if (dp->d_type == DT_FIFO)
+					putchar('|');
+			}
+			
+			putchar('\n');
+		}
 	}
-	closedir(dirp);
+	close(fd);
 	
 	/* Error while reading. */
-	if (errno != 0)
+	if (n < 0)
 	{
 		fprintf(stderr, "ls: cannot read %s\n", pathname);
 		return (errno);
@@ -104,10 +125,11 @@ static void usage(void)
 	printf("Usage: ls [options] [directory]\n\n");
 	printf("Brief: Lists contents of a directory.\n\n");
 	printf("Options:\n");
-	printf("  -a, --all     List all entries\n");
-	printf("  -i, --inode   Print the inode number of each file\n");
-	printf("      --help    Display this information and exit\n");
-	printf("      --version Display program version and exit\n");
+	printf("  -a, --all      List all entries\n");
+	printf("  -F, --classify Append / to directories and | to FIFOs\n");
+	printf("  -i, --inode    Print the inode number of each file\n");
+	printf("      --help     Display this information and exit\n");
+	printf("      --version  Display program version and exit\n");
 	
 	exit(EXIT_SUCCESS);
 }
@@ -129,6 +151,10 @@ static void getargs(int argc, char *const argv[])
 		if ((!strcmp(arg, "-a")) || (!strcmp(arg, "--all")))
 			ls_flags |= LS_ALL;
 		
+		/* Append file type indicators. */
+		else if ((!strcmp(arg, "-F")) || (!strcmp(arg, "--classify")))
+			ls_flags |= LS_CLASSIFY;
+		
 		/* Print inode numbers. */
 		else if ((!strcmp(arg, "-i")) || (!strcmp(arg, "--inode")))
 			ls_flags |= LS_INODE;
@@ -129,7 +129,9 @@ static void buildname(char *name1, char *name2, char *strbuf)
 	while ((*strbuf = *name2) != '\0') {
 		strbuf++; name2++;
 	}
-	strbuf[-1] = '/';
+	if (strbuf[-1] != '/') {
+		*strbuf++ = '/';
+	}
 	p1 = p2 = name1;
 	while (*name1++ != '\0')
 	{
@@ -144,7 +146,7 @@ static void buildname(char *name1, char *name2, char *strbuf)
 
 
 /*
- * Creates a link between two files
+ * Moves or renames a file.
  */
 int main(int argc, char *const argv[])
 {
@@ -163,44 +165,24 @@ int main(int argc, char *const argv[])
 		return (EXIT_FAILURE);
 	}
 	
-	/* Moving directory is not allowed. */
-	if (S_ISDIR(st.st_mode))
+	/* Move into directory. */
+	if ((stat(name2, &st) == 0) && (S_ISDIR(st.st_mode)))
 	{
-		fprintf(stderr, "mv: cannot move a directory\n");
-		return (EXIT_FAILURE);
-	}
-
-again:
-	/* File 2 already exits... */
-	if (stat(name2, &st) == 0)
-	{
-		/* Directory. */
-		if (S_ISDIR(st.st_mode))
+		/* Name too long. */
+		if (strlen(name2) + strlen(args.name1) + 2 > PATH_MAX)
 		{
-			buildname(args.name1, name2, strbuf);
-			name2 = strbuf;
-			goto again;
-		}
-		
-		/* Failed to unlink(). */
-		if (unlink(name2) < 0)
-		{
-			fprintf(stderr, "mv: cannot remove %s\n", name2);
+			fprintf(stderr, "mv: name too long\n");
 			return (EXIT_FAILURE);
 		}
+		
+		buildname(args.name1, name2, strbuf);
+		name2 = strbuf;
 	}
 	
-	/* Failed to link(). */
-	if (link(args.name1, name2) < 0)
-	{
-		fprintf(stderr, "mv: cannot link()\n");
-		return (EXIT_FAILURE);
-	}
-	
-	/* Failed to unlink(). */
-	if (unlink(args.name1) < 0)
+	/* Failed to rename(). */
+	if (rename(args.name1, name2) < 0)
 	{
-		fprintf(stderr, "mv: cannot unlink()\n");
+		fprintf(stderr, "mv: cannot move %s to %s\n", args.name1, name2);
 		return (EXIT_FAILURE);
 	}
 	
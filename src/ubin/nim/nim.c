@@ -24,7 +24,11 @@
 #include <string.h>
 #include <unistd.h>
 
-#define clear() ioctl(1, TTY_CLEAR)
+/*
+ * Output is fully buffered, so pending text has to go
+ * out before the screen is cleared or input is read.
+ */
+#define clear() (fflush(stdout), ioctl(1, TTY_CLEAR))
 
 #define COMPUTER 1
 #define PLAYER   2
@@ -162,6 +166,7 @@ void itoa(int n, char* s)
 int get()
 {
 	char ret;
+	fflush(stdout);
 	ret = getchar();
 	getchar();
 	return ret;
@@ -272,7 +277,7 @@ void think()
 
 int main()
 {
-	setvbuf(stdout, NULL, _IONBF, BUFSIZ);
+	setvbuf(stdout, NULL, _IOFBF, BUFSIZ);
 	int option;
 
 	nBin[0] = 0;
@@ -17,13 +17,184 @@
  * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <unistd.h>
+#include <sys/procstat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Software versioning. */
+#define VERSION_MAJOR 1 /* Major version. */
+#define VERSION_MINOR 0 /* Minor version. */
+
+/* Maximum number of records. */
+#define NR_RECORDS 64
+
+/* Program arguments. */
+static struct
+{
+	int rusage;               /* Show resource usage? */
+	struct procfilter filter; /* Snapshot filter.     */
+} args = { 0, { 0, PROCSTAT_RSS, 0, { 0 } } };
+
+/* Process records. */
+static struct procstat records[NR_RECORDS];
+
+/* Process state names. */
+static const char *states[] = {
+	"DEAD", "ZOMBIE", "RUNNING", "READY", "WAITING", "SLEEPING", "STOPPED"
+};
+
+/*
+ * Prints program version and exits.
+ */
+static void version(void)
+{
+	printf("ps (Nanvix Coreutils) %d.%d\n\n", VERSION_MAJOR, VERSION_MINOR);
+	printf("Copyright(C) 2011-2016 Pedro H. Penna\n");
+	printf("This is free software under the "); 
+	printf("GNU General Public License Version 3.\n");
+	printf("There is NO WARRANTY, to the extent permitted by law.\n\n");
+	
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ * Prints program usage and exits.
+ */
+static void usage(void)
+{
+	printf("Usage: ps [options] [pid...]\n\n");
+	printf("Brief: Reports process status.\n\n");
+	printf("Options:\n");
+	printf("  -r, --rusage  Report resource usage\n");
+	printf("  -s <state>    Report processes in a state only\n");
+	printf("  --help        Display this information and exit\n");
+	printf("  --version     Display program version and exit\n");
+	
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ * Gets a process state by name, or zero if there is none.
+ */
+static int getstate(const char *name)
+{
+	unsigned i; /* Loop index. */
+	
+	for (i = 1; i < sizeof(states)/sizeof(states[0]); i++)
+	{
+		if (!strcmp(name, states[i]))
+			return (i);
+	}
+	
+	return (0);
+}
+
+/*
+ * Gets program arguments.
+ */
+static void getargs(int argc, char *const argv[])
+{
+	int i;     /* Loop index.       */
+	int state; /* Process state.    */
+	char *arg; /* Current argument. */
+	
+	/* Read command line arguments. */
+	for (i = 1; i < argc; i++)
+	{
+		arg = argv[i];
+		
+		/* Parse command line argument. */
+		if (!strcmp(arg, "--help")) {
+			usage();
+		}
+		else if (!strcmp(arg, "--version")) {
+			version();
+		}
+		else if ((!strcmp(arg, "-r")) || (!strcmp(arg, "--rusage"))) {
+			args.rusage = 1;
+		}
+		else if ((!strcmp(arg, "-s")) && (i + 1 < argc)) {
+			if ((state = getstate(argv[++i])) == 0)
+			{
+				fprintf(stderr, "ps: unknown state %s\n", argv[i]);
+				usage();
+			}
+			args.filter.states |= PROCSTAT_STATE(state);
+		}
+		else if ((arg[0] != '-') && (args.filter.npids < PROCSTAT_PIDS)) {
+			args.filter.pids[args.filter.npids++] = atoi(arg);
+		}
+		else {
+			fprintf(stderr, "ps: bad argument\n");
+			usage();
+		}
+	}
+}
+
+/*
+ * Prints process status.
+ */
+static void status(int n)
+{
+	int i;              /* Loop index.     */
+	struct procstat *r; /* Working record. */
+	
+	printf("NAME           PID   PPID  UID   PRIO  NICE  UTIME  KTIME  RSS   MAJFLT STATUS\n");
+	
+	for (i = 0; i < n; i++)
+	{
+		r = &records[i];
+		
+		printf("%-14.14s %-5d %-5d %-5d %-5d %-5d %-6u %-6u %-5u %-6u %s\n",
+			r->name, r->pid, r->ppid, r->uid, r->priority, r->nice,
+			r->utime, r->ktime, r->rss, r->majflt, states[r->state]);
+	}
+}
+
+/*
+ * Prints resource usage.
+ */
+static void rusage(int n)
+{
+	int i;              /* Loop index.     */
+	struct procstat *r; /* Working record. */
+	
+	printf("NAME           PID   MINFLT MAJFLT VCSW   IVCSW  INBLK  OUBLK  SYSCALL MAXRSS\n");
+	
+	for (i = 0; i < n; i++)
+	{
+		r = &records[i];
+		
+		printf("%-14.14s %-5d %-6u %-6u %-6u %-6u %-6u %-6u %-7u %u\n",
+			r->name, r->pid, r->minflt, r->majflt, r->nvcsw, r->nivcsw,
+			r->inblock, r->oublock, r->nsyscall, r->maxrss);
+	}
+}
 
 /*
- * Gets and prints process information
+ * Reports process status.
  */
-int main()
+int main(int argc, char *const argv[])
 {
-	ps();
-	return 0;
+	int n; /* Number of records. */
+	
+	getargs(argc, argv);
+	
+	n = procstat(PROCSTAT_VERSION, &args.filter, records, NR_RECORDS);
+	if (n < 0)
+	{
+		fprintf(stderr, "ps: cannot get process table\n");
+		return (EXIT_FAILURE);
+	}
+	
+	if (n > NR_RECORDS)
+		n = NR_RECORDS;
+	
+	if (args.rusage)
+		rusage(n);
+	else
+		status(n);
+	
+	return (EXIT_SUCCESS);
 }
@@ -0,0 +1,255 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <sys/sysstat.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Software versioning. */
+#define VERSION_MAJOR 1 /* Major version. */
+#define VERSION_MINOR 0 /* Minor version. */
+
+/* Microseconds per clock tick. */
+#define USECS_PER_TICK 10000
+
+/*
+ * Program arguments.
+ */
+static struct
+{
+	int cmd;   /* Command.          */
+	pid_t pid; /* Target process.   */
+	int hist;  /* Print histograms? */
+} args = { SYSSTAT_GET, 0, 0 };
+
+/*
+ * System call names.
+ */
+static const char *names[] = {
+	"alarm", "brk", "fork", "getegid", "geteuid", "getgid", "getgrp",
+	"getpid", "getppid", "getuid", "kill", "nice", "pause", "setegid",
+	"seteuid", "setgid", "setpgrp", "setuid", "_exit", "wait", "signal",
+	"access", "chdir", "chown", "chroot", "chmod", "open", "umask",
+	"read", "write", "close", "execve", "lseek", "pipe", "stat", "fcntl",
+	"sync", "unlink", "dup2", "ioctl", "link", "uname", "utime", "ustat",
+	"times", "shutdown", "ps", "gticks", "semget", "semctl", "semop",
+	"cachestat", "iostat", "sendfile", "readv", "writev", "pread",
+	"pwrite", "fsync", "fdatasync", "mmap", "munmap", "getdents",
+	"swapon", "vfork", "vmstat", "nanosleep", "futex", "shmget", "shmat",
+	"shmdt", "shmctl", "clone", "mq_open", "mq_close", "mq_unlink",
+	"mq_send", "mq_receive", "mq_setattr", "poll", "epoll_create",
+	"epoll_ctl", "epoll_wait", "epoll_close", "io_uring_setup",
+	"io_uring_enter", "io_uring_close", "multicall", "sigaction",
+	"sigprocmask", "sigsuspend", "sigpending", "pmc_open", "pmc_read",
+	"pmc_close", "sysstat", "wait4",
+	"getrusage", "procstat", "getcwd",
+	"fstat", "openat", "fstatat", "unlinkat", "mkdirat", "rename",
+	"lockstat", "sched_setscheduler", "ioprio_set",
+	"madvise", "posix_fadvise", "mlock", "munlock", "mlockall", "munlockall",
+	"socket", "socketpair", "bind", "listen", "accept", "connect",
+	"sendmsg", "recvmsg", "getitimer", "setitimer", "profil"
+};
+
+/* Statistics. */
+static struct sysstat st;
+
+/*
+ * Prints program version and exits.
+ */
+static void version(void)
+{
+	printf("sysstat (Nanvix Coreutils) %d.%d\n\n", VERSION_MAJOR, VERSION_MINOR);
+	printf("Copyright(C) 2011-2016 Pedro H. Penna\n");
+	printf("This is free software under the "); 
+	printf("GNU General Public License Version 3.\n");
+	printf("There is NO WARRANTY, to the extent permitted by law.\n\n");
+	
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ * Prints program usage and exits.
+ */
+static void usage(void)
+{
+	printf("Usage: sysstat [options]\n\n");
+	printf("Brief: Reports system call statistics.\n\n");
+	printf("Options:\n");
+	printf("  --on          Start accounting system calls\n");
+	printf("  --off         Stop accounting system calls\n");
+	printf("  --reset       Clear statistics\n");
+	printf("  --pid <pid>   Report statistics of a process\n");
+	printf("  --hist        Report latency histograms\n");
+	printf("  --help        Display this information and exit\n");
+	printf("  --version     Display program version and exit\n");
+	
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ * Gets program arguments.
+ */
+static void getargs(int argc, char *const argv[])
+{
+	int i;     /* Loop index.       */
+	char *arg; /* Current argument. */
+	
+	/* Read command line arguments. */
+	for (i = 1; i < argc; i++)
+	{
+		arg = argv[i];
+		
+		/* Parse command line argument. */
+		if (!strcmp(arg, "--help")) {
+			usage();
+		}
+		else if (!strcmp(arg, "--version")) {
+			version();
+		}
+		else if (!strcmp(arg, "--on")) {
+			args.cmd = SYSSTAT_ON;
+		}
+		else if (!strcmp(arg, "--off")) {
+			args.cmd = SYSSTAT_OFF;
+		}
+		else if (!strcmp(arg, "--reset")) {
+			args.cmd = SYSSTAT_RESET;
+		}
+		else if ((!strcmp(arg, "--pid")) && (i + 1 < argc)) {
+			args.pid = atoi(argv[++i]);
+		}
+		else if (!strcmp(arg, "--hist")) {
+			args.hist = 1;
+		}
+		else {
+			fprintf(stderr, "sysstat: bad argument\n");
+			usage();
+		}
+	}
+}
+
+/*
+ * Converts TSC counts to microseconds.
+ */
+static unsigned usecs(unsigned counts)
+{
+	unsigned per_usec; /* TSC counts per microsecond. */
+	
+	/* Counts are clock ticks. */
+	if (st.rate <= 1)
+		return (counts*USECS_PER_TICK);
+	
+	if ((per_usec = st.rate/USECS_PER_TICK) == 0)
+		per_usec = 1;
+	
+	return (counts/per_usec);
+}
+
+/*
+ * Computes the mean latency of a system call, in TSC counts.
+ */
+static unsigned mean(int nr)
+{
+	unsigned count;  /* Calls.         */
+	uint64_t cycles; /* Total latency. */
+	
+	count = st.count[nr];
+	cycles = st.cycles[nr];
+	
+	/* Keep the division in 32 bits. */
+	while ((cycles >> 32) && (count > 1))
+	{
+		cycles >>= 1;
+		count >>= 1;
+	}
+	
+	if (cycles >> 32)
+		return (0xffffffff);
+	
+	return ((unsigned)cycles/count);
+}
+
+/*
+ * Prints the latency histogram of a system call.
+ */
+static void hist(int nr)
+{
+	int i; /* Loop index. */
+	
+	for (i = 0; i < SYSSTAT_BUCKETS; i++)
+	{
+		if (st.hist[nr][i] == 0)
+			continue;
+		
+		printf("    >= %u us: %u\n", usecs(1u << i), st.hist[nr][i]);
+	}
+}
+
+/*
+ * Reports system call statistics.
+ */
+int main(int argc, char *const argv[])
+{
+	int i;           /* Loop index.  */
+	unsigned ncalls; /* Total calls. */
+	
+	getargs(argc, argv);
+	
+	/* Control accounting. */
+	if (args.cmd != SYSSTAT_GET)
+	{
+		if (sysstat(args.cmd, 0, NULL) < 0)
+		{
+			fprintf(stderr, "sysstat: permission denied\n");
+			return (EXIT_FAILURE);
+		}
+		
+		return (EXIT_SUCCESS);
+	}
+	
+	if (sysstat(SYSSTAT_GET, args.pid, &st) < 0)
+	{
+		fprintf(stderr, "sysstat: no such process\n");
+		return (EXIT_FAILURE);
+	}
+	
+	if (!st.on)
+		printf("sysstat: accounting is off\n");
+	
+	printf("SYSCALL          CALLS   AVG(us)\n");
+	
+	ncalls = 0;
+	for (i = 0; i < (int)(sizeof(names)/sizeof(names[0])); i++)
+	{
+		if (st.count[i] == 0)
+			continue;
+		
+		printf("%-14s %7u %9u\n", names[i], st.count[i], usecs(mean(i)));
+		ncalls += st.count[i];
+		
+		if ((args.hist) && (args.pid == 0))
+			hist(i);
+	}
+	
+	printf("total          %7u\n", ncalls);
+	
+	return (EXIT_SUCCESS);
+}
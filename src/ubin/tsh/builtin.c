@@ -17,13 +17,16 @@
  * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <sys/wait.h>
+#include <sys/stat.h>
 #include <errno.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include "builtin.h"
+#include "hash.h"
+#include "job.h"
 #include "tsh.h"
 
 /*
@@ -67,29 +70,296 @@ static int builtin_exit(int argc, const char **argv)
  */
 static int builtin_wait(int argc, const char **argv)
 {
-	int status;
+	((void)argc);
+	((void)argv);
+	
+	job_waitall();
+	
+	return (EXIT_SUCCESS);
+}
+
+/*
+ * Writes arguments to the standard output.
+ */
+static int builtin_echo(int argc, const char **argv)
+{
+	int i;
+	
+	for (i = 1; i < argc; i++)
+	{
+		fputs(argv[i], stdout);
+		if (i + 1 < argc)
+			putchar(' ');
+	}
+	putchar('\n');
+	
+	return (EXIT_SUCCESS);
+}
+
+/*
+ * Prints the name of the working directory.
+ */
+static int builtin_pwd(int argc, const char **argv)
+{
+	char pathname[PATH_MAX];
+	
+	((void)argc);
+	((void)argv);
+	
+	if (getcwd(pathname, PATH_MAX) == NULL)
+	{
+		fputs("pwd: cannot getcwd\n", stderr);
+		return (EXIT_FAILURE);
+	}
+	
+	puts(pathname);
+	
+	return (EXIT_SUCCESS);
+}
+
+/*
+ * Returns successfully.
+ */
+static int builtin_true(int argc, const char **argv)
+{
+	((void)argc);
+	((void)argv);
 	
+	return (EXIT_SUCCESS);
+}
+
+/*
+ * Returns unsuccessfully.
+ */
+static int builtin_false(int argc, const char **argv)
+{
 	((void)argc);
 	((void)argv);
 	
-	/* Wait for all child processes to complete */
-	while (wait(&status) != -1)
-		/* empty. */;
+	return (EXIT_FAILURE);
+}
+
+/*
+ * Suspends execution for an interval of time.
+ */
+static int builtin_sleep(int argc, const char **argv)
+{
+	/* Wrong usage. */
+	if (argc < 2)
+	{
+		fputs("sleep: missing operand\n", stderr);
+		return (EXIT_FAILURE);
+	}
+	
+	sleep(atoi(argv[1]));
 	
 	return (EXIT_SUCCESS);
 }
 
+/*
+ * Converts an operand of test to an integer.
+ */
+static int test_int(const char *str, long *val)
+{
+	char *end;
+	
+	*val = strtol(str, &end, 10);
+	if ((*str == '\0') || (*end != '\0'))
+	{
+		fprintf(stderr, "test: %s: integer expected\n", str);
+		return (-1);
+	}
+	
+	return (0);
+}
+
+/*
+ * Evaluates a unary primary of test.
+ */
+static int test_unary(const char *op, const char *arg)
+{
+	struct stat st;
+	
+	if ((op[0] != '-') || (op[1] == '\0') || (op[2] != '\0'))
+		return (-1);
+	
+	switch (op[1])
+	{
+		case 'z': return (*arg == '\0');
+		case 'n': return (*arg != '\0');
+		case 'r': return (access(arg, R_OK) == 0);
+		case 'w': return (access(arg, W_OK) == 0);
+		case 'x': return (access(arg, X_OK) == 0);
+	}
+	
+	if (strchr("efdcbps", op[1]) == NULL)
+		return (-1);
+	
+	if (stat(arg, &st) < 0)
+		return (0);
+	
+	switch (op[1])
+	{
+		case 'e': return (1);
+		case 'f': return (S_ISREG(st.st_mode));
+		case 'd': return (S_ISDIR(st.st_mode));
+		case 'c': return (S_ISCHR(st.st_mode));
+		case 'b': return (S_ISBLK(st.st_mode));
+		case 'p': return (S_ISFIFO(st.st_mode));
+		case 's': return (st.st_size > 0);
+	}
+	
+	return (-1);
+}
+
+/*
+ * Evaluates a binary primary of test.
+ */
+static int test_binary(const char *a, const char *op, const char *b)
+{
+	long x, y;
+	
+	if (!strcmp(op, "="))
+		return (!strcmp(a, b));
+	else if (!strcmp(op, "!="))
+		return (strcmp(a, b) != 0);
+	
+	if ((test_int(a, &x) < 0) || (test_int(b, &y) < 0))
+		return (-2);
+	
+	if (!strcmp(op, "-eq"))
+		return (x == y);
+	else if (!strcmp(op, "-ne"))
+		return (x != y);
+	else if (!strcmp(op, "-lt"))
+		return (x < y);
+	else if (!strcmp(op, "-le"))
+		return (x <= y);
+	else if (!strcmp(op, "-gt"))
+		return (x > y);
+	else if (!strcmp(op, "-ge"))
+		return (x >= y);
+	
+	return (-1);
+}
+
+/*
+ * Evaluates a test expression. Returns 1 if it is true, 0 if it is
+ * false and a negative number if it is malformed.
+ */
+static int test_expr(int argc, const char **argv)
+{
+	int ret;
+	
+	/* Negation. */
+	if ((argc > 1) && (!strcmp(argv[0], "!")))
+		return (((ret = test_expr(argc - 1, &argv[1])) < 0) ? ret : !ret);
+	
+	switch (argc)
+	{
+		case 0:
+			return (0);
+		case 1:
+			return (argv[0][0] != '\0');
+		case 2:
+			return (test_unary(argv[0], argv[1]));
+		case 3:
+			return (test_binary(argv[0], argv[1], argv[2]));
+	}
+	
+	return (-1);
+}
+
+/*
+ * Evaluates a conditional expression.
+ */
+static int builtin_test(int argc, const char **argv)
+{
+	int ret;
+	
+	/* Bracket form. */
+	if (!strcmp(argv[0], "["))
+	{
+		if (strcmp(argv[--argc], "]"))
+		{
+			fputs("[: missing ]\n", stderr);
+			return (2);
+		}
+	}
+	
+	if ((ret = test_expr(argc - 1, &argv[1])) < 0)
+	{
+		if (ret == -1)
+			fputs("test: syntax error\n", stderr);
+		return (2);
+	}
+	
+	return ((ret) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+/*
+ * Remembers or forgets command locations.
+ */
+static int builtin_hash(int argc, const char **argv)
+{
+	int i;
+	int ret;
+	
+	if (argc < 2)
+	{
+		hash_print();
+		return (EXIT_SUCCESS);
+	}
+	
+	if (!strcmp(argv[1], "-r"))
+	{
+		hash_clear();
+		return (EXIT_SUCCESS);
+	}
+	
+	ret = EXIT_SUCCESS;
+	for (i = 1; i < argc; i++)
+	{
+		if (hash_lookup(argv[i]) == NULL)
+		{
+			fprintf(stderr, "hash: %s: not found\n", argv[i]);
+			ret = EXIT_FAILURE;
+		}
+	}
+	
+	return (ret);
+}
+
+/*
+ * Built-in commands.
+ */
+static const struct builtin builtins[] = {
+	{ "cd",    &builtin_cd,    BUILTIN_SPECIAL },
+	{ "exit",  &builtin_exit,  BUILTIN_SPECIAL },
+	{ "wait",  &builtin_wait,  BUILTIN_SPECIAL },
+	{ "hash",  &builtin_hash,  BUILTIN_SPECIAL },
+	{ "echo",  &builtin_echo,  0               },
+	{ "pwd",   &builtin_pwd,   0               },
+	{ "test",  &builtin_test,  0               },
+	{ "[",     &builtin_test,  0               },
+	{ "true",  &builtin_true,  0               },
+	{ "false", &builtin_false, 0               },
+	{ "sleep", &builtin_sleep, 0               },
+	{ NULL,    NULL,           0               }
+};
+
 /*
  * Gets the requested built-in command.
  */
-builtin_t getbuiltin(const char *cmdname)
+const struct builtin *getbuiltin(const char *cmdname)
 {
-	if (!strcmp(cmdname, "cd"))
-		return (&builtin_cd);
-	else if (!strcmp(cmdname, "exit"))
-		return (&builtin_exit);
-	else if (!strcmp(cmdname, "wait"))
-		return (&builtin_wait);
+	const struct builtin *b;
+	
+	for (b = builtins; b->name != NULL; b++)
+	{
+		if (!strcmp(cmdname, b->name))
+			return (b);
+	}
 	
 	return (NULL);
 }
@@ -25,9 +25,22 @@
 	 */
 	typedef int (*builtin_t)(int, const char**);
 	
+	/* Built-in command flags. */
+	#define BUILTIN_SPECIAL 001 /* Changes shell state? */
+	
+	/*
+	 * Built-in command.
+	 */
+	struct builtin
+	{
+		const char *name; /* Command name. */
+		builtin_t func;   /* Entry point.  */
+		int flags;        /* Flags.        */
+	};
+	
 	/*
 	 * Gets the requested built-in command.
 	 */
-	builtin_t getbuiltin(const char *cmdname);
+	const struct builtin *getbuiltin(const char *cmdname);
 
 #endif /* _BUILTIN_ */
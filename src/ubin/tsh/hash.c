@@ -0,0 +1,202 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "hash.h"
+#include "tsh.h"
+
+/*
+ * Remembered command location.
+ */
+struct hashent
+{
+	struct hashent *next; /* Next entry in the chain. */
+	char *name;           /* Command name.            */
+	char *path;           /* Full pathname.           */
+	unsigned hits;        /* Number of lookups.       */
+	char names[];         /* Storage for both names.  */
+};
+
+/* Command hash table. */
+static struct hashent *hashtab[HASH_SIZE];
+
+/* Search path that the table was filled against. */
+static char *hashpath = NULL;
+
+/*
+ * Hashes a command name.
+ */
+static unsigned hash_key(const char *name)
+{
+	unsigned h;
+	
+	h = 0;
+	while (*name != '\0')
+		h = h*31 + (unsigned char)*name++;
+	
+	return (h%HASH_SIZE);
+}
+
+/*
+ * Forgets all remembered command locations.
+ */
+void hash_clear(void)
+{
+	int i;                /* Loop index.    */
+	struct hashent *e;    /* Working entry. */
+	struct hashent *next; /* Next entry.    */
+	
+	for (i = 0; i < HASH_SIZE; i++)
+	{
+		for (e = hashtab[i]; e != NULL; e = next)
+		{
+			next = e->next;
+			free(e);
+		}
+		hashtab[i] = NULL;
+	}
+	
+	free(hashpath);
+	hashpath = NULL;
+}
+
+/*
+ * Flushes the table if the search path has changed.
+ */
+static void hash_check(const char *path)
+{
+	if ((hashpath != NULL) && (!strcmp(hashpath, path)))
+		return;
+	
+	hash_clear();
+	if ((hashpath = malloc(strlen(path) + 1)) != NULL)
+		strcpy(hashpath, path);
+}
+
+/*
+ * Searches the search path for a command.
+ */
+static int hash_search(const char *path, const char *name, char *buf)
+{
+	size_t len;    /* Length of directory name. */
+	size_t length; /* Length of command name.   */
+	const char *p; /* End of directory name.    */
+	
+	length = strlen(name);
+	
+	for (/* noop */; *path != '\0'; path = (*p == ':') ? p + 1 : p)
+	{
+		p = strchr(path, ':');
+		if (p == NULL)
+			p = strchr(path, '\0');
+		
+		/* Skip names that do not fit. */
+		len = p - path;
+		if (len + length + 2 > PATH_MAX)
+			continue;
+		
+		memcpy(buf, path, len);
+		buf[len] = '/';
+		memcpy(&buf[len + 1], name, length + 1);
+		
+		if (access(buf, X_OK) == 0)
+			return (0);
+	}
+	
+	return (-1);
+}
+
+/*
+ * Looks up the full pathname of a command, walking the search path only
+ * on the first use of the name. Stale entries are dropped and searched
+ * again. Returns NULL if the command is not found, in which case the
+ * caller should fall back to execvp().
+ */
+const char *hash_lookup(const char *name)
+{
+	size_t len;          /* Name length.       */
+	unsigned key;        /* Hash key.          */
+	const char *path;    /* Search path.       */
+	struct hashent *e;   /* Working entry.     */
+	struct hashent **pp; /* Link to the entry. */
+	char buf[PATH_MAX];  /* Working pathname.  */
+	
+	/* Use given path. */
+	if (strchr(name, '/') != NULL)
+		return (name);
+	
+	if ((path = getenv("PATH")) == NULL)
+		return (NULL);
+	
+	hash_check(path);
+	
+	key = hash_key(name);
+	for (pp = &hashtab[key]; (e = *pp) != NULL; pp = &e->next)
+	{
+		if (strcmp(e->name, name))
+			continue;
+		
+		if (access(e->path, X_OK) == 0)
+		{
+			e->hits++;
+			return (e->path);
+		}
+		
+		/* Stale entry. */
+		*pp = e->next;
+		free(e);
+		break;
+	}
+	
+	if (hash_search(path, name, buf) < 0)
+		return (NULL);
+	
+	/* Remember location. */
+	len = strlen(name) + 1;
+	if ((e = malloc(sizeof(struct hashent) + len + strlen(buf) + 1)) == NULL)
+		return (NULL);
+	e->name = e->names;
+	e->path = &e->names[len];
+	strcpy(e->name, name);
+	strcpy(e->path, buf);
+	e->hits = 1;
+	e->next = hashtab[key];
+	hashtab[key] = e;
+	
+	return (e->path);
+}
+
+/*
+ * Prints remembered command locations.
+ */
+void hash_print(void)
+{
+	int i;             /* Loop index.    */
+	struct hashent *e; /* Working entry. */
+	
+	for (i = 0; i < HASH_SIZE; i++)
+	{
+		for (e = hashtab[i]; e != NULL; e = e->next)
+			printf("%u\t%s\n", e->hits, e->path);
+	}
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "job.h"
+#include "tsh.h"
+
+/*
+ * Stage of the foreground pipeline.
+ */
+struct stage
+{
+	pid_t pid;  /* Process ID.  */
+	int status; /* Exit status. */
+	int done;   /* Completed?   */
+};
+
+/* Foreground pipeline. */
+static struct stage stages[PIPE_MAXSTAGES];
+
+/* Number of stages in the foreground pipeline. */
+static int nstages = 0;
+
+/* Number of stages still running. */
+static volatile int nrunning = 0;
+
+/*
+ * Buries completed child processes, in whatever order they complete.
+ * Children that are not part of the foreground pipeline, that is,
+ * asynchronous ones, are just discarded.
+ */
+static void reaper(int sig)
+{
+	int i;      /* Loop index.       */
+	int status; /* Exit status.      */
+	pid_t pid;  /* Child process ID. */
+	
+	((void)sig);
+	
+	while ((pid = waitpid(-1, &status, WNOHANG | WUNTRACED)) > 0)
+	{
+		for (i = 0; i < nstages; i++)
+		{
+			if ((stages[i].pid == pid) && (!stages[i].done))
+			{
+				stages[i].status = status;
+				stages[i].done = 1;
+				nrunning--;
+				break;
+			}
+		}
+	}
+}
+
+/*
+ * Sets up reaping of child processes. SIGCHLD stays blocked all the
+ * time, except while waiting for the foreground pipeline. Otherwise,
+ * it would interrupt reads at the prompt.
+ */
+void job_init(void)
+{
+	sigset_t set;        /* SIGCHLD.       */
+	struct sigaction sa; /* Signal action. */
+	
+	sa.sa_handler = reaper;
+	sa.sa_flags = 0;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGCHLD, &sa, NULL);
+	
+	sigemptyset(&set);
+	sigaddset(&set, SIGCHLD);
+	sigprocmask(SIG_BLOCK, &set, NULL);
+}
+
+/*
+ * Restores the signal mask in a child process.
+ */
+void job_child(void)
+{
+	sigset_t set;
+	
+	sigemptyset(&set);
+	sigaddset(&set, SIGCHLD);
+	sigprocmask(SIG_UNBLOCK, &set, NULL);
+}
+
+/*
+ * Adds a stage to the foreground pipeline.
+ */
+void job_add(pid_t pid)
+{
+	if (nstages == PIPE_MAXSTAGES)
+		return;
+	
+	stages[nstages].pid = pid;
+	stages[nstages].done = 0;
+	nstages++;
+	nrunning++;
+}
+
+/*
+ * Waits for all stages of the foreground pipeline to complete. Returns
+ * zero and the exit status of the stage @p pid, or -1 if it is not part
+ * of the pipeline.
+ */
+int job_wait(pid_t pid, int *status)
+{
+	int i;         /* Loop index.           */
+	int ret;       /* Return value.         */
+	sigset_t mask; /* Mask while suspended. */
+	
+	sigprocmask(SIG_SETMASK, NULL, &mask);
+	sigdelset(&mask, SIGCHLD);
+	
+	while (nrunning > 0)
+		sigsuspend(&mask);
+	
+	ret = -1;
+	for (i = 0; i < nstages; i++)
+	{
+		if (stages[i].pid == pid)
+		{
+			*status = stages[i].status;
+			ret = 0;
+		}
+	}
+	
+	nstages = 0;
+	
+	return (ret);
+}
+
+/*
+ * Buries child processes that have already completed.
+ */
+void job_reap(void)
+{
+	reaper(SIGCHLD);
+}
+
+/*
+ * Waits for all child processes to complete.
+ */
+void job_waitall(void)
+{
+	int status;   /* Exit status. */
+	sigset_t set; /* SIGCHLD.     */
+	sigset_t old; /* Old mask.    */
+	
+	sigemptyset(&set);
+	sigaddset(&set, SIGCHLD);
+	sigprocmask(SIG_UNBLOCK, &set, &old);
+	
+	while (wait(&status) != -1)
+		/* empty. */;
+	
+	sigprocmask(SIG_SETMASK, &old, NULL);
+}
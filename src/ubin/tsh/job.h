@@ -0,0 +1,55 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _JOB_H_
+#define _JOB_H_
+
+	#include <sys/types.h>
+
+	/*
+	 * Sets up reaping of child processes.
+	 */
+	extern void job_init(void);
+	
+	/*
+	 * Restores the signal mask in a child process.
+	 */
+	extern void job_child(void);
+	
+	/*
+	 * Adds a stage to the foreground pipeline.
+	 */
+	extern void job_add(pid_t pid);
+	
+	/*
+	 * Waits for the foreground pipeline to complete.
+	 */
+	extern int job_wait(pid_t pid, int *status);
+	
+	/*
+	 * Buries child processes that have already completed.
+	 */
+	extern void job_reap(void);
+	
+	/*
+	 * Waits for all child processes to complete.
+	 */
+	extern void job_waitall(void);
+
+#endif /* _JOB_H_ */
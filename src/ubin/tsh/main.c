@@ -19,6 +19,8 @@
  * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <nanvix/clock.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
@@ -34,6 +36,8 @@
 #include <ctype.h>
 
 #include "builtin.h"
+#include "hash.h"
+#include "job.h"
 #include "tsh.h"
 #include "history.h"
 
@@ -57,6 +61,9 @@ struct termios raw;
 /* Global command history stack struct */
 static struct history *hist = NULL;
 
+/* Last stage of the foreground pipeline. */
+static pid_t fgpid = 0;
+
 /*
  * Switches to canonical (default) mode.
  */
@@ -133,6 +140,8 @@ static void sigmsg(int sig)
 		case SIGTERM: msg = "Terminated"; break;
 		case SIGALRM: msg = "Alarm"; break;
 		case SIGTRAP: msg = "Trace"; break;
+		case SIGVTALRM: msg = "Virtual timer expired"; break;
+		case SIGPROF: msg = "Profiling timer expired"; break;
 		default:      msg = "Other signal"; break;		
 	}
 	
@@ -156,26 +165,84 @@ static void closeredir(int *redir)
 		close(redir[1]);
 }
 
+/*
+ * Runs a built-in command in the shell itself.
+ */
+static void runbuiltin(const struct builtin *cmd, const char **args, int argc, int *redir)
+{
+	int i;        /* Loop index.           */
+	int saved[2]; /* Saved standard files. */
+	
+	/* Redirections. */
+	fflush(stdout);
+	for (i = 0; i < 2; i++)
+	{
+		saved[i] = -1;
+		if (redir[i] != -1)
+		{
+			if (((saved[i] = dup(i)) == -1) || (dup2(redir[i], i) == -1))
+			{
+				fprintf(stderr, "%s: failed to redirect\n", args[0]);
+				shret = EXIT_FAILURE;
+				goto out;
+			}
+		}
+	}
+	
+	shret = cmd->func(argc, args);
+	
+out:
+	fflush(stdout);
+	for (i = 0; i < 2; i++)
+	{
+		if (saved[i] != -1)
+		{
+			dup2(saved[i], i);
+			close(saved[i]);
+		}
+	}
+	closeredir(redir);
+	
+	/* Only failures that affect the shell itself are errors. */
+	if ((shret != EXIT_SUCCESS) && (cmd->flags & BUILTIN_SPECIAL))
+		sherror();
+}
+
 /*
  * Runs a command.
  */
 static void runcmd(const char **args, int argc, int *redir, int flags)
 {
-	int i;         /* Loop index.       */
-	int status;    /* Exit status.      */
-	pid_t pid;     /* Child process ID. */
-	builtin_t cmd; /* Built-in command. */
+	int i;                     /* Loop index.       */
+	pid_t pid;                 /* Child process ID. */
+	const char *path;          /* Command pathname. */
+	const struct builtin *cmd; /* Built-in command. */
+	
+	path = NULL;
 	
-	/* Checks built-in. */
+	/*
+	 * Checks built-in. Those that are piped or run
+	 * asynchronously still need a child, but not exec().
+	 */
 	if ((cmd = getbuiltin(args[0])) != NULL)
-	{	
-		closeredir(redir);
-		if ((shret = cmd(argc, args)) != EXIT_SUCCESS)
-			sherror();
-		return;
+	{
+		if ((cmd->flags & BUILTIN_SPECIAL) || !(flags & (CMD_PIPE | CMD_ASYNC)))
+		{
+			runbuiltin(cmd, args, argc, redir);
+			return;
+		}
+		
+		/* Pending output would be written twice otherwise. */
+		fflush(stdout);
+		pid = fork();
 	}
 	
-	pid = fork();
+	/* Child only sets up redirections and calls execv(). */
+	else
+	{
+		path = hash_lookup(args[0]);
+		pid = vfork();
+	}
 	
 	/* Failed to fork. */
 	if (pid < 0)
@@ -190,36 +257,18 @@ static void runcmd(const char **args, int argc, int *redir, int flags)
 	{
 		closeredir(redir);
 		
-		/* Piping... */
-		if (flags & CMD_PIPE)
-			return;
-		
 		/* Asynchronous execution. */
 		if (flags & CMD_ASYNC)
 		{
-			printf("[%d]+\n", pid);
+			if (!(flags & CMD_PIPE))
+				printf("[%d]+\n", pid);
 			return;
 		}
-
-		/* Wait child. */
-		while (wait(&status) != pid)
-			/* noop */;
 		
-		/* Abnormal termination. */
-		if (status != EXIT_SUCCESS)
-		{
-			/* Signal. */
-			if (WIFSIGNALED(status))
-				sigmsg(shret = WTERMSIG(status));
-			
-			/* Voluntary. */
-			else if (WIFEXITED(status))
-				shret = WEXITSTATUS(status);
-			
-			/* Stopped. */
-			else if  (WIFSTOPPED(status))
-				printf("[%d]+\tStopped\n", pid);
-		}
+		/* Reaped once the whole pipeline is running. */
+		job_add(pid);
+		if (!(flags & CMD_PIPE))
+			fgpid = pid;
 		
 		return;
 	}
@@ -229,6 +278,7 @@ static void runcmd(const char **args, int argc, int *redir, int flags)
 	 */
 
 	/* Reset signals. */
+	job_child();
 	signal(SIGINT, SIG_DFL);
 	signal(SIGQUIT, SIG_DFL);
 	signal(SIGTERM, SIG_DFL);
@@ -258,6 +308,13 @@ static void runcmd(const char **args, int argc, int *redir, int flags)
 		}
 	}
 		
+	if (cmd != NULL)
+		exit(cmd->func(argc, args));
+	
+	if (path != NULL)
+	{
+		execv(path, (char * const *)args);
+	}
 	execvp(args[0], (char * const *)args);
 	fprintf(stderr, "%s: failed to execute\n", args[0]);
 	exit(EXIT_FAILURE);
@@ -448,7 +505,98 @@ error0:
 }
 
 /*
- * Parses a pipe block.
+ * Waits for all stages of the foreground pipeline.
+ */
+static void waitpipe(void)
+{
+	int status; /* Exit status. */
+	pid_t pid;  /* Last stage.  */
+	
+	pid = fgpid;
+	fgpid = 0;
+	
+	/* Last stage was not a child process. */
+	if (job_wait(pid, &status) < 0)
+		return;
+	
+	/* Abnormal termination. */
+	if (status != EXIT_SUCCESS)
+	{
+		/* Signal. */
+		if (WIFSIGNALED(status))
+			sigmsg(shret = WTERMSIG(status));
+		
+		/* Voluntary. */
+		else if (WIFEXITED(status))
+			shret = WEXITSTATUS(status);
+		
+		/* Stopped. */
+		else if  (WIFSTOPPED(status))
+			printf("[%d]+\tStopped\n", pid);
+	}
+}
+
+/*
+ * Strips a leading "time" keyword from a pipe block.
+ */
+static int timeprefix(char **pipeblk)
+{
+	char *p;
+	
+	/* Skip blanks. */
+	for (p = *pipeblk; (*p == ' ') || (*p == '\t'); p++)
+		/* noop */ ;
+	
+	if (strncmp(p, "time", 4))
+		return (0);
+	
+	if ((p[4] != ' ') && (p[4] != '\t'))
+		return (0);
+	
+	*pipeblk = p + 4;
+	
+	return (1);
+}
+
+/*
+ * Converts a time value to hundredths of a second.
+ */
+#define TV_TO_CS(tv) \
+	((tv).tv_sec*100 + (tv).tv_usec/10000)
+
+/*
+ * Reports resources used by a timed pipeline.
+ */
+static void timereport(const struct rusage *r0, int t0)
+{
+	int real;         /* Elapsed time.  */
+	long user, sys;   /* CPU times.     */
+	struct rusage r1; /* Final usage.   */
+	
+	real = ((gticks() - t0)*100)/CLOCK_FREQ;
+	
+	if (getrusage(RUSAGE_CHILDREN, &r1) < 0)
+		return;
+	
+	user = TV_TO_CS(r1.ru_utime) - TV_TO_CS(r0->ru_utime);
+	sys = TV_TO_CS(r1.ru_stime) - TV_TO_CS(r0->ru_stime);
+	
+	fprintf(stderr, "real %d.%02ds user %ld.%02lds sys %ld.%02lds\n",
+		real/100, real%100, user/100, user%100, sys/100, sys%100);
+	fprintf(stderr, "faults %ld/%ld csw %ld/%ld blocks %ld/%ld syscalls %ld maxrss %ldK\n",
+		r1.ru_minflt - r0->ru_minflt,
+		r1.ru_majflt - r0->ru_majflt,
+		r1.ru_nvcsw - r0->ru_nvcsw,
+		r1.ru_nivcsw - r0->ru_nivcsw,
+		r1.ru_inblock - r0->ru_inblock,
+		r1.ru_oublock - r0->ru_oublock,
+		r1.ru_nsyscall - r0->ru_nsyscall,
+		r1.ru_maxrss);
+}
+
+/*
+ * Parses a pipe block. All stages are launched before
+ * any of them is waited for.
  */
 static void ppipe(char *pipeblk, int flags)
 {
@@ -456,10 +604,24 @@ static void ppipe(char *pipeblk, int flags)
 	int pipefd[2];   /* Pipe file descriptors.        */
 	int redir[2]; /* Redirection file descriptors. */
 	char *lastcmd;   /* Last command found.           */
+	int timed;       /* Time pipeline?                */
+	int t0;          /* Start time.                   */
+	struct rusage r0;/* Initial usage.                */
 	
 	pipefd[0] = pipefd[1] = -1;
 	redir[0] = redir[1] = -1;
 	
+	/* Time foreground pipelines only. */
+	timed = 0;
+	if (timeprefix(&pipeblk) && !(flags & CMD_ASYNC))
+	{
+		if (getrusage(RUSAGE_CHILDREN, &r0) == 0)
+		{
+			timed = 1;
+			t0 = gticks();
+		}
+	}
+	
 	/*
 	 * Parse pipe block breaking it
 	 * down into commands.
@@ -507,6 +669,9 @@ static void ppipe(char *pipeblk, int flags)
 				redir[0] = pipefd[0];
 				redir[1] = -1;
 				pcmd(lastcmd, redir, flags);
+				waitpipe();
+				if (timed)
+					timereport(&r0, t0);
 				return;
 			
 			/* Keep parsing. */
@@ -518,8 +683,11 @@ static void ppipe(char *pipeblk, int flags)
 error1:
 	shret = EXIT_FAILURE;
 error0:
-	sherror();
 	closeredir(redir);
+	waitpipe();
+	if (timed)
+		timereport(&r0, t0);
+	sherror();
 }
 
 /*
@@ -796,10 +964,15 @@ int main(int argc, char **argv)
 
 	/* Initialize command stack. */
 	hist = history_init(HISTORY_SIZE);
+	
+	job_init();
 
 	/* Read and interpret commands. */
 	while (1)
 	{
+		/* Bury asynchronous commands. */
+		job_reap();
+		
 		/* Print prompt character. */
 		if (shflags & SH_INTERACTIVE)
 			printf("%c ", (myuid == 0) ? '#' : '%');
@@ -41,8 +41,14 @@
 	 */
 	#define HISTORY_SIZE 50
 
+	/* Number of chains in the command hash table. */
+	#define HASH_SIZE 32
+
 	/* Max arguments of a command. */
 	#define CMD_MAXARGS 32
+	
+	/* Max stages of a pipeline. */
+	#define PIPE_MAXSTAGES (LINELEN/2)
 
 	/* Command flags. */
 	#define CMD_ASYNC 001 /* Asynchronous? */
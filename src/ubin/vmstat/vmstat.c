@@ -0,0 +1,119 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <sys/vmstat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Software versioning. */
+#define VERSION_MAJOR 1 /* Major version. */
+#define VERSION_MINOR 0 /* Minor version. */
+
+/*
+ * Prints program version and exits.
+ */
+static void version(void)
+{
+	printf("vmstat (Nanvix Coreutils) %d.%d\n\n", VERSION_MAJOR, VERSION_MINOR);
+	printf("Copyright(C) 2011-2016 Pedro H. Penna\n");
+	printf("This is free software under the "); 
+	printf("GNU General Public License Version 3.\n");
+	printf("There is NO WARRANTY, to the extent permitted by law.\n\n");
+	
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ * Prints program usage and exits.
+ */
+static void usage(void)
+{
+	printf("Usage: vmstat [options]\n\n");
+	printf("Brief: Prints virtual memory statistics.\n\n");
+	printf("Options:\n");
+	printf("  --help    Display this information and exit\n");
+	printf("  --version Display program version and exit\n");
+	
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ * Gets program arguments.
+ */
+static void getargs(int argc, char *const argv[])
+{
+	int i;     /* Loop index.       */
+	char *arg; /* Current argument. */
+	
+	/* Read command line arguments. */
+	for (i = 1; i < argc; i++)
+	{
+		arg = argv[i];
+		
+		/* Parse command line argument. */
+		if (!strcmp(arg, "--help")) {
+			usage();
+		}
+		else if (!strcmp(arg, "--version")) {
+			version();
+		}
+		else {
+			fprintf(stderr, "vmstat: bad argument\n");
+			usage();
+		}
+	}
+}
+
+/*
+ * Prints virtual memory statistics.
+ */
+int main(int argc, char *const argv[])
+{
+	struct vmstat st; /* Statistics. */
+	
+	getargs(argc, argv);
+	
+	if (vmstat(&st) < 0)
+	{
+		fprintf(stderr, "vmstat: cannot get statistics\n");
+		return (EXIT_FAILURE);
+	}
+	
+	printf("memory:\n");
+	printf("  frames:       %u (%u free)\n", st.frames, st.free);
+	printf("  kernel pages: %u (%u free)\n", st.kpages, st.kfree);
+	printf("  regions:      %u in use\n", st.regions);
+	printf("  suspended:    %u processes\n", st.suspended);
+	printf("swap:\n");
+	printf("  slots:        %u (%u free)\n", st.swap, st.swapfree);
+	printf("  compressed:   %u pages\n", st.zswap);
+	printf("  swap ins:     %u\n", st.swapins);
+	printf("  swap outs:    %u\n", st.swapouts);
+	printf("faults:\n");
+	printf("  zero fill:    %u\n", st.zero);
+	printf("  file fill:    %u\n", st.fill);
+	printf("  cow:          %u (%u page tables)\n", st.cow, st.pgtabcow);
+	printf("  huge pages:   %u (%u split)\n", st.huge, st.split);
+	printf("merging:\n");
+	printf("  scanned:      %u\n", st.scanned);
+	printf("  merged:       %u\n", st.merged);
+	
+	return (EXIT_SUCCESS);
+}
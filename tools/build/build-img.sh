@@ -25,6 +25,26 @@
 #
 EDUCATIONAL_KERNEL=$1
 GENERATE_ISO=$2
+
+# Init table (override to build the benchmark image).
+INITTAB=${INITTAB:-tools/img/inittab}
+
+# File system block size (log 2), and blocks per KiB shift.
+BLOCK_SIZE_LOG2=${BLOCK_SIZE_LOG2:-10}
+BLOCK_SHIFT=$((BLOCK_SIZE_LOG2 - 10))
+
+# Metadata journal size (in blocks), or zero for no journal.
+JOURNAL=${JOURNAL:-0}
+
+# Compress the initial RAM disk? A compressed one is inflated by
+# the kernel, so it may be bigger than INITRD_SIZE.
+COMPRESS_INITRD=${COMPRESS_INITRD:-1}
+if [ "$COMPRESS_INITRD" == "1" ]; then
+	INITRD_KB=1024
+else
+	INITRD_KB=512
+fi
+
 # Root credentials.
 ROOTUID=0
 ROOTGID=0
@@ -33,6 +53,9 @@ ROOTGID=0
 NOOBUID=1
 NOOBUID=1
 
+# Image manifest, fed to batch.minix in a single pass.
+MANIFEST=manifest
+
 # macOS compatibility stuff
 if [ "x$(uname -rv | grep Darwin)" != "x" ];
 then
@@ -88,7 +111,6 @@ function eject {
 }
 
 # Generate passwords file
-#   $1 Disk image name.
 #
 function passwords
 {
@@ -102,10 +124,7 @@ function passwords
 		chmod 600 $file
 	fi
 
-	bin/cp.minix $1 $file /etc/$file $ROOTUID $ROOTGID
-
-	# House keeping.
-	rm -f $file
+	echo "f $file /etc/$file $ROOTUID $ROOTGID" >> $MANIFEST
 }
 
 #
@@ -115,17 +134,37 @@ function passwords
 #   $3 Number of inodes.
 #
 function format {
-	bin/mkfs.minix $1 $2 $3 $ROOTUID $ROOTGID
-	bin/mkdir.minix $1 /etc $ROOTUID $ROOTGID
-	bin/mkdir.minix $1 /sbin $ROOTUID $ROOTGID
-	bin/mkdir.minix $1 /bin $ROOTUID $ROOTGID
-	bin/mkdir.minix $1 /home $ROOTUID $ROOTGID
-	bin/mkdir.minix $1 /dev $ROOTUID $ROOTGID
-	bin/mknod.minix $1 /dev/null 666 c 0 0 $ROOTUID $ROOTGID
-	bin/mknod.minix $1 /dev/tty 666 c 0 1 $ROOTUID $ROOTGID
-	bin/mknod.minix $1 /dev/klog 666 c 0 2 $ROOTUID $ROOTGID
-	bin/mknod.minix $1 /dev/ramdisk 666 b 0 0 $ROOTUID $ROOTGID
-	bin/mknod.minix $1 /dev/hdd 666 b 0 1 $ROOTUID $ROOTGID
+	bin/mkfs.minix $1 $2 $3 $ROOTUID $ROOTGID $JOURNAL
+
+	{
+		echo "d /etc $ROOTUID $ROOTGID"
+		echo "d /sbin $ROOTUID $ROOTGID"
+		echo "d /lib $ROOTUID $ROOTGID"
+		echo "d /bin $ROOTUID $ROOTGID"
+		echo "d /home $ROOTUID $ROOTGID"
+		echo "d /dev $ROOTUID $ROOTGID"
+		echo "n /dev/null 666 c 0 0 $ROOTUID $ROOTGID"
+		echo "n /dev/tty 666 c 0 1 $ROOTUID $ROOTGID"
+		echo "n /dev/klog 666 c 0 2 $ROOTUID $ROOTGID"
+		echo "n /dev/ttyS0 666 c 0 3 $ROOTUID $ROOTGID"
+		echo "n /dev/ktrace 666 c 0 5 $ROOTUID $ROOTGID"
+		echo "n /dev/kprof 666 c 0 6 $ROOTUID $ROOTGID"
+		echo "n /dev/net0 666 c 0 7 $ROOTUID $ROOTGID"
+		echo "n /dev/bootlog 644 c 0 8 $ROOTUID $ROOTGID"
+		echo "n /dev/tty1 666 c 1 1 $ROOTUID $ROOTGID"
+		echo "n /dev/tty2 666 c 2 1 $ROOTUID $ROOTGID"
+		echo "n /dev/tty3 666 c 3 1 $ROOTUID $ROOTGID"
+		echo "n /dev/ptyp0 666 c 0 4 $ROOTUID $ROOTGID"
+		echo "n /dev/ttyp0 666 c 4 1 $ROOTUID $ROOTGID"
+		echo "n /dev/ptyp1 666 c 1 4 $ROOTUID $ROOTGID"
+		echo "n /dev/ttyp1 666 c 5 1 $ROOTUID $ROOTGID"
+		echo "n /dev/ptyp2 666 c 2 4 $ROOTUID $ROOTGID"
+		echo "n /dev/ttyp2 666 c 6 1 $ROOTUID $ROOTGID"
+		echo "n /dev/ptyp3 666 c 3 4 $ROOTUID $ROOTGID"
+		echo "n /dev/ttyp3 666 c 7 1 $ROOTUID $ROOTGID"
+		echo "n /dev/ramdisk 666 b 0 0 $ROOTUID $ROOTGID"
+		echo "n /dev/hdd 666 b 0 1 $ROOTUID $ROOTGID"
+	} > $MANIFEST
 }
 
 #
@@ -134,29 +173,45 @@ function format {
 #
 function copy_files
 {
-	chmod 666 tools/img/inittab
+	chmod 666 $INITTAB
 
 	# Let's care for security...
 	if [ "$EDUCATIONAL_KERNEL" == "0" ]; then
-		chmod 600 tools/img/inittab
+		chmod 600 $INITTAB
 	fi
-	bin/cp.minix $1 tools/img/inittab /etc/inittab $ROOTUID $ROOTGID
+	echo "f $INITTAB /etc/inittab $ROOTUID $ROOTGID" >> $MANIFEST
+
+	passwords
 
-	passwords $1
+	# Empty boot trace, recorded by the kernel on first boot.
+	: > boottrace
+	chmod 600 boottrace
+	echo "f boottrace /etc/boottrace $ROOTUID $ROOTGID" >> $MANIFEST
+
+	# Shared C library.
+	if [ -f lib/libc.so ]; then
+		echo "f lib/libc.so /lib/libc.so $ROOTUID $ROOTGID" >> $MANIFEST
+	fi
 
 	for file in bin/sbin/*; do
 		filename=`basename $file`
 		if [[ "$filename" != *.debug ]]; then
-			bin/cp.minix $1 $file /sbin/$filename $ROOTUID $ROOTGID
+			echo "f $file /sbin/$filename $ROOTUID $ROOTGID" >> $MANIFEST
 		fi;
 	done
 
 	for file in bin/ubin/*; do
 		filename=`basename $file`
 		if [[ "$filename" != *.debug ]]; then
-			bin/cp.minix $1 $file /bin/$filename $ROOTUID $ROOTGID
+			echo "f $file /bin/$filename $ROOTUID $ROOTGID" >> $MANIFEST
 		fi;
 	done
+
+	# Populate the image in a single pass.
+	bin/batch.minix $1 $MANIFEST
+
+	# House keeping.
+	rm -f passwords boottrace $MANIFEST
 }
 
 #
@@ -193,13 +248,17 @@ done
 
 # Build HDD image.
 dd if=/dev/zero of=hdd.img bs=512 count=131072
-format hdd.img 32708 16384
+format hdd.img 32708 $((16384 >> BLOCK_SHIFT))
 copy_files hdd.img
 
 # Build initrd image.
-dd if=/dev/zero of=initrd.img bs=512k count=1
-format initrd.img 128 512
+dd if=/dev/zero of=initrd.img bs=1k count=$INITRD_KB
+format initrd.img $((INITRD_KB/4)) $((512 >> BLOCK_SHIFT))
 copy_files initrd.img
+if [ "$COMPRESS_INITRD" == "1" ]; then
+	bin/mkinitrd initrd.img initrd.lz4
+	mv -f initrd.lz4 initrd.img
+fi
 
 # Build nanvix image.
 # # Build live nanvix image.
@@ -0,0 +1,236 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include <initrd.h>
+
+/**
+ * @brief Minimum match length.
+ */
+#define MINMATCH 4
+
+/**
+ * @brief No match may start in the last bytes of the input.
+ */
+#define MFLIMIT 12
+
+/**
+ * @brief The last bytes of the input are always literals.
+ */
+#define LASTLITERALS 5
+
+/**
+ * @brief Farthest match.
+ */
+#define MAX_DISTANCE 65535
+
+/**
+ * @brief Log 2 of the number of entries in the match finder table.
+ */
+#define HASH_LOG2 12
+
+/**
+ * @brief Reads four bytes.
+ */
+static uint32_t read32(const unsigned char *p)
+{
+	uint32_t x;
+	
+	memcpy(&x, p, sizeof(x));
+	
+	return (x);
+}
+
+/**
+ * @brief Hashes four bytes.
+ */
+static unsigned hash(const unsigned char *p)
+{
+	return ((read32(p)*2654435761u) >> (32 - HASH_LOG2));
+}
+
+/**
+ * @brief Writes a length that does not fit in a token.
+ * 
+ * @param op  Output pointer.
+ * @param len Length, minus the part that is in the token.
+ * 
+ * @returns The updated output pointer.
+ */
+static unsigned char *putlen(unsigned char *op, size_t len)
+{
+	for (/* noop */; len >= 255; len -= 255)
+		*op++ = 255;
+	*op++ = len;
+	
+	return (op);
+}
+
+/**
+ * @brief Writes a sequence.
+ * 
+ * @param op     Output pointer.
+ * @param lit    Literals.
+ * @param litlen Number of literals.
+ * @param offset Match offset, or zero if the sequence has no match.
+ * @param len    Match length.
+ * 
+ * @returns The updated output pointer.
+ */
+static unsigned char *putseq
+(unsigned char *op, const unsigned char *lit, size_t litlen, size_t offset, size_t len)
+{
+	unsigned char *token;
+	
+	token = op++;
+	*token = ((litlen < 15) ? litlen : 15) << 4;
+	if (litlen >= 15)
+		op = putlen(op, litlen - 15);
+	memcpy(op, lit, litlen);
+	op += litlen;
+	
+	/* Last sequence. */
+	if (offset == 0)
+		return (op);
+	
+	*op++ = offset & 0xff;
+	*op++ = offset >> 8;
+	len -= MINMATCH;
+	*token |= (len < 15) ? len : 15;
+	if (len >= 15)
+		op = putlen(op, len - 15);
+	
+	return (op);
+}
+
+/**
+ * @brief Compresses a buffer into a single LZ4 block.
+ * 
+ * @param in  Input buffer.
+ * @param n   Size of input buffer.
+ * @param out Output buffer.
+ * 
+ * @returns The size of the compressed data.
+ */
+static size_t compress(const unsigned char *in, size_t n, unsigned char *out)
+{
+	size_t ip;                  /* Input position.     */
+	size_t anchor;              /* First literal.      */
+	long ref;                   /* Match candidate.    */
+	size_t len;                 /* Match length.       */
+	unsigned char *op;          /* Output pointer.     */
+	long table[1 << HASH_LOG2]; /* Match finder table. */
+	
+	for (unsigned i = 0; i < (1u << HASH_LOG2); i++)
+		table[i] = -1;
+	
+	op = out;
+	ip = anchor = 0;
+	
+	while (ip + MFLIMIT < n)
+	{
+		unsigned h;
+		
+		h = hash(&in[ip]);
+		ref = table[h];
+		table[h] = ip;
+		
+		/* No match. */
+		if ((ref < 0) || (ip - ref > MAX_DISTANCE) ||
+			(read32(&in[ref]) != read32(&in[ip])))
+		{
+			ip++;
+			continue;
+		}
+		
+		/* Extend match. */
+		len = MINMATCH;
+		while ((ip + len < n - LASTLITERALS) && (in[ref + len] == in[ip + len]))
+			len++;
+		
+		op = putseq(op, &in[anchor], ip - anchor, ip - ref, len);
+		ip += len;
+		anchor = ip;
+	}
+	
+	op = putseq(op, &in[anchor], n - anchor, 0, 0);
+	
+	return (op - out);
+}
+
+/**
+ * @brief Prints program usage and exits.
+ */
+static void usage(void)
+{
+	printf("Usage: mkinitrd <input file> <output file>\n\n");
+	printf("Brief: Compresses an initial RAM disk image.\n");
+	
+	exit(EXIT_SUCCESS);
+}
+
+/**
+ * @brief Compresses an initial RAM disk image.
+ */
+int main(int argc, char **argv)
+{
+	FILE *file;
+	long n;
+	unsigned char *in;
+	unsigned char *out;
+	struct initrd_header hdr;
+	
+	if (argc < 3)
+		usage();
+	
+	/* Read image. */
+	if ((file = fopen(argv[1], "rb")) == NULL)
+		return (EXIT_FAILURE);
+	fseek(file, 0, SEEK_END);
+	n = ftell(file);
+	rewind(file);
+	in = malloc(n + 1);
+	out = malloc(n + n/255 + 16);
+	if ((in == NULL) || (out == NULL))
+		return (EXIT_FAILURE);
+	if (fread(in, 1, n, file) != (size_t)n)
+		return (EXIT_FAILURE);
+	fclose(file);
+	
+	hdr.magic = INITRD_MAGIC;
+	hdr.size = n;
+	hdr.csize = compress(in, n, out);
+	
+	/* Write compressed image. */
+	if ((file = fopen(argv[2], "wb")) == NULL)
+		return (EXIT_FAILURE);
+	fwrite(&hdr, sizeof(struct initrd_header), 1, file);
+	fwrite(out, 1, hdr.csize, file);
+	
+	/* House keeping. */
+	fclose(file);
+	free(out);
+	free(in);
+	
+	return (EXIT_SUCCESS);
+}
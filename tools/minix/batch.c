@@ -0,0 +1,245 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "minix.h"
+#include "util.h"
+
+/**
+ * @brief Maximum length of a manifest line.
+ */
+#define MANIFEST_LINE_MAX 512
+
+/**
+ * @brief Prints program usage and exits.
+ */
+static void usage(void)
+{
+	printf("usage: batch.minix <input file> <manifest>\n");
+	printf("\n");
+	printf("manifest entries, one per line:\n");
+	printf("  d <directory> <uid> <gid> [buckets]\n");
+	printf("  f <source file> <dest file> <uid> <gid>\n");
+	printf("  n <file name> <mode> <type> <minor> <major> <uid> <gid>\n");
+	exit(EXIT_SUCCESS);
+}
+
+/**
+ * @brief Returns device number.
+ * 
+ * @param type  Device type.
+ * @param major Major number.
+ * @param minor Minor number.
+ * 
+ * @returns The device number.
+ */
+static inline uint16_t devnum(char type, unsigned major, unsigned minor)
+{
+	return (((major & 0xf) << 8)|((minor & 0xf) << 4) | (type == 'c' ? 0 : 1));
+}
+
+/**
+ * @brief Creates a directory and any missing parent directory.
+ * 
+ * @param dirname  Directory that shall be created.
+ * @param uid      User ID.
+ * @param gid      User group ID.
+ * @param nbuckets Hash buckets of the directory.
+ */
+static void batch_mkdir
+(const char *dirname, uint16_t uid, uint16_t gid, uint16_t nbuckets)
+{
+	uint16_t num1, num2;               /* Working inode numbers. */
+	struct d_inode *ip;                /* Working inode.         */
+	char filename[MINIX_NAME_MAX + 1]; /* Working file name.     */
+	
+	/* Traverse file system tree. */
+	ip = minix_inode_read(num1 = INODE_ROOT);
+	do
+	{
+		dirname = break_path(dirname, filename);	
+		num2 = dir_search(ip, filename);
+		
+		/* Create directory. */
+		if (num2 == INODE_NULL)
+		{
+			num2 = minix_mkdir(ip, num1, filename, uid, gid,
+				(*dirname == '\0') ? nbuckets : 0);
+		}
+		
+		minix_inode_write(num1, ip);
+		ip = minix_inode_read(num1 = num2);
+	} while (*dirname != '\0');
+
+	minix_inode_write(num1, ip);
+}
+
+/**
+ * @brief Creates a special file.
+ * 
+ * @param pathname Special file that shall be created.
+ * @param mode     Access mode of the special file.
+ * @param dev      Device number.
+ * @param uid      User ID.
+ * @param gid      User group ID.
+ */
+static void batch_mknod
+(const char *pathname, uint16_t mode, uint16_t dev, uint16_t uid, uint16_t gid)
+{
+	uint16_t num;                      /* Working inode number. */
+	struct d_inode *dip;               /* Working inode.        */
+	char filename[MINIX_NAME_MAX + 1]; /* Working file name.    */
+	
+	num = minix_inode_dname(pathname, filename);
+	dip = minix_inode_read(num);
+	minix_mknod(dip, num, filename, mode, dev, uid, gid);
+	minix_inode_write(num, dip);
+}
+
+/**
+ * @brief Copies the contents of a file.
+ * 
+ * @param num Inode number of the destination file.
+ * @param src Source file.
+ */
+static void batch_copy(uint16_t num, const char *src)
+{
+	int fd;            /* File ID of source file.  */
+	struct stat stbuf; /* Buffer for stat().       */
+	char *buf;         /* Buffer used for copying. */
+	
+	if (stat(src, &stbuf) != 0)
+		error("cannot stat()");
+	
+	buf = smalloc(stbuf.st_size);
+	fd = sopen(src, O_RDONLY);
+	sread(fd, buf, stbuf.st_size);
+	sclose(fd);
+	minix_write(num, buf, stbuf.st_size);
+	free(buf);
+}
+
+/**
+ * @brief Processes a manifest.
+ * 
+ * @details The first pass creates every directory, special file and
+ *          regular file inode, so that all directory blocks are allocated
+ *          up front. The second pass then writes file contents, so that
+ *          files are laid out contiguously in manifest order.
+ * 
+ * @param manifest Manifest file.
+ * @param data     Write file contents (second pass)?
+ */
+static void batch_pass(FILE *manifest, int data)
+{
+	char line[MANIFEST_LINE_MAX];  /* Manifest line.         */
+	char path1[MANIFEST_LINE_MAX]; /* First path argument.   */
+	char path2[MANIFEST_LINE_MAX]; /* Second path argument.  */
+	unsigned mode;                 /* Access mode.           */
+	unsigned major;                /* Major number.          */
+	unsigned minor;                /* Minor number.          */
+	unsigned uid, gid;             /* Credentials.           */
+	unsigned nbuckets;             /* Hash buckets.          */
+	char type;                     /* Device type.           */
+	struct stat stbuf;             /* Buffer for stat().     */
+	int n;                         /* Number of fields read. */
+	
+	rewind(manifest);
+	
+	while (fgets(line, sizeof(line), manifest) != NULL)
+	{
+		switch (line[0])
+		{
+			/* Directory. */
+			case 'd':
+				nbuckets = 0;
+				n = sscanf(&line[1], "%s %u %u %u", path1, &uid, &gid, &nbuckets);
+				if (n < 3)
+					error("bad directory entry");
+				if (!data)
+					batch_mkdir(path1, uid, gid, nbuckets);
+				break;
+			
+			/* Regular file. */
+			case 'f':
+				n = sscanf(&line[1], "%s %s %u %u", path1, path2, &uid, &gid);
+				if (n != 4)
+					error("bad file entry");
+				if (data)
+					batch_copy(minix_lookup(path2), path1);
+				else
+				{
+					if (stat(path1, &stbuf) != 0)
+						error("cannot stat()");
+					minix_create(path2, stbuf.st_mode, uid, gid);
+				}
+				break;
+			
+			/* Special file. */
+			case 'n':
+				n = sscanf(&line[1], "%s %o %c %u %u %u %u",
+					path1, &mode, &type, &minor, &major, &uid, &gid);
+				if (n != 7)
+					error("bad special file entry");
+				if (!data)
+					batch_mknod(path1, mode, devnum(type, major, minor), uid, gid);
+				break;
+			
+			/* Blank line or comment. */
+			case '\n':
+			case '#':
+				break;
+			
+			default:
+				error("bad manifest entry");
+		}
+	}
+}
+
+/**
+ * @brief Populates a Minix file system from a manifest in a single mount.
+ */
+int main(int argc, char **argv)
+{
+	FILE *manifest; /* Manifest file. */
+	
+	/* Wrong usage. */
+	if (argc != 3)
+		usage();
+	
+	manifest = fopen(argv[2], "r");
+	if (manifest == NULL)
+		error("cannot open manifest");
+	
+	minix_mount(argv[1]);
+	batch_pass(manifest, 0);
+	batch_pass(manifest, 1);
+	minix_umount();
+	
+	fclose(manifest);
+	
+	return (EXIT_SUCCESS);
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+ * 
+ * This file is part of Nanvix.
+ * 
+ * Nanvix is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Nanvix is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Nanvix. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "minix.h"
+#include "util.h"
+
+/**
+ * @brief Maximum length of a hint file line.
+ */
+#define HINT_LINE_MAX 512
+
+/**
+ * @brief Maximum number of hinted files.
+ */
+#define HINT_MAX 1024
+
+/**
+ * @brief Prints program usage and exits.
+ */
+static void usage(void)
+{
+	printf("usage: defrag.minix <input file> [hint file]\n");
+	printf("\n");
+	printf("the hint file lists, one per line, files to be laid out first\n");
+	exit(EXIT_SUCCESS);
+}
+
+/**
+ * @brief Defragments a Minix file system.
+ */
+int main(int argc, char **argv)
+{
+	FILE *hints;              /* Hint file.                  */
+	char line[HINT_LINE_MAX]; /* Hint file line.             */
+	char path[HINT_LINE_MAX]; /* File name.                  */
+	uint16_t order[HINT_MAX]; /* Files to be laid out first. */
+	unsigned n;               /* Number of hinted files.     */
+	
+	/* Wrong usage. */
+	if ((argc != 2) && (argc != 3))
+		usage();
+	
+	minix_mount(argv[1]);
+	
+	/* Read access order hints. */
+	n = 0;
+	if (argc == 3)
+	{
+		if ((hints = fopen(argv[2], "r")) == NULL)
+			error("cannot open hint file");
+		
+		while (fgets(line, sizeof(line), hints) != NULL)
+		{
+			/* Blank line or comment. */
+			if ((sscanf(line, "%s", path) != 1) || (path[0] == '#'))
+				continue;
+			
+			if (n == HINT_MAX)
+				error("too many hints");
+			order[n++] = minix_lookup(path);
+		}
+		
+		fclose(hints);
+	}
+	
+	minix_defrag(order, n);
+	minix_umount();
+	
+	return (EXIT_SUCCESS);
+}
@@ -59,6 +59,60 @@ static struct
 	uint32_t *bitmap; /**< Bitmap.                   */
 } zmap;
 
+/**
+ * @brief Asserts if a journal record starts at a given journal block.
+ * 
+ * @param pos Journal block.
+ * @param seq Expected sequence number.
+ * 
+ * @returns True if a descriptor block with sequence number @p seq is found at
+ *          @p pos, and false otherwise.
+ */
+static bool minix_journal_record(unsigned pos, uint32_t seq)
+{
+	struct d_jdesc desc; /* Descriptor block. */
+	
+	/* Out of the journal. */
+	if (pos >= super.s_journal_nblocks)
+		return (false);
+	
+	slseek(fd, (super.s_journal_start + pos)*BLOCK_SIZE, SEEK_SET);
+	sread(fd, &desc, sizeof(struct d_jdesc));
+	
+	return ((desc.d_magic == JOURNAL_DESC) && (desc.d_seq == seq));
+}
+
+/**
+ * @brief Asserts if the journal of a Minix file system holds records.
+ * 
+ * @details Records are not replayed here, so file systems which have not
+ *          been cleanly shut down are left to the kernel.
+ * 
+ * @returns True if a record is found where replay starts, and false
+ *          otherwise.
+ */
+static bool minix_journal_dirty(void)
+{
+	struct d_jheader hdr; /* Journal header. */
+	
+	/* No journal. */
+	if (super.s_journal_nblocks == 0)
+		return (false);
+	
+	slseek(fd, super.s_journal_start*BLOCK_SIZE, SEEK_SET);
+	sread(fd, &hdr, sizeof(struct d_jheader));
+	if (hdr.h_magic != JOURNAL_MAGIC)
+		error("bad journal magic number");
+	
+	/* Nothing to replay. */
+	if (hdr.h_start == 0)
+		return (false);
+	
+	/* Records may start over at the first journal block. */
+	return (minix_journal_record(hdr.h_start, hdr.h_seq) ||
+		minix_journal_record(1, hdr.h_seq));
+}
+
 /**
  * @brief Reads the superblock of a Minix file system.
  */
@@ -69,6 +123,10 @@ static void minix_super_read(void)
 	sread(fd, &super, sizeof(struct d_superblock));
 	if (super.s_magic != SUPER_MAGIC)
 		error("bad magic number");
+	if (super.s_log_block_size != BLOCK_SIZE_LOG2 - 10)
+		error("unsupported block size");
+	if (minix_journal_dirty())
+		error("journal needs recovery");
 	
 	/* Read inode map. */
 	slseek(fd, 2*BLOCK_SIZE, SEEK_SET);
@@ -222,6 +280,11 @@ static block_t minix_block_alloc(void)
 /**
  * @brief Allocates an inode.
  * 
+ * @details A new directory gets the first free inode of the allocation group
+ *          that follows the one of its parent, and any other file the first
+ *          free inode after its parent, as the kernel does.
+ * 
+ * @param dnum Inode number of the parent directory, or #INODE_NULL.
  * @param mode Access mode.
  * @param uid  User ID.
  * @param gid  User group ID.
@@ -230,15 +293,33 @@ static block_t minix_block_alloc(void)
  * 
  * @note The Minix file system must be mounted.
  */
-static uint16_t minix_inode_alloc(uint16_t mode, uint16_t uid, uint16_t gid)
+static uint16_t minix_inode_alloc
+(uint16_t dnum, uint16_t mode, uint16_t uid, uint16_t gid)
 {
 	uint16_t num;       /* Inode number.                */
 	uint32_t bit;       /* Bit number if the inode map. */
+	uint32_t chunk;     /* First chunk to search.       */
+	unsigned g;         /* Allocation group.            */
 	struct d_inode *ip; /* New inode.                   */
+	
+	/* Spread directories, keep other files near their parent. */
+	chunk = 0;
+	if (dnum != INODE_NULL)
+	{
+		bit = dnum - 1;
+		if (S_ISDIR(mode))
+		{
+			g = ((bit*NR_GROUPS)/super.s_ninodes + 1)%NR_GROUPS;
+			bit = (g*super.s_ninodes + NR_GROUPS - 1)/NR_GROUPS;
+		}
+		chunk = bit >> 5;
+	}
 
 	/* Allocate inode. */
-	bit = bitmap_first_free(imap.bitmap, imap.size);
-	if (bit == BITMAP_FULL)
+	bit = bitmap_first_free(imap.bitmap + chunk, imap.size - (chunk << 2));
+	if ((bit == BITMAP_FULL) || ((bit += chunk << 5) >= super.s_ninodes))
+		bit = bitmap_first_free(imap.bitmap, imap.size);
+	if ((bit == BITMAP_FULL) || (bit >= super.s_ninodes))
 		error("inode map overflow");
 	bitmap_set(imap.bitmap, bit);
 	num = bit + 1;
@@ -336,18 +417,57 @@ static block_t minix_block_map(struct d_inode *ip, off_t off, bool create)
 	
 	logic -= NR_SINGLE;
 	
-	/* Double indirect zone. */
-	error("double indect zone");
+	/* Create double indirect block. */
+	if (ip->i_zones[ZONE_DOUBLE] == BLOCK_NULL && create)
+	{
+		phys = minix_block_alloc();
+		ip->i_zones[ZONE_DOUBLE] = phys;
+	}
+	
+	/* We cannot go any further. */
+	if ((phys = ip->i_zones[ZONE_DOUBLE]) == BLOCK_NULL)
+		error("invalid offset");
+	
+	off = phys*BLOCK_SIZE;
+	slseek(fd, off, SEEK_SET);
+	sread(fd, buf, BLOCK_SIZE);
+	
+	/* Create single indirect block. */
+	if (buf[logic/NR_SINGLE] == BLOCK_NULL && create)
+	{
+		phys = minix_block_alloc();
+		buf[logic/NR_SINGLE] = phys;
+		slseek(fd, off, SEEK_SET);
+		swrite(fd, buf, BLOCK_SIZE);
+	}
+	
+	/* We cannot go any further. */
+	if ((phys = buf[logic/NR_SINGLE]) == BLOCK_NULL)
+		error("invalid offset");
+	
+	off = phys*BLOCK_SIZE;
+	slseek(fd, off, SEEK_SET);
+	sread(fd, buf, BLOCK_SIZE);
+	
+	/* Create direct block. */
+	if (buf[logic%NR_SINGLE] == BLOCK_NULL && create)
+	{
+		phys = minix_block_alloc();
+		buf[logic%NR_SINGLE] = phys;
+		slseek(fd, off, SEEK_SET);
+		swrite(fd, buf, BLOCK_SIZE);
+	}
 	
-	return (BLOCK_NULL);
+	return (buf[logic%NR_SINGLE]);
 }
 
 /**
- * @brief Searches for a directory entry.
+ * @brief Searches linearly for a directory entry.
  * 
  * @param ip       Directory where the directory entry shall be searched. 
  * @param filename Name of the directory entry that shall be searched.
  * @param create   Create directory entry?
+ * @param first    First directory entry to scan. It must start a block.
  * 
  * @returns The file offset where the directory entry is located, or -1 if the
  *          file does not exist.
@@ -356,7 +476,8 @@ static block_t minix_block_map(struct d_inode *ip, off_t off, bool create)
  * @note @p filename must point to a valid file name.
  * @note The Minix file system must be mounted.
  */
-static off_t dirent_search(struct d_inode *ip, const char *filename,bool create)
+static off_t dirent_search_linear
+(struct d_inode *ip, const char *filename, bool create, int first)
 {
 	int i;             /* Working entry.               */
 	off_t base, off;   /* Working file offsets.        */
@@ -368,9 +489,10 @@ static off_t dirent_search(struct d_inode *ip, const char *filename,bool create)
 	nentries = ip->i_size/sizeof(struct d_dirent);
 	
 	/* Search for directory entry. */
-	i = 0;
+	i = first;
 	entry = -1;
-	blk = ip->i_zones[0];
+	blk = (first == 0) ? ip->i_zones[0] :
+		minix_block_map(ip, first*sizeof(struct d_dirent), false);
 	base = -1;
 	while (i < nentries)
 	{
@@ -444,6 +566,184 @@ static off_t dirent_search(struct d_inode *ip, const char *filename,bool create)
 	return (base + off);
 }
 
+/**
+ * @brief Number of directory entries per block.
+ */
+#define DIRENTS_PER_BLOCK (BLOCK_SIZE/sizeof(struct d_dirent))
+
+/**
+ * @brief Hashes a file name.
+ * 
+ * @param filename Target file name.
+ * 
+ * @returns The hash of @p filename, as specified for hashed directories.
+ */
+static unsigned dirhash(const char *filename)
+{
+	uint32_t h;
+	
+	/* "." and ".." live in the first bucket. */
+	if (!strcmp(filename, ".") || !strcmp(filename, ".."))
+		return (0);
+	
+	h = 0;
+	for (unsigned i = 0; (i < MINIX_NAME_MAX) && (filename[i] != '\0'); i++)
+		h = h*31 + (unsigned char)filename[i];
+	
+	return (h);
+}
+
+/**
+ * @brief Gets the number of hash buckets of a directory.
+ * 
+ * @param ip Target directory.
+ * 
+ * @returns The number of hash buckets of the directory, or zero if it is a
+ *          plain directory.
+ * 
+ * @note @p ip must point to a valid inode
+ * @note The Minix file system must be mounted.
+ */
+static unsigned dirhash_buckets(struct d_inode *ip)
+{
+	struct d_dirhash h; /* Hashed directory header. */
+	
+	/* Too small to be hashed. */
+	if ((ip->i_size < BLOCK_SIZE) || (ip->i_zones[0] == BLOCK_NULL))
+		return (0);
+	
+	slseek(fd, ip->i_zones[0]*BLOCK_SIZE + DIRHASH_SLOT*sizeof(h), SEEK_SET);
+	sread(fd, &h, sizeof(h));
+	
+	/* Plain directory. */
+	if ((h.h_ino != INODE_NULL) || (h.h_magic != DIRHASH_MAGIC))
+		return (0);
+	
+	return (h.h_nbuckets);
+}
+
+/**
+ * @brief Searches for a directory entry in a hashed directory.
+ * 
+ * @param ip       Directory where the directory entry shall be searched. 
+ * @param filename Name of the directory entry that shall be searched.
+ * @param create   Create directory entry?
+ * @param nbuckets Number of hash buckets of the directory.
+ * 
+ * @returns The file offset where the directory entry is located, or -1 if the
+ *          file does not exist.
+ * 
+ * @note @p ip must point to a valid inode
+ * @note @p filename must point to a valid file name.
+ * @note The Minix file system must be mounted.
+ */
+static off_t dirhash_search
+(struct d_inode *ip, const char *filename, bool create, unsigned nbuckets)
+{
+	unsigned b;        /* Working bucket.          */
+	off_t off;         /* Working file offset.     */
+	off_t entry;       /* Free entry.              */
+	bool end;          /* End of the probe?        */
+	struct d_dirent d; /* Working directory entry. */
+	
+	entry = -1;
+	end = false;
+	b = dirhash(filename)%nbuckets;
+	for (unsigned n = 0; (n < nbuckets) && (!end); n++, b = (b + 1)%nbuckets)
+	{
+		off = minix_block_map(ip, b*BLOCK_SIZE, false)*BLOCK_SIZE;
+		slseek(fd, off, SEEK_SET);
+		
+		for (unsigned i = 0; i < DIRENTS_PER_BLOCK; i++)
+		{
+			sread(fd, &d, sizeof(struct d_dirent));
+			
+			/* Valid entry. */
+			if (d.d_ino != INODE_NULL)
+			{
+				/* Found. */
+				if (!strncmp(d.d_name, filename, MINIX_NAME_MAX))
+				{
+					/* Duplicate entry. */
+					if (create)
+						error("duplicate entry");
+					
+					return (off + i*sizeof(struct d_dirent));
+				}
+				
+				continue;
+			}
+			
+			/* Hashed directory header. */
+			if ((b == 0) && (i == DIRHASH_SLOT))
+				continue;
+			
+			/* Remember free entry. */
+			if (entry < 0)
+				entry = off + i*sizeof(struct d_dirent);
+			
+			/* Entry was never used. */
+			if (d.d_name[0] == '\0')
+			{
+				end = true;
+				break;
+			}
+		}
+	}
+	
+	/* All buckets are full, so search overflow entries. */
+	if (!end)
+	{
+		off = dirent_search_linear(ip, filename, false,
+			nbuckets*DIRENTS_PER_BLOCK);
+		
+		if (off >= 0)
+		{
+			/* Duplicate entry. */
+			if (create)
+				error("duplicate entry");
+			
+			return (off);
+		}
+	}
+	
+	/* No entry found. */
+	if (!create)
+		return (-1);
+	
+	/* No free entry in buckets. */
+	if (entry < 0)
+		return (dirent_search_linear(ip, filename, true,
+			nbuckets*DIRENTS_PER_BLOCK));
+	
+	return (entry);
+}
+
+/**
+ * @brief Searches for a directory entry.
+ * 
+ * @param ip       Directory where the directory entry shall be searched. 
+ * @param filename Name of the directory entry that shall be searched.
+ * @param create   Create directory entry?
+ * 
+ * @returns The file offset where the directory entry is located, or -1 if the
+ *          file does not exist.
+ * 
+ * @note @p ip must point to a valid inode
+ * @note @p filename must point to a valid file name.
+ * @note The Minix file system must be mounted.
+ */
+static off_t dirent_search(struct d_inode *ip, const char *filename,bool create)
+{
+	unsigned nbuckets;
+	
+	/* Hashed directory. */
+	if ((nbuckets = dirhash_buckets(ip)) > 0)
+		return (dirhash_search(ip, filename, create, nbuckets));
+	
+	return (dirent_search_linear(ip, filename, create, 0));
+}
+
 /**
  * @brief Searches for a file in a directory.
  * 
@@ -556,14 +856,47 @@ out:
 	return (num1);
 }
 
+/**
+ * @brief Looks up a file.
+ * 
+ * @param pathname Path name of the file.
+ * 
+ * @returns The inode number of the file.
+ * 
+ * @note @p pathname must point to a valid path name.
+ * @note The Minix file system must be mounted.
+ */
+uint16_t minix_lookup(const char *pathname)
+{
+	uint16_t num1, num2;               /* Working inode numbers. */
+	struct d_inode *ip;                /* Working inode.         */
+	char filename[MINIX_NAME_MAX + 1]; /* Working file name.     */
+	
+	/* Traverse file system tree. */
+	num2 = INODE_ROOT;
+	do
+	{
+		ip = minix_inode_read(num1 = num2);
+		pathname = break_path(pathname, filename);
+		num2 = dir_search(ip, filename);
+		minix_inode_write(num1, ip);
+		
+		if (num2 == INODE_NULL)
+			error("no such file");
+	} while (*pathname != '\0');
+	
+	return (num2);
+}
+
 /**
  * @brief Creates a directory.
  * 
  * @param dip      Directory where the new directory shall be created.
  * @param dnum     Inode number of @p dip.
  * @param filename Name of the new directory.
- * @param uid  User ID.
- * @param gid  User group ID.
+ * @param uid      User ID.
+ * @param gid      User group ID.
+ * @param nbuckets Number of hash buckets, or zero for a plain directory.
  * 
  * @returns The inode number of the newly created directory.
  * 
@@ -572,11 +905,13 @@ out:
  * @note The Minix file system must be mounted.
  */
 uint16_t minix_mkdir
-(struct d_inode *dip, uint16_t dnum, const char *filename, uint16_t uid, uint16_t gid)
+(struct d_inode *dip, uint16_t dnum, const char *filename, uint16_t uid, uint16_t gid, uint16_t nbuckets)
 {
 	uint16_t mode;
 	uint16_t num;
 	struct d_inode *ip;
+	struct d_dirhash h;
+	char zeros[BLOCK_SIZE];
 	
 	/* Not a directory. */
 	if (!S_ISDIR(dip->i_mode))
@@ -586,7 +921,7 @@ uint16_t minix_mkdir
 	mode |= S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH;
 	
 	/* Allocate inode. */
-	num = minix_inode_alloc(mode, uid, gid);
+	num = minix_inode_alloc(dnum, mode, uid, gid);
 	minix_dirent_add(dip, filename, num);
 	
 	/* Create "." and ".." */
@@ -594,6 +929,35 @@ uint16_t minix_mkdir
 	minix_dirent_add(ip, ".", num);
 	minix_dirent_add(ip, "..", dnum);
 	ip->i_nlinks--;
+	
+	/* Lay out hash buckets. */
+	if (nbuckets > 0)
+	{
+		if ((off_t)(nbuckets*BLOCK_SIZE) > (off_t)super.s_max_size)
+			error("too many hash buckets");
+		
+		memset(zeros, 0, BLOCK_SIZE);
+		for (unsigned b = 1; b < nbuckets; b++)
+		{
+			slseek(fd, minix_block_map(ip, b*BLOCK_SIZE, true)*BLOCK_SIZE,
+				SEEK_SET);
+			swrite(fd, zeros, BLOCK_SIZE);
+		}
+		ip->i_size = nbuckets*BLOCK_SIZE;
+		
+		/* Clear unused entries of the first bucket. */
+		slseek(fd, ip->i_zones[0]*BLOCK_SIZE + DIRHASH_SLOT*sizeof(h), SEEK_SET);
+		swrite(fd, zeros, BLOCK_SIZE - DIRHASH_SLOT*sizeof(h));
+		
+		/* Write header. */
+		memset(&h, 0, sizeof(h));
+		h.h_ino = INODE_NULL;
+		h.h_magic = DIRHASH_MAGIC;
+		h.h_nbuckets = nbuckets;
+		slseek(fd, ip->i_zones[0]*BLOCK_SIZE + DIRHASH_SLOT*sizeof(h), SEEK_SET);
+		swrite(fd, &h, sizeof(h));
+	}
+	
 	minix_inode_write(num, ip);
 	
 	return (num);
@@ -603,6 +967,7 @@ uint16_t minix_mkdir
  * @brief Creates a special file.
  * 
  * @param dip      Directory where the new special file shall be created.
+ * @param dnum     Inode number of the directory.
  * @param filename Name of the new special file.
  * @param mode     Access mode to new special file.
  * @param dev      Device which the new special file refers to.
@@ -614,7 +979,7 @@ uint16_t minix_mkdir
  * @note The Minix file system must be mounted.
  */
 void minix_mknod
-(struct d_inode *dip, const char *filename, uint16_t mode, uint16_t dev, uint16_t uid, uint16_t gid)
+(struct d_inode *dip, uint16_t dnum, const char *filename, uint16_t mode, uint16_t dev, uint16_t uid, uint16_t gid)
 {
 	uint16_t num;       /* Inode number of special file. */
 	struct d_inode *ip; /* Special file.                 */
@@ -626,7 +991,7 @@ void minix_mknod
 	mode = (mode & ~S_IFMT) | ((dev & 1) ? S_IFBLK : S_IFCHR);
 	
 	/* Allocate inode. */
-	num = minix_inode_alloc(mode, uid, gid);
+	num = minix_inode_alloc(dnum, mode, uid, gid);
 	minix_dirent_add(dip, filename, num);
 	
 	/* Write device number. */
@@ -661,7 +1026,7 @@ uint16_t minix_create
 	
 	dnum = minix_inode_dname(pathname, filename);
 	dip = minix_inode_read(dnum);
-	num = minix_inode_alloc(mode, uid, gid);
+	num = minix_inode_alloc(dnum, mode, uid, gid);
 	minix_dirent_add(dip, filename, num);
 	minix_inode_write(dnum, dip);
 	
@@ -715,6 +1080,259 @@ void minix_write(uint16_t num, const void *buf, size_t n)
 	minix_inode_write(num, ip);
 }
 
+/**
+ * @brief State of the defragmenter.
+ */
+static struct
+{
+	char *old;       /**< Data blocks, as found on disk.      */
+	char *new;       /**< Data blocks, as they will be laid.  */
+	block_t next;    /**< Next free data block of @p new.     */
+	bool *placed;    /**< Was an inode already laid out?      */
+	uint16_t *queue; /**< Directories to be walked.           */
+	unsigned head;   /**< Head of @p queue.                   */
+	unsigned tail;   /**< Tail of @p queue.                   */
+} defrag;
+
+/**
+ * @brief Gets a data block that was read by the defragmenter.
+ * 
+ * @param buf Data blocks.
+ * @param blk Block number.
+ * 
+ * @returns A pointer to the contents of @p blk in @p buf.
+ */
+static char *defrag_block(char *buf, block_t blk)
+{
+	if ((blk < super.s_first_data_block) ||
+		(blk >= super.s_first_data_block + super.s_nblocks))
+		error("bad block number");
+	
+	return (&buf[(blk - super.s_first_data_block)*BLOCK_SIZE]);
+}
+
+/**
+ * @brief Maps a file block number in a block number of the new layout.
+ * 
+ * @param ip    File to use, already laid out.
+ * @param logic File block number.
+ * 
+ * @returns The block number that is associated with @p logic, or
+ *          #BLOCK_NULL if it lays in a hole.
+ */
+static block_t defrag_map(struct d_inode *ip, block_t logic)
+{
+	block_t *buf; /* Indirect block. */
+	
+	/* Direct block. */
+	if (logic < NR_ZONES_DIRECT)
+		return (ip->i_zones[logic]);
+	
+	logic -= NR_ZONES_DIRECT;
+	
+	/* Single indirect block. */
+	if (logic < NR_SINGLE)
+	{
+		if (ip->i_zones[ZONE_SINGLE] == BLOCK_NULL)
+			return (BLOCK_NULL);
+		buf = (block_t *)defrag_block(defrag.new, ip->i_zones[ZONE_SINGLE]);
+		return (buf[logic]);
+	}
+	
+	logic -= NR_SINGLE;
+	
+	/* Double indirect block. */
+	if (ip->i_zones[ZONE_DOUBLE] == BLOCK_NULL)
+		return (BLOCK_NULL);
+	buf = (block_t *)defrag_block(defrag.new, ip->i_zones[ZONE_DOUBLE]);
+	if (buf[logic/NR_SINGLE] == BLOCK_NULL)
+		return (BLOCK_NULL);
+	buf = (block_t *)defrag_block(defrag.new, buf[logic/NR_SINGLE]);
+	return (buf[logic%NR_SINGLE]);
+}
+
+/**
+ * @brief Moves a data block to the next free block of the new layout.
+ * 
+ * @param blk Block number, as found on disk.
+ * 
+ * @returns The new block number of @p blk.
+ */
+static block_t defrag_move(block_t blk)
+{
+	block_t phys;
+	
+	/* Hole. */
+	if (blk == BLOCK_NULL)
+		return (BLOCK_NULL);
+	
+	phys = super.s_first_data_block + defrag.next;
+	memcpy(defrag_block(defrag.new, phys), defrag_block(defrag.old, blk),
+		BLOCK_SIZE);
+	bitmap_set(zmap.bitmap, defrag.next);
+	defrag.next++;
+	
+	return (phys);
+}
+
+/**
+ * @brief Moves an indirect block and the blocks that it refers to.
+ * 
+ * @param blk   Block number, as found on disk.
+ * @param level Level of indirection.
+ * 
+ * @returns The new block number of @p blk.
+ */
+static block_t defrag_move_indirect(block_t blk, int level)
+{
+	block_t *buf; /* Moved indirect block. */
+	
+	if ((blk = defrag_move(blk)) == BLOCK_NULL)
+		return (BLOCK_NULL);
+	
+	buf = (block_t *)defrag_block(defrag.new, blk);
+	for (unsigned i = 0; i < NR_SINGLE; i++)
+	{
+		buf[i] = (level > 1) ?
+			defrag_move_indirect(buf[i], level - 1) : defrag_move(buf[i]);
+	}
+	
+	return (blk);
+}
+
+/**
+ * @brief Lays out the blocks of a file contiguously.
+ * 
+ * @details Directories are also queued, so that their files get laid out
+ *          right after them.
+ * 
+ * @param num Inode number of the file.
+ */
+static void defrag_place(uint16_t num)
+{
+	struct d_inode *ip;
+	
+	/* Already placed. */
+	if (defrag.placed[num])
+		return;
+	defrag.placed[num] = true;
+	
+	ip = minix_inode_read(num);
+	
+	/* Special files have no blocks. */
+	if (!S_ISCHR(ip->i_mode) && !S_ISBLK(ip->i_mode))
+	{
+		for (unsigned i = 0; i < NR_ZONES_DIRECT; i++)
+			ip->i_zones[i] = defrag_move(ip->i_zones[i]);
+		ip->i_zones[ZONE_SINGLE] =
+			defrag_move_indirect(ip->i_zones[ZONE_SINGLE], 1);
+		ip->i_zones[ZONE_DOUBLE] =
+			defrag_move_indirect(ip->i_zones[ZONE_DOUBLE], 2);
+		
+		if (S_ISDIR(ip->i_mode))
+			defrag.queue[defrag.tail++] = num;
+	}
+	
+	minix_inode_write(num, ip);
+}
+
+/**
+ * @brief Lays out the files of a directory.
+ * 
+ * @param num Inode number of the directory.
+ */
+static void defrag_walk(uint16_t num)
+{
+	block_t blk;        /* Working block.           */
+	struct d_dirent *d; /* Working directory entry. */
+	struct d_inode *ip; /* Directory.               */
+	
+	ip = minix_inode_read(num);
+	
+	for (off_t off = 0; off < (off_t)ip->i_size; off += BLOCK_SIZE)
+	{
+		/* Skip hole. */
+		if ((blk = defrag_map(ip, off/BLOCK_SIZE)) == BLOCK_NULL)
+			continue;
+		
+		d = (struct d_dirent *)defrag_block(defrag.new, blk);
+		for (unsigned i = 0; i < DIRENTS_PER_BLOCK; i++)
+		{
+			if (off + i*sizeof(struct d_dirent) >= ip->i_size)
+				break;
+			if ((d[i].d_ino == INODE_NULL) || (d[i].d_ino > super.s_ninodes))
+				continue;
+			if (!strncmp(d[i].d_name, ".", MINIX_NAME_MAX) ||
+				!strncmp(d[i].d_name, "..", MINIX_NAME_MAX))
+				continue;
+			
+			defrag_place(d[i].d_ino);
+		}
+	}
+	
+	free(ip);
+}
+
+/**
+ * @brief Defragments the mounted Minix file system.
+ * 
+ * @details Files listed in @p order are laid out first, one after the other.
+ *          The directory tree is then walked breadth first, and every
+ *          directory gets laid out followed by its files. Each file is
+ *          written in a contiguous run of blocks, with indirect blocks
+ *          right before the blocks that they refer to.
+ * 
+ * @param order Inode numbers of files to be laid out first.
+ * @param n     Number of entries in @p order.
+ * 
+ * @note The Minix file system must be mounted.
+ */
+void minix_defrag(const uint16_t *order, unsigned n)
+{
+	size_t size; /* Size of data blocks (in bytes). */
+	
+	/* Read all data blocks. */
+	size = (size_t)super.s_nblocks*BLOCK_SIZE;
+	defrag.old = smalloc(size);
+	defrag.new = scalloc(super.s_nblocks, BLOCK_SIZE);
+	slseek(fd, super.s_first_data_block*BLOCK_SIZE, SEEK_SET);
+	sread(fd, defrag.old, size);
+	
+	defrag.placed = scalloc(super.s_ninodes + 1, sizeof(bool));
+	defrag.queue = smalloc((super.s_ninodes + 1)*sizeof(uint16_t));
+	defrag.head = defrag.tail = 0;
+	defrag.next = 0;
+	memset(zmap.bitmap, 0, zmap.size);
+	
+	/* Files that are accessed first. */
+	for (unsigned i = 0; i < n; i++)
+		defrag_place(order[i]);
+	
+	/* Directory tree. */
+	defrag_place(INODE_ROOT);
+	while (defrag.head < defrag.tail)
+		defrag_walk(defrag.queue[defrag.head++]);
+	
+	/* Unreachable files. */
+	for (uint16_t num = 1; num <= super.s_ninodes; num++)
+	{
+		if (imap.bitmap[IDX(num - 1)] & (1 << OFF(num - 1)))
+			defrag_place(num);
+	}
+	while (defrag.head < defrag.tail)
+		defrag_walk(defrag.queue[defrag.head++]);
+	
+	/* Write new layout. */
+	slseek(fd, super.s_first_data_block*BLOCK_SIZE, SEEK_SET);
+	swrite(fd, defrag.new, size);
+	
+	/* House keeping. */
+	free(defrag.queue);
+	free(defrag.placed);
+	free(defrag.new);
+	free(defrag.old);
+}
+
 /**
  * @brief Creates a Minix file system.
  * 
@@ -723,13 +1341,15 @@ void minix_write(uint16_t num, const void *buf, size_t n)
  * @param nblocks  Number of blocks.
  * @param uid  User ID.
  * @param gid  User group ID.
+ * @param journal Number of journal blocks, or zero for no journal.
  * 
  * @note @p diskfile must refer to a valid file.
  * @note @p ninodes must be valid.
  * @note @p nblocks must be valid.
+ * @note @p journal must be valid.
  */
 void minix_mkfs
-(const char *diskfile, uint16_t ninodes, uint16_t nblocks, uint16_t uid, uint16_t gid)
+(const char *diskfile, uint16_t ninodes, uint16_t nblocks, uint16_t uid, uint16_t gid, uint16_t journal)
 {
 	size_t size;            /* Size of file system.            */
 	char buf[BLOCK_SIZE];   /* Writing buffer.                 */
@@ -739,6 +1359,8 @@ void minix_mkfs
 	struct d_inode *root;   /* Root directory.                 */
 	mode_t mode;            /* Access permissions to root dir. */
 	uint16_t num;           /* Inode number of root directory. */
+	struct d_jheader *hdr;  /* Journal header.                 */
+	uint64_t max_size;      /* Maximum file size.              */
 	
 	fd = sopen(diskfile, O_RDWR | O_CREAT);
 	
@@ -755,6 +1377,7 @@ void minix_mkfs
 	size += imap_nblocks;  /* inode map    */
 	size += bmap_nblocks;  /* block map    */
 	size += inode_nblocks; /* inode blocks */
+	size += journal;       /* journal      */
 	size += nblocks;       /* data blocks  */
 	size <<= BLOCK_SIZE_LOG2;
 	
@@ -769,8 +1392,29 @@ void minix_mkfs
 	super.s_imap_nblocks = imap_nblocks;
 	super.s_bmap_nblocks = bmap_nblocks;
 	super.s_first_data_block = 2 + imap_nblocks + bmap_nblocks + inode_nblocks;
-	super.s_max_size = 532480;
+	super.s_log_block_size = BLOCK_SIZE_LOG2 - 10;
+	/*
+	 * Large blocks address more than a signed
+	 * 32-bit file offset reaches, and that is
+	 * all the kernel can represent.
+	 */
+	max_size = ((uint64_t)NR_ZONES_DIRECT + NR_SINGLE + NR_DOUBLE)*BLOCK_SIZE;
+	super.s_max_size = (max_size > 0x7fffffff) ? 0x7fffffff : max_size;
 	super.s_magic = SUPER_MAGIC;
+	super.s_journal_start = (journal > 0) ? super.s_first_data_block : 0;
+	super.s_journal_nblocks = journal;
+	super.s_first_data_block += journal;
+	
+	/* Write journal header. */
+	if (journal > 0)
+	{
+		hdr = (struct d_jheader *)buf;
+		hdr->h_magic = JOURNAL_MAGIC;
+		hdr->h_seq = 1;
+		hdr->h_start = 1;
+		slseek(fd, super.s_journal_start*BLOCK_SIZE, SEEK_SET);
+		swrite(fd, buf, BLOCK_SIZE);
+	}
 	
 	/* Create inode map. */
 	imap.size = imap_nblocks*BLOCK_SIZE;
@@ -785,7 +1429,7 @@ void minix_mkfs
 	mode |= S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH;
 	
 	/* Create root directory. */
-	num = minix_inode_alloc(mode, uid, gid);
+	num = minix_inode_alloc(INODE_NULL, mode, uid, gid);
 	root = minix_inode_read(num);
 	minix_dirent_add(root, ".", num);
 	minix_dirent_add(root, "..", num);
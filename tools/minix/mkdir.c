@@ -32,7 +32,7 @@
  */
 static void usage(void)
 {
-	printf("usage: mkdir.minix <input file> <directory> <uid> <gid>\n");
+	printf("usage: mkdir.minix <input file> <directory> <uid> <gid> [buckets]\n");
 	exit(EXIT_SUCCESS);
 }
 
@@ -42,13 +42,16 @@ static void usage(void)
 int main(int argc, char **argv)
 {
 	const char *dirname;               /* Directory that shall be created. */
+	uint16_t nbuckets;                 /* Hash buckets of the directory.   */
 	uint16_t num1, num2;               /* Working inode numbers.           */
 	struct d_inode *ip;                /* Working inode.                   */
 	char filename[MINIX_NAME_MAX + 1]; /* Working file name.               */
 	
 	/* Wrong usage. */
-	if (argc != 5)
+	if ((argc != 5) && (argc != 6))
 		usage();
+	
+	nbuckets = (argc == 6) ? atoi(argv[5]) : 0;
 
 	minix_mount(argv[1]);
 	
@@ -63,7 +66,10 @@ int main(int argc, char **argv)
 		
 		/* Create directory. */
 		if (num2 == INODE_NULL)
-			num2 = minix_mkdir(ip, num1, filename, atoi(argv[3]), atoi(argv[4]));
+		{
+			num2 = minix_mkdir(ip, num1, filename, atoi(argv[3]), atoi(argv[4]),
+				(*dirname == '\0') ? nbuckets : 0);
+		}
 		
 		minix_inode_write(num1, ip);
 		ip = minix_inode_read(num1 = num2);
@@ -27,7 +27,7 @@
  */
 static void usage(void)
 {
-	printf("usage: mkfs.minix <input file> <ninodes> <nblocks> <uid> <gid>\n");
+	printf("usage: mkfs.minix <input file> <ninodes> <nblocks> <uid> <gid> [journal blocks]\n");
 	exit(EXIT_SUCCESS);
 }
 
@@ -38,6 +38,7 @@ int main(int argc, char **argv)
 {
 	unsigned ninodes;     /* # inodes in the file system.      */
 	unsigned nblocks; 	  /* # data blocks in the file system. */
+	unsigned journal;     /* # journal blocks.                 */
 	const char *diskfile; /* Disk file name.                   */
 	
 	/* Missing arguments. */
@@ -48,8 +49,19 @@ int main(int argc, char **argv)
 	diskfile = argv[1];
 	sscanf(argv[2], "%u", &ninodes);
 	sscanf(argv[3], "%u", &nblocks);
+	journal = 0;
+	if (argc > 6)
+		sscanf(argv[6], "%u", &journal);
 	
-	minix_mkfs(diskfile, ninodes, nblocks, atoi(argv[4]), atoi(argv[5]));
+	/* Bad journal size. */
+	if ((journal > 0) && ((journal < JOURNAL_SIZE_MIN) || (journal > JOURNAL_SIZE_MAX)))
+	{
+		fprintf(stderr, "mkfs.minix: journal must have %d to %d blocks\n",
+			JOURNAL_SIZE_MIN, JOURNAL_SIZE_MAX);
+		exit(EXIT_FAILURE);
+	}
+	
+	minix_mkfs(diskfile, ninodes, nblocks, atoi(argv[4]), atoi(argv[5]), journal);
 	
 	return (EXIT_SUCCESS);
 }
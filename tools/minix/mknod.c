@@ -76,7 +76,7 @@ int main(int argc, char **argv)
 	minix_mount(argv[1]);	
 	num = minix_inode_dname(pathname, filename);
 	dip = minix_inode_read(num);
-	minix_mknod(dip, filename, mode, devnum(type, major, minor), atoi(argv[7]), atoi(argv[8]));
+	minix_mknod(dip, num, filename, mode, devnum(type, major, minor), atoi(argv[7]), atoi(argv[8]));
 	minix_inode_write(num, dip);
 	minix_umount();
 	
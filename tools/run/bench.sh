@@ -0,0 +1,231 @@
+#
+# Copyright(C) 2011-2016 Pedro H. Penna <pedrohenriquepenna@gmail.com>
+#
+# This file is part of Nanvix.
+#
+# Nanvix is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# Nanvix is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with Nanvix.  If not, see <http://www.gnu.org/licenses/>.
+#
+
+# NOTES:
+#   - Run "make bench-image" first, so that init runs the benchmark suites.
+#   - Results are normalized to one "<key> <metric> <value> <dir>" line per
+#     metric, where dir is "-" if lower is better and "+" otherwise.
+
+VERSION_MAJOR=1
+VERSION_MINOR=0
+KVM=false
+LOG="bench-serial.log"
+OUTPUT="bench-results.txt"
+BASELINE="tools/run/bench-baseline.txt"
+THRESHOLD=10
+TIMEOUT=1800
+UPDATE=false
+
+version()
+{
+    echo "bench (Nanvix tools) $VERSION_MAJOR.$VERSION_MINOR"
+    echo "Copyright(C) 2011-2016 Pedro H. Penna"
+    echo "This is free software under the GNU General Public License Version 3."
+    echo "There is NO WARRANTY, to the extent permitted by law."
+}
+
+usage()
+{
+    echo "Usage: bench [options]"
+    echo "Brief: Runs the benchmark image headless inside QEMU and checks results."
+    echo "Options:"
+    echo "      --help             Display this information and exit"
+    echo "      --version          Display program version and exit"
+    echo "      --kvm              Use KVM acceleration (default=false)"
+    echo "      --log=FILE         Raw serial console log (default=$LOG)"
+    echo "      --output=FILE      Normalized results (default=$OUTPUT)"
+    echo "      --baseline=FILE    Baseline results (default=$BASELINE)"
+    echo "      --threshold=PCT    Regression threshold (default=$THRESHOLD)"
+    echo "      --timeout=SECS     Give up after SECS seconds (default=$TIMEOUT)"
+    echo "      --update-baseline  Store results as the new baseline"
+}
+
+#
+# Boots the benchmark image and captures the serial console.
+#
+run_qemu()
+{
+    FLAGS="-m 16 -cdrom nanvix.iso -boot d"
+    FLAGS="$FLAGS -drive file=hdd.img,format=raw,if=ide,index=0"
+    FLAGS="$FLAGS -display none -monitor none -serial file:$LOG"
+
+    if [ "$KVM" = true ]; then
+        FLAGS="$FLAGS -machine accel=kvm"
+    else
+        FLAGS="$FLAGS -machine accel=tcg"
+    fi;
+
+    rm -f $LOG
+    qemu-system-i386 $FLAGS &
+    PID=$!
+
+    # Wait for the suites to finish.
+    ELAPSED=0
+    while ! grep -q "^### done" $LOG 2>/dev/null; do
+        if ! kill -0 $PID 2>/dev/null; then
+            echo "ERROR: QEMU exited before the benchmarks were done"
+            return 1
+        fi;
+        if [ $ELAPSED -ge $TIMEOUT ]; then
+            echo "ERROR: benchmarks timed out after $TIMEOUT seconds"
+            kill $PID
+            return 1
+        fi;
+        sleep 5
+        ELAPSED=$((ELAPSED + 5))
+    done
+
+    kill $PID 2>/dev/null
+    wait $PID 2>/dev/null
+    return 0
+}
+
+#
+# Normalizes the serial console log.
+#   $1 Serial console log.
+#
+normalize()
+{
+    tr -d '\r' < $1 | awk '
+        /^### suite / { suite = $3; next }
+        /^### end /   { suite = ""; next }
+        /^#/          { next }
+        suite == ""   { next }
+
+        # bench: <name> <ops> <cycles/op> <ns/op>
+        suite == "bench" && NF == 4 {
+            print suite "/" $1, "ns_per_op", $4, "-"
+            next
+        }
+
+        # fsbench: <test> <size> <ops> <MB/s> <ops/s> <p50> <p90> <p99> <max>
+        suite ~ /^fsbench/ && NF == 9 {
+            key = suite "/" $1 "/" $2
+            print key, "ops_per_sec", $5, "+"
+            print key, "p50_ns", $6, "-"
+            print key, "p99_ns", $8, "-"
+            next
+        }
+
+        # mmbench and schedbench: key=value pairs.
+        /=/ {
+            key = suite
+            nm = 0
+            for (i = 1; i <= NF; i++) {
+                split($i, kv, "=")
+                if (kv[1] ~ /^(test|pct|pages|dist|hogs|sleepers|nice)$/)
+                    key = key "/" kv[2]
+                else if (kv[1] ~ /^(ns_per_|p50_|p99_|max_)/)
+                    m[++nm] = kv[1] " " kv[2] " -"
+                else if (kv[1] ~ /^(kbps|ops_per_sec|iters_per_sec)$/)
+                    m[++nm] = kv[1] " " kv[2] " +"
+            }
+            for (i = 1; i <= nm; i++)
+                print key, m[i]
+        }
+    '
+}
+
+#
+# Compares results against a baseline.
+#   $1 Baseline.
+#   $2 Results.
+#
+compare()
+{
+    awk -v t=$THRESHOLD '
+        NR == FNR { base[$1 " " $2] = $3; next }
+        !(($1 " " $2) in base) { next }
+        {
+            b = base[$1 " " $2]
+            if (b == 0)
+                next
+            d = ($3 - b)*100/b
+            bad = (($4 == "-") && (d > t)) || (($4 == "+") && (-d > t))
+            printf "%-40s %-14s %12d %12d %+7.1f%%%s\n", \
+                $1, $2, b, $3, d, (bad) ? "  REGRESSION" : ""
+            if (bad)
+                n++
+        }
+        END {
+            printf "%d regression(s) beyond %d%%\n", n, t
+            exit (n > 0)
+        }
+    ' $1 $2
+}
+
+while [ "$1" != "" ]; do
+    PARAM=`echo $1 | awk -F= '{print $1}'`
+    VALUE=`echo $1 | awk -F= '{print $2}'`
+    case $PARAM in
+        -h | --help)
+            usage
+            exit
+            ;;
+        -v | --version)
+            version
+            exit
+            ;;
+        --kvm)
+            KVM=true
+            ;;
+        --log)
+            LOG=$VALUE
+            ;;
+        --output)
+            OUTPUT=$VALUE
+            ;;
+        --baseline)
+            BASELINE=$VALUE
+            ;;
+        --threshold)
+            THRESHOLD=$VALUE
+            ;;
+        --timeout)
+            TIMEOUT=$VALUE
+            ;;
+        --update-baseline)
+            UPDATE=true
+            ;;
+        *)
+            echo "ERROR: unknown parameter \"$PARAM\""
+            usage
+            exit 1
+            ;;
+    esac
+    shift
+done
+
+run_qemu || exit 1
+
+normalize $LOG > $OUTPUT
+echo "$(wc -l < $OUTPUT) results written to $OUTPUT"
+
+if [ "$UPDATE" = true ]; then
+    cp $OUTPUT $BASELINE
+    echo "baseline updated: $BASELINE"
+    exit
+fi;
+
+if [ ! -f $BASELINE ]; then
+    echo "no baseline found, run with --update-baseline to store one"
+    exit
+fi;
+
+compare $BASELINE $OUTPUT
@@ -9,3 +9,6 @@ ata0: enabled=1, ioaddr1=0x1f0, ioaddr2=0x3f0, irq=14
 ata1: enabled=1, ioaddr1=0x170, ioaddr2=0x370, irq=15
 ata0-master: type=disk, path=hdd.img, mode=flat, cylinders=130, heads=16, spt=63
 ata0-slave: type=cdrom, path=nanvix.iso, status=inserted
+# Swap disk on the secondary channel (see SWAP_DEV in include/nanvix/config.h).
+# Create it with: dd if=/dev/zero of=swp.img bs=512 count=33264
+#ata1-master: type=disk, path=swp.img, mode=flat, cylinders=33, heads=16, spt=63
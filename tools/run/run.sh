@@ -26,6 +26,9 @@ BOCHS_CONFIG="tools/run/bochsrc.txt"
 DEBUG=false
 RT=false
 SDL=false
+QEMU=false
+VIRTIO=false
+NET=false
 
 version()
 {
@@ -38,13 +41,16 @@ version()
 usage()
 {
     echo "Usage: run"
-    echo "Brief: Runs nanvix inside bochs."
+    echo "Brief: Runs nanvix inside bochs or QEMU."
     echo "Options:"
     echo "      --help       Display this information and exit"
     echo "      --version    Display program version and exit"
     echo "      --debug      Enables GDB support (default=false)"
     echo "      --real-time  Enables real-time clock support (default=false)"
     echo "      --sdl        Uses sdl2 display library (default=term)"
+    echo "      --qemu       Runs inside QEMU instead of bochs (default=false)"
+    echo "      --virtio     Attaches the hard disk as virtio-blk (implies --qemu)"
+    echo "      --net        Attaches a virtio-net card, host port 8080 to guest 80 (implies --qemu)"
 }
 
 debug()
@@ -62,6 +68,51 @@ sdl()
     SDL=true
 }
 
+qemu()
+{
+    QEMU=true
+}
+
+virtio()
+{
+    QEMU=true
+    VIRTIO=true
+}
+
+net()
+{
+    QEMU=true
+    NET=true
+}
+
+run_qemu()
+{
+    FLAGS="-m 16 -machine accel=kvm:tcg -cdrom nanvix.iso -boot d"
+
+    # Setup ROOT_DEV in include/nanvix/config.h accordingly.
+    if [ "$VIRTIO" = true ]; then
+        FLAGS="$FLAGS -drive file=hdd.img,format=raw,if=virtio"
+    else
+        FLAGS="$FLAGS -drive file=hdd.img,format=raw,if=ide,index=0"
+    fi;
+
+    # User networking hands out the addresses in include/nanvix/config.h.
+    if [ "$NET" = true ]; then
+        FLAGS="$FLAGS -netdev user,id=net0,hostfwd=tcp::8080-:80"
+        FLAGS="$FLAGS -device virtio-net-pci,netdev=net0"
+    fi;
+
+    if [ "$DEBUG" = true ]; then
+        FLAGS="$FLAGS -s -S"
+    fi;
+
+    if [ "$SDL" = false ]; then
+        FLAGS="$FLAGS -display curses"
+    fi;
+
+    qemu-system-i386 $FLAGS
+}
+
 config_bochs()
 {
     cat $BOCHS_CONFIG.tpl > $BOCHS_CONFIG
@@ -103,6 +154,15 @@ while [ "$1" != "" ]; do
         -s  | --sdl)
             sdl
             ;;
+        -q  | --qemu)
+            qemu
+            ;;
+        --virtio)
+            virtio
+            ;;
+        --net)
+            net
+            ;;
         *)
             echo "ERROR: unknown parameter \"$PARAM\""
             usage
@@ -112,6 +172,11 @@ while [ "$1" != "" ]; do
     shift
 done
 
+if [ "$QEMU" = true ]; then
+    run_qemu
+    exit
+fi;
+
 config_bochs
 
 bochs -q -f tools/run/bochsrc.txt